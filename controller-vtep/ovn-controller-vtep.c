@@ -32,12 +32,15 @@
 #include "simap.h"
 #include "ovsdb-idl.h"
 #include "smap.h"
+#include "sset.h"
 #include "stream.h"
 #include "stream-ssl.h"
 #include "unixctl.h"
 #include "util.h"
+#include "uuidset.h"
 #include "openvswitch/vconn.h"
 #include "openvswitch/vlog.h"
+#include "lib/inc-proc-eng.h"
 #include "lib/ovn-sb-idl.h"
 #include "lib/ovn-util.h"
 #include "vtep/vtep-idl.h"
@@ -103,6 +106,134 @@ update_idl_probe_interval(struct ovsdb_idl *ovn_sb_idl,
     set_idl_probe_interval(ovn_sb_idl, ovnsb_remote, interval);
 }
 
+/* Engine input nodes.
+ *
+ * Only the tables that gateway_run(), binding_run() and vtep_run() read are
+ * inputs of the engine, so that, e.g., MACs learned by the hardware switch in
+ * the VTEP Ucast_Macs_Local table do not wake up a full recomputation. */
+#define SB_NODES \
+    SB_NODE(chassis, "chassis") \
+    SB_NODE(encap, "encap") \
+    SB_NODE(datapath_binding, "datapath_binding") \
+    SB_NODE(port_binding, "port_binding")
+
+#define VTEP_NODES \
+    VTEP_NODE(physical_switch, "physical_switch") \
+    VTEP_NODE(physical_port, "physical_port") \
+    VTEP_NODE(logical_switch, "logical_switch") \
+    VTEP_NODE(ucast_macs_remote, "ucast_macs_remote") \
+    VTEP_NODE(mcast_macs_remote, "mcast_macs_remote") \
+    VTEP_NODE(physical_locator, "physical_locator") \
+    VTEP_NODE(physical_locator_set, "physical_locator_set")
+
+#define SB_NODE(NAME, NAME_STR) ENGINE_FUNC_SB(NAME);
+SB_NODES
+#undef SB_NODE
+
+#define VTEP_NODE(NAME, NAME_STR) ENGINE_FUNC_VTEP(NAME);
+VTEP_NODES
+#undef VTEP_NODE
+
+/* Engine node that keeps the SB Chassis and Port_Binding tables and the VTEP
+ * database in sync.  Its run() method is the full recomputation done by
+ * gateway_run(), binding_run() and vtep_run(). */
+struct ed_type_vtep {
+    /* Names of the VTEP physical switches, which are also the names of the
+     * chassis that represent them in the SB database. */
+    struct sset pswitches;
+
+    /* Datapaths with at least one "vtep" port binding.  These are the only
+     * datapaths whose ports can end up in the VTEP database. */
+    struct uuidset datapaths;
+};
+
+static void *
+en_vtep_init(struct engine_node *node OVS_UNUSED,
+             struct engine_arg *arg OVS_UNUSED)
+{
+    struct ed_type_vtep *data = xzalloc(sizeof *data);
+
+    sset_init(&data->pswitches);
+    uuidset_init(&data->datapaths);
+    return data;
+}
+
+static void
+en_vtep_cleanup(void *data_)
+{
+    struct ed_type_vtep *data = data_;
+
+    sset_destroy(&data->pswitches);
+    uuidset_destroy(&data->datapaths);
+}
+
+static void
+en_vtep_run(struct engine_node *node, void *data_)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct controller_vtep_ctx *ctx = eng_ctx->client_ctx;
+    struct ed_type_vtep *data = data_;
+
+    gateway_run(ctx);
+    binding_run(ctx);
+    vtep_run(ctx);
+
+    const struct vteprec_physical_switch_table *ps_table =
+        EN_OVSDB_GET(engine_get_input("VTEP_physical_switch", node));
+    const struct vteprec_physical_switch *pswitch;
+
+    sset_clear(&data->pswitches);
+    VTEPREC_PHYSICAL_SWITCH_TABLE_FOR_EACH (pswitch, ps_table) {
+        sset_add(&data->pswitches, pswitch->name);
+    }
+
+    const struct sbrec_port_binding_table *pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    const struct sbrec_port_binding *pb;
+
+    uuidset_clear(&data->datapaths);
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (pb, pb_table) {
+        if (!strcmp(pb->type, "vtep") && pb->datapath) {
+            uuidset_insert(&data->datapaths, &pb->datapath->header_.uuid);
+        }
+    }
+
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+/* Port_Binding changes only matter if they touch a datapath attached to a
+ * VTEP logical switch or a port bound to a VTEP chassis.  Changes to the
+ * ports that link datapaths together are not tracked here and always fall
+ * back to a recompute. */
+static bool
+vtep_sb_port_binding_handler(struct engine_node *node, void *data_)
+{
+    const struct sbrec_port_binding_table *pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    struct ed_type_vtep *data = data_;
+    const struct sbrec_port_binding *pb;
+
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, pb_table) {
+        if (!strcmp(pb->type, "vtep") || !strcmp(pb->type, "patch")
+            || !strcmp(pb->type, "chassisredirect")) {
+            return false;
+        }
+        if (sbrec_port_binding_is_updated(pb,
+                                          SBREC_PORT_BINDING_COL_DATAPATH)) {
+            return false;
+        }
+        if (pb->chassis
+            && sset_contains(&data->pswitches, pb->chassis->name)) {
+            return false;
+        }
+        if (pb->datapath
+            && uuidset_find(&data->datapaths, &pb->datapath->header_.uuid)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -172,6 +303,38 @@ main(int argc, char *argv[])
     ovsdb_idl_set_leader_only(ovnsb_idl_loop.idl, false);
     ovsdb_idl_get_initial_snapshot(ovnsb_idl_loop.idl);
 
+    ovsdb_idl_track_add_all(ovnsb_idl_loop.idl);
+    ovsdb_idl_track_add_all(vtep_idl_loop.idl);
+
+    /* Define inc-proc-engine nodes. */
+    ENGINE_NODE(vtep, "vtep");
+#define SB_NODE(NAME, NAME_STR) ENGINE_NODE_SB(NAME, NAME_STR);
+    SB_NODES
+#undef SB_NODE
+
+#define VTEP_NODE(NAME, NAME_STR) ENGINE_NODE_VTEP(NAME, NAME_STR);
+    VTEP_NODES
+#undef VTEP_NODE
+
+    /* Add dependencies between inc-proc-engine nodes. */
+    engine_add_input(&en_vtep, &en_sb_chassis, NULL);
+    engine_add_input(&en_vtep, &en_sb_encap, NULL);
+    engine_add_input(&en_vtep, &en_sb_datapath_binding, NULL);
+    engine_add_input(&en_vtep, &en_sb_port_binding,
+                     vtep_sb_port_binding_handler);
+
+#define VTEP_NODE(NAME, NAME_STR) \
+    engine_add_input(&en_vtep, &en_vtep_##NAME, NULL);
+    VTEP_NODES
+#undef VTEP_NODE
+
+    struct engine_arg engine_arg = {
+        .sb_idl = ovnsb_idl_loop.idl,
+        .vtep_idl = vtep_idl_loop.idl,
+    };
+    engine_init(&en_vtep, &engine_arg);
+    engine_set_force_recompute(true);
+
     char *ovn_version = ovn_get_internal_version();
     VLOG_INFO("OVN internal version is : [%s]", ovn_version);
 
@@ -183,12 +346,19 @@ main(int argc, char *argv[])
     /* Main loop. */
     exiting = false;
     while (!exiting) {
+        engine_init_run();
+
         struct controller_vtep_ctx ctx = {
             .vtep_idl = vtep_idl_loop.idl,
             .vtep_idl_txn = ovsdb_idl_loop_run(&vtep_idl_loop),
             .ovnsb_idl = ovnsb_idl_loop.idl,
             .ovnsb_idl_txn = ovsdb_idl_loop_run(&ovnsb_idl_loop),
         };
+        struct engine_context eng_ctx = {
+            .ovnsb_idl_txn = ctx.ovnsb_idl_txn,
+            .client_ctx = &ctx,
+        };
+        engine_set_context(&eng_ctx);
 
         memory_run();
         if (memory_should_report()) {
@@ -205,9 +375,20 @@ main(int argc, char *argv[])
             ovsdb_idl_has_ever_connected(vtep_idl_loop.idl) &&
             check_northd_version(vtep_idl_loop.idl, ovnsb_idl_loop.idl,
                                  ovn_version)) {
-            gateway_run(&ctx);
-            binding_run(&ctx);
-            vtep_run(&ctx);
+            if (ctx.ovnsb_idl_txn && ctx.vtep_idl_txn) {
+                engine_run(true);
+            }
+            if (!engine_has_run()) {
+                if (engine_need_run()) {
+                    VLOG_DBG("engine did not run, force recompute next time");
+                    engine_set_force_recompute(true);
+                }
+            } else {
+                engine_set_force_recompute(false);
+            }
+        } else {
+            /* Whatever changed in the meantime was not processed. */
+            engine_set_force_recompute(true);
         }
 
         unixctl_server_run(unixctl);
@@ -217,8 +398,16 @@ main(int argc, char *argv[])
         if (exiting) {
             poll_immediate_wake();
         }
-        ovsdb_idl_loop_commit_and_wait(&vtep_idl_loop);
-        ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop);
+        if (!ovsdb_idl_loop_commit_and_wait(&vtep_idl_loop)) {
+            VLOG_INFO("VTEP commit failed, force recompute next time.");
+            engine_set_force_recompute(true);
+        }
+        if (!ovsdb_idl_loop_commit_and_wait(&ovnsb_idl_loop)) {
+            VLOG_INFO("OVNSB commit failed, force recompute next time.");
+            engine_set_force_recompute(true);
+        }
+        ovsdb_idl_track_clear(vtep_idl_loop.idl);
+        ovsdb_idl_track_clear(ovnsb_idl_loop.idl);
         poll_block();
         if (should_service_stop()) {
             exiting = true;
@@ -249,6 +438,8 @@ main(int argc, char *argv[])
         poll_block();
     }
 
+    engine_set_context(NULL);
+    engine_cleanup();
     unixctl_server_destroy(unixctl);
 
     ovsdb_idl_loop_destroy(&vtep_idl_loop);
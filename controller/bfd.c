@@ -117,7 +117,7 @@ bfd_calculate_active_tunnels(const struct ovsrec_bridge *br_int,
  *
  * If 'our_chassis' is C5 then this function returns empty bfd set.
  */
-static void
+void
 bfd_calculate_chassis(
     const struct sbrec_chassis *our_chassis,
     const struct sbrec_ha_chassis_group_table *ha_chassis_grp_table,
@@ -178,19 +178,48 @@ bfd_calculate_chassis(
     }
 }
 
+/* Inputs of the last bfd_run() and the BFD chassis computed from them. */
+static struct sset bfd_chassis_set = SSET_INITIALIZER(&bfd_chassis_set);
+static const struct sbrec_chassis *bfd_chassis_rec;
+static const struct ovsrec_bridge *bfd_br_int;
+static unsigned int bfd_ovs_seqno;
+static unsigned int bfd_sb_seqno;
+static bool bfd_ran;
+
+/* Enables BFD on the tunnels to the chassis that share an HA chassis group
+ * with 'chassis_rec', and disables it on the others.  'ovs_seqno' and
+ * 'sb_seqno' are the change sequence numbers of the OVS and SB IDLs: all
+ * the work is skipped if they and the other arguments didn't change since
+ * the last call, and the BFD chassis are only computed again if the SB
+ * database or 'chassis_rec' changed. */
 void
 bfd_run(const struct ovsrec_interface_table *interface_table,
         const struct ovsrec_bridge *br_int,
         const struct sbrec_chassis *chassis_rec,
         const struct sbrec_ha_chassis_group_table *ha_chassis_grp_table,
-        const struct sbrec_sb_global_table *sb_global_table)
+        const struct sbrec_sb_global_table *sb_global_table,
+        unsigned int ovs_seqno, unsigned int sb_seqno)
 {
     if (!chassis_rec) {
         return;
     }
-    struct sset bfd_chassis = SSET_INITIALIZER(&bfd_chassis);
-    bfd_calculate_chassis(chassis_rec, ha_chassis_grp_table,
-                          &bfd_chassis);
+
+    bool sb_changed = !bfd_ran || sb_seqno != bfd_sb_seqno
+                      || chassis_rec != bfd_chassis_rec;
+    if (!sb_changed && ovs_seqno == bfd_ovs_seqno && br_int == bfd_br_int) {
+        return;
+    }
+    bfd_ran = true;
+    bfd_chassis_rec = chassis_rec;
+    bfd_br_int = br_int;
+    bfd_ovs_seqno = ovs_seqno;
+    bfd_sb_seqno = sb_seqno;
+
+    if (sb_changed) {
+        sset_clear(&bfd_chassis_set);
+        bfd_calculate_chassis(chassis_rec, ha_chassis_grp_table,
+                              &bfd_chassis_set);
+    }
 
     /* Identify tunnels ports(connected to remote chassis id) to enable bfd */
     struct sset tunnels = SSET_INITIALIZER(&tunnels);
@@ -205,7 +234,7 @@ bfd_run(const struct ovsrec_interface_table *interface_table,
             sset_add(&tunnels, port_name);
 
             if (encaps_tunnel_id_parse(tunnel_id, &chassis_name, NULL, NULL)) {
-                if (sset_contains(&bfd_chassis, chassis_name)) {
+                if (sset_contains(&bfd_chassis_set, chassis_name)) {
                     sset_add(&bfd_ifaces, port_name);
                 }
                 free(chassis_name);
@@ -270,5 +299,11 @@ bfd_run(const struct ovsrec_interface_table *interface_table,
     smap_destroy(&bfd);
     sset_destroy(&tunnels);
     sset_destroy(&bfd_ifaces);
-    sset_destroy(&bfd_chassis);
+}
+
+void
+bfd_destroy(void)
+{
+    sset_destroy(&bfd_chassis_set);
+    bfd_ran = false;
 }
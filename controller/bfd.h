@@ -33,9 +33,14 @@ void bfd_run(const struct ovsrec_interface_table *,
              const struct ovsrec_bridge *,
              const struct sbrec_chassis *,
              const struct sbrec_ha_chassis_group_table *,
-             const struct sbrec_sb_global_table *);
+             const struct sbrec_sb_global_table *,
+             unsigned int ovs_seqno, unsigned int sb_seqno);
+void bfd_destroy(void);
 
 void  bfd_calculate_active_tunnels(const struct ovsrec_bridge *br_int,
                                    struct sset *active_tunnels);
+void bfd_calculate_chassis(const struct sbrec_chassis *our_chassis,
+                           const struct sbrec_ha_chassis_group_table *,
+                           struct sset *bfd_chassis);
 
 #endif
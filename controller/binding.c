@@ -16,7 +16,9 @@
 #include <config.h>
 
 /* OVS includes. */
+#include "coverage.h"
 #include "lib/bitmap.h"
+#include "lib/hmapx.h"
 #include "openvswitch/poll-loop.h"
 #include "lib/sset.h"
 #include "lib/util.h"
@@ -31,6 +33,7 @@
 #include "if-status.h"
 #include "lflow.h"
 #include "lib/chassis-index.h"
+#include "lib/inc-proc-eng.h"
 #include "lib/ovn-sb-idl.h"
 #include "local_data.h"
 #include "lport.h"
@@ -40,12 +43,15 @@
 
 VLOG_DEFINE_THIS_MODULE(binding);
 
+COVERAGE_DEFINE(binding_claim_over_budget);
+
 /* External ID to be set in the OVS.Interface record when the OVS interface
  * is ready for use, i.e., is bound to an OVN port and its corresponding
  * flows have been installed.
  */
 #define OVN_INSTALLED_EXT_ID "ovn-installed"
 #define OVN_INSTALLED_TS_EXT_ID "ovn-installed-ts"
+#define OVN_INSTALL_TIMINGS_EXT_ID "ovn-install-timings"
 
 #define OVN_QOS_TYPE "linux-htb"
 
@@ -63,6 +69,9 @@ static struct shash _claimed_ports = SHASH_INITIALIZER(&_claimed_ports);
 static struct sset _postponed_ports = SSET_INITIALIZER(&_postponed_ports);
 static struct shash _qos_ports = SHASH_INITIALIZER(&_qos_ports);
 
+/* Ports claimed by the current engine run. */
+static size_t n_run_claims;
+
 static void
 remove_additional_chassis(const struct sbrec_port_binding *pb,
                           const struct sbrec_chassis *chassis_rec);
@@ -950,8 +959,8 @@ local_binding_is_down(struct shash *local_bindings, const char *pb_name,
 void
 local_binding_set_up(struct shash *local_bindings, const char *pb_name,
                      const struct sbrec_chassis *chassis_rec,
-                     const char *ts_now_str, bool sb_readonly,
-                     bool ovs_readonly)
+                     const char *ts_now_str, const char *timings,
+                     bool sb_readonly, bool ovs_readonly)
 {
     struct local_binding *lbinding =
         local_binding_find(local_bindings, pb_name);
@@ -967,6 +976,10 @@ local_binding_set_up(struct shash *local_bindings, const char *pb_name,
         ovsrec_interface_update_external_ids_setkey(lbinding->iface,
                                                     OVN_INSTALLED_TS_EXT_ID,
                                                     ts_now_str);
+        if (timings) {
+            ovsrec_interface_update_external_ids_setkey(
+                lbinding->iface, OVN_INSTALL_TIMINGS_EXT_ID, timings);
+        }
     }
 
     if (!sb_readonly && lbinding && b_lport && b_lport->pb->n_up &&
@@ -1317,6 +1330,33 @@ lport_maybe_postpone(const char *port_name, long long int now,
     return true;
 }
 
+/* Returns true, after adding 'port_name' to 'postponed_ports', if the current
+ * engine run is over its time budget, in which case the claim of
+ * 'port_name' is left for the next run.  At least one port is claimed per
+ * run, so that the claims progress whatever the budget. */
+static bool
+lport_postpone_over_budget(const char *port_name,
+                           struct sset *postponed_ports)
+{
+    if (!n_run_claims || !engine_over_budget()) {
+        return false;
+    }
+
+    sset_add(postponed_ports, port_name);
+    engine_yield();
+    COVERAGE_INC(binding_claim_over_budget);
+    VLOG_DBG("Postponed claim on logical port %s, over the engine time "
+             "budget.", port_name);
+
+    return true;
+}
+
+void
+binding_init_run(void)
+{
+    n_run_claims = 0;
+}
+
 static bool
 is_postponed_port(const char *port_name)
 {
@@ -1348,6 +1388,11 @@ claim_lport(const struct sbrec_port_binding *pb,
                     return true;
                 }
             }
+            if (lport_postpone_over_budget(pb->logical_port,
+                                           postponed_ports)) {
+                return true;
+            }
+            n_run_claims++;
             if (is_additional_chassis(pb, chassis_rec)) {
                 if (sb_readonly) {
                     return false;
@@ -1563,7 +1608,8 @@ consider_vif_lport_(const struct sbrec_port_binding *pb,
                                b_ctx_in->sbrec_port_binding_by_name,
                                pb->datapath, b_ctx_in->chassis_rec,
                                b_ctx_out->local_datapaths,
-                               b_ctx_out->tracked_dp_bindings);
+                               b_ctx_out->tracked_dp_bindings,
+                               b_ctx_in->lazy_dps, b_ctx_out->lazy_peer_dps);
             update_related_lport(pb, b_ctx_out);
             update_local_lports(pb->logical_port, b_ctx_out);
             if (binding_lport_update_port_sec(b_lport, pb) &&
@@ -1865,7 +1911,8 @@ consider_nonvif_lport_(const struct sbrec_port_binding *pb,
                            b_ctx_in->sbrec_port_binding_by_name,
                            pb->datapath, b_ctx_in->chassis_rec,
                            b_ctx_out->local_datapaths,
-                           b_ctx_out->tracked_dp_bindings);
+                           b_ctx_out->tracked_dp_bindings,
+                           b_ctx_in->lazy_dps, b_ctx_out->lazy_peer_dps);
 
         update_related_lport(pb, b_ctx_out);
         return claim_lport(pb, NULL, b_ctx_in->chassis_rec, NULL,
@@ -1971,7 +2018,8 @@ consider_ha_lport(const struct sbrec_port_binding *pb,
                            b_ctx_in->sbrec_port_binding_by_name,
                            pb->datapath, b_ctx_in->chassis_rec,
                            b_ctx_out->local_datapaths,
-                           b_ctx_out->tracked_dp_bindings);
+                           b_ctx_out->tracked_dp_bindings,
+                           b_ctx_in->lazy_dps, b_ctx_out->lazy_peer_dps);
         update_related_lport(pb, b_ctx_out);
     }
 
@@ -2505,15 +2553,41 @@ consider_iface_release(const struct ovsrec_interface *iface_rec,
     return true;
 }
 
+/* Returns true if 'iface_rec' is a VIF, i.e. an interface that can be bound
+ * to a logical port through its external_ids:iface-id, as binding_run()
+ * does for all the interfaces of br-int.  Besides the system and internal
+ * ones, that includes the DPDK vhost-user, tap, AF_XDP... interfaces.  The
+ * patch and tunnel interfaces, which are created by ovn-controller itself,
+ * aren't VIFs. */
 static bool
 is_iface_vif(const struct ovsrec_interface *iface_rec)
 {
-    if (iface_rec->type && iface_rec->type[0] &&
-        strcmp(iface_rec->type, "internal")) {
+    return (strcmp(iface_rec->type, "patch")
+            && strcmp(iface_rec->type, "geneve")
+            && strcmp(iface_rec->type, "vxlan")
+            && strcmp(iface_rec->type, "stt"));
+}
+
+/* Returns true if 'iface_rec' is a tunnel interface whose change doesn't
+ * affect the runtime data.  Tunnels are only used by the runtime data to
+ * build the active tunnels, which depend on their BFD status. */
+static bool
+is_iface_tunnel_without_bfd(const struct ovsrec_interface *iface_rec)
+{
+    if (strcmp(iface_rec->type, "geneve") &&
+        strcmp(iface_rec->type, "vxlan") &&
+        strcmp(iface_rec->type, "stt")) {
         return false;
     }
 
-    return true;
+    return !smap_get_bool(&iface_rec->bfd, "enable", false)
+           && smap_is_empty(&iface_rec->bfd_status)
+           && !ovsrec_interface_is_updated(iface_rec,
+                                           OVSREC_INTERFACE_COL_TYPE)
+           && !ovsrec_interface_is_updated(iface_rec,
+                                           OVSREC_INTERFACE_COL_BFD)
+           && !ovsrec_interface_is_updated(iface_rec,
+                                           OVSREC_INTERFACE_COL_BFD_STATUS);
 }
 
 static bool
@@ -2630,10 +2704,15 @@ binding_handle_ovs_interface_changes(struct binding_ctx_in *b_ctx_in,
     const struct ovsrec_interface *iface_rec;
     OVSREC_INTERFACE_TABLE_FOR_EACH_TRACKED (iface_rec,
                                              b_ctx_in->iface_table) {
+        if (is_iface_tunnel_without_bfd(iface_rec)) {
+            /* Tunnel changes are handled by the non_vif_data engine
+             * node. */
+            continue;
+        }
+
         if (!is_iface_vif(iface_rec)) {
             /* Right now we are not handling ovs_interface changes of
-             * other types. This can be enhanced to handle of
-             * types - patch and tunnel. */
+             * patch interfaces and tunnels with BFD. */
             handled = false;
             break;
         }
@@ -2897,7 +2976,13 @@ consider_patch_port_for_local_datapaths(const struct sbrec_port_binding *pb,
                 get_local_datapath(b_ctx_out->local_datapaths,
                                    peer->datapath->tunnel_key);
         }
-        if (peer_ld && need_add_peer_to_local(
+        if (peer_ld && b_ctx_out->lazy_peer_dps
+            && lazy_datapath_can_wait(b_ctx_in->lazy_dps,
+                                      b_ctx_in->sbrec_port_binding_by_datapath,
+                                      peer, pb->datapath)) {
+            hmapx_add(b_ctx_out->lazy_peer_dps,
+                      CONST_CAST(void *, pb->datapath));
+        } else if (peer_ld && need_add_peer_to_local(
                 b_ctx_in->sbrec_port_binding_by_name, peer,
                 b_ctx_in->chassis_rec)) {
             add_local_datapath(
@@ -2906,7 +2991,8 @@ consider_patch_port_for_local_datapaths(const struct sbrec_port_binding *pb,
                 b_ctx_in->sbrec_port_binding_by_name,
                 pb->datapath, b_ctx_in->chassis_rec,
                 b_ctx_out->local_datapaths,
-                b_ctx_out->tracked_dp_bindings);
+                b_ctx_out->tracked_dp_bindings,
+                b_ctx_in->lazy_dps, b_ctx_out->lazy_peer_dps);
         }
     } else {
         /* Add the peer datapath to the local datapaths if it's
@@ -2921,7 +3007,8 @@ consider_patch_port_for_local_datapaths(const struct sbrec_port_binding *pb,
                 b_ctx_in->sbrec_port_binding_by_datapath,
                 b_ctx_in->sbrec_port_binding_by_name,
                 ld, b_ctx_out->local_datapaths,
-                b_ctx_out->tracked_dp_bindings);
+                b_ctx_out->tracked_dp_bindings,
+                b_ctx_in->lazy_dps, b_ctx_out->lazy_peer_dps);
         }
     }
 }
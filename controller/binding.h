@@ -41,6 +41,7 @@ struct sset;
 struct sbrec_port_binding;
 struct ds;
 struct if_status_mgr;
+struct lazy_datapaths;
 
 struct binding_ctx_in {
     struct ovsdb_idl_txn *ovnsb_idl_txn;
@@ -59,6 +60,7 @@ struct binding_ctx_in {
     const struct ovsrec_open_vswitch_table *ovs_table;
     const struct ovsrec_interface_table *iface_table;
     struct shash *iface_table_external_ids_old;
+    const struct lazy_datapaths *lazy_dps;
 };
 
 /* Locally relevant port bindings, e.g., VIFs that might be bound locally,
@@ -105,6 +107,10 @@ struct binding_ctx_out {
      * the changed datapaths and port bindings. */
     struct hmap *tracked_dp_bindings;
 
+    /* hmapx of the peer switches that are only added to 'local_datapaths'
+     * once they are used, see struct lazy_datapaths. */
+    struct hmapx *lazy_peer_dps;
+
     struct if_status_mgr *if_mgr;
 
     struct sset *postponed_ports;
@@ -175,8 +181,8 @@ void local_binding_remove_ovn_installed(
 
 void local_binding_set_up(struct shash *local_bindings, const char *pb_name,
                           const struct sbrec_chassis *chassis_rec,
-                          const char *ts_now_str, bool sb_readonly,
-                          bool ovs_readonly);
+                          const char *ts_now_str, const char *timings,
+                          bool sb_readonly, bool ovs_readonly);
 void local_binding_set_down(struct shash *local_bindings, const char *pb_name,
                             const struct sbrec_chassis *chassis_rec,
                             bool sb_readonly, bool ovs_readonly);
@@ -260,6 +266,10 @@ struct sset *get_postponed_ports(void);
 /* Schedule any pending binding work. */
 void binding_wait(void);
 
+/* Resets the state of the port claims of the current engine run, see
+ * engine_set_time_budget(). */
+void binding_init_run(void);
+
 /* Clean up module state. */
 void binding_destroy(void);
 
@@ -15,8 +15,11 @@
 
 #include <config.h>
 #include "encaps.h"
+#include "bfd.h"
 #include "chassis.h"
+#include "local_data.h"
 
+#include "lib/chassis-index.h"
 #include "lib/hash.h"
 #include "lib/sset.h"
 #include "lib/util.h"
@@ -435,6 +438,112 @@ chassis_tzones_overlap(const struct sset *transport_zones,
     return false;
 }
 
+/* Returns true if tunnels should only be created to the chassis that are
+ * actually needed, see encaps_collect_peer_chassis(). */
+bool
+encaps_tunnels_on_demand(const struct ovsrec_open_vswitch_table *ovs_table,
+                         const struct sbrec_chassis *this_chassis)
+{
+    const struct ovsrec_open_vswitch *cfg =
+        ovsrec_open_vswitch_table_first(ovs_table);
+
+    return cfg && get_chassis_external_id_value_bool(
+                      &cfg->external_ids, this_chassis->name,
+                      "ovn-encap-on-demand", false);
+}
+
+static void
+peer_chassis_add(struct sset *peer_chassis,
+                 const struct sbrec_chassis *chassis_rec,
+                 const struct sbrec_chassis *this_chassis)
+{
+    if (chassis_rec && chassis_rec != this_chassis) {
+        sset_add(peer_chassis, chassis_rec->name);
+    }
+}
+
+/* Adds to 'peer_chassis' the names of the chassis this chassis may need to
+ * tunnel traffic to: the chassis that the ports of the local datapaths are
+ * bound to, the chassis of their HA chassis groups and the chassis this
+ * chassis runs BFD with. */
+void
+encaps_collect_peer_chassis(
+    const struct hmap *local_datapaths,
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath,
+    const struct sbrec_ha_chassis_group_table *ha_chassis_grp_table,
+    const struct sbrec_chassis *this_chassis,
+    struct sset *peer_chassis)
+{
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(sbrec_port_binding_by_datapath);
+
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, local_datapaths) {
+        sbrec_port_binding_index_set_datapath(target, ld->datapath);
+
+        const struct sbrec_port_binding *pb;
+        SBREC_PORT_BINDING_FOR_EACH_EQUAL (pb, target,
+                                           sbrec_port_binding_by_datapath) {
+            peer_chassis_add(peer_chassis, pb->chassis, this_chassis);
+            for (size_t i = 0; i < pb->n_additional_chassis; i++) {
+                peer_chassis_add(peer_chassis, pb->additional_chassis[i],
+                                 this_chassis);
+            }
+            if (pb->ha_chassis_group) {
+                const struct sbrec_ha_chassis_group *hcg =
+                    pb->ha_chassis_group;
+                for (size_t i = 0; i < hcg->n_ha_chassis; i++) {
+                    peer_chassis_add(peer_chassis,
+                                     hcg->ha_chassis[i]->chassis,
+                                     this_chassis);
+                }
+            }
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+
+    bfd_calculate_chassis(this_chassis, ha_chassis_grp_table, peer_chassis);
+    sset_find_and_delete(peer_chassis, this_chassis->name);
+}
+
+/* Creates the tunnels to 'chassis_rec' if it is an acceptable peer for this
+ * chassis. */
+static void
+chassis_tunnels_add(const struct sbrec_chassis *chassis_rec,
+                    const struct sbrec_sb_global *sbg,
+                    const struct ovsrec_open_vswitch_table *ovs_table,
+                    const struct sset *transport_zones,
+                    struct tunnel_ctx *tc,
+                    const struct sbrec_chassis *this_chassis)
+{
+    if (!strcmp(chassis_rec->name, this_chassis->name)) {
+        return;
+    }
+
+    /* Create tunnels to the other Chassis belonging to the
+     * same transport zone */
+    if (!chassis_tzones_overlap(transport_zones, chassis_rec)) {
+        VLOG_DBG("Skipping encap creation for Chassis '%s' because "
+                 "it belongs to different transport zones",
+                 chassis_rec->name);
+        return;
+    }
+
+    if (smap_get_bool(&chassis_rec->other_config, "is-remote", false)
+        && !smap_get_bool(&this_chassis->other_config, "is-interconn",
+                          false)) {
+        VLOG_DBG("Skipping encap creation for Chassis '%s' because "
+                 "it is remote but this chassis is not interconn.",
+                 chassis_rec->name);
+        return;
+    }
+
+    if (chassis_tunnel_add(chassis_rec, sbg, ovs_table, tc,
+                           this_chassis) == 0) {
+        VLOG_INFO("Creating encap for '%s' failed", chassis_rec->name);
+    }
+}
+
 static void
 clear_old_tunnels(const struct ovsrec_bridge *old_br_int, const char *prefix,
                   size_t prefix_len)
@@ -458,6 +567,8 @@ encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
            const struct sbrec_sb_global *sbg,
            const struct ovsrec_open_vswitch_table *ovs_table,
            const struct sset *transport_zones,
+           const struct sset *peer_chassis,
+           struct ovsdb_idl_index *sbrec_chassis_by_name,
            const struct ovsrec_bridge_table *bridge_table)
 {
     if (!ovs_idl_txn || !br_int) {
@@ -530,39 +641,34 @@ encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
         }
     }
 
-    SBREC_CHASSIS_TABLE_FOR_EACH (chassis_rec, chassis_table) {
-        if (strcmp(chassis_rec->name, this_chassis->name)) {
-            /* Create tunnels to the other Chassis belonging to the
-             * same transport zone */
-            if (!chassis_tzones_overlap(transport_zones, chassis_rec)) {
-                VLOG_DBG("Skipping encap creation for Chassis '%s' because "
-                         "it belongs to different transport zones",
-                         chassis_rec->name);
-                continue;
-            }
-
-            if (smap_get_bool(&chassis_rec->other_config, "is-remote", false)
-                && !smap_get_bool(&this_chassis->other_config, "is-interconn",
-                                  false)) {
-                VLOG_DBG("Skipping encap creation for Chassis '%s' because "
-                         "it is remote but this chassis is not interconn.",
-                         chassis_rec->name);
-                continue;
-            }
-
-            if (chassis_tunnel_add(chassis_rec, sbg, ovs_table, &tc,
-                                   this_chassis) == 0) {
-                VLOG_INFO("Creating encap for '%s' failed", chassis_rec->name);
-                continue;
+    if (peer_chassis) {
+        /* Only create tunnels to the chassis that are needed, looking them
+         * up instead of walking the whole Chassis table. */
+        const char *name;
+        SSET_FOR_EACH (name, peer_chassis) {
+            chassis_rec = chassis_lookup_by_name(sbrec_chassis_by_name, name);
+            if (chassis_rec) {
+                chassis_tunnels_add(chassis_rec, sbg, ovs_table,
+                                    transport_zones, &tc, this_chassis);
             }
         }
+    } else {
+        SBREC_CHASSIS_TABLE_FOR_EACH (chassis_rec, chassis_table) {
+            chassis_tunnels_add(chassis_rec, sbg, ovs_table, transport_zones,
+                                &tc, this_chassis);
+        }
     }
 
-    /* Delete any existing OVN tunnels that were not still around. */
+    /* Delete any existing OVN tunnels that were not still around.  Right
+     * after startup, the peers of this chassis might not be known yet, so
+     * keep the tunnels that aren't needed anymore for a while. */
+    bool keep_unused = peer_chassis && daemon_started_recently();
     struct shash_node *node;
     SHASH_FOR_EACH_SAFE (node, &tc.tunnel) {
         struct tunnel_node *tunnel = node->data;
-        ovsrec_bridge_update_ports_delvalue(tunnel->bridge, tunnel->port);
+        if (!keep_unused) {
+            ovsrec_bridge_update_ports_delvalue(tunnel->bridge, tunnel->port);
+        }
         shash_delete(&tc.tunnel, node);
         free(tunnel);
     }
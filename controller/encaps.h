@@ -18,12 +18,15 @@
 
 #include <stdbool.h>
 
+struct hmap;
 struct ovsdb_idl;
+struct ovsdb_idl_index;
 struct ovsdb_idl_txn;
 struct ovsrec_bridge;
 struct ovsrec_bridge_table;
 struct sbrec_chassis_table;
 struct sbrec_chassis;
+struct sbrec_ha_chassis_group_table;
 struct sbrec_sb_global;
 struct ovsrec_open_vswitch_table;
 struct sset;
@@ -36,8 +39,19 @@ void encaps_run(struct ovsdb_idl_txn *ovs_idl_txn,
                 const struct sbrec_sb_global *,
                 const struct ovsrec_open_vswitch_table *,
                 const struct sset *transport_zones,
+                const struct sset *peer_chassis,
+                struct ovsdb_idl_index *sbrec_chassis_by_name,
                 const struct ovsrec_bridge_table *bridge_table);
 
+bool encaps_tunnels_on_demand(const struct ovsrec_open_vswitch_table *,
+                              const struct sbrec_chassis *);
+void encaps_collect_peer_chassis(
+    const struct hmap *local_datapaths,
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath,
+    const struct sbrec_ha_chassis_group_table *,
+    const struct sbrec_chassis *this_chassis,
+    struct sset *peer_chassis);
+
 bool encaps_cleanup(struct ovsdb_idl_txn *ovs_idl_txn,
                     const struct ovsrec_bridge *br_int);
 
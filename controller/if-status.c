@@ -20,8 +20,11 @@
 #include "ofctrl-seqno.h"
 #include "ovsport.h"
 #include "simap.h"
+#include "sset.h"
 
 #include "lib/hmapx.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/list.h"
 #include "lib/util.h"
 #include "timeval.h"
 #include "openvswitch/vlog.h"
@@ -53,6 +56,12 @@ VLOG_DEFINE_THIS_MODULE(if_status);
  * C. At every iteration, based on ofctrl_seqno updates, handled in
  *    if_status_mgr_run():
  * - the flows for a previously claimed interface have been installed in OVS.
+ *
+ * All the interfaces that move to OIF_INSTALL_FLOWS in the same iteration
+ * form an install batch that shares a single ofctrl seqno request.  When
+ * ofctrl acks that seqno the whole batch moves on at once, so their bindings
+ * are marked "up" in the same SB and OVS transactions, and interfaces whose
+ * batch isn't acked yet are not looked at.
  */
 
 enum if_state {
@@ -93,6 +102,36 @@ static const char *if_state_names[] = {
     [OIF_UPDATE_PORT]      = "UPDATE_PORT",
 };
 
+/* Phases of the claim of an interface whose latency is measured, from the
+ * state transitions recorded when the interface reaches OIF_INSTALLED. */
+enum if_phase {
+    OIF_PHASE_CLAIM,    /* OIF_CLAIMED until pb->chassis is written to SB. */
+    OIF_PHASE_FLOWS,    /* OIF_INSTALL_FLOWS until the flows are acked. */
+    OIF_PHASE_MARK_UP,  /* Flows acked until the binding is "up" in SB and
+                         * OVS. */
+    OIF_PHASE_TOTAL,    /* OIF_CLAIMED until OIF_INSTALLED. */
+    OIF_PHASE_MAX,
+};
+
+static const char *if_phase_names[] = {
+    [OIF_PHASE_CLAIM]   = "claim",
+    [OIF_PHASE_FLOWS]   = "install-flows",
+    [OIF_PHASE_MARK_UP] = "mark-up",
+    [OIF_PHASE_TOTAL]   = "total",
+};
+
+/* Latency histogram.  Bucket 0 counts the interfaces that took less than 1ms
+ * and bucket 'i' the ones that took [2^(i - 1), 2^i) ms.  The last bucket
+ * also counts anything longer. */
+#define IF_LATENCY_N_BUCKETS 20
+
+struct if_latency {
+    uint64_t buckets[IF_LATENCY_N_BUCKETS];
+    uint64_t count;
+    uint64_t total_msec;
+    uint64_t max_msec;
+};
+
 /*
  *       +----------------------+
  * +---> |                      |
@@ -181,15 +220,25 @@ struct ovs_iface {
     struct uuid pb_uuid;    /* Port_binding uuid */
     struct uuid parent_pb_uuid; /* Parent port_binding uuid */
     enum if_state state;    /* State of the interface in the state machine. */
-    uint32_t install_seqno; /* Seqno at which this interface is expected to
-                             * be fully programmed in OVS.  Only used in state
-                             * OIF_INSTALL_FLOWS.
-                             */
+    struct if_install_batch *batch; /* Batch whose seqno acks the flows of
+                                     * this interface.  Only set in state
+                                     * OIF_INSTALL_FLOWS. */
+    long long int state_ts[OIF_MAX]; /* time_msec() at which the interface
+                                      * last entered each state since it was
+                                      * claimed, 0 if it didn't. */
     uint16_t mtu;           /* Extracted from OVS interface.mtu field. */
     enum can_bind bind_type;/* CAN_BIND_AS_MAIN or CAN_BIND_AS_ADDITIONAL */
     bool is_vif;            /* Vifs, container or virtual ports */
 };
 
+/* Interfaces claimed in the same iteration, which are expected to be fully
+ * programmed in OVS once ofctrl acks 'seqno'. */
+struct if_install_batch {
+    struct ovs_list list_node;  /* In 'if_status_mgr.install_batches'. */
+    uint32_t seqno;
+    struct hmapx ifaces;        /* Contains "struct ovs_iface *". */
+};
+
 static uint64_t ifaces_usage;
 
 /* State machine manager for all local OVS interfaces. */
@@ -210,6 +259,21 @@ struct if_status_mgr {
      * interfaces have been installed.
      */
     uint32_t iface_seqno;
+
+    /* Install batches waiting for their seqno to be acked, in the order they
+     * were requested. */
+    struct ovs_list install_batches;
+
+    /* Latency of the claims that reached OIF_INSTALLED, per phase. */
+    struct if_latency latency[OIF_PHASE_MAX];
+
+    /* If true, the phase latencies are also stored in the OVS interface
+     * external_ids when setting ovn-installed. */
+    bool record_timings;
+
+    /* Maximum number of interfaces whose ovn-installed is set or removed in
+     * a single OVS transaction, 0 if unlimited. */
+    unsigned int max_ovs_writes;
 };
 
 static struct ovs_iface *
@@ -222,6 +286,9 @@ static void ovs_iface_destroy(struct if_status_mgr *, struct ovs_iface *);
 static void ovn_uninstall_hash_destroy(struct if_status_mgr *mgr, char *name);
 static void ovs_iface_set_state(struct if_status_mgr *, struct ovs_iface *,
                                 enum if_state);
+static struct if_install_batch *if_install_batch_create(
+    struct if_status_mgr *, uint32_t seqno);
+static void if_install_batch_destroy(struct if_install_batch *);
 
 static void if_status_mgr_update_bindings(
     struct if_status_mgr *mgr, struct local_binding_data *binding_data,
@@ -242,6 +309,8 @@ if_status_mgr_create(void)
     }
     shash_init(&mgr->ifaces);
     shash_init(&mgr->ovn_uninstall_hash);
+    ovs_list_init(&mgr->install_batches);
+    mgr->max_ovs_writes = IF_STATUS_DEFAULT_MAX_OVS_WRITES;
     return mgr;
 }
 
@@ -263,6 +332,11 @@ if_status_mgr_clear(struct if_status_mgr *mgr)
     for (size_t i = 0; i < ARRAY_SIZE(mgr->ifaces_per_state); i++) {
         ovs_assert(hmapx_is_empty(&mgr->ifaces_per_state[i]));
     }
+
+    struct if_install_batch *batch;
+    LIST_FOR_EACH_SAFE (batch, list_node, &mgr->install_batches) {
+        if_install_batch_destroy(batch);
+    }
 }
 
 void
@@ -576,9 +650,10 @@ if_status_mgr_update(struct if_status_mgr *mgr,
         }
     }
 
-    /* Move newly claimed interfaces from OIF_CLAIMED to OIF_INSTALL_FLOWS.
+    /* Move newly claimed interfaces from OIF_CLAIMED to OIF_INSTALL_FLOWS,
+     * all of them in the same install batch.
      */
-    bool new_ifaces = false;
+    struct if_install_batch *batch = NULL;
     if (!sb_readonly) {
         HMAPX_FOR_EACH_SAFE (node, &mgr->ifaces_per_state[OIF_CLAIMED]) {
             struct ovs_iface *iface = node->data;
@@ -586,9 +661,13 @@ if_status_mgr_update(struct if_status_mgr *mgr,
              * in if_status_handle_claims or if_status_mgr_claim_iface
              */
             if (iface->is_vif) {
+                if (!batch) {
+                    batch = if_install_batch_create(mgr,
+                                                    mgr->iface_seqno + 1);
+                }
                 ovs_iface_set_state(mgr, iface, OIF_INSTALL_FLOWS);
-                iface->install_seqno = mgr->iface_seqno + 1;
-                new_ifaces = true;
+                iface->batch = batch;
+                hmapx_add(&batch->ifaces, iface);
             } else {
                 ovs_iface_set_state(mgr, iface, OIF_MARK_UP);
             }
@@ -623,11 +702,12 @@ if_status_mgr_update(struct if_status_mgr *mgr,
      * Request a seqno update when the flows for new interfaces have been
      * installed in OVS.
      */
-    if (new_ifaces) {
+    if (batch) {
         mgr->iface_seqno++;
         ofctrl_seqno_update_create(mgr->iface_seq_type_pb_cfg,
                                    mgr->iface_seqno);
-        VLOG_DBG("Seqno requested: %"PRIu32, mgr->iface_seqno);
+        VLOG_DBG("Seqno requested: %"PRIu32" for %"PRIuSIZE" interfaces",
+                 mgr->iface_seqno, hmapx_count(&batch->ifaces));
     }
 }
 
@@ -653,32 +733,42 @@ if_status_mgr_run(struct if_status_mgr *mgr,
 {
     struct ofctrl_acked_seqnos *acked_seqnos =
             ofctrl_acked_seqnos_get(mgr->iface_seq_type_pb_cfg);
+    struct if_install_batch *batch;
     struct hmapx_node *node;
 
-    /* Move interfaces from state OIF_INSTALL_FLOWS to OIF_MARK_UP if a
-     * notification has been received aabout their flows being installed
-     * in OVS.
+    /* Move the interfaces of every install batch for which a notification
+     * has been received about their flows being installed in OVS from state
+     * OIF_INSTALL_FLOWS to OIF_MARK_UP.
+     *
+     * The batches are in the order of their seqnos, which are acked in the
+     * same order, so only the ones at the front of the list are walked.  An
+     * ack also covers the previous seqnos that were flushed along with the
+     * OpenFlow connection, as all the flows are installed again after it
+     * reconnects.
      */
-    HMAPX_FOR_EACH_SAFE (node, &mgr->ifaces_per_state[OIF_INSTALL_FLOWS]) {
-        struct ovs_iface *iface = node->data;
-
-        if (!ofctrl_acked_seqnos_contains(acked_seqnos,
-                                          iface->install_seqno)) {
-            continue;
+    LIST_FOR_EACH_SAFE (batch, list_node, &mgr->install_batches) {
+        if (batch->seqno > acked_seqnos->last_acked) {
+            break;
         }
-        /* Wait for ovn-installed to be absent before moving to MARK_UP state.
-         * Most of the times ovn-installed is already absent and hence we will
-         * not have to wait.
-         * If there is no binding_data, we can't determine if ovn-installed is
-         * present or not; hence also go to the OIF_REM_OLD_OVN_INST state.
-         */
-        if (!binding_data ||
-            local_binding_is_ovn_installed(&binding_data->bindings,
-                                           iface->id)) {
-            ovs_iface_set_state(mgr, iface, OIF_REM_OLD_OVN_INST);
-        } else {
-            ovs_iface_set_state(mgr, iface, OIF_MARK_UP);
+        HMAPX_FOR_EACH_SAFE (node, &batch->ifaces) {
+            struct ovs_iface *iface = node->data;
+
+            /* Wait for ovn-installed to be absent before moving to MARK_UP
+             * state.  Most of the times ovn-installed is already absent and
+             * hence we will not have to wait.
+             * If there is no binding_data, we can't determine if
+             * ovn-installed is present or not; hence also go to the
+             * OIF_REM_OLD_OVN_INST state.
+             */
+            if (!binding_data ||
+                local_binding_is_ovn_installed(&binding_data->bindings,
+                                               iface->id)) {
+                ovs_iface_set_state(mgr, iface, OIF_REM_OLD_OVN_INST);
+            } else {
+                ovs_iface_set_state(mgr, iface, OIF_MARK_UP);
+            }
         }
+        if_install_batch_destroy(batch);
     }
     ofctrl_acked_seqnos_destroy(acked_seqnos);
 
@@ -778,6 +868,9 @@ ovs_iface_destroy(struct if_status_mgr *mgr, struct ovs_iface *iface)
     VLOG_DBG("Interface %s destroy: state %s", iface->id,
              if_state_names[iface->state]);
     hmapx_find_and_delete(&mgr->ifaces_per_state[iface->state], iface);
+    if (iface->batch) {
+        hmapx_find_and_delete(&iface->batch->ifaces, iface);
+    }
     struct shash_node *node = shash_find(&mgr->ifaces, iface->id);
     if (node) {
         shash_steal(&mgr->ifaces, node);
@@ -805,6 +898,85 @@ ovn_uninstall_hash_destroy(struct if_status_mgr *mgr, char *name)
     }
 }
 
+/* Returns the time at which the flows of 'iface' were acked, 0 if they
+ * weren't yet. */
+static long long int
+ovs_iface_flows_done_ts(const struct ovs_iface *iface)
+{
+    if (!iface->state_ts[OIF_INSTALL_FLOWS]) {
+        return 0;
+    }
+    return iface->state_ts[OIF_REM_OLD_OVN_INST]
+           ? iface->state_ts[OIF_REM_OLD_OVN_INST]
+           : iface->state_ts[OIF_MARK_UP];
+}
+
+/* Stores in 'phases' the duration, in milliseconds, of each phase of the
+ * claim of 'iface', or -1 for the phases it didn't complete (e.g., non-VIF
+ * ports don't wait for their flows). */
+static void
+ovs_iface_get_phases(const struct ovs_iface *iface,
+                     long long int phases[OIF_PHASE_MAX])
+{
+    const long long int *ts = iface->state_ts;
+    long long int flows_done = ovs_iface_flows_done_ts(iface);
+
+    for (size_t i = 0; i < OIF_PHASE_MAX; i++) {
+        phases[i] = -1;
+    }
+    if (!ts[OIF_CLAIMED]) {
+        return;
+    }
+    if (ts[OIF_INSTALL_FLOWS]) {
+        phases[OIF_PHASE_CLAIM] = ts[OIF_INSTALL_FLOWS] - ts[OIF_CLAIMED];
+    }
+    if (flows_done) {
+        phases[OIF_PHASE_FLOWS] = flows_done - ts[OIF_INSTALL_FLOWS];
+    }
+    if (ts[OIF_INSTALLED]) {
+        long long int mark_up = flows_done ? flows_done : ts[OIF_MARK_UP];
+        if (mark_up) {
+            phases[OIF_PHASE_MARK_UP] = ts[OIF_INSTALLED] - mark_up;
+        }
+        phases[OIF_PHASE_TOTAL] = ts[OIF_INSTALLED] - ts[OIF_CLAIMED];
+    }
+}
+
+static void
+if_latency_add(struct if_latency *latency, long long int msec)
+{
+    uint64_t value = MAX(msec, 0);
+    size_t bucket = value ? MIN(log_2_floor(value) + 1,
+                                IF_LATENCY_N_BUCKETS - 1)
+                          : 0;
+
+    latency->buckets[bucket]++;
+    latency->count++;
+    latency->total_msec += value;
+    latency->max_msec = MAX(latency->max_msec, value);
+}
+
+/* Returns an upper bound, in milliseconds, of the latency under which
+ * 'pct' percent of the interfaces in 'latency' completed. */
+static uint64_t
+if_latency_percentile(const struct if_latency *latency, unsigned int pct)
+{
+    uint64_t target = DIV_ROUND_UP(latency->count * pct, 100);
+    uint64_t sum = 0;
+
+    if (!latency->count) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < IF_LATENCY_N_BUCKETS; i++) {
+        sum += latency->buckets[i];
+        if (sum >= target) {
+            return MIN(UINT64_C(1) << i, latency->max_msec);
+        }
+    }
+    return latency->max_msec;
+}
+
 static void
 ovs_iface_set_state(struct if_status_mgr *mgr, struct ovs_iface *iface,
                     enum if_state state)
@@ -816,9 +988,94 @@ ovs_iface_set_state(struct if_status_mgr *mgr, struct ovs_iface *iface,
     hmapx_find_and_delete(&mgr->ifaces_per_state[iface->state], iface);
     iface->state = state;
     hmapx_add(&mgr->ifaces_per_state[iface->state], iface);
-    iface->install_seqno = 0;
+
+    if (state == OIF_CLAIMED) {
+        memset(iface->state_ts, 0, sizeof iface->state_ts);
+    }
+    iface->state_ts[state] = time_msec();
+    if (state == OIF_INSTALLED) {
+        long long int phases[OIF_PHASE_MAX];
+
+        ovs_iface_get_phases(iface, phases);
+        for (size_t i = 0; i < OIF_PHASE_MAX; i++) {
+            if (phases[i] >= 0) {
+                if_latency_add(&mgr->latency[i], phases[i]);
+            }
+        }
+    }
+
+    if (iface->batch) {
+        hmapx_find_and_delete(&iface->batch->ifaces, iface);
+        iface->batch = NULL;
+    }
+}
+
+static struct if_install_batch *
+if_install_batch_create(struct if_status_mgr *mgr, uint32_t seqno)
+{
+    struct if_install_batch *batch = xmalloc(sizeof *batch);
+
+    batch->seqno = seqno;
+    hmapx_init(&batch->ifaces);
+    ovs_list_push_back(&mgr->install_batches, &batch->list_node);
+    return batch;
+}
+
+/* Destroys 'batch'.  The interfaces still in it, if any, are detached from
+ * it but keep their state. */
+static void
+if_install_batch_destroy(struct if_install_batch *batch)
+{
+    struct hmapx_node *node;
+
+    HMAPX_FOR_EACH (node, &batch->ifaces) {
+        struct ovs_iface *iface = node->data;
+        iface->batch = NULL;
+    }
+    hmapx_destroy(&batch->ifaces);
+    ovs_list_remove(&batch->list_node);
+    free(batch);
+}
+
+/* Returns the durations of the phases completed by 'iface' so far, in the
+ * "claim=<ms>,install-flows=<ms>" format stored in the OVS interface
+ * external_ids.  The caller must free the returned string. */
+static char *
+ovs_iface_format_timings(const struct ovs_iface *iface)
+{
+    struct ds timings = DS_EMPTY_INITIALIZER;
+    long long int phases[OIF_PHASE_MAX];
+
+    ovs_iface_get_phases(iface, phases);
+    for (size_t i = 0; i < OIF_PHASE_MAX; i++) {
+        if (phases[i] >= 0) {
+            ds_put_format(&timings, "%s%s=%lld", timings.length ? "," : "",
+                          if_phase_names[i], phases[i]);
+        }
+    }
+    return ds_steal_cstr(&timings);
+}
+
+/* Returns true, and counts it in '*n_writes', if the ovn-installed of one
+ * more interface can be written in the current OVS transaction. */
+static bool
+if_status_mgr_ovs_write_allowed(const struct if_status_mgr *mgr,
+                                size_t *n_writes)
+{
+    if (mgr->max_ovs_writes && *n_writes >= mgr->max_ovs_writes) {
+        return false;
+    }
+    (*n_writes)++;
+    return true;
 }
 
+/* The changes of ovn-installed are written to the OVS transaction of the
+ * current iteration, which ovn-controller commits along with its other OVS
+ * updates.  Under churn, e.g. when thousands of interfaces are claimed at
+ * once, at most 'max_ovs_writes' interfaces are updated per transaction, so
+ * that large batches are spread over several bounded transactions and don't
+ * delay the other updates of the OVS database.  The interfaces left over
+ * stay in their state and are updated once the transaction completes. */
 static void
 if_status_mgr_update_bindings(struct if_status_mgr *mgr,
                               struct local_binding_data *binding_data,
@@ -833,6 +1090,7 @@ if_status_mgr_update_bindings(struct if_status_mgr *mgr,
 
     struct shash *bindings = &binding_data->bindings;
     struct hmapx_node *node;
+    size_t n_ovs_writes = 0;
 
     /* Notify the binding module to set "down" all bindings that are still
      * in the process of being installed in OVS, i.e., are not yet installed.
@@ -850,6 +1108,11 @@ if_status_mgr_update_bindings(struct if_status_mgr *mgr,
     HMAPX_FOR_EACH (node, &mgr->ifaces_per_state[OIF_REM_OLD_OVN_INST]) {
         struct ovs_iface *iface = node->data;
 
+        if (!ovs_readonly
+            && local_binding_is_ovn_installed(bindings, iface->id)
+            && !if_status_mgr_ovs_write_allowed(mgr, &n_ovs_writes)) {
+            continue;
+        }
         local_binding_remove_ovn_installed(bindings, iface_table, iface->id,
                                            ovs_readonly);
     }
@@ -862,8 +1125,20 @@ if_status_mgr_update_bindings(struct if_status_mgr *mgr,
     HMAPX_FOR_EACH (node, &mgr->ifaces_per_state[OIF_MARK_UP]) {
         struct ovs_iface *iface = node->data;
         if (iface->is_vif) {
+            /* The port is only set "up" in the Southbound along with, or
+             * after, ovn-installed. */
+            if (!ovs_readonly
+                && !local_binding_is_ovn_installed(bindings, iface->id)
+                && !if_status_mgr_ovs_write_allowed(mgr, &n_ovs_writes)) {
+                continue;
+            }
+            char *timings = NULL;
+            if (mgr->record_timings) {
+                timings = ovs_iface_format_timings(iface);
+            }
             local_binding_set_up(bindings, iface->id, chassis_rec, ts_now_str,
-                                 sb_readonly, ovs_readonly);
+                                 timings, sb_readonly, ovs_readonly);
+            free(timings);
         } else if (!sb_readonly) {
             const struct sbrec_port_binding *pb =
                 sbrec_port_binding_table_get_for_uuid(pb_table,
@@ -899,6 +1174,12 @@ if_status_mgr_get_memory_usage(struct if_status_mgr *mgr,
                               hmapx_count(&mgr->ifaces_per_state[i]);
     }
 
+    const struct if_install_batch *batch;
+    LIST_FOR_EACH (batch, list_node, &mgr->install_batches) {
+        ifaces_state_usage += sizeof *batch + sizeof(struct hmapx_node) *
+                              hmapx_count(&batch->ifaces);
+    }
+
     simap_increase(usage, "if_status_mgr_ifaces_usage-KB",
                    ROUND_UP(ifaces_usage, 1024) / 1024);
     simap_increase(usage, "if_status_mgr_ifaces_state_usage-KB",
@@ -917,3 +1198,116 @@ if_status_is_port_claimed(const struct if_status_mgr *mgr,
     }
 }
 
+
+void
+if_status_mgr_set_record_timings(struct if_status_mgr *mgr, bool enabled)
+{
+    mgr->record_timings = enabled;
+}
+
+/* Sets the maximum number of interfaces whose ovn-installed is set or
+ * removed in a single OVS transaction, 0 for no limit. */
+void
+if_status_mgr_set_max_ovs_writes(struct if_status_mgr *mgr,
+                                 unsigned int max_ovs_writes)
+{
+    mgr->max_ovs_writes = max_ovs_writes;
+}
+
+/* Returns true if 'iface_id' is claimed but its flows are not known to be
+ * installed in OVS yet. */
+bool
+if_status_mgr_iface_is_installing(const struct if_status_mgr *mgr,
+                                  const char *iface_id)
+{
+    const struct ovs_iface *iface = shash_find_data(&mgr->ifaces, iface_id);
+    return iface && iface->is_vif && (iface->state == OIF_CLAIMED
+                                      || iface->state == OIF_INSTALL_FLOWS);
+}
+
+/* Adds to 'iface_ids' the interfaces for which
+ * if_status_mgr_iface_is_installing() is true. */
+void
+if_status_mgr_get_installing_ifaces(const struct if_status_mgr *mgr,
+                                    struct sset *iface_ids)
+{
+    static const enum if_state states[] = {
+        OIF_CLAIMED, OIF_INSTALL_FLOWS,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(states); i++) {
+        struct hmapx_node *node;
+        HMAPX_FOR_EACH (node, &mgr->ifaces_per_state[states[i]]) {
+            const struct ovs_iface *iface = node->data;
+            if (iface->is_vif) {
+                sset_add(iface_ids, iface->id);
+            }
+        }
+    }
+}
+
+/* Returns the ofctrl seqno type used to track the installation of the flows
+ * of newly claimed interfaces. */
+size_t
+if_status_mgr_get_seqno_type(const struct if_status_mgr *mgr)
+{
+    return mgr->iface_seq_type_pb_cfg;
+}
+
+/* Formats into 'ds' the claim latency histograms of 'mgr' and the state
+ * transition times of the interfaces it currently tracks, relative to their
+ * claim. */
+void
+if_status_mgr_format_stats(const struct if_status_mgr *mgr, struct ds *ds)
+{
+    ds_put_cstr(ds, "Claim latency:\n");
+    for (size_t i = 0; i < OIF_PHASE_MAX; i++) {
+        const struct if_latency *latency = &mgr->latency[i];
+
+        ds_put_format(ds, "- %s: %"PRIu64" ports, p50 %"PRIu64"ms, "
+                      "p99 %"PRIu64"ms, max %"PRIu64"ms\n",
+                      if_phase_names[i], latency->count,
+                      if_latency_percentile(latency, 50),
+                      if_latency_percentile(latency, 99),
+                      latency->max_msec);
+        for (size_t j = 0; j < IF_LATENCY_N_BUCKETS; j++) {
+            if (!latency->buckets[j]) {
+                continue;
+            }
+            if (!j) {
+                ds_put_cstr(ds, "    < 1ms");
+            } else if (j == IF_LATENCY_N_BUCKETS - 1) {
+                ds_put_format(ds, "    >= %"PRIu64"ms",
+                              UINT64_C(1) << (j - 1));
+            } else {
+                ds_put_format(ds, "    [%"PRIu64", %"PRIu64")ms",
+                              UINT64_C(1) << (j - 1), UINT64_C(1) << j);
+            }
+            ds_put_format(ds, ": %"PRIu64"\n", latency->buckets[j]);
+        }
+    }
+
+    ds_put_cstr(ds, "Interfaces:\n");
+    const struct shash_node **nodes = shash_sort(&mgr->ifaces);
+    for (size_t i = 0; i < shash_count(&mgr->ifaces); i++) {
+        const struct ovs_iface *iface = nodes[i]->data;
+        long long int claim_ts = iface->state_ts[OIF_CLAIMED];
+
+        ds_put_format(ds, "- %s (%s): %s", iface->id,
+                      iface->name ? iface->name : "",
+                      if_state_names[iface->state]);
+        for (size_t j = 0; claim_ts && j < OIF_MAX; j++) {
+            if (iface->state_ts[j]) {
+                ds_put_format(ds, ", %s +%lldms", if_state_names[j],
+                              iface->state_ts[j] - claim_ts);
+            }
+        }
+        ds_put_char(ds, '\n');
+    }
+    free(nodes);
+}
+
+void
+if_status_mgr_clear_stats(struct if_status_mgr *mgr)
+{
+    memset(mgr->latency, 0, sizeof mgr->latency);
+}
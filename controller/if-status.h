@@ -22,8 +22,14 @@
 #include "binding.h"
 #include "lport.h"
 
+struct ds;
 struct if_status_mgr;
 struct simap;
+struct sset;
+
+/* Default maximum number of interfaces whose ovn-installed is updated in a
+ * single OVS transaction, see external_ids:ovn-ovs-txn-max-ifaces. */
+#define IF_STATUS_DEFAULT_MAX_OVS_WRITES 1000
 
 struct if_status_mgr *if_status_mgr_create(void);
 void if_status_mgr_clear(struct if_status_mgr *);
@@ -69,5 +75,15 @@ bool if_status_mgr_iface_update(const struct if_status_mgr *mgr,
                                 const struct ovsrec_interface *iface_rec);
 bool if_status_is_port_claimed(const struct if_status_mgr *mgr,
                                const char *iface_id);
+void if_status_mgr_set_record_timings(struct if_status_mgr *, bool enabled);
+void if_status_mgr_set_max_ovs_writes(struct if_status_mgr *,
+                                      unsigned int max_ovs_writes);
+bool if_status_mgr_iface_is_installing(const struct if_status_mgr *,
+                                       const char *iface_id);
+void if_status_mgr_get_installing_ifaces(const struct if_status_mgr *,
+                                         struct sset *iface_ids);
+size_t if_status_mgr_get_seqno_type(const struct if_status_mgr *);
+void if_status_mgr_format_stats(const struct if_status_mgr *, struct ds *);
+void if_status_mgr_clear_stats(struct if_status_mgr *);
 
 # endif /* controller/if-status.h */
@@ -17,8 +17,10 @@
 #include <config.h>
 
 /* OpenvSwitch lib includes. */
+#include "hash.h"
 #include "openvswitch/vlog.h"
 #include "lib/smap.h"
+#include "packets.h"
 
 /* OVN includes */
 #include "lb.h"
@@ -27,6 +29,12 @@
 
 VLOG_DEFINE_THIS_MODULE(controller_lb);
 
+static uint32_t
+ovn_controller_lb_vip_hash(const struct in6_addr *vip, uint16_t vip_port)
+{
+    return hash_add(hash_bytes(vip, sizeof *vip, 0), vip_port);
+}
+
 static void
 ovn_lb_get_hairpin_snat_ip(const struct uuid *lb_uuid,
                            const struct smap *lb_options,
@@ -48,7 +56,8 @@ ovn_lb_get_hairpin_snat_ip(const struct uuid *lb_uuid,
 struct ovn_controller_lb *
 ovn_controller_lb_create(const struct sbrec_load_balancer *sbrec_lb,
                          const struct smap *template_vars,
-                         struct sset *template_vars_ref)
+                         struct sset *template_vars_ref,
+                         struct ovn_lb_vip_cache *vip_cache)
 {
     struct ovn_controller_lb *lb = xzalloc(sizeof *lb);
     bool template = smap_get_bool(&sbrec_lb->options, "template", false);
@@ -73,9 +82,10 @@ ovn_controller_lb_create(const struct sbrec_load_balancer *sbrec_lb,
                                                              template_vars,
                                                              template_vars_ref)
                                : lex_str_use(node->value);
-        char *error = ovn_lb_vip_init_explicit(lb_vip,
-                                               lex_str_get(&key_s),
-                                               lex_str_get(&value_s));
+        char *error = ovn_lb_vip_init_cached(vip_cache, lb_vip,
+                                             lex_str_get(&key_s),
+                                             lex_str_get(&value_s),
+                                             false, AF_UNSPEC);
         if (error) {
             free(error);
         } else {
@@ -99,10 +109,23 @@ ovn_controller_lb_create(const struct sbrec_load_balancer *sbrec_lb,
      */
     lb->n_vips = n_vips;
 
+    lb->vip_nodes = xcalloc(lb->n_vips, sizeof *lb->vip_nodes);
+    hmap_init(&lb->vip_index);
+    for (size_t i = 0; i < lb->n_vips; i++) {
+        struct ovn_controller_lb_vip *vip_node = &lb->vip_nodes[i];
+
+        vip_node->vip = &lb->vips[i];
+        hmap_insert(&lb->vip_index, &vip_node->hmap_node,
+                    ovn_controller_lb_vip_hash(&lb->vips[i].vip,
+                                               lb->vips[i].vip_port));
+    }
+
     lb->hairpin_orig_tuple = smap_get_bool(&sbrec_lb->options,
                                            "hairpin_orig_tuple",
                                            false);
     lb->ct_flush = smap_get_bool(&sbrec_lb->options, "ct_flush", false);
+    lb->hairpin_conjunctive = smap_get_bool(&sbrec_lb->options,
+                                            "hairpin_conjunctive", false);
     ovn_lb_get_hairpin_snat_ip(&sbrec_lb->header_.uuid, &sbrec_lb->options,
                                &lb->hairpin_snat_ips);
     return lb;
@@ -115,6 +138,8 @@ ovn_controller_lb_destroy(struct ovn_controller_lb *lb)
         ovn_lb_vip_destroy(&lb->vips[i]);
     }
     free(lb->vips);
+    hmap_destroy(&lb->vip_index);
+    free(lb->vip_nodes);
     destroy_lport_addresses(&lb->hairpin_snat_ips);
     free(lb);
 }
@@ -144,3 +169,39 @@ ovn_controller_lb_find(const struct hmap *ovn_controller_lbs,
     return NULL;
 }
 
+
+/* Returns the VIP of 'lb' with address 'vip' and port 'vip_port', or NULL if
+ * there's none. */
+const struct ovn_lb_vip *
+ovn_controller_lb_find_vip(const struct ovn_controller_lb *lb,
+                           const struct in6_addr *vip, uint16_t vip_port)
+{
+    const struct ovn_controller_lb_vip *vip_node;
+    HMAP_FOR_EACH_WITH_HASH (vip_node, hmap_node,
+                             ovn_controller_lb_vip_hash(vip, vip_port),
+                             &lb->vip_index) {
+        if (vip_node->vip->vip_port == vip_port
+            && ipv6_addr_equals(&vip_node->vip->vip, vip)) {
+            return vip_node->vip;
+        }
+    }
+    return NULL;
+}
+
+/* Returns true if VIPs 'a' and 'b' have the same backends, in the same
+ * order. */
+bool
+ovn_controller_lb_vip_backends_equal(const struct ovn_lb_vip *a,
+                                     const struct ovn_lb_vip *b)
+{
+    if (a->n_backends != b->n_backends) {
+        return false;
+    }
+    for (size_t i = 0; i < a->n_backends; i++) {
+        if (a->backends[i].port != b->backends[i].port
+            || !ipv6_addr_equals(&a->backends[i].ip, &b->backends[i].ip)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -21,6 +21,12 @@
 
 struct sbrec_load_balancer;
 
+/* A VIP of an 'ovn_controller_lb', in its 'vip_index'. */
+struct ovn_controller_lb_vip {
+    struct hmap_node hmap_node;
+    const struct ovn_lb_vip *vip;
+};
+
 struct ovn_controller_lb {
     struct hmap_node hmap_node;
 
@@ -30,10 +36,14 @@ struct ovn_controller_lb {
 
     struct ovn_lb_vip *vips;
     size_t n_vips;
+    struct ovn_controller_lb_vip *vip_nodes; /* One per VIP in 'vips'. */
+    struct hmap vip_index;  /* 'vip_nodes' by VIP address and port. */
     bool hairpin_orig_tuple; /* True if ovn-northd stores the original
                               * destination tuple in registers.
                               */
     bool ct_flush; /* True if we should flush CT after backend removal. */
+    bool hairpin_conjunctive; /* True if the hairpin sessions are detected
+                               * with conjunctive matches. */
 
     struct lport_addresses hairpin_snat_ips; /* IP (v4 and/or v6) to be used
                                               * as source for hairpinned
@@ -44,12 +54,18 @@ struct ovn_controller_lb {
 struct ovn_controller_lb *ovn_controller_lb_create(
     const struct sbrec_load_balancer *,
     const struct smap *template_vars,
-    struct sset *template_vars_ref);
+    struct sset *template_vars_ref,
+    struct ovn_lb_vip_cache *);
 void ovn_controller_lb_destroy(struct ovn_controller_lb *);
 void ovn_controller_lbs_destroy(struct hmap *ovn_controller_lbs);
 struct ovn_controller_lb *ovn_controller_lb_find(
     const struct hmap *ovn_controller_lbs,
     const struct uuid *uuid);
+const struct ovn_lb_vip *ovn_controller_lb_find_vip(
+    const struct ovn_controller_lb *,
+    const struct in6_addr *vip, uint16_t vip_port);
+bool ovn_controller_lb_vip_backends_equal(const struct ovn_lb_vip *,
+                                          const struct ovn_lb_vip *);
 
 #endif /* OVN_CONTROLLER_LB_H */
 
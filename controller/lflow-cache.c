@@ -17,14 +17,26 @@
 
 #include <config.h>
 
+#include <errno.h>
+#include <fcntl.h>
 #if HAVE_DECL_MALLOC_TRIM
 #include <malloc.h>
 #endif
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "coverage.h"
+#include "hash.h"
+#include "heap.h"
 #include "lflow-cache.h"
+#include "lib/crc32c.h"
+#include "lib/slab.h"
 #include "lib/uuid.h"
 #include "memory-trim.h"
+#include "nx-match.h"
+#include "openvswitch/ofpbuf.h"
 #include "openvswitch/vlog.h"
 #include "ovn/expr.h"
 
@@ -37,12 +49,16 @@ COVERAGE_DEFINE(lflow_cache_free_expr);
 COVERAGE_DEFINE(lflow_cache_free_matches);
 COVERAGE_DEFINE(lflow_cache_add);
 COVERAGE_DEFINE(lflow_cache_hit);
+COVERAGE_DEFINE(lflow_cache_hit_shared);
 COVERAGE_DEFINE(lflow_cache_miss);
 COVERAGE_DEFINE(lflow_cache_delete);
+COVERAGE_DEFINE(lflow_cache_delete_stale);
 COVERAGE_DEFINE(lflow_cache_full);
 COVERAGE_DEFINE(lflow_cache_mem_full);
 COVERAGE_DEFINE(lflow_cache_made_room);
 COVERAGE_DEFINE(lflow_cache_trim);
+COVERAGE_DEFINE(lflow_cache_restore);
+COVERAGE_DEFINE(lflow_cache_restore_stale);
 
 static const char *lflow_cache_type_names[LCACHE_T_MAX] = {
     [LCACHE_T_EXPR]    = "cache-expr",
@@ -53,6 +69,7 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
 
 struct lflow_cache {
     struct hmap entries[LCACHE_T_MAX];
+    struct hmap shared[LCACHE_T_MAX];   /* "struct lflow_cache_shared"s. */
     struct memory_trimmer *mt;
     uint32_t n_entries;
     uint32_t high_watermark;
@@ -63,21 +80,118 @@ struct lflow_cache {
     uint32_t trim_wmark_perc;
     uint64_t trim_count;
     bool enabled;
+
+    /* Eviction, see lflow_cache_make_room__(). */
+    struct heap heaps[LCACHE_T_MAX]; /* "struct lflow_cache_entry"s. */
+    uint64_t inflation;         /* Priority of the last evicted entry. */
+
+    uint64_t n_hits;
+    uint64_t n_misses;
+    uint64_t n_evictions;
+
+    /* Entries saved by a previous run, see lflow_cache_load(). */
+    struct hmap saved;          /* Contains "struct lflow_cache_saved". */
+    void *saved_map;            /* Memory mapped file, if any. */
+    size_t saved_map_size;
 };
 
 struct lflow_cache_entry {
     struct hmap_node node;
     struct uuid lflow_uuid; /* key */
-    size_t size;
+    uint32_t lflow_hash;
+    struct heap_node heap_node; /* In 'heaps[value->type]'. */
+
+    struct lflow_cache_value *value;
+};
+
+static struct ovn_slab lflow_cache_entry_slab =
+    OVN_SLAB_INITIALIZER(lflow_cache_entry_slab, "lflow_cache_entry",
+                         sizeof(struct lflow_cache_entry));
+
+/* A cached value, referenced by the entries of one or more logical flows.
+ *
+ * Values added with a nonnull key are shared by all the logical flows whose
+ * translation has the same key, see lflow_cache_add_shared(). */
+struct lflow_cache_shared {
+    struct hmap_node node;  /* In 'shared[value.type]', only if 'key'. */
+    char *key;
+    size_t size;            /* Accounted for in 'mem_usage'. */
+    uint64_t benefit;       /* Cost of computing the value, per KB. */
 
     struct lflow_cache_value value;
 };
 
+/* Format of the file written by lflow_cache_save().
+ *
+ * The file starts with a header, followed by 'n_entries' entries.  Each
+ * entry is followed by its 'n_matches' matches, each of them made of a
+ * struct lflow_cache_file_match, the match in NXM format padded to a
+ * multiple of 8 bytes and its conjunctions.  Integers are in host byte
+ * order, the file is only meant to be read back on the same system. */
+#define LFLOW_CACHE_FILE_MAGIC 0x4f4c4643 /* "OLFC" */
+
+/* Must be increased whenever the format of the file or the translation of
+ * logical flow matches to OpenFlow changes in a way that isn't reflected in
+ * the symbol table fingerprint. */
+#define LFLOW_CACHE_FILE_VERSION 1
+
+struct lflow_cache_file_header {
+    uint32_t magic;             /* LFLOW_CACHE_FILE_MAGIC. */
+    uint32_t version;           /* LFLOW_CACHE_FILE_VERSION. */
+    uint32_t fingerprint;       /* As passed to lflow_cache_save(). */
+    uint32_t n_entries;
+    ovs_be32 crc;               /* CRC32C of the rest of the file. */
+    uint8_t pad[4];
+};
+BUILD_ASSERT_DECL(sizeof(struct lflow_cache_file_header) % 8 == 0);
+
+struct lflow_cache_file_entry {
+    struct uuid lflow_uuid;
+    uint32_t lflow_hash;
+    uint32_t n_conjs;
+    uint32_t conj_id_ofs;
+    uint32_t n_matches;
+    uint32_t size;              /* Bytes of matches that follow. */
+    uint8_t pad[4];
+};
+BUILD_ASSERT_DECL(sizeof(struct lflow_cache_file_entry) % 8 == 0);
+
+struct lflow_cache_file_match {
+    uint32_t match_len;         /* Length of the NXM match, w/o padding. */
+    uint32_t n_conjs;
+};
+BUILD_ASSERT_DECL(sizeof(struct lflow_cache_file_match) % 8 == 0);
+
+struct lflow_cache_file_conj {
+    uint32_t id;
+    uint8_t clause;
+    uint8_t n_clauses;
+    uint8_t pad[2];
+};
+BUILD_ASSERT_DECL(sizeof(struct lflow_cache_file_conj) % 8 == 0);
+
+/* An entry of the memory mapped file, not restored yet. */
+struct lflow_cache_saved {
+    struct hmap_node node;      /* In 'saved', by lflow uuid. */
+    const struct lflow_cache_file_entry *entry;
+};
+
 static bool lflow_cache_make_room__(struct lflow_cache *lc,
-                                    enum lflow_cache_type type);
+                                    enum lflow_cache_type type,
+                                    uint64_t benefit);
+static bool lflow_cache_reserve__(struct lflow_cache *lc,
+                                  enum lflow_cache_type type, size_t size,
+                                  uint64_t benefit);
+static struct lflow_cache_shared *lflow_cache_find_shared__(
+    const struct lflow_cache *lc, enum lflow_cache_type type,
+    const char *key);
+static struct lflow_cache_value *lflow_cache_insert__(
+    struct lflow_cache *lc, const struct uuid *lflow_uuid,
+    uint32_t lflow_hash, struct lflow_cache_shared *shared);
 static struct lflow_cache_value *lflow_cache_add__(
     struct lflow_cache *lc, const struct uuid *lflow_uuid,
-    enum lflow_cache_type type, uint64_t value_size);
+    uint32_t lflow_hash, enum lflow_cache_type type, const char *key,
+    uint64_t value_size, uint64_t cost);
 static void lflow_cache_delete__(struct lflow_cache *lc,
                                  struct lflow_cache_entry *lce);
 static void lflow_cache_trim__(struct lflow_cache *lc, bool force);
@@ -89,8 +203,11 @@ lflow_cache_create(void)
 
     for (size_t i = 0; i < LCACHE_T_MAX; i++) {
         hmap_init(&lc->entries[i]);
+        hmap_init(&lc->shared[i]);
+        heap_init(&lc->heaps[i]);
     }
     lc->mt = memory_trimmer_create();
+    hmap_init(&lc->saved);
 
     return lc;
 }
@@ -110,6 +227,8 @@ lflow_cache_flush(struct lflow_cache *lc)
             lflow_cache_delete__(lc, lce);
         }
     }
+    lc->inflation = 0;
+    lflow_cache_drop_saved(lc);
     lflow_cache_trim__(lc, true);
 }
 
@@ -123,7 +242,10 @@ lflow_cache_destroy(struct lflow_cache *lc)
     lflow_cache_flush(lc);
     for (size_t i = 0; i < LCACHE_T_MAX; i++) {
         hmap_destroy(&lc->entries[i]);
+        hmap_destroy(&lc->shared[i]);
+        heap_destroy(&lc->heaps[i]);
     }
+    hmap_destroy(&lc->saved);
     memory_trimmer_destroy(lc->mt);
     free(lc);
 }
@@ -203,18 +325,31 @@ lflow_cache_get_stats(const struct lflow_cache *lc, struct ds *output)
                       hmap_count(&lc->entries[i]));
     }
     ds_put_format(output, "%-16s: %"PRIu64"\n", "trim count", lc->trim_count);
+    ds_put_format(output, "%-16s: %"PRIu64"\n", "hits", lc->n_hits);
+    ds_put_format(output, "%-16s: %"PRIu64"\n", "misses", lc->n_misses);
+    ds_put_format(output, "%-16s: %"PRIu64"\n", "evictions",
+                  lc->n_evictions);
     ds_put_format(output, "%-16s: %"PRIu64"\n", "Mem usage (KB)",
                   ROUND_UP(lc->mem_usage, 1024) / 1024);
 }
 
+/* Caches 'expr' for 'lflow_uuid'.  If 'key' is nonnull, the expression can
+ * be shared with other logical flows with the same 'key', and if there is
+ * one already, it is used instead of 'expr'.
+ *
+ * 'cost' is the time, in microseconds, that it took to compute 'expr'.  When
+ * the cache is full, the entries that are the cheapest to recompute for the
+ * memory they use are evicted first. */
 void
 lflow_cache_add_expr(struct lflow_cache *lc, const struct uuid *lflow_uuid,
-                     struct expr *expr, size_t expr_sz)
+                     const char *key, struct expr *expr, size_t expr_sz,
+                     uint64_t cost)
 {
     struct lflow_cache_value *lcv =
-        lflow_cache_add__(lc, lflow_uuid, LCACHE_T_EXPR, expr_sz);
+        lflow_cache_add__(lc, lflow_uuid, 0, LCACHE_T_EXPR, key, expr_sz,
+                          cost);
 
-    if (!lcv) {
+    if (!lcv || lcv->ref_count > 1) {
         expr_destroy(expr);
         return;
     }
@@ -222,15 +357,21 @@ lflow_cache_add_expr(struct lflow_cache *lc, const struct uuid *lflow_uuid,
     lcv->expr = expr;
 }
 
+/* Caches 'matches' for 'lflow_uuid'.  Same as lflow_cache_add_expr() for
+ * 'key' and 'cost', except that matches with conjunctions are never shared,
+ * as their conjunction ids are specific to 'lflow_uuid'. */
 void
 lflow_cache_add_matches(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                        uint32_t lflow_hash, const char *key,
                         uint32_t conj_id_ofs, uint32_t n_conjs,
-                        struct hmap *matches, size_t matches_sz)
+                        struct hmap *matches, size_t matches_sz,
+                        uint64_t cost)
 {
     struct lflow_cache_value *lcv =
-        lflow_cache_add__(lc, lflow_uuid, LCACHE_T_MATCHES, matches_sz);
+        lflow_cache_add__(lc, lflow_uuid, lflow_hash, LCACHE_T_MATCHES,
+                          n_conjs ? NULL : key, matches_sz, cost);
 
-    if (!lcv) {
+    if (!lcv || lcv->ref_count > 1) {
         expr_matches_destroy(matches);
         free(matches);
         return;
@@ -241,13 +382,9 @@ lflow_cache_add_matches(struct lflow_cache *lc, const struct uuid *lflow_uuid,
     lcv->conj_id_ofs = conj_id_ofs;
 }
 
-struct lflow_cache_value *
-lflow_cache_get(struct lflow_cache *lc, const struct uuid *lflow_uuid)
+static struct lflow_cache_entry *
+lflow_cache_find__(const struct lflow_cache *lc, const struct uuid *lflow_uuid)
 {
-    if (!lflow_cache_is_enabled(lc)) {
-        return NULL;
-    }
-
     size_t hash = uuid_hash(lflow_uuid);
 
     for (size_t i = 0; i < LCACHE_T_MAX; i++) {
@@ -255,15 +392,145 @@ lflow_cache_get(struct lflow_cache *lc, const struct uuid *lflow_uuid)
 
         HMAP_FOR_EACH_WITH_HASH (lce, node, hash, &lc->entries[i]) {
             if (uuid_equals(&lce->lflow_uuid, lflow_uuid)) {
-                COVERAGE_INC(lflow_cache_hit);
-                return &lce->value;
+                return lce;
             }
         }
     }
+    return NULL;
+}
+
+/* Returns the eviction priority of an entry with a value of 'benefit', as
+ * per the GreedyDual-Size algorithm: the entry with the lowest 'inflation' +
+ * 'benefit' is evicted first, and 'inflation' is raised to its value, which
+ * ages the entries that weren't used since they were added.  As heap.h is a
+ * max-heap, the priority is inverted. */
+static uint64_t
+lflow_cache_priority__(const struct lflow_cache *lc, uint64_t benefit)
+{
+    return UINT64_MAX - (lc->inflation + benefit);
+}
+
+static uint64_t
+lflow_cache_entry_benefit(const struct lflow_cache_entry *lce)
+{
+    const struct lflow_cache_shared *shared =
+        CONTAINER_OF(lce->value, struct lflow_cache_shared, value);
+    return shared->benefit;
+}
+
+struct lflow_cache_value *
+lflow_cache_get(struct lflow_cache *lc, const struct uuid *lflow_uuid)
+{
+    if (!lflow_cache_is_enabled(lc)) {
+        return NULL;
+    }
+
+    struct lflow_cache_entry *lce = lflow_cache_find__(lc, lflow_uuid);
+    if (lce) {
+        COVERAGE_INC(lflow_cache_hit);
+        lc->n_hits++;
+        heap_change(&lc->heaps[lce->value->type], &lce->heap_node,
+                    lflow_cache_priority__(
+                        lc, lflow_cache_entry_benefit(lce)));
+        return lce->value;
+    }
     COVERAGE_INC(lflow_cache_miss);
+    lc->n_misses++;
+    return NULL;
+}
+
+/* Same as lflow_cache_get(), except that the value cached for 'lflow_uuid'
+ * is returned only if it was added with 'key'.  Otherwise, the value is
+ * stale, e.g., because the logical flow refers to template variables whose
+ * values changed since, and the entry is deleted. */
+struct lflow_cache_value *
+lflow_cache_get_for_key(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                        const char *key)
+{
+    if (!lflow_cache_is_enabled(lc)) {
+        return NULL;
+    }
+
+    const struct lflow_cache_entry *lce = lflow_cache_find__(lc, lflow_uuid);
+    if (lce) {
+        const struct lflow_cache_shared *shared =
+            CONTAINER_OF(lce->value, struct lflow_cache_shared, value);
+
+        if (!shared->key || strcmp(shared->key, key)) {
+            COVERAGE_INC(lflow_cache_delete_stale);
+            lflow_cache_delete(lc, lflow_uuid);
+        }
+    }
+    return lflow_cache_get(lc, lflow_uuid);
+}
+
+/* Returns true if 'lc' has an entry for 'lflow_uuid'.  Unlike
+ * lflow_cache_get(), this doesn't count as a cache hit or miss. */
+bool
+lflow_cache_contains(const struct lflow_cache *lc,
+                     const struct uuid *lflow_uuid)
+{
+    return lflow_cache_is_enabled(lc) && lflow_cache_find__(lc, lflow_uuid);
+}
+
+/* Returns the value cached for 'key', preferring matches over expressions,
+ * or NULL if there is none.  This doesn't modify 'lc' at all, so it may be
+ * called from several threads as long as 'lc' isn't modified meanwhile. */
+const struct lflow_cache_value *
+lflow_cache_find_shared(const struct lflow_cache *lc, const char *key)
+{
+    if (!lflow_cache_is_enabled(lc)) {
+        return NULL;
+    }
+
+    for (size_t i = LCACHE_T_MAX; i-- > 0;) {
+        struct lflow_cache_shared *shared =
+            lflow_cache_find_shared__(lc, i, key);
+        if (shared) {
+            return &shared->value;
+        }
+    }
     return NULL;
 }
 
+/* Makes 'lflow_uuid' refer to the value that lflow_cache_find_shared()
+ * returns for 'key', and returns it.  Returns NULL if there is no such value
+ * or no room for another entry.  If 'lflow_uuid' is cached already, returns
+ * its value instead. */
+struct lflow_cache_value *
+lflow_cache_add_shared(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                       uint32_t lflow_hash, const char *key)
+{
+    if (!lflow_cache_is_enabled(lc)) {
+        return NULL;
+    }
+
+    struct lflow_cache_entry *lce = lflow_cache_find__(lc, lflow_uuid);
+    if (lce) {
+        return lce->value;
+    }
+
+    const struct lflow_cache_value *lcv = lflow_cache_find_shared(lc, key);
+    if (!lcv) {
+        return NULL;
+    }
+
+    /* Making room may evict the last reference to the value. */
+    enum lflow_cache_type type = lcv->type;
+    uint64_t benefit = CONTAINER_OF(lcv, struct lflow_cache_shared,
+                                    value)->benefit;
+    if (!lflow_cache_reserve__(lc, type, sizeof *lce, benefit)) {
+        return NULL;
+    }
+    struct lflow_cache_shared *shared = lflow_cache_find_shared__(lc, type,
+                                                                  key);
+    if (!shared) {
+        return NULL;
+    }
+    COVERAGE_INC(lflow_cache_hit_shared);
+    return lflow_cache_insert__(lc, lflow_uuid, lflow_hash, shared);
+}
+
 void
 lflow_cache_delete(struct lflow_cache *lc, const struct uuid *lflow_uuid)
 {
@@ -271,33 +538,48 @@ lflow_cache_delete(struct lflow_cache *lc, const struct uuid *lflow_uuid)
         return;
     }
 
-    struct lflow_cache_value *lcv = lflow_cache_get(lc, lflow_uuid);
-    if (lcv) {
+    struct lflow_cache_entry *lce = lflow_cache_is_enabled(lc)
+                                    ? lflow_cache_find__(lc, lflow_uuid)
+                                    : NULL;
+    if (lce) {
         COVERAGE_INC(lflow_cache_delete);
-        lflow_cache_delete__(lc, CONTAINER_OF(lcv, struct lflow_cache_entry,
-                                              value));
+        lflow_cache_delete__(lc, lce);
         lflow_cache_trim__(lc, false);
         memory_trimmer_record_activity(lc->mt);
     }
 }
 
+/* Evicts an entry to make room for an entry of 'type' whose value is worth
+ * 'benefit'.  Returns false if there is no entry that is worth less.
+ *
+ * When the cache becomes full, the rule is to prefer more "important"
+ * cache entries over less "important" ones.  That is, evict entries of
+ * type LCACHE_T_EXPR if there's no room to add an entry of type
+ * LCACHE_T_MATCHES.  Among the entries of a type, the one with the lowest
+ * GreedyDual-Size priority goes first, see lflow_cache_priority__(), so
+ * that entries that are cheap to recompute, large or not used recently are
+ * evicted before the others. */
 static bool
-lflow_cache_make_room__(struct lflow_cache *lc, enum lflow_cache_type type)
+lflow_cache_make_room__(struct lflow_cache *lc, enum lflow_cache_type type,
+                        uint64_t benefit)
 {
-    /* When the cache becomes full, the rule is to prefer more "important"
-     * cache entries over less "important" ones.  That is, evict entries of
-     * type LCACHE_T_EXPR if there's no room to add an entry of type
-     * LCACHE_T_MATCHES.
-     */
-    for (size_t i = 0; i < type; i++) {
-        if (hmap_count(&lc->entries[i]) > 0) {
-            struct lflow_cache_entry *lce =
-                CONTAINER_OF(hmap_first(&lc->entries[i]),
-                             struct lflow_cache_entry, node);
+    for (size_t i = 0; i <= type; i++) {
+        if (heap_is_empty(&lc->heaps[i])) {
+            continue;
+        }
 
-            lflow_cache_delete__(lc, lce);
-            return true;
+        struct lflow_cache_entry *lce =
+            CONTAINER_OF(heap_max(&lc->heaps[i]), struct lflow_cache_entry,
+                         heap_node);
+        uint64_t value = UINT64_MAX - lce->heap_node.priority;
+        if (i == type && value >= lc->inflation + benefit) {
+            return false;
         }
+
+        lc->inflation = MAX(lc->inflation, value);
+        lc->n_evictions++;
+        lflow_cache_delete__(lc, lce);
+        return true;
     }
     return false;
 }
@@ -313,6 +595,7 @@ lflow_cache_get_memory_usage(const struct lflow_cache *lc, struct simap *usage)
     }
     simap_increase(usage, "lflow-cache-size-KB",
                    ROUND_UP(lc->mem_usage, 1024) / 1024);
+    memory_trimmer_get_memory_usage(lc->mt, usage);
 }
 
 void
@@ -329,68 +612,500 @@ lflow_cache_wait(struct lflow_cache *lc)
     memory_trimmer_wait(lc->mt);
 }
 
+static void
+lflow_cache_put_entry(struct ofpbuf *buf, const struct lflow_cache_entry *lce)
+{
+    size_t start = buf->size;
+    struct lflow_cache_file_entry *fe = ofpbuf_put_zeros(buf, sizeof *fe);
+
+    fe->lflow_uuid = lce->lflow_uuid;
+    fe->lflow_hash = lce->lflow_hash;
+    fe->n_conjs = lce->value->n_conjs;
+    fe->conj_id_ofs = lce->value->conj_id_ofs;
+    fe->n_matches = hmap_count(lce->value->expr_matches);
+
+    struct expr_match *m;
+    HMAP_FOR_EACH (m, hmap_node, lce->value->expr_matches) {
+        size_t match_ofs = buf->size;
+        struct lflow_cache_file_match *fm;
+
+        ofpbuf_put_zeros(buf, sizeof *fm);
+        int match_len = nx_put_match(buf, &m->match, htonll(0), htonll(0));
+        fm = ofpbuf_at_assert(buf, match_ofs, sizeof *fm);
+        fm->match_len = match_len;
+        fm->n_conjs = m->n;
+
+        for (size_t i = 0; i < m->n; i++) {
+            struct lflow_cache_file_conj *fc = ofpbuf_put_zeros(buf,
+                                                                sizeof *fc);
+            fc->id = m->conjunctions[i].id;
+            fc->clause = m->conjunctions[i].clause;
+            fc->n_clauses = m->conjunctions[i].n_clauses;
+        }
+    }
+
+    fe = ofpbuf_at_assert(buf, start, sizeof *fe);
+    fe->size = buf->size - start - sizeof *fe;
+}
+
+/* Saves the LCACHE_T_MATCHES entries of 'lc' to 'file_name', tagged with
+ * 'fingerprint', so that lflow_cache_load() can restore them after a restart.
+ * The saved entries that weren't restored yet are written back too.
+ *
+ * Returns 0 if successful, otherwise a positive errno value. */
+int
+lflow_cache_save(const struct lflow_cache *lc, const char *file_name,
+                 uint32_t fingerprint)
+{
+    struct lflow_cache_file_header *hdr;
+    struct ofpbuf buf;
+
+    ofpbuf_init(&buf, 0);
+    ofpbuf_put_zeros(&buf, sizeof *hdr);
+
+    struct lflow_cache_entry *lce;
+    HMAP_FOR_EACH (lce, node, &lc->entries[LCACHE_T_MATCHES]) {
+        lflow_cache_put_entry(&buf, lce);
+    }
+    struct lflow_cache_saved *saved;
+    HMAP_FOR_EACH (saved, node, &lc->saved) {
+        ofpbuf_put(&buf, saved->entry, sizeof *saved->entry
+                                       + saved->entry->size);
+    }
+
+    hdr = buf.data;
+    hdr->magic = LFLOW_CACHE_FILE_MAGIC;
+    hdr->version = LFLOW_CACHE_FILE_VERSION;
+    hdr->fingerprint = fingerprint;
+    hdr->n_entries = hmap_count(&lc->entries[LCACHE_T_MATCHES])
+                     + hmap_count(&lc->saved);
+    hdr->crc = crc32c((const uint8_t *) (hdr + 1), buf.size - sizeof *hdr);
+
+    /* Write to a temporary file first, so that a crash never leaves a
+     * partially written cache behind. */
+    char *tmp_name = xasprintf("%s.tmp", file_name);
+    int error = 0;
+    FILE *stream = fopen(tmp_name, "wb");
+    if (!stream) {
+        error = errno;
+    } else {
+        if (fwrite(buf.data, buf.size, 1, stream) != 1) {
+            error = errno;
+        }
+        if (fclose(stream) && !error) {
+            error = errno;
+        }
+        if (!error && rename(tmp_name, file_name)) {
+            error = errno;
+        }
+        if (error) {
+            unlink(tmp_name);
+        }
+    }
+
+    if (error) {
+        VLOG_WARN("%s: failed to save the logical flow cache (%s)",
+                  file_name, ovs_strerror(error));
+    } else {
+        VLOG_INFO("%s: saved %"PRIu32" logical flow cache entries",
+                  file_name, hdr->n_entries);
+    }
+    free(tmp_name);
+    ofpbuf_uninit(&buf);
+    return error;
+}
+
+/* Indexes the entries of the mapped file 'map', of 'size' bytes, into
+ * 'lc->saved'.  Returns NULL if successful, otherwise an error message. */
+static const char *
+lflow_cache_index_saved(struct lflow_cache *lc, const void *map, size_t size,
+                        uint32_t fingerprint)
+{
+    const struct lflow_cache_file_header *hdr = map;
+
+    if (size < sizeof *hdr
+        || hdr->magic != LFLOW_CACHE_FILE_MAGIC
+        || hdr->version != LFLOW_CACHE_FILE_VERSION) {
+        return "unknown file format";
+    }
+    if (hdr->fingerprint != fingerprint) {
+        return "saved for a different logical flow syntax";
+    }
+    if (hdr->crc != crc32c((const uint8_t *) (hdr + 1),
+                           size - sizeof *hdr)) {
+        return "checksum mismatch";
+    }
+
+    size_t ofs = sizeof *hdr;
+    for (uint32_t i = 0; i < hdr->n_entries; i++) {
+        const struct lflow_cache_file_entry *fe =
+            (const void *) ((const uint8_t *) map + ofs);
+
+        if (size - ofs < sizeof *fe
+            || size - ofs - sizeof *fe < fe->size
+            || fe->size % 8) {
+            return "truncated file";
+        }
+        ofs += sizeof *fe + fe->size;
+
+        struct lflow_cache_saved *saved = xmalloc(sizeof *saved);
+        saved->entry = fe;
+        hmap_insert(&lc->saved, &saved->node, uuid_hash(&fe->lflow_uuid));
+    }
+    return NULL;
+}
+
+/* Maps 'file_name', written by lflow_cache_save(), so that its entries can
+ * be restored by lflow_cache_restore().  The file is ignored if it wasn't
+ * saved with the same 'fingerprint'. */
+void
+lflow_cache_load(struct lflow_cache *lc, const char *file_name,
+                 uint32_t fingerprint)
+{
+    lflow_cache_drop_saved(lc);
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            VLOG_WARN("%s: open failed (%s)", file_name,
+                      ovs_strerror(errno));
+        }
+        return;
+    }
+
+    struct stat s;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &s)) {
+        VLOG_WARN("%s: fstat failed (%s)", file_name, ovs_strerror(errno));
+    } else if (s.st_size > 0) {
+        map = mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            VLOG_WARN("%s: mmap failed (%s)", file_name, ovs_strerror(errno));
+        }
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    lc->saved_map = map;
+    lc->saved_map_size = s.st_size;
+
+    const char *error = lflow_cache_index_saved(lc, map, s.st_size,
+                                                fingerprint);
+    if (error) {
+        VLOG_WARN("%s: ignoring the saved logical flow cache: %s",
+                  file_name, error);
+        lflow_cache_drop_saved(lc);
+        return;
+    }
+    VLOG_INFO("%s: loaded %"PRIuSIZE" saved logical flow cache entries",
+              file_name, hmap_count(&lc->saved));
+}
+
+/* Decodes the matches of the saved entry 'fe'.  Returns NULL if they are
+ * not valid, otherwise the matches and their size in '*sizep'. */
+static struct hmap *
+lflow_cache_decode_matches(const struct lflow_cache_file_entry *fe,
+                           size_t *sizep)
+{
+    struct hmap *matches = xmalloc(sizeof *matches);
+    size_t size = sizeof *matches;
+    struct ofpbuf b;
+
+    hmap_init(matches);
+    ofpbuf_use_const(&b, fe + 1, fe->size);
+    for (uint32_t i = 0; i < fe->n_matches; i++) {
+        const struct lflow_cache_file_match *fm = ofpbuf_try_pull(&b,
+                                                                 sizeof *fm);
+        if (!fm) {
+            goto error;
+        }
+
+        struct expr_match *m = xzalloc(sizeof *m);
+        ovs_be64 cookie, cookie_mask;
+        if (nx_pull_match(&b, fm->match_len, &m->match, &cookie,
+                          &cookie_mask, false, NULL, NULL)) {
+            expr_match_destroy(m);
+            goto error;
+        }
+        hmap_insert(matches, &m->hmap_node, match_hash(&m->match, 0));
+
+        if (fm->n_conjs) {
+            const struct lflow_cache_file_conj *fc =
+                ofpbuf_try_pull(&b, fm->n_conjs * sizeof *fc);
+            if (!fc) {
+                goto error;
+            }
+            m->conjunctions = xmalloc(fm->n_conjs * sizeof *m->conjunctions);
+            for (size_t j = 0; j < fm->n_conjs; j++) {
+                m->conjunctions[j].id = fc[j].id;
+                m->conjunctions[j].clause = fc[j].clause;
+                m->conjunctions[j].n_clauses = fc[j].n_clauses;
+            }
+            m->n = m->allocated = fm->n_conjs;
+        }
+        size += sizeof *m + m->allocated * sizeof *m->conjunctions;
+    }
+    if (b.size) {
+        goto error;
+    }
+
+    *sizep = size;
+    return matches;
+
+error:
+    expr_matches_destroy(matches);
+    free(matches);
+    return NULL;
+}
+
+/* Adds the saved entry 'fe' to 'lc', if it is valid and there is room for
+ * it.  Returns the new cache value, otherwise NULL. */
 static struct lflow_cache_value *
-lflow_cache_add__(struct lflow_cache *lc, const struct uuid *lflow_uuid,
-                  enum lflow_cache_type type, uint64_t value_size)
+lflow_cache_restore__(struct lflow_cache *lc,
+                      const struct lflow_cache_file_entry *fe,
+                      uint32_t lflow_hash)
 {
-    if (!lflow_cache_is_enabled(lc) || !lflow_uuid) {
+    if (fe->lflow_hash != lflow_hash) {
+        COVERAGE_INC(lflow_cache_restore_stale);
         return NULL;
     }
 
-    struct lflow_cache_entry *lce;
-    size_t size = sizeof *lce + value_size;
-    if (size + lc->mem_usage > lc->max_mem_usage) {
-        COVERAGE_INC(lflow_cache_mem_full);
+    size_t matches_sz;
+    struct hmap *matches = lflow_cache_decode_matches(fe, &matches_sz);
+    if (!matches) {
+        VLOG_WARN_RL(&rl, "lflow "UUID_FMT": invalid saved cache entry",
+                     UUID_ARGS(&fe->lflow_uuid));
         return NULL;
     }
 
+    /* The time it took to compute the matches isn't saved, so restored
+     * entries are evicted before the ones computed by this run. */
+    struct lflow_cache_value *lcv =
+        lflow_cache_add__(lc, &fe->lflow_uuid, lflow_hash, LCACHE_T_MATCHES,
+                          NULL, matches_sz, 0);
+    if (!lcv) {
+        expr_matches_destroy(matches);
+        free(matches);
+        return NULL;
+    }
+    COVERAGE_INC(lflow_cache_restore);
+    lcv->expr_matches = matches;
+    lcv->n_conjs = fe->n_conjs;
+    lcv->conj_id_ofs = fe->conj_id_ofs;
+    return lcv;
+}
+
+/* Looks for an entry for 'lflow_uuid' saved by a previous run and, if it was
+ * saved for the same 'lflow_hash', adds it to 'lc' as LCACHE_T_MATCHES.
+ * Returns the new cache value, or NULL if there was no valid saved entry.
+ *
+ * The caller must make sure that 'lc' doesn't have an entry for 'lflow_uuid'
+ * already.  Each saved entry is considered only once. */
+struct lflow_cache_value *
+lflow_cache_restore(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                    uint32_t lflow_hash)
+{
+    struct lflow_cache_saved *saved = NULL;
+    struct lflow_cache_saved *iter;
+
+    HMAP_FOR_EACH_WITH_HASH (iter, node, uuid_hash(lflow_uuid), &lc->saved) {
+        if (uuid_equals(&iter->entry->lflow_uuid, lflow_uuid)) {
+            saved = iter;
+            break;
+        }
+    }
+    if (!saved) {
+        return NULL;
+    }
+
+    hmap_remove(&lc->saved, &saved->node);
+    struct lflow_cache_value *lcv = lflow_cache_restore__(lc, saved->entry,
+                                                          lflow_hash);
+    free(saved);
+
+    /* Unmap the file as soon as it is not needed anymore. */
+    if (hmap_is_empty(&lc->saved)) {
+        lflow_cache_drop_saved(lc);
+    }
+    return lcv;
+}
+
+bool
+lflow_cache_has_saved(const struct lflow_cache *lc)
+{
+    return lc && !hmap_is_empty(&lc->saved);
+}
+
+/* Forgets about the entries saved by a previous run that weren't restored
+ * yet and unmaps the file they were loaded from. */
+void
+lflow_cache_drop_saved(struct lflow_cache *lc)
+{
+    struct lflow_cache_saved *saved;
+
+    HMAP_FOR_EACH_POP (saved, node, &lc->saved) {
+        free(saved);
+    }
+    if (lc->saved_map) {
+        munmap(lc->saved_map, lc->saved_map_size);
+        lc->saved_map = NULL;
+        lc->saved_map_size = 0;
+    }
+}
+
+/* Checks that there is room in 'lc' for 'size' more bytes and for another
+ * entry of 'type' whose value is worth 'benefit', evicting other entries if
+ * necessary. */
+static bool
+lflow_cache_reserve__(struct lflow_cache *lc, enum lflow_cache_type type,
+                      size_t size, uint64_t benefit)
+{
+    if (size > lc->max_mem_usage) {
+        COVERAGE_INC(lflow_cache_mem_full);
+        return false;
+    }
+    while (size + lc->mem_usage > lc->max_mem_usage) {
+        if (!lflow_cache_make_room__(lc, type, benefit)) {
+            COVERAGE_INC(lflow_cache_mem_full);
+            return false;
+        }
+        COVERAGE_INC(lflow_cache_made_room);
+    }
+
     if (lc->n_entries == lc->capacity) {
-        if (!lflow_cache_make_room__(lc, type)) {
+        if (!lflow_cache_make_room__(lc, type, benefit)) {
             COVERAGE_INC(lflow_cache_full);
-            return NULL;
+            return false;
         } else {
             COVERAGE_INC(lflow_cache_made_room);
         }
     }
+    return true;
+}
+
+static struct lflow_cache_shared *
+lflow_cache_find_shared__(const struct lflow_cache *lc,
+                          enum lflow_cache_type type, const char *key)
+{
+    struct lflow_cache_shared *shared;
+
+    HMAP_FOR_EACH_WITH_HASH (shared, node, hash_string(key, 0),
+                             &lc->shared[type]) {
+        if (!strcmp(shared->key, key)) {
+            return shared;
+        }
+    }
+    return NULL;
+}
+
+/* Adds an entry for 'lflow_uuid' that refers to the value of 'shared'. */
+static struct lflow_cache_value *
+lflow_cache_insert__(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                     uint32_t lflow_hash, struct lflow_cache_shared *shared)
+{
+    struct lflow_cache_entry *lce = ovn_slab_zalloc(&lflow_cache_entry_slab);
 
     memory_trimmer_record_activity(lc->mt);
-    lc->mem_usage += size;
+    lc->mem_usage += sizeof *lce;
 
     COVERAGE_INC(lflow_cache_add);
-    lce = xzalloc(sizeof *lce);
     lce->lflow_uuid = *lflow_uuid;
-    lce->size = size;
-    lce->value.type = type;
-    hmap_insert(&lc->entries[type], &lce->node, uuid_hash(lflow_uuid));
+    lce->lflow_hash = lflow_hash;
+    lce->value = &shared->value;
+    lce->value->ref_count++;
+    hmap_insert(&lc->entries[shared->value.type], &lce->node,
+                uuid_hash(lflow_uuid));
+    heap_insert(&lc->heaps[shared->value.type], &lce->heap_node,
+                lflow_cache_priority__(lc, shared->benefit));
     lc->n_entries++;
     lc->high_watermark = MAX(lc->high_watermark, lc->n_entries);
-    return &lce->value;
+    return lce->value;
+}
+
+/* Adds an entry of 'type' for 'lflow_uuid'.  If 'key' is nonnull and there
+ * is a value cached for it already, the entry refers to it.  Otherwise, it
+ * refers to a new value of 'value_size' bytes, that took 'cost' microseconds
+ * to compute, shared under 'key' if it is nonnull, that the caller must fill.
+ * The new value has a 'ref_count' of 1. */
+static struct lflow_cache_value *
+lflow_cache_add__(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                  uint32_t lflow_hash, enum lflow_cache_type type,
+                  const char *key, uint64_t value_size, uint64_t cost)
+{
+    if (!lflow_cache_is_enabled(lc) || !lflow_uuid) {
+        return NULL;
+    }
+
+    struct lflow_cache_shared *shared;
+    size_t shared_size = sizeof *shared + value_size
+                         + (key ? strlen(key) + 1 : 0);
+    uint64_t benefit = cost * 1024 / shared_size;
+    if (!lflow_cache_reserve__(lc, type,
+                               sizeof(struct lflow_cache_entry)
+                               + shared_size, benefit)) {
+        return NULL;
+    }
+
+    shared = key ? lflow_cache_find_shared__(lc, type, key) : NULL;
+    if (!shared) {
+        shared = xzalloc(sizeof *shared);
+        shared->size = shared_size;
+        shared->benefit = benefit;
+        shared->value.type = type;
+        if (key) {
+            shared->key = xstrdup(key);
+            hmap_insert(&lc->shared[type], &shared->node,
+                        hash_string(key, 0));
+        }
+        lc->mem_usage += shared_size;
+    }
+    return lflow_cache_insert__(lc, lflow_uuid, lflow_hash, shared);
 }
 
 static void
 lflow_cache_delete__(struct lflow_cache *lc, struct lflow_cache_entry *lce)
 {
+    struct lflow_cache_value *lcv = lce->value;
+
     ovs_assert(lc->n_entries > 0);
-    hmap_remove(&lc->entries[lce->value.type], &lce->node);
+    hmap_remove(&lc->entries[lcv->type], &lce->node);
+    heap_remove(&lc->heaps[lcv->type], &lce->heap_node);
     lc->n_entries--;
-    switch (lce->value.type) {
+    ovs_assert(lc->mem_usage >= sizeof *lce);
+    lc->mem_usage -= sizeof *lce;
+    ovn_slab_free(&lflow_cache_entry_slab, lce);
+
+    ovs_assert(lcv->ref_count > 0);
+    if (--lcv->ref_count) {
+        return;
+    }
+
+    switch (lcv->type) {
     case LCACHE_T_NONE:
         OVS_NOT_REACHED();
         break;
     case LCACHE_T_EXPR:
         COVERAGE_INC(lflow_cache_free_expr);
-        expr_destroy(lce->value.expr);
+        expr_destroy(lcv->expr);
         break;
     case LCACHE_T_MATCHES:
         COVERAGE_INC(lflow_cache_free_matches);
-        expr_matches_destroy(lce->value.expr_matches);
-        free(lce->value.expr_matches);
+        expr_matches_destroy(lcv->expr_matches);
+        free(lcv->expr_matches);
         break;
     }
 
-    ovs_assert(lc->mem_usage >= lce->size);
-    lc->mem_usage -= lce->size;
-    free(lce);
+    struct lflow_cache_shared *shared =
+        CONTAINER_OF(lcv, struct lflow_cache_shared, value);
+    if (shared->key) {
+        hmap_remove(&lc->shared[lcv->type], &shared->node);
+        free(shared->key);
+    }
+    ovs_assert(lc->mem_usage >= shared->size);
+    lc->mem_usage -= shared->size;
+    free(shared);
 }
 
 static void
@@ -410,6 +1125,7 @@ lflow_cache_trim__(struct lflow_cache *lc, bool force)
     COVERAGE_INC(lflow_cache_trim);
     for (size_t i = 0; i < LCACHE_T_MAX; i++) {
         hmap_shrink(&lc->entries[i]);
+        hmap_shrink(&lc->shared[i]);
     }
 
     memory_trimmer_trim(lc->mt);
@@ -33,6 +33,9 @@ struct lflow_cache;
  *     (1) expr tree if the logical flow doesn't have port group/address set
  *         references but has other references (such as lport).
  *     (2) expr matches if the logical flow doesn't have any references.
+ *
+ * Cached values may be shared by several logical flows whose translation
+ * is the same, e.g., that have the same match.
  */
 enum lflow_cache_type {
     LCACHE_T_EXPR,    /* Expr tree of the logical flow is cached. */
@@ -43,6 +46,7 @@ enum lflow_cache_type {
 
 struct lflow_cache_value {
     enum lflow_cache_type type;
+    uint32_t ref_count;     /* Number of logical flows using this value. */
 
     /* n_conjs and conj_id_ofs are used only for LCACHE_T_MATCHES.
      * They are saved together with the match, so that we can re-allocate the
@@ -66,19 +70,48 @@ bool lflow_cache_is_enabled(const struct lflow_cache *);
 void lflow_cache_get_stats(const struct lflow_cache *, struct ds *output);
 
 void lflow_cache_add_expr(struct lflow_cache *, const struct uuid *lflow_uuid,
-                          struct expr *expr, size_t expr_sz);
+                          const char *key, struct expr *expr, size_t expr_sz,
+                          uint64_t cost);
 void lflow_cache_add_matches(struct lflow_cache *,
                              const struct uuid *lflow_uuid,
+                             uint32_t lflow_hash, const char *key,
                              uint32_t conj_id_ofs, uint32_t n_conjs,
-                             struct hmap *matches, size_t matches_sz);
+                             struct hmap *matches, size_t matches_sz,
+                             uint64_t cost);
 
 struct lflow_cache_value *lflow_cache_get(struct lflow_cache *,
                                           const struct uuid *lflow_uuid);
+struct lflow_cache_value *lflow_cache_get_for_key(
+    struct lflow_cache *, const struct uuid *lflow_uuid, const char *key);
+bool lflow_cache_contains(const struct lflow_cache *,
+                          const struct uuid *lflow_uuid);
+const struct lflow_cache_value *lflow_cache_find_shared(
+    const struct lflow_cache *, const char *key);
+struct lflow_cache_value *lflow_cache_add_shared(struct lflow_cache *,
+                                                 const struct uuid *lflow_uuid,
+                                                 uint32_t lflow_hash,
+                                                 const char *key);
 void lflow_cache_delete(struct lflow_cache *, const struct uuid *lflow_uuid);
 
 void lflow_cache_get_memory_usage(const struct lflow_cache *,
                                   struct simap *usage);
 
+/* Persistent storage of the LCACHE_T_MATCHES entries.
+ *
+ * Entries are saved together with the 'lflow_hash' they were added with and
+ * restored only for the same hash, which should cover everything the cached
+ * translation of the logical flow depends on.  'fingerprint' should cover
+ * everything else, e.g., the logical flow symbol table. */
+int lflow_cache_save(const struct lflow_cache *, const char *file_name,
+                     uint32_t fingerprint);
+void lflow_cache_load(struct lflow_cache *, const char *file_name,
+                      uint32_t fingerprint);
+struct lflow_cache_value *lflow_cache_restore(struct lflow_cache *,
+                                              const struct uuid *lflow_uuid,
+                                              uint32_t lflow_hash);
+bool lflow_cache_has_saved(const struct lflow_cache *);
+void lflow_cache_drop_saved(struct lflow_cache *);
+
 void lflow_cache_run(struct lflow_cache *);
 void lflow_cache_wait(struct lflow_cache *);
 
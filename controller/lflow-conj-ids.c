@@ -16,6 +16,8 @@
 #include <config.h>
 #include "coverage.h"
 #include "lflow-conj-ids.h"
+#include "lib/ovn-util.h"
+#include "lib/sliced-reply.h"
 #include "util.h"
 #include "hash.h"
 #include "openvswitch/list.h"
@@ -25,11 +27,13 @@ COVERAGE_DEFINE(lflow_conj_alloc);
 COVERAGE_DEFINE(lflow_conj_alloc_specified);
 COVERAGE_DEFINE(lflow_conj_free);
 COVERAGE_DEFINE(lflow_conj_free_unexpected);
+COVERAGE_DEFINE(lflow_conj_reuse);
 
 /* Node in struct conj_ids.conj_id_allocations. */
 struct conj_id_node {
     struct hmap_node hmap_node;
     uint32_t conj_id;
+    struct uuid lflow_uuid;     /* The lflow the id is allocated to. */
 };
 
 struct lflow_conj_node {
@@ -39,6 +43,12 @@ struct lflow_conj_node {
     struct uuid dp_uuid;
     uint32_t start_conj_id;
     uint32_t n_conjs;
+
+    /* The ids were freed by lflow_conj_ids_free() but are kept for the same
+     * lflow + DP until lflow_conj_ids_purge_released(), so that, if it is
+     * processed again in the meantime, it gets the same ids, even if it had
+     * a conflict, and its conjunctive flows don't change. */
+    bool released;
 };
 
 struct lflow_to_dps_node {
@@ -59,9 +69,12 @@ static struct lflow_conj_node *
 lflow_conj_ids_find_(struct conj_ids *conj_ids, const struct uuid *lflow_uuid,
                      const struct uuid *dp_uuid);
 static void lflow_conj_ids_free_(struct conj_ids *, struct lflow_conj_node *);
-static void lflow_conj_ids_free_for_lflow_dp(struct conj_ids *,
-                                             const struct uuid *lflow_uuid,
-                                             const struct uuid *dp_uuid);
+static uint32_t lflow_conj_ids_free_for_lflow_dp(struct conj_ids *,
+                                                 const struct uuid *lflow_uuid,
+                                                 const struct uuid *dp_uuid);
+static bool lflow_conj_ids_range_is_available(const struct conj_ids *,
+                                              uint32_t start_conj_id,
+                                              uint32_t n_conjs);
 static struct lflow_to_dps_node *lflow_to_dps_find(struct conj_ids *,
                                                    const struct uuid *);
 static inline uint32_t
@@ -87,8 +100,14 @@ lflow_conj_ids_set_test_mode(bool mode)
  * The first conjunction id is returned. If no conjunction ids available, or if
  * the input is invalid (n_conjs == 0), then 0 is returned.
  *
- * The algorithm tries to allocate the hash result of the combination of the
- * lflow_uuid and dp_uuid as the first conjunction id. If it is unavailable, or
+ * If the ids of the lflow_uuid and dp_uuid were released since the last
+ * lflow_conj_ids_purge_released() and enough of them are still available,
+ * the same first conjunction id is returned, so that processing an lflow
+ * again generates the same flows.
+ *
+ * Otherwise, the algorithm tries to allocate the hash result of the
+ * combination of the lflow_uuid and dp_uuid as the first conjunction id.
+ * If it is unavailable, or
  * any of the subsequent n_conjs - 1 ids are unavailable, iterate until the
  * next available n_conjs ids are found.  Given that n_conjs is very small (in
  * most cases will be 1), the algorithm should be efficient enough and in most
@@ -108,10 +127,21 @@ lflow_conj_ids_alloc(struct conj_ids *conj_ids, const struct uuid *lflow_uuid,
     if (!n_conjs) {
         return 0;
     }
-    lflow_conj_ids_free_for_lflow_dp(conj_ids, lflow_uuid, dp_uuid);
+    uint32_t released_id = lflow_conj_ids_free_for_lflow_dp(conj_ids,
+                                                            lflow_uuid,
+                                                            dp_uuid);
 
     COVERAGE_INC(lflow_conj_alloc);
 
+    if (released_id
+        && lflow_conj_ids_range_is_available(conj_ids, released_id,
+                                             n_conjs)) {
+        COVERAGE_INC(lflow_conj_reuse);
+        lflow_conj_ids_insert_(conj_ids, lflow_uuid, dp_uuid, released_id,
+                               n_conjs);
+        return released_id;
+    }
+
     uint32_t start_conj_id = hash_lflow_dp(lflow_uuid, dp_uuid);
     if (start_conj_id == 0) {
         start_conj_id++;
@@ -179,19 +209,9 @@ lflow_conj_ids_alloc_specified(struct conj_ids *conj_ids,
     }
     lflow_conj_ids_free_for_lflow_dp(conj_ids, lflow_uuid, dp_uuid);
 
-    uint32_t conj_id = start_conj_id;
-    for (uint32_t i = 0; i < n_conjs; i++) {
-        if (!conj_id) {
-            return false;
-        }
-        struct conj_id_node *conj_id_node;
-        HMAP_FOR_EACH_WITH_HASH (conj_id_node, hmap_node, conj_id,
-                                 &conj_ids->conj_id_allocations) {
-            if (conj_id_node->conj_id == conj_id) {
-                return false;
-            }
-        }
-        conj_id++;
+    if (!lflow_conj_ids_range_is_available(conj_ids, start_conj_id,
+                                           n_conjs)) {
+        return false;
     }
     lflow_conj_ids_insert_(conj_ids, lflow_uuid, dp_uuid, start_conj_id,
                            n_conjs);
@@ -209,10 +229,29 @@ lflow_conj_ids_find(struct conj_ids *conj_ids, const struct uuid *lflow_uuid,
     struct lflow_conj_node *lflow_conj = lflow_conj_ids_find_(conj_ids,
                                                               lflow_uuid,
                                                               dp_uuid);
-    return lflow_conj ? lflow_conj->start_conj_id : 0;
+    return lflow_conj && !lflow_conj->released ? lflow_conj->start_conj_id
+                                               : 0;
+}
+
+/* Returns true if 'conj_id' is allocated to the logical flow, for any DP. */
+bool
+lflow_conj_ids_is_allocated_to(const struct conj_ids *conj_ids,
+                               uint32_t conj_id, const struct uuid *lflow_uuid)
+{
+    struct conj_id_node *conj_id_node;
+    HMAP_FOR_EACH_WITH_HASH (conj_id_node, hmap_node, conj_id,
+                             &conj_ids->conj_id_allocations) {
+        if (conj_id_node->conj_id == conj_id) {
+            return uuid_equals(&conj_id_node->lflow_uuid, lflow_uuid);
+        }
+    }
+    return false;
 }
 
-/* Frees the conjunction IDs used by lflow_uuid. */
+/* Frees the conjunction IDs used by lflow_uuid.  They are only released:
+ * they can't be allocated to other lflows until the next
+ * lflow_conj_ids_purge_released(), so that the lflow gets them back if it
+ * is processed again before. */
 void
 lflow_conj_ids_free(struct conj_ids *conj_ids, const struct uuid *lflow_uuid)
 {
@@ -221,11 +260,42 @@ lflow_conj_ids_free(struct conj_ids *conj_ids, const struct uuid *lflow_uuid)
         return;
     }
     struct lflow_conj_node *lflow_conj;
-    LIST_FOR_EACH_SAFE (lflow_conj, list_node, &ltd->dps) {
-        lflow_conj_ids_free_(conj_ids, lflow_conj);
+    LIST_FOR_EACH (lflow_conj, list_node, &ltd->dps) {
+        if (!lflow_conj->released) {
+            lflow_conj->released = true;
+            conj_ids->n_released++;
+        }
+    }
+}
+
+/* Releases all the conjunction IDs, as lflow_conj_ids_free() does, e.g.
+ * before processing all the lflows again, so that they get the same ids
+ * regardless of the order in which they are processed. */
+void
+lflow_conj_ids_release_all(struct conj_ids *conj_ids)
+{
+    struct lflow_conj_node *lflow_conj;
+    HMAP_FOR_EACH (lflow_conj, hmap_node, &conj_ids->lflow_conj_ids) {
+        lflow_conj->released = true;
+    }
+    conj_ids->n_released = hmap_count(&conj_ids->lflow_conj_ids);
+}
+
+/* Frees for good the conjunction IDs that were released and not allocated
+ * again to the same lflow + DP since. */
+void
+lflow_conj_ids_purge_released(struct conj_ids *conj_ids)
+{
+    if (!conj_ids->n_released) {
+        return;
+    }
+
+    struct lflow_conj_node *lflow_conj;
+    HMAP_FOR_EACH_SAFE (lflow_conj, hmap_node, &conj_ids->lflow_conj_ids) {
+        if (lflow_conj->released) {
+            lflow_conj_ids_free_(conj_ids, lflow_conj);
+        }
     }
-    hmap_remove(&conj_ids->lflow_to_dps, &ltd->hmap_node);
-    free(ltd);
 }
 
 void
@@ -234,6 +304,7 @@ lflow_conj_ids_init(struct conj_ids *conj_ids)
     hmap_init(&conj_ids->conj_id_allocations);
     hmap_init(&conj_ids->lflow_conj_ids);
     hmap_init(&conj_ids->lflow_to_dps);
+    conj_ids->n_released = 0;
 }
 
 void
@@ -267,23 +338,49 @@ void lflow_conj_ids_clear(struct conj_ids *conj_ids) {
     lflow_conj_ids_init(conj_ids);
 }
 
-void
-lflow_conj_ids_dump(struct conj_ids *conj_ids, struct ds *out_data)
+static void
+lflow_conj_ids_dump_start(const void *conj_ids OVS_UNUSED, struct ds *out_data)
 {
-    struct lflow_conj_node *lflow_conj;
+    ds_put_cstr(out_data, "Conjunction IDs allocations:\n");
+}
+
+static bool
+lflow_conj_ids_dump_next(const void *conj_ids_, struct hmap_position *pos,
+                         struct ds *out_data)
+{
+    const struct conj_ids *conj_ids = conj_ids_;
+    struct hmap_node *node = hmap_at_position(&conj_ids->lflow_conj_ids,
+                                              pos);
+    if (!node) {
+        return false;
+    }
+    if (!out_data) {
+        return true;
+    }
+
+    const struct lflow_conj_node *lflow_conj =
+        CONTAINER_OF(node, struct lflow_conj_node, hmap_node);
+    bool has_conflict =
+        (lflow_conj->start_conj_id != lflow_conj->hmap_node.hash);
+    ds_put_format(out_data, "lflow: "UUID_FMT", dp: "UUID_FMT", start: %"
+                  PRIu32", n: %"PRIu32"%s%s\n",
+                  UUID_ARGS(&lflow_conj->lflow_uuid),
+                  UUID_ARGS(&lflow_conj->dp_uuid),
+                  lflow_conj->start_conj_id,
+                  lflow_conj->n_conjs,
+                  has_conflict ? " (*)" : "",
+                  lflow_conj->released ? " (released)" : "");
+    return true;
+}
+
+static void
+lflow_conj_ids_dump_finish(const void *conj_ids_, struct ds *out_data)
+{
+    const struct conj_ids *conj_ids = conj_ids_;
+    const struct lflow_conj_node *lflow_conj;
     size_t count = 0;
 
-    ds_put_cstr(out_data, "Conjunction IDs allocations:\n");
     HMAP_FOR_EACH (lflow_conj, hmap_node, &conj_ids->lflow_conj_ids) {
-        bool has_conflict =
-            (lflow_conj->start_conj_id != lflow_conj->hmap_node.hash);
-        ds_put_format(out_data, "lflow: "UUID_FMT", dp: "UUID_FMT", start: %"
-                      PRIu32", n: %"PRIu32"%s\n",
-                      UUID_ARGS(&lflow_conj->lflow_uuid),
-                      UUID_ARGS(&lflow_conj->dp_uuid),
-                      lflow_conj->start_conj_id,
-                      lflow_conj->n_conjs,
-                      has_conflict ? " (*)" : "");
         count += lflow_conj->n_conjs;
     }
 
@@ -297,6 +394,23 @@ lflow_conj_ids_dump(struct conj_ids *conj_ids, struct ds *out_data)
     }
 }
 
+/* Formats the conjunction IDs allocations of a "struct conj_ids", e.g. for
+ * sliced_reply_start(). */
+const struct sliced_reply_class lflow_conj_ids_dump_class = {
+    .start = lflow_conj_ids_dump_start,
+    .next = lflow_conj_ids_dump_next,
+    .finish = lflow_conj_ids_dump_finish,
+};
+
+/* Dumps the conjunction ID allocations of 'page', or all of them if 'page'
+ * is NULL, to 'out_data'.  The totals always account for all of them. */
+void
+lflow_conj_ids_dump(struct conj_ids *conj_ids,
+                    const struct ovn_unixctl_page *page, struct ds *out_data)
+{
+    sliced_reply_format(&lflow_conj_ids_dump_class, conj_ids, page, out_data);
+}
+
 static struct lflow_to_dps_node *
 lflow_to_dps_find(struct conj_ids *conj_ids, const struct uuid *lflow_uuid)
 {
@@ -324,6 +438,7 @@ lflow_conj_ids_insert_(struct conj_ids *conj_ids,
         ovs_assert(conj_id);
         struct conj_id_node *node = xzalloc(sizeof *node);
         node->conj_id = conj_id;
+        node->lflow_uuid = *lflow_uuid;
         hmap_insert(&conj_ids->conj_id_allocations, &node->hmap_node, conj_id);
         conj_id++;
     }
@@ -388,10 +503,22 @@ lflow_conj_ids_free_(struct conj_ids *conj_ids,
 
     hmap_remove(&conj_ids->lflow_conj_ids, &lflow_conj->hmap_node);
     ovs_list_remove(&lflow_conj->list_node);
+    if (lflow_conj->released) {
+        conj_ids->n_released--;
+    }
+
+    struct lflow_to_dps_node *ltd = lflow_to_dps_find(conj_ids,
+                                                      &lflow_conj->lflow_uuid);
+    if (ltd && ovs_list_is_empty(&ltd->dps)) {
+        hmap_remove(&conj_ids->lflow_to_dps, &ltd->hmap_node);
+        free(ltd);
+    }
     free(lflow_conj);
 }
 
-static void
+/* Frees the conjunction ids of the lflow_uuid and dp_uuid, if any.  Returns
+ * the first of them if they were released, 0 otherwise. */
+static uint32_t
 lflow_conj_ids_free_for_lflow_dp(struct conj_ids *conj_ids,
                                  const struct uuid *lflow_uuid,
                                  const struct uuid *dp_uuid)
@@ -400,12 +527,41 @@ lflow_conj_ids_free_for_lflow_dp(struct conj_ids *conj_ids,
                                                               lflow_uuid,
                                                               dp_uuid);
     if (!lflow_conj) {
-        return;
+        return 0;
     }
 
-    /* It is unexpected that an entry is found because this is called only by
-     * alloc/alloc_specified. Something may be wrong in the lflow module.
-     */
-    COVERAGE_INC(lflow_conj_free_unexpected);
+    uint32_t released_id = 0;
+    if (lflow_conj->released) {
+        released_id = lflow_conj->start_conj_id;
+    } else {
+        /* It is unexpected that an entry is found because this is called
+         * only by alloc/alloc_specified. Something may be wrong in the lflow
+         * module. */
+        COVERAGE_INC(lflow_conj_free_unexpected);
+    }
     lflow_conj_ids_free_(conj_ids, lflow_conj);
+    return released_id;
+}
+
+/* Returns true if none of the n_conjs ids starting from start_conj_id is
+ * allocated, or released, and if the range doesn't include 0. */
+static bool
+lflow_conj_ids_range_is_available(const struct conj_ids *conj_ids,
+                                  uint32_t start_conj_id, uint32_t n_conjs)
+{
+    uint32_t conj_id = start_conj_id;
+    for (uint32_t i = 0; i < n_conjs; i++) {
+        if (!conj_id) {
+            return false;
+        }
+        struct conj_id_node *conj_id_node;
+        HMAP_FOR_EACH_WITH_HASH (conj_id_node, hmap_node, conj_id,
+                                 &conj_ids->conj_id_allocations) {
+            if (conj_id_node->conj_id == conj_id) {
+                return false;
+            }
+        }
+        conj_id++;
+    }
+    return true;
 }
@@ -21,6 +21,9 @@
 #include "openvswitch/hmap.h"
 #include "uuid.h"
 
+struct ovn_unixctl_page;
+struct sliced_reply_class;
+
 struct conj_ids {
     /* Allocated conjunction ids. Contains struct conj_id_node. */
     struct hmap conj_id_allocations;
@@ -30,6 +33,9 @@ struct conj_ids {
     /* A map from lflow to the list of DPs this lflow belongs to. Contains
      * struct lflow_to_dps_node. */
     struct hmap lflow_to_dps;
+    /* Number of struct lflow_conj_node whose ids are released but not
+     * purged yet. */
+    size_t n_released;
 };
 
 uint32_t lflow_conj_ids_alloc(struct conj_ids *, const struct uuid *lflow_uuid,
@@ -39,12 +45,19 @@ bool lflow_conj_ids_alloc_specified(struct conj_ids *,
                                     const struct uuid *dp_uuid,
                                     uint32_t start_conj_id, uint32_t n_conjs);
 void lflow_conj_ids_free(struct conj_ids *, const struct uuid *lflow_uuid);
+void lflow_conj_ids_release_all(struct conj_ids *);
+void lflow_conj_ids_purge_released(struct conj_ids *);
 uint32_t lflow_conj_ids_find(struct conj_ids *, const struct uuid *lflow_uuid,
                              const struct uuid *dp_uuid);
+bool lflow_conj_ids_is_allocated_to(const struct conj_ids *, uint32_t conj_id,
+                                    const struct uuid *lflow_uuid);
 void lflow_conj_ids_init(struct conj_ids *);
 void lflow_conj_ids_destroy(struct conj_ids *);
 void lflow_conj_ids_clear(struct conj_ids *);
-void lflow_conj_ids_dump(struct conj_ids *, struct ds *out_data);
+void lflow_conj_ids_dump(struct conj_ids *, const struct ovn_unixctl_page *,
+                         struct ds *out_data);
 void lflow_conj_ids_set_test_mode(bool);
 
+extern const struct sliced_reply_class lflow_conj_ids_dump_class;
+
 #endif /* controller/lflow-conj-ids.h */
@@ -18,44 +18,429 @@
 #include "lflow.h"
 #include "coverage.h"
 #include "ha-chassis.h"
+#include "hash.h"
+#include "hmapx.h"
+#include "if-status.h"
 #include "lb.h"
 #include "lflow-cache.h"
 #include "local_data.h"
 #include "lport.h"
+#include "mac-cache.h"
 #include "ofctrl.h"
 #include "openvswitch/dynamic-string.h"
 #include "openvswitch/ofp-actions.h"
 #include "openvswitch/ofpbuf.h"
+#include "openvswitch/usdt-probes.h"
 #include "openvswitch/vlog.h"
 #include "ovn-controller.h"
 #include "ovn/actions.h"
 #include "ovn/expr.h"
+#include "ovn/lex.h"
 #include "lib/lb.h"
 #include "lib/ovn-l7.h"
+#include "lib/ovn-parallel-hmap.h"
 #include "lib/ovn-sb-idl.h"
+#include "lib/ovn-util.h"
 #include "lib/extend-table.h"
 #include "lib/uuidset.h"
+#include "ovs-thread.h"
 #include "packets.h"
 #include "physical.h"
 #include "simap.h"
 #include "sset.h"
+#include "timeval.h"
+#include "uuid.h"
 
 VLOG_DEFINE_THIS_MODULE(lflow);
 
 COVERAGE_DEFINE(lflow_run);
 COVERAGE_DEFINE(consider_logical_flow);
+COVERAGE_DEFINE(lflow_over_budget);
+COVERAGE_DEFINE(lflow_deferred_datapath);
+COVERAGE_DEFINE(lflow_parameters_xlate);
+COVERAGE_DEFINE(lflow_dp_group_add_dps);
 
 /* Symbol table. */
 
 /* Contains "struct expr_symbol"s for fields supported by OVN lflows. */
 static struct shash symtab;
 
+/* Actions encoded by add_matches_to_flow_table(), shared by the logical flows
+ * and datapaths that have the same actions. */
+static struct ovnacts_encode_cache *ovnacts_cache;
+
 void
 lflow_init(void)
 {
     ovn_init_symtab(&symtab);
+    ovnacts_cache = ovnacts_encode_cache_create();
+}
+
+/* Clears the cache of encoded actions.  Must be called when the DHCP options
+ * that actions are parsed with change. */
+void
+lflow_clear_encode_cache(void)
+{
+    ovnacts_encode_cache_clear(ovnacts_cache);
+}
+
+/* Returns a hash of everything in the symbol table that the translation of
+ * logical flow matches depends on, so that the lflow cache saved by a
+ * different version of ovn-controller is only reused if it is compatible. */
+static uint32_t
+lflow_symtab_fingerprint(void)
+{
+    const struct shash_node **nodes = shash_sort(&symtab);
+    struct ds s = DS_EMPTY_INITIALIZER;
+    uint32_t hash = 0;
+
+    for (size_t i = 0; i < shash_count(&symtab); i++) {
+        const struct expr_symbol *symbol = nodes[i]->data;
+
+        ds_clear(&s);
+        expr_symbol_format(symbol, &s);
+        ds_put_format(&s, " width=%d level=%d prereqs=%s%s", symbol->width,
+                      symbol->level, symbol->prereqs ? symbol->prereqs : "",
+                      symbol->must_crossproduct ? " must_crossproduct" : "");
+        hash = hash_string(ds_cstr(&s), hash);
+    }
+    ds_destroy(&s);
+    free(nodes);
+    return hash;
+}
+
+/* Saves the cached OpenFlow matches of 'lflow_cache' to 'file_name'. */
+void
+lflow_save_cache(const struct lflow_cache *lflow_cache,
+                 const char *file_name)
+{
+    lflow_cache_save(lflow_cache, file_name, lflow_symtab_fingerprint());
+}
+
+/* Loads the OpenFlow matches saved by lflow_save_cache() in a previous
+ * run into 'lflow_cache'.  They are reused by lflow_run() for the logical
+ * flows that didn't change in the meantime. */
+void
+lflow_load_cache(struct lflow_cache *lflow_cache, const char *file_name)
+{
+    lflow_cache_load(lflow_cache, file_name, lflow_symtab_fingerprint());
+}
+
+/* Returns a hash of the contents of 'lflow'. */
+static uint32_t
+lflow_content_hash(const struct sbrec_logical_flow *lflow)
+{
+    return hash_string(lflow->match, hash_string(lflow->actions, 0));
+}
+
+/* Adds to 'lflow_cache' the entry saved for 'lflow' by a previous run, if
+ * any and if 'lflow' didn't change since. */
+static void
+lflow_restore_cache_entry(const struct sbrec_logical_flow *lflow,
+                          struct lflow_cache *lflow_cache)
+{
+    if (lflow_cache_has_saved(lflow_cache)
+        && !lflow_cache_contains(lflow_cache, &lflow->header_.uuid)) {
+        lflow_cache_restore(lflow_cache, &lflow->header_.uuid,
+                            lflow_content_hash(lflow));
+    }
 }
 
+/* Maximum number of flows that a logical flow may generate for a datapath
+ * before it is translated again with expr_normalize_conjunctive(), 0 for no
+ * limit.  See lflow_set_flow_budget(). */
+static unsigned int lflow_flow_budget = 0;
+
+/* Logical flows translated with expr_normalize_conjunctive() for at least
+ * one datapath, whose flows don't necessarily map to the addresses of the
+ * address sets that they refer to. */
+static struct uuidset lflows_over_budget =
+    UUIDSET_INITIALIZER(&lflows_over_budget);
+
+/* Sets the flow budget of the logical flows to 'budget', 0 for no limit.
+ * Returns true if it changed, in which case the logical flows must be
+ * translated again. */
+bool
+lflow_set_flow_budget(unsigned int budget)
+{
+    if (budget == lflow_flow_budget) {
+        return false;
+    }
+    lflow_flow_budget = budget;
+    return true;
+}
+
+static void
+lflow_over_budget_remove(const struct uuid *lflow_uuid)
+{
+    struct uuidset_node *node = uuidset_find(&lflows_over_budget,
+                                             lflow_uuid);
+    if (node) {
+        uuidset_delete(&lflows_over_budget, node);
+    }
+}
+
+/* Datapaths of a datapath group as of the last time that the logical flows
+ * that use it were translated, so that only the datapaths added to it need
+ * to be considered when it changes, see lflow_handle_changed_dp_groups(). */
+struct dp_group_members {
+    struct hmap_node hmap_node;  /* In 'dp_groups_members', by 'uuid'. */
+    struct uuid uuid;            /* Logical_DP_Group. */
+    struct uuid *dps;            /* Datapath_Binding UUIDs, sorted. */
+    size_t n_dps;
+};
+
+static struct hmap dp_groups_members = HMAP_INITIALIZER(&dp_groups_members);
+
+static struct dp_group_members *
+dp_group_members_find(const struct uuid *dpg_uuid)
+{
+    struct dp_group_members *members;
+    HMAP_FOR_EACH_WITH_HASH (members, hmap_node, uuid_hash(dpg_uuid),
+                             &dp_groups_members) {
+        if (uuid_equals(&members->uuid, dpg_uuid)) {
+            return members;
+        }
+    }
+    return NULL;
+}
+
+static int
+compare_datapath_uuids(const void *a_, const void *b_)
+{
+    const struct sbrec_datapath_binding *const *a = a_;
+    const struct sbrec_datapath_binding *const *b = b_;
+
+    return uuid_compare_3way(&(*a)->header_.uuid, &(*b)->header_.uuid);
+}
+
+/* Returns the datapaths of 'dpg' sorted by UUID, to be freed by the
+ * caller. */
+static const struct sbrec_datapath_binding **
+dp_group_sorted_dps(const struct sbrec_logical_dp_group *dpg)
+{
+    const struct sbrec_datapath_binding **dps =
+        xmemdup(dpg->datapaths, dpg->n_datapaths * sizeof *dps);
+    qsort(dps, dpg->n_datapaths, sizeof *dps, compare_datapath_uuids);
+    return dps;
+}
+
+/* Sets the members of 'dpg' to its current datapaths, 'sorted_dps' if
+ * nonnull. */
+static void
+dp_group_members_set(const struct sbrec_logical_dp_group *dpg,
+                     const struct sbrec_datapath_binding **sorted_dps)
+{
+    struct dp_group_members *members =
+        dp_group_members_find(&dpg->header_.uuid);
+    if (!members) {
+        members = xzalloc(sizeof *members);
+        members->uuid = dpg->header_.uuid;
+        hmap_insert(&dp_groups_members, &members->hmap_node,
+                    uuid_hash(&dpg->header_.uuid));
+    }
+
+    const struct sbrec_datapath_binding **dps =
+        sorted_dps ? sorted_dps : dp_group_sorted_dps(dpg);
+    members->dps = xrealloc(members->dps,
+                            dpg->n_datapaths * sizeof *members->dps);
+    members->n_dps = dpg->n_datapaths;
+    for (size_t i = 0; i < dpg->n_datapaths; i++) {
+        members->dps[i] = dps[i]->header_.uuid;
+    }
+    if (!sorted_dps) {
+        free(dps);
+    }
+}
+
+static void
+dp_group_members_destroy(struct dp_group_members *members)
+{
+    hmap_remove(&dp_groups_members, &members->hmap_node);
+    free(members->dps);
+    free(members);
+}
+
+static void
+dp_groups_members_clear(void)
+{
+    struct dp_group_members *members;
+    HMAP_FOR_EACH_SAFE (members, hmap_node, &dp_groups_members) {
+        dp_group_members_destroy(members);
+    }
+}
+
+/* Returns true if 'lflow' is only tracked because the datapaths of its
+ * datapath group changed, see lflow_handle_changed_dp_groups(). */
+static bool
+lflow_only_dp_group_changed(const struct sbrec_logical_flow *lflow)
+{
+    const struct sbrec_logical_dp_group *dpg = lflow->logical_dp_group;
+
+    if (!dpg || sbrec_logical_flow_is_new(lflow)
+        || sbrec_logical_flow_is_deleted(lflow)
+        || sbrec_logical_dp_group_is_new(dpg)
+        || !sbrec_logical_dp_group_is_updated(
+                dpg, SBREC_LOGICAL_DP_GROUP_COL_DATAPATHS)
+        || !dp_group_members_find(&dpg->header_.uuid)) {
+        return false;
+    }
+    for (size_t i = 0; i < SBREC_LOGICAL_FLOW_N_COLUMNS; i++) {
+        if (sbrec_logical_flow_is_updated(lflow, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Cost of the translation of a logical flow, see lflow_cost_enable(). */
+struct lflow_cost {
+    struct hmap_node hmap_node;  /* In 'lflow_costs', by 'uuid'. */
+    struct uuid uuid;            /* Logical flow. */
+    uint64_t usec;               /* Time spent translating it. */
+    uint64_t n_xlates;           /* Number of translations, per datapath. */
+
+    /* Generated by the translations since the flows of the logical flow were
+     * last removed. */
+    size_t n_flows;              /* OpenFlow flows. */
+    size_t n_bytes;              /* Memory used by the matches and actions. */
+};
+
+static bool lflow_cost_enabled = false;
+static struct hmap lflow_costs = HMAP_INITIALIZER(&lflow_costs);
+
+static void
+lflow_cost_clear(void)
+{
+    struct lflow_cost *cost;
+    HMAP_FOR_EACH_POP (cost, hmap_node, &lflow_costs) {
+        free(cost);
+    }
+}
+
+/* Enables or disables the tracking of the cost of the translation of each
+ * logical flow.  Disabling it discards the costs tracked so far. */
+void
+lflow_cost_enable(bool enable)
+{
+    lflow_cost_enabled = enable;
+    if (!enable) {
+        lflow_cost_clear();
+    }
+}
+
+static struct lflow_cost *
+lflow_cost_find(const struct uuid *lflow_uuid)
+{
+    struct lflow_cost *cost;
+    HMAP_FOR_EACH_WITH_HASH (cost, hmap_node, uuid_hash(lflow_uuid),
+                             &lflow_costs) {
+        if (uuid_equals(&cost->uuid, lflow_uuid)) {
+            return cost;
+        }
+    }
+    return NULL;
+}
+
+static void
+lflow_cost_record(const struct sbrec_logical_flow *lflow, uint64_t usec,
+                  size_t n_flows, size_t n_bytes)
+{
+    struct lflow_cost *cost = lflow_cost_find(&lflow->header_.uuid);
+    if (!cost) {
+        cost = xzalloc(sizeof *cost);
+        cost->uuid = lflow->header_.uuid;
+        hmap_insert(&lflow_costs, &cost->hmap_node,
+                    uuid_hash(&lflow->header_.uuid));
+    }
+    cost->usec += usec;
+    cost->n_xlates++;
+    cost->n_flows += n_flows;
+    cost->n_bytes += n_bytes;
+}
+
+/* Forgets the flows generated for the logical flow 'lflow_uuid', which were
+ * removed, and all of its costs if it was deleted. */
+static void
+lflow_cost_remove_flows(const struct uuid *lflow_uuid, bool deleted)
+{
+    struct lflow_cost *cost = lflow_cost_find(lflow_uuid);
+    if (cost) {
+        if (deleted) {
+            hmap_remove(&lflow_costs, &cost->hmap_node);
+            free(cost);
+        } else {
+            cost->n_flows = 0;
+            cost->n_bytes = 0;
+        }
+    }
+}
+
+static int
+lflow_cost_cmp(const void *a_, const void *b_)
+{
+    const struct lflow_cost *const *a = a_;
+    const struct lflow_cost *const *b = b_;
+
+    if ((*a)->usec != (*b)->usec) {
+        return (*a)->usec > (*b)->usec ? -1 : 1;
+    }
+    return uuid_compare_3way(&(*a)->uuid, &(*b)->uuid);
+}
+
+/* Appends to 'ds' the 'n' logical flows of 'lflow_table' whose translation
+ * took the most time, since the tracking of costs was enabled, with the
+ * northd stage that generated them. */
+void
+lflow_cost_format(const struct sbrec_logical_flow_table *lflow_table,
+                  size_t n, struct ds *ds)
+{
+    if (!lflow_cost_enabled) {
+        ds_put_cstr(ds, "Tracking of logical flow costs is disabled.\n");
+        return;
+    }
+
+    const struct lflow_cost **costs = xmalloc(hmap_count(&lflow_costs)
+                                              * sizeof *costs);
+    size_t n_costs = 0;
+
+    struct lflow_cost *cost;
+    HMAP_FOR_EACH_SAFE (cost, hmap_node, &lflow_costs) {
+        if (!sbrec_logical_flow_table_get_for_uuid(lflow_table,
+                                                   &cost->uuid)) {
+            /* Deleted while its flows were recomputed. */
+            hmap_remove(&lflow_costs, &cost->hmap_node);
+            free(cost);
+            continue;
+        }
+        costs[n_costs++] = cost;
+    }
+    qsort(costs, n_costs, sizeof *costs, lflow_cost_cmp);
+
+    for (size_t i = 0; i < MIN(n, n_costs); i++) {
+        const struct sbrec_logical_flow *lflow =
+            sbrec_logical_flow_table_get_for_uuid(lflow_table,
+                                                  &costs[i]->uuid);
+        const char *stage_name = smap_get_def(&lflow->external_ids,
+                                              "stage-name", "");
+        const char *stage_hint = smap_get(&lflow->external_ids,
+                                          "stage-hint");
+
+        ds_put_format(ds, UUID_FMT": usec=%"PRIu64" xlates=%"PRIu64
+                      " flows=%"PRIuSIZE" bytes=%"PRIuSIZE
+                      " pipeline=%s table=%"PRId64" stage=%s",
+                      UUID_ARGS(&costs[i]->uuid), costs[i]->usec,
+                      costs[i]->n_xlates, costs[i]->n_flows,
+                      costs[i]->n_bytes, lflow->pipeline, lflow->table_id,
+                      stage_name);
+        if (stage_hint) {
+            ds_put_format(ds, " stage-hint=%s", stage_hint);
+        }
+        ds_put_char(ds, '\n');
+    }
+    free(costs);
+}
+
 struct lookup_port_aux {
     struct ovsdb_idl_index *sbrec_multicast_group_by_name_datapath;
     struct ovsdb_idl_index *sbrec_port_binding_by_name;
@@ -84,11 +469,12 @@ convert_match_to_expr(const struct sbrec_logical_flow *,
                       const struct smap *template_vars,
                       struct sset *template_vars_ref,
                       struct objdep_mgr *, bool *pg_addr_set_ref);
-static void
+static size_t
 add_matches_to_flow_table(const struct sbrec_logical_flow *,
                           const struct local_datapath *,
                           struct hmap *matches, uint8_t ptable,
                           uint8_t output_ptable, struct ofpbuf *ovnacts,
+                          const struct sset *template_vars_ref,
                           bool ingress, struct lflow_ctx_in *,
                           struct lflow_ctx_out *);
 static void
@@ -96,11 +482,14 @@ consider_logical_flow(const struct sbrec_logical_flow *lflow,
                       bool is_recompute,
                       struct lflow_ctx_in *l_ctx_in,
                       struct lflow_ctx_out *l_ctx_out);
+static void lflow_reprocess(struct uuidset *lflows, struct lflow_ctx_in *,
+                            struct lflow_ctx_out *);
 
 static void
 consider_lb_hairpin_flows(const struct ovn_controller_lb *lb,
                           const struct hmap *local_datapaths,
                           bool use_ct_mark,
+                          struct conj_ids *conj_ids,
                           struct ovn_desired_flow_table *flow_table);
 
 static void add_port_sec_flows(const struct shash *binding_lports,
@@ -204,17 +593,6 @@ is_chassis_resident_cb(const void *c_aux_, const char *port_name)
     }
 }
 
-/* Adds the logical flows from the Logical_Flow table to flow tables. */
-static void
-add_logical_flows(struct lflow_ctx_in *l_ctx_in,
-                  struct lflow_ctx_out *l_ctx_out)
-{
-    const struct sbrec_logical_flow *lflow;
-    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
-        consider_logical_flow(lflow, true, l_ctx_in, l_ctx_out);
-    }
-}
-
 bool
 lflow_handle_changed_flows(struct lflow_ctx_in *l_ctx_in,
                            struct lflow_ctx_out *l_ctx_out)
@@ -234,6 +612,11 @@ lflow_handle_changed_flows(struct lflow_ctx_in *l_ctx_in,
                      UUID_ARGS(&lflow->header_.uuid));
             continue;
         }
+        if (lflow_only_dp_group_changed(lflow)) {
+            /* Only the datapaths added to or removed from the group need to
+             * be handled, see lflow_handle_changed_dp_groups(). */
+            continue;
+        }
         VLOG_DBG("delete lflow "UUID_FMT, UUID_ARGS(&lflow->header_.uuid));
         uuidset_insert(&flood_remove_nodes, &lflow->header_.uuid);
         if (!sbrec_logical_flow_is_new(lflow)) {
@@ -254,6 +637,10 @@ lflow_handle_changed_flows(struct lflow_ctx_in *l_ctx_in,
         /* Reprocessing the lflow if the sb record is not deleted. */
         lflow = sbrec_logical_flow_table_get_for_uuid(
             l_ctx_in->logical_flow_table, &ofrn->uuid);
+        lflow_over_budget_remove(&ofrn->uuid);
+        if (lflow_cost_enabled) {
+            lflow_cost_remove_flows(&ofrn->uuid, !lflow);
+        }
         if (lflow) {
             VLOG_DBG("re-add lflow "UUID_FMT,
                      UUID_ARGS(&lflow->header_.uuid));
@@ -305,6 +692,36 @@ as_info_from_expr_const(const char *as_name, const struct expr_constant *c,
     return true;
 }
 
+/* Port groups are tracked like address sets, by the port keys of the ports,
+ * see expr_port_to_as_ip().  Returns false if the port 'port_name' of the
+ * port group 'pg_name' isn't known. */
+static bool
+as_info_from_pg_port(const char *pg_name, const char *port_name,
+                     const struct lflow_ctx_in *l_ctx_in,
+                     struct addrset_info *as_info)
+{
+    const struct sbrec_port_binding *pb
+        = lport_lookup_by_name(l_ctx_in->sbrec_port_binding_by_name,
+                               port_name);
+    if (!pb) {
+        return false;
+    }
+    as_info->name = pg_name;
+    expr_port_to_as_ip(pb->tunnel_key, &as_info->ip, &as_info->mask);
+    return true;
+}
+
+/* Port groups in the SB are specific to a datapath, see
+ * get_sb_port_group_name(). */
+static bool
+port_group_is_on_datapath(const char *pg_name,
+                          const struct sbrec_datapath_binding *dp)
+{
+    char prefix[32];
+    int n = snprintf(prefix, sizeof prefix, "%"PRId64"_", dp->tunnel_key);
+    return !strncmp(pg_name, prefix, n);
+}
+
 static void
 store_lflow_template_refs(struct objdep_mgr *lflow_deps_mgr,
                           const struct sset *template_vars_ref,
@@ -353,9 +770,10 @@ lflow_parse_actions(const struct sbrec_logical_flow *lflow,
     return true;
 }
 
-/* Parses the lflow regarding the changed address set 'as_name', and generates
- * ovs flows for the newly added addresses in 'as_diff_added' only. It is
- * similar to consider_logical_flow__, with the below differences:
+/* Parses the lflow regarding the changed address set 'as_name', or the port
+ * group if 'port_group' is true, and generates ovs flows for the newly added
+ * addresses, or ports, in 'as_diff_added' only. It is similar to
+ * consider_logical_flow__, with the below differences:
  *
  * - It has one more arg 'as_ref_count' to deduce how many flows are expected
  *   to be added.
@@ -374,7 +792,7 @@ static bool
 consider_lflow_for_added_as_ips__(
                         const struct sbrec_logical_flow *lflow,
                         const struct sbrec_datapath_binding *dp,
-                        const char *as_name,
+                        const char *as_name, bool port_group,
                         size_t as_ref_count,
                         const struct expr_constant_set *as_diff_added,
                         struct lflow_ctx_in *l_ctx_in,
@@ -448,11 +866,21 @@ consider_lflow_for_added_as_ips__(
         new_fake_as = xzalloc(sizeof *new_fake_as);
         new_fake_as->values = xzalloc(sizeof *new_fake_as->values * 2);
         new_fake_as->n_values = 2;
-        new_fake_as->values[0] = new_fake_as->values[1] =
-            as_diff_added->values[0];
-        /* Make a dummy ip that is different from the real one. */
-        new_fake_as->values[1].value.u8_val++;
-        dummy_ip = new_fake_as->values[1].value.ipv6;
+        new_fake_as->type = as_diff_added->type;
+        if (port_group) {
+            /* "none" is always port 0, which no real port has. */
+            struct in6_addr dummy_mask;
+            new_fake_as->values[0].string =
+                xstrdup(as_diff_added->values[0].string);
+            new_fake_as->values[1].string = xstrdup("none");
+            expr_port_to_as_ip(0, &dummy_ip, &dummy_mask);
+        } else {
+            new_fake_as->values[0] = new_fake_as->values[1] =
+                as_diff_added->values[0];
+            /* Make a dummy ip that is different from the real one. */
+            new_fake_as->values[1].value.u8_val++;
+            dummy_ip = new_fake_as->values[1].value.ipv6;
+        }
         has_dummy_ip = true;
         fake_as = new_fake_as;
     }
@@ -468,8 +896,10 @@ consider_lflow_for_added_as_ips__(
      * XXX: if necessary, we can optimize this by checking all the address set
      * references in this lflow, and replace all the "big" address sets with a
      * small faked one. */
-    struct expr_constant_set *real_as =
-        shash_replace((struct shash *)l_ctx_in->addr_sets, as_name, fake_as);
+    struct shash *sets = CONST_CAST(struct shash *,
+                                    port_group ? l_ctx_in->port_groups
+                                               : l_ctx_in->addr_sets);
+    struct expr_constant_set *real_as = shash_replace(sets, as_name, fake_as);
     /* We are here because of the address set update, so it must be found. */
     ovs_assert(real_as);
 
@@ -479,7 +909,7 @@ consider_lflow_for_added_as_ips__(
                                               l_ctx_in->template_vars,
                                               &template_vars_ref,
                                               l_ctx_out->lflow_deps_mgr, NULL);
-    shash_replace((struct shash *)l_ctx_in->addr_sets, as_name, real_as);
+    shash_replace(sets, as_name, real_as);
     if (new_fake_as) {
         expr_constant_set_destroy(new_fake_as);
         free(new_fake_as);
@@ -520,11 +950,12 @@ consider_lflow_for_added_as_ips__(
      * as_diff_added. So we need to fall back to reprocessing the lflow.
      */
     if (hmap_count(&matches) != as_ref_count * as_diff_added->n_values) {
-        VLOG_DBG("lflow "UUID_FMT", addrset %s: Generated flows count "
+        VLOG_DBG("lflow "UUID_FMT", %s %s: Generated flows count "
                  "(%"PRIuSIZE") " "doesn't match added addresses count "
                  "(%"PRIuSIZE") and ref_count (%"PRIuSIZE"). "
                  "Need reprocessing.",
-                 UUID_ARGS(&lflow->header_.uuid), as_name,
+                 UUID_ARGS(&lflow->header_.uuid),
+                 port_group ? "port group" : "addrset", as_name,
                  hmap_count(&matches), as_diff_added->n_values, as_ref_count);
         handled = false;
         goto done;
@@ -542,7 +973,8 @@ consider_lflow_for_added_as_ips__(
         expr_matches_prepare(&matches, start_conj_id - 1);
     }
     add_matches_to_flow_table(lflow, ldp, &matches, ptable, output_ptable,
-                              &ovnacts, ingress, l_ctx_in, l_ctx_out);
+                              &ovnacts, &template_vars_ref, ingress,
+                              l_ctx_in, l_ctx_out);
 done:
     expr_destroy(prereqs);
     ovnacts_free(ovnacts.data, ovnacts.size);
@@ -560,7 +992,7 @@ done:
 static bool
 consider_lflow_for_added_as_ips(
                         const struct sbrec_logical_flow *lflow,
-                        const char *as_name,
+                        const char *as_name, bool port_group,
                         size_t as_ref_count,
                         const struct expr_constant_set *as_diff_added,
                         struct lflow_ctx_in *l_ctx_in,
@@ -578,12 +1010,18 @@ consider_lflow_for_added_as_ips(
 
     if (dp) {
         return consider_lflow_for_added_as_ips__(lflow, dp, as_name,
-                                                 as_ref_count, as_diff_added,
-                                                 l_ctx_in, l_ctx_out);
+                                                 port_group, as_ref_count,
+                                                 as_diff_added, l_ctx_in,
+                                                 l_ctx_out);
     }
     for (size_t i = 0; dp_group && i < dp_group->n_datapaths; i++) {
-        if (!consider_lflow_for_added_as_ips__(lflow, dp_group->datapaths[i],
-                                               as_name, as_ref_count,
+        dp = dp_group->datapaths[i];
+        if (port_group && !port_group_is_on_datapath(as_name, dp)) {
+            /* The lflow refers to another port group on this datapath. */
+            continue;
+        }
+        if (!consider_lflow_for_added_as_ips__(lflow, dp, as_name,
+                                               port_group, as_ref_count,
                                                as_diff_added, l_ctx_in,
                                                l_ctx_out)) {
             return false;
@@ -592,14 +1030,13 @@ consider_lflow_for_added_as_ips(
     return true;
 }
 
-/* Check if an address set update can be handled without reprocessing the
- * lflow. */
+/* Check if an address set, or port group, update can be handled without
+ * reprocessing the lflow. */
 static bool
 as_update_can_be_handled(const char *as_name, struct addr_set_diff *as_diff,
-                         struct lflow_ctx_in *l_ctx_in)
+                         const struct shash *sets)
 {
-    struct expr_constant_set *as = shash_find_data(l_ctx_in->addr_sets,
-                                                   as_name);
+    struct expr_constant_set *as = shash_find_data(sets, as_name);
     ovs_assert(as);
     size_t n_added = as_diff->added ? as_diff->added->n_values : 0;
     size_t n_deleted = as_diff->deleted ? as_diff->deleted->n_values : 0;
@@ -611,73 +1048,35 @@ as_update_can_be_handled(const char *as_name, struct addr_set_diff *as_diff,
         return false;
     }
 
-    /* If the size of the diff is too big, reprocessing may be more
-     * efficient than incrementally processing the diffs.  */
-    if ((n_added + n_deleted) >= as->n_values) {
+    /* If all the addresses are new, reprocessing is as expensive as parsing
+     * the added addresses.  Deleted addresses are not considered, removing
+     * their flows is cheaper than removing and adding back all the flows of
+     * the lflow, including the ones that don't depend on the address set. */
+    if (n_added >= as->n_values) {
         return false;
     }
 
     return true;
 }
 
-/* Handles address set update incrementally - processes only the diff
- * (added/deleted) addresses in the address set. If it cannot handle the update
- * incrementally, returns false, so that the caller will trigger reprocessing
- * for the lflow.
- *
- * The reasons that the function returns false are:
- *
- * - The size of the address set changed to/from 0 or 1, which means the
- *   'template' of the lflow translation is changed. In this case reprocessing
- *   doesn't impact performance because the size of the address set is already
- *   very small.
- *
- * - The size of the change is equal or bigger than the new size. In this case
- *   it doesn't make sense to incrementally processing the changes because
- *   reprocessing can be faster.
- *
- * - When the address set information couldn't be properly tracked during lflow
- *   parsing. The typical cases are:
- *
- *      - The relational operator to the address set is not '=='. In this case
- *        there is no 1-1 mapping between the addresses and the flows
- *        generated.
- *
- *      - The sub expression of the address set is combined with other sub-
- *        expressions/constants on different fields, e.g.:
- *
- *          ip.src == $as1 || ip.dst == $as2
- *
- *        This could have been split into separate lflows.
- *
- *      - Conjunctions overlapping between lflows, which can be caused by
- *        overlapping address sets or same address set used by multiple lflows
- *        that could have been combined. e.g.:
- *
- *          lflow1: ip.src == $as1 && tcp.dst == {p1, p2}
- *          lflow2: ip.src == $as1 && tcp.dst == {p3, p4}
- *
- *        It could have been combined as:
- *
- *          ip.src == $as1 && tcp.dst == {p1, p2, p3, p4}
- *
- *        Note: addresses additions still can be processed incrementally in
- *        this case, although deletions cannot.
- */
-bool
-lflow_handle_addr_set_update(const char *as_name,
-                             struct addr_set_diff *as_diff,
-                             struct lflow_ctx_in *l_ctx_in,
-                             struct lflow_ctx_out *l_ctx_out,
-                             bool *changed)
+static bool
+lflow_handle_set_update(const char *as_name, bool port_group,
+                        struct addr_set_diff *as_diff,
+                        struct lflow_ctx_in *l_ctx_in,
+                        struct lflow_ctx_out *l_ctx_out,
+                        bool *changed)
 {
     ovs_assert(as_diff->added || as_diff->deleted);
-    if (!as_update_can_be_handled(as_name, as_diff, l_ctx_in)) {
+    if (!as_update_can_be_handled(as_name, as_diff,
+                                  port_group ? l_ctx_in->port_groups
+                                             : l_ctx_in->addr_sets)) {
         return false;
     }
 
     struct resource_to_objects_node *resource_node =
-        objdep_mgr_find_objs(l_ctx_out->lflow_deps_mgr, OBJDEP_TYPE_ADDRSET,
+        objdep_mgr_find_objs(l_ctx_out->lflow_deps_mgr,
+                             port_group ? OBJDEP_TYPE_PORTGROUP
+                                        : OBJDEP_TYPE_ADDRSET,
                              as_name);
     if (!resource_node) {
         *changed = false;
@@ -686,10 +1085,12 @@ lflow_handle_addr_set_update(const char *as_name,
 
     *changed = false;
 
+    struct uuidset reprocess = UUIDSET_INITIALIZER(&reprocess);
     bool ret = true;
-    struct object_to_resources_list_node *resource_list_node;
-    RESOURCE_FOR_EACH_OBJ (resource_list_node, resource_node) {
-        const struct uuid *obj_uuid = &resource_list_node->obj_uuid;
+    struct objdep_ref *ref;
+    RESOURCE_FOR_EACH_OBJ (ref, resource_node) {
+        const struct uuid *obj_uuid =
+            objdep_mgr_ref_obj_uuid(l_ctx_out->lflow_deps_mgr, ref);
         if (uuidset_find(l_ctx_out->objs_processed, obj_uuid)) {
             VLOG_DBG("lflow "UUID_FMT"has been processed, skip.",
                      UUID_ARGS(obj_uuid));
@@ -702,22 +1103,37 @@ lflow_handle_addr_set_update(const char *as_name,
             /* lflow deletion should be handled in the corresponding input
              * handler, so we can skip here. */
             VLOG_DBG("lflow "UUID_FMT" not found while handling updates of "
-                     "address set %s, skip.",
-                     UUID_ARGS(obj_uuid), as_name);
+                     "%s %s, skip.", UUID_ARGS(obj_uuid),
+                     port_group ? "port group" : "address set", as_name);
             continue;
         }
         *changed = true;
 
+        if (lflow->n_parameters
+            || uuidset_find(&lflows_over_budget, obj_uuid)) {
+            /* Its flows may not map to the addresses, see
+             * lflow_xlate_matches(), or there are flows for each of its
+             * tuples of parameters. */
+            uuidset_insert(&reprocess, obj_uuid);
+            continue;
+        }
+
         if (as_diff->deleted) {
             struct addrset_info as_info;
             for (size_t i = 0; i < as_diff->deleted->n_values; i++) {
                 struct expr_constant *c = &as_diff->deleted->values[i];
-                if (!as_info_from_expr_const(as_name, c, &as_info)) {
+                if (port_group) {
+                    if (!as_info_from_pg_port(as_name, c->string, l_ctx_in,
+                                              &as_info)) {
+                        ret = false;
+                        goto done;
+                    }
+                } else if (!as_info_from_expr_const(as_name, c, &as_info)) {
                     continue;
                 }
                 if (!ofctrl_remove_flows_for_as_ip(
                         l_ctx_out->flow_table, obj_uuid, &as_info,
-                        resource_list_node->ref_count)) {
+                        ref->ref_count, l_ctx_out->conj_ids)) {
                     ret = false;
                     goto done;
                 }
@@ -725,8 +1141,8 @@ lflow_handle_addr_set_update(const char *as_name,
         }
 
         if (as_diff->added) {
-            if (!consider_lflow_for_added_as_ips(lflow, as_name,
-                                                 resource_list_node->ref_count,
+            if (!consider_lflow_for_added_as_ips(lflow, as_name, port_group,
+                                                 ref->ref_count,
                                                  as_diff->added,
                                                  l_ctx_in, l_ctx_out)) {
                 ret = false;
@@ -735,47 +1151,108 @@ lflow_handle_addr_set_update(const char *as_name,
         }
     }
 
+    if (!uuidset_is_empty(&reprocess)) {
+        lflow_reprocess(&reprocess, l_ctx_in, l_ctx_out);
+    }
+
 done:
+    uuidset_destroy(&reprocess);
     return ret;
 }
 
+/* Handles address set update incrementally - processes only the diff
+ * (added/deleted) addresses in the address set. If it cannot handle the update
+ * incrementally, returns false, so that the caller will trigger reprocessing
+ * for the lflow.
+ *
+ * The reasons that the function returns false are:
+ *
+ * - The size of the address set changed to/from 0 or 1, which means the
+ *   'template' of the lflow translation is changed. In this case reprocessing
+ *   doesn't impact performance because the size of the address set is already
+ *   very small.
+ *
+ * - All the addresses of the address set are new. In this case it doesn't
+ *   make sense to incrementally processing the changes because reprocessing
+ *   can be faster.
+ *
+ * - When the address set information couldn't be properly tracked during lflow
+ *   parsing. The typical cases are:
+ *
+ *      - The relational operator to the address set is not '=='. In this case
+ *        there is no 1-1 mapping between the addresses and the flows
+ *        generated.
+ *
+ *      - The sub expression of the address set is combined with other sub-
+ *        expressions/constants on different fields, e.g.:
+ *
+ *          ip.src == $as1 || ip.dst == $as2
+ *
+ *        This could have been split into separate lflows.
+ *
+ *      - The lflow generates the same conjunctive flow more than once, which
+ *        then can't be mapped to a single address of the address set.
+ *
+ * Conjunctions overlapping between lflows, which can be caused by overlapping
+ * address sets or same address set used by multiple lflows, are handled
+ * incrementally: on deletion, only the conjunctions of the lflow are removed
+ * from the shared flows, e.g. for 10.0.0.1 in both $as1 and $as2:
+ *
+ *     lflow1: ip.src == $as1 && tcp.dst == {p1, p2}
+ *     lflow2: ip.src == $as2 && tcp.dst == {p3, p4}
+ */
 bool
-lflow_handle_changed_ref(enum objdep_type type, const char *res_name,
-                         struct ovs_list *objs_todo,
-                         const void *in_arg, void *out_arg)
+lflow_handle_addr_set_update(const char *as_name,
+                             struct addr_set_diff *as_diff,
+                             struct lflow_ctx_in *l_ctx_in,
+                             struct lflow_ctx_out *l_ctx_out,
+                             bool *changed)
 {
-    struct lflow_ctx_in *l_ctx_in = CONST_CAST(struct lflow_ctx_in *, in_arg);
-    struct lflow_ctx_out *l_ctx_out = out_arg;
+    return lflow_handle_set_update(as_name, false, as_diff, l_ctx_in,
+                                   l_ctx_out, changed);
+}
 
-    /* Re-parse the related lflows. */
-    /* Firstly, flood remove the flows from desired flow table. */
-    struct object_to_resources_list_node *resource_list_node_uuid;
-    struct uuidset flood_remove_nodes =
-        UUIDSET_INITIALIZER(&flood_remove_nodes);
-    LIST_FOR_EACH_SAFE (resource_list_node_uuid, list_node, objs_todo) {
-        const struct uuid *obj_uuid = &resource_list_node_uuid->obj_uuid;
-        VLOG_DBG("Reprocess lflow "UUID_FMT" for resource type: %s,"
-                 " name: %s.",
-                 UUID_ARGS(obj_uuid), objdep_type_name(type), res_name);
-        uuidset_insert(&flood_remove_nodes, obj_uuid);
-        free(resource_list_node_uuid);
-    }
-    ofctrl_flood_remove_flows(l_ctx_out->flow_table, &flood_remove_nodes);
+/* Handles the update of the local ports of a port group incrementally, the
+ * same way as lflow_handle_addr_set_update(), each port being handled as an
+ * address made of its port key.  Returns false, so that the caller will
+ * trigger reprocessing for the lflows, in the same cases, or if a deleted
+ * port can't be found anymore. */
+bool
+lflow_handle_port_group_update(const char *pg_name,
+                               struct addr_set_diff *pg_diff,
+                               struct lflow_ctx_in *l_ctx_in,
+                               struct lflow_ctx_out *l_ctx_out,
+                               bool *changed)
+{
+    return lflow_handle_set_update(pg_name, true, pg_diff, l_ctx_in,
+                                   l_ctx_out, changed);
+}
 
-    /* Secondly, for each lflow that is actually removed, reprocessing it. */
+/* Removes the flows of the logical flows in 'lflows' from the desired flow
+ * table, along with the ones of the logical flows that share flows with
+ * them, which are added to 'lflows', and translates them again. */
+static void
+lflow_reprocess(struct uuidset *lflows, struct lflow_ctx_in *l_ctx_in,
+                struct lflow_ctx_out *l_ctx_out)
+{
+    ofctrl_flood_remove_flows(l_ctx_out->flow_table, lflows);
+
+    /* For each lflow that is actually removed, reprocessing it. */
     struct uuidset_node *ofrn;
-    UUIDSET_FOR_EACH (ofrn, &flood_remove_nodes) {
+    UUIDSET_FOR_EACH (ofrn, lflows) {
         objdep_mgr_remove_obj(l_ctx_out->lflow_deps_mgr, &ofrn->uuid);
         lflow_conj_ids_free(l_ctx_out->conj_ids, &ofrn->uuid);
+        lflow_over_budget_remove(&ofrn->uuid);
 
         const struct sbrec_logical_flow *lflow =
             sbrec_logical_flow_table_get_for_uuid(l_ctx_in->logical_flow_table,
                                                   &ofrn->uuid);
+        if (lflow_cost_enabled) {
+            lflow_cost_remove_flows(&ofrn->uuid, !lflow);
+        }
         if (!lflow) {
-            VLOG_DBG("lflow "UUID_FMT" not found while reprocessing for"
-                     " resource type: %s, name: %s.",
-                     UUID_ARGS(&ofrn->uuid),
-                     objdep_type_name(type), res_name);
+            VLOG_DBG("lflow "UUID_FMT" not found while reprocessing.",
+                     UUID_ARGS(&ofrn->uuid));
             continue;
         }
 
@@ -791,6 +1268,32 @@ lflow_handle_changed_ref(enum objdep_type type, const char *res_name,
 
         consider_logical_flow(lflow, false, l_ctx_in, l_ctx_out);
     }
+}
+
+bool
+lflow_handle_changed_ref(enum objdep_type type, const char *res_name,
+                         struct ovs_list *objs_todo,
+                         const void *in_arg, void *out_arg)
+{
+    struct lflow_ctx_in *l_ctx_in = CONST_CAST(struct lflow_ctx_in *, in_arg);
+    struct lflow_ctx_out *l_ctx_out = out_arg;
+
+    /* Re-parse the related lflows. */
+    /* Firstly, flood remove the flows from desired flow table. */
+    struct object_to_resources_list_node *resource_list_node_uuid;
+    struct uuidset flood_remove_nodes =
+        UUIDSET_INITIALIZER(&flood_remove_nodes);
+    LIST_FOR_EACH_SAFE (resource_list_node_uuid, list_node, objs_todo) {
+        const struct uuid *obj_uuid = &resource_list_node_uuid->obj_uuid;
+        VLOG_DBG("Reprocess lflow "UUID_FMT" for resource type: %s,"
+                 " name: %s.",
+                 UUID_ARGS(obj_uuid), objdep_type_name(type), res_name);
+        uuidset_insert(&flood_remove_nodes, obj_uuid);
+        free(resource_list_node_uuid);
+    }
+
+    /* Secondly, reprocess them. */
+    lflow_reprocess(&flood_remove_nodes, l_ctx_in, l_ctx_out);
     uuidset_destroy(&flood_remove_nodes);
     return true;
 }
@@ -833,11 +1336,14 @@ get_common_nat_zone(const struct local_datapath *ldp)
     }
 }
 
-static void
+/* Adds to the flow table the flows of 'lflow' for 'matches' in 'ldp' and
+ * returns how many were added. */
+static size_t
 add_matches_to_flow_table(const struct sbrec_logical_flow *lflow,
                           const struct local_datapath *ldp,
                           struct hmap *matches, uint8_t ptable,
                           uint8_t output_ptable, struct ofpbuf *ovnacts,
+                          const struct sset *template_vars_ref,
                           bool ingress, struct lflow_ctx_in *l_ctx_in,
                           struct lflow_ctx_out *l_ctx_out)
 {
@@ -890,8 +1396,15 @@ add_matches_to_flow_table(const struct sbrec_logical_flow *lflow,
         .ctrl_meter_id = ctrl_meter_id,
         .common_nat_ct_zone = get_common_nat_zone(ldp),
     };
-    ovnacts_encode(ovnacts->data, ovnacts->size, &ep, &ofpacts);
-
+    /* Actions that use template variables may expand differently for other
+     * logical flows, so they can't be looked up by their string. */
+    const struct ofpbuf *encoded =
+        ovnacts_encode_cached(sset_is_empty(template_vars_ref)
+                              ? ovnacts_cache : NULL,
+                              lflow->actions, lflow->table_id,
+                              ovnacts->data, ovnacts->size, &ep, &ofpacts);
+
+    size_t n_flows = 0;
     struct expr_match *m;
     HMAP_FOR_EACH (m, hmap_node, matches) {
         match_set_metadata(&m->match, htonll(ldp->datapath->tunnel_key));
@@ -922,7 +1435,7 @@ add_matches_to_flow_table(const struct sbrec_logical_flow *lflow,
             ofctrl_add_flow_metered(l_ctx_out->flow_table, ptable,
                                     lflow->priority,
                                     lflow->header_.uuid.parts[0], &m->match,
-                                    &ofpacts, &lflow->header_.uuid,
+                                    encoded, &lflow->header_.uuid,
                                     ctrl_meter_id,
                                     as_info.name ? &as_info : NULL);
         } else {
@@ -950,9 +1463,11 @@ add_matches_to_flow_table(const struct sbrec_logical_flow *lflow,
                                       as_info.name ? &as_info : NULL);
             ofpbuf_uninit(&conj);
         }
+        n_flows++;
     }
 
     ofpbuf_uninit(&ofpacts);
+    return n_flows;
 }
 
 /* Converts the match and returns the simplified expr tree.
@@ -1024,24 +1539,257 @@ convert_match_to_expr(const struct sbrec_logical_flow *lflow,
     return expr_simplify(e);
 }
 
-static void
-consider_logical_flow__(const struct sbrec_logical_flow *lflow,
-                        const struct sbrec_datapath_binding *dp,
-                        struct lflow_ctx_in *l_ctx_in,
-                        struct lflow_ctx_out *l_ctx_out)
+/* Translation of a logical flow for one of its datapaths.
+ *
+ * It is done in two steps.  lflow_xlate_prepare() parses the actions and
+ * converts the match into OpenFlow matches, which is the expensive part, but
+ * only reads the SB database and the lflow_ctx_in, so it may run on worker
+ * threads.  lflow_xlate_commit() then allocates the conjunction ids, encodes
+ * the actions, adds the flows to the desired flow table and updates the lflow
+ * cache, from the main thread. */
+struct lflow_xlate {
+    const struct sbrec_logical_flow *lflow;
+    const struct sbrec_datapath_binding *dp;
+    const struct local_datapath *ldp;
+    bool prepared;              /* False if there is nothing to commit. */
+
+    bool ingress;
+    uint8_t ptable;
+    uint8_t output_ptable;
+
+    struct ofpbuf ovnacts;
+    struct expr *prereqs;
+    struct sset template_vars_ref;
+
+    enum lflow_cache_type lcv_type;
+    struct lflow_cache_value *lcv;
+
+    /* Key under which the translation may be shared with other logical
+     * flows in the lflow cache, see lflow_xlate_cache_key().  If 'lcv' is
+     * NULL but 'lcv_type' isn't LCACHE_T_NONE, the value cached for 'key' was
+     * used, and 'shared_lcv' points to it during lflow_xlate_prepare(). */
+    char *cache_key;
+    const struct lflow_cache_value *shared_lcv;
+
+    struct expr *expr;
+    struct expr *cached_expr;   /* To be cached by lflow_xlate_commit(). */
+    struct hmap *matches;       /* Owned, unless taken from 'lcv'. */
+    uint32_t n_conjs;
+    uint64_t cost;              /* Time to compute 'matches', in usec. */
+    uint64_t prepare_usec;      /* Only if 'lflow_cost_enabled'. */
+
+    /* Number of matches with expr_normalize(), if it exceeded the flow
+     * budget and 'matches' were computed with expr_normalize_conjunctive()
+     * instead, otherwise 0. */
+    size_t n_over_budget;
+};
+
+/* Local datapaths whose logical flows the current lflow_run() leaves out,
+ * see 'deferred_dps' in struct lflow_ctx_out.  Empty outside of
+ * lflow_run(). */
+static struct hmapx deferred_ldps = HMAPX_INITIALIZER(&deferred_ldps);
+
+/* Returns the local datapath for 'dp', or NULL if 'lflow' must be skipped for
+ * it because it's not local or its logical flows are deferred. */
+static const struct local_datapath *
+lflow_get_local_datapath(const struct sbrec_logical_flow *lflow,
+                         const struct sbrec_datapath_binding *dp,
+                         const struct lflow_ctx_in *l_ctx_in)
 {
-    struct local_datapath *ldp = get_local_datapath(l_ctx_in->local_datapaths,
-                                                    dp->tunnel_key);
+    const struct local_datapath *ldp =
+        get_local_datapath(l_ctx_in->local_datapaths, dp->tunnel_key);
     if (!ldp) {
         VLOG_DBG("Skip lflow "UUID_FMT" for non-local datapath %"PRId64,
                  UUID_ARGS(&lflow->header_.uuid), dp->tunnel_key);
-        return;
+    } else if (!hmapx_is_empty(&deferred_ldps)
+               && hmapx_contains(&deferred_ldps, ldp)) {
+        return NULL;
     }
+    return ldp;
+}
+
+static void
+lflow_xlate_init(struct lflow_xlate *x, const struct sbrec_logical_flow *lflow,
+                 const struct sbrec_datapath_binding *dp,
+                 const struct local_datapath *ldp)
+{
+    memset(x, 0, sizeof *x);
+    x->lflow = lflow;
+    x->dp = dp;
+    x->ldp = ldp;
+    ofpbuf_init(&x->ovnacts, 0);
+    sset_init(&x->template_vars_ref);
+    x->lcv_type = LCACHE_T_NONE;
+}
+
+static void
+lflow_xlate_destroy(struct lflow_xlate *x)
+{
+    expr_destroy(x->prereqs);
+    ovnacts_free(x->ovnacts.data, x->ovnacts.size);
+    ofpbuf_uninit(&x->ovnacts);
+    expr_destroy(x->expr);
+    expr_destroy(x->cached_expr);
+    expr_matches_destroy(x->matches);
+    free(x->matches);
+    free(x->cache_key);
+    sset_destroy(&x->template_vars_ref);
+}
+
+/* Returns true if the match of 'lflow' refers to template variables, in
+ * which case its translation depends on their current values. */
+static bool
+lflow_match_has_templates(const struct sbrec_logical_flow *lflow)
+{
+    return strchr(lflow->match, LEX_TEMPLATE_PREFIX) != NULL;
+}
+
+/* Returns the key of the translation of 'x' in the lflow cache.  It depends
+ * only on the match, with its template variables expanded, and on the
+ * prerequisites of the actions, which are part of the match expression.
+ * The template variables that the match refers to are added to
+ * 'x->template_vars_ref'. */
+static char *
+lflow_xlate_cache_key(struct lflow_xlate *x, const struct smap *template_vars)
+{
+    struct ds key = DS_EMPTY_INITIALIZER;
+
+    /* Only the expressions are cached for matches with template variables,
+     * see lflow_xlate_commit(), so keep their keys apart from the ones of
+     * the other matches, whose OpenFlow matches may be shared. */
+    if (lflow_match_has_templates(x->lflow)) {
+        ds_put_format(&key, "%c\n", LEX_TEMPLATE_PREFIX);
+    }
+
+    struct lex_str match_s =
+        lexer_parse_template_string(x->lflow->match, template_vars,
+                                    &x->template_vars_ref);
+    ds_put_cstr(&key, lex_str_get(&match_s));
+    lex_str_free(&match_s);
+    if (x->prereqs) {
+        ds_put_char(&key, '\n');
+        expr_format(x->prereqs, &key);
+    }
+    return ds_steal_cstr(&key);
+}
+
+/* Converts the match of 'x->lflow', or the expression cached for it, into
+ * OpenFlow matches.  Returns false if there are none. */
+static bool
+lflow_xlate_matches(struct lflow_xlate *x,
+                    const struct lflow_ctx_in *l_ctx_in,
+                    const struct lflow_cache *lflow_cache,
+                    struct objdep_mgr *deps_mgr)
+{
+    struct lookup_port_aux aux = {
+        .sbrec_multicast_group_by_name_datapath
+            = l_ctx_in->sbrec_multicast_group_by_name_datapath,
+        .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
+        .dp = x->dp,
+        .lflow = x->lflow,
+        .deps_mgr = deps_mgr,
+    };
+    struct condition_aux cond_aux = {
+        .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
+        .dp = x->dp,
+        .chassis = l_ctx_in->chassis,
+        .active_tunnels = l_ctx_in->active_tunnels,
+        .lflow = x->lflow,
+        .deps_mgr = deps_mgr,
+    };
+    long long int start = time_usec();
+
+    /* Expression that the match can be translated from again, if it turns
+     * out to be over budget, without keeping a copy of the normalized one in
+     * case it does. */
+    const struct expr *source = NULL;
+
+    /* Get match expr, either from cache or from lflow match. */
+    if (x->lcv_type == LCACHE_T_NONE) {
+        bool pg_addr_set_ref = false;
+
+        x->expr = convert_match_to_expr(x->lflow, x->ldp, &x->prereqs,
+                                        l_ctx_in->addr_sets,
+                                        l_ctx_in->port_groups,
+                                        l_ctx_in->template_vars,
+                                        &x->template_vars_ref, deps_mgr,
+                                        &pg_addr_set_ref);
+        if (!x->expr) {
+            return false;
+        }
+
+        /* If caching is enabled and this is a not cached expr that doesn't
+         * refer to address sets or port groups, save it to potentially cache
+         * it later.  The template variables it refers to are part of its
+         * cache key. */
+        if (lflow_cache_is_enabled(lflow_cache) && !pg_addr_set_ref) {
+            x->cached_expr = expr_clone(x->expr);
+            source = x->cached_expr;
+        }
+    } else {
+        ovs_assert(x->lcv_type == LCACHE_T_EXPR);
+        source = x->lcv ? x->lcv->expr : x->shared_lcv->expr;
+        x->expr = expr_clone(CONST_CAST(struct expr *, source));
+    }
+
+    /* Normalize expression. */
+    x->expr = expr_evaluate_condition(x->expr, is_chassis_resident_cb,
+                                      &cond_aux);
+    struct expr *expr = (lflow_flow_budget && !source
+                         ? expr_clone(x->expr)
+                         : NULL);
+    x->expr = expr_normalize(x->expr);
+
+    x->matches = xmalloc(sizeof *x->matches);
+    x->n_conjs = expr_to_matches(x->expr, lookup_port_cb, &aux, x->matches);
+    x->n_over_budget = 0;
+    if (lflow_flow_budget && hmap_count(x->matches) > lflow_flow_budget) {
+        /* Keep the disjunctions over several fields, which are the usual
+         * cause of crossproducts, as clauses of conjunctive matches. */
+        if (!expr) {
+            expr = expr_clone(CONST_CAST(struct expr *, source));
+            expr = expr_evaluate_condition(expr, is_chassis_resident_cb,
+                                           &cond_aux);
+        }
+        x->n_over_budget = hmap_count(x->matches);
+        expr_matches_destroy(x->matches);
+        expr_destroy(x->expr);
+        x->expr = expr_normalize_conjunctive(expr);
+        x->n_conjs = expr_to_matches(x->expr, lookup_port_cb, &aux,
+                                     x->matches);
+    } else {
+        expr_destroy(expr);
+    }
+    x->cost = time_usec() - start;
+    if (hmap_is_empty(x->matches)) {
+        VLOG_DBG("lflow "UUID_FMT" matches are empty, skip",
+                 UUID_ARGS(&x->lflow->header_.uuid));
+        return false;
+    }
+    return true;
+}
+
+/* Does the first step of the translation of 'x', see struct lflow_xlate.
+ * The resources that the logical flow refers to are recorded in 'deps_mgr'.
+ *
+ * This may be called for different logical flows from several threads at
+ * the same time, as long as each of them uses its own 'deps_mgr', nothing
+ * modifies 'lflow_cache' meanwhile and 'lookup_cache' is false.  The latter
+ * means that the logical flow is known not to be cached, as looking it up
+ * updates the statistics of the cache. */
+static void
+lflow_xlate_prepare__(struct lflow_xlate *x,
+                      const struct lflow_ctx_in *l_ctx_in,
+                      struct lflow_cache *lflow_cache, bool lookup_cache,
+                      struct objdep_mgr *deps_mgr)
+{
+    const struct sbrec_logical_flow *lflow = x->lflow;
+    const struct sbrec_datapath_binding *dp = x->dp;
 
     const char *io_port = smap_get(&lflow->tags, "in_out_port");
     if (io_port) {
-        objdep_mgr_add(l_ctx_out->lflow_deps_mgr, OBJDEP_TYPE_PORTBINDING,
-                       io_port, &lflow->header_.uuid);
+        objdep_mgr_add(deps_mgr, OBJDEP_TYPE_PORTBINDING, io_port,
+                       &lflow->header_.uuid);
         const struct sbrec_port_binding *pb
             = lport_lookup_by_name(l_ctx_in->sbrec_port_binding_by_name,
                                    io_port);
@@ -1060,193 +1808,324 @@ consider_logical_flow__(const struct sbrec_logical_flow *lflow,
     }
 
     /* Determine translation of logical table IDs to physical table IDs. */
-    bool ingress = !strcmp(lflow->pipeline, "ingress");
-
-    /* Determine translation of logical table IDs to physical table IDs. */
-    uint8_t first_ptable = (ingress
+    x->ingress = !strcmp(lflow->pipeline, "ingress");
+    uint8_t first_ptable = (x->ingress
                             ? OFTABLE_LOG_INGRESS_PIPELINE
                             : OFTABLE_LOG_EGRESS_PIPELINE);
-    uint8_t ptable = first_ptable + lflow->table_id;
-    uint8_t output_ptable = (ingress
-                             ? OFTABLE_OUTPUT_INIT
-                             : OFTABLE_SAVE_INPORT);
+    x->ptable = first_ptable + lflow->table_id;
+    x->output_ptable = (x->ingress
+                        ? OFTABLE_OUTPUT_INIT
+                        : OFTABLE_SAVE_INPORT);
 
     /* Parse OVN logical actions.
      *
      * XXX Deny changes to 'outport' in egress pipeline. */
-    uint64_t ovnacts_stub[1024 / 8];
-    struct ofpbuf ovnacts = OFPBUF_STUB_INITIALIZER(ovnacts_stub);
-    struct sset template_vars_ref = SSET_INITIALIZER(&template_vars_ref);
-    struct expr *prereqs = NULL;
+    if (!lflow_parse_actions(lflow, l_ctx_in, &x->template_vars_ref,
+                             &x->ovnacts, &x->prereqs)) {
+        return;
+    }
 
-    if (!lflow_parse_actions(lflow, l_ctx_in, &template_vars_ref,
-                             &ovnacts, &prereqs)) {
-        ovnacts_free(ovnacts.data, ovnacts.size);
-        ofpbuf_uninit(&ovnacts);
-        store_lflow_template_refs(l_ctx_out->lflow_deps_mgr,
-                                  &template_vars_ref, lflow);
-        sset_destroy(&template_vars_ref);
+    /* The translation cached for a match with template variables is only
+     * valid for the same values of the variables, i.e., the same key. */
+    if (lflow_cache_is_enabled(lflow_cache)
+        && lflow_match_has_templates(lflow)) {
+        x->cache_key = lflow_xlate_cache_key(x, l_ctx_in->template_vars);
+        x->lcv = (lookup_cache
+                  ? lflow_cache_get_for_key(lflow_cache, &lflow->header_.uuid,
+                                            x->cache_key)
+                  : NULL);
+    } else {
+        x->lcv = (lookup_cache
+                  ? lflow_cache_get(lflow_cache, &lflow->header_.uuid)
+                  : NULL);
+    }
+    x->lcv_type = x->lcv ? x->lcv->type : LCACHE_T_NONE;
+
+    /* Other logical flows may have the same translation. */
+    if (!x->lcv && lflow_cache_is_enabled(lflow_cache)) {
+        if (!x->cache_key) {
+            x->cache_key = lflow_xlate_cache_key(x, l_ctx_in->template_vars);
+        }
+        x->shared_lcv = lflow_cache_find_shared(lflow_cache, x->cache_key);
+        if (x->shared_lcv) {
+            x->lcv_type = x->shared_lcv->type;
+        }
+    }
+
+    /* The conjunction ids of cached matches are checked, and the matches
+     * used, by lflow_xlate_commit(). */
+    x->prepared = (x->lcv_type == LCACHE_T_MATCHES
+                   || lflow_xlate_matches(x, l_ctx_in, lflow_cache,
+                                          deps_mgr));
+    x->shared_lcv = NULL;
+}
+
+static void
+lflow_xlate_prepare(struct lflow_xlate *x,
+                    const struct lflow_ctx_in *l_ctx_in,
+                    struct lflow_cache *lflow_cache, bool lookup_cache,
+                    struct objdep_mgr *deps_mgr)
+{
+    if (!lflow_cost_enabled) {
+        lflow_xlate_prepare__(x, l_ctx_in, lflow_cache, lookup_cache,
+                              deps_mgr);
         return;
     }
 
-    struct lookup_port_aux aux = {
-        .sbrec_multicast_group_by_name_datapath
-            = l_ctx_in->sbrec_multicast_group_by_name_datapath,
-        .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
-        .dp = dp,
-        .lflow = lflow,
-        .deps_mgr = l_ctx_out->lflow_deps_mgr,
-    };
-    struct condition_aux cond_aux = {
-        .sbrec_port_binding_by_name = l_ctx_in->sbrec_port_binding_by_name,
-        .dp = dp,
-        .chassis = l_ctx_in->chassis,
-        .active_tunnels = l_ctx_in->active_tunnels,
-        .lflow = lflow,
-        .deps_mgr = l_ctx_out->lflow_deps_mgr,
-    };
+    long long int start = time_usec();
+    lflow_xlate_prepare__(x, l_ctx_in, lflow_cache, lookup_cache, deps_mgr);
+    x->prepare_usec = time_usec() - start;
+}
+
+/* Returns the size of the translation of 'x' into 'matches'. */
+static size_t
+lflow_xlate_size(const struct lflow_xlate *x, const struct hmap *matches)
+{
+    size_t size = x->ovnacts.size;
+    const struct expr_match *m;
 
-    struct lflow_cache_value *lcv =
-        lflow_cache_get(l_ctx_out->lflow_cache, &lflow->header_.uuid);
-    enum lflow_cache_type lcv_type =
-        lcv ? lcv->type : LCACHE_T_NONE;
+    HMAP_FOR_EACH (m, hmap_node, matches) {
+        size += sizeof *m + m->allocated * sizeof *m->conjunctions;
+    }
+    return size;
+}
+
+static void
+lflow_warn_over_budget(const struct lflow_xlate *x, size_t n_matches)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
+    const struct sbrec_logical_flow *lflow = x->lflow;
 
-    struct expr *cached_expr = NULL, *expr = NULL;
-    struct hmap *matches = NULL;
+    COVERAGE_INC(lflow_over_budget);
+    if (!uuidset_find(&lflows_over_budget, &lflow->header_.uuid)) {
+        uuidset_insert(&lflows_over_budget, &lflow->header_.uuid);
+    }
+
+    /* The stage hint is the beginning of the UUID of the northbound row,
+     * e.g. the ACL, that the logical flow was generated for. */
+    VLOG_WARN_RL(&rl, "lflow "UUID_FMT" (%s, stage hint %s) generates "
+                 "%"PRIuSIZE" flows for datapath %"PRId64", more than the "
+                 "budget of %u, translated to %"PRIuSIZE" flows with "
+                 "conjunctive matches instead",
+                 UUID_ARGS(&lflow->header_.uuid),
+                 smap_get_def(&lflow->external_ids, "stage-name", "<none>"),
+                 smap_get_def(&lflow->external_ids, "stage-hint", "<none>"),
+                 x->n_over_budget, x->dp->tunnel_key, lflow_flow_budget,
+                 n_matches);
+}
+
+/* Does the second step of the translation of 'x', prepared by
+ * lflow_xlate_prepare(), see struct lflow_xlate.  The result is added to the
+ * lflow cache only if 'may_cache' is true.  Returns true if it was. */
+static bool
+lflow_xlate_commit(struct lflow_xlate *x, bool may_cache,
+                   struct lflow_ctx_in *l_ctx_in,
+                   struct lflow_ctx_out *l_ctx_out)
+{
+    const struct sbrec_logical_flow *lflow = x->lflow;
+    struct hmap *matches = x->matches;
+    long long int start = lflow_cost_enabled ? time_usec() : 0;
+    uint32_t start_conj_id = 0;
     size_t matches_size = 0;
+    size_t n_flows = 0;
+    size_t n_bytes = 0;
+    bool cached = false;
 
-    bool pg_addr_set_ref = false;
-
-    if (lcv_type == LCACHE_T_MATCHES
-        && lcv->n_conjs
-        && !lflow_conj_ids_alloc_specified(l_ctx_out->conj_ids,
-                                           &lflow->header_.uuid,
-                                           &dp->header_.uuid,
-                                           lcv->conj_id_ofs, lcv->n_conjs)) {
-        /* This should happen very rarely. */
-        VLOG_DBG("lflow "UUID_FMT" match cached with conjunctions, but the"
-                 " cached ids are not available anymore. Drop the cache.",
-                 UUID_ARGS(&lflow->header_.uuid));
-        lflow_cache_delete(l_ctx_out->lflow_cache, &lflow->header_.uuid);
-        lcv_type = LCACHE_T_NONE;
+    if (!x->prepared) {
+        goto done;
     }
 
-    /* Get match expr, either from cache or from lflow match. */
-    switch (lcv_type) {
-    case LCACHE_T_NONE:
-        expr = convert_match_to_expr(lflow, ldp, &prereqs, l_ctx_in->addr_sets,
-                                     l_ctx_in->port_groups,
-                                     l_ctx_in->template_vars,
-                                     &template_vars_ref,
-                                     l_ctx_out->lflow_deps_mgr,
-                                     &pg_addr_set_ref);
-        if (!expr) {
-            goto done;
+    if (x->lcv_type == LCACHE_T_MATCHES && !x->lcv) {
+        /* Use the matches cached for another logical flow with the same key,
+         * unless they were evicted since lflow_xlate_prepare(). */
+        x->lcv = lflow_cache_add_shared(l_ctx_out->lflow_cache,
+                                        &lflow->header_.uuid,
+                                        lflow_content_hash(lflow),
+                                        x->cache_key);
+        if (!x->lcv) {
+            x->lcv_type = LCACHE_T_NONE;
+            if (!lflow_xlate_matches(x, l_ctx_in, l_ctx_out->lflow_cache,
+                                     l_ctx_out->lflow_deps_mgr)) {
+                goto done;
+            }
         }
-        break;
-    case LCACHE_T_EXPR:
-        expr = expr_clone(lcv->expr);
-        break;
-    case LCACHE_T_MATCHES:
-        break;
     }
 
-    /* If caching is enabled and this is a not cached expr that doesn't refer
-     * to address sets, port groups, or template variables, save it to
-     * potentially cache it later.
-     */
-    if (lcv_type == LCACHE_T_NONE
-            && lflow_cache_is_enabled(l_ctx_out->lflow_cache)
-            && !pg_addr_set_ref
-            && sset_is_empty(&template_vars_ref)) {
-        cached_expr = expr_clone(expr);
-    }
-
-    /* Normalize expression if needed. */
-    switch (lcv_type) {
-    case LCACHE_T_NONE:
-    case LCACHE_T_EXPR:
-        expr = expr_evaluate_condition(expr, is_chassis_resident_cb,
-                                       &cond_aux);
-        expr = expr_normalize(expr);
-        break;
-    case LCACHE_T_MATCHES:
-        break;
-    }
-
-    /* Get matches, either from cache or from expr computed above. */
-    uint32_t start_conj_id = 0;
-    uint32_t n_conjs = 0;
-    switch (lcv_type) {
-    case LCACHE_T_NONE:
-    case LCACHE_T_EXPR:
-        matches = xmalloc(sizeof *matches);
-        n_conjs = expr_to_matches(expr, lookup_port_cb, &aux, matches);
-        if (hmap_is_empty(matches)) {
-            VLOG_DBG("lflow "UUID_FMT" matches are empty, skip",
-                     UUID_ARGS(&lflow->header_.uuid));
-            goto done;
-        }
-        if (n_conjs) {
-            start_conj_id = lflow_conj_ids_alloc(l_ctx_out->conj_ids,
-                                                 &lflow->header_.uuid,
-                                                 &dp->header_.uuid,
-                                                 n_conjs);
-            if (!start_conj_id) {
-                VLOG_ERR("32-bit conjunction ids exhausted!");
+    if (x->lcv_type == LCACHE_T_MATCHES) {
+        if (x->lcv->n_conjs
+            && !lflow_conj_ids_alloc_specified(l_ctx_out->conj_ids,
+                                               &lflow->header_.uuid,
+                                               &x->dp->header_.uuid,
+                                               x->lcv->conj_id_ofs,
+                                               x->lcv->n_conjs)) {
+            /* This should happen very rarely. */
+            VLOG_DBG("lflow "UUID_FMT" match cached with conjunctions, but "
+                     "the cached ids are not available anymore. Drop the "
+                     "cache.", UUID_ARGS(&lflow->header_.uuid));
+            lflow_cache_delete(l_ctx_out->lflow_cache, &lflow->header_.uuid);
+            x->lcv = NULL;
+            x->lcv_type = LCACHE_T_NONE;
+            if (!lflow_xlate_matches(x, l_ctx_in, l_ctx_out->lflow_cache,
+                                     l_ctx_out->lflow_deps_mgr)) {
                 goto done;
             }
-            matches_size = expr_matches_prepare(matches, start_conj_id - 1);
-        }
-        break;
-    case LCACHE_T_MATCHES:
-        matches = lcv->expr_matches;
-        break;
-    }
-
-    add_matches_to_flow_table(lflow, ldp, matches, ptable, output_ptable,
-                              &ovnacts, ingress, l_ctx_in, l_ctx_out);
-
-    /* Update cache if needed. */
-    switch (lcv_type) {
-    case LCACHE_T_NONE:
-        /* Cache new entry if caching is enabled. */
-        if (lflow_cache_is_enabled(l_ctx_out->lflow_cache)) {
-            if (cached_expr
-                && !objdep_mgr_contains_obj(l_ctx_out->lflow_deps_mgr,
-                                            &lflow->header_.uuid)) {
-                lflow_cache_add_matches(l_ctx_out->lflow_cache,
-                                        &lflow->header_.uuid, start_conj_id,
-                                        n_conjs, matches, matches_size);
-                matches = NULL;
-            } else if (cached_expr) {
-                lflow_cache_add_expr(l_ctx_out->lflow_cache,
-                                     &lflow->header_.uuid,
-                                     cached_expr, expr_size(cached_expr));
-                cached_expr = NULL;
-            }
+            matches = x->matches;
+        } else {
+            matches = x->lcv->expr_matches;
         }
-        break;
-    case LCACHE_T_EXPR:
-        break;
-    case LCACHE_T_MATCHES:
-        /* Cached matches were used, don't destroy them. */
-        matches = NULL;
-        break;
     }
 
-done:
-    expr_destroy(prereqs);
-    ovnacts_free(ovnacts.data, ovnacts.size);
-    ofpbuf_uninit(&ovnacts);
-    expr_destroy(expr);
-    expr_destroy(cached_expr);
-    expr_matches_destroy(matches);
-    free(matches);
+    if (x->lcv_type != LCACHE_T_MATCHES && x->n_conjs) {
+        start_conj_id = lflow_conj_ids_alloc(l_ctx_out->conj_ids,
+                                             &lflow->header_.uuid,
+                                             &x->dp->header_.uuid,
+                                             x->n_conjs);
+        if (!start_conj_id) {
+            VLOG_ERR("32-bit conjunction ids exhausted!");
+            goto done;
+        }
+        matches_size = expr_matches_prepare(matches, start_conj_id - 1);
+    }
+
+    n_flows = add_matches_to_flow_table(lflow, x->ldp, matches, x->ptable,
+                                        x->output_ptable, &x->ovnacts,
+                                        &x->template_vars_ref, x->ingress,
+                                        l_ctx_in, l_ctx_out);
+    if (lflow_cost_enabled) {
+        n_bytes = lflow_xlate_size(x, matches);
+    }
+    if (x->n_over_budget) {
+        lflow_warn_over_budget(x, hmap_count(matches));
+    }
+
+    /* Cache new entry if caching is enabled. */
+    if (x->lcv_type == LCACHE_T_EXPR && !x->lcv) {
+        lflow_cache_add_shared(l_ctx_out->lflow_cache, &lflow->header_.uuid,
+                               0, x->cache_key);
+    } else if (x->lcv_type == LCACHE_T_NONE
+               && may_cache
+               && lflow_cache_is_enabled(l_ctx_out->lflow_cache)
+               && x->cached_expr) {
+        cached = true;
+        /* The matches are saved across restarts with the hash of the
+         * contents of the logical flow, which doesn't cover the values of
+         * the template variables, so only the expression is cached for a
+         * match that refers to them. */
+        if (!objdep_mgr_contains_obj(l_ctx_out->lflow_deps_mgr,
+                                     &lflow->header_.uuid)
+            && !lflow_match_has_templates(lflow)) {
+            lflow_cache_add_matches(l_ctx_out->lflow_cache,
+                                    &lflow->header_.uuid,
+                                    lflow_content_hash(lflow), x->cache_key,
+                                    start_conj_id, x->n_conjs, x->matches,
+                                    matches_size, x->cost);
+            x->matches = NULL;
+        } else {
+            lflow_cache_add_expr(l_ctx_out->lflow_cache,
+                                 &lflow->header_.uuid, x->cache_key,
+                                 x->cached_expr,
+                                 expr_size(x->cached_expr), x->cost);
+            x->cached_expr = NULL;
+        }
+    }
 
+done:
     store_lflow_template_refs(l_ctx_out->lflow_deps_mgr,
-                              &template_vars_ref, lflow);
-    sset_destroy(&template_vars_ref);
+                              &x->template_vars_ref, lflow);
+    if (lflow_cost_enabled) {
+        lflow_cost_record(lflow, x->prepare_usec + (time_usec() - start),
+                          n_flows, n_bytes);
+    }
+    return cached;
+}
+
+/* Translates 'lflow', a parameterized logical flow, for 'dp' once for each
+ * of its tuples of parameters, whose values take precedence over the
+ * template variables of the chassis.
+ *
+ * The translations are not cached, since they differ for each tuple and the
+ * tuples of a logical flow change whenever one of the entities that it was
+ * generated for, e.g. a logical switch port, does.  The conjunction ids are
+ * allocated per logical flow and datapath, so a tuple whose match needs
+ * conjunctions can't be translated. */
+static void
+consider_parameterized_lflow(const struct sbrec_logical_flow *lflow,
+                             const struct sbrec_datapath_binding *dp,
+                             const struct local_datapath *ldp,
+                             struct lflow_ctx_in *l_ctx_in,
+                             struct lflow_ctx_out *l_ctx_out)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
+    struct lflow_ctx_in p_ctx_in = *l_ctx_in;
+
+    for (size_t i = 0; i < lflow->n_parameters; i++) {
+        struct smap template_vars;
+
+        smap_clone(&template_vars, l_ctx_in->template_vars);
+        char *error = lexer_parse_template_params(lflow->parameters[i],
+                                                  &template_vars);
+        if (error) {
+            VLOG_WARN_RL(&rl, "lflow "UUID_FMT": invalid parameters \"%s\": "
+                         "%s", UUID_ARGS(&lflow->header_.uuid),
+                         lflow->parameters[i], error);
+            free(error);
+            smap_destroy(&template_vars);
+            continue;
+        }
+        p_ctx_in.template_vars = &template_vars;
+        COVERAGE_INC(lflow_parameters_xlate);
+
+        struct lflow_xlate x;
+        lflow_xlate_init(&x, lflow, dp, ldp);
+        lflow_xlate_prepare(&x, &p_ctx_in, NULL, false,
+                            l_ctx_out->lflow_deps_mgr);
+        if (x.prepared && x.n_conjs) {
+            VLOG_WARN_RL(&rl, "lflow "UUID_FMT" needs conjunctive matches "
+                         "for parameters \"%s\", skip",
+                         UUID_ARGS(&lflow->header_.uuid),
+                         lflow->parameters[i]);
+            x.prepared = false;
+        }
+        lflow_xlate_commit(&x, false, &p_ctx_in, l_ctx_out);
+        lflow_xlate_destroy(&x);
+        smap_destroy(&template_vars);
+    }
+}
+
+static void
+consider_logical_flow__(const struct sbrec_logical_flow *lflow,
+                        const struct sbrec_datapath_binding *dp,
+                        struct lflow_ctx_in *l_ctx_in,
+                        struct lflow_ctx_out *l_ctx_out)
+{
+    const struct local_datapath *ldp =
+        lflow_get_local_datapath(lflow, dp, l_ctx_in);
+    if (!ldp) {
+        return;
+    }
+
+    if (lflow->n_parameters) {
+        consider_parameterized_lflow(lflow, dp, ldp, l_ctx_in, l_ctx_out);
+        return;
+    }
+
+    lflow_restore_cache_entry(lflow, l_ctx_out->lflow_cache);
+
+    struct lflow_xlate x;
+    long long int start OVS_UNUSED = ovn_usdt_time_usec();
+
+    lflow_xlate_init(&x, lflow, dp, ldp);
+    lflow_xlate_prepare(&x, l_ctx_in, l_ctx_out->lflow_cache, true,
+                        l_ctx_out->lflow_deps_mgr);
+    long long int prepared OVS_UNUSED = ovn_usdt_time_usec();
+    lflow_xlate_commit(&x, true, l_ctx_in, l_ctx_out);
+    lflow_xlate_destroy(&x);
+
+    /* Parsing and conversion of the match and actions, then generation of
+     * the OpenFlow flows, in microseconds. */
+    OVS_USDT_PROBE(consider_logical_flow__, lflow_xlate,
+                   &lflow->header_.uuid, dp->tunnel_key, lflow->table_id,
+                   prepared - start, ovn_usdt_time_usec() - prepared);
 }
 
 static void
@@ -1282,6 +2161,244 @@ consider_logical_flow(const struct sbrec_logical_flow *lflow,
     }
 }
 
+/* Maximum number of translations of logical flows, for any datapath, that
+ * the workers of 'lflow_pool' prepare before the main thread commits them.
+ * This bounds the memory used by the prepared matches. */
+#define LFLOW_XLATE_BATCH 16384
+
+/* Number of logical flows handed out at a time to a worker. */
+#define LFLOW_XLATE_CHUNK 64
+
+#define LFLOW_MAX_N_THREADS 256
+
+/* Pool used by lflow_run() to translate the logical flows in parallel, NULL
+ * if there is only one thread.  See lflow_set_n_threads(). */
+static struct worker_pool *lflow_pool;
+static struct work_queue lflow_xlate_wq;
+static bool lflow_xlate_wq_inited = false;
+
+/* A logical flow and its translations for the local datapaths. */
+struct lflow_xlate_job {
+    const struct sbrec_logical_flow *lflow;
+    struct lflow_xlate *xlates;
+    size_t n_xlates;
+
+    /* The logical flow is in the lflow cache.  Entries of the cache may be
+     * replaced while a batch is committed, so its translations are prepared
+     * by the main thread right before being committed. */
+    bool serial;
+};
+
+struct lflow_xlate_task {
+    struct lflow_xlate_job *jobs;
+    size_t n_jobs;
+    const struct lflow_ctx_in *l_ctx_in;
+    struct lflow_cache *lflow_cache;
+    struct objdep_mgr *deps_mgrs;   /* Indexed by worker id. */
+};
+
+/* Initializes the translations of 'job->lflow' for its local datapaths and
+ * returns their number. */
+static size_t
+lflow_xlate_job_init(struct lflow_xlate_job *job,
+                     const struct lflow_ctx_in *l_ctx_in,
+                     struct lflow_cache *lflow_cache)
+{
+    const struct sbrec_logical_flow *lflow = job->lflow;
+    const struct sbrec_logical_dp_group *dp_group = lflow->logical_dp_group;
+    const struct sbrec_datapath_binding *dp = lflow->logical_datapath;
+
+    job->xlates = NULL;
+    job->n_xlates = 0;
+    job->serial = false;
+
+    if (lflow->n_parameters) {
+        /* Translated by the main thread, with consider_logical_flow(). */
+        return 0;
+    }
+    if (!dp_group && !dp) {
+        VLOG_DBG("lflow "UUID_FMT" has no datapath binding, skip",
+                 UUID_ARGS(&lflow->header_.uuid));
+        return 0;
+    }
+    ovs_assert(!dp_group || !dp);
+
+    COVERAGE_INC(consider_logical_flow);
+
+    size_t n_dps = dp ? 1 : dp_group->n_datapaths;
+    for (size_t i = 0; i < n_dps; i++) {
+        const struct sbrec_datapath_binding *ldp_sb =
+            dp ? dp : dp_group->datapaths[i];
+        const struct local_datapath *ldp =
+            lflow_get_local_datapath(lflow, ldp_sb, l_ctx_in);
+        if (!ldp) {
+            continue;
+        }
+        if (!job->xlates) {
+            job->xlates = xmalloc((n_dps - i) * sizeof *job->xlates);
+        }
+        lflow_xlate_init(&job->xlates[job->n_xlates++], lflow, ldp_sb, ldp);
+    }
+
+    if (job->n_xlates) {
+        lflow_restore_cache_entry(lflow, lflow_cache);
+        /* Logical flows that are not cached are not looked up again by
+         * lflow_xlate_prepare(), so this is where their misses are
+         * accounted for. */
+        job->serial = !!lflow_cache_get(lflow_cache, &lflow->header_.uuid);
+    }
+    return job->n_xlates;
+}
+
+static void
+lflow_xlate_task_run(struct worker_control *control, void *task_)
+{
+    struct lflow_xlate_task *task = task_;
+    struct objdep_mgr *deps_mgr = &task->deps_mgrs[control->id];
+    size_t chunk;
+
+    WORK_QUEUE_FOR_EACH_BUCKET (chunk, control->id, &lflow_xlate_wq) {
+        size_t end = MIN((chunk + 1) * LFLOW_XLATE_CHUNK, task->n_jobs);
+
+        for (size_t i = chunk * LFLOW_XLATE_CHUNK; i < end; i++) {
+            struct lflow_xlate_job *job = &task->jobs[i];
+
+            for (size_t j = 0; !job->serial && j < job->n_xlates; j++) {
+                lflow_xlate_prepare(&job->xlates[j], task->l_ctx_in,
+                                    task->lflow_cache, false, deps_mgr);
+            }
+        }
+    }
+}
+
+/* Same as calling consider_logical_flow() for every logical flow, but the
+ * logical flows are prepared on 'lflow_pool'.  They are then committed by
+ * this thread in the order of the Logical_Flow table. */
+static void
+add_logical_flows_parallel(struct lflow_ctx_in *l_ctx_in,
+                           struct lflow_ctx_out *l_ctx_out)
+{
+    const struct sbrec_logical_flow *lflow;
+    struct lflow_xlate_job *jobs = NULL;
+    size_t n_jobs = 0;
+    size_t allocated_jobs = 0;
+
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
+        if (n_jobs >= allocated_jobs) {
+            jobs = x2nrealloc(jobs, &allocated_jobs, sizeof *jobs);
+        }
+        jobs[n_jobs++].lflow = lflow;
+    }
+
+    /* The workers translate the logical flows, they can't also be used to
+     * expand their matches. */
+    expr_set_worker_pool(NULL);
+
+    struct objdep_mgr *deps_mgrs =
+        xmalloc(lflow_pool->size * sizeof *deps_mgrs);
+    for (size_t i = 0; i < lflow_pool->size; i++) {
+        objdep_mgr_init(&deps_mgrs[i]);
+    }
+
+    size_t last;
+    for (size_t first = 0; first < n_jobs; first = last) {
+        size_t n_xlates = 0;
+
+        for (last = first; last < n_jobs && n_xlates < LFLOW_XLATE_BATCH;
+             last++) {
+            n_xlates += lflow_xlate_job_init(&jobs[last], l_ctx_in,
+                                             l_ctx_out->lflow_cache);
+        }
+
+        struct lflow_xlate_task task = {
+            .jobs = &jobs[first],
+            .n_jobs = last - first,
+            .l_ctx_in = l_ctx_in,
+            .lflow_cache = l_ctx_out->lflow_cache,
+            .deps_mgrs = deps_mgrs,
+        };
+        ovn_work_queue_reset(&lflow_xlate_wq,
+                             DIV_ROUND_UP(task.n_jobs, LFLOW_XLATE_CHUNK));
+        run_pool_task(lflow_pool, lflow_xlate_task_run, &task);
+
+        /* Every logical flow was prepared by a single worker, so merging
+         * keeps the order in which its resources were referenced. */
+        for (size_t i = 0; i < lflow_pool->size; i++) {
+            objdep_mgr_merge(l_ctx_out->lflow_deps_mgr, &deps_mgrs[i]);
+        }
+
+        for (size_t i = first; i < last; i++) {
+            struct lflow_xlate_job *job = &jobs[i];
+
+            if (job->lflow->n_parameters) {
+                consider_logical_flow(job->lflow, true, l_ctx_in, l_ctx_out);
+                continue;
+            }
+
+            /* As with a single thread, the result is only cached for the
+             * first datapath, the others would reuse it. */
+            bool cached = false;
+            for (size_t j = 0; j < job->n_xlates; j++) {
+                if (job->serial) {
+                    lflow_xlate_prepare(&job->xlates[j], l_ctx_in,
+                                        l_ctx_out->lflow_cache, true,
+                                        l_ctx_out->lflow_deps_mgr);
+                }
+                cached |= lflow_xlate_commit(&job->xlates[j], !cached,
+                                             l_ctx_in, l_ctx_out);
+                lflow_xlate_destroy(&job->xlates[j]);
+            }
+            free(job->xlates);
+        }
+    }
+
+    for (size_t i = 0; i < lflow_pool->size; i++) {
+        objdep_mgr_destroy(&deps_mgrs[i]);
+    }
+    free(deps_mgrs);
+    free(jobs);
+
+    expr_set_worker_pool(lflow_pool);
+}
+
+/* Adds the logical flows from the Logical_Flow table to flow tables. */
+static void
+add_logical_flows(struct lflow_ctx_in *l_ctx_in,
+                  struct lflow_ctx_out *l_ctx_out)
+{
+    if (lflow_pool) {
+        add_logical_flows_parallel(l_ctx_in, l_ctx_out);
+        return;
+    }
+
+    const struct sbrec_logical_flow *lflow;
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (lflow, l_ctx_in->logical_flow_table) {
+        consider_logical_flow(lflow, true, l_ctx_in, l_ctx_out);
+    }
+}
+
+/* Sets the number of threads that lflow_run() uses to translate the logical
+ * flows.  With 1, the default, they are translated by the calling thread. */
+void
+lflow_set_n_threads(size_t n_threads)
+{
+    n_threads = MIN(MAX(n_threads, 1), LFLOW_MAX_N_THREADS);
+    if (update_worker_pool(n_threads, &lflow_pool,
+                           ovn_worker_task_thread) != POOL_UNCHANGED) {
+        if (lflow_xlate_wq_inited) {
+            ovn_work_queue_destroy(&lflow_xlate_wq);
+            lflow_xlate_wq_inited = false;
+        }
+        if (lflow_pool) {
+            ovn_work_queue_init_for_pool(&lflow_xlate_wq, lflow_pool);
+            lflow_xlate_wq_inited = true;
+        }
+        /* Outside of add_logical_flows_parallel(), the workers are idle and
+         * can expand the matches on big address sets. */
+        expr_set_worker_pool(lflow_pool);
+    }
+}
+
 static void
 put_load(const uint8_t *data, size_t len,
          enum mf_field_id dst, int ofs, int n_bits,
@@ -1407,7 +2524,11 @@ consider_neighbor_flow(struct ovsdb_idl_index *sbrec_port_binding_by_name,
                     &lookup_arp_match, &ofpacts,
                     b ? &b->header_.uuid : &smb->header_.uuid);
 
-    if (b) {
+    /* The flows that mark the MAC bindings as used are only looked at, by
+     * statctrl, if they age out, which saves a flow per MAC binding on the
+     * datapaths without aging, e.g. on gateway chassis with lots of learned
+     * neighbors. */
+    if (b && mac_cache_threshold_get_value_ms(b->datapath)) {
         ofpbuf_clear(&ofpacts);
         ofctrl_add_flow(flow_table, OFTABLE_MAC_CACHE_USE, priority,
                         b->header_.uuid.parts[0], &mb_cache_use_match,
@@ -1417,29 +2538,51 @@ consider_neighbor_flow(struct ovsdb_idl_index *sbrec_port_binding_by_name,
     ofpbuf_uninit(&ofpacts);
 }
 
-/* Adds an OpenFlow flow to flow tables for each MAC binding in the OVN
- * southbound database. */
+/* Adds the OpenFlow flows of the learnt and of the statically configured
+ * MAC bindings of the datapath 'dp'. */
 static void
-add_neighbor_flows(struct ovsdb_idl_index *sbrec_port_binding_by_name,
-                   const struct sbrec_mac_binding_table *mac_binding_table,
-                   const struct sbrec_static_mac_binding_table *smb_table,
-                   const struct hmap *local_datapaths,
-                   struct ovn_desired_flow_table *flow_table)
+add_neighbor_flows_for_datapath(const struct sbrec_datapath_binding *dp,
+                                const struct lflow_ctx_in *l_ctx_in,
+                                struct lflow_ctx_out *l_ctx_out)
 {
-    /* Add flows for learnt MAC bindings */
-    const struct sbrec_mac_binding *b;
-    SBREC_MAC_BINDING_TABLE_FOR_EACH (b, mac_binding_table) {
-        consider_neighbor_flow(sbrec_port_binding_by_name, local_datapaths,
-                               b, NULL, flow_table, 100);
+    struct sbrec_mac_binding *mb_index_row = sbrec_mac_binding_index_init_row(
+        l_ctx_in->sbrec_mac_binding_by_datapath);
+    sbrec_mac_binding_index_set_datapath(mb_index_row, dp);
+    const struct sbrec_mac_binding *mb;
+    SBREC_MAC_BINDING_FOR_EACH_EQUAL (
+        mb, mb_index_row, l_ctx_in->sbrec_mac_binding_by_datapath) {
+        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
+                               l_ctx_in->local_datapaths,
+                               mb, NULL, l_ctx_out->flow_table, 100);
     }
+    sbrec_mac_binding_index_destroy_row(mb_index_row);
 
-    /* Add flows for statically configured MAC bindings */
+    struct sbrec_static_mac_binding *smb_index_row =
+        sbrec_static_mac_binding_index_init_row(
+            l_ctx_in->sbrec_static_mac_binding_by_datapath);
+    sbrec_static_mac_binding_index_set_datapath(smb_index_row, dp);
     const struct sbrec_static_mac_binding *smb;
-    SBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (smb, smb_table) {
-        consider_neighbor_flow(sbrec_port_binding_by_name, local_datapaths,
-                               NULL, smb, flow_table,
+    SBREC_STATIC_MAC_BINDING_FOR_EACH_EQUAL (
+        smb, smb_index_row, l_ctx_in->sbrec_static_mac_binding_by_datapath) {
+        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
+                               l_ctx_in->local_datapaths,
+                               NULL, smb, l_ctx_out->flow_table,
                                smb->override_dynamic_mac ? 150 : 50);
     }
+    sbrec_static_mac_binding_index_destroy_row(smb_index_row);
+}
+
+/* Adds an OpenFlow flow to flow tables for each MAC binding of the local
+ * datapaths.  The MAC bindings are looked up by datapath, so that the ones
+ * of the other datapaths, possibly millions of them, are not walked. */
+static void
+add_neighbor_flows(const struct lflow_ctx_in *l_ctx_in,
+                   struct lflow_ctx_out *l_ctx_out)
+{
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, l_ctx_in->local_datapaths) {
+        add_neighbor_flows_for_datapath(ld->datapath, l_ctx_in, l_ctx_out);
+    }
 }
 
 /* Builds the "learn()" action to be triggered by packets initiating a
@@ -1451,9 +2594,11 @@ add_neighbor_flows(struct ovsdb_idl_index *sbrec_port_binding_by_name,
  *     nw_proto='lb_proto',tp_src_port=<backend-port>
  * - action:
  *     set MLF_LOOKUP_LB_HAIRPIN_BIT=1
- */
+ *
+ * <vip> is 'vip' or, if it is NULL, the original destination IP of the
+ * packet stored by ovn-northd. */
 static void
-add_lb_vip_hairpin_reply_action(struct in6_addr *vip6, ovs_be32 vip,
+add_lb_vip_hairpin_reply_action(bool ipv6, const union mf_value *vip,
                                 uint8_t lb_proto, bool has_l4_port,
                                 uint64_t cookie, struct ofpbuf *ofpacts)
 {
@@ -1496,7 +2641,7 @@ add_lb_vip_hairpin_reply_action(struct in6_addr *vip6, ovs_be32 vip,
     ol_spec->dst_type = NX_LEARN_DST_MATCH;
     ol_spec->src_type = NX_LEARN_SRC_IMMEDIATE;
     union mf_value imm_eth_type = {
-        .be16 = !vip6 ? htons(ETH_TYPE_IP) : htons(ETH_TYPE_IPV6)
+        .be16 = !ipv6 ? htons(ETH_TYPE_IP) : htons(ETH_TYPE_IPV6)
     };
     mf_write_subfield_value(&ol_spec->dst, &imm_eth_type, &match);
 
@@ -1507,7 +2652,7 @@ add_lb_vip_hairpin_reply_action(struct in6_addr *vip6, ovs_be32 vip,
 
     /* Hairpin replies have ip.src == <backend-ip>. */
     ol_spec = ofpbuf_put_zeros(ofpacts, sizeof *ol_spec);
-    if (!vip6) {
+    if (!ipv6) {
         ol_spec->dst.field = mf_from_id(MFF_IPV4_SRC);
         ol_spec->src.field = mf_from_id(MFF_IPV4_SRC);
     } else {
@@ -1521,30 +2666,25 @@ add_lb_vip_hairpin_reply_action(struct in6_addr *vip6, ovs_be32 vip,
     ol_spec->src_type = NX_LEARN_SRC_FIELD;
 
     /* Hairpin replies have ip.dst == <vip>. */
-    union mf_value imm_ip;
     ol_spec = ofpbuf_put_zeros(ofpacts, sizeof *ol_spec);
-    if (!vip6) {
-        ol_spec->dst.field = mf_from_id(MFF_IPV4_DST);
-        imm_ip = (union mf_value) {
-            .be32 = vip
-        };
-    } else {
-        ol_spec->dst.field = mf_from_id(MFF_IPV6_DST);
-        imm_ip = (union mf_value) {
-            .ipv6 = *vip6
-        };
-    }
+    ol_spec->dst.field = mf_from_id(!ipv6 ? MFF_IPV4_DST : MFF_IPV6_DST);
     ol_spec->dst.ofs = 0;
     ol_spec->dst.n_bits = ol_spec->dst.field->n_bits;
     ol_spec->n_bits = ol_spec->dst.n_bits;
     ol_spec->dst_type = NX_LEARN_DST_MATCH;
-    ol_spec->src_type = NX_LEARN_SRC_IMMEDIATE;
-    mf_write_subfield_value(&ol_spec->dst, &imm_ip, &match);
+    if (!vip) {
+        ol_spec->src_type = NX_LEARN_SRC_FIELD;
+        ol_spec->src.field = mf_from_id(!ipv6 ? MFF_LOG_LB_ORIG_DIP_IPV4
+                                              : MFF_LOG_LB_ORIG_DIP_IPV6);
+    } else {
+        ol_spec->src_type = NX_LEARN_SRC_IMMEDIATE;
+        mf_write_subfield_value(&ol_spec->dst, vip, &match);
 
-    /* Push value last, as this may reallocate 'ol_spec' */
-    imm_bytes = DIV_ROUND_UP(ol_spec->dst.n_bits, 8);
-    src_imm = ofpbuf_put_zeros(ofpacts, OFPACT_ALIGN(imm_bytes));
-    memcpy(src_imm, &imm_ip, imm_bytes);
+        /* Push value last, as this may reallocate 'ol_spec' */
+        imm_bytes = DIV_ROUND_UP(ol_spec->dst.n_bits, 8);
+        src_imm = ofpbuf_put_zeros(ofpacts, OFPACT_ALIGN(imm_bytes));
+        memcpy(src_imm, vip, imm_bytes);
+    }
 
     /* Hairpin replies have the same nw_proto as packets that created the
      * session.
@@ -1621,6 +2761,24 @@ add_lb_vip_hairpin_reply_action(struct in6_addr *vip6, ovs_be32 vip,
     ofpact_finish_LEARN(ofpacts, &ol);
 }
 
+/* Matches, in 'match', the traffic that was already load balanced, i.e.,
+ * "ct.natted == 1", stored in ct_mark if 'use_ct_mark', in ct_label
+ * otherwise. */
+static void
+match_set_lb_natted(struct match *match, bool use_ct_mark)
+{
+    if (use_ct_mark) {
+        uint32_t lb_ct_mark = OVN_CT_NATTED;
+        match_set_ct_mark_masked(match, lb_ct_mark, lb_ct_mark);
+    } else {
+        match_set_ct_mark_masked(match, 0, 0);
+        ovs_u128 lb_ct_label = {
+            .u64.lo = OVN_CT_NATTED,
+        };
+        match_set_ct_label_masked(match, lb_ct_label, lb_ct_label);
+    }
+}
+
 /* Adds flows to detect hairpin sessions.
  *
  * For backwards compatibilty with older ovn-northd versions, uses
@@ -1669,7 +2827,8 @@ add_lb_vip_hairpin_flows(const struct ovn_controller_lb *lb,
                           ntohl(vip4));
         }
 
-        add_lb_vip_hairpin_reply_action(NULL, snat_vip4, lb->proto,
+        union mf_value imm_vip = { .be32 = snat_vip4 };
+        add_lb_vip_hairpin_reply_action(false, &imm_vip, lb->proto,
                                         lb_backend->port,
                                         lb->slb->header_.uuid.parts[0],
                                         &ofpacts);
@@ -1694,7 +2853,8 @@ add_lb_vip_hairpin_flows(const struct ovn_controller_lb *lb,
                             ntoh128(vip6_value));
         }
 
-        add_lb_vip_hairpin_reply_action(snat_vip6, 0, lb->proto,
+        union mf_value imm_vip = { .ipv6 = *snat_vip6 };
+        add_lb_vip_hairpin_reply_action(true, &imm_vip, lb->proto,
                                         lb_backend->port,
                                         lb->slb->header_.uuid.parts[0],
                                         &ofpacts);
@@ -1727,26 +2887,191 @@ add_lb_vip_hairpin_flows(const struct ovn_controller_lb *lb,
      * ct.natted in ct_label.  For backwards compatibility, only use ct_mark
      * if ovn-northd notified ovn-controller to do that.
      */
-    if (use_ct_mark) {
-        uint32_t lb_ct_mark = OVN_CT_NATTED;
-        match_set_ct_mark_masked(&hairpin_match, lb_ct_mark, lb_ct_mark);
+    match_set_lb_natted(&hairpin_match, use_ct_mark);
+    ofctrl_add_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
+                    lb->slb->header_.uuid.parts[0], &hairpin_match,
+                    &ofpacts, &lb->slb->header_.uuid);
 
-        ofctrl_add_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
-                        lb->slb->header_.uuid.parts[0], &hairpin_match,
-                        &ofpacts, &lb->slb->header_.uuid);
-    } else {
-        match_set_ct_mark_masked(&hairpin_match, 0, 0);
-        ovs_u128 lb_ct_label = {
-            .u64.lo = OVN_CT_NATTED,
-        };
-        match_set_ct_label_masked(&hairpin_match, lb_ct_label, lb_ct_label);
+    ofpbuf_uninit(&ofpacts);
+}
+
+/* Adds a flow for clause 'clause' of the 2 clauses hairpin conjunction
+ * 'conj_id' of 'lb'. */
+static void
+add_lb_hairpin_conj_clause(const struct ovn_controller_lb *lb,
+                           const struct match *match,
+                           uint32_t conj_id, uint8_t clause,
+                           struct ovn_desired_flow_table *flow_table)
+{
+    uint64_t stub[64 / 8];
+    struct ofpbuf conj = OFPBUF_STUB_INITIALIZER(stub);
+
+    struct ofpact_conjunction *dst = ofpact_put_CONJUNCTION(&conj);
+    dst->id = conj_id;
+    dst->clause = clause;
+    dst->n_clauses = 2;
+
+    ofctrl_add_or_append_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
+                              lb->slb->header_.uuid.parts[0], match, &conj,
+                              &lb->slb->header_.uuid, NX_CTLR_NO_METER,
+                              NULL);
+    ofpbuf_uninit(&conj);
+}
+
+/* The conjunctions used by add_lb_conj_hairpin_flows() for each address
+ * family and whether the VIPs have an L4 port. */
+#define LB_HAIRPIN_N_CONJS 4
+
+static size_t
+lb_hairpin_conj_index(bool ipv6, bool has_l4_port)
+{
+    return ipv6 * 2 + has_l4_port;
+}
+
+/* Adds flows to detect the hairpin sessions of 'lb' with conjunctive
+ * matches, if its "hairpin_conjunctive" option is set.  Instead of a flow
+ * per VIP and backend pair, see add_lb_vip_hairpin_flows(), there is a flow
+ * per VIP and one per distinct backend, which is much less for load
+ * balancers whose VIPs share backends:
+ *
+ * - conjunction(id, 1/2): the original destination of the packet, stored
+ *   by ovn-northd, is a VIP of 'lb' and the packet was load balanced.
+ * - conjunction(id, 2/2): ip.src == ip.dst == <backend> and the destination
+ *   port is the backend port.
+ *
+ * This doesn't check that the backend is one of the VIP of the packet, but
+ * the packet was load balanced, so it is.  The learned hairpin reply flows
+ * take the VIP from the original destination of the packet, so the actions
+ * of the conjunction don't depend on the VIP either.
+ *
+ * Returns false if the flows weren't added, in which case the caller should
+ * fall back to add_lb_vip_hairpin_flows(). */
+static bool
+add_lb_conj_hairpin_flows(const struct ovn_controller_lb *lb,
+                          bool use_ct_mark, struct conj_ids *conj_ids,
+                          struct ovn_desired_flow_table *flow_table)
+{
+    if (!lb->hairpin_conjunctive || !lb->hairpin_orig_tuple) {
+        return false;
+    }
+
+    const struct uuid *lb_uuid = &lb->slb->header_.uuid;
+    uint32_t start_conj_id = lflow_conj_ids_alloc(conj_ids, lb_uuid, lb_uuid,
+                                                  LB_HAIRPIN_N_CONJS);
+    if (!start_conj_id) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+        VLOG_WARN_RL(&rl, "Unable to allocate conjunction ids for the "
+                     "hairpin flows of load balancer "UUID_FMT,
+                     UUID_ARGS(lb_uuid));
+        return false;
+    }
+
+    struct sset backends = SSET_INITIALIZER(&backends);
+    bool used[LB_HAIRPIN_N_CONJS] = { false };
+
+    for (size_t i = 0; i < lb->n_vips; i++) {
+        const struct ovn_lb_vip *lb_vip = &lb->vips[i];
+        bool ipv6 = !IN6_IS_ADDR_V4MAPPED(&lb_vip->vip);
+        bool has_l4_port = lb_vip->vip_port != 0;
+        size_t idx = lb_hairpin_conj_index(ipv6, has_l4_port);
+
+        if (!lb_vip->n_backends) {
+            continue;
+        }
+        used[idx] = true;
+
+        struct match match = MATCH_CATCHALL_INITIALIZER;
+        if (!ipv6) {
+            match_set_dl_type(&match, htons(ETH_TYPE_IP));
+            match_set_reg(&match, MFF_LOG_LB_ORIG_DIP_IPV4 - MFF_LOG_REG0,
+                          ntohl(in6_addr_get_mapped_ipv4(&lb_vip->vip)));
+        } else {
+            ovs_be128 vip6_value;
+
+            memcpy(&vip6_value, &lb_vip->vip, sizeof vip6_value);
+            match_set_dl_type(&match, htons(ETH_TYPE_IPV6));
+            match_set_xxreg(&match, MFF_LOG_LB_ORIG_DIP_IPV6 - MFF_LOG_XXREG0,
+                            ntoh128(vip6_value));
+        }
+        if (has_l4_port) {
+            match_set_nw_proto(&match, lb->proto);
+            match_set_reg_masked(&match, MFF_LOG_LB_ORIG_TP_DPORT - MFF_REG0,
+                                 lb_vip->vip_port, UINT16_MAX);
+        }
+        match_set_lb_natted(&match, use_ct_mark);
+        add_lb_hairpin_conj_clause(lb, &match, start_conj_id + idx, 0,
+                                   flow_table);
+
+        for (size_t j = 0; j < lb_vip->n_backends; j++) {
+            const struct ovn_lb_backend *lb_backend = &lb_vip->backends[j];
+            char ip_s[INET6_ADDRSTRLEN];
+            size_t n_backends = sset_count(&backends);
+
+            ipv6_string_mapped(ip_s, &lb_backend->ip);
+            sset_add_and_free(&backends,
+                              xasprintf("%"PRIuSIZE" %s %"PRIu16, idx, ip_s,
+                                        lb_backend->port));
+            if (sset_count(&backends) == n_backends) {
+                continue;
+            }
+
+            match_init_catchall(&match);
+            if (!ipv6) {
+                ovs_be32 bip4 = in6_addr_get_mapped_ipv4(&lb_backend->ip);
+
+                match_set_dl_type(&match, htons(ETH_TYPE_IP));
+                match_set_nw_src(&match, bip4);
+                match_set_nw_dst(&match, bip4);
+            } else {
+                match_set_dl_type(&match, htons(ETH_TYPE_IPV6));
+                match_set_ipv6_src(&match, &lb_backend->ip);
+                match_set_ipv6_dst(&match, &lb_backend->ip);
+            }
+            if (has_l4_port) {
+                match_set_nw_proto(&match, lb->proto);
+                match_set_tp_dst(&match, htons(lb_backend->port));
+            }
+            add_lb_hairpin_conj_clause(lb, &match, start_conj_id + idx, 1,
+                                       flow_table);
+        }
+    }
+    sset_destroy(&backends);
+
+    uint64_t stub[1024 / 8];
+    struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(stub);
+    for (size_t ipv6 = 0; ipv6 < 2; ipv6++) {
+        for (size_t has_l4_port = 0; has_l4_port < 2; has_l4_port++) {
+            size_t idx = lb_hairpin_conj_index(ipv6, has_l4_port);
+            if (!used[idx]) {
+                continue;
+            }
 
-        ofctrl_add_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
-                        lb->slb->header_.uuid.parts[0], &hairpin_match,
-                        &ofpacts, &lb->slb->header_.uuid);
-    }
+            union mf_value imm_vip;
+            const union mf_value *vip = NULL;
+            if (!ipv6 && lb->hairpin_snat_ips.n_ipv4_addrs) {
+                imm_vip.be32 = lb->hairpin_snat_ips.ipv4_addrs[0].addr;
+                vip = &imm_vip;
+            } else if (ipv6 && lb->hairpin_snat_ips.n_ipv6_addrs) {
+                imm_vip.ipv6 = lb->hairpin_snat_ips.ipv6_addrs[0].addr;
+                vip = &imm_vip;
+            }
 
+            ofpbuf_clear(&ofpacts);
+            uint8_t value = 1;
+            put_load(&value, sizeof value, MFF_LOG_FLAGS,
+                     MLF_LOOKUP_LB_HAIRPIN_BIT, 1, &ofpacts);
+            add_lb_vip_hairpin_reply_action(ipv6, vip, lb->proto,
+                                            has_l4_port, lb_uuid->parts[0],
+                                            &ofpacts);
+
+            struct match match = MATCH_CATCHALL_INITIALIZER;
+            match_set_conj_id(&match, start_conj_id + idx);
+            ofctrl_add_flow(flow_table, OFTABLE_CHK_LB_HAIRPIN, 100,
+                            lb_uuid->parts[0], &match, &ofpacts, lb_uuid);
+        }
+    }
     ofpbuf_uninit(&ofpacts);
+    return true;
 }
 
 static void
@@ -1968,16 +3293,19 @@ static void
 consider_lb_hairpin_flows(const struct ovn_controller_lb *lb,
                           const struct hmap *local_datapaths,
                           bool use_ct_mark,
+                          struct conj_ids *conj_ids,
                           struct ovn_desired_flow_table *flow_table)
 {
-    for (size_t i = 0; i < lb->n_vips; i++) {
-        struct ovn_lb_vip *lb_vip = &lb->vips[i];
+    if (!add_lb_conj_hairpin_flows(lb, use_ct_mark, conj_ids, flow_table)) {
+        for (size_t i = 0; i < lb->n_vips; i++) {
+            struct ovn_lb_vip *lb_vip = &lb->vips[i];
 
-        for (size_t j = 0; j < lb_vip->n_backends; j++) {
-            struct ovn_lb_backend *lb_backend = &lb_vip->backends[j];
+            for (size_t j = 0; j < lb_vip->n_backends; j++) {
+                struct ovn_lb_backend *lb_backend = &lb_vip->backends[j];
 
-            add_lb_vip_hairpin_flows(lb, lb_vip, lb_backend,
-                                     use_ct_mark, flow_table);
+                add_lb_vip_hairpin_flows(lb, lb_vip, lb_backend,
+                                         use_ct_mark, flow_table);
+            }
         }
     }
 
@@ -1990,12 +3318,30 @@ static void
 add_lb_hairpin_flows(const struct hmap *local_lbs,
                      const struct hmap *local_datapaths,
                      bool use_ct_mark,
+                     struct conj_ids *conj_ids,
                      struct ovn_desired_flow_table *flow_table)
 {
     const struct ovn_controller_lb *lb;
     HMAP_FOR_EACH (lb, hmap_node, local_lbs) {
         consider_lb_hairpin_flows(lb, local_datapaths,
-                                  use_ct_mark, flow_table);
+                                  use_ct_mark, conj_ids, flow_table);
+    }
+}
+
+/* Adds to 'usage' the number of desired flows of the load balancers in
+ * 'local_lbs', i.e., of their hairpin flows. */
+void
+lflow_get_lb_hairpin_usage(const struct hmap *local_lbs,
+                           const struct ovn_desired_flow_table *flow_table,
+                           struct simap *usage)
+{
+    const struct ovn_controller_lb *lb;
+    HMAP_FOR_EACH (lb, hmap_node, local_lbs) {
+        simap_increase(usage, "lb_hairpin_flows",
+                       ofctrl_count_flows(flow_table, &lb->slb->header_.uuid));
+        if (lb->hairpin_conjunctive) {
+            simap_increase(usage, "lb_hairpin_conjunctive", 1);
+        }
     }
 }
 
@@ -2033,6 +3379,28 @@ lflow_handle_changed_mac_bindings(
     }
 }
 
+/* Handles a change of the MAC binding aging threshold of the local datapath
+ * 'dp', by adding its learnt MAC bindings' flows again, with or without the
+ * flows that mark them as used. */
+void
+lflow_handle_changed_mac_binding_aging(const struct sbrec_datapath_binding *dp,
+                                       struct lflow_ctx_in *l_ctx_in,
+                                       struct lflow_ctx_out *l_ctx_out)
+{
+    struct sbrec_mac_binding *mb_index_row = sbrec_mac_binding_index_init_row(
+        l_ctx_in->sbrec_mac_binding_by_datapath);
+    sbrec_mac_binding_index_set_datapath(mb_index_row, dp);
+    const struct sbrec_mac_binding *mb;
+    SBREC_MAC_BINDING_FOR_EACH_EQUAL (
+        mb, mb_index_row, l_ctx_in->sbrec_mac_binding_by_datapath) {
+        ofctrl_remove_flows(l_ctx_out->flow_table, &mb->header_.uuid);
+        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
+                               l_ctx_in->local_datapaths,
+                               mb, NULL, l_ctx_out->flow_table, 100);
+    }
+    sbrec_mac_binding_index_destroy_row(mb_index_row);
+}
+
 /* Handles changes to static_mac_binding table. */
 void
 lflow_handle_changed_static_mac_bindings(
@@ -2123,20 +3491,156 @@ consider_fdb_flows(const struct sbrec_fdb *fdb,
     ofpbuf_uninit(&ofpacts);
 }
 
-/* Adds an OpenFlow flow to flow tables for each MAC binding in the OVN
- * southbound database. */
+/* Adds the OpenFlow flows of the FDB entries of the datapath with tunnel key
+ * 'dp_key', or only of the ones learnt on its port 'port_key' if it's
+ * nonzero.  If 'readd' is true, the flows previously added for the entries
+ * are removed first. */
 static void
-add_fdb_flows(const struct sbrec_fdb_table *fdb_table,
-              const struct hmap *local_datapaths,
-              struct ovn_desired_flow_table *flow_table,
-              struct ovsdb_idl_index *sbrec_port_binding_by_key,
-              bool localnet_learn_fdb)
+add_fdb_flows_for_datapath(uint32_t dp_key, uint32_t port_key, bool readd,
+                           const struct lflow_ctx_in *l_ctx_in,
+                           struct lflow_ctx_out *l_ctx_out)
 {
+    struct ovsdb_idl_index *index = port_key
+                                    ? l_ctx_in->sbrec_fdb_by_dp_key_port_key
+                                    : l_ctx_in->sbrec_fdb_by_dp_key;
+    struct sbrec_fdb *fdb_index_row = sbrec_fdb_index_init_row(index);
+    sbrec_fdb_index_set_dp_key(fdb_index_row, dp_key);
+    if (port_key) {
+        sbrec_fdb_index_set_port_key(fdb_index_row, port_key);
+    }
+
     const struct sbrec_fdb *fdb;
-    SBREC_FDB_TABLE_FOR_EACH (fdb, fdb_table) {
-        consider_fdb_flows(fdb, local_datapaths, flow_table,
-                           sbrec_port_binding_by_key, localnet_learn_fdb);
+    SBREC_FDB_FOR_EACH_EQUAL (fdb, fdb_index_row, index) {
+        if (readd) {
+            ofctrl_remove_flows(l_ctx_out->flow_table, &fdb->header_.uuid);
+        }
+        consider_fdb_flows(fdb, l_ctx_in->local_datapaths,
+                           l_ctx_out->flow_table,
+                           l_ctx_in->sbrec_port_binding_by_key,
+                           l_ctx_in->localnet_learn_fdb);
+    }
+    sbrec_fdb_index_destroy_row(fdb_index_row);
+}
+
+/* Adds an OpenFlow flow to flow tables for each FDB entry of the local
+ * datapaths. */
+static void
+add_fdb_flows(const struct lflow_ctx_in *l_ctx_in,
+              struct lflow_ctx_out *l_ctx_out)
+{
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, l_ctx_in->local_datapaths) {
+        add_fdb_flows_for_datapath(ld->datapath->tunnel_key, 0, false,
+                                   l_ctx_in, l_ctx_out);
+    }
+}
+
+/* Marks as prioritized the flows of the logical flows that reference the
+ * resource 'name' of type 'type'. */
+static void
+lflow_prioritize_flows_for_resource(enum objdep_type type, const char *name,
+                                    struct lflow_ctx_out *l_ctx_out)
+{
+    struct resource_to_objects_node *resource_node =
+        objdep_mgr_find_objs(l_ctx_out->lflow_deps_mgr, type, name);
+    if (!resource_node) {
+        return;
+    }
+
+    struct objdep_ref *ref;
+    RESOURCE_FOR_EACH_OBJ (ref, resource_node) {
+        ofctrl_prioritize_flows(
+            l_ctx_out->flow_table,
+            objdep_mgr_ref_obj_uuid(l_ctx_out->lflow_deps_mgr, ref));
+    }
+}
+
+/* Marks the flows of 'pb' and of the logical flows that reference it as
+ * prioritized if 'pb' is a port whose flows ovn-controller is waiting for
+ * before reporting it up, see ofctrl_prioritize_flows().  Returns true if
+ * it is one.  The flows of its port groups are left to
+ * lflow_prioritize_flows_for_port_groups(). */
+static bool
+lflow_prioritize_flows_for_lport(const struct sbrec_port_binding *pb,
+                                 const struct lflow_ctx_in *l_ctx_in,
+                                 struct lflow_ctx_out *l_ctx_out)
+{
+    if (!pb || !l_ctx_in->if_mgr
+        || !if_status_mgr_iface_is_installing(l_ctx_in->if_mgr,
+                                              pb->logical_port)) {
+        return false;
+    }
+
+    ofctrl_prioritize_flows(l_ctx_out->flow_table, &pb->header_.uuid);
+    lflow_prioritize_flows_for_resource(OBJDEP_TYPE_PORTBINDING,
+                                        pb->logical_port, l_ctx_out);
+    return true;
+}
+
+/* Marks as prioritized the flows of the logical flows that reference the
+ * port groups that contain any of 'lports', e.g. the ACLs of "inport ==
+ * @pg", so that a port isn't reported up before its ACLs are enforced. */
+static void
+lflow_prioritize_flows_for_port_groups(const struct sset *lports,
+                                       const struct lflow_ctx_in *l_ctx_in,
+                                       struct lflow_ctx_out *l_ctx_out)
+{
+    if (sset_is_empty(lports)) {
+        return;
+    }
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, l_ctx_in->port_groups) {
+        const struct expr_constant_set *lports_cs = node->data;
+
+        for (size_t i = 0; i < lports_cs->n_values; i++) {
+            if (sset_contains(lports, lports_cs->values[i].string)) {
+                lflow_prioritize_flows_for_resource(OBJDEP_TYPE_PORTGROUP,
+                                                    node->name, l_ctx_out);
+                break;
+            }
+        }
+    }
+}
+
+/* Adds to 'deferred_ldps', and their datapaths' UUIDs to 'deferred_dps', the
+ * local datapaths that have no local VIF, unless none of them has any. */
+static void
+lflow_defer_datapaths(const struct lflow_ctx_in *l_ctx_in,
+                      struct uuidset *deferred_dps)
+{
+    struct hmapx vif_ldps = HMAPX_INITIALIZER(&vif_ldps);
+    struct shash_node *node;
+
+    SHASH_FOR_EACH (node, l_ctx_in->binding_lports) {
+        const struct binding_lport *b_lport = node->data;
+
+        if (!b_lport->pb || (b_lport->type != LP_VIF
+                             && b_lport->type != LP_CONTAINER
+                             && b_lport->type != LP_VIRTUAL)) {
+            continue;
+        }
+
+        const struct local_datapath *ldp =
+            get_local_datapath(l_ctx_in->local_datapaths,
+                               b_lport->pb->datapath->tunnel_key);
+        if (ldp) {
+            hmapx_add(&vif_ldps, CONST_CAST(struct local_datapath *, ldp));
+        }
+    }
+
+    if (!hmapx_is_empty(&vif_ldps)) {
+        struct local_datapath *ldp;
+
+        HMAP_FOR_EACH (ldp, hmap_node, l_ctx_in->local_datapaths) {
+            if (!hmapx_contains(&vif_ldps, ldp)) {
+                hmapx_add(&deferred_ldps, ldp);
+                uuidset_insert(deferred_dps, &ldp->datapath->header_.uuid);
+            }
+        }
+        COVERAGE_ADD(lflow_deferred_datapath, hmapx_count(&deferred_ldps));
     }
+    hmapx_destroy(&vif_ldps);
 }
 
 
@@ -2147,22 +3651,51 @@ lflow_run(struct lflow_ctx_in *l_ctx_in, struct lflow_ctx_out *l_ctx_out)
 {
     COVERAGE_INC(lflow_run);
 
+    if (l_ctx_out->deferred_dps) {
+        lflow_defer_datapaths(l_ctx_in, l_ctx_out->deferred_dps);
+    }
+
+    /* The flow table was cleared. */
+    uuidset_clear(&lflows_over_budget);
+    dp_groups_members_clear();
+    const struct sbrec_logical_dp_group *dpg;
+    SBREC_LOGICAL_DP_GROUP_TABLE_FOR_EACH (dpg,
+                                           l_ctx_in->logical_dp_group_table) {
+        dp_group_members_set(dpg, NULL);
+    }
+    struct lflow_cost *cost;
+    HMAP_FOR_EACH (cost, hmap_node, &lflow_costs) {
+        cost->n_flows = 0;
+        cost->n_bytes = 0;
+    }
+
     add_logical_flows(l_ctx_in, l_ctx_out);
-    add_neighbor_flows(l_ctx_in->sbrec_port_binding_by_name,
-                       l_ctx_in->mac_binding_table,
-                       l_ctx_in->static_mac_binding_table,
-                       l_ctx_in->local_datapaths,
-                       l_ctx_out->flow_table);
+    hmapx_clear(&deferred_ldps);
+    add_neighbor_flows(l_ctx_in, l_ctx_out);
     add_lb_hairpin_flows(l_ctx_in->local_lbs,
                          l_ctx_in->local_datapaths,
                          l_ctx_in->lb_hairpin_use_ct_mark,
+                         l_ctx_out->conj_ids,
                          l_ctx_out->flow_table);
-    add_fdb_flows(l_ctx_in->fdb_table, l_ctx_in->local_datapaths,
-                  l_ctx_out->flow_table,
-                  l_ctx_in->sbrec_port_binding_by_key,
-                  l_ctx_in->localnet_learn_fdb);
+    add_fdb_flows(l_ctx_in, l_ctx_out);
     add_port_sec_flows(l_ctx_in->binding_lports, l_ctx_in->chassis,
                        l_ctx_out->flow_table);
+
+    if (l_ctx_in->if_mgr) {
+        struct sset installing = SSET_INITIALIZER(&installing);
+        const char *iface_id;
+
+        if_status_mgr_get_installing_ifaces(l_ctx_in->if_mgr, &installing);
+        SSET_FOR_EACH (iface_id, &installing) {
+            lflow_prioritize_flows_for_lport(
+                lport_lookup_by_name(l_ctx_in->sbrec_port_binding_by_name,
+                                     iface_id),
+                l_ctx_in, l_ctx_out);
+        }
+        lflow_prioritize_flows_for_port_groups(&installing, l_ctx_in,
+                                               l_ctx_out);
+        sset_destroy(&installing);
+    }
 }
 
 /* Should be called at every ovn-controller iteration before IDL tracked
@@ -2185,17 +3718,24 @@ lflow_handle_cached_flows(struct lflow_cache *lc,
 void
 lflow_destroy(void)
 {
+    ovnacts_encode_cache_destroy(ovnacts_cache);
+    ovnacts_cache = NULL;
     expr_symtab_destroy(&symtab);
     shash_destroy(&symtab);
+    lflow_cost_clear();
+    uuidset_destroy(&lflows_over_budget);
+    dp_groups_members_clear();
+    if (lflow_xlate_wq_inited) {
+        ovn_work_queue_destroy(&lflow_xlate_wq);
+        lflow_xlate_wq_inited = false;
+    }
 }
 
-bool
-lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *dp,
-                             struct lflow_ctx_in *l_ctx_in,
-                             struct lflow_ctx_out *l_ctx_out)
+static void
+add_logical_flows_for_datapath(const struct sbrec_datapath_binding *dp,
+                               struct lflow_ctx_in *l_ctx_in,
+                               struct lflow_ctx_out *l_ctx_out)
 {
-    bool handled = true;
-
     struct sbrec_logical_flow *lf_row = sbrec_logical_flow_index_init_row(
         l_ctx_in->sbrec_logical_flow_by_logical_datapath);
     sbrec_logical_flow_index_set_logical_datapath(lf_row, dp);
@@ -2242,49 +3782,170 @@ lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *dp,
         }
     }
     sbrec_logical_flow_index_destroy_row(lf_row);
+}
 
-    struct sbrec_fdb *fdb_index_row =
-        sbrec_fdb_index_init_row(l_ctx_in->sbrec_fdb_by_dp_key);
-    sbrec_fdb_index_set_dp_key(fdb_index_row, dp->tunnel_key);
-    const struct sbrec_fdb *fdb_row;
-    SBREC_FDB_FOR_EACH_EQUAL (fdb_row, fdb_index_row,
-                              l_ctx_in->sbrec_fdb_by_dp_key) {
-        consider_fdb_flows(fdb_row, l_ctx_in->local_datapaths,
-                           l_ctx_out->flow_table,
-                           l_ctx_in->sbrec_port_binding_by_key,
-                           l_ctx_in->localnet_learn_fdb);
+/* Handles the change of the datapaths of 'dpg', whose datapaths were
+ * 'members' the last time that its logical flows were translated.  The
+ * logical flows are translated for the local datapaths added to the group,
+ * leaving the flows of the other datapaths untouched, unless local datapaths
+ * were removed from the group, since the flows of a logical flow aren't
+ * tracked by datapath, in which case the logical flows are reprocessed. */
+static void
+lflow_handle_dp_group_update(const struct sbrec_logical_dp_group *dpg,
+                             const struct dp_group_members *members,
+                             const struct sbrec_datapath_binding **dps,
+                             struct lflow_ctx_in *l_ctx_in,
+                             struct lflow_ctx_out *l_ctx_out,
+                             bool *changed)
+{
+    const struct sbrec_datapath_binding **added_dps = NULL;
+    size_t n_added = 0;
+    bool removed_local = false;
+    size_t oi = 0, ni = 0;
+
+    /* Both 'members->dps' and 'dps' are sorted by UUID. */
+    added_dps = xmalloc(dpg->n_datapaths * sizeof *added_dps);
+    while (oi < members->n_dps || ni < dpg->n_datapaths) {
+        int d = (oi >= members->n_dps ? 1
+                 : ni >= dpg->n_datapaths ? -1
+                 : uuid_compare_3way(&members->dps[oi],
+                                     &dps[ni]->header_.uuid));
+        if (d < 0) {
+            /* Removed from the group.  The datapath may not exist anymore,
+             * so look for it among the local datapaths. */
+            const struct local_datapath *ldp;
+            HMAP_FOR_EACH (ldp, hmap_node, l_ctx_in->local_datapaths) {
+                if (uuid_equals(&ldp->datapath->header_.uuid,
+                                &members->dps[oi])) {
+                    removed_local = true;
+                    break;
+                }
+            }
+            oi++;
+        } else if (d > 0) {
+            if (get_local_datapath(l_ctx_in->local_datapaths,
+                                   dps[ni]->tunnel_key)) {
+                added_dps[n_added++] = dps[ni];
+            }
+            ni++;
+        } else {
+            oi++;
+            ni++;
+        }
     }
-    sbrec_fdb_index_destroy_row(fdb_index_row);
 
-    struct sbrec_mac_binding *mb_index_row = sbrec_mac_binding_index_init_row(
-        l_ctx_in->sbrec_mac_binding_by_datapath);
-    sbrec_mac_binding_index_set_datapath(mb_index_row, dp);
-    const struct sbrec_mac_binding *mb;
-    SBREC_MAC_BINDING_FOR_EACH_EQUAL (
-        mb, mb_index_row, l_ctx_in->sbrec_mac_binding_by_datapath) {
-        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
-                               l_ctx_in->local_datapaths,
-                               mb, NULL, l_ctx_out->flow_table, 100);
+    if (!n_added && !removed_local) {
+        /* The flows of the non-local datapaths weren't added. */
+        free(added_dps);
+        return;
     }
-    sbrec_mac_binding_index_destroy_row(mb_index_row);
 
-    struct sbrec_static_mac_binding *smb_index_row =
-        sbrec_static_mac_binding_index_init_row(
-            l_ctx_in->sbrec_static_mac_binding_by_datapath);
-    sbrec_static_mac_binding_index_set_datapath(smb_index_row, dp);
-    const struct sbrec_static_mac_binding *smb;
-    SBREC_STATIC_MAC_BINDING_FOR_EACH_EQUAL (
-        smb, smb_index_row, l_ctx_in->sbrec_static_mac_binding_by_datapath) {
-        consider_neighbor_flow(l_ctx_in->sbrec_port_binding_by_name,
-                               l_ctx_in->local_datapaths,
-                               NULL, smb, l_ctx_out->flow_table,
-                               smb->override_dynamic_mac ? 150 : 50);
+    struct uuidset reprocess = UUIDSET_INITIALIZER(&reprocess);
+    struct sbrec_logical_flow *lf_row = sbrec_logical_flow_index_init_row(
+        l_ctx_in->sbrec_logical_flow_by_logical_dp_group);
+    sbrec_logical_flow_index_set_logical_dp_group(lf_row, dpg);
+
+    const struct sbrec_logical_flow *lflow;
+    SBREC_LOGICAL_FLOW_FOR_EACH_EQUAL (
+        lflow, lf_row, l_ctx_in->sbrec_logical_flow_by_logical_dp_group) {
+        if (uuidset_find(l_ctx_out->objs_processed, &lflow->header_.uuid)) {
+            continue;
+        }
+        *changed = true;
+        if (removed_local) {
+            uuidset_insert(&reprocess, &lflow->header_.uuid);
+            continue;
+        }
+
+        uuidset_insert(l_ctx_out->objs_processed, &lflow->header_.uuid);
+        for (size_t i = 0; i < n_added; i++) {
+            consider_logical_flow__(lflow, added_dps[i], l_ctx_in,
+                                    l_ctx_out);
+        }
+        COVERAGE_INC(lflow_dp_group_add_dps);
     }
-    sbrec_static_mac_binding_index_destroy_row(smb_index_row);
+    sbrec_logical_flow_index_destroy_row(lf_row);
+
+    if (!uuidset_is_empty(&reprocess)) {
+        VLOG_DBG("Local datapaths removed from datapath group "UUID_FMT", "
+                 "reprocess its lflows.", UUID_ARGS(&dpg->header_.uuid));
+        lflow_reprocess(&reprocess, l_ctx_in, l_ctx_out);
+    }
+    uuidset_destroy(&reprocess);
+    free(added_dps);
+}
+
+/* Handles the changes of the datapaths of the datapath groups.  The logical
+ * flows that use an updated datapath group are skipped by
+ * lflow_handle_changed_flows() if nothing else changed for them, since
+ * reprocessing them would translate them again for all the datapaths of the
+ * group, which may be many more than the ones that changed. */
+bool
+lflow_handle_changed_dp_groups(struct lflow_ctx_in *l_ctx_in,
+                               struct lflow_ctx_out *l_ctx_out,
+                               bool *changed)
+{
+    const struct sbrec_logical_dp_group *dpg;
+
+    *changed = false;
+    SBREC_LOGICAL_DP_GROUP_TABLE_FOR_EACH_TRACKED (
+            dpg, l_ctx_in->logical_dp_group_table) {
+        struct dp_group_members *members =
+            dp_group_members_find(&dpg->header_.uuid);
+
+        if (sbrec_logical_dp_group_is_deleted(dpg)) {
+            if (members) {
+                dp_group_members_destroy(members);
+            }
+            continue;
+        }
+
+        const struct sbrec_datapath_binding **dps = dp_group_sorted_dps(dpg);
+        if (members && !sbrec_logical_dp_group_is_new(dpg)
+            && sbrec_logical_dp_group_is_updated(
+                    dpg, SBREC_LOGICAL_DP_GROUP_COL_DATAPATHS)) {
+            lflow_handle_dp_group_update(dpg, members, dps, l_ctx_in,
+                                         l_ctx_out, changed);
+        }
+        dp_group_members_set(dpg, dps);
+        free(dps);
+    }
+    return true;
+}
+
+bool
+lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *dp,
+                             struct lflow_ctx_in *l_ctx_in,
+                             struct lflow_ctx_out *l_ctx_out)
+{
+    bool handled = true;
+
+    add_logical_flows_for_datapath(dp, l_ctx_in, l_ctx_out);
+    add_fdb_flows_for_datapath(dp->tunnel_key, 0, false, l_ctx_in, l_ctx_out);
+
+    add_neighbor_flows_for_datapath(dp, l_ctx_in, l_ctx_out);
 
     return handled;
 }
 
+/* Adds the logical flows that lflow_run() left out for the datapaths in
+ * 'deferred_dps' that are still local, then clears 'deferred_dps'. */
+void
+lflow_add_deferred_flows(struct uuidset *deferred_dps,
+                         struct lflow_ctx_in *l_ctx_in,
+                         struct lflow_ctx_out *l_ctx_out)
+{
+    const struct local_datapath *ldp;
+
+    HMAP_FOR_EACH (ldp, hmap_node, l_ctx_in->local_datapaths) {
+        if (uuidset_find(deferred_dps, &ldp->datapath->header_.uuid)) {
+            add_logical_flows_for_datapath(ldp->datapath, l_ctx_in,
+                                           l_ctx_out);
+        }
+    }
+    uuidset_clear(deferred_dps);
+}
+
 /* Handles a port-binding change that is possibly related to a lport's
  * residence status on this chassis. */
 bool
@@ -2316,14 +3977,20 @@ lflow_handle_flows_for_lport(const struct sbrec_port_binding *pb,
                                           pb->logical_port)) {
         consider_port_sec_flows(pb, l_ctx_out->flow_table);
     }
-    if (l_ctx_in->localnet_learn_fdb_changed && l_ctx_in->localnet_learn_fdb) {
-        const struct sbrec_fdb *fdb;
-        SBREC_FDB_TABLE_FOR_EACH (fdb, l_ctx_in->fdb_table) {
-            consider_fdb_flows(fdb, l_ctx_in->local_datapaths,
-                               l_ctx_out->flow_table,
-                               l_ctx_in->sbrec_port_binding_by_key,
-                               l_ctx_in->localnet_learn_fdb);
-        }
+    /* The flows of the FDB entries learnt on the port depend on its
+     * type. */
+    if (get_local_datapath(l_ctx_in->local_datapaths,
+                           pb->datapath->tunnel_key)) {
+        add_fdb_flows_for_datapath(pb->datapath->tunnel_key, pb->tunnel_key,
+                                   true, l_ctx_in, l_ctx_out);
+    }
+
+    if (lflow_prioritize_flows_for_lport(pb, l_ctx_in, l_ctx_out)) {
+        struct sset lports = SSET_INITIALIZER(&lports);
+
+        sset_add(&lports, pb->logical_port);
+        lflow_prioritize_flows_for_port_groups(&lports, l_ctx_in, l_ctx_out);
+        sset_destroy(&lports);
     }
     return true;
 }
@@ -2383,6 +4050,37 @@ lflow_handle_changed_mc_groups(struct lflow_ctx_in *l_ctx_in,
     return ret;
 }
 
+/* Removes the hairpin flows of load balancer 'lb_uuid', whose previous
+ * version is 'old_lb'.  Its conjunctive hairpin flows, if any, may be shared
+ * with other load balancers, so the flows of these are removed as well and
+ * their uuids added to 'readd'. */
+static void
+lflow_remove_lb_hairpin_flows(const struct ovn_controller_lb *old_lb,
+                              const struct uuid *lb_uuid,
+                              struct lflow_ctx_out *l_ctx_out,
+                              struct uuidset *readd)
+{
+    if (!old_lb || !old_lb->hairpin_conjunctive) {
+        ofctrl_remove_flows(l_ctx_out->flow_table, lb_uuid);
+        lflow_conj_ids_free(l_ctx_out->conj_ids, lb_uuid);
+        return;
+    }
+
+    struct uuidset flood_remove_nodes =
+        UUIDSET_INITIALIZER(&flood_remove_nodes);
+    uuidset_insert(&flood_remove_nodes, lb_uuid);
+    ofctrl_flood_remove_flows(l_ctx_out->flow_table, &flood_remove_nodes);
+
+    struct uuidset_node *ofrn;
+    UUIDSET_FOR_EACH (ofrn, &flood_remove_nodes) {
+        lflow_conj_ids_free(l_ctx_out->conj_ids, &ofrn->uuid);
+        if (!uuid_equals(&ofrn->uuid, lb_uuid)) {
+            uuidset_insert(readd, &ofrn->uuid);
+        }
+    }
+    uuidset_destroy(&flood_remove_nodes);
+}
+
 bool
 lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
                          struct lflow_ctx_out *l_ctx_out,
@@ -2392,6 +4090,7 @@ lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
                          const struct hmap *old_lbs)
 {
     const struct ovn_controller_lb *lb;
+    struct uuidset readd = UUIDSET_INITIALIZER(&readd);
 
     struct uuidset_node *uuid_node;
     UUIDSET_FOR_EACH (uuid_node, deleted_lbs) {
@@ -2399,19 +4098,36 @@ lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
 
         VLOG_DBG("Remove hairpin flows for deleted load balancer "UUID_FMT,
                  UUID_ARGS(&uuid_node->uuid));
-        ofctrl_remove_flows(l_ctx_out->flow_table, &uuid_node->uuid);
+        lflow_remove_lb_hairpin_flows(lb, &uuid_node->uuid, l_ctx_out,
+                                      &readd);
     }
 
     UUIDSET_FOR_EACH (uuid_node, updated_lbs) {
-        lb = ovn_controller_lb_find(l_ctx_in->local_lbs, &uuid_node->uuid);
+        lb = ovn_controller_lb_find(old_lbs, &uuid_node->uuid);
 
         VLOG_DBG("Remove and add hairpin flows for updated load balancer "
                   UUID_FMT, UUID_ARGS(&uuid_node->uuid));
-        ofctrl_remove_flows(l_ctx_out->flow_table, &uuid_node->uuid);
-        consider_lb_hairpin_flows(lb, l_ctx_in->local_datapaths,
-                                  l_ctx_in->lb_hairpin_use_ct_mark,
-                                  l_ctx_out->flow_table);
+        lflow_remove_lb_hairpin_flows(lb, &uuid_node->uuid, l_ctx_out,
+                                      &readd);
+        uuidset_insert(&readd, &uuid_node->uuid);
+    }
+
+    /* Add back the flows of the updated load balancers and of the ones that
+     * shared flows with the removed ones. */
+    UUIDSET_FOR_EACH (uuid_node, &readd) {
+        if (uuidset_find(deleted_lbs, &uuid_node->uuid)
+            || uuidset_find(new_lbs, &uuid_node->uuid)) {
+            continue;
+        }
+        lb = ovn_controller_lb_find(l_ctx_in->local_lbs, &uuid_node->uuid);
+        if (lb) {
+            consider_lb_hairpin_flows(lb, l_ctx_in->local_datapaths,
+                                      l_ctx_in->lb_hairpin_use_ct_mark,
+                                      l_ctx_out->conj_ids,
+                                      l_ctx_out->flow_table);
+        }
     }
+    uuidset_destroy(&readd);
 
     UUIDSET_FOR_EACH (uuid_node, new_lbs) {
         lb = ovn_controller_lb_find(l_ctx_in->local_lbs, &uuid_node->uuid);
@@ -2420,12 +4136,28 @@ lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
                  UUID_ARGS(&uuid_node->uuid));
         consider_lb_hairpin_flows(lb, l_ctx_in->local_datapaths,
                                   l_ctx_in->lb_hairpin_use_ct_mark,
+                                  l_ctx_out->conj_ids,
                                   l_ctx_out->flow_table);
     }
 
     return true;
 }
 
+/* Handles a change of the localnet_learn_fdb option of the local localnet
+ * ports, by adding again the flows of the FDB entries of the local
+ * datapaths, with or without the ones that look them up for the packets
+ * received from a localnet port. */
+void
+lflow_handle_changed_localnet_learn_fdb(struct lflow_ctx_in *l_ctx_in,
+                                        struct lflow_ctx_out *l_ctx_out)
+{
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, l_ctx_in->local_datapaths) {
+        add_fdb_flows_for_datapath(ld->datapath->tunnel_key, 0, true,
+                                   l_ctx_in, l_ctx_out);
+    }
+}
+
 bool
 lflow_handle_changed_fdbs(struct lflow_ctx_in *l_ctx_in,
                          struct lflow_ctx_out *l_ctx_out)
@@ -2487,28 +4219,77 @@ reset_match_for_port_sec_flows(const struct sbrec_port_binding *pb,
     match_set_reg(match, reg_id - MFF_REG0, pb->tunnel_key);
 }
 
-static void build_port_sec_deny_action(struct ofpbuf *ofpacts)
+/* The parts of the port security flows that are the same for all the ports:
+ * their actions and the constant addresses they match on.  They are built
+ * once, so that the flows of each port are only the copy of these with the
+ * keys and addresses of the port filled in. */
+struct port_sec_template {
+    struct ofpbuf deny;         /* "port_sec_failed = 1;" */
+    struct ofpbuf allow;        /* "port_sec_failed = 0;" */
+    struct ofpbuf adv_nd;       /* "resubmit(,PORT_SEC_ND_TABLE);" */
+
+    struct in6_addr mld_dst;    /* ff02::/16 */
+    struct in6_addr mld_dst_mask;
+    struct in6_addr mcast_dst;  /* ff00::/8 */
+    struct in6_addr mcast_dst_mask;
+};
+
+static const struct port_sec_template *
+port_sec_template_get(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    static struct port_sec_template tmpl;
+
+    if (ovsthread_once_start(&once)) {
+        uint8_t value = 1;
+        ofpbuf_init(&tmpl.deny, 0);
+        put_load(&value, sizeof value, MFF_LOG_FLAGS,
+                 MLF_CHECK_PORT_SEC_BIT, 1, &tmpl.deny);
+
+        value = 0;
+        ofpbuf_init(&tmpl.allow, 0);
+        put_load(&value, sizeof value, MFF_LOG_FLAGS,
+                 MLF_CHECK_PORT_SEC_BIT, 1, &tmpl.allow);
+
+        ofpbuf_init(&tmpl.adv_nd, 0);
+        struct ofpact_resubmit *resubmit = ofpact_put_RESUBMIT(&tmpl.adv_nd);
+        resubmit->in_port = OFPP_IN_PORT;
+        resubmit->table_id = OFTABLE_CHK_IN_PORT_SEC_ND;
+
+        char *err = ipv6_parse_masked("ff02::/16", &tmpl.mld_dst,
+                                      &tmpl.mld_dst_mask);
+        ovs_assert(!err);
+        err = ipv6_parse_masked("ff00::/8", &tmpl.mcast_dst,
+                                &tmpl.mcast_dst_mask);
+        ovs_assert(!err);
+
+        ovsthread_once_done(&once);
+    }
+    return &tmpl;
+}
+
+static void
+put_port_sec_template_actions(struct ofpbuf *ofpacts,
+                              const struct ofpbuf *tmpl_ofpacts)
 {
     ofpbuf_clear(ofpacts);
-    uint8_t value = 1;
-    put_load(&value, sizeof value, MFF_LOG_FLAGS,
-             MLF_CHECK_PORT_SEC_BIT, 1, ofpacts);
+    ofpbuf_put(ofpacts, tmpl_ofpacts->data, tmpl_ofpacts->size);
+}
+
+static void build_port_sec_deny_action(struct ofpbuf *ofpacts)
+{
+    put_port_sec_template_actions(ofpacts, &port_sec_template_get()->deny);
 }
 
 static void build_port_sec_allow_action(struct ofpbuf *ofpacts)
 {
-    ofpbuf_clear(ofpacts);
-    uint8_t value = 0;
-    put_load(&value, sizeof value, MFF_LOG_FLAGS,
-             MLF_CHECK_PORT_SEC_BIT, 1, ofpacts);
+    put_port_sec_template_actions(ofpacts, &port_sec_template_get()->allow);
 }
 
 static void build_port_sec_adv_nd_check(struct ofpbuf *ofpacts)
 {
-    ofpbuf_clear(ofpacts);
-    struct ofpact_resubmit *resubmit = ofpact_put_RESUBMIT(ofpacts);
-    resubmit->in_port = OFPP_IN_PORT;
-    resubmit->table_id = OFTABLE_CHK_IN_PORT_SEC_ND;
+    put_port_sec_template_actions(ofpacts,
+                                  &port_sec_template_get()->adv_nd);
 }
 
 static void
@@ -2814,13 +4595,10 @@ build_in_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
      *          icmp6.code == 0 && icmp6.type == {131, 143}"
      * action - "port_sec_failed = 0;"
      */
+    const struct port_sec_template *tmpl = port_sec_template_get();
     build_port_sec_allow_action(ofpacts);
     match_set_ipv6_src(m, &in6addr_any);
-    struct in6_addr ip6, mask;
-    char *err = ipv6_parse_masked("ff02::/16", &ip6, &mask);
-    ovs_assert(!err);
-
-    match_set_ipv6_dst_masked(m, &ip6, &mask);
+    match_set_ipv6_dst_masked(m, &tmpl->mld_dst, &tmpl->mld_dst_mask);
     match_set_nw_proto(m, IPPROTO_ICMPV6);
     match_set_icmp_type(m, 131);
     match_set_icmp_code(m, 0);
@@ -3036,10 +4814,7 @@ build_out_port_sec_ip4_flows(const struct sbrec_port_binding *pb,
                  *          ip4.dst == 10.0.0.255"
                  * action - "port_sec_failed = 0;"
                  */
-                ovs_be32 bcast_addr;
-                ovs_assert(ip_parse(ps_addr->ipv4_addrs[j].bcast_s,
-                                    &bcast_addr));
-                match_set_nw_dst(m, bcast_addr);
+                match_set_nw_dst(m, ps_addr->ipv4_addrs[j].network | ~mask);
                 ofctrl_add_flow(flow_table, OFTABLE_CHK_OUT_PORT_SEC, 95,
                                 pb->header_.uuid.parts[0], m, ofpacts,
                                 &pb->header_.uuid);
@@ -3147,11 +4922,8 @@ build_out_port_sec_ip6_flows(const struct sbrec_port_binding *pb,
                     pb->header_.uuid.parts[0], m, ofpacts,
                     &pb->header_.uuid);
 
-    struct in6_addr ip6, mask;
-    char *err = ipv6_parse_masked("ff00::/8", &ip6, &mask);
-    ovs_assert(!err);
-
-    match_set_ipv6_dst_masked(m, &ip6, &mask);
+    const struct port_sec_template *tmpl = port_sec_template_get();
+    match_set_ipv6_dst_masked(m, &tmpl->mcast_dst, &tmpl->mcast_dst_mask);
     ofctrl_add_flow(flow_table, OFTABLE_CHK_OUT_PORT_SEC, 95,
                     pb->header_.uuid.parts[0], m, ofpacts,
                     &pb->header_.uuid);
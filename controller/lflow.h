@@ -43,8 +43,10 @@
 #include "openvswitch/uuid.h"
 #include "openvswitch/list.h"
 
+struct ds;
 struct hmap;
 struct hmap_node;
+struct if_status_mgr;
 struct ovn_desired_flow_table;
 struct ovn_extend_table;
 struct ovsdb_idl_index;
@@ -95,6 +97,8 @@ struct uuid;
 #define OFTABLE_CHK_LB_AFFINITY          78
 #define OFTABLE_MAC_CACHE_USE            79
 #define OFTABLE_CT_ZONE_LOOKUP           80
+#define OFTABLE_ARP_ND_RSP_LOOKUP        81
+#define OFTABLE_LAZY_DP_USE              82
 
 struct lflow_ctx_in {
     struct ovsdb_idl_index *sbrec_multicast_group_by_name_datapath;
@@ -103,6 +107,7 @@ struct lflow_ctx_in {
     struct ovsdb_idl_index *sbrec_port_binding_by_name;
     struct ovsdb_idl_index *sbrec_port_binding_by_key;
     struct ovsdb_idl_index *sbrec_fdb_by_dp_key;
+    struct ovsdb_idl_index *sbrec_fdb_by_dp_key_port_key;
     struct ovsdb_idl_index *sbrec_mac_binding_by_datapath;
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_datapath;
     const struct sbrec_port_binding_table *port_binding_table;
@@ -132,6 +137,9 @@ struct lflow_ctx_in {
     bool localnet_learn_fdb;
     bool localnet_learn_fdb_changed;
     bool explicit_arp_ns_output;
+    /* If nonnull, the flows of the ports whose flows it is waiting for are
+     * prioritized, see ofctrl_prioritize_flows(). */
+    const struct if_status_mgr *if_mgr;
 };
 
 struct lflow_ctx_out {
@@ -143,14 +151,31 @@ struct lflow_ctx_out {
     struct lflow_cache *lflow_cache;
     struct conj_ids *conj_ids;
     struct uuidset *objs_processed;
+
+    /* If nonnull, lflow_run() leaves out the logical flows of the local
+     * datapaths without local VIFs, as long as some have, and adds the UUIDs
+     * of these datapaths, for lflow_add_deferred_flows().  This gets the
+     * flows of the local VIFs installed sooner after a restart. */
+    struct uuidset *deferred_dps;
 };
 
 void lflow_init(void);
+void lflow_clear_encode_cache(void);
+void lflow_set_n_threads(size_t n_threads);
+bool lflow_set_flow_budget(unsigned int budget);
+void lflow_save_cache(const struct lflow_cache *, const char *file_name);
+void lflow_load_cache(struct lflow_cache *, const char *file_name);
+void lflow_cost_enable(bool enable);
+void lflow_cost_format(const struct sbrec_logical_flow_table *, size_t n,
+                       struct ds *);
 void lflow_run(struct lflow_ctx_in *, struct lflow_ctx_out *);
 void lflow_handle_cached_flows(struct lflow_cache *,
                                const struct sbrec_logical_flow_table *);
 bool lflow_handle_changed_flows(struct lflow_ctx_in *,
                                 struct lflow_ctx_out *);
+bool lflow_handle_changed_dp_groups(struct lflow_ctx_in *,
+                                    struct lflow_ctx_out *,
+                                    bool *changed);
 
 struct addr_set_diff {
     struct expr_constant_set *added;
@@ -160,6 +185,11 @@ bool lflow_handle_addr_set_update(const char *as_name, struct addr_set_diff *,
                                   struct lflow_ctx_in *,
                                   struct lflow_ctx_out *,
                                   bool *changed);
+bool lflow_handle_port_group_update(const char *pg_name,
+                                    struct addr_set_diff *,
+                                    struct lflow_ctx_in *,
+                                    struct lflow_ctx_out *,
+                                    bool *changed);
 bool lflow_handle_changed_ref(enum objdep_type, const char *res_name,
                               struct ovs_list *objs_todo,
                               const void *in_arg, void *out_arg);
@@ -169,6 +199,9 @@ void lflow_handle_changed_mac_bindings(
     const struct sbrec_mac_binding_table *mac_binding_table,
     const struct hmap *local_datapaths,
     struct ovn_desired_flow_table *);
+void lflow_handle_changed_mac_binding_aging(
+    const struct sbrec_datapath_binding *,
+    struct lflow_ctx_in *, struct lflow_ctx_out *);
 void lflow_handle_changed_static_mac_bindings(
     struct ovsdb_idl_index *sbrec_port_binding_by_name,
     const struct sbrec_static_mac_binding_table *smb_table,
@@ -181,11 +214,19 @@ bool lflow_handle_changed_lbs(struct lflow_ctx_in *l_ctx_in,
                               const struct uuidset *new_lbs,
                               const struct hmap *old_lbs);
 bool lflow_handle_changed_fdbs(struct lflow_ctx_in *, struct lflow_ctx_out *);
+void lflow_handle_changed_localnet_learn_fdb(struct lflow_ctx_in *,
+                                             struct lflow_ctx_out *);
+void lflow_get_lb_hairpin_usage(const struct hmap *local_lbs,
+                                const struct ovn_desired_flow_table *,
+                                struct simap *usage);
 void lflow_destroy(void);
 
 bool lflow_add_flows_for_datapath(const struct sbrec_datapath_binding *,
                                   struct lflow_ctx_in *,
                                   struct lflow_ctx_out *);
+void lflow_add_deferred_flows(struct uuidset *deferred_dps,
+                              struct lflow_ctx_in *,
+                              struct lflow_ctx_out *);
 bool lflow_handle_flows_for_lport(const struct sbrec_port_binding *,
                                   struct lflow_ctx_in *,
                                   struct lflow_ctx_out *);
@@ -17,10 +17,14 @@
 
 /* OVS includes. */
 #include "include/openvswitch/json.h"
+#include "lib/byte-order.h"
 #include "lib/hmapx.h"
+#include "lib/sset.h"
 #include "lib/flow.h"
 #include "lib/util.h"
 #include "lib/vswitch-idl.h"
+#include "openvswitch/ofp-flow.h"
+#include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
 #include "socket-util.h"
 
@@ -41,7 +45,8 @@ static struct local_datapath *add_local_datapath__(
     struct ovsdb_idl_index *sbrec_port_binding_by_name,
     int depth, const struct sbrec_datapath_binding *,
     const struct sbrec_chassis *, struct hmap *local_datapaths,
-    struct hmap *tracked_datapaths);
+    struct hmap *tracked_datapaths, const struct lazy_datapaths *,
+    struct hmapx *lazy_peer_dps);
 static void local_datapath_peer_port_add(
     struct local_datapath *, const struct sbrec_port_binding *local,
     const struct sbrec_port_binding *remote);
@@ -56,6 +61,56 @@ static bool datapath_is_transit_switch(const struct sbrec_datapath_binding *);
 
 static uint64_t local_datapath_usage;
 
+/* Two-level table of the local datapaths indexed by tunnel key, which
+ * makes get_local_datapath() a couple of array accesses instead of a hash
+ * bucket walk.  Datapath tunnel keys are at most 24 bits and are allocated
+ * densely by ovn-northd, so typically only the first leaf is populated.
+ *
+ * There is a single set of local datapaths in ovn-controller: 'map' is the
+ * first hmap that gets a local datapath added and it stays indexed until
+ * local_datapaths_destroy().  Lookups in other maps use the hmap. */
+#define LD_INDEX_LEAF_BITS 12
+#define LD_INDEX_LEAF_SIZE (1u << LD_INDEX_LEAF_BITS)
+#define LD_INDEX_N_LEAVES (1u << (24 - LD_INDEX_LEAF_BITS))
+
+static struct {
+    const struct hmap *map;
+    struct local_datapath **leaves[LD_INDEX_N_LEAVES];
+} ld_index;
+
+static void
+ld_index_insert(const struct hmap *local_datapaths, struct local_datapath *ld)
+{
+    uint32_t key = ld->datapath->tunnel_key;
+
+    if (ld_index.map != local_datapaths || key > OVN_MAX_DP_KEY) {
+        return;
+    }
+
+    size_t i = key >> LD_INDEX_LEAF_BITS;
+    if (!ld_index.leaves[i]) {
+        ld_index.leaves[i] = xcalloc(LD_INDEX_LEAF_SIZE,
+                                     sizeof *ld_index.leaves[i]);
+        local_datapath_usage += LD_INDEX_LEAF_SIZE
+                                * sizeof *ld_index.leaves[i];
+    }
+    ld_index.leaves[i][key & (LD_INDEX_LEAF_SIZE - 1)] = ld;
+}
+
+static void
+ld_index_clear(void)
+{
+    for (size_t i = 0; i < LD_INDEX_N_LEAVES; i++) {
+        if (ld_index.leaves[i]) {
+            local_datapath_usage -= LD_INDEX_LEAF_SIZE
+                                    * sizeof *ld_index.leaves[i];
+            free(ld_index.leaves[i]);
+            ld_index.leaves[i] = NULL;
+        }
+    }
+    ld_index.map = NULL;
+}
+
 /* To be used when hmap_node.hash might be wrong e.g. tunnel_key got updated */
 struct local_datapath *
 get_local_datapath_no_hash(const struct hmap *local_datapaths,
@@ -73,6 +128,12 @@ get_local_datapath_no_hash(const struct hmap *local_datapaths,
 struct local_datapath *
 get_local_datapath(const struct hmap *local_datapaths, uint32_t tunnel_key)
 {
+    if (local_datapaths == ld_index.map && tunnel_key <= OVN_MAX_DP_KEY) {
+        struct local_datapath **leaf =
+            ld_index.leaves[tunnel_key >> LD_INDEX_LEAF_BITS];
+        return leaf ? leaf[tunnel_key & (LD_INDEX_LEAF_SIZE - 1)] : NULL;
+    }
+
     struct hmap_node *node = hmap_first_with_hash(local_datapaths, tunnel_key);
     return (node
             ? CONTAINER_OF(node, struct local_datapath, hmap_node)
@@ -102,6 +163,9 @@ local_datapaths_destroy(struct hmap *local_datapaths)
         local_datapath_destroy(ld);
     }
 
+    if (ld_index.map == local_datapaths) {
+        ld_index_clear();
+    }
     hmap_destroy(local_datapaths);
 }
 
@@ -180,6 +244,259 @@ need_add_peer_to_local(
     return false;
 }
 
+struct lazy_datapath {
+    struct hmap_node hmap_node;  /* In 'active' of struct lazy_datapaths. */
+    uint32_t dp_key;
+
+    /* ofctrl seqno whose ack means that the flows of the datapath are
+     * installed, 0 if not requested yet. */
+    uint64_t install_seqno;
+    bool installed;
+};
+
+struct lazy_datapath_stats {
+    struct ovs_list list_node;
+    uint32_t dp_key;
+    uint64_t idle_age_ms;
+};
+
+void
+lazy_datapaths_init(struct lazy_datapaths *lazy)
+{
+    *lazy = (struct lazy_datapaths) {
+        .active = HMAP_INITIALIZER(&lazy->active),
+    };
+}
+
+static void
+lazy_datapaths_clear(struct lazy_datapaths *lazy)
+{
+    struct lazy_datapath *ldp;
+    HMAP_FOR_EACH_POP (ldp, hmap_node, &lazy->active) {
+        free(ldp);
+        lazy->changed = true;
+    }
+}
+
+void
+lazy_datapaths_destroy(struct lazy_datapaths *lazy)
+{
+    lazy_datapaths_clear(lazy);
+    hmap_destroy(&lazy->active);
+}
+
+void
+lazy_datapaths_set_config(struct lazy_datapaths *lazy, bool enabled,
+                          uint64_t idle_timeout_ms)
+{
+    if (enabled != lazy->enabled) {
+        lazy->enabled = enabled;
+        lazy->changed = true;
+    }
+    if (!enabled) {
+        lazy_datapaths_clear(lazy);
+    }
+    lazy->idle_timeout_ms = idle_timeout_ms;
+}
+
+static struct lazy_datapath *
+lazy_datapath_find(const struct lazy_datapaths *lazy, uint32_t dp_key)
+{
+    struct lazy_datapath *ldp;
+    HMAP_FOR_EACH_WITH_HASH (ldp, hmap_node, dp_key, &lazy->active) {
+        if (ldp->dp_key == dp_key) {
+            return ldp;
+        }
+    }
+    return NULL;
+}
+
+bool
+lazy_datapath_is_active(const struct lazy_datapaths *lazy, uint32_t dp_key)
+{
+    return lazy_datapath_find(lazy, dp_key) != NULL;
+}
+
+void
+lazy_datapath_activate(struct lazy_datapaths *lazy, uint32_t dp_key)
+{
+    if (!lazy->enabled || lazy_datapath_find(lazy, dp_key)) {
+        return;
+    }
+
+    struct lazy_datapath *ldp = xzalloc(sizeof *ldp);
+    ldp->dp_key = dp_key;
+    hmap_insert(&lazy->active, &ldp->hmap_node, dp_key);
+    lazy->changed = true;
+    lazy->request_install = true;
+}
+
+/* Returns true if 'dp_key' was activated but its flows may not be installed
+ * in OVS yet. */
+bool
+lazy_datapath_is_installing(const struct lazy_datapaths *lazy,
+                            uint32_t dp_key)
+{
+    const struct lazy_datapath *ldp = lazy_datapath_find(lazy, dp_key);
+    return ldp && !ldp->installed;
+}
+
+/* Assigns a new ofctrl seqno to the datapaths activated since the last call,
+ * which must be called once their flows are in the desired flow tables, and
+ * returns it, or returns 0 if no datapath was activated.  The caller must
+ * request the seqno from ofctrl. */
+uint64_t
+lazy_datapaths_request_install(struct lazy_datapaths *lazy)
+{
+    struct lazy_datapath *ldp;
+
+    if (!lazy->request_install) {
+        return 0;
+    }
+    lazy->request_install = false;
+
+    lazy->install_seqno++;
+    HMAP_FOR_EACH (ldp, hmap_node, &lazy->active) {
+        if (!ldp->install_seqno) {
+            ldp->install_seqno = lazy->install_seqno;
+        }
+    }
+    return lazy->install_seqno;
+}
+
+/* Marks the flows of the datapaths whose seqno is up to 'last_acked' as
+ * installed.  Returns true if any of them was not yet. */
+bool
+lazy_datapaths_install_acked(struct lazy_datapaths *lazy,
+                             uint64_t last_acked)
+{
+    struct lazy_datapath *ldp;
+    bool acked = false;
+
+    if (last_acked <= lazy->acked_seqno) {
+        return false;
+    }
+    lazy->acked_seqno = last_acked;
+
+    HMAP_FOR_EACH (ldp, hmap_node, &lazy->active) {
+        if (!ldp->installed && ldp->install_seqno
+            && ldp->install_seqno <= last_acked) {
+            ldp->installed = true;
+            acked = true;
+        }
+    }
+    return acked;
+}
+
+/* Returns true if 'peer_dp' is reached over 'router_pb', a distributed port
+ * of a router, and is a switch, which makes it a candidate for being
+ * installed on demand. */
+bool
+lazy_datapath_is_candidate(const struct lazy_datapaths *lazy,
+                           const struct sbrec_port_binding *router_pb,
+                           const struct sbrec_datapath_binding *peer_dp)
+{
+    return lazy && lazy->enabled
+           && !strcmp(router_pb->type, "patch")
+           && !datapath_is_switch(router_pb->datapath)
+           && !smap_get(&router_pb->options, "chassis-redirect-port")
+           && datapath_is_switch(peer_dp);
+}
+
+/* Returns true if 'peer_dp', reached from a local router over 'router_pb',
+ * doesn't need to be added to the local datapaths until it is used, i.e. if
+ * it is a peer switch that can be installed on demand and that isn't active,
+ * see struct lazy_datapaths. */
+bool
+lazy_datapath_can_wait(
+    const struct lazy_datapaths *lazy,
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath,
+    const struct sbrec_port_binding *router_pb,
+    const struct sbrec_datapath_binding *peer_dp)
+{
+    if (!lazy_datapath_is_candidate(lazy, router_pb, peer_dp)
+        || lazy_datapath_find(lazy, peer_dp->tunnel_key)) {
+        return false;
+    }
+
+    struct sbrec_port_binding *target =
+        sbrec_port_binding_index_init_row(sbrec_port_binding_by_datapath);
+    sbrec_port_binding_index_set_datapath(target, peer_dp);
+
+    bool can_wait = true;
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_FOR_EACH_EQUAL (pb, target,
+                                       sbrec_port_binding_by_datapath) {
+        enum en_lport_type type = get_lport_type(pb);
+        if (type == LP_LOCALNET || type == LP_L2GATEWAY
+            || type == LP_VTEP || type == LP_EXTERNAL) {
+            can_wait = false;
+            break;
+        }
+    }
+    sbrec_port_binding_index_destroy_row(target);
+    return can_wait;
+}
+
+/* Runs in the statctrl thread. */
+void
+lazy_datapath_stats_process_flow_stats(struct ovs_list *stats_list,
+                                       struct ofputil_flow_stats *ofp_stats)
+{
+    struct lazy_datapath_stats *stats = xmalloc(sizeof *stats);
+
+    stats->dp_key = ntohll(ofp_stats->match.flow.metadata);
+    stats->idle_age_ms = ofp_stats->idle_age * 1000;
+    ovs_list_push_back(stats_list, &stats->list_node);
+}
+
+/* Deactivates the active datapaths that haven't been used for the idle
+ * timeout. */
+void
+lazy_datapath_stats_run(struct ovs_list *stats_list, uint64_t *req_delay,
+                        void *data)
+{
+    struct lazy_datapaths *lazy = data;
+
+    struct lazy_datapath_stats *stats;
+    LIST_FOR_EACH_POP (stats, list_node, stats_list) {
+        struct lazy_datapath *ldp = lazy_datapath_find(lazy, stats->dp_key);
+
+        if (ldp && stats->idle_age_ms >= lazy->idle_timeout_ms) {
+            VLOG_DBG("Datapath %"PRIu32" idle for %"PRIu64" ms, removing "
+                     "its flows", ldp->dp_key, stats->idle_age_ms);
+            hmap_remove(&lazy->active, &ldp->hmap_node);
+            free(ldp);
+            lazy->changed = true;
+        }
+        free(stats);
+    }
+
+    if (lazy->changed) {
+        /* Let the engine pick up the deactivated datapaths. */
+        poll_immediate_wake();
+    }
+
+    /* The idle age is reported in seconds. */
+    *req_delay = lazy->enabled && !hmap_is_empty(&lazy->active)
+                 ? MAX(lazy->idle_timeout_ms / 2, 1000)
+                 : 0;
+}
+
+void
+lazy_datapath_stats_destroy(struct ovs_list *stats_list)
+{
+    struct lazy_datapath_stats *stats;
+    LIST_FOR_EACH_POP (stats, list_node, stats_list) {
+        free(stats);
+    }
+}
+
+/* Adds 'dp' and, recursively, the datapaths reachable from it to
+ * 'local_datapaths'.  The peer switches that 'lazy' allows to install on
+ * demand are skipped and added to 'lazy_peer_dps' instead, as long as they
+ * aren't local, see struct lazy_datapaths.  'lazy' and 'lazy_peer_dps' may
+ * be NULL if no datapath is installed on demand. */
 void
 add_local_datapath(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                    struct ovsdb_idl_index *sbrec_port_binding_by_datapath,
@@ -187,13 +504,15 @@ add_local_datapath(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                    const struct sbrec_datapath_binding *dp,
                    const struct sbrec_chassis *chassis,
                    struct hmap *local_datapaths,
-                   struct hmap *tracked_datapaths)
+                   struct hmap *tracked_datapaths,
+                   const struct lazy_datapaths *lazy,
+                   struct hmapx *lazy_peer_dps)
 {
     add_local_datapath__(sbrec_datapath_binding_by_key,
                          sbrec_port_binding_by_datapath,
                          sbrec_port_binding_by_name, 0,
                          dp, chassis, local_datapaths,
-                         tracked_datapaths);
+                         tracked_datapaths, lazy, lazy_peer_dps);
 }
 
 void
@@ -205,7 +524,9 @@ add_local_datapath_peer_port(
     struct ovsdb_idl_index *sbrec_port_binding_by_name,
     struct local_datapath *ld,
     struct hmap *local_datapaths,
-    struct hmap *tracked_datapaths)
+    struct hmap *tracked_datapaths,
+    const struct lazy_datapaths *lazy,
+    struct hmapx *lazy_peer_dps)
 {
     const struct sbrec_port_binding *peer;
     peer = lport_get_peer(pb, sbrec_port_binding_by_name);
@@ -214,17 +535,24 @@ add_local_datapath_peer_port(
         return;
     }
 
-    local_datapath_peer_port_add(ld, pb, peer);
-
     struct local_datapath *peer_ld =
         get_local_datapath(local_datapaths,
                            peer->datapath->tunnel_key);
+    if (!peer_ld && lazy_peer_dps
+        && lazy_datapath_can_wait(lazy, sbrec_port_binding_by_datapath,
+                                  pb, peer->datapath)) {
+        hmapx_add(lazy_peer_dps, CONST_CAST(void *, peer->datapath));
+        return;
+    }
+
+    local_datapath_peer_port_add(ld, pb, peer);
+
     if (!peer_ld) {
         add_local_datapath__(sbrec_datapath_binding_by_key,
                              sbrec_port_binding_by_datapath,
                              sbrec_port_binding_by_name, 1,
                              peer->datapath, chassis, local_datapaths,
-                             tracked_datapaths);
+                             tracked_datapaths, lazy, lazy_peer_dps);
         return;
     }
 
@@ -504,6 +832,54 @@ get_chassis_tunnel_ofport(const struct hmap *chassis_tunnels,
 }
 
 
+static const struct chassis_tunnel *
+chassis_tunnel_find_by_id(const struct hmap *chassis_tunnels,
+                          const struct chassis_tunnel *tun)
+{
+    const struct chassis_tunnel *t;
+    HMAP_FOR_EACH_WITH_HASH (t, hmap_node, tun->hmap_node.hash,
+                             chassis_tunnels) {
+        if (!strcmp(t->chassis_id, tun->chassis_id)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static void
+chassis_tunnel_add_chassis_name(const struct chassis_tunnel *tun,
+                                struct sset *chassis_names)
+{
+    char *chassis_name = NULL;
+    if (encaps_tunnel_id_parse(tun->chassis_id, &chassis_name, NULL, NULL)) {
+        sset_add_and_free(chassis_names, chassis_name);
+    }
+}
+
+/* Adds to 'changed_chassis' the name of each chassis that has a tunnel which
+ * is present in only one of 'old' and 'new', or whose OpenFlow port or type
+ * differs between them. */
+void
+chassis_tunnels_diff(const struct hmap *old, const struct hmap *new,
+                     struct sset *changed_chassis)
+{
+    const struct chassis_tunnel *tun;
+    HMAP_FOR_EACH (tun, hmap_node, new) {
+        const struct chassis_tunnel *old_tun =
+            chassis_tunnel_find_by_id(old, tun);
+        if (!old_tun || old_tun->ofport != tun->ofport
+            || old_tun->type != tun->type
+            || old_tun->is_ipv6 != tun->is_ipv6) {
+            chassis_tunnel_add_chassis_name(tun, changed_chassis);
+        }
+    }
+    HMAP_FOR_EACH (tun, hmap_node, old) {
+        if (!chassis_tunnel_find_by_id(new, tun)) {
+            chassis_tunnel_add_chassis_name(tun, changed_chassis);
+        }
+    }
+}
+
 void
 chassis_tunnels_destroy(struct hmap *chassis_tunnels)
 {
@@ -553,7 +929,9 @@ add_local_datapath__(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                      int depth, const struct sbrec_datapath_binding *dp,
                      const struct sbrec_chassis *chassis,
                      struct hmap *local_datapaths,
-                     struct hmap *tracked_datapaths)
+                     struct hmap *tracked_datapaths,
+                     const struct lazy_datapaths *lazy,
+                     struct hmapx *lazy_peer_dps)
 {
     uint32_t dp_key = dp->tunnel_key;
     struct local_datapath *ld = get_local_datapath(local_datapaths, dp_key);
@@ -561,9 +939,17 @@ add_local_datapath__(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
         return ld;
     }
 
+    if (lazy_peer_dps) {
+        hmapx_find_and_delete(lazy_peer_dps, dp);
+    }
+
     ld = local_datapath_alloc(dp);
+    if (hmap_is_empty(local_datapaths) && !ld_index.map) {
+        ld_index.map = local_datapaths;
+    }
     hmap_insert(local_datapaths, &ld->hmap_node, dp_key);
     ld->datapath = dp;
+    ld_index_insert(local_datapaths, ld);
 
     if (tracked_datapaths) {
         tracked_datapath_add(ld->datapath, TRACKED_RESOURCE_NEW,
@@ -592,7 +978,15 @@ add_local_datapath__(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                                             peer_name);
 
                 if (peer && peer->datapath) {
-                    if (need_add_peer_to_local(
+                    if (lazy_peer_dps
+                        && !get_local_datapath(local_datapaths,
+                                               peer->datapath->tunnel_key)
+                        && lazy_datapath_can_wait(
+                            lazy, sbrec_port_binding_by_datapath, pb,
+                            peer->datapath)) {
+                        hmapx_add(lazy_peer_dps,
+                                  CONST_CAST(void *, peer->datapath));
+                    } else if (need_add_peer_to_local(
                             sbrec_port_binding_by_name, pb, chassis)) {
                         struct local_datapath *peer_ld =
                             add_local_datapath__(sbrec_datapath_binding_by_key,
@@ -600,7 +994,8 @@ add_local_datapath__(struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
                                              sbrec_port_binding_by_name,
                                              depth + 1, peer->datapath,
                                              chassis, local_datapaths,
-                                             tracked_datapaths);
+                                             tracked_datapaths, lazy,
+                                             lazy_peer_dps);
                         local_datapath_peer_port_add(peer_ld, peer, pb);
                         local_datapath_peer_port_add(ld, pb, peer);
                     }
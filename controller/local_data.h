@@ -31,6 +31,10 @@ struct ovsdb_idl_index;
 struct ovsrec_bridge;
 struct ovsrec_interface_table;
 struct sbrec_load_balancer;
+struct sset;
+struct hmapx;
+struct ofputil_flow_stats;
+struct ovs_list;
 
 /* A logical datapath that has some relevance to this hypervisor.  A logical
  * datapath D is relevant to hypervisor H if:
@@ -73,6 +77,67 @@ struct local_datapath *get_local_datapath_no_hash(
     const struct hmap *local_datapaths,
     uint32_t tunnel_key);
 
+/* The logical switches behind the router ports of the local datapaths, that
+ * have no port of their own on this hypervisor, are called peer switches.
+ *
+ * With external_ids:ovn-lazy-peer-datapaths, a peer switch that only matters
+ * to this hypervisor for the traffic that local workloads send to it isn't
+ * added to the local datapaths, so its flows aren't installed, until a packet
+ * is actually routed to it: the packet is sent to ovn-controller, which adds
+ * the switch to the 'active' ones and then resumes the packet, once the
+ * ofctrl seqno requested after the switch's flows were computed is acked,
+ * i.e. once they are installed in OVS.  A switch that hasn't seen any
+ * traffic for 'idle_timeout_ms' is inactive again and its flows are removed.
+ *
+ * Only the switches reached over a distributed router port are installed on
+ * demand, and only if they have no localnet, l2gateway, vtep or external
+ * port, since traffic for these may enter the switch on this hypervisor
+ * without going through a local router. */
+struct lazy_datapaths {
+    bool enabled;
+    uint64_t idle_timeout_ms;
+
+    /* Contains "struct lazy_datapath" nodes, by tunnel key. */
+    struct hmap active;
+
+    /* Last ofctrl seqno requested for the flows of activated datapaths, and
+     * last one seen acked.  'request_install' is set when a datapath was
+     * activated since the last request. */
+    uint64_t install_seqno;
+    uint64_t acked_seqno;
+    bool request_install;
+
+    /* Set when the configuration or 'active' changes. */
+    bool changed;
+};
+
+void lazy_datapaths_init(struct lazy_datapaths *);
+void lazy_datapaths_destroy(struct lazy_datapaths *);
+void lazy_datapaths_set_config(struct lazy_datapaths *, bool enabled,
+                               uint64_t idle_timeout_ms);
+bool lazy_datapath_is_active(const struct lazy_datapaths *,
+                             uint32_t dp_key);
+void lazy_datapath_activate(struct lazy_datapaths *, uint32_t dp_key);
+bool lazy_datapath_is_installing(const struct lazy_datapaths *,
+                                 uint32_t dp_key);
+uint64_t lazy_datapaths_request_install(struct lazy_datapaths *);
+bool lazy_datapaths_install_acked(struct lazy_datapaths *,
+                                  uint64_t last_acked);
+bool lazy_datapath_is_candidate(const struct lazy_datapaths *,
+                                const struct sbrec_port_binding *router_pb,
+                                const struct sbrec_datapath_binding *peer_dp);
+bool lazy_datapath_can_wait(
+    const struct lazy_datapaths *,
+    struct ovsdb_idl_index *sbrec_port_binding_by_datapath,
+    const struct sbrec_port_binding *router_pb,
+    const struct sbrec_datapath_binding *peer_dp);
+
+void lazy_datapath_stats_process_flow_stats(
+    struct ovs_list *stats_list, struct ofputil_flow_stats *ofp_stats);
+void lazy_datapath_stats_run(struct ovs_list *stats_list,
+                             uint64_t *req_delay, void *data);
+void lazy_datapath_stats_destroy(struct ovs_list *stats_list);
+
 bool
 need_add_peer_to_local(
     struct ovsdb_idl_index *sbrec_port_binding_by_name,
@@ -85,7 +150,9 @@ void add_local_datapath(
     const struct sbrec_datapath_binding *,
     const struct sbrec_chassis *,
     struct hmap *local_datapaths,
-    struct hmap *tracked_datapaths);
+    struct hmap *tracked_datapaths,
+    const struct lazy_datapaths *,
+    struct hmapx *lazy_peer_dps);
 
 void local_datapaths_destroy(struct hmap *local_datapaths);
 void local_datapath_destroy(struct local_datapath *ld);
@@ -97,7 +164,9 @@ void add_local_datapath_peer_port(
     struct ovsdb_idl_index *sbrec_port_binding_by_name,
     struct local_datapath *,
     struct hmap *local_datapaths,
-    struct hmap *tracked_datapaths);
+    struct hmap *tracked_datapaths,
+    const struct lazy_datapaths *,
+    struct hmapx *lazy_peer_dps);
 
 void remove_local_datapath_peer_port(const struct sbrec_port_binding *pb,
                                      struct local_datapath *ld,
@@ -160,6 +229,8 @@ bool get_chassis_tunnel_ofport(const struct hmap *chassis_tunnels,
                                const char *chassis_name,
                                ofp_port_t *ofport);
 
+void chassis_tunnels_diff(const struct hmap *old, const struct hmap *new,
+                          struct sset *changed_chassis);
 void chassis_tunnels_destroy(struct hmap *chassis_tunnels);
 void local_datapath_memory_usage(struct simap *usage);
 void add_local_datapath_external_port(struct local_datapath *ld,
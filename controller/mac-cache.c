@@ -16,6 +16,7 @@
 #include <config.h>
 #include <stdbool.h>
 
+#include "coverage.h"
 #include "local_data.h"
 #include "lport.h"
 #include "mac-cache.h"
@@ -23,9 +24,12 @@
 #include "openvswitch/vlog.h"
 #include "ovn/logical-fields.h"
 #include "ovn-sb-idl.h"
+#include "simap.h"
 
 VLOG_DEFINE_THIS_MODULE(mac_cache);
 
+COVERAGE_DEFINE(buffered_packets_evicted);
+
 #define MAX_BUFFERED_PACKETS        1000
 #define BUFFER_QUEUE_DEPTH          4
 #define BUFFERED_PACKETS_TIMEOUT_MS 10000
@@ -40,8 +44,6 @@ static uint32_t
 fdb_data_hash(const struct fdb_data *fdb_data);
 static inline bool
 fdb_data_equals(const struct fdb_data *a, const struct fdb_data *b);
-static uint64_t
-mac_cache_threshold_get_value_ms(const struct sbrec_datapath_binding *dp);
 static void
 mac_cache_threshold_remove(struct hmap *thresholds,
                            struct mac_cache_threshold *threshold);
@@ -56,6 +58,10 @@ static void
 buffered_packets_remove(struct buffered_packets_ctx *ctx,
                         struct buffered_packets *bp);
 
+static void
+buffered_packets_ctx_evict(struct buffered_packets_ctx *ctx,
+                           const struct buffered_packets *keep);
+
 static void
 buffered_packets_db_lookup(struct buffered_packets *bp,
                            struct ds *ip, struct eth_addr *mac,
@@ -463,6 +469,8 @@ bp_packet_data_create(const struct ofputil_packet_in *pin,
             .userdata_len = 0,
     };
     pd->continuation = ofpbuf_clone(continuation);
+    pd->n_bytes = sizeof *pd + pd->pin.packet_len
+                  + sizeof *pd->continuation + pd->continuation->allocated;
 
     return pd;
 }
@@ -493,6 +501,7 @@ buffered_packets_add(struct buffered_packets_ctx *ctx,
          * immediately. */
         bp->lookup_at_ms = 0;
         ovs_list_init(&bp->queue);
+        ovs_list_push_back(&ctx->lru, &bp->lru_node);
     }
 
     bp->expire_at_ms = time_msec() + BUFFERED_PACKETS_TIMEOUT_MS;
@@ -500,16 +509,27 @@ buffered_packets_add(struct buffered_packets_ctx *ctx,
     return bp;
 }
 
+/* Enqueues 'pd' to 'bp' and marks 'bp' as the most recently used buffered
+ * packet.  If that makes 'ctx' exceed its memory budget, the least recently
+ * used buffered packets are evicted until it fits again. */
 void
-buffered_packets_packet_data_enqueue(struct buffered_packets *bp,
+buffered_packets_packet_data_enqueue(struct buffered_packets_ctx *ctx,
+                                     struct buffered_packets *bp,
                                      struct bp_packet_data *pd) {
     if (ovs_list_size(&bp->queue) == BUFFER_QUEUE_DEPTH) {
         struct bp_packet_data *p = CONTAINER_OF(ovs_list_pop_front(&bp->queue),
                                                 struct bp_packet_data, node);
 
+        ctx->n_bytes -= p->n_bytes;
         bp_packet_data_destroy(p);
     }
     ovs_list_push_back(&bp->queue, &pd->node);
+    ctx->n_bytes += pd->n_bytes;
+
+    ovs_list_remove(&bp->lru_node);
+    ovs_list_push_back(&ctx->lru, &bp->lru_node);
+
+    buffered_packets_ctx_evict(ctx, bp);
 }
 
 void
@@ -556,6 +576,7 @@ buffered_packets_ctx_run(struct buffered_packets_ctx *ctx,
             struct eth_header *eth = dp_packet_data(&packet);
             eth->eth_dst = mac;
 
+            ctx->n_bytes -= pd->n_bytes;
             ovs_list_push_back(&ctx->ready_packets_data, &pd->node);
         }
 
@@ -565,6 +586,38 @@ buffered_packets_ctx_run(struct buffered_packets_ctx *ctx,
     ds_destroy(&ip);
 }
 
+/* Makes the packets of 'ctx' that are buffered for a datapath, i.e. with
+ * only the 'dp_key' of their 'mb_data' set, ready to be sent once the
+ * datapath is in 'local_datapaths' and its flows are installed, so that the
+ * resumed packets are not sent to ovn-controller again. */
+void
+buffered_packets_ctx_run_datapaths(struct buffered_packets_ctx *ctx,
+                                   const struct hmap *local_datapaths,
+                                   const struct lazy_datapaths *lazy_dps) {
+    long long now = time_msec();
+
+    struct buffered_packets *bp;
+    HMAP_FOR_EACH_SAFE (bp, hmap_node, &ctx->buffered_packets) {
+        if (now > bp->expire_at_ms) {
+            buffered_packets_remove(ctx, bp);
+            continue;
+        }
+
+        if (!get_local_datapath(local_datapaths, bp->mb_data.dp_key)
+            || lazy_datapath_is_installing(lazy_dps, bp->mb_data.dp_key)) {
+            continue;
+        }
+
+        struct bp_packet_data *pd;
+        LIST_FOR_EACH_POP (pd, node, &bp->queue) {
+            ctx->n_bytes -= pd->n_bytes;
+            ovs_list_push_back(&ctx->ready_packets_data, &pd->node);
+        }
+
+        buffered_packets_remove(ctx, bp);
+    }
+}
+
 bool
 buffered_packets_ctx_is_ready_to_send(struct buffered_packets_ctx *ctx) {
     return !ovs_list_is_empty(&ctx->ready_packets_data);
@@ -575,10 +628,34 @@ buffered_packets_ctx_has_packets(struct buffered_packets_ctx *ctx) {
     return !hmap_is_empty(&ctx->buffered_packets);
 }
 
+/* Sets the maximum memory, in bytes, that the packets buffered in 'ctx' can
+ * use, 0 meaning unlimited. */
+void
+buffered_packets_ctx_set_max_bytes(struct buffered_packets_ctx *ctx,
+                                   size_t max_bytes) {
+    ctx->max_bytes = max_bytes;
+    buffered_packets_ctx_evict(ctx, NULL);
+}
+
+void
+buffered_packets_ctx_get_memory_usage(struct buffered_packets_ctx *ctx,
+                                      struct simap *usage) {
+    size_t n_bytes = ctx->n_bytes + hmap_count(&ctx->buffered_packets)
+                                    * sizeof(struct buffered_packets);
+
+    simap_increase(usage, "buffered_packets",
+                   hmap_count(&ctx->buffered_packets));
+    simap_increase(usage, "buffered_packets_usage-KB",
+                   ROUND_UP(n_bytes, 1024) / 1024);
+}
+
 void
 buffered_packets_ctx_init(struct buffered_packets_ctx *ctx) {
     hmap_init(&ctx->buffered_packets);
     ovs_list_init(&ctx->ready_packets_data);
+    ovs_list_init(&ctx->lru);
+    ctx->n_bytes = 0;
+    ctx->max_bytes = 0;
 }
 
 void
@@ -644,7 +721,9 @@ fdb_data_equals(const struct fdb_data *a, const struct fdb_data *b)
            eth_addr_equals(a->mac, b->mac);
 }
 
-static uint64_t
+/* Returns the aging threshold in ms of the MAC bindings or the FDB entries
+ * of 'dp', 0 if their aging isn't enabled. */
+uint64_t
 mac_cache_threshold_get_value_ms(const struct sbrec_datapath_binding *dp)
 {
     uint64_t mb_value =
@@ -703,13 +782,42 @@ buffered_packets_remove(struct buffered_packets_ctx *ctx,
                         struct buffered_packets *bp) {
     struct bp_packet_data *pd;
     LIST_FOR_EACH_POP (pd, node, &bp->queue) {
+        ctx->n_bytes -= pd->n_bytes;
         bp_packet_data_destroy(pd);
     }
 
     hmap_remove(&ctx->buffered_packets, &bp->hmap_node);
+    ovs_list_remove(&bp->lru_node);
     free(bp);
 }
 
+/* Evicts the least recently used buffered packets of 'ctx' until it is back
+ * within its memory budget.  'keep', if nonnull, is the buffered packet that
+ * was just used: it is never removed, but its oldest packets are dropped if
+ * it is the only one left. */
+static void
+buffered_packets_ctx_evict(struct buffered_packets_ctx *ctx,
+                           const struct buffered_packets *keep) {
+    while (ctx->max_bytes && ctx->n_bytes > ctx->max_bytes
+           && !ovs_list_is_empty(&ctx->lru)) {
+        struct buffered_packets *bp = CONTAINER_OF(ovs_list_front(&ctx->lru),
+                                                   struct buffered_packets,
+                                                   lru_node);
+        if (bp != keep) {
+            buffered_packets_remove(ctx, bp);
+        } else if (ovs_list_size(&bp->queue) > 1) {
+            struct bp_packet_data *pd =
+                CONTAINER_OF(ovs_list_pop_front(&bp->queue),
+                             struct bp_packet_data, node);
+            ctx->n_bytes -= pd->n_bytes;
+            bp_packet_data_destroy(pd);
+        } else {
+            break;
+        }
+        COVERAGE_INC(buffered_packets_evicted);
+    }
+}
+
 static void
 buffered_packets_db_lookup(struct buffered_packets *bp, struct ds *ip,
                            struct eth_addr *mac,
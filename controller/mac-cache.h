@@ -27,7 +27,9 @@
 #include "openvswitch/ofp-packet.h"
 #include "ovn-sb-idl.h"
 
+struct lazy_datapaths;
 struct ovsdb_idl_index;
+struct simap;
 
 struct mac_cache_data {
     /* 'struct mac_cache_threshold' by datapath's tunnel_key. */
@@ -91,10 +93,15 @@ struct bp_packet_data {
 
     struct ofpbuf *continuation;
     struct ofputil_packet_in pin;
+
+    /* Memory used by this packet data, including the struct itself. */
+    size_t n_bytes;
 };
 
 struct buffered_packets {
     struct hmap_node hmap_node;
+    /* In 'lru' of struct buffered_packets_ctx, least recently used first. */
+    struct ovs_list lru_node;
 
     struct mac_binding_data mb_data;
 
@@ -113,6 +120,13 @@ struct buffered_packets_ctx {
     struct hmap buffered_packets;
     /* List of packet data that are ready to be sent. */
     struct ovs_list ready_packets_data;
+    /* All the buffered packets, ordered by the time a packet was last
+     * enqueued for them. */
+    struct ovs_list lru;
+    /* Memory used by the packet data queued in 'buffered_packets'. */
+    size_t n_bytes;
+    /* Upper bound of 'n_bytes', 0 if unlimited. */
+    size_t max_bytes;
 };
 
 /* Thresholds. */
@@ -123,6 +137,8 @@ void mac_cache_threshold_replace(struct mac_cache_data *data,
                                  const struct hmap *local_datapaths);
 struct mac_cache_threshold *
 mac_cache_threshold_find(struct mac_cache_data *data, uint32_t dp_key);
+uint64_t mac_cache_threshold_get_value_ms(
+    const struct sbrec_datapath_binding *dp);
 void mac_cache_thresholds_sync(struct mac_cache_data *data,
                                const struct hmap *local_datapaths);
 void mac_cache_thresholds_clear(struct mac_cache_data *data);
@@ -191,7 +207,8 @@ struct buffered_packets *
 buffered_packets_add(struct buffered_packets_ctx *ctx,
                      struct mac_binding_data mb_data);
 
-void buffered_packets_packet_data_enqueue(struct buffered_packets *bp,
+void buffered_packets_packet_data_enqueue(struct buffered_packets_ctx *ctx,
+                                          struct buffered_packets *bp,
                                           struct bp_packet_data *pd);
 
 void buffered_packets_ctx_run(struct buffered_packets_ctx *ctx,
@@ -201,6 +218,10 @@ void buffered_packets_ctx_run(struct buffered_packets_ctx *ctx,
                               struct ovsdb_idl_index *sbrec_pb_by_name,
                               struct ovsdb_idl_index *sbrec_mb_by_lport_ip);
 
+void buffered_packets_ctx_run_datapaths(struct buffered_packets_ctx *ctx,
+                                        const struct hmap *local_datapaths,
+                                        const struct lazy_datapaths *);
+
 void buffered_packets_ctx_init(struct buffered_packets_ctx *ctx);
 
 void buffered_packets_ctx_destroy(struct buffered_packets_ctx *ctx);
@@ -209,4 +230,10 @@ bool buffered_packets_ctx_is_ready_to_send(struct buffered_packets_ctx *ctx);
 
 bool buffered_packets_ctx_has_packets(struct buffered_packets_ctx *ctx);
 
+void buffered_packets_ctx_set_max_bytes(struct buffered_packets_ctx *ctx,
+                                        size_t max_bytes);
+
+void buffered_packets_ctx_get_memory_usage(struct buffered_packets_ctx *ctx,
+                                           struct simap *usage);
+
 #endif /* controller/mac-cache.h */
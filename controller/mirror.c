@@ -30,32 +30,36 @@
 #include "binding.h"
 #include "lib/ovn-sb-idl.h"
 #include "mirror.h"
+#include "ovsport.h"
 
 VLOG_DEFINE_THIS_MODULE(port_mirror);
 
 struct ovn_mirror {
     char *name;
     const struct sbrec_mirror *sb_mirror;
-    const struct ovsrec_mirror *ovs_mirror;
-    struct ovs_list mirror_src_lports;
-    struct ovs_list mirror_dst_lports;
-};
 
-struct mirror_lport {
-    struct ovs_list list_node;
+    /* Only valid while mirror_run() syncs this mirror. */
+    const struct ovsrec_mirror *ovs_mirror;
 
-    struct local_binding *lbinding;
+    /* Names of the local logical ports mirrored by this mirror. */
+    struct sset mirror_src_lports;
+    struct sset mirror_dst_lports;
 };
 
-static struct ovn_mirror *ovn_mirror_create(char *mirror_name);
+static struct ovn_mirror *ovn_mirror_create(const char *mirror_name);
 static void ovn_mirror_add(struct shash *ovn_mirrors,
                            struct ovn_mirror *);
-static struct ovn_mirror *ovn_mirror_find(struct shash *ovn_mirrors,
+static struct ovn_mirror *ovn_mirror_find(const struct shash *ovn_mirrors,
                                           const char *mirror_name);
 static void ovn_mirror_delete(struct ovn_mirror *);
-static void ovn_mirror_add_lport(struct ovn_mirror *, struct local_binding *);
+static void ovn_mirror_add_lport(struct mirror_data *, struct ovn_mirror *,
+                                 const char *lport_name);
+static bool mirror_add_lport(struct mirror_data *, const char *lport_name,
+                             const struct shash *local_bindings);
 static void sync_ovn_mirror(struct ovn_mirror *, struct ovsdb_idl_txn *,
                             const struct ovsrec_bridge *,
+                            struct ovsdb_idl_index *ovsrec_port_by_interfaces,
+                            const struct shash *local_bindings,
                             struct shash *ovs_mirror_ports);
 
 static void create_ovs_mirror(struct ovn_mirror *, struct ovsdb_idl_txn *,
@@ -64,16 +68,17 @@ static void create_ovs_mirror(struct ovn_mirror *, struct ovsdb_idl_txn *,
 static struct ovsrec_port *create_mirror_port(struct ovn_mirror *,
                                               struct ovsdb_idl_txn *,
                                               const struct ovsrec_bridge *);
-static void sync_ovs_mirror_ports(struct ovn_mirror *,
-                                  const struct ovsrec_bridge *);
+static void sync_ovs_mirror_ports(
+    struct ovn_mirror *, struct ovsdb_idl_index *ovsrec_port_by_interfaces,
+    const struct shash *local_bindings);
 static void delete_ovs_mirror(struct ovn_mirror *,
                               const struct ovsrec_bridge *);
 static bool should_delete_ovs_mirror(struct ovn_mirror *);
 static void set_mirror_iface_options(struct ovsrec_interface *,
                                      const struct sbrec_mirror *);
 
-static const struct ovsrec_port *get_iface_port(
-    const struct ovsrec_interface *, const struct ovsrec_bridge *);
+static const struct ovsrec_mirror *ovs_mirror_lookup_by_name(
+    struct ovsdb_idl_index *ovsrec_mirror_by_name, const char *name);
 
 char *get_mirror_tunnel_type(const struct sbrec_mirror *);
 
@@ -91,6 +96,12 @@ mirror_register_ovs_idl(struct ovsdb_idl *ovs_idl)
     ovsdb_idl_add_column(ovs_idl, &ovsrec_mirror_col_select_dst_port);
     ovsdb_idl_add_column(ovs_idl, &ovsrec_mirror_col_select_src_port);
     ovsdb_idl_add_column(ovs_idl, &ovsrec_mirror_col_external_ids);
+
+    ovsdb_idl_track_add_column(ovs_idl, &ovsrec_mirror_col_name);
+    ovsdb_idl_track_add_column(ovs_idl, &ovsrec_mirror_col_output_port);
+    ovsdb_idl_track_add_column(ovs_idl, &ovsrec_mirror_col_select_dst_port);
+    ovsdb_idl_track_add_column(ovs_idl, &ovsrec_mirror_col_select_src_port);
+    ovsdb_idl_track_add_column(ovs_idl, &ovsrec_mirror_col_external_ids);
 }
 
 void
@@ -104,90 +115,243 @@ mirror_destroy(void)
 }
 
 void
-mirror_run(struct ovsdb_idl_txn *ovs_idl_txn,
-           const struct ovsrec_mirror_table *ovs_mirror_table,
-           const struct sbrec_mirror_table *sb_mirror_table,
-           const struct ovsrec_bridge *br_int,
-           struct shash *local_bindings)
+mirror_data_init(struct mirror_data *md)
 {
-    if (!ovs_idl_txn) {
-        return;
+    shash_init(&md->ovn_mirrors);
+    shash_init(&md->lport_mirrors);
+    sset_init(&md->dirty_mirrors);
+}
+
+static void
+mirror_data_clear(struct mirror_data *md)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH_SAFE (node, &md->ovn_mirrors) {
+        ovn_mirror_delete(node->data);
+        shash_delete(&md->ovn_mirrors, node);
     }
 
-    struct shash ovn_mirrors = SHASH_INITIALIZER(&ovn_mirrors);
-    struct shash ovs_local_mirror_ports =
-        SHASH_INITIALIZER(&ovs_local_mirror_ports);
+    SHASH_FOR_EACH_SAFE (node, &md->lport_mirrors) {
+        struct sset *mirrors = node->data;
+        sset_destroy(mirrors);
+        free(mirrors);
+        shash_delete(&md->lport_mirrors, node);
+    }
+
+    sset_clear(&md->dirty_mirrors);
+}
+
+void
+mirror_data_destroy(struct mirror_data *md)
+{
+    mirror_data_clear(md);
+    shash_destroy(&md->ovn_mirrors);
+    shash_destroy(&md->lport_mirrors);
+    sset_destroy(&md->dirty_mirrors);
+}
+
+/* Rebuilds 'md' from scratch and marks all the mirrors as dirty. */
+void
+mirror_recompute(struct mirror_data *md,
+                 const struct ovsrec_mirror_table *ovs_mirror_table,
+                 const struct sbrec_mirror_table *sb_mirror_table,
+                 const struct shash *local_bindings)
+{
+    mirror_data_clear(md);
 
     /* Iterate through sb mirrors and build the 'ovn_mirrors'. */
     const struct sbrec_mirror *sb_mirror;
     SBREC_MIRROR_TABLE_FOR_EACH (sb_mirror, sb_mirror_table) {
         struct ovn_mirror *m = ovn_mirror_create(sb_mirror->name);
         m->sb_mirror = sb_mirror;
-        ovn_mirror_add(&ovn_mirrors, m);
+        ovn_mirror_add(&md->ovn_mirrors, m);
     }
 
-    /* Iterate through ovs mirrors and add to the 'ovn_mirrors'. */
+    /* Iterate through ovs mirrors and add to the 'ovn_mirrors' the ones
+     * that are not in the SB anymore, so that they get deleted. */
     const struct ovsrec_mirror *ovs_mirror;
     OVSREC_MIRROR_TABLE_FOR_EACH (ovs_mirror, ovs_mirror_table) {
         bool ovn_owned_mirror = smap_get_bool(&ovs_mirror->external_ids,
                                               "ovn-owned", false);
-        if (!ovn_owned_mirror) {
+        if (!ovn_owned_mirror
+            || ovn_mirror_find(&md->ovn_mirrors, ovs_mirror->name)) {
             continue;
         }
 
-        struct ovn_mirror *m = ovn_mirror_find(&ovn_mirrors, ovs_mirror->name);
-        if (!m) {
-            m = ovn_mirror_create(ovs_mirror->name);
-            ovn_mirror_add(&ovn_mirrors, m);
-        }
-        m->ovs_mirror = ovs_mirror;
+        ovn_mirror_add(&md->ovn_mirrors, ovn_mirror_create(ovs_mirror->name));
     }
 
-    if (shash_is_empty(&ovn_mirrors)) {
-        shash_destroy(&ovn_mirrors);
-        return;
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &md->ovn_mirrors) {
+        sset_add(&md->dirty_mirrors, node->name);
     }
 
-    build_ovs_mirror_ports(br_int, &ovs_local_mirror_ports);
-
     /* Iterate through the local bindings and if the local binding's 'pb' has
      * mirrors associated, add it to the ovn_mirror. */
-    struct shash_node *node;
     SHASH_FOR_EACH (node, local_bindings) {
-        struct local_binding *lbinding = node->data;
-        const struct sbrec_port_binding *pb =
-            local_binding_get_primary_pb(local_bindings, lbinding->name);
-        if (!pb || !pb->n_mirror_rules) {
-            continue;
+        mirror_add_lport(md, node->name, local_bindings);
+    }
+}
+
+/* Updates the mirrors of the local logical port 'lport_name', e.g., after it
+ * got bound or released or after its 'mirror_rules' changed.  Returns false
+ * if the port refers to a mirror that is not known, in which case 'md' must
+ * be recomputed. */
+bool
+mirror_handle_lport(struct mirror_data *md, const char *lport_name,
+                    const struct shash *local_bindings)
+{
+    struct sset *mirrors = shash_find_and_delete(&md->lport_mirrors,
+                                                 lport_name);
+    if (mirrors) {
+        const char *mirror_name;
+        SSET_FOR_EACH (mirror_name, mirrors) {
+            struct ovn_mirror *m = ovn_mirror_find(&md->ovn_mirrors,
+                                                   mirror_name);
+            if (m) {
+                sset_find_and_delete(&m->mirror_src_lports, lport_name);
+                sset_find_and_delete(&m->mirror_dst_lports, lport_name);
+                sset_add(&md->dirty_mirrors, mirror_name);
+            }
         }
+        sset_destroy(mirrors);
+        free(mirrors);
+    }
+
+    return mirror_add_lport(md, lport_name, local_bindings);
+}
 
-        for (size_t i = 0; i < pb->n_mirror_rules; i++) {
-            struct ovn_mirror *m = ovn_mirror_find(&ovn_mirrors,
-                                                   pb->mirror_rules[i]->name);
-            ovs_assert(m);
-            ovn_mirror_add_lport(m, lbinding);
+/* Marks the mirror that corresponds to the OVS mirror 'ovs_mirror' as dirty,
+ * so that any change done to it outside of OVN is reverted and a stale
+ * ovn-owned mirror gets deleted. */
+void
+mirror_handle_ovs_mirror(struct mirror_data *md,
+                         const struct ovsrec_mirror *ovs_mirror)
+{
+    struct ovn_mirror *m = ovn_mirror_find(&md->ovn_mirrors, ovs_mirror->name);
+    if (!m) {
+        if (ovsrec_mirror_is_deleted(ovs_mirror)
+            || !smap_get_bool(&ovs_mirror->external_ids, "ovn-owned",
+                              false)) {
+            return;
         }
+        m = ovn_mirror_create(ovs_mirror->name);
+        ovn_mirror_add(&md->ovn_mirrors, m);
     }
+    sset_add(&md->dirty_mirrors, m->name);
+}
 
-    /* Iterate through the built 'ovn_mirrors' and
-     * sync with the local ovsdb i.e.
-     * create/update or delete the ovsrec mirror(s). */
-     SHASH_FOR_EACH (node, &ovn_mirrors) {
+/* Marks the mirrors of type "local" as dirty.  To be called when the
+ * "mirror-id" of the OVS interfaces they use as output port might have
+ * changed. */
+void
+mirror_handle_mirror_ports_changed(struct mirror_data *md)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &md->ovn_mirrors) {
         struct ovn_mirror *m = node->data;
-        sync_ovn_mirror(m, ovs_idl_txn, br_int, &ovs_local_mirror_ports);
-     }
+        if (m->sb_mirror && !strcmp(m->sb_mirror->type, "local")) {
+            sset_add(&md->dirty_mirrors, m->name);
+        }
+    }
+}
 
-    SHASH_FOR_EACH_SAFE (node, &ovn_mirrors) {
-        ovn_mirror_delete(node->data);
-        shash_delete(&ovn_mirrors, node);
+/* Syncs the OVS mirrors of the dirty mirrors of 'md' with the local ovsdb
+ * i.e. creates/updates or deletes the ovsrec mirror(s). */
+void
+mirror_run(struct ovsdb_idl_txn *ovs_idl_txn,
+           struct mirror_data *md,
+           struct ovsdb_idl_index *ovsrec_mirror_by_name,
+           struct ovsdb_idl_index *ovsrec_port_by_interfaces,
+           const struct ovsrec_bridge *br_int,
+           const struct shash *local_bindings)
+{
+    if (!ovs_idl_txn || !br_int || sset_is_empty(&md->dirty_mirrors)) {
+        return;
     }
 
-    shash_destroy(&ovn_mirrors);
+    /* Only "local" mirrors need the mirror-id to port mapping, which is
+     * built lazily as it requires walking all the ports of 'br_int'. */
+    struct shash ovs_local_mirror_ports =
+        SHASH_INITIALIZER(&ovs_local_mirror_ports);
+    bool ovs_local_mirror_ports_built = false;
+
+    const char *mirror_name;
+    SSET_FOR_EACH (mirror_name, &md->dirty_mirrors) {
+        struct ovn_mirror *m = ovn_mirror_find(&md->ovn_mirrors, mirror_name);
+        if (!m) {
+            continue;
+        }
+
+        if (m->sb_mirror && !strcmp(m->sb_mirror->type, "local")
+            && !ovs_local_mirror_ports_built) {
+            build_ovs_mirror_ports(br_int, &ovs_local_mirror_ports);
+            ovs_local_mirror_ports_built = true;
+        }
+
+        m->ovs_mirror = ovs_mirror_lookup_by_name(ovsrec_mirror_by_name,
+                                                  m->name);
+        sync_ovn_mirror(m, ovs_idl_txn, br_int, ovsrec_port_by_interfaces,
+                        local_bindings, &ovs_local_mirror_ports);
+        m->ovs_mirror = NULL;
+
+        if (!m->sb_mirror) {
+            /* The OVS mirror is gone now, so is the need to track it. */
+            shash_find_and_delete(&md->ovn_mirrors, m->name);
+            ovn_mirror_delete(m);
+        }
+    }
+    sset_clear(&md->dirty_mirrors);
+
     shash_destroy(&ovs_local_mirror_ports);
 }
 
 /* Static functions. */
 
+static const struct ovsrec_mirror *
+ovs_mirror_lookup_by_name(struct ovsdb_idl_index *ovsrec_mirror_by_name,
+                          const char *name)
+{
+    struct ovsrec_mirror *target =
+        ovsrec_mirror_index_init_row(ovsrec_mirror_by_name);
+    ovsrec_mirror_index_set_name(target, name);
+
+    const struct ovsrec_mirror *ovs_mirror =
+        ovsrec_mirror_index_find(ovsrec_mirror_by_name, target);
+    ovsrec_mirror_index_destroy_row(target);
+
+    if (ovs_mirror && !smap_get_bool(&ovs_mirror->external_ids, "ovn-owned",
+                                     false)) {
+        return NULL;
+    }
+    return ovs_mirror;
+}
+
+/* Adds the local logical port 'lport_name' to the mirrors of its primary
+ * port binding, if any.  Returns false if one of them is not known. */
+static bool
+mirror_add_lport(struct mirror_data *md, const char *lport_name,
+                 const struct shash *local_bindings)
+{
+    const struct sbrec_port_binding *pb =
+        local_binding_get_primary_pb(local_bindings, lport_name);
+    if (!pb || !pb->n_mirror_rules) {
+        return true;
+    }
+
+    bool found = true;
+    for (size_t i = 0; i < pb->n_mirror_rules; i++) {
+        struct ovn_mirror *m = ovn_mirror_find(&md->ovn_mirrors,
+                                               pb->mirror_rules[i]->name);
+        if (!m || !m->sb_mirror) {
+            found = false;
+            continue;
+        }
+        ovn_mirror_add_lport(md, m, lport_name);
+    }
+    return found;
+}
+
 /* Builds mapping from mirror-id to ovsrec_port.
  */
 static void
@@ -230,12 +394,12 @@ build_ovs_mirror_ports(const struct ovsrec_bridge *br_int,
 }
 
 static struct ovn_mirror *
-ovn_mirror_create(char *mirror_name)
+ovn_mirror_create(const char *mirror_name)
 {
     struct ovn_mirror *m = xzalloc(sizeof *m);
     m->name = xstrdup(mirror_name);
-    ovs_list_init(&m->mirror_src_lports);
-    ovs_list_init(&m->mirror_dst_lports);
+    sset_init(&m->mirror_src_lports);
+    sset_init(&m->mirror_dst_lports);
     return m;
 }
 
@@ -246,7 +410,7 @@ ovn_mirror_add(struct shash *ovn_mirrors, struct ovn_mirror *m)
 }
 
 static struct ovn_mirror *
-ovn_mirror_find(struct shash *ovn_mirrors, const char *mirror_name)
+ovn_mirror_find(const struct shash *ovn_mirrors, const char *mirror_name)
 {
     return shash_find_data(ovn_mirrors, mirror_name);
 }
@@ -255,34 +419,41 @@ static void
 ovn_mirror_delete(struct ovn_mirror *m)
 {
     free(m->name);
-    struct mirror_lport *m_lport;
-    LIST_FOR_EACH_POP (m_lport, list_node, &m->mirror_src_lports) {
-        free(m_lport);
-    }
-
-    LIST_FOR_EACH_POP (m_lport, list_node, &m->mirror_dst_lports) {
-        free(m_lport);
-    }
-
+    sset_destroy(&m->mirror_src_lports);
+    sset_destroy(&m->mirror_dst_lports);
     free(m);
 }
 
 static void
-ovn_mirror_add_lport(struct ovn_mirror *m, struct local_binding *lbinding)
+ovn_mirror_add_lport(struct mirror_data *md, struct ovn_mirror *m,
+                     const char *lport_name)
 {
+    bool added = false;
+
     if (!strcmp(m->sb_mirror->filter, "from-lport") ||
         !strcmp(m->sb_mirror->filter, "both")) {
-        struct mirror_lport *m_lport = xzalloc(sizeof *m_lport);
-        m_lport->lbinding = lbinding;
-        ovs_list_push_back(&m->mirror_src_lports, &m_lport->list_node);
+        sset_add(&m->mirror_src_lports, lport_name);
+        added = true;
     }
 
     if (!strcmp(m->sb_mirror->filter, "to-lport") ||
         !strcmp(m->sb_mirror->filter, "both")) {
-        struct mirror_lport *m_lport = xzalloc(sizeof *m_lport);
-        m_lport->lbinding = lbinding;
-        ovs_list_push_back(&m->mirror_dst_lports, &m_lport->list_node);
+        sset_add(&m->mirror_dst_lports, lport_name);
+        added = true;
+    }
+
+    if (!added) {
+        return;
+    }
+
+    struct sset *mirrors = shash_find_data(&md->lport_mirrors, lport_name);
+    if (!mirrors) {
+        mirrors = xmalloc(sizeof *mirrors);
+        sset_init(mirrors);
+        shash_add(&md->lport_mirrors, lport_name, mirrors);
     }
+    sset_add(mirrors, m->name);
+    sset_add(&md->dirty_mirrors, m->name);
 }
 
 static void
@@ -338,6 +509,8 @@ check_and_update_interface_table(struct ovn_mirror *m,
 static void
 sync_ovn_mirror(struct ovn_mirror *m, struct ovsdb_idl_txn *ovs_idl_txn,
                 const struct ovsrec_bridge *br_int,
+                struct ovsdb_idl_index *ovsrec_port_by_interfaces,
+                const struct shash *local_bindings,
                 struct shash *ovs_mirror_ports)
 {
     if (should_delete_ovs_mirror(m)) {
@@ -346,8 +519,8 @@ sync_ovn_mirror(struct ovn_mirror *m, struct ovsdb_idl_txn *ovs_idl_txn,
         return;
     }
 
-    if (ovs_list_is_empty(&m->mirror_src_lports) &&
-            ovs_list_is_empty(&m->mirror_dst_lports)) {
+    if (sset_is_empty(&m->mirror_src_lports) &&
+            sset_is_empty(&m->mirror_dst_lports)) {
         /* Nothing to do. */
         return;
     }
@@ -380,7 +553,7 @@ sync_ovn_mirror(struct ovn_mirror *m, struct ovsdb_idl_txn *ovs_idl_txn,
         }
     }
 
-    sync_ovs_mirror_ports(m, br_int);
+    sync_ovs_mirror_ports(m, ovsrec_port_by_interfaces, local_bindings);
 }
 
 static bool
@@ -394,23 +567,8 @@ should_delete_ovs_mirror(struct ovn_mirror *m)
         return true;
     }
 
-    return (ovs_list_is_empty(&m->mirror_src_lports) &&
-            ovs_list_is_empty(&m->mirror_dst_lports));
-}
-
-static const struct ovsrec_port *
-get_iface_port(const struct ovsrec_interface *iface,
-               const struct ovsrec_bridge *br_int)
-{
-    for (size_t i = 0; i < br_int->n_ports; i++) {
-        const struct ovsrec_port *p = br_int->ports[i];
-        for (size_t j = 0; j < p->n_interfaces; j++) {
-            if (!strcmp(iface->name, p->interfaces[j]->name)) {
-                return p;
-            }
-        }
-    }
-    return NULL;
+    return (sset_is_empty(&m->mirror_src_lports) &&
+            sset_is_empty(&m->mirror_dst_lports));
 }
 
 static struct ovsrec_port *
@@ -466,46 +624,55 @@ create_ovs_mirror(struct ovn_mirror *m, struct ovsdb_idl_txn *ovs_idl_txn,
     ovsrec_bridge_update_mirrors_addvalue(br_int, m->ovs_mirror);
 }
 
-static void
-sync_ovs_mirror_ports(struct ovn_mirror *m, const struct ovsrec_bridge *br_int)
+/* Returns the OVS ports of the local logical ports in 'lports' and stores
+ * their number in '*n_ports'. */
+static struct ovsrec_port **
+get_lports_ovs_ports(const struct sset *lports,
+                     struct ovsdb_idl_index *ovsrec_port_by_interfaces,
+                     const struct shash *local_bindings, size_t *n_ports)
 {
-    struct mirror_lport *m_lport;
-
-    if (ovs_list_is_empty(&m->mirror_src_lports)) {
-        ovsrec_mirror_set_select_src_port(m->ovs_mirror, NULL, 0);
-    } else {
-        size_t n_lports = ovs_list_size(&m->mirror_src_lports);
-        struct ovsrec_port **ovs_ports = xmalloc(sizeof *ovs_ports * n_lports);
-
-        size_t i = 0;
-        LIST_FOR_EACH (m_lport, list_node, &m->mirror_src_lports) {
-            const struct ovsrec_port *p =
-                get_iface_port(m_lport->lbinding->iface, br_int);
-            ovs_assert(p);
-            ovs_ports[i++] = (struct ovsrec_port *) p;
+    struct ovsrec_port **ovs_ports =
+        xmalloc(sizeof *ovs_ports * sset_count(lports));
+    const char *lport_name;
+
+    *n_ports = 0;
+    SSET_FOR_EACH (lport_name, lports) {
+        const struct local_binding *lbinding =
+            local_binding_find(local_bindings, lport_name);
+        if (!lbinding || !lbinding->iface) {
+            continue;
         }
 
-        ovsrec_mirror_set_select_src_port(m->ovs_mirror, ovs_ports, n_lports);
-        free(ovs_ports);
-    }
-
-    if (ovs_list_is_empty(&m->mirror_dst_lports)) {
-        ovsrec_mirror_set_select_dst_port(m->ovs_mirror, NULL, 0);
-    } else {
-        size_t n_lports = ovs_list_size(&m->mirror_dst_lports);
-        struct ovsrec_port **ovs_ports = xmalloc(sizeof *ovs_ports * n_lports);
-
-        size_t i = 0;
-        LIST_FOR_EACH (m_lport, list_node, &m->mirror_dst_lports) {
-            const struct ovsrec_port *p =
-                get_iface_port(m_lport->lbinding->iface, br_int);
-            ovs_assert(p);
-            ovs_ports[i++] = (struct ovsrec_port *) p;
+        const struct ovsrec_port *p =
+            ovsport_lookup_by_interface(
+                ovsrec_port_by_interfaces,
+                CONST_CAST(struct ovsrec_interface *, lbinding->iface));
+        if (p) {
+            ovs_ports[(*n_ports)++] = CONST_CAST(struct ovsrec_port *, p);
         }
-
-        ovsrec_mirror_set_select_dst_port(m->ovs_mirror, ovs_ports, n_lports);
-        free(ovs_ports);
     }
+    return ovs_ports;
+}
+
+static void
+sync_ovs_mirror_ports(struct ovn_mirror *m,
+                      struct ovsdb_idl_index *ovsrec_port_by_interfaces,
+                      const struct shash *local_bindings)
+{
+    struct ovsrec_port **ovs_ports;
+    size_t n_ports;
+
+    ovs_ports = get_lports_ovs_ports(&m->mirror_src_lports,
+                                     ovsrec_port_by_interfaces,
+                                     local_bindings, &n_ports);
+    ovsrec_mirror_set_select_src_port(m->ovs_mirror, ovs_ports, n_ports);
+    free(ovs_ports);
+
+    ovs_ports = get_lports_ovs_ports(&m->mirror_dst_lports,
+                                     ovsrec_port_by_interfaces,
+                                     local_bindings, &n_ports);
+    ovsrec_mirror_set_select_dst_port(m->ovs_mirror, ovs_ports, n_ports);
+    free(ovs_ports);
 }
 
 static void
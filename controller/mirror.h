@@ -16,18 +16,53 @@
 #ifndef OVN_MIRROR_H
 #define OVN_MIRROR_H 1
 
+#include "openvswitch/shash.h"
+#include "sset.h"
+
+struct ovsdb_idl;
+struct ovsdb_idl_index;
 struct ovsdb_idl_txn;
+struct ovsrec_mirror;
 struct ovsrec_mirror_table;
 struct sbrec_mirror_table;
 struct ovsrec_bridge;
-struct shash;
+
+/* Data of the "mirror" engine node.  It only tracks which local logical
+ * ports are mirrored by which mirror; the OVS Mirror rows themselves are
+ * created, updated or deleted by mirror_run(), only for the mirrors listed
+ * in 'dirty_mirrors'. */
+struct mirror_data {
+    /* Contains "struct ovn_mirror"s, by name. */
+    struct shash ovn_mirrors;
+
+    /* Maps the name of a mirrored local logical port to the 'struct sset'
+     * of the names of the mirrors it belongs to. */
+    struct shash lport_mirrors;
+
+    /* Names of the mirrors whose OVS configuration must be synced. */
+    struct sset dirty_mirrors;
+};
 
 void mirror_register_ovs_idl(struct ovsdb_idl *);
 void mirror_init(void);
 void mirror_destroy(void);
+
+void mirror_data_init(struct mirror_data *);
+void mirror_data_destroy(struct mirror_data *);
+void mirror_recompute(struct mirror_data *,
+                      const struct ovsrec_mirror_table *,
+                      const struct sbrec_mirror_table *,
+                      const struct shash *local_bindings);
+bool mirror_handle_lport(struct mirror_data *, const char *lport_name,
+                         const struct shash *local_bindings);
+void mirror_handle_ovs_mirror(struct mirror_data *,
+                              const struct ovsrec_mirror *);
+void mirror_handle_mirror_ports_changed(struct mirror_data *);
+
 void mirror_run(struct ovsdb_idl_txn *ovs_idl_txn,
-                const struct ovsrec_mirror_table *,
-                const struct sbrec_mirror_table *,
+                struct mirror_data *,
+                struct ovsdb_idl_index *ovsrec_mirror_by_name,
+                struct ovsdb_idl_index *ovsrec_port_by_interfaces,
                 const struct ovsrec_bridge *,
-                struct shash *local_bindings);
+                const struct shash *local_bindings);
 #endif
@@ -25,7 +25,10 @@
  * to inform the application that the 'req_cfg' seqno has been processed.
  */
 struct ofctrl_seqno_update {
-    struct ovs_list list_node; /* In 'ofctrl_seqno_updates'. */
+    struct ovs_list list_node; /* In 'ofctrl_seqno_updates' or, once acked,
+                                * in the 'acked_cfgs' of its type. */
+    struct ovs_list type_node; /* In the 'pending_cfgs' of its type, until
+                                * acked. */
     size_t seqno_type;         /* Application specific seqno type.
                                 * Relevant only for 'req_cfg'.
                                 */
@@ -36,7 +39,8 @@ struct ofctrl_seqno_update {
     uint64_t req_cfg;          /* Application specific seqno. */
 };
 
-/* List of in flight sequence number updates. */
+/* List of in flight sequence number updates, in the order of their
+ * 'flow_cfg'. */
 static struct ovs_list ofctrl_seqno_updates;
 
 /* Last sequence number request sent to OVS. */
@@ -47,6 +51,9 @@ struct ofctrl_seqno_state {
     struct ovs_list acked_cfgs; /* Acked requests since the last time the
                                  * application consumed acked requests.
                                  */
+    struct ovs_list pending_cfgs; /* In flight requests, a sublist of
+                                   * 'ofctrl_seqno_updates'.
+                                   */
     uint64_t cur_cfg;           /* Last acked application seqno. */
     uint64_t req_cfg;           /* Last requested application seqno. */
 };
@@ -137,8 +144,11 @@ ofctrl_seqno_add_type(void)
     for (size_t i = 0; i < n_ofctrl_seqno_states - 1; i++) {
         ovs_list_move(&new_states[i].acked_cfgs,
                       &ofctrl_seqno_states[i].acked_cfgs);
+        ovs_list_move(&new_states[i].pending_cfgs,
+                      &ofctrl_seqno_states[i].pending_cfgs);
     }
     ovs_list_init(&new_states[new_type].acked_cfgs);
+    ovs_list_init(&new_states[new_type].pending_cfgs);
 
     free(ofctrl_seqno_states);
     ofctrl_seqno_states = new_states;
@@ -184,6 +194,30 @@ ofctrl_seqno_run(uint64_t flow_cfg)
     }
 }
 
+/* Same as ofctrl_seqno_run() but only for the requests of 'seqno_type', for
+ * applications that know that the OVS flow updates they depend on were
+ * processed earlier than the others of 'flow_cfg'.
+ *
+ * Only the requests of 'seqno_type' are walked, so that the ones of the
+ * other types that are still in flight are not walked again on every run.
+ */
+void
+ofctrl_seqno_run_type(size_t seqno_type, uint64_t flow_cfg)
+{
+    ovs_assert(seqno_type < n_ofctrl_seqno_states);
+
+    struct ofctrl_seqno_state *state = &ofctrl_seqno_states[seqno_type];
+    struct ofctrl_seqno_update *update;
+    LIST_FOR_EACH_SAFE (update, type_node, &state->pending_cfgs) {
+        if (flow_cfg < update->flow_cfg) {
+            break;
+        }
+
+        ovs_list_remove(&update->list_node);
+        ofctrl_seqno_cfg_run(seqno_type, update);
+    }
+}
+
 /* Returns the seqno to be used when sending a barrier request to OVS. */
 uint64_t
 ofctrl_seqno_get_req_cfg(void)
@@ -199,6 +233,7 @@ ofctrl_seqno_flush(void)
 {
     for (size_t i = 0; i < n_ofctrl_seqno_states; i++) {
         ofctrl_seqno_update_list_destroy(&ofctrl_seqno_states[i].acked_cfgs);
+        ovs_list_init(&ofctrl_seqno_states[i].pending_cfgs);
     }
     ofctrl_seqno_update_list_destroy(&ofctrl_seqno_updates);
     ofctrl_req_seqno = 0;
@@ -229,6 +264,8 @@ ofctrl_seqno_update_create__(size_t seqno_type, uint64_t req_cfg)
 
     ofctrl_req_seqno++;
     ovs_list_push_back(&ofctrl_seqno_updates, &update->list_node);
+    ovs_list_push_back(&ofctrl_seqno_states[seqno_type].pending_cfgs,
+                       &update->type_node);
     update->seqno_type = seqno_type;
     update->flow_cfg = ofctrl_req_seqno;
     update->req_cfg = req_cfg;
@@ -248,6 +285,7 @@ static void
 ofctrl_seqno_cfg_run(size_t seqno_type, struct ofctrl_seqno_update *update)
 {
     ovs_assert(seqno_type < n_ofctrl_seqno_states);
+    ovs_list_remove(&update->type_node);
     ovs_list_push_back(&ofctrl_seqno_states[seqno_type].acked_cfgs,
                        &update->list_node);
     ofctrl_seqno_states[seqno_type].cur_cfg = update->req_cfg;
@@ -43,6 +43,7 @@ void ofctrl_seqno_init(void);
 size_t ofctrl_seqno_add_type(void);
 void ofctrl_seqno_update_create(size_t seqno_type, uint64_t new_cfg);
 void ofctrl_seqno_run(uint64_t flow_cfg);
+void ofctrl_seqno_run_type(size_t seqno_type, uint64_t flow_cfg);
 uint64_t ofctrl_seqno_get_req_cfg(void);
 void ofctrl_seqno_flush(void);
 
@@ -38,17 +38,23 @@
 #include "openvswitch/ofp-msgs.h"
 #include "openvswitch/ofp-meter.h"
 #include "openvswitch/ofp-packet.h"
+#include "openvswitch/ofp-port.h"
 #include "openvswitch/ofp-print.h"
 #include "openvswitch/ofp-util.h"
 #include "openvswitch/ofpbuf.h"
+#include "openvswitch/usdt-probes.h"
 #include "openvswitch/vlog.h"
 #include "ovn-controller.h"
 #include "ovn/actions.h"
 #include "lib/extend-table.h"
 #include "lib/lb.h"
+#include "lib/slab.h"
+#include "latch.h"
 #include "openvswitch/poll-loop.h"
+#include "ovs-thread.h"
 #include "physical.h"
 #include "openvswitch/rconn.h"
+#include "seq.h"
 #include "socket-util.h"
 #include "timeval.h"
 #include "util.h"
@@ -57,6 +63,9 @@
 VLOG_DEFINE_THIS_MODULE(ofctrl);
 
 COVERAGE_DEFINE(ofctrl_msg_too_long);
+COVERAGE_DEFINE(ofctrl_bundle_split);
+COVERAGE_DEFINE(ofctrl_prio_put);
+COVERAGE_DEFINE(ofctrl_ct_flush_batch);
 
 /* An OpenFlow flow. */
 struct ovn_flow {
@@ -244,11 +253,24 @@ struct ofctrl_mem_stats {
     uint64_t sb_flow_ref_usage;
     uint64_t desired_flow_usage;
     uint64_t installed_flow_usage;
+    uint64_t flow_actions_usage;
+    uint64_t shared_flow_actions;  /* Not allocated thanks to sharing. */
     uint64_t oflow_update_usage;
 };
 
 static struct ofctrl_mem_stats mem_stats;
 
+/* The flow tables' fixed-size objects, by far the most numerous ones. */
+static struct ovn_slab sb_flow_ref_slab =
+    OVN_SLAB_INITIALIZER(sb_flow_ref_slab, "sb_flow_ref",
+                         sizeof(struct sb_flow_ref));
+static struct ovn_slab desired_flow_slab =
+    OVN_SLAB_INITIALIZER(desired_flow_slab, "desired_flow",
+                         sizeof(struct desired_flow));
+static struct ovn_slab installed_flow_slab =
+    OVN_SLAB_INITIALIZER(installed_flow_slab, "installed_flow",
+                         sizeof(struct installed_flow));
+
 typedef bool
 (*desired_flow_match_cb)(const struct desired_flow *candidate,
                          const void *arg);
@@ -273,9 +295,11 @@ static struct desired_flow *desired_flow_lookup_conjunctive(
 static void desired_flow_destroy(struct desired_flow *);
 
 static struct installed_flow *installed_flow_lookup(
-    const struct ovn_flow *target, struct hmap *installed_flows);
+    const struct ovn_flow *target, struct resizing_hmap *installed_flows);
 static void installed_flow_destroy(struct installed_flow *);
 static struct installed_flow *installed_flow_dup(struct desired_flow *);
+static struct installed_flow *installed_flow_from_stats(
+    const struct ofputil_flow_stats *);
 static size_t installed_flow_size(const struct installed_flow *);
 static struct desired_flow *installed_flow_get_active(struct installed_flow *);
 
@@ -305,6 +329,8 @@ static unsigned int seqno;
     STATE(S_TLV_TABLE_MOD_SENT)                 \
     STATE(S_WAIT_BEFORE_CLEAR)                  \
     STATE(S_CLEAR_FLOWS)                        \
+    STATE(S_DUMP_FLOWS)                         \
+    STATE(S_DUMP_FLOWS_REQUESTED)               \
     STATE(S_UPDATE_FLOWS)
 enum ofctrl_state {
 #define STATE(NAME) NAME,
@@ -343,6 +369,24 @@ static struct ovs_list flow_updates;
 /* req_cfg of latest committed flow update. */
 static uint64_t cur_cfg;
 
+/* The prioritized flows sent by an ofctrl_put() are followed by their own
+ * barrier, with transaction ID 'prio_xid' (0 if none is in flight).  When it
+ * is replied to, the switch has processed everything that was sent before
+ * it, including the prioritized flows of 'prio_req_cfg', which then becomes
+ * 'prio_cfg'. */
+static ovs_be32 prio_xid;
+static uint64_t prio_req_cfg;
+static uint64_t prio_cfg;
+
+/* The conntrack flushes of released zones are sent after the flow updates,
+ * in batches of at most CT_FLUSH_BATCH_SIZE messages followed by their own
+ * barrier, so that flushing many zones delays neither the installation of
+ * the flows nor the reporting of its completion.  There is at most one batch
+ * in flight, whose barrier has transaction ID 'ct_flush_xid' (0 if none).
+ * The zones of new users are still flushed ahead of their flows. */
+#define CT_FLUSH_BATCH_SIZE 1024
+static ovs_be32 ct_flush_xid;
+
 /* Current state. */
 static enum ofctrl_state state;
 
@@ -354,24 +398,66 @@ static unsigned int wait_before_clear_time = 0;
  * If the timer is not started yet, it is set to 0. */
 static long long int wait_before_clear_expire = 0;
 
+/* Whether to reconcile with the flows, groups and meters already present in
+ * the switch on (re)connection, instead of clearing them.  Read from
+ * external_ids: ovn-ofctrl-reconcile. */
+static bool reconcile_on_connect = false;
+
+/* Limits on the number of flow_mods and on the size in bytes of each bundle
+ * sent by ofctrl_put(), read from external_ids:
+ * ovn-ofctrl-bundle-max-flow-mods and ovn-ofctrl-bundle-max-bytes.  Larger
+ * updates are split into a sequence of bundles.  0 means unlimited. */
+static unsigned int bundle_max_flow_mods = 0;
+static unsigned int bundle_max_bytes = 0;
+
+/* State of the bundle being filled by ofctrl_put(). */
+static uint32_t next_bundle_id;
+static struct ofpbuf *bundle_open_msg;  /* Open request of the bundle. */
+static bool bundle_may_split;
+static size_t bundle_n_flow_mods;
+static size_t bundle_n_bytes;
+static uint64_t bundle_last_cookie;
+
 /* Transaction IDs for messages in flight to the switch. */
 static ovs_be32 xid, xid2;
 
-/* Counter for in-flight OpenFlow messages on 'swconn'.  We only send a new
- * round of flow table modifications to the switch when the counter falls to
- * zero, to avoid unbounded buffering. */
+/* Counters for in-flight OpenFlow messages on 'swconn'.  Each round of flow
+ * table modifications sent by ofctrl_put() is accounted to its own counter,
+ * alternating between the two, and 'tx_counter' points to the one of the
+ * latest round.  We only send a new round when the counter of the round
+ * before the latest one falls to zero, so that the switch can be processing
+ * one round while the next one is still being transmitted, without
+ * unbounded buffering. */
+static struct rconn_packet_counter *tx_counters[2];
 static struct rconn_packet_counter *tx_counter;
 
+/* Thread that transmits the messages queued on 'swconn', so that a large
+ * backlog keeps draining while the main thread is busy, e.g., recomputing
+ * flows.  'swconn' is protected by its own mutex, so the main thread keeps
+ * using it directly; 'ofctrl_io_seq' is changed to wake up the thread when
+ * new messages are queued. */
+static pthread_t ofctrl_io_thread;
+static struct latch ofctrl_io_exit;
+static struct seq *ofctrl_io_seq;
+static bool ofctrl_io_pending;
+
+static void *ofctrl_io_thread_main(void *);
+static void ofctrl_io_wake(void);
+
 /* Flow table of "struct ovn_flow"s, that holds the logical flow table
  * currently installed in the switch. */
-static struct hmap installed_lflows;
+static struct resizing_hmap installed_lflows;
 /* Flow table of "struct ovn_flow"s, that holds the physical flow table
  * currently installed in the switch. */
-static struct hmap installed_pflows;
+static struct resizing_hmap installed_pflows;
 
 /* A reference to the group_table. */
 static struct ovn_extend_table *groups;
 
+/* A reference to the group table of the physical flows, if any.  Its ids
+ * must not overlap with the ones of 'groups'. */
+static struct ovn_extend_table *pflow_groups;
+
 /* A reference to the meter_table. */
 static struct ovn_extend_table *meters;
 
@@ -402,6 +488,29 @@ static enum mf_field_id mff_ovn_geneve;
  * (e.g. after OVS restart). */
 static bool ofctrl_initial_clear;
 
+/* State of the reconciliation with the switch after going through the
+ * S_DUMP_FLOWS state.  'reconcile_flows' holds the "struct installed_flow"s
+ * dumped from the switch that have not been matched to desired flows yet,
+ * and 'reconcile_group_ids' and 'reconcile_meter_ids' the ids ("struct
+ * ofctrl_reconcile_id"s) of the groups and meters found in the switch.  The
+ * next ofctrl_put()s move the flows that are still desired to the installed
+ * flow tables, and once both flow tables are complete and compared, modify
+ * the groups and meters that are still desired in place and delete
+ * everything else. */
+static bool ofctrl_reconciling;
+static struct hmap reconcile_flows;
+static bool lflows_reconcile_compared;
+static bool pflows_reconcile_compared;
+static struct hmap reconcile_group_ids;
+static struct hmap reconcile_meter_ids;
+
+struct ofctrl_reconcile_id {
+    struct hmap_node hmap_node;
+    uint32_t id;
+};
+
+static void ofctrl_reconcile_clear(void);
+
 static ovs_be32 queue_msg(struct ofpbuf *);
 
 static struct ofpbuf *encode_flow_mod(struct ofputil_flow_mod *);
@@ -418,17 +527,56 @@ static void ofctrl_recv(const struct ofp_header *, enum ofptype);
 
 void
 ofctrl_init(struct ovn_extend_table *group_table,
+            struct ovn_extend_table *pflow_group_table,
             struct ovn_extend_table *meter_table)
 {
     swconn = rconn_create(0, 0, DSCP_DEFAULT, 1 << OFP15_VERSION);
-    tx_counter = rconn_packet_counter_create();
-    hmap_init(&installed_lflows);
-    hmap_init(&installed_pflows);
+    tx_counters[0] = rconn_packet_counter_create();
+    tx_counters[1] = rconn_packet_counter_create();
+    tx_counter = tx_counters[0];
+    resizing_hmap_init(&installed_lflows);
+    resizing_hmap_init(&installed_pflows);
+    hmap_init(&reconcile_flows);
+    hmap_init(&reconcile_group_ids);
+    hmap_init(&reconcile_meter_ids);
     ovs_list_init(&flow_updates);
     ovn_init_symtab(&symtab);
     groups = group_table;
+    pflow_groups = pflow_group_table;
     meters = meter_table;
     shash_init(&meter_bands);
+
+    latch_init(&ofctrl_io_exit);
+    ofctrl_io_seq = seq_create();
+    ofctrl_io_thread = ovs_thread_create("ovn_ofctrl_io",
+                                         ofctrl_io_thread_main, NULL);
+}
+
+static void *
+ofctrl_io_thread_main(void *arg OVS_UNUSED)
+{
+    while (!latch_is_set(&ofctrl_io_exit)) {
+        uint64_t io_seq = seq_read(ofctrl_io_seq);
+
+        rconn_run(swconn);
+
+        rconn_run_wait(swconn);
+        seq_wait(ofctrl_io_seq, io_seq);
+        latch_wait(&ofctrl_io_exit);
+        poll_block();
+    }
+    return NULL;
+}
+
+/* Wakes up the I/O thread if messages were queued on 'swconn' since the
+ * last call. */
+static void
+ofctrl_io_wake(void)
+{
+    if (ofctrl_io_pending) {
+        ofctrl_io_pending = false;
+        seq_change(ofctrl_io_seq);
+    }
 }
 
 /* S_NEW, for a new connection.
@@ -625,16 +773,16 @@ error:
 }
 
 /* S_WAIT_BEFORE_CLEAR, we are almost ready to set up flows, but just wait for
- * a while until the initial flow compute to complete before we clear the
- * existing flows in OVS, so that we won't end up with an empty flow table,
- * which may cause data plane down time. */
+ * a while until the initial flow compute to complete before we clear (or
+ * reconcile with) the existing flows in OVS, so that we won't end up with an
+ * empty flow table, which may cause data plane down time. */
 static void
 run_S_WAIT_BEFORE_CLEAR(void)
 {
     if (!wait_before_clear_time ||
         (wait_before_clear_expire &&
          time_msec() >= wait_before_clear_expire)) {
-        state = S_CLEAR_FLOWS;
+        state = reconcile_on_connect ? S_DUMP_FLOWS : S_CLEAR_FLOWS;
         return;
     }
 
@@ -658,15 +806,12 @@ recv_S_WAIT_BEFORE_CLEAR(const struct ofp_header *oh, enum ofptype type,
  * Sends an OFPT_TABLE_MOD to clear all flows, then transitions to
  * S_UPDATE_FLOWS. */
 
+/* Forgets about everything installed in the switch, because the connection
+ * to it was (re)established. */
 static void
-run_S_CLEAR_FLOWS(void)
+ofctrl_reset_installed(void)
 {
-    VLOG_DBG("clearing all flows");
-
-    /* Set the flag so that the ofctrl_run() can clear the existing flows,
-     * groups and meters. We clear them in ofctrl_run() right before the new
-     * ones are installed to avoid data plane downtime. */
-    ofctrl_initial_clear = true;
+    ofctrl_reconcile_clear();
 
     /* Clear installed_flows, to match the state of the switch. */
     ovn_installed_flow_table_clear();
@@ -675,6 +820,9 @@ run_S_CLEAR_FLOWS(void)
     if (groups) {
         ovn_extend_table_clear(groups, true);
     }
+    if (pflow_groups) {
+        ovn_extend_table_clear(pflow_groups, true);
+    }
 
     /* Clear existing meters, to match the state of the switch. */
     if (meters) {
@@ -689,6 +837,21 @@ run_S_CLEAR_FLOWS(void)
         ovs_list_remove(&fup->list_node);
         free(fup);
     }
+    prio_xid = 0;
+    prio_cfg = 0;
+}
+
+static void
+run_S_CLEAR_FLOWS(void)
+{
+    VLOG_DBG("clearing all flows");
+
+    /* Set the flag so that the ofctrl_run() can clear the existing flows,
+     * groups and meters. We clear them in ofctrl_run() right before the new
+     * ones are installed to avoid data plane downtime. */
+    ofctrl_initial_clear = true;
+
+    ofctrl_reset_installed();
 
     state = S_UPDATE_FLOWS;
 
@@ -703,6 +866,200 @@ recv_S_CLEAR_FLOWS(const struct ofp_header *oh, enum ofptype type,
 {
     ofctrl_recv(oh, type);
 }
+
+/* S_DUMP_FLOWS, instead of S_CLEAR_FLOWS when reconciliation is enabled.
+ *
+ * Sends requests to dump all the flows, groups and meters of the switch,
+ * followed by an OFPT_BARRIER_REQUEST, and transitions to
+ * S_DUMP_FLOWS_REQUESTED. */
+
+static void
+run_S_DUMP_FLOWS(void)
+{
+    VLOG_DBG("dumping all flows");
+
+    /* Nothing is cleared, even if a previous connection went through
+     * S_CLEAR_FLOWS before ofctrl_put() could do it. */
+    ofctrl_initial_clear = false;
+    ofctrl_reset_installed();
+    ofctrl_reconciling = true;
+    lflows_reconcile_compared = false;
+    pflows_reconcile_compared = false;
+
+    struct ofputil_flow_stats_request fsr = {
+        .aggregate = false,
+        .out_port = OFPP_ANY,
+        .out_group = OFPG_ANY,
+        .table_id = OFPTT_ALL,
+    };
+    match_init_catchall(&fsr.match);
+    queue_msg(ofputil_encode_flow_stats_request(
+                  &fsr, ofputil_protocol_from_ofp_version(OFP15_VERSION)));
+    queue_msg(ofputil_encode_group_desc_request(OFP15_VERSION, OFPG_ALL));
+    queue_msg(ofputil_encode_meter_request(OFP15_VERSION,
+                                           OFPUTIL_METER_CONFIG,
+                                           OFPM13_ALL));
+    xid = queue_msg(ofputil_encode_barrier_request(OFP15_VERSION));
+
+    state = S_DUMP_FLOWS_REQUESTED;
+}
+
+static void
+recv_S_DUMP_FLOWS(const struct ofp_header *oh, enum ofptype type,
+                  struct shash *pending_ct_zones OVS_UNUSED)
+{
+    ofctrl_recv(oh, type);
+}
+
+/* S_DUMP_FLOWS_REQUESTED, when the dump requests have been sent and we're
+ * waiting for the replies.
+ *
+ * Each flow stats, group description and meter config reply is added to the
+ * reconciliation state.  The switch replies in order, so when we receive the
+ * OFPT_BARRIER_REPLY all the dumps are complete: transition to
+ * S_UPDATE_FLOWS.
+ *
+ * If a dump fails, e.g., because the switch does not support meters, the
+ * error is only logged: the corresponding objects will simply be added
+ * again by ofctrl_put(). */
+
+static void
+run_S_DUMP_FLOWS_REQUESTED(void)
+{
+}
+
+static void
+ofctrl_reconcile_add_id(struct hmap *ids, uint32_t id)
+{
+    struct ofctrl_reconcile_id *rid = xmalloc(sizeof *rid);
+    rid->id = id;
+    hmap_insert(ids, &rid->hmap_node, hash_int(id, 0));
+}
+
+static struct ofctrl_reconcile_id *
+ofctrl_reconcile_find_id(const struct hmap *ids, uint32_t id)
+{
+    struct ofctrl_reconcile_id *rid;
+    HMAP_FOR_EACH_WITH_HASH (rid, hmap_node, hash_int(id, 0), ids) {
+        if (rid->id == id) {
+            return rid;
+        }
+    }
+    return NULL;
+}
+
+static void
+ofctrl_reconcile_remove_id(struct hmap *ids, uint32_t id)
+{
+    struct ofctrl_reconcile_id *rid = ofctrl_reconcile_find_id(ids, id);
+    if (rid) {
+        hmap_remove(ids, &rid->hmap_node);
+        free(rid);
+    }
+}
+
+static void
+ofctrl_reconcile_recv_flows(const struct ofp_header *oh)
+{
+    struct ofpbuf b = ofpbuf_const_initializer(oh, ntohs(oh->length));
+    uint64_t ofpacts_stub[1024 / 8];
+    struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(ofpacts_stub);
+
+    for (;;) {
+        struct ofputil_flow_stats fs;
+        int retval = ofputil_decode_flow_stats_reply(&fs, &b, false,
+                                                     &ofpacts);
+        if (retval) {
+            if (retval != EOF) {
+                VLOG_WARN("failed to decode flow dump reply (%s)",
+                          ofperr_to_string(retval));
+            }
+            break;
+        }
+
+        struct installed_flow *i = installed_flow_from_stats(&fs);
+        if (installed_flow_lookup__(&i->flow, &reconcile_flows)) {
+            /* Only possible if OVS reports the same flow twice. */
+            installed_flow_destroy(i);
+        } else {
+            hmap_insert(&reconcile_flows, &i->match_hmap_node,
+                        i->flow.hash);
+        }
+    }
+    ofpbuf_uninit(&ofpacts);
+}
+
+static void
+ofctrl_reconcile_recv_groups(const struct ofp_header *oh)
+{
+    struct ofpbuf b = ofpbuf_const_initializer(oh, ntohs(oh->length));
+
+    for (;;) {
+        struct ofputil_group_desc gd;
+        int retval = ofputil_decode_group_desc_reply(&gd, &b, OFP15_VERSION);
+        if (retval) {
+            if (retval != EOF) {
+                VLOG_WARN("failed to decode group dump reply (%s)",
+                          ofperr_to_string(retval));
+            }
+            break;
+        }
+        if (!ofctrl_reconcile_find_id(&reconcile_group_ids, gd.group_id)) {
+            ofctrl_reconcile_add_id(&reconcile_group_ids, gd.group_id);
+        }
+        ofputil_uninit_group_desc(&gd);
+    }
+}
+
+static void
+ofctrl_reconcile_recv_meters(const struct ofp_header *oh)
+{
+    struct ofpbuf b = ofpbuf_const_initializer(oh, ntohs(oh->length));
+    struct ofpbuf bands;
+
+    ofpbuf_init(&bands, 64);
+    for (;;) {
+        struct ofputil_meter_config mc;
+        int retval = ofputil_decode_meter_config(&b, &mc, &bands);
+        if (retval) {
+            if (retval != EOF) {
+                VLOG_WARN("failed to decode meter dump reply (%s)",
+                          ofperr_to_string(retval));
+            }
+            break;
+        }
+        if (!ofctrl_reconcile_find_id(&reconcile_meter_ids, mc.meter_id)) {
+            ofctrl_reconcile_add_id(&reconcile_meter_ids, mc.meter_id);
+        }
+    }
+    ofpbuf_uninit(&bands);
+}
+
+static void
+recv_S_DUMP_FLOWS_REQUESTED(const struct ofp_header *oh, enum ofptype type,
+                            struct shash *pending_ct_zones OVS_UNUSED)
+{
+    if (type == OFPTYPE_FLOW_STATS_REPLY) {
+        ofctrl_reconcile_recv_flows(oh);
+    } else if (type == OFPTYPE_GROUP_DESC_STATS_REPLY) {
+        ofctrl_reconcile_recv_groups(oh);
+    } else if (type == OFPTYPE_METER_CONFIG_STATS_REPLY) {
+        ofctrl_reconcile_recv_meters(oh);
+    } else if (type == OFPTYPE_BARRIER_REPLY && oh->xid == xid) {
+        VLOG_INFO("reconciling with %"PRIuSIZE" flows, %"PRIuSIZE" groups "
+                  "and %"PRIuSIZE" meters found in the switch",
+                  hmap_count(&reconcile_flows),
+                  hmap_count(&reconcile_group_ids),
+                  hmap_count(&reconcile_meter_ids));
+        state = S_UPDATE_FLOWS;
+
+        /* Give a chance for the main loop to call ofctrl_put(), as for
+         * S_CLEAR_FLOWS. */
+        poll_immediate_wake();
+    } else {
+        ofctrl_recv(oh, type);
+    }
+}
 
 /* S_UPDATE_FLOWS, for maintaining the flow table over time.
  *
@@ -724,7 +1081,23 @@ static void
 recv_S_UPDATE_FLOWS(const struct ofp_header *oh, enum ofptype type,
                     struct shash *pending_ct_zones)
 {
-    if (type == OFPTYPE_BARRIER_REPLY && !ovs_list_is_empty(&flow_updates)) {
+    if (type == OFPTYPE_BARRIER_REPLY && prio_xid && oh->xid == prio_xid) {
+        prio_cfg = MAX(prio_cfg, prio_req_cfg);
+        prio_xid = 0;
+    } else if (type == OFPTYPE_BARRIER_REPLY && ct_flush_xid
+               && oh->xid == ct_flush_xid) {
+        /* The conntrack flushes of the batch succeeded.  Move their pending
+         * ct zone entries to the next stage. */
+        struct shash_node *iter;
+        SHASH_FOR_EACH (iter, pending_ct_zones) {
+            struct ct_zone_pending_entry *ctzpe = iter->data;
+            if (ctzpe->state == CT_ZONE_OF_SENT && ctzpe->of_xid == oh->xid) {
+                ctzpe->state = CT_ZONE_DB_QUEUED;
+            }
+        }
+        ct_flush_xid = 0;
+    } else if (type == OFPTYPE_BARRIER_REPLY
+               && !ovs_list_is_empty(&flow_updates)) {
         struct ofctrl_flow_update *fup = ofctrl_flow_update_from_list_node(
             ovs_list_front(&flow_updates));
         if (fup->xid == oh->xid) {
@@ -737,10 +1110,10 @@ recv_S_UPDATE_FLOWS(const struct ofp_header *oh, enum ofptype type,
         }
 
         /* If the barrier xid is associated with an outstanding conntrack
-         * flush, the flush succeeded.  Move the pending ct zone entry
-         * to the next stage. */
+         * flush of a new zone user, the flush succeeded.  Move the pending
+         * ct zone entry to the next stage. */
         struct shash_node *iter;
-        SHASH_FOR_EACH(iter, pending_ct_zones) {
+        SHASH_FOR_EACH (iter, pending_ct_zones) {
             struct ct_zone_pending_entry *ctzpe = iter->data;
             if (ctzpe->state == CT_ZONE_OF_SENT && ctzpe->of_xid == oh->xid) {
                 ctzpe->state = CT_ZONE_DB_QUEUED;
@@ -760,6 +1133,8 @@ ofctrl_get_mf_field_id(void)
     }
     return (state == S_WAIT_BEFORE_CLEAR
             || state == S_CLEAR_FLOWS
+            || state == S_DUMP_FLOWS
+            || state == S_DUMP_FLOWS_REQUESTED
             || state == S_UPDATE_FLOWS
             ? mff_ovn_geneve : 0);
 }
@@ -790,6 +1165,7 @@ ofctrl_run(const char *conn_target, int probe_interval,
         state = S_NEW;
 
         /* Reset the state of any outstanding ct flushes to resend them. */
+        ct_flush_xid = 0;
         struct shash_node *iter;
         SHASH_FOR_EACH(iter, pending_ct_zones) {
             struct ct_zone_pending_entry *ctzpe = iter->data;
@@ -808,6 +1184,17 @@ ofctrl_run(const char *conn_target, int probe_interval,
                   _wait_before_clear_time, wait_before_clear_time);
         wait_before_clear_time = _wait_before_clear_time;
     }
+    bundle_max_flow_mods = smap_get_uint(&cfg->external_ids,
+                                         "ovn-ofctrl-bundle-max-flow-mods", 0);
+    bundle_max_bytes = smap_get_uint(&cfg->external_ids,
+                                     "ovn-ofctrl-bundle-max-bytes", 0);
+    bool _reconcile_on_connect =
+        smap_get_bool(&cfg->external_ids, "ovn-ofctrl-reconcile", false);
+    if (_reconcile_on_connect != reconcile_on_connect) {
+        VLOG_INFO("ofctrl-reconcile is now %s",
+                  _reconcile_on_connect ? "enabled" : "disabled");
+        reconcile_on_connect = _reconcile_on_connect;
+    }
 
     bool progress = true;
     for (int i = 0; progress && i < 50; i++) {
@@ -856,6 +1243,7 @@ ofctrl_run(const char *conn_target, int probe_interval,
          * point, so ensure that we come back again without waiting. */
         poll_immediate_wake();
     }
+    ofctrl_io_wake();
 
     return reconnected;
 }
@@ -870,9 +1258,20 @@ ofctrl_wait(void)
 void
 ofctrl_destroy(void)
 {
+    latch_set(&ofctrl_io_exit);
+    xpthread_join(ofctrl_io_thread, NULL);
+    latch_destroy(&ofctrl_io_exit);
+    seq_destroy(ofctrl_io_seq);
+
     rconn_destroy(swconn);
+    ofctrl_reconcile_clear();
+    hmap_destroy(&reconcile_flows);
+    hmap_destroy(&reconcile_group_ids);
+    hmap_destroy(&reconcile_meter_ids);
     ovn_installed_flow_table_destroy();
-    rconn_packet_counter_destroy(tx_counter);
+    hmap_destroy(&flow_actions_table);
+    rconn_packet_counter_destroy(tx_counters[0]);
+    rconn_packet_counter_destroy(tx_counters[1]);
     expr_symtab_destroy(&symtab);
     shash_destroy(&symtab);
     ofctrl_meter_bands_destroy();
@@ -883,6 +1282,15 @@ ofctrl_get_cur_cfg(void)
 {
     return cur_cfg;
 }
+
+/* Returns the latest req_cfg for which the prioritized flows, see
+ * ofctrl_prioritize_flows(), have been installed in the switch.  The other
+ * flows of that req_cfg may still be in flight. */
+uint64_t
+ofctrl_get_prio_cfg(void)
+{
+    return MAX(prio_cfg, cur_cfg);
+}
 
 static ovs_be32
 queue_msg(struct ofpbuf *msg)
@@ -890,6 +1298,7 @@ queue_msg(struct ofpbuf *msg)
     const struct ofp_header *oh = msg->data;
     ovs_be32 xid_ = oh->xid;
     rconn_send(swconn, msg, tx_counter);
+    ofctrl_io_pending = true;
     return xid_;
 }
 
@@ -1146,7 +1555,7 @@ link_flow_to_sb(struct ovn_desired_flow_table *flow_table,
                 struct desired_flow *f, const struct uuid *sb_uuid,
                 const struct addrset_info *as_info)
 {
-    struct sb_flow_ref *sfr = xmalloc(sizeof *sfr);
+    struct sb_flow_ref *sfr = ovn_slab_alloc(&sb_flow_ref_slab);
     mem_stats.sb_flow_ref_usage += sb_flow_ref_size(sfr);
     sfr->flow = f;
     sfr->sb_uuid = *sb_uuid;
@@ -1243,8 +1652,8 @@ ofctrl_check_and_add_flow_metered(struct ovn_desired_flow_table *flow_table,
         return;
     }
 
-    hmap_insert(&flow_table->match_flow_table, &f->match_hmap_node,
-                f->flow.hash);
+    resizing_hmap_insert(&flow_table->match_flow_table, &f->match_hmap_node,
+                         f->flow.hash);
     link_flow_to_sb(flow_table, f, sb_uuid, as_info);
     track_flow_add_or_modify(flow_table, f);
     ovn_flow_log(&f->flow, "ofctrl_add_flow");
@@ -1357,33 +1766,23 @@ ofctrl_add_or_append_flow(struct ovn_desired_flow_table *desired_flows,
 
         ofpact_refs_destroy(&existing_conj);
 
-        mem_stats.desired_flow_usage -= desired_flow_size(existing);
-        free(existing->flow.ofpacts);
-        existing->flow.ofpacts = xmemdup(compound.data, compound.size);
+        ovn_flow_actions_unref(existing->flow.ofpacts);
+        existing->flow.ofpacts = ovn_flow_actions_create(compound.data,
+                                                         compound.size);
         existing->flow.ofpacts_len = compound.size;
-        mem_stats.desired_flow_usage += desired_flow_size(existing);
 
         ofpbuf_uninit(&compound);
         desired_flow_destroy(f);
         f = existing;
 
-        /* Since the flow now shared by more than one SB lflows, don't track
-         * it with address set ips. So remove any existed as_info tracking, and
-         * then add the new sb link without as_info.
-         *
-         * XXX: this may still be tracked if the flow is shared by different
-         * lflows, but we need to remove the related conjunction from the
-         * actions properly when handle addrset ip deletion, instead of simply
-         * delete the flow. */
-        struct sb_flow_ref *sfr;
-        LIST_FOR_EACH (sfr, sb_list, &f->references) {
-            ovs_list_remove(&sfr->as_ip_flow_list);
-            ovs_list_init(&sfr->as_ip_flow_list);
-        }
-        link_flow_to_sb(desired_flows, f, sb_uuid, NULL);
+        /* The flow is still tracked with the address set ips of each of the
+         * lflows that share it.  When one of the ips is deleted, only the
+         * conjunctions of that lflow are removed from the actions, see
+         * ofctrl_remove_flows_for_as_ip(). */
+        link_flow_to_sb(desired_flows, f, sb_uuid, as_info);
     } else {
-        hmap_insert(&desired_flows->match_flow_table, &f->match_hmap_node,
-                    f->flow.hash);
+        resizing_hmap_insert(&desired_flows->match_flow_table,
+                             &f->match_hmap_node, f->flow.hash);
         link_flow_to_sb(desired_flows, f, sb_uuid, as_info);
     }
     track_flow_add_or_modify(desired_flows, f);
@@ -1408,6 +1807,9 @@ ofctrl_remove_flows(struct ovn_desired_flow_table *flow_table,
 
     /* remove any related group and meter info */
     ovn_extend_table_remove_desired(groups, sb_uuid);
+    if (pflow_groups) {
+        ovn_extend_table_remove_desired(pflow_groups, sb_uuid);
+    }
     ovn_extend_table_remove_desired(meters, sb_uuid);
 }
 
@@ -1450,16 +1852,71 @@ ofctrl_flood_remove_flows(struct ovn_desired_flow_table *flow_table,
     }
 }
 
+/* Removes from the actions of the conjunctive flow 'f' the conjunctions
+ * whose ids are allocated to 'lflow_uuid' in 'conj_ids'.  Returns false,
+ * without modifying 'f', if that would leave 'f' without actions. */
+static bool
+desired_flow_remove_conjs(struct desired_flow *f,
+                          const struct uuid *lflow_uuid,
+                          const struct conj_ids *conj_ids)
+{
+    uint64_t ofpacts_stub[64 / 8];
+    struct ofpbuf ofpacts = OFPBUF_STUB_INITIALIZER(ofpacts_stub);
+
+    const struct ofpact *ofpact;
+    OFPACT_FOR_EACH (ofpact, f->flow.ofpacts, f->flow.ofpacts_len) {
+        if (ofpact->type != OFPACT_CONJUNCTION
+            || !lflow_conj_ids_is_allocated_to(
+                    conj_ids, ofpact_get_CONJUNCTION(ofpact)->id,
+                    lflow_uuid)) {
+            ofpbuf_put(&ofpacts, ofpact, OFPACT_ALIGN(ofpact->len));
+        }
+    }
+
+    if (!ofpacts.size) {
+        ofpbuf_uninit(&ofpacts);
+        return false;
+    }
+
+    ovn_flow_actions_unref(f->flow.ofpacts);
+    f->flow.ofpacts = ovn_flow_actions_create(ofpacts.data, ofpacts.size);
+    f->flow.ofpacts_len = ofpacts.size;
+
+    ofpbuf_uninit(&ofpacts);
+    return true;
+}
+
+/* Returns true if 'f' is referenced by 'sb_uuid' other than through
+ * 'except'. */
+static bool
+desired_flow_has_other_ref(const struct desired_flow *f,
+                           const struct uuid *sb_uuid,
+                           const struct sb_flow_ref *except)
+{
+    const struct sb_flow_ref *sfr;
+    LIST_FOR_EACH (sfr, sb_list, &f->references) {
+        if (sfr != except && uuid_equals(&sfr->sb_uuid, sb_uuid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* Remove desired flows related to the specified 'addrset_info' for the
  * 'lflow_uuid'. Returns true if it can be processed completely, otherwise
  * returns false, which would trigger a reprocessing of the lflow of
  * 'lflow_uuid'. The expected_count is checked against the actual flows
- * deleted, and if it doesn't match, return false, too. */
+ * deleted, and if it doesn't match, return false, too.
+ *
+ * Conjunctive flows shared with other lflows are not deleted, only the
+ * conjunctions of 'lflow_uuid', as allocated in 'conj_ids', are removed
+ * from their actions. */
 bool
 ofctrl_remove_flows_for_as_ip(struct ovn_desired_flow_table *flow_table,
                               const struct uuid *lflow_uuid,
                               const struct addrset_info *as_info,
-                              size_t expected_count)
+                              size_t expected_count,
+                              const struct conj_ids *conj_ids)
 {
     struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
                                              lflow_uuid);
@@ -1494,24 +1951,35 @@ ofctrl_remove_flows_for_as_ip(struct ovn_desired_flow_table *flow_table,
     struct sb_flow_ref *sfr;
     size_t count = 0;
     LIST_FOR_EACH_SAFE (sfr, as_ip_flow_list, &itfn->flows) {
-        /* If the desired flow is referenced by multiple sb lflows, it
-         * shouldn't have been indexed by address set. */
-        ovs_assert(ovs_list_is_short(&sfr->sb_list));
+        struct desired_flow *f = sfr->flow;
+        bool shared = !ovs_list_is_short(&sfr->sb_list);
+
+        if (shared) {
+            /* The conjunctions of the lflow can only be removed if it
+             * doesn't use the flow for anything else. */
+            if (desired_flow_has_other_ref(f, lflow_uuid, sfr)
+                || !desired_flow_remove_conjs(f, lflow_uuid, conj_ids)) {
+                return false;
+            }
+        }
 
         ovs_list_remove(&sfr->sb_list);
         ovs_list_remove(&sfr->flow_list);
         ovs_list_remove(&sfr->as_ip_flow_list);
-
-        struct desired_flow *f = sfr->flow;
         mem_stats.sb_flow_ref_usage -= sb_flow_ref_size(sfr);
-        free(sfr);
+        ovn_slab_free(&sb_flow_ref_slab, sfr);
 
         ovs_assert(ovs_list_is_empty(&f->list_node));
-        ovs_assert(ovs_list_is_empty(&f->references));
-        ovn_flow_log(&f->flow, "remove_flows_for_as_ip");
-        hmap_remove(&flow_table->match_flow_table,
-                    &f->match_hmap_node);
-        track_or_destroy_for_flow_del(flow_table, f);
+        if (shared) {
+            ovn_flow_log(&f->flow, "remove_conjs_for_as_ip");
+            track_flow_add_or_modify(flow_table, f);
+        } else {
+            ovs_assert(ovs_list_is_empty(&f->references));
+            ovn_flow_log(&f->flow, "remove_flows_for_as_ip");
+            resizing_hmap_remove(&flow_table->match_flow_table,
+                                 &f->match_hmap_node);
+            track_or_destroy_for_flow_del(flow_table, f);
+        }
         count++;
     }
 
@@ -1541,15 +2009,15 @@ remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
         ovs_list_remove(&sfr->as_ip_flow_list);
         struct desired_flow *f = sfr->flow;
         mem_stats.sb_flow_ref_usage -= sb_flow_ref_size(sfr);
-        free(sfr);
+        ovn_slab_free(&sb_flow_ref_slab, sfr);
 
         ovs_assert(ovs_list_is_empty(&f->list_node));
         if (ovs_list_is_empty(&f->references)) {
             if (log_msg) {
                 ovn_flow_log(&f->flow, log_msg);
             }
-            hmap_remove(&flow_table->match_flow_table,
-                        &f->match_hmap_node);
+            resizing_hmap_remove(&flow_table->match_flow_table,
+                                 &f->match_hmap_node);
             track_or_destroy_for_flow_del(flow_table, f);
         } else if (flood_remove_nodes) {
             ovs_list_insert(&to_be_removed, &f->list_node);
@@ -1598,20 +2066,105 @@ remove_flows_from_sb_to_flow(struct ovn_desired_flow_table *flow_table,
             }
             ovs_list_remove(&sfr->sb_list);
             mem_stats.sb_flow_ref_usage -= sb_flow_ref_size(sfr);
-            free(sfr);
+            ovn_slab_free(&sb_flow_ref_slab, sfr);
         }
         ovs_list_remove(&f->list_node);
         if (log_msg) {
             ovn_flow_log(&f->flow, log_msg);
         }
-        hmap_remove(&flow_table->match_flow_table,
-                    &f->match_hmap_node);
+        resizing_hmap_remove(&flow_table->match_flow_table,
+                             &f->match_hmap_node);
         track_or_destroy_for_flow_del(flow_table, f);
     }
 }
 
 /* flow operations. */
 
+/* The actions of flows are interned in reference counted buffers: all the
+ * desired and installed flows with byte-identical actions share the same
+ * buffer, so two flows have the same actions if and only if their 'ofpacts'
+ * pointers are equal.  The buffers are never modified once created: changing
+ * the actions of a flow means replacing its buffer. */
+struct ovn_flow_actions {
+    struct hmap_node hmap_node; /* In 'flow_actions_table'. */
+    size_t ref_count;
+    size_t len;
+    /* Followed by 'len' bytes of ofpacts, at OVN_FLOW_ACTIONS_OFS. */
+};
+
+static struct hmap flow_actions_table =
+    HMAP_INITIALIZER(&flow_actions_table);
+
+#define OVN_FLOW_ACTIONS_OFS \
+    ROUND_UP(sizeof(struct ovn_flow_actions), OFPACT_ALIGNTO)
+
+static struct ovn_flow_actions *
+ovn_flow_actions_from_ofpacts(const struct ofpact *ofpacts)
+{
+    return (struct ovn_flow_actions *) ((char *) ofpacts
+                                        - OVN_FLOW_ACTIONS_OFS);
+}
+
+static struct ofpact *
+ovn_flow_actions_get_ofpacts(const struct ovn_flow_actions *fa)
+{
+    return (struct ofpact *) ((char *) fa + OVN_FLOW_ACTIONS_OFS);
+}
+
+static struct ofpact *ovn_flow_actions_ref(struct ofpact *);
+
+/* Returns a reference to the interned buffer holding the 'len' bytes of
+ * 'ofpacts', creating it if needed. */
+static struct ofpact *
+ovn_flow_actions_create(const void *ofpacts, size_t len)
+{
+    uint32_t hash = hash_bytes(ofpacts, len, 0);
+    struct ovn_flow_actions *fa;
+
+    HMAP_FOR_EACH_WITH_HASH (fa, hmap_node, hash, &flow_actions_table) {
+        struct ofpact *interned = ovn_flow_actions_get_ofpacts(fa);
+        if (fa->len == len && !memcmp(interned, ofpacts, len)) {
+            return ovn_flow_actions_ref(interned);
+        }
+    }
+
+    fa = xmalloc(OVN_FLOW_ACTIONS_OFS + len);
+    fa->ref_count = 1;
+    fa->len = len;
+    memcpy(ovn_flow_actions_get_ofpacts(fa), ofpacts, len);
+    hmap_insert(&flow_actions_table, &fa->hmap_node, hash);
+    mem_stats.flow_actions_usage += OVN_FLOW_ACTIONS_OFS + len;
+    return ovn_flow_actions_get_ofpacts(fa);
+}
+
+static struct ofpact *
+ovn_flow_actions_ref(struct ofpact *ofpacts)
+{
+    struct ovn_flow_actions *fa = ovn_flow_actions_from_ofpacts(ofpacts);
+
+    fa->ref_count++;
+    mem_stats.shared_flow_actions += fa->len;
+    return ofpacts;
+}
+
+static void
+ovn_flow_actions_unref(struct ofpact *ofpacts)
+{
+    if (!ofpacts) {
+        return;
+    }
+
+    struct ovn_flow_actions *fa = ovn_flow_actions_from_ofpacts(ofpacts);
+    ovs_assert(fa->ref_count > 0);
+    if (--fa->ref_count) {
+        mem_stats.shared_flow_actions -= fa->len;
+    } else {
+        mem_stats.flow_actions_usage -= OVN_FLOW_ACTIONS_OFS + fa->len;
+        hmap_remove(&flow_actions_table, &fa->hmap_node);
+        free(fa);
+    }
+}
+
 static void
 ovn_flow_init(struct ovn_flow *f, uint8_t table_id, uint16_t priority,
               uint64_t cookie, const struct match *match,
@@ -1620,17 +2173,19 @@ ovn_flow_init(struct ovn_flow *f, uint8_t table_id, uint16_t priority,
     f->table_id = table_id;
     f->priority = priority;
     minimatch_init(&f->match, match);
-    f->ofpacts = xmemdup(actions->data, actions->size);
+    f->ofpacts = ovn_flow_actions_create(actions->data, actions->size);
     f->ofpacts_len = actions->size;
     f->hash = ovn_flow_match_hash(f);
     f->cookie = cookie;
     f->ctrl_meter_id = meter_id;
 }
 
+/* Doesn't include the actions, which are accounted separately since they
+ * may be shared with an installed flow. */
 static size_t
 desired_flow_size(const struct desired_flow *f)
 {
-    return sizeof *f + f->flow.ofpacts_len;
+    return sizeof *f;
 }
 
 static struct desired_flow *
@@ -1638,7 +2193,7 @@ desired_flow_alloc(uint8_t table_id, uint16_t priority, uint64_t cookie,
                    const struct match *match, const struct ofpbuf *actions,
                    uint32_t meter_id)
 {
-    struct desired_flow *f = xmalloc(sizeof *f);
+    struct desired_flow *f = ovn_slab_alloc(&desired_flow_slab);
     ovs_list_init(&f->references);
     ovs_list_init(&f->list_node);
     ovs_list_init(&f->installed_ref_list_node);
@@ -1660,22 +2215,23 @@ ovn_flow_match_hash(const struct ovn_flow *f)
                        minimatch_hash(&f->match, 0));
 }
 
+/* Doesn't include the actions, see desired_flow_size(). */
 static size_t
 installed_flow_size(const struct installed_flow *f)
 {
-    return sizeof *f + f->flow.ofpacts_len;
+    return sizeof *f;
 }
 
 /* Duplicate a desired flow to an installed flow. */
 static struct installed_flow *
 installed_flow_dup(struct desired_flow *src)
 {
-    struct installed_flow *dst = xmalloc(sizeof *dst);
+    struct installed_flow *dst = ovn_slab_alloc(&installed_flow_slab);
     ovs_list_init(&dst->desired_refs);
     dst->flow.table_id = src->flow.table_id;
     dst->flow.priority = src->flow.priority;
     minimatch_clone(&dst->flow.match, &src->flow.match);
-    dst->flow.ofpacts = xmemdup(src->flow.ofpacts, src->flow.ofpacts_len);
+    dst->flow.ofpacts = ovn_flow_actions_ref(src->flow.ofpacts);
     dst->flow.ofpacts_len = src->flow.ofpacts_len;
     dst->flow.hash = src->flow.hash;
     dst->flow.cookie = src->flow.cookie;
@@ -1684,6 +2240,24 @@ installed_flow_dup(struct desired_flow *src)
     return dst;
 }
 
+/* Creates an installed flow from a flow dumped from the switch.  The meter
+ * used by its controller actions is not known until it is matched to a
+ * desired flow. */
+static struct installed_flow *
+installed_flow_from_stats(const struct ofputil_flow_stats *fs)
+{
+    struct installed_flow *dst = ovn_slab_alloc(&installed_flow_slab);
+    struct ofpbuf actions = ofpbuf_const_initializer(fs->ofpacts,
+                                                     fs->ofpacts_len);
+
+    ovs_list_init(&dst->desired_refs);
+    ovn_flow_init(&dst->flow, fs->table_id, fs->priority,
+                  ntohll(fs->cookie), &fs->match, &actions,
+                  NX_CTLR_NO_METER);
+    mem_stats.installed_flow_usage += installed_flow_size(dst);
+    return dst;
+}
+
 static struct desired_flow *
 installed_flow_get_active(struct installed_flow *f)
 {
@@ -1703,7 +2277,9 @@ desired_flow_lookup__(struct ovn_desired_flow_table *flow_table,
 {
     struct desired_flow *d;
     HMAP_FOR_EACH_WITH_HASH (d, match_hmap_node, target->hash,
-                             &flow_table->match_flow_table) {
+                             resizing_hmap_for_hash(
+                                 &flow_table->match_flow_table,
+                                 target->hash)) {
         struct ovn_flow *f = &d->flow;
         if (f->table_id == target->table_id
             && f->priority == target->priority
@@ -1779,15 +2355,13 @@ desired_flow_lookup_conjunctive(struct ovn_desired_flow_table *flow_table,
                                  NULL);
 }
 
-/* Finds and returns an installed_flow in installed_flows whose key is
- * identical to 'target''s key, or NULL if there is none. */
+/* Finds and returns an installed_flow in 'flows' whose key is identical to
+ * 'target''s key, or NULL if there is none. */
 static struct installed_flow *
-installed_flow_lookup(const struct ovn_flow *target,
-                      struct hmap *installed_flows)
+installed_flow_lookup__(const struct ovn_flow *target, struct hmap *flows)
 {
     struct installed_flow *i;
-    HMAP_FOR_EACH_WITH_HASH (i, match_hmap_node, target->hash,
-                             installed_flows) {
+    HMAP_FOR_EACH_WITH_HASH (i, match_hmap_node, target->hash, flows) {
         struct ovn_flow *f = &i->flow;
         if (f->table_id == target->table_id
             && f->priority == target->priority
@@ -1798,6 +2372,16 @@ installed_flow_lookup(const struct ovn_flow *target,
     return NULL;
 }
 
+/* Finds and returns an installed_flow in installed_flows whose key is
+ * identical to 'target''s key, or NULL if there is none. */
+static struct installed_flow *
+installed_flow_lookup(const struct ovn_flow *target,
+                      struct resizing_hmap *installed_flows)
+{
+    return installed_flow_lookup__(
+        target, resizing_hmap_for_hash(installed_flows, target->hash));
+}
+
 static char *
 ovn_flow_to_string(const struct ovn_flow *f)
 {
@@ -1839,7 +2423,7 @@ static void
 ovn_flow_uninit(struct ovn_flow *f)
 {
     minimatch_destroy(&f->match);
-    free(f->ofpacts);
+    ovn_flow_actions_unref(f->ofpacts);
 }
 
 static void
@@ -1850,7 +2434,7 @@ desired_flow_destroy(struct desired_flow *f)
         ovs_assert(!f->installed_flow);
         mem_stats.desired_flow_usage -= desired_flow_size(f);
         ovn_flow_uninit(&f->flow);
-        free(f);
+        ovn_slab_free(&desired_flow_slab, f);
     }
 }
 
@@ -1861,7 +2445,7 @@ installed_flow_destroy(struct installed_flow *f)
         ovs_assert(!installed_flow_get_active(f));
         mem_stats.installed_flow_usage -= installed_flow_size(f);
         ovn_flow_uninit(&f->flow);
-        free(f);
+        ovn_slab_free(&installed_flow_slab, f);
     }
 }
 
@@ -1869,10 +2453,12 @@ installed_flow_destroy(struct installed_flow *f)
 void
 ovn_desired_flow_table_init(struct ovn_desired_flow_table *flow_table)
 {
-    hmap_init(&flow_table->match_flow_table);
+    resizing_hmap_init(&flow_table->match_flow_table);
     hmap_init(&flow_table->uuid_flow_table);
     ovs_list_init(&flow_table->tracked_flows);
+    uuidset_init(&flow_table->prio_uuids);
     flow_table->change_tracked = false;
+    flow_table->incomplete = false;
 }
 
 void
@@ -1895,14 +2481,39 @@ ovn_desired_flow_table_clear(struct ovn_desired_flow_table *flow_table)
     HMAP_FOR_EACH_SAFE (stf, hmap_node, &flow_table->uuid_flow_table) {
         remove_flows_from_sb_to_flow(flow_table, stf, NULL, NULL);
     }
+    uuidset_clear(&flow_table->prio_uuids);
 }
 
 void
 ovn_desired_flow_table_destroy(struct ovn_desired_flow_table *flow_table)
 {
     ovn_desired_flow_table_clear(flow_table);
-    hmap_destroy(&flow_table->match_flow_table);
+    resizing_hmap_destroy(&flow_table->match_flow_table);
     hmap_destroy(&flow_table->uuid_flow_table);
+    uuidset_destroy(&flow_table->prio_uuids);
+}
+
+/* Makes the next ofctrl_put() send the changes to the flows of 'sb_uuid' in
+ * 'flow_table' before all the other ones, in their own bundle followed by a
+ * barrier, so that they are installed as soon as possible even if there are
+ * many other changes, e.g., the flows of a newly claimed port during a
+ * recompute. */
+void
+ofctrl_prioritize_flows(struct ovn_desired_flow_table *flow_table,
+                        const struct uuid *sb_uuid)
+{
+    uuidset_insert(&flow_table->prio_uuids, sb_uuid);
+}
+
+/* Returns the number of flows of 'sb_uuid' in 'flow_table'. */
+size_t
+ofctrl_count_flows(const struct ovn_desired_flow_table *flow_table,
+                   const struct uuid *sb_uuid)
+{
+    struct hmap *uuid_flow_table =
+        CONST_CAST(struct hmap *, &flow_table->uuid_flow_table);
+    struct sb_to_flow *stf = sb_to_flow_find(uuid_flow_table, sb_uuid);
+    return stf ? ovs_list_size(&stf->flows) : 0;
 }
 
 
@@ -1910,26 +2521,45 @@ ovn_desired_flow_table_destroy(struct ovn_desired_flow_table *flow_table)
 static void
 ovn_installed_flow_table_clear(void)
 {
+    struct hmap *lflows = resizing_hmap_settle(&installed_lflows);
     struct installed_flow *f;
-    HMAP_FOR_EACH_SAFE (f, match_hmap_node, &installed_lflows) {
-        hmap_remove(&installed_lflows, &f->match_hmap_node);
+    HMAP_FOR_EACH_POP (f, match_hmap_node, lflows) {
         unlink_all_refs_for_installed_flow(f);
         installed_flow_destroy(f);
     }
 
-    HMAP_FOR_EACH_SAFE (f, match_hmap_node, &installed_pflows) {
-        hmap_remove(&installed_pflows, &f->match_hmap_node);
+    struct hmap *pflows = resizing_hmap_settle(&installed_pflows);
+    HMAP_FOR_EACH_POP (f, match_hmap_node, pflows) {
         unlink_all_refs_for_installed_flow(f);
         installed_flow_destroy(f);
     }
 }
 
+static void
+ofctrl_reconcile_clear(void)
+{
+    struct installed_flow *f;
+    HMAP_FOR_EACH_POP (f, match_hmap_node, &reconcile_flows) {
+        installed_flow_destroy(f);
+    }
+
+    struct ofctrl_reconcile_id *rid;
+    HMAP_FOR_EACH_POP (rid, hmap_node, &reconcile_group_ids) {
+        free(rid);
+    }
+    HMAP_FOR_EACH_POP (rid, hmap_node, &reconcile_meter_ids) {
+        free(rid);
+    }
+
+    ofctrl_reconciling = false;
+}
+
 static void
 ovn_installed_flow_table_destroy(void)
 {
     ovn_installed_flow_table_clear();
-    hmap_destroy(&installed_lflows);
-    hmap_destroy(&installed_pflows);
+    resizing_hmap_destroy(&installed_lflows);
+    resizing_hmap_destroy(&installed_pflows);
 }
 
 /* Flow table update. */
@@ -1954,18 +2584,97 @@ encode_bundle_add(struct ofpbuf *msg, struct ofputil_bundle_ctrl_msg *bc)
     return ofputil_encode_bundle_add(OFP15_VERSION, &bam);
 }
 
+/* Returns a message that adds 'fm' to the bundle 'bc', the same as the one
+ * that encode_bundle_add() returns for the message from encode_flow_mod(),
+ * and sets '*flow_mod_len' to the length of the flow_mod in it.
+ *
+ * The flow_mod is encoded directly in the bundle message, rather than in a
+ * message of its own that would then be copied, which saves two memory
+ * allocations and a copy for each of the flow_mods of a bulk update. */
+struct ofpbuf *
+ofctrl_encode_bundle_flow_mod(const struct ofputil_flow_mod *fm,
+                              const struct ofputil_bundle_ctrl_msg *bc,
+                              size_t *flow_mod_len)
+{
+    enum ofputil_protocol protocol = OFPUTIL_P_OF15_OXM;
+
+    if (fm->flags) {
+        /* Not needed by ofctrl, the flags require a conversion. */
+        struct ofputil_flow_mod copy = *fm;
+        struct ofpbuf *msg = encode_flow_mod(&copy);
+        struct ofpbuf *bundle_msg = encode_bundle_add(msg, bc);
+
+        *flow_mod_len = msg->size;
+        ofpbuf_delete(msg);
+        return bundle_msg;
+    }
+
+    struct ofpbuf *msg = ofpraw_alloc(OFPRAW_OFPT14_BUNDLE_ADD_MESSAGE,
+                                      OFP15_VERSION,
+                                      sizeof(struct ofp14_bundle_ctrl_msg)
+                                      + sizeof(struct ofp_header)
+                                      + sizeof(struct ofp11_flow_mod)
+                                      + ofputil_match_typical_len(protocol)
+                                      + fm->ofpacts_len);
+    const struct ofp_header *bundle_oh = msg->data;
+
+    /* The flow_mod must have the same xid as the bundle message. */
+    ovs_be32 xid = bundle_oh->xid;
+
+    struct ofp14_bundle_ctrl_msg *m = ofpbuf_put_zeros(msg, sizeof *m);
+    m->bundle_id = htonl(bc->bundle_id);
+    m->flags = htons(bc->flags);
+
+    size_t ofs = msg->size;
+    ofpraw_put_xid(OFPRAW_OFPT11_FLOW_MOD, OFP15_VERSION, xid, msg);
+
+    struct ofp11_flow_mod *ofm = ofpbuf_put_zeros(msg, sizeof *ofm);
+    ofm->cookie = (fm->command == OFPFC_ADD
+                   ? fm->new_cookie
+                   : fm->cookie & fm->cookie_mask);
+    ofm->cookie_mask = fm->cookie_mask;
+    if (fm->table_id != OFPTT_ALL
+        || fm->command == OFPFC_DELETE
+        || fm->command == OFPFC_DELETE_STRICT) {
+        ofm->table_id = fm->table_id;
+    }
+    ofm->command = fm->command;
+    ofm->idle_timeout = htons(fm->idle_timeout);
+    ofm->hard_timeout = htons(fm->hard_timeout);
+    ofm->priority = htons(fm->priority);
+    ofm->buffer_id = htonl(UINT32_MAX);
+    ofm->out_port = ofputil_port_to_ofp11(OFPP_ANY);
+    ofm->out_group = htonl(OFPG_ANY);
+    if (fm->command == OFPFC_ADD) {
+        ofm->importance = htons(fm->importance);
+    }
+
+    struct match match;
+    minimatch_expand(&fm->match, &match);
+    ofputil_put_ofp11_match(msg, &match, protocol);
+    ofpacts_put_openflow_instructions(fm->ofpacts, fm->ofpacts_len, msg,
+                                      OFP15_VERSION);
+
+    /* Too long messages are dropped by the caller, their lengths don't
+     * matter. */
+    *flow_mod_len = msg->size - ofs;
+    struct ofp_header *oh = ofpbuf_at_assert(msg, ofs, sizeof *oh);
+    oh->length = htons(MIN(*flow_mod_len, UINT16_MAX));
+    msg->header = msg->data;
+    ofpmsg_update_length(msg);
+
+    return msg;
+}
+
 static bool
 add_flow_mod(struct ofputil_flow_mod *fm,
              struct ofputil_bundle_ctrl_msg *bc,
              struct ovs_list *msgs)
 {
-    struct ofpbuf *msg = encode_flow_mod(fm);
-    struct ofpbuf *bundle_msg = encode_bundle_add(msg, bc);
-
-    uint32_t flow_mod_len = msg->size;
-    uint32_t bundle_len = bundle_msg->size;
-
-    ofpbuf_delete(msg);
+    size_t flow_mod_len;
+    struct ofpbuf *bundle_msg = ofctrl_encode_bundle_flow_mod(fm, bc,
+                                                              &flow_mod_len);
+    size_t bundle_len = bundle_msg->size;
 
     if (flow_mod_len > UINT16_MAX || bundle_len > UINT16_MAX) {
         ofpbuf_delete(bundle_msg);
@@ -1974,8 +2683,72 @@ add_flow_mod(struct ofputil_flow_mod *fm,
     }
 
     ovs_list_push_back(msgs, &bundle_msg->list_node);
+    bundle_n_flow_mods++;
+    bundle_n_bytes += bundle_len;
     return true;
 }
+
+/* Opens a new bundle in 'msgs', using 'bc'. */
+static void
+ofctrl_bundle_open(struct ofputil_bundle_ctrl_msg *bc, struct ovs_list *msgs)
+{
+    bc->bundle_id = next_bundle_id++;
+    bc->type = OFPBCT_OPEN_REQUEST;
+    bundle_open_msg = ofputil_encode_bundle_ctrl_request(OFP15_VERSION, bc);
+    ovs_list_push_back(msgs, &bundle_open_msg->list_node);
+    bundle_n_flow_mods = 0;
+    bundle_n_bytes = 0;
+}
+
+/* Commits the bundle opened by ofctrl_bundle_open(), or removes it from
+ * 'msgs' if it is still empty. */
+static void
+ofctrl_bundle_commit(struct ofputil_bundle_ctrl_msg *bc,
+                     struct ovs_list *msgs)
+{
+    if (ovs_list_back(msgs) == &bundle_open_msg->list_node) {
+        /* No flow updates.  Removing the bundle open request. */
+        ovs_list_pop_back(msgs);
+        ofpbuf_delete(bundle_open_msg);
+    } else {
+        bc->type = OFPBCT_COMMIT_REQUEST;
+        struct ofpbuf *bundle_commit =
+            ofputil_encode_bundle_ctrl_request(OFP15_VERSION, bc);
+        ovs_list_push_back(msgs, &bundle_commit->list_node);
+        OVS_USDT_PROBE(ofctrl_bundle_commit, bundle, bc->bundle_id,
+                       bundle_n_flow_mods, bundle_n_bytes);
+    }
+    bundle_open_msg = NULL;
+}
+
+/* Called before adding a flow_mod for a flow with 'cookie' to the current
+ * bundle.  If the bundle is over the configured limits, commits it and opens
+ * a new one.  The flow_mods of the flows of a logical flow, which share the
+ * cookie and are usually added one after the other, are kept in the same
+ * bundle unless the limits are exceeded twice over. */
+static void
+ofctrl_bundle_check_limits(struct ofputil_bundle_ctrl_msg *bc,
+                           struct ovs_list *msgs, uint64_t cookie)
+{
+    if (!bundle_may_split) {
+        return;
+    }
+
+    size_t n_over = 0;
+    if (bundle_max_flow_mods && bundle_n_flow_mods >= bundle_max_flow_mods) {
+        n_over = MAX(n_over, bundle_n_flow_mods / bundle_max_flow_mods);
+    }
+    if (bundle_max_bytes && bundle_n_bytes >= bundle_max_bytes) {
+        n_over = MAX(n_over, bundle_n_bytes / bundle_max_bytes);
+    }
+
+    if (n_over > 1 || (n_over && cookie != bundle_last_cookie)) {
+        COVERAGE_INC(ofctrl_bundle_split);
+        ofctrl_bundle_commit(bc, msgs);
+        ofctrl_bundle_open(bc, msgs);
+    }
+    bundle_last_cookie = cookie;
+}
 
 /* group_table. */
 
@@ -2063,6 +2836,74 @@ add_group_mod(struct ofputil_group_mod *gm,
     ofputil_uninit_group_mod(&split);
 }
 
+/* Adds to 'msgs' the group mods that install the groups of 'table' that are
+ * desired but not installed yet. */
+static void
+ofctrl_put_desired_groups(struct ovn_extend_table *table,
+                          struct ofputil_bundle_ctrl_msg *bc,
+                          struct ovs_list *msgs)
+{
+    struct ovn_extend_table_info *desired;
+    EXTEND_TABLE_FOR_EACH_UNINSTALLED (desired, table) {
+        /* Create and install new group, or update it in place if it was
+         * found in the switch on reconnection. */
+        struct ofputil_group_mod gm;
+        enum ofputil_protocol usable_protocols;
+        uint16_t command = OFPGC15_ADD;
+        if (ofctrl_reconcile_find_id(&reconcile_group_ids,
+                                     desired->table_id)) {
+            ofctrl_reconcile_remove_id(&reconcile_group_ids,
+                                       desired->table_id);
+            command = OFPGC15_MODIFY;
+        }
+        char *group_string = xasprintf("group_id=%"PRIu32",%s",
+                                       desired->table_id,
+                                       desired->name);
+        char *error = parse_ofp_group_mod_str(&gm, command, group_string,
+                                              NULL, NULL, &usable_protocols);
+        if (!error) {
+            add_group_mod(&gm, bc, msgs);
+        } else {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+            VLOG_ERR_RL(&rl, "new group %s %s", error, group_string);
+            free(error);
+        }
+        free(group_string);
+        ofputil_uninit_group_mod(&gm);
+    }
+}
+
+/* Adds to 'msgs' the group mods that delete the groups of 'table' that are
+ * installed but no longer desired. */
+static void
+ofctrl_remove_installed_groups(struct ovn_extend_table *table,
+                               struct ofputil_bundle_ctrl_msg *bc,
+                               struct ovs_list *msgs)
+{
+    struct ovn_extend_table_info *installed;
+    EXTEND_TABLE_FOR_EACH_INSTALLED (installed, table) {
+        /* Delete the group. */
+        struct ofputil_group_mod gm;
+        enum ofputil_protocol usable_protocols;
+        char *group_string = xasprintf("group_id=%"PRIu32"",
+                                       installed->table_id);
+        char *error = parse_ofp_group_mod_str(&gm, OFPGC15_DELETE,
+                                              group_string, NULL, NULL,
+                                              &usable_protocols);
+        if (!error) {
+            add_group_mod(&gm, bc, msgs);
+        } else {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+            VLOG_ERR_RL(&rl, "Error deleting group %d: %s",
+                        installed->table_id, error);
+            free(error);
+        }
+        free(group_string);
+        ofputil_uninit_group_mod(&gm);
+        ovn_extend_table_remove_existing(table, installed);
+    }
+}
+
 
 static struct ofpbuf *
 encode_meter_mod(const struct ofputil_meter_mod *mm)
@@ -2073,7 +2914,20 @@ encode_meter_mod(const struct ofputil_meter_mod *mm)
 static void
 add_meter_mod(const struct ofputil_meter_mod *mm, struct ovs_list *msgs)
 {
-    struct ofpbuf *msg = encode_meter_mod(mm);
+    struct ofpbuf *msg;
+
+    if (mm->command == OFPMC13_ADD
+        && ofctrl_reconcile_find_id(&reconcile_meter_ids,
+                                    mm->meter.meter_id)) {
+        /* The meter was found in the switch on reconnection, update it in
+         * place instead. */
+        struct ofputil_meter_mod mod = *mm;
+        mod.command = OFPMC13_MODIFY;
+        ofctrl_reconcile_remove_id(&reconcile_meter_ids, mm->meter.meter_id);
+        msg = encode_meter_mod(&mod);
+    } else {
+        msg = encode_meter_mod(mm);
+    }
     ovs_list_push_back(msgs, &msg->list_node);
 }
 
@@ -2088,6 +2942,104 @@ add_ct_flush_zone(uint16_t zone_id, struct ovs_list *msgs)
     ovs_list_push_back(msgs, &msg->list_node);
 }
 
+/* Adds to 'msgs' the conntrack flushes of the zones in 'pending_ct_zones'
+ * that are in the CT_ZONE_OF_QUEUED state and were assigned to a new user,
+ * so that they are flushed ahead of the flows of their user, and moves them
+ * into the CT_ZONE_OF_SENT state.
+ *
+ * A release of one of these zones whose flush is still waiting for its batch
+ * is taken care of by the same flush, instead of being sent later and
+ * flushing the connections of the new user. */
+static void
+ofctrl_put_new_ct_zone_flushes(struct shash *pending_ct_zones,
+                               struct ovs_list *msgs)
+{
+    unsigned long *new_zones = NULL;
+
+    struct shash_node *iter;
+    SHASH_FOR_EACH (iter, pending_ct_zones) {
+        struct ct_zone_pending_entry *ctzpe = iter->data;
+        if (ctzpe->state == CT_ZONE_OF_QUEUED && ctzpe->add) {
+            add_ct_flush_zone(ctzpe->zone, msgs);
+            ctzpe->state = CT_ZONE_OF_SENT;
+            ctzpe->of_xid = 0;
+            if (!new_zones) {
+                new_zones = bitmap_allocate(MAX_CT_ZONES + 1);
+            }
+            bitmap_set1(new_zones, ctzpe->zone);
+        }
+    }
+    if (!new_zones) {
+        return;
+    }
+
+    SHASH_FOR_EACH (iter, pending_ct_zones) {
+        struct ct_zone_pending_entry *ctzpe = iter->data;
+        if (ctzpe->state == CT_ZONE_OF_QUEUED
+            && bitmap_is_set(new_zones, ctzpe->zone)) {
+            ctzpe->state = CT_ZONE_OF_SENT;
+            ctzpe->of_xid = 0;
+        }
+    }
+    bitmap_free(new_zones);
+}
+
+/* Queues the conntrack flushes of up to CT_FLUSH_BATCH_SIZE of the released
+ * zones in 'pending_ct_zones' that are in the CT_ZONE_OF_QUEUED state,
+ * followed by a barrier, unless a previous batch is still in flight.  The
+ * remaining zones are flushed in later batches, once the barrier is replied
+ * to.
+ *
+ * The flushes are sent after the flows, so the flows of a removed zone user
+ * are gone by the time its zone is flushed.
+ *
+ * Returns true if any message was queued. */
+static bool
+ofctrl_put_ct_flushes(struct shash *pending_ct_zones)
+{
+    if (ct_flush_xid) {
+        return false;
+    }
+
+    struct ovs_list msgs = OVS_LIST_INITIALIZER(&msgs);
+    size_t n_flushes = 0;
+
+    struct shash_node *iter;
+    SHASH_FOR_EACH (iter, pending_ct_zones) {
+        struct ct_zone_pending_entry *ctzpe = iter->data;
+        if (ctzpe->state == CT_ZONE_OF_QUEUED && !ctzpe->add) {
+            add_ct_flush_zone(ctzpe->zone, &msgs);
+            ctzpe->state = CT_ZONE_OF_SENT;
+            ctzpe->of_xid = 0;
+            if (++n_flushes == CT_FLUSH_BATCH_SIZE) {
+                break;
+            }
+        }
+    }
+    if (!n_flushes) {
+        return false;
+    }
+
+    struct ofpbuf *barrier = ofputil_encode_barrier_request(OFP15_VERSION);
+    const struct ofp_header *oh = barrier->data;
+    ct_flush_xid = oh->xid;
+    ovs_list_push_back(&msgs, &barrier->list_node);
+
+    struct ofpbuf *msg;
+    LIST_FOR_EACH_POP (msg, list_node, &msgs) {
+        queue_msg(msg);
+    }
+
+    SHASH_FOR_EACH (iter, pending_ct_zones) {
+        struct ct_zone_pending_entry *ctzpe = iter->data;
+        if (ctzpe->state == CT_ZONE_OF_SENT && !ctzpe->of_xid) {
+            ctzpe->of_xid = ct_flush_xid;
+        }
+    }
+    COVERAGE_INC(ofctrl_ct_flush_batch);
+    return true;
+}
+
 static void
 add_meter_string(struct ovn_extend_table_info *m_desired,
                  struct ovs_list *msgs)
@@ -2321,6 +3273,7 @@ installed_flow_add(struct ovn_flow *d,
         .command = OFPFC_ADD,
     };
 
+    ofctrl_bundle_check_limits(bc, msgs, d->cookie);
     if (!add_flow_mod(&fm, bc, msgs)) {
         ovn_flow_log_size_err(d);
     }
@@ -2347,12 +3300,12 @@ installed_flow_mod(struct ovn_flow *i, struct ovn_flow *d,
         /* Use OFPFC_ADD so that cookie can be updated. */
         fm.command = OFPFC_ADD;
     }
+    ofctrl_bundle_check_limits(bc, msgs, d->cookie);
     bool result = add_flow_mod(&fm, bc, msgs);
 
     /* Replace 'i''s actions and cookie by 'd''s. */
-    mem_stats.installed_flow_usage -= i->ofpacts_len - d->ofpacts_len;
-    free(i->ofpacts);
-    i->ofpacts = xmemdup(d->ofpacts, d->ofpacts_len);
+    ovn_flow_actions_unref(i->ofpacts);
+    i->ofpacts = ovn_flow_actions_ref(d->ofpacts);
     i->ofpacts_len = d->ofpacts_len;
     i->cookie = d->cookie;
 
@@ -2373,23 +3326,58 @@ installed_flow_del(struct ovn_flow *i,
         .command = OFPFC_DELETE_STRICT,
     };
 
+    ofctrl_bundle_check_limits(bc, msgs, i->cookie);
     if (!add_flow_mod(&fm, bc, msgs)) {
         ovn_flow_log_size_err(i);
     }
 }
 
+/* Looks up a flow with the same key as 'd' among the flows dumped from the
+ * switch on reconnection.  If there is one, moves it to 'installed_flows',
+ * links it to 'd' and updates it in the switch if needed, then returns true.
+ * Otherwise, returns false and 'd' has to be added. */
+static bool
+installed_flow_reconcile(struct desired_flow *d,
+                         struct ofputil_bundle_ctrl_msg *bc,
+                         struct resizing_hmap *installed_flows,
+                         struct ovs_list *msgs)
+{
+    if (hmap_is_empty(&reconcile_flows)) {
+        return false;
+    }
+
+    struct installed_flow *i = installed_flow_lookup__(&d->flow,
+                                                       &reconcile_flows);
+    if (!i) {
+        return false;
+    }
+    hmap_remove(&reconcile_flows, &i->match_hmap_node);
+    resizing_hmap_insert(installed_flows, &i->match_hmap_node, i->flow.hash);
+    i->flow.ctrl_meter_id = d->flow.ctrl_meter_id;
+    link_installed_to_desired(i, d);
+
+    if (i->flow.ofpacts != d->flow.ofpacts
+        || i->flow.cookie != d->flow.cookie) {
+        installed_flow_mod(&i->flow, &d->flow, bc, msgs);
+        ovn_flow_log(&i->flow, "updating installed (reconciled)");
+    }
+    return true;
+}
+
 static void
 update_installed_flows_by_compare(struct ovn_desired_flow_table *flow_table,
                                   struct ofputil_bundle_ctrl_msg *bc,
-                                  struct hmap *installed_flows,
+                                  struct resizing_hmap *installed_flows,
                                   struct ovs_list *msgs)
 {
     ovs_assert(ovs_list_is_empty(&flow_table->tracked_flows));
     /* Iterate through all of the installed flows.  If any of them are no
      * longer desired, delete them; if any of them should have different
-     * actions, update them. */
+     * actions, update them.  Settling 'installed_flows' first costs no more
+     * than the walk itself. */
+    struct hmap *all_installed = resizing_hmap_settle(installed_flows);
     struct installed_flow *i;
-    HMAP_FOR_EACH_SAFE (i, match_hmap_node, installed_flows) {
+    HMAP_FOR_EACH_SAFE (i, match_hmap_node, all_installed) {
         unlink_all_refs_for_installed_flow(i);
         struct desired_flow *d = desired_flow_lookup(flow_table, &i->flow);
         if (!d) {
@@ -2398,12 +3386,11 @@ update_installed_flows_by_compare(struct ovn_desired_flow_table *flow_table,
             installed_flow_del(&i->flow, bc, msgs);
             ovn_flow_log(&i->flow, "removing installed");
 
-            hmap_remove(installed_flows, &i->match_hmap_node);
+            resizing_hmap_remove(installed_flows, &i->match_hmap_node);
             installed_flow_destroy(i);
         } else {
-            if (!ofpacts_equal(i->flow.ofpacts, i->flow.ofpacts_len,
-                               d->flow.ofpacts, d->flow.ofpacts_len) ||
-                i->flow.cookie != d->flow.cookie) {
+            if (i->flow.ofpacts != d->flow.ofpacts
+                || i->flow.cookie != d->flow.cookie) {
                 installed_flow_mod(&i->flow, &d->flow, bc, msgs);
                 ovn_flow_log(&i->flow, "updating installed");
             }
@@ -2414,16 +3401,22 @@ update_installed_flows_by_compare(struct ovn_desired_flow_table *flow_table,
 
     /* Iterate through the desired flows and add those that aren't found
      * in the installed flow table. */
+    struct hmap *all_desired =
+        resizing_hmap_settle(&flow_table->match_flow_table);
     struct desired_flow *d;
-    HMAP_FOR_EACH (d, match_hmap_node, &flow_table->match_flow_table) {
+    HMAP_FOR_EACH (d, match_hmap_node, all_desired) {
         i = installed_flow_lookup(&d->flow, installed_flows);
         if (!i) {
+            if (installed_flow_reconcile(d, bc, installed_flows, msgs)) {
+                continue;
+            }
             ovn_flow_log(&d->flow, "adding installed");
             installed_flow_add(&d->flow, bc, msgs);
 
             /* Copy 'd' from 'flow_table' to installed_flows. */
             i = installed_flow_dup(d);
-            hmap_insert(installed_flows, &i->match_hmap_node, i->flow.hash);
+            resizing_hmap_insert(installed_flows, &i->match_hmap_node,
+                                 i->flow.hash);
             link_installed_to_desired(i, d);
         } else if (!d->installed_flow) {
             /* This is a desired_flow that conflicts with one installed
@@ -2453,8 +3446,7 @@ deleted_flow_lookup(struct hmap *deleted_flows, struct ovn_flow *target)
             && f->priority == target->priority
             && minimatch_equal(&f->match, &target->match)
             && f->cookie == target->cookie
-            && ofpacts_equal(f->ofpacts, f->ofpacts_len, target->ofpacts,
-                             target->ofpacts_len)) {
+            && f->ofpacts == target->ofpacts) {
             /* del_f must have been installed, otherwise it should have
              * been removed during track_flow_del. */
             ovs_assert(d->installed_flow);
@@ -2465,8 +3457,7 @@ deleted_flow_lookup(struct hmap *deleted_flows, struct ovn_flow *target)
              * installed flow can be updated later. */
             struct ovn_flow *f_i = &d->installed_flow->flow;
             if (f_i->cookie == target->cookie
-                && ofpacts_equal(f_i->ofpacts, f_i->ofpacts_len,
-                                 target->ofpacts, target->ofpacts_len)) {
+                && f_i->ofpacts == target->ofpacts) {
                 return d;
             }
         }
@@ -2520,10 +3511,55 @@ merge_tracked_flows(struct ovn_desired_flow_table *flow_table)
     hmap_destroy(&deleted_flows);
 }
 
+/* Installs the desired flow 'f', which was tracked as added or modified and
+ * is already removed from the tracked flows. */
+static void
+installed_flow_update_tracked(struct desired_flow *f,
+                              struct ofputil_bundle_ctrl_msg *bc,
+                              struct resizing_hmap *installed_flows,
+                              struct ovs_list *msgs)
+{
+    struct installed_flow *i = installed_flow_lookup(&f->flow,
+                                                     installed_flows);
+    if (!i) {
+        if (!installed_flow_reconcile(f, bc, installed_flows, msgs)) {
+            /* Adding a new flow. */
+            installed_flow_add(&f->flow, bc, msgs);
+            ovn_flow_log(&f->flow, "adding installed (tracked)");
+
+            /* Copy 'f' from 'flow_table' to installed_flows. */
+            struct installed_flow *new_node = installed_flow_dup(f);
+            resizing_hmap_insert(installed_flows,
+                                 &new_node->match_hmap_node,
+                                 new_node->flow.hash);
+            link_installed_to_desired(new_node, f);
+        }
+    } else if (installed_flow_get_active(i) == f) {
+        /* The installed flow is installed for f, but f has change
+         * tracked, so it must have been modified. */
+        installed_flow_mod(&i->flow, &f->flow, bc, msgs);
+        ovn_flow_log(&i->flow, "updating installed (tracked)");
+    } else if (!f->installed_flow) {
+        /* Adding a new flow that conflicts with an existing installed
+         * flow, so add it to the link.  If this flow becomes active,
+         * e.g., it is less restrictive than the previous active flow
+         * then modify the installed flow.
+         */
+        if (link_installed_to_desired(i, f)) {
+            installed_flow_mod(&i->flow, &f->flow, bc, msgs);
+            ovn_flow_log(&i->flow,
+                         "updating installed (tracked conflict)");
+        }
+    }
+    /* The track_list_node emptyness is used to check if the node is
+     * already added to track list, so initialize it again here. */
+    ovs_list_init(&f->track_list_node);
+}
+
 static void
 update_installed_flows_by_track(struct ovn_desired_flow_table *flow_table,
                                 struct ofputil_bundle_ctrl_msg *bc,
-                                struct hmap *installed_flows,
+                                struct resizing_hmap *installed_flows,
                                 struct ovs_list *msgs)
 {
     merge_tracked_flows(flow_table);
@@ -2542,7 +3578,8 @@ update_installed_flows_by_track(struct ovn_desired_flow_table *flow_table,
                     installed_flow_del(&i->flow, bc, msgs);
                     ovn_flow_log(&i->flow, "removing installed (tracked)");
 
-                    hmap_remove(installed_flows, &i->match_hmap_node);
+                    resizing_hmap_remove(installed_flows,
+                                         &i->match_hmap_node);
                     installed_flow_destroy(i);
                 } else if (was_active) {
                     /* There are other desired flow(s) referencing this
@@ -2555,39 +3592,65 @@ update_installed_flows_by_track(struct ovn_desired_flow_table *flow_table,
             }
             desired_flow_destroy(f);
         } else {
-            /* The desired flow was added or modified. */
+            installed_flow_update_tracked(f, bc, installed_flows, msgs);
+        }
+    }
+}
+
+/* Sends to the switch the changes to the flows of the SB uuids in
+ * 'flow_table->prio_uuids' that were added or modified, ahead of the rest of
+ * update_installed_flows_by_track() or update_installed_flows_by_compare(),
+ * which then find them up to date. */
+static void
+update_installed_prio_flows(struct ovn_desired_flow_table *flow_table,
+                            struct ofputil_bundle_ctrl_msg *bc,
+                            struct resizing_hmap *installed_flows,
+                            struct ovs_list *msgs)
+{
+    if (flow_table->change_tracked) {
+        merge_tracked_flows(flow_table);
+    }
+
+    const struct uuidset_node *node;
+    UUIDSET_FOR_EACH (node, &flow_table->prio_uuids) {
+        struct sb_to_flow *stf = sb_to_flow_find(&flow_table->uuid_flow_table,
+                                                 &node->uuid);
+        if (!stf) {
+            continue;
+        }
+
+        struct sb_flow_ref *sfr;
+        LIST_FOR_EACH (sfr, flow_list, &stf->flows) {
+            struct desired_flow *f = sfr->flow;
+
+            if (flow_table->change_tracked) {
+                if (!ovs_list_is_empty(&f->track_list_node)) {
+                    ovs_list_remove(&f->track_list_node);
+                    installed_flow_update_tracked(f, bc, installed_flows,
+                                                  msgs);
+                }
+                continue;
+            }
+
+            /* The table was recomputed.  Install 'f' the way
+             * update_installed_flows_by_compare() would. */
             struct installed_flow *i = installed_flow_lookup(&f->flow,
                                                              installed_flows);
             if (!i) {
-                /* Adding a new flow. */
                 installed_flow_add(&f->flow, bc, msgs);
-                ovn_flow_log(&f->flow, "adding installed (tracked)");
-
-                /* Copy 'f' from 'flow_table' to installed_flows. */
-                struct installed_flow *new_node = installed_flow_dup(f);
-                hmap_insert(installed_flows, &new_node->match_hmap_node,
-                            new_node->flow.hash);
-                link_installed_to_desired(new_node, f);
-            } else if (installed_flow_get_active(i) == f) {
-                /* The installed flow is installed for f, but f has change
-                 * tracked, so it must have been modified. */
+                ovn_flow_log(&f->flow, "adding installed (prio)");
+
+                i = installed_flow_dup(f);
+                resizing_hmap_insert(installed_flows, &i->match_hmap_node,
+                                     i->flow.hash);
+                link_installed_to_desired(i, f);
+            } else if (!f->installed_flow
+                       && link_installed_to_desired(i, f)
+                       && (i->flow.ofpacts != f->flow.ofpacts
+                           || i->flow.cookie != f->flow.cookie)) {
                 installed_flow_mod(&i->flow, &f->flow, bc, msgs);
-                ovn_flow_log(&i->flow, "updating installed (tracked)");
-            } else if (!f->installed_flow) {
-                /* Adding a new flow that conflicts with an existing installed
-                 * flow, so add it to the link.  If this flow becomes active,
-                 * e.g., it is less restrictive than the previous active flow
-                 * then modify the installed flow.
-                 */
-                if (link_installed_to_desired(i, f)) {
-                    installed_flow_mod(&i->flow, &f->flow, bc, msgs);
-                    ovn_flow_log(&i->flow,
-                                 "updating installed (tracked conflict)");
-                }
+                ovn_flow_log(&i->flow, "updating installed (prio)");
             }
-            /* The track_list_node emptyness is used to check if the node is
-             * already added to track list, so initialize it again here. */
-            ovs_list_init(&f->track_list_node);
         }
     }
 }
@@ -2625,7 +3688,12 @@ add_ct_flush_tuple(const struct ovn_lb_5tuple *tuple,
 bool
 ofctrl_has_backlog(void)
 {
-    if (rconn_packet_counter_n_packets(tx_counter)
+    /* The next round of flow table modifications reuses the counter of the
+     * round before the latest one. */
+    const struct rconn_packet_counter *next_counter =
+        tx_counters[tx_counter == tx_counters[0]];
+
+    if (rconn_packet_counter_n_packets(next_counter)
         || rconn_get_version(swconn) < 0) {
         return true;
     }
@@ -2633,9 +3701,9 @@ ofctrl_has_backlog(void)
 }
 
 /* The flow table can be updated if the connection to the switch is up and
- * in the correct state and not backlogged with existing flow_mods.  (Our
- * criteria for being backlogged appear very conservative, but the socket
- * between ovn-controller and OVS provides some buffering.) */
+ * in the correct state and not backlogged with existing flow_mods.  At most
+ * two rounds of flow_mods can be in flight: the switch may still be
+ * processing one while the I/O thread transmits the next one. */
 static bool
 ofctrl_can_put(void)
 {
@@ -2652,9 +3720,10 @@ ofctrl_can_put(void)
  * Replaces the group table and meter table on the switch, if possible,
  * by the contents of '->desired'.
  *
- * Sends conntrack flush messages to each zone in 'pending_ct_zones' that
- * is in the CT_ZONE_OF_QUEUED state and then moves the zone into the
- * CT_ZONE_OF_SENT state.
+ * Sends conntrack flush messages to the zones in 'pending_ct_zones' that are
+ * in the CT_ZONE_OF_QUEUED state and then moves them into the CT_ZONE_OF_SENT
+ * state: ahead of the flow updates for the zones of new users, after them
+ * for the released zones.  See ofctrl_put_ct_flushes().
  *
  * This should be called after ofctrl_run() within the main loop. */
 void
@@ -2671,7 +3740,7 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
     static uint64_t old_req_cfg = 0;
     bool need_put = false;
     if (lflows_changed || pflows_changed || skipped_last_time ||
-        ofctrl_initial_clear) {
+        ofctrl_initial_clear || ofctrl_reconciling) {
         need_put = true;
         old_req_cfg = req_cfg;
     } else if (req_cfg != old_req_cfg) {
@@ -2692,6 +3761,9 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
 
     if (!need_put) {
         VLOG_DBG("ofctrl_put not needed");
+        if (ofctrl_can_put() && ofctrl_put_ct_flushes(pending_ct_zones)) {
+            ofctrl_io_wake();
+        }
         return;
     }
     if (!ofctrl_can_put()) {
@@ -2699,20 +3771,13 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         skipped_last_time = true;
         return;
     }
+    tx_counter = tx_counters[tx_counter == tx_counters[0]];
 
     /* OpenFlow messages to send to the switch to bring it up-to-date. */
     struct ovs_list msgs = OVS_LIST_INITIALIZER(&msgs);
 
-    /* Iterate through ct zones that need to be flushed. */
-    struct shash_node *iter;
-    SHASH_FOR_EACH(iter, pending_ct_zones) {
-        struct ct_zone_pending_entry *ctzpe = iter->data;
-        if (ctzpe->state == CT_ZONE_OF_QUEUED) {
-            add_ct_flush_zone(ctzpe->zone, &msgs);
-            ctzpe->state = CT_ZONE_OF_SENT;
-            ctzpe->of_xid = 0;
-        }
-    }
+    /* Iterate through the ct zones of new users that need to be flushed. */
+    ofctrl_put_new_ct_zone_flushes(pending_ct_zones, &msgs);
 
     if (ofctrl_initial_clear) {
         /* Send a meter_mod to delete all meters.
@@ -2731,8 +3796,7 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
      * add them to the switch. */
     struct ovn_extend_table_info *m_desired;
     HMAP_FOR_EACH (m_desired, hmap_node, &meters->desired) {
-        struct ovn_extend_table_info *m_existing =
-            ovn_extend_table_lookup(&meters->existing, m_desired);
+        struct ovn_extend_table_info *m_existing = m_desired->peer;
         if (!m_existing) {
             if (!strncmp(m_desired->name, "__string: ", 10)) {
                 /* The "set-meter" action creates a meter entry name that
@@ -2746,18 +3810,55 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         }
     }
 
-    /* Add all flow updates into a bundle. */
-    static int bundle_id = 0;
+    /* Add all flow updates into a bundle, or a sequence of bundles if the
+     * size of bundles is limited.  The flows are never split when they are
+     * all replaced, since the data plane would be disrupted between the
+     * bundles. */
     struct ofputil_bundle_ctrl_msg bc = {
-        .bundle_id = bundle_id++,
         .flags     = OFPBF_ORDERED | OFPBF_ATOMIC,
     };
-    struct ofpbuf *bundle_open, *bundle_commit;
+    bundle_may_split = !ofctrl_initial_clear
+                       && (bundle_max_flow_mods || bundle_max_bytes);
+
+    /* Send the prioritized flows, and the groups they may use, in a first
+     * bundle with its own barrier.  Not when the flows are all replaced or
+     * reconciled, which must be done at once. */
+    bool lflows_prio = (lflows_changed || skipped_last_time)
+                       && !uuidset_is_empty(&lflow_table->prio_uuids);
+    bool pflows_prio = (pflows_changed || skipped_last_time)
+                       && !uuidset_is_empty(&pflow_table->prio_uuids);
+    bool put_prio = (lflows_prio || pflows_prio)
+                    && !ofctrl_initial_clear && !ofctrl_reconciling;
+    if (put_prio) {
+        ofctrl_bundle_open(&bc, &msgs);
+        ofctrl_put_desired_groups(groups, &bc, &msgs);
+        if (pflow_groups) {
+            ofctrl_put_desired_groups(pflow_groups, &bc, &msgs);
+        }
+        if (lflows_prio) {
+            update_installed_prio_flows(lflow_table, &bc, &installed_lflows,
+                                        &msgs);
+        }
+        if (pflows_prio) {
+            update_installed_prio_flows(pflow_table, &bc, &installed_pflows,
+                                        &msgs);
+        }
+        bool prio_empty = ovs_list_back(&msgs) == &bundle_open_msg->list_node;
+        ofctrl_bundle_commit(&bc, &msgs);
+        if (!prio_empty) {
+            struct ofpbuf *barrier =
+                ofputil_encode_barrier_request(OFP15_VERSION);
+            const struct ofp_header *oh = barrier->data;
+            prio_xid = oh->xid;
+            prio_req_cfg = req_cfg;
+            ovs_list_push_back(&msgs, &barrier->list_node);
+            COVERAGE_INC(ofctrl_prio_put);
+        }
+    }
+    uuidset_clear(&lflow_table->prio_uuids);
+    uuidset_clear(&pflow_table->prio_uuids);
 
-    /* Open a new bundle. */
-    bc.type = OFPBCT_OPEN_REQUEST;
-    bundle_open = ofputil_encode_bundle_ctrl_request(OFP15_VERSION, &bc);
-    ovs_list_push_back(&msgs, &bundle_open->list_node);
+    ofctrl_bundle_open(&bc, &msgs);
 
     if (ofctrl_initial_clear) {
         /* Send a flow_mod to delete all flows. */
@@ -2784,31 +3885,20 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
 
     /* Iterate through all the desired groups. If there are new ones,
      * add them to the switch. */
-    struct ovn_extend_table_info *desired;
-    EXTEND_TABLE_FOR_EACH_UNINSTALLED (desired, groups) {
-        /* Create and install new group. */
-        struct ofputil_group_mod gm;
-        enum ofputil_protocol usable_protocols;
-        char *group_string = xasprintf("group_id=%"PRIu32",%s",
-                                       desired->table_id,
-                                       desired->name);
-        char *error = parse_ofp_group_mod_str(&gm, OFPGC15_ADD, group_string,
-                                              NULL, NULL, &usable_protocols);
-        if (!error) {
-            add_group_mod(&gm, &bc, &msgs);
-        } else {
-            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-            VLOG_ERR_RL(&rl, "new group %s %s", error, group_string);
-            free(error);
+    if (!put_prio) {
+        ofctrl_put_desired_groups(groups, &bc, &msgs);
+        if (pflow_groups) {
+            ofctrl_put_desired_groups(pflow_groups, &bc, &msgs);
         }
-        free(group_string);
-        ofputil_uninit_group_mod(&gm);
     }
 
     /* If skipped last time, then process the flow table
      * (tracked) flows even if lflows_changed is not set.
      * Same for pflows_changed. */
+    bool lflows_compared = false;
+    bool pflows_compared = false;
     if (lflows_changed || skipped_last_time) {
+        lflows_compared = !lflow_table->change_tracked;
         if (lflow_table->change_tracked) {
             update_installed_flows_by_track(lflow_table, &bc,
                                             &installed_lflows,
@@ -2821,6 +3911,7 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
     }
 
     if (pflows_changed || skipped_last_time) {
+        pflows_compared = !pflow_table->change_tracked;
         if (pflow_table->change_tracked) {
             update_installed_flows_by_track(pflow_table, &bc,
                                             &installed_pflows,
@@ -2834,44 +3925,51 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
 
     skipped_last_time = false;
 
-    /* Iterate through the installed groups from previous runs. If they
-     * are not needed delete them. */
-    struct ovn_extend_table_info *installed;
-    EXTEND_TABLE_FOR_EACH_INSTALLED (installed, groups) {
-        /* Delete the group. */
-        struct ofputil_group_mod gm;
-        enum ofputil_protocol usable_protocols;
-        char *group_string = xasprintf("group_id=%"PRIu32"",
-                                       installed->table_id);
-        char *error = parse_ofp_group_mod_str(&gm, OFPGC15_DELETE,
-                                              group_string, NULL, NULL,
-                                              &usable_protocols);
-        if (!error) {
+    /* Once both flow tables have been fully compared with the flows dumped
+     * from the switch, and are complete, the ones left over are no longer
+     * desired.  The flows added by track in the meantime are reconciled as
+     * well. */
+    lflows_reconcile_compared |= lflows_compared;
+    pflows_reconcile_compared |= pflows_compared;
+    bool reconciled = ofctrl_reconciling && lflows_reconcile_compared
+                      && pflows_reconcile_compared
+                      && !lflow_table->incomplete
+                      && !pflow_table->incomplete;
+    if (reconciled) {
+        struct installed_flow *i;
+        HMAP_FOR_EACH_POP (i, match_hmap_node, &reconcile_flows) {
+            installed_flow_del(&i->flow, &bc, &msgs);
+            ovn_flow_log(&i->flow, "removing installed (reconciled)");
+            installed_flow_destroy(i);
+        }
+
+        struct ofctrl_reconcile_id *rid;
+        HMAP_FOR_EACH_POP (rid, hmap_node, &reconcile_group_ids) {
+            struct ofputil_group_mod gm = {
+                .command = OFPGC15_DELETE,
+                .group_id = rid->id,
+                .command_bucket_id = OFPG15_BUCKET_ALL,
+            };
+            ovs_list_init(&gm.buckets);
             add_group_mod(&gm, &bc, &msgs);
-        } else {
-            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-            VLOG_ERR_RL(&rl, "Error deleting group %d: %s",
-                        installed->table_id, error);
-            free(error);
+            free(rid);
         }
-        free(group_string);
-        ofputil_uninit_group_mod(&gm);
-        ovn_extend_table_remove_existing(groups, installed);
     }
 
-    if (ovs_list_back(&msgs) == &bundle_open->list_node) {
-        /* No flow updates.  Removing the bundle open request. */
-        ovs_list_pop_back(&msgs);
-        ofpbuf_delete(bundle_open);
-    } else {
-        /* Committing the bundle. */
-        bc.type = OFPBCT_COMMIT_REQUEST;
-        bundle_commit = ofputil_encode_bundle_ctrl_request(OFP15_VERSION, &bc);
-        ovs_list_push_back(&msgs, &bundle_commit->list_node);
+    /* Iterate through the installed groups from previous runs. If they
+     * are not needed delete them. */
+    ofctrl_remove_installed_groups(groups, &bc, &msgs);
+    if (pflow_groups) {
+        ofctrl_remove_installed_groups(pflow_groups, &bc, &msgs);
     }
 
+    ofctrl_bundle_commit(&bc, &msgs);
+
     /* Sync the contents of groups->desired to groups->existing. */
     ovn_extend_table_sync(groups);
+    if (pflow_groups) {
+        ovn_extend_table_sync(pflow_groups);
+    }
 
     /* Iterate through the installed meters from previous runs. If they
      * are not needed delete them. */
@@ -2892,6 +3990,21 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
     /* Sync the contents of meters->desired to meters->existing. */
     ovn_extend_table_sync(meters);
 
+    if (reconciled) {
+        /* Meters can't be part of the bundle, delete the ones that are no
+         * longer desired after it is committed. */
+        struct ofctrl_reconcile_id *rid;
+        HMAP_FOR_EACH_POP (rid, hmap_node, &reconcile_meter_ids) {
+            struct ofputil_meter_mod mm = {
+                .command = OFPMC13_DELETE,
+                .meter = { .meter_id = rid->id },
+            };
+            add_meter_mod(&mm, &msgs);
+            free(rid);
+        }
+        ofctrl_reconcile_clear();
+    }
+
     if (ovs_feature_is_supported(OVS_CT_TUPLE_FLUSH_SUPPORT)) {
         struct ovn_lb_5tuple *tuple;
         HMAP_FOR_EACH_POP (tuple, hmap_node, pending_lb_tuples) {
@@ -2906,6 +4019,8 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         const struct ofp_header *oh = barrier->data;
         ovs_be32 xid_ = oh->xid;
         ovs_list_push_back(&msgs, &barrier->list_node);
+        OVS_USDT_PROBE(ofctrl_put, queue_msgs, ovs_list_size(&msgs),
+                       req_cfg);
 
         /* Queue the messages. */
         struct ofpbuf *msg;
@@ -2914,7 +4029,8 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
         }
 
         /* Store the barrier's xid with any newly sent ct flushes. */
-        SHASH_FOR_EACH(iter, pending_ct_zones) {
+        struct shash_node *iter;
+        SHASH_FOR_EACH (iter, pending_ct_zones) {
             struct ct_zone_pending_entry *ctzpe = iter->data;
             if (ctzpe->state == CT_ZONE_OF_SENT && !ctzpe->of_xid) {
                 ctzpe->of_xid = xid_;
@@ -2973,6 +4089,48 @@ ofctrl_put(struct ovn_desired_flow_table *lflow_table,
 
     pflow_table->change_tracked = true;
     ovs_assert(ovs_list_is_empty(&pflow_table->tracked_flows));
+
+    ofctrl_put_ct_flushes(pending_ct_zones);
+
+    ofctrl_io_wake();
+}
+
+/* Computes into 'msgs', without sending them, the flow_mods that
+ * ofctrl_put() would send to bring the installed logical flows up-to-date
+ * with 'lflow_table', in a single bundle, and updates the installed logical
+ * flows as if they were sent.  Returns the total size of the messages, in
+ * bytes.
+ *
+ * This is meant for benchmarking the flow table diff in isolation, so it
+ * must not be mixed with ofctrl_put() on a connected switch. */
+size_t
+ofctrl_diff_lflows(struct ovn_desired_flow_table *lflow_table,
+                   struct ovs_list *msgs)
+{
+    struct ofputil_bundle_ctrl_msg bc = {
+        .flags     = OFPBF_ORDERED | OFPBF_ATOMIC,
+    };
+    bundle_may_split = false;
+
+    ofctrl_bundle_open(&bc, msgs);
+    if (lflow_table->change_tracked) {
+        update_installed_flows_by_track(lflow_table, &bc, &installed_lflows,
+                                        msgs);
+    } else {
+        update_installed_flows_by_compare(lflow_table, &bc, &installed_lflows,
+                                          msgs);
+    }
+    ofctrl_bundle_commit(&bc, msgs);
+
+    lflow_table->change_tracked = true;
+    ovs_assert(ovs_list_is_empty(&lflow_table->tracked_flows));
+
+    size_t n_bytes = 0;
+    struct ofpbuf *msg;
+    LIST_FOR_EACH (msg, list_node, msgs) {
+        n_bytes += msg->size;
+    }
+    return n_bytes;
 }
 
 /* Looks up the logical port with the name 'port_name' in 'br_int_'.  If
@@ -3069,6 +4227,7 @@ ofctrl_inject_pkt(const struct ovsrec_bridge *br_int, const char *flow_s,
     match_set_in_port(&po.flow_metadata, uflow.in_port.ofp_port);
     enum ofputil_protocol proto = ofputil_protocol_from_ofp_version(version);
     queue_msg(ofputil_encode_packet_out(&po, proto));
+    ofctrl_io_wake();
     dp_packet_uninit(&packet);
     ofpbuf_uninit(&ofpacts);
 
@@ -3090,9 +4249,14 @@ ofctrl_get_memory_usage(struct simap *usage)
                    ROUND_UP(mem_stats.desired_flow_usage, 1024) / 1024);
     simap_increase(usage, "ofctrl_installed_flow_usage-KB",
                    ROUND_UP(mem_stats.installed_flow_usage, 1024) / 1024);
+    simap_increase(usage, "ofctrl_flow_actions_usage-KB",
+                   ROUND_UP(mem_stats.flow_actions_usage, 1024) / 1024);
+    simap_increase(usage, "ofctrl_shared_flow_actions-KB",
+                   ROUND_UP(mem_stats.shared_flow_actions, 1024) / 1024);
     simap_increase(usage, "oflow_update_usage-KB",
                    ROUND_UP(mem_stats.oflow_update_usage, 1024) / 1024);
     simap_increase(usage, "ofctrl_rconn_packet_counter-KB",
-                   ROUND_UP(rconn_packet_counter_n_bytes(tx_counter), 1024)
-                   / 1024);
+                   ROUND_UP(rconn_packet_counter_n_bytes(tx_counters[0])
+                            + rconn_packet_counter_n_bytes(tx_counters[1]),
+                            1024) / 1024);
 }
@@ -22,12 +22,16 @@
 #include "openvswitch/meta-flow.h"
 #include "ovsdb-idl.h"
 #include "hindex.h"
+#include "lib/resizing-hmap.h"
 #include "lib/uuidset.h"
 
+struct conj_ids;
 struct ovn_extend_table;
 struct hmap;
 struct match;
 struct ofpbuf;
+struct ofputil_bundle_ctrl_msg;
+struct ofputil_flow_mod;
 struct ovsrec_bridge;
 struct ovsrec_open_vswitch_table;
 struct sbrec_meter_table;
@@ -35,7 +39,7 @@ struct shash;
 
 struct ovn_desired_flow_table {
     /* Hash map flow table using flow match conditions as hash key.*/
-    struct hmap match_flow_table;
+    struct resizing_hmap match_flow_table;
 
     /* SB uuid index for the cross reference nodes that link to the nodes in
      * match_flow_table.*/
@@ -45,10 +49,19 @@ struct ovn_desired_flow_table {
     bool change_tracked;
     /* Tracked flow changes. */
     struct ovs_list tracked_flows;
+
+    /* SB uuids whose flows are sent to the switch, and acked, before the
+     * other flow changes by the next ofctrl_put(). */
+    struct uuidset prio_uuids;
+
+    /* Some of the desired flows are yet to be added, so the flows dumped
+     * from the switch that aren't desired must not be deleted yet. */
+    bool incomplete;
 };
 
 /* Interface for OVN main loop. */
 void ofctrl_init(struct ovn_extend_table *group_table,
+                 struct ovn_extend_table *pflow_group_table,
                  struct ovn_extend_table *meter_table);
 bool ofctrl_run(const char *conn_target, int probe_interval,
                 const struct ovsrec_open_vswitch_table *ovs_table,
@@ -66,6 +79,14 @@ bool ofctrl_has_backlog(void);
 void ofctrl_wait(void);
 void ofctrl_destroy(void);
 uint64_t ofctrl_get_cur_cfg(void);
+uint64_t ofctrl_get_prio_cfg(void);
+
+/* Interface for benchmarks. */
+size_t ofctrl_diff_lflows(struct ovn_desired_flow_table *,
+                          struct ovs_list *msgs);
+struct ofpbuf *ofctrl_encode_bundle_flow_mod(
+    const struct ofputil_flow_mod *, const struct ofputil_bundle_ctrl_msg *,
+    size_t *flow_mod_len);
 
 void ofctrl_ct_flush_zone(uint16_t zone_id);
 
@@ -125,7 +146,13 @@ void ofctrl_flood_remove_flows(struct ovn_desired_flow_table *,
 bool ofctrl_remove_flows_for_as_ip(struct ovn_desired_flow_table *,
                                    const struct uuid *lflow_uuid,
                                    const struct addrset_info *,
-                                   size_t expected_count);
+                                   size_t expected_count,
+                                   const struct conj_ids *);
+
+void ofctrl_prioritize_flows(struct ovn_desired_flow_table *,
+                             const struct uuid *sb_uuid);
+size_t ofctrl_count_flows(const struct ovn_desired_flow_table *,
+                          const struct uuid *sb_uuid);
 
 void ovn_desired_flow_table_init(struct ovn_desired_flow_table *);
 void ovn_desired_flow_table_clear(struct ovn_desired_flow_table *);
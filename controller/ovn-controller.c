@@ -54,12 +54,15 @@
 #include "ovn/features.h"
 #include "lib/chassis-index.h"
 #include "lib/extend-table.h"
+#include "lib/idl-recorder.h"
 #include "lib/ip-mcast-index.h"
 #include "lib/mac-binding-index.h"
 #include "lib/mcast-group-index.h"
 #include "lib/ovn-dirs.h"
 #include "lib/ovn-sb-idl.h"
 #include "lib/ovn-util.h"
+#include "lib/slab.h"
+#include "lib/sliced-reply.h"
 #include "ovsport.h"
 #include "patch.h"
 #include "vif-plug.h"
@@ -102,8 +105,15 @@ static unixctl_cb_func debug_dump_local_template_vars;
 static unixctl_cb_func debug_dump_lflow_conj_ids;
 static unixctl_cb_func lflow_cache_flush_cmd;
 static unixctl_cb_func lflow_cache_show_stats_cmd;
+static unixctl_cb_func lflow_cost_enable_cmd;
+static unixctl_cb_func lflow_cost_disable_cmd;
+static unixctl_cb_func lflow_cost_show_cmd;
 static unixctl_cb_func debug_delay_nb_cfg_report;
 static unixctl_cb_func debug_ignore_startup_delay;
+static unixctl_cb_func if_status_show_stats_cmd;
+static unixctl_cb_func if_status_clear_stats_cmd;
+static unixctl_cb_func nb_cfg_show_latency_cmd;
+static unixctl_cb_func nb_cfg_clear_latency_cmd;
 
 #define DEFAULT_BRIDGE_NAME "br-int"
 #define DEFAULT_DATAPATH "system"
@@ -118,6 +128,7 @@ static unixctl_cb_func debug_ignore_startup_delay;
 #define OFCTRL_SEQNO_RUN_STOPWATCH_NAME "ofctrl-seqno-run"
 #define BFD_RUN_STOPWATCH_NAME "bfd-run"
 #define VIF_PLUG_RUN_STOPWATCH_NAME "vif-plug-run"
+#define SB_IDL_RUN_STOPWATCH_NAME "sb-idl-run"
 
 #define OVS_NB_CFG_NAME "ovn-nb-cfg"
 #define OVS_NB_CFG_TS_NAME "ovn-nb-cfg-ts"
@@ -136,6 +147,12 @@ static const char *ssl_private_key_file;
 static const char *ssl_certificate_file;
 static const char *ssl_ca_cert_file;
 
+/* File where the lflow cache is saved on exit and restored from on start. */
+static char *lflow_cache_file;
+
+/* File to record the updates received from the SB database into, if any. */
+static char *ovnsb_record_file;
+
 /* By default don't set an upper bound for the lflow cache and enable auto
  * trimming above 10K logical flows when reducing cache size by 50%.
  */
@@ -163,6 +180,10 @@ struct pending_pkt {
 /* Registered ofctrl seqno type for nb_cfg propagation. */
 static size_t ofctrl_seq_type_nb_cfg;
 
+/* Registered ofctrl seqno type for the installation of the flows of the
+ * datapaths activated on demand, see struct lazy_datapaths. */
+static size_t ofctrl_seq_type_lazy_dps;
+
 static void
 remove_newline(char *s)
 {
@@ -205,6 +226,64 @@ static char *get_file_system_id(void)
 #define sb_table_set_req_mon_condition(idl, table, cond) \
     sbrec_##table##_set_condition(idl, cond)
 
+/* Whether the logical flows that apply to datapath groups are monitored
+ * only for the groups that include a local datapath, see
+ * external_ids:ovn-monitor-local-dp-groups. */
+static bool sb_monitor_local_dp_groups;
+
+/* Whether the peer switches are installed on demand, with
+ * external_ids:ovn-lazy-peer-datapaths, and their idle timeout, see struct
+ * lazy_datapaths. */
+static bool lazy_peer_dps_enabled;
+static uint64_t lazy_peer_dps_idle_timeout_ms;
+
+#define DEFAULT_LAZY_PEER_DPS_IDLE_TIMEOUT 300
+
+/* Above this number of local datapath groups, the logical flows of all the
+ * groups are monitored: the bigger condition would cost the server more
+ * than the rows it saves. */
+#define SB_MONITOR_MAX_LOCAL_DP_GROUPS 1000
+
+/* Adds to 'lf' a clause for each datapath group that includes one of the
+ * 'local_datapaths'.  Returns false, without changing 'lf', if there are
+ * too many of them. */
+static bool
+add_local_dp_group_clauses(struct ovsdb_idl *ovnsb_idl,
+                           struct ovsdb_idl_condition *lf,
+                           const struct hmap *local_datapaths)
+{
+    const struct sbrec_logical_dp_group **dpgs = NULL;
+    size_t n_dpgs = 0;
+    size_t allocated_dpgs = 0;
+
+    const struct sbrec_logical_dp_group *dpg;
+    SBREC_LOGICAL_DP_GROUP_FOR_EACH (dpg, ovnsb_idl) {
+        for (size_t i = 0; i < dpg->n_datapaths; i++) {
+            const struct local_datapath *ld =
+                get_local_datapath(local_datapaths,
+                                   dpg->datapaths[i]->tunnel_key);
+            if (ld && ld->datapath == dpg->datapaths[i]) {
+                if (n_dpgs >= SB_MONITOR_MAX_LOCAL_DP_GROUPS) {
+                    free(dpgs);
+                    return false;
+                }
+                if (n_dpgs >= allocated_dpgs) {
+                    dpgs = x2nrealloc(dpgs, &allocated_dpgs, sizeof *dpgs);
+                }
+                dpgs[n_dpgs++] = dpg;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n_dpgs; i++) {
+        struct uuid *uuid = CONST_CAST(struct uuid *, &dpgs[i]->header_.uuid);
+        sbrec_logical_flow_add_clause_logical_dp_group(lf, OVSDB_F_EQ, uuid);
+    }
+    free(dpgs);
+    return true;
+}
+
 static unsigned int
 update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
                    const struct sbrec_chassis *chassis,
@@ -215,8 +294,10 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
 {
     /* Monitor Port_Bindings rows for local interfaces and local datapaths.
      *
-     * Monitor Logical_Flow, MAC_Binding, FDB, Multicast_Group, and DNS tables
-     * for local datapaths.
+     * Monitor Logical_Flow, MAC_Binding, Static_MAC_Binding, FDB,
+     * Multicast_Group, and DNS tables for local datapaths.
+     *
+     * Monitor Service_Monitor rows for local chassis and local interfaces.
      *
      * Monitor Controller_Event rows for local chassis.
      *
@@ -242,6 +323,8 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
     struct ovsdb_idl_condition igmp = OVSDB_IDL_CONDITION_INIT(&igmp);
     struct ovsdb_idl_condition chprv = OVSDB_IDL_CONDITION_INIT(&chprv);
     struct ovsdb_idl_condition tv = OVSDB_IDL_CONDITION_INIT(&tv);
+    struct ovsdb_idl_condition smb = OVSDB_IDL_CONDITION_INIT(&smb);
+    struct ovsdb_idl_condition svc = OVSDB_IDL_CONDITION_INIT(&svc);
 
     /* Always monitor all logical datapath groups. Otherwise, DPG updates may
      * be received *after* the lflows using it are seen by ovn-controller.
@@ -261,6 +344,8 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
         ovsdb_idl_condition_add_clause_true(&igmp);
         ovsdb_idl_condition_add_clause_true(&chprv);
         ovsdb_idl_condition_add_clause_true(&tv);
+        ovsdb_idl_condition_add_clause_true(&smb);
+        ovsdb_idl_condition_add_clause_true(&svc);
         goto out;
     }
 
@@ -270,6 +355,13 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
      * chassis */
     sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "chassisredirect");
     sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "external");
+    if (lazy_peer_dps_enabled) {
+        /* A switch with one of these ports can't be installed on demand,
+         * which we have to know about before it is local. */
+        sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "localnet");
+        sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "l2gateway");
+        sbrec_port_binding_add_clause_type(&pb, OVSDB_F_EQ, "vtep");
+    }
     if (chassis) {
         /* This should be mostly redundant with the other clauses for port
          * bindings, but it allows us to catch any ports that are assigned to
@@ -302,6 +394,8 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
 
         sbrec_chassis_template_var_add_clause_chassis(&tv, OVSDB_F_EQ,
                                                       chassis->name);
+        sbrec_service_monitor_add_clause_chassis_name(&svc, OVSDB_F_EQ,
+                                                      chassis->name);
     } else {
         /* During initialization, we monitor all records in Chassis_Private so
          * that we don't try to recreate existing ones. */
@@ -330,6 +424,12 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
             }
             sbrec_port_binding_add_clause_logical_port(&pb, OVSDB_F_EQ, name);
         }
+        /* The service monitors of the local interfaces are needed as soon
+         * as they are claimed, before ovn-northd updates their chassis. */
+        SSET_FOR_EACH (name, local_ifaces) {
+            sbrec_service_monitor_add_clause_logical_port(&svc, OVSDB_F_EQ,
+                                                          name);
+        }
         /* Monitor all sub-ports unconditionally; we don't expect a lot of
          * them in the SB database. */
         sbrec_port_binding_add_clause_parent_port(&pb, OVSDB_F_NE, NULL);
@@ -343,6 +443,8 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
             sbrec_logical_flow_add_clause_logical_datapath(&lf, OVSDB_F_EQ,
                                                            uuid);
             sbrec_mac_binding_add_clause_datapath(&mb, OVSDB_F_EQ, uuid);
+            sbrec_static_mac_binding_add_clause_datapath(&smb, OVSDB_F_EQ,
+                                                         uuid);
             sbrec_fdb_add_clause_dp_key(&fdb, OVSDB_F_EQ,
                                         ld->datapath->tunnel_key);
             sbrec_multicast_group_add_clause_datapath(&mg, OVSDB_F_EQ, uuid);
@@ -357,9 +459,16 @@ update_sb_monitors(struct ovsdb_idl *ovnsb_idl,
          * new group UUID is not known by ovn-controller until the SB update
          * is received.  To avoid unnecessarily removing and adding lflows
          * that reference datapath groups, set the monitor condition to always
-         * request all of them.
+         * request all of them, unless asked to only request the ones of the
+         * local groups.  In that case, the condition is widened back to all
+         * of them when there are too many local groups.
          */
-        sbrec_logical_flow_add_clause_logical_dp_group(&lf, OVSDB_F_NE, NULL);
+        if (!sb_monitor_local_dp_groups
+            || !add_local_dp_group_clauses(ovnsb_idl, &lf,
+                                           local_datapaths)) {
+            sbrec_logical_flow_add_clause_logical_dp_group(&lf, OVSDB_F_NE,
+                                                           NULL);
+        }
     }
 
 out:;
@@ -376,6 +485,8 @@ out:;
         sb_table_set_req_mon_condition(ovnsb_idl, igmp_group, &igmp),
         sb_table_set_req_mon_condition(ovnsb_idl, chassis_private, &chprv),
         sb_table_set_opt_mon_condition(ovnsb_idl, chassis_template_var, &tv),
+        sb_table_set_opt_mon_condition(ovnsb_idl, static_mac_binding, &smb),
+        sb_table_set_opt_mon_condition(ovnsb_idl, service_monitor, &svc),
     };
 
     unsigned int expected_cond_seqno = 0;
@@ -395,6 +506,8 @@ out:;
     ovsdb_idl_condition_destroy(&igmp);
     ovsdb_idl_condition_destroy(&chprv);
     ovsdb_idl_condition_destroy(&tv);
+    ovsdb_idl_condition_destroy(&smb);
+    ovsdb_idl_condition_destroy(&svc);
     return expected_cond_seqno;
 }
 
@@ -573,6 +686,29 @@ process_br_int(struct ovsdb_idl_txn *ovs_idl_txn,
     *br_int_ = br_int;
 }
 
+/* After a reconnection, the SB IDL either resumes its monitors from the last
+ * transaction that it received, and only gets the changes that it missed, or
+ * it clears its content and gets all of it again, e.g. after a failover to a
+ * server or relay that doesn't have that transaction in its history.
+ *
+ * Returns true if the content of 'ovnsb_idl', which just got the reply to
+ * its monitor requests, was replaced, in which case the engine must
+ * recompute: the rows are new ones, even with the same content, and the
+ * engine data still points to the old ones.  'sb_global_uuid' is the UUID
+ * of the SB_Global row before the reconnection, all zeros if there was
+ * none.  That row is never deleted, so it is only new if the content was
+ * replaced. */
+static bool
+sb_idl_content_replaced(struct ovsdb_idl *ovnsb_idl,
+                        const struct uuid *sb_global_uuid)
+{
+    const struct sbrec_sb_global *sb = sbrec_sb_global_first(ovnsb_idl);
+
+    return (!sb || uuid_is_zero(sb_global_uuid)
+            || !uuid_equals(&sb->header_.uuid, sb_global_uuid)
+            || sbrec_sb_global_is_new(sb));
+}
+
 static void
 update_ssl_config(const struct ovsrec_ssl_table *ssl_table)
 {
@@ -592,6 +728,25 @@ update_ssl_config(const struct ovsrec_ssl_table *ssl_table)
     }
 }
 
+/* Minimum time, in milliseconds, between two updates of nb_cfg in the
+ * chassis' Chassis_Private, see external_ids:ovn-nb-cfg-report-interval, and
+ * time before which nb_cfg is not updated again. */
+static unsigned int nb_cfg_report_interval;
+static long long int nb_cfg_report_time;
+
+/* Returns true if reporting nb_cfg in Chassis_Private must be delayed, so
+ * that the sequence numbers acknowledged in the meantime are coalesced into
+ * a single SB transaction. */
+static bool
+nb_cfg_report_is_delayed(void)
+{
+    if (time_msec() < nb_cfg_report_time) {
+        poll_timer_wait_until(nb_cfg_report_time);
+        return true;
+    }
+    return false;
+}
+
 /* Retrieves the pointer to the OVN Southbound database from 'ovs_idl' and
  * updates 'sbdb_idl' with that pointer. */
 static void
@@ -620,6 +775,15 @@ update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
             &cfg->external_ids, chassis_id, "ovn-remote-probe-interval", -1);
     set_idl_probe_interval(ovnsb_idl, remote, interval);
 
+    unsigned int report_interval =
+        get_chassis_external_id_value_uint(
+            &cfg->external_ids, chassis_id, "ovn-nb-cfg-report-interval", 0);
+    if (report_interval != nb_cfg_report_interval) {
+        nb_cfg_report_time = MIN(nb_cfg_report_time,
+                                 time_msec() + report_interval);
+        nb_cfg_report_interval = report_interval;
+    }
+
     bool monitor_all =
         get_chassis_external_id_value_bool(
             &cfg->external_ids, chassis_id, "ovn-monitor-all", false);
@@ -637,6 +801,30 @@ update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
     if (monitor_all_p) {
         *monitor_all_p = monitor_all;
     }
+
+    bool monitor_local_dp_groups =
+        get_chassis_external_id_value_bool(
+            &cfg->external_ids, chassis_id, "ovn-monitor-local-dp-groups",
+            false);
+    if (monitor_local_dp_groups != sb_monitor_local_dp_groups) {
+        /* Recompute so that the monitor conditions get updated. */
+        sb_monitor_local_dp_groups = monitor_local_dp_groups;
+        engine_set_force_recompute(true);
+    }
+    bool lazy_peer_dps =
+        get_chassis_external_id_value_bool(
+            &cfg->external_ids, chassis_id, "ovn-lazy-peer-datapaths", false);
+    if (lazy_peer_dps != lazy_peer_dps_enabled) {
+        /* Recompute so that the monitor conditions get updated. */
+        lazy_peer_dps_enabled = lazy_peer_dps;
+        engine_set_force_recompute(true);
+    }
+    lazy_peer_dps_idle_timeout_ms =
+        get_chassis_external_id_value_uint(
+            &cfg->external_ids, chassis_id,
+            "ovn-lazy-peer-datapaths-idle-timeout",
+            DEFAULT_LAZY_PEER_DPS_IDLE_TIMEOUT) * 1000ULL;
+
     if (reset_ovnsb_idl_min_index && *reset_ovnsb_idl_min_index) {
         VLOG_INFO("Resetting southbound database cluster state");
         engine_set_force_recompute(true);
@@ -671,6 +859,111 @@ update_sb_db(struct ovsdb_idl *ovs_idl, struct ovsdb_idl *ovnsb_idl,
                 "ovn-trim-timeout-ms",
                 DEFAULT_LFLOW_CACHE_TRIM_TO_MS));
     }
+
+    lflow_set_n_threads(
+        get_chassis_external_id_value_uint(
+            &cfg->external_ids, chassis_id, "ovn-lflow-n-threads", 1));
+
+    engine_set_time_budget(
+        get_chassis_external_id_value_uint(
+            &cfg->external_ids, chassis_id, "ovn-engine-time-budget", 0));
+
+    if (lflow_set_flow_budget(
+            get_chassis_external_id_value_uint(
+                &cfg->external_ids, chassis_id, "ovn-lflow-flow-budget", 0))) {
+        /* The cached matches may have been computed with another budget. */
+        if (ctx) {
+            lflow_cache_flush(ctx->lflow_cache);
+        }
+        engine_set_force_recompute(true);
+    }
+}
+
+/* Conntrack zone allocator.
+ *
+ * The free zones are kept in a doubly linked list, threaded through 'prev'
+ * and 'next' and using zone 0 (which is reserved) as the list head, so
+ * allocating, freeing and claiming a specific zone are all O(1).  Zones are
+ * allocated from the front of the list and freed zones are appended to its
+ * back, so a freed zone is only reused after all the other free zones were.
+ * The zone is flushed again, ahead of the flows of its new user, when it is
+ * reused, so this only spreads the reuse of zones: it isn't needed for
+ * correctness.  A requested SNAT zone, in particular, can be claimed right
+ * after its release. */
+struct ct_zone_allocator {
+    unsigned long used[BITMAP_N_LONGS(MAX_CT_ZONES + 1)];
+    uint16_t prev[MAX_CT_ZONES + 1];
+    uint16_t next[MAX_CT_ZONES + 1];
+};
+
+static void
+ct_zone_allocator_init(struct ct_zone_allocator *za)
+{
+    memset(za->used, 0, sizeof za->used);
+    bitmap_set1(za->used, 0); /* Zone 0 is reserved. */
+    for (size_t zone = 0; zone <= MAX_CT_ZONES; zone++) {
+        za->next[zone] = zone == MAX_CT_ZONES ? 0 : zone + 1;
+        za->prev[zone] = zone == 0 ? MAX_CT_ZONES : zone - 1;
+    }
+}
+
+static bool
+ct_zone_is_used(const struct ct_zone_allocator *za, uint16_t zone)
+{
+    return bitmap_is_set(za->used, zone);
+}
+
+/* Marks 'zone' as used, removing it from the free list. */
+static void
+ct_zone_set_used(struct ct_zone_allocator *za, uint16_t zone)
+{
+    if (ct_zone_is_used(za, zone)) {
+        return;
+    }
+    bitmap_set1(za->used, zone);
+    za->next[za->prev[zone]] = za->next[zone];
+    za->prev[za->next[zone]] = za->prev[zone];
+}
+
+/* Releases 'zone', making it the last one to be allocated again. */
+static void
+ct_zone_set_free(struct ct_zone_allocator *za, uint16_t zone)
+{
+    if (!zone || !ct_zone_is_used(za, zone)) {
+        return;
+    }
+    bitmap_set0(za->used, zone);
+    za->prev[zone] = za->prev[0];
+    za->next[zone] = 0;
+    za->next[za->prev[0]] = zone;
+    za->prev[0] = zone;
+}
+
+/* Allocates the free zone that was released the longest time ago.  Returns 0
+ * if all the zones are in use. */
+static uint16_t
+ct_zone_alloc(struct ct_zone_allocator *za)
+{
+    uint16_t zone = za->next[0];
+    if (zone) {
+        ct_zone_set_used(za, zone);
+    }
+    return zone;
+}
+
+/* Makes the zones in use in 'za' exactly the ones set in 'used', keeping the
+ * order of the zones that stay free. */
+static void
+ct_zone_allocator_sync(struct ct_zone_allocator *za,
+                       const unsigned long *used)
+{
+    for (size_t zone = 1; zone <= MAX_CT_ZONES; zone++) {
+        if (bitmap_is_set(used, zone)) {
+            ct_zone_set_used(za, zone);
+        } else {
+            ct_zone_set_free(za, zone);
+        }
+    }
 }
 
 static void
@@ -699,23 +992,20 @@ add_pending_ct_zone_entry(struct shash *pending_ct_zones,
 
 static bool
 alloc_id_to_ct_zone(const char *zone_name, struct simap *ct_zones,
-                    unsigned long *ct_zone_bitmap, int *scan_start,
+                    struct ct_zone_allocator *za,
                     struct shash *pending_ct_zones)
 {
     /* We assume that there are 64K zones and that we own them all. */
-    int zone = bitmap_scan(ct_zone_bitmap, 0, *scan_start, MAX_CT_ZONES + 1);
-    if (zone == MAX_CT_ZONES + 1) {
+    uint16_t zone = ct_zone_alloc(za);
+    if (!zone) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
         VLOG_WARN_RL(&rl, "exhausted all ct zones");
         return false;
     }
 
-    *scan_start = zone + 1;
-
     add_pending_ct_zone_entry(pending_ct_zones, CT_ZONE_OF_QUEUED,
                               zone, true, zone_name);
 
-    bitmap_set1(ct_zone_bitmap, zone);
     simap_put(ct_zones, zone_name, zone);
     return true;
 }
@@ -729,11 +1019,10 @@ get_snat_ct_zone(const struct sbrec_datapath_binding *dp)
 static void
 update_ct_zones(const struct sset *local_lports,
                 const struct hmap *local_datapaths,
-                struct simap *ct_zones, unsigned long *ct_zone_bitmap,
+                struct simap *ct_zones, struct ct_zone_allocator *za,
                 struct shash *pending_ct_zones)
 {
     struct simap_node *ct_zone;
-    int scan_start = 1;
     const char *user;
     struct sset all_users = SSET_INITIALIZER(&all_users);
     struct simap req_snat_zones = SIMAP_INITIALIZER(&req_snat_zones);
@@ -781,7 +1070,7 @@ update_ct_zones(const struct sset *local_lports,
             add_pending_ct_zone_entry(pending_ct_zones, CT_ZONE_OF_QUEUED,
                                       ct_zone->data, false, ct_zone->name);
 
-            bitmap_set0(ct_zone_bitmap, ct_zone->data);
+            ct_zone_set_free(za, ct_zone->data);
             simap_delete(ct_zones, ct_zone);
         } else if (!simap_find(&req_snat_zones, ct_zone->name)) {
             bitmap_set1(unreq_snat_zones_map, ct_zone->data);
@@ -819,14 +1108,14 @@ update_ct_zones(const struct sset *local_lports,
                 add_pending_ct_zone_entry(pending_ct_zones, CT_ZONE_OF_QUEUED,
                                           snat_req_node->data, true,
                                           snat_req_node->name);
-                bitmap_set0(ct_zone_bitmap, node->data);
+                ct_zone_set_free(za, node->data);
             }
-            bitmap_set1(ct_zone_bitmap, snat_req_node->data);
+            ct_zone_set_used(za, snat_req_node->data);
             node->data = snat_req_node->data;
         } else {
             add_pending_ct_zone_entry(pending_ct_zones, CT_ZONE_OF_QUEUED,
                                       snat_req_node->data, true, snat_req_node->name);
-            bitmap_set1(ct_zone_bitmap, snat_req_node->data);
+            ct_zone_set_used(za, snat_req_node->data);
             simap_put(ct_zones, snat_req_node->name, snat_req_node->data);
         }
     }
@@ -841,8 +1130,7 @@ update_ct_zones(const struct sset *local_lports,
             continue;
         }
 
-        alloc_id_to_ct_zone(user, ct_zones, ct_zone_bitmap, &scan_start,
-                            pending_ct_zones);
+        alloc_id_to_ct_zone(user, ct_zones, za, pending_ct_zones);
     }
 
     simap_destroy(&req_snat_zones);
@@ -890,7 +1178,7 @@ commit_ct_zones(const struct ovsrec_bridge *br_int,
 
 /* Connection tracking zones. */
 struct ed_type_ct_zones {
-    unsigned long bitmap[BITMAP_N_LONGS(MAX_CT_ZONES)];
+    struct ct_zone_allocator zones;
     struct shash pending;
     struct simap current;
 
@@ -926,8 +1214,8 @@ ct_zone_name_from_uuid(const struct sbrec_datapath_binding_table *dp_table,
 
 static void
 ct_zone_restore(const struct sbrec_datapath_binding_table *dp_table,
-                struct ed_type_ct_zones *ct_zones_data, const char *name,
-                int zone)
+                struct ed_type_ct_zones *ct_zones_data,
+                unsigned long *restored, const char *name, int zone)
 {
     VLOG_DBG("restoring ct zone %"PRId32" for '%s'", zone, name);
 
@@ -949,26 +1237,24 @@ ct_zone_restore(const struct sbrec_datapath_binding_table *dp_table,
     }
 
     simap_put(&ct_zones_data->current, current_name, zone);
-    bitmap_set1(ct_zones_data->bitmap, zone);
+    bitmap_set1(restored, zone);
 
     free(new_name);
 }
 
 static void
-restore_ct_zones(const struct ovsrec_bridge_table *bridge_table,
-                 const struct ovsrec_open_vswitch_table *ovs_table,
-                 const struct sbrec_datapath_binding_table *dp_table,
-                 struct ed_type_ct_zones *ct_zones_data)
+restore_ct_zones__(const struct ovsrec_bridge_table *bridge_table,
+                   const struct ovsrec_open_vswitch_table *ovs_table,
+                   const struct sbrec_datapath_binding_table *dp_table,
+                   struct ed_type_ct_zones *ct_zones_data,
+                   unsigned long *restored)
 {
-    memset(ct_zones_data->bitmap, 0, sizeof ct_zones_data->bitmap);
-    bitmap_set1(ct_zones_data->bitmap, 0); /* Zone 0 is reserved. */
-
     struct shash_node *pending_node;
     SHASH_FOR_EACH (pending_node, &ct_zones_data->pending) {
         struct ct_zone_pending_entry *ctpe = pending_node->data;
 
         if (ctpe->add) {
-            ct_zone_restore(dp_table, ct_zones_data,
+            ct_zone_restore(dp_table, ct_zones_data, restored,
                             pending_node->name, ctpe->zone);
         }
     }
@@ -1007,27 +1293,118 @@ restore_ct_zones(const struct ovsrec_bridge_table *bridge_table,
             continue;
         }
 
-        ct_zone_restore(dp_table, ct_zones_data, user, zone);
+        ct_zone_restore(dp_table, ct_zones_data, restored, user, zone);
+    }
+}
+
+static void
+restore_ct_zones(const struct ovsrec_bridge_table *bridge_table,
+                 const struct ovsrec_open_vswitch_table *ovs_table,
+                 const struct sbrec_datapath_binding_table *dp_table,
+                 struct ed_type_ct_zones *ct_zones_data)
+{
+    unsigned long *restored = bitmap_allocate(MAX_CT_ZONES + 1);
+
+    restore_ct_zones__(bridge_table, ovs_table, dp_table, ct_zones_data,
+                       restored);
+    ct_zone_allocator_sync(&ct_zones_data->zones, restored);
+    bitmap_free(restored);
+}
+
+/* Stages of the handling of an nb_cfg by this chassis, whose latency is
+ * displayed by nb-cfg/show-latency:
+ *
+ *   - NB_CFG_STAGE_COMPUTE: from receiving it in SB_Global to having the
+ *     matching flows computed.
+ *
+ *   - NB_CFG_STAGE_INSTALL: from then to OVS acknowledging the flows.
+ *
+ *   - NB_CFG_STAGE_TOTAL: from receiving it to OVS acknowledging the flows.
+ *
+ * nb_cfg values superseded before the end of a stage are skipped. */
+enum nb_cfg_stage {
+    NB_CFG_STAGE_COMPUTE,
+    NB_CFG_STAGE_INSTALL,
+    NB_CFG_STAGE_TOTAL,
+    NB_CFG_N_STAGES
+};
+
+static const char *nb_cfg_stage_names[NB_CFG_N_STAGES] = {
+    [NB_CFG_STAGE_COMPUTE] = "compute",
+    [NB_CFG_STAGE_INSTALL] = "install",
+    [NB_CFG_STAGE_TOTAL] = "total",
+};
+
+static struct {
+    uint64_t recv_cfg;          /* Last nb_cfg received in SB_Global. */
+    long long int recv_time;
+    uint64_t computed_cfg;      /* Last nb_cfg whose flows were computed. */
+    long long int computed_recv_time;
+    long long int computed_time;
+    uint64_t installed_cfg;     /* Last nb_cfg acknowledged by OVS. */
+    struct ovn_latency latency[NB_CFG_N_STAGES];
+} nb_cfg_latency;
+
+static void
+nb_cfg_latency_received(const struct sbrec_sb_global *sb)
+{
+    if (sb && sb->nb_cfg != nb_cfg_latency.recv_cfg) {
+        nb_cfg_latency.recv_cfg = sb->nb_cfg;
+        nb_cfg_latency.recv_time = time_msec();
+    }
+}
+
+static void
+nb_cfg_latency_computed(uint64_t nb_cfg)
+{
+    if (nb_cfg != nb_cfg_latency.computed_cfg
+        && nb_cfg == nb_cfg_latency.recv_cfg) {
+        long long int now = time_msec();
+
+        nb_cfg_latency.computed_cfg = nb_cfg;
+        nb_cfg_latency.computed_recv_time = nb_cfg_latency.recv_time;
+        nb_cfg_latency.computed_time = now;
+        ovn_latency_record(&nb_cfg_latency.latency[NB_CFG_STAGE_COMPUTE],
+                           now - nb_cfg_latency.recv_time);
+    }
+}
+
+static void
+nb_cfg_latency_installed(uint64_t nb_cfg)
+{
+    if (nb_cfg != nb_cfg_latency.installed_cfg) {
+        nb_cfg_latency.installed_cfg = nb_cfg;
+        if (nb_cfg == nb_cfg_latency.computed_cfg) {
+            long long int now = time_msec();
+
+            ovn_latency_record(&nb_cfg_latency.latency[NB_CFG_STAGE_INSTALL],
+                               now - nb_cfg_latency.computed_time);
+            ovn_latency_record(&nb_cfg_latency.latency[NB_CFG_STAGE_TOTAL],
+                               now - nb_cfg_latency.computed_recv_time);
+        }
     }
 }
 
 static uint64_t
 get_nb_cfg(const struct sbrec_sb_global_table *sb_global_table,
-           unsigned int cond_seqno, unsigned int expected_cond_seqno)
+           unsigned int cond_seqno, unsigned int expected_cond_seqno,
+           bool flows_incomplete)
 {
     static uint64_t nb_cfg = 0;
 
     /* Delay getting nb_cfg if there are monitor condition changes
      * in flight.  It might be that those changes would instruct the
      * server to send updates that happened before SB_Global.nb_cfg.
+     * Same if some logical flows are yet to be added to the flow table.
      */
-    if (cond_seqno != expected_cond_seqno) {
+    if (cond_seqno != expected_cond_seqno || flows_incomplete) {
         return nb_cfg;
     }
 
     const struct sbrec_sb_global *sb
         = sbrec_sb_global_table_first(sb_global_table);
     nb_cfg = sb ? sb->nb_cfg : 0;
+    nb_cfg_latency_computed(nb_cfg);
     return nb_cfg;
 }
 
@@ -1057,12 +1434,15 @@ store_nb_cfg(struct ovsdb_idl_txn *sb_txn, struct ovsdb_idl_txn *ovs_txn,
     if (!cur_cfg) {
         goto done;
     }
+    nb_cfg_latency_installed(cur_cfg);
 
     long long ts_now = time_wall_msec();
 
-    if (sb_txn && chassis && cur_cfg != chassis->nb_cfg) {
+    if (sb_txn && chassis && cur_cfg != chassis->nb_cfg
+        && !nb_cfg_report_is_delayed()) {
         sbrec_chassis_private_set_nb_cfg(chassis, cur_cfg);
         sbrec_chassis_private_set_nb_cfg_timestamp(chassis, ts_now);
+        nb_cfg_report_time = time_msec() + nb_cfg_report_interval;
 
         if (delay_nb_cfg_report) {
             VLOG_INFO("Sleep for %u sec", delay_nb_cfg_report);
@@ -1184,7 +1564,8 @@ ctrl_register_ovs_idl(struct ovsdb_idl *ovs_idl)
     SB_NODE(fdb, "fdb") \
     SB_NODE(meter, "meter") \
     SB_NODE(static_mac_binding, "static_mac_binding") \
-    SB_NODE(chassis_template_var, "chassis_template_var")
+    SB_NODE(chassis_template_var, "chassis_template_var") \
+    SB_NODE(mirror, "mirror")
 
 enum sb_engine_node {
 #define SB_NODE(NAME, NAME_STR) SB_##NAME,
@@ -1203,7 +1584,8 @@ enum sb_engine_node {
     OVS_NODE(interface, "interface") \
     OVS_NODE(qos, "qos") \
     OVS_NODE(queue, "queue") \
-    OVS_NODE(flow_sample_collector_set, "flow_sample_collector_set")
+    OVS_NODE(flow_sample_collector_set, "flow_sample_collector_set") \
+    OVS_NODE(mirror, "mirror")
 
 enum ovs_engine_node {
 #define OVS_NODE(NAME, NAME_STR) OVS_##NAME,
@@ -1432,6 +1814,44 @@ en_activated_ports_run(struct engine_node *node, void *data_)
     engine_set_node_state(node, state);
 }
 
+static void *
+en_lazy_datapaths_init(struct engine_node *node OVS_UNUSED,
+                       struct engine_arg *arg OVS_UNUSED)
+{
+    struct lazy_datapaths *data = xmalloc(sizeof *data);
+    lazy_datapaths_init(data);
+    return data;
+}
+
+static void
+en_lazy_datapaths_cleanup(void *data)
+{
+    lazy_datapaths_destroy(data);
+}
+
+/* Activates the datapaths that pinctrl got packets for.  The ones that
+ * became idle are deactivated by statctrl_run(). */
+static void
+en_lazy_datapaths_run(struct engine_node *node, void *data)
+{
+    struct lazy_datapaths *lazy = data;
+
+    lazy_datapaths_set_config(lazy, lazy_peer_dps_enabled,
+                              lazy_peer_dps_idle_timeout_ms);
+
+    struct ovs_list dps = OVS_LIST_INITIALIZER(&dps);
+    pinctrl_take_datapaths_to_activate(&dps);
+
+    struct activated_datapath *ad;
+    LIST_FOR_EACH_POP (ad, list, &dps) {
+        lazy_datapath_activate(lazy, ad->dp_key);
+        free(ad);
+    }
+
+    engine_set_node_state(node, lazy->changed ? EN_UPDATED : EN_UNCHANGED);
+    lazy->changed = false;
+}
+
 struct ed_type_postponed_ports {
     struct sset *postponed_ports;
 };
@@ -1467,6 +1887,43 @@ en_postponed_ports_run(struct engine_node *node, void *data_)
     engine_set_node_state(node, state);
 }
 
+/* Datapaths whose logical flows the first recompute of lflow_output left
+ * out, see 'deferred_dps' in struct lflow_ctx_out.  Like the
+ * postponed_ports node, this is an input node, but its data is populated by
+ * lflow_output. */
+struct ed_type_lflow_deferred {
+    struct uuidset dps;
+};
+
+static void *
+en_lflow_deferred_init(struct engine_node *node OVS_UNUSED,
+                       struct engine_arg *arg OVS_UNUSED)
+{
+    struct ed_type_lflow_deferred *data = xzalloc(sizeof *data);
+    uuidset_init(&data->dps);
+    return data;
+}
+
+static void
+en_lflow_deferred_cleanup(void *data_)
+{
+    struct ed_type_lflow_deferred *data = data_;
+    uuidset_destroy(&data->dps);
+}
+
+static void
+en_lflow_deferred_run(struct engine_node *node, void *data_)
+{
+    struct ed_type_lflow_deferred *data = data_;
+    enum engine_node_state state = EN_UNCHANGED;
+
+    /* Let the flows of the local VIFs reach the switch first. */
+    if (!uuidset_is_empty(&data->dps) && !ofctrl_has_backlog()) {
+        state = EN_UPDATED;
+    }
+    engine_set_node_state(node, state);
+}
+
 struct ed_type_runtime_data {
     /* Contains "struct local_datapath" nodes. */
     struct hmap local_datapaths;
@@ -1501,6 +1958,10 @@ struct ed_type_runtime_data {
     struct shash local_active_ports_ras;
 
     struct sset *postponed_ports;
+
+    /* The peer switches that are waiting for their first packet to be
+     * installed, see struct lazy_datapaths. */
+    struct hmapx lazy_peer_dps;
 };
 
 /* struct ed_type_runtime_data has the below members for tracking the
@@ -1573,6 +2034,7 @@ en_runtime_data_clear_tracked_data(void *data_)
     hmap_init(&data->tracked_dp_bindings);
     data->local_lports_changed = false;
     data->tracked = false;
+    binding_init_run();
 }
 
 static void *
@@ -1590,6 +2052,7 @@ en_runtime_data_init(struct engine_node *node OVS_UNUSED,
     local_binding_data_init(&data->lbinding_data);
     shash_init(&data->local_active_ports_ipv6_pd);
     shash_init(&data->local_active_ports_ras);
+    hmapx_init(&data->lazy_peer_dps);
 
     /* Init the tracked data. */
     hmap_init(&data->tracked_dp_bindings);
@@ -1611,6 +2074,24 @@ en_runtime_data_cleanup(void *data)
     shash_destroy(&rt_data->local_active_ports_ipv6_pd);
     shash_destroy(&rt_data->local_active_ports_ras);
     local_binding_data_destroy(&rt_data->lbinding_data);
+    hmapx_destroy(&rt_data->lazy_peer_dps);
+}
+
+static void
+en_runtime_data_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_runtime_data *rt_data = data;
+
+    simap_increase(usage, "runtime_data-local-datapaths",
+                   hmap_count(&rt_data->local_datapaths));
+    simap_increase(usage, "runtime_data-local-bindings",
+                   shash_count(&rt_data->lbinding_data.bindings));
+    simap_increase(usage, "runtime_data-local-lports",
+                   sset_count(&rt_data->local_lports));
+    simap_increase(usage, "runtime_data-related-lports",
+                   sset_count(&rt_data->related_lports.lport_names));
+    simap_increase(usage, "runtime_data-qos",
+                   hmap_count(&rt_data->qos_map));
 }
 
 static void
@@ -1688,6 +2169,7 @@ init_binding_ctx(struct engine_node *node,
     b_ctx_in->active_tunnels = &rt_data->active_tunnels;
     b_ctx_in->bridge_table = bridge_table;
     b_ctx_in->ovs_table = ovs_table;
+    b_ctx_in->lazy_dps = engine_get_input_data("lazy_datapaths", node);
 
     b_ctx_out->local_datapaths = &rt_data->local_datapaths;
     b_ctx_out->local_active_ports_ipv6_pd =
@@ -1704,6 +2186,7 @@ init_binding_ctx(struct engine_node *node,
     b_ctx_out->local_iface_ids = &rt_data->local_iface_ids;
     b_ctx_out->postponed_ports = rt_data->postponed_ports;
     b_ctx_out->tracked_dp_bindings = NULL;
+    b_ctx_out->lazy_peer_dps = &rt_data->lazy_peer_dps;
     b_ctx_out->if_mgr = ctrl_ctx->if_mgr;
     b_ctx_out->localnet_learn_fdb = rt_data->localnet_learn_fdb;
     b_ctx_out->localnet_learn_fdb_changed = false;
@@ -1733,6 +2216,7 @@ en_runtime_data_run(struct engine_node *node, void *data)
         sset_destroy(active_tunnels);
         destroy_qos_map(&rt_data->qos_map);
         smap_destroy(&rt_data->local_iface_ids);
+        hmapx_clear(&rt_data->lazy_peer_dps);
         hmap_init(local_datapaths);
         sset_init(local_lports);
         related_lports_init(&rt_data->related_lports);
@@ -1848,9 +2332,15 @@ runtime_data_ovs_interface_shadow_handler(struct engine_node *node, void *data)
     rt_data->tracked = true;
     b_ctx_out.tracked_dp_bindings = &rt_data->tracked_dp_bindings;
 
+    size_t n_lazy_peer_dps = hmapx_count(&rt_data->lazy_peer_dps);
     if (!binding_handle_ovs_interface_changes(&b_ctx_in, &b_ctx_out)) {
         return false;
     }
+    if (hmapx_count(&rt_data->lazy_peer_dps) > n_lazy_peer_dps) {
+        /* The flows that send the packets of the new peer switches to
+         * pinctrl are only installed by a recompute. */
+        return false;
+    }
 
     if (b_ctx_out.local_lports_changed) {
         engine_set_node_state(node, EN_UPDATED);
@@ -1874,9 +2364,14 @@ runtime_data_sb_port_binding_handler(struct engine_node *node, void *data)
     rt_data->tracked = true;
     b_ctx_out.tracked_dp_bindings = &rt_data->tracked_dp_bindings;
 
+    size_t n_lazy_peer_dps = hmapx_count(&rt_data->lazy_peer_dps);
     if (!binding_handle_port_binding_changes(&b_ctx_in, &b_ctx_out)) {
         return false;
     }
+    if (hmapx_count(&rt_data->lazy_peer_dps) > n_lazy_peer_dps) {
+        /* See runtime_data_ovs_interface_shadow_handler(). */
+        return false;
+    }
 
     rt_data->local_lports_changed = b_ctx_out.local_lports_changed;
     rt_data->localnet_learn_fdb = b_ctx_out.localnet_learn_fdb;
@@ -1911,6 +2406,10 @@ runtime_data_sb_datapath_binding_handler(struct engine_node *node OVS_UNUSED,
 
         }
 
+        if (hmapx_contains(&rt_data->lazy_peer_dps, dp)) {
+            return false;
+        }
+
         if (sbrec_datapath_binding_is_updated(
                 dp, SBREC_DATAPATH_BINDING_COL_TUNNEL_KEY) &&
             !sbrec_datapath_binding_is_new(dp)) {
@@ -2006,7 +2505,9 @@ template_vars_update(const struct sbrec_chassis_template_var_table *tv_table,
                 }
             }
             SMAP_FOR_EACH (node, local_templates) {
-                sset_add (deleted, node->key);
+                if (!smap_get_node(&tv->variables, node->key)) {
+                    sset_add(deleted, node->key);
+                }
             }
         }
 
@@ -2159,6 +2660,22 @@ en_addr_sets_cleanup(void *data)
     shash_destroy(&as->updated);
 }
 
+static void
+en_addr_sets_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_addr_sets *as = data;
+    size_t n_addrs = 0;
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &as->addr_sets) {
+        const struct expr_constant_set *cs = node->data;
+        n_addrs += cs->n_values;
+    }
+    simap_increase(usage, "addr_sets-address-sets",
+                   shash_count(&as->addr_sets));
+    simap_increase(usage, "addr_sets-addresses", n_addrs);
+}
+
 /* Iterate address sets in the southbound database.  Create and update the
  * corresponding symtab entries as necessary. */
 static void
@@ -2271,8 +2788,64 @@ struct ed_type_port_groups{
     struct sset new;
     struct sset deleted;
     struct sset updated;
+
+    /* The changes of the local lports, struct addr_set_diff, of the port
+     * groups in 'updated' that were updated once since the tracked data was
+     * cleared. */
+    struct shash updated_diffs;
 };
 
+static void
+port_group_diff_destroy(struct addr_set_diff *pg_diff)
+{
+    if (pg_diff) {
+        expr_constant_set_destroy(pg_diff->added);
+        free(pg_diff->added);
+        expr_constant_set_destroy(pg_diff->deleted);
+        free(pg_diff->deleted);
+        free(pg_diff);
+    }
+}
+
+static void
+port_group_diffs_clear(struct shash *updated_diffs)
+{
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, updated_diffs) {
+        port_group_diff_destroy(node->data);
+    }
+    shash_clear(updated_diffs);
+}
+
+/* Replaces the const set of the local lports of the port group 'name' by the
+ * ones of 'ports' and marks it as updated, keeping track of the lports added
+ * and deleted, so that the logical flows can be updated incrementally. */
+static void
+port_group_cs_local_update(struct ed_type_port_groups *pg, const char *name,
+                           const char *const *ports, size_t n_ports,
+                           const struct sset *local_lports)
+{
+    struct expr_constant_set *cs_new =
+        expr_constant_set_create_strings(ports, n_ports, local_lports);
+    struct expr_constant_set *cs_old =
+        shash_find_data(&pg->port_groups_cs_local, name);
+
+    if (cs_old && !sset_contains(&pg->new, name)
+        && !sset_contains(&pg->updated, name)) {
+        struct addr_set_diff *pg_diff = xmalloc(sizeof *pg_diff);
+        expr_constant_set_strings_diff(cs_old, cs_new, &pg_diff->added,
+                                       &pg_diff->deleted);
+        shash_add(&pg->updated_diffs, name, pg_diff);
+    } else {
+        /* The changes don't add up, the logical flows that use the port
+         * group will be reprocessed. */
+        port_group_diff_destroy(shash_find_and_delete(&pg->updated_diffs,
+                                                      name));
+    }
+    sset_add(&pg->updated, name);
+    expr_const_sets_add(&pg->port_groups_cs_local, name, cs_new);
+}
+
 static void
 port_group_ssets_add_or_update(struct shash *port_group_ssets,
                                const struct sbrec_port_group *pg)
@@ -2330,6 +2903,7 @@ en_port_groups_init(struct engine_node *node OVS_UNUSED,
     sset_init(&pg->new);
     sset_init(&pg->deleted);
     sset_init(&pg->updated);
+    shash_init(&pg->updated_diffs);
     return pg;
 }
 
@@ -2347,6 +2921,26 @@ en_port_groups_cleanup(void *data)
     sset_destroy(&pg->new);
     sset_destroy(&pg->deleted);
     sset_destroy(&pg->updated);
+    port_group_diffs_clear(&pg->updated_diffs);
+    shash_destroy(&pg->updated_diffs);
+}
+
+static void
+en_port_groups_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_port_groups *pg = data;
+    size_t n_ports = 0;
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &pg->port_group_ssets) {
+        const struct sset *lports = node->data;
+        n_ports += sset_count(lports);
+    }
+    simap_increase(usage, "port_groups-port-groups",
+                   shash_count(&pg->port_group_ssets));
+    simap_increase(usage, "port_groups-ports", n_ports);
+    simap_increase(usage, "port_groups-local-port-groups",
+                   shash_count(&pg->port_groups_cs_local));
 }
 
 static void
@@ -2367,30 +2961,30 @@ port_groups_init(const struct sbrec_port_group_table *port_group_table,
 static void
 port_groups_update(const struct sbrec_port_group_table *port_group_table,
                    const struct sset *local_lports,
-                   struct shash *port_group_ssets,
-                   struct shash *port_groups_cs_local,
-                   struct sset *new, struct sset *deleted,
-                   struct sset *updated)
+                   struct ed_type_port_groups *pg_data)
 {
     const struct sbrec_port_group *pg;
     SBREC_PORT_GROUP_TABLE_FOR_EACH_TRACKED (pg, port_group_table) {
         if (sbrec_port_group_is_deleted(pg)) {
-            expr_const_sets_remove(port_groups_cs_local, pg->name);
-            port_group_ssets_delete(port_group_ssets, pg->name);
-            sset_add(deleted, pg->name);
+            expr_const_sets_remove(&pg_data->port_groups_cs_local, pg->name);
+            port_group_ssets_delete(&pg_data->port_group_ssets, pg->name);
+            sset_add(&pg_data->deleted, pg->name);
         }
     }
 
     SBREC_PORT_GROUP_TABLE_FOR_EACH_TRACKED (pg, port_group_table) {
         if (!sbrec_port_group_is_deleted(pg)) {
-            port_group_ssets_add_or_update(port_group_ssets, pg);
-            expr_const_sets_add_strings(port_groups_cs_local, pg->name,
-                                        (const char *const *) pg->ports,
-                                        pg->n_ports, local_lports);
+            port_group_ssets_add_or_update(&pg_data->port_group_ssets, pg);
             if (sbrec_port_group_is_new(pg)) {
-                sset_add(new, pg->name);
+                expr_const_sets_add_strings(&pg_data->port_groups_cs_local,
+                                            pg->name,
+                                            (const char *const *) pg->ports,
+                                            pg->n_ports, local_lports);
+                sset_add(&pg_data->new, pg->name);
             } else {
-                sset_add(updated, pg->name);
+                port_group_cs_local_update(pg_data, pg->name,
+                                           (const char *const *) pg->ports,
+                                           pg->n_ports, local_lports);
             }
         }
     }
@@ -2403,6 +2997,7 @@ en_port_groups_clear_tracked_data(void *data_)
     sset_clear(&pg->new);
     sset_clear(&pg->deleted);
     sset_clear(&pg->updated);
+    port_group_diffs_clear(&pg->updated_diffs);
     pg->change_tracked = false;
 }
 
@@ -2437,9 +3032,7 @@ port_groups_sb_port_group_handler(struct engine_node *node, void *data)
     struct ed_type_runtime_data *rt_data =
         engine_get_input_data("runtime_data", node);
 
-    port_groups_update(pg_table, &rt_data->related_lports.lport_names,
-                       &pg->port_group_ssets, &pg->port_groups_cs_local,
-                       &pg->new, &pg->deleted, &pg->updated);
+    port_groups_update(pg_table, &rt_data->related_lports.lport_names, pg);
 
     if (!sset_is_empty(&pg->new) || !sset_is_empty(&pg->deleted) ||
             !sset_is_empty(&pg->updated)) {
@@ -2494,11 +3087,10 @@ port_groups_runtime_data_handler(struct engine_node *node, void *data)
             }
         }
         if (need_update) {
-            expr_const_sets_add_strings(&pg->port_groups_cs_local, pg_sb->name,
-                                        (const char *const *) pg_sb->ports,
-                                        pg_sb->n_ports,
-                                        &rt_data->related_lports.lport_names);
-            sset_add(&pg->updated, pg_sb->name);
+            port_group_cs_local_update(pg, pg_sb->name,
+                                       (const char *const *) pg_sb->ports,
+                                       pg_sb->n_ports,
+                                       &rt_data->related_lports.lport_names);
         }
     }
 
@@ -2519,6 +3111,7 @@ en_ct_zones_init(struct engine_node *node OVS_UNUSED,
 {
     struct ed_type_ct_zones *data = xzalloc(sizeof *data);
 
+    ct_zone_allocator_init(&data->zones);
     shash_init(&data->pending);
     simap_init(&data->current);
 
@@ -2541,6 +3134,17 @@ en_ct_zones_cleanup(void *data)
     shash_destroy_free_data(&ct_zones_data->pending);
 }
 
+static void
+en_ct_zones_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_ct_zones *ct_zones_data = data;
+
+    simap_increase(usage, "ct_zones-zones",
+                   simap_count(&ct_zones_data->current));
+    simap_increase(usage, "ct_zones-pending",
+                   shash_count(&ct_zones_data->pending));
+}
+
 static void
 en_ct_zones_run(struct engine_node *node, void *data)
 {
@@ -2557,7 +3161,7 @@ en_ct_zones_run(struct engine_node *node, void *data)
 
     restore_ct_zones(bridge_table, ovs_table, dp_table, ct_zones_data);
     update_ct_zones(&rt_data->local_lports, &rt_data->local_datapaths,
-                    &ct_zones_data->current, ct_zones_data->bitmap,
+                    &ct_zones_data->current, &ct_zones_data->zones,
                     &ct_zones_data->pending);
 
 
@@ -2640,7 +3244,6 @@ ct_zones_runtime_data_handler(struct engine_node *node, void *data)
 
     struct hmap *tracked_dp_bindings = &rt_data->tracked_dp_bindings;
     struct tracked_datapath *tdp;
-    int scan_start = 1;
 
     bool updated = false;
 
@@ -2668,7 +3271,7 @@ ct_zones_runtime_data_handler(struct engine_node *node, void *data)
                                     t_lport->pb->logical_port)) {
                     alloc_id_to_ct_zone(t_lport->pb->logical_port,
                                         &ct_zones_data->current,
-                                        ct_zones_data->bitmap, &scan_start,
+                                        &ct_zones_data->zones,
                                         &ct_zones_data->pending);
                     updated = true;
                 }
@@ -2681,7 +3284,7 @@ ct_zones_runtime_data_handler(struct engine_node *node, void *data)
                         &ct_zones_data->pending, CT_ZONE_OF_QUEUED,
                         ct_zone->data, false, ct_zone->name);
 
-                    bitmap_set0(ct_zones_data->bitmap, ct_zone->data);
+                    ct_zone_set_free(&ct_zones_data->zones, ct_zone->data);
                     simap_delete(&ct_zones_data->current, ct_zone);
                     updated = true;
                 }
@@ -2884,6 +3487,12 @@ struct ed_type_lb_data {
     struct uuidset updated;
     /* uuids of load balancers added during last run. */
     struct uuidset new;
+    /* uuids of the load balancers in 'old_lbs' that are being added back,
+     * whose 'removed_tuples' are only updated for the VIPs that change when
+     * they are. */
+    struct uuidset readd;
+    /* Parsed VIPs of the load balancers. */
+    struct ovn_lb_vip_cache *vip_cache;
 };
 
 struct lb_data_ctx_in {
@@ -2934,6 +3543,67 @@ lb_data_removed_five_tuples_remove(struct ed_type_lb_data *lb_data,
     }
 }
 
+static void
+lb_data_removed_vip_tuples_update(struct ed_type_lb_data *lb_data,
+                                  const struct ovn_lb_vip *old_vip,
+                                  const struct ovn_lb_vip *new_vip,
+                                  uint8_t proto)
+{
+    for (size_t i = 0; old_vip && i < old_vip->n_backends; i++) {
+        ovn_lb_5tuple_add(&lb_data->removed_tuples, old_vip,
+                          &old_vip->backends[i], proto);
+    }
+    for (size_t i = 0; new_vip && i < new_vip->n_backends; i++) {
+        struct ovn_lb_5tuple tuple;
+
+        ovn_lb_5tuple_init(&tuple, new_vip, &new_vip->backends[i], proto);
+        ovn_lb_5tuple_find_and_delete(&lb_data->removed_tuples, &tuple);
+    }
+}
+
+/* Updates the removed five tuples for load balancer 'old_lb' being replaced
+ * by 'new_lb', looking up each VIP of one in the other, so that only the
+ * backends of the VIPs that changed are added or removed. */
+static void
+lb_data_removed_five_tuples_diff(struct ed_type_lb_data *lb_data,
+                                 const struct ovn_controller_lb *old_lb,
+                                 const struct ovn_controller_lb *new_lb)
+{
+    if (!ovs_feature_is_supported(OVS_CT_TUPLE_FLUSH_SUPPORT) ||
+        (!old_lb->ct_flush && !new_lb->ct_flush)) {
+        return;
+    }
+
+    if (old_lb->ct_flush != new_lb->ct_flush
+        || old_lb->proto != new_lb->proto) {
+        lb_data_removed_five_tuples_add(lb_data, old_lb);
+        lb_data_removed_five_tuples_remove(lb_data, new_lb);
+        return;
+    }
+
+    for (size_t i = 0; i < old_lb->n_vips; i++) {
+        const struct ovn_lb_vip *old_vip = &old_lb->vips[i];
+        const struct ovn_lb_vip *new_vip =
+            ovn_controller_lb_find_vip(new_lb, &old_vip->vip,
+                                       old_vip->vip_port);
+
+        if (!new_vip
+            || !ovn_controller_lb_vip_backends_equal(old_vip, new_vip)) {
+            lb_data_removed_vip_tuples_update(lb_data, old_vip, new_vip,
+                                              old_lb->proto);
+        }
+    }
+    for (size_t i = 0; i < new_lb->n_vips; i++) {
+        const struct ovn_lb_vip *new_vip = &new_lb->vips[i];
+
+        if (!ovn_controller_lb_find_vip(old_lb, &new_vip->vip,
+                                        new_vip->vip_port)) {
+            lb_data_removed_vip_tuples_update(lb_data, NULL, new_vip,
+                                              new_lb->proto);
+        }
+    }
+}
+
 static void
 lb_data_local_lb_add(struct ed_type_lb_data *lb_data,
                      const struct sbrec_load_balancer *sbrec_lb,
@@ -2943,7 +3613,8 @@ lb_data_local_lb_add(struct ed_type_lb_data *lb_data,
     const struct uuid *uuid = &sbrec_lb->header_.uuid;
 
     struct ovn_controller_lb *lb =
-        ovn_controller_lb_create(sbrec_lb, template_vars, &template_vars_ref);
+        ovn_controller_lb_create(sbrec_lb, template_vars, &template_vars_ref,
+                                 lb_data->vip_cache);
     hmap_insert(&lb_data->local_lbs, &lb->hmap_node, uuid_hash(uuid));
 
     const char *tv_name;
@@ -2954,13 +3625,19 @@ lb_data_local_lb_add(struct ed_type_lb_data *lb_data,
 
     sset_destroy(&template_vars_ref);
 
-    lb_data_removed_five_tuples_remove(lb_data, lb);
+    const struct ovn_controller_lb *old_lb =
+        tracked ? ovn_controller_lb_find(&lb_data->old_lbs, uuid) : NULL;
+    if (old_lb && uuidset_find_and_delete(&lb_data->readd, uuid)) {
+        lb_data_removed_five_tuples_diff(lb_data, old_lb, lb);
+    } else {
+        lb_data_removed_five_tuples_remove(lb_data, lb);
+    }
 
     if (!tracked) {
         return;
     }
 
-    if (ovn_controller_lb_find(&lb_data->old_lbs, uuid)) {
+    if (old_lb) {
         uuidset_insert(&lb_data->updated, uuid);
         uuidset_find_and_delete(&lb_data->deleted, uuid);
     } else {
@@ -2968,21 +3645,34 @@ lb_data_local_lb_add(struct ed_type_lb_data *lb_data,
     }
 }
 
+/* Removes 'lb' from the local load balancers.  If 'readd' is true, the
+ * caller adds the load balancer back right after, and its removed five
+ * tuples are only updated then. */
 static void
 lb_data_local_lb_remove(struct ed_type_lb_data *lb_data,
-                        struct ovn_controller_lb *lb)
+                        struct ovn_controller_lb *lb, bool readd)
 {
     const struct uuid *uuid = &lb->slb->header_.uuid;
 
     objdep_mgr_remove_obj(&lb_data->deps_mgr, uuid);
     hmap_remove(&lb_data->local_lbs, &lb->hmap_node);
 
-    lb_data_removed_five_tuples_add(lb_data, lb);
-
-    hmap_insert(&lb_data->old_lbs, &lb->hmap_node, uuid_hash(uuid));
-    uuidset_insert(&lb_data->deleted, uuid);
-}
-
+    if (ovn_controller_lb_find(&lb_data->old_lbs, uuid)) {
+        /* Already updated during this run, so 'old_lbs' has the installed
+         * version of the load balancer and 'lb' was never installed. */
+        lb_data_removed_five_tuples_add(lb_data, lb);
+        ovn_controller_lb_destroy(lb);
+    } else {
+        if (readd) {
+            uuidset_insert(&lb_data->readd, uuid);
+        } else {
+            lb_data_removed_five_tuples_add(lb_data, lb);
+        }
+        hmap_insert(&lb_data->old_lbs, &lb->hmap_node, uuid_hash(uuid));
+    }
+    uuidset_insert(&lb_data->deleted, uuid);
+}
+
 static bool
 lb_data_handle_changed_ref(enum objdep_type type, const char *res_name,
                            struct ovs_list *objs_todo, const void *in_arg,
@@ -3005,11 +3695,12 @@ lb_data_handle_changed_ref(enum objdep_type type, const char *res_name,
             continue;
         }
 
-        lb_data_local_lb_remove(lb_data, lb);
-
         const struct sbrec_load_balancer *sbrec_lb =
             sbrec_load_balancer_table_get_for_uuid(ctx_in->lb_table, uuid);
-        if (!lb_is_local(sbrec_lb, ctx_in->local_datapaths)) {
+        bool is_local = lb_is_local(sbrec_lb, ctx_in->local_datapaths);
+
+        lb_data_local_lb_remove(lb_data, lb, is_local);
+        if (!is_local) {
             free(resource_lb_uuid);
             continue;
         }
@@ -3036,6 +3727,8 @@ en_lb_data_init(struct engine_node *node OVS_UNUSED,
     uuidset_init(&lb_data->deleted);
     uuidset_init(&lb_data->updated);
     uuidset_init(&lb_data->new);
+    uuidset_init(&lb_data->readd);
+    lb_data->vip_cache = ovn_lb_vip_cache_create();
 
     return lb_data;
 }
@@ -3069,6 +3762,7 @@ en_lb_data_run(struct engine_node *node, void *data)
         lb_data_local_lb_add(lb_data, sbrec_lb,
                              &tv_data->local_templates, false);
     }
+    ovn_lb_vip_cache_sweep(lb_data->vip_cache);
 
     engine_set_node_state(node, EN_UPDATED);
 }
@@ -3087,6 +3781,8 @@ lb_data_sb_load_balancer_handler(struct engine_node *node, void *data)
     const struct sbrec_load_balancer *sbrec_lb;
     SBREC_LOAD_BALANCER_TABLE_FOR_EACH_TRACKED (sbrec_lb, lb_table) {
         struct ovn_controller_lb *lb;
+        bool is_local = !sbrec_load_balancer_is_deleted(sbrec_lb)
+                        && lb_is_local(sbrec_lb, &rt_data->local_datapaths);
 
         if (!sbrec_load_balancer_is_new(sbrec_lb)) {
             lb = ovn_controller_lb_find(&lb_data->local_lbs,
@@ -3095,11 +3791,10 @@ lb_data_sb_load_balancer_handler(struct engine_node *node, void *data)
                 continue;
             }
 
-            lb_data_local_lb_remove(lb_data, lb);
+            lb_data_local_lb_remove(lb_data, lb, is_local);
         }
 
-        if (sbrec_load_balancer_is_deleted(sbrec_lb) ||
-            !lb_is_local(sbrec_lb, &rt_data->local_datapaths)) {
+        if (!is_local) {
             continue;
         }
 
@@ -3254,7 +3949,17 @@ en_lb_data_clear_tracked_data(void *data)
 {
     struct ed_type_lb_data *lb_data = data;
 
+    /* A change handler that failed may have left load balancers that were
+     * not added back. */
     struct ovn_controller_lb *lb;
+    struct uuidset_node *readd_node;
+    UUIDSET_FOR_EACH (readd_node, &lb_data->readd) {
+        lb = ovn_controller_lb_find(&lb_data->old_lbs, &readd_node->uuid);
+        if (lb) {
+            lb_data_removed_five_tuples_add(lb_data, lb);
+        }
+    }
+
     HMAP_FOR_EACH_POP (lb, hmap_node, &lb_data->old_lbs) {
         ovn_controller_lb_destroy(lb);
     }
@@ -3264,6 +3969,7 @@ en_lb_data_clear_tracked_data(void *data)
     uuidset_clear(&lb_data->deleted);
     uuidset_clear(&lb_data->updated);
     uuidset_clear(&lb_data->new);
+    uuidset_clear(&lb_data->readd);
     lb_data->change_tracked = false;
 }
 
@@ -3280,6 +3986,19 @@ en_lb_data_cleanup(void *data)
     uuidset_destroy(&lb_data->deleted);
     uuidset_destroy(&lb_data->updated);
     uuidset_destroy(&lb_data->new);
+    uuidset_destroy(&lb_data->readd);
+    ovn_lb_vip_cache_destroy(lb_data->vip_cache);
+}
+
+static void
+en_lb_data_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_lb_data *lb_data = data;
+
+    simap_increase(usage, "lb_data-local-lbs",
+                   hmap_count(&lb_data->local_lbs));
+    simap_increase(usage, "lb_data-deps",
+                   hmap_count(&lb_data->deps_mgr.resource_to_objects_table));
 }
 
 static void
@@ -3654,6 +4373,144 @@ en_mac_cache_cleanup(void *data)
     hmap_destroy(&cache_data->fdbs);
 }
 
+/* Engine node that tracks which local logical ports are mirrored by which
+ * mirror.  The OVS Mirror rows of the mirrors it marks as dirty are synced
+ * by mirror_run(), outside of the engine. */
+static void *
+en_mirror_init(struct engine_node *node OVS_UNUSED,
+               struct engine_arg *arg OVS_UNUSED)
+{
+    struct mirror_data *md = xzalloc(sizeof *md);
+
+    mirror_data_init(md);
+    return md;
+}
+
+static void
+en_mirror_run(struct engine_node *node, void *data)
+{
+    struct mirror_data *md = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    const struct ovsrec_mirror_table *ovs_mirror_table =
+        EN_OVSDB_GET(engine_get_input("OVS_mirror", node));
+    const struct sbrec_mirror_table *sb_mirror_table =
+        EN_OVSDB_GET(engine_get_input("SB_mirror", node));
+
+    mirror_recompute(md, ovs_mirror_table, sb_mirror_table,
+                     &rt_data->lbinding_data.bindings);
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+static void
+en_mirror_cleanup(void *data)
+{
+    mirror_data_destroy(data);
+}
+
+static void
+mirror_set_node_state(struct engine_node *node, struct mirror_data *md)
+{
+    if (!sset_is_empty(&md->dirty_mirrors)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+}
+
+static bool
+mirror_runtime_data_handler(struct engine_node *node, void *data)
+{
+    struct mirror_data *md = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+
+    /* There are no tracked data. Fall back to full recompute. */
+    if (!rt_data->tracked) {
+        return false;
+    }
+
+    struct tracked_datapath *tdp;
+    HMAP_FOR_EACH (tdp, node, &rt_data->tracked_dp_bindings) {
+        struct shash_node *shash_node;
+        SHASH_FOR_EACH (shash_node, &tdp->lports) {
+            struct tracked_lport *lport = shash_node->data;
+            if (!mirror_handle_lport(md, lport->pb->logical_port,
+                                     &rt_data->lbinding_data.bindings)) {
+                return false;
+            }
+        }
+    }
+
+    mirror_set_node_state(node, md);
+    return true;
+}
+
+static bool
+mirror_sb_port_binding_handler(struct engine_node *node, void *data)
+{
+    struct mirror_data *md = data;
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    const struct sbrec_port_binding_table *pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+
+    /* Bindings and releases are handled through the runtime data, so only
+     * the changes of mirror rules of already bound ports are left. */
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, pb_table) {
+        if (!sbrec_port_binding_is_updated(
+                pb, SBREC_PORT_BINDING_COL_MIRROR_RULES)) {
+            continue;
+        }
+        if (!mirror_handle_lport(md, pb->logical_port,
+                                 &rt_data->lbinding_data.bindings)) {
+            return false;
+        }
+    }
+
+    mirror_set_node_state(node, md);
+    return true;
+}
+
+static bool
+mirror_ovs_mirror_handler(struct engine_node *node, void *data)
+{
+    struct mirror_data *md = data;
+    const struct ovsrec_mirror_table *ovs_mirror_table =
+        EN_OVSDB_GET(engine_get_input("OVS_mirror", node));
+
+    const struct ovsrec_mirror *ovs_mirror;
+    OVSREC_MIRROR_TABLE_FOR_EACH_TRACKED (ovs_mirror, ovs_mirror_table) {
+        mirror_handle_ovs_mirror(md, ovs_mirror);
+    }
+
+    mirror_set_node_state(node, md);
+    return true;
+}
+
+static bool
+mirror_ovs_interface_handler(struct engine_node *node, void *data)
+{
+    struct mirror_data *md = data;
+    const struct ovsrec_interface_table *iface_table =
+        EN_OVSDB_GET(engine_get_input("OVS_interface", node));
+
+    /* The output ports of "local" mirrors are found through the
+     * "mirror-id" of the OVS interfaces. */
+    const struct ovsrec_interface *iface;
+    OVSREC_INTERFACE_TABLE_FOR_EACH_TRACKED (iface, iface_table) {
+        if (ovsrec_interface_is_new(iface)
+            || ovsrec_interface_is_deleted(iface)
+            || ovsrec_interface_is_updated(
+                   iface, OVSREC_INTERFACE_COL_EXTERNAL_IDS)) {
+            mirror_handle_mirror_ports_changed(md);
+            break;
+        }
+    }
+
+    mirror_set_node_state(node, md);
+    return true;
+}
+
 /* Engine node which is used to handle the Non VIF data like
  *   - OVS patch ports
  *   - Tunnel ports and the related chassis information.
@@ -3662,6 +4519,11 @@ struct ed_type_non_vif_data {
     struct simap patch_ofports; /* simap of patch ovs ports. */
     struct hmap chassis_tunnels; /* hmap of 'struct chassis_tunnel' from the
                                   * tunnel OVS ports. */
+
+    /* Tracked data.  If 'change_tracked' is true, the last run only changed
+     * the tunnels to the chassis in 'changed_chassis'. */
+    bool change_tracked;
+    struct sset changed_chassis;
 };
 
 static void *
@@ -3671,6 +4533,7 @@ en_non_vif_data_init(struct engine_node *node OVS_UNUSED,
     struct ed_type_non_vif_data *data = xzalloc(sizeof *data);
     simap_init(&data->patch_ofports);
     hmap_init(&data->chassis_tunnels);
+    sset_init(&data->changed_chassis);
     return data;
 }
 
@@ -3680,16 +4543,28 @@ en_non_vif_data_cleanup(void *data OVS_UNUSED)
     struct ed_type_non_vif_data *ed_non_vif_data = data;
     simap_destroy(&ed_non_vif_data->patch_ofports);
     chassis_tunnels_destroy(&ed_non_vif_data->chassis_tunnels);
+    sset_destroy(&ed_non_vif_data->changed_chassis);
+}
+
+static void
+en_non_vif_data_clear_tracked_data(void *data)
+{
+    struct ed_type_non_vif_data *ed_non_vif_data = data;
+    ed_non_vif_data->change_tracked = false;
+    sset_clear(&ed_non_vif_data->changed_chassis);
 }
 
 static void
 en_non_vif_data_run(struct engine_node *node, void *data)
 {
     struct ed_type_non_vif_data *ed_non_vif_data = data;
-    simap_destroy(&ed_non_vif_data->patch_ofports);
-    chassis_tunnels_destroy(&ed_non_vif_data->chassis_tunnels);
-    simap_init(&ed_non_vif_data->patch_ofports);
-    hmap_init(&ed_non_vif_data->chassis_tunnels);
+    struct simap old_patch_ofports;
+    struct hmap old_chassis_tunnels;
+
+    simap_init(&old_patch_ofports);
+    hmap_init(&old_chassis_tunnels);
+    simap_swap(&old_patch_ofports, &ed_non_vif_data->patch_ofports);
+    hmap_swap(&old_chassis_tunnels, &ed_non_vif_data->chassis_tunnels);
 
     const struct ovsrec_open_vswitch_table *ovs_table =
         EN_OVSDB_GET(engine_get_input("OVS_open_vswitch", node));
@@ -3711,7 +4586,23 @@ en_non_vif_data_run(struct engine_node *node, void *data)
 
     local_nonvif_data_run(br_int, chassis, &ed_non_vif_data->patch_ofports,
                           &ed_non_vif_data->chassis_tunnels);
-    engine_set_node_state(node, EN_UPDATED);
+
+    /* The patch ports are used by the flows of most of the port bindings, so
+     * only changes to the tunnels are tracked. */
+    enum engine_node_state state = EN_UPDATED;
+    if (simap_equal(&old_patch_ofports, &ed_non_vif_data->patch_ofports)) {
+        chassis_tunnels_diff(&old_chassis_tunnels,
+                             &ed_non_vif_data->chassis_tunnels,
+                             &ed_non_vif_data->changed_chassis);
+        ed_non_vif_data->change_tracked = true;
+        if (sset_is_empty(&ed_non_vif_data->changed_chassis)) {
+            state = EN_UNCHANGED;
+        }
+    }
+
+    simap_destroy(&old_patch_ofports);
+    chassis_tunnels_destroy(&old_chassis_tunnels);
+    engine_set_node_state(node, state);
 }
 
 static bool
@@ -3850,6 +4741,8 @@ en_dhcp_options_run(struct engine_node *node, void *data)
        dhcp_opt_add(&dhcp_opts->v6_opts, dhcpv6_opt_row->name,
                     dhcpv6_opt_row->code, dhcpv6_opt_row->type);
     }
+    /* Encoded DHCP actions depend on the option definitions. */
+    lflow_clear_encode_cache();
     engine_set_node_state(node, EN_UPDATED);
 }
 
@@ -3924,6 +4817,11 @@ init_lflow_ctx(struct engine_node *node,
                 engine_get_input("SB_fdb", node),
                 "dp_key");
 
+    struct ovsdb_idl_index *sbrec_fdb_by_dp_key_port_key =
+        engine_ovsdb_node_get_index(
+                engine_get_input("SB_fdb", node),
+                "dp_key_port_key");
+
     struct ovsdb_idl_index *sbrec_mac_binding_by_datapath =
         engine_ovsdb_node_get_index(
                 engine_get_input("SB_mac_binding", node),
@@ -4005,6 +4903,7 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_in->sbrec_port_binding_by_name = sbrec_port_binding_by_name;
     l_ctx_in->sbrec_port_binding_by_key = sbrec_port_binding_by_key;
     l_ctx_in->sbrec_fdb_by_dp_key = sbrec_fdb_by_dp_key;
+    l_ctx_in->sbrec_fdb_by_dp_key_port_key = sbrec_fdb_by_dp_key_port_key;
     l_ctx_in->sbrec_mac_binding_by_datapath = sbrec_mac_binding_by_datapath;
     l_ctx_in->sbrec_static_mac_binding_by_datapath =
         sbrec_static_mac_binding_by_datapath;
@@ -4027,6 +4926,7 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_in->chassis_tunnels = &non_vif_data->chassis_tunnels;
     l_ctx_in->lb_hairpin_use_ct_mark = n_opts->lb_hairpin_use_ct_mark;
     l_ctx_in->explicit_arp_ns_output = n_opts->explicit_arp_ns_output;
+
     l_ctx_in->nd_ra_opts = &fo->nd_ra_opts;
     l_ctx_in->dhcp_opts = &dhcp_opts->v4_opts;
     l_ctx_in->dhcpv6_opts = &dhcp_opts->v6_opts;
@@ -4035,6 +4935,9 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_in->collector_ids = &fo->collector_ids;
     l_ctx_in->local_lbs = &lb_data->local_lbs;
 
+    struct controller_engine_ctx *ctrl_ctx = engine_get_context()->client_ctx;
+    l_ctx_in->if_mgr = ctrl_ctx->if_mgr;
+
     l_ctx_out->flow_table = &fo->flow_table;
     l_ctx_out->group_table = &fo->group_table;
     l_ctx_out->meter_table = &fo->meter_table;
@@ -4042,6 +4945,7 @@ init_lflow_ctx(struct engine_node *node,
     l_ctx_out->conj_ids = &fo->conj_ids;
     l_ctx_out->objs_processed = &fo->objs_processed;
     l_ctx_out->lflow_cache = fo->pd.lflow_cache;
+    l_ctx_out->deferred_dps = NULL;
 }
 
 static void *
@@ -4066,6 +4970,7 @@ en_lflow_output_clear_tracked_data(void *data)
 {
     struct ed_type_lflow_output *flow_output_data = data;
     uuidset_clear(&flow_output_data->objs_processed);
+    lflow_conj_ids_purge_released(&flow_output_data->conj_ids);
 }
 
 static void
@@ -4084,6 +4989,21 @@ en_lflow_output_cleanup(void *data)
     flow_collector_ids_destroy(&flow_output_data->collector_ids);
 }
 
+static void
+en_lflow_output_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_lflow_output *fo = data;
+
+    simap_increase(usage, "logical_flow_output-flows",
+                   resizing_hmap_count(&fo->flow_table.match_flow_table));
+    simap_increase(usage, "logical_flow_output-deps-resources",
+                   hmap_count(&fo->lflow_deps_mgr.resource_to_objects_table));
+    simap_increase(usage, "logical_flow_output-deps-objects",
+                   fo->lflow_deps_mgr.n_objs);
+    simap_increase(usage, "logical_flow_output-conj-ids",
+                   hmap_count(&fo->conj_ids.conj_id_allocations));
+}
+
 static void
 en_lflow_output_run(struct engine_node *node, void *data)
 {
@@ -4125,7 +5045,14 @@ en_lflow_output_run(struct engine_node *node, void *data)
     struct ovn_extend_table *meter_table = &fo->meter_table;
     struct objdep_mgr *lflow_deps_mgr = &fo->lflow_deps_mgr;
 
+    /* On startup, the flows of the local VIFs are computed and installed
+     * before the ones of the other local datapaths. */
+    struct ed_type_lflow_deferred *deferred =
+        engine_get_input_data("lflow_deferred", node);
+    uuidset_clear(&deferred->dps);
+
     static bool first_run = true;
+    bool defer = first_run;
     if (first_run) {
         first_run = false;
     } else {
@@ -4133,7 +5060,8 @@ en_lflow_output_run(struct engine_node *node, void *data)
         ovn_extend_table_clear(group_table, false /* desired */);
         ovn_extend_table_clear(meter_table, false /* desired */);
         objdep_mgr_clear(lflow_deps_mgr);
-        lflow_conj_ids_clear(&fo->conj_ids);
+        /* Keep the conjunction ids of the lflows processed again. */
+        lflow_conj_ids_release_all(&fo->conj_ids);
     }
 
     struct controller_engine_ctx *ctrl_ctx = engine_get_context()->client_ctx;
@@ -4143,11 +5071,42 @@ en_lflow_output_run(struct engine_node *node, void *data)
     struct lflow_ctx_in l_ctx_in;
     struct lflow_ctx_out l_ctx_out;
     init_lflow_ctx(node, fo, &l_ctx_in, &l_ctx_out);
+    if (defer) {
+        l_ctx_out.deferred_dps = &deferred->dps;
+    }
     lflow_run(&l_ctx_in, &l_ctx_out);
 
+    lflow_table->incomplete = !uuidset_is_empty(&deferred->dps);
+    if (lflow_table->incomplete) {
+        poll_immediate_wake();
+    }
+
     engine_set_node_state(node, EN_UPDATED);
 }
 
+/* Adds the logical flows of the datapaths deferred by the first recompute,
+ * see en_lflow_deferred_run(). */
+static bool
+lflow_output_lflow_deferred_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_lflow_deferred *deferred =
+        engine_get_input_data("lflow_deferred", node);
+    struct ed_type_lflow_output *fo = data;
+
+    if (uuidset_is_empty(&deferred->dps)) {
+        return true;
+    }
+
+    struct lflow_ctx_in l_ctx_in;
+    struct lflow_ctx_out l_ctx_out;
+    init_lflow_ctx(node, fo, &l_ctx_in, &l_ctx_out);
+    lflow_add_deferred_flows(&deferred->dps, &l_ctx_in, &l_ctx_out);
+    fo->flow_table.incomplete = false;
+
+    engine_set_node_state(node, EN_UPDATED);
+    return true;
+}
+
 static bool
 lflow_output_sb_logical_flow_handler(struct engine_node *node, void *data)
 {
@@ -4162,6 +5121,24 @@ lflow_output_sb_logical_flow_handler(struct engine_node *node, void *data)
     return handled;
 }
 
+static bool
+lflow_output_sb_logical_dp_group_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_lflow_output *fo = data;
+    struct lflow_ctx_in l_ctx_in;
+    struct lflow_ctx_out l_ctx_out;
+    init_lflow_ctx(node, fo, &l_ctx_in, &l_ctx_out);
+
+    bool changed;
+    if (!lflow_handle_changed_dp_groups(&l_ctx_in, &l_ctx_out, &changed)) {
+        return false;
+    }
+    if (changed) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    return true;
+}
+
 static bool
 lflow_output_flow_sample_collector_set_handler(struct engine_node *node,
                                                void *data OVS_UNUSED)
@@ -4283,6 +5260,46 @@ lflow_output_sb_mac_binding_handler(struct engine_node *node, void *data)
     return true;
 }
 
+static bool
+lflow_output_sb_datapath_binding_handler(struct engine_node *node,
+                                         void *data)
+{
+    const struct sbrec_datapath_binding_table *dp_table =
+        EN_OVSDB_GET(engine_get_input("SB_datapath_binding", node));
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    struct ed_type_lflow_output *lfo = data;
+    struct lflow_ctx_in l_ctx_in;
+    struct lflow_ctx_out l_ctx_out;
+    bool initialized = false;
+
+    /* The datapaths that become local, or stop being local, are handled
+     * through runtime_data.  Only the MAC binding aging threshold of the
+     * local ones matters here, as it decides whether their MAC bindings
+     * need flows that mark them as used. */
+    const struct sbrec_datapath_binding *dp;
+    SBREC_DATAPATH_BINDING_TABLE_FOR_EACH_TRACKED (dp, dp_table) {
+        if (sbrec_datapath_binding_is_new(dp)
+            || sbrec_datapath_binding_is_deleted(dp)
+            || !sbrec_datapath_binding_is_updated(
+                    dp, SBREC_DATAPATH_BINDING_COL_EXTERNAL_IDS)
+            || !get_local_datapath(&rt_data->local_datapaths,
+                                   dp->tunnel_key)) {
+            continue;
+        }
+        if (!initialized) {
+            init_lflow_ctx(node, lfo, &l_ctx_in, &l_ctx_out);
+            initialized = true;
+        }
+        lflow_handle_changed_mac_binding_aging(dp, &l_ctx_in, &l_ctx_out);
+    }
+
+    if (initialized) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    return true;
+}
+
 static bool
 lflow_output_sb_static_mac_binding_handler(struct engine_node *node,
                                            void *data)
@@ -4340,6 +5357,50 @@ lflow_output_sb_port_binding_handler(struct engine_node *node, void *data)
     return true;
 }
 
+/* The logical flows only use the tunnels to find the OpenFlow port of the
+ * chassis of the child ports of the fwd_group() actions with liveness, which
+ * are referenced as port bindings.  So, reprocess the logical flows that
+ * reference the ports bound to the chassis whose tunnels changed. */
+static bool
+lflow_output_non_vif_data_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_non_vif_data *non_vif_data =
+        engine_get_input_data("non_vif_data", node);
+
+    if (!non_vif_data->change_tracked) {
+        return false;
+    }
+
+    struct ed_type_lflow_output *lfo = data;
+
+    struct lflow_ctx_in l_ctx_in;
+    struct lflow_ctx_out l_ctx_out;
+    init_lflow_ctx(node, lfo, &l_ctx_in, &l_ctx_out);
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (pb, l_ctx_in.port_binding_table) {
+        if (!pb->chassis || !sset_contains(&non_vif_data->changed_chassis,
+                                           pb->chassis->name)) {
+            continue;
+        }
+
+        bool changed;
+        if (!objdep_mgr_handle_change(l_ctx_out.lflow_deps_mgr,
+                                      OBJDEP_TYPE_PORTBINDING,
+                                      pb->logical_port,
+                                      lflow_handle_changed_ref,
+                                      l_ctx_out.objs_processed,
+                                      &l_ctx_in, &l_ctx_out, &changed)) {
+            return false;
+        }
+        if (changed) {
+            engine_set_node_state(node, EN_UPDATED);
+        }
+    }
+
+    return true;
+}
+
 static bool
 lflow_output_addr_sets_handler(struct engine_node *node, void *data)
 {
@@ -4439,12 +5500,24 @@ lflow_output_port_groups_handler(struct engine_node *node, void *data)
         }
     }
     SSET_FOR_EACH (ref_name, &pg_data->updated) {
-        if (!objdep_mgr_handle_change(l_ctx_out.lflow_deps_mgr,
-                                      OBJDEP_TYPE_PORTGROUP, ref_name,
-                                      lflow_handle_changed_ref,
-                                      l_ctx_out.objs_processed,
-                                      &l_ctx_in, &l_ctx_out, &changed)) {
-            return false;
+        struct addr_set_diff *pg_diff =
+            shash_find_data(&pg_data->updated_diffs, ref_name);
+        if (pg_diff && !pg_diff->added && !pg_diff->deleted) {
+            /* None of the local lports of the port group changed. */
+            continue;
+        }
+        if (!pg_diff || !lflow_handle_port_group_update(ref_name, pg_diff,
+                                                        &l_ctx_in, &l_ctx_out,
+                                                        &changed)) {
+            VLOG_DBG("Can't incrementally handle the change of port group %s."
+                     " Reprocess related lflows.", ref_name);
+            if (!objdep_mgr_handle_change(l_ctx_out.lflow_deps_mgr,
+                                          OBJDEP_TYPE_PORTGROUP, ref_name,
+                                          lflow_handle_changed_ref,
+                                          l_ctx_out.objs_processed,
+                                          &l_ctx_in, &l_ctx_out, &changed)) {
+                return false;
+            }
         }
         if (changed) {
             engine_set_node_state(node, EN_UPDATED);
@@ -4567,6 +5640,9 @@ lflow_output_runtime_data_handler(struct engine_node *node,
             }
         }
     }
+    if (l_ctx_in.localnet_learn_fdb_changed) {
+        lflow_handle_changed_localnet_learn_fdb(&l_ctx_in, &l_ctx_out);
+    }
 
     engine_set_node_state(node, EN_UPDATED);
     return true;
@@ -4632,6 +5708,8 @@ lflow_output_sb_meter_handler(struct engine_node *node, void *data)
 struct ed_type_pflow_output {
     /* Desired physical flows. */
     struct ovn_desired_flow_table flow_table;
+    /* Groups used to fan out multicast traffic to remote chassis. */
+    struct ovn_extend_table group_table;
     /* Drop debugging options. */
     struct physical_debug debug;
 };
@@ -4728,6 +5806,19 @@ static void init_physical_ctx(struct engine_node *node,
     p_ctx->local_bindings = &rt_data->lbinding_data.bindings;
     p_ctx->patch_ofports = &non_vif_data->patch_ofports;
     p_ctx->chassis_tunnels = &non_vif_data->chassis_tunnels;
+    p_ctx->lazy_dps = engine_get_input_data("lazy_datapaths", node);
+    p_ctx->lazy_peer_dps = &rt_data->lazy_peer_dps;
+
+    const struct ovsrec_open_vswitch *cfg =
+        ovsrec_open_vswitch_table_first(ovs_table);
+    struct ed_type_pflow_output *pfo = engine_get_internal_data(node);
+    p_ctx->group_table = NULL;
+    if (cfg && get_chassis_external_id_value_bool(&cfg->external_ids,
+                                                  chassis_id,
+                                                  "ovn-mc-fanout-groups",
+                                                  false)) {
+        p_ctx->group_table = &pfo->group_table;
+    }
 
     struct controller_engine_ctx *ctrl_ctx = engine_get_context()->client_ctx;
     p_ctx->if_mgr = ctrl_ctx->if_mgr;
@@ -4750,6 +5841,7 @@ en_pflow_output_init(struct engine_node *node OVS_UNUSED,
 {
     struct ed_type_pflow_output *data = xzalloc(sizeof *data);
     ovn_desired_flow_table_init(&data->flow_table);
+    ovn_extend_table_init(&data->group_table, "pflow-group-table", 0);
     return data;
 }
 
@@ -4758,6 +5850,16 @@ en_pflow_output_cleanup(void *data OVS_UNUSED)
 {
     struct ed_type_pflow_output *pfo = data;
     ovn_desired_flow_table_destroy(&pfo->flow_table);
+    ovn_extend_table_destroy(&pfo->group_table);
+}
+
+static void
+en_pflow_output_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_pflow_output *pfo = data;
+
+    simap_increase(usage, "physical_flow_output-flows",
+                   resizing_hmap_count(&pfo->flow_table.match_flow_table));
 }
 
 static void
@@ -4770,6 +5872,7 @@ en_pflow_output_run(struct engine_node *node, void *data)
         first_run = false;
     } else {
         ovn_desired_flow_table_clear(pflow_table);
+        ovn_extend_table_clear(&pfo->group_table, false /* desired */);
     }
 
     struct ed_type_runtime_data *rt_data =
@@ -4898,6 +6001,73 @@ pflow_output_sb_multicast_group_handler(struct engine_node *node, void *data)
     return true;
 }
 
+/* Recomputes the physical flows that depend on the tunnels to the chassis in
+ * 'changed_chassis'. */
+static void
+pflow_output_handle_chassis_tunnel_changes(
+    struct engine_node *node, struct ed_type_pflow_output *pfo,
+    const struct sset *changed_chassis)
+{
+    if (sset_is_empty(changed_chassis)) {
+        return;
+    }
+
+    struct ed_type_runtime_data *rt_data =
+        engine_get_input_data("runtime_data", node);
+    struct ed_type_non_vif_data *non_vif_data =
+        engine_get_input_data("non_vif_data", node);
+
+    struct physical_ctx p_ctx;
+    init_physical_ctx(node, rt_data, non_vif_data, &p_ctx);
+
+    physical_handle_chassis_tunnel_changes(&p_ctx, changed_chassis,
+                                           &pfo->flow_table);
+
+    engine_set_node_state(node, EN_UPDATED);
+    destroy_physical_ctx(&p_ctx);
+}
+
+static bool
+pflow_output_non_vif_data_handler(struct engine_node *node, void *data)
+{
+    struct ed_type_non_vif_data *non_vif_data =
+        engine_get_input_data("non_vif_data", node);
+
+    if (!non_vif_data->change_tracked) {
+        return false;
+    }
+
+    pflow_output_handle_chassis_tunnel_changes(node, data,
+                                               &non_vif_data->changed_chassis);
+    return true;
+}
+
+/* Handles sbrec_encap changes.  Changes to the encaps of a remote chassis
+ * only affect the selection of the tunnels towards that chassis. */
+static bool
+pflow_output_sb_encap_handler(struct engine_node *node, void *data)
+{
+    const struct sbrec_encap_table *encap_table =
+        EN_OVSDB_GET(engine_get_input("SB_encap", node));
+    const struct ovsrec_open_vswitch_table *ovs_table =
+        EN_OVSDB_GET(engine_get_input("OVS_open_vswitch", node));
+    const char *chassis_id = get_ovs_chassis_id(ovs_table);
+
+    struct sset changed_chassis = SSET_INITIALIZER(&changed_chassis);
+    const struct sbrec_encap *encap;
+    SBREC_ENCAP_TABLE_FOR_EACH_TRACKED (encap, encap_table) {
+        if (!chassis_id || !strcmp(encap->chassis_name, chassis_id)) {
+            sset_destroy(&changed_chassis);
+            return false;
+        }
+        sset_add(&changed_chassis, encap->chassis_name);
+    }
+
+    pflow_output_handle_chassis_tunnel_changes(node, data, &changed_chassis);
+    sset_destroy(&changed_chassis);
+    return true;
+}
+
 static bool
 pflow_output_runtime_data_handler(struct engine_node *node, void *data)
 {
@@ -5207,6 +6377,7 @@ main(int argc, char *argv[])
 
     /* Register ofctrl seqno types. */
     ofctrl_seq_type_nb_cfg = ofctrl_seqno_add_type();
+    ofctrl_seq_type_lazy_dps = ofctrl_seqno_add_type();
 
     patch_init();
     pinctrl_init();
@@ -5233,6 +6404,9 @@ main(int argc, char *argv[])
     struct ovsdb_idl_index *ovsrec_queue_by_external_ids
         = ovsdb_idl_index_create1(ovs_idl_loop.idl,
                                   &ovsrec_queue_col_external_ids);
+    struct ovsdb_idl_index *ovsrec_mirror_by_name
+        = ovsdb_idl_index_create1(ovs_idl_loop.idl,
+                                  &ovsrec_mirror_col_name);
     struct ovsdb_idl_index *ovsrec_flow_sample_collector_set_by_id
         = ovsdb_idl_index_create2(ovs_idl_loop.idl,
                                   &ovsrec_flow_sample_collector_set_col_bridge,
@@ -5294,8 +6468,15 @@ main(int argc, char *argv[])
         = ovsdb_idl_index_create2(ovnsb_idl_loop.idl,
                                   &sbrec_fdb_col_mac,
                                   &sbrec_fdb_col_dp_key);
+    struct ovsdb_idl_index *sbrec_fdb_by_dp_key_port_key
+        = ovsdb_idl_index_create2(ovnsb_idl_loop.idl,
+                                  &sbrec_fdb_col_dp_key,
+                                  &sbrec_fdb_col_port_key);
     struct ovsdb_idl_index *sbrec_mac_binding_by_datapath
         = mac_binding_by_datapath_index_create(ovnsb_idl_loop.idl);
+    struct ovsdb_idl_index *sbrec_service_monitor_by_lport
+        = ovsdb_idl_index_create1(ovnsb_idl_loop.idl,
+                                  &sbrec_service_monitor_col_logical_port);
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_datapath
         = ovsdb_idl_index_create1(ovnsb_idl_loop.idl,
                                   &sbrec_static_mac_binding_col_datapath);
@@ -5309,6 +6490,12 @@ main(int argc, char *argv[])
     ovsdb_idl_omit_alert(ovnsb_idl_loop.idl,
                          &sbrec_chassis_private_col_nb_cfg_timestamp);
 
+    struct ovn_idl_recorder *ovnsb_recorder = NULL;
+    if (ovnsb_record_file) {
+        ovnsb_recorder = ovn_idl_recorder_create(ovnsb_idl_loop.idl,
+                                                 ovnsb_record_file);
+    }
+
     /* Omit the external_ids column of all the tables except for -
      *  - DNS. pinctrl.c uses the external_ids column of DNS,
      *    which it shouldn't. This should be removed.
@@ -5360,6 +6547,7 @@ main(int argc, char *argv[])
     stopwatch_create(OFCTRL_SEQNO_RUN_STOPWATCH_NAME, SW_MS);
     stopwatch_create(BFD_RUN_STOPWATCH_NAME, SW_MS);
     stopwatch_create(VIF_PLUG_RUN_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(SB_IDL_RUN_STOPWATCH_NAME, SW_MS);
 
     /* Define inc-proc-engine nodes. */
     ENGINE_NODE(sb_ro, "sb_ro");
@@ -5368,11 +6556,13 @@ main(int argc, char *argv[])
     ENGINE_NODE_WITH_CLEAR_TRACK_DATA(ovs_interface_shadow,
                                       "ovs_interface_shadow");
     ENGINE_NODE_WITH_CLEAR_TRACK_DATA(runtime_data, "runtime_data");
-    ENGINE_NODE(non_vif_data, "non_vif_data");
+    ENGINE_NODE_WITH_CLEAR_TRACK_DATA(non_vif_data, "non_vif_data");
     ENGINE_NODE(mff_ovn_geneve, "mff_ovn_geneve");
     ENGINE_NODE(ofctrl_is_connected, "ofctrl_is_connected");
     ENGINE_NODE_WITH_CLEAR_TRACK_DATA(activated_ports, "activated_ports");
     ENGINE_NODE(postponed_ports, "postponed_ports");
+    ENGINE_NODE(lazy_datapaths, "lazy_datapaths");
+    ENGINE_NODE(lflow_deferred, "lflow_deferred");
     ENGINE_NODE(pflow_output, "physical_flow_output");
     ENGINE_NODE_WITH_CLEAR_TRACK_DATA(lflow_output, "logical_flow_output");
     ENGINE_NODE(controller_output, "controller_output");
@@ -5383,6 +6573,7 @@ main(int argc, char *argv[])
     ENGINE_NODE(if_status_mgr, "if_status_mgr");
     ENGINE_NODE_WITH_CLEAR_TRACK_DATA(lb_data, "lb_data");
     ENGINE_NODE(mac_cache, "mac_cache");
+    ENGINE_NODE(mirror, "mirror");
 
 #define SB_NODE(NAME, NAME_STR) ENGINE_NODE_SB(NAME, NAME_STR);
     SB_NODES
@@ -5427,7 +6618,7 @@ main(int argc, char *argv[])
      * be handled before any ct_zone changes.
      */
     engine_add_input(&en_pflow_output, &en_non_vif_data,
-                     NULL);
+                     pflow_output_non_vif_data_handler);
     engine_add_input(&en_pflow_output, &en_ct_zones,
                      pflow_output_ct_zones_handler);
     engine_add_input(&en_pflow_output, &en_sb_chassis,
@@ -5450,8 +6641,10 @@ main(int argc, char *argv[])
 
     engine_add_input(&en_pflow_output, &en_runtime_data,
                      pflow_output_runtime_data_handler);
-    engine_add_input(&en_pflow_output, &en_sb_encap, NULL);
+    engine_add_input(&en_pflow_output, &en_sb_encap,
+                     pflow_output_sb_encap_handler);
     engine_add_input(&en_pflow_output, &en_mff_ovn_geneve, NULL);
+    engine_add_input(&en_pflow_output, &en_lazy_datapaths, NULL);
     engine_add_input(&en_pflow_output, &en_ovs_open_vswitch, NULL);
     engine_add_input(&en_pflow_output, &en_ovs_bridge, NULL);
     engine_add_input(&en_pflow_output, &en_ovs_flow_sample_collector_set,
@@ -5485,7 +6678,7 @@ main(int argc, char *argv[])
     engine_add_input(&en_lflow_output, &en_runtime_data,
                      lflow_output_runtime_data_handler);
     engine_add_input(&en_lflow_output, &en_non_vif_data,
-                     NULL);
+                     lflow_output_non_vif_data_handler);
 
     engine_add_input(&en_lflow_output, &en_sb_multicast_group,
                      lflow_output_sb_multicast_group_handler);
@@ -5503,16 +6696,18 @@ main(int argc, char *argv[])
 
     engine_add_input(&en_lflow_output, &en_sb_mac_binding,
                      lflow_output_sb_mac_binding_handler);
+    engine_add_input(&en_lflow_output, &en_sb_datapath_binding,
+                     lflow_output_sb_datapath_binding_handler);
     engine_add_input(&en_lflow_output, &en_sb_static_mac_binding,
                      lflow_output_sb_static_mac_binding_handler);
     engine_add_input(&en_lflow_output, &en_sb_logical_flow,
                      lflow_output_sb_logical_flow_handler);
-    /* Using a noop handler since we don't really need any data from datapath
-     * groups or a full recompute.  Update of a datapath group will put
-     * logical flow into the tracked list, so the logical flow handler will
-     * process all changes. */
+    /* Update of a datapath group puts its logical flows into the tracked
+     * list, the logical flow handler leaves the ones that didn't change
+     * otherwise to the datapath group handler, which only considers the
+     * datapaths added to the group. */
     engine_add_input(&en_lflow_output, &en_sb_logical_dp_group,
-                     engine_noop_handler);
+                     lflow_output_sb_logical_dp_group_handler);
     engine_add_input(&en_lflow_output, &en_sb_dns, NULL);
     engine_add_input(&en_lflow_output, &en_lb_data,
                      lflow_output_lb_data_handler);
@@ -5520,6 +6715,10 @@ main(int argc, char *argv[])
                      lflow_output_sb_fdb_handler);
     engine_add_input(&en_lflow_output, &en_sb_meter,
                      lflow_output_sb_meter_handler);
+    /* The deferred logical flows are added after all the other changes are
+     * handled. */
+    engine_add_input(&en_lflow_output, &en_lflow_deferred,
+                     lflow_output_lflow_deferred_handler);
 
     engine_add_input(&en_ct_zones, &en_ovs_open_vswitch, NULL);
     engine_add_input(&en_ct_zones, &en_ovs_bridge, NULL);
@@ -5532,6 +6731,7 @@ main(int argc, char *argv[])
                      ovs_interface_shadow_ovs_interface_handler);
 
     engine_add_input(&en_runtime_data, &en_ofctrl_is_connected, NULL);
+    engine_add_input(&en_runtime_data, &en_lazy_datapaths, NULL);
 
     engine_add_input(&en_runtime_data, &en_ovs_open_vswitch, NULL);
     engine_add_input(&en_runtime_data, &en_ovs_bridge, NULL);
@@ -5572,12 +6772,36 @@ main(int argc, char *argv[])
     engine_add_input(&en_mac_cache, &en_sb_port_binding,
                      engine_noop_handler);
 
+    engine_add_input(&en_mirror, &en_runtime_data,
+                     mirror_runtime_data_handler);
+    engine_add_input(&en_mirror, &en_sb_mirror, NULL);
+    engine_add_input(&en_mirror, &en_sb_port_binding,
+                     mirror_sb_port_binding_handler);
+    engine_add_input(&en_mirror, &en_ovs_mirror, mirror_ovs_mirror_handler);
+    engine_add_input(&en_mirror, &en_ovs_interface,
+                     mirror_ovs_interface_handler);
+
     engine_add_input(&en_controller_output, &en_lflow_output,
                      controller_output_lflow_output_handler);
     engine_add_input(&en_controller_output, &en_pflow_output,
                      controller_output_pflow_output_handler);
     engine_add_input(&en_controller_output, &en_mac_cache,
                      controller_output_mac_cache_handler);
+    engine_add_input(&en_controller_output, &en_mirror,
+                     engine_noop_handler);
+
+    engine_set_node_memory_usage(&en_runtime_data,
+                                 en_runtime_data_get_memory_usage);
+    engine_set_node_memory_usage(&en_addr_sets,
+                                 en_addr_sets_get_memory_usage);
+    engine_set_node_memory_usage(&en_port_groups,
+                                 en_port_groups_get_memory_usage);
+    engine_set_node_memory_usage(&en_ct_zones, en_ct_zones_get_memory_usage);
+    engine_set_node_memory_usage(&en_lb_data, en_lb_data_get_memory_usage);
+    engine_set_node_memory_usage(&en_lflow_output,
+                                 en_lflow_output_get_memory_usage);
+    engine_set_node_memory_usage(&en_pflow_output,
+                                 en_pflow_output_get_memory_usage);
 
     struct engine_arg engine_arg = {
         .sb_idl = ovnsb_idl_loop.idl,
@@ -5602,6 +6826,8 @@ main(int argc, char *argv[])
                                 sbrec_datapath_binding_by_key);
     engine_ovsdb_node_add_index(&en_sb_fdb, "dp_key",
                                 sbrec_fdb_by_dp_key);
+    engine_ovsdb_node_add_index(&en_sb_fdb, "dp_key_port_key",
+                                sbrec_fdb_by_dp_key_port_key);
     engine_ovsdb_node_add_index(&en_sb_mac_binding, "datapath",
                                 sbrec_mac_binding_by_datapath);
     engine_ovsdb_node_add_index(&en_sb_static_mac_binding, "datapath",
@@ -5628,20 +6854,28 @@ main(int argc, char *argv[])
         engine_get_internal_data(&en_lb_data);
     struct mac_cache_data *mac_cache_data =
             engine_get_internal_data(&en_mac_cache);
+    struct lazy_datapaths *lazy_dps_data =
+            engine_get_internal_data(&en_lazy_datapaths);
 
     ofctrl_init(&lflow_output_data->group_table,
+                &pflow_output_data->group_table,
                 &lflow_output_data->meter_table);
     ofctrl_seqno_init();
 
-    unixctl_command_register("group-table-list", "", 0, 0,
+    unixctl_command_register("group-table-list", "[OFFSET [LIMIT]]", 0, 2,
                              extend_table_list,
                              &lflow_output_data->group_table);
 
-    unixctl_command_register("meter-table-list", "", 0, 0,
+    unixctl_command_register("pflow-group-table-list", "[OFFSET [LIMIT]]",
+                             0, 2,
+                             extend_table_list,
+                             &pflow_output_data->group_table);
+
+    unixctl_command_register("meter-table-list", "[OFFSET [LIMIT]]", 0, 2,
                              extend_table_list,
                              &lflow_output_data->meter_table);
 
-    unixctl_command_register("ct-zone-list", "", 0, 0,
+    unixctl_command_register("ct-zone-list", "[OFFSET [LIMIT]]", 0, 2,
                              ct_zone_list,
                              &ct_zones_data->current);
 
@@ -5662,6 +6896,12 @@ main(int argc, char *argv[])
     unixctl_command_register("lflow-cache/show-stats", "", 0, 0,
                              lflow_cache_show_stats_cmd,
                              &lflow_output_data->pd);
+    unixctl_command_register("lflow-cost/enable", "", 0, 0,
+                             lflow_cost_enable_cmd, NULL);
+    unixctl_command_register("lflow-cost/disable", "", 0, 0,
+                             lflow_cost_disable_cmd, NULL);
+    unixctl_command_register("lflow-cost/show", "[N]", 0, 1,
+                             lflow_cost_show_cmd, ovnsb_idl_loop.idl);
 
     bool reset_ovnsb_idl_min_index = false;
     unixctl_command_register("sb-cluster-state-reset", "", 0, 0,
@@ -5684,7 +6924,8 @@ main(int argc, char *argv[])
                              debug_dump_local_bindings,
                              &runtime_data->lbinding_data);
 
-    unixctl_command_register("debug/dump-lflow-conj-ids", "", 0, 0,
+    unixctl_command_register("debug/dump-lflow-conj-ids",
+                             "[OFFSET [LIMIT]]", 0, 2,
                              debug_dump_lflow_conj_ids,
                              &lflow_output_data->conj_ids);
 
@@ -5698,13 +6939,27 @@ main(int argc, char *argv[])
     unsigned int ovs_cond_seqno = UINT_MAX;
     unsigned int ovnsb_cond_seqno = UINT_MAX;
     unsigned int ovnsb_expected_cond_seqno = UINT_MAX;
+    struct uuid sb_global_uuid = UUID_ZERO;
+    bool sb_resync_pending = false;
 
     struct controller_engine_ctx ctrl_engine_ctx = {
         .lflow_cache = lflow_cache_create(),
         .if_mgr = if_status_mgr_create(),
     };
+    if (lflow_cache_file) {
+        lflow_load_cache(ctrl_engine_ctx.lflow_cache, lflow_cache_file);
+    }
     struct if_status_mgr *if_mgr = ctrl_engine_ctx.if_mgr;
 
+    unixctl_command_register("if-status/show-stats", "", 0, 0,
+                             if_status_show_stats_cmd, if_mgr);
+    unixctl_command_register("if-status/clear-stats", "", 0, 0,
+                             if_status_clear_stats_cmd, if_mgr);
+    unixctl_command_register("nb-cfg/show-latency", "", 0, 0,
+                             nb_cfg_show_latency_cmd, NULL);
+    unixctl_command_register("nb-cfg/clear-latency", "", 0, 0,
+                             nb_cfg_clear_latency_cmd, NULL);
+
     struct shash vif_plug_deleted_iface_ids =
         SHASH_INITIALIZER(&vif_plug_deleted_iface_ids);
     struct shash vif_plug_changed_iface_ids =
@@ -5713,6 +6968,11 @@ main(int argc, char *argv[])
     char *ovn_version = ovn_get_internal_version();
     VLOG_INFO("OVN internal version is : [%s]", ovn_version);
 
+    /* The chassis that tunnels are needed to, if "ovn-encap-on-demand" is
+     * set, as computed from the last valid runtime data. */
+    struct sset tunnel_peers = SSET_INITIALIZER(&tunnel_peers);
+    bool tunnel_peers_valid = false;
+
     /* Main loop. */
     bool sb_monitor_all = false;
     while (!exit_args.exiting) {
@@ -5722,10 +6982,16 @@ main(int argc, char *argv[])
 
             lflow_cache_get_memory_usage(ctrl_engine_ctx.lflow_cache, &usage);
             ofctrl_get_memory_usage(&usage);
+            ovn_slab_get_memory_usage(&usage);
             if_status_mgr_get_memory_usage(if_mgr, &usage);
+            lflow_get_lb_hairpin_usage(&lb_data->local_lbs,
+                                       &lflow_output_data->flow_table,
+                                       &usage);
             local_datapath_memory_usage(&usage);
+            pinctrl_get_memory_usage(&usage);
             ovsdb_idl_get_memory_usage(ovnsb_idl_loop.idl, &usage);
             ovsdb_idl_get_memory_usage(ovs_idl_loop.idl, &usage);
+            engine_get_memory_usage(&usage);
             memory_report(&usage);
             simap_destroy(&usage);
         }
@@ -5735,12 +7001,15 @@ main(int argc, char *argv[])
          */
         if (paused) {
             unixctl_server_run(unixctl);
+            sliced_reply_run(false);
             unixctl_server_wait(unixctl);
+            sliced_reply_wait();
             goto loop_done;
         }
 
         engine_init_run();
 
+        bool pinctrl_ran = false;
         struct ovsdb_idl_txn *ovs_idl_txn = ovsdb_idl_loop_run(&ovs_idl_loop);
         unsigned int new_ovs_cond_seqno
             = ovsdb_idl_get_condition_seqno(ovs_idl_loop.idl);
@@ -5757,17 +7026,40 @@ main(int argc, char *argv[])
                      &ctrl_engine_ctx, &ovnsb_expected_cond_seqno);
         update_ssl_config(ovsrec_ssl_table_get(ovs_idl_loop.idl));
 
+        /* Parsing and applying the SB updates is done by the IDL, on this
+         * thread, and delays everything else in the loop. */
+        stopwatch_start(SB_IDL_RUN_STOPWATCH_NAME, time_msec());
         struct ovsdb_idl_txn *ovnsb_idl_txn
             = ovsdb_idl_loop_run(&ovnsb_idl_loop);
+        stopwatch_stop(SB_IDL_RUN_STOPWATCH_NAME, time_msec());
         unsigned int new_ovnsb_cond_seqno
             = ovsdb_idl_get_condition_seqno(ovnsb_idl_loop.idl);
         if (new_ovnsb_cond_seqno != ovnsb_cond_seqno) {
             if (!new_ovnsb_cond_seqno) {
-                VLOG_INFO("OVNSB IDL reconnected, force recompute.");
-                engine_set_force_recompute(true);
+                VLOG_INFO("OVNSB IDL reconnected, waiting for resync.");
+                sb_resync_pending = true;
+                pinctrl_force_resync();
+            } else if (sb_resync_pending) {
+                /* The monitor requests were acknowledged, along with the
+                 * content that they got. */
+                sb_resync_pending = false;
+                if (sb_idl_content_replaced(ovnsb_idl_loop.idl,
+                                            &sb_global_uuid)) {
+                    VLOG_INFO("OVNSB IDL content replaced on resync, "
+                              "force recompute.");
+                    engine_set_force_recompute(true);
+                } else {
+                    VLOG_INFO("OVNSB IDL resumed its monitors on resync, "
+                              "processing changes incrementally.");
+                }
             }
             ovnsb_cond_seqno = new_ovnsb_cond_seqno;
         }
+        const struct sbrec_sb_global *sb_global_row =
+            sbrec_sb_global_first(ovnsb_idl_loop.idl);
+        sb_global_uuid = sb_global_row ? sb_global_row->header_.uuid
+                                       : UUID_ZERO;
+        nb_cfg_latency_received(sb_global_row);
 
         struct engine_context eng_ctx = {
             .ovs_idl_txn = ovs_idl_txn,
@@ -5809,6 +7101,21 @@ main(int argc, char *argv[])
             }
         }
 
+        const struct ovsrec_open_vswitch *ovs_cfg =
+            ovsrec_open_vswitch_table_first(ovs_table);
+        if_status_mgr_set_record_timings(
+            if_mgr, ovs_cfg && get_chassis_external_id_value_bool(
+                                   &ovs_cfg->external_ids,
+                                   get_ovs_chassis_id(ovs_table),
+                                   "ovn-record-install-timings", false));
+        if_status_mgr_set_max_ovs_writes(
+            if_mgr, ovs_cfg ? get_chassis_external_id_value_uint(
+                                  &ovs_cfg->external_ids,
+                                  get_ovs_chassis_id(ovs_table),
+                                  "ovn-ovs-txn-max-ifaces",
+                                  IF_STATUS_DEFAULT_MAX_OVS_WRITES)
+                            : IF_STATUS_DEFAULT_MAX_OVS_WRITES);
+
         static bool chassis_idx_stored = false;
         if (ovs_idl_txn && !chassis_idx_stored) {
             store_chassis_index_if_needed(ovs_table);
@@ -5859,9 +7166,18 @@ main(int argc, char *argv[])
                     uint32_t max_meters = ovs_feature_max_meters_get();
                     struct ed_type_lflow_output *lflow_out_data =
                         engine_get_internal_data(&en_lflow_output);
+                    struct ed_type_pflow_output *pflow_out_data =
+                        engine_get_internal_data(&en_pflow_output);
 
+                    /* The upper part of the group id space is reserved for
+                     * the multicast fan out groups built by physical.c. */
+                    uint32_t n_pflow_groups =
+                        MIN(max_groups / 4, PHYSICAL_MAX_GROUP_IDS);
                     ovn_extend_table_reinit(&lflow_out_data->group_table,
-                                            max_groups);
+                                            max_groups - n_pflow_groups);
+                    ovn_extend_table_reinit_range(
+                        &pflow_out_data->group_table,
+                        max_groups - n_pflow_groups + 1, n_pflow_groups);
                     ovn_extend_table_reinit(&lflow_out_data->meter_table,
                                             max_meters);
                 }
@@ -5882,13 +7198,19 @@ main(int argc, char *argv[])
                 }
 
                 if (chassis && ovs_feature_set_discovered()) {
-                    encaps_run(ovs_idl_txn, br_int,
-                               sbrec_chassis_table_get(ovnsb_idl_loop.idl),
-                               chassis,
-                               sbrec_sb_global_first(ovnsb_idl_loop.idl),
-                               ovs_table,
-                               &transport_zones,
-                               bridge_table);
+                    bool on_demand = encaps_tunnels_on_demand(ovs_table,
+                                                              chassis);
+                    if (!on_demand || tunnel_peers_valid) {
+                        encaps_run(ovs_idl_txn, br_int,
+                                   sbrec_chassis_table_get(ovnsb_idl_loop.idl),
+                                   chassis,
+                                   sbrec_sb_global_first(ovnsb_idl_loop.idl),
+                                   ovs_table,
+                                   &transport_zones,
+                                   on_demand ? &tunnel_peers : NULL,
+                                   sbrec_chassis_by_name,
+                                   bridge_table);
+                    }
 
                     stopwatch_start(CONTROLLER_LOOP_STOPWATCH_NAME,
                                     time_msec());
@@ -5940,11 +7262,23 @@ main(int argc, char *argv[])
                                 br_int, chassis,
                                 sbrec_ha_chassis_group_table_get(
                                     ovnsb_idl_loop.idl),
-                                sbrec_sb_global_table_get(ovnsb_idl_loop.idl));
+                                sbrec_sb_global_table_get(ovnsb_idl_loop.idl),
+                                ovsdb_idl_get_seqno(ovs_idl_loop.idl),
+                                ovsdb_idl_get_seqno(ovnsb_idl_loop.idl));
                         stopwatch_stop(BFD_RUN_STOPWATCH_NAME, time_msec());
                     }
 
                     runtime_data = engine_get_data(&en_runtime_data);
+                    if (runtime_data && on_demand) {
+                        sset_clear(&tunnel_peers);
+                        encaps_collect_peer_chassis(
+                            &runtime_data->local_datapaths,
+                            sbrec_port_binding_by_datapath,
+                            sbrec_ha_chassis_group_table_get(
+                                ovnsb_idl_loop.idl),
+                            chassis, &tunnel_peers);
+                        tunnel_peers_valid = true;
+                    }
                     if (runtime_data) {
                         stopwatch_start(PATCH_RUN_STOPWATCH_NAME, time_msec());
                         patch_run(ovs_idl_txn,
@@ -5997,6 +7331,7 @@ main(int argc, char *argv[])
                                     sbrec_igmp_group,
                                     sbrec_ip_multicast,
                                     sbrec_fdb_by_dp_key_mac,
+                                    sbrec_service_monitor_by_lport,
                                     sbrec_dns_table_get(ovnsb_idl_loop.idl),
                                     sbrec_controller_event_table_get(
                                         ovnsb_idl_loop.idl),
@@ -6005,20 +7340,27 @@ main(int argc, char *argv[])
                                     sbrec_mac_binding_table_get(
                                         ovnsb_idl_loop.idl),
                                     sbrec_bfd_table_get(ovnsb_idl_loop.idl),
+                                    sbrec_port_binding_table_get(
+                                        ovnsb_idl_loop.idl),
                                     br_int, chassis,
                                     &runtime_data->local_datapaths,
+                                    lazy_dps_data,
                                     &runtime_data->active_tunnels,
                                     &runtime_data->local_active_ports_ipv6_pd,
                                     &runtime_data->local_active_ports_ras,
                                     ovsrec_open_vswitch_table_get(
                                             ovs_idl_loop.idl));
+                        pinctrl_ran = true;
                         stopwatch_stop(PINCTRL_RUN_STOPWATCH_NAME,
                                        time_msec());
-                        mirror_run(ovs_idl_txn,
-                                   ovsrec_mirror_table_get(ovs_idl_loop.idl),
-                                   sbrec_mirror_table_get(ovnsb_idl_loop.idl),
-                                   br_int,
-                                   &runtime_data->lbinding_data.bindings);
+                        struct mirror_data *mirror_data =
+                            engine_get_data(&en_mirror);
+                        if (mirror_data) {
+                            mirror_run(ovs_idl_txn, mirror_data,
+                                       ovsrec_mirror_by_name,
+                                       ovsrec_port_by_interfaces, br_int,
+                                       &runtime_data->lbinding_data.bindings);
+                        }
                         /* Updating monitor conditions if runtime data or
                          * logical datapath goups changed. */
                         if (engine_node_changed(&en_runtime_data)
@@ -6041,15 +7383,33 @@ main(int argc, char *argv[])
                     }
 
                     if (mac_cache_data) {
-                        statctrl_run(ovnsb_idl_txn, mac_cache_data);
+                        statctrl_run(ovnsb_idl_txn, mac_cache_data,
+                                     lazy_dps_data);
                     }
 
+                    struct ed_type_lflow_output *lfo =
+                        engine_get_internal_data(&en_lflow_output);
                     ofctrl_seqno_update_create(
                         ofctrl_seq_type_nb_cfg,
                         get_nb_cfg(sbrec_sb_global_table_get(
                                                        ovnsb_idl_loop.idl),
                                               ovnsb_cond_seqno,
-                                              ovnsb_expected_cond_seqno));
+                                              ovnsb_expected_cond_seqno,
+                                              lfo->flow_table.incomplete));
+
+                    /* The flows of the datapaths activated by this run are
+                     * in the desired flow tables if it completed, so the
+                     * packets buffered for them can be resumed once this
+                     * ofctrl_put() is acked. */
+                    if (engine_has_run() && !engine_canceled()
+                        && !lfo->flow_table.incomplete) {
+                        uint64_t lazy_seqno =
+                            lazy_datapaths_request_install(lazy_dps_data);
+                        if (lazy_seqno) {
+                            ofctrl_seqno_update_create(
+                                ofctrl_seq_type_lazy_dps, lazy_seqno);
+                        }
+                    }
 
                     struct local_binding_data *binding_data =
                         runtime_data ? &runtime_data->lbinding_data : NULL;
@@ -6085,8 +7445,20 @@ main(int argc, char *argv[])
                     stopwatch_start(OFCTRL_SEQNO_RUN_STOPWATCH_NAME,
                                     time_msec());
                     ofctrl_seqno_run(ofctrl_get_cur_cfg());
+                    ofctrl_seqno_run_type(
+                        if_status_mgr_get_seqno_type(if_mgr),
+                        ofctrl_get_prio_cfg());
                     stopwatch_stop(OFCTRL_SEQNO_RUN_STOPWATCH_NAME,
                                    time_msec());
+
+                    struct ofctrl_acked_seqnos *acked_lazy_seqnos =
+                        ofctrl_acked_seqnos_get(ofctrl_seq_type_lazy_dps);
+                    if (lazy_datapaths_install_acked(
+                            lazy_dps_data, acked_lazy_seqnos->last_acked)) {
+                        /* Let pinctrl resume the buffered packets. */
+                        poll_immediate_wake();
+                    }
+                    ofctrl_acked_seqnos_destroy(acked_lazy_seqnos);
                     stopwatch_start(IF_STATUS_MGR_RUN_STOPWATCH_NAME,
                                     time_msec());
                     if_status_mgr_run(if_mgr, binding_data, chassis,
@@ -6162,8 +7534,10 @@ main(int argc, char *argv[])
         }
 
         unixctl_server_run(unixctl);
+        sliced_reply_run(engine_has_updated());
 
         unixctl_server_wait(unixctl);
+        sliced_reply_wait();
         if (exit_args.exiting || pending_pkt.conn) {
             poll_immediate_wake();
         }
@@ -6205,12 +7579,27 @@ main(int argc, char *argv[])
             OVS_NOT_REACHED();
         }
 
+        if (!pinctrl_ran) {
+            /* pinctrl_run() didn't see the SB changes tracked in this
+             * iteration. */
+            pinctrl_force_resync();
+        }
+        if (ovnsb_recorder) {
+            ovn_idl_recorder_run(ovnsb_recorder);
+        }
         ovsdb_idl_track_clear(ovnsb_idl_loop.idl);
         ovsdb_idl_track_clear(ovs_idl_loop.idl);
 
         lflow_cache_run(ctrl_engine_ctx.lflow_cache);
         lflow_cache_wait(ctrl_engine_ctx.lflow_cache);
 
+        /* The saved lflow cache entries that weren't needed during the
+         * initial sync with the SB DB are stale. */
+        if (lflow_cache_has_saved(ctrl_engine_ctx.lflow_cache)
+            && !daemon_started_recently()) {
+            lflow_cache_drop_saved(ctrl_engine_ctx.lflow_cache);
+        }
+
 loop_done:
         memory_wait();
         poll_block();
@@ -6219,8 +7608,14 @@ loop_done:
         }
     }
 
+    if (lflow_cache_file) {
+        lflow_save_cache(ctrl_engine_ctx.lflow_cache, lflow_cache_file);
+    }
+
+    sliced_reply_cancel_all("exiting");
     engine_set_context(NULL);
     engine_cleanup();
+    sset_destroy(&tunnel_peers);
 
     /* It's time to exit.  Clean up the databases if we are not restarting */
     if (!exit_args.restart) {
@@ -6280,6 +7675,7 @@ loop_done:
     ofctrl_destroy();
     pinctrl_destroy();
     binding_destroy();
+    bfd_destroy();
     patch_destroy();
     mirror_destroy();
     encaps_destroy();
@@ -6289,6 +7685,7 @@ loop_done:
     shash_destroy(&vif_plug_changed_iface_ids);
     vif_plug_provider_destroy_all();
 
+    ovn_idl_recorder_destroy(ovnsb_recorder);
     ovsdb_idl_loop_destroy(&ovs_idl_loop);
     ovsdb_idl_loop_destroy(&ovnsb_idl_loop);
 
@@ -6297,6 +7694,8 @@ loop_done:
     free(ovs_remote);
     free(file_system_id);
     free(cli_system_id);
+    free(lflow_cache_file);
+    free(ovnsb_record_file);
     ovn_exit_args_finish(&exit_args);
     unixctl_server_destroy(unixctl);
     service_stop();
@@ -6316,6 +7715,9 @@ parse_options(int argc, char *argv[])
         OVN_DAEMON_OPTION_ENUMS,
         SSL_OPTION_ENUMS,
         OPT_ENABLE_DUMMY_VIF_PLUG,
+        OPT_LFLOW_CACHE_FILE,
+        OPT_OVNSB_RECORD,
+        OPT_HUGE_PAGES,
     };
 
     static struct option long_options[] = {
@@ -6329,6 +7731,9 @@ parse_options(int argc, char *argv[])
         {"chassis", required_argument, NULL, 'n'},
         {"enable-dummy-vif-plug", no_argument, NULL,
          OPT_ENABLE_DUMMY_VIF_PLUG},
+        {"lflow-cache-file", required_argument, NULL, OPT_LFLOW_CACHE_FILE},
+        {"ovnsb-record", required_argument, NULL, OPT_OVNSB_RECORD},
+        {"huge-pages", no_argument, NULL, OPT_HUGE_PAGES},
         {NULL, 0, NULL, 0}
     };
     char *short_options = ovs_cmdl_long_options_to_short_options(long_options);
@@ -6385,6 +7790,20 @@ parse_options(int argc, char *argv[])
             vif_plug_dummy_enable();
             break;
 
+        case OPT_LFLOW_CACHE_FILE:
+            free(lflow_cache_file);
+            lflow_cache_file = abs_file_name(NULL, optarg);
+            break;
+
+        case OPT_OVNSB_RECORD:
+            free(ovnsb_record_file);
+            ovnsb_record_file = abs_file_name(NULL, optarg);
+            break;
+
+        case OPT_HUGE_PAGES:
+            ovn_slab_enable(true);
+            break;
+
         case 'n':
             free(cli_system_id);
             cli_system_id = xstrdup(optarg);
@@ -6426,32 +7845,66 @@ usage(void)
     vlog_usage();
     printf("\nOther options:\n"
            "  -n                      custom chassis name\n"
+           "  --lflow-cache-file=FILE save the lflow cache to FILE on exit\n"
+           "                          and restore it from FILE on start\n"
+           "  --ovnsb-record=FILE     record the updates received from the\n"
+           "                          SB database to FILE\n"
+           "  --huge-pages            allocate the flow tables and the lflow\n"
+           "                          cache entries from huge pages\n"
            "  -h, --help              display this help message\n"
            "  -V, --version           display version information\n");
     exit(EXIT_SUCCESS);
 }
 
-static void
-ct_zone_list(struct unixctl_conn *conn, int argc OVS_UNUSED,
-             const char *argv[] OVS_UNUSED, void *ct_zones_)
+static bool
+ct_zone_list_next(const void *ct_zones_, struct hmap_position *pos,
+                  struct ds *ds)
 {
-    struct simap *ct_zones = ct_zones_;
-    struct ds ds = DS_EMPTY_INITIALIZER;
-    struct simap_node *zone;
+    const struct simap *ct_zones = ct_zones_;
+    struct hmap_node *node = hmap_at_position(&ct_zones->map, pos);
+    if (!node) {
+        return false;
+    }
+    if (ds) {
+        const struct simap_node *zone =
+            CONTAINER_OF(node, struct simap_node, node);
+        ds_put_format(ds, "%s %d\n", zone->name, zone->data);
+    }
+    return true;
+}
 
-    SIMAP_FOR_EACH(zone, ct_zones) {
-        ds_put_format(&ds, "%s %d\n", zone->name, zone->data);
+static const struct sliced_reply_class ct_zone_list_class = {
+    .next = ct_zone_list_next,
+};
+
+static void
+ct_zone_list(struct unixctl_conn *conn, int argc,
+             const char *argv[], void *ct_zones)
+{
+    struct ovn_unixctl_page page;
+    char *error = ovn_unixctl_page_parse(argc, argv, &page);
+    if (error) {
+        unixctl_command_reply_error(conn, error);
+        free(error);
+        return;
     }
 
-    unixctl_command_reply(conn, ds_cstr(&ds));
-    ds_destroy(&ds);
+    sliced_reply_start(conn, &ct_zone_list_class, ct_zones, &page);
 }
 
 static void
-extend_table_list(struct unixctl_conn *conn, int argc OVS_UNUSED,
-                 const char *argv[] OVS_UNUSED, void *extend_table_)
+extend_table_list(struct unixctl_conn *conn, int argc,
+                 const char *argv[], void *extend_table_)
 {
     struct ovn_extend_table *extend_table = extend_table_;
+    struct ovn_unixctl_page page;
+    char *error = ovn_unixctl_page_parse(argc, argv, &page);
+    if (error) {
+        unixctl_command_reply_error(conn, error);
+        free(error);
+        return;
+    }
+
     struct ds ds = DS_EMPTY_INITIALIZER;
     struct simap items = SIMAP_INITIALIZER(&items);
 
@@ -6462,7 +7915,8 @@ extend_table_list(struct unixctl_conn *conn, int argc OVS_UNUSED,
 
     const struct simap_node **nodes = simap_sort(&items);
     size_t n_nodes = simap_count(&items);
-    for (size_t i = 0; i < n_nodes; i++) {
+    for (size_t i = page.offset; i < n_nodes && i - page.offset < page.limit;
+         i++) {
         const struct simap_node *node = nodes[i];
         ds_put_format(&ds, "%s: %d\n", node->name, node->data);
     }
@@ -6522,6 +7976,85 @@ lflow_cache_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
     ds_destroy(&ds);
 }
 
+static void
+lflow_cost_enable_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                      const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    lflow_cost_enable(true);
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+lflow_cost_disable_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                       const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    lflow_cost_enable(false);
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+lflow_cost_show_cmd(struct unixctl_conn *conn, int argc, const char *argv[],
+                    void *ovnsb_idl_)
+{
+    struct ovsdb_idl *ovnsb_idl = ovnsb_idl_;
+    unsigned int n = 10;
+
+    if (argc > 1 && !str_to_uint(argv[1], 10, &n)) {
+        unixctl_command_reply_error(conn, "invalid N");
+        return;
+    }
+
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    lflow_cost_format(sbrec_logical_flow_table_get(ovnsb_idl), n, &ds);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+if_status_show_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *if_mgr_)
+{
+    struct if_status_mgr *if_mgr = if_mgr_;
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    if_status_mgr_format_stats(if_mgr, &ds);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+if_status_clear_stats_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[] OVS_UNUSED, void *if_mgr_)
+{
+    struct if_status_mgr *if_mgr = if_mgr_;
+
+    if_status_mgr_clear_stats(if_mgr);
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+nb_cfg_show_latency_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                        const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ds_put_cstr(&ds, "nb_cfg latency:\n");
+    for (size_t i = 0; i < NB_CFG_N_STAGES; i++) {
+        ovn_latency_format(&nb_cfg_latency.latency[i], nb_cfg_stage_names[i],
+                           &ds);
+    }
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+nb_cfg_clear_latency_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    memset(nb_cfg_latency.latency, 0, sizeof nb_cfg_latency.latency);
+    unixctl_command_reply(conn, NULL);
+}
+
 static void
 cluster_state_reset_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
                const char *argv[] OVS_UNUSED, void *idl_reset_)
@@ -6601,13 +8134,18 @@ debug_dump_local_bindings(struct unixctl_conn *conn, int argc OVS_UNUSED,
 }
 
 static void
-debug_dump_lflow_conj_ids(struct unixctl_conn *conn, int argc OVS_UNUSED,
-                          const char *argv[] OVS_UNUSED, void *conj_ids)
-{
-    struct ds conj_ids_dump = DS_EMPTY_INITIALIZER;
-    lflow_conj_ids_dump(conj_ids, &conj_ids_dump);
-    unixctl_command_reply(conn, ds_cstr(&conj_ids_dump));
-    ds_destroy(&conj_ids_dump);
+debug_dump_lflow_conj_ids(struct unixctl_conn *conn, int argc,
+                          const char *argv[], void *conj_ids)
+{
+    struct ovn_unixctl_page page;
+    char *error = ovn_unixctl_page_parse(argc, argv, &page);
+    if (error) {
+        unixctl_command_reply_error(conn, error);
+        free(error);
+        return;
+    }
+
+    sliced_reply_start(conn, &lflow_conj_ids_dump_class, conj_ids, &page);
 }
 
 static void
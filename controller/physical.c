@@ -14,6 +14,7 @@
  */
 
 #include <config.h>
+#include <netinet/icmp6.h>
 #include "binding.h"
 #include "coverage.h"
 #include "byte-order.h"
@@ -25,9 +26,12 @@
 #include "lport.h"
 #include "chassis.h"
 #include "lib/bundle.h"
+#include "lib/extend-table.h"
+#include "lib/hmapx.h"
 #include "openvswitch/poll-loop.h"
 #include "lib/uuid.h"
 #include "ofctrl.h"
+#include "openvswitch/dynamic-string.h"
 #include "openvswitch/list.h"
 #include "openvswitch/hmap.h"
 #include "openvswitch/match.h"
@@ -1474,6 +1478,93 @@ enforce_tunneling_for_multichassis_ports(
     free(tuns);
 }
 
+static void
+put_arp_nd_rsp_lookup_flow(const struct sbrec_port_binding *binding,
+                           struct match *match, const struct ofpbuf *ofpacts,
+                           struct ovn_desired_flow_table *flow_table)
+{
+    ofctrl_add_flow(flow_table, OFTABLE_ARP_ND_RSP_LOOKUP, 100,
+                    binding->header_.uuid.parts[0], match, ofpacts,
+                    &binding->header_.uuid);
+
+    /* Do not reply to the requests sent by the port that owns the address,
+     * e.g. for duplicate address detection, they are forwarded instead. */
+    struct ofpbuf no_hit;
+    ofpbuf_init(&no_hit, 0);
+    match_set_reg(match, MFF_LOG_INPORT - MFF_REG0, binding->tunnel_key);
+    ofctrl_add_flow(flow_table, OFTABLE_ARP_ND_RSP_LOOKUP, 110,
+                    binding->header_.uuid.parts[0], match, &no_hit,
+                    &binding->header_.uuid);
+    ofpbuf_uninit(&no_hit);
+}
+
+/* Table 81, priority 100 and 110.
+ * ===============================
+ *
+ * Looks up the target addresses of ARP requests and IPv6 neighbor
+ * solicitations for the lookup_arp_nd_rsp() action.  For each address of
+ * a port binding with the "arp_nd_rsp_lookup" option, stores its MAC
+ * address in eth.dst and sets MLF_LOOKUP_MAC_BIT. */
+static void
+put_arp_nd_rsp_lookup_flows(const struct sbrec_port_binding *binding,
+                            struct ovn_desired_flow_table *flow_table)
+{
+    if (!smap_get_bool(&binding->options, "arp_nd_rsp_lookup", false)) {
+        return;
+    }
+
+    uint32_t dp_key = binding->datapath->tunnel_key;
+    struct ofpbuf ofpacts;
+    ofpbuf_init(&ofpacts, 0);
+
+    for (size_t i = 0; i < binding->n_mac; i++) {
+        struct lport_addresses laddrs;
+        if (!extract_lsp_addresses(binding->mac[i], &laddrs)) {
+            continue;
+        }
+
+        ofpbuf_clear(&ofpacts);
+        put_load(eth_addr_to_uint64(laddrs.ea), MFF_ETH_DST, 0, 48,
+                 &ofpacts);
+        put_load(1, MFF_LOG_FLAGS, MLF_LOOKUP_MAC_BIT, 1, &ofpacts);
+
+        struct match match;
+        for (size_t j = 0; j < laddrs.n_ipv4_addrs; j++) {
+            match_init_catchall(&match);
+            match_set_metadata(&match, htonll(dp_key));
+            match_set_dl_type(&match, htons(ETH_TYPE_ARP));
+            match_set_nw_proto(&match, ARP_OP_REQUEST);
+            match_set_nw_dst(&match, laddrs.ipv4_addrs[j].addr);
+            put_arp_nd_rsp_lookup_flow(binding, &match, &ofpacts,
+                                       flow_table);
+        }
+
+        /* Solicitations are sent either to the unicast address or to its
+         * solicited-node multicast address. */
+        for (size_t j = 0; j < laddrs.n_ipv6_addrs; j++) {
+            const struct in6_addr *ip6_dsts[] = {
+                &laddrs.ipv6_addrs[j].addr,
+                &laddrs.ipv6_addrs[j].sn_addr,
+            };
+
+            for (size_t k = 0; k < ARRAY_SIZE(ip6_dsts); k++) {
+                match_init_catchall(&match);
+                match_set_metadata(&match, htonll(dp_key));
+                match_set_dl_type(&match, htons(ETH_TYPE_IPV6));
+                match_set_nw_proto(&match, IPPROTO_ICMPV6);
+                match_set_icmp_type(&match, ND_NEIGHBOR_SOLICIT);
+                match_set_icmp_code(&match, 0);
+                match_set_nd_target(&match, &laddrs.ipv6_addrs[j].addr);
+                match_set_ipv6_dst(&match, ip6_dsts[k]);
+                put_arp_nd_rsp_lookup_flow(binding, &match, &ofpacts,
+                                           flow_table);
+            }
+        }
+        destroy_lport_addresses(&laddrs);
+    }
+    ofpbuf_uninit(&ofpacts);
+}
+
 static void
 consider_port_binding(struct ovsdb_idl_index *sbrec_port_binding_by_name,
                       enum mf_field_id mff_ovn_geneve,
@@ -1489,6 +1580,7 @@ consider_port_binding(struct ovsdb_idl_index *sbrec_port_binding_by_name,
                       const struct if_status_mgr *if_mgr,
                       size_t n_encap_ips,
                       const char **encap_ips,
+                      const struct lazy_datapaths *lazy_dps,
                       struct ovn_desired_flow_table *flow_table,
                       struct ofpbuf *ofpacts_p)
 {
@@ -1499,6 +1591,8 @@ consider_port_binding(struct ovsdb_idl_index *sbrec_port_binding_by_name,
         return;
     }
 
+    put_arp_nd_rsp_lookup_flows(binding, flow_table);
+
     if (get_lport_type(binding) == LP_VIF) {
         /* Table 80, priority 100.
          * =======================
@@ -1551,6 +1645,10 @@ consider_port_binding(struct ovsdb_idl_index *sbrec_port_binding_by_name,
         for (int i = 0; i < MFF_N_LOG_REGS; i++) {
             put_load(0, MFF_LOG_REG0 + i, 0, 32, ofpacts_p);
         }
+        if (lazy_datapath_is_candidate(lazy_dps, binding, peer->datapath)) {
+            /* The peer switch may be installed on demand. */
+            put_resubmit(OFTABLE_LAZY_DP_USE, ofpacts_p);
+        }
         put_resubmit(OFTABLE_LOG_INGRESS_PIPELINE, ofpacts_p);
         clone = ofpbuf_at_assert(ofpacts_p, clone_ofs, sizeof *clone);
         ofpacts_p->header = clone;
@@ -2043,6 +2141,88 @@ fanout_to_chassis(enum mf_field_id mff_ovn_geneve,
     }
 }
 
+static int
+compare_ofp_ports(const void *a_, const void *b_)
+{
+    ofp_port_t a = *(const ofp_port_t *) a_;
+    ofp_port_t b = *(const ofp_port_t *) b_;
+
+    return ofp_to_u16(a) < ofp_to_u16(b) ? -1 : ofp_to_u16(a) > ofp_to_u16(b);
+}
+
+/* Same as fanout_to_chassis() but, for each encapsulation type, sets up the
+ * encapsulation once and outputs to the tunnels through an OpenFlow group of
+ * type "all".  The group only depends on the set of tunnel ports, so it is
+ * shared by all the multicast groups, of any datapath, that flood to the
+ * same chassis, and a change of the remote chassis only updates a group and
+ * flows that reference it instead of every flow that outputs to them. */
+static void
+fanout_to_chassis_by_group(enum mf_field_id mff_ovn_geneve,
+                           struct sset *remote_chassis,
+                           const struct hmap *chassis_tunnels,
+                           const struct sbrec_datapath_binding *datapath,
+                           uint16_t outport, bool is_ramp_switch,
+                           struct ovn_extend_table *group_table,
+                           const struct uuid *mc_uuid,
+                           struct ofpbuf *remote_ofpacts)
+{
+    static const enum chassis_tunnel_type tunnel_types[] = {
+        GENEVE, STT, VXLAN,
+    };
+    ofp_port_t *ofports = xmalloc(sset_count(remote_chassis)
+                                  * sizeof *ofports);
+
+    for (size_t i = 0; i < ARRAY_SIZE(tunnel_types); i++) {
+        const struct chassis_tunnel *type_tun = NULL;
+        size_t n_ofports = 0;
+
+        const char *chassis_name;
+        SSET_FOR_EACH (chassis_name, remote_chassis) {
+            const struct chassis_tunnel *tun
+                = chassis_tunnel_find(chassis_tunnels, chassis_name,
+                                      NULL, NULL);
+            if (tun && tun->type == tunnel_types[i]) {
+                ofports[n_ofports++] = tun->ofport;
+                type_tun = tun;
+            }
+        }
+        if (!n_ofports) {
+            continue;
+        }
+
+        put_encapsulation(mff_ovn_geneve, type_tun, datapath, outport,
+                          is_ramp_switch, remote_ofpacts);
+
+        uint32_t group_id = EXT_TABLE_ID_INVALID;
+        if (n_ofports > 1) {
+            /* Sort the ports so that the group name, and thus the group, is
+             * the same for identical sets of chassis. */
+            qsort(ofports, n_ofports, sizeof *ofports, compare_ofp_ports);
+
+            struct ds group = DS_EMPTY_INITIALIZER;
+            ds_put_cstr(&group, "type=all");
+            for (size_t j = 0; j < n_ofports; j++) {
+                ds_put_format(&group, ",bucket=actions=output:%"PRIu16,
+                              ofp_to_u16(ofports[j]));
+            }
+            group_id = ovn_extend_table_assign_id(group_table,
+                                                  ds_cstr(&group), *mc_uuid);
+            ds_destroy(&group);
+        }
+
+        if (group_id != EXT_TABLE_ID_INVALID) {
+            ofpact_put_GROUP(remote_ofpacts)->group_id = group_id;
+        } else {
+            /* Either there is a single tunnel or the group table is full. */
+            for (size_t j = 0; j < n_ofports; j++) {
+                ofpact_put_OUTPUT(remote_ofpacts)->port = ofports[j];
+            }
+        }
+    }
+
+    free(ofports);
+}
+
 static bool
 chassis_is_vtep(const struct sbrec_chassis *chassis)
 {
@@ -2117,6 +2297,7 @@ consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
                   const struct sbrec_chassis *chassis,
                   const struct sbrec_multicast_group *mc,
                   const struct hmap *chassis_tunnels,
+                  struct ovn_extend_table *group_table,
                   struct ovn_desired_flow_table *flow_table)
 {
     uint32_t dp_key = mc->datapath->tunnel_key;
@@ -2256,10 +2437,22 @@ consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
         put_load(mc->tunnel_key, MFF_LOG_OUTPORT, 0, 32, &ofpacts_last);
     }
 
-    fanout_to_chassis(mff_ovn_geneve, &remote_chassis, chassis_tunnels,
-                      mc->datapath, mc->tunnel_key, false, &ofpacts_last);
-    fanout_to_chassis(mff_ovn_geneve, &vtep_chassis, chassis_tunnels,
-                      mc->datapath, mc->tunnel_key, true, &ofpacts_last);
+    if (group_table) {
+        fanout_to_chassis_by_group(mff_ovn_geneve, &remote_chassis,
+                                   chassis_tunnels, mc->datapath,
+                                   mc->tunnel_key, false, group_table,
+                                   &mc->header_.uuid, &ofpacts_last);
+        fanout_to_chassis_by_group(mff_ovn_geneve, &vtep_chassis,
+                                   chassis_tunnels, mc->datapath,
+                                   mc->tunnel_key, true, group_table,
+                                   &mc->header_.uuid, &ofpacts_last);
+    } else {
+        fanout_to_chassis(mff_ovn_geneve, &remote_chassis, chassis_tunnels,
+                          mc->datapath, mc->tunnel_key, false,
+                          &ofpacts_last);
+        fanout_to_chassis(mff_ovn_geneve, &vtep_chassis, chassis_tunnels,
+                          mc->datapath, mc->tunnel_key, true, &ofpacts_last);
+    }
 
     remote_ports |= (ofpacts_last.size > 0);
     if (remote_ports && local_ports) {
@@ -2337,6 +2530,151 @@ consider_mc_group(struct ovsdb_idl_index *sbrec_port_binding_by_name,
     sset_destroy(&vtep_chassis);
 }
 
+/* Stores in 'uuid' the UUID used for the table 0 flows of the tunnels to
+ * 'chassis_name', so that they can be replaced without recomputing the flows
+ * of the other tunnels. */
+static void
+get_chassis_tunnel_flow_uuid(const char *chassis_name, struct uuid *uuid)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(uuid->parts); i++) {
+        uuid->parts[i] = hash_string(chassis_name, hc_uuid->parts[i]);
+    }
+}
+
+/* Adds the table 0 flows that process the packets received on 'tun'. */
+static void
+put_chassis_tunnel_flows(const struct physical_ctx *p_ctx,
+                         const struct chassis_tunnel *tun,
+                         struct ofpbuf *ofpacts,
+                         struct ovn_desired_flow_table *flow_table)
+{
+    char *chassis_name = NULL;
+    if (!encaps_tunnel_id_parse(tun->chassis_id, &chassis_name, NULL, NULL)) {
+        return;
+    }
+
+    struct uuid tun_uuid;
+    get_chassis_tunnel_flow_uuid(chassis_name, &tun_uuid);
+
+    /* Add flows for Geneve, STT and VXLAN encapsulations.  Geneve and STT
+     * encapsulations have metadata about the ingress and egress logical ports.
+     * VXLAN encapsulations have metadata about the egress logical port only.
+     * We set MFF_LOG_DATAPATH, MFF_LOG_INPORT, and MFF_LOG_OUTPORT from the
+     * tunnel key data where possible, then resubmit to table 40 to handle
+     * packets to the local hypervisor. */
+    struct match match = MATCH_CATCHALL_INITIALIZER;
+    match_set_in_port(&match, tun->ofport);
+
+    ofpbuf_clear(ofpacts);
+    if (tun->type == GENEVE) {
+        put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, ofpacts);
+        put_move(p_ctx->mff_ovn_geneve, 16, MFF_LOG_INPORT, 0, 15, ofpacts);
+        put_move(p_ctx->mff_ovn_geneve, 0, MFF_LOG_OUTPORT, 0, 16, ofpacts);
+    } else if (tun->type == STT) {
+        put_move(MFF_TUN_ID, 40, MFF_LOG_INPORT,   0, 15, ofpacts);
+        put_move(MFF_TUN_ID, 24, MFF_LOG_OUTPORT,  0, 16, ofpacts);
+        put_move(MFF_TUN_ID,  0, MFF_LOG_DATAPATH, 0, 24, ofpacts);
+    } else if (tun->type == VXLAN) {
+        /* Add flows for non-VTEP tunnels. Split VNI into two 12-bit
+         * sections and use them for datapath and outport IDs. */
+        put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 12, ofpacts);
+        put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, ofpacts);
+    } else {
+        OVS_NOT_REACHED();
+    }
+
+    put_resubmit(OFTABLE_LOCAL_OUTPUT, ofpacts);
+    ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 100, 0, &match,
+                    ofpacts, &tun_uuid);
+
+    /* Set allow rx from tunnel bit. */
+    put_load(1, MFF_LOG_FLAGS, MLF_RX_FROM_TUNNEL_BIT, 1, ofpacts);
+
+    /* Add specif flows for E/W ICMPv{4,6} packets if tunnelled packets
+     * do not fit path MTU.
+     */
+    put_resubmit(OFTABLE_CT_ZONE_LOOKUP, ofpacts);
+
+    /* IPv4 */
+    match_init_catchall(&match);
+    match_set_in_port(&match, tun->ofport);
+    match_set_dl_type(&match, htons(ETH_TYPE_IP));
+    match_set_nw_proto(&match, IPPROTO_ICMP);
+    match_set_icmp_type(&match, 3);
+    match_set_icmp_code(&match, 4);
+
+    ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 120, 0, &match,
+                    ofpacts, &tun_uuid);
+    /* IPv6 */
+    match_init_catchall(&match);
+    match_set_in_port(&match, tun->ofport);
+    match_set_dl_type(&match, htons(ETH_TYPE_IPV6));
+    match_set_nw_proto(&match, IPPROTO_ICMPV6);
+    match_set_icmp_type(&match, 2);
+    match_set_icmp_code(&match, 0);
+
+    ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 120, 0, &match,
+                    ofpacts, &tun_uuid);
+
+    if (tun->type != VXLAN) {
+        free(chassis_name);
+        return;
+    }
+
+    /* Add VXLAN specific rules to transform port keys
+     * from 12 bits to 16 bits used elsewhere. */
+    ofpbuf_clear(ofpacts);
+
+    match_init_catchall(&match);
+    match_set_in_port(&match, tun->ofport);
+    ovs_be64 mcast_bits = htonll((OVN_VXLAN_MIN_MULTICAST << 12));
+    match_set_tun_id_masked(&match, mcast_bits, mcast_bits);
+
+    put_load(1, MFF_LOG_OUTPORT, 15, 1, ofpacts);
+    put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 11, ofpacts);
+    put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, ofpacts);
+    put_resubmit(OFTABLE_LOCAL_OUTPUT, ofpacts);
+
+    ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 105, 0,
+                    &match, ofpacts, &tun_uuid);
+
+    /* Handle ramp switch encapsulations. */
+    const struct sbrec_port_binding *binding;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (binding, p_ctx->port_binding_table) {
+        if (strcmp(binding->type, "vtep")) {
+            continue;
+        }
+
+        if (!binding->chassis ||
+            strcmp(binding->chassis->name, chassis_name)) {
+            continue;
+        }
+
+        match_init_catchall(&match);
+        match_set_in_port(&match, tun->ofport);
+        ofpbuf_clear(ofpacts);
+
+        /* Add flows for ramp switches.  The VNI is used to populate
+         * MFF_LOG_DATAPATH.  The gateway's logical port is set to
+         * MFF_LOG_INPORT.  Then the packet is resubmitted to table 8
+         * to determine the logical egress port. */
+        match_set_tun_id(&match, htonll(binding->datapath->tunnel_key));
+
+        put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, ofpacts);
+        put_load(binding->tunnel_key, MFF_LOG_INPORT, 0, 15, ofpacts);
+        /* For packets received from a ramp tunnel, set a flag to that
+         * effect. */
+        put_load(1, MFF_LOG_FLAGS, MLF_RCV_FROM_RAMP_BIT, 1, ofpacts);
+        put_resubmit(OFTABLE_LOG_INGRESS_PIPELINE, ofpacts);
+
+        ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 110,
+                        binding->header_.uuid.parts[0],
+                        &match, ofpacts, &tun_uuid);
+    }
+
+    free(chassis_name);
+}
+
 static void
 physical_eval_port_binding(struct physical_ctx *p_ctx,
                            const struct sbrec_port_binding *pb,
@@ -2355,6 +2693,7 @@ physical_eval_port_binding(struct physical_ctx *p_ctx,
                           p_ctx->if_mgr,
                           p_ctx->n_encap_ips,
                           p_ctx->encap_ips,
+                          p_ctx->lazy_dps,
                           flow_table, &ofpacts);
     ofpbuf_uninit(&ofpacts);
 }
@@ -2416,6 +2755,11 @@ physical_handle_flows_for_lport(const struct sbrec_port_binding *pb,
 
     if (!removed) {
         physical_eval_port_binding(p_ctx, pb, flow_table);
+        if (p_ctx->if_mgr
+            && if_status_mgr_iface_is_installing(p_ctx->if_mgr,
+                                                 pb->logical_port)) {
+            ofctrl_prioritize_flows(flow_table, &pb->header_.uuid);
+        }
         if (!strcmp(pb->type, "patch")) {
             const struct sbrec_port_binding *peer =
                 get_binding_peer(p_ctx->sbrec_port_binding_by_name, pb);
@@ -2446,9 +2790,137 @@ physical_handle_mc_group_changes(struct physical_ctx *p_ctx,
                               p_ctx->patch_ofports,
                               p_ctx->chassis, mc,
                               p_ctx->chassis_tunnels,
-                              flow_table);
+                              p_ctx->group_table, flow_table);
+        }
+    }
+}
+
+/* Returns true if the flows of 'pb' may send packets through a tunnel to one
+ * of the chassis in 'chassis_names'.  Ports bound to a HA chassis group are
+ * always considered, because the references of their HA_Chassis rows to a
+ * removed chassis are already gone. */
+static bool
+port_binding_uses_chassis(const struct sbrec_port_binding *pb,
+                          const struct sset *chassis_names)
+{
+    if (pb->chassis && sset_contains(chassis_names, pb->chassis->name)) {
+        return true;
+    }
+    for (size_t i = 0; i < pb->n_additional_chassis; i++) {
+        if (sset_contains(chassis_names, pb->additional_chassis[i]->name)) {
+            return true;
         }
     }
+    return pb->ha_chassis_group && pb->ha_chassis_group->n_ha_chassis;
+}
+
+/* Handles the addition, removal or update of the tunnels to the chassis in
+ * 'changed_chassis' by replacing their table 0 flows and reconsidering the
+ * port bindings and multicast groups that may output to them. */
+void
+physical_handle_chassis_tunnel_changes(
+    struct physical_ctx *p_ctx, const struct sset *changed_chassis,
+    struct ovn_desired_flow_table *flow_table)
+{
+    struct ofpbuf ofpacts;
+    ofpbuf_init(&ofpacts, 0);
+
+    const char *chassis_name;
+    SSET_FOR_EACH (chassis_name, changed_chassis) {
+        struct uuid tun_uuid;
+        get_chassis_tunnel_flow_uuid(chassis_name, &tun_uuid);
+        ofctrl_remove_flows(flow_table, &tun_uuid);
+
+        struct chassis_tunnel *tun;
+        HMAP_FOR_EACH_WITH_HASH (tun, hmap_node, hash_string(chassis_name, 0),
+                                 p_ctx->chassis_tunnels) {
+            if (encaps_tunnel_id_match(tun->chassis_id, chassis_name,
+                                       NULL, NULL)) {
+                put_chassis_tunnel_flows(p_ctx, tun, &ofpacts, flow_table);
+            }
+        }
+    }
+    ofpbuf_uninit(&ofpacts);
+
+    const struct sbrec_port_binding *pb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (pb, p_ctx->port_binding_table) {
+        if (port_binding_uses_chassis(pb, changed_chassis)) {
+            ofctrl_remove_flows(flow_table, &pb->header_.uuid);
+            physical_eval_port_binding(p_ctx, pb, flow_table);
+        }
+    }
+
+    const struct sbrec_multicast_group *mc;
+    SBREC_MULTICAST_GROUP_TABLE_FOR_EACH (mc, p_ctx->mc_group_table) {
+        for (size_t i = 0; i < mc->n_ports; i++) {
+            if (port_binding_uses_chassis(mc->ports[i], changed_chassis)) {
+                ofctrl_remove_flows(flow_table, &mc->header_.uuid);
+                consider_mc_group(p_ctx->sbrec_port_binding_by_name,
+                                  p_ctx->mff_ovn_geneve, p_ctx->ct_zones,
+                                  p_ctx->local_datapaths,
+                                  p_ctx->local_bindings,
+                                  p_ctx->patch_ofports,
+                                  p_ctx->chassis, mc,
+                                  p_ctx->chassis_tunnels,
+                                  p_ctx->group_table, flow_table);
+                break;
+            }
+        }
+    }
+}
+
+/* Table 82, priority 100 and 0.
+ * =============================
+ *
+ * Packets that enter a peer switch installed on demand, see struct
+ * lazy_datapaths, go through this table.  They are sent to ovn-controller,
+ * which buffers them until the switch is installed, if it isn't installed
+ * yet.  Otherwise the flows of the active switches count their packets,
+ * which tells ovn-controller when they become idle. */
+static void
+put_lazy_dp_use_flows(const struct physical_ctx *p_ctx,
+                      struct ofpbuf *ofpacts,
+                      struct ovn_desired_flow_table *flow_table)
+{
+    if (!p_ctx->lazy_dps || !p_ctx->lazy_dps->enabled) {
+        return;
+    }
+
+    struct match match;
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH (node, p_ctx->lazy_peer_dps) {
+        const struct sbrec_datapath_binding *dp = node->data;
+
+        match_init_catchall(&match);
+        match_set_metadata(&match, htonll(dp->tunnel_key));
+        ofpbuf_clear(ofpacts);
+        size_t ofs = encode_start_controller_op(
+            ACTION_OPCODE_ACTIVATE_DATAPATH, true, NX_CTLR_NO_METER, ofpacts);
+        encode_finish_controller_op(ofs, ofpacts);
+        ofctrl_add_flow(flow_table, OFTABLE_LAZY_DP_USE, 100,
+                        dp->header_.uuid.parts[0], &match, ofpacts,
+                        &dp->header_.uuid);
+    }
+
+    const struct local_datapath *ld;
+    HMAP_FOR_EACH (ld, hmap_node, p_ctx->local_datapaths) {
+        if (!lazy_datapath_is_active(p_ctx->lazy_dps,
+                                     ld->datapath->tunnel_key)) {
+            continue;
+        }
+
+        match_init_catchall(&match);
+        match_set_metadata(&match, htonll(ld->datapath->tunnel_key));
+        ofpbuf_clear(ofpacts);
+        ofctrl_add_flow(flow_table, OFTABLE_LAZY_DP_USE, 100,
+                        ld->datapath->header_.uuid.parts[0], &match, ofpacts,
+                        &ld->datapath->header_.uuid);
+    }
+
+    match_init_catchall(&match);
+    ofpbuf_clear(ofpacts);
+    ofctrl_add_flow(flow_table, OFTABLE_LAZY_DP_USE, 0, 0, &match, ofpacts,
+                    hc_uuid);
 }
 
 void
@@ -2482,9 +2954,12 @@ physical_run(struct physical_ctx *p_ctx,
                               p_ctx->if_mgr,
                               p_ctx->n_encap_ips,
                               p_ctx->encap_ips,
+                              p_ctx->lazy_dps,
                               flow_table, &ofpacts);
     }
 
+    put_lazy_dp_use_flows(p_ctx, &ofpacts, flow_table);
+
     /* Default flow for CT_ZONE_LOOKUP Table. */
     struct match ct_look_def_match;
     match_init_catchall(&ct_look_def_match);
@@ -2501,140 +2976,17 @@ physical_run(struct physical_ctx *p_ctx,
                           p_ctx->local_datapaths, p_ctx->local_bindings,
                           p_ctx->patch_ofports, p_ctx->chassis,
                           mc, p_ctx->chassis_tunnels,
-                          flow_table);
+                          p_ctx->group_table, flow_table);
     }
 
-    /* Table 0, priority 100.
-     * ======================
+    /* Table 0, priority 100, 105, 110 and 120.
+     * ========================================
      *
      * Process packets that arrive from a remote hypervisor (by matching
      * on tunnel in_port). */
-
-    /* Add flows for Geneve, STT and VXLAN encapsulations.  Geneve and STT
-     * encapsulations have metadata about the ingress and egress logical ports.
-     * VXLAN encapsulations have metadata about the egress logical port only.
-     * We set MFF_LOG_DATAPATH, MFF_LOG_INPORT, and MFF_LOG_OUTPORT from the
-     * tunnel key data where possible, then resubmit to table 40 to handle
-     * packets to the local hypervisor. */
     struct chassis_tunnel *tun;
     HMAP_FOR_EACH (tun, hmap_node, p_ctx->chassis_tunnels) {
-        struct match match = MATCH_CATCHALL_INITIALIZER;
-        match_set_in_port(&match, tun->ofport);
-
-        ofpbuf_clear(&ofpacts);
-        if (tun->type == GENEVE) {
-            put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, &ofpacts);
-            put_move(p_ctx->mff_ovn_geneve, 16, MFF_LOG_INPORT, 0, 15,
-                     &ofpacts);
-            put_move(p_ctx->mff_ovn_geneve, 0, MFF_LOG_OUTPORT, 0, 16,
-                     &ofpacts);
-        } else if (tun->type == STT) {
-            put_move(MFF_TUN_ID, 40, MFF_LOG_INPORT,   0, 15, &ofpacts);
-            put_move(MFF_TUN_ID, 24, MFF_LOG_OUTPORT,  0, 16, &ofpacts);
-            put_move(MFF_TUN_ID,  0, MFF_LOG_DATAPATH, 0, 24, &ofpacts);
-        } else if (tun->type == VXLAN) {
-            /* Add flows for non-VTEP tunnels. Split VNI into two 12-bit
-             * sections and use them for datapath and outport IDs. */
-            put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 12, &ofpacts);
-            put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, &ofpacts);
-        } else {
-            OVS_NOT_REACHED();
-        }
-
-        put_resubmit(OFTABLE_LOCAL_OUTPUT, &ofpacts);
-        ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 100, 0, &match,
-                        &ofpacts, hc_uuid);
-
-        /* Set allow rx from tunnel bit. */
-        put_load(1, MFF_LOG_FLAGS, MLF_RX_FROM_TUNNEL_BIT, 1, &ofpacts);
-
-        /* Add specif flows for E/W ICMPv{4,6} packets if tunnelled packets
-         * do not fit path MTU.
-         */
-        put_resubmit(OFTABLE_CT_ZONE_LOOKUP, &ofpacts);
-
-        /* IPv4 */
-        match_init_catchall(&match);
-        match_set_in_port(&match, tun->ofport);
-        match_set_dl_type(&match, htons(ETH_TYPE_IP));
-        match_set_nw_proto(&match, IPPROTO_ICMP);
-        match_set_icmp_type(&match, 3);
-        match_set_icmp_code(&match, 4);
-
-        ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 120, 0, &match,
-                        &ofpacts, hc_uuid);
-        /* IPv6 */
-        match_init_catchall(&match);
-        match_set_in_port(&match, tun->ofport);
-        match_set_dl_type(&match, htons(ETH_TYPE_IPV6));
-        match_set_nw_proto(&match, IPPROTO_ICMPV6);
-        match_set_icmp_type(&match, 2);
-        match_set_icmp_code(&match, 0);
-
-        ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 120, 0, &match,
-                        &ofpacts, hc_uuid);
-    }
-
-    /* Add VXLAN specific rules to transform port keys
-     * from 12 bits to 16 bits used elsewhere. */
-    HMAP_FOR_EACH (tun, hmap_node, p_ctx->chassis_tunnels) {
-        if (tun->type == VXLAN) {
-            ofpbuf_clear(&ofpacts);
-
-            struct match match = MATCH_CATCHALL_INITIALIZER;
-            match_set_in_port(&match, tun->ofport);
-            ovs_be64 mcast_bits = htonll((OVN_VXLAN_MIN_MULTICAST << 12));
-            match_set_tun_id_masked(&match, mcast_bits, mcast_bits);
-
-            put_load(1, MFF_LOG_OUTPORT, 15, 1, &ofpacts);
-            put_move(MFF_TUN_ID, 12, MFF_LOG_OUTPORT,  0, 11, &ofpacts);
-            put_move(MFF_TUN_ID, 0, MFF_LOG_DATAPATH, 0, 12, &ofpacts);
-            put_resubmit(OFTABLE_LOCAL_OUTPUT, &ofpacts);
-
-            ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 105, 0,
-                            &match, &ofpacts, hc_uuid);
-        }
-    }
-
-    /* Handle ramp switch encapsulations. */
-    HMAP_FOR_EACH (tun, hmap_node, p_ctx->chassis_tunnels) {
-        if (tun->type != VXLAN) {
-            continue;
-        }
-
-        SBREC_PORT_BINDING_TABLE_FOR_EACH (binding,
-                                           p_ctx->port_binding_table) {
-            if (strcmp(binding->type, "vtep")) {
-                continue;
-            }
-
-            if (!binding->chassis ||
-                !encaps_tunnel_id_match(tun->chassis_id,
-                                        binding->chassis->name, NULL, NULL)) {
-                continue;
-            }
-
-            struct match match = MATCH_CATCHALL_INITIALIZER;
-            match_set_in_port(&match, tun->ofport);
-            ofpbuf_clear(&ofpacts);
-
-            /* Add flows for ramp switches.  The VNI is used to populate
-             * MFF_LOG_DATAPATH.  The gateway's logical port is set to
-             * MFF_LOG_INPORT.  Then the packet is resubmitted to table 8
-             * to determine the logical egress port. */
-            match_set_tun_id(&match, htonll(binding->datapath->tunnel_key));
-
-            put_move(MFF_TUN_ID, 0,  MFF_LOG_DATAPATH, 0, 24, &ofpacts);
-            put_load(binding->tunnel_key, MFF_LOG_INPORT, 0, 15, &ofpacts);
-            /* For packets received from a ramp tunnel, set a flag to that
-             * effect. */
-            put_load(1, MFF_LOG_FLAGS, MLF_RCV_FROM_RAMP_BIT, 1, &ofpacts);
-            put_resubmit(OFTABLE_LOG_INGRESS_PIPELINE, &ofpacts);
-
-            ofctrl_add_flow(flow_table, OFTABLE_PHY_TO_LOG, 110,
-                            binding->header_.uuid.parts[0],
-                            &match, &ofpacts, hc_uuid);
-        }
+        put_chassis_tunnel_flows(p_ctx, tun, &ofpacts, flow_table);
     }
 
     /* Table 0, priority 0.
@@ -2755,4 +3107,20 @@ physical_run(struct physical_ctx *p_ctx,
     add_default_drop_flow(p_ctx, OFTABLE_LOG_TO_PHY, flow_table);
 
     ofpbuf_uninit(&ofpacts);
+
+    if (p_ctx->if_mgr) {
+        struct sset installing = SSET_INITIALIZER(&installing);
+        const char *iface_id;
+
+        if_status_mgr_get_installing_ifaces(p_ctx->if_mgr, &installing);
+        SSET_FOR_EACH (iface_id, &installing) {
+            const struct sbrec_port_binding *pb =
+                lport_lookup_by_name(p_ctx->sbrec_port_binding_by_name,
+                                     iface_id);
+            if (pb) {
+                ofctrl_prioritize_flows(flow_table, &pb->header_.uuid);
+            }
+        }
+        sset_destroy(&installing);
+    }
 }
@@ -28,7 +28,10 @@
 #include "openvswitch/meta-flow.h"
 
 struct hmap;
+struct hmapx;
+struct lazy_datapaths;
 struct ovsdb_idl_index;
+struct ovn_extend_table;
 struct ovsrec_bridge;
 struct simap;
 struct sbrec_multicast_group_table;
@@ -43,6 +46,11 @@ struct local_nonvif_data;
 #define OVN_GENEVE_TYPE 0x80     /* Critical option. */
 #define OVN_GENEVE_LEN 4
 
+/* Maximum number of OpenFlow group ids reserved for the multicast fan out
+ * groups.  The rest of the switch's group ids is left to the logical flows'
+ * select groups. */
+#define PHYSICAL_MAX_GROUP_IDS 65536
+
 struct physical_debug {
     uint32_t collector_set_id;
     uint32_t obs_domain_id;
@@ -69,6 +77,13 @@ struct physical_ctx {
     size_t n_encap_ips;
     const char **encap_ips;
     struct physical_debug debug;
+    /* If nonnull, the fanout of the multicast groups to remote chassis uses
+     * OpenFlow groups allocated from this table. */
+    struct ovn_extend_table *group_table;
+    /* The peer switches installed on demand, the ones that are waiting for
+     * their first packet are in 'lazy_peer_dps'. */
+    const struct lazy_datapaths *lazy_dps;
+    const struct hmapx *lazy_peer_dps;
 };
 
 void physical_register_ovs_idl(struct ovsdb_idl *);
@@ -80,4 +95,7 @@ bool physical_handle_flows_for_lport(const struct sbrec_port_binding *,
                                      bool removed,
                                      struct physical_ctx *,
                                      struct ovn_desired_flow_table *);
+void physical_handle_chassis_tunnel_changes(struct physical_ctx *,
+                                            const struct sset *chassis_names,
+                                            struct ovn_desired_flow_table *);
 #endif /* controller/physical.h */
@@ -24,6 +24,8 @@
 #include "dp-packet.h"
 #include "encaps.h"
 #include "flow.h"
+#include "guarded-list.h"
+#include "heap.h"
 #include "ha-chassis.h"
 #include "local_data.h"
 #include "lport.h"
@@ -40,6 +42,7 @@
 #include "openvswitch/ofp-print.h"
 #include "openvswitch/ofp-switch.h"
 #include "openvswitch/ofp-util.h"
+#include "openvswitch/usdt-probes.h"
 #include "openvswitch/vlog.h"
 #include "lib/random.h"
 #include "lib/crc32c.h"
@@ -56,9 +59,13 @@
 #include "ovn/logical-fields.h"
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/rconn.h"
+#include "ovs-rcu.h"
 #include "socket-util.h"
 #include "seq.h"
 #include "timeval.h"
+#include "token-bucket.h"
+#include "unixctl.h"
+#include "uuid.h"
 #include "vswitch-idl.h"
 #include "lflow.h"
 #include "ip-mcast.h"
@@ -81,11 +88,13 @@ VLOG_DEFINE_THIS_MODULE(pinctrl);
  *
  *   - dns_lookup -     In order to do a DNS lookup, this action needs
  *                      to access the 'DNS' table. pinctrl_run() builds a
- *                      local DNS cache - 'dns_cache'. See sync_dns_cache()
- *                      for more details.
+ *                      local DNS cache - 'dns_cache' and publishes a
+ *                      read-only copy of it through RCU. See
+ *                      sync_dns_cache() for more details.
  *                      The function 'pinctrl_handle_dns_lookup()' (which is
  *                      called with in the pinctrl_handler thread) looks into
- *                      the local DNS cache to resolve the DNS requests.
+ *                      that copy to resolve the DNS requests without taking
+ *                      'pinctrl_mutex'.
  *
  *   - put_arp/put_nd - These actions stores the IPv4/IPv6 and MAC addresses
  *                      in the 'MAC_Binding' table.
@@ -160,6 +169,16 @@ VLOG_DEFINE_THIS_MODULE(pinctrl);
  *  'pinctrl_main_seq' is used by pinctrl_handler() thread to wake up
  *  the main thread from poll_block() when mac bindings/igmp groups need to
  *  be updated in the Southboubd DB.
+ *
+ * Packet-in workers
+ * -----------------
+ * If external_ids:ovn-pinctrl-threads is set, pinctrl_handler() starts that
+ * many 'pinctrl_worker' threads and hands them the packet-ins of the actions
+ * that don't depend on state owned by pinctrl_handler() itself (see
+ * pinctrl_worker_opcode()): DHCP, DNS, ARP/ND, ICMP and the like.  The
+ * packet-ins are sharded by datapath, so that the ones of a datapath are
+ * still processed in order.  The workers access the shared state under
+ * 'pinctrl_mutex', exactly as pinctrl_handler() does.
  * */
 
 static struct ovs_mutex pinctrl_mutex = OVS_MUTEX_INITIALIZER;
@@ -178,6 +197,18 @@ struct pinctrl {
     pthread_t pinctrl_thread;
     /* Latch to destroy the 'pinctrl_thread' */
     struct latch pinctrl_thread_exit;
+    /* Number of packet-in worker threads requested by the main thread.
+     * Protected by pinctrl_mutex. */
+    size_t n_workers;
+    /* Learned MAC bindings write policy, see run_put_mac_bindings().
+     * Protected by pinctrl_mutex. */
+    unsigned int mac_binding_coalesce_ms;
+    size_t mac_binding_max_batch;
+    size_t mac_binding_max_batch_per_dp;
+    /* Service monitor status write policy, see
+     * svc_monitors_write_status().  Protected by pinctrl_mutex. */
+    unsigned int svc_monitor_status_holddown_ms;
+    size_t svc_monitor_max_batch;
     bool mac_binding_can_timestamp;
     bool fdb_can_timestamp;
     bool dns_supports_ovn_owned;
@@ -214,6 +245,18 @@ static void send_mac_binding_buffered_pkts(struct rconn *swconn)
     OVS_REQUIRES(pinctrl_mutex);
 
 static void pinctrl_rarp_activation_strategy_handler(const struct match *md);
+static void pinctrl_activate_datapath_handler(
+    const struct ofputil_packet_in *, const struct ofpbuf *continuation);
+static void destroy_datapaths_to_activate(void);
+static void wait_datapaths_to_activate(void);
+static void run_lazy_dp_buffered_packets(
+    const struct hmap *local_datapaths,
+    const struct lazy_datapaths *lazy_dps);
+
+static void pinctrl_pin_stats_show(struct unixctl_conn *, int argc,
+                                   const char *argv[], void *);
+static void pinctrl_pin_stats_clear(struct unixctl_conn *, int argc,
+                                    const char *argv[], void *);
 
 static void pinctrl_mg_split_buff_handler(
         struct rconn *swconn, struct dp_packet *pkt,
@@ -330,9 +373,14 @@ static void destroy_svc_monitors(void);
 static void sync_svc_monitors(
     struct ovsdb_idl_txn *ovnsb_idl_txn,
     const struct sbrec_service_monitor_table *svc_mon_table,
+    const struct sbrec_port_binding_table *pb_table,
     struct ovsdb_idl_index *sbrec_port_binding_by_name,
+    struct ovsdb_idl_index *sbrec_service_monitor_by_lport,
     const struct sbrec_chassis *our_chassis)
     OVS_REQUIRES(pinctrl_mutex);
+static void wait_svc_monitors_status(struct ovsdb_idl_txn *ovnsb_idl_txn)
+    OVS_REQUIRES(pinctrl_mutex);
+static void resync_svc_monitors(void) OVS_REQUIRES(pinctrl_mutex);
 static void svc_monitors_run(struct rconn *swconn,
                              long long int *svc_monitors_next_run_time)
     OVS_REQUIRES(pinctrl_mutex);
@@ -396,11 +444,19 @@ static void pinctrl_handle_put_fdb(const struct flow *md,
                                    OVS_REQUIRES(pinctrl_mutex);
 
 COVERAGE_DEFINE(pinctrl_drop_put_mac_binding);
+COVERAGE_DEFINE(pinctrl_coalesce_put_mac_binding);
+COVERAGE_DEFINE(pinctrl_defer_put_mac_binding);
 COVERAGE_DEFINE(pinctrl_drop_buffered_packets_map);
 COVERAGE_DEFINE(pinctrl_drop_controller_event);
 COVERAGE_DEFINE(pinctrl_drop_put_vport_binding);
 COVERAGE_DEFINE(pinctrl_notify_main_thread);
 COVERAGE_DEFINE(pinctrl_total_pin_pkts);
+COVERAGE_DEFINE(pinctrl_drop_worker_pin_pkts);
+COVERAGE_DEFINE(pinctrl_urgent_pin_pkts);
+COVERAGE_DEFINE(pinctrl_drop_bulk_pin_pkts);
+COVERAGE_DEFINE(pinctrl_drop_rate_limited_pin_pkts);
+COVERAGE_DEFINE(pinctrl_defer_svc_monitor_status);
+COVERAGE_DEFINE(pinctrl_dhcp_reply_template_miss);
 
 struct empty_lb_backends_event {
     struct hmap_node hmap_node;
@@ -572,6 +628,11 @@ pinctrl_init(void)
     latch_init(&pinctrl.pinctrl_thread_exit);
     pinctrl.pinctrl_thread = ovs_thread_create("ovn_pinctrl", pinctrl_handler,
                                                 &pinctrl);
+
+    unixctl_command_register("pinctrl/show-stats", "", 0, 0,
+                             pinctrl_pin_stats_show, NULL);
+    unixctl_command_register("pinctrl/clear-stats", "", 0, 0,
+                             pinctrl_pin_stats_clear, NULL);
 }
 
 static ovs_be32
@@ -1517,18 +1578,32 @@ prepare_ipv6_prefixd(struct ovsdb_idl_txn *ovnsb_idl_txn,
     }
 }
 
+/* Default memory budget of the buffered packets, in KB. */
+#define BUFFERED_PACKETS_DEFAULT_MEMLIMIT_KB 4096
+
 static struct buffered_packets_ctx buffered_packets_ctx;
 
+/* Packets buffered until the flows of their datapath, which are installed on
+ * demand, are installed. */
+static struct buffered_packets_ctx lazy_dp_buffered_packets_ctx;
+
 static void
 init_buffered_packets_ctx(void)
 {
     buffered_packets_ctx_init(&buffered_packets_ctx);
+    buffered_packets_ctx_set_max_bytes(
+        &buffered_packets_ctx, BUFFERED_PACKETS_DEFAULT_MEMLIMIT_KB * 1024);
+    buffered_packets_ctx_init(&lazy_dp_buffered_packets_ctx);
+    buffered_packets_ctx_set_max_bytes(
+        &lazy_dp_buffered_packets_ctx,
+        BUFFERED_PACKETS_DEFAULT_MEMLIMIT_KB * 1024);
 }
 
 static void
 destroy_buffered_packets_ctx(void)
 {
     buffered_packets_ctx_destroy(&buffered_packets_ctx);
+    buffered_packets_ctx_destroy(&lazy_dp_buffered_packets_ctx);
 }
 
 /* Called with in the pinctrl_handler thread context. */
@@ -1560,7 +1635,7 @@ OVS_REQUIRES(pinctrl_mutex)
     }
 
     struct bp_packet_data *pd = bp_packet_data_create(pin, continuation);
-    buffered_packets_packet_data_enqueue(bp, pd);
+    buffered_packets_packet_data_enqueue(&buffered_packets_ctx, bp, pd);
 
     /* There is a chance that the MAC binding was already created. */
     notify_pinctrl_main();
@@ -2512,6 +2587,162 @@ exit:
     }
 }
 
+/* Rewrites the DHCP options in 'opts', as encoded by put_dhcp_opts(), into
+ * the ones to send in the reply to a client that did ('ipxe_req') or did not
+ * request iPXE.  Returns true and stores in '*next_server' the value of the
+ * next server option if there is one. */
+static bool
+dhcp_reply_opts_prepare(struct ofpbuf *opts, bool ipxe_req,
+                        ovs_be32 *next_server)
+{
+    bool next_server_set = false;
+    bool bootfile_name_set = false;
+    const char *in_dhcp_ptr = opts->data;
+    const char *end = (const char *) opts->data + opts->size;
+
+    while (in_dhcp_ptr < end) {
+        struct dhcp_opt_header *in_dhcp_opt =
+            (struct dhcp_opt_header *)in_dhcp_ptr;
+
+        switch (in_dhcp_opt->code) {
+        case DHCP_OPT_NEXT_SERVER_CODE:
+            *next_server = get_unaligned_be32(DHCP_OPT_PAYLOAD(in_dhcp_opt));
+            next_server_set = true;
+            break;
+        case DHCP_OPT_BOOTFILE_CODE: ;
+            unsigned char *ptr = (unsigned char *)in_dhcp_opt;
+            int len = sizeof *in_dhcp_opt + in_dhcp_opt->len;
+            struct dhcp_opt_header *next_dhcp_opt =
+                (struct dhcp_opt_header *)(ptr + len);
+
+            if (next_dhcp_opt->code == DHCP_OPT_BOOTFILE_ALT_CODE) {
+                if (!ipxe_req) {
+                    ofpbuf_pull(opts, len);
+                    next_dhcp_opt->code = DHCP_OPT_BOOTFILE_CODE;
+                } else {
+                    char *buf = xmalloc(len);
+
+                    memcpy(buf, in_dhcp_opt, len);
+                    ofpbuf_pull(opts,
+                                sizeof *in_dhcp_opt + next_dhcp_opt->len);
+                    memcpy(opts->data, buf, len);
+                    free(buf);
+                }
+            }
+            bootfile_name_set = true;
+            break;
+        case DHCP_OPT_BOOTFILE_ALT_CODE:
+            if (!bootfile_name_set) {
+                in_dhcp_opt->code = DHCP_OPT_BOOTFILE_CODE;
+            }
+            break;
+        }
+
+        in_dhcp_ptr += sizeof *in_dhcp_opt;
+        if (in_dhcp_ptr > end) {
+            break;
+        }
+        in_dhcp_ptr += in_dhcp_opt->len;
+        if (in_dhcp_ptr > end) {
+            break;
+        }
+    }
+
+    return next_server_set;
+}
+
+/* Cache of the options computed by dhcp_reply_opts_prepare(), keyed by the
+ * options found in the put_dhcp_opts() userdata and by 'ipxe_req'.  The
+ * userdata of a port only changes when its DHCP_Options or logical flows do,
+ * so the key is enough to invalidate stale entries and the entries for a
+ * port are reused by every request that port sends.
+ *
+ * Accessed by both pinctrl_handler and the pinctrl workers. */
+struct dhcp_reply_template {
+    struct hmap_node hmap_node;
+    bool ipxe_req;
+    struct ofpbuf *key;         /* Options from the userdata. */
+    struct ofpbuf *opts;        /* Options to put in the reply. */
+    bool has_next_server;
+    ovs_be32 next_server;
+};
+
+/* Maximum number of cached templates.  The cache is flushed when it is
+ * reached, which gets rid of the ones of deleted or modified ports. */
+#define DHCP_REPLY_TEMPLATES_MAX 4096
+
+static struct ovs_mutex dhcp_reply_templates_mutex = OVS_MUTEX_INITIALIZER;
+static struct hmap dhcp_reply_templates
+    OVS_GUARDED_BY(dhcp_reply_templates_mutex)
+    = HMAP_INITIALIZER(&dhcp_reply_templates);
+
+static void
+dhcp_reply_templates_clear(void)
+    OVS_REQUIRES(dhcp_reply_templates_mutex)
+{
+    struct dhcp_reply_template *t;
+    HMAP_FOR_EACH_POP (t, hmap_node, &dhcp_reply_templates) {
+        ofpbuf_delete(t->key);
+        ofpbuf_delete(t->opts);
+        free(t);
+    }
+}
+
+static void
+destroy_dhcp_reply_templates(void)
+{
+    ovs_mutex_lock(&dhcp_reply_templates_mutex);
+    dhcp_reply_templates_clear();
+    hmap_destroy(&dhcp_reply_templates);
+    ovs_mutex_unlock(&dhcp_reply_templates_mutex);
+}
+
+/* Appends to 'reply_opts' the DHCP options to send in the reply for the
+ * put_dhcp_opts() options 'userdata_opts', and updates '*next_server' if
+ * they include a next server option. */
+static void
+dhcp_reply_template_get(const struct ofpbuf *userdata_opts, bool ipxe_req,
+                        struct ofpbuf *reply_opts, ovs_be32 *next_server)
+{
+    uint32_t hash = hash_bytes(userdata_opts->data, userdata_opts->size,
+                               ipxe_req);
+    struct dhcp_reply_template *t;
+    bool found = false;
+
+    ovs_mutex_lock(&dhcp_reply_templates_mutex);
+    HMAP_FOR_EACH_WITH_HASH (t, hmap_node, hash, &dhcp_reply_templates) {
+        if (t->ipxe_req == ipxe_req
+            && t->key->size == userdata_opts->size
+            && !memcmp(t->key->data, userdata_opts->data,
+                       userdata_opts->size)) {
+            found = true;
+            break;
+        }
+    }
+
+    if (!found) {
+        COVERAGE_INC(pinctrl_dhcp_reply_template_miss);
+        if (hmap_count(&dhcp_reply_templates) >= DHCP_REPLY_TEMPLATES_MAX) {
+            dhcp_reply_templates_clear();
+        }
+
+        t = xmalloc(sizeof *t);
+        t->ipxe_req = ipxe_req;
+        t->key = ofpbuf_clone(userdata_opts);
+        t->opts = ofpbuf_clone(userdata_opts);
+        t->next_server = 0;
+        t->has_next_server = dhcp_reply_opts_prepare(t->opts, ipxe_req,
+                                                     &t->next_server);
+        hmap_insert(&dhcp_reply_templates, &t->hmap_node, hash);
+    }
+
+    ofpbuf_put(reply_opts, t->opts->data, t->opts->size);
+    if (t->has_next_server) {
+        *next_server = t->next_server;
+    }
+    ovs_mutex_unlock(&dhcp_reply_templates_mutex);
+}
+
 /* Called with in the pinctrl_handler thread context. */
 static void
 pinctrl_handle_put_dhcp_opts(
@@ -2524,6 +2755,8 @@ pinctrl_handle_put_dhcp_opts(
     enum ofputil_protocol proto = ofputil_protocol_from_ofp_version(version);
     struct dp_packet *pkt_out_ptr = NULL;
     struct ofpbuf *dhcp_inform_reply_buf = NULL;
+    uint64_t reply_opts_stub[256 / 8];
+    struct ofpbuf reply_opts = OFPBUF_STUB_INITIALIZER(reply_opts_stub);
     uint32_t success = 0;
 
     /* Parse result field. */
@@ -2703,56 +2936,9 @@ pinctrl_handle_put_dhcp_opts(
      * --------------------------------------------------------------
      */
     ovs_be32 next_server = in_dhcp_data->siaddr;
-    bool bootfile_name_set = false;
-    in_dhcp_ptr = reply_dhcp_opts_ptr->data;
-    end = (const char *)reply_dhcp_opts_ptr->data + reply_dhcp_opts_ptr->size;
-
-    while (in_dhcp_ptr < end) {
-        struct dhcp_opt_header *in_dhcp_opt =
-            (struct dhcp_opt_header *)in_dhcp_ptr;
-
-        switch (in_dhcp_opt->code) {
-        case DHCP_OPT_NEXT_SERVER_CODE:
-            next_server = get_unaligned_be32(DHCP_OPT_PAYLOAD(in_dhcp_opt));
-            break;
-        case DHCP_OPT_BOOTFILE_CODE: ;
-            unsigned char *ptr = (unsigned char *)in_dhcp_opt;
-            int len = sizeof *in_dhcp_opt + in_dhcp_opt->len;
-            struct dhcp_opt_header *next_dhcp_opt =
-                (struct dhcp_opt_header *)(ptr + len);
-
-            if (next_dhcp_opt->code == DHCP_OPT_BOOTFILE_ALT_CODE) {
-                if (!dhcp_opts.ipxe_req) {
-                    ofpbuf_pull(reply_dhcp_opts_ptr, len);
-                    next_dhcp_opt->code = DHCP_OPT_BOOTFILE_CODE;
-                } else {
-                    char *buf = xmalloc(len);
-
-                    memcpy(buf, in_dhcp_opt, len);
-                    ofpbuf_pull(reply_dhcp_opts_ptr,
-                                sizeof *in_dhcp_opt + next_dhcp_opt->len);
-                    memcpy(reply_dhcp_opts_ptr->data, buf, len);
-                    free(buf);
-                }
-            }
-            bootfile_name_set = true;
-            break;
-        case DHCP_OPT_BOOTFILE_ALT_CODE:
-            if (!bootfile_name_set) {
-                in_dhcp_opt->code = DHCP_OPT_BOOTFILE_CODE;
-            }
-            break;
-        }
-
-        in_dhcp_ptr += sizeof *in_dhcp_opt;
-        if (in_dhcp_ptr > end) {
-            break;
-        }
-        in_dhcp_ptr += in_dhcp_opt->len;
-        if (in_dhcp_ptr > end) {
-            break;
-        }
-    }
+    dhcp_reply_template_get(reply_dhcp_opts_ptr, dhcp_opts.ipxe_req,
+                            &reply_opts, &next_server);
+    reply_dhcp_opts_ptr = &reply_opts;
 
     uint16_t new_l4_size = UDP_HEADER_LEN + DHCP_HEADER_LEN + 16;
     if (msg_type != DHCP_MSG_NAK) {
@@ -2859,6 +3045,7 @@ exit:
     if (dhcp_inform_reply_buf) {
         ofpbuf_delete(dhcp_inform_reply_buf);
     }
+    ofpbuf_uninit(&reply_opts);
 }
 
 static void
@@ -3284,14 +3471,138 @@ struct dns_data {
     bool delete;
 };
 
+/* DNS records as known by the main thread.  Only accessed by
+ * sync_dns_cache() and destroy_dns_cache(). */
 static struct shash dns_cache = SHASH_INITIALIZER(&dns_cache);
 
+static void
+dns_data_destroy(struct dns_data *d)
+{
+    smap_destroy(&d->records);
+    smap_destroy(&d->options);
+    free(d->dps);
+    free(d);
+}
+
+/* A DNS record of a datapath, as looked up by pinctrl_handle_dns_lookup(). */
+struct dns_index_entry {
+    struct hmap_node hmap_node; /* In dns_index's 'entries'. */
+    uint64_t dp_key;            /* Datapath tunnel key. */
+    const char *name;           /* Lowercase query name, owned by the
+                                 * dns_data the record comes from. */
+    const char *answer;         /* Record value, same owner as 'name'. */
+    bool ovn_owned;
+
+    /* 'answer' parsed as a list of IP addresses, for A, AAAA and ANY
+     * queries.  PTR records have a domain name instead. */
+    bool has_addrs;
+    struct lport_addresses addrs;
+};
+
+/* Read-only copy of 'dns_cache', with its records indexed by datapath and
+ * name.  It is replaced as a whole whenever 'dns_cache' changes, and the
+ * previous copy is freed once all the threads have quiesced, so lookups
+ * don't need to take 'pinctrl_mutex'. */
+struct dns_index {
+    struct shash dns_data;      /* Copy of 'dns_cache'. */
+    struct hmap entries;        /* Contains "struct dns_index_entry"s. */
+};
+
+static OVSRCU_TYPE(struct dns_index *) dns_index_snapshot;
+
+static uint32_t
+dns_index_hash(uint64_t dp_key, const char *name)
+{
+    return hash_string(name, hash_uint64(dp_key));
+}
+
+static const struct dns_index_entry *
+dns_index_find(const struct dns_index *di, uint64_t dp_key,
+               const char *name)
+{
+    const struct dns_index_entry *e;
+    HMAP_FOR_EACH_WITH_HASH (e, hmap_node, dns_index_hash(dp_key, name),
+                             &di->entries) {
+        if (e->dp_key == dp_key && !strcmp(e->name, name)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static struct dns_index *
+dns_index_create(const struct shash *cache)
+{
+    struct dns_index *di = xmalloc(sizeof *di);
+    shash_init(&di->dns_data);
+    hmap_init(&di->entries);
+
+    struct shash_node *iter;
+    SHASH_FOR_EACH (iter, cache) {
+        const struct dns_data *d = iter->data;
+        struct dns_data *c = xmalloc(sizeof *c);
+
+        smap_clone(&c->records, &d->records);
+        smap_clone(&c->options, &d->options);
+        c->n_dps = d->n_dps;
+        c->dps = xmemdup(d->dps, d->n_dps * sizeof *d->dps);
+        c->delete = false;
+        shash_add(&di->dns_data, iter->name, c);
+
+        bool ovn_owned = smap_get_bool(&c->options, "ovn-owned", false);
+        for (size_t i = 0; i < c->n_dps; i++) {
+            struct smap_node *record;
+            SMAP_FOR_EACH (record, &c->records) {
+                if (dns_index_find(di, c->dps[i], record->key)) {
+                    continue;
+                }
+
+                struct dns_index_entry *e = xmalloc(sizeof *e);
+                e->dp_key = c->dps[i];
+                e->name = record->key;
+                e->answer = record->value;
+                e->ovn_owned = ovn_owned;
+                e->has_addrs = extract_ip_addresses(record->value,
+                                                    &e->addrs);
+                hmap_insert(&di->entries, &e->hmap_node,
+                            dns_index_hash(e->dp_key, e->name));
+            }
+        }
+    }
+    return di;
+}
+
+static void
+dns_index_destroy(struct dns_index *di)
+{
+    if (!di) {
+        return;
+    }
+
+    struct dns_index_entry *e;
+    HMAP_FOR_EACH_POP (e, hmap_node, &di->entries) {
+        destroy_lport_addresses(&e->addrs);
+        free(e);
+    }
+    hmap_destroy(&di->entries);
+
+    struct shash_node *iter;
+    SHASH_FOR_EACH_SAFE (iter, &di->dns_data) {
+        struct dns_data *d = iter->data;
+        shash_delete(&di->dns_data, iter);
+        dns_data_destroy(d);
+    }
+    shash_destroy(&di->dns_data);
+    free(di);
+}
+
 /* Called by pinctrl_run(). Runs within the main ovn-controller
  * thread context. */
 static void
 sync_dns_cache(const struct sbrec_dns_table *dns_table)
-    OVS_REQUIRES(pinctrl_mutex)
 {
+    bool changed = false;
+
     struct shash_node *iter;
     SHASH_FOR_EACH (iter, &dns_cache) {
         struct dns_data *d = iter->data;
@@ -3313,8 +3624,7 @@ sync_dns_cache(const struct sbrec_dns_table *dns_table)
             shash_add(&dns_cache, dns_id, dns_data);
             dns_data->n_dps = 0;
             dns_data->dps = NULL;
-        } else {
-            free(dns_data->dps);
+            changed = true;
         }
 
         dns_data->delete = false;
@@ -3322,18 +3632,29 @@ sync_dns_cache(const struct sbrec_dns_table *dns_table)
         if (!smap_equal(&dns_data->records, &sbrec_dns->records)) {
             smap_destroy(&dns_data->records);
             smap_clone(&dns_data->records, &sbrec_dns->records);
+            changed = true;
         }
 
         if (pinctrl.dns_supports_ovn_owned
             && !smap_equal(&dns_data->options, &sbrec_dns->options)) {
             smap_destroy(&dns_data->options);
             smap_clone(&dns_data->options, &sbrec_dns->options);
+            changed = true;
         }
 
-        dns_data->n_dps = sbrec_dns->n_datapaths;
-        dns_data->dps = xcalloc(dns_data->n_dps, sizeof(uint64_t));
-        for (size_t i = 0; i < sbrec_dns->n_datapaths; i++) {
-            dns_data->dps[i] = sbrec_dns->datapaths[i]->tunnel_key;
+        bool dps_changed = dns_data->n_dps != sbrec_dns->n_datapaths;
+        for (size_t i = 0; !dps_changed && i < dns_data->n_dps; i++) {
+            dps_changed = (dns_data->dps[i]
+                           != sbrec_dns->datapaths[i]->tunnel_key);
+        }
+        if (dps_changed) {
+            free(dns_data->dps);
+            dns_data->n_dps = sbrec_dns->n_datapaths;
+            dns_data->dps = xcalloc(dns_data->n_dps, sizeof(uint64_t));
+            for (size_t i = 0; i < sbrec_dns->n_datapaths; i++) {
+                dns_data->dps[i] = sbrec_dns->datapaths[i]->tunnel_key;
+            }
+            changed = true;
         }
     }
 
@@ -3341,10 +3662,17 @@ sync_dns_cache(const struct sbrec_dns_table *dns_table)
         struct dns_data *d = iter->data;
         if (d->delete) {
             shash_delete(&dns_cache, iter);
-            smap_destroy(&d->records);
-            smap_destroy(&d->options);
-            free(d->dps);
-            free(d);
+            dns_data_destroy(d);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        struct dns_index *old = ovsrcu_get_protected(struct dns_index *,
+                                                     &dns_index_snapshot);
+        ovsrcu_set(&dns_index_snapshot, dns_index_create(&dns_cache));
+        if (old) {
+            ovsrcu_postpone(dns_index_destroy, old);
         }
     }
 }
@@ -3356,11 +3684,12 @@ destroy_dns_cache(void)
     SHASH_FOR_EACH_SAFE (iter, &dns_cache) {
         struct dns_data *d = iter->data;
         shash_delete(&dns_cache, iter);
-        smap_destroy(&d->records);
-        smap_destroy(&d->options);
-        free(d->dps);
-        free(d);
+        dns_data_destroy(d);
     }
+
+    dns_index_destroy(ovsrcu_get_protected(struct dns_index *,
+                                           &dns_index_snapshot));
+    ovsrcu_set_hidden(&dns_index_snapshot, NULL);
 }
 
 /* Populates dns_answer struct with base data.
@@ -3440,7 +3769,6 @@ pinctrl_handle_dns_lookup(
     struct rconn *swconn,
     struct dp_packet *pkt_in, struct ofputil_packet_in *pin,
     struct ofpbuf *userdata, struct ofpbuf *continuation)
-    OVS_REQUIRES(pinctrl_mutex)
 {
     static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
     enum ofp_version version = rconn_get_version(swconn);
@@ -3545,64 +3873,51 @@ pinctrl_handle_dns_lookup(
     uint32_t query_l4_size = rest - l4_start;
 
     uint64_t dp_key = ntohll(pin->flow_metadata.flow.metadata);
-    const char *answer_data = NULL;
-    bool ovn_owned = false;
-    struct shash_node *iter;
-    SHASH_FOR_EACH (iter, &dns_cache) {
-        struct dns_data *d = iter->data;
-        ovn_owned = smap_get_bool(&d->options, "ovn-owned", false);
-        for (size_t i = 0; i < d->n_dps; i++) {
-            if (d->dps[i] == dp_key) {
-                /* DNS records in SBDB are stored in lowercase. Convert to
-                 * lowercase to perform case insensitive lookup
-                 */
-                char *query_name_lower = str_tolower(ds_cstr(&query_name));
-                answer_data = smap_get(&d->records, query_name_lower);
-                free(query_name_lower);
-                if (answer_data) {
-                    break;
-                }
-            }
-        }
-
-        if (answer_data) {
-            break;
-        }
+    const struct dns_index *di = ovsrcu_get(struct dns_index *,
+                                            &dns_index_snapshot);
+    const struct dns_index_entry *entry = NULL;
+    if (di) {
+        /* DNS records in SBDB are stored in lowercase. Convert to
+         * lowercase to perform case insensitive lookup
+         */
+        char *query_name_lower = str_tolower(ds_cstr(&query_name));
+        entry = dns_index_find(di, dp_key, query_name_lower);
+        free(query_name_lower);
     }
 
     ds_destroy(&query_name);
-    if (!answer_data) {
+    if (!entry) {
         goto exit;
     }
 
-
     uint16_t ancount = 0;
     uint64_t dns_ans_stub[128 / 8];
     struct ofpbuf dns_answer = OFPBUF_STUB_INITIALIZER(dns_ans_stub);
 
     if (query_type == DNS_QUERY_TYPE_PTR) {
-        dns_build_ptr_answer(&dns_answer, in_queryname, idx, answer_data);
+        dns_build_ptr_answer(&dns_answer, in_queryname, idx, entry->answer);
         ancount++;
     } else {
-        struct lport_addresses ip_addrs;
-        if (!extract_ip_addresses(answer_data, &ip_addrs)) {
+        if (!entry->has_addrs) {
+            ofpbuf_uninit(&dns_answer);
             goto exit;
         }
+        const struct lport_addresses *ip_addrs = &entry->addrs;
 
         if (query_type == DNS_QUERY_TYPE_A ||
             query_type == DNS_QUERY_TYPE_ANY) {
-            for (size_t i = 0; i < ip_addrs.n_ipv4_addrs; i++) {
+            for (size_t i = 0; i < ip_addrs->n_ipv4_addrs; i++) {
                 dns_build_a_answer(&dns_answer, in_queryname, idx,
-                                   ip_addrs.ipv4_addrs[i].addr);
+                                   ip_addrs->ipv4_addrs[i].addr);
                 ancount++;
             }
         }
 
         if (query_type == DNS_QUERY_TYPE_AAAA ||
             query_type == DNS_QUERY_TYPE_ANY) {
-            for (size_t i = 0; i < ip_addrs.n_ipv6_addrs; i++) {
+            for (size_t i = 0; i < ip_addrs->n_ipv6_addrs; i++) {
                 dns_build_aaaa_answer(&dns_answer, in_queryname, idx,
-                                      &ip_addrs.ipv6_addrs[i].addr);
+                                      &ip_addrs->ipv6_addrs[i].addr);
                 ancount++;
             }
         }
@@ -3613,12 +3928,10 @@ pinctrl_handle_dns_lookup(
          * will speed up the DNS process by not letting the customer
          * wait for a timeout.
          */
-        if (ovn_owned && (query_type == DNS_QUERY_TYPE_AAAA ||
-            query_type == DNS_QUERY_TYPE_A) && !ancount) {
+        if (entry->ovn_owned && (query_type == DNS_QUERY_TYPE_AAAA ||
+                                 query_type == DNS_QUERY_TYPE_A) && !ancount) {
             send_refuse = true;
         }
-
-        destroy_lport_addresses(&ip_addrs);
     }
 
     if (!ancount && !send_refuse) {
@@ -3710,38 +4023,263 @@ exit:
     dp_packet_uninit(pkt_out_ptr);
 }
 
-/* Called with in the pinctrl_handler thread context. */
-static void
-process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
+/* Packet-in accounting, per datapath and action opcode, and optional per
+ * datapath rate limiting (see external_ids:ovn-pinctrl-datapath-rate).
+ *
+ * Updated by pinctrl_handler and the packet-in workers, and read by the
+ * "pinctrl/show-stats" command from the main thread.  Entries are never
+ * removed before pinctrl_destroy(), "pinctrl/clear-stats" only resets their
+ * counters. */
+struct pinctrl_pin_stats {
+    struct hmap_node hmap_node; /* In 'pin_stats'. */
+    uint64_t dp_key;
+    uint32_t opcode;
+    uint64_t n_packets;         /* Processed packet-ins. */
+    uint64_t n_dropped;         /* Packet-ins dropped by the rate limit. */
+    uint64_t total_usec;        /* Time spent processing them. */
+};
+
+/* Token bucket of a datapath.  One packet-in costs 1000 tokens, so that the
+ * bucket's rate, in tokens per millisecond, is in packet-ins per second. */
+struct pinctrl_pin_limiter {
+    struct hmap_node hmap_node; /* In 'pin_limiters'. */
+    uint64_t dp_key;
+    struct token_bucket tb;
+};
+
+#define PINCTRL_PIN_TOKENS 1000
+
+static struct ovs_mutex pin_stats_mutex = OVS_MUTEX_INITIALIZER;
+static struct hmap pin_stats OVS_GUARDED_BY(pin_stats_mutex)
+    = HMAP_INITIALIZER(&pin_stats);
+static struct hmap pin_limiters OVS_GUARDED_BY(pin_stats_mutex)
+    = HMAP_INITIALIZER(&pin_limiters);
+/* Packet-ins per second and burst size allowed for each datapath, or 0 if
+ * packet-ins are not rate limited. */
+static unsigned int pin_rate OVS_GUARDED_BY(pin_stats_mutex);
+static unsigned int pin_burst OVS_GUARDED_BY(pin_stats_mutex);
+
+static struct pinctrl_pin_stats *
+pinctrl_pin_stats_get(uint64_t dp_key, uint32_t opcode)
+    OVS_REQUIRES(pin_stats_mutex)
 {
-    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+    uint32_t hash = hash_int(opcode, hash_uint64(dp_key));
+    struct pinctrl_pin_stats *stats;
 
-    struct ofputil_packet_in pin;
-    struct ofpbuf continuation;
-    enum ofperr error = ofputil_decode_packet_in(msg, true, NULL, NULL, &pin,
-                                                 NULL, NULL, &continuation);
+    HMAP_FOR_EACH_WITH_HASH (stats, hmap_node, hash, &pin_stats) {
+        if (stats->dp_key == dp_key && stats->opcode == opcode) {
+            return stats;
+        }
+    }
 
-    if (error) {
-        VLOG_WARN_RL(&rl, "error decoding packet-in: %s",
-                     ofperr_to_string(error));
-        return;
+    stats = xzalloc(sizeof *stats);
+    stats->dp_key = dp_key;
+    stats->opcode = opcode;
+    hmap_insert(&pin_stats, &stats->hmap_node, hash);
+    return stats;
+}
+
+static struct pinctrl_pin_limiter *
+pinctrl_pin_limiter_get(uint64_t dp_key)
+    OVS_REQUIRES(pin_stats_mutex)
+{
+    uint32_t hash = hash_uint64(dp_key);
+    struct pinctrl_pin_limiter *limiter;
+
+    HMAP_FOR_EACH_WITH_HASH (limiter, hmap_node, hash, &pin_limiters) {
+        if (limiter->dp_key == dp_key) {
+            return limiter;
+        }
     }
-    if (pin.reason != OFPR_ACTION) {
-        return;
+
+    limiter = xmalloc(sizeof *limiter);
+    limiter->dp_key = dp_key;
+    token_bucket_init(&limiter->tb, pin_rate,
+                      OVS_SAT_MUL(pin_burst, PINCTRL_PIN_TOKENS));
+    hmap_insert(&pin_limiters, &limiter->hmap_node, hash);
+    return limiter;
+}
+
+static void
+pinctrl_pin_limiters_clear(void)
+    OVS_REQUIRES(pin_stats_mutex)
+{
+    struct pinctrl_pin_limiter *limiter;
+    HMAP_FOR_EACH_POP (limiter, hmap_node, &pin_limiters) {
+        free(limiter);
     }
+}
 
-    struct ofpbuf userdata = ofpbuf_const_initializer(pin.userdata,
-                                                      pin.userdata_len);
-    const struct action_header *ah = ofpbuf_pull(&userdata, sizeof *ah);
-    if (!ah) {
-        VLOG_WARN_RL(&rl, "packet-in userdata lacks action header");
-        return;
+/* Called by pinctrl_run(). Runs with in the main ovn-controller
+ * thread context. */
+static void
+pinctrl_pin_rate_limit_set(unsigned int rate, unsigned int burst)
+{
+    ovs_mutex_lock(&pin_stats_mutex);
+    if (rate != pin_rate || burst != pin_burst) {
+        pin_rate = rate;
+        pin_burst = burst;
+        pinctrl_pin_limiters_clear();
     }
+    ovs_mutex_unlock(&pin_stats_mutex);
+}
 
-    struct dp_packet packet;
-    dp_packet_use_const(&packet, pin.packet, pin.packet_len);
-    struct flow headers;
-    flow_extract(&packet, &headers);
+/* Accounts for a packet-in for 'opcode' on datapath 'dp_key'.  Returns false
+ * if the packet-in must be dropped because the datapath exceeded its rate
+ * limit. */
+static bool
+pinctrl_pin_admit(uint64_t dp_key, uint32_t opcode)
+{
+    bool admit = true;
+
+    ovs_mutex_lock(&pin_stats_mutex);
+    struct pinctrl_pin_stats *stats = pinctrl_pin_stats_get(dp_key, opcode);
+    if (pin_rate) {
+        struct pinctrl_pin_limiter *limiter = pinctrl_pin_limiter_get(dp_key);
+        admit = token_bucket_withdraw(&limiter->tb, PINCTRL_PIN_TOKENS);
+    }
+    if (admit) {
+        stats->n_packets++;
+    } else {
+        stats->n_dropped++;
+    }
+    ovs_mutex_unlock(&pin_stats_mutex);
+
+    if (!admit) {
+        COVERAGE_INC(pinctrl_drop_rate_limited_pin_pkts);
+    }
+    return admit;
+}
+
+static void
+pinctrl_pin_account(uint64_t dp_key, uint32_t opcode, long long int usec)
+{
+    ovs_mutex_lock(&pin_stats_mutex);
+    pinctrl_pin_stats_get(dp_key, opcode)->total_usec += usec;
+    ovs_mutex_unlock(&pin_stats_mutex);
+}
+
+static int
+compare_pin_stats(const void *a_, const void *b_)
+{
+    const struct pinctrl_pin_stats *const *a = a_;
+    const struct pinctrl_pin_stats *const *b = b_;
+
+    if ((*a)->dp_key != (*b)->dp_key) {
+        return (*a)->dp_key < (*b)->dp_key ? -1 : 1;
+    }
+    return ((*a)->opcode > (*b)->opcode) - ((*a)->opcode < (*b)->opcode);
+}
+
+static void
+pinctrl_pin_stats_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                       const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ovs_mutex_lock(&pin_stats_mutex);
+    size_t n = 0;
+    struct pinctrl_pin_stats **sorted = xmalloc(hmap_count(&pin_stats)
+                                                * sizeof *sorted);
+    struct pinctrl_pin_stats *stats;
+    HMAP_FOR_EACH (stats, hmap_node, &pin_stats) {
+        sorted[n++] = stats;
+    }
+    qsort(sorted, n, sizeof *sorted, compare_pin_stats);
+
+    if (pin_rate) {
+        ds_put_format(&ds, "Rate limit: %u packets/s per datapath, "
+                      "burst %u\n", pin_rate, pin_burst);
+    }
+    for (size_t i = 0; i < n; i++) {
+        stats = sorted[i];
+
+        char *opcode = ovnact_op_to_string(stats->opcode);
+        ds_put_format(&ds, "datapath %"PRIu64" %-22s packets: %-10"PRIu64
+                      " dropped: %-10"PRIu64" usec: %-12"PRIu64
+                      " avg-usec: %.1f\n",
+                      stats->dp_key, opcode, stats->n_packets,
+                      stats->n_dropped, stats->total_usec,
+                      stats->n_packets
+                      ? (double) stats->total_usec / stats->n_packets
+                      : 0.0);
+        free(opcode);
+    }
+    ovs_mutex_unlock(&pin_stats_mutex);
+    free(sorted);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
+static void
+pinctrl_pin_stats_clear(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                        const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    ovs_mutex_lock(&pin_stats_mutex);
+    struct pinctrl_pin_stats *stats;
+    HMAP_FOR_EACH (stats, hmap_node, &pin_stats) {
+        stats->n_packets = 0;
+        stats->n_dropped = 0;
+        stats->total_usec = 0;
+    }
+    ovs_mutex_unlock(&pin_stats_mutex);
+
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+destroy_pin_stats(void)
+{
+    ovs_mutex_lock(&pin_stats_mutex);
+    struct pinctrl_pin_stats *stats;
+    HMAP_FOR_EACH_POP (stats, hmap_node, &pin_stats) {
+        free(stats);
+    }
+    pinctrl_pin_limiters_clear();
+    ovs_mutex_unlock(&pin_stats_mutex);
+}
+
+/* Called with in the pinctrl_handler thread context. */
+static void
+process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+    struct ofputil_packet_in pin;
+    struct ofpbuf continuation;
+    enum ofperr error = ofputil_decode_packet_in(msg, true, NULL, NULL, &pin,
+                                                 NULL, NULL, &continuation);
+
+    if (error) {
+        VLOG_WARN_RL(&rl, "error decoding packet-in: %s",
+                     ofperr_to_string(error));
+        return;
+    }
+    if (pin.reason != OFPR_ACTION) {
+        return;
+    }
+
+    struct ofpbuf userdata = ofpbuf_const_initializer(pin.userdata,
+                                                      pin.userdata_len);
+    const struct action_header *ah = ofpbuf_pull(&userdata, sizeof *ah);
+    if (!ah) {
+        VLOG_WARN_RL(&rl, "packet-in userdata lacks action header");
+        return;
+    }
+
+    uint64_t dp_key = ntohll(pin.flow_metadata.flow.metadata);
+    uint32_t opcode = ntohl(ah->opcode);
+    if (!pinctrl_pin_admit(dp_key, opcode)) {
+        OVS_USDT_PROBE(process_packet_in, drop, opcode, dp_key);
+        return;
+    }
+    long long int start = time_usec();
+
+    struct dp_packet packet;
+    dp_packet_use_const(&packet, pin.packet, pin.packet_len);
+    struct flow headers;
+    flow_extract(&packet, &headers);
 
     switch (ntohl(ah->opcode)) {
     case ACTION_OPCODE_ARP:
@@ -3803,10 +4341,8 @@ process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
         break;
 
     case ACTION_OPCODE_DNS_LOOKUP:
-        ovs_mutex_lock(&pinctrl_mutex);
         pinctrl_handle_dns_lookup(swconn, &packet, &pin, &userdata,
                                   &continuation);
-        ovs_mutex_unlock(&pinctrl_mutex);
         break;
 
     case ACTION_OPCODE_LOG:
@@ -3893,6 +4429,12 @@ process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
         ovs_mutex_unlock(&pinctrl_mutex);
         break;
 
+    case ACTION_OPCODE_ACTIVATE_DATAPATH:
+        ovs_mutex_lock(&pinctrl_mutex);
+        pinctrl_activate_datapath_handler(&pin, &continuation);
+        ovs_mutex_unlock(&pinctrl_mutex);
+        break;
+
     case ACTION_OPCODE_MG_SPLIT_BUF:
         pinctrl_mg_split_buff_handler(swconn, &packet, &pin.flow_metadata,
                                       &userdata);
@@ -3903,7 +4445,10 @@ process_packet_in(struct rconn *swconn, const struct ofp_header *msg)
                      ntohl(ah->opcode));
         break;
     }
-
+    long long int usec = time_usec() - start;
+    pinctrl_pin_account(dp_key, opcode, usec);
+    OVS_USDT_PROBE(process_packet_in, handled, opcode, dp_key,
+                   ntohll(pin.cookie), usec);
 
     if (VLOG_IS_DBG_ENABLED()) {
         struct ds pin_str = DS_EMPTY_INITIALIZER;
@@ -3982,6 +4527,290 @@ notify_pinctrl_main(void)
     seq_change(pinctrl_main_seq);
 }
 
+/* Maximum number of packet-ins queued for a worker.  Beyond that, new
+ * packet-ins for the worker are dropped, as OVS would do if we didn't read
+ * them fast enough. */
+#define PINCTRL_WORKER_MAX_QUEUE 1024
+
+/* A thread that processes packet-ins handed by pinctrl_handler(). */
+struct pinctrl_worker {
+    pthread_t thread;
+    struct latch exit;
+    struct seq *seq;                  /* Changed when packet-ins are queued. */
+    struct guarded_list packet_ins;   /* Contains "struct ofpbuf"s. */
+    struct rconn *swconn;
+};
+
+/* Only accessed by the pinctrl_handler thread. */
+static struct pinctrl_worker *pinctrl_workers;
+static size_t n_pinctrl_workers;
+
+/* Returns true if packet-ins for 'opcode' can be processed by a worker,
+ * i.e. if their handler only accesses state shared with the main thread
+ * under 'pinctrl_mutex', or no state at all. */
+static bool
+pinctrl_worker_opcode(uint32_t opcode)
+{
+    switch (opcode) {
+    case ACTION_OPCODE_ARP:
+    case ACTION_OPCODE_PUT_ARP:
+    case ACTION_OPCODE_DHCP_RELAY_REQ_CHK:
+    case ACTION_OPCODE_DHCP_RELAY_RESP_CHK:
+    case ACTION_OPCODE_PUT_DHCP_OPTS:
+    case ACTION_OPCODE_ND_NA:
+    case ACTION_OPCODE_ND_NA_ROUTER:
+    case ACTION_OPCODE_PUT_ND:
+    case ACTION_OPCODE_PUT_FDB:
+    case ACTION_OPCODE_PUT_DHCPV6_OPTS:
+    case ACTION_OPCODE_DNS_LOOKUP:
+    case ACTION_OPCODE_LOG:
+    case ACTION_OPCODE_PUT_ND_RA_OPTS:
+    case ACTION_OPCODE_ND_NS:
+    case ACTION_OPCODE_ICMP:
+    case ACTION_OPCODE_ICMP4_ERROR:
+    case ACTION_OPCODE_ICMP6_ERROR:
+    case ACTION_OPCODE_TCP_RESET:
+    case ACTION_OPCODE_SCTP_ABORT:
+    case ACTION_OPCODE_REJECT:
+    case ACTION_OPCODE_PUT_ICMP4_FRAG_MTU:
+    case ACTION_OPCODE_PUT_ICMP6_FRAG_MTU:
+        return true;
+    default:
+        /* IGMP, service monitors, BFD, etc. use state that belongs to the
+         * pinctrl_handler thread. */
+        return false;
+    }
+}
+
+static void
+pinctrl_worker_process(struct pinctrl_worker *w)
+{
+    struct ovs_list msgs;
+    struct ofpbuf *msg;
+
+    guarded_list_pop_all(&w->packet_ins, &msgs);
+    LIST_FOR_EACH_POP (msg, list_node, &msgs) {
+        process_packet_in(w->swconn, msg->data);
+        ofpbuf_delete(msg);
+    }
+}
+
+static void *
+pinctrl_worker_main(void *arg)
+{
+    struct pinctrl_worker *w = arg;
+
+    while (!latch_is_set(&w->exit)) {
+        uint64_t seq = seq_read(w->seq);
+
+        pinctrl_worker_process(w);
+
+        seq_wait(w->seq, seq);
+        latch_wait(&w->exit);
+        poll_block();
+    }
+    return NULL;
+}
+
+/* Stops the current workers and starts 'n' new ones.  The packet-ins left in
+ * the queues of the stopped workers are processed by the caller. */
+static void
+pinctrl_workers_set(struct rconn *swconn, size_t n)
+{
+    for (size_t i = 0; i < n_pinctrl_workers; i++) {
+        struct pinctrl_worker *w = &pinctrl_workers[i];
+
+        latch_set(&w->exit);
+        xpthread_join(w->thread, NULL);
+        pinctrl_worker_process(w);
+        latch_destroy(&w->exit);
+        seq_destroy(w->seq);
+        guarded_list_destroy(&w->packet_ins);
+    }
+    free(pinctrl_workers);
+    pinctrl_workers = NULL;
+    n_pinctrl_workers = 0;
+
+    if (!n) {
+        return;
+    }
+
+    VLOG_INFO("using %"PRIuSIZE" packet-in worker threads", n);
+    pinctrl_workers = xcalloc(n, sizeof *pinctrl_workers);
+    n_pinctrl_workers = n;
+    for (size_t i = 0; i < n; i++) {
+        struct pinctrl_worker *w = &pinctrl_workers[i];
+
+        latch_init(&w->exit);
+        w->seq = seq_create();
+        guarded_list_init(&w->packet_ins);
+        w->swconn = swconn;
+        w->thread = ovs_thread_create("ovn_pinctrl_worker",
+                                      pinctrl_worker_main, w);
+    }
+}
+
+/* Extracts from the packet-in 'oh' the opcode of the action that sent it
+ * to the controller and its datapath's tunnel key.  Returns false if 'oh'
+ * wasn't sent by an OVN action, i.e. if process_packet_in() ignores it. */
+static bool
+pinctrl_pin_decode_opcode(const struct ofp_header *oh, uint32_t *opcode,
+                          uint64_t *dp_key)
+{
+    struct ofputil_packet_in pin;
+    if (ofputil_decode_packet_in(oh, true, NULL, NULL, &pin,
+                                 NULL, NULL, NULL)
+        || pin.reason != OFPR_ACTION) {
+        return false;
+    }
+
+    struct ofpbuf userdata = ofpbuf_const_initializer(pin.userdata,
+                                                      pin.userdata_len);
+    const struct action_header *ah = ofpbuf_pull(&userdata, sizeof *ah);
+    if (!ah) {
+        return false;
+    }
+
+    *opcode = ntohl(ah->opcode);
+    *dp_key = ntohll(pin.flow_metadata.flow.metadata);
+    return true;
+}
+
+/* Hands the packet-in 'msg', for 'opcode' on datapath 'dp_key', to a worker,
+ * if possible, and returns true.  Otherwise returns false and the caller
+ * keeps the ownership of 'msg'. */
+static bool
+pinctrl_workers_dispatch(struct ofpbuf *msg, uint32_t opcode, uint64_t dp_key)
+{
+    if (!n_pinctrl_workers || !pinctrl_worker_opcode(opcode)) {
+        return false;
+    }
+
+    struct pinctrl_worker *w =
+        &pinctrl_workers[hash_uint64(dp_key) % n_pinctrl_workers];
+
+    COVERAGE_INC(pinctrl_total_pin_pkts);
+    if (!guarded_list_push_back(&w->packet_ins, &msg->list_node,
+                                PINCTRL_WORKER_MAX_QUEUE)) {
+        COVERAGE_INC(pinctrl_drop_worker_pin_pkts);
+        ofpbuf_delete(msg);
+    } else {
+        seq_change(w->seq);
+    }
+    return true;
+}
+
+/* Packet-ins read by pinctrl_handler() are queued by class, so that the ones
+ * that keep liveness checks and active flows going aren't stuck behind
+ * floods of DHCP requests, ICMP errors and the like:
+ *
+ *   - Urgent packet-ins are all processed as soon as they are read.
+ *
+ *   - Bulk packet-ins are processed at most PINCTRL_BULK_BATCH per
+ *     iteration of pinctrl_handler(), which may read more of them, up to
+ *     PINCTRL_MAX_RECV messages in all.  Beyond PINCTRL_BULK_MAX_QUEUE
+ *     queued, new bulk packet-ins are dropped. */
+enum pinctrl_pin_class {
+    PINCTRL_PIN_URGENT,
+    PINCTRL_PIN_BULK,
+    PINCTRL_N_PIN_CLASSES
+};
+
+#define PINCTRL_MAX_RECV 500
+#define PINCTRL_BULK_BATCH 50
+#define PINCTRL_BULK_MAX_QUEUE 1024
+
+/* Only accessed by the pinctrl_handler thread. */
+static struct ovs_list pinctrl_pin_queues[PINCTRL_N_PIN_CLASSES] = {
+    OVS_LIST_INITIALIZER(&pinctrl_pin_queues[PINCTRL_PIN_URGENT]),
+    OVS_LIST_INITIALIZER(&pinctrl_pin_queues[PINCTRL_PIN_BULK]),
+};
+static size_t pinctrl_n_bulk_pins;
+
+static enum pinctrl_pin_class
+pinctrl_pin_class(uint32_t opcode)
+{
+    switch (opcode) {
+    case ACTION_OPCODE_BFD_MSG:
+    case ACTION_OPCODE_HANDLE_SVC_CHECK:
+    case ACTION_OPCODE_PUT_ARP:
+    case ACTION_OPCODE_PUT_ND:
+    case ACTION_OPCODE_PUT_FDB:
+    case ACTION_OPCODE_BIND_VPORT:
+    case ACTION_OPCODE_ACTIVATION_STRATEGY_RARP:
+    case ACTION_OPCODE_ACTIVATE_DATAPATH:
+        return PINCTRL_PIN_URGENT;
+    default:
+        return PINCTRL_PIN_BULK;
+    }
+}
+
+/* Takes the ownership of the packet-in 'msg' and queues it according to its
+ * class, unless a worker takes it or it must be dropped. */
+static void
+pinctrl_pin_enqueue(struct ofpbuf *msg)
+{
+    enum pinctrl_pin_class class = PINCTRL_PIN_BULK;
+    uint32_t opcode;
+    uint64_t dp_key;
+
+    if (pinctrl_pin_decode_opcode(msg->data, &opcode, &dp_key)) {
+        if (pinctrl_workers_dispatch(msg, opcode, dp_key)) {
+            return;
+        }
+        class = pinctrl_pin_class(opcode);
+    }
+
+    if (class == PINCTRL_PIN_URGENT) {
+        COVERAGE_INC(pinctrl_urgent_pin_pkts);
+    } else if (pinctrl_n_bulk_pins >= PINCTRL_BULK_MAX_QUEUE) {
+        COVERAGE_INC(pinctrl_drop_bulk_pin_pkts);
+        ofpbuf_delete(msg);
+        return;
+    } else {
+        pinctrl_n_bulk_pins++;
+    }
+    ovs_list_push_back(&pinctrl_pin_queues[class], &msg->list_node);
+}
+
+/* Processes all the queued urgent packet-ins, then up to 'max_bulk' bulk
+ * ones. */
+static void
+pinctrl_pin_queues_run(struct rconn *swconn, size_t max_bulk)
+{
+    struct ofpbuf *msg;
+
+    LIST_FOR_EACH_POP (msg, list_node,
+                       &pinctrl_pin_queues[PINCTRL_PIN_URGENT]) {
+        pinctrl_recv(swconn, msg->data, OFPTYPE_PACKET_IN);
+        ofpbuf_delete(msg);
+    }
+
+    struct ovs_list *bulk = &pinctrl_pin_queues[PINCTRL_PIN_BULK];
+    for (size_t i = 0; i < max_bulk && !ovs_list_is_empty(bulk); i++) {
+        msg = CONTAINER_OF(ovs_list_pop_front(bulk), struct ofpbuf,
+                           list_node);
+        pinctrl_n_bulk_pins--;
+        pinctrl_recv(swconn, msg->data, OFPTYPE_PACKET_IN);
+        ofpbuf_delete(msg);
+    }
+}
+
+/* Drops the queued packet-ins, e.g. because the connection they came from
+ * is gone, along with the switch state their continuations refer to. */
+static void
+pinctrl_pin_queues_flush(void)
+{
+    for (size_t i = 0; i < PINCTRL_N_PIN_CLASSES; i++) {
+        struct ofpbuf *msg;
+
+        LIST_FOR_EACH_POP (msg, list_node, &pinctrl_pin_queues[i]) {
+            ofpbuf_delete(msg);
+        }
+    }
+    pinctrl_n_bulk_pins = 0;
+}
+
 /* pinctrl_handler pthread function. */
 static void *
 pinctrl_handler(void *arg_)
@@ -4009,17 +4838,25 @@ pinctrl_handler(void *arg_)
 
         ovs_mutex_lock(&pinctrl_mutex);
         ip_mcast_snoop_run();
+        size_t n_workers = pctrl->n_workers;
         ovs_mutex_unlock(&pinctrl_mutex);
 
+        if (n_workers != n_pinctrl_workers) {
+            pinctrl_workers_set(swconn, n_workers);
+        }
+
         rconn_run(swconn);
         new_seq = seq_read(pinctrl_handler_seq);
         if (rconn_is_connected(swconn)) {
             if (conn_seq_no != rconn_get_connection_seqno(swconn)) {
+                pinctrl_pin_queues_flush();
                 pinctrl_setup(swconn);
                 conn_seq_no = rconn_get_connection_seqno(swconn);
             }
 
-            for (int i = 0; i < 50; i++) {
+            /* Reads ahead of the bulk packet-ins being processed, to find
+             * the urgent ones that follow them. */
+            for (int i = 0; i < PINCTRL_MAX_RECV; i++) {
                 struct ofpbuf *msg = rconn_recv(swconn);
                 if (!msg) {
                     break;
@@ -4029,9 +4866,14 @@ pinctrl_handler(void *arg_)
                 enum ofptype type;
 
                 ofptype_decode(&type, oh);
+                if (type == OFPTYPE_PACKET_IN) {
+                    pinctrl_pin_enqueue(msg);
+                    continue;
+                }
                 pinctrl_recv(swconn, oh, type);
                 ofpbuf_delete(msg);
             }
+            pinctrl_pin_queues_run(swconn, PINCTRL_BULK_BATCH);
 
             if (may_inject_pkts()) {
                 ovs_mutex_lock(&pinctrl_mutex);
@@ -4059,12 +4901,17 @@ pinctrl_handler(void *arg_)
             svc_monitors_wait(svc_monitors_next_run_time);
             ipv6_prefixd_wait(send_prefixd_time);
             bfd_monitor_wait(bfd_time);
+            if (pinctrl_n_bulk_pins) {
+                poll_immediate_wake();
+            }
         }
         seq_wait(pinctrl_handler_seq, new_seq);
 
         latch_wait(&pctrl->pinctrl_thread_exit);
         poll_block();
     }
+    pinctrl_pin_queues_flush();
+    pinctrl_workers_set(swconn, 0);
 
     return NULL;
 }
@@ -4145,20 +4992,65 @@ pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
             struct ovsdb_idl_index *sbrec_igmp_groups,
             struct ovsdb_idl_index *sbrec_ip_multicast_opts,
             struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+            struct ovsdb_idl_index *sbrec_service_monitor_by_lport,
             const struct sbrec_dns_table *dns_table,
             const struct sbrec_controller_event_table *ce_table,
             const struct sbrec_service_monitor_table *svc_mon_table,
             const struct sbrec_mac_binding_table *mac_binding_table,
             const struct sbrec_bfd_table *bfd_table,
+            const struct sbrec_port_binding_table *pb_table,
             const struct ovsrec_bridge *br_int,
             const struct sbrec_chassis *chassis,
             const struct hmap *local_datapaths,
+            const struct lazy_datapaths *lazy_dps,
             const struct sset *active_tunnels,
             const struct shash *local_active_ports_ipv6_pd,
             const struct shash *local_active_ports_ras,
             const struct ovsrec_open_vswitch_table *ovs_table)
 {
+    const struct ovsrec_open_vswitch *cfg =
+        ovsrec_open_vswitch_table_first(ovs_table);
+    size_t n_workers = cfg ? MIN(smap_get_uint(&cfg->external_ids,
+                                               "ovn-pinctrl-threads", 0), 64)
+                           : 0;
+
+    unsigned int pin_rate_cfg = 0;
+    unsigned int pin_burst_cfg = 0;
+    if (cfg) {
+        pin_rate_cfg = MIN(smap_get_uint(&cfg->external_ids,
+                                         "ovn-pinctrl-datapath-rate", 0),
+                           UINT_MAX / PINCTRL_PIN_TOKENS);
+        pin_burst_cfg = smap_get_uint(&cfg->external_ids,
+                                      "ovn-pinctrl-datapath-burst",
+                                      pin_rate_cfg);
+    }
+    pinctrl_pin_rate_limit_set(pin_rate_cfg, MAX(pin_burst_cfg, 1));
+
     ovs_mutex_lock(&pinctrl_mutex);
+    if (n_workers != pinctrl.n_workers) {
+        pinctrl.n_workers = n_workers;
+        notify_pinctrl_handler();
+    }
+    if (cfg) {
+        pinctrl.mac_binding_coalesce_ms =
+            smap_get_uint(&cfg->external_ids,
+                          "ovn-mac-binding-coalesce-interval", 0);
+        pinctrl.mac_binding_max_batch =
+            smap_get_uint(&cfg->external_ids, "ovn-mac-binding-max-batch", 0);
+        pinctrl.mac_binding_max_batch_per_dp =
+            smap_get_uint(&cfg->external_ids,
+                          "ovn-mac-binding-max-batch-per-datapath", 0);
+        buffered_packets_ctx_set_max_bytes(
+            &buffered_packets_ctx,
+            smap_get_ullong(&cfg->external_ids,
+                            "ovn-memlimit-buffered-packets-kb",
+                            BUFFERED_PACKETS_DEFAULT_MEMLIMIT_KB) * 1024);
+        pinctrl.svc_monitor_status_holddown_ms =
+            smap_get_uint(&cfg->external_ids,
+                          "ovn-svc-monitor-status-holddown", 0);
+        pinctrl.svc_monitor_max_batch =
+            smap_get_uint(&cfg->external_ids, "ovn-svc-monitor-max-batch", 0);
+    }
     run_put_mac_bindings(ovnsb_idl_txn, sbrec_datapath_binding_by_key,
                          sbrec_port_binding_by_key,
                          sbrec_mac_binding_by_lport_ip);
@@ -4183,8 +5075,10 @@ pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
                          sbrec_datapath_binding_by_key,
                          sbrec_port_binding_by_name,
                          sbrec_mac_binding_by_lport_ip);
-    sync_svc_monitors(ovnsb_idl_txn, svc_mon_table, sbrec_port_binding_by_name,
-                      chassis);
+    run_lazy_dp_buffered_packets(local_datapaths, lazy_dps);
+    sync_svc_monitors(ovnsb_idl_txn, svc_mon_table, pb_table,
+                      sbrec_port_binding_by_name,
+                      sbrec_service_monitor_by_lport, chassis);
     bfd_monitor_run(ovnsb_idl_txn, bfd_table, sbrec_port_binding_by_name,
                     chassis, active_tunnels);
     run_put_fdbs(ovnsb_idl_txn, sbrec_port_binding_by_key,
@@ -4695,10 +5589,35 @@ pinctrl_wait(struct ovsdb_idl_txn *ovnsb_idl_txn)
     seq_wait(pinctrl_main_seq, new_seq);
     wait_put_fdbs(ovnsb_idl_txn);
     wait_activated_ports();
+    wait_datapaths_to_activate();
+    wait_svc_monitors_status(ovnsb_idl_txn);
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
+/* Called by ovn-controller when the SB changes tracked in the current
+ * iteration of its main loop won't be seen by pinctrl_run(), either because
+ * it doesn't run in this iteration or because the SB IDL reconnected.  The
+ * state that pinctrl maintains incrementally is then fully resynchronized
+ * by the next pinctrl_run(). */
+void
+pinctrl_force_resync(void)
+{
+    ovs_mutex_lock(&pinctrl_mutex);
+    resync_svc_monitors();
     ovs_mutex_unlock(&pinctrl_mutex);
 }
 
 /* Called by ovn-controller. */
+void
+pinctrl_get_memory_usage(struct simap *usage)
+{
+    ovs_mutex_lock(&pinctrl_mutex);
+    buffered_packets_ctx_get_memory_usage(&buffered_packets_ctx, usage);
+    buffered_packets_ctx_get_memory_usage(&lazy_dp_buffered_packets_ctx,
+                                          usage);
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
 void
 pinctrl_destroy(void)
 {
@@ -4711,10 +5630,13 @@ pinctrl_destroy(void)
     destroy_ipv6_prefixd();
     destroy_buffered_packets_ctx();
     destroy_activated_ports();
+    destroy_datapaths_to_activate();
     event_table_destroy();
     destroy_put_mac_bindings();
     destroy_put_vport_bindings();
     destroy_dns_cache();
+    destroy_dhcp_reply_templates();
+    destroy_pin_stats();
     ip_mcast_snoop_destroy();
     destroy_svc_monitors();
     bfd_monitor_destroy();
@@ -4762,11 +5684,6 @@ pinctrl_handle_put_mac_binding(const struct flow *md,
                                bool is_arp)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    if (hmap_count(&put_mac_bindings) >= MAX_MAC_BINDINGS) {
-        COVERAGE_INC(pinctrl_drop_put_mac_binding);
-        return;
-    }
-
     struct mac_binding_data mb_data = (struct mac_binding_data) {
             .dp_key =  ntohll(md->metadata),
             .port_key =  md->regs[MFF_LOG_INPORT - MFF_REG0],
@@ -4780,11 +5697,27 @@ pinctrl_handle_put_mac_binding(const struct flow *md,
         memcpy(&mb_data.ip, &ip6, sizeof mb_data.ip);
     }
 
+    /* A binding for the same IP is already waiting to be written: only
+     * update its MAC, without postponing it, so that a burst of replies
+     * results in a single write. */
+    struct mac_binding *mb = mac_binding_find(&put_mac_bindings, &mb_data);
+    if (mb) {
+        COVERAGE_INC(pinctrl_coalesce_put_mac_binding);
+        mb->data = mb_data;
+        return;
+    }
+
+    if (hmap_count(&put_mac_bindings) >= MAX_MAC_BINDINGS) {
+        COVERAGE_INC(pinctrl_drop_put_mac_binding);
+        return;
+    }
+
     /* If the ARP reply was unicast we should not delay it,
      * there won't be any race. */
     uint32_t delay = eth_addr_is_multicast(headers->dl_dst)
                      ? random_range(MAX_MAC_BINDING_DELAY_MSEC) + 1
                      : 0;
+    delay = MAX(delay, pinctrl.mac_binding_coalesce_ms);
     long long timestamp = time_msec() + delay;
     mac_binding_add(&put_mac_bindings, mb_data, timestamp);
 
@@ -4802,14 +5735,19 @@ send_mac_binding_buffered_pkts(struct rconn *swconn)
     enum ofp_version version = rconn_get_version(swconn);
     enum ofputil_protocol proto = ofputil_protocol_from_ofp_version(version);
 
-    struct bp_packet_data *pd;
-    LIST_FOR_EACH_POP (pd, node, &buffered_packets_ctx.ready_packets_data) {
-        queue_msg(swconn, ofputil_encode_resume(&pd->pin, pd->continuation,
-                                                proto));
-        bp_packet_data_destroy(pd);
-    }
+    struct buffered_packets_ctx *ctxs[] = {
+        &buffered_packets_ctx, &lazy_dp_buffered_packets_ctx,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(ctxs); i++) {
+        struct bp_packet_data *pd;
+        LIST_FOR_EACH_POP (pd, node, &ctxs[i]->ready_packets_data) {
+            queue_msg(swconn, ofputil_encode_resume(&pd->pin,
+                                                    pd->continuation, proto));
+            bp_packet_data_destroy(pd);
+        }
 
-    ovs_list_init(&buffered_packets_ctx.ready_packets_data);
+        ovs_list_init(&ctxs[i]->ready_packets_data);
+    }
 }
 
 /* Update or add an IP-MAC binding for 'logical_port'.
@@ -4923,8 +5861,51 @@ run_put_mac_binding(struct ovsdb_idl_txn *ovnsb_idl_txn,
     ds_destroy(&ip_s);
 }
 
+static int
+compare_mac_bindings_by_timestamp(const void *a_, const void *b_)
+{
+    const struct mac_binding *const *a = a_;
+    const struct mac_binding *const *b = b_;
+
+    return ((*a)->timestamp > (*b)->timestamp)
+           - ((*a)->timestamp < (*b)->timestamp);
+}
+
+/* Number of MAC bindings written for a datapath, in the current batch. */
+struct mac_binding_dp_count {
+    struct hmap_node hmap_node;
+    uint32_t dp_key;
+    size_t n;
+};
+
+static struct mac_binding_dp_count *
+mac_binding_dp_count_get(struct hmap *counts, uint32_t dp_key)
+{
+    uint32_t hash = hash_int(dp_key, 0);
+    struct mac_binding_dp_count *c;
+
+    HMAP_FOR_EACH_WITH_HASH (c, hmap_node, hash, counts) {
+        if (c->dp_key == dp_key) {
+            return c;
+        }
+    }
+
+    c = xmalloc(sizeof *c);
+    c->dp_key = dp_key;
+    c->n = 0;
+    hmap_insert(counts, &c->hmap_node, hash);
+    return c;
+}
+
 /* Called by pinctrl_run(). Runs with in the main ovn-controller
- * thread context. */
+ * thread context.
+ *
+ * Writes the buffered MAC bindings that are due to the Southbound database.
+ * If external_ids:ovn-mac-binding-max-batch and
+ * external_ids:ovn-mac-binding-max-batch-per-datapath are set, at most that
+ * many bindings, respectively in total and for a given datapath, are written
+ * in a single transaction, the oldest ones first, and the rest are kept for
+ * the next transaction. */
 static void
 run_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn,
                      struct ovsdb_idl_index *sbrec_datapath_binding_by_key,
@@ -4932,22 +5913,60 @@ run_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn,
                      struct ovsdb_idl_index *sbrec_mac_binding_by_lport_ip)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    if (!ovnsb_idl_txn) {
+    if (!ovnsb_idl_txn || hmap_is_empty(&put_mac_bindings)) {
         return;
     }
 
     long long now = time_msec();
-
+    size_t max_batch = pinctrl.mac_binding_max_batch
+                       ? pinctrl.mac_binding_max_batch : SIZE_MAX;
+    size_t max_batch_per_dp = pinctrl.mac_binding_max_batch_per_dp
+                              ? pinctrl.mac_binding_max_batch_per_dp
+                              : SIZE_MAX;
+
+    struct mac_binding **due = xmalloc(hmap_count(&put_mac_bindings)
+                                       * sizeof *due);
+    size_t n_due = 0;
     struct mac_binding *mb;
-    HMAP_FOR_EACH_SAFE (mb, hmap_node, &put_mac_bindings) {
+    HMAP_FOR_EACH (mb, hmap_node, &put_mac_bindings) {
         if (now >= mb->timestamp) {
-            run_put_mac_binding(ovnsb_idl_txn,
-                                sbrec_datapath_binding_by_key,
-                                sbrec_port_binding_by_key,
-                                sbrec_mac_binding_by_lport_ip, mb);
-            mac_binding_remove(&put_mac_bindings, mb);
+            due[n_due++] = mb;
         }
     }
+
+    bool limited = max_batch < n_due || max_batch_per_dp < n_due;
+    if (limited) {
+        qsort(due, n_due, sizeof *due, compare_mac_bindings_by_timestamp);
+    }
+
+    struct hmap dp_counts = HMAP_INITIALIZER(&dp_counts);
+    size_t n_written = 0;
+    for (size_t i = 0; i < n_due; i++) {
+        mb = due[i];
+        if (limited) {
+            struct mac_binding_dp_count *c =
+                mac_binding_dp_count_get(&dp_counts, mb->data.dp_key);
+            if (n_written >= max_batch || c->n >= max_batch_per_dp) {
+                COVERAGE_INC(pinctrl_defer_put_mac_binding);
+                continue;
+            }
+            c->n++;
+        }
+
+        run_put_mac_binding(ovnsb_idl_txn,
+                            sbrec_datapath_binding_by_key,
+                            sbrec_port_binding_by_key,
+                            sbrec_mac_binding_by_lport_ip, mb);
+        mac_binding_remove(&put_mac_bindings, mb);
+        n_written++;
+    }
+
+    struct mac_binding_dp_count *c;
+    HMAP_FOR_EACH_POP (c, hmap_node, &dp_counts) {
+        free(c);
+    }
+    hmap_destroy(&dp_counts);
+    free(due);
 }
 
 static void
@@ -5023,6 +6042,95 @@ wait_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn)
     }
 }
 
+
+/* Deadlines of the periodic senders run by pinctrl_handler (GARP/RARP,
+ * service monitors and BFD).
+ *
+ * Each sender keeps its scheduled entries in a heap ordered by deadline, so
+ * that a wakeup only processes the entries that are due instead of all of
+ * them, and the next wakeup time is the deadline at the top of the heap.  As
+ * heap.h is a max-heap, the priority is inverted. */
+struct pinctrl_timer {
+    struct heap_node heap_node;
+    long long int when;         /* LLONG_MAX if not scheduled. */
+};
+
+static void
+pinctrl_timer_init(struct pinctrl_timer *t)
+{
+    t->when = LLONG_MAX;
+}
+
+static struct pinctrl_timer *
+pinctrl_timer_from_heap_node(const struct heap_node *node)
+{
+    return CONTAINER_OF(node, struct pinctrl_timer, heap_node);
+}
+
+static void
+pinctrl_timer_cancel(struct heap *timers, struct pinctrl_timer *t)
+{
+    if (t->when != LLONG_MAX) {
+        heap_remove(timers, &t->heap_node);
+        t->when = LLONG_MAX;
+    }
+}
+
+/* Schedules 't' in 'timers' to expire at 'when', or cancels it if 'when' is
+ * LLONG_MAX. */
+static void
+pinctrl_timer_set(struct heap *timers, struct pinctrl_timer *t,
+                  long long int when)
+{
+    if (when == LLONG_MAX) {
+        pinctrl_timer_cancel(timers, t);
+    } else if (t->when == LLONG_MAX) {
+        t->when = when;
+        heap_insert(timers, &t->heap_node, UINT64_MAX - when);
+    } else if (t->when != when) {
+        t->when = when;
+        heap_change(timers, &t->heap_node, UINT64_MAX - when);
+    }
+}
+
+/* Returns the earliest deadline in 'timers', or LLONG_MAX if it is empty. */
+static long long int
+pinctrl_timers_next(const struct heap *timers)
+{
+    return (heap_is_empty(timers)
+            ? LLONG_MAX
+            : pinctrl_timer_from_heap_node(heap_max(timers))->when);
+}
+
+/* Removes from 'timers' the timers that are due at 'now' and returns them in
+ * an array of '*n_due' elements that the caller must free.  The caller is
+ * expected to reschedule them as needed.  Collecting them before processing
+ * them makes sure that a timer rescheduled to 'now' is not processed twice in
+ * the same run. */
+static struct pinctrl_timer **
+pinctrl_timers_pop_due(struct heap *timers, long long int now, size_t *n_due)
+{
+    struct pinctrl_timer **due = NULL;
+    size_t allocated = 0;
+
+    *n_due = 0;
+    while (!heap_is_empty(timers)) {
+        struct pinctrl_timer *t =
+            pinctrl_timer_from_heap_node(heap_max(timers));
+        if (t->when > now) {
+            break;
+        }
+
+        heap_pop(timers);
+        t->when = LLONG_MAX;
+        if (*n_due >= allocated) {
+            due = x2nrealloc(due, &allocated, sizeof *due);
+        }
+        due[(*n_due)++] = t;
+    }
+    return due;
+}
+
 
 /*
  * Send gratuitous/reverse ARP for vif on localnet.
@@ -5035,7 +6143,8 @@ wait_put_mac_bindings(struct ovsdb_idl_txn *ovnsb_idl_txn)
 struct garp_rarp_data {
     struct eth_addr ea;          /* Ethernet address of port. */
     ovs_be32 ipv4;               /* Ipv4 address of port. */
-    long long int announce_time; /* Next announcement in ms. */
+    struct pinctrl_timer timer;  /* Next announcement, in
+                                  * 'send_garp_rarp_timers'. */
     int backoff;                 /* Backoff timeout for the next
                                   * announcement (in msecs). */
     uint32_t dp_key;             /* Datapath used to output this GARP. */
@@ -5044,17 +6153,30 @@ struct garp_rarp_data {
 
 /* Contains GARPs/RARPs to be sent. Protected by pinctrl_mutex*/
 static struct shash send_garp_rarp_data;
+/* GARPs/RARPs of 'send_garp_rarp_data' that have an announcement scheduled.
+ * Protected by pinctrl_mutex. */
+static struct heap send_garp_rarp_timers;
 
 static void
 init_send_garps_rarps(void)
 {
     shash_init(&send_garp_rarp_data);
+    heap_init(&send_garp_rarp_timers);
 }
 
 static void
 destroy_send_garps_rarps(void)
 {
     shash_destroy_free_data(&send_garp_rarp_data);
+    heap_destroy(&send_garp_rarp_timers);
+}
+
+static void
+send_garp_rarp_schedule(struct garp_rarp_data *garp_rarp,
+                        long long int announce_time)
+{
+    pinctrl_timer_set(&send_garp_rarp_timers, &garp_rarp->timer,
+                      announce_time);
 }
 
 /* Runs with in the main ovn-controller thread context. */
@@ -5065,10 +6187,11 @@ add_garp_rarp(const char *name, const struct eth_addr ea, ovs_be32 ip,
     struct garp_rarp_data *garp_rarp = xmalloc(sizeof *garp_rarp);
     garp_rarp->ea = ea;
     garp_rarp->ipv4 = ip;
-    garp_rarp->announce_time = time_msec() + 1000;
     garp_rarp->backoff = 1000; /* msec. */
     garp_rarp->dp_key = dp_key;
     garp_rarp->port_key = port_key;
+    pinctrl_timer_init(&garp_rarp->timer);
+    send_garp_rarp_schedule(garp_rarp, time_msec() + 1000);
     shash_add(&send_garp_rarp_data, name, garp_rarp);
 
     /* Notify pinctrl_handler so that it can wakeup and process
@@ -5086,7 +6209,7 @@ send_garp_rarp_update(struct ovsdb_idl_txn *ovnsb_idl_txn,
                       long long int garp_max_timeout,
                       bool garp_continuous)
 {
-    volatile struct garp_rarp_data *garp_rarp = NULL;
+    struct garp_rarp_data *garp_rarp = NULL;
 
     /* Skip localports as they don't need to be announced */
     if (!strcmp(binding_rec->type, "localport")) {
@@ -5113,7 +6236,8 @@ send_garp_rarp_update(struct ovsdb_idl_txn *ovnsb_idl_txn,
                     if (garp_max_timeout != garp_rarp_max_timeout ||
                         garp_continuous != garp_rarp_continuous) {
                         /* reset backoff */
-                        garp_rarp->announce_time = time_msec() + 1000;
+                        send_garp_rarp_schedule(garp_rarp,
+                                                time_msec() + 1000);
                         garp_rarp->backoff = 1000; /* msec. */
                     }
                 } else if (ovnsb_idl_txn) {
@@ -5143,7 +6267,8 @@ send_garp_rarp_update(struct ovsdb_idl_txn *ovnsb_idl_txn,
                         if (garp_max_timeout != garp_rarp_max_timeout ||
                             garp_continuous != garp_rarp_continuous) {
                             /* reset backoff */
-                            garp_rarp->announce_time = time_msec() + 1000;
+                            send_garp_rarp_schedule(garp_rarp,
+                                                    time_msec() + 1000);
                             garp_rarp->backoff = 1000; /* msec. */
                         }
                     } else {
@@ -5168,7 +6293,7 @@ send_garp_rarp_update(struct ovsdb_idl_txn *ovnsb_idl_txn,
         if (garp_max_timeout != garp_rarp_max_timeout ||
             garp_continuous != garp_rarp_continuous) {
             /* reset backoff */
-            garp_rarp->announce_time = time_msec() + 1000;
+            send_garp_rarp_schedule(garp_rarp, time_msec() + 1000);
             garp_rarp->backoff = 1000; /* msec. */
         }
         return;
@@ -5207,20 +6332,19 @@ send_garp_rarp_delete(const char *lport)
 {
     struct garp_rarp_data *garp_rarp = shash_find_and_delete
                                        (&send_garp_rarp_data, lport);
+    if (garp_rarp) {
+        pinctrl_timer_cancel(&send_garp_rarp_timers, &garp_rarp->timer);
+    }
     free(garp_rarp);
     notify_pinctrl_handler();
 }
 
 /* Called with in the pinctrl_handler thread context. */
-static long long int
+static void
 send_garp_rarp(struct rconn *swconn, struct garp_rarp_data *garp_rarp,
                long long int current_time)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    if (current_time < garp_rarp->announce_time) {
-        return garp_rarp->announce_time;
-    }
-
     /* Compose a GARP request packet. */
     uint64_t packet_stub[128 / 8];
     struct dp_packet packet;
@@ -5259,13 +6383,9 @@ send_garp_rarp(struct rconn *swconn, struct garp_rarp_data *garp_rarp,
      * vif if garp_rarp_max_timeout is not specified otherwise cap the max
      * timeout to garp_rarp_max_timeout. */
     if (garp_rarp_continuous || garp_rarp->backoff < garp_rarp_max_timeout) {
-        garp_rarp->announce_time = current_time + garp_rarp->backoff;
-    } else {
-        garp_rarp->announce_time = LLONG_MAX;
+        send_garp_rarp_schedule(garp_rarp, current_time + garp_rarp->backoff);
     }
     garp_rarp->backoff = MIN(garp_rarp_max_timeout, garp_rarp->backoff * 2);
-
-    return garp_rarp->announce_time;
 }
 
 static void
@@ -5360,6 +6480,16 @@ struct ip_mcast_snoop {
     int64_t dp_key;                /* Datapath running the snooping. */
 
     long long int query_time_ms;   /* Next query time in ms. */
+
+    bool groups_changed;           /* True if the groups or mrouters changed
+                                    * since ip_mcast_sync() last took the
+                                    * changes.  Written by pinctrl_handler
+                                    * and taken by pinctrl_main, under
+                                    * 'ms->rwlock' when packets update the
+                                    * groups and under 'pinctrl_mutex'
+                                    * otherwise. */
+    bool sync_groups;              /* Only used by ip_mcast_sync(), true if
+                                    * it has to write the groups. */
 };
 
 /*
@@ -5651,6 +6781,7 @@ ip_mcast_snoop_configure(struct ip_mcast_snoop *ip_ms,
 
 set_fields:
     memcpy(&ip_ms->cfg, cfg, sizeof ip_ms->cfg);
+    ip_ms->groups_changed = true;
     return true;
 }
 
@@ -5738,19 +6869,21 @@ ip_mcast_snoop_run(void)
      */
     struct ip_mcast_snoop_state *ip_ms_state;
 
+    bool notify = false;
+
     HMAP_FOR_EACH (ip_ms_state, hmap_node, &mcast_cfg_map) {
         ip_ms = ip_mcast_snoop_find(ip_ms_state->dp_key);
 
         if (!ip_ms) {
             ip_mcast_snoop_add(ip_ms_state->dp_key, &ip_ms_state->cfg);
+            notify = true;
         } else if (memcmp(&ip_ms_state->cfg, &ip_ms->cfg,
                           sizeof ip_ms_state->cfg)) {
             ip_mcast_snoop_configure(ip_ms, &ip_ms_state->cfg);
+            notify = true;
         }
     }
 
-    bool notify = false;
-
     /* Then walk the multicast snoop instances. */
     HMAP_FOR_EACH_SAFE (ip_ms, hmap_node, &mcast_snoop_map) {
 
@@ -5763,6 +6896,9 @@ ip_mcast_snoop_run(void)
         /* If enabled run the snooping instance to timeout old groups. */
         if (ip_ms->cfg.enabled) {
             if (mcast_snooping_run(ip_ms->ms)) {
+                ovs_rwlock_wrlock(&ip_ms->ms->rwlock);
+                ip_ms->groups_changed = true;
+                ovs_rwlock_unlock(&ip_ms->ms->rwlock);
                 notify = true;
             }
 
@@ -5775,6 +6911,29 @@ ip_mcast_snoop_run(void)
     }
 }
 
+/* Returns true if the groups or mrouters of 'ip_ms' changed since the last
+ * call, and clears the change.  The changes that happen afterwards, e.g.
+ * while the groups are written to the SB database, are returned by the next
+ * call. */
+static bool
+ip_mcast_snoop_take_groups_changed(struct ip_mcast_snoop *ip_ms)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    bool changed;
+
+    if (!ip_ms->ms) {
+        changed = ip_ms->groups_changed;
+        ip_ms->groups_changed = false;
+        return changed;
+    }
+
+    ovs_rwlock_wrlock(&ip_ms->ms->rwlock);
+    changed = ip_ms->groups_changed;
+    ip_ms->groups_changed = false;
+    ovs_rwlock_unlock(&ip_ms->ms->rwlock);
+    return changed;
+}
+
 /* Flushes all IGMP_Groups installed by the local chassis for the logical
  * datapath specified by 'dp_key'.
  */
@@ -5799,6 +6958,11 @@ ip_mcast_flush_groups(int64_t dp_key, const struct sbrec_chassis *chassis,
  * database. It reads the IP_Multicast table and updates the local multicast
  * configuration. Then writes to the southbound database the updated
  * IGMP_Groups.
+ *
+ * Only the groups of the datapaths whose snooping state changed are written,
+ * unless the southbound database changed since the last run, e.g. because
+ * the ports of the groups did or because the last transaction failed, in
+ * which case all of them are.
  */
 static void
 ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
@@ -5816,6 +6980,12 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
         return;
     }
 
+    static unsigned int sb_seqno = UINT_MAX;
+    unsigned int new_sb_seqno =
+        ovsdb_idl_get_seqno(ovsdb_idl_txn_get_idl(ovnsb_idl_txn));
+    bool sync_all = sb_seqno != new_sb_seqno;
+    sb_seqno = new_sb_seqno;
+
     struct sbrec_ip_multicast *ip_mcast;
     struct ip_mcast_snoop_state *ip_ms_state;
 
@@ -5845,6 +7015,18 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
         }
     }
 
+    struct ip_mcast_snoop *ip_ms;
+    bool groups_changed = false;
+
+    HMAP_FOR_EACH (ip_ms, hmap_node, &mcast_snoop_map) {
+        ip_ms->sync_groups = ip_mcast_snoop_take_groups_changed(ip_ms)
+                             || sync_all;
+        groups_changed |= ip_ms->sync_groups;
+    }
+    if (!groups_changed) {
+        goto out;
+    }
+
     const struct sbrec_igmp_group *sbrec_ip_mrouter;
     const struct sbrec_igmp_group *sbrec_igmp;
 
@@ -5870,7 +7052,7 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
             continue;
         }
 
-        struct ip_mcast_snoop *ip_ms = ip_mcast_snoop_find(dp_key);
+        ip_ms = ip_mcast_snoop_find(dp_key);
 
         /* If the datapath doesn't exist anymore or IGMP snooping was disabled
          * on it then delete the IGMP_Group entry.
@@ -5880,6 +7062,10 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
             continue;
         }
 
+        if (!ip_ms->sync_groups) {
+            continue;
+        }
+
         if (!strcmp(sbrec_igmp->address, OVN_IGMP_GROUP_MROUTERS)) {
             continue;
         } else if (!ip46_parse(sbrec_igmp->address, &group_addr)) {
@@ -5896,8 +7082,6 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
         ovs_rwlock_unlock(&ip_ms->ms->rwlock);
     }
 
-    struct ip_mcast_snoop *ip_ms;
-
     /* Last: write new IGMP_Groups to the southbound DB and update existing
      * ones (if needed). We also flush any old per-datapath multicast snoop
      * structures.
@@ -5911,8 +7095,9 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
             continue;
         }
 
-        /* Skip datapaths on which snooping is disabled. */
-        if (!ip_ms->cfg.enabled) {
+        /* Skip datapaths on which snooping is disabled or whose groups
+         * didn't change. */
+        if (!ip_ms->cfg.enabled || !ip_ms->sync_groups) {
             continue;
         }
 
@@ -5955,6 +7140,7 @@ ip_mcast_sync(struct ovsdb_idl_txn *ovnsb_idl_txn,
         ovs_rwlock_unlock(&ip_ms->ms->rwlock);
     }
 
+out:
     if (notify) {
         notify_pinctrl_handler();
     }
@@ -6032,6 +7218,9 @@ pinctrl_ip_mcast_handle_igmp(struct rconn *swconn,
                                       port_key_data);
         break;
     }
+    if (group_change) {
+        ip_ms->groups_changed = true;
+    }
     ovs_rwlock_unlock(&ip_ms->ms->rwlock);
 
     /* Forward reports to all registered mrouters and flood queries to
@@ -6091,6 +7280,9 @@ pinctrl_ip_mcast_handle_mld(struct rconn *swconn,
                                    port_key_data);
         break;
     }
+    if (group_change) {
+        ip_ms->groups_changed = true;
+    }
     ovs_rwlock_unlock(&ip_ms->ms->rwlock);
 
     /* Forward reports to all registered mrouters and flood queries to
@@ -6548,17 +7740,19 @@ send_garp_rarp_run(struct rconn *swconn, long long int *send_garp_rarp_time)
         return;
     }
 
-    /* Send GARPs, and update the next announcement. */
-    struct shash_node *iter;
+    /* Send the GARPs that are due, and update the next announcement. */
     long long int current_time = time_msec();
-    *send_garp_rarp_time = LLONG_MAX;
-    SHASH_FOR_EACH (iter, &send_garp_rarp_data) {
-        long long int next_announce = send_garp_rarp(swconn, iter->data,
-                                                     current_time);
-        if (*send_garp_rarp_time > next_announce) {
-            *send_garp_rarp_time = next_announce;
-        }
+    size_t n_due;
+    struct pinctrl_timer **due =
+        pinctrl_timers_pop_due(&send_garp_rarp_timers, current_time, &n_due);
+    for (size_t i = 0; i < n_due; i++) {
+        send_garp_rarp(swconn,
+                       CONTAINER_OF(due[i], struct garp_rarp_data, timer),
+                       current_time);
     }
+    free(due);
+
+    *send_garp_rarp_time = pinctrl_timers_next(&send_garp_rarp_timers);
 }
 
 /* Called by pinctrl_run(). Runs with in the main ovn-controller
@@ -6665,6 +7859,8 @@ may_inject_pkts(void)
             ipv6_prefixd_should_inject() ||
             !ovs_list_is_empty(&mcast_query_list) ||
             buffered_packets_ctx_is_ready_to_send(&buffered_packets_ctx) ||
+            buffered_packets_ctx_is_ready_to_send(
+                &lazy_dp_buffered_packets_ctx) ||
             bfd_monitor_should_inject());
 }
 
@@ -7267,6 +8463,14 @@ struct svc_monitor {
     /* Should be accessed only with in the main ovn-controller
      * thread. */
     const struct sbrec_service_monitor *sb_svc_mon;
+    struct uuid sb_uuid;        /* UUID of 'sb_svc_mon'. */
+    struct hmap_node uuid_node; /* In 'svc_monitors_by_uuid'. */
+
+    /* In 'svc_monitors_status_pending' while 'status' may differ from the
+     * status of 'sb_svc_mon'.  'status_changed_at' is the time at which
+     * 'status' last changed. */
+    struct ovs_list status_node;
+    long long int status_changed_at;
 
     /* key */
     struct in6_addr ip;
@@ -7283,6 +8487,7 @@ struct svc_monitor {
 
     long long int wait_time;
     long long int next_send_time;
+    struct pinctrl_timer timer;  /* Next run, in 'svc_monitors_timers'. */
 
     struct smap options;
     /* The interval, in milli seconds, between service monitor checks. */
@@ -7315,12 +8520,38 @@ struct svc_monitor {
 
 static struct hmap svc_monitors_map;
 static struct ovs_list svc_monitors;
+/* Service monitors that have a run scheduled. */
+static struct heap svc_monitors_timers;
+/* The same service monitors, indexed by the UUID of their SB row. */
+static struct hmap svc_monitors_by_uuid;
+/* Service monitors whose status has to be written to the SB. */
+static struct ovs_list svc_monitors_status_pending;
+/* Whether the next sync_svc_monitors() has to process the whole
+ * Service_Monitor table instead of only its tracked changes. */
+static bool svc_monitors_full_sync;
+static const struct sbrec_chassis *svc_monitors_chassis;
 
 static void
 init_svc_monitors(void)
 {
     hmap_init(&svc_monitors_map);
     ovs_list_init(&svc_monitors);
+    heap_init(&svc_monitors_timers);
+    hmap_init(&svc_monitors_by_uuid);
+    ovs_list_init(&svc_monitors_status_pending);
+    svc_monitors_full_sync = true;
+}
+
+static void
+resync_svc_monitors(void)
+{
+    svc_monitors_full_sync = true;
+}
+
+static void
+svc_monitor_schedule(struct svc_monitor *svc_mon, long long int when)
+{
+    pinctrl_timer_set(&svc_monitors_timers, &svc_mon->timer, when);
 }
 
 static void
@@ -7332,11 +8563,72 @@ destroy_svc_monitors(void)
     }
 
     hmap_destroy(&svc_monitors_map);
+    hmap_destroy(&svc_monitors_by_uuid);
 
     LIST_FOR_EACH_POP (svc, list_node, &svc_monitors) {
         smap_destroy(&svc->options);
         free(svc);
     }
+    heap_destroy(&svc_monitors_timers);
+}
+
+static struct svc_monitor *
+svc_monitor_find_by_uuid(const struct uuid *uuid)
+{
+    struct svc_monitor *svc_mon;
+    HMAP_FOR_EACH_WITH_HASH (svc_mon, uuid_node, uuid_hash(uuid),
+                             &svc_monitors_by_uuid) {
+        if (uuid_equals(&svc_mon->sb_uuid, uuid)) {
+            return svc_mon;
+        }
+    }
+    return NULL;
+}
+
+/* Queues the status of 'svc_mon' to be written to the SB.  The write is
+ * held down until 'changed_at' plus the configured hold-down time. */
+static void
+svc_monitor_status_changed(struct svc_monitor *svc_mon,
+                           long long int changed_at)
+{
+    svc_mon->status_changed_at = changed_at;
+    if (ovs_list_is_empty(&svc_mon->status_node)) {
+        ovs_list_push_back(&svc_monitors_status_pending,
+                           &svc_mon->status_node);
+    }
+}
+
+static void
+svc_monitor_status_done(struct svc_monitor *svc_mon)
+{
+    ovs_list_remove(&svc_mon->status_node);
+    ovs_list_init(&svc_mon->status_node);
+}
+
+static void
+svc_monitor_destroy(struct svc_monitor *svc_mon)
+{
+    hmap_remove(&svc_monitors_map, &svc_mon->hmap_node);
+    hmap_remove(&svc_monitors_by_uuid, &svc_mon->uuid_node);
+    ovs_list_remove(&svc_mon->list_node);
+    ovs_list_remove(&svc_mon->status_node);
+    pinctrl_timer_cancel(&svc_monitors_timers, &svc_mon->timer);
+    smap_destroy(&svc_mon->options);
+    free(svc_mon);
+}
+
+static const char *
+svc_monitor_status_to_string(enum svc_monitor_status status)
+{
+    switch (status) {
+    case SVC_MON_ST_ONLINE:
+        return "online";
+    case SVC_MON_ST_OFFLINE:
+        return "offline";
+    case SVC_MON_ST_UNKNOWN:
+    default:
+        return NULL;
+    }
 }
 
 
@@ -7359,174 +8651,320 @@ pinctrl_find_svc_monitor(uint32_t dp_key, uint32_t port_key,
     return NULL;
 }
 
-static void
-sync_svc_monitors(struct ovsdb_idl_txn *ovnsb_idl_txn,
-                  const struct sbrec_service_monitor_table *svc_mon_table,
-                  struct ovsdb_idl_index *sbrec_port_binding_by_name,
-                  const struct sbrec_chassis *our_chassis)
+/* Creates or updates the service monitor of 'sb_svc_mon' if the latter has
+ * to be handled by 'our_chassis'.  Returns the service monitor, or NULL if
+ * there's none for 'sb_svc_mon'. */
+static struct svc_monitor *
+sync_svc_monitor__(const struct sbrec_service_monitor *sb_svc_mon,
+                   struct ovsdb_idl_index *sbrec_port_binding_by_name,
+                   const struct sbrec_chassis *our_chassis, bool *changed)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    bool changed = false;
-    struct svc_monitor *svc_mon;
+    const struct sbrec_port_binding *pb
+        = lport_lookup_by_name(sbrec_port_binding_by_name,
+                               sb_svc_mon->logical_port);
+    if (!pb) {
+        return NULL;
+    }
 
-    LIST_FOR_EACH (svc_mon, list_node, &svc_monitors) {
-        svc_mon->delete = true;
+    if (pb->chassis != our_chassis) {
+        return NULL;
     }
 
-    const struct sbrec_service_monitor *sb_svc_mon;
-    SBREC_SERVICE_MONITOR_TABLE_FOR_EACH (sb_svc_mon, svc_mon_table) {
-        const struct sbrec_port_binding *pb
-            = lport_lookup_by_name(sbrec_port_binding_by_name,
-                                   sb_svc_mon->logical_port);
-        if (!pb) {
-            continue;
-        }
+    struct in6_addr ip_addr;
+    ovs_be32 ip4;
+    bool is_ipv4 = ip_parse(sb_svc_mon->ip, &ip4);
+    if (is_ipv4) {
+        ip_addr = in6_addr_mapped_ipv4(ip4);
+    } else if (!ipv6_parse(sb_svc_mon->ip, &ip_addr)) {
+        return NULL;
+    }
 
-        if (pb->chassis != our_chassis) {
+    struct eth_addr ea;
+    bool mac_found = false;
+    for (size_t i = 0; i < pb->n_mac && !mac_found; i++) {
+        struct lport_addresses laddrs;
+
+        if (!extract_lsp_addresses(pb->mac[i], &laddrs)) {
             continue;
         }
 
-        struct in6_addr ip_addr;
-        ovs_be32 ip4;
-        bool is_ipv4 = ip_parse(sb_svc_mon->ip, &ip4);
         if (is_ipv4) {
-            ip_addr = in6_addr_mapped_ipv4(ip4);
-        } else if (!ipv6_parse(sb_svc_mon->ip, &ip_addr)) {
-            continue;
+            for (size_t j = 0; j < laddrs.n_ipv4_addrs; j++) {
+                if (ip4 == laddrs.ipv4_addrs[j].addr) {
+                    ea = laddrs.ea;
+                    mac_found = true;
+                    break;
+                }
+            }
+        } else {
+            for (size_t j = 0; j < laddrs.n_ipv6_addrs; j++) {
+                if (IN6_ARE_ADDR_EQUAL(&ip_addr,
+                                       &laddrs.ipv6_addrs[j].addr)) {
+                    ea = laddrs.ea;
+                    mac_found = true;
+                    break;
+                }
+            }
         }
 
-        struct eth_addr ea;
-        bool mac_found = false;
-        for (size_t i = 0; i < pb->n_mac && !mac_found; i++) {
-            struct lport_addresses laddrs;
+        if (!mac_found && !laddrs.n_ipv4_addrs && !laddrs.n_ipv6_addrs) {
+            /* IP address(es) are not configured. Use the first mac. */
+            ea = laddrs.ea;
+            mac_found = true;
+        }
 
-            if (!extract_lsp_addresses(pb->mac[i], &laddrs)) {
-                continue;
-            }
+        destroy_lport_addresses(&laddrs);
+    }
 
-            if (is_ipv4) {
-                for (size_t j = 0; j < laddrs.n_ipv4_addrs; j++) {
-                    if (ip4 == laddrs.ipv4_addrs[j].addr) {
-                        ea = laddrs.ea;
-                        mac_found = true;
-                        break;
-                    }
-                }
-            } else {
-                for (size_t j = 0; j < laddrs.n_ipv6_addrs; j++) {
-                    if (IN6_ARE_ADDR_EQUAL(&ip_addr,
-                                           &laddrs.ipv6_addrs[j].addr)) {
-                        ea = laddrs.ea;
-                        mac_found = true;
-                        break;
-                    }
-                }
-            }
+    if (!mac_found) {
+        return NULL;
+    }
 
-            if (!mac_found && !laddrs.n_ipv4_addrs && !laddrs.n_ipv6_addrs) {
-                /* IP address(es) are not configured. Use the first mac. */
-                ea = laddrs.ea;
-                mac_found = true;
-            }
+    uint32_t dp_key = pb->datapath->tunnel_key;
+    uint32_t port_key = pb->tunnel_key;
+    uint32_t hash =
+        hash_bytes(&ip_addr, sizeof ip_addr,
+                   hash_3words(dp_key, port_key, sb_svc_mon->port));
 
-            destroy_lport_addresses(&laddrs);
-        }
+    enum svc_monitor_protocol protocol;
+    if (!sb_svc_mon->protocol || strcmp(sb_svc_mon->protocol, "udp")) {
+        protocol = SVC_MON_PROTO_TCP;
+    } else {
+        protocol = SVC_MON_PROTO_UDP;
+    }
+
+    struct svc_monitor *svc_mon =
+        pinctrl_find_svc_monitor(dp_key, port_key, &ip_addr,
+                                 sb_svc_mon->port, protocol, hash);
+
+    if (!svc_mon) {
+        svc_mon = xmalloc(sizeof *svc_mon);
+        svc_mon->dp_key = dp_key;
+        svc_mon->port_key = port_key;
+        svc_mon->proto_port = sb_svc_mon->port;
+        svc_mon->ip = ip_addr;
+        svc_mon->is_ip6 = !is_ipv4;
+        svc_mon->state = SVC_MON_S_INIT;
+        svc_mon->status = SVC_MON_ST_UNKNOWN;
+        svc_mon->protocol = protocol;
+
+        smap_init(&svc_mon->options);
+        svc_mon->interval =
+            smap_get_int(&svc_mon->options, "interval", 5) * 1000;
+        svc_mon->svc_timeout =
+            smap_get_int(&svc_mon->options, "timeout", 3) * 1000;
+        svc_mon->success_count =
+            smap_get_int(&svc_mon->options, "success_count", 1);
+        svc_mon->failure_count =
+            smap_get_int(&svc_mon->options, "failure_count", 1);
+        svc_mon->n_success = 0;
+        svc_mon->n_failures = 0;
+
+        eth_addr_from_string(sb_svc_mon->src_mac, &svc_mon->src_mac);
+        ip46_parse(sb_svc_mon->src_ip, &svc_mon->src_ip);
+
+        hmap_insert(&svc_monitors_map, &svc_mon->hmap_node, hash);
+        ovs_list_push_back(&svc_monitors, &svc_mon->list_node);
+        ovs_list_init(&svc_mon->status_node);
+        pinctrl_timer_init(&svc_mon->timer);
+        svc_monitor_schedule(svc_mon, time_msec());
+        svc_mon->sb_uuid = sb_svc_mon->header_.uuid;
+        hmap_insert(&svc_monitors_by_uuid, &svc_mon->uuid_node,
+                    uuid_hash(&svc_mon->sb_uuid));
+        *changed = true;
+    } else if (!uuid_equals(&svc_mon->sb_uuid, &sb_svc_mon->header_.uuid)) {
+        hmap_remove(&svc_monitors_by_uuid, &svc_mon->uuid_node);
+        svc_mon->sb_uuid = sb_svc_mon->header_.uuid;
+        hmap_insert(&svc_monitors_by_uuid, &svc_mon->uuid_node,
+                    uuid_hash(&svc_mon->sb_uuid));
+    }
+
+    svc_mon->sb_svc_mon = sb_svc_mon;
+    svc_mon->ea = ea;
+    if (!smap_equal(&svc_mon->options, &sb_svc_mon->options)) {
+        smap_destroy(&svc_mon->options);
+        smap_clone(&svc_mon->options, &sb_svc_mon->options);
+        svc_mon->interval =
+            smap_get_int(&svc_mon->options, "interval", 5) * 1000;
+        svc_mon->svc_timeout =
+            smap_get_int(&svc_mon->options, "timeout", 3) * 1000;
+        svc_mon->success_count =
+            smap_get_int(&svc_mon->options, "success_count", 1);
+        svc_mon->failure_count =
+            smap_get_int(&svc_mon->options, "failure_count", 1);
+        *changed = true;
+    }
+
+    /* The SB status may have been changed by someone else, or the row
+     * (re)created, restore ours without holding it down. */
+    const char *status = svc_monitor_status_to_string(svc_mon->status);
+    if (status && ovs_list_is_empty(&svc_mon->status_node)
+        && !nullable_string_is_equal(status, sb_svc_mon->status)) {
+        svc_monitor_status_changed(svc_mon, LLONG_MIN);
+    }
+
+    return svc_mon;
+}
+
+static void
+sync_svc_monitor(const struct sbrec_service_monitor *sb_svc_mon,
+                 struct ovsdb_idl_index *sbrec_port_binding_by_name,
+                 const struct sbrec_chassis *our_chassis, bool *changed)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    struct svc_monitor *old =
+        svc_monitor_find_by_uuid(&sb_svc_mon->header_.uuid);
+    struct svc_monitor *svc_mon =
+        sync_svc_monitor__(sb_svc_mon, sbrec_port_binding_by_name,
+                           our_chassis, changed);
+    if (svc_mon) {
+        svc_mon->delete = false;
+    }
+    if (old && old != svc_mon) {
+        /* The row doesn't apply to 'old' anymore, e.g., because its
+         * logical port was bound to another chassis or it changed key. */
+        svc_monitor_destroy(old);
+        *changed = true;
+    }
+}
 
-        if (!mac_found) {
+/* Writes to the SB the statuses of the service monitors that changed and
+ * stayed the same for at least the configured hold-down time, so that a
+ * flapping backend doesn't cause a flurry of SB updates.  At most the
+ * configured batch size of rows is updated in a transaction, the oldest
+ * changes first, the rest waits for the next one. */
+static void
+svc_monitors_write_status(struct ovsdb_idl_txn *ovnsb_idl_txn)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    long long int now = time_msec();
+    long long int holddown = pinctrl.svc_monitor_status_holddown_ms;
+    size_t max_batch = pinctrl.svc_monitor_max_batch;
+    size_t n_written = 0;
+
+    struct svc_monitor *svc_mon;
+    LIST_FOR_EACH_SAFE (svc_mon, status_node, &svc_monitors_status_pending) {
+        const char *status = svc_monitor_status_to_string(svc_mon->status);
+        if (!status
+            || nullable_string_is_equal(status, svc_mon->sb_svc_mon->status)) {
+            /* Nothing to write, e.g., the status flapped back. */
+            svc_monitor_status_done(svc_mon);
+            continue;
+        }
+        if (svc_mon->status_changed_at != LLONG_MIN
+            && now < svc_mon->status_changed_at + holddown) {
             continue;
         }
+        if (max_batch && n_written >= max_batch) {
+            COVERAGE_INC(pinctrl_defer_svc_monitor_status);
+            break;
+        }
+        sbrec_service_monitor_set_status(svc_mon->sb_svc_mon, status);
+        svc_monitor_status_done(svc_mon);
+        n_written++;
+    }
+}
 
-        uint32_t dp_key = pb->datapath->tunnel_key;
-        uint32_t port_key = pb->tunnel_key;
-        uint32_t hash =
-            hash_bytes(&ip_addr, sizeof ip_addr,
-                       hash_3words(dp_key, port_key, sb_svc_mon->port));
+static void
+wait_svc_monitors_status(struct ovsdb_idl_txn *ovnsb_idl_txn)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    if (!ovnsb_idl_txn) {
+        return;
+    }
 
-        enum svc_monitor_protocol protocol;
-        if (!sb_svc_mon->protocol || strcmp(sb_svc_mon->protocol, "udp")) {
-            protocol = SVC_MON_PROTO_TCP;
-        } else {
-            protocol = SVC_MON_PROTO_UDP;
+    long long int holddown = pinctrl.svc_monitor_status_holddown_ms;
+    struct svc_monitor *svc_mon;
+    LIST_FOR_EACH (svc_mon, status_node, &svc_monitors_status_pending) {
+        if (svc_mon->status_changed_at == LLONG_MIN) {
+            poll_immediate_wake();
+            return;
         }
+        poll_timer_wait_until(svc_mon->status_changed_at + holddown);
+    }
+}
+
+/* Synchronizes the service monitors with the SB Service_Monitor table.
+ * Normally only the tracked changes of the table, and the ones of the port
+ * bindings referenced by it, are processed.  The whole table is processed
+ * again when the tracked changes may be incomplete, see
+ * pinctrl_force_resync(), or when the chassis changes. */
+static void
+sync_svc_monitors(struct ovsdb_idl_txn *ovnsb_idl_txn,
+                  const struct sbrec_service_monitor_table *svc_mon_table,
+                  const struct sbrec_port_binding_table *pb_table,
+                  struct ovsdb_idl_index *sbrec_port_binding_by_name,
+                  struct ovsdb_idl_index *sbrec_service_monitor_by_lport,
+                  const struct sbrec_chassis *our_chassis)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    const struct sbrec_service_monitor *sb_svc_mon;
+    struct svc_monitor *svc_mon;
+    bool changed = false;
 
-        svc_mon = pinctrl_find_svc_monitor(dp_key, port_key, &ip_addr,
-                                           sb_svc_mon->port, protocol, hash);
+    if (our_chassis != svc_monitors_chassis) {
+        svc_monitors_chassis = our_chassis;
+        svc_monitors_full_sync = true;
+    }
 
-        if (!svc_mon) {
-            svc_mon = xmalloc(sizeof *svc_mon);
-            svc_mon->dp_key = dp_key;
-            svc_mon->port_key = port_key;
-            svc_mon->proto_port = sb_svc_mon->port;
-            svc_mon->ip = ip_addr;
-            svc_mon->is_ip6 = !is_ipv4;
-            svc_mon->state = SVC_MON_S_INIT;
-            svc_mon->status = SVC_MON_ST_UNKNOWN;
-            svc_mon->protocol = protocol;
-
-            smap_init(&svc_mon->options);
-            svc_mon->interval =
-                smap_get_int(&svc_mon->options, "interval", 5) * 1000;
-            svc_mon->svc_timeout =
-                smap_get_int(&svc_mon->options, "timeout", 3) * 1000;
-            svc_mon->success_count =
-                smap_get_int(&svc_mon->options, "success_count", 1);
-            svc_mon->failure_count =
-                smap_get_int(&svc_mon->options, "failure_count", 1);
-            svc_mon->n_success = 0;
-            svc_mon->n_failures = 0;
-
-            eth_addr_from_string(sb_svc_mon->src_mac, &svc_mon->src_mac);
-            ip46_parse(sb_svc_mon->src_ip, &svc_mon->src_ip);
-
-            hmap_insert(&svc_monitors_map, &svc_mon->hmap_node, hash);
-            ovs_list_push_back(&svc_monitors, &svc_mon->list_node);
-            changed = true;
+    if (svc_monitors_full_sync) {
+        LIST_FOR_EACH (svc_mon, list_node, &svc_monitors) {
+            svc_mon->delete = true;
         }
 
-        svc_mon->sb_svc_mon = sb_svc_mon;
-        svc_mon->ea = ea;
-        if (!smap_equal(&svc_mon->options, &sb_svc_mon->options)) {
-            smap_destroy(&svc_mon->options);
-            smap_clone(&svc_mon->options, &sb_svc_mon->options);
-            svc_mon->interval =
-                smap_get_int(&svc_mon->options, "interval", 5) * 1000;
-            svc_mon->svc_timeout =
-                smap_get_int(&svc_mon->options, "timeout", 3) * 1000;
-            svc_mon->success_count =
-                smap_get_int(&svc_mon->options, "success_count", 1);
-            svc_mon->failure_count =
-                smap_get_int(&svc_mon->options, "failure_count", 1);
-            changed = true;
+        SBREC_SERVICE_MONITOR_TABLE_FOR_EACH (sb_svc_mon, svc_mon_table) {
+            sync_svc_monitor(sb_svc_mon, sbrec_port_binding_by_name,
+                             our_chassis, &changed);
         }
 
-        svc_mon->delete = false;
-    }
-
-    LIST_FOR_EACH_SAFE (svc_mon, list_node, &svc_monitors) {
-        if (svc_mon->delete) {
-            hmap_remove(&svc_monitors_map, &svc_mon->hmap_node);
-            ovs_list_remove(&svc_mon->list_node);
-            smap_destroy(&svc_mon->options);
-            free(svc_mon);
-            changed = true;
-        } else if (ovnsb_idl_txn) {
-            /* Update the status of the service monitor. */
-            if (svc_mon->status != SVC_MON_ST_UNKNOWN) {
-                if (svc_mon->status == SVC_MON_ST_ONLINE) {
-                    sbrec_service_monitor_set_status(svc_mon->sb_svc_mon,
-                                                     "online");
-                } else {
-                    sbrec_service_monitor_set_status(svc_mon->sb_svc_mon,
-                                                     "offline");
+        LIST_FOR_EACH_SAFE (svc_mon, list_node, &svc_monitors) {
+            if (svc_mon->delete) {
+                svc_monitor_destroy(svc_mon);
+                changed = true;
+            }
+        }
+        svc_monitors_full_sync = false;
+    } else {
+        SBREC_SERVICE_MONITOR_TABLE_FOR_EACH_TRACKED (sb_svc_mon,
+                                                      svc_mon_table) {
+            if (sbrec_service_monitor_is_deleted(sb_svc_mon)) {
+                svc_mon = svc_monitor_find_by_uuid(&sb_svc_mon->header_.uuid);
+                if (svc_mon) {
+                    svc_monitor_destroy(svc_mon);
+                    changed = true;
                 }
+            } else {
+                sync_svc_monitor(sb_svc_mon, sbrec_port_binding_by_name,
+                                 our_chassis, &changed);
+            }
+        }
+
+        /* A port binding change may move a service monitor to or away from
+         * this chassis, or change its MAC or keys. */
+        struct sbrec_service_monitor *target =
+            sbrec_service_monitor_index_init_row(
+                sbrec_service_monitor_by_lport);
+        const struct sbrec_port_binding *pb;
+        SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, pb_table) {
+            sbrec_service_monitor_index_set_logical_port(target,
+                                                         pb->logical_port);
+            SBREC_SERVICE_MONITOR_FOR_EACH_EQUAL (
+                    sb_svc_mon, target, sbrec_service_monitor_by_lport) {
+                sync_svc_monitor(sb_svc_mon, sbrec_port_binding_by_name,
+                                 our_chassis, &changed);
             }
         }
+        sbrec_service_monitor_index_destroy_row(target);
+    }
+
+    if (ovnsb_idl_txn) {
+        svc_monitors_write_status(ovnsb_idl_txn);
     }
 
     if (changed) {
         notify_pinctrl_handler();
     }
-
 }
 
 enum bfd_state {
@@ -7609,12 +9047,19 @@ struct bfd_entry {
     uint32_t detection_timeout;
     long long int last_rx;
     long long int next_tx;
+
+    /* Next transmission or detection timeout, in 'bfd_monitor_timers'. */
+    struct pinctrl_timer timer;
 };
 
+/* BFD entries that have a transmission or a detection timeout pending. */
+static struct heap bfd_monitor_timers;
+
 static void
 bfd_monitor_init(void)
 {
     hmap_init(&bfd_monitor_map);
+    heap_init(&bfd_monitor_timers);
     bfd_last_update = time_msec();
 }
 
@@ -7626,6 +9071,25 @@ bfd_monitor_destroy(void)
         free(entry);
     }
     hmap_destroy(&bfd_monitor_map);
+    heap_destroy(&bfd_monitor_timers);
+}
+
+/* Schedules 'entry' for its next transmission or for its detection timeout,
+ * whichever comes first. */
+static void
+bfd_monitor_schedule(struct bfd_entry *entry)
+{
+    long long int when = LLONG_MAX;
+
+    if (entry->remote_min_rx && entry->state != BFD_STATE_ADMIN_DOWN
+        && !entry->remote_demand_mode) {
+        when = entry->next_tx;
+    }
+    if (entry->state != BFD_STATE_ADMIN_DOWN
+        && entry->state != BFD_STATE_DOWN && entry->detection_timeout) {
+        when = MIN(when, entry->last_rx + entry->detection_timeout);
+    }
+    pinctrl_timer_set(&bfd_monitor_timers, &entry->timer, when);
 }
 
 static struct bfd_entry *
@@ -7660,15 +9124,7 @@ pinctrl_find_bfd_monitor_entry_by_disc(const char *ip,
 static bool
 bfd_monitor_should_inject(void)
 {
-    long long int cur_time = time_msec();
-    struct bfd_entry *entry;
-
-    HMAP_FOR_EACH (entry, node, &bfd_monitor_map) {
-        if (entry->next_tx < cur_time) {
-            return true;
-        }
-    }
-    return false;
+    return pinctrl_timers_next(&bfd_monitor_timers) <= time_msec();
 }
 
 static void
@@ -7815,45 +9271,37 @@ bfd_monitor_send_msg(struct rconn *swconn, long long int *bfd_time)
     OVS_REQUIRES(pinctrl_mutex)
 {
     long long int cur_time = time_msec();
-    struct bfd_entry *entry;
 
     if (bfd_monitor_need_update()) {
         notify_pinctrl_main();
     }
 
-    HMAP_FOR_EACH (entry, node, &bfd_monitor_map) {
-        unsigned long tx_timeout;
+    size_t n_due;
+    struct pinctrl_timer **due =
+        pinctrl_timers_pop_due(&bfd_monitor_timers, cur_time, &n_due);
+    for (size_t i = 0; i < n_due; i++) {
+        struct bfd_entry *entry = CONTAINER_OF(due[i], struct bfd_entry,
+                                               timer);
 
         bfd_check_detection_timeout(entry);
 
-        if (cur_time < entry->next_tx) {
-            goto next;
-        }
-
-        if (!entry->remote_min_rx) {
-            continue;
-        }
-
-        if (entry->state == BFD_STATE_ADMIN_DOWN) {
-            continue;
-        }
-
-        if (entry->remote_demand_mode) {
-            continue;
-        }
+        if (cur_time >= entry->next_tx && entry->remote_min_rx
+            && entry->state != BFD_STATE_ADMIN_DOWN
+            && !entry->remote_demand_mode) {
+            pinctrl_send_bfd_tx_msg(swconn, entry, false);
 
-        pinctrl_send_bfd_tx_msg(swconn, entry, false);
-
-        tx_timeout = MAX(entry->local_min_tx, entry->remote_min_rx);
-        if (tx_timeout >= 4) {
-            tx_timeout -= random_range(tx_timeout / 4);
-        }
-        entry->next_tx = cur_time + tx_timeout;
-next:
-        if (*bfd_time > entry->next_tx) {
-            *bfd_time = entry->next_tx;
+            unsigned long tx_timeout = MAX(entry->local_min_tx,
+                                           entry->remote_min_rx);
+            if (tx_timeout >= 4) {
+                tx_timeout -= random_range(tx_timeout / 4);
+            }
+            entry->next_tx = cur_time + tx_timeout;
         }
+        bfd_monitor_schedule(entry);
     }
+    free(due);
+
+    *bfd_time = pinctrl_timers_next(&bfd_monitor_timers);
 }
 
 static bool
@@ -8027,6 +9475,8 @@ pinctrl_handle_bfd_msg(struct rconn *swconn, const struct flow *ip_flow,
     }
 
 out:
+    bfd_monitor_schedule(entry);
+
     /* let's try to bacth db updates */
     if (change_state) {
         entry->change_state = true;
@@ -8178,16 +9628,20 @@ bfd_monitor_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
 
             uint32_t hash = hash_string(bt->dst_ip, 0);
             hmap_insert(&bfd_monitor_map, &entry->node, hash);
+            pinctrl_timer_init(&entry->timer);
+            bfd_monitor_schedule(entry);
         } else if (!strcmp(bt->status, "admin_down") &&
                    entry->state != BFD_STATE_ADMIN_DOWN) {
             entry->state = BFD_STATE_ADMIN_DOWN;
             entry->change_state = false;
             entry->remote_disc = 0;
+            bfd_monitor_schedule(entry);
         } else if (strcmp(bt->status, "admin_down") &&
                    entry->state == BFD_STATE_ADMIN_DOWN) {
             entry->state = BFD_STATE_DOWN;
             entry->change_state = false;
             entry->remote_disc = 0;
+            bfd_monitor_schedule(entry);
             changed = true;
         } else if (entry->change_state && ovnsb_idl_txn) {
             if (entry->state == BFD_STATE_DOWN) {
@@ -8203,6 +9657,7 @@ bfd_monitor_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
     HMAP_FOR_EACH_SAFE (entry, node, &bfd_monitor_map) {
         if (entry->erase) {
             hmap_remove(&bfd_monitor_map, &entry->node);
+            pinctrl_timer_cancel(&bfd_monitor_timers, &entry->timer);
             free(entry);
         }
     }
@@ -8382,14 +9837,14 @@ svc_monitors_run(struct rconn *swconn,
                  long long int *svc_monitors_next_run_time)
     OVS_REQUIRES(pinctrl_mutex)
 {
-    *svc_monitors_next_run_time = LLONG_MAX;
-    struct svc_monitor *svc_mon;
-    LIST_FOR_EACH (svc_mon, list_node, &svc_monitors) {
-        char ip_[INET6_ADDRSTRLEN + 1];
-        memset(ip_, 0, INET6_ADDRSTRLEN + 1);
-        ipv6_string_mapped(ip_, &svc_mon->ip);
+    long long int current_time = time_msec();
+    size_t n_due;
+    struct pinctrl_timer **due =
+        pinctrl_timers_pop_due(&svc_monitors_timers, current_time, &n_due);
+    for (size_t i = 0; i < n_due; i++) {
+        struct svc_monitor *svc_mon =
+            CONTAINER_OF(due[i], struct svc_monitor, timer);
 
-        long long int current_time = time_msec();
         long long int next_run_time = LLONG_MAX;
         enum svc_monitor_status old_status = svc_mon->status;
         switch (svc_mon->state) {
@@ -8448,15 +9903,17 @@ svc_monitors_run(struct rconn *swconn,
             OVS_NOT_REACHED();
         }
 
-        if (*svc_monitors_next_run_time > next_run_time) {
-            *svc_monitors_next_run_time = next_run_time;
-        }
+        svc_monitor_schedule(svc_mon, next_run_time);
 
         if (old_status != svc_mon->status) {
             /* Notify the main thread to update the status in the SB DB. */
+            svc_monitor_status_changed(svc_mon, current_time);
             notify_pinctrl_main();
         }
     }
+    free(due);
+
+    *svc_monitors_next_run_time = pinctrl_timers_next(&svc_monitors_timers);
 }
 
 static void
@@ -8500,6 +9957,7 @@ pinctrl_handle_tcp_svc_check(struct rconn *swconn,
                                             htonl(0), th->tcp_dst);
         /* Calculate next_send_time. */
         svc_mon->next_send_time = time_msec() + svc_mon->interval;
+        svc_monitor_schedule(svc_mon, time_msec());
         return true;
     }
 
@@ -8510,6 +9968,7 @@ pinctrl_handle_tcp_svc_check(struct rconn *swconn,
 
         /* Calculate next_send_time. */
         svc_mon->next_send_time = time_msec() + svc_mon->interval;
+        svc_monitor_schedule(svc_mon, time_msec());
         return false;
     }
 
@@ -8664,6 +10123,7 @@ pinctrl_handle_svc_check(struct rconn *swconn, const struct flow *ip_flow,
 
         /* Calculate next_send_time. */
         svc_mon->next_send_time = time_msec() + svc_mon->interval;
+        svc_monitor_schedule(svc_mon, time_msec());
     }
 }
 
@@ -8813,6 +10273,92 @@ pinctrl_rarp_activation_strategy_handler(const struct match *md)
     notify_pinctrl_main();
 }
 
+/* Datapaths that got a packet while their flows, installed on demand, were
+ * not installed.  Contains "struct activated_datapath" nodes. */
+static struct ovs_list datapaths_to_activate = OVS_LIST_INITIALIZER(
+    &datapaths_to_activate);
+
+/* Moves the datapaths to activate to 'dps', which must be empty. */
+void
+pinctrl_take_datapaths_to_activate(struct ovs_list *dps)
+{
+    ovs_mutex_lock(&pinctrl_mutex);
+    ovs_list_push_back_all(dps, &datapaths_to_activate);
+    ovs_mutex_unlock(&pinctrl_mutex);
+}
+
+static void
+destroy_datapaths_to_activate(void)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    struct activated_datapath *ad;
+    LIST_FOR_EACH_POP (ad, list, &datapaths_to_activate) {
+        free(ad);
+    }
+}
+
+static void
+wait_datapaths_to_activate(void)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    if (!ovs_list_is_empty(&datapaths_to_activate)) {
+        poll_immediate_wake();
+    }
+}
+
+/* Releases the packets buffered for the datapaths that are local now and
+ * whose flows are installed. */
+static void
+run_lazy_dp_buffered_packets(const struct hmap *local_datapaths,
+                             const struct lazy_datapaths *lazy_dps)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    if (!buffered_packets_ctx_has_packets(&lazy_dp_buffered_packets_ctx)) {
+        return;
+    }
+
+    buffered_packets_ctx_run_datapaths(&lazy_dp_buffered_packets_ctx,
+                                       local_datapaths, lazy_dps);
+    if (buffered_packets_ctx_is_ready_to_send(
+            &lazy_dp_buffered_packets_ctx)) {
+        notify_pinctrl_handler();
+    }
+}
+
+/* Called with in the pinctrl_handler thread context. */
+static void
+pinctrl_activate_datapath_handler(const struct ofputil_packet_in *pin,
+                                  const struct ofpbuf *continuation)
+    OVS_REQUIRES(pinctrl_mutex)
+{
+    uint32_t dp_key = ntohll(pin->flow_metadata.flow.metadata);
+    struct mac_binding_data mb_data = (struct mac_binding_data) {
+        .dp_key = dp_key,
+    };
+
+    struct buffered_packets *bp =
+        buffered_packets_add(&lazy_dp_buffered_packets_ctx, mb_data);
+    if (bp) {
+        struct bp_packet_data *pd = bp_packet_data_create(pin, continuation);
+        buffered_packets_packet_data_enqueue(&lazy_dp_buffered_packets_ctx,
+                                             bp, pd);
+    } else {
+        COVERAGE_INC(pinctrl_drop_buffered_packets_map);
+    }
+
+    struct activated_datapath *ad;
+    LIST_FOR_EACH (ad, list, &datapaths_to_activate) {
+        if (ad->dp_key == dp_key) {
+            return;
+        }
+    }
+    ad = xmalloc(sizeof *ad);
+    ad->dp_key = dp_key;
+    ovs_list_push_back(&datapaths_to_activate, &ad->list);
+
+    notify_pinctrl_main();
+}
+
 static void
 pinctrl_mg_split_buff_handler(struct rconn *swconn, struct dp_packet *pkt,
                               const struct match *md, struct ofpbuf *userdata)
@@ -24,7 +24,9 @@
 #include "openvswitch/meta-flow.h"
 
 struct hmap;
+struct lazy_datapaths;
 struct shash;
+struct simap;
 struct lport_index;
 struct ovsdb_idl;
 struct ovsdb_idl_index;
@@ -37,6 +39,7 @@ struct sbrec_controller_event_table;
 struct sbrec_service_monitor_table;
 struct sbrec_bfd_table;
 struct sbrec_port_binding;
+struct sbrec_port_binding_table;
 struct sbrec_mac_binding_table;
 
 void pinctrl_init(void);
@@ -49,19 +52,24 @@ void pinctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
                  struct ovsdb_idl_index *sbrec_igmp_groups,
                  struct ovsdb_idl_index *sbrec_ip_multicast_opts,
                  struct ovsdb_idl_index *sbrec_fdb_by_dp_key_mac,
+                 struct ovsdb_idl_index *sbrec_service_monitor_by_lport,
                  const struct sbrec_dns_table *,
                  const struct sbrec_controller_event_table *,
                  const struct sbrec_service_monitor_table *,
                  const struct sbrec_mac_binding_table *,
                  const struct sbrec_bfd_table *,
+                 const struct sbrec_port_binding_table *,
                  const struct ovsrec_bridge *, const struct sbrec_chassis *,
                  const struct hmap *local_datapaths,
+                 const struct lazy_datapaths *,
                  const struct sset *active_tunnels,
                  const struct shash *local_active_ports_ipv6_pd,
                  const struct shash *local_active_ports_ras,
                  const struct ovsrec_open_vswitch_table *ovs_table);
 void pinctrl_wait(struct ovsdb_idl_txn *ovnsb_idl_txn);
+void pinctrl_force_resync(void);
 void pinctrl_destroy(void);
+void pinctrl_get_memory_usage(struct simap *usage);
 
 void pinctrl_update_swconn(const char *target, int probe_interval);
 
@@ -76,4 +84,12 @@ struct activated_port {
 void tag_port_as_activated_in_engine(struct activated_port *ap);
 struct ovs_list *get_ports_to_activate_in_engine(void);
 bool pinctrl_is_port_activated(int64_t dp_key, int64_t port_key);
+
+/* A datapath whose flows are installed on demand, that got a packet. */
+struct activated_datapath {
+    uint32_t dp_key;
+    struct ovs_list list;
+};
+
+void pinctrl_take_datapaths_to_activate(struct ovs_list *dps);
 #endif /* controller/pinctrl.h */
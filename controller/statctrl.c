@@ -19,6 +19,7 @@
 #include "dirs.h"
 #include "latch.h"
 #include "lflow.h"
+#include "local_data.h"
 #include "mac-cache.h"
 #include "openvswitch/ofp-errors.h"
 #include "openvswitch/ofp-flow.h"
@@ -39,9 +40,20 @@ VLOG_DEFINE_THIS_MODULE(statctrl);
 enum stat_type {
     STATS_MAC_BINDING = 0,
     STATS_FDB,
+    STATS_LAZY_DP,
     STATS_MAX,
 };
 
+/* The flows of a table are dumped in 'n_slices' slices, selected by the low
+ * bits of their cookie, which is the first 32 bits of the UUID of the SB
+ * record they were created for.  The requests for the slices are evenly
+ * spread over the request delay, so every flow is still dumped once per
+ * request delay but each dump only covers a part of the table.  The number of
+ * slices is adjusted, at the end of each full dump, to keep the flows per
+ * slice under STATS_SLICE_MAX_FLOWS. */
+#define STATS_SLICE_MAX_FLOWS 8192
+#define STATS_MAX_SLICES 256
+
 struct stats_node {
     /* The statistics request. */
     struct  ofputil_flow_stats_request request;
@@ -51,6 +63,12 @@ struct stats_node {
     int64_t next_request_timestamp;
     /* Request delay in ms. */
     uint64_t request_delay;
+    /* Number of slices of the table, a power of 2. */
+    uint32_t n_slices;
+    /* Slice to be requested next. */
+    uint32_t slice;
+    /* Number of flows received since the first slice was requested. */
+    size_t n_dumped_flows;
     /* List of processed statistics. */
     struct ovs_list stats_list;
     /* Function to clean up the node.
@@ -71,6 +89,9 @@ struct stats_node {
         .xid = 0,                                                          \
         .next_request_timestamp = INT64_MAX,                               \
         .request_delay = 0,                                                \
+        .n_slices = 1,                                                     \
+        .slice = 0,                                                        \
+        .n_dumped_flows = 0,                                               \
         .stats_list =                                                      \
             OVS_LIST_INITIALIZER(                                          \
                 &statctrl_ctx.nodes[STATS_##NAME].stats_list),             \
@@ -114,6 +135,8 @@ static bool statctrl_update_next_request_timestamp(struct stats_node *node,
                                                    long long now,
                                                    uint64_t prev_delay)
     OVS_REQUIRES(mutex);
+static void statctrl_update_n_slices(struct stats_node *node)
+    OVS_REQUIRES(mutex);
 
 void
 statctrl_init(void)
@@ -145,6 +168,17 @@ statctrl_init(void)
     STATS_NODE(FDB, fdb_request, mac_cache_stats_destroy,
                fdb_stats_process_flow_stats, fdb_stats_run);
 
+    struct ofputil_flow_stats_request lazy_dp_request = {
+            .cookie = htonll(0),
+            .cookie_mask = htonll(0),
+            .out_port = OFPP_ANY,
+            .out_group = OFPG_ANY,
+            .table_id = OFTABLE_LAZY_DP_USE,
+    };
+    STATS_NODE(LAZY_DP, lazy_dp_request, lazy_datapath_stats_destroy,
+               lazy_datapath_stats_process_flow_stats,
+               lazy_datapath_stats_run);
+
     statctrl_ctx.thread = ovs_thread_create("ovn_statctrl",
                                             statctrl_thread_handler,
                                             &statctrl_ctx);
@@ -152,13 +186,14 @@ statctrl_init(void)
 
 void
 statctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
-             struct mac_cache_data *mac_cache_data)
+             struct mac_cache_data *mac_cache_data,
+             struct lazy_datapaths *lazy_dps)
 {
     if (!ovnsb_idl_txn) {
         return;
     }
 
-    void *node_data[STATS_MAX] = {mac_cache_data, mac_cache_data};
+    void *node_data[STATS_MAX] = {mac_cache_data, mac_cache_data, lazy_dps};
 
     bool schedule_updated = false;
     long long now = time_msec();
@@ -333,6 +368,7 @@ statctrl_decode_statistics_reply(struct stats_node *node, struct ofpbuf *msg)
         }
 
         node->process_flow_stats(&node->stats_list, &fs);
+        node->n_dumped_flows++;
     }
 
     ofpbuf_uninit(&ofpacts);
@@ -353,6 +389,13 @@ statctrl_send_request(struct rconn *swconn, struct statctrl_ctx *ctx)
             continue;
         }
 
+        if (!node->slice) {
+            statctrl_update_n_slices(node);
+        }
+        node->request.cookie = htonll(node->slice);
+        node->request.cookie_mask = htonll(node->n_slices - 1);
+        node->slice = (node->slice + 1) & (node->n_slices - 1);
+
         struct ofpbuf *msg =
                 ofputil_encode_flow_stats_request(&node->request, proto);
         node->xid = ((struct ofp_header *) msg->data)->xid;
@@ -363,6 +406,29 @@ statctrl_send_request(struct rconn *swconn, struct statctrl_ctx *ctx)
     }
 }
 
+/* Adjusts the number of slices of 'node' to the number of flows received
+ * during the last full dump.  Must be called before requesting the first
+ * slice. */
+static void
+statctrl_update_n_slices(struct stats_node *node)
+    OVS_REQUIRES(mutex)
+{
+    size_t n_flows = node->n_dumped_flows;
+    uint32_t n_slices = 1;
+
+    while (n_slices < STATS_MAX_SLICES
+           && n_flows > (size_t) n_slices * STATS_SLICE_MAX_FLOWS) {
+        n_slices *= 2;
+    }
+    if (n_slices != node->n_slices) {
+        VLOG_DBG("Dumping the statistics of table %"PRIu8" in %"PRIu32
+                 " slices (%"PRIuSIZE" flows)", node->request.table_id,
+                 n_slices, n_flows);
+        node->n_slices = n_slices;
+    }
+    node->n_dumped_flows = 0;
+}
+
 static void
 statctrl_notify_main_thread(struct statctrl_ctx *ctx)
 {
@@ -386,6 +452,14 @@ statctrl_wait_next_request(struct statctrl_ctx *ctx)
     }
 }
 
+/* Returns the delay between the requests of two slices of 'node' for a
+ * request delay of 'request_delay'. */
+static uint64_t
+statctrl_slice_delay(const struct stats_node *node, uint64_t request_delay)
+{
+    return request_delay ? MAX(request_delay / node->n_slices, 1) : 0;
+}
+
 static bool
 statctrl_update_next_request_timestamp(struct stats_node *node,
                                        long long now, uint64_t prev_delay)
@@ -395,9 +469,11 @@ statctrl_update_next_request_timestamp(struct stats_node *node,
         return false;
     }
 
+    uint64_t delay = statctrl_slice_delay(node, node->request_delay);
+    prev_delay = statctrl_slice_delay(node, prev_delay);
+
     int64_t timestamp = prev_delay ? node->next_request_timestamp : now;
-    node->next_request_timestamp =
-            timestamp + node->request_delay - prev_delay;
+    node->next_request_timestamp = timestamp + delay - prev_delay;
 
     return timestamp != node->next_request_timestamp;
 }
@@ -18,9 +18,12 @@
 
 #include "mac-cache.h"
 
+struct lazy_datapaths;
+
 void statctrl_init(void);
 void statctrl_run(struct ovsdb_idl_txn *ovnsb_idl_txn,
-                  struct mac_cache_data *mac_cache_data);
+                  struct mac_cache_data *mac_cache_data,
+                  struct lazy_datapaths *lazy_dps);
 
 void statctrl_update_swconn(const char *target, int probe_interval);
 void statctrl_wait(struct ovsdb_idl_txn *ovnsb_idl_txn);
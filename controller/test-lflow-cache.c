@@ -15,8 +15,14 @@
 
 #include <config.h>
 
+#include "coverage.h"
 #include "lib/uuid.h"
+#include "openvswitch/poll-loop.h"
 #include "ovn/expr.h"
+#include "ovn/logical-fields.h"
+#include "random.h"
+#include "simap.h"
+#include "timeval.h"
 #include "tests/ovstest.h"
 #include "tests/test-utils.h"
 #include "util.h"
@@ -36,9 +42,10 @@
 
 static void
 test_lflow_cache_add__(struct lflow_cache *lc, const char *op_type,
-                       const struct uuid *lflow_uuid,
+                       const struct uuid *lflow_uuid, const char *key,
                        unsigned int conj_id_ofs,
                        unsigned int n_conjs,
+                       unsigned int cost,
                        struct expr *e)
 {
     printf("ADD %s:\n", op_type);
@@ -46,21 +53,21 @@ test_lflow_cache_add__(struct lflow_cache *lc, const char *op_type,
     printf("  n_conjs: %u\n", n_conjs);
 
     if (!strcmp(op_type, "expr")) {
-        lflow_cache_add_expr(lc, lflow_uuid, expr_clone(e),
-                             TEST_LFLOW_CACHE_VALUE_SIZE);
+        lflow_cache_add_expr(lc, lflow_uuid, key, expr_clone(e),
+                             TEST_LFLOW_CACHE_VALUE_SIZE, cost);
     } else if (!strcmp(op_type, "matches")) {
         struct hmap *matches = xmalloc(sizeof *matches);
         ovs_assert(expr_to_matches(e, NULL, NULL, matches) == 0);
         ovs_assert(hmap_count(matches) == 1);
-        lflow_cache_add_matches(lc, lflow_uuid,
+        lflow_cache_add_matches(lc, lflow_uuid, 0, key,
                                 conj_id_ofs, n_conjs, matches,
-                                TEST_LFLOW_CACHE_VALUE_SIZE);
+                                TEST_LFLOW_CACHE_VALUE_SIZE, cost);
     } else {
         OVS_NOT_REACHED();
     }
 }
 
-static void
+static const struct lflow_cache_value *
 test_lflow_cache_lookup__(struct lflow_cache *lc,
                           const struct uuid *lflow_uuid)
 {
@@ -69,7 +76,7 @@ test_lflow_cache_lookup__(struct lflow_cache *lc,
     printf("LOOKUP:\n");
     if (!lcv) {
         printf("  not found\n");
-        return;
+        return NULL;
     }
 
     printf("  conj_id_ofs: %"PRIu32"\n", lcv->conj_id_ofs);
@@ -85,6 +92,7 @@ test_lflow_cache_lookup__(struct lflow_cache *lc,
         OVS_NOT_REACHED();
         break;
     }
+    return lcv;
 }
 
 static void
@@ -134,7 +142,8 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
             goto done;
         }
 
-        if (!strcmp(op, "add")) {
+        if (!strcmp(op, "add") || !strcmp(op, "add-shared")) {
+            bool shared = !strcmp(op, "add-shared");
             const char *op_type = test_read_value(ctx, shift++, "op_type");
             if (!op_type) {
                 goto done;
@@ -152,6 +161,14 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
                 goto done;
             }
 
+            unsigned int cost = 0;
+            if (ctx->argv[shift] && !strcmp(ctx->argv[shift], "cost")) {
+                shift++;
+                if (!test_read_uint_value(ctx, shift++, "cost", &cost)) {
+                    goto done;
+                }
+            }
+
             if (n_lflow_uuids == n_allocated_lflow_uuids) {
                 lflow_uuids = x2nrealloc(lflow_uuids, &n_allocated_lflow_uuids,
                                          sizeof *lflow_uuids);
@@ -159,9 +176,14 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
             struct uuid *lflow_uuid = &lflow_uuids[n_lflow_uuids++];
 
             uuid_generate(lflow_uuid);
-            test_lflow_cache_add__(lc, op_type, lflow_uuid, conj_id_ofs,
-                                   n_conjs, e);
-            test_lflow_cache_lookup__(lc, lflow_uuid);
+            test_lflow_cache_add__(lc, op_type, lflow_uuid,
+                                   shared ? "shared-key" : NULL,
+                                   conj_id_ofs, n_conjs, cost, e);
+            const struct lflow_cache_value *lcv =
+                test_lflow_cache_lookup__(lc, lflow_uuid);
+            if (shared && lcv) {
+                printf("  ref_count: %"PRIu32"\n", lcv->ref_count);
+            }
         } else if (!strcmp(op, "add-del")) {
             const char *op_type = test_read_value(ctx, shift++, "op_type");
             if (!op_type) {
@@ -182,8 +204,8 @@ test_lflow_cache_operations(struct ovs_cmdl_context *ctx)
 
             struct uuid lflow_uuid;
             uuid_generate(&lflow_uuid);
-            test_lflow_cache_add__(lc, op_type, &lflow_uuid, conj_id_ofs,
-                                   n_conjs, e);
+            test_lflow_cache_add__(lc, op_type, &lflow_uuid, NULL,
+                                   conj_id_ofs, n_conjs, 0, e);
             test_lflow_cache_lookup__(lc, &lflow_uuid);
             test_lflow_cache_delete__(lc, &lflow_uuid);
             test_lflow_cache_lookup__(lc, &lflow_uuid);
@@ -269,15 +291,253 @@ test_lflow_cache_negative(struct ovs_cmdl_context *ctx OVS_UNUSED)
         ovs_assert(expr_to_matches(e, NULL, NULL, matches) == 0);
         ovs_assert(hmap_count(matches) == 1);
 
-        lflow_cache_add_expr(lcs[i], NULL, NULL, 0);
-        lflow_cache_add_expr(lcs[i], NULL, e, expr_size(e));
-        lflow_cache_add_matches(lcs[i], NULL, 0, 0, NULL, 0);
-        lflow_cache_add_matches(lcs[i], NULL, 0, 0, matches,
-                                TEST_LFLOW_CACHE_VALUE_SIZE);
+        lflow_cache_add_expr(lcs[i], NULL, NULL, NULL, 0, 0);
+        lflow_cache_add_expr(lcs[i], NULL, NULL, e, expr_size(e), 0);
+        lflow_cache_add_matches(lcs[i], NULL, 0, NULL, 0, 0, NULL, 0, 0);
+        lflow_cache_add_matches(lcs[i], NULL, 0, NULL, 0, 0, matches,
+                                TEST_LFLOW_CACHE_VALUE_SIZE, 0);
         lflow_cache_destroy(lcs[i]);
     }
 }
 
+/* lflow-cache.c counts the trims with this coverage counter, whose count()
+ * function returns and zeroes the count of the calling thread. */
+extern struct coverage_counter counter_lflow_cache_trim;
+
+struct bench_latencies {
+    const char *name;
+    long long int *ns;
+    size_t n;
+};
+
+static void
+bench_latencies_init(struct bench_latencies *bl, const char *name,
+                     size_t max)
+{
+    bl->name = name;
+    bl->ns = xmalloc(MAX(max, 1) * sizeof *bl->ns);
+    bl->n = 0;
+}
+
+static long long int
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    time_timespec(&ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int
+bench_compare_ns(const void *a_, const void *b_)
+{
+    const long long int *a = a_;
+    const long long int *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+static void
+bench_latencies_report(struct bench_latencies *bl)
+{
+    if (!bl->n) {
+        printf("%-8s: no operations\n", bl->name);
+    } else {
+        qsort(bl->ns, bl->n, sizeof *bl->ns, bench_compare_ns);
+        printf("%-8s: %"PRIuSIZE" ops, p50 %lld ns, p90 %lld ns, "
+               "p99 %lld ns, max %lld ns\n", bl->name, bl->n,
+               bl->ns[bl->n / 2], bl->ns[bl->n * 9 / 10],
+               bl->ns[bl->n * 99 / 100], bl->ns[bl->n - 1]);
+    }
+    free(bl->ns);
+}
+
+/* Returns the number of bytes of the heap in use, or 0 if unknown. */
+static uint64_t
+bench_heap_in_use(const struct lflow_cache *lc)
+{
+    struct simap usage = SIMAP_INITIALIZER(&usage);
+
+    lflow_cache_get_memory_usage(lc, &usage);
+    uint64_t heap_kb = simap_get(&usage, "heap-KB");
+    uint64_t free_kb = simap_get(&usage, "heap-free-KB");
+    simap_destroy(&usage);
+
+    return heap_kb > free_kb ? (heap_kb - free_kb) * 1024 : 0;
+}
+
+/* Adds to 'lc' an entry for 'lflow_uuid', alternately of type
+ * LCACHE_T_EXPR, with a copy of 'expr', and LCACHE_T_MATCHES, with the
+ * matches of 'expr', and returns the time it took in ns. */
+static long long int
+bench_lflow_cache_add(struct lflow_cache *lc, const struct uuid *lflow_uuid,
+                      const struct expr *expr, size_t i)
+{
+    long long int start;
+
+    if (i % 2) {
+        struct expr *copy = expr_clone(expr);
+        size_t size = expr_size(copy);
+
+        start = bench_now_ns();
+        lflow_cache_add_expr(lc, lflow_uuid, NULL, copy, size, 100);
+    } else {
+        struct hmap *matches = xmalloc(sizeof *matches);
+        expr_to_matches(expr, NULL, NULL, matches);
+        size_t size = expr_matches_prepare(matches, 0);
+
+        start = bench_now_ns();
+        lflow_cache_add_matches(lc, lflow_uuid, 0, NULL, 0, 0, matches,
+                                size, 100);
+    }
+    return bench_now_ns() - start;
+}
+
+static void
+test_lflow_cache_benchmark(struct ovs_cmdl_context *ctx)
+{
+    unsigned int n_entries;
+    unsigned int n_ops;
+    unsigned int capacity = UINT32_MAX;
+    unsigned int mem_limit_kb = UINT32_MAX;
+    unsigned int trim_wmark_perc = TEST_LFLOW_CACHE_TRIM_WMARK_PERC;
+
+    if (!test_read_uint_value(ctx, 1, "n_entries", &n_entries)
+        || !test_read_uint_value(ctx, 2, "n_ops", &n_ops)
+        || (ctx->argc > 3
+            && !test_read_uint_value(ctx, 3, "capacity", &capacity))
+        || (ctx->argc > 4
+            && !test_read_uint_value(ctx, 4, "mem-limit", &mem_limit_kb))
+        || (ctx->argc > 5
+            && !test_read_uint_value(ctx, 5, "trim-wmark-perc",
+                                     &trim_wmark_perc))) {
+        return;
+    }
+
+    /* A typical match of an ACL, which results in 3 OpenFlow matches. */
+    struct shash symtab;
+    char *error;
+    ovn_init_symtab(&symtab);
+    struct expr *expr = expr_parse_string(
+        "ip4.src == {10.0.0.1, 10.0.0.2, 10.0.0.3} && tcp.dst == 80",
+        &symtab, NULL, NULL, NULL, NULL, 0, &error);
+    if (!error) {
+        expr = expr_annotate(expr, &symtab, &error);
+    }
+    if (error) {
+        ovs_fatal(0, "%s", error);
+    }
+    expr = expr_normalize(expr_simplify(expr));
+
+    struct uuid *lflow_uuids = xmalloc(MAX(n_entries + n_ops, 1)
+                                       * sizeof *lflow_uuids);
+    size_t n_lflow_uuids = 0;
+    struct bench_latencies insert, lookup, delete, trim;
+    bench_latencies_init(&insert, "insert", n_entries + n_ops);
+    bench_latencies_init(&lookup, "lookup", n_ops);
+    bench_latencies_init(&delete, "delete", n_entries + n_ops);
+    bench_latencies_init(&trim, "trim", n_entries + n_ops + 1);
+    random_set_seed(0x1234abcd);
+
+    struct lflow_cache *lc = lflow_cache_create();
+    lflow_cache_enable(lc, true, capacity, mem_limit_kb, 10000,
+                       trim_wmark_perc, 1000);
+    uint64_t heap_start = bench_heap_in_use(lc);
+
+    /* Populate the cache. */
+    for (size_t i = 0; i < n_entries; i++) {
+        struct uuid *lflow_uuid = &lflow_uuids[n_lflow_uuids++];
+
+        uuid_generate(lflow_uuid);
+        insert.ns[insert.n++] = bench_lflow_cache_add(lc, lflow_uuid,
+                                                      expr, i);
+    }
+
+    struct simap usage = SIMAP_INITIALIZER(&usage);
+    lflow_cache_get_memory_usage(lc, &usage);
+    size_t n_cached = simap_get(&usage, "lflow-cache-entries-expr")
+                      + simap_get(&usage, "lflow-cache-entries-matches");
+    uint64_t cache_kb = simap_get(&usage, "lflow-cache-size-KB");
+    simap_destroy(&usage);
+
+    printf("populated %"PRIuSIZE" entries\n", n_cached);
+    uint64_t heap_used = bench_heap_in_use(lc);
+    if (n_cached && heap_used) {
+        printf("memory: %.0f bytes/entry accounted, %.0f bytes/entry "
+               "in the heap\n", cache_kb * 1024.0 / n_cached,
+               (double) (heap_used - MIN(heap_start, heap_used)) / n_cached);
+    }
+
+    /* Mixed workload: 80% lookups, 10% inserts and 10% deletes. */
+    for (size_t i = 0; i < n_ops; i++) {
+        unsigned int op = random_range(10);
+
+        if (op < 8 || !n_lflow_uuids) {
+            size_t idx = n_lflow_uuids ? random_range(n_lflow_uuids) : 0;
+            struct uuid missing = UUID_ZERO;
+            const struct uuid *lflow_uuid = n_lflow_uuids
+                                            ? &lflow_uuids[idx] : &missing;
+            long long int start = bench_now_ns();
+            lflow_cache_get(lc, lflow_uuid);
+            lookup.ns[lookup.n++] = bench_now_ns() - start;
+        } else if (op == 8) {
+            struct uuid *lflow_uuid = &lflow_uuids[n_lflow_uuids++];
+
+            uuid_generate(lflow_uuid);
+            insert.ns[insert.n++] = bench_lflow_cache_add(lc, lflow_uuid,
+                                                          expr, i);
+        } else {
+            size_t idx = random_range(n_lflow_uuids);
+            long long int start = bench_now_ns();
+            lflow_cache_delete(lc, &lflow_uuids[idx]);
+            delete.ns[delete.n++] = bench_now_ns() - start;
+            lflow_uuids[idx] = lflow_uuids[--n_lflow_uuids];
+        }
+    }
+
+    /* Delete 90% of the entries, which trims the cache once it goes below
+     * the trim watermark. */
+    counter_lflow_cache_trim.count();
+    size_t n_keep = n_lflow_uuids / 10;
+    while (n_lflow_uuids > n_keep) {
+        long long int start = bench_now_ns();
+        lflow_cache_delete(lc, &lflow_uuids[--n_lflow_uuids]);
+        long long int elapsed = bench_now_ns() - start;
+
+        delete.ns[delete.n++] = elapsed;
+        if (counter_lflow_cache_trim.count()) {
+            trim.ns[trim.n++] = elapsed;
+        }
+    }
+
+    /* Wait for the cache to be trimmed because of inactivity. */
+    long long int deadline = time_msec() + 5000;
+    while (time_msec() < deadline) {
+        lflow_cache_wait(lc);
+        poll_timer_wait_until(deadline);
+        poll_block();
+
+        long long int start = bench_now_ns();
+        lflow_cache_run(lc);
+        if (counter_lflow_cache_trim.count()) {
+            trim.ns[trim.n++] = bench_now_ns() - start;
+            break;
+        }
+    }
+
+    bench_latencies_report(&insert);
+    bench_latencies_report(&lookup);
+    bench_latencies_report(&delete);
+    bench_latencies_report(&trim);
+    test_lflow_cache_stats__(lc);
+
+    lflow_cache_destroy(lc);
+    free(lflow_uuids);
+    expr_destroy(expr);
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+}
+
 static void
 test_lflow_cache_main(int argc, char *argv[])
 {
@@ -287,6 +547,8 @@ test_lflow_cache_main(int argc, char *argv[])
          test_lflow_cache_operations, OVS_RO},
         {"lflow_cache_negative", NULL, 0, 0,
          test_lflow_cache_negative, OVS_RO},
+        {"lflow_cache_benchmark", NULL, 2, 5,
+         test_lflow_cache_benchmark, OVS_RO},
         {NULL, NULL, 0, 0, NULL, OVS_RO},
     };
     struct ovs_cmdl_context ctx;
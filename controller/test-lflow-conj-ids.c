@@ -97,20 +97,28 @@ test_conj_ids_operations(struct ovs_cmdl_context *ctx)
             printf("alloc_specified("UUID_FMT", 0x%"PRIx32", %"PRIu32"): %s\n",
                    UUID_ARGS(&uuid), start_conj_id, n_conjs,
                    ret ? "true" : "false");
-        } else if (!strcmp(op, "free")) {
+        } else if (!strcmp(op, "free") || !strcmp(op, "release")) {
             struct uuid uuid;
             if (!parse_lflow_uuid(ctx, shift++, &uuid)) {
                 goto done;
             }
             lflow_conj_ids_free(&conj_ids, &uuid);
-            printf("free("UUID_FMT")\n", UUID_ARGS(&uuid));
+            if (!strcmp(op, "free")) {
+                /* As if the lflow wasn't processed again in the same engine
+                 * run. */
+                lflow_conj_ids_purge_released(&conj_ids);
+            }
+            printf("%s("UUID_FMT")\n", op, UUID_ARGS(&uuid));
+        } else if (!strcmp(op, "purge")) {
+            lflow_conj_ids_purge_released(&conj_ids);
+            printf("purge\n");
         } else {
             printf("Unknown operation: %s\n", op);
             goto done;
         }
     }
     struct ds conj_ids_dump = DS_EMPTY_INITIALIZER;
-    lflow_conj_ids_dump(&conj_ids, &conj_ids_dump);
+    lflow_conj_ids_dump(&conj_ids, NULL, &conj_ids_dump);
     printf("%s", ds_cstr(&conj_ids_dump));
     ds_destroy(&conj_ids_dump);
 
@@ -0,0 +1,346 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "include/ovn/logical-fields.h"
+#include "lib/extend-table.h"
+#include "lib/uuidset.h"
+#include "openvswitch/list.h"
+#include "openvswitch/match.h"
+#include "openvswitch/ofp-actions.h"
+#include "openvswitch/ofp-bundle.h"
+#include "openvswitch/ofp-flow.h"
+#include "openvswitch/ofpbuf.h"
+#include "packets.h"
+#include "tests/ovstest.h"
+#include "tests/test-utils.h"
+#include "timeval.h"
+#include "util.h"
+#include "uuid.h"
+
+#include "ofctrl.h"
+
+/* Each synthetic logical flow generates BENCH_PRIVATE_FLOWS flows of its
+ * own, whose actions change with its version, plus a flow that it shares
+ * with the other logical flow of its pair, so that the shared flows have
+ * several SB references.  One logical flow out of BENCH_CONJ_STRIDE also
+ * generates a conjunction, whose clause flows are appended to the ones of
+ * the other conjunctions. */
+#define BENCH_PRIVATE_FLOWS 3
+#define BENCH_CONJ_STRIDE 16
+#define BENCH_CONJ_CLAUSE_MATCHES 64
+
+static struct uuid
+bench_lflow_uuid(size_t idx)
+{
+    return (struct uuid) { .parts = { idx + 1, 0, 0, 0xbe0c } };
+}
+
+static void
+bench_add_lflow(struct ovn_desired_flow_table *table, size_t idx,
+                uint32_t version)
+{
+    struct uuid lflow_uuid = bench_lflow_uuid(idx);
+    uint64_t cookie = lflow_uuid.parts[0];
+    struct ofpbuf ofpacts;
+    struct match match;
+
+    ofpbuf_init(&ofpacts, 0);
+    for (size_t i = 0; i < BENCH_PRIVATE_FLOWS; i++) {
+        match_init_catchall(&match);
+        match_set_metadata(&match, htonll(idx / 64 + 1));
+        match_set_reg(&match, MFF_LOG_INPORT - MFF_REG0,
+                      idx * BENCH_PRIVATE_FLOWS + i);
+
+        ofpbuf_clear(&ofpacts);
+        ofpact_put_OUTPUT(&ofpacts)->port = u16_to_ofp((idx + version) % 64
+                                                       + 1);
+        ofctrl_add_flow(table, 8 + i, 100, cookie, &match, &ofpacts,
+                        &lflow_uuid);
+    }
+
+    match_init_catchall(&match);
+    match_set_metadata(&match, htonll(idx / 2 + 1));
+    ofpbuf_clear(&ofpacts);
+    struct ofpact_resubmit *resubmit = ofpact_put_RESUBMIT(&ofpacts);
+    resubmit->in_port = OFPP_IN_PORT;
+    resubmit->table_id = 41;
+    ofctrl_add_flow(table, 40, 50, 0, &match, &ofpacts, &lflow_uuid);
+
+    if (!(idx % BENCH_CONJ_STRIDE)) {
+        uint32_t conj_id = idx / BENCH_CONJ_STRIDE + 1;
+
+        for (uint8_t clause = 0; clause < 2; clause++) {
+            match_init_catchall(&match);
+            match_set_dl_type(&match, htons(ETH_TYPE_IP));
+            if (!clause) {
+                match_set_nw_src(&match, htonl(0x0a000000 + conj_id
+                                               % BENCH_CONJ_CLAUSE_MATCHES));
+            } else {
+                match_set_nw_proto(&match, IPPROTO_TCP);
+                match_set_tp_dst(&match, htons(1 + conj_id
+                                               % BENCH_CONJ_CLAUSE_MATCHES));
+            }
+
+            ofpbuf_clear(&ofpacts);
+            struct ofpact_conjunction *conj = ofpact_put_CONJUNCTION(&ofpacts);
+            conj->id = conj_id;
+            conj->clause = clause;
+            conj->n_clauses = 2;
+            ofctrl_add_or_append_flow(table, 44, 1000, cookie, &match,
+                                      &ofpacts, &lflow_uuid,
+                                      NX_CTLR_NO_METER, NULL);
+        }
+
+        match_init_catchall(&match);
+        match_set_conj_id(&match, conj_id);
+        ofpbuf_clear(&ofpacts);
+        ofpact_put_OUTPUT(&ofpacts)->port = u16_to_ofp((conj_id + version)
+                                                       % 64 + 1);
+        ofctrl_add_flow(table, 44, 1000, cookie, &match, &ofpacts,
+                        &lflow_uuid);
+    }
+    ofpbuf_uninit(&ofpacts);
+}
+
+/* Returns true if the logical flow 'idx' changes in 'round'. */
+static bool
+bench_lflow_changes(size_t idx, unsigned int round, unsigned int change_perc)
+{
+    return (idx * 7919 + round * 31) % 100 < change_perc;
+}
+
+static size_t
+bench_diff(struct ovn_desired_flow_table *table, long long int *usec)
+{
+    struct ovs_list msgs = OVS_LIST_INITIALIZER(&msgs);
+
+    long long int start = time_usec();
+    size_t n_bytes = ofctrl_diff_lflows(table, &msgs);
+    *usec += time_usec() - start;
+
+    struct ofpbuf *msg;
+    LIST_FOR_EACH_POP (msg, list_node, &msgs) {
+        ofpbuf_delete(msg);
+    }
+    return n_bytes;
+}
+
+static void
+bench_report(const char *name, unsigned int n_rounds, long long int usec,
+             size_t n_bytes)
+{
+    printf("%s: %u rounds, %lld usec/round, %"PRIuSIZE" bytes/round\n",
+           name, n_rounds, usec / n_rounds, n_bytes / n_rounds);
+}
+
+/* Installs the flows of N_LFLOWS synthetic logical flows, then N_ROUNDS
+ * times changes the actions of CHANGE_PERC percent of them, as an
+ * incremental update diffed by track and as a recompute diffed by compare,
+ * and prints the time spent in the diff and the size of the flow_mods it
+ * generated.  The flow_mods are discarded instead of being sent. */
+static void
+test_ofctrl_diff_benchmark(struct ovs_cmdl_context *ctx)
+{
+    unsigned int n_lflows;
+    unsigned int n_rounds;
+    unsigned int change_perc = 10;
+    unsigned int shift = 1;
+
+    if (!test_read_uint_value(ctx, shift++, "n_lflows", &n_lflows)
+        || !test_read_uint_value(ctx, shift++, "n_rounds", &n_rounds)) {
+        return;
+    }
+    if (ctx->argc > shift
+        && !test_read_uint_value(ctx, shift++, "change_perc",
+                                 &change_perc)) {
+        return;
+    }
+    if (!n_rounds || change_perc > 100) {
+        fprintf(stderr, "Invalid n_rounds or change_perc\n");
+        return;
+    }
+
+    struct ovn_extend_table group_table;
+    struct ovn_extend_table meter_table;
+    ovn_extend_table_init(&group_table, "group-table", 0);
+    ovn_extend_table_init(&meter_table, "meter-table", 0);
+    ofctrl_init(&group_table, NULL, &meter_table);
+
+    struct ovn_desired_flow_table table;
+    ovn_desired_flow_table_init(&table);
+    uint32_t *versions = xcalloc(n_lflows, sizeof *versions);
+
+    long long int usec = 0;
+    for (size_t i = 0; i < n_lflows; i++) {
+        bench_add_lflow(&table, i, 0);
+    }
+    size_t n_flows = resizing_hmap_count(&table.match_flow_table);
+    size_t n_bytes = bench_diff(&table, &usec);
+    printf("installed %u logical flows, %"PRIuSIZE" flows: "
+           "%lld usec, %"PRIuSIZE" bytes\n",
+           n_lflows, n_flows, usec, n_bytes);
+
+    /* Incremental processing: the logical flows that change are removed,
+     * along with the ones that share flows with them, and added back. */
+    usec = 0;
+    n_bytes = 0;
+    for (unsigned int round = 0; round < n_rounds; round++) {
+        struct uuidset changed = UUIDSET_INITIALIZER(&changed);
+        for (size_t i = 0; i < n_lflows; i++) {
+            if (bench_lflow_changes(i, round, change_perc)) {
+                versions[i]++;
+                struct uuid lflow_uuid = bench_lflow_uuid(i);
+                uuidset_insert(&changed, &lflow_uuid);
+            }
+        }
+        ofctrl_flood_remove_flows(&table, &changed);
+
+        const struct uuidset_node *node;
+        UUIDSET_FOR_EACH (node, &changed) {
+            size_t idx = node->uuid.parts[0] - 1;
+            bench_add_lflow(&table, idx, versions[idx]);
+        }
+        uuidset_destroy(&changed);
+
+        n_bytes += bench_diff(&table, &usec);
+    }
+    bench_report("by-track", n_rounds, usec, n_bytes);
+
+    /* Recompute: all the logical flows are added back after a change. */
+    usec = 0;
+    n_bytes = 0;
+    for (unsigned int round = 0; round < n_rounds; round++) {
+        ovn_desired_flow_table_clear(&table);
+        for (size_t i = 0; i < n_lflows; i++) {
+            if (bench_lflow_changes(i, n_rounds + round, change_perc)) {
+                versions[i]++;
+            }
+            bench_add_lflow(&table, i, versions[i]);
+        }
+        n_bytes += bench_diff(&table, &usec);
+    }
+    bench_report("by-compare", n_rounds, usec, n_bytes);
+
+    free(versions);
+    ovn_desired_flow_table_destroy(&table);
+    ofctrl_destroy();
+    ovn_extend_table_destroy(&group_table);
+    ovn_extend_table_destroy(&meter_table);
+}
+
+/* Checks that ofctrl_encode_bundle_flow_mod() encodes the same messages as
+ * ofputil_encode_bundle_add() for the flow_mods of ofputil_encode_flow_mod(),
+ * for each kind of flow_mod that ofctrl sends. */
+static void
+test_ofctrl_diff_encode(struct ovs_cmdl_context *ctx OVS_UNUSED)
+{
+    struct ofputil_bundle_ctrl_msg bc = {
+        .bundle_id = 7,
+        .flags = OFPBF_ORDERED | OFPBF_ATOMIC,
+    };
+    struct ofpbuf ofpacts;
+    struct match match;
+
+    ofpbuf_init(&ofpacts, 0);
+    ofpact_put_OUTPUT(&ofpacts)->port = u16_to_ofp(3);
+    struct ofpact_resubmit *resubmit = ofpact_put_RESUBMIT(&ofpacts);
+    resubmit->in_port = OFPP_IN_PORT;
+    resubmit->table_id = 41;
+
+    match_init_catchall(&match);
+    match_set_metadata(&match, htonll(5));
+    match_set_reg(&match, MFF_LOG_INPORT - MFF_REG0, 3);
+    match_set_dl_type(&match, htons(ETH_TYPE_IP));
+
+    struct ofputil_flow_mod fms[] = {
+        { .table_id = 8, .priority = 100, .new_cookie = htonll(0xabc),
+          .command = OFPFC_ADD,
+          .ofpacts = ofpacts.data, .ofpacts_len = ofpacts.size },
+        { .table_id = 8, .priority = 100,
+          .command = OFPFC_MODIFY_STRICT,
+          .ofpacts = ofpacts.data, .ofpacts_len = ofpacts.size },
+        { .table_id = 8, .priority = 100, .command = OFPFC_DELETE_STRICT },
+        { .table_id = OFPTT_ALL, .command = OFPFC_DELETE },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(fms); i++) {
+        struct ofputil_flow_mod *fm = &fms[i];
+
+        if (fm->table_id == OFPTT_ALL) {
+            minimatch_init_catchall(&fm->match);
+        } else {
+            minimatch_init(&fm->match, &match);
+        }
+
+        size_t flow_mod_len;
+        struct ofpbuf *msg = ofctrl_encode_bundle_flow_mod(fm, &bc,
+                                                           &flow_mod_len);
+
+        struct ofputil_flow_mod copy = *fm;
+        copy.buffer_id = UINT32_MAX;
+        copy.out_port = OFPP_ANY;
+        copy.out_group = OFPG_ANY;
+        struct ofpbuf *fm_msg = ofputil_encode_flow_mod(&copy,
+                                                        OFPUTIL_P_OF15_OXM);
+        struct ofputil_bundle_add_msg bam = {
+            .bundle_id = bc.bundle_id,
+            .flags = bc.flags,
+            .msg = fm_msg->data,
+        };
+        struct ofpbuf *expected = ofputil_encode_bundle_add(OFP15_VERSION,
+                                                            &bam);
+
+        /* Only the xids, of the bundle message and of the flow_mod in it,
+         * differ. */
+        ovs_assert(flow_mod_len == fm_msg->size);
+        ovs_assert(msg->size == expected->size);
+        size_t xid_ofs[] = {
+            offsetof(struct ofp_header, xid),
+            sizeof(struct ofp_header) + sizeof(struct ofp14_bundle_ctrl_msg)
+            + offsetof(struct ofp_header, xid),
+        };
+        for (size_t j = 0; j < ARRAY_SIZE(xid_ofs); j++) {
+            memcpy((char *) msg->data + xid_ofs[j],
+                   (char *) expected->data + xid_ofs[j], sizeof(ovs_be32));
+        }
+        ovs_assert(!memcmp(msg->data, expected->data, msg->size));
+        printf("flow_mod %"PRIuSIZE": %"PRIuSIZE" bytes\n", i, msg->size);
+
+        ofpbuf_delete(msg);
+        ofpbuf_delete(fm_msg);
+        ofpbuf_delete(expected);
+        minimatch_destroy(&fm->match);
+    }
+    ofpbuf_uninit(&ofpacts);
+}
+
+static void
+test_ofctrl_diff_main(int argc, char *argv[])
+{
+    set_program_name(argv[0]);
+    static const struct ovs_cmdl_command commands[] = {
+        {"benchmark", "N_LFLOWS N_ROUNDS [CHANGE_PERC]", 2, 3,
+         test_ofctrl_diff_benchmark, OVS_RO},
+        {"encode", NULL, 0, 0, test_ofctrl_diff_encode, OVS_RO},
+        {NULL, NULL, 0, 0, NULL, OVS_RO},
+    };
+    struct ovs_cmdl_context ctx;
+    ctx.argc = argc - 1;
+    ctx.argv = argv + 1;
+    ovs_cmdl_run_command(&ctx, commands);
+}
+
+OVSTEST_REGISTER("test-ofctrl-diff", test_ofctrl_diff_main);
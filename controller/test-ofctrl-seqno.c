@@ -97,16 +97,19 @@ test_ofctrl_seqno_add_type(struct ovs_cmdl_context *ctx)
     }
 }
 
+/* Parses the seqno requests and acks starting at argument 'shift' of 'ctx'
+ * and runs the acks, for all the seqno types if 'ack_type' is SIZE_MAX or
+ * only for 'ack_type' otherwise. */
 static void
-test_ofctrl_seqno_ack_seqnos(struct ovs_cmdl_context *ctx)
+test_ofctrl_seqno_ack_seqnos__(struct ovs_cmdl_context *ctx,
+                               unsigned int shift, bool batch_acks,
+                               size_t ack_type)
 {
     unsigned int n_reqs = 0;
-    unsigned int shift = 2;
     unsigned int n_types;
     unsigned int n_acks;
 
     test_init();
-    bool batch_acks = !strcmp(ctx->argv[1], "true");
 
     if (!test_read_uint_value(ctx, shift++, "n_types", &n_types)) {
         return;
@@ -144,7 +147,11 @@ test_ofctrl_seqno_ack_seqnos(struct ovs_cmdl_context *ctx)
         if (!test_read_ullong_value(ctx, shift++, "ack_seqno", &ack_seqno)) {
             return;
         }
-        ofctrl_seqno_run(ack_seqno);
+        if (ack_type == SIZE_MAX) {
+            ofctrl_seqno_run(ack_seqno);
+        } else {
+            ofctrl_seqno_run_type(ack_type, ack_seqno);
+        }
 
         if (!batch_acks) {
             for (unsigned int st = 0; st < n_types; st++) {
@@ -159,6 +166,25 @@ test_ofctrl_seqno_ack_seqnos(struct ovs_cmdl_context *ctx)
     }
 }
 
+static void
+test_ofctrl_seqno_ack_seqnos(struct ovs_cmdl_context *ctx)
+{
+    bool batch_acks = !strcmp(ctx->argv[1], "true");
+
+    test_ofctrl_seqno_ack_seqnos__(ctx, 2, batch_acks, SIZE_MAX);
+}
+
+static void
+test_ofctrl_seqno_ack_type_seqnos(struct ovs_cmdl_context *ctx)
+{
+    unsigned int ack_type;
+
+    if (!test_read_uint_value(ctx, 1, "ack_type", &ack_type)) {
+        return;
+    }
+    test_ofctrl_seqno_ack_seqnos__(ctx, 2, false, ack_type);
+}
+
 static void
 test_ofctrl_seqno_main(int argc, char *argv[])
 {
@@ -168,6 +194,8 @@ test_ofctrl_seqno_main(int argc, char *argv[])
          test_ofctrl_seqno_add_type, OVS_RO},
         {"ofctrl_seqno_ack_seqnos", NULL, 2, INT_MAX,
          test_ofctrl_seqno_ack_seqnos, OVS_RO},
+        {"ofctrl_seqno_ack_type_seqnos", NULL, 2, INT_MAX,
+         test_ofctrl_seqno_ack_type_seqnos, OVS_RO},
         {NULL, NULL, 0, 0, NULL, OVS_RO},
     };
     struct ovs_cmdl_context ctx;
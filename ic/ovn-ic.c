@@ -27,6 +27,8 @@
 #include "openvswitch/dynamic-string.h"
 #include "fatal-signal.h"
 #include "hash.h"
+#include "hmapx.h"
+#include "lib/inc-proc-eng.h"
 #include "openvswitch/hmap.h"
 #include "lib/ovn-ic-nb-idl.h"
 #include "lib/ovn-ic-sb-idl.h"
@@ -41,9 +43,13 @@
 #include "sset.h"
 #include "stream.h"
 #include "stream-ssl.h"
+#include "stopwatch.h"
+#include "lib/stopwatch-names.h"
+#include "timeval.h"
 #include "unixctl.h"
 #include "util.h"
 #include "uuid.h"
+#include "uuidset.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(ovn_ic);
@@ -88,6 +94,11 @@ static const char *ovn_ic_nb_db;
 static const char *ovn_ic_sb_db;
 static const char *unixctl_path;
 
+/* The transit switches and the routers of the AZ are split between
+ * 'n_shards' active ovn-ic instances, this one serving shard 'shard_id'. */
+static unsigned int n_shards = 1;
+static unsigned int shard_id;
+
 /* SSL options */
 static const char *ssl_private_key_file;
 static const char *ssl_certificate_file;
@@ -111,6 +122,8 @@ Options:\n\
   --ic-sb-db=DATABASE       connect to ovn-ic-sb database at DATABASE\n\
                             (default: %s)\n\
   --unixctl=SOCKET          override default control socket name\n\
+  --n-shards=N              split the sync between N ovn-ic instances\n\
+  --shard=ID                sync shard ID, in [0, N - 1], of the AZ\n\
   -h, --help                display this help message\n\
   -o, --options             list available options\n\
   -V, --version             display version information\n\
@@ -120,6 +133,31 @@ Options:\n\
     vlog_usage();
     stream_usage("database", true, true, false);
 }
+
+/* Returns true if this instance serves shard 0, which also runs the syncs
+ * that are not split: the AZ registration, the transit switches, the
+ * gateways and the sequence numbers. */
+static bool
+ic_shard_is_primary(void)
+{
+    return !shard_id;
+}
+
+/* Returns true if the ports of transit switch 'ts_name' are synced by this
+ * instance. */
+static bool
+ic_shard_owns_ts(const char *ts_name)
+{
+    return n_shards == 1 || hash_string(ts_name, 0) % n_shards == shard_id;
+}
+
+/* Returns true if the routes of the logical router with 'lr_uuid' are
+ * synced by this instance. */
+static bool
+ic_shard_owns_lr(const struct uuid *lr_uuid)
+{
+    return n_shards == 1 || uuid_hash(lr_uuid) % n_shards == shard_id;
+}
 
 static const struct icsbrec_availability_zone *
 az_run(struct ic_context *ctx)
@@ -139,6 +177,9 @@ az_run(struct ic_context *ctx)
     const struct icsbrec_availability_zone *az;
     if (az_name && strcmp(az_name, nb_global->name)) {
         ICSBREC_AVAILABILITY_ZONE_FOR_EACH (az, ctx->ovnisb_idl) {
+            if (!ic_shard_is_primary()) {
+                break;
+            }
             /* AZ name update locally need to update az in ISB. */
             if (nb_global->name[0] && !strcmp(az->name, az_name)) {
                 icsbrec_availability_zone_set_name(az, nb_global->name);
@@ -171,7 +212,7 @@ az_run(struct ic_context *ctx)
     }
 
     /* Create AZ in ISB */
-    if (ctx->ovnisb_txn) {
+    if (ctx->ovnisb_txn && ic_shard_is_primary()) {
         VLOG_INFO("Register AZ %s to interconnection DB.", az_name);
         az = icsbrec_availability_zone_insert(ctx->ovnisb_txn);
         icsbrec_availability_zone_set_name(az, az_name);
@@ -181,7 +222,7 @@ az_run(struct ic_context *ctx)
 }
 
 static uint32_t
-allocate_ts_dp_key(struct hmap *dp_tnlids)
+allocate_ts_dp_key(struct ovn_tnlids *dp_tnlids)
 {
     static uint32_t hint = OVN_MIN_DP_KEY_GLOBAL;
     return ovn_allocate_tnlid(dp_tnlids, "transit switch datapath",
@@ -192,9 +233,14 @@ allocate_ts_dp_key(struct hmap *dp_tnlids)
 static void
 ts_run(struct ic_context *ctx)
 {
+    if (!ic_shard_is_primary()) {
+        return;
+    }
+
     const struct icnbrec_transit_switch *ts;
 
-    struct hmap dp_tnlids = HMAP_INITIALIZER(&dp_tnlids);
+    struct ovn_tnlids dp_tnlids;
+    ovn_tnlids_init(&dp_tnlids, OVN_MIN_DP_KEY_GLOBAL, OVN_MAX_DP_KEY_GLOBAL);
     struct shash isb_dps = SHASH_INITIALIZER(&isb_dps);
     const struct icsbrec_datapath_binding *isb_dp;
     ICSBREC_DATAPATH_BINDING_FOR_EACH (isb_dp, ctx->ovnisb_idl) {
@@ -373,7 +419,7 @@ sync_sb_gw_to_isb(struct ic_context *ctx,
 static void
 gateway_run(struct ic_context *ctx, const struct icsbrec_availability_zone *az)
 {
-    if (!ctx->ovnisb_txn || !ctx->ovnsb_txn) {
+    if (!ctx->ovnisb_txn || !ctx->ovnsb_txn || !ic_shard_is_primary()) {
         return;
     }
 
@@ -491,28 +537,24 @@ find_crp_from_lrp(struct ic_context *ctx,
     return pb;
 }
 
-static const struct sbrec_port_binding *
-find_crp_for_sb_pb(struct ic_context *ctx,
-                   const struct sbrec_port_binding *sb_pb)
+static const char *
+get_lrp_address(const struct sbrec_port_binding *lrp_pb)
 {
-    const struct sbrec_port_binding *peer = find_peer_port(ctx, sb_pb);
-    if (!peer) {
-        return NULL;
-    }
-
-    return find_crp_from_lrp(ctx, peer);
+    return lrp_pb && lrp_pb->n_mac ? *lrp_pb->mac : NULL;
 }
 
+/* Returns the name of the gateway chassis of the router port 'lrp_pb', or
+ * NULL if it has none. */
 static const char *
-get_lrp_address_for_sb_pb(struct ic_context *ctx,
-                          const struct sbrec_port_binding *sb_pb)
+get_lrp_gateway(struct ic_context *ctx,
+                const struct sbrec_port_binding *lrp_pb)
 {
-    const struct sbrec_port_binding *peer = find_peer_port(ctx, sb_pb);
-    if (!peer) {
+    if (!lrp_pb) {
         return NULL;
     }
 
-    return peer->n_mac ? *peer->mac : NULL;
+    const struct sbrec_port_binding *crp = find_crp_from_lrp(ctx, lrp_pb);
+    return crp && crp->chassis ? crp->chassis->name : NULL;
 }
 
 static const struct sbrec_chassis *
@@ -547,13 +589,11 @@ sync_lsp_tnl_key(const struct nbrec_logical_switch_port *lsp,
 }
 
 static bool
-get_router_uuid_by_sb_pb(struct ic_context *ctx,
-                         const struct sbrec_port_binding *sb_pb,
-                         struct uuid *router_uuid)
+get_router_uuid_by_lrp(const struct sbrec_port_binding *router_pb,
+                       struct uuid *router_uuid)
 {
-    const struct sbrec_port_binding *router_pb = find_peer_port(ctx, sb_pb);
     if (!router_pb || !router_pb->datapath) {
-        return NULL;
+        return false;
     }
 
     return smap_get_uuid(&router_pb->datapath->external_ids, "logical-router",
@@ -561,12 +601,11 @@ get_router_uuid_by_sb_pb(struct ic_context *ctx,
 }
 
 static void
-update_isb_pb_external_ids(struct ic_context *ctx,
-                           const struct sbrec_port_binding *sb_pb,
+update_isb_pb_external_ids(const struct sbrec_port_binding *lrp_pb,
                            const struct icsbrec_port_binding *isb_pb)
 {
     struct uuid lr_uuid;
-    if (!get_router_uuid_by_sb_pb(ctx, sb_pb, &lr_uuid)) {
+    if (!get_router_uuid_by_lrp(lrp_pb, &lr_uuid)) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
         VLOG_WARN_RL(&rl, "Can't get router uuid for transit switch port %s.",
                      isb_pb->logical_port);
@@ -593,14 +632,14 @@ update_isb_pb_external_ids(struct ic_context *ctx,
 static void
 sync_local_port(struct ic_context *ctx,
                 const struct icsbrec_port_binding *isb_pb,
-                const struct sbrec_port_binding *sb_pb,
+                const struct sbrec_port_binding *lrp_pb,
                 const struct nbrec_logical_switch_port *lsp)
 {
     /* Sync address from NB to ISB */
-    const char *address = get_lrp_address_for_sb_pb(ctx, sb_pb);
+    const char *address = get_lrp_address(lrp_pb);
     if (!address) {
         VLOG_DBG("Can't get logical router port address for logical"
-                 " switch port %s", sb_pb->logical_port);
+                 " switch port %s", lsp->name);
         if (isb_pb->address[0]) {
             icsbrec_port_binding_set_address(isb_pb, "");
         }
@@ -611,10 +650,10 @@ sync_local_port(struct ic_context *ctx,
     }
 
     /* Sync gateway from SB to ISB */
-    const struct sbrec_port_binding *crp = find_crp_for_sb_pb(ctx, sb_pb);
-    if (crp && crp->chassis) {
-        if (strcmp(crp->chassis->name, isb_pb->gateway)) {
-            icsbrec_port_binding_set_gateway(isb_pb, crp->chassis->name);
+    const char *gateway = get_lrp_gateway(ctx, lrp_pb);
+    if (gateway) {
+        if (strcmp(gateway, isb_pb->gateway)) {
+            icsbrec_port_binding_set_gateway(isb_pb, gateway);
         }
     } else {
         if (isb_pb->gateway[0]) {
@@ -623,7 +662,7 @@ sync_local_port(struct ic_context *ctx,
     }
 
     /* Sync external_ids:router-id to ISB */
-    update_isb_pb_external_ids(ctx, sb_pb, isb_pb);
+    update_isb_pb_external_ids(lrp_pb, isb_pb);
 
     /* Sync back tunnel key from ISB to NB */
     sync_lsp_tnl_key(lsp, isb_pb->tunnel_key);
@@ -704,6 +743,7 @@ create_nb_lsp(struct ic_context *ctx,
 static void
 create_isb_pb(struct ic_context *ctx,
               const struct sbrec_port_binding *sb_pb,
+              const struct sbrec_port_binding *lrp_pb,
               const struct icsbrec_availability_zone *az,
               const char *ts_name,
               uint32_t pb_tnl_key)
@@ -715,17 +755,17 @@ create_isb_pb(struct ic_context *ctx,
     icsbrec_port_binding_set_logical_port(isb_pb, sb_pb->logical_port);
     icsbrec_port_binding_set_tunnel_key(isb_pb, pb_tnl_key);
 
-    const char *address = get_lrp_address_for_sb_pb(ctx, sb_pb);
+    const char *address = get_lrp_address(lrp_pb);
     if (address) {
         icsbrec_port_binding_set_address(isb_pb, address);
     }
 
-    const struct sbrec_port_binding *crp = find_crp_for_sb_pb(ctx, sb_pb);
-    if (crp && crp->chassis) {
-        icsbrec_port_binding_set_gateway(isb_pb, crp->chassis->name);
+    const char *gateway = get_lrp_gateway(ctx, lrp_pb);
+    if (gateway) {
+        icsbrec_port_binding_set_gateway(isb_pb, gateway);
     }
 
-    update_isb_pb_external_ids(ctx, sb_pb, isb_pb);
+    update_isb_pb_external_ids(lrp_pb, isb_pb);
 
     /* XXX: Sync encap so that multiple encaps can be used for the same
      * gateway.  However, it is not needed for now, since we don't yet
@@ -743,7 +783,7 @@ find_lsp_in_sb(struct ic_context *ctx,
 }
 
 static uint32_t
-allocate_port_key(struct hmap *pb_tnlids)
+allocate_port_key(struct ovn_tnlids *pb_tnlids)
 {
     static uint32_t hint;
     return ovn_allocate_tnlid(pb_tnlids, "transit port",
@@ -768,13 +808,19 @@ port_binding_run(struct ic_context *ctx,
 
     ICSBREC_PORT_BINDING_FOR_EACH_EQUAL (isb_pb, isb_pb_key,
                                          ctx->icsbrec_port_binding_by_az) {
-        shash_add(&isb_all_local_pbs, isb_pb->logical_port, isb_pb);
+        if (ic_shard_owns_ts(isb_pb->transit_switch)) {
+            shash_add(&isb_all_local_pbs, isb_pb->logical_port, isb_pb);
+        }
     }
     icsbrec_port_binding_index_destroy_row(isb_pb_key);
 
     const struct sbrec_port_binding *sb_pb;
     const struct icnbrec_transit_switch *ts;
     ICNBREC_TRANSIT_SWITCH_FOR_EACH (ts, ctx->ovninb_idl) {
+        if (!ic_shard_owns_ts(ts->name)) {
+            continue;
+        }
+
         const struct nbrec_logical_switch *ls = find_ts_in_nb(ctx, ts->name);
         if (!ls) {
             VLOG_DBG("Transit switch %s not found in NB.", ts->name);
@@ -782,7 +828,8 @@ port_binding_run(struct ic_context *ctx,
         }
         struct shash local_pbs = SHASH_INITIALIZER(&local_pbs);
         struct shash remote_pbs = SHASH_INITIALIZER(&remote_pbs);
-        struct hmap pb_tnlids = HMAP_INITIALIZER(&pb_tnlids);
+        struct ovn_tnlids pb_tnlids;
+        ovn_tnlids_init(&pb_tnlids, 1, (1u << 15) - 1);
         isb_pb_key = icsbrec_port_binding_index_init_row(
             ctx->icsbrec_port_binding_by_ts);
         icsbrec_port_binding_index_set_transit_switch(isb_pb_key, ts->name);
@@ -810,12 +857,17 @@ port_binding_run(struct ic_context *ctx,
                 if (!sb_pb) {
                     continue;
                 }
+                /* The peer router port is looked up only once for all the
+                 * info that is synced from it. */
+                const struct sbrec_port_binding *lrp_pb =
+                    find_peer_port(ctx, sb_pb);
                 isb_pb = shash_find_and_delete(&local_pbs, lsp->name);
                 if (!isb_pb) {
                     uint32_t pb_tnl_key = allocate_port_key(&pb_tnlids);
-                    create_isb_pb(ctx, sb_pb, az, ts->name, pb_tnl_key);
+                    create_isb_pb(ctx, sb_pb, lrp_pb, az, ts->name,
+                                  pb_tnl_key);
                 } else {
-                    sync_local_port(ctx, isb_pb, sb_pb, lsp);
+                    sync_local_port(ctx, isb_pb, lrp_pb, lsp);
                 }
             } else if (!strcmp(lsp->type, "remote")) {
                 /* The port is remote. */
@@ -864,6 +916,31 @@ struct ic_router_info {
     size_t n_isb_pbs;
     size_t n_allocated_isb_pbs;
     struct hmap routes_learned;
+
+    /* Static routes and ports of 'lr'. */
+    struct ic_router_item **items;
+    size_t n_items;
+    size_t n_allocated_items;
+};
+
+/* A static route or a port of an interconnected router, to find the router
+ * that a change to either of them affects. */
+struct ic_router_item {
+    struct hmap_node node;      /* In 'struct ic_routers''s 'items'. */
+    struct uuid uuid;           /* Of the NB static route or router port. */
+    struct ic_router_info *ic_lr;
+};
+
+/* The logical routers of an AZ that are connected to transit switches, kept
+ * between runs so that only the routers affected by a change have to be
+ * synced again. */
+struct ic_routers {
+    struct hmap ic_lrs;         /* "struct ic_router_info"s. */
+    struct hmap items;          /* "struct ic_router_item"s, by uuid. */
+    struct shash ts_lrs;        /* Transit switch name -> "struct hmapx" of
+                                 * the "struct ic_router_info"s on it. */
+    struct uuidset missing_lrs; /* Routers of IC-SB port bindings that are
+                                 * not in NB (yet). */
 };
 
 /* Represents an interconnection route entry. */
@@ -1490,11 +1567,37 @@ ad_route_sync_external_ids(const struct ic_route_info *route_adv,
     }
 }
 
-/* Sync routes from routes_ad to IC-SB. */
+/* Returns true if 'isb_route' was advertised by logical router 'lr'. */
+static bool
+isb_route_is_of_lr(const struct icsbrec_route *isb_route,
+                   const struct nbrec_logical_router *lr)
+{
+    struct uuid lr_uuid;
+    return smap_get_uuid(&isb_route->external_ids, "lr-id", &lr_uuid) &&
+           uuid_equals(&lr_uuid, &lr->header_.uuid);
+}
+
+/* Returns true if 'isb_route' was advertised by a logical router of this
+ * shard.  The routes without a router are deleted by shard 0. */
+static bool
+isb_route_is_of_shard(const struct icsbrec_route *isb_route)
+{
+    struct uuid lr_uuid;
+    if (!smap_get_uuid(&isb_route->external_ids, "lr-id", &lr_uuid)) {
+        return ic_shard_is_primary();
+    }
+    return ic_shard_owns_lr(&lr_uuid);
+}
+
+/* Sync routes from routes_ad to IC-SB.  If 'lr' is nonnull, 'routes_ad' only
+ * contains the routes of that router and the routes advertised by the other
+ * routers of the transit switch are left alone.  Otherwise, 'routes_ad'
+ * contains the routes of all the routers of this shard. */
 static void
 advertise_routes(struct ic_context *ctx,
                  const struct icsbrec_availability_zone *az,
                  const char *ts_name,
+                 const struct nbrec_logical_router *lr,
                  struct hmap *routes_ad)
 {
     ovs_assert(ctx->ovnisb_txn);
@@ -1506,9 +1609,13 @@ advertise_routes(struct ic_context *ctx,
 
     ICSBREC_ROUTE_FOR_EACH_EQUAL (isb_route, isb_route_key,
                                   ctx->icsbrec_route_by_ts_az) {
+        if (lr ? !isb_route_is_of_lr(isb_route, lr)
+               : !isb_route_is_of_shard(isb_route)) {
+            continue;
+        }
+
         struct in6_addr prefix, nexthop;
         unsigned int plen;
-
         if (!parse_route(isb_route->ip_prefix, isb_route->nexthop,
                          &prefix, &plen, &nexthop)) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
@@ -1710,16 +1817,109 @@ delete_orphan_ic_routes(struct ic_context *ctx,
 }
 
 static void
-route_run(struct ic_context *ctx,
-          const struct icsbrec_availability_zone *az)
+ic_routers_init(struct ic_routers *routers)
 {
-    if (!ctx->ovnisb_txn || !ctx->ovnnb_txn) {
-        return;
+    hmap_init(&routers->ic_lrs);
+    hmap_init(&routers->items);
+    shash_init(&routers->ts_lrs);
+    uuidset_init(&routers->missing_lrs);
+}
+
+static void
+ic_router_items_clear(struct ic_routers *routers,
+                      struct ic_router_info *ic_lr)
+{
+    for (size_t i = 0; i < ic_lr->n_items; i++) {
+        hmap_remove(&routers->items, &ic_lr->items[i]->node);
+        free(ic_lr->items[i]);
+    }
+    ic_lr->n_items = 0;
+}
+
+static void
+ic_router_item_add(struct ic_routers *routers, struct ic_router_info *ic_lr,
+                   const struct uuid *uuid)
+{
+    if (ic_lr->n_items == ic_lr->n_allocated_items) {
+        ic_lr->items = x2nrealloc(ic_lr->items, &ic_lr->n_allocated_items,
+                                  sizeof *ic_lr->items);
+    }
+
+    struct ic_router_item *item = xmalloc(sizeof *item);
+    item->uuid = *uuid;
+    item->ic_lr = ic_lr;
+    hmap_insert(&routers->items, &item->node, uuid_hash(uuid));
+    ic_lr->items[ic_lr->n_items++] = item;
+}
+
+/* Refreshes the static routes and ports of 'ic_lr' in 'routers'. */
+static void
+ic_router_items_build(struct ic_routers *routers,
+                      struct ic_router_info *ic_lr)
+{
+    const struct nbrec_logical_router *lr = ic_lr->lr;
+
+    ic_router_items_clear(routers, ic_lr);
+    for (size_t i = 0; i < lr->n_static_routes; i++) {
+        ic_router_item_add(routers, ic_lr,
+                           &lr->static_routes[i]->header_.uuid);
+    }
+    for (size_t i = 0; i < lr->n_ports; i++) {
+        ic_router_item_add(routers, ic_lr, &lr->ports[i]->header_.uuid);
+    }
+}
+
+/* Returns the router that the NB static route or router port with 'uuid'
+ * belongs to, if it is an interconnected one. */
+static struct ic_router_info *
+ic_router_item_find(const struct ic_routers *routers, const struct uuid *uuid)
+{
+    struct ic_router_item *item;
+    HMAP_FOR_EACH_WITH_HASH (item, node, uuid_hash(uuid), &routers->items) {
+        if (uuid_equals(&item->uuid, uuid)) {
+            return item->ic_lr;
+        }
+    }
+    return NULL;
+}
+
+static void
+ic_routers_clear(struct ic_routers *routers)
+{
+    struct ic_router_info *ic_lr;
+    HMAP_FOR_EACH_POP (ic_lr, node, &routers->ic_lrs) {
+        ic_router_items_clear(routers, ic_lr);
+        free(ic_lr->items);
+        free(ic_lr->isb_pbs);
+        hmap_destroy(&ic_lr->routes_learned);
+        free(ic_lr);
+    }
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &routers->ts_lrs) {
+        hmapx_destroy(node->data);
     }
+    shash_clear_free_data(&routers->ts_lrs);
+    uuidset_clear(&routers->missing_lrs);
+}
 
-    delete_orphan_ic_routes(ctx, az);
+static void
+ic_routers_destroy(struct ic_routers *routers)
+{
+    ic_routers_clear(routers);
+    hmap_destroy(&routers->ic_lrs);
+    hmap_destroy(&routers->items);
+    shash_destroy(&routers->ts_lrs);
+    uuidset_destroy(&routers->missing_lrs);
+}
 
-    struct hmap ic_lrs = HMAP_INITIALIZER(&ic_lrs);
+/* Builds 'routers' from the IC-SB port bindings of 'az', which must be
+ * empty. */
+static void
+ic_routers_build(struct ic_context *ctx,
+                 const struct icsbrec_availability_zone *az,
+                 struct ic_routers *routers)
+{
     const struct icsbrec_port_binding *isb_pb;
     const struct icsbrec_port_binding *isb_pb_key =
         icsbrec_port_binding_index_init_row(ctx->icsbrec_port_binding_by_az);
@@ -1735,6 +1935,9 @@ route_run(struct ic_context *ctx,
         const char *ts_lrp_name =
             get_lrp_name_by_ts_port_name(ctx, isb_pb->logical_port);
         if (!ts_lrp_name) {
+            if (!ic_shard_owns_ts(isb_pb->transit_switch)) {
+                continue;
+            }
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
             VLOG_WARN_RL(&rl, "Route sync ignores port %s on ts %s because "
                          "logical router port is not found in NB. Deleting it",
@@ -1749,19 +1952,25 @@ route_run(struct ic_context *ctx,
                      "external_ids:router-id set.", isb_pb->logical_port);
             continue;
         }
+        if (!ic_shard_owns_lr(&lr_uuid)) {
+            continue;
+        }
 
         const struct nbrec_logical_router *lr
             = nbrec_logical_router_get_for_uuid(ctx->ovnnb_idl, &lr_uuid);
         if (!lr) {
+            uuidset_insert(&routers->missing_lrs, &lr_uuid);
             continue;
         }
 
-        struct ic_router_info *ic_lr = ic_router_find(&ic_lrs, lr);
+        struct ic_router_info *ic_lr = ic_router_find(&routers->ic_lrs, lr);
         if (!ic_lr) {
             ic_lr = xzalloc(sizeof *ic_lr);
             ic_lr->lr = lr;
             hmap_init(&ic_lr->routes_learned);
-            hmap_insert(&ic_lrs, &ic_lr->node, uuid_hash(&lr->header_.uuid));
+            hmap_insert(&routers->ic_lrs, &ic_lr->node,
+                        uuid_hash(&lr->header_.uuid));
+            ic_router_items_build(routers, ic_lr);
         }
 
         if (ic_lr->n_isb_pbs == ic_lr->n_allocated_isb_pbs) {
@@ -1770,26 +1979,75 @@ route_run(struct ic_context *ctx,
                                         sizeof *ic_lr->isb_pbs);
         }
         ic_lr->isb_pbs[ic_lr->n_isb_pbs++] = isb_pb;
+
+        struct hmapx *ts_lrs = shash_find_data(&routers->ts_lrs,
+                                               isb_pb->transit_switch);
+        if (!ts_lrs) {
+            ts_lrs = xmalloc(sizeof *ts_lrs);
+            hmapx_init(ts_lrs);
+            shash_add(&routers->ts_lrs, isb_pb->transit_switch, ts_lrs);
+        }
+        hmapx_add(ts_lrs, ic_lr);
     }
     icsbrec_port_binding_index_destroy_row(isb_pb_key);
+}
+
+/* Syncs the routes learned and advertised by all the routers in 'routers',
+ * as built by ic_routers_build(). */
+static void
+route_run(struct ic_context *ctx,
+          const struct icsbrec_availability_zone *az,
+          struct ic_routers *routers)
+{
+    if (!ctx->ovnisb_txn || !ctx->ovnnb_txn) {
+        return;
+    }
+
+    if (ic_shard_is_primary()) {
+        delete_orphan_ic_routes(ctx, az);
+    }
 
     struct ic_router_info *ic_lr;
     struct shash routes_ad_by_ts = SHASH_INITIALIZER(&routes_ad_by_ts);
-    HMAP_FOR_EACH_SAFE (ic_lr, node, &ic_lrs) {
+    HMAP_FOR_EACH (ic_lr, node, &routers->ic_lrs) {
         collect_lr_routes(ctx, ic_lr, &routes_ad_by_ts);
         sync_learned_routes(ctx, ic_lr);
-        free(ic_lr->isb_pbs);
-        hmap_destroy(&ic_lr->routes_learned);
-        hmap_remove(&ic_lrs, &ic_lr->node);
-        free(ic_lr);
     }
     struct shash_node *node;
     SHASH_FOR_EACH (node, &routes_ad_by_ts) {
-        advertise_routes(ctx, az, node->name, node->data);
+        advertise_routes(ctx, az, node->name, NULL, node->data);
         hmap_destroy(node->data);
     }
     shash_destroy_free_data(&routes_ad_by_ts);
-    hmap_destroy(&ic_lrs);
+}
+
+/* Syncs the routes learned and advertised by the routers in 'ic_lrs', a set
+ * of "struct ic_router_info"s, leaving the ones of the other routers
+ * alone. */
+static void
+route_run_lrs(struct ic_context *ctx,
+              const struct icsbrec_availability_zone *az,
+              const struct hmapx *ic_lrs)
+{
+    if (!ctx->ovnisb_txn || !ctx->ovnnb_txn) {
+        return;
+    }
+
+    struct hmapx_node *hn;
+    HMAPX_FOR_EACH (hn, ic_lrs) {
+        struct ic_router_info *ic_lr = hn->data;
+        struct shash routes_ad_by_ts = SHASH_INITIALIZER(&routes_ad_by_ts);
+
+        collect_lr_routes(ctx, ic_lr, &routes_ad_by_ts);
+        sync_learned_routes(ctx, ic_lr);
+
+        struct shash_node *node;
+        SHASH_FOR_EACH (node, &routes_ad_by_ts) {
+            advertise_routes(ctx, az, node->name, ic_lr->lr, node->data);
+            hmap_destroy(node->data);
+        }
+        shash_destroy_free_data(&routes_ad_by_ts);
+    }
 }
 
 /*
@@ -1877,14 +2135,657 @@ update_sequence_numbers(const struct icsbrec_availability_zone *az,
     }
 }
 
+/* Incremental processing engine.
+ *
+ * Each sync domain (availability zone, transit switches, gateways, port
+ * bindings and routes) is an engine node that depends on the tables it
+ * reads.  A domain is only run again when one of its inputs changed, and
+ * the change handlers below filter out the changes that can't affect it,
+ * e.g., the ones to regular logical switches, ports and chassis. */
+
+#define IC_NB_NODES \
+    NB_NODE(nb_global, "nb_global") \
+    NB_NODE(logical_switch, "logical_switch") \
+    NB_NODE(logical_switch_port, "logical_switch_port") \
+    NB_NODE(logical_router, "logical_router") \
+    NB_NODE(logical_router_port, "logical_router_port") \
+    NB_NODE(logical_router_static_route, "logical_router_static_route")
+
+#define IC_SB_NODES \
+    SB_NODE(chassis, "chassis") \
+    SB_NODE(encap, "encap") \
+    SB_NODE(datapath_binding, "datapath_binding") \
+    SB_NODE(port_binding, "port_binding")
+
+#define IC_ICNB_NODES \
+    ICNB_NODE(transit_switch, "transit_switch")
+
+#define IC_ICSB_NODES \
+    ICSB_NODE(availability_zone, "availability_zone") \
+    ICSB_NODE(datapath_binding, "datapath_binding") \
+    ICSB_NODE(gateway, "gateway") \
+    ICSB_NODE(encap, "encap") \
+    ICSB_NODE(port_binding, "port_binding") \
+    ICSB_NODE(route, "route")
+
+/* Define engine node functions for nodes that represent DB tables
+ *
+ * en_<DB_NAME>_<TABLE_NAME>_run()
+ * en_<DB_NAME>_<TABLE_NAME>_init()
+ * en_<DB_NAME>_<TABLE_NAME>_cleanup()
+ */
+#define NB_NODE(NAME, NAME_STR) ENGINE_FUNC_NB(NAME);
+#define SB_NODE(NAME, NAME_STR) ENGINE_FUNC_SB(NAME);
+#define ICNB_NODE(NAME, NAME_STR) ENGINE_FUNC_ICNB(NAME);
+#define ICSB_NODE(NAME, NAME_STR) ENGINE_FUNC_ICSB(NAME);
+    IC_NB_NODES
+    IC_SB_NODES
+    IC_ICNB_NODES
+    IC_ICSB_NODES
+#undef NB_NODE
+#undef SB_NODE
+#undef ICNB_NODE
+#undef ICSB_NODE
+
+/* Define engine nodes for DB tables.  Define nodes as static to avoid sparse
+ * errors. */
+#define NB_NODE(NAME, NAME_STR) static ENGINE_NODE_NB(NAME, NAME_STR);
+#define SB_NODE(NAME, NAME_STR) static ENGINE_NODE_SB(NAME, NAME_STR);
+#define ICNB_NODE(NAME, NAME_STR) static ENGINE_NODE_ICNB(NAME, NAME_STR);
+#define ICSB_NODE(NAME, NAME_STR) static ENGINE_NODE_ICSB(NAME, NAME_STR);
+    IC_NB_NODES
+    IC_SB_NODES
+    IC_ICNB_NODES
+    IC_ICSB_NODES
+#undef NB_NODE
+#undef SB_NODE
+#undef ICNB_NODE
+#undef ICSB_NODE
+
+static struct ic_context *
+ic_engine_get_context(void)
+{
+    return engine_get_context()->client_ctx;
+}
+
+/* Engine node "az": the availability zone of this ovn-ic instance in the IC
+ * SB database. */
+struct ed_type_az {
+    const struct icsbrec_availability_zone *az;
+};
+
+static void *
+en_az_init(struct engine_node *node OVS_UNUSED,
+           struct engine_arg *arg OVS_UNUSED)
+{
+    return xzalloc(sizeof(struct ed_type_az));
+}
+
+static void
+en_az_cleanup(void *data OVS_UNUSED)
+{
+}
+
+static void
+en_az_run(struct engine_node *node, void *data_)
+{
+    struct ed_type_az *data = data_;
+    const struct icsbrec_availability_zone *az =
+        az_run(ic_engine_get_context());
+
+    VLOG_DBG("Availability zone: %s", az ? az->name : "not created yet.");
+
+    /* The domains only need to run again if the AZ record itself changed,
+     * not on every update of, e.g., its nb_ic_cfg. */
+    engine_set_node_state(node, az != data->az ? EN_UPDATED : EN_UNCHANGED);
+    data->az = az;
+}
+
+static const struct icsbrec_availability_zone *
+en_az_get_input(struct engine_node *node)
+{
+    const struct ed_type_az *data = engine_get_input_data("az", node);
+    return data->az;
+}
+
+/* The sync domain nodes don't have any data of their own: their output is
+ * the transactions on the databases. */
+#define IC_DOMAIN_NODE_FUNCS(NAME) \
+static void * \
+en_##NAME##_init(struct engine_node *node OVS_UNUSED, \
+                 struct engine_arg *arg OVS_UNUSED) \
+{ \
+    return NULL; \
+} \
+static void \
+en_##NAME##_cleanup(void *data OVS_UNUSED) \
+{ \
+}
+
+IC_DOMAIN_NODE_FUNCS(ts)
+IC_DOMAIN_NODE_FUNCS(gateway)
+IC_DOMAIN_NODE_FUNCS(port_binding)
+IC_DOMAIN_NODE_FUNCS(route)
+IC_DOMAIN_NODE_FUNCS(ic)
+
+static void
+en_ts_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    if (!en_az_get_input(node)) {
+        engine_set_node_state(node, EN_UNCHANGED);
+        return;
+    }
+    ts_run(ic_engine_get_context());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+static void
+en_gateway_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct icsbrec_availability_zone *az = en_az_get_input(node);
+    if (!az) {
+        engine_set_node_state(node, EN_UNCHANGED);
+        return;
+    }
+    gateway_run(ic_engine_get_context(), az);
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+static void
+en_port_binding_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct icsbrec_availability_zone *az = en_az_get_input(node);
+    if (!az) {
+        engine_set_node_state(node, EN_UNCHANGED);
+        return;
+    }
+    stopwatch_start(IC_PORT_BINDING_RUN_STOPWATCH_NAME, time_msec());
+    port_binding_run(ic_engine_get_context(), az);
+    stopwatch_stop(IC_PORT_BINDING_RUN_STOPWATCH_NAME, time_msec());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+/* Engine node "ic_routers": the interconnected routers of the AZ, and which
+ * of them are affected by the tracked changes. */
+struct ed_type_ic_routers {
+    const struct icsbrec_availability_zone *az;
+    struct ic_routers routers;
+
+    /* Tracked data. */
+    bool recomputed;            /* All the routers were rebuilt. */
+    struct hmapx dirty_lrs;     /* Changed "struct ic_router_info"s. */
+};
+
+static void *
+en_ic_routers_init(struct engine_node *node OVS_UNUSED,
+                   struct engine_arg *arg OVS_UNUSED)
+{
+    struct ed_type_ic_routers *data = xzalloc(sizeof *data);
+
+    ic_routers_init(&data->routers);
+    hmapx_init(&data->dirty_lrs);
+    return data;
+}
+
+static void
+en_ic_routers_cleanup(void *data_)
+{
+    struct ed_type_ic_routers *data = data_;
+
+    ic_routers_destroy(&data->routers);
+    hmapx_destroy(&data->dirty_lrs);
+}
+
+static void
+en_ic_routers_clear_tracked_data(void *data_)
+{
+    struct ed_type_ic_routers *data = data_;
+
+    data->recomputed = false;
+    hmapx_clear(&data->dirty_lrs);
+}
+
+static void
+en_ic_routers_run(struct engine_node *node, void *data_)
+{
+    struct ed_type_ic_routers *data = data_;
+
+    hmapx_clear(&data->dirty_lrs);
+    ic_routers_clear(&data->routers);
+    data->az = en_az_get_input(node);
+    if (data->az) {
+        ic_routers_build(ic_engine_get_context(), data->az, &data->routers);
+    }
+    data->recomputed = true;
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+/* Marks the routes of 'ic_lr' to be synced again, and refreshes the static
+ * routes and ports that lead to it. */
 static void
-ovn_db_run(struct ic_context *ctx,
-           const struct icsbrec_availability_zone *az)
+ic_routers_mark_dirty(struct ed_type_ic_routers *data,
+                      struct ic_router_info *ic_lr)
 {
-    ts_run(ctx);
-    gateway_run(ctx, az);
-    port_binding_run(ctx, az);
-    route_run(ctx, az);
+    if (hmapx_add(&data->dirty_lrs, ic_lr)) {
+        ic_router_items_build(&data->routers, ic_lr);
+    }
+}
+
+static void
+ic_routers_set_state(struct engine_node *node,
+                     const struct ed_type_ic_routers *data)
+{
+    if (!hmapx_is_empty(&data->dirty_lrs)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+}
+
+static bool
+ic_routers_nb_logical_router_handler(struct engine_node *node, void *data_)
+{
+    const struct nbrec_logical_router_table *table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_router", node));
+    struct ed_type_ic_routers *data = data_;
+    const struct nbrec_logical_router *lr;
+
+    NBREC_LOGICAL_ROUTER_TABLE_FOR_EACH_TRACKED (lr, table) {
+        if (nbrec_logical_router_is_new(lr)) {
+            /* A router that IC-SB port bindings were already waiting for. */
+            if (uuidset_find(&data->routers.missing_lrs, &lr->header_.uuid)) {
+                return false;
+            }
+            continue;
+        }
+
+        struct ic_router_info *ic_lr = ic_router_find(&data->routers.ic_lrs,
+                                                      lr);
+        if (!ic_lr) {
+            continue;
+        }
+        if (nbrec_logical_router_is_deleted(lr)) {
+            return false;
+        }
+        ic_routers_mark_dirty(data, ic_lr);
+    }
+    ic_routers_set_state(node, data);
+    return true;
+}
+
+static bool
+ic_routers_nb_static_route_handler(struct engine_node *node, void *data_)
+{
+    const struct nbrec_logical_router_static_route_table *table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_router_static_route",
+                                      node));
+    struct ed_type_ic_routers *data = data_;
+    const struct nbrec_logical_router_static_route *route;
+
+    /* New and deleted routes also update the router that references them,
+     * so only the changes to existing routes have to be looked up. */
+    NBREC_LOGICAL_ROUTER_STATIC_ROUTE_TABLE_FOR_EACH_TRACKED (route, table) {
+        struct ic_router_info *ic_lr =
+            ic_router_item_find(&data->routers, &route->header_.uuid);
+        if (ic_lr) {
+            ic_routers_mark_dirty(data, ic_lr);
+        }
+    }
+    ic_routers_set_state(node, data);
+    return true;
+}
+
+static bool
+ic_routers_nb_logical_router_port_handler(struct engine_node *node,
+                                          void *data_)
+{
+    const struct nbrec_logical_router_port_table *table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_router_port", node));
+    struct ed_type_ic_routers *data = data_;
+    const struct nbrec_logical_router_port *lrp;
+
+    NBREC_LOGICAL_ROUTER_PORT_TABLE_FOR_EACH_TRACKED (lrp, table) {
+        struct ic_router_info *ic_lr =
+            ic_router_item_find(&data->routers, &lrp->header_.uuid);
+        if (ic_lr) {
+            ic_routers_mark_dirty(data, ic_lr);
+        }
+    }
+    ic_routers_set_state(node, data);
+    return true;
+}
+
+/* A route advertised on a transit switch may have to be learned by any of
+ * the routers of the AZ on that switch, and the routes they advertised
+ * themselves may have been changed by someone else. */
+static bool
+ic_routers_icsb_route_handler(struct engine_node *node, void *data_)
+{
+    const struct icsbrec_route_table *table =
+        EN_OVSDB_GET(engine_get_input("ICSB_route", node));
+    struct ed_type_ic_routers *data = data_;
+    const struct icsbrec_route *isb_route;
+
+    ICSBREC_ROUTE_TABLE_FOR_EACH_TRACKED (isb_route, table) {
+        if (icsbrec_route_is_updated(isb_route,
+                                     ICSBREC_ROUTE_COL_TRANSIT_SWITCH)) {
+            return false;
+        }
+
+        const struct hmapx *ts_lrs =
+            shash_find_data(&data->routers.ts_lrs, isb_route->transit_switch);
+        if (!ts_lrs) {
+            continue;
+        }
+
+        struct hmapx_node *hn;
+        HMAPX_FOR_EACH (hn, ts_lrs) {
+            ic_routers_mark_dirty(data, hn->data);
+        }
+    }
+    ic_routers_set_state(node, data);
+    return true;
+}
+
+static void
+en_route_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct ed_type_ic_routers *ic_routers =
+        engine_get_input_data("ic_routers", node);
+    if (!ic_routers->az) {
+        engine_set_node_state(node, EN_UNCHANGED);
+        return;
+    }
+    stopwatch_start(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    route_run(ic_engine_get_context(), ic_routers->az, &ic_routers->routers);
+    stopwatch_stop(IC_ROUTE_RUN_STOPWATCH_NAME, time_msec());
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+static bool
+route_ic_routers_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct ed_type_ic_routers *ic_routers =
+        engine_get_input_data("ic_routers", node);
+
+    if (ic_routers->recomputed) {
+        return false;
+    }
+    if (ic_routers->az && !hmapx_is_empty(&ic_routers->dirty_lrs)) {
+        route_run_lrs(ic_engine_get_context(), ic_routers->az,
+                      &ic_routers->dirty_lrs);
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    return true;
+}
+
+/* Engine node "ic": the output node, which only exists to have a single
+ * root for the domains and to run them in the order they are added as its
+ * inputs. */
+static void
+en_ic_run(struct engine_node *node, void *data OVS_UNUSED)
+{
+    engine_set_node_state(node, EN_UPDATED);
+}
+
+static bool
+ic_domain_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    engine_set_node_state(node, EN_UPDATED);
+    return true;
+}
+
+/* Only the logical switches that are, or were before the change, the NB
+ * counterpart of a transit switch matter to ovn-ic. */
+static bool
+ic_nb_logical_switch_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct nbrec_logical_switch_table *table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_switch", node));
+    const struct nbrec_logical_switch *ls;
+
+    /* Deleted rows keep their last contents, so checking the current
+     * other_config covers deletions as well. */
+    NBREC_LOGICAL_SWITCH_TABLE_FOR_EACH_TRACKED (ls, table) {
+        if (smap_get(&ls->other_config, "interconn-ts") ||
+            nbrec_logical_switch_is_updated(
+                ls, NBREC_LOGICAL_SWITCH_COL_OTHER_CONFIG)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Only the ports that connect a router to a transit switch, and the remote
+ * ports created by ovn-ic, matter. */
+static bool
+ic_nb_logical_switch_port_handler(struct engine_node *node,
+                                  void *data OVS_UNUSED)
+{
+    const struct nbrec_logical_switch_port_table *table =
+        EN_OVSDB_GET(engine_get_input("NB_logical_switch_port", node));
+    const struct nbrec_logical_switch_port *lsp;
+
+    NBREC_LOGICAL_SWITCH_PORT_TABLE_FOR_EACH_TRACKED (lsp, table) {
+        if (!strcmp(lsp->type, "router") || !strcmp(lsp->type, "remote") ||
+            nbrec_logical_switch_port_is_updated(
+                lsp, NBREC_LOGICAL_SWITCH_PORT_COL_TYPE)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns true if 'chassis' is, or was before the change, either a local
+ * interconnection gateway or a remote one created by ovn-ic. */
+static bool
+ic_chassis_is_gateway(const struct sbrec_chassis *chassis)
+{
+    return smap_get_bool(&chassis->other_config, "is-interconn", false) ||
+           smap_get_bool(&chassis->other_config, "is-remote", false) ||
+           sbrec_chassis_is_updated(chassis, SBREC_CHASSIS_COL_OTHER_CONFIG);
+}
+
+static bool
+ic_sb_chassis_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct sbrec_chassis_table *table =
+        EN_OVSDB_GET(engine_get_input("SB_chassis", node));
+    const struct sbrec_chassis *chassis;
+
+    SBREC_CHASSIS_TABLE_FOR_EACH_TRACKED (chassis, table) {
+        if (ic_chassis_is_gateway(chassis)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+ic_sb_encap_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct sbrec_encap_table *table =
+        EN_OVSDB_GET(engine_get_input("SB_encap", node));
+    struct ic_context *ctx = ic_engine_get_context();
+    const struct sbrec_encap *encap;
+
+    SBREC_ENCAP_TABLE_FOR_EACH_TRACKED (encap, table) {
+        const struct sbrec_chassis *chassis =
+            find_sb_chassis(ctx, encap->chassis_name);
+        if (!chassis || ic_chassis_is_gateway(chassis)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Regular VIFs and the other port types that can't be part of a transit
+ * switch don't matter. */
+static bool
+ic_sb_port_binding_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    const struct sbrec_port_binding_table *table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+    const struct sbrec_port_binding *pb;
+
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, table) {
+        if (!strcmp(pb->type, "patch") || !strcmp(pb->type, "l3gateway") ||
+            !strcmp(pb->type, "chassisredirect") ||
+            !strcmp(pb->type, "remote") ||
+            sbrec_port_binding_is_updated(pb, SBREC_PORT_BINDING_COL_TYPE)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Only the datapaths of logical routers matter, to find the router behind a
+ * transit switch port. */
+static bool
+ic_sb_datapath_binding_handler(struct engine_node *node,
+                               void *data OVS_UNUSED)
+{
+    const struct sbrec_datapath_binding_table *table =
+        EN_OVSDB_GET(engine_get_input("SB_datapath_binding", node));
+    const struct sbrec_datapath_binding *dp;
+
+    SBREC_DATAPATH_BINDING_TABLE_FOR_EACH_TRACKED (dp, table) {
+        if (smap_get(&dp->external_ids, "logical-router") ||
+            sbrec_datapath_binding_is_updated(
+                dp, SBREC_DATAPATH_BINDING_COL_EXTERNAL_IDS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static ENGINE_NODE(az, "az");
+static ENGINE_NODE(ts, "ts");
+static ENGINE_NODE(gateway, "gateway");
+static ENGINE_NODE(port_binding, "port_binding");
+static ENGINE_NODE_WITH_CLEAR_TRACK_DATA(ic_routers, "ic_routers");
+static ENGINE_NODE(route, "route");
+static ENGINE_NODE(ic, "ic");
+
+static void
+ic_engine_init(struct ovsdb_idl *nb_idl, struct ovsdb_idl *sb_idl,
+               struct ovsdb_idl *icnb_idl, struct ovsdb_idl *icsb_idl)
+{
+    /* Define relationships between nodes where first argument is dependent
+     * on the second argument */
+    engine_add_input(&en_az, &en_nb_nb_global, NULL);
+    engine_add_input(&en_az, &en_icsb_availability_zone, NULL);
+
+    engine_add_input(&en_ts, &en_az, NULL);
+    engine_add_input(&en_ts, &en_icnb_transit_switch, NULL);
+    engine_add_input(&en_ts, &en_icsb_datapath_binding, NULL);
+    engine_add_input(&en_ts, &en_nb_logical_switch,
+                     ic_nb_logical_switch_handler);
+
+    engine_add_input(&en_gateway, &en_az, NULL);
+    engine_add_input(&en_gateway, &en_icsb_gateway, NULL);
+    engine_add_input(&en_gateway, &en_icsb_encap, NULL);
+    engine_add_input(&en_gateway, &en_sb_chassis, ic_sb_chassis_handler);
+    engine_add_input(&en_gateway, &en_sb_encap, ic_sb_encap_handler);
+
+    engine_add_input(&en_port_binding, &en_az, NULL);
+    engine_add_input(&en_port_binding, &en_icnb_transit_switch, NULL);
+    engine_add_input(&en_port_binding, &en_icsb_port_binding, NULL);
+    engine_add_input(&en_port_binding, &en_nb_logical_switch,
+                     ic_nb_logical_switch_handler);
+    engine_add_input(&en_port_binding, &en_nb_logical_switch_port,
+                     ic_nb_logical_switch_port_handler);
+    engine_add_input(&en_port_binding, &en_sb_chassis,
+                     ic_sb_chassis_handler);
+    engine_add_input(&en_port_binding, &en_sb_datapath_binding,
+                     ic_sb_datapath_binding_handler);
+    engine_add_input(&en_port_binding, &en_sb_port_binding,
+                     ic_sb_port_binding_handler);
+
+    /* The routers connected to transit switches only change with the IC-SB
+     * port bindings, the rest of the inputs only decide which of them have
+     * to be synced again. */
+    engine_add_input(&en_ic_routers, &en_az, NULL);
+    engine_add_input(&en_ic_routers, &en_icnb_transit_switch, NULL);
+    engine_add_input(&en_ic_routers, &en_icsb_port_binding, NULL);
+    engine_add_input(&en_ic_routers, &en_nb_nb_global, NULL);
+    engine_add_input(&en_ic_routers, &en_nb_logical_switch_port,
+                     ic_nb_logical_switch_port_handler);
+    engine_add_input(&en_ic_routers, &en_nb_logical_router,
+                     ic_routers_nb_logical_router_handler);
+    engine_add_input(&en_ic_routers, &en_nb_logical_router_port,
+                     ic_routers_nb_logical_router_port_handler);
+    engine_add_input(&en_ic_routers, &en_nb_logical_router_static_route,
+                     ic_routers_nb_static_route_handler);
+    engine_add_input(&en_ic_routers, &en_icsb_route,
+                     ic_routers_icsb_route_handler);
+
+    engine_add_input(&en_route, &en_ic_routers, route_ic_routers_handler);
+
+    /* The domains run in this order, which is the one of the original full
+     * sync: e.g., the ports of a transit switch are synced after the switch
+     * itself. */
+    engine_add_input(&en_ic, &en_ts, ic_domain_handler);
+    engine_add_input(&en_ic, &en_gateway, ic_domain_handler);
+    engine_add_input(&en_ic, &en_port_binding, ic_domain_handler);
+    engine_add_input(&en_ic, &en_route, ic_domain_handler);
+
+    struct engine_arg engine_arg = {
+        .nb_idl = nb_idl,
+        .sb_idl = sb_idl,
+        .icnb_idl = icnb_idl,
+        .icsb_idl = icsb_idl,
+    };
+    engine_init(&en_ic, &engine_arg);
+}
+
+/* Runs the engine on the changes tracked by the IDLs since the last run.
+ * Returns true if all of them were processed, false if the next run has to
+ * recompute everything. */
+static bool
+ic_engine_run(struct ic_context *ctx, bool recompute)
+{
+    engine_init_run();
+
+    /* Force a full recompute if instructed to, for example, after a
+     * reconnect.  However, make sure we don't overwrite an existing
+     * force-recompute request if 'recompute' is false. */
+    if (recompute) {
+        engine_set_force_recompute(true);
+    }
+
+    struct engine_context eng_ctx = {
+        .ovnnb_idl_txn = ctx->ovnnb_txn,
+        .ovnsb_idl_txn = ctx->ovnsb_txn,
+        .client_ctx = ctx,
+    };
+    engine_set_context(&eng_ctx);
+    engine_run(true);
+
+    if (!engine_has_run()) {
+        if (engine_need_run()) {
+            VLOG_DBG("engine did not run, force recompute next time.");
+            engine_set_force_recompute(true);
+            poll_immediate_wake();
+            return false;
+        }
+        VLOG_DBG("engine did not run, and it was not needed");
+    } else if (engine_canceled()) {
+        VLOG_DBG("engine was canceled, force recompute next time.");
+        engine_set_force_recompute(true);
+        poll_immediate_wake();
+        return false;
+    } else {
+        engine_set_force_recompute(false);
+    }
+    return true;
+}
+
+/* Returns the availability zone of this instance, as found by the last
+ * engine run, or NULL if there isn't one yet. */
+static const struct icsbrec_availability_zone *
+ic_engine_get_az(void)
+{
+    const struct ed_type_az *data = engine_get_data(&en_az);
+    return data ? data->az : NULL;
 }
 
 static void
@@ -1894,6 +2795,8 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
         OVN_DAEMON_OPTION_ENUMS,
         VLOG_OPTION_ENUMS,
         SSL_OPTION_ENUMS,
+        OPT_N_SHARDS,
+        OPT_SHARD,
     };
     static const struct option long_options[] = {
         {"ovnsb-db", required_argument, NULL, 'd'},
@@ -1901,6 +2804,8 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
         {"ic-sb-db", required_argument, NULL, 'i'},
         {"ic-nb-db", required_argument, NULL, 'I'},
         {"unixctl", required_argument, NULL, 'u'},
+        {"n-shards", required_argument, NULL, OPT_N_SHARDS},
+        {"shard", required_argument, NULL, OPT_SHARD},
         {"help", no_argument, NULL, 'h'},
         {"options", no_argument, NULL, 'o'},
         {"version", no_argument, NULL, 'V'},
@@ -1963,6 +2868,20 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
             unixctl_path = optarg;
             break;
 
+        case OPT_N_SHARDS:
+            if (!str_to_uint(optarg, 10, &n_shards) || !n_shards) {
+                ovs_fatal(0, "--n-shards: \"%s\" is not a positive integer",
+                          optarg);
+            }
+            break;
+
+        case OPT_SHARD:
+            if (!str_to_uint(optarg, 10, &shard_id)) {
+                ovs_fatal(0, "--shard: \"%s\" is not a valid shard id",
+                          optarg);
+            }
+            break;
+
         case 'h':
             usage();
             exit(EXIT_SUCCESS);
@@ -1980,6 +2899,10 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED)
         }
     }
 
+    if (shard_id >= n_shards) {
+        ovs_fatal(0, "--shard must be less than --n-shards (%u)", n_shards);
+    }
+
     if (!ovnsb_db) {
         ovnsb_db = default_sb_db();
     }
@@ -2019,6 +2942,19 @@ update_ssl_config(void)
     }
 }
 
+/* Returns true if 'idl' reconnected to its database since the last call,
+ * which is tracked through '*cond_seqno'. */
+static bool
+ic_idl_reconnected(struct ovsdb_idl *idl, unsigned int *cond_seqno)
+{
+    unsigned int new_cond_seqno = ovsdb_idl_get_condition_seqno(idl);
+    if (new_cond_seqno == *cond_seqno) {
+        return false;
+    }
+    *cond_seqno = new_cond_seqno;
+    return !new_cond_seqno;
+}
+
 static void
 update_idl_probe_interval(struct ovsdb_idl *ovn_sb_idl,
                           struct ovsdb_idl *ovn_nb_idl,
@@ -2044,6 +2980,128 @@ update_idl_probe_interval(struct ovsdb_idl *ovn_sb_idl,
     set_idl_probe_interval(ovn_icnb_idl, ovn_ic_nb_db, ic_interval);
 }
 
+/* Sets the monitor conditions of the IC-SB tables whose size grows with the
+ * number of availability zones.  Unless NB_Global options:ic-monitor-all is
+ * true, the default, only the rows that matter to this AZ are monitored:
+ *
+ *    - The port bindings and routes of this AZ, and the ones of the transit
+ *      switches that this AZ is connected to, i.e. that have either a port
+ *      of this AZ in the IC-SB or a router port in the AZ's NB, about to be
+ *      bound.
+ *
+ *    - The gateways of this AZ, and the ones of the AZs with ports on these
+ *      transit switches.
+ *
+ * The conditions widen as ports are added, see ic_isb_monitors_acked().
+ * Returns the condition sequence number to wait for. */
+static unsigned int
+update_isb_monitors(struct ovsdb_idl *ovnnb_idl, struct ovsdb_idl *ovnisb_idl)
+{
+    struct ovsdb_idl_condition pb = OVSDB_IDL_CONDITION_INIT(&pb);
+    struct ovsdb_idl_condition route = OVSDB_IDL_CONDITION_INIT(&route);
+    struct ovsdb_idl_condition gw = OVSDB_IDL_CONDITION_INIT(&gw);
+    const struct nbrec_nb_global *nb = nbrec_nb_global_first(ovnnb_idl);
+
+    if (!nb || smap_get_bool(&nb->options, "ic-monitor-all", true)) {
+        ovsdb_idl_condition_add_clause_true(&pb);
+        ovsdb_idl_condition_add_clause_true(&route);
+        ovsdb_idl_condition_add_clause_true(&gw);
+        goto out;
+    }
+
+    const struct icsbrec_availability_zone *az = NULL, *iter;
+    ICSBREC_AVAILABILITY_ZONE_FOR_EACH (iter, ovnisb_idl) {
+        if (nb->name[0] && !strcmp(iter->name, nb->name)) {
+            az = iter;
+            break;
+        }
+    }
+
+    struct sset tses = SSET_INITIALIZER(&tses);
+    const struct nbrec_logical_switch *ls;
+    NBREC_LOGICAL_SWITCH_FOR_EACH (ls, ovnnb_idl) {
+        const char *ts_name = smap_get(&ls->other_config, "interconn-ts");
+        if (!ts_name) {
+            continue;
+        }
+        for (size_t i = 0; i < ls->n_ports; i++) {
+            if (!strcmp(ls->ports[i]->type, "router")) {
+                sset_add(&tses, ts_name);
+                break;
+            }
+        }
+    }
+
+    const struct icsbrec_port_binding *isb_pb;
+    if (az) {
+        const struct uuid *az_uuid = &az->header_.uuid;
+
+        icsbrec_port_binding_add_clause_availability_zone(&pb, OVSDB_F_EQ,
+                                                          az_uuid);
+        icsbrec_route_add_clause_availability_zone(&route, OVSDB_F_EQ,
+                                                   az_uuid);
+        icsbrec_gateway_add_clause_availability_zone(&gw, OVSDB_F_EQ,
+                                                     az_uuid);
+        ICSBREC_PORT_BINDING_FOR_EACH (isb_pb, ovnisb_idl) {
+            if (isb_pb->availability_zone == az) {
+                sset_add(&tses, isb_pb->transit_switch);
+            }
+        }
+    }
+
+    const char *ts_name;
+    SSET_FOR_EACH (ts_name, &tses) {
+        icsbrec_port_binding_add_clause_transit_switch(&pb, OVSDB_F_EQ,
+                                                       ts_name);
+        icsbrec_route_add_clause_transit_switch(&route, OVSDB_F_EQ, ts_name);
+    }
+
+    struct uuidset remote_azs = UUIDSET_INITIALIZER(&remote_azs);
+    ICSBREC_PORT_BINDING_FOR_EACH (isb_pb, ovnisb_idl) {
+        if (isb_pb->availability_zone && isb_pb->availability_zone != az
+            && sset_contains(&tses, isb_pb->transit_switch)) {
+            uuidset_insert(&remote_azs,
+                           &isb_pb->availability_zone->header_.uuid);
+        }
+    }
+    const struct uuidset_node *node;
+    UUIDSET_FOR_EACH (node, &remote_azs) {
+        icsbrec_gateway_add_clause_availability_zone(&gw, OVSDB_F_EQ,
+                                                     &node->uuid);
+    }
+    uuidset_destroy(&remote_azs);
+    sset_destroy(&tses);
+
+out:;
+    unsigned int cond_seqnos[] = {
+        icsbrec_port_binding_set_condition(ovnisb_idl, &pb),
+        icsbrec_route_set_condition(ovnisb_idl, &route),
+        icsbrec_gateway_set_condition(ovnisb_idl, &gw),
+    };
+
+    unsigned int expected_cond_seqno = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(cond_seqnos); i++) {
+        expected_cond_seqno = MAX(expected_cond_seqno, cond_seqnos[i]);
+    }
+
+    ovsdb_idl_condition_destroy(&pb);
+    ovsdb_idl_condition_destroy(&route);
+    ovsdb_idl_condition_destroy(&gw);
+    return expected_cond_seqno;
+}
+
+/* Returns true if the IC-SB server acked the conditions last set by
+ * update_isb_monitors().  Until then, the IC-SB misses the rows of the
+ * transit switches that this AZ just connected to, e.g. the ports of other
+ * AZs, whose tunnel keys must be known before allocating one, so nothing
+ * is synced. */
+static bool
+ic_isb_monitors_acked(struct ovsdb_idl *ovnisb_idl,
+                      unsigned int expected_cond_seqno)
+{
+    return ovsdb_idl_get_condition_seqno(ovnisb_idl) == expected_cond_seqno;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -2191,6 +3249,13 @@ main(int argc, char *argv[])
     ovsdb_idl_add_column(ovnsb_idl_loop.idl,
                          &sbrec_port_binding_col_chassis);
 
+    /* Track the changes to all the monitored columns, they are the inputs
+     * of the incremental processing engine. */
+    ovsdb_idl_track_add_all(ovninb_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnisb_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnnb_idl_loop.idl);
+    ovsdb_idl_track_add_all(ovnsb_idl_loop.idl);
+
     /* Create IDL indexes */
     struct ovsdb_idl_index *nbrec_ls_by_name
         = ovsdb_idl_index_create1(ovnnb_idl_loop.idl,
@@ -2238,6 +3303,12 @@ main(int argc, char *argv[])
                                   &icsbrec_route_col_transit_switch,
                                   &icsbrec_route_col_availability_zone);
 
+    stopwatch_create(IC_PORT_BINDING_RUN_STOPWATCH_NAME, SW_MS);
+    stopwatch_create(IC_ROUTE_RUN_STOPWATCH_NAME, SW_MS);
+
+    ic_engine_init(ovnnb_idl_loop.idl, ovnsb_idl_loop.idl,
+                   ovninb_idl_loop.idl, ovnisb_idl_loop.idl);
+
     unixctl_command_register("nb-connection-status", "", 0, 0,
                              ovn_conn_show, ovnnb_idl_loop.idl);
     unixctl_command_register("sb-connection-status", "", 0, 0,
@@ -2247,10 +3318,30 @@ main(int argc, char *argv[])
     unixctl_command_register("ic-sb-connection-status", "", 0, 0,
                              ovn_conn_show, ovnisb_idl_loop.idl);
 
+    unsigned int ovnnb_cond_seqno = UINT_MAX;
+    unsigned int ovnsb_cond_seqno = UINT_MAX;
+    unsigned int ovninb_cond_seqno = UINT_MAX;
+    unsigned int ovnisb_cond_seqno = UINT_MAX;
+
+    /* The IDL sequence numbers of the databases that the IC-SB monitor
+     * conditions depend on, when these were last set. */
+    unsigned int isb_monitors_nb_seqno = UINT_MAX;
+    unsigned int isb_monitors_isb_seqno = UINT_MAX;
+    unsigned int ovnisb_expected_cond_seqno = 0;
+
+    /* Each shard has its own lock, so that one instance per shard is
+     * active. */
+    char *lock_name = n_shards > 1 ? xasprintf("ovn_ic_shard%u", shard_id)
+                                   : xstrdup("ovn_ic");
+    if (n_shards > 1) {
+        VLOG_INFO("Syncing shard %u of %u.", shard_id, n_shards);
+    }
+
     /* Main loop. */
     exiting = false;
     state.had_lock = false;
     state.paused = false;
+    bool recompute = true;
     while (!exiting) {
         update_ssl_config();
         update_idl_probe_interval(ovnsb_idl_loop.idl, ovnnb_idl_loop.idl,
@@ -2264,15 +3355,16 @@ main(int argc, char *argv[])
             simap_destroy(&usage);
         }
 
+        bool clear_idl_track = true;
         if (!state.paused) {
             if (!ovsdb_idl_has_lock(ovnsb_idl_loop.idl) &&
                 !ovsdb_idl_is_lock_contended(ovnsb_idl_loop.idl))
             {
                 /* Ensure that only a single ovn-ic is active in the deployment
-                 * by acquiring a lock called "ovn_ic" on the southbound
-                 * database and then only performing DB transactions if the
-                 * lock is held. */
-                ovsdb_idl_set_lock(ovnsb_idl_loop.idl, "ovn_ic");
+                 * (per shard) by acquiring a lock called "ovn_ic" (or
+                 * "ovn_ic_shard<N>") on the southbound database and then only
+                 * performing DB transactions if the lock is held. */
+                ovsdb_idl_set_lock(ovnsb_idl_loop.idl, lock_name);
             }
 
             struct ic_context ctx = {
@@ -2299,6 +3391,29 @@ main(int argc, char *argv[])
                 .icsbrec_route_by_ts_az = icsbrec_route_by_ts_az,
             };
 
+            bool reconnected =
+                ic_idl_reconnected(ctx.ovnnb_idl, &ovnnb_cond_seqno);
+            reconnected |= ic_idl_reconnected(ctx.ovnsb_idl,
+                                              &ovnsb_cond_seqno);
+            reconnected |= ic_idl_reconnected(ctx.ovninb_idl,
+                                              &ovninb_cond_seqno);
+            reconnected |= ic_idl_reconnected(ctx.ovnisb_idl,
+                                              &ovnisb_cond_seqno);
+            if (reconnected) {
+                VLOG_INFO("IDL reconnected, force recompute.");
+                recompute = true;
+            }
+
+            unsigned int nb_seqno = ovsdb_idl_get_seqno(ctx.ovnnb_idl);
+            unsigned int isb_seqno = ovsdb_idl_get_seqno(ctx.ovnisb_idl);
+            if (reconnected || nb_seqno != isb_monitors_nb_seqno
+                || isb_seqno != isb_monitors_isb_seqno) {
+                ovnisb_expected_cond_seqno =
+                    update_isb_monitors(ctx.ovnnb_idl, ctx.ovnisb_idl);
+                isb_monitors_nb_seqno = nb_seqno;
+                isb_monitors_isb_seqno = isb_seqno;
+            }
+
             if (!state.had_lock && ovsdb_idl_has_lock(ovnsb_idl_loop.idl)) {
                 VLOG_INFO("ovn-ic lock acquired. "
                         "This ovn-ic instance is now active.");
@@ -2315,13 +3430,29 @@ main(int argc, char *argv[])
                 ovsdb_idl_has_ever_connected(ctx.ovnsb_idl) &&
                 ovsdb_idl_has_ever_connected(ctx.ovninb_idl) &&
                 ovsdb_idl_has_ever_connected(ctx.ovnisb_idl)) {
-                const struct icsbrec_availability_zone *az = az_run(&ctx);
-                VLOG_DBG("Availability zone: %s", az ? az->name :
-                                               "not created yet.");
-                if (az) {
-                    ovn_db_run(&ctx, az);
-                    update_sequence_numbers(az, &ctx, &ovnisb_idl_loop);
+                if (ctx.ovnnb_txn && ctx.ovnsb_txn &&
+                    ctx.ovninb_txn && ctx.ovnisb_txn &&
+                    ic_isb_monitors_acked(ctx.ovnisb_idl,
+                                          ovnisb_expected_cond_seqno)) {
+                    if (ic_engine_run(&ctx, recompute)) {
+                        const struct icsbrec_availability_zone *az =
+                            ic_engine_get_az();
+                        if (az && ic_shard_is_primary()) {
+                            update_sequence_numbers(az, &ctx,
+                                                    &ovnisb_idl_loop);
+                        }
+                    }
+                    recompute = false;
+                } else if (!recompute) {
+                    /* Keep the tracked changes until the transactions in
+                     * flight complete, and the IC-SB monitor conditions are
+                     * acked, and the engine can process them. */
+                    clear_idl_track = false;
                 }
+            } else {
+                /* Whatever changes while this instance is on standby have
+                 * to be processed when it becomes active. */
+                recompute = true;
             }
 
             int rc1 = ovsdb_idl_loop_commit_and_wait(&ovnnb_idl_loop);
@@ -2333,8 +3464,10 @@ main(int argc, char *argv[])
                          !rc1 ? "nb" : "", !rc2 ? "sb" : "",
                          !rc3 ? "ic_nb" : "", rc4 ? "ic_sb" : "");
                 /* A transaction failed. Wake up immediately to give
-                 * opportunity to send the proper transaction
+                 * opportunity to send the proper transaction, and
+                 * recompute as the changes it was made of are lost.
                  */
+                recompute = true;
                 poll_immediate_wake();
             }
         } else {
@@ -2361,6 +3494,16 @@ main(int argc, char *argv[])
             ovsdb_idl_wait(ovnsb_idl_loop.idl);
             ovsdb_idl_wait(ovninb_idl_loop.idl);
             ovsdb_idl_wait(ovnisb_idl_loop.idl);
+
+            /* Force a full recompute next time we become active. */
+            recompute = true;
+        }
+
+        if (clear_idl_track) {
+            ovsdb_idl_track_clear(ovnnb_idl_loop.idl);
+            ovsdb_idl_track_clear(ovnsb_idl_loop.idl);
+            ovsdb_idl_track_clear(ovninb_idl_loop.idl);
+            ovsdb_idl_track_clear(ovnisb_idl_loop.idl);
         }
 
         unixctl_server_run(unixctl);
@@ -2376,6 +3519,8 @@ main(int argc, char *argv[])
         }
     }
 
+    engine_cleanup();
+    free(lock_name);
     unixctl_server_destroy(unixctl);
     ovsdb_idl_loop_destroy(&ovnnb_idl_loop);
     ovsdb_idl_loop_destroy(&ovnsb_idl_loop);
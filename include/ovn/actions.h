@@ -131,6 +131,7 @@ struct collector_set_ids;
     OVNACT(CHK_LB_AFF,        ovnact_result)          \
     OVNACT(SAMPLE,            ovnact_sample)          \
     OVNACT(MAC_CACHE_USE,     ovnact_null)            \
+    OVNACT(LOOKUP_ARP_ND_RSP, ovnact_result)          \
 
 /* enum ovnact_type, with a member OVNACT_<ENUM> for each action. */
 enum OVS_PACKED_ENUM ovnact_type {
@@ -793,6 +794,10 @@ enum action_opcode {
      *   - The 32-bit DHCP server IP.
      */
     ACTION_OPCODE_DHCP_RELAY_RESP_CHK,
+
+    /* Activate the datapath of the packet, whose flows are installed on
+     * demand, and buffer the packet until they are. */
+    ACTION_OPCODE_ACTIVATE_DATAPATH,
 };
 
 /* Header. */
@@ -937,6 +942,35 @@ void ovnacts_encode(const struct ovnact[], size_t ovnacts_len,
                     const struct ovnact_encode_params *,
                     struct ofpbuf *ofpacts);
 
+/* Cache of encoded actions.
+ *
+ * Many logical flows have the same actions, e.g. "next;" or "ct_next;", and
+ * encoding them gives the same ofpacts as long as the encoding parameters
+ * that they depend on are the same.  The cache is keyed by the string that
+ * the actions were parsed from, the logical table that they were parsed for
+ * and these parameters.  Actions whose encoding depends on anything else,
+ * e.g. on port lookups or on the group and meter tables, are never cached.
+ *
+ * This includes the DHCP, DHCPv6, IPv6 RA and controller event options,
+ * whose encoding is the bulk of the pinctrl userdata and is the same for all
+ * the logical flows with the same options.  Their encoding depends on the
+ * option definitions that the actions were parsed with, so the cache must be
+ * cleared whenever these change.
+ *
+ * The cache is not thread-safe. */
+struct ovnacts_encode_cache;
+
+struct ovnacts_encode_cache *ovnacts_encode_cache_create(void);
+void ovnacts_encode_cache_destroy(struct ovnacts_encode_cache *);
+void ovnacts_encode_cache_clear(struct ovnacts_encode_cache *);
+const struct ofpbuf *ovnacts_encode_cached(struct ovnacts_encode_cache *,
+                                           const char *actions_s,
+                                           uint8_t ltable,
+                                           const struct ovnact[],
+                                           size_t ovnacts_len,
+                                           const struct ovnact_encode_params *,
+                                           struct ofpbuf *ofpacts);
+
 void ovnacts_free(struct ovnact[], size_t ovnacts_len);
 char *ovnact_op_to_string(uint32_t);
 int encode_ra_dnssl_opt(char *data, char *buf, int buf_len);
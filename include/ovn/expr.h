@@ -68,6 +68,7 @@ struct ofpbuf;
 struct shash;
 struct simap;
 struct sset;
+struct worker_pool;
 
 /* "Measurement level" of a field.  See "Level of Measurement" in the large
  * comment on struct expr_symbol below for more information. */
@@ -368,8 +369,8 @@ bool expr_relop_from_token(enum lex_type type, enum expr_relop *relop);
 struct expr {
     struct ovs_list node;       /* In parent EXPR_T_AND or EXPR_T_OR if any. */
     enum expr_type type;        /* Expression type. */
-    const char *as_name;        /* Address set name. Null if it is not an
-                                   address set. */
+    const char *as_name;        /* Address set or port group name. Null if
+                                   it is not from either. */
 
     union {
         /* EXPR_T_CMP.
@@ -444,6 +445,7 @@ struct expr *expr_evaluate_condition(
                                 const char *port_name),
     const void *c_aux);
 struct expr *expr_normalize(struct expr *);
+struct expr *expr_normalize_conjunctive(struct expr *);
 
 bool expr_honors_invariants(const struct expr *);
 bool expr_is_simplified(const struct expr *);
@@ -463,6 +465,15 @@ bool expr_evaluate(const struct expr *, const struct flow *uflow,
                    bool (*lookup_port)(const void *aux, const char *port_name,
                                        unsigned int *portp),
                    const void *aux);
+
+struct expr_program *expr_compile(
+    const struct expr *,
+    bool (*lookup_port)(const void *aux, const char *port_name,
+                        unsigned int *portp),
+    const void *aux);
+bool expr_program_evaluate(const struct expr_program *,
+                           const struct flow *uflow);
+void expr_program_destroy(struct expr_program *);
 
 /* Converting expressions to OpenFlow flows. */
 
@@ -486,10 +497,13 @@ uint32_t expr_to_matches(const struct expr *,
                                              unsigned int *portp),
                          const void *aux,
                          struct hmap *matches);
+void expr_set_worker_pool(struct worker_pool *);
 void expr_match_destroy(struct expr_match *);
 void expr_matches_destroy(struct hmap *matches);
 size_t expr_matches_prepare(struct hmap *matches, uint32_t conj_id_ofs);
 void expr_matches_print(const struct hmap *matches, FILE *);
+void expr_port_to_as_ip(unsigned int port, struct in6_addr *ip,
+                        struct in6_addr *mask);
 
 /* Action parsing helper. */
 
@@ -553,6 +567,14 @@ void expr_constant_set_integers_diff(
                                 struct expr_constant_set *new,
                                 struct expr_constant_set **p_diff_added,
                                 struct expr_constant_set **p_diff_deleted);
+struct expr_constant_set *expr_constant_set_create_strings(
+                                const char *const *values, size_t n_values,
+                                const struct sset *filter);
+void expr_constant_set_strings_diff(
+                                const struct expr_constant_set *old,
+                                const struct expr_constant_set *new,
+                                struct expr_constant_set **p_diff_added,
+                                struct expr_constant_set **p_diff_deleted);
 
 
 /* Constant sets.
@@ -199,4 +199,6 @@ lex_str_free(struct lex_str *ls)
 struct lex_str lexer_parse_template_string(const char *s,
                                            const struct smap *template_vars,
                                            struct sset *template_vars_ref);
+char *lexer_parse_template_params(const char *s,
+                                  struct smap *template_vars);
 #endif /* ovn/lex.h */
@@ -4962,6 +4962,30 @@ encode_CHK_ECMP_NH(const struct ovnact_result *res,
                            MLF_LOOKUP_COMMIT_ECMP_NH_BIT, ofpacts);
 }
 
+static void
+parse_lookup_arp_nd_rsp(struct action_context *ctx,
+                        const struct expr_field *dst,
+                        struct ovnact_result *res)
+{
+    parse_ovnact_result(ctx, "lookup_arp_nd_rsp", NULL, dst, res);
+}
+
+static void
+format_LOOKUP_ARP_ND_RSP(const struct ovnact_result *res, struct ds *s)
+{
+    expr_field_format(&res->dst, s);
+    ds_put_cstr(s, " = lookup_arp_nd_rsp();");
+}
+
+static void
+encode_LOOKUP_ARP_ND_RSP(const struct ovnact_result *res,
+                         const struct ovnact_encode_params *ep OVS_UNUSED,
+                         struct ofpbuf *ofpacts)
+{
+    encode_result_action__(res, OFTABLE_ARP_ND_RSP_LOOKUP,
+                           MLF_LOOKUP_MAC_BIT, ofpacts);
+}
+
 static void
 parse_commit_lb_aff(struct action_context *ctx,
                     struct ovnact_commit_lb_aff *lb_aff)
@@ -5472,6 +5496,10 @@ parse_set_action(struct action_context *ctx)
                    lexer_lookahead(ctx->lexer) == LEX_T_LPAREN) {
             parse_chk_lb_aff(ctx, &lhs,
                     ovnact_put_CHK_LB_AFF(ctx->ovnacts));
+        } else if (!strcmp(ctx->lexer->token.s, "lookup_arp_nd_rsp") &&
+                   lexer_lookahead(ctx->lexer) == LEX_T_LPAREN) {
+            parse_lookup_arp_nd_rsp(ctx, &lhs,
+                    ovnact_put_LOOKUP_ARP_ND_RSP(ctx->ovnacts));
         } else if (lexer_match_id(ctx->lexer, "dhcp_relay_req_chk")) {
             parse_dhcp_relay_chk(
                 ctx, &lhs, ovnact_put_DHCPV4_RELAY_REQ_CHK(ctx->ovnacts));
@@ -5761,6 +5789,202 @@ ovnacts_encode(const struct ovnact *ovnacts, size_t ovnacts_len,
         }
     }
 }
+
+/* Caching encoded actions. */
+
+/* The cache is flushed when it reaches this number of entries. */
+#define OVNACTS_ENCODE_CACHE_MAX_ENTRIES 4096
+
+/* Actions longer than this aren't cached, they are unlikely to be shared. */
+#define OVNACTS_ENCODE_CACHE_MAX_LEN 1024
+
+/* The encoding parameters that cacheable actions depend on. */
+struct ovnacts_encode_key {
+    uint32_t ctrl_meter_id;
+    uint32_t common_nat_ct_zone;
+    uint32_t mac_cache_use_table;
+    uint8_t pipeline;
+    uint8_t ltable;
+    bool is_switch;
+    bool explicit_arp_ns_output;
+    uint8_t ptables[15];
+};
+
+struct ovnacts_encode_cache_entry {
+    struct hmap_node hmap_node;
+    struct ovnacts_encode_key key;
+    struct ofpbuf ofpacts;
+    char actions_s[];
+};
+
+struct ovnacts_encode_cache {
+    struct hmap entries;
+};
+
+static void
+ovnacts_encode_key_init(struct ovnacts_encode_key *key, uint8_t ltable,
+                        const struct ovnact_encode_params *ep)
+{
+    /* Zero the padding too, since keys are compared with memcmp(). */
+    memset(key, 0, sizeof *key);
+    key->ctrl_meter_id = ep->ctrl_meter_id;
+    key->common_nat_ct_zone = ep->common_nat_ct_zone;
+    key->mac_cache_use_table = ep->mac_cache_use_table;
+    key->pipeline = ep->pipeline;
+    key->ltable = ltable;
+    key->is_switch = ep->is_switch;
+    key->explicit_arp_ns_output = ep->explicit_arp_ns_output;
+
+    const uint8_t ptables[] = {
+        ep->ingress_ptable, ep->egress_ptable, ep->output_ptable,
+        ep->mac_bind_ptable, ep->mac_lookup_ptable, ep->lb_hairpin_ptable,
+        ep->lb_hairpin_reply_ptable, ep->ct_snat_vip_ptable, ep->fdb_ptable,
+        ep->fdb_lookup_ptable, ep->in_port_sec_ptable,
+        ep->out_port_sec_ptable,
+    };
+    BUILD_ASSERT_DECL(ARRAY_SIZE(ptables) <= ARRAY_SIZE(key->ptables));
+    memcpy(key->ptables, ptables, sizeof ptables);
+}
+
+/* Returns true if encoding 'ovnacts' only depends on the parameters in
+ * struct ovnacts_encode_key, and the result of parsing them only depends on
+ * the action string, the pipeline, the logical table and the option
+ * definitions (see struct ovnacts_encode_cache). */
+static bool
+ovnacts_encode_is_cacheable(const struct ovnact *ovnacts, size_t ovnacts_len)
+{
+    const struct ovnact *a;
+
+    OVNACT_FOR_EACH (a, ovnacts, ovnacts_len) {
+        switch (a->type) {
+        case OVNACT_LOAD:
+            /* Loading a port name requires a port lookup. */
+            if (!ovnact_get_LOAD(a)->dst.symbol->width) {
+                return false;
+            }
+            break;
+
+        case OVNACT_CT_COMMIT_V2:
+        case OVNACT_CLONE:
+        case OVNACT_ARP:
+        case OVNACT_ICMP4:
+        case OVNACT_ICMP4_ERROR:
+        case OVNACT_ICMP6:
+        case OVNACT_ICMP6_ERROR:
+        case OVNACT_TCP_RESET:
+        case OVNACT_SCTP_ABORT:
+        case OVNACT_ND_NA:
+        case OVNACT_ND_NA_ROUTER:
+        case OVNACT_ND_NS:
+        case OVNACT_REJECT: {
+            const struct ovnact_nest *on = ALIGNED_CAST(
+                const struct ovnact_nest *, a);
+            if (!ovnacts_encode_is_cacheable(on->nested, on->nested_len)) {
+                return false;
+            }
+            break;
+        }
+
+        /* Depend on the group and meter tables, on port lookups or on the
+         * logical flow. */
+        case OVNACT_CT_COMMIT_TO_ZONE:
+        case OVNACT_CT_COMMIT_NAT:
+        case OVNACT_CT_LB:
+        case OVNACT_CT_LB_MARK:
+        case OVNACT_SELECT:
+        case OVNACT_LOG:
+        case OVNACT_SET_METER:
+        case OVNACT_BIND_VPORT:
+        case OVNACT_FWD_GROUP:
+        case OVNACT_SAMPLE:
+        case OVNACT_COMMIT_LB_AFF:
+            return false;
+
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+struct ovnacts_encode_cache *
+ovnacts_encode_cache_create(void)
+{
+    struct ovnacts_encode_cache *cache = xmalloc(sizeof *cache);
+
+    hmap_init(&cache->entries);
+    return cache;
+}
+
+void
+ovnacts_encode_cache_clear(struct ovnacts_encode_cache *cache)
+{
+    struct ovnacts_encode_cache_entry *e;
+
+    HMAP_FOR_EACH_POP (e, hmap_node, &cache->entries) {
+        ofpbuf_uninit(&e->ofpacts);
+        free(e);
+    }
+}
+
+void
+ovnacts_encode_cache_destroy(struct ovnacts_encode_cache *cache)
+{
+    if (cache) {
+        ovnacts_encode_cache_clear(cache);
+        hmap_destroy(&cache->entries);
+        free(cache);
+    }
+}
+
+/* Encodes the 'ovnacts_len' bytes of actions starting at 'ovnacts', which
+ * were parsed from 'actions_s' for logical table 'ltable', like
+ * ovnacts_encode(), and returns the ofpacts to use.
+ *
+ * If the actions can be cached, the returned ofpacts are owned by 'cache' and
+ * remain valid until the next call that modifies it.  Otherwise, or if
+ * 'cache' is NULL, the actions are appended to 'ofpacts', which is
+ * returned. */
+const struct ofpbuf *
+ovnacts_encode_cached(struct ovnacts_encode_cache *cache,
+                      const char *actions_s, uint8_t ltable,
+                      const struct ovnact *ovnacts, size_t ovnacts_len,
+                      const struct ovnact_encode_params *ep,
+                      struct ofpbuf *ofpacts)
+{
+    size_t len = strlen(actions_s);
+
+    if (!cache || len > OVNACTS_ENCODE_CACHE_MAX_LEN
+        || !ovnacts_encode_is_cacheable(ovnacts, ovnacts_len)) {
+        ovnacts_encode(ovnacts, ovnacts_len, ep, ofpacts);
+        return ofpacts;
+    }
+
+    struct ovnacts_encode_key key;
+    ovnacts_encode_key_init(&key, ltable, ep);
+
+    uint32_t hash = hash_bytes(&key, sizeof key, hash_string(actions_s, 0));
+    struct ovnacts_encode_cache_entry *e;
+
+    HMAP_FOR_EACH_WITH_HASH (e, hmap_node, hash, &cache->entries) {
+        if (!memcmp(&e->key, &key, sizeof key)
+            && !strcmp(e->actions_s, actions_s)) {
+            return &e->ofpacts;
+        }
+    }
+
+    if (hmap_count(&cache->entries) >= OVNACTS_ENCODE_CACHE_MAX_ENTRIES) {
+        ovnacts_encode_cache_clear(cache);
+    }
+
+    e = xmalloc(sizeof *e + len + 1);
+    e->key = key;
+    memcpy(e->actions_s, actions_s, len + 1);
+    ofpbuf_init(&e->ofpacts, 0);
+    ovnacts_encode(ovnacts, ovnacts_len, ep, &e->ofpacts);
+    hmap_insert(&cache->entries, &e->hmap_node, hash);
+    return &e->ofpacts;
+}
 
 /* Freeing ovnacts. */
 
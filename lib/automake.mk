@@ -22,6 +22,10 @@ lib_libovn_la_SOURCES = \
 	lib/extend-table.h \
 	lib/extend-table.c \
 	lib/features.c \
+	lib/hbitmap.c \
+	lib/hbitmap.h \
+	lib/idl-recorder.c \
+	lib/idl-recorder.h \
 	lib/ovn-parallel-hmap.h \
 	lib/ovn-parallel-hmap.c \
 	lib/ip-mcast-index.c \
@@ -35,10 +39,18 @@ lib_libovn_la_SOURCES = \
 	lib/lex.c \
 	lib/objdep.c \
 	lib/objdep.h \
+	lib/resizing-hmap.c \
+	lib/resizing-hmap.h \
 	lib/ovn-l7.h \
 	lib/ovn-l7.c \
 	lib/ovn-util.c \
 	lib/ovn-util.h \
+	lib/profiler.c \
+	lib/profiler.h \
+	lib/slab.c \
+	lib/slab.h \
+	lib/sliced-reply.c \
+	lib/sliced-reply.h \
 	lib/logical-fields.c \
 	lib/inc-proc-eng.c \
 	lib/inc-proc-eng.h \
@@ -25,6 +25,9 @@
 #include "openvswitch/ofp-actions.h"
 #include "openvswitch/shash.h"
 #include "openvswitch/vlog.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "ovn-parallel-hmap.h"
 #include "ovn-util.h"
 #include "ovn/expr.h"
 #include "ovn/lex.h"
@@ -511,6 +514,7 @@ struct expr_context {
 
     bool not;                    /* True inside odd number of NOT operators. */
     unsigned int paren_depth;    /* Depth of nested parentheses. */
+    bool uses_sets;              /* Refers to an address set or port group. */
 };
 
 struct expr *expr_parse__(struct expr_context *);
@@ -679,6 +683,82 @@ exit:
     return e;
 }
 
+/* Symbol lookup.
+ *
+ * Every field reference in every parsed expression and action looks up its
+ * symbol by name.  The names come from a small set that is fixed once the
+ * symbol table is built, so each thread keeps a direct-mapped cache of the
+ * symbols that it looked up, indexed by a hash of the length and a few
+ * characters of the name.  A hit costs a single string comparison, instead
+ * of hashing the whole name and walking the shash bucket.
+ *
+ * Adding a symbol or destroying a symbol table bumps
+ * 'expr_symtab_generation', which invalidates the caches of all the
+ * threads. */
+#define EXPR_SYMBOL_CACHE_BITS 9
+#define EXPR_SYMBOL_CACHE_SIZE (1u << EXPR_SYMBOL_CACHE_BITS)
+
+struct expr_symbol_cache_entry {
+    const struct shash *symtab;
+    const struct expr_symbol *symbol;
+};
+
+struct expr_symbol_cache {
+    unsigned int generation;
+    struct expr_symbol_cache_entry entries[EXPR_SYMBOL_CACHE_SIZE];
+};
+
+static atomic_count expr_symtab_generation = ATOMIC_COUNT_INIT(1);
+
+DEFINE_STATIC_PER_THREAD_DATA(struct expr_symbol_cache, expr_symbol_cache,
+                              { 0 });
+
+static void
+expr_symtab_changed(void)
+{
+    atomic_count_inc(&expr_symtab_generation);
+}
+
+static size_t
+expr_symbol_cache_index(const char *name, size_t len)
+{
+    uint32_t key = len
+                   | (uint8_t) name[0] << 8
+                   | (uint8_t) name[len / 2] << 16
+                   | (uint8_t) name[len - 1] << 24;
+
+    return (key * 0x9e3779b1u) >> (32 - EXPR_SYMBOL_CACHE_BITS);
+}
+
+static const struct expr_symbol *
+expr_symtab_lookup(const struct shash *symtab, const char *name)
+{
+    size_t len = strlen(name);
+    if (!len) {
+        return NULL;
+    }
+
+    struct expr_symbol_cache *cache = expr_symbol_cache_get();
+    unsigned int generation = atomic_count_get(&expr_symtab_generation);
+    if (cache->generation != generation) {
+        memset(cache->entries, 0, sizeof cache->entries);
+        cache->generation = generation;
+    }
+
+    struct expr_symbol_cache_entry *e =
+        &cache->entries[expr_symbol_cache_index(name, len)];
+    if (e->symtab == symtab && !strcmp(e->symbol->name, name)) {
+        return e->symbol;
+    }
+
+    const struct expr_symbol *symbol = shash_find_data(symtab, name);
+    if (symbol) {
+        e->symtab = symtab;
+        e->symbol = symbol;
+    }
+    return symbol;
+}
+
 static bool
 parse_field(struct expr_context *ctx, struct expr_field *f)
 {
@@ -690,7 +770,7 @@ parse_field(struct expr_context *ctx, struct expr_field *f)
     }
 
     symbol = ctx->symtab
-             ? shash_find_data(ctx->symtab, ctx->lexer->token.s)
+             ? expr_symtab_lookup(ctx->symtab, ctx->lexer->token.s)
              : NULL;
     if (!symbol) {
         lexer_syntax_error(ctx->lexer, "expecting field name");
@@ -781,6 +861,7 @@ static bool
 parse_addr_sets(struct expr_context *ctx, struct expr_constant_set *cs,
                 size_t *allocated_values)
 {
+    ctx->uses_sets = true;
     if (ctx->addr_sets_ref) {
         size_t *ref_count = shash_find_data(ctx->addr_sets_ref,
                                             ctx->lexer->token.s);
@@ -826,19 +907,20 @@ parse_port_group(struct expr_context *ctx, struct expr_constant_set *cs,
 {
     struct ds sb_name = DS_EMPTY_INITIALIZER;
 
+    ctx->uses_sets = true;
     get_sb_port_group_name(ctx->lexer->token.s, ctx->dp_id, &sb_name);
     if (ctx->port_groups_ref) {
         sset_add(ctx->port_groups_ref, ds_cstr(&sb_name));
     }
 
-    struct expr_constant_set *port_group = NULL;
+    struct shash_node *node = NULL;
 
     if (ctx->port_groups) {
-        port_group = shash_find_data(ctx->port_groups, ds_cstr(&sb_name));
+        node = shash_find(ctx->port_groups, ds_cstr(&sb_name));
     }
     ds_destroy(&sb_name);
 
-    if (!port_group) {
+    if (!node) {
         lexer_syntax_error(ctx->lexer, "expecting port group name");
         return false;
     }
@@ -847,6 +929,7 @@ parse_port_group(struct expr_context *ctx, struct expr_constant_set *cs,
         return false;
     }
 
+    struct expr_constant_set *port_group = node->data;
     size_t n_values = cs->n_values + port_group->n_values;
     if (n_values >= *allocated_values) {
         cs->values = xrealloc(cs->values, n_values * sizeof *cs->values);
@@ -855,7 +938,7 @@ parse_port_group(struct expr_context *ctx, struct expr_constant_set *cs,
     for (size_t i = 0; i < port_group->n_values; i++) {
         struct expr_constant *c = &cs->values[cs->n_values++];
         c->string = xstrdup(port_group->values[i].string);
-        c->as_name = NULL;
+        c->as_name = node->name;
     }
 
     return true;
@@ -1192,6 +1275,66 @@ expr_constant_set_integers_diff(struct expr_constant_set *old,
     *p_diff_deleted = diff_deleted;
 }
 
+static void
+expr_constant_set_add_string(struct expr_constant_set **p_cs,
+                             const char *string, size_t *allocated)
+{
+    struct expr_constant c = { .string = xstrdup(string) };
+
+    if (!*p_cs) {
+        *p_cs = xzalloc(sizeof **p_cs);
+        (*p_cs)->in_curlies = true;
+        (*p_cs)->type = EXPR_C_STRING;
+    }
+    expr_constant_set_add_value(p_cs, &c, allocated);
+}
+
+/* Find the differences between old and new, which must be string type, e.g.
+ * generated by expr_constant_set_create_strings().  Unlike
+ * expr_constant_set_integers_diff(), they don't need to be sorted.
+ *
+ * The differences, added and deleted elements, are stored in p_diff_added and
+ * p_diff_deleted respectively. Caller takes the ownership of these.
+ *
+ * *p_diff_added and *p_diff_deleted can be NULL, if no such elements found. */
+void
+expr_constant_set_strings_diff(const struct expr_constant_set *old,
+                               const struct expr_constant_set *new,
+                               struct expr_constant_set **p_diff_added,
+                               struct expr_constant_set **p_diff_deleted)
+{
+    struct expr_constant_set *diff_added = NULL;
+    struct expr_constant_set *diff_deleted = NULL;
+    size_t added_n_allocated = 0, deleted_n_allocated = 0;
+    struct sset old_strings = SSET_INITIALIZER(&old_strings);
+
+    ovs_assert(old->type == EXPR_C_STRING && new->type == EXPR_C_STRING);
+    for (size_t i = 0; i < old->n_values; i++) {
+        sset_add(&old_strings, old->values[i].string);
+    }
+
+    for (size_t i = 0; i < new->n_values; i++) {
+        const char *string = new->values[i].string;
+        if (!sset_find_and_delete(&old_strings, string)) {
+            expr_constant_set_add_string(&diff_added, string,
+                                         &added_n_allocated);
+        }
+    }
+
+    /* The strings left are the ones that are not in 'new' anymore. */
+    for (size_t i = 0; i < old->n_values; i++) {
+        const char *string = old->values[i].string;
+        if (sset_find_and_delete(&old_strings, string)) {
+            expr_constant_set_add_string(&diff_deleted, string,
+                                         &deleted_n_allocated);
+        }
+    }
+    sset_destroy(&old_strings);
+
+    *p_diff_added = diff_added;
+    *p_diff_deleted = diff_deleted;
+}
+
 
 /* Adds an constant set named 'name' to 'const_sets', replacing any existing
  * constant set entry with the given name. */
@@ -1216,15 +1359,12 @@ expr_const_sets_add_integers(struct shash *const_sets, const char *name,
     expr_const_sets_add(const_sets, name, cs);
 }
 
-/* Adds an constant set named 'name' to 'const_sets', replacing any existing
- * constant set entry with the given name. Unlike expr_const_sets_add_integers,
- * the 'values' will not be converted but stored as is.
- * 'filter', if not NULL, specifies a set of eligible values that are allowed
- * to be added from 'values'. */
-void
-expr_const_sets_add_strings(struct shash *const_sets, const char *name,
-                            const char *const *values, size_t n_values,
-                            const struct sset *filter)
+/* Create a string type constant set.  The 'values' are not converted but
+ * stored as is.  'filter', if not NULL, specifies a set of eligible values
+ * that are allowed to be added from 'values'. */
+struct expr_constant_set *
+expr_constant_set_create_strings(const char *const *values, size_t n_values,
+                                 const struct sset *filter)
 {
     struct expr_constant_set *cs = xzalloc(sizeof *cs);
     cs->in_curlies = true;
@@ -1234,14 +1374,28 @@ expr_const_sets_add_strings(struct shash *const_sets, const char *name,
     for (size_t i = 0; i < n_values; i++) {
         if (filter && !sset_find(filter, values[i])) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(100, 10);
-            VLOG_DBG_RL(&rl, "Skip constant set entry '%s' for '%s'",
-                        values[i], name);
+            VLOG_DBG_RL(&rl, "Skip constant set entry '%s'", values[i]);
             continue;
         }
         struct expr_constant *c = &cs->values[cs->n_values++];
         c->string = xstrdup(values[i]);
     }
+    return cs;
+}
 
+/* Adds an constant set named 'name' to 'const_sets', replacing any existing
+ * constant set entry with the given name. Unlike expr_const_sets_add_integers,
+ * the 'values' will not be converted but stored as is.
+ * 'filter', if not NULL, specifies a set of eligible values that are allowed
+ * to be added from 'values'. */
+void
+expr_const_sets_add_strings(struct shash *const_sets, const char *name,
+                            const char *const *values, size_t n_values,
+                            const struct sset *filter)
+{
+    struct expr_constant_set *cs = expr_constant_set_create_strings(values,
+                                                                    n_values,
+                                                                    filter);
     expr_const_sets_add(const_sets, name, cs);
 }
 
@@ -1508,6 +1662,119 @@ expr_parse(struct lexer *lexer, const struct shash *symtab,
     return lexer->error ? NULL : expr_parse__(&ctx);
 }
 
+/* Cache of the expressions parsed by expr_parse_string().
+ *
+ * The same strings are parsed over and over, e.g., the prerequisites of the
+ * fields and actions for every logical flow, and many logical flows have the
+ * same match.  The result of parsing a string only depends on the symbol
+ * table, unless it refers to address sets or port groups, so the other ones
+ * are kept here and cloned on later parses of the same string.  The cached
+ * expressions are never modified.
+ *
+ * The cache is shared by all the threads.  It is bounded and simply flushed
+ * when it is full, and the entries of a symbol table are flushed when it is
+ * destroyed. */
+#define EXPR_PARSE_CACHE_MAX_ENTRIES 4096
+#define EXPR_PARSE_CACHE_MAX_LEN 1024
+
+struct expr_parse_cache_entry {
+    struct hmap_node node;
+    const struct shash *symtab;
+    struct expr *expr;
+    char s[];
+};
+
+static struct ovs_rwlock expr_parse_cache_rwlock;
+static struct hmap expr_parse_cache OVS_GUARDED_BY(expr_parse_cache_rwlock)
+    = HMAP_INITIALIZER(&expr_parse_cache);
+
+static void
+expr_parse_cache_init(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        ovs_rwlock_init(&expr_parse_cache_rwlock);
+        ovsthread_once_done(&once);
+    }
+}
+
+/* Returns a clone of the cached parse of 's' with 'symtab', or NULL if there
+ * is none. */
+static struct expr *
+expr_parse_cache_get(const char *s, const struct shash *symtab, uint32_t hash)
+{
+    struct expr_parse_cache_entry *e;
+    struct expr *expr = NULL;
+
+    expr_parse_cache_init();
+    ovs_rwlock_rdlock(&expr_parse_cache_rwlock);
+    HMAP_FOR_EACH_WITH_HASH (e, node, hash, &expr_parse_cache) {
+        if (e->symtab == symtab && !strcmp(e->s, s)) {
+            expr = expr_clone(e->expr);
+            break;
+        }
+    }
+    ovs_rwlock_unlock(&expr_parse_cache_rwlock);
+    return expr;
+}
+
+static void
+expr_parse_cache_flush__(const struct shash *symtab)
+    OVS_REQ_WRLOCK(expr_parse_cache_rwlock)
+{
+    struct expr_parse_cache_entry *e;
+
+    HMAP_FOR_EACH_SAFE (e, node, &expr_parse_cache) {
+        if (!symtab || e->symtab == symtab) {
+            hmap_remove(&expr_parse_cache, &e->node);
+            expr_destroy(e->expr);
+            free(e);
+        }
+    }
+}
+
+/* Stores a clone of 'expr', the parse of 's', 'len' bytes long, with
+ * 'symtab'. */
+static void
+expr_parse_cache_put(const char *s, size_t len, const struct shash *symtab,
+                     uint32_t hash, struct expr *expr)
+{
+    struct expr_parse_cache_entry *e = xmalloc(sizeof *e + len + 1);
+
+    e->symtab = symtab;
+    e->expr = expr_clone(expr);
+    memcpy(e->s, s, len + 1);
+
+    ovs_rwlock_wrlock(&expr_parse_cache_rwlock);
+    if (hmap_count(&expr_parse_cache) >= EXPR_PARSE_CACHE_MAX_ENTRIES) {
+        expr_parse_cache_flush__(NULL);
+    }
+
+    /* Another thread might have cached the same string meanwhile. */
+    const struct expr_parse_cache_entry *old;
+    HMAP_FOR_EACH_WITH_HASH (old, node, hash, &expr_parse_cache) {
+        if (old->symtab == symtab && !strcmp(old->s, s)) {
+            ovs_rwlock_unlock(&expr_parse_cache_rwlock);
+            expr_destroy(e->expr);
+            free(e);
+            return;
+        }
+    }
+    hmap_insert(&expr_parse_cache, &e->node, hash);
+    ovs_rwlock_unlock(&expr_parse_cache_rwlock);
+}
+
+/* Removes the cached expressions parsed with 'symtab'. */
+static void
+expr_parse_cache_flush(const struct shash *symtab)
+{
+    expr_parse_cache_init();
+    ovs_rwlock_wrlock(&expr_parse_cache_rwlock);
+    expr_parse_cache_flush__(symtab);
+    ovs_rwlock_unlock(&expr_parse_cache_rwlock);
+}
+
 /* Parses the expression in 's' using the symbols in 'symtab' and
  * address set table in 'addr_sets' and 'port_groups'.  If successful, returns
  * the new expression and sets '*errorp' to NULL.  On failure, returns NULL
@@ -1523,17 +1790,40 @@ expr_parse_string(const char *s, const struct shash *symtab,
                   int64_t dp_id,
                   char **errorp)
 {
+    size_t len = strlen(s);
+    bool cacheable = len <= EXPR_PARSE_CACHE_MAX_LEN;
+    uint32_t hash = 0;
+
+    if (cacheable) {
+        hash = hash_bytes(s, len, hash_pointer(symtab, 0));
+
+        struct expr *expr = expr_parse_cache_get(s, symtab, hash);
+        if (expr) {
+            *errorp = NULL;
+            return expr;
+        }
+    }
+
     struct lexer lexer;
 
     lexer_init(&lexer, s);
     lexer_get(&lexer);
-    struct expr *expr = expr_parse(&lexer, symtab, addr_sets, port_groups,
-                                   addr_sets_ref, port_groups_ref, dp_id);
+
+    struct expr_context ctx = { .lexer = &lexer,
+                                .symtab = symtab,
+                                .addr_sets = addr_sets,
+                                .port_groups = port_groups,
+                                .addr_sets_ref = addr_sets_ref,
+                                .port_groups_ref = port_groups_ref,
+                                .dp_id = dp_id };
+    struct expr *expr = lexer.error ? NULL : expr_parse__(&ctx);
     lexer_force_end(&lexer);
     *errorp = lexer_steal_error(&lexer);
     if (*errorp) {
         expr_destroy(expr);
         expr = NULL;
+    } else if (cacheable && !ctx.uses_sets) {
+        expr_parse_cache_put(s, len, symtab, hash, expr);
     }
     lexer_destroy(&lexer);
 
@@ -1628,6 +1918,7 @@ add_symbol(struct shash *symtab, const char *name, int width,
     symbol->must_crossproduct = must_crossproduct;
     symbol->rw = rw;
     shash_add_assert(symtab, symbol->name, symbol);
+    expr_symtab_changed();
     return symbol;
 }
 
@@ -1809,6 +2100,9 @@ expr_symtab_destroy(struct shash *symtab)
 {
     struct shash_node *node;
 
+    expr_parse_cache_flush(symtab);
+    expr_symtab_changed();
+
     SHASH_FOR_EACH_SAFE (node, symtab) {
         struct expr_symbol *symbol = node->data;
 
@@ -2518,23 +2812,155 @@ compare_cmps_cb(const void *a_, const void *b_)
     return compare_cmps_3way(a, b);
 }
 
-/* Similar to mf_subvalue_intersect(), but only checks the possibility of
- * intersection without producing a result. */
+/* Returns true if all that 'a_value'/'a_mask' matches is also matched by
+ * 'b_value'/'b_mask', i.e. if 'a_mask' is a superset of 'b_mask' and both
+ * values are equal on the bits of 'b_mask'.  'bit_width' must be a multiple
+ * of the number of bits in an unsigned long.
+ *
+ * This is called for many pairs of expressions, so it checks all the words
+ * at once, in a loop without branches that the compiler can vectorize. */
+static bool
+expr_bitmap_is_subset(const unsigned long *a_value,
+                      const unsigned long *a_mask,
+                      const unsigned long *b_value,
+                      const unsigned long *b_mask,
+                      size_t bit_width)
+{
+    unsigned long diff = 0;
+
+    for (size_t i = 0; i < bit_width / BITMAP_ULONG_BITS; i++) {
+        diff |= b_mask[i] & (~a_mask[i] | (a_value[i] ^ b_value[i]));
+    }
+    return !diff;
+}
+
+/* Returns the number of bits in the mask of EXPR_T_CMP 'cmp'. */
+static size_t
+expr_cmp_mask_n_bits(const struct expr *cmp)
+{
+    size_t n_bits = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cmp->cmp.mask.be64); i++) {
+        n_bits += count_1bits(cmp->cmp.mask.be64[i]);
+    }
+    return n_bits;
+}
+
+/* Returns true if EXPR_T_CMP 'cmp', whose 'mask_n_bits' must be set, matches
+ * a prefix of the 'symbol->width' bits of its field, e.g., a CIDR on an IP
+ * address, and has no bit set in its value outside of its mask.
+ *
+ * Two such prefixes are either disjoint or one of them contains the other,
+ * which allows to process sets of them after sorting them by value, instead
+ * of comparing them pairwise. */
+static bool
+expr_cmp_is_prefix(const struct expr *cmp, const struct expr_symbol *symbol)
+{
+    size_t n_bits = cmp->cmp.mask_n_bits;
+    union mf_subvalue prefix;
+
+    if (n_bits > symbol->width) {
+        return false;
+    }
+
+    memset(&prefix, 0, sizeof prefix);
+    bitwise_one(&prefix, sizeof prefix, symbol->width - n_bits, n_bits);
+    if (memcmp(&prefix, &cmp->cmp.mask, sizeof prefix)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(cmp->cmp.value.be64); i++) {
+        if (cmp->cmp.value.be64[i] & ~cmp->cmp.mask.be64[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Orders prefixes by their first value, and then from the shortest to the
+ * longest, so that a prefix comes right before the ones it contains. */
+static int
+compare_prefixes_3way(const struct expr *a, const struct expr *b)
+{
+    int d = memcmp(&a->cmp.value, &b->cmp.value, sizeof a->cmp.value);
+    if (!d && a->cmp.mask_n_bits != b->cmp.mask_n_bits) {
+        d = a->cmp.mask_n_bits < b->cmp.mask_n_bits ? -1 : 1;
+    }
+    return d;
+}
+
+static int
+compare_prefixes_cb(const void *a_, const void *b_)
+{
+    const struct expr *const *ap = a_;
+    const struct expr *const *bp = b_;
+    return compare_prefixes_3way(*ap, *bp);
+}
+
+/* Returns true if prefixes 'a' and 'b' overlap, i.e., if one contains the
+ * other. */
 static bool
-expr_bitmap_intersect_check(const unsigned long *a_value,
-                            const unsigned long *a_mask,
-                            const unsigned long *b_value,
-                            const unsigned long *b_mask,
-                            size_t bit_width)
-{
-    for (size_t i = 0; i < bitmap_n_longs(bit_width); i++) {
-        if ((a_value[i] ^ b_value[i]) & (a_mask[i] & b_mask[i])) {
+expr_prefixes_overlap(const struct expr *a, const struct expr *b)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(a->cmp.value.be64); i++) {
+        if ((a->cmp.value.be64[i] ^ b->cmp.value.be64[i])
+            & a->cmp.mask.be64[i] & b->cmp.mask.be64[i]) {
             return false;
         }
     }
     return true;
 }
 
+struct expr_prefix_ref {
+    struct expr *expr;
+    size_t idx;
+};
+
+static int
+compare_prefix_refs_cb(const void *a_, const void *b_)
+{
+    const struct expr_prefix_ref *a = a_;
+    const struct expr_prefix_ref *b = b_;
+    return compare_prefixes_3way(a->expr, b->expr);
+}
+
+/* Implementation of the superset elimination of crush_or_supersets() for
+ * the 'n' 'subs', some of them null, when all of them are prefixes.
+ *
+ * Sorted by value, the prefixes that are kept are disjoint, so a prefix is
+ * contained in another one if and only if it is contained in the last
+ * prefix kept, which makes it O(n log n) instead of O(n**2). */
+static void
+crush_or_prefixes(struct expr **subs, size_t n)
+{
+    struct expr_prefix_ref *sorted = xmalloc(n * sizeof *sorted);
+    size_t n_sorted = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (subs[i]) {
+            sorted[n_sorted++] = (struct expr_prefix_ref) {
+                .expr = subs[i],
+                .idx = i,
+            };
+        }
+    }
+    qsort(sorted, n_sorted, sizeof *sorted, compare_prefix_refs_cb);
+
+    const struct expr *last = NULL;
+    for (size_t i = 0; i < n_sorted; i++) {
+        if (last && expr_prefixes_overlap(last, sorted[i].expr)) {
+            /* 'last' is the same expression with a smaller mask.  Supersets
+             * are only eliminated without address sets, so there is no
+             * reference to remove. */
+            expr_destroy(sorted[i].expr);
+            subs[sorted[i].idx] = NULL;
+        } else {
+            last = sorted[i].expr;
+        }
+    }
+    free(sorted);
+}
+
 /* This function expects an OR expression with already crushed sub
  * expressions, so they are plain comparisons.  Result is the same
  * expression, but with unnecessary sub-expressions removed. */
@@ -2599,6 +3025,15 @@ crush_or_supersets(struct expr *expr, const struct expr_symbol *symbol)
         goto done;
     }
 
+    bool all_prefixes = true;
+    for (i = 0; i < n && all_prefixes; i = next[i]) {
+        all_prefixes = !subs[i] || expr_cmp_is_prefix(subs[i], symbol);
+    }
+    if (all_prefixes) {
+        crush_or_prefixes(subs, n);
+        goto done;
+    }
+
     /* Build a mask size index.  'mask_index[n_bits]' is an index in 'subs',
      * where expressions with 'n_bits' bits in mask start. */
     size_t *mask_index, n_bits;
@@ -2645,9 +3080,8 @@ crush_or_supersets(struct expr *expr, const struct expr_symbol *symbol)
             a_mask  = (unsigned long *) &a->cmp.mask.be64[ofs];
             b_mask  = (unsigned long *) &b->cmp.mask.be64[ofs];
 
-            if (expr_bitmap_intersect_check(a_value, a_mask, b_value, b_mask,
-                                            bit_width)
-                && bitmap_is_superset(b_mask, a_mask, bit_width)) {
+            if (expr_bitmap_is_subset(b_value, b_mask, a_value, a_mask,
+                                      bit_width)) {
                 /* 'a' is the same expression with a smaller mask.
                  * Remove address set reference from the duplicate. */
                 a->as_name = NULL;
@@ -2681,62 +3115,219 @@ done:
     return expr;
 }
 
-/* Implementation of crush_cmps() for expr->type == EXPR_T_AND and a
- * numeric-typed 'symbol'. */
+/* Returns a disjunction of the non-empty intersections of every comparison of
+ * disjunction 'as' with every comparison of disjunction 'bs', further
+ * restricted by 'value' and 'mask'. */
 static struct expr *
-crush_and_numeric(struct expr *expr, const struct expr_symbol *symbol)
+crush_and_pairwise(const struct expr *as, const struct expr *bs,
+                   const union mf_subvalue *value,
+                   const union mf_subvalue *mask,
+                   const struct expr_symbol *symbol)
 {
-    ovs_assert(!ovs_list_is_short(&expr->andor));
+    struct expr *new = NULL;
+    struct expr *or;
 
-    union mf_subvalue value, mask;
-    memset(&value, 0, sizeof value);
-    memset(&mask, 0, sizeof mask);
+    or = xzalloc(sizeof *or);
+    or->type = EXPR_T_OR;
+    ovs_list_init(&or->andor);
 
-    struct expr *sub, *next = NULL;
-    LIST_FOR_EACH_SAFE (sub, next, node, &expr->andor) {
-        ovs_list_remove(&sub->node);
-        struct expr *new = crush_cmps(sub, symbol);
-        switch (new->type) {
-        case EXPR_T_CMP:
-            if (!mf_subvalue_intersect(&value, &mask,
-                                       &new->cmp.value, &new->cmp.mask,
-                                       &value, &mask)) {
-                expr_destroy(new);
-                expr_destroy(expr);
-                return expr_create_boolean(false);
+    struct expr *a;
+    LIST_FOR_EACH (a, node, &as->andor) {
+        union mf_subvalue a_value, a_mask;
+
+        ovs_assert(a->type == EXPR_T_CMP);
+        if (!mf_subvalue_intersect(value, mask,
+                                   &a->cmp.value, &a->cmp.mask,
+                                   &a_value, &a_mask)) {
+            continue;
+        }
+
+        struct expr *b;
+        LIST_FOR_EACH (b, node, &bs->andor) {
+            ovs_assert(b->type == EXPR_T_CMP);
+            if (!new) {
+                new = xzalloc(sizeof *new);
+                new->type = EXPR_T_CMP;
+                new->cmp.symbol = symbol;
+                new->cmp.relop = EXPR_R_EQ;
             }
-            expr_destroy(new);
-            break;
-        case EXPR_T_AND:
-            OVS_NOT_REACHED();
-        case EXPR_T_OR:
-            ovs_list_insert(next ? &next->node : &expr->andor, &new->node);
-            break;
-        case EXPR_T_BOOLEAN:
-            if (!new->boolean) {
-                expr_destroy(expr);
-                return new;
+            if (mf_subvalue_intersect(&a_value, &a_mask,
+                                      &b->cmp.value, &b->cmp.mask,
+                                      &new->cmp.value, &new->cmp.mask)) {
+                ovs_list_push_back(&or->andor, &new->node);
+                new = NULL;
             }
-            expr_destroy(new);
-            break;
-        case EXPR_T_CONDITION:
-            OVS_NOT_REACHED();
         }
     }
-    if (ovs_list_is_empty(&expr->andor)) {
-        if (is_all_zeros(&mask, sizeof mask)) {
-            expr_destroy(expr);
-            return expr_create_boolean(true);
-        } else {
-            struct expr *cmp;
-            cmp = xzalloc(sizeof *cmp);
-            cmp->type = EXPR_T_CMP;
-            cmp->cmp.symbol = symbol;
-            cmp->cmp.relop = EXPR_R_EQ;
-            cmp->cmp.value = value;
-            cmp->cmp.mask = mask;
-            expr_destroy(expr);
-            return cmp;
+    expr_destroy(new);
+    return or;
+}
+
+/* Returns the comparisons of disjunction 'or' sorted by
+ * compare_prefixes_cb(), and their number in '*n', if all of them are
+ * disjoint prefixes.  Otherwise, returns NULL. */
+static struct expr **
+expr_sorted_disjoint_prefixes(struct expr *or,
+                              const struct expr_symbol *symbol, size_t *n)
+{
+    size_t n_subs = ovs_list_size(&or->andor);
+    struct expr **subs = xmalloc(n_subs * sizeof *subs);
+    size_t i = 0;
+
+    struct expr *sub;
+    LIST_FOR_EACH (sub, node, &or->andor) {
+        ovs_assert(sub->type == EXPR_T_CMP);
+        sub->cmp.mask_n_bits = expr_cmp_mask_n_bits(sub);
+        if (!expr_cmp_is_prefix(sub, symbol)) {
+            free(subs);
+            return NULL;
+        }
+        subs[i++] = sub;
+    }
+
+    qsort(subs, n_subs, sizeof *subs, compare_prefixes_cb);
+    for (i = 1; i < n_subs; i++) {
+        if (expr_prefixes_overlap(subs[i - 1], subs[i])) {
+            free(subs);
+            return NULL;
+        }
+    }
+
+    *n = n_subs;
+    return subs;
+}
+
+/* Returns a disjunction of the non-empty intersections of the comparisons of
+ * disjunctions 'as' and 'bs', further restricted by 'value' and 'mask', the
+ * same as crush_and_pairwise(), if both of them are sets of disjoint
+ * prefixes.  Otherwise, returns NULL.
+ *
+ * Two prefixes only intersect if one contains the other, and then the
+ * intersection is the longest one, so walking both sets sorted by value finds
+ * all of the intersections in O(n log n + m log m) instead of O(n * m). */
+static struct expr *
+crush_and_prefix_sets(struct expr *as, struct expr *bs,
+                      const union mf_subvalue *value,
+                      const union mf_subvalue *mask,
+                      const struct expr_symbol *symbol)
+{
+    struct expr **a, **b;
+    size_t n_a, n_b;
+
+    a = expr_sorted_disjoint_prefixes(as, symbol, &n_a);
+    if (!a) {
+        return NULL;
+    }
+    b = expr_sorted_disjoint_prefixes(bs, symbol, &n_b);
+    if (!b) {
+        free(a);
+        return NULL;
+    }
+
+    struct expr *or = xzalloc(sizeof *or);
+    or->type = EXPR_T_OR;
+    ovs_list_init(&or->andor);
+
+    size_t i = 0, j = 0;
+    while (i < n_a && j < n_b) {
+        const struct expr *x = a[i], *y = b[j];
+
+        if (!expr_prefixes_overlap(x, y)) {
+            /* The first one ends before the second one starts, so it can't
+             * overlap with any of the following prefixes of the other set
+             * either. */
+            if (compare_prefixes_3way(x, y) < 0) {
+                i++;
+            } else {
+                j++;
+            }
+            continue;
+        }
+
+        const struct expr *inner = (x->cmp.mask_n_bits >= y->cmp.mask_n_bits
+                                    ? x : y);
+        struct expr *new = xzalloc(sizeof *new);
+        new->type = EXPR_T_CMP;
+        new->cmp.symbol = symbol;
+        new->cmp.relop = EXPR_R_EQ;
+        if (mf_subvalue_intersect(value, mask,
+                                  &inner->cmp.value, &inner->cmp.mask,
+                                  &new->cmp.value, &new->cmp.mask)) {
+            ovs_list_push_back(&or->andor, &new->node);
+        } else {
+            expr_destroy(new);
+        }
+
+        /* The inner prefix doesn't overlap with the next prefix of the other
+         * set, but the outer one might. */
+        if (inner == x) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+
+    free(a);
+    free(b);
+    return or;
+}
+
+/* Implementation of crush_cmps() for expr->type == EXPR_T_AND and a
+ * numeric-typed 'symbol'. */
+static struct expr *
+crush_and_numeric(struct expr *expr, const struct expr_symbol *symbol)
+{
+    ovs_assert(!ovs_list_is_short(&expr->andor));
+
+    union mf_subvalue value, mask;
+    memset(&value, 0, sizeof value);
+    memset(&mask, 0, sizeof mask);
+
+    struct expr *sub, *next = NULL;
+    LIST_FOR_EACH_SAFE (sub, next, node, &expr->andor) {
+        ovs_list_remove(&sub->node);
+        struct expr *new = crush_cmps(sub, symbol);
+        switch (new->type) {
+        case EXPR_T_CMP:
+            if (!mf_subvalue_intersect(&value, &mask,
+                                       &new->cmp.value, &new->cmp.mask,
+                                       &value, &mask)) {
+                expr_destroy(new);
+                expr_destroy(expr);
+                return expr_create_boolean(false);
+            }
+            expr_destroy(new);
+            break;
+        case EXPR_T_AND:
+            OVS_NOT_REACHED();
+        case EXPR_T_OR:
+            ovs_list_insert(next ? &next->node : &expr->andor, &new->node);
+            break;
+        case EXPR_T_BOOLEAN:
+            if (!new->boolean) {
+                expr_destroy(expr);
+                return new;
+            }
+            expr_destroy(new);
+            break;
+        case EXPR_T_CONDITION:
+            OVS_NOT_REACHED();
+        }
+    }
+    if (ovs_list_is_empty(&expr->andor)) {
+        if (is_all_zeros(&mask, sizeof mask)) {
+            expr_destroy(expr);
+            return expr_create_boolean(true);
+        } else {
+            struct expr *cmp;
+            cmp = xzalloc(sizeof *cmp);
+            cmp->type = EXPR_T_CMP;
+            cmp->cmp.symbol = symbol;
+            cmp->cmp.relop = EXPR_R_EQ;
+            cmp->cmp.value = value;
+            cmp->cmp.mask = mask;
+            expr_destroy(expr);
+            return cmp;
         }
     } else if (ovs_list_is_short(&expr->andor)) {
         /* Transform "a && (b || c || d)" into "ab || ac || ad" where "ab" is
@@ -2777,44 +3368,14 @@ crush_and_numeric(struct expr *expr, const struct expr_symbol *symbol)
          *           "(xa0b0 || xa0b1 || xa1b0 || xa1b1) && ...". */
         struct expr *as = expr_from_node(ovs_list_pop_front(&expr->andor));
         struct expr *bs = expr_from_node(ovs_list_pop_front(&expr->andor));
-        struct expr *new = NULL;
         struct expr *or;
 
-        or = xzalloc(sizeof *or);
-        or->type = EXPR_T_OR;
-        ovs_list_init(&or->andor);
-
-        struct expr *a;
-        LIST_FOR_EACH (a, node, &as->andor) {
-            union mf_subvalue a_value, a_mask;
-
-            ovs_assert(a->type == EXPR_T_CMP);
-            if (!mf_subvalue_intersect(&value, &mask,
-                                       &a->cmp.value, &a->cmp.mask,
-                                       &a_value, &a_mask)) {
-                continue;
-            }
-
-            struct expr *b;
-            LIST_FOR_EACH (b, node, &bs->andor) {
-                ovs_assert(b->type == EXPR_T_CMP);
-                if (!new) {
-                    new = xzalloc(sizeof *new);
-                    new->type = EXPR_T_CMP;
-                    new->cmp.symbol = symbol;
-                    new->cmp.relop = EXPR_R_EQ;
-                }
-                if (mf_subvalue_intersect(&a_value, &a_mask,
-                                          &b->cmp.value, &b->cmp.mask,
-                                          &new->cmp.value, &new->cmp.mask)) {
-                    ovs_list_push_back(&or->andor, &new->node);
-                    new = NULL;
-                }
-            }
+        or = crush_and_prefix_sets(as, bs, &value, &mask, symbol);
+        if (!or) {
+            or = crush_and_pairwise(as, bs, &value, &mask, symbol);
         }
         expr_destroy(as);
         expr_destroy(bs);
-        expr_destroy(new);
 
         if (ovs_list_is_empty(&or->andor)) {
             expr_destroy(expr);
@@ -2973,12 +3534,194 @@ expr_sort(struct expr *expr)
     return expr ? expr : expr_create_boolean(true);
 }
 
-static struct expr *expr_normalize_or(struct expr *expr);
+static struct expr *expr_normalize_or(struct expr *expr, bool conjunctive);
+
+static void
+expr_collect_symbols(const struct expr *expr, struct hmapx *symbols)
+{
+    const struct expr *sub;
+
+    switch (expr->type) {
+    case EXPR_T_CMP:
+        hmapx_add(symbols, CONST_CAST(struct expr_symbol *,
+                                      expr->cmp.symbol));
+        break;
+
+    case EXPR_T_AND:
+    case EXPR_T_OR:
+        LIST_FOR_EACH (sub, node, &expr->andor) {
+            expr_collect_symbols(sub, symbols);
+        }
+        break;
+
+    case EXPR_T_BOOLEAN:
+    case EXPR_T_CONDITION:
+    default:
+        break;
+    }
+}
+
+static bool
+expr_cmp_equals(const struct expr *a, const struct expr *b)
+{
+    if (a->cmp.symbol != b->cmp.symbol || a->cmp.relop != b->cmp.relop) {
+        return false;
+    }
+    return (a->cmp.symbol->width
+            ? (!memcmp(&a->cmp.value, &b->cmp.value, sizeof a->cmp.value)
+               && !memcmp(&a->cmp.mask, &b->cmp.mask, sizeof a->cmp.mask))
+            : !strcmp(a->cmp.string, b->cmp.string));
+}
+
+/* Returns true if 'term', an AND of cmps and of at most one disjunction on
+ * a symbol of 'owned', compares each symbol once, at least one symbol of
+ * 'owned' and the symbols of the cmps of 'and' to the same values as them. */
+static bool
+expr_is_conjunctive_term(const struct expr *and, const struct expr *term,
+                         const struct hmapx *owned)
+{
+    struct hmapx symbols = HMAPX_INITIALIZER(&symbols);
+    const struct expr *sub, *cmp;
+    bool has_owned = false;
+    bool ok = true;
+
+    LIST_FOR_EACH (sub, node, &term->andor) {
+        const struct expr_symbol *symbol = (sub->type == EXPR_T_OR
+                                            ? expr_get_unique_symbol(sub)
+                                            : sub->cmp.symbol);
+        if (!hmapx_add(&symbols, CONST_CAST(struct expr_symbol *, symbol))) {
+            ok = false;
+            break;
+        }
+        if (hmapx_contains(owned, symbol)) {
+            has_owned = true;
+            continue;
+        }
+        LIST_FOR_EACH (cmp, node, &and->andor) {
+            if (cmp->type == EXPR_T_CMP && cmp->cmp.symbol == symbol
+                && !expr_cmp_equals(cmp, sub)) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    hmapx_destroy(&symbols);
+    return ok && has_owned;
+}
+
+/* Returns true if 'or', a disjunction over several symbols in 'and', may be
+ * kept as a clause of the conjunctive match of 'and' instead of being
+ * expanded into the crossproduct of its terms with the other clauses.
+ *
+ * Each term must be a cmp or an AND of cmps and of at most one disjunction
+ * of cmps on a single symbol, and compare at least one symbol, owned by
+ * 'or', that the rest of 'and' doesn't compare, so that it turns into
+ * flows that the other clauses can't generate.  It must also compare the
+ * symbols of the cmps of 'and' to the same values. */
+static bool
+expr_is_conjunctive_clause(const struct expr *and, const struct expr *or)
+{
+    struct hmapx owned = HMAPX_INITIALIZER(&owned);
+    struct hmapx others = HMAPX_INITIALIZER(&others);
+    const struct expr *sub, *term;
+    bool ok = true;
+
+    expr_collect_symbols(or, &owned);
+    LIST_FOR_EACH (sub, node, &and->andor) {
+        if (sub != or) {
+            expr_collect_symbols(sub, &others);
+        }
+    }
+
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH (node, &others) {
+        struct hmapx_node *owned_node = hmapx_find(&owned, node->data);
+        if (owned_node) {
+            hmapx_delete(&owned, owned_node);
+        }
+    }
+    HMAPX_FOR_EACH (node, &owned) {
+        const struct expr_symbol *symbol = node->data;
+        if (symbol->must_crossproduct) {
+            ok = false;
+        }
+    }
+
+    LIST_FOR_EACH (term, node, &or->andor) {
+        if (!ok) {
+            break;
+        }
+        if (term->type == EXPR_T_CMP) {
+            ok = hmapx_contains(&owned, term->cmp.symbol);
+            continue;
+        } else if (term->type != EXPR_T_AND) {
+            ok = false;
+            break;
+        }
+
+        size_t n_ors = 0;
+        LIST_FOR_EACH (sub, node, &term->andor) {
+            if (sub->type == EXPR_T_OR) {
+                const struct expr_symbol *symbol =
+                    expr_get_unique_symbol(sub);
+                const struct expr *cmp;
+
+                if (n_ors++ || !symbol || !hmapx_contains(&owned, symbol)) {
+                    ok = false;
+                    break;
+                }
+                LIST_FOR_EACH (cmp, node, &sub->andor) {
+                    if (cmp->type != EXPR_T_CMP) {
+                        ok = false;
+                        break;
+                    }
+                }
+            } else if (sub->type != EXPR_T_CMP) {
+                ok = false;
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        ok = ok && expr_is_conjunctive_term(and, term, &owned);
+    }
+
+    hmapx_destroy(&owned);
+    hmapx_destroy(&others);
+    return ok;
+}
+
+/* Appends 'term', or its sub-expressions if it is an AND, to 'and'.  If
+ * 'move' is true, 'term', which must not be in a list, is consumed, otherwise
+ * they are copied. */
+static void
+expr_crossproduct_add_term(struct expr *and, struct expr *term, bool move)
+{
+    if (term->type == EXPR_T_AND) {
+        struct expr *p;
+
+        LIST_FOR_EACH_SAFE (p, node, &term->andor) {
+            if (move) {
+                ovs_list_remove(&p->node);
+            }
+            struct expr *new = move ? p : expr_clone(p);
+            ovs_list_push_back(&and->andor, &new->node);
+        }
+        if (move) {
+            expr_destroy(term);
+        }
+    } else {
+        struct expr *new = move ? term : expr_clone(term);
+        ovs_list_push_back(&and->andor, &new->node);
+    }
+}
 
 /* Returns 'expr', which is an AND, reduced to OR(AND(clause)) where
- * a clause is a cmp or a disjunction of cmps on a single field. */
+ * a clause is a cmp or a disjunction of cmps on a single field.  If
+ * 'conjunctive' is true, a clause may also be a disjunction over several
+ * fields, see expr_is_conjunctive_clause(). */
 static struct expr *
-expr_normalize_and(struct expr *expr)
+expr_normalize_and(struct expr *expr, bool conjunctive)
 {
     expr = expr_sort(expr);
     if (expr->type != EXPR_T_AND) {
@@ -3016,39 +3759,43 @@ expr_normalize_and(struct expr *expr)
 
         ovs_assert(sub->type == EXPR_T_OR);
         const struct expr_symbol *symbol = expr_get_unique_symbol(sub);
+        if (!symbol && conjunctive && expr_is_conjunctive_clause(expr, sub)) {
+            continue;
+        }
         if (!symbol || symbol->must_crossproduct) {
             struct expr *or = expr_create_andor(EXPR_T_OR);
             struct expr *k;
 
-            LIST_FOR_EACH (k, node, &sub->andor) {
+            /* Each disjunct of 'sub' is only used once, and the other terms
+             * of 'expr' for the last time with the last one, so these are
+             * moved instead of copied. */
+            LIST_FOR_EACH_SAFE (k, node, &sub->andor) {
+                bool last = k->node.next == &sub->andor;
                 struct expr *and = expr_create_andor(EXPR_T_AND);
                 struct expr *m;
 
-                LIST_FOR_EACH (m, node, &expr->andor) {
-                    struct expr *term = m == sub ? k : m;
-                    if (term->type == EXPR_T_AND) {
-                        struct expr *p;
-
-                        LIST_FOR_EACH (p, node, &term->andor) {
-                            struct expr *new = expr_clone(p);
-                            ovs_list_push_back(&and->andor, &new->node);
-                        }
+                ovs_list_remove(&k->node);
+                LIST_FOR_EACH_SAFE (m, node, &expr->andor) {
+                    if (m == sub) {
+                        expr_crossproduct_add_term(and, k, true);
                     } else {
-                        struct expr *new = expr_clone(term);
-                        ovs_list_push_back(&and->andor, &new->node);
+                        if (last) {
+                            ovs_list_remove(&m->node);
+                        }
+                        expr_crossproduct_add_term(and, m, last);
                     }
                 }
                 ovs_list_push_back(&or->andor, &and->node);
             }
             expr_destroy(expr);
-            return expr_normalize_or(or);
+            return expr_normalize_or(or, conjunctive);
         }
     }
     return expr;
 }
 
 static struct expr *
-expr_normalize_or(struct expr *expr)
+expr_normalize_or(struct expr *expr, bool conjunctive)
 {
     struct expr *sub, *next;
 
@@ -3056,7 +3803,7 @@ expr_normalize_or(struct expr *expr)
         if (sub->type == EXPR_T_AND) {
             ovs_list_remove(&sub->node);
 
-            struct expr *new = expr_normalize_and(sub);
+            struct expr *new = expr_normalize_and(sub, conjunctive);
             if (new->type == EXPR_T_BOOLEAN) {
                 if (new->boolean) {
                     expr_destroy(expr);
@@ -3085,27 +3832,18 @@ expr_normalize_or(struct expr *expr)
     return expr;
 }
 
-/* Takes ownership of 'expr', which is either a constant "true" or "false" or
- * an expression in terms of only relationals, AND, and OR.  Returns either a
- * constant "true" or "false" or 'expr' reduced to OR(AND(clause)) where a
- * clause is a cmp or a disjunction of cmps on a single field.  This form is
- * significant because it is a form that can be directly converted to OpenFlow
- * flows with the Open vSwitch "conjunctive match" extension.
- *
- * 'expr' must already have been simplified, with expr_simplify() and had
- * conditions evaluated using expr_evaluate_condition(). */
-struct expr *
-expr_normalize(struct expr *expr)
+static struct expr *
+expr_normalize__(struct expr *expr, bool conjunctive)
 {
     switch (expr->type) {
     case EXPR_T_CMP:
         return expr;
 
     case EXPR_T_AND:
-        return expr_normalize_and(expr);
+        return expr_normalize_and(expr, conjunctive);
 
     case EXPR_T_OR:
-        return expr_normalize_or(expr);
+        return expr_normalize_or(expr, conjunctive);
 
     case EXPR_T_BOOLEAN:
         return expr;
@@ -3118,6 +3856,37 @@ expr_normalize(struct expr *expr)
         OVS_NOT_REACHED();
     }
 }
+
+/* Takes ownership of 'expr', which is either a constant "true" or "false" or
+ * an expression in terms of only relationals, AND, and OR.  Returns either a
+ * constant "true" or "false" or 'expr' reduced to OR(AND(clause)) where a
+ * clause is a cmp or a disjunction of cmps on a single field.  This form is
+ * significant because it is a form that can be directly converted to OpenFlow
+ * flows with the Open vSwitch "conjunctive match" extension.
+ *
+ * 'expr' must already have been simplified, with expr_simplify() and had
+ * conditions evaluated using expr_evaluate_condition(). */
+struct expr *
+expr_normalize(struct expr *expr)
+{
+    return expr_normalize__(expr, false);
+}
+
+/* Same as expr_normalize(), except that a disjunction over several fields
+ * is kept as a clause of a conjunctive match, instead of being expanded into
+ * the crossproduct of its terms with the other clauses, when the flows of
+ * its terms are guaranteed to be distinct from the ones of the other
+ * clauses, see expr_is_conjunctive_clause().  This trades the
+ * multiplication of the number of flows for their addition, e.g.
+ * "(a == 1 || b == {1, 2}) && c == {1, 2, 3}" takes 3 + 3 + 1 flows instead
+ * of 3 * 3, at the cost of an OpenFlow conjunctive match.
+ *
+ * The result is accepted by expr_is_normalized() and expr_to_matches(). */
+struct expr *
+expr_normalize_conjunctive(struct expr *expr)
+{
+    return expr_normalize__(expr, true);
+}
 
 /* Creates, initializes, and returns a new 'struct expr_match'.  If 'm' is
  * nonnull then it is copied into the new expr_match, otherwise the new
@@ -3169,9 +3938,9 @@ expr_match_destroy(struct expr_match *match)
  * This might actually destroy 'match' because it gets merged together with
  * some existing conjunction.*/
 static void
-expr_match_add(struct hmap *matches, struct expr_match *match)
+expr_match_add__(struct hmap *matches, struct expr_match *match,
+                 uint32_t hash)
 {
-    uint32_t hash = match_hash(&match->match, 0);
     struct expr_match *m;
 
     HMAP_FOR_EACH_WITH_HASH (m, hmap_node, hash, matches) {
@@ -3203,19 +3972,26 @@ expr_match_add(struct hmap *matches, struct expr_match *match)
     hmap_insert(matches, &match->hmap_node, hash);
 }
 
+static void
+expr_match_add(struct hmap *matches, struct expr_match *match)
+{
+    expr_match_add__(matches, match, match_hash(&match->match, 0));
+}
+
 /* Applies EXPR_T_CMP-typed 'expr' to 'm'.  This will only work properly if 'm'
  * doesn't already match on 'expr->cmp.symbol', because it replaces any
  * existing match on that symbol instead of intersecting with it.
  *
  * If 'expr' is a comparison on a string field, uses 'lookup_port' and 'aux' to
- * convert the string to a port number.  In such a case, if the port can't be
- * found, returns false.  In all other cases, returns true. */
+ * convert the string to a port number, stored in '*portp' if it is nonnull.
+ * In such a case, if the port can't be found, returns false.  In all other
+ * cases, returns true. */
 static bool
-constrain_match(const struct expr *expr,
-                bool (*lookup_port)(const void *aux,
-                                    const char *port_name,
-                                    unsigned int *portp),
-                const void *aux, struct match *m)
+constrain_match__(const struct expr *expr,
+                  bool (*lookup_port)(const void *aux,
+                                      const char *port_name,
+                                      unsigned int *portp),
+                  const void *aux, struct match *m, unsigned int *portp)
 {
     ovs_assert(expr->type == EXPR_T_CMP);
     if (expr->cmp.symbol->width) {
@@ -3226,6 +4002,9 @@ constrain_match(const struct expr *expr,
         if (!lookup_port(aux, expr->cmp.string, &port)) {
             return false;
         }
+        if (portp) {
+            *portp = port;
+        }
 
         struct mf_subfield sf;
         sf.field = expr->cmp.symbol->field;
@@ -3241,6 +4020,216 @@ constrain_match(const struct expr *expr,
     return true;
 }
 
+static bool
+constrain_match(const struct expr *expr,
+                bool (*lookup_port)(const void *aux,
+                                    const char *port_name,
+                                    unsigned int *portp),
+                const void *aux, struct match *m)
+{
+    return constrain_match__(expr, lookup_port, aux, m, NULL);
+}
+
+/* Port groups are tracked like address sets, each of their ports standing
+ * for an "address" made of its port key, which is how it is stored into
+ * 'ip' and 'mask'. */
+void
+expr_port_to_as_ip(unsigned int port, struct in6_addr *ip,
+                   struct in6_addr *mask)
+{
+    union mf_subvalue x;
+
+    memset(&x, 0, sizeof x);
+    x.integer = htonll(port);
+    *ip = x.ipv6;
+
+    memset(&x, 0, sizeof x);
+    x.integer = OVS_BE64_MAX;
+    *mask = x.ipv6;
+}
+
+/* Parallel expansion of large disjunctions.
+ *
+ * Disjunctions on big address sets may have tens of thousands of terms,
+ * which take a long time to turn into matches.  Beyond a threshold, the
+ * matches of the terms are built and hashed by the threads of 'expr_pool',
+ * each one taking a slice of the terms, and then added to 'matches' by the
+ * calling thread in the order of the terms, so that the result is the same
+ * as with a single thread.
+ *
+ * Only disjunctions whose terms all compare integer fields are expanded this
+ * way, since string comparisons call 'lookup_port', which isn't expected to
+ * be thread safe. */
+#define EXPR_PARALLEL_MIN_TERMS 4096
+
+/* Pool used to expand the large disjunctions, NULL to only use the calling
+ * thread.  See expr_set_worker_pool(). */
+static struct worker_pool *expr_pool;
+
+struct expr_disjunction_task {
+    const struct expr **terms;
+    size_t n_terms;
+    size_t n_workers;
+
+    const struct match *m;
+    uint8_t clause;
+    uint8_t n_clauses;
+    uint32_t conj_id;
+    bool track_as;
+
+    struct expr_match **results; /* One per term. */
+};
+
+static struct expr_match *
+expr_disjunction_term_to_match(const struct expr *sub, const struct match *m,
+                               uint8_t clause, uint8_t n_clauses,
+                               uint32_t conj_id, bool track_as)
+{
+    struct expr_match *match = expr_match_new(m, clause, n_clauses, conj_id);
+    if (track_as && sub->as_name) {
+        ovs_assert(sub->type == EXPR_T_CMP);
+        match->as_name = xstrdup(sub->as_name);
+        /* The ports of port groups are only known once looked up, see
+         * add_disjunction(). */
+        if (sub->cmp.symbol->width) {
+            match->as_ip = sub->cmp.value.ipv6;
+            match->as_mask = sub->cmp.mask.ipv6;
+        }
+    }
+    return match;
+}
+
+static void
+expr_disjunction_task_run(struct worker_control *control, void *task_)
+{
+    struct expr_disjunction_task *task = task_;
+    size_t start = task->n_terms * control->id / task->n_workers;
+    size_t end = task->n_terms * (control->id + 1) / task->n_workers;
+
+    for (size_t i = start; i < end; i++) {
+        const struct expr *sub = task->terms[i];
+        struct expr_match *match =
+            expr_disjunction_term_to_match(sub, task->m, task->clause,
+                                           task->n_clauses, task->conj_id,
+                                           task->track_as);
+
+        /* Integer comparisons never fail. */
+        constrain_match(sub, NULL, NULL, &match->match);
+        match->hmap_node.hash = match_hash(&match->match, 0);
+        task->results[i] = match;
+    }
+}
+
+/* Adds to 'matches' one match per term of disjunction 'or', restricted by 'm'
+ * (if nonnull) and with the given conjunction, using 'expr_pool'.  Returns
+ * false, without adding anything, if 'or' doesn't qualify for the parallel
+ * expansion or if the pool is not available. */
+static bool
+add_disjunction_parallel(const struct expr *or, const struct match *m,
+                         uint8_t clause, uint8_t n_clauses, uint32_t conj_id,
+                         bool track_as, struct hmap *matches)
+{
+    if (!expr_pool) {
+        return false;
+    }
+
+    size_t n_terms = 0;
+    const struct expr *sub;
+    LIST_FOR_EACH (sub, node, &or->andor) {
+        if (sub->type != EXPR_T_CMP || !sub->cmp.symbol->width) {
+            return false;
+        }
+        n_terms++;
+    }
+    if (n_terms < EXPR_PARALLEL_MIN_TERMS) {
+        return false;
+    }
+
+    const struct expr **terms = xmalloc(n_terms * sizeof *terms);
+    struct expr_match **results = xmalloc(n_terms * sizeof *results);
+    size_t i = 0;
+    LIST_FOR_EACH (sub, node, &or->andor) {
+        terms[i++] = sub;
+    }
+
+    struct expr_disjunction_task task = {
+        .terms = terms,
+        .n_terms = n_terms,
+        .n_workers = expr_pool->size,
+        .m = m,
+        .clause = clause,
+        .n_clauses = n_clauses,
+        .conj_id = conj_id,
+        .track_as = track_as,
+        .results = results,
+    };
+    run_pool_task(expr_pool, expr_disjunction_task_run, &task);
+
+    for (i = 0; i < n_terms; i++) {
+        expr_match_add__(matches, results[i], results[i]->hmap_node.hash);
+    }
+
+    free(results);
+    free(terms);
+    return true;
+}
+
+/* Makes expr_to_matches() expand the disjunctions with a large number of
+ * terms on 'pool', which must have been created with
+ * ovn_worker_task_thread(), or only use the calling thread if 'pool' is
+ * NULL, the default.
+ *
+ * The pool is not locked: while it is set, expr_to_matches() must only be
+ * called by one thread at a time and not by the workers of 'pool'. */
+void
+expr_set_worker_pool(struct worker_pool *pool)
+{
+    expr_pool = pool;
+}
+
+/* Adds to 'matches' the flows of 'and', a term of a conjunctive clause
+ * produced by expr_normalize_conjunctive(), and returns how many. */
+static int
+add_disjunction_and_term(const struct expr *and,
+                         bool (*lookup_port)(const void *aux,
+                                             const char *port_name,
+                                             unsigned int *portp),
+                         const void *aux, const struct match *m,
+                         uint8_t clause, uint8_t n_clauses, uint32_t conj_id,
+                         struct hmap *matches)
+{
+    const struct expr *or = NULL;
+    struct match base = *m;
+    const struct expr *sub;
+
+    LIST_FOR_EACH (sub, node, &and->andor) {
+        if (sub->type == EXPR_T_OR) {
+            or = sub;
+        } else if (!constrain_match(sub, lookup_port, aux, &base)) {
+            return 0;
+        }
+    }
+    if (!or) {
+        expr_match_add(matches, expr_match_new(&base, clause, n_clauses,
+                                               conj_id));
+        return 1;
+    }
+
+    int n = 0;
+    LIST_FOR_EACH (sub, node, &or->andor) {
+        struct expr_match *match =
+            expr_disjunction_term_to_match(sub, &base, clause, n_clauses,
+                                           conj_id, false);
+        if (constrain_match(sub, lookup_port, aux, &match->match)) {
+            expr_match_add(matches, match);
+            n++;
+        } else {
+            expr_match_destroy(match);
+        }
+    }
+    return n;
+}
+
 static bool
 add_disjunction(const struct expr *or,
                 bool (*lookup_port)(const void *aux, const char *port_name,
@@ -3253,17 +4242,27 @@ add_disjunction(const struct expr *or,
     int n = 0;
 
     ovs_assert(or->type == EXPR_T_OR);
+    if (add_disjunction_parallel(or, m, clause, n_clauses, conj_id, true,
+                                 matches)) {
+        /* Integer comparisons never fail and there is at least one term. */
+        return true;
+    }
+
     LIST_FOR_EACH (sub, node, &or->andor) {
-        struct expr_match *match = expr_match_new(m, clause, n_clauses,
-                                                  conj_id);
-        if (sub->as_name) {
-            ovs_assert(sub->type == EXPR_T_CMP);
-            ovs_assert(sub->cmp.symbol->width);
-            match->as_name = xstrdup(sub->as_name);
-            match->as_ip = sub->cmp.value.ipv6;
-            match->as_mask = sub->cmp.mask.ipv6;
+        if (sub->type == EXPR_T_AND) {
+            n += add_disjunction_and_term(sub, lookup_port, aux, m, clause,
+                                          n_clauses, conj_id, matches);
+            continue;
         }
-        if (constrain_match(sub, lookup_port, aux, &match->match)) {
+
+        struct expr_match *match =
+            expr_disjunction_term_to_match(sub, m, clause, n_clauses,
+                                           conj_id, true);
+        unsigned int port;
+        if (constrain_match__(sub, lookup_port, aux, &match->match, &port)) {
+            if (match->as_name && !sub->cmp.symbol->width) {
+                expr_port_to_as_ip(port, &match->as_ip, &match->as_mask);
+            }
             expr_match_add(matches, match);
             n++;
         } else {
@@ -3410,6 +4409,10 @@ expr_to_matches(const struct expr *expr,
         if (expr_get_unique_symbol(expr)) {
             struct expr *sub;
 
+            if (add_disjunction_parallel(expr, NULL, 0, 0, 0, false,
+                                         matches)) {
+                break;
+            }
             LIST_FOR_EACH (sub, node, &expr->andor) {
                 add_cmp_flow(sub, lookup_port, aux, matches);
             }
@@ -3560,7 +4563,9 @@ expr_is_normalized_and(const struct expr *expr)
     const struct expr *sub;
 
     LIST_FOR_EACH (sub, node, &expr->andor) {
-        if (!expr_get_unique_symbol(sub)) {
+        if (!expr_get_unique_symbol(sub)
+            && (sub->type != EXPR_T_OR
+                || !expr_is_conjunctive_clause(expr, sub))) {
             return false;
         }
     }
@@ -3669,8 +4674,9 @@ expr_evaluate_cmp(const struct expr *e, const struct flow *f,
  * and 'aux' auxiliary data to pass to it; see expr_to_matches() for more
  * details.
  *
- * This isn't particularly fast.  For performance-sensitive tasks, use
- * expr_to_matches() and the classifier. */
+ * This isn't particularly fast.  To evaluate the same expression many
+ * times, use expr_compile() and expr_program_evaluate(), and for
+ * performance-sensitive tasks, expr_to_matches() and the classifier. */
 bool
 expr_evaluate(const struct expr *e, const struct flow *uflow,
               bool (*lookup_port)(const void *aux, const char *port_name,
@@ -3700,6 +4706,193 @@ expr_evaluate(const struct expr *e, const struct flow *uflow,
     }
 }
 
+/* An instruction of a compiled expression, which compares a field of the
+ * microflow against a constant and then jumps to next[0] or next[1],
+ * depending on whether the comparison was false or true. */
+struct expr_insn {
+    const struct mf_field *field;
+    bool is_port;               /* Compare the whole field to 'port'? */
+    enum expr_relop relop;
+    union mf_value value;       /* First n_bytes, already masked. */
+    union mf_value mask;        /* First n_bytes. */
+    unsigned int port;
+    uint32_t next[2];
+};
+
+/* Jump targets that end the evaluation. */
+#define EXPR_PROGRAM_TRUE UINT32_MAX
+#define EXPR_PROGRAM_FALSE (UINT32_MAX - 1)
+
+/* An expression compiled by expr_compile(). */
+struct expr_program {
+    struct expr_insn *insns;
+    size_t n_insns;
+    size_t allocated_insns;
+    uint32_t start;             /* First instruction or end target. */
+};
+
+/* Appends to 'prog' the instructions of 'e', such that they jump to
+ * 'on_true' or 'on_false' on the respective outcome, and returns the
+ * instruction that evaluates 'e' first.  The instructions are emitted in
+ * the reverse of the order in which they run, since each one needs the index
+ * of the ones that follow. */
+static uint32_t
+expr_compile__(const struct expr *e, struct expr_program *prog,
+               uint32_t on_true, uint32_t on_false,
+               bool (*lookup_port)(const void *aux, const char *port_name,
+                                   unsigned int *portp),
+               const void *aux)
+{
+    const struct expr *sub;
+    uint32_t next;
+
+    switch (e->type) {
+    case EXPR_T_CMP: {
+        const struct mf_field *field = e->cmp.symbol->field;
+        struct expr_insn insn = {
+            .field = field,
+            .relop = e->cmp.relop,
+            .next = { on_false, on_true },
+        };
+
+        if (e->cmp.symbol->width) {
+            int n_bytes = field->n_bytes;
+            const uint8_t *cst = &e->cmp.value.u8[sizeof e->cmp.value
+                                                  - n_bytes];
+            const uint8_t *mask = &e->cmp.mask.u8[sizeof e->cmp.mask
+                                                  - n_bytes];
+
+            memcpy(insn.value.b, cst, n_bytes);
+            memcpy(insn.mask.b, mask, n_bytes);
+        } else {
+            /* A port that can't be looked up never matches, as in
+             * expr_evaluate_cmp(). */
+            if (!lookup_port(aux, e->cmp.string, &insn.port)) {
+                return on_false;
+            }
+            insn.is_port = true;
+        }
+
+        if (prog->n_insns >= prog->allocated_insns) {
+            prog->insns = x2nrealloc(prog->insns, &prog->allocated_insns,
+                                     sizeof *prog->insns);
+        }
+        prog->insns[prog->n_insns] = insn;
+        return prog->n_insns++;
+    }
+
+    case EXPR_T_AND:
+        next = on_true;
+        LIST_FOR_EACH_REVERSE (sub, node, &e->andor) {
+            next = expr_compile__(sub, prog, next, on_false,
+                                  lookup_port, aux);
+        }
+        return next;
+
+    case EXPR_T_OR:
+        next = on_false;
+        LIST_FOR_EACH_REVERSE (sub, node, &e->andor) {
+            next = expr_compile__(sub, prog, on_true, next,
+                                  lookup_port, aux);
+        }
+        return next;
+
+    case EXPR_T_BOOLEAN:
+        return e->boolean ? on_true : on_false;
+
+    case EXPR_T_CONDITION:
+        /* Same assumption as expr_evaluate(). */
+        return e->cond.not ? on_false : on_true;
+
+    default:
+        OVS_NOT_REACHED();
+    }
+}
+
+static uint32_t
+expr_program_reverse_target(const struct expr_program *prog, uint32_t target)
+{
+    return (target == EXPR_PROGRAM_TRUE || target == EXPR_PROGRAM_FALSE
+            ? target
+            : prog->n_insns - 1 - target);
+}
+
+/* Compiles 'e', which must be annotated, into a program that
+ * expr_program_evaluate() can evaluate against a microflow with the same
+ * result as expr_evaluate(), without walking the expression tree.
+ *
+ * Port names are mapped to port numbers with 'lookup_port' and 'aux' while
+ * compiling, so the program must be compiled again if the mapping changes.
+ *
+ * The caller must eventually free the program with expr_program_destroy(). */
+struct expr_program *
+expr_compile(const struct expr *e,
+             bool (*lookup_port)(const void *aux, const char *port_name,
+                                 unsigned int *portp),
+             const void *aux)
+{
+    struct expr_program *prog = xzalloc(sizeof *prog);
+
+    prog->start = expr_compile__(e, prog, EXPR_PROGRAM_TRUE,
+                                 EXPR_PROGRAM_FALSE, lookup_port, aux);
+
+    /* Lay the instructions out in the order in which they run. */
+    for (size_t i = 0; i < prog->n_insns / 2; i++) {
+        struct expr_insn tmp = prog->insns[i];
+        prog->insns[i] = prog->insns[prog->n_insns - 1 - i];
+        prog->insns[prog->n_insns - 1 - i] = tmp;
+    }
+    for (size_t i = 0; i < prog->n_insns; i++) {
+        struct expr_insn *insn = &prog->insns[i];
+        insn->next[0] = expr_program_reverse_target(prog, insn->next[0]);
+        insn->next[1] = expr_program_reverse_target(prog, insn->next[1]);
+    }
+    prog->start = expr_program_reverse_target(prog, prog->start);
+    return prog;
+}
+
+void
+expr_program_destroy(struct expr_program *prog)
+{
+    if (prog) {
+        free(prog->insns);
+        free(prog);
+    }
+}
+
+/* Evaluates 'prog', compiled by expr_compile(), against microflow 'uflow'
+ * and returns the result. */
+bool
+expr_program_evaluate(const struct expr_program *prog,
+                      const struct flow *uflow)
+{
+    uint32_t pc = prog->start;
+
+    while (pc < prog->n_insns) {
+        const struct expr_insn *insn = &prog->insns[pc];
+        const struct mf_field *field = insn->field;
+        int cmp;
+
+        if (!insn->is_port) {
+            union mf_value value;
+
+            mf_get_value(field, uflow, &value);
+            for (int i = 0; i < field->n_bytes; i++) {
+                value.b[i] &= insn->mask.b[i];
+            }
+            cmp = memcmp(&value, &insn->value, field->n_bytes);
+        } else {
+            struct mf_subfield sf = { .field = field, .ofs = 0,
+                                      .n_bits = field->n_bits };
+            uint64_t value = mf_get_subfield(&sf, uflow);
+
+            cmp = value < insn->port ? -1 : value > insn->port;
+        }
+        pc = insn->next[expr_relop_test(insn->relop, cmp)];
+    }
+    return pc == EXPR_PROGRAM_TRUE;
+}
+
 /* Action parsing helper. */
 
 /* Checks that 'f' is 'n_bits' wide (where 'n_bits == 0' means that 'f' must be
@@ -19,7 +19,6 @@
 
 #include "extend-table.h"
 #include "hash.h"
-#include "id-pool.h"
 #include "lib/uuid.h"
 #include "openvswitch/vlog.h"
 
@@ -29,29 +28,79 @@ static void
 ovn_extend_table_delete_desired(struct ovn_extend_table *table,
                                 struct ovn_extend_table_lflow_to_desired *l);
 
+/* Makes [base, base + n_ids) the range of ids of 'table', all of them
+ * unused. */
+static void
+ovn_extend_table_ids_init(struct ovn_extend_table *table, uint32_t base,
+                          uint32_t n_ids)
+{
+    table->base = base;
+    table->n_ids = n_ids;
+    table->next_id = base;
+    table->n_free_ids = 0;
+}
+
+/* Stores an unused id of 'table' in '*id' and returns true, or returns false
+ * if all of them are in use. */
+static bool
+ovn_extend_table_alloc_id(struct ovn_extend_table *table, uint32_t *id)
+{
+    if (table->n_free_ids) {
+        *id = table->free_ids[--table->n_free_ids];
+        return true;
+    }
+    if (table->next_id - table->base < table->n_ids) {
+        *id = table->next_id++;
+        return true;
+    }
+    return false;
+}
+
+static void
+ovn_extend_table_free_id(struct ovn_extend_table *table, uint32_t id)
+{
+    if (table->n_free_ids >= table->allocated_free_ids) {
+        table->free_ids = x2nrealloc(table->free_ids,
+                                     &table->allocated_free_ids,
+                                     sizeof *table->free_ids);
+    }
+    table->free_ids[table->n_free_ids++] = id;
+}
+
 void
 ovn_extend_table_init(struct ovn_extend_table *table, const char *table_name,
                       uint32_t n_ids)
 {
     *table = (struct ovn_extend_table) {
         .name = xstrdup(table_name),
-        .n_ids = n_ids,
-        /* Table id 0 is invalid, set id-pool base to 1. */
-        .table_ids = id_pool_create(1, n_ids),
         .desired = HMAP_INITIALIZER(&table->desired),
         .lflow_to_desired = HMAP_INITIALIZER(&table->lflow_to_desired),
         .existing = HMAP_INITIALIZER(&table->existing),
+        .uninstalled = OVS_LIST_INITIALIZER(&table->uninstalled),
+        .stale = OVS_LIST_INITIALIZER(&table->stale),
     };
+    /* Table id 0 is invalid, start allocating ids at 1. */
+    ovn_extend_table_ids_init(table, 1, n_ids);
 }
 
 void
 ovn_extend_table_reinit(struct ovn_extend_table *table, uint32_t n_ids)
 {
-    if (n_ids != table->n_ids) {
+    ovn_extend_table_reinit_range(table, 1, n_ids);
+}
+
+/* Same as ovn_extend_table_reinit() but allocates the ids of 'table' from
+ * [base, base + n_ids), so that tables installed in the same switch table
+ * (e.g., the OpenFlow group table) don't use the same ids.  'base' must not
+ * be 0, which is an invalid table id. */
+void
+ovn_extend_table_reinit_range(struct ovn_extend_table *table, uint32_t base,
+                              uint32_t n_ids)
+{
+    ovs_assert(base != EXT_TABLE_ID_INVALID);
+    if (base != table->base || n_ids != table->n_ids) {
         ovn_extend_table_clear(table, true);
-        id_pool_destroy(table->table_ids);
-        table->table_ids = id_pool_create(1, n_ids);
-        table->n_ids = n_ids;
+        ovn_extend_table_ids_init(table, base, n_ids);
     }
 }
 
@@ -69,9 +118,40 @@ ovn_extend_table_info_alloc(const char *name, uint32_t id,
     }
     e->hmap_node.hash = hash;
     hmap_init(&e->references);
+    ovs_list_init(&e->list_node);
     return e;
 }
 
+/* Removes 'e' from the 'uninstalled' or 'stale' list it is in, if any. */
+static void
+ovn_extend_table_info_unlink(struct ovn_extend_table_info *e)
+{
+    if (!ovs_list_is_empty(&e->list_node)) {
+        ovs_list_remove(&e->list_node);
+        ovs_list_init(&e->list_node);
+    }
+}
+
+/* Releases what 'e', which is being removed from 'table', holds: the id if
+ * 'e' has no peer, otherwise the peer, that becomes either uninstalled (if
+ * 'e' belongs to 'table->existing') or stale (if 'e' belongs to
+ * 'table->desired'). */
+static void
+ovn_extend_table_info_release(struct ovn_extend_table *table,
+                              struct ovn_extend_table_info *e,
+                              bool existing)
+{
+    if (e->peer) {
+        e->peer->peer = NULL;
+        ovs_list_push_back(existing ? &table->uninstalled : &table->stale,
+                           &e->peer->list_node);
+    } else {
+        /* Unset the id because the peer is deleted already. */
+        ovn_extend_table_info_unlink(e);
+        ovn_extend_table_free_id(table, e->table_id);
+    }
+}
+
 static void
 ovn_extend_table_info_destroy(struct ovn_extend_table_info *e)
 {
@@ -205,12 +285,7 @@ ovn_extend_table_clear(struct ovn_extend_table *table, bool existing)
     /* Clear the target table. */
     HMAP_FOR_EACH_SAFE (g, hmap_node, target) {
         hmap_remove(target, &g->hmap_node);
-        if (g->peer) {
-            g->peer->peer = NULL;
-        } else {
-            /* Unset the id because the peer is deleted already. */
-            id_pool_free_id(table->table_ids, g->table_id);
-        }
+        ovn_extend_table_info_release(table, g, existing);
         ovn_extend_table_info_destroy(g);
     }
 }
@@ -223,7 +298,7 @@ ovn_extend_table_destroy(struct ovn_extend_table *table)
     hmap_destroy(&table->lflow_to_desired);
     ovn_extend_table_clear(table, true);
     hmap_destroy(&table->existing);
-    id_pool_destroy(table->table_ids);
+    free(table->free_ids);
     free(table->name);
 }
 
@@ -234,13 +309,7 @@ ovn_extend_table_remove_existing(struct ovn_extend_table *table,
 {
     /* Remove 'existing' from 'table->existing' */
     hmap_remove(&table->existing, &existing->hmap_node);
-
-    if (existing->peer) {
-        existing->peer->peer = NULL;
-    } else {
-        /* Dealloc the ID. */
-        id_pool_free_id(table->table_ids, existing->table_id);
-    }
+    ovn_extend_table_info_release(table, existing, true);
     ovn_extend_table_info_destroy(existing);
 }
 
@@ -257,11 +326,7 @@ ovn_extend_table_delete_desired(struct ovn_extend_table *table,
             VLOG_DBG("%s: table %s: %s, "UUID_FMT, __func__,
                      table->name, e->name, UUID_ARGS(&l->lflow_uuid));
             hmap_remove(&table->desired, &e->hmap_node);
-            if (e->peer) {
-                e->peer->peer = NULL;
-            } else {
-                id_pool_free_id(table->table_ids, e->table_id);
-            }
+            ovn_extend_table_info_release(table, e, false);
             ovn_extend_table_info_destroy(e);
         }
     }
@@ -288,17 +353,18 @@ ovn_extend_table_sync(struct ovn_extend_table *table)
 {
     struct ovn_extend_table_info *desired;
 
-    /* Copy the contents of desired to existing. */
-    HMAP_FOR_EACH_SAFE (desired, hmap_node, &table->desired) {
-        if (!ovn_extend_table_lookup(&table->existing, desired)) {
-            struct ovn_extend_table_info *existing =
-                ovn_extend_table_info_alloc(desired->name,
-                                            desired->table_id,
-                                            desired,
-                                            desired->hmap_node.hash);
-            hmap_insert(&table->existing, &existing->hmap_node,
-                        existing->hmap_node.hash);
-        }
+    /* Copy the contents of desired to existing.  Only the uninstalled items
+     * need it, the others already have a peer. */
+    LIST_FOR_EACH_POP (desired, list_node, &table->uninstalled) {
+        ovs_list_init(&desired->list_node);
+
+        struct ovn_extend_table_info *existing =
+            ovn_extend_table_info_alloc(desired->name,
+                                        desired->table_id,
+                                        desired,
+                                        desired->hmap_node.hash);
+        hmap_insert(&table->existing, &existing->hmap_node,
+                    existing->hmap_node.hash);
     }
 }
 
@@ -338,7 +404,7 @@ ovn_extend_table_assign_id(struct ovn_extend_table *table, const char *name,
 
     if (!existing_info) {
         /* Reserve a new id. */
-        if (!id_pool_alloc_id(table->table_ids, &table_id)) {
+        if (!ovn_extend_table_alloc_id(table, &table_id)) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
 
             VLOG_ERR_RL(&rl, "table %s: out of table ids.", table->name);
@@ -348,6 +414,12 @@ ovn_extend_table_assign_id(struct ovn_extend_table *table, const char *name,
 
     table_info = ovn_extend_table_info_alloc(name, table_id, existing_info,
                                              hash);
+    if (existing_info) {
+        /* 'existing_info' is no longer stale. */
+        ovn_extend_table_info_unlink(existing_info);
+    } else {
+        ovs_list_push_back(&table->uninstalled, &table_info->list_node);
+    }
 
     hmap_insert(&table->desired,
                 &table_info->hmap_node, table_info->hmap_node.hash);
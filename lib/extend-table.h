@@ -23,26 +23,41 @@
 #include "openvswitch/list.h"
 #include "openvswitch/uuid.h"
 
-struct id_pool;
-
 /* Used to manage expansion tables associated with Flow table,
  * such as the Group Table or Meter Table. */
 struct ovn_extend_table {
     char *name; /* Used to identify this table in a user friendly way,
                  * e.g., for logging. */
+    uint32_t base;  /* Ids are allocated in [base, base + n_ids). */
     uint32_t n_ids;
-    struct id_pool *table_ids; /* Used to allocate ids in either desired or
-                                * existing (or both).  If the same "name"
-                                * exists in both desired and existing tables,
-                                * they must share the same ID.  The "peer"
-                                * pointer would tell if the ID is still used by
-                                * the same item in the peer table. */
+
+    /* Ids used in either desired or existing (or both).  If the same "name"
+     * exists in both desired and existing tables, they must share the same
+     * ID.  The "peer" pointer would tell if the ID is still used by the same
+     * item in the peer table.
+     *
+     * Ids are allocated from 'free_ids', a stack of the ids that were
+     * released, and only then from the ids that were never used, starting at
+     * 'next_id', so that both allocating and releasing an id is O(1). */
+    uint32_t next_id;
+    uint32_t *free_ids;
+    size_t n_free_ids;
+    size_t allocated_free_ids;
+
     struct hmap desired;
     struct hmap lflow_to_desired; /* Index for looking up desired table
                                    * items from given lflow uuid, with
                                    * ovn_extend_table_lflow_to_desired nodes.
                                    */
     struct hmap existing;
+
+    /* Items of 'desired' that are not in 'existing' and items of 'existing'
+     * that are not in 'desired', i.e., the ones without a "peer", linked
+     * through their 'list_node'.  They allow ovn_extend_table_sync() and the
+     * EXTEND_TABLE_FOR_EACH_* iterators to only visit the items that
+     * changed. */
+    struct ovs_list uninstalled;
+    struct ovs_list stale;
 };
 
 struct ovn_extend_table_lflow_to_desired {
@@ -65,6 +80,8 @@ struct ovn_extend_table_info {
     struct hmap references; /* The lflows that are using this item, with
                              * ovn_extend_table_lflow_ref nodes. Only useful
                              * for items in ovn_extend_table.desired. */
+    struct ovs_list list_node; /* In ovn_extend_table.uninstalled or
+                                * ovn_extend_table.stale if "peer" is NULL. */
 };
 
 /* Maintains the link between a lflow and an ovn_extend_table_info item in
@@ -87,6 +104,8 @@ struct ovn_extend_table_lflow_ref {
 void ovn_extend_table_init(struct ovn_extend_table *, const char *table_name,
                            uint32_t n_ids);
 void ovn_extend_table_reinit(struct ovn_extend_table *, uint32_t n_ids);
+void ovn_extend_table_reinit_range(struct ovn_extend_table *, uint32_t base,
+                                   uint32_t n_ids);
 
 void ovn_extend_table_destroy(struct ovn_extend_table *);
 
@@ -116,14 +135,12 @@ ovn_extend_table_desired_lookup_by_name(struct ovn_extend_table * table,
  * 'TABLE'->desired that are not in 'TABLE'->existing.  (The loop body
  * presumably adds them.) */
 #define EXTEND_TABLE_FOR_EACH_UNINSTALLED(DESIRED, TABLE) \
-    HMAP_FOR_EACH (DESIRED, hmap_node, &(TABLE)->desired) \
-        if (!ovn_extend_table_lookup(&(TABLE)->existing, DESIRED))
+    LIST_FOR_EACH (DESIRED, list_node, &(TABLE)->uninstalled)
 
 /* Iterates 'EXISTING' through all of the 'ovn_extend_table_info's in
  * 'TABLE'->existing that are not in 'TABLE'->desired.  (The loop body
  * presumably removes them.) */
-#define EXTEND_TABLE_FOR_EACH_INSTALLED(EXISTING, TABLE)               \
-    HMAP_FOR_EACH_SAFE (EXISTING, hmap_node, &(TABLE)->existing)        \
-        if (!ovn_extend_table_lookup(&(TABLE)->desired, EXISTING))
+#define EXTEND_TABLE_FOR_EACH_INSTALLED(EXISTING, TABLE) \
+    LIST_FOR_EACH_SAFE (EXISTING, list_node, &(TABLE)->stale)
 
 #endif /* lib/extend-table.h */
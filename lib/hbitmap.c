@@ -0,0 +1,234 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <limits.h>
+#include <string.h>
+
+#include "lib/hbitmap.h"
+#include "util.h"
+
+/* Returns the number of meaningful bits in level 'k' of 'hb'. */
+static size_t
+hbitmap_level_bits(const struct hbitmap *hb, size_t k)
+{
+    size_t n = hb->n_bits;
+
+    while (k--) {
+        n = bitmap_n_longs(n);
+    }
+    return n;
+}
+
+/* Sets the unused trailing bits of every level and, if that makes the last
+ * word of a level full, the corresponding summary bit. */
+static void
+hbitmap_init_padding(struct hbitmap *hb)
+{
+    for (size_t k = 0; k < hb->n_levels; k++) {
+        size_t n = hbitmap_level_bits(hb, k);
+        size_t n_longs = MAX(bitmap_n_longs(n), 1);
+        size_t tail = n % BITMAP_ULONG_BITS;
+
+        if (!n) {
+            hb->levels[k][0] = ULONG_MAX;
+        } else if (tail) {
+            hb->levels[k][n_longs - 1] |= ULONG_MAX << tail;
+        }
+        if (hb->levels[k][n_longs - 1] == ULONG_MAX && k + 1 < hb->n_levels) {
+            bitmap_set1(hb->levels[k + 1], n_longs - 1);
+        }
+    }
+}
+
+/* Initializes 'hb' as a hierarchical bitmap of 'n_bits' bits, all of them
+ * initially unset. */
+void
+hbitmap_init(struct hbitmap *hb, size_t n_bits)
+{
+    memset(hb, 0, sizeof *hb);
+    hb->n_bits = n_bits;
+
+    size_t n = n_bits;
+    for (;;) {
+        ovs_assert(hb->n_levels < HBITMAP_MAX_LEVELS);
+        hb->levels[hb->n_levels++] = xcalloc(MAX(bitmap_n_longs(n), 1),
+                                             sizeof(unsigned long));
+        if (n <= BITMAP_ULONG_BITS) {
+            break;
+        }
+        n = bitmap_n_longs(n);
+    }
+    hbitmap_init_padding(hb);
+}
+
+void
+hbitmap_destroy(struct hbitmap *hb)
+{
+    for (size_t k = 0; k < hb->n_levels; k++) {
+        free(hb->levels[k]);
+        hb->levels[k] = NULL;
+    }
+    hb->n_levels = 0;
+    hb->n_bits = 0;
+}
+
+/* Sets bit 'idx' of level 'k' of 'hb', propagating to the upper levels the
+ * words that become full. */
+static void
+hbitmap_set1__(struct hbitmap *hb, size_t k, size_t idx)
+{
+    for (; k < hb->n_levels; k++) {
+        unsigned long *word = &hb->levels[k][idx / BITMAP_ULONG_BITS];
+        unsigned long mask = 1UL << (idx % BITMAP_ULONG_BITS);
+
+        if (*word & mask) {
+            return;
+        }
+        *word |= mask;
+        if (*word != ULONG_MAX) {
+            return;
+        }
+        idx /= BITMAP_ULONG_BITS;
+    }
+}
+
+void
+hbitmap_set1(struct hbitmap *hb, size_t idx)
+{
+    ovs_assert(idx < hb->n_bits);
+    hbitmap_set1__(hb, 0, idx);
+}
+
+/* Grows 'hb' to 'n_bits' bits, which must not be less than its current
+ * size.  The new bits are unset. */
+void
+hbitmap_grow(struct hbitmap *hb, size_t n_bits)
+{
+    ovs_assert(n_bits >= hb->n_bits);
+    if (n_bits == hb->n_bits) {
+        return;
+    }
+
+    struct hbitmap new;
+    hbitmap_init(&new, n_bits);
+
+    /* Copy the full words of level 0 as they are, and the trailing partial
+     * one bit by bit to leave out its padding. */
+    size_t n_full = hb->n_bits / BITMAP_ULONG_BITS;
+    for (size_t w = 0; w < n_full; w++) {
+        new.levels[0][w] = hb->levels[0][w];
+        if (new.levels[0][w] == ULONG_MAX) {
+            hbitmap_set1__(&new, 1, w);
+        }
+    }
+    for (size_t i = n_full * BITMAP_ULONG_BITS; i < hb->n_bits; i++) {
+        if (hbitmap_is_set(hb, i)) {
+            hbitmap_set1(&new, i);
+        }
+    }
+
+    hbitmap_destroy(hb);
+    *hb = new;
+}
+
+/* Unsets all the bits of 'hb'. */
+void
+hbitmap_clear(struct hbitmap *hb)
+{
+    for (size_t k = 0; k < hb->n_levels; k++) {
+        size_t n = hbitmap_level_bits(hb, k);
+
+        memset(hb->levels[k], 0,
+               MAX(bitmap_n_longs(n), 1) * sizeof(unsigned long));
+    }
+    hbitmap_init_padding(hb);
+}
+
+void
+hbitmap_set0(struct hbitmap *hb, size_t idx)
+{
+    ovs_assert(idx < hb->n_bits);
+
+    for (size_t k = 0; k < hb->n_levels; k++) {
+        unsigned long *word = &hb->levels[k][idx / BITMAP_ULONG_BITS];
+        unsigned long mask = 1UL << (idx % BITMAP_ULONG_BITS);
+        bool was_full = *word == ULONG_MAX;
+
+        if (!(*word & mask)) {
+            return;
+        }
+        *word &= ~mask;
+        if (!was_full) {
+            return;
+        }
+        idx /= BITMAP_ULONG_BITS;
+    }
+}
+
+/* Sets the 'count' bits starting at 'start'. */
+void
+hbitmap_set_multiple(struct hbitmap *hb, size_t start, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        hbitmap_set1(hb, start + i);
+    }
+}
+
+/* Returns the index of the first unset bit in 'hb' in the range
+ * [start, end), or 'end' if all of them are set. */
+size_t
+hbitmap_scan0(const struct hbitmap *hb, size_t start, size_t end)
+{
+    size_t idx = start;
+    size_t k = 0;
+
+    end = MIN(end, hb->n_bits);
+    if (start >= end) {
+        return end;
+    }
+
+    /* Walk up the summary levels until one has an unset bit at or after
+     * the current position. */
+    for (;;) {
+        size_t w = idx / BITMAP_ULONG_BITS;
+        unsigned long free_bits = ~hb->levels[k][w]
+                                  & (ULONG_MAX << (idx % BITMAP_ULONG_BITS));
+
+        if (free_bits) {
+            idx = w * BITMAP_ULONG_BITS + raw_ctz(free_bits);
+            break;
+        }
+        if (k + 1 >= hb->n_levels) {
+            return end;
+        }
+        /* The rest of word 'w' is full, so continue at the next word, which
+         * is represented by bit 'w + 1' of the upper level. */
+        idx = w + 1;
+        k++;
+        if (idx >= hbitmap_level_bits(hb, k)) {
+            return end;
+        }
+    }
+
+    /* Walk back down.  A zero bit at level 'k' means that the corresponding
+     * word at level 'k - 1' has at least one unset bit. */
+    while (k > 0) {
+        k--;
+        idx = idx * BITMAP_ULONG_BITS + raw_ctz(~hb->levels[k][idx]);
+    }
+
+    return MIN(idx, end);
+}
@@ -0,0 +1,60 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVN_HBITMAP_H
+#define OVN_HBITMAP_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bitmap.h"
+
+/* Hierarchical bitmap.
+ *
+ * A plain bitmap of 'n_bits' bits (level 0) plus summary levels on top of
+ * it.  Bit 'i' of level 'k + 1' is set if and only if word 'i' of level 'k'
+ * has all of its bits set.  This makes looking up the first unset bit
+ * O(log(n_bits)) instead of the O(n_bits) scan done by bitmap_scan(), which
+ * matters for allocators working on large spaces (e.g., IPAM on a /8 subnet
+ * or 24-bit MAC suffixes) that are close to being full.
+ *
+ * Unused trailing bits of each level are kept set so that they are never
+ * reported as free. */
+
+#define HBITMAP_MAX_LEVELS 8
+
+struct hbitmap {
+    size_t n_bits;
+    size_t n_levels;
+    unsigned long *levels[HBITMAP_MAX_LEVELS];
+};
+
+void hbitmap_init(struct hbitmap *, size_t n_bits);
+void hbitmap_destroy(struct hbitmap *);
+void hbitmap_grow(struct hbitmap *, size_t n_bits);
+void hbitmap_clear(struct hbitmap *);
+
+void hbitmap_set1(struct hbitmap *, size_t idx);
+void hbitmap_set0(struct hbitmap *, size_t idx);
+void hbitmap_set_multiple(struct hbitmap *, size_t start, size_t count);
+
+size_t hbitmap_scan0(const struct hbitmap *, size_t start, size_t end);
+
+static inline bool
+hbitmap_is_set(const struct hbitmap *hb, size_t idx)
+{
+    return bitmap_is_set(hb->levels[0], idx);
+}
+
+#endif /* OVN_HBITMAP_H */
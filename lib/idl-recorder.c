@@ -0,0 +1,212 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "lib/idl-recorder.h"
+
+#include "coverage.h"
+#include "openvswitch/json.h"
+#include "openvswitch/vlog.h"
+#include "ovsdb-data.h"
+#include "ovsdb-idl.h"
+#include "timeval.h"
+#include "util.h"
+#include "uuid.h"
+
+VLOG_DEFINE_THIS_MODULE(idl_recorder);
+
+COVERAGE_DEFINE(idl_recorder_txn);
+
+struct ovn_idl_recorder {
+    struct ovsdb_idl *idl;
+    char *file_name;
+    FILE *file;
+
+    /* Highest change seqno of the rows recorded so far, to tell apart the
+     * rows inserted since the last run from the ones modified since. */
+    unsigned int change_seqno;
+};
+
+/* Creates a recorder of the updates received by 'idl' into 'file_name',
+ * which is truncated.  Returns NULL, after logging an error, if the file
+ * can't be opened. */
+struct ovn_idl_recorder *
+ovn_idl_recorder_create(struct ovsdb_idl *idl, const char *file_name)
+{
+    FILE *file = fopen(file_name, "w");
+    if (!file) {
+        VLOG_ERR("%s: failed to open for recording (%s)", file_name,
+                 ovs_strerror(errno));
+        return NULL;
+    }
+
+    struct ovn_idl_recorder *recorder = xmalloc(sizeof *recorder);
+    *recorder = (struct ovn_idl_recorder) {
+        .idl = idl,
+        .file_name = xstrdup(file_name),
+        .file = file,
+    };
+    return recorder;
+}
+
+void
+ovn_idl_recorder_destroy(struct ovn_idl_recorder *recorder)
+{
+    if (recorder) {
+        fclose(recorder->file);
+        free(recorder->file_name);
+        free(recorder);
+    }
+}
+
+static struct json *
+idl_recorder_where_uuid(const struct ovsdb_idl_row *row)
+{
+    return json_array_create_1(
+        json_array_create_3(json_string_create("_uuid"),
+                            json_string_create("=="),
+                            json_array_create_2(
+                                json_string_create("uuid"),
+                                json_string_create_nocopy(
+                                    xasprintf(UUID_FMT,
+                                              UUID_ARGS(&row->uuid))))));
+}
+
+/* Returns a JSON object with the columns of 'row' in 'table', only the ones
+ * that were updated if 'updated_only' is true, or NULL if there are none. */
+static struct json *
+idl_recorder_row(const struct ovsdb_idl_row *row,
+                 const struct ovsdb_idl_table_class *table,
+                 bool updated_only)
+{
+    struct json *json = NULL;
+
+    for (size_t i = 0; i < table->n_columns; i++) {
+        const struct ovsdb_idl_column *column = &table->columns[i];
+
+        if (updated_only && !ovsdb_idl_track_is_updated(row, column)) {
+            continue;
+        }
+        if (!json) {
+            json = json_object_create();
+        }
+        json_object_put(json, column->name,
+                        ovsdb_datum_to_json(ovsdb_idl_read(row, column),
+                                            &column->type));
+    }
+    return json;
+}
+
+static struct json *
+idl_recorder_op(const char *op, const struct ovsdb_idl_table_class *table)
+{
+    struct json *json = json_object_create();
+
+    json_object_put_string(json, "op", op);
+    json_object_put_string(json, "table", table->name);
+    return json;
+}
+
+/* Appends to the recorder's file the changes tracked by its IDL, if any. */
+void
+ovn_idl_recorder_run(struct ovn_idl_recorder *recorder)
+{
+    const struct ovsdb_idl_class *class = ovsdb_idl_get_class(recorder->idl);
+    struct json *deletes = json_array_create_empty();
+    struct json *inserts = json_array_create_empty();
+    struct json *updates = json_array_create_empty();
+    unsigned int max_seqno = recorder->change_seqno;
+
+    for (size_t i = 0; i < class->n_tables; i++) {
+        const struct ovsdb_idl_table_class *table = &class->tables[i];
+        const struct ovsdb_idl_row *row;
+
+        for (row = ovsdb_idl_track_get_first(recorder->idl, table); row;
+             row = ovsdb_idl_track_get_next(row)) {
+            unsigned int insert_seqno =
+                ovsdb_idl_row_get_seqno(row, OVSDB_IDL_CHANGE_INSERT);
+            unsigned int modify_seqno =
+                ovsdb_idl_row_get_seqno(row, OVSDB_IDL_CHANGE_MODIFY);
+            unsigned int delete_seqno =
+                ovsdb_idl_row_get_seqno(row, OVSDB_IDL_CHANGE_DELETE);
+            bool is_new = insert_seqno > recorder->change_seqno;
+            bool is_deleted = delete_seqno > 0;
+            struct json *op;
+
+            max_seqno = MAX(max_seqno, insert_seqno);
+            max_seqno = MAX(max_seqno, modify_seqno);
+            max_seqno = MAX(max_seqno, delete_seqno);
+
+            if (is_deleted) {
+                if (is_new) {
+                    /* Inserted and deleted since the last run. */
+                    continue;
+                }
+                op = idl_recorder_op("delete", table);
+                json_object_put(op, "where", idl_recorder_where_uuid(row));
+                json_array_add(deletes, op);
+            } else if (is_new) {
+                op = idl_recorder_op("insert", table);
+                json_object_put_string_nocopy(
+                    op, "uuid", xasprintf(UUID_FMT, UUID_ARGS(&row->uuid)));
+                struct json *columns = idl_recorder_row(row, table, false);
+                json_object_put(op, "row",
+                                columns ? columns : json_object_create());
+                json_array_add(inserts, op);
+            } else {
+                struct json *columns = idl_recorder_row(row, table, true);
+                if (!columns) {
+                    continue;
+                }
+                op = idl_recorder_op("update", table);
+                json_object_put(op, "where", idl_recorder_where_uuid(row));
+                json_object_put(op, "row", columns);
+                json_array_add(updates, op);
+            }
+        }
+    }
+    recorder->change_seqno = max_seqno;
+
+    /* Deletes go first so that a row deleted and inserted again, e.g. on a
+     * full resync with the server, is replayed correctly. */
+    struct json *params = json_array_create_1(
+        json_string_create(class->database));
+    struct json *lists[] = { deletes, inserts, updates };
+    for (size_t i = 0; i < ARRAY_SIZE(lists); i++) {
+        const struct json_array *ops = json_array(lists[i]);
+
+        for (size_t j = 0; j < ops->n; j++) {
+            json_array_add(params, json_clone(ops->elems[j]));
+        }
+        json_destroy(lists[i]);
+    }
+
+    if (json_array(params)->n > 1) {
+        COVERAGE_INC(idl_recorder_txn);
+
+        char *s = json_to_string(params, 0);
+        fprintf(recorder->file, "# time: %lld\n%s\n", time_wall_msec(), s);
+        free(s);
+        if (fflush(recorder->file)) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+            VLOG_WARN_RL(&rl, "%s: write failed (%s)", recorder->file_name,
+                         ovs_strerror(errno));
+        }
+    }
+    json_destroy(params);
+}
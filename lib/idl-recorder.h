@@ -0,0 +1,44 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVN_IDL_RECORDER_H
+#define OVN_IDL_RECORDER_H 1
+
+struct ovsdb_idl;
+
+/* Recorder of the updates received by an IDL.
+ *
+ * Each call to ovn_idl_recorder_run() appends to the recorder's file the
+ * changes tracked by the IDL since the tracked changes were last cleared,
+ * i.e. the updates received from the database server, including the ones
+ * caused by the process' own transactions.  It must be called right before
+ * ovsdb_idl_track_clear(), and all the tables and columns of the IDL must
+ * be tracked, e.g. with ovsdb_idl_track_add_all().
+ *
+ * The changes are written as the "params" of an OVSDB "transact" request,
+ * one JSON array per line, preceded by a "# time: MSEC" comment line with
+ * the wall clock time at which they were recorded.  Rows are inserted with
+ * their original UUIDs, so that the file, started with the process, can be
+ * replayed against an empty database, e.g. with ovn-northd-bench --replay,
+ * to reproduce the sequence of updates.
+ *
+ * Columns that the IDL doesn't monitor are recorded with their default
+ * values. */
+
+struct ovn_idl_recorder *ovn_idl_recorder_create(struct ovsdb_idl *,
+                                                 const char *file_name);
+void ovn_idl_recorder_destroy(struct ovn_idl_recorder *);
+void ovn_idl_recorder_run(struct ovn_idl_recorder *);
+
+#endif /* OVN_IDL_RECORDER_H */
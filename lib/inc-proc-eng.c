@@ -18,28 +18,59 @@
 
 #include <errno.h>
 #include <getopt.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "coverage.h"
+#include "hash.h"
+#include "lib/ovn-parallel-hmap.h"
+#include "lib/profiler.h"
 #include "lib/util.h"
 #include "openvswitch/dynamic-string.h"
 #include "openvswitch/hmap.h"
+#include "openvswitch/json.h"
 #include "openvswitch/poll-loop.h"
+#include "openvswitch/usdt-probes.h"
 #include "openvswitch/vlog.h"
 #include "inc-proc-eng.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "sset.h"
 #include "timeval.h"
 #include "unixctl.h"
 
 VLOG_DEFINE_THIS_MODULE(inc_proc_eng);
 
+COVERAGE_DEFINE(engine_yield);
+
 static bool engine_force_recompute = false;
 static bool engine_run_canceled = false;
+
+/* See engine_set_time_budget(). */
+static unsigned int engine_time_budget_msec = 0;
+static long long int engine_run_deadline = LLONG_MAX;
+static bool engine_run_yielded = false;
 static const struct engine_context *engine_context;
 
 static struct engine_node **engine_nodes;
 static size_t engine_n_nodes;
 
+/* Nodes that have the node at the same position in 'engine_nodes' as one of
+ * their inputs, as indexes into 'engine_nodes'.  Used to find out which
+ * nodes become ready when running the engine in parallel. */
+struct engine_node_outputs {
+    size_t *idx;
+    size_t n;
+    size_t allocated;
+};
+static struct engine_node_outputs *engine_outputs;
+
+static struct worker_pool *engine_pool;
+static bool engine_pool_busy;
+
 static const char *engine_node_state_name[EN_STATE_MAX] = {
     [EN_STALE]     = "Stale",
     [EN_UPDATED]   = "Updated",
@@ -49,6 +80,60 @@ static const char *engine_node_state_name[EN_STATE_MAX] = {
 
 static long long engine_compute_log_timeout_msec = 500;
 
+/* Engine tracing.
+ *
+ * When enabled, every engine run, node run, change handler call and
+ * recompute is recorded in a ring buffer of 'engine_trace.size' events,
+ * that can be dumped in the Chrome trace event format, e.g., to be loaded
+ * in Perfetto.  When disabled the only cost is testing
+ * 'engine_trace_enabled'. */
+#define ENGINE_TRACE_DEFAULT_SIZE 65536
+#define ENGINE_TRACE_REASON_LEN 64
+
+struct engine_trace_event {
+    const char *cat;            /* "engine", "node", "handler", "recompute". */
+    const char *name;           /* Node name. */
+    const char *input;          /* Input name, for handlers, or NULL. */
+    const char *result;         /* Outcome, or NULL. */
+    char reason[ENGINE_TRACE_REASON_LEN]; /* Recompute reason. */
+    long long int start_usec;
+    long long int dur_usec;
+    unsigned int tid;
+};
+
+static bool engine_trace_enabled = false;
+static struct ovs_mutex engine_trace_mutex = OVS_MUTEX_INITIALIZER;
+static struct {
+    struct engine_trace_event *events;
+    size_t size;    /* Number of elements in 'events'. */
+    size_t head;    /* Next element to be written. */
+    size_t n;       /* Number of valid elements. */
+} engine_trace OVS_GUARDED_BY(engine_trace_mutex);
+
+/* Recompute causes.
+ *
+ * When enabled, every recompute of a node that has inputs is accounted, with
+ * its cost, to the node, to the reason of the recompute (e.g., the input
+ * whose change handler failed) and to the changes that led to it, i.e., the
+ * set of updated nodes without inputs, typically OVSDB tables, upstream of
+ * the node.  This tells which kinds of database changes are not handled
+ * incrementally, and how much that costs. */
+struct engine_recompute_cause {
+    struct hmap_node hmap_node;
+    const char *node;           /* Name of the recomputed node. */
+    char *reason;
+    char *changes;              /* Names of the changed sources, sorted. */
+    uint64_t count;
+    uint64_t total_usec;
+    uint64_t max_usec;
+};
+
+static bool engine_recompute_causes_enabled = false;
+static struct ovs_mutex engine_recompute_causes_mutex = OVS_MUTEX_INITIALIZER;
+static struct hmap engine_recompute_causes
+    OVS_GUARDED_BY(engine_recompute_causes_mutex)
+    = HMAP_INITIALIZER(&engine_recompute_causes);
+
 static void
 engine_recompute(struct engine_node *node, bool allowed,
                  const char *reason_fmt, ...) OVS_PRINTF_FORMAT(3, 4);
@@ -71,6 +156,120 @@ engine_set_context(const struct engine_context *ctx)
     engine_context = ctx;
 }
 
+static void
+engine_trace_add(const char *cat, const char *name, const char *input,
+                 const char *result, const char *reason,
+                 long long int start_usec)
+{
+    long long int now = time_usec();
+
+    ovs_mutex_lock(&engine_trace_mutex);
+    if (engine_trace.events) {
+        struct engine_trace_event *ev =
+            &engine_trace.events[engine_trace.head];
+
+        *ev = (struct engine_trace_event) {
+            .cat = cat,
+            .name = name,
+            .input = input,
+            .result = result,
+            .start_usec = start_usec,
+            .dur_usec = now - start_usec,
+            .tid = ovsthread_id_self(),
+        };
+        ovs_strlcpy(ev->reason, reason ? reason : "", sizeof ev->reason);
+
+        engine_trace.head = (engine_trace.head + 1) % engine_trace.size;
+        engine_trace.n = MIN(engine_trace.n + 1, engine_trace.size);
+    }
+    ovs_mutex_unlock(&engine_trace_mutex);
+}
+
+static long long int
+engine_trace_start(void)
+{
+    return OVS_UNLIKELY(engine_trace_enabled) ? time_usec() : 0;
+}
+
+/* Adds to 'changes' the names of the nodes without inputs, upstream of
+ * 'node', that were updated by the current run. */
+static void
+engine_collect_changes(const struct engine_node *node, struct sset *visited,
+                       struct sset *changes)
+{
+    for (size_t i = 0; i < node->n_inputs; i++) {
+        const struct engine_node *input = node->inputs[i].node;
+
+        if (!sset_add(visited, input->name)) {
+            continue;
+        }
+        if (input->n_inputs) {
+            engine_collect_changes(input, visited, changes);
+        } else if (input->state == EN_UPDATED) {
+            sset_add(changes, input->name);
+        }
+    }
+}
+
+static void
+engine_recompute_causes_add(const struct engine_node *node,
+                            const char *reason, long long int usec)
+{
+    struct sset visited = SSET_INITIALIZER(&visited);
+    struct sset changed = SSET_INITIALIZER(&changed);
+    struct ds changes = DS_EMPTY_INITIALIZER;
+
+    engine_collect_changes(node, &visited, &changed);
+    const char **names = sset_sort(&changed);
+    for (size_t i = 0; i < sset_count(&changed); i++) {
+        ds_put_format(&changes, "%s%s", i ? "," : "", names[i]);
+    }
+    free(names);
+    sset_destroy(&changed);
+    sset_destroy(&visited);
+
+    uint32_t hash = hash_string(node->name, 0);
+    hash = hash_string(reason, hash);
+    hash = hash_string(ds_cstr(&changes), hash);
+
+    ovs_mutex_lock(&engine_recompute_causes_mutex);
+    struct engine_recompute_cause *cause;
+    HMAP_FOR_EACH_WITH_HASH (cause, hmap_node, hash,
+                             &engine_recompute_causes) {
+        if (!strcmp(cause->node, node->name)
+            && !strcmp(cause->reason, reason)
+            && !strcmp(cause->changes, ds_cstr(&changes))) {
+            break;
+        }
+    }
+    if (!cause) {
+        cause = xzalloc(sizeof *cause);
+        cause->node = node->name;
+        cause->reason = xstrdup(reason);
+        cause->changes = ds_steal_cstr(&changes);
+        hmap_insert(&engine_recompute_causes, &cause->hmap_node, hash);
+    }
+    cause->count++;
+    cause->total_usec += usec;
+    cause->max_usec = MAX(cause->max_usec, usec);
+    ovs_mutex_unlock(&engine_recompute_causes_mutex);
+
+    ds_destroy(&changes);
+}
+
+static void
+engine_recompute_causes_clear(void)
+    OVS_REQUIRES(engine_recompute_causes_mutex)
+{
+    struct engine_recompute_cause *cause;
+
+    HMAP_FOR_EACH_POP (cause, hmap_node, &engine_recompute_causes) {
+        free(cause->reason);
+        free(cause->changes);
+        free(cause);
+    }
+}
+
 /* Builds the topologically sorted 'sorted_nodes' array starting from
  * 'node'.
  */
@@ -111,6 +310,42 @@ engine_get_nodes(struct engine_node *node, size_t *n_count)
     return engine_topo_sort(node, NULL, n_count, &n_size);
 }
 
+static void
+engine_latency_add(struct engine_latency *latency, long long int usec)
+{
+    uint64_t value = MAX(usec, 0);
+    size_t bucket = value ? MIN(log_2_floor(value) + 1,
+                                ENGINE_LATENCY_N_BUCKETS - 1)
+                          : 0;
+
+    latency->buckets[bucket]++;
+    latency->count++;
+    latency->total_usec += value;
+    latency->max_usec = MAX(latency->max_usec, value);
+}
+
+/* Returns an upper bound, in microseconds, of the latency under which
+ * 'pct' percent of the runs in 'latency' completed. */
+static uint64_t
+engine_latency_percentile(const struct engine_latency *latency,
+                          unsigned int pct)
+{
+    uint64_t target = DIV_ROUND_UP(latency->count * pct, 100);
+    uint64_t sum = 0;
+
+    if (!latency->count) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < ENGINE_LATENCY_N_BUCKETS; i++) {
+        sum += latency->buckets[i];
+        if (sum >= target) {
+            return MIN(UINT64_C(1) << i, latency->max_usec);
+        }
+    }
+    return latency->max_usec;
+}
+
 static void
 engine_clear_stats(struct unixctl_conn *conn, int argc OVS_UNUSED,
                    const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
@@ -119,10 +354,148 @@ engine_clear_stats(struct unixctl_conn *conn, int argc OVS_UNUSED,
         struct engine_node *node = engine_nodes[i];
 
         memset(&node->stats, 0, sizeof node->stats);
+        for (size_t j = 0; j < node->n_inputs; j++) {
+            memset(&node->inputs[j].stats, 0, sizeof node->inputs[j].stats);
+        }
     }
     unixctl_command_reply(conn, NULL);
 }
 
+static void
+engine_format_latency(struct ds *s, const char *name,
+                      const struct engine_latency *latency)
+{
+    ds_put_format(s, "- %s latency: %"PRIu64" runs, p50 %"PRIu64"us, "
+                  "p99 %"PRIu64"us, max %"PRIu64"us, total %"PRIu64"us\n",
+                  name, latency->count,
+                  engine_latency_percentile(latency, 50),
+                  engine_latency_percentile(latency, 99),
+                  latency->max_usec, latency->total_usec);
+}
+
+static void
+engine_format_profile(struct ds *s, const struct engine_node *node)
+{
+    ds_put_format(s, "Node: %s\n", node->name);
+    engine_format_latency(s, "recompute", &node->stats.recompute_latency);
+    engine_format_latency(s, "compute", &node->stats.compute_latency);
+    ds_put_format(s, "- forced recompute: %"PRIu64"\n", node->stats.forced);
+
+    for (size_t i = 0; i < node->n_inputs; i++) {
+        const struct engine_node_input *input = &node->inputs[i];
+
+        ds_put_format(s, "- input %s: handled %"PRIu64", failed %"PRIu64", "
+                      "missing %"PRIu64", changes %"PRIu64"\n",
+                      input->node->name, input->stats.handled,
+                      input->stats.failed, input->stats.missing,
+                      input->stats.changes);
+    }
+}
+
+static struct json *
+engine_latency_to_json(const struct engine_latency *latency)
+{
+    struct json *json = json_object_create();
+
+    json_object_put(json, "count", json_integer_create(latency->count));
+    json_object_put(json, "p50_usec", json_integer_create(
+                        engine_latency_percentile(latency, 50)));
+    json_object_put(json, "p99_usec", json_integer_create(
+                        engine_latency_percentile(latency, 99)));
+    json_object_put(json, "max_usec",
+                    json_integer_create(latency->max_usec));
+    json_object_put(json, "total_usec",
+                    json_integer_create(latency->total_usec));
+    return json;
+}
+
+static struct json *
+engine_profile_to_json(const struct engine_node *node)
+{
+    struct json *json = json_object_create();
+
+    json_object_put(json, "recompute",
+                    json_integer_create(node->stats.recompute));
+    json_object_put(json, "compute", json_integer_create(node->stats.compute));
+    json_object_put(json, "cancel", json_integer_create(node->stats.cancel));
+    json_object_put(json, "forced", json_integer_create(node->stats.forced));
+    json_object_put(json, "recompute_latency",
+                    engine_latency_to_json(&node->stats.recompute_latency));
+    json_object_put(json, "compute_latency",
+                    engine_latency_to_json(&node->stats.compute_latency));
+
+    struct json *inputs = json_object_create();
+    for (size_t i = 0; i < node->n_inputs; i++) {
+        const struct engine_node_input *input = &node->inputs[i];
+        struct json *input_json = json_object_create();
+
+        json_object_put(input_json, "handled",
+                        json_integer_create(input->stats.handled));
+        json_object_put(input_json, "failed",
+                        json_integer_create(input->stats.failed));
+        json_object_put(input_json, "missing",
+                        json_integer_create(input->stats.missing));
+        json_object_put(input_json, "changes",
+                        json_integer_create(input->stats.changes));
+        json_object_put(inputs, input->node->name, input_json);
+    }
+    json_object_put(json, "inputs", inputs);
+
+    return json;
+}
+
+static void
+engine_dump_profile(struct unixctl_conn *conn, int argc,
+                    const char *argv[], void *arg OVS_UNUSED)
+{
+    bool as_json = false;
+    const char *node_name = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) {
+            as_json = true;
+        } else if (!node_name) {
+            node_name = argv[i];
+        } else {
+            unixctl_command_reply_error(conn, "too many arguments");
+            return;
+        }
+    }
+
+    struct json *json = as_json ? json_object_create() : NULL;
+    struct ds dump = DS_EMPTY_INITIALIZER;
+    bool found = false;
+
+    for (size_t i = 0; i < engine_n_nodes; i++) {
+        const struct engine_node *node = engine_nodes[i];
+
+        if (node_name && strcmp(node->name, node_name)) {
+            continue;
+        }
+
+        found = true;
+        if (json) {
+            json_object_put(json, node->name, engine_profile_to_json(node));
+        } else {
+            engine_format_profile(&dump, node);
+        }
+    }
+
+    if (node_name && !found) {
+        unixctl_command_reply_error(conn, "unknown node");
+    } else if (json) {
+        char *reply = json_to_string(json, JSSF_SORT);
+
+        unixctl_command_reply(conn, reply);
+        free(reply);
+    } else {
+        unixctl_command_reply(conn, ds_cstr(&dump));
+    }
+
+    json_destroy(json);
+    ds_destroy(&dump);
+}
+
 static void
 engine_dump_stats(struct unixctl_conn *conn, int argc,
                   const char *argv[], void *arg OVS_UNUSED)
@@ -195,10 +568,266 @@ engine_set_log_timeout_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
     unixctl_command_reply(conn, NULL);
 }
 
+static size_t
+engine_node_index(const struct engine_node *node, size_t n_count)
+{
+    for (size_t i = 0; i < n_count; i++) {
+        if (engine_nodes[i] == node) {
+            return i;
+        }
+    }
+    OVS_NOT_REACHED();
+    return SIZE_MAX;
+}
+
+static void
+engine_init_outputs(void)
+{
+    engine_outputs = xcalloc(engine_n_nodes, sizeof *engine_outputs);
+
+    for (size_t i = 0; i < engine_n_nodes; i++) {
+        struct engine_node *node = engine_nodes[i];
+
+        for (size_t j = 0; j < node->n_inputs; j++) {
+            /* Inputs are always sorted before the node. */
+            size_t input_idx = engine_node_index(node->inputs[j].node, i);
+            struct engine_node_outputs *outputs = &engine_outputs[input_idx];
+
+            if (outputs->n == outputs->allocated) {
+                outputs->idx = x2nrealloc(outputs->idx, &outputs->allocated,
+                                          sizeof *outputs->idx);
+            }
+            outputs->idx[outputs->n++] = i;
+        }
+    }
+}
+
+static void
+engine_trace_enable_cmd(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *arg OVS_UNUSED)
+{
+    unsigned int size = ENGINE_TRACE_DEFAULT_SIZE;
+
+    if (argc > 1 && (!str_to_uint(argv[1], 10, &size) || !size)) {
+        unixctl_command_reply_error(conn, "positive integer required");
+        return;
+    }
+
+    ovs_mutex_lock(&engine_trace_mutex);
+    free(engine_trace.events);
+    engine_trace.events = xcalloc(size, sizeof *engine_trace.events);
+    engine_trace.size = size;
+    engine_trace.head = 0;
+    engine_trace.n = 0;
+    ovs_mutex_unlock(&engine_trace_mutex);
+
+    engine_trace_enabled = true;
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+engine_trace_disable_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    engine_trace_enabled = false;
+
+    ovs_mutex_lock(&engine_trace_mutex);
+    free(engine_trace.events);
+    memset(&engine_trace, 0, sizeof engine_trace);
+    ovs_mutex_unlock(&engine_trace_mutex);
+
+    unixctl_command_reply(conn, NULL);
+}
+
+static struct json *
+engine_trace_event_to_json(const struct engine_trace_event *ev, pid_t pid)
+{
+    struct json *json = json_object_create();
+    struct json *args = json_object_create();
+
+    json_object_put_string(json, "name", ev->input ? ev->input : ev->name);
+    json_object_put_string(json, "cat", ev->cat);
+    json_object_put_string(json, "ph", "X");
+    json_object_put(json, "ts", json_integer_create(ev->start_usec));
+    json_object_put(json, "dur", json_integer_create(ev->dur_usec));
+    json_object_put(json, "pid", json_integer_create(pid));
+    json_object_put(json, "tid", json_integer_create(ev->tid));
+
+    json_object_put_string(args, "node", ev->name);
+    if (ev->input) {
+        json_object_put_string(args, "input", ev->input);
+    }
+    if (ev->result) {
+        json_object_put_string(args, "result", ev->result);
+    }
+    if (ev->reason[0]) {
+        json_object_put_string(args, "reason", ev->reason);
+    }
+    json_object_put(json, "args", args);
+
+    return json;
+}
+
+/* Replies with the events in the trace buffer, oldest first, in the Chrome
+ * trace event JSON format.  Handler events are named after the input they
+ * handle, the other ones after their node. */
+static void
+engine_trace_dump_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                      const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    struct json *events = json_array_create_empty();
+    pid_t pid = getpid();
+
+    ovs_mutex_lock(&engine_trace_mutex);
+    if (!engine_trace.events) {
+        ovs_mutex_unlock(&engine_trace_mutex);
+        json_destroy(events);
+        unixctl_command_reply_error(conn, "tracing is not enabled");
+        return;
+    }
+
+    size_t first = (engine_trace.head + engine_trace.size - engine_trace.n)
+                   % engine_trace.size;
+    for (size_t i = 0; i < engine_trace.n; i++) {
+        const struct engine_trace_event *ev =
+            &engine_trace.events[(first + i) % engine_trace.size];
+
+        json_array_add(events, engine_trace_event_to_json(ev, pid));
+    }
+    ovs_mutex_unlock(&engine_trace_mutex);
+
+    struct json *trace = json_object_create();
+    json_object_put(trace, "traceEvents", events);
+    json_object_put_string(trace, "displayTimeUnit", "ms");
+
+    char *reply = json_to_string(trace, JSSF_SORT);
+    unixctl_command_reply(conn, reply);
+    free(reply);
+    json_destroy(trace);
+}
+
+static void
+engine_recompute_causes_enable_cmd(struct unixctl_conn *conn,
+                                   int argc OVS_UNUSED,
+                                   const char *argv[] OVS_UNUSED,
+                                   void *arg OVS_UNUSED)
+{
+    ovs_mutex_lock(&engine_recompute_causes_mutex);
+    engine_recompute_causes_clear();
+    ovs_mutex_unlock(&engine_recompute_causes_mutex);
+
+    engine_recompute_causes_enabled = true;
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+engine_recompute_causes_disable_cmd(struct unixctl_conn *conn,
+                                    int argc OVS_UNUSED,
+                                    const char *argv[] OVS_UNUSED,
+                                    void *arg OVS_UNUSED)
+{
+    engine_recompute_causes_enabled = false;
+
+    ovs_mutex_lock(&engine_recompute_causes_mutex);
+    engine_recompute_causes_clear();
+    ovs_mutex_unlock(&engine_recompute_causes_mutex);
+
+    unixctl_command_reply(conn, NULL);
+}
+
+static int
+engine_recompute_cause_cmp(const void *a_, const void *b_)
+{
+    const struct engine_recompute_cause *const *ap = a_;
+    const struct engine_recompute_cause *const *bp = b_;
+    const struct engine_recompute_cause *a = *ap;
+    const struct engine_recompute_cause *b = *bp;
+
+    if (a->total_usec != b->total_usec) {
+        return a->total_usec > b->total_usec ? -1 : 1;
+    }
+    int cmp = strcmp(a->node, b->node);
+    if (!cmp) {
+        cmp = strcmp(a->reason, b->reason);
+    }
+    return cmp ? cmp : strcmp(a->changes, b->changes);
+}
+
+/* Replies with the recompute causes recorded since they were enabled, the
+ * most expensive first. */
+static void
+engine_recompute_causes_show_cmd(struct unixctl_conn *conn, int argc,
+                                 const char *argv[], void *arg OVS_UNUSED)
+{
+    bool as_json = argc > 1 && !strcmp(argv[1], "--json");
+
+    if (argc > 1 && !as_json) {
+        unixctl_command_reply_error(conn, "unknown option");
+        return;
+    }
+    if (!engine_recompute_causes_enabled) {
+        unixctl_command_reply_error(conn,
+                                    "recompute causes are not enabled");
+        return;
+    }
+
+    ovs_mutex_lock(&engine_recompute_causes_mutex);
+    size_t n = hmap_count(&engine_recompute_causes);
+    struct engine_recompute_cause **causes = xmalloc(n * sizeof *causes);
+    struct engine_recompute_cause *cause;
+    size_t i = 0;
+    HMAP_FOR_EACH (cause, hmap_node, &engine_recompute_causes) {
+        causes[i++] = cause;
+    }
+    qsort(causes, n, sizeof *causes, engine_recompute_cause_cmp);
+
+    struct json *json = as_json ? json_array_create_empty() : NULL;
+    struct ds reply = DS_EMPTY_INITIALIZER;
+    for (i = 0; i < n; i++) {
+        cause = causes[i];
+        if (json) {
+            struct json *cause_json = json_object_create();
+
+            json_object_put_string(cause_json, "node", cause->node);
+            json_object_put_string(cause_json, "reason", cause->reason);
+            json_object_put_string(cause_json, "changes", cause->changes);
+            json_object_put(cause_json, "count",
+                            json_integer_create(cause->count));
+            json_object_put(cause_json, "total_usec",
+                            json_integer_create(cause->total_usec));
+            json_object_put(cause_json, "max_usec",
+                            json_integer_create(cause->max_usec));
+            json_array_add(json, cause_json);
+        } else {
+            ds_put_format(&reply, "Node: %s\n"
+                          "- reason: %s\n"
+                          "- changes: %s\n"
+                          "- recomputes: %"PRIu64", total %"PRIu64"us, "
+                          "max %"PRIu64"us\n",
+                          cause->node, cause->reason,
+                          cause->changes[0] ? cause->changes : "none",
+                          cause->count, cause->total_usec, cause->max_usec);
+        }
+    }
+    ovs_mutex_unlock(&engine_recompute_causes_mutex);
+    free(causes);
+
+    if (json) {
+        char *s = json_to_string(json, JSSF_SORT);
+        unixctl_command_reply(conn, s);
+        free(s);
+        json_destroy(json);
+    } else {
+        unixctl_command_reply(conn, ds_cstr(&reply));
+    }
+    ds_destroy(&reply);
+}
+
 void
 engine_init(struct engine_node *node, struct engine_arg *arg)
 {
     engine_nodes = engine_get_nodes(node, &engine_n_nodes);
+    engine_init_outputs();
 
     for (size_t i = 0; i < engine_n_nodes; i++) {
         if (engine_nodes[i]->init) {
@@ -213,10 +842,25 @@ engine_init(struct engine_node *node, struct engine_arg *arg)
                              engine_dump_stats, NULL);
     unixctl_command_register("inc-engine/clear-stats", "", 0, 0,
                              engine_clear_stats, NULL);
+    unixctl_command_register("inc-engine/show-profile", "[--json] [NODE]",
+                             0, 2, engine_dump_profile, NULL);
     unixctl_command_register("inc-engine/recompute", "", 0, 0,
                              engine_trigger_recompute_cmd, NULL);
     unixctl_command_register("inc-engine/compute-log-timeout", "", 1, 1,
                              engine_set_log_timeout_cmd, NULL);
+    unixctl_command_register("inc-engine/trace-enable", "[N_EVENTS]", 0, 1,
+                             engine_trace_enable_cmd, NULL);
+    unixctl_command_register("inc-engine/trace-disable", "", 0, 0,
+                             engine_trace_disable_cmd, NULL);
+    unixctl_command_register("inc-engine/trace-dump", "", 0, 0,
+                             engine_trace_dump_cmd, NULL);
+    unixctl_command_register("inc-engine/recompute-causes-enable", "", 0, 0,
+                             engine_recompute_causes_enable_cmd, NULL);
+    unixctl_command_register("inc-engine/recompute-causes-disable", "", 0, 0,
+                             engine_recompute_causes_disable_cmd, NULL);
+    unixctl_command_register("inc-engine/recompute-causes-show", "[--json]",
+                             0, 1, engine_recompute_causes_show_cmd, NULL);
+    ovn_profiler_init();
 }
 
 void
@@ -231,12 +875,60 @@ engine_cleanup(void)
             engine_nodes[i]->cleanup(engine_nodes[i]->data);
         }
         free(engine_nodes[i]->data);
+        free(engine_outputs[i].idx);
     }
+    free(engine_outputs);
+    engine_outputs = NULL;
+
+    /* The recompute causes point to the names of the nodes. */
+    engine_recompute_causes_enabled = false;
+    ovs_mutex_lock(&engine_recompute_causes_mutex);
+    engine_recompute_causes_clear();
+    ovs_mutex_unlock(&engine_recompute_causes_mutex);
+
     free(engine_nodes);
     engine_nodes = NULL;
     engine_n_nodes = 0;
 }
 
+void
+engine_set_node_thread_safe(struct engine_node *node)
+{
+    node->thread_safe = true;
+}
+
+void
+engine_set_node_memory_usage(
+    struct engine_node *node,
+    void (*get_memory_usage)(const void *data, struct simap *usage))
+{
+    node->get_memory_usage = get_memory_usage;
+}
+
+void
+engine_get_memory_usage(struct simap *usage)
+{
+    for (size_t i = 0; i < engine_n_nodes; i++) {
+        const struct engine_node *node = engine_nodes[i];
+
+        if (node->get_memory_usage && node->data) {
+            node->get_memory_usage(node->data, usage);
+        }
+    }
+}
+
+void
+engine_set_worker_pool(struct worker_pool *pool)
+{
+    engine_pool = pool;
+}
+
+bool
+engine_worker_pool_is_busy(void)
+{
+    return engine_pool_busy;
+}
+
 struct engine_node *
 engine_get_input(const char *input_name, struct engine_node *node)
 {
@@ -356,6 +1048,35 @@ engine_canceled(void)
     return engine_run_canceled;
 }
 
+void
+engine_set_time_budget(unsigned int msec)
+{
+    engine_time_budget_msec = msec;
+}
+
+bool
+engine_over_budget(void)
+{
+    return engine_run_deadline != LLONG_MAX
+           && time_msec() >= engine_run_deadline;
+}
+
+void
+engine_yield(void)
+{
+    if (!engine_run_yielded) {
+        COVERAGE_INC(engine_yield);
+        engine_run_yielded = true;
+    }
+    poll_immediate_wake();
+}
+
+bool
+engine_yielded(void)
+{
+    return engine_run_yielded;
+}
+
 void *
 engine_get_data(struct engine_node *node)
 {
@@ -377,6 +1098,7 @@ engine_init_run(void)
     VLOG_DBG("Initializing new run");
     for (size_t i = 0; i < engine_n_nodes; i++) {
         engine_set_node_state(engine_nodes[i], EN_STALE);
+        engine_nodes[i]->n_changes = 0;
 
         if (engine_nodes[i]->clear_tracked_data) {
             engine_nodes[i]->clear_tracked_data(engine_nodes[i]->data);
@@ -401,6 +1123,10 @@ engine_recompute(struct engine_node *node, bool allowed,
     if (!allowed) {
         VLOG_DBG("node: %s, recompute (%s) canceled", node->name, reason);
         engine_set_node_state(node, EN_CANCELED);
+        if (OVS_UNLIKELY(engine_trace_enabled)) {
+            engine_trace_add("recompute", node->name, NULL, "canceled",
+                             reason, time_usec());
+        }
         goto done;
     }
 
@@ -411,10 +1137,21 @@ engine_recompute(struct engine_node *node, bool allowed,
     }
 
     /* Run the node handler which might change state. */
-    long long int now = time_msec();
+    long long int now = time_usec();
     node->run(node, node->data);
     node->stats.recompute++;
-    long long int delta_time = time_msec() - now;
+    long long int delta_usec = time_usec() - now;
+    long long int delta_time = delta_usec / 1000;
+    OVS_USDT_PROBE(engine_recompute, recompute, node->name, reason,
+                   delta_usec);
+    engine_latency_add(&node->stats.recompute_latency, delta_usec);
+    if (OVS_UNLIKELY(engine_trace_enabled)) {
+        engine_trace_add("recompute", node->name, NULL,
+                         engine_node_state_name[node->state], reason, now);
+    }
+    if (OVS_UNLIKELY(engine_recompute_causes_enabled)) {
+        engine_recompute_causes_add(node, reason, delta_usec);
+    }
     if (delta_time > engine_compute_log_timeout_msec) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(20, 10);
         VLOG_INFO_RL(&rl, "node: %s, recompute (%s) took %lldms", node->name,
@@ -437,9 +1174,25 @@ engine_compute(struct engine_node *node, bool recompute_allowed)
             /* If the input change can't be handled incrementally, run
              * the node handler.
              */
-            long long int now = time_msec();
-            bool handled = node->inputs[i].change_handler(node, node->data);
-            long long int delta_time = time_msec() - now;
+            struct engine_node_input *input = &node->inputs[i];
+            long long int now = time_usec();
+            bool handled = input->change_handler(node, node->data);
+            long long int delta_usec = time_usec() - now;
+            long long int delta_time = delta_usec / 1000;
+
+            OVS_USDT_PROBE(engine_compute, handler, node->name,
+                           input->node->name, handled, delta_usec);
+            engine_latency_add(&node->stats.compute_latency, delta_usec);
+            if (OVS_UNLIKELY(engine_trace_enabled)) {
+                engine_trace_add("handler", node->name, input->node->name,
+                                 handled ? "handled" : "failed", NULL, now);
+            }
+            if (handled) {
+                input->stats.handled++;
+                input->stats.changes += input->node->n_changes;
+            } else {
+                input->stats.failed++;
+            }
             if (delta_time > engine_compute_log_timeout_msec) {
                 static struct vlog_rate_limit rl =
                     VLOG_RATE_LIMIT_INIT(20, 10);
@@ -464,7 +1217,7 @@ engine_compute(struct engine_node *node, bool recompute_allowed)
 }
 
 static void
-engine_run_node(struct engine_node *node, bool recompute_allowed)
+engine_run_node__(struct engine_node *node, bool recompute_allowed)
 {
     if (!node->n_inputs) {
         /* Run the node handler which might change state. */
@@ -474,6 +1227,7 @@ engine_run_node(struct engine_node *node, bool recompute_allowed)
     }
 
     if (engine_force_recompute) {
+        node->stats.forced++;
         engine_recompute(node, recompute_allowed, "forced");
         return;
     }
@@ -488,6 +1242,7 @@ engine_run_node(struct engine_node *node, bool recompute_allowed)
 
             /* Trigger a recompute if we don't have a change handler. */
             if (!node->inputs[i].change_handler) {
+                node->inputs[i].stats.missing++;
                 engine_recompute(node, recompute_allowed,
                                  "missing handler for input %s",
                                  node->inputs[i].node->name);
@@ -513,6 +1268,142 @@ engine_run_node(struct engine_node *node, bool recompute_allowed)
     }
 }
 
+static void
+engine_run_node(struct engine_node *node, bool recompute_allowed)
+{
+    long long int start = engine_trace_start();
+
+    OVS_USDT_PROBE(engine_run_node, node_start, node->name);
+    ovn_profiler_set_tag(node->name);
+    engine_run_node__(node, recompute_allowed);
+    ovn_profiler_set_tag(NULL);
+    OVS_USDT_PROBE(engine_run_node, node_end, node->name, node->state);
+    if (OVS_UNLIKELY(engine_trace_enabled)) {
+        engine_trace_add("node", node->name, NULL,
+                         engine_node_state_name[node->state], NULL, start);
+    }
+}
+
+/* A set of thread safe nodes that are ready to run, shared by the workers
+ * of 'engine_pool'. */
+struct engine_parallel_batch {
+    struct engine_node **nodes;
+    size_t n_nodes;
+    atomic_count next;          /* Next node in 'nodes' to be picked up. */
+    bool recompute_allowed;
+};
+
+static void
+engine_run_parallel_batch(struct worker_control *control OVS_UNUSED,
+                          void *aux)
+{
+    struct engine_parallel_batch *batch = aux;
+
+    for (;;) {
+        size_t i = atomic_count_inc(&batch->next);
+
+        if (i >= batch->n_nodes) {
+            break;
+        }
+        engine_run_node(batch->nodes[i], batch->recompute_allowed);
+    }
+}
+
+static int
+compare_size_t(const void *a_, const void *b_)
+{
+    const size_t *a = a_;
+    const size_t *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+/* Runs the engine nodes as soon as all their inputs have been processed,
+ * in steps.  At each step the ready thread safe nodes are spread over the
+ * workers of 'engine_pool', then the other ready nodes are run by the
+ * current thread in topological order. */
+static void
+engine_run_parallel(bool recompute_allowed)
+{
+    size_t *n_waiting = xmalloc(engine_n_nodes * sizeof *n_waiting);
+    size_t *ready = xmalloc(engine_n_nodes * sizeof *ready);
+    size_t *next_ready = xmalloc(engine_n_nodes * sizeof *next_ready);
+    struct engine_node **batch_nodes =
+        xmalloc(engine_n_nodes * sizeof *batch_nodes);
+    size_t n_ready = 0;
+
+    for (size_t i = 0; i < engine_n_nodes; i++) {
+        n_waiting[i] = engine_nodes[i]->n_inputs;
+        if (!n_waiting[i]) {
+            ready[n_ready++] = i;
+        }
+    }
+
+    while (n_ready) {
+        size_t n_batch = 0;
+
+        for (size_t i = 0; i < n_ready; i++) {
+            if (engine_nodes[ready[i]]->thread_safe) {
+                batch_nodes[n_batch++] = engine_nodes[ready[i]];
+            }
+        }
+
+        if (n_batch > 1) {
+            struct engine_parallel_batch batch = {
+                .nodes = batch_nodes,
+                .n_nodes = n_batch,
+                .recompute_allowed = recompute_allowed,
+            };
+
+            atomic_count_init(&batch.next, 0);
+            engine_pool_busy = true;
+            run_pool_task(engine_pool, engine_run_parallel_batch, &batch);
+            engine_pool_busy = false;
+        } else if (n_batch) {
+            engine_run_node(batch_nodes[0], recompute_allowed);
+        }
+
+        for (size_t i = 0; i < n_ready; i++) {
+            struct engine_node *node = engine_nodes[ready[i]];
+
+            if (!node->thread_safe && !engine_run_canceled) {
+                engine_run_node(node, recompute_allowed);
+            }
+            if (node->state == EN_CANCELED) {
+                node->stats.cancel++;
+                engine_run_canceled = true;
+            }
+        }
+
+        if (engine_run_canceled) {
+            break;
+        }
+
+        size_t n_next_ready = 0;
+        for (size_t i = 0; i < n_ready; i++) {
+            const struct engine_node_outputs *outputs =
+                &engine_outputs[ready[i]];
+
+            for (size_t j = 0; j < outputs->n; j++) {
+                if (!--n_waiting[outputs->idx[j]]) {
+                    next_ready[n_next_ready++] = outputs->idx[j];
+                }
+            }
+        }
+        qsort(next_ready, n_next_ready, sizeof *next_ready, compare_size_t);
+
+        size_t *tmp = ready;
+        ready = next_ready;
+        next_ready = tmp;
+        n_ready = n_next_ready;
+    }
+
+    free(batch_nodes);
+    free(next_ready);
+    free(ready);
+    free(n_waiting);
+}
+
 void
 engine_run(bool recompute_allowed)
 {
@@ -523,16 +1414,33 @@ engine_run(bool recompute_allowed)
         return;
     }
 
+    long long int start = engine_trace_start();
+
     engine_run_canceled = false;
-    for (size_t i = 0; i < engine_n_nodes; i++) {
-        engine_run_node(engine_nodes[i], recompute_allowed);
+    engine_run_yielded = false;
+    engine_run_deadline = (engine_time_budget_msec
+                           ? time_msec() + engine_time_budget_msec
+                           : LLONG_MAX);
+    if (engine_pool) {
+        engine_run_parallel(recompute_allowed);
+    } else {
+        for (size_t i = 0; i < engine_n_nodes; i++) {
+            engine_run_node(engine_nodes[i], recompute_allowed);
 
-        if (engine_nodes[i]->state == EN_CANCELED) {
-            engine_nodes[i]->stats.cancel++;
-            engine_run_canceled = true;
-            return;
+            if (engine_nodes[i]->state == EN_CANCELED) {
+                engine_nodes[i]->stats.cancel++;
+                engine_run_canceled = true;
+                break;
+            }
         }
     }
+
+    if (OVS_UNLIKELY(engine_trace_enabled)) {
+        engine_trace_add("engine", "engine_run", NULL,
+                         engine_run_canceled ? "canceled" : "completed",
+                         recompute_allowed ? NULL : "recompute not allowed",
+                         start);
+    }
 }
 
 bool
@@ -166,9 +166,24 @@ struct engine_arg {
     struct ovsdb_idl *sb_idl;
     struct ovsdb_idl *nb_idl;
     struct ovsdb_idl *ovs_idl;
+    struct ovsdb_idl *vtep_idl;
+    struct ovsdb_idl *icnb_idl;
+    struct ovsdb_idl *icsb_idl;
 };
 
 struct engine_node;
+struct simap;
+struct worker_pool;
+
+/* Number of times the change handler of an input was invoked, and with what
+ * outcome. */
+struct engine_input_stats {
+    uint64_t handled;   /* Handler returned true. */
+    uint64_t failed;    /* Handler returned false, the node recomputed. */
+    uint64_t missing;   /* No handler, the node recomputed. */
+    uint64_t changes;   /* Tracked changes of the input that were handled
+                         * incrementally, for inputs that report them. */
+};
 
 struct engine_node_input {
     /* The input node. */
@@ -184,6 +199,9 @@ struct engine_node_input {
      * and the pointers are NULL, the change handler MUST return false.
      */
     bool (*change_handler)(struct engine_node *node, void *data);
+
+    /* Handler statistics. */
+    struct engine_input_stats stats;
 };
 
 enum engine_node_state {
@@ -200,10 +218,26 @@ enum engine_node_state {
     EN_STATE_MAX,
 };
 
+/* Latency histogram.  Bucket 0 counts the runs that took less than 1us and
+ * bucket 'i' the ones that took [2^(i - 1), 2^i) us.  The last bucket also
+ * counts anything longer. */
+#define ENGINE_LATENCY_N_BUCKETS 32
+
+struct engine_latency {
+    uint64_t buckets[ENGINE_LATENCY_N_BUCKETS];
+    uint64_t count;
+    uint64_t total_usec;
+    uint64_t max_usec;
+};
+
 struct engine_stats {
     uint64_t recompute;
     uint64_t compute;
     uint64_t cancel;
+    uint64_t forced;    /* Recomputes forced by the user or the engine. */
+
+    struct engine_latency recompute_latency;  /* Of run(). */
+    struct engine_latency compute_latency;    /* Of each change handler. */
 };
 
 struct engine_node {
@@ -254,8 +288,28 @@ struct engine_node {
      * engine 'data'. It may be NULL. */
     void (*clear_tracked_data)(void *tracked_data);
 
+    /* Method to report the memory used by the node's data, by adding to
+     * 'usage' the number of elements of its main data structures, named
+     * after the node, e.g. "<node>-<elements>".  It may be NULL.  It's
+     * called outside of the engine runs, so it must not access the DB
+     * records that the data may refer to.  See engine_get_memory_usage(). */
+    void (*get_memory_usage)(const void *data, struct simap *usage);
+
     /* Engine stats. */
     struct engine_stats stats;
+
+    /* Number of tracked changes of the data of this node during the last
+     * run, if the node reports them (e.g., OVSDB table nodes report their
+     * tracked rows).  Accounted in the input stats of the nodes that handle
+     * them incrementally. */
+    size_t n_changes;
+
+    /* True if run() and all the change handlers of this node may be executed
+     * by a worker thread, concurrently with other thread safe nodes.  Such a
+     * node must only read its inputs and update its own data: no OVSDB
+     * transaction writes, no poll loop calls and no unprotected global
+     * state.  See engine_set_worker_pool(). */
+    bool thread_safe;
 };
 
 /* Initialize the data for the engine nodes. It calls each node's
@@ -280,6 +334,35 @@ void engine_run(bool recompute_allowed);
  * terminates. */
 void engine_cleanup(void);
 
+/* Marks 'node' as safe to be executed by a worker thread.  It should be
+ * called before the first engine_run(). */
+void engine_set_node_thread_safe(struct engine_node *node);
+
+/* Sets the method that reports the memory used by the data of 'node'.
+ * It should be called before the first engine_run(). */
+void engine_set_node_memory_usage(
+    struct engine_node *node,
+    void (*get_memory_usage)(const void *data, struct simap *usage));
+
+/* Adds to 'usage' the memory used by the data of all the engine nodes that
+ * report it, e.g. for memory_report(). */
+void engine_get_memory_usage(struct simap *usage);
+
+/* Makes engine_run() execute the thread safe nodes whose inputs are all up
+ * to date in parallel, using the workers of 'pool', which must have been
+ * created with ovn_worker_task_thread().  The rest of the nodes are still
+ * executed by the calling thread, after the parallel ones that became ready
+ * at the same time.  A NULL 'pool' restores the sequential execution.
+ *
+ * The pool can be shared with other users, including the nodes themselves,
+ * as long as they check engine_worker_pool_is_busy() first. */
+void engine_set_worker_pool(struct worker_pool *pool);
+
+/* Returns true while the engine is running nodes on its worker pool.  The
+ * nodes that run at that time, possibly from one of the workers, must not
+ * submit any task to the pool. */
+bool engine_worker_pool_is_busy(void);
+
 /* Check if engine needs to run but didn't. */
 bool engine_need_run(void);
 
@@ -330,6 +413,26 @@ bool engine_has_updated(void);
 /* Returns true if during the last engine run we had to cancel processing. */
 bool engine_canceled(void);
 
+/* Time budget of engine runs.
+ *
+ * A change handler that processes a large batch of changes, e.g. thousands
+ * of port claims, may check engine_over_budget() and, once it returns true,
+ * leave the rest of the batch for the next run, provided that it preserves
+ * it somewhere that triggers the next run, typically the data of an input
+ * node, as IDL tracked changes don't survive the current run.  It must then
+ * call engine_yield(), which wakes up the main loop right away, so that
+ * pinctrl, BFD and the OpenFlow connection get served in between.
+ *
+ * The budget is in msec, counted from the start of engine_run(), 0 for no
+ * limit, the default. */
+void engine_set_time_budget(unsigned int msec);
+bool engine_over_budget(void);
+void engine_yield(void);
+
+/* Returns true if some change handler left changes to process for the next
+ * run during the last engine run. */
+bool engine_yielded(void);
+
 /* Return a pointer to node data accessible for users outside the processing
  * engine. If the node data is not valid (e.g., last engine_run() failed or
  * didn't happen), the node's is_valid() method is used to determine if the
@@ -419,7 +522,13 @@ en_##DB_NAME##_##TBL_NAME##_run(struct engine_node *node, \
 { \
     const struct DB_NAME##rec_##TBL_NAME##_table *table = \
         EN_OVSDB_GET(node); \
-    if (DB_NAME##rec_##TBL_NAME##_table_track_get_first(table)) { \
+    const struct DB_NAME##rec_##TBL_NAME *row; \
+    node->n_changes = 0; \
+    for (row = DB_NAME##rec_##TBL_NAME##_table_track_get_first(table); \
+         row; row = DB_NAME##rec_##TBL_NAME##_track_get_next(row)) { \
+        node->n_changes++; \
+    } \
+    if (node->n_changes) { \
         engine_set_node_state(node, EN_UPDATED); \
         return; \
     } \
@@ -453,6 +562,21 @@ static void en_##DB_NAME##_##TBL_NAME##_cleanup(void *data OVS_UNUSED) \
 #define ENGINE_FUNC_OVS(TBL_NAME) \
     ENGINE_FUNC_OVSDB(ovs, TBL_NAME)
 
+/* Macro to define member functions of an engine node which represents
+ * a table of hardware_vtep DB */
+#define ENGINE_FUNC_VTEP(TBL_NAME) \
+    ENGINE_FUNC_OVSDB(vtep, TBL_NAME)
+
+/* Macro to define member functions of an engine node which represents
+ * a table of OVN IC NB DB */
+#define ENGINE_FUNC_ICNB(TBL_NAME) \
+    ENGINE_FUNC_OVSDB(icnb, TBL_NAME)
+
+/* Macro to define member functions of an engine node which represents
+ * a table of OVN IC SB DB */
+#define ENGINE_FUNC_ICSB(TBL_NAME) \
+    ENGINE_FUNC_OVSDB(icsb, TBL_NAME)
+
 /* Macro to define an engine node which represents a table of OVSDB */
 #define ENGINE_NODE_OVSDB(DB_NAME, DB_NAME_STR, TBL_NAME, TBL_NAME_STR) \
     ENGINE_NODE(DB_NAME##_##TBL_NAME, DB_NAME_STR"_"TBL_NAME_STR)
@@ -470,4 +594,17 @@ static void en_##DB_NAME##_##TBL_NAME##_cleanup(void *data OVS_UNUSED) \
 #define ENGINE_NODE_OVS(TBL_NAME, TBL_NAME_STR) \
     ENGINE_NODE_OVSDB(ovs, "OVS", TBL_NAME, TBL_NAME_STR);
 
+/* Macro to define an engine node which represents a table of hardware_vtep
+ * DB */
+#define ENGINE_NODE_VTEP(TBL_NAME, TBL_NAME_STR) \
+    ENGINE_NODE_OVSDB(vtep, "VTEP", TBL_NAME, TBL_NAME_STR);
+
+/* Macro to define an engine node which represents a table of OVN IC NB DB */
+#define ENGINE_NODE_ICNB(TBL_NAME, TBL_NAME_STR) \
+    ENGINE_NODE_OVSDB(icnb, "ICNB", TBL_NAME, TBL_NAME_STR);
+
+/* Macro to define an engine node which represents a table of OVN IC SB DB */
+#define ENGINE_NODE_ICSB(TBL_NAME, TBL_NAME_STR) \
+    ENGINE_NODE_OVSDB(icsb, "ICSB", TBL_NAME, TBL_NAME_STR);
+
 #endif /* lib/inc-proc-eng.h */
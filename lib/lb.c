@@ -20,6 +20,8 @@
 #include "ovn/lex.h"
 
 /* OpenvSwitch lib includes. */
+#include "hash.h"
+#include "openvswitch/hmap.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(lb);
@@ -284,6 +286,25 @@ ovn_lb_backends_clear(struct ovn_lb_vip *vip)
     vip->n_backends = 0;
 }
 
+/* Initializes 'dst' as a copy of 'src'.  The caller is responsible for
+ * destroying 'dst'. */
+void
+ovn_lb_vip_clone(struct ovn_lb_vip *dst, const struct ovn_lb_vip *src)
+{
+    *dst = *src;
+    dst->vip_str = nullable_xstrdup(src->vip_str);
+    dst->port_str = nullable_xstrdup(src->port_str);
+    dst->backends = (src->n_backends
+                     ? xmemdup(src->backends,
+                               src->n_backends * sizeof *src->backends)
+                     : NULL);
+    for (size_t i = 0; i < src->n_backends; i++) {
+        dst->backends[i].ip_str = nullable_xstrdup(src->backends[i].ip_str);
+        dst->backends[i].port_str =
+            nullable_xstrdup(src->backends[i].port_str);
+    }
+}
+
 void
 ovn_lb_vip_destroy(struct ovn_lb_vip *vip)
 {
@@ -293,6 +314,119 @@ ovn_lb_vip_destroy(struct ovn_lb_vip *vip)
     free(vip->backends);
 }
 
+/* Caching parsed VIPs. */
+
+/* Above this number of entries, new VIPs are not cached until the next
+ * sweep. */
+#define OVN_LB_VIP_CACHE_MAX_ENTRIES 262144
+
+struct ovn_lb_vip_cache_entry {
+    struct hmap_node hmap_node;
+    char *key;
+    char *value;
+    bool template;
+    int address_family;
+    unsigned int generation;    /* Generation of the last lookup. */
+    struct ovn_lb_vip vip;
+};
+
+struct ovn_lb_vip_cache {
+    struct hmap entries;
+    unsigned int generation;
+};
+
+struct ovn_lb_vip_cache *
+ovn_lb_vip_cache_create(void)
+{
+    struct ovn_lb_vip_cache *cache = xmalloc(sizeof *cache);
+
+    hmap_init(&cache->entries);
+    cache->generation = 0;
+    return cache;
+}
+
+static void
+ovn_lb_vip_cache_entry_destroy(struct ovn_lb_vip_cache_entry *e)
+{
+    ovn_lb_vip_destroy(&e->vip);
+    free(e->key);
+    free(e->value);
+    free(e);
+}
+
+void
+ovn_lb_vip_cache_destroy(struct ovn_lb_vip_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    struct ovn_lb_vip_cache_entry *e;
+    HMAP_FOR_EACH_POP (e, hmap_node, &cache->entries) {
+        ovn_lb_vip_cache_entry_destroy(e);
+    }
+    hmap_destroy(&cache->entries);
+    free(cache);
+}
+
+void
+ovn_lb_vip_cache_sweep(struct ovn_lb_vip_cache *cache)
+{
+    struct ovn_lb_vip_cache_entry *e;
+
+    HMAP_FOR_EACH_SAFE (e, hmap_node, &cache->entries) {
+        if (e->generation != cache->generation) {
+            hmap_remove(&cache->entries, &e->hmap_node);
+            ovn_lb_vip_cache_entry_destroy(e);
+        }
+    }
+    cache->generation++;
+}
+
+/* Like ovn_lb_vip_init(), but looks 'lb_key' and 'lb_value' up in 'cache'
+ * first, and caches the result if the VIP is valid.  'cache' may be NULL. */
+char *
+ovn_lb_vip_init_cached(struct ovn_lb_vip_cache *cache,
+                       struct ovn_lb_vip *lb_vip, const char *lb_key,
+                       const char *lb_value, bool template,
+                       int address_family)
+{
+    if (!cache) {
+        return ovn_lb_vip_init(lb_vip, lb_key, lb_value, template,
+                               address_family);
+    }
+
+    uint32_t hash = hash_string(lb_key, hash_string(lb_value, 0));
+    hash = hash_2words(hash, (template << 16) | address_family);
+
+    struct ovn_lb_vip_cache_entry *e;
+    HMAP_FOR_EACH_WITH_HASH (e, hmap_node, hash, &cache->entries) {
+        if (e->template == template && e->address_family == address_family
+            && !strcmp(e->key, lb_key) && !strcmp(e->value, lb_value)) {
+            e->generation = cache->generation;
+            ovn_lb_vip_clone(lb_vip, &e->vip);
+            return NULL;
+        }
+    }
+
+    char *error = ovn_lb_vip_init(lb_vip, lb_key, lb_value, template,
+                                  address_family);
+    if (error
+        || hmap_count(&cache->entries) >= OVN_LB_VIP_CACHE_MAX_ENTRIES) {
+        return error;
+    }
+
+    e = xmalloc(sizeof *e);
+    e->key = xstrdup(lb_key);
+    e->value = xstrdup(lb_value);
+    e->template = template;
+    e->address_family = address_family;
+    e->generation = cache->generation;
+    ovn_lb_vip_clone(&e->vip, lb_vip);
+    hmap_insert(&cache->entries, &e->hmap_node, hash);
+    return NULL;
+}
+
 static void
 ovn_lb_vip_format__(const struct ovn_lb_vip *vip, struct ds *s,
                     bool needs_brackets)
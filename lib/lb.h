@@ -62,7 +62,28 @@ char *ovn_lb_vip_init(struct ovn_lb_vip *lb_vip, const char *lb_key,
                       const char *lb_value, bool template, int address_family);
 char *ovn_lb_vip_init_explicit(struct ovn_lb_vip *lb_vip, const char *lb_key,
                                const char *lb_value);
+void ovn_lb_vip_clone(struct ovn_lb_vip *dst, const struct ovn_lb_vip *src);
 void ovn_lb_vip_destroy(struct ovn_lb_vip *vip);
+
+/* Cache of parsed VIPs.
+ *
+ * Load balancers are rebuilt from scratch whenever any of their VIPs
+ * changes, and they may have thousands of VIPs, so the VIPs that parsed
+ * successfully are cached by their key and value strings.  Only the VIPs
+ * that changed are then parsed again.
+ *
+ * ovn_lb_vip_cache_sweep() drops the VIPs that were not looked up since the
+ * previous sweep.  It is meant to be called after a full rebuild of the load
+ * balancers. */
+struct ovn_lb_vip_cache;
+
+struct ovn_lb_vip_cache *ovn_lb_vip_cache_create(void);
+void ovn_lb_vip_cache_destroy(struct ovn_lb_vip_cache *);
+void ovn_lb_vip_cache_sweep(struct ovn_lb_vip_cache *);
+char *ovn_lb_vip_init_cached(struct ovn_lb_vip_cache *,
+                             struct ovn_lb_vip *lb_vip, const char *lb_key,
+                             const char *lb_value, bool template,
+                             int address_family);
 void ovn_lb_vip_format(const struct ovn_lb_vip *vip, struct ds *s,
                        bool template);
 void ovn_lb_vip_backends_format(const struct ovn_lb_vip *vip, struct ds *s);
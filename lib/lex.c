@@ -514,6 +514,7 @@ static const char *
 lex_parse_string(const char *p, struct lex_token *token)
 {
     const char *start = ++p;
+    bool escaped = false;
     char * s = NULL;
     for (;;) {
         switch (*p) {
@@ -522,12 +523,21 @@ lex_parse_string(const char *p, struct lex_token *token)
             return p;
 
         case '"':
-            token->type = (json_string_unescape(start, p - start, &s)
-                           ? LEX_T_STRING : LEX_T_ERROR);
-            lex_token_strset(token, s);
+            if (!escaped) {
+                /* Most strings have no escapes, so copy them as they are.
+                 * This avoids a malloc() unless the string is too long for
+                 * the token's buffer. */
+                token->type = LEX_T_STRING;
+                lex_token_strcpy(token, start, p - start);
+            } else {
+                token->type = (json_string_unescape(start, p - start, &s)
+                               ? LEX_T_STRING : LEX_T_ERROR);
+                lex_token_strset(token, s);
+            }
             return p + 1;
 
         case '\\':
+            escaped = true;
             p++;
             if (*p) {
                 p++;
@@ -1085,3 +1095,56 @@ lexer_parse_template_string(const char *s, const struct smap *template_vars,
     lexer_destroy(&lexer);
     return lex_str_steal(ds_steal_cstr(&expanded));
 }
+
+/* Parses 's', one tuple of parameters of a parameterized logical flow, i.e.
+ * a comma-separated list of NAME=VALUE pairs in which each VALUE is a single
+ * token, e.g. 'mac=00:00:00:00:00:01, port="lsp1"', and adds each pair to
+ * 'template_vars', replacing the existing value of NAME, if any, so that the
+ * flow's templates can then be expanded by lexer_parse_template_string().
+ *
+ * Returns NULL if successful, otherwise an error message that the caller
+ * must free.  'template_vars' might have been partially updated on error. */
+char *
+lexer_parse_template_params(const char *s, struct smap *template_vars)
+{
+    struct lexer lexer;
+
+    lexer_init(&lexer, s);
+    lexer_get(&lexer);
+    do {
+        if (lexer.token.type != LEX_T_ID) {
+            lexer_syntax_error(&lexer, "expecting parameter name");
+            break;
+        }
+        char *name = xstrdup(lexer.token.s);
+
+        lexer_get(&lexer);
+        if (!lexer_force_match(&lexer, LEX_T_EQUALS)) {
+            free(name);
+            break;
+        }
+        if (lexer.token.type != LEX_T_ID
+            && lexer.token.type != LEX_T_STRING
+            && lexer.token.type != LEX_T_INTEGER
+            && lexer.token.type != LEX_T_MASKED_INTEGER) {
+            lexer_syntax_error(&lexer, "expecting parameter value");
+            free(name);
+            break;
+        }
+
+        struct ds value = DS_EMPTY_INITIALIZER;
+        lex_token_format(&lexer.token, &value);
+        smap_replace(template_vars, name, ds_cstr(&value));
+        ds_destroy(&value);
+        free(name);
+        lexer_get(&lexer);
+    } while (lexer_match(&lexer, LEX_T_COMMA));
+
+    if (!lexer.error) {
+        lexer_force_end(&lexer);
+    }
+
+    char *error = lexer_steal_error(&lexer);
+    lexer_destroy(&lexer);
+    return error;
+}
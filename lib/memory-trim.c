@@ -17,7 +17,9 @@
 
 #include <config.h>
 
-#if HAVE_DECL_MALLOC_TRIM
+#include <string.h>
+
+#if HAVE_DECL_MALLOC_TRIM || HAVE_DECL_MALLINFO2
 #include <malloc.h>
 #endif
 
@@ -25,18 +27,96 @@
 
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
+#include "simap.h"
 #include "timeval.h"
 
 VLOG_DEFINE_THIS_MODULE(memory_trim);
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
 
+/* Trimming after 'trim_timeout_ms' of inactivity is a poor fit for the
+ * large recomputes that free most of the heap at once: the memory stays
+ * retained by malloc until the timeout expires.  So, once the process has
+ * been inactive for MEMORY_TRIM_EARLY_MS, the heap is sampled and, if at
+ * least MEMORY_TRIM_EARLY_MIN_FREE bytes and MEMORY_TRIM_EARLY_MIN_PCT
+ * percent of it are free, memory is trimmed right away.
+ *
+ * Trimming is expensive for a large heap, so early trims are budgeted to
+ * one per 'trim_timeout_ms' to keep them from adding latency when short
+ * bursts of activity keep freeing memory. */
+#define MEMORY_TRIM_EARLY_MS 1000
+#define MEMORY_TRIM_EARLY_MIN_FREE (64 * 1024 * 1024)
+#define MEMORY_TRIM_EARLY_MIN_PCT 50
+
 struct memory_trimmer {
     uint32_t trim_timeout_ms;
     long long int last_active_ms;
     bool recently_active;
+    bool heap_checked;      /* Heap sampled since last activity. */
+    long long int last_early_trim_ms;
+
+    /* Statistics. */
+    unsigned int n_trims;
+    unsigned int n_early_trims;
+};
+
+struct memory_heap_stats {
+    size_t heap_bytes;      /* Allocated from the system by malloc. */
+    size_t free_bytes;      /* Free, but retained by malloc. */
 };
 
+/* Fills 'stats' with the current state of the malloc heap.  Returns false if
+ * that's not supported. */
+static bool
+memory_heap_get_stats(struct memory_heap_stats *stats)
+{
+#if HAVE_DECL_MALLINFO2
+    struct mallinfo2 mi = mallinfo2();
+
+    stats->heap_bytes = mi.arena + mi.hblkhd;
+    stats->free_bytes = mi.fordblks + mi.fsmblks;
+    return true;
+#else
+    memset(stats, 0, sizeof *stats);
+    return false;
+#endif
+}
+
+static unsigned int
+memory_heap_free_pct(const struct memory_heap_stats *stats)
+{
+    return stats->heap_bytes
+           ? (unsigned int) ((uint64_t) stats->free_bytes * 100
+                             / stats->heap_bytes)
+           : 0;
+}
+
+/* Returns true if the heap has enough freed but retained memory to trim it
+ * before the inactivity timeout. */
+static bool
+memory_trimmer_should_trim_early(struct memory_trimmer *mt, long long int now)
+{
+    struct memory_heap_stats stats;
+
+    if (mt->last_early_trim_ms
+        && now - mt->last_early_trim_ms < mt->trim_timeout_ms) {
+        return false;
+    }
+    if (!memory_heap_get_stats(&stats)
+        || stats.free_bytes < MEMORY_TRIM_EARLY_MIN_FREE
+        || memory_heap_free_pct(&stats) < MEMORY_TRIM_EARLY_MIN_PCT) {
+        return false;
+    }
+
+    VLOG_INFO_RL(&rl, "Detected %"PRIuSIZE" kB of free heap (%u%%) after "
+                 "%lld ms of inactivity: trimming memory",
+                 stats.free_bytes / 1024, memory_heap_free_pct(&stats),
+                 now - mt->last_active_ms);
+    mt->last_early_trim_ms = now;
+    mt->n_early_trims++;
+    return true;
+}
+
 struct memory_trimmer *
 memory_trimmer_create(void)
 {
@@ -62,7 +142,8 @@ memory_trimmer_set(struct memory_trimmer *mt, uint32_t trim_timeout_ms)
     mt->trim_timeout_ms = trim_timeout_ms;
 }
 
-/* Returns true if trimming due to inactivity should happen. */
+/* Returns true if trimming due to inactivity, or due to a large amount of
+ * freed memory once the process is briefly inactive, should happen. */
 bool
 memory_trimmer_can_run(struct memory_trimmer *mt)
 {
@@ -86,6 +167,15 @@ memory_trimmer_can_run(struct memory_trimmer *mt)
         return true;
     }
 
+    if (!mt->heap_checked
+        && now - mt->last_active_ms >= MEMORY_TRIM_EARLY_MS) {
+        mt->heap_checked = true;
+        if (memory_trimmer_should_trim_early(mt, now)) {
+            mt->recently_active = false;
+            return true;
+        }
+    }
+
     return false;
 }
 
@@ -95,15 +185,20 @@ memory_trimmer_wait(struct memory_trimmer *mt)
     if (!mt->recently_active) {
         return;
     }
-    poll_timer_wait_until(mt->last_active_ms + mt->trim_timeout_ms);
+    if (!mt->heap_checked) {
+        poll_timer_wait_until(mt->last_active_ms + MEMORY_TRIM_EARLY_MS);
+    } else {
+        poll_timer_wait_until(mt->last_active_ms + mt->trim_timeout_ms);
+    }
 }
 
 void
-memory_trimmer_trim(struct memory_trimmer *mt OVS_UNUSED)
+memory_trimmer_trim(struct memory_trimmer *mt)
 {
 #if HAVE_DECL_MALLOC_TRIM
         malloc_trim(0);
 #endif
+    mt->n_trims++;
 }
 
 void
@@ -111,4 +206,22 @@ memory_trimmer_record_activity(struct memory_trimmer *mt)
 {
     mt->last_active_ms = time_msec();
     mt->recently_active = true;
+    mt->heap_checked = false;
+}
+
+/* Adds the trimming statistics and the current amount of free memory retained
+ * by malloc to 'usage', for memory/show. */
+void
+memory_trimmer_get_memory_usage(const struct memory_trimmer *mt,
+                                struct simap *usage)
+{
+    struct memory_heap_stats stats;
+
+    simap_increase(usage, "memory-trims", mt->n_trims);
+    simap_increase(usage, "memory-trims-early", mt->n_early_trims);
+    if (memory_heap_get_stats(&stats)) {
+        simap_put(usage, "heap-KB", stats.heap_bytes / 1024);
+        simap_put(usage, "heap-free-KB", stats.free_bytes / 1024);
+        simap_put(usage, "heap-free-pct", memory_heap_free_pct(&stats));
+    }
 }
@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 struct memory_trimmer;
+struct simap;
 
 struct memory_trimmer *memory_trimmer_create(void);
 void memory_trimmer_destroy(struct memory_trimmer *);
@@ -29,5 +30,7 @@ bool memory_trimmer_can_run(struct memory_trimmer *);
 void memory_trimmer_wait(struct memory_trimmer *);
 void memory_trimmer_trim(struct memory_trimmer *);
 void memory_trimmer_record_activity(struct memory_trimmer *);
+void memory_trimmer_get_memory_usage(const struct memory_trimmer *,
+                                     struct simap *usage);
 
 #endif /* lib/memory-trim.h */
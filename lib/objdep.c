@@ -30,6 +30,9 @@ objdep_mgr_init(struct objdep_mgr *mgr)
 {
     hmap_init(&mgr->resource_to_objects_table);
     hmap_init(&mgr->object_to_resources_table);
+    mgr->objs = NULL;
+    mgr->n_objs = 0;
+    mgr->allocated_objs = 0;
 }
 
 void
@@ -39,29 +42,23 @@ objdep_mgr_destroy(struct objdep_mgr *mgr)
 
     hmap_destroy(&mgr->resource_to_objects_table);
     hmap_destroy(&mgr->object_to_resources_table);
+    free(mgr->objs);
 }
 
 void
 objdep_mgr_clear(struct objdep_mgr *mgr)
 {
     struct resource_to_objects_node *resource_node;
-    HMAP_FOR_EACH_SAFE (resource_node, node, &mgr->resource_to_objects_table) {
-        struct object_to_resources_list_node *object_list_node;
-        HMAP_FOR_EACH_SAFE (object_list_node, hmap_node,
-                            &resource_node->objs) {
-            ovs_list_remove(&object_list_node->list_node);
-            hmap_remove(&resource_node->objs, &object_list_node->hmap_node);
-            free(object_list_node);
-        }
-        hmap_remove(&mgr->resource_to_objects_table, &resource_node->node);
+    HMAP_FOR_EACH_POP (resource_node, node, &mgr->resource_to_objects_table) {
         resource_node_destroy(resource_node);
     }
 
     struct object_to_resources_node *object_node;
-    HMAP_FOR_EACH_SAFE (object_node, node, &mgr->object_to_resources_table) {
-        hmap_remove(&mgr->object_to_resources_table, &object_node->node);
+    HMAP_FOR_EACH_POP (object_node, node, &mgr->object_to_resources_table) {
+        free(object_node->resources);
         free(object_node);
     }
+    mgr->n_objs = 0;
 }
 
 void
@@ -81,11 +78,10 @@ objdep_mgr_add_with_refcount(struct objdep_mgr *mgr, enum objdep_type type,
     struct object_to_resources_node *object_node =
         objdep_mgr_find_resources(mgr, obj_uuid);
     if (resource_node && object_node) {
-        /* Check if the mapping already existed before adding a new one. */
-        struct object_to_resources_list_node *n;
-        HMAP_FOR_EACH_WITH_HASH (n, hmap_node, uuid_hash(obj_uuid),
-                                 &resource_node->objs) {
-            if (uuid_equals(&n->obj_uuid, obj_uuid)) {
+        /* Check if the mapping already existed before adding a new one.
+         * Objects only use a few resources, so look at the object's side. */
+        for (size_t i = 0; i < object_node->n_resources; i++) {
+            if (object_node->resources[i].resource == resource_node) {
                 return;
             }
         }
@@ -94,11 +90,14 @@ objdep_mgr_add_with_refcount(struct objdep_mgr *mgr, enum objdep_type type,
     /* Create the resource node if we didn't have one already (for a
      * different object). */
     if (!resource_node) {
-        resource_node = xzalloc(sizeof *resource_node);
+        size_t name_len = strlen(res_name);
+        resource_node = xmalloc(sizeof *resource_node + name_len + 1);
         resource_node->node.hash = hash_string(res_name, type);
         resource_node->type = type;
-        resource_node->res_name = xstrdup(res_name);
-        hmap_init(&resource_node->objs);
+        resource_node->objs = NULL;
+        resource_node->n_objs = 0;
+        resource_node->allocated_objs = 0;
+        memcpy(resource_node->res_name, res_name, name_len + 1);
         hmap_insert(&mgr->resource_to_objects_table,
                     &resource_node->node,
                     resource_node->node.hash);
@@ -110,21 +109,54 @@ objdep_mgr_add_with_refcount(struct objdep_mgr *mgr, enum objdep_type type,
         object_node = xzalloc(sizeof *object_node);
         object_node->node.hash = uuid_hash(obj_uuid);
         object_node->obj_uuid = *obj_uuid;
-        ovs_list_init(&object_node->resources_head);
         hmap_insert(&mgr->object_to_resources_table,
                     &object_node->node,
                     object_node->node.hash);
+
+        if (mgr->n_objs >= mgr->allocated_objs) {
+            mgr->objs = x2nrealloc(mgr->objs, &mgr->allocated_objs,
+                                   sizeof *mgr->objs);
+        }
+        object_node->idx = mgr->n_objs;
+        mgr->objs[mgr->n_objs++] = object_node;
     }
 
-    struct object_to_resources_list_node *resource_list_node =
-        xzalloc(sizeof *resource_list_node);
-    resource_list_node->obj_uuid = *obj_uuid;
-    resource_list_node->ref_count = ref_count;
-    resource_list_node->resource_node = resource_node;
-    hmap_insert(&resource_node->objs, &resource_list_node->hmap_node,
-                uuid_hash(obj_uuid));
-    ovs_list_push_back(&object_node->resources_head,
-                       &resource_list_node->list_node);
+    if (resource_node->n_objs >= resource_node->allocated_objs) {
+        resource_node->objs = x2nrealloc(resource_node->objs,
+                                         &resource_node->allocated_objs,
+                                         sizeof *resource_node->objs);
+    }
+    if (object_node->n_resources >= object_node->allocated_resources) {
+        object_node->resources = x2nrealloc(object_node->resources,
+                                            &object_node->allocated_resources,
+                                            sizeof *object_node->resources);
+    }
+    resource_node->objs[resource_node->n_objs] = (struct objdep_ref) {
+        .obj_idx = object_node->idx,
+        .res_idx = object_node->n_resources,
+        .ref_count = ref_count,
+    };
+    object_node->resources[object_node->n_resources++] =
+        (struct objdep_res_ref) {
+            .resource = resource_node,
+            .idx = resource_node->n_objs++,
+        };
+}
+
+/* Removes the reference at index 'idx' of 'resource_node', by moving the last
+ * one into its slot. */
+static void
+resource_node_remove_ref(struct objdep_mgr *mgr,
+                         struct resource_to_objects_node *resource_node,
+                         size_t idx)
+{
+    size_t last = --resource_node->n_objs;
+    if (idx != last) {
+        struct objdep_ref *ref = &resource_node->objs[idx];
+
+        *ref = resource_node->objs[last];
+        mgr->objs[ref->obj_idx]->resources[ref->res_idx].idx = idx;
+    }
 }
 
 void
@@ -138,23 +170,34 @@ objdep_mgr_remove_obj(struct objdep_mgr *mgr, const struct uuid *obj_uuid)
 
     hmap_remove(&mgr->object_to_resources_table, &object_node->node);
 
-    struct object_to_resources_list_node *resource_list_node;
-    LIST_FOR_EACH_SAFE (resource_list_node, list_node,
-                        &object_node->resources_head) {
-        struct resource_to_objects_node *resource_node =
-            resource_list_node->resource_node;
-        ovs_list_remove(&resource_list_node->list_node);
-        hmap_remove(&resource_node->objs, &resource_list_node->hmap_node);
+    for (size_t i = 0; i < object_node->n_resources; i++) {
+        struct objdep_res_ref *res_ref = &object_node->resources[i];
+        struct resource_to_objects_node *resource_node = res_ref->resource;
+
+        resource_node_remove_ref(mgr, resource_node, res_ref->idx);
 
         /* Clean up the node in ref_obj_table if the resource is not
          * referred by any logical flows. */
-        if (hmap_is_empty(&resource_node->objs)) {
+        if (!resource_node->n_objs) {
             hmap_remove(&mgr->resource_to_objects_table, &resource_node->node);
-            resource_node_destroy(resource_list_node->resource_node);
+            resource_node_destroy(resource_node);
         }
+    }
+
+    /* Move the last object into the slot of the removed one, and update the
+     * references to it. */
+    struct object_to_resources_node *last = mgr->objs[--mgr->n_objs];
+    if (last != object_node) {
+        last->idx = object_node->idx;
+        mgr->objs[last->idx] = last;
+        for (size_t i = 0; i < last->n_resources; i++) {
+            struct objdep_res_ref *res_ref = &last->resources[i];
 
-        free(resource_list_node);
+            res_ref->resource->objs[res_ref->idx].obj_idx = last->idx;
+        }
     }
+
+    free(object_node->resources);
     free(object_node);
 }
 
@@ -195,6 +238,30 @@ objdep_mgr_contains_obj(struct objdep_mgr *mgr, const struct uuid *obj_uuid)
     return !!objdep_mgr_find_resources(mgr, obj_uuid);
 }
 
+/* Adds all the references recorded in 'src' to 'dst', and clears 'src'.  The
+ * resources of each object are added in the order they were added to
+ * 'src'. */
+void
+objdep_mgr_merge(struct objdep_mgr *dst, struct objdep_mgr *src)
+{
+    for (size_t i = 0; i < src->n_objs; i++) {
+        struct object_to_resources_node *object_node = src->objs[i];
+
+        for (size_t j = 0; j < object_node->n_resources; j++) {
+            const struct objdep_res_ref *res_ref =
+                &object_node->resources[j];
+            const struct resource_to_objects_node *resource_node =
+                res_ref->resource;
+
+            objdep_mgr_add_with_refcount(
+                dst, resource_node->type, resource_node->res_name,
+                &object_node->obj_uuid,
+                resource_node->objs[res_ref->idx].ref_count);
+        }
+    }
+    objdep_mgr_clear(src);
+}
+
 bool
 objdep_mgr_handle_change(struct objdep_mgr *mgr,
                          enum objdep_type type,
@@ -216,16 +283,15 @@ objdep_mgr_handle_change(struct objdep_mgr *mgr,
 
     struct ovs_list objs_todo = OVS_LIST_INITIALIZER(&objs_todo);
 
-    struct object_to_resources_list_node *resource_list_node;
-    HMAP_FOR_EACH (resource_list_node, hmap_node, &resource_node->objs) {
-        if (uuidset_find(objs_processed, &resource_list_node->obj_uuid)) {
+    struct objdep_ref *ref;
+    RESOURCE_FOR_EACH_OBJ (ref, resource_node) {
+        const struct uuid *obj_uuid = objdep_mgr_ref_obj_uuid(mgr, ref);
+        if (uuidset_find(objs_processed, obj_uuid)) {
             continue;
         }
-        /* Use object_to_resources_list_node as list node to store the uuid.
-         * Other fields are not used here. */
         struct object_to_resources_list_node *resource_list_node_uuid =
             xmalloc(sizeof *resource_list_node_uuid);
-        resource_list_node_uuid->obj_uuid = resource_list_node->obj_uuid;
+        resource_list_node_uuid->obj_uuid = *obj_uuid;
         ovs_list_push_back(&objs_todo, &resource_list_node_uuid->list_node);
     }
     if (ovs_list_is_empty(&objs_todo)) {
@@ -255,7 +321,6 @@ objdep_type_name(enum objdep_type type)
 static void
 resource_node_destroy(struct resource_to_objects_node *resource_node)
 {
-    free(resource_node->res_name);
-    hmap_destroy(&resource_node->objs);
+    free(resource_node->objs);
     free(resource_node);
 }
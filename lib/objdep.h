@@ -38,19 +38,45 @@ typedef bool (*objdep_change_handler)(enum objdep_type,
                                       struct ovs_list *ref_nodes,
                                       const void *in_arg, void *out_arg);
 
+/* A reference from an object to a resource, stored in the array of the
+ * resource_to_objects_node.  The object is identified by its index in
+ * objdep_mgr.objs rather than by its uuid, and 'res_idx' is the index of the
+ * matching objdep_res_ref in object_to_resources_node.resources, so that
+ * both sides can be updated in O(1) when an object is removed. */
+struct objdep_ref {
+    uint32_t obj_idx;
+    uint32_t res_idx;
+    uint32_t ref_count; /* Reference count of the resource by this object.
+                         * Currently only used for the resource type
+                         * OBJDEP_TYPE_ADDRSET and for other types always
+                         * set to 0. */
+};
+
 /* A node pointing to all objects that refer to a given resource. */
 struct resource_to_objects_node {
     struct hmap_node node; /* node in objdep_mgr.resource_to_objects_table. */
     enum objdep_type type; /* key */
-    char *res_name;        /* key */
-    struct hmap objs;      /* Contains object_to_resources_list_node.
-                            * Use hmap instead of list so
-                            * that obj_resource_add() can check and avoid
-                            * and redundant entries in O(1). */
+    struct objdep_ref *objs; /* Objects referring to the resource, in no
+                              * particular order. */
+    size_t n_objs;
+    size_t allocated_objs;
+    char res_name[];       /* key */
 };
 
-#define RESOURCE_FOR_EACH_OBJ(NODE, MAP) \
-    HMAP_FOR_EACH (NODE, hmap_node, &(MAP)->objs)
+/* Iterates over the objdep_ref 'REF' of all objects referring to the
+ * resource 'NODE'.  It is fine to add references to other resources in the
+ * body of the loop. */
+#define RESOURCE_FOR_EACH_OBJ(REF, NODE)                                \
+    for (size_t REF##_i__ = 0;                                          \
+         REF##_i__ < (NODE)->n_objs                                     \
+         && ((REF) = &(NODE)->objs[REF##_i__], true);                   \
+         REF##_i__++)
+
+/* A resource used by an object, the other side of a struct objdep_ref. */
+struct objdep_res_ref {
+    struct resource_to_objects_node *resource;
+    uint32_t idx;          /* Index of the objdep_ref in resource->objs. */
+};
 
 /* A node pointing to all resources used by a given object (specified by
  * uuid).
@@ -58,38 +84,35 @@ struct resource_to_objects_node {
 struct object_to_resources_node {
     struct hmap_node node; /* node in objdep_mgr.object_to_resources_table. */
     struct uuid obj_uuid;  /* key */
-    struct ovs_list resources_head; /* Contains elements of type
-                                     * object_to_resources_list_node. */
+    uint32_t idx;          /* Index in objdep_mgr.objs. */
+    struct objdep_res_ref *resources; /* In the order they were added. */
+    size_t n_resources;
+    size_t allocated_resources;
 };
 
-/* Maintains the relationship for a pair of named resource and
- * an object, indexed by both resource_to_object_table and
- * object_to_resources_table. */
+/* A node in the list of objects passed to objdep_change_handler. */
 struct object_to_resources_list_node {
-    /* node in object_to_resources_node.resources_head. */
     struct ovs_list list_node;
-    struct hmap_node hmap_node; /* node in resource_to_objects_node.objs. */
     struct uuid obj_uuid;
-    size_t ref_count; /* Reference count of the resource by this object.
-                       * Currently only used for the resource type
-                       * OBJDEP_TYPE_ADDRSET and for other types always
-                       * set to 0. */
-    struct resource_to_objects_node *resource_node;
 };
 
 struct objdep_mgr {
     /* A map from a referenced resource type & name (e.g. address_set AS1)
-     * to a list of object UUIDs (e.g., lflow) that are referencing the named
+     * to the objects (e.g., lflow) that are referencing the named
      * resource. Data type of each node in this hmap is struct
-     * resource_to_objects_node.  The objs in each node point
-     * to a map of object_to_resources_list_node.ref_list. */
+     * resource_to_objects_node. */
     struct hmap resource_to_objects_table;
 
-    /* A map from a obj uuid to a list of named resources that are
-     * referenced by the object. Data type of each node in this hmap is
-     * struct object_to_resources_node. The resources_head in each node
-     * points to a list of object_to_resources_list_node.obj_list. */
+    /* A map from a obj uuid to the named resources that are referenced by
+     * the object. Data type of each node in this hmap is struct
+     * object_to_resources_node. */
     struct hmap object_to_resources_table;
+
+    /* All the object_to_resources_node, indexed by their 'idx'.  Kept dense
+     * by moving the last one into the slot of a removed object. */
+    struct object_to_resources_node **objs;
+    size_t n_objs;
+    size_t allocated_objs;
 };
 
 void objdep_mgr_init(struct objdep_mgr *);
@@ -110,6 +133,7 @@ struct resource_to_objects_node *objdep_mgr_find_objs(
 struct object_to_resources_node *objdep_mgr_find_resources(
     struct objdep_mgr *, const struct uuid *);
 bool objdep_mgr_contains_obj(struct objdep_mgr *, const struct uuid *);
+void objdep_mgr_merge(struct objdep_mgr *dst, struct objdep_mgr *src);
 
 bool objdep_mgr_handle_change(struct objdep_mgr *, enum objdep_type,
                               const char *res_name,
@@ -120,4 +144,13 @@ bool objdep_mgr_handle_change(struct objdep_mgr *, enum objdep_type,
 
 const char *objdep_type_name(enum objdep_type);
 
+/* Returns the uuid of the object of 'ref', a reference of a resource in
+ * 'mgr'. */
+static inline const struct uuid *
+objdep_mgr_ref_obj_uuid(const struct objdep_mgr *mgr,
+                        const struct objdep_ref *ref)
+{
+    return &mgr->objs[ref->obj_idx]->obj_uuid;
+}
+
 #endif /* lib/objdep.h */
@@ -29,6 +29,7 @@
 #include "openvswitch/hmap.h"
 #include "openvswitch/thread.h"
 #include "ovn-parallel-hmap.h"
+#include "profiler.h"
 #include "ovs-atomic.h"
 #include "ovs-thread.h"
 #include "ovs-numa.h"
@@ -55,6 +56,9 @@ static struct ovs_mutex init_mutex = OVS_MUTEX_INITIALIZER;
 
 static size_t pool_size = 1;
 
+/* Whether to pin the worker threads, see ovn_set_worker_pool_numa_aware(). */
+static bool numa_aware = false;
+
 static int sembase;
 
 static void worker_pool_hook(void *aux OVS_UNUSED);
@@ -78,6 +82,14 @@ ovn_get_worker_pool_size(void)
     return pool_size;
 }
 
+void
+ovn_set_worker_pool_numa_aware(bool enable)
+{
+    ovs_mutex_lock(&init_mutex);
+    numa_aware = enable;
+    ovs_mutex_unlock(&init_mutex);
+}
+
 static void
 stop_controls(struct worker_pool *pool)
 {
@@ -155,6 +167,8 @@ init_controls(struct worker_pool *pool)
         new_control->data = NULL;
         new_control->pool = pool;
         new_control->worker = 0;
+        new_control->core_id = OVS_CORE_UNSPEC;
+        new_control->numa_id = OVS_NUMA_UNSPEC;
         ovs_mutex_init(&new_control->mutex);
         atomic_init(&new_control->finished, false);
         sprintf(sem_name, WORKER_SEM_NAME, sembase, pool, i);
@@ -167,12 +181,81 @@ init_controls(struct worker_pool *pool)
     return 0;
 }
 
+static int
+compare_cores_by_numa(const void *a_, const void *b_)
+{
+    const struct ovs_numa_info_core *a = a_;
+    const struct ovs_numa_info_core *b = b_;
+
+    if (a->numa_id != b->numa_id) {
+        return a->numa_id < b->numa_id ? -1 : 1;
+    }
+    return a->core_id < b->core_id ? -1 : a->core_id > b->core_id;
+}
+
+/* Assigns to the workers of 'pool' the cores that the process may run on,
+ * sorted by NUMA node and spread evenly over the workers. */
+static void
+assign_worker_cores(struct worker_pool *pool)
+{
+    ovs_numa_init();
+
+    struct ovs_numa_dump *dump = ovs_numa_thread_getaffinity_dump();
+    size_t n_cores = dump ? ovs_numa_dump_count(dump) : 0;
+    if (!n_cores) {
+        VLOG_WARN("Failed to get the CPU affinity, not pinning threads.");
+        ovs_numa_dump_destroy(dump);
+        return;
+    }
+
+    struct ovs_numa_info_core *cores = xmalloc(n_cores * sizeof *cores);
+    const struct ovs_numa_info_core *core;
+    size_t n = 0;
+    FOR_EACH_CORE_ON_DUMP (core, dump) {
+        cores[n++] = *core;
+    }
+    ovs_numa_dump_destroy(dump);
+    qsort(cores, n, sizeof *cores, compare_cores_by_numa);
+
+    for (size_t i = 0; i < pool->size; i++) {
+        const struct ovs_numa_info_core *c = &cores[i * n / pool->size];
+
+        pool->controls[i].core_id = c->core_id;
+        pool->controls[i].numa_id = c->numa_id;
+    }
+    free(cores);
+}
+
+static void *
+worker_thread_start(void *arg)
+{
+    struct worker_control *control = arg;
+
+    ovn_profiler_register_thread();
+    if (control->core_id != OVS_CORE_UNSPEC) {
+        int error = ovs_numa_thread_setaffinity_core(control->core_id);
+        if (error) {
+            VLOG_WARN("Failed to pin worker %d to core %u: %s",
+                      control->id, control->core_id, ovs_strerror(error));
+        }
+    }
+
+    void *ret = control->pool->start(control);
+    ovn_profiler_unregister_thread();
+    return ret;
+}
+
 static void
 init_threads(struct worker_pool *pool, void *(*start)(void *))
 {
+    pool->start = start;
+    if (numa_aware) {
+        assign_worker_cores(pool);
+    }
     for (size_t i = 0; i < pool_size; i++) {
         pool->controls[i].worker =
-            ovs_thread_create("worker pool helper", start, &pool->controls[i]);
+            ovs_thread_create("worker pool helper", worker_thread_start,
+                              &pool->controls[i]);
     }
     ovs_list_push_back(&worker_pools, &pool->list_node);
 }
@@ -363,6 +446,41 @@ ovn_run_pool(struct worker_pool *pool)
     run_pool_callback(pool, NULL, NULL, NULL);
 }
 
+void *
+ovn_worker_task_thread(void *arg)
+{
+    struct worker_control *control = arg;
+
+    while (!stop_parallel_processing()) {
+        wait_for_work(control);
+        struct worker_task *task = control->data;
+        if (stop_parallel_processing()) {
+            return NULL;
+        }
+        if (task) {
+            task->run(control, task->aux);
+        }
+        post_completed_work(control);
+    }
+    return NULL;
+}
+
+void
+ovn_run_pool_task(struct worker_pool *pool,
+                  void (*run)(struct worker_control *, void *aux),
+                  void *aux)
+{
+    struct worker_task task = {
+        .run = run,
+        .aux = aux,
+    };
+
+    for (size_t i = 0; i < pool->size; i++) {
+        pool->controls[i].data = &task;
+    }
+    run_pool(pool);
+}
+
 /* Brute force merge of a hashmap into another hashmap.
  * Intended for use in parallel processing. The destination
  * hashmap MUST be the same size as the one being merged.
@@ -436,6 +554,176 @@ ovn_update_hashrow_locks(struct hmap *lflows, struct hashrow_locks *hrl)
     }
 }
 
+void
+ovn_work_queue_init(struct work_queue *wq, size_t n_workers)
+{
+    wq->n_workers = n_workers;
+    wq->slices = xmalloc(n_workers * sizeof *wq->slices);
+    for (size_t i = 0; i < n_workers; i++) {
+        ovs_mutex_init(&wq->slices[i].mutex);
+        atomic_init(&wq->slices[i].next, 0);
+        atomic_init(&wq->slices[i].end, 0);
+    }
+    wq->numa_ids = NULL;
+    atomic_count_init(&wq->n_steals, 0);
+}
+
+/* Initializes 'wq' for the workers of 'pool', taking into account the NUMA
+ * nodes they run on, if they are pinned. */
+void
+ovn_work_queue_init_for_pool(struct work_queue *wq,
+                             const struct worker_pool *pool)
+{
+    ovn_work_queue_init(wq, pool->size);
+    if (pool->size && pool->controls[0].numa_id != OVS_NUMA_UNSPEC) {
+        wq->numa_ids = xmalloc(pool->size * sizeof *wq->numa_ids);
+        for (size_t i = 0; i < pool->size; i++) {
+            wq->numa_ids[i] = pool->controls[i].numa_id;
+        }
+    }
+}
+
+void
+ovn_work_queue_destroy(struct work_queue *wq)
+{
+    for (size_t i = 0; i < wq->n_workers; i++) {
+        ovs_mutex_destroy(&wq->slices[i].mutex);
+    }
+    free(wq->slices);
+    wq->slices = NULL;
+    free(wq->numa_ids);
+    wq->numa_ids = NULL;
+    wq->n_workers = 0;
+}
+
+static void
+work_queue_slice_set(struct work_queue_slice *s, size_t next, size_t end)
+{
+    ovs_mutex_lock(&s->mutex);
+    atomic_store_relaxed(&s->next, next);
+    atomic_store_relaxed(&s->end, end);
+    ovs_mutex_unlock(&s->mutex);
+}
+
+void
+ovn_work_queue_reset(struct work_queue *wq, size_t n_jobs)
+{
+    size_t start = 0;
+
+    for (size_t i = 0; i < wq->n_workers; i++) {
+        size_t n = n_jobs / wq->n_workers + (i < n_jobs % wq->n_workers);
+
+        work_queue_slice_set(&wq->slices[i], start, start + n);
+        start += n;
+    }
+    atomic_count_set(&wq->n_steals, 0);
+}
+
+/* Returns the number of jobs left in 's'.  Without the mutex of 's', the
+ * result is only a hint, since its owner or a thief may change it at any
+ * time. */
+static size_t
+work_queue_slice_left(struct work_queue_slice *s)
+{
+    size_t next, end;
+
+    atomic_read_relaxed(&s->next, &next);
+    atomic_read_relaxed(&s->end, &end);
+    return end > next ? end - next : 0;
+}
+
+/* Returns the slice of another worker than 'worker_id' with the most jobs
+ * left, only considering the workers on the same NUMA node if 'same_numa' is
+ * true, or NULL if none of them has jobs left. */
+static struct work_queue_slice *
+work_queue_find_victim(struct work_queue *wq, size_t worker_id,
+                       bool same_numa)
+{
+    struct work_queue_slice *victim = NULL;
+    size_t best = 0;
+
+    /* Unlocked reads are only a hint, the victim is re-checked later. */
+    for (size_t i = 1; i < wq->n_workers; i++) {
+        size_t idx = (worker_id + i) % wq->n_workers;
+        struct work_queue_slice *s = &wq->slices[idx];
+
+        if (same_numa && wq->numa_ids[idx] != wq->numa_ids[worker_id]) {
+            continue;
+        }
+
+        size_t left = work_queue_slice_left(s);
+        if (left > best) {
+            best = left;
+            victim = s;
+        }
+    }
+    return victim;
+}
+
+/* Steals the upper half of the biggest slice of another worker, preferably
+ * one on the same NUMA node, and makes it the slice of 'worker_id'.  Returns
+ * false if nothing is left to steal. */
+static bool
+work_queue_steal(struct work_queue *wq, size_t worker_id)
+{
+    struct work_queue_slice *own = &wq->slices[worker_id];
+
+    for (;;) {
+        struct work_queue_slice *victim = NULL;
+
+        if (wq->numa_ids) {
+            victim = work_queue_find_victim(wq, worker_id, true);
+        }
+        if (!victim) {
+            victim = work_queue_find_victim(wq, worker_id, false);
+        }
+        if (!victim) {
+            return false;
+        }
+
+        size_t next, start, end;
+
+        ovs_mutex_lock(&victim->mutex);
+        atomic_read_relaxed(&victim->next, &next);
+        atomic_read_relaxed(&victim->end, &end);
+        if (end <= next) {
+            ovs_mutex_unlock(&victim->mutex);
+            continue;
+        }
+        start = next + (end - next) / 2;
+        atomic_store_relaxed(&victim->end, start);
+        ovs_mutex_unlock(&victim->mutex);
+
+        work_queue_slice_set(own, start, end);
+
+        atomic_count_inc(&wq->n_steals);
+        return true;
+    }
+}
+
+bool
+ovn_work_queue_next(struct work_queue *wq, size_t worker_id, size_t *job)
+{
+    struct work_queue_slice *own = &wq->slices[worker_id];
+
+    do {
+        size_t next, end;
+
+        ovs_mutex_lock(&own->mutex);
+        atomic_read_relaxed(&own->next, &next);
+        atomic_read_relaxed(&own->end, &end);
+        if (next < end) {
+            atomic_store_relaxed(&own->next, next + 1);
+            ovs_mutex_unlock(&own->mutex);
+            *job = next;
+            return true;
+        }
+        ovs_mutex_unlock(&own->mutex);
+    } while (work_queue_steal(wq, worker_id));
+
+    return false;
+}
+
 static void
 worker_pool_hook(void *aux OVS_UNUSED) {
     static struct worker_pool *pool;
@@ -83,6 +83,8 @@ struct worker_control {
     void *data; /* Pointer to data to be processed. */
     pthread_t worker;
     struct worker_pool *pool;
+    unsigned int core_id; /* Pinned to this core, or OVS_CORE_UNSPEC. */
+    int numa_id; /* NUMA node of 'core_id', or OVS_NUMA_UNSPEC. */
 };
 
 struct worker_pool {
@@ -90,11 +92,19 @@ struct worker_pool {
     struct ovs_list list_node; /* List of pools - used in cleanup/exit. */
     struct worker_control *controls; /* "Handles" in this pool. */
     sem_t *done; /* Work completion semaphorew. */
+    void *(*start)(void *); /* Thread function of the workers. */
 };
 
 /* Return pool size; bigger than 1 means parallelization has been enabled. */
 size_t ovn_get_worker_pool_size(void);
 
+/* If 'enable' is true, the threads of the pools created or resized from now
+ * on are pinned to the CPU cores that the process may run on, in order of
+ * NUMA node, so that workers with consecutive ids share a NUMA node as much
+ * as possible.  Work queues initialized with ovn_work_queue_init_for_pool()
+ * then prefer to steal from workers on the same NUMA node. */
+void ovn_set_worker_pool_numa_aware(bool enable);
+
 enum pool_update_status {
      POOL_UNCHANGED,     /* no change to pool */
      POOL_UPDATED,       /* pool has been updated */
@@ -154,6 +164,27 @@ void ovn_run_pool_callback(struct worker_pool *pool, void *fin_result,
                            size_t index));
 
 
+/* Generic jobs for a pool.
+ *
+ * A pool created with ovn_worker_task_thread() as its start function can be
+ * used by several independent users: every run hands the same 'run' callback
+ * and 'aux' pointer to all the workers, which can tell themselves apart by
+ * 'control->id'.
+ */
+struct worker_task {
+    void (*run)(struct worker_control *, void *aux);
+    void *aux;
+};
+
+void *ovn_worker_task_thread(void *arg);
+
+/* Runs 'run(control, aux)' on all the workers of 'pool', which must have been
+ * created with ovn_worker_task_thread(), and waits for all of them to
+ * finish. */
+void ovn_run_pool_task(struct worker_pool *pool,
+                       void (*run)(struct worker_control *, void *aux),
+                       void *aux);
+
 /* Returns the first node in 'hmap' in the bucket in which the given 'hash'
  * would land, or a null pointer if that bucket is empty. */
 
@@ -163,6 +194,22 @@ hmap_first_in_bucket_num(const struct hmap *hmap, size_t num)
     return hmap->buckets[num];
 }
 
+/* Inserts 'node', with the given 'hash', into 'hmap', like
+ * hmap_insert_fast(), but without updating the number of nodes in 'hmap'.
+ * This only modifies the bucket of 'hash', so concurrent inserts only need to
+ * be serialized if they go to the same bucket, e.g., with a lock per bucket
+ * or per set of buckets.  The caller must count the inserted nodes and add
+ * them to 'hmap->n' once there are no concurrent inserts left. */
+static inline void
+parallel_hmap_insert(struct hmap *hmap, struct hmap_node *node, size_t hash)
+{
+    struct hmap_node **bucket = &hmap->buckets[hash & hmap->mask];
+
+    node->hash = hash;
+    node->next = *bucket;
+    *bucket = node;
+}
+
 static inline struct hmap_node *
 parallel_hmap_next__(const struct hmap *hmap, size_t start, size_t pool_size)
 {
@@ -288,6 +335,8 @@ static inline void init_hash_row_locks(struct hashrow_locks *hrl)
 
 #define run_pool(pool) ovn_run_pool(pool)
 
+#define run_pool_task(pool, run, aux) ovn_run_pool_task(pool, run, aux)
+
 #define run_pool_hash(pool, result, result_frags) \
     ovn_run_pool_hash(pool, result, result_frags)
 
@@ -298,6 +347,52 @@ static inline void init_hash_row_locks(struct hashrow_locks *hrl)
     ovn_run_pool_callback(pool, fin_result, result_frags, helper_func)
 
 
+/* Work-stealing distribution of a set of jobs numbered 0..n_jobs-1 between
+ * the workers of a pool.
+ *
+ * Each worker initially owns a contiguous slice of the job range and takes
+ * jobs from the front of it.  A worker that runs out of jobs steals the upper
+ * half of the largest remaining slice of another worker, so that a few
+ * expensive jobs on one worker do not leave the rest of the pool idle.
+ *
+ * A typical job is a single hash bucket, iterated with
+ * HMAP_FOR_EACH_IN_PARALLEL. */
+struct work_queue_slice {
+    struct ovs_mutex mutex;
+
+    /* Only written with 'mutex' held.  They are atomic so that the other
+     * workers can read them without the mutex to pick a slice to steal
+     * from. */
+    ATOMIC(size_t) next;    /* First job not yet taken. */
+    ATOMIC(size_t) end;     /* One past the last job owned by the worker. */
+};
+
+struct work_queue {
+    size_t n_workers;
+    struct work_queue_slice *slices;
+    int *numa_ids;          /* NUMA node of each worker, or NULL. */
+    atomic_count n_steals;  /* Statistics only. */
+};
+
+void ovn_work_queue_init(struct work_queue *, size_t n_workers);
+void ovn_work_queue_init_for_pool(struct work_queue *,
+                                  const struct worker_pool *);
+void ovn_work_queue_destroy(struct work_queue *);
+
+/* Must be called by the main thread before the pool is run. */
+void ovn_work_queue_reset(struct work_queue *, size_t n_jobs);
+
+/* Stores the next job for worker 'worker_id' in '*job' and returns true,
+ * or returns false if there are no jobs left for any of the workers. */
+bool ovn_work_queue_next(struct work_queue *, size_t worker_id, size_t *job);
+
+/* Iterates 'BNUM' over the hash buckets of a parallel hmap handed out to
+ * worker 'ID' by work queue 'WQ'. */
+#define WORK_QUEUE_FOR_EACH_BUCKET(BNUM, ID, WQ) \
+    for (size_t job__; \
+         ovn_work_queue_next(WQ, ID, &job__) ? ((BNUM) = job__, true) : false;)
+
+
 
 #ifdef __clang__
 #pragma clang diagnostic pop
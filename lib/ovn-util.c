@@ -66,15 +66,28 @@ void set_idl_probe_interval(struct ovsdb_idl *idl, const char *remote,
     ovsdb_idl_set_probe_interval(idl, interval);
 }
 
+/* Returns 'array', with 'n' elements of 'size' bytes, reallocated if needed
+ * to make room for one more.  The capacity of the arrays of lport_addresses
+ * isn't stored: they are always grown to the next power of 2, so that adding
+ * many addresses doesn't reallocate them each time. */
+static void *
+lport_addresses_grow(void *array, size_t n, size_t size)
+{
+    if (!n || is_pow2(n)) {
+        array = xrealloc(array, (n ? 2 * n : 1) * size);
+    }
+    return array;
+}
+
 static void
 add_ipv4_netaddr(struct lport_addresses *laddrs, ovs_be32 addr,
                  unsigned int plen)
 {
-    laddrs->n_ipv4_addrs++;
-    laddrs->ipv4_addrs = xrealloc(laddrs->ipv4_addrs,
-        laddrs->n_ipv4_addrs * sizeof *laddrs->ipv4_addrs);
+    laddrs->ipv4_addrs = lport_addresses_grow(laddrs->ipv4_addrs,
+                                              laddrs->n_ipv4_addrs,
+                                              sizeof *laddrs->ipv4_addrs);
 
-    struct ipv4_netaddr *na = &laddrs->ipv4_addrs[laddrs->n_ipv4_addrs - 1];
+    struct ipv4_netaddr *na = &laddrs->ipv4_addrs[laddrs->n_ipv4_addrs++];
 
     na->addr = addr;
     na->mask = be32_prefix_mask(plen);
@@ -91,11 +104,11 @@ static void
 add_ipv6_netaddr(struct lport_addresses *laddrs, struct in6_addr addr,
                  unsigned int plen)
 {
-    laddrs->n_ipv6_addrs++;
-    laddrs->ipv6_addrs = xrealloc(laddrs->ipv6_addrs,
-        laddrs->n_ipv6_addrs * sizeof *laddrs->ipv6_addrs);
+    laddrs->ipv6_addrs = lport_addresses_grow(laddrs->ipv6_addrs,
+                                              laddrs->n_ipv6_addrs,
+                                              sizeof *laddrs->ipv6_addrs);
 
-    struct ipv6_netaddr *na = &laddrs->ipv6_addrs[laddrs->n_ipv6_addrs - 1];
+    struct ipv6_netaddr *na = &laddrs->ipv6_addrs[laddrs->n_ipv6_addrs++];
 
     memcpy(&na->addr, &addr, sizeof na->addr);
     na->mask = ipv6_create_mask(plen);
@@ -158,6 +171,16 @@ is_dynamic_lsp_address(const char *address)
     return false;
 }
 
+/* Returns false if the first word of 's' can't be an IPv4 address, because it
+ * has a colon before its first dot, so that IPv6 addresses are not parsed as
+ * IPv4 first, which allocates an error message. */
+static bool
+may_be_ipv4(const char *s)
+{
+    s += strspn(s, " ");
+    return s[strcspn(s, ":. ")] != ':';
+}
+
 static bool
 parse_and_store_addresses(const char *address, struct lport_addresses *laddrs,
                           int *ofs, bool extract_eth_addr)
@@ -191,13 +214,15 @@ parse_and_store_addresses(const char *address, struct lport_addresses *laddrs,
     buf += buf_index;
     while (*buf != '\0') {
         buf_index = 0;
-        error = ip_parse_cidr_len(buf, &buf_index, &ip4, &plen);
-        if (!error) {
-            add_ipv4_netaddr(laddrs, ip4, plen);
-            buf += buf_index;
-            continue;
+        if (may_be_ipv4(buf)) {
+            error = ip_parse_cidr_len(buf, &buf_index, &ip4, &plen);
+            if (!error) {
+                add_ipv4_netaddr(laddrs, ip4, plen);
+                buf += buf_index;
+                continue;
+            }
+            free(error);
         }
-        free(error);
         error = ipv6_parse_cidr_len(buf, &buf_index, &ip6, &plen);
         if (!error) {
             add_ipv6_netaddr(laddrs, ip6, plen);
@@ -321,18 +346,21 @@ extract_lrp_networks(const struct nbrec_logical_router_port *lrp,
         unsigned int plen;
         char *error;
 
-        error = ip_parse_cidr(lrp->networks[i], &ip4, &plen);
-        if (!error) {
-            if (!ip4) {
-                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-                VLOG_WARN_RL(&rl, "bad 'networks' %s", lrp->networks[i]);
+        if (may_be_ipv4(lrp->networks[i])) {
+            error = ip_parse_cidr(lrp->networks[i], &ip4, &plen);
+            if (!error) {
+                if (!ip4) {
+                    static struct vlog_rate_limit rl
+                        = VLOG_RATE_LIMIT_INIT(5, 1);
+                    VLOG_WARN_RL(&rl, "bad 'networks' %s", lrp->networks[i]);
+                    continue;
+                }
+
+                add_ipv4_netaddr(laddrs, ip4, plen);
                 continue;
             }
-
-            add_ipv4_netaddr(laddrs, ip4, plen);
-            continue;
+            free(error);
         }
-        free(error);
 
         error = ipv6_parse_cidr(lrp->networks[i], &ip6, &plen);
         if (!error) {
@@ -639,6 +667,209 @@ ovn_logical_flow_hash(uint8_t table_id, enum ovn_pipeline pipeline,
     return hash_string(actions, hash);
 }
 
+/* Iterator over the pieces of a struct ovn_fmt, i.e. its literal parts and
+ * the arguments of its conversions. */
+struct ovn_fmt_iter {
+    const struct ovn_fmt *fmt;
+    const char *p;              /* Next piece of 'fmt->fmt'. */
+    size_t arg;                 /* Next of 'fmt->args'. */
+};
+
+static void
+ovn_fmt_iter_init(struct ovn_fmt_iter *it, const struct ovn_fmt *fmt)
+{
+    *it = (struct ovn_fmt_iter) { .fmt = fmt, .p = fmt->fmt };
+}
+
+/* Sets '*s' and '*len' to the next piece of the string, which is not
+ * null-terminated.  Returns false at the end of the string. */
+static bool
+ovn_fmt_iter_next(struct ovn_fmt_iter *it, const char **s, size_t *len)
+{
+    const struct ovn_fmt *fmt = it->fmt;
+
+    if (!*it->p) {
+        ovs_assert(it->arg == fmt->n_args);
+        return false;
+    }
+
+    if (!fmt->args) {
+        *s = it->p;
+        *len = strlen(it->p);
+    } else if (*it->p != '%') {
+        *s = it->p;
+        *len = strcspn(it->p, "%");
+    } else if (it->p[1] == 's') {
+        ovs_assert(it->arg < fmt->n_args);
+        *s = fmt->args[it->arg++];
+        *len = strlen(*s);
+        it->p += 2;
+        return true;
+    } else {
+        ovs_assert(it->p[1] == '%');
+        *s = it->p + 1;
+        *len = 1;
+        it->p += 2;
+        return true;
+    }
+    it->p += *len;
+    return true;
+}
+
+/* Same as hash_string() of the formatted string, i.e. as hash_bytes(), which
+ * hashes the string as a sequence of 32-bit words. */
+uint32_t
+ovn_fmt_hash(const struct ovn_fmt *fmt, uint32_t basis)
+{
+    uint8_t tail[4];            /* The last 'n % 4' bytes, not hashed yet. */
+    uint32_t hash = basis;
+    uint32_t word;
+    size_t n = 0;
+
+    struct ovn_fmt_iter it;
+    const char *s;
+    size_t len;
+
+    ovn_fmt_iter_init(&it, fmt);
+    while (ovn_fmt_iter_next(&it, &s, &len)) {
+        size_t n_tail = n % 4;
+
+        n += len;
+        if (n_tail) {
+            size_t k = MIN(4 - n_tail, len);
+
+            memcpy(&tail[n_tail], s, k);
+            s += k;
+            len -= k;
+            if (n_tail + k < 4) {
+                continue;
+            }
+            memcpy(&word, tail, 4);
+            hash = hash_add(hash, word);
+        }
+        for (; len >= 4; s += 4, len -= 4) {
+            memcpy(&word, s, 4);
+            hash = hash_add(hash, word);
+        }
+        memcpy(tail, s, len);
+    }
+
+    if (n % 4) {
+        word = 0;
+        memcpy(&word, tail, n % 4);
+        hash = hash_add(hash, word);
+    }
+    return hash_finish(hash, n);
+}
+
+/* Returns true if 'fmt', formatted, is the string 's'. */
+bool
+ovn_fmt_equals(const struct ovn_fmt *fmt, const char *s)
+{
+    struct ovn_fmt_iter it;
+    const char *piece;
+    size_t len;
+
+    ovn_fmt_iter_init(&it, fmt);
+    while (ovn_fmt_iter_next(&it, &piece, &len)) {
+        if (strncmp(s, piece, len)) {
+            return false;
+        }
+        s += len;
+    }
+    return !*s;
+}
+
+/* Appends 'fmt', formatted, to 'ds'. */
+void
+ovn_fmt_format(const struct ovn_fmt *fmt, struct ds *ds)
+{
+    struct ovn_fmt_iter it;
+    const char *piece;
+    size_t len;
+
+    ovn_fmt_iter_init(&it, fmt);
+    while (ovn_fmt_iter_next(&it, &piece, &len)) {
+        ds_put_buffer(ds, piece, len);
+    }
+}
+
+/* Same as ovn_logical_flow_hash() of the formatted 'match' and 'actions'. */
+uint32_t
+ovn_logical_flow_fmt_hash(uint8_t table_id, enum ovn_pipeline pipeline,
+                          uint16_t priority, const struct ovn_fmt *match,
+                          const struct ovn_fmt *actions)
+{
+    size_t hash = hash_2words((table_id << 16) | priority, pipeline);
+    hash = ovn_fmt_hash(match, hash);
+    return ovn_fmt_hash(actions, hash);
+}
+
+/* Adds a sample of 'msec' milliseconds to 'latency'.  Negative samples,
+ * e.g. between the clocks of different hosts, count as 0. */
+void
+ovn_latency_record(struct ovn_latency *latency, long long int msec)
+{
+    uint64_t value = MAX(msec, 0);
+    size_t bucket = value ? MIN(log_2_floor(value) + 1,
+                                OVN_LATENCY_N_BUCKETS - 1) : 0;
+
+    latency->buckets[bucket]++;
+    latency->count++;
+    latency->total_msec += value;
+    latency->max_msec = MAX(latency->max_msec, value);
+}
+
+/* Returns an upper bound, in milliseconds, of the latency of 'pct' percent
+ * of the samples in 'latency'. */
+static uint64_t
+ovn_latency_percentile(const struct ovn_latency *latency, unsigned int pct)
+{
+    uint64_t target = DIV_ROUND_UP(latency->count * pct, 100);
+    uint64_t sum = 0;
+
+    if (!latency->count) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < OVN_LATENCY_N_BUCKETS; i++) {
+        sum += latency->buckets[i];
+        if (sum >= target) {
+            return MIN(UINT64_C(1) << i, latency->max_msec);
+        }
+    }
+    return latency->max_msec;
+}
+
+/* Appends to 'ds' a summary of 'latency', named 'name', followed by its
+ * non-empty buckets. */
+void
+ovn_latency_format(const struct ovn_latency *latency, const char *name,
+                   struct ds *ds)
+{
+    ds_put_format(ds, "- %s: %"PRIu64" samples, avg %"PRIu64"ms, "
+                  "p50 %"PRIu64"ms, p99 %"PRIu64"ms, max %"PRIu64"ms\n",
+                  name, latency->count,
+                  latency->count ? latency->total_msec / latency->count : 0,
+                  ovn_latency_percentile(latency, 50),
+                  ovn_latency_percentile(latency, 99),
+                  latency->max_msec);
+    for (size_t i = 0; i < OVN_LATENCY_N_BUCKETS; i++) {
+        if (!latency->buckets[i]) {
+            continue;
+        }
+        if (!i) {
+            ds_put_cstr(ds, "    < 1ms");
+        } else if (i == OVN_LATENCY_N_BUCKETS - 1) {
+            ds_put_format(ds, "    >= %"PRIu64"ms", UINT64_C(1) << (i - 1));
+        } else {
+            ds_put_format(ds, "    [%"PRIu64", %"PRIu64")ms",
+                          UINT64_C(1) << (i - 1), UINT64_C(1) << i);
+        }
+        ds_put_format(ds, ": %"PRIu64"\n", latency->buckets[i]);
+    }
+}
+
 
 struct tnlid_node {
     struct hmap_node hmap_node;
@@ -646,65 +877,143 @@ struct tnlid_node {
 };
 
 void
-ovn_destroy_tnlids(struct hmap *tnlids)
+ovn_tnlids_init(struct ovn_tnlids *tnlids, uint32_t min, uint32_t max)
+{
+    ovs_assert(min <= max);
+    tnlids->min = min;
+    tnlids->max = max;
+    hbitmap_init(&tnlids->used, 0);
+    hmap_init(&tnlids->others);
+}
+
+void
+ovn_destroy_tnlids(struct ovn_tnlids *tnlids)
 {
     struct tnlid_node *node;
-    HMAP_FOR_EACH_POP (node, hmap_node, tnlids) {
+    HMAP_FOR_EACH_POP (node, hmap_node, &tnlids->others) {
         free(node);
     }
-    hmap_destroy(tnlids);
+    hmap_destroy(&tnlids->others);
+    hbitmap_destroy(&tnlids->used);
 }
 
-/* Returns true if 'tnlid' is present in the hmap 'tnlids'. */
-bool
-ovn_tnlid_present(struct hmap *tnlids, uint32_t tnlid)
+static bool
+tnlid_in_range(const struct ovn_tnlids *tnlids, uint32_t tnlid)
+{
+    return tnlid >= tnlids->min && tnlid <= tnlids->max;
+}
+
+static struct tnlid_node *
+tnlid_find_other(const struct ovn_tnlids *tnlids, uint32_t tnlid)
 {
     uint32_t hash = hash_int(tnlid, 0);
     struct tnlid_node *node;
-    HMAP_FOR_EACH_IN_BUCKET (node, hmap_node, hash, tnlids) {
+    HMAP_FOR_EACH_IN_BUCKET (node, hmap_node, hash, &tnlids->others) {
         if (node->tnlid == tnlid) {
-            return true;
+            return node;
         }
     }
+    return NULL;
+}
 
-    return false;
+/* Returns true if 'tnlid' is present in 'tnlids'. */
+bool
+ovn_tnlid_present(const struct ovn_tnlids *tnlids, uint32_t tnlid)
+{
+    if (!tnlid_in_range(tnlids, tnlid)) {
+        return tnlid_find_other(tnlids, tnlid) != NULL;
+    }
+
+    size_t idx = tnlid - tnlids->min;
+    return idx < tnlids->used.n_bits && hbitmap_is_set(&tnlids->used, idx);
 }
 
 bool
-ovn_add_tnlid(struct hmap *set, uint32_t tnlid)
+ovn_add_tnlid(struct ovn_tnlids *set, uint32_t tnlid)
 {
     if (ovn_tnlid_present(set, tnlid)) {
         return false;
     }
 
-    uint32_t hash = hash_int(tnlid, 0);
-    struct tnlid_node *node = xmalloc(sizeof *node);
-    hmap_insert(set, &node->hmap_node, hash);
-    node->tnlid = tnlid;
+    if (!tnlid_in_range(set, tnlid)) {
+        uint32_t hash = hash_int(tnlid, 0);
+        struct tnlid_node *node = xmalloc(sizeof *node);
+        hmap_insert(&set->others, &node->hmap_node, hash);
+        node->tnlid = tnlid;
+        return true;
+    }
+
+    size_t idx = tnlid - set->min;
+    if (idx >= set->used.n_bits) {
+        /* Grow geometrically, so that adding keys in increasing order, which
+         * is the common case, costs amortized O(1). */
+        size_t range = (size_t) set->max - set->min + 1;
+        size_t n_bits = MAX(2 * set->used.n_bits, idx + 1);
+        n_bits = MIN(MAX(n_bits, BITMAP_ULONG_BITS), range);
+        hbitmap_grow(&set->used, n_bits);
+    }
+    hbitmap_set1(&set->used, idx);
     return true;
 }
 
+/* Looks for an unused key in [start, end], which must be within the range of
+ * 'set'.  Returns true and stores it in '*tnlid' if there is one. */
+static bool
+tnlid_find_unused(const struct ovn_tnlids *set, uint32_t start, uint32_t end,
+                  uint32_t *tnlid)
+{
+    size_t first = start - set->min;
+    size_t last = end - set->min;
+    size_t n_bits = set->used.n_bits;
+
+    if (first >= n_bits) {
+        *tnlid = start;
+        return true;
+    }
+
+    size_t scan_end = MIN(last + 1, n_bits);
+    size_t idx = hbitmap_scan0(&set->used, first, scan_end);
+    if (idx < scan_end) {
+        *tnlid = set->min + idx;
+        return true;
+    }
+    if (n_bits <= last) {
+        /* Keys beyond the end of the bitmap are not in use. */
+        *tnlid = set->min + n_bits;
+        return true;
+    }
+    return false;
+}
+
 static uint32_t
 next_tnlid(uint32_t tnlid, uint32_t min, uint32_t max)
 {
     return tnlid + 1 <= max ? tnlid + 1 : min;
 }
 
+/* Allocates an unused key in [min, max], which must be within the range that
+ * 'set' was initialized with, and adds it to 'set'.  Keys are allocated in a
+ * round-robin fashion starting right after '*hint', which is updated to the
+ * allocated key.  Returns 0 if all the keys are in use. */
 uint32_t
-ovn_allocate_tnlid(struct hmap *set, const char *name, uint32_t min,
+ovn_allocate_tnlid(struct ovn_tnlids *set, const char *name, uint32_t min,
                    uint32_t max, uint32_t *hint)
 {
+    ovs_assert(min >= set->min && max <= set->max && min <= max);
+
     /* Normalize hint, because it can be outside of [min, max]. */
     *hint = next_tnlid(*hint, min, max);
+    if (*hint < min) {
+        *hint = min;
+    }
 
-    uint32_t tnlid = *hint;
-    do {
-        if (ovn_add_tnlid(set, tnlid)) {
-            *hint = tnlid;
-            return tnlid;
-        }
-        tnlid = next_tnlid(tnlid, min, max);
-    } while (tnlid != *hint);
+    uint32_t tnlid;
+    if (tnlid_find_unused(set, *hint, max, &tnlid)
+        || (*hint > min && tnlid_find_unused(set, min, *hint - 1, &tnlid))) {
+        ovn_add_tnlid(set, tnlid);
+        *hint = tnlid;
+        return tnlid;
+    }
 
     static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
     VLOG_WARN_RL(&rl, "all %s tunnel ids exhausted", name);
@@ -712,18 +1021,23 @@ ovn_allocate_tnlid(struct hmap *set, const char *name, uint32_t min,
 }
 
 bool
-ovn_free_tnlid(struct hmap *tnlids, uint32_t tnlid)
+ovn_free_tnlid(struct ovn_tnlids *tnlids, uint32_t tnlid)
 {
-    uint32_t hash = hash_int(tnlid, 0);
-    struct tnlid_node *node;
-    HMAP_FOR_EACH_IN_BUCKET (node, hmap_node, hash, tnlids) {
-        if (node->tnlid == tnlid) {
-            hmap_remove(tnlids, &node->hmap_node);
+    if (!tnlid_in_range(tnlids, tnlid)) {
+        struct tnlid_node *node = tnlid_find_other(tnlids, tnlid);
+        if (node) {
+            hmap_remove(&tnlids->others, &node->hmap_node);
             free(node);
             return true;
         }
+        return false;
     }
-    return false;
+
+    if (!ovn_tnlid_present(tnlids, tnlid)) {
+        return false;
+    }
+    hbitmap_set0(&tnlids->used, tnlid - tnlids->min);
+    return true;
 }
 
 char *
@@ -939,16 +1253,16 @@ daemon_started_recently(void)
 }
 
 /* Builds a unique address set compatible name ([a-zA-Z_.][a-zA-Z_.0-9]*)
- * for the router's load balancer VIP address set, combining the logical
- * router's datapath tunnel key and address family.
+ * for one of the router's generated address sets, 'kind', combining the
+ * logical router's datapath tunnel key and address family.
  *
  * Also prefixes the name with 'prefix'.
  */
 static char *
-lr_lb_address_set_name_(uint32_t lr_tunnel_key, const char *prefix,
-                        int addr_family)
+lr_address_set_name_(uint32_t lr_tunnel_key, const char *prefix,
+                     const char *kind, int addr_family)
 {
-    return xasprintf("%s_rtr_lb_%"PRIu32"_ip%s", prefix, lr_tunnel_key,
+    return xasprintf("%s_rtr_%s_%"PRIu32"_ip%s", prefix, kind, lr_tunnel_key,
                      addr_family == AF_INET ? "4" : "6");
 }
 
@@ -956,7 +1270,7 @@ lr_lb_address_set_name_(uint32_t lr_tunnel_key, const char *prefix,
 char *
 lr_lb_address_set_name(uint32_t lr_tunnel_key, int addr_family)
 {
-    return lr_lb_address_set_name_(lr_tunnel_key, "", addr_family);
+    return lr_address_set_name_(lr_tunnel_key, "", "lb", addr_family);
 }
 
 /* Builds a string that refers to the the router's load balancer VIP address
@@ -965,7 +1279,23 @@ lr_lb_address_set_name(uint32_t lr_tunnel_key, int addr_family)
 char *
 lr_lb_address_set_ref(uint32_t lr_tunnel_key, int addr_family)
 {
-    return lr_lb_address_set_name_(lr_tunnel_key, "$", addr_family);
+    return lr_address_set_name_(lr_tunnel_key, "$", "lb", addr_family);
+}
+
+/* Builds the name of the address set of the router's NAT external IPs that
+ * ARP requests and IPv6 NS are forwarded to the router for. */
+char *
+lr_nat_address_set_name(uint32_t lr_tunnel_key, int addr_family)
+{
+    return lr_address_set_name_(lr_tunnel_key, "", "nat", addr_family);
+}
+
+/* Builds a string that refers to the router's NAT external IP address set
+ * name, that is: $<address_set_name>. */
+char *
+lr_nat_address_set_ref(uint32_t lr_tunnel_key, int addr_family)
+{
+    return lr_address_set_name_(lr_tunnel_key, "$", "nat", addr_family);
 }
 
 static char *
@@ -1259,6 +1589,51 @@ sorted_array_apply_diff(const struct sorted_array *a1,
     }
 }
 
+static int
+compare_strings_cb(const void *a_, const void *b_)
+{
+    const char *const *a = a_;
+    const char *const *b = b_;
+
+    return strcmp(*a, *b);
+}
+
+/* Same as sorted_array_apply_diff(), with the items to add given as sset
+ * 's1', which doesn't need to be sorted first.
+ *
+ * The items of 'a2' that are not in 's1' are removed.  If all the other
+ * items of 's1' are found in 'a2' along the way, which is the common case,
+ * there is nothing to add, otherwise the items of 's1' are looked up in
+ * 'a2' with a binary search.  The items are not reported in sorted order. */
+void
+sset_apply_diff(const struct sset *s1, const struct sorted_array *a2,
+                void (*apply_callback)(const void *arg, const char *item,
+                                       bool add),
+                const void *arg)
+{
+    size_t n_found = 0;
+
+    for (size_t i = 0; i < a2->n; i++) {
+        if (sset_contains(s1, a2->arr[i])) {
+            n_found++;
+        } else {
+            apply_callback(arg, a2->arr[i], false);
+        }
+    }
+
+    if (n_found == sset_count(s1)) {
+        return;
+    }
+
+    const char *item;
+    SSET_FOR_EACH (item, s1) {
+        if (!bsearch(&item, a2->arr, a2->n, sizeof *a2->arr,
+                     compare_strings_cb)) {
+            apply_callback(arg, item, true);
+        }
+    }
+}
+
 /* Call for the unixctl command that will store the connection and
  * set the appropriate conditions. */
 void
@@ -1290,6 +1665,28 @@ ovn_exit_args_finish(struct ovn_exit_args *exit_args)
     free(exit_args->conns);
 }
 
+/* Parses the optional "[OFFSET [LIMIT]]" arguments of a unixctl command,
+ * in argv[1] and argv[2], into 'page'.  Returns an error message if they are
+ * invalid, which the caller must free. */
+char *
+ovn_unixctl_page_parse(int argc, const char *argv[],
+                       struct ovn_unixctl_page *page)
+{
+    unsigned int offset = 0;
+    unsigned int limit = UINT_MAX;
+
+    if (argc > 1 && !str_to_uint(argv[1], 10, &offset)) {
+        return xasprintf("%s: invalid offset", argv[1]);
+    }
+    if (argc > 2 && (!str_to_uint(argv[2], 10, &limit) || !limit)) {
+        return xasprintf("%s: invalid limit", argv[2]);
+    }
+
+    page->offset = offset;
+    page->limit = limit == UINT_MAX ? SIZE_MAX : limit;
+    return NULL;
+}
+
 bool
 ovn_update_swconn_at(struct rconn *swconn, const char *target,
                      int probe_interval, const char *where)
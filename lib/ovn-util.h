@@ -17,10 +17,13 @@
 #define OVN_UTIL_H 1
 
 #include "ovsdb-idl.h"
+#include "lib/hbitmap.h"
 #include "lib/packets.h"
+#include "openvswitch/hmap.h"
 #include "lib/sset.h"
 #include "lib/svec.h"
 #include "include/ovn/version.h"
+#include "timeval.h"
 
 #define ovn_set_program_name(name) \
     ovs_set_program_name(name, OVN_PACKAGE_VERSION)
@@ -147,9 +150,59 @@ uint32_t sbrec_logical_flow_hash(const struct sbrec_logical_flow *);
 uint32_t ovn_logical_flow_hash(uint8_t table_id, enum ovn_pipeline pipeline,
                                uint16_t priority,
                                const char *match, const char *actions);
+
+/* A string given as a format and its arguments, e.g. the match or actions
+ * of a logical flow, that is only formatted if it is actually needed.
+ *
+ * The only conversions of 'fmt' are "%s", for the next of 'args', and "%%".
+ * If 'args' is NULL, 'fmt' is a plain string, taken literally.
+ *
+ * ovn_fmt_hash() returns the same hash as hash_string() of the formatted
+ * string, so that a structured string can be looked up among plain ones
+ * without being formatted. */
+struct ovn_fmt {
+    const char *fmt;
+    const char *const *args;
+    size_t n_args;
+};
+
+#define OVN_FMT(FMT, ...)                                                 \
+    ((struct ovn_fmt) {                                                   \
+        .fmt = FMT,                                                       \
+        .args = (const char *const []) { __VA_ARGS__ },                   \
+        .n_args = (sizeof ((const char *const []) { __VA_ARGS__ })        \
+                   / sizeof (const char *)),                              \
+    })
+
+#define OVN_FMT_STR(S) ((struct ovn_fmt) { .fmt = S })
+
+uint32_t ovn_fmt_hash(const struct ovn_fmt *, uint32_t basis);
+bool ovn_fmt_equals(const struct ovn_fmt *, const char *s);
+void ovn_fmt_format(const struct ovn_fmt *, struct ds *);
+uint32_t ovn_logical_flow_fmt_hash(uint8_t table_id,
+                                   enum ovn_pipeline pipeline,
+                                   uint16_t priority,
+                                   const struct ovn_fmt *match,
+                                   const struct ovn_fmt *actions);
 void ovn_conn_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
                    const char *argv[] OVS_UNUSED, void *idl_);
 
+/* Latency histogram.  Bucket 0 counts the samples under 1ms and bucket 'i'
+ * the ones in [2^(i - 1), 2^i) ms.  The last bucket also counts anything
+ * longer. */
+#define OVN_LATENCY_N_BUCKETS 24
+
+struct ovn_latency {
+    uint64_t buckets[OVN_LATENCY_N_BUCKETS];
+    uint64_t count;
+    uint64_t total_msec;
+    uint64_t max_msec;
+};
+
+void ovn_latency_record(struct ovn_latency *, long long int msec);
+void ovn_latency_format(const struct ovn_latency *, const char *name,
+                        struct ds *);
+
 void set_idl_probe_interval(struct ovsdb_idl *idl, const char *remote,
                             int interval);
 
@@ -163,13 +216,27 @@ void set_idl_probe_interval(struct ovsdb_idl *idl, const char *remote,
 #define OVN_MAX_DP_VXLAN_KEY ((1u << 12) - 1)
 #define OVN_MAX_DP_VXLAN_KEY_LOCAL (OVN_MAX_DP_KEY - OVN_MAX_DP_GLOBAL_NUM)
 
-struct hmap;
-void ovn_destroy_tnlids(struct hmap *tnlids);
-bool ovn_add_tnlid(struct hmap *set, uint32_t tnlid);
-bool ovn_tnlid_present(struct hmap *tnlids, uint32_t tnlid);
-uint32_t ovn_allocate_tnlid(struct hmap *set, const char *name, uint32_t min,
-                            uint32_t max, uint32_t *hint);
-bool ovn_free_tnlid(struct hmap *tnlids, uint32_t tnlid);
+/* A set of tunnel keys in use.
+ *
+ * Keys in [min, max], the range that keys are allocated from, are kept in a
+ * hierarchical bitmap, so that finding a free key is O(log n) even when the
+ * key space is dense.  The bitmap only grows up to the highest key in use,
+ * so sparse sets stay small.  Keys outside of that range, e.g., explicitly
+ * requested ones, are kept in a hash map. */
+struct ovn_tnlids {
+    uint32_t min;
+    uint32_t max;
+    struct hbitmap used;   /* Bit 'i' is set if key 'min + i' is in use. */
+    struct hmap others;    /* Contains "struct tnlid_node"s. */
+};
+
+void ovn_tnlids_init(struct ovn_tnlids *, uint32_t min, uint32_t max);
+void ovn_destroy_tnlids(struct ovn_tnlids *tnlids);
+bool ovn_add_tnlid(struct ovn_tnlids *set, uint32_t tnlid);
+bool ovn_tnlid_present(const struct ovn_tnlids *tnlids, uint32_t tnlid);
+uint32_t ovn_allocate_tnlid(struct ovn_tnlids *set, const char *name,
+                            uint32_t min, uint32_t max, uint32_t *hint);
+bool ovn_free_tnlid(struct ovn_tnlids *tnlids, uint32_t tnlid);
 
 static inline void
 get_unique_lport_key(uint64_t dp_tunnel_key, uint64_t lport_tunnel_key,
@@ -346,6 +413,8 @@ int64_t daemon_startup_ts(void);
 
 char *lr_lb_address_set_name(uint32_t lr_tunnel_key, int addr_family);
 char *lr_lb_address_set_ref(uint32_t lr_tunnel_key, int addr_family);
+char *lr_nat_address_set_name(uint32_t lr_tunnel_key, int addr_family);
+char *lr_nat_address_set_ref(uint32_t lr_tunnel_key, int addr_family);
 
 const char *
 get_chassis_external_id_value(const struct smap *,
@@ -465,6 +534,10 @@ void sorted_array_apply_diff(const struct sorted_array *a1,
                                                     const char *item,
                                                     bool add),
                              const void *arg);
+void sset_apply_diff(const struct sset *s1, const struct sorted_array *a2,
+                     void (*apply_callback)(const void *arg,
+                                            const char *item, bool add),
+                     const void *arg);
 
 /* Utilities around properly handling exit command. */
 struct ovn_exit_args {
@@ -481,4 +554,44 @@ void ovn_exit_args_finish(struct ovn_exit_args *exit_args);
 bool ovn_update_swconn_at(struct rconn *swconn, const char *target,
                           int probe_interval, const char *where);
 
+/* A page of the output of a unixctl command that can list many entries, as
+ * selected by its optional "[OFFSET [LIMIT]]" arguments, so that the entries
+ * can be retrieved by chunks instead of formatting all of them at once. */
+struct ovn_unixctl_page {
+    size_t offset;              /* Index of the first entry to list. */
+    size_t limit;               /* Maximum number of entries to list. */
+};
+
+char *ovn_unixctl_page_parse(int argc, const char *argv[],
+                             struct ovn_unixctl_page *)
+    OVS_WARN_UNUSED_RESULT;
+
+/* Returns true if the entry with index 'idx' is part of 'page'. */
+static inline bool
+ovn_unixctl_page_contains(const struct ovn_unixctl_page *page, size_t idx)
+{
+    return idx >= page->offset && idx - page->offset < page->limit;
+}
+
+/* Returns true if the entry with index 'idx', and all the following ones,
+ * are past the end of 'page'. */
+static inline bool
+ovn_unixctl_page_is_past(const struct ovn_unixctl_page *page, size_t idx)
+{
+    return idx >= page->offset && idx - page->offset >= page->limit;
+}
+
+/* Returns the current time in microseconds if the USDT probes are built in,
+ * see --enable-usdt-probes, and 0 otherwise, so that the durations that are
+ * only passed to the probes cost nothing when they are not. */
+static inline long long int
+ovn_usdt_time_usec(void)
+{
+#ifdef HAVE_USDT_PROBES
+    return time_usec();
+#else
+    return 0;
+#endif
+}
+
 #endif /* OVN_UTIL_H */
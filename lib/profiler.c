@@ -0,0 +1,490 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_BACKTRACE
+#include <execinfo.h>
+#endif
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#include "lib/profiler.h"
+
+#include "hash.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/hmap.h"
+#include "openvswitch/vlog.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "simap.h"
+#include "unixctl.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(profiler);
+
+#if defined(HAVE_BACKTRACE) && !defined(_WIN32)
+#define PROFILER_SUPPORTED 1
+#endif
+
+#define PROFILER_DEFAULT_HZ 99
+#define PROFILER_MAX_HZ 1000
+#define PROFILER_MAX_THREADS 256
+#define PROFILER_MAX_SAMPLES 32768
+#define PROFILER_MAX_FRAMES 32
+
+/* Frames of the signal handler and of the signal trampoline, at the top of
+ * each sampled stack. */
+#define PROFILER_SKIP_FRAMES 2
+
+#define PROFILER_NO_TAG "[untagged]"
+
+/* A registered thread.  'tag' is only written by the thread itself and read
+ * by the signal handler that interrupts it. */
+struct profiler_thread {
+    bool in_use;                /* Protected by 'threads_mutex'. */
+    const char *volatile tag;
+};
+
+/* Slots of the registered threads.  A slot is reused once its thread
+ * unregisters, e.g. when a worker pool is resized.  The signal handler finds
+ * the slot of the thread that it interrupts through 'profiler_self', which
+ * is only set once the slot is initialized. */
+static struct ovs_mutex threads_mutex = OVS_MUTEX_INITIALIZER;
+static struct profiler_thread threads[PROFILER_MAX_THREADS];
+static struct profiler_thread *main_thread;
+
+DEFINE_STATIC_PER_THREAD_DATA(struct profiler_thread *, profiler_self, NULL);
+
+struct profiler_sample {
+    atomic_bool valid;          /* Set once the other members are written. */
+    const char *tag;
+    int n_frames;
+    void *frames[PROFILER_MAX_FRAMES];
+};
+
+/* Allocated on the first start and never freed, so that a signal delivered
+ * after the profiler is stopped doesn't write to freed memory.  Samples are
+ * reserved by incrementing 'n_reserved' and are dropped once it reaches
+ * PROFILER_MAX_SAMPLES. */
+static struct profiler_sample *samples;
+static atomic_count n_reserved = ATOMIC_COUNT_INIT(0);
+static atomic_count n_dropped = ATOMIC_COUNT_INIT(0);
+static atomic_bool profiler_running = ATOMIC_VAR_INIT(false);
+
+/* Registers the calling thread, so that it is sampled by the profiler, or
+ * logs a warning if there are too many threads already.  Registering a
+ * thread more than once has no effect.  A thread that registers must call
+ * ovn_profiler_unregister_thread() before it exits. */
+void
+ovn_profiler_register_thread(void)
+{
+    struct profiler_thread **self = profiler_self_get();
+    struct profiler_thread *slot = NULL;
+
+    if (*self) {
+        return;
+    }
+
+    ovs_mutex_lock(&threads_mutex);
+    for (size_t i = 0; i < PROFILER_MAX_THREADS; i++) {
+        if (!threads[i].in_use) {
+            slot = &threads[i];
+            *slot = (struct profiler_thread) { .in_use = true };
+            break;
+        }
+    }
+    ovs_mutex_unlock(&threads_mutex);
+
+    if (slot) {
+        *self = slot;
+    } else {
+        VLOG_WARN("too many threads, %s will not be profiled",
+                  get_subprogram_name());
+    }
+}
+
+/* Releases the slot of the calling thread, so that a thread that registers
+ * later can reuse it.  Does nothing if the thread isn't registered. */
+void
+ovn_profiler_unregister_thread(void)
+{
+    struct profiler_thread **self = profiler_self_get();
+    struct profiler_thread *slot = *self;
+
+    if (!slot) {
+        return;
+    }
+
+    /* The signal handler stops using the slot from here on. */
+    *self = NULL;
+
+    ovs_mutex_lock(&threads_mutex);
+    *slot = (struct profiler_thread) { .in_use = false };
+    ovs_mutex_unlock(&threads_mutex);
+}
+
+/* Tags the following samples of the calling thread with 'tag', which must
+ * outlive the profiling session, e.g. the name of an engine node, until
+ * the next call.  A NULL 'tag' clears it. */
+void
+ovn_profiler_set_tag(const char *tag)
+{
+    struct profiler_thread *self = *profiler_self_get();
+
+    if (self) {
+        self->tag = tag;
+    }
+}
+
+#ifdef PROFILER_SUPPORTED
+/* Async signal safe, apart from backtrace(), which is called once before
+ * the timer is armed so that it doesn't have to load libgcc from the
+ * handler. */
+static void
+profiler_sigprof_handler(int signr OVS_UNUSED)
+{
+    bool running;
+
+    atomic_read_relaxed(&profiler_running, &running);
+    if (!running) {
+        return;
+    }
+
+    /* Threads that aren't registered, e.g. the ones of the OVS library, are
+     * not sampled.  The _unsafe() variant doesn't allocate the per-thread
+     * data of the threads that never touched it. */
+    struct profiler_thread **selfp = profiler_self_get_unsafe();
+    const struct profiler_thread *self = selfp ? *selfp : NULL;
+    if (!self) {
+        return;
+    }
+
+    unsigned int idx = atomic_count_inc(&n_reserved);
+    if (idx >= PROFILER_MAX_SAMPLES) {
+        atomic_count_inc(&n_dropped);
+        return;
+    }
+
+    int save_errno = errno;
+    struct profiler_sample *sample = &samples[idx];
+    sample->tag = self->tag ? self->tag
+                  : main_thread ? main_thread->tag : NULL;
+    sample->n_frames = backtrace(sample->frames, PROFILER_MAX_FRAMES);
+    atomic_store_explicit(&sample->valid, true, memory_order_release);
+    errno = save_errno;
+}
+
+static void
+profiler_set_timer(unsigned int hz)
+{
+    long int usec = hz ? 1000000 / hz : 0;
+    struct itimerval timer = {
+        .it_interval = { .tv_sec = usec / 1000000,
+                         .tv_usec = usec % 1000000 },
+    };
+
+    timer.it_value = timer.it_interval;
+
+    if (setitimer(ITIMER_PROF, &timer, NULL)) {
+        VLOG_WARN("setitimer failed (%s)", ovs_strerror(errno));
+    }
+}
+#endif
+
+static void
+profiler_start_cmd(struct unixctl_conn *conn, int argc, const char *argv[],
+                   void *arg OVS_UNUSED)
+{
+#ifdef PROFILER_SUPPORTED
+    unsigned int hz = PROFILER_DEFAULT_HZ;
+
+    if (argc > 1 && (!str_to_uint(argv[1], 10, &hz)
+                     || !hz || hz > PROFILER_MAX_HZ)) {
+        unixctl_command_reply_error(conn, "HZ must be between 1 and "
+                                    OVS_STRINGIZE(PROFILER_MAX_HZ));
+        return;
+    }
+
+    atomic_store_relaxed(&profiler_running, false);
+    profiler_set_timer(0);
+
+    if (!samples) {
+        void *frame;
+
+        backtrace(&frame, 1);
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sa_handler = profiler_sigprof_handler;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        if (sigaction(SIGPROF, &sa, NULL)) {
+            unixctl_command_reply_error(conn, ovs_strerror(errno));
+            return;
+        }
+        samples = xcalloc(PROFILER_MAX_SAMPLES, sizeof *samples);
+    }
+
+    for (size_t i = 0; i < PROFILER_MAX_SAMPLES; i++) {
+        atomic_store_relaxed(&samples[i].valid, false);
+    }
+    atomic_count_set(&n_reserved, 0);
+    atomic_count_set(&n_dropped, 0);
+
+    atomic_store_relaxed(&profiler_running, true);
+    profiler_set_timer(hz);
+    VLOG_INFO("profiling at %u Hz", hz);
+    unixctl_command_reply(conn, NULL);
+#else
+    unixctl_command_reply_error(conn, "profiling is not supported on this "
+                                "platform");
+#endif
+}
+
+static void
+profiler_stop_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                  const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+#ifdef PROFILER_SUPPORTED
+    bool running;
+
+    atomic_read_relaxed(&profiler_running, &running);
+    if (running) {
+        profiler_set_timer(0);
+        atomic_store_relaxed(&profiler_running, false);
+        VLOG_INFO("profiling stopped");
+    }
+
+    unsigned int n = atomic_count_get(&n_reserved);
+    char *reply = xasprintf("%u samples, %u dropped",
+                            MIN(n, PROFILER_MAX_SAMPLES),
+                            atomic_count_get(&n_dropped));
+    unixctl_command_reply(conn, reply);
+    free(reply);
+#else
+    unixctl_command_reply_error(conn, "profiling is not supported on this "
+                                "platform");
+#endif
+}
+
+#ifdef PROFILER_SUPPORTED
+struct profiler_symbol {
+    struct hmap_node node;
+    void *addr;
+    char *name;
+};
+
+static struct profiler_symbol *
+profiler_symbol_find(const struct hmap *symbols, void *addr)
+{
+    struct profiler_symbol *symbol;
+
+    HMAP_FOR_EACH_WITH_HASH (symbol, node, hash_pointer(addr, 0), symbols) {
+        if (symbol->addr == addr) {
+            return symbol;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the name of a frame from its backtrace_symbols() description,
+ * "binary(function+offset) [address]" or, for a function that isn't
+ * exported, "binary(+offset) [address]". */
+static char *
+profiler_symbol_name(const char *description, void *addr)
+{
+    const char *open = strchr(description, '(');
+    const char *plus = open ? strchr(open, '+') : NULL;
+    const char *close = plus ? strchr(plus, ')') : NULL;
+
+    if (!close) {
+        return xasprintf("%p", addr);
+    }
+    if (plus > open + 1) {
+        return xmemdup0(open + 1, plus - open - 1);
+    }
+
+    const char *binary = open;
+    while (binary > description && binary[-1] != '/') {
+        binary--;
+    }
+    return xasprintf("%.*s%.*s", (int) (open - binary), binary,
+                     (int) (close - plus), plus);
+}
+
+/* Symbolizes the addresses of all the valid samples at once, so that each
+ * distinct address is only looked up once. */
+static void
+profiler_symbolize(struct hmap *symbols, unsigned int n_samples)
+{
+    size_t n_addrs = 0, allocated_addrs = 0;
+    void **addrs = NULL;
+
+    for (size_t i = 0; i < n_samples; i++) {
+        const struct profiler_sample *sample = &samples[i];
+
+        for (int j = PROFILER_SKIP_FRAMES; j < sample->n_frames; j++) {
+            void *addr = sample->frames[j];
+
+            if (profiler_symbol_find(symbols, addr)) {
+                continue;
+            }
+
+            struct profiler_symbol *symbol = xmalloc(sizeof *symbol);
+            symbol->addr = addr;
+            symbol->name = NULL;
+            hmap_insert(symbols, &symbol->node, hash_pointer(addr, 0));
+
+            if (n_addrs >= allocated_addrs) {
+                addrs = x2nrealloc(addrs, &allocated_addrs, sizeof *addrs);
+            }
+            addrs[n_addrs++] = addr;
+        }
+    }
+
+    char **descriptions = n_addrs ? backtrace_symbols(addrs, n_addrs) : NULL;
+    for (size_t i = 0; i < n_addrs; i++) {
+        struct profiler_symbol *symbol =
+            profiler_symbol_find(symbols, addrs[i]);
+
+        symbol->name = descriptions
+                       ? profiler_symbol_name(descriptions[i], addrs[i])
+                       : xasprintf("%p", addrs[i]);
+    }
+    free(descriptions);
+    free(addrs);
+}
+
+/* Appends to 'out' the samples recorded so far as folded stacks. */
+static void
+profiler_dump_folded(struct ds *out)
+{
+    unsigned int n_samples = MIN(atomic_count_get(&n_reserved),
+                                 PROFILER_MAX_SAMPLES);
+
+    /* Samples still being written are skipped. */
+    for (size_t i = 0; i < n_samples; i++) {
+        bool valid;
+
+        atomic_read_explicit(&samples[i].valid, &valid, memory_order_acquire);
+        if (!valid) {
+            n_samples = i;
+            break;
+        }
+    }
+
+    struct hmap symbols = HMAP_INITIALIZER(&symbols);
+    profiler_symbolize(&symbols, n_samples);
+
+    struct simap stacks = SIMAP_INITIALIZER(&stacks);
+    struct ds stack = DS_EMPTY_INITIALIZER;
+    for (size_t i = 0; i < n_samples; i++) {
+        const struct profiler_sample *sample = &samples[i];
+
+        ds_clear(&stack);
+        ds_put_cstr(&stack, sample->tag ? sample->tag : PROFILER_NO_TAG);
+        for (int j = sample->n_frames - 1; j >= PROFILER_SKIP_FRAMES; j--) {
+            ds_put_format(&stack, ";%s",
+                          profiler_symbol_find(&symbols,
+                                               sample->frames[j])->name);
+        }
+        simap_increase(&stacks, ds_cstr(&stack), 1);
+    }
+    ds_destroy(&stack);
+
+    const struct simap_node **sorted = simap_sort(&stacks);
+    for (size_t i = 0; i < simap_count(&stacks); i++) {
+        ds_put_format(out, "%s %u\n", sorted[i]->name, sorted[i]->data);
+    }
+    free(sorted);
+    simap_destroy(&stacks);
+
+    struct profiler_symbol *symbol;
+    HMAP_FOR_EACH_POP (symbol, node, &symbols) {
+        free(symbol->name);
+        free(symbol);
+    }
+    hmap_destroy(&symbols);
+}
+#endif
+
+static void
+profiler_dump_cmd(struct unixctl_conn *conn, int argc, const char *argv[],
+                  void *arg OVS_UNUSED)
+{
+#ifdef PROFILER_SUPPORTED
+    if (!samples) {
+        unixctl_command_reply_error(conn, "profiler was never started");
+        return;
+    }
+
+    struct ds out = DS_EMPTY_INITIALIZER;
+    profiler_dump_folded(&out);
+
+    if (argc > 1) {
+        FILE *file = fopen(argv[1], "w");
+        if (!file) {
+            char *error = xasprintf("%s: open failed (%s)", argv[1],
+                                    ovs_strerror(errno));
+            unixctl_command_reply_error(conn, error);
+            free(error);
+        } else {
+            fputs(ds_cstr(&out), file);
+            if (fclose(file)) {
+                char *error = xasprintf("%s: write failed (%s)", argv[1],
+                                        ovs_strerror(errno));
+                unixctl_command_reply_error(conn, error);
+                free(error);
+            } else {
+                unixctl_command_reply(conn, NULL);
+            }
+        }
+    } else {
+        unixctl_command_reply(conn, ds_cstr(&out));
+    }
+    ds_destroy(&out);
+#else
+    unixctl_command_reply_error(conn, "profiling is not supported on this "
+                                "platform");
+#endif
+}
+
+/* Registers the calling thread, which must be the main thread, and the
+ * profiler's unixctl commands. */
+void
+ovn_profiler_init(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (!ovsthread_once_start(&once)) {
+        return;
+    }
+
+    ovn_profiler_register_thread();
+    main_thread = *profiler_self_get();
+    unixctl_command_register("profiler/start", "[HZ]", 0, 1,
+                             profiler_start_cmd, NULL);
+    unixctl_command_register("profiler/stop", "", 0, 0,
+                             profiler_stop_cmd, NULL);
+    unixctl_command_register("profiler/dump", "[FILE]", 0, 1,
+                             profiler_dump_cmd, NULL);
+    ovsthread_once_done(&once);
+}
@@ -0,0 +1,51 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVN_PROFILER_H
+#define OVN_PROFILER_H 1
+
+/* Sampling profiler.
+ *
+ * Once started with the "profiler/start" unixctl command, a SIGPROF timer
+ * samples the call stack of the registered threads, i.e. the main thread
+ * and the threads of the worker pools, at a fixed rate of their CPU time.
+ * Each sample is tagged with the name of the engine node that the thread
+ * was running, see ovn_profiler_set_tag(), or, for a worker pool thread
+ * that isn't running a node, the node that the main thread was running,
+ * which is the one that handed the work to the pool.
+ *
+ * The samples are kept in a fixed size buffer, filled from the signal
+ * handler without any locking or allocation, so that keeping the profiler
+ * running costs little more than the sampling itself.  Once the buffer is
+ * full, the following samples are dropped and counted.
+ *
+ * "profiler/dump" prints the samples as folded stacks, one line per
+ * distinct stack with the tag as its root frame, followed by the number of
+ * samples, e.g.:
+ *
+ *     lflow_output;main;engine_run;...;consider_logical_flow 42
+ *
+ * which is the input format of flamegraph.pl.  Functions whose names are
+ * not exported are printed as the binary they belong to and their offset in
+ * it, which addr2line can resolve.
+ *
+ * The profiler needs backtrace(3), without it the unixctl commands fail. */
+
+void ovn_profiler_init(void);
+void ovn_profiler_register_thread(void);
+void ovn_profiler_unregister_thread(void);
+
+void ovn_profiler_set_tag(const char *tag);
+
+#endif /* lib/profiler.h */
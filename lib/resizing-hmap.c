@@ -0,0 +1,126 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "lib/resizing-hmap.h"
+
+#include "coverage.h"
+
+COVERAGE_DEFINE(resizing_hmap_resize);
+
+/* Below this number of nodes, the hmap is simply expanded at once. */
+#define RESIZING_HMAP_MIN_NODES 16384
+
+/* Number of buckets of the old hmap moved on each insertion or removal.
+ * The new hmap can take about as many insertions as there are nodes to move
+ * before it needs to grow in turn, and the old one has about half as many
+ * buckets, so this moves all of them well before that. */
+#define RESIZING_HMAP_STEP 4
+
+void
+resizing_hmap_init(struct resizing_hmap *rhmap)
+{
+    hmap_init(&rhmap->cur);
+    hmap_init(&rhmap->old);
+    rhmap->next_bucket = 0;
+}
+
+void
+resizing_hmap_destroy(struct resizing_hmap *rhmap)
+{
+    hmap_destroy(&rhmap->cur);
+    hmap_destroy(&rhmap->old);
+}
+
+/* Moves the nodes of up to 'n_buckets' buckets of 'rhmap->old' to
+ * 'rhmap->cur', and frees the buckets of 'rhmap->old' once it is empty. */
+static void
+resizing_hmap_step(struct resizing_hmap *rhmap, size_t n_buckets)
+{
+    struct hmap *old = &rhmap->old;
+
+    while (n_buckets-- && !hmap_is_empty(old)) {
+        struct hmap_node *node = old->buckets[rhmap->next_bucket];
+
+        old->buckets[rhmap->next_bucket++] = NULL;
+        while (node) {
+            struct hmap_node *next = node->next;
+
+            old->n--;
+            hmap_insert_fast(&rhmap->cur, node, node->hash);
+            node = next;
+        }
+    }
+
+    if (hmap_is_empty(old) && old->mask) {
+        hmap_destroy(old);
+        hmap_init(old);
+        rhmap->next_bucket = 0;
+    }
+}
+
+static void
+resizing_hmap_start(struct resizing_hmap *rhmap)
+{
+    COVERAGE_INC(resizing_hmap_resize);
+    hmap_swap(&rhmap->cur, &rhmap->old);
+    hmap_reserve(&rhmap->cur, 2 * hmap_count(&rhmap->old));
+    rhmap->next_bucket = 0;
+}
+
+/* Inserts 'node', with the given 'hash', into 'rhmap'.  While a resize is
+ * in progress, the node goes into the same hmap as the other nodes with
+ * 'hash', i.e. into 'rhmap->old' if their bucket wasn't moved yet, so that
+ * resizing_hmap_for_hash() keeps finding all of them. */
+void
+resizing_hmap_insert(struct resizing_hmap *rhmap, struct hmap_node *node,
+                     size_t hash)
+{
+    struct hmap *cur = &rhmap->cur;
+
+    hmap_insert_fast(resizing_hmap_for_hash(rhmap, hash), node, hash);
+    if (rhmap->old.mask) {
+        resizing_hmap_step(rhmap, RESIZING_HMAP_STEP);
+    }
+
+    /* Same growth policy as hmap_insert(). */
+    if (cur->n / 2 > cur->mask) {
+        if (cur->n < RESIZING_HMAP_MIN_NODES) {
+            hmap_expand(cur);
+        } else {
+            resizing_hmap_settle(rhmap);
+            resizing_hmap_start(rhmap);
+        }
+    }
+}
+
+/* Removes 'node' from 'rhmap'.  Does not shrink it. */
+void
+resizing_hmap_remove(struct resizing_hmap *rhmap, struct hmap_node *node)
+{
+    hmap_remove(resizing_hmap_for_hash(rhmap, node->hash), node);
+    if (rhmap->old.mask) {
+        resizing_hmap_step(rhmap, RESIZING_HMAP_STEP);
+    }
+}
+
+/* Completes the resize of 'rhmap' in progress, if any, and returns the hmap
+ * that then contains all its nodes. */
+struct hmap *
+resizing_hmap_settle(struct resizing_hmap *rhmap)
+{
+    resizing_hmap_step(rhmap, SIZE_MAX);
+    return &rhmap->cur;
+}
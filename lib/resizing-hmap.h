@@ -0,0 +1,87 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVN_RESIZING_HMAP_H
+#define OVN_RESIZING_HMAP_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "openvswitch/hmap.h"
+#include "openvswitch/util.h"
+
+/* Hash map that grows incrementally.
+ *
+ * When an hmap with millions of nodes grows, hmap_insert() rehashes all of
+ * them at once into a new bucket array, which blocks the caller for a long
+ * time.  Once large enough, a resizing_hmap instead allocates the new
+ * bucket array and moves the nodes of a few buckets of the old one on each
+ * insertion or removal, so that the rehash is spread across them.
+ *
+ * The nodes are plain "struct hmap_node"s.  All the nodes with a given hash
+ * are in the same hmap, returned by resizing_hmap_for_hash(), which can be
+ * used with HMAP_FOR_EACH_WITH_HASH and the like, but not to insert or
+ * remove nodes.  To iterate over all the nodes, use the hmap returned by
+ * resizing_hmap_settle(), which completes the resize in progress if any:
+ * that costs no more than the iteration itself.  The nodes may be removed
+ * from it during the iteration, with resizing_hmap_remove(), but not
+ * inserted. */
+struct resizing_hmap {
+    struct hmap cur;            /* Nodes of the buckets already moved. */
+    struct hmap old;            /* Nodes of the buckets not yet moved. */
+    size_t next_bucket;         /* Next bucket of 'old' to move. */
+};
+
+#define RESIZING_HMAP_INITIALIZER(RHMAP)                \
+    { .cur = HMAP_INITIALIZER(&(RHMAP)->cur),           \
+      .old = HMAP_INITIALIZER(&(RHMAP)->old) }
+
+void resizing_hmap_init(struct resizing_hmap *);
+void resizing_hmap_destroy(struct resizing_hmap *);
+
+void resizing_hmap_insert(struct resizing_hmap *, struct hmap_node *,
+                          size_t hash);
+void resizing_hmap_remove(struct resizing_hmap *, struct hmap_node *);
+struct hmap *resizing_hmap_settle(struct resizing_hmap *);
+
+static inline bool
+resizing_hmap_is_resizing(const struct resizing_hmap *rhmap)
+{
+    return !hmap_is_empty(&rhmap->old);
+}
+
+/* Returns the hmap that contains the nodes of 'rhmap' with 'hash'. */
+static inline struct hmap *
+resizing_hmap_for_hash(const struct resizing_hmap *rhmap, size_t hash)
+{
+    return CONST_CAST(struct hmap *,
+                      resizing_hmap_is_resizing(rhmap)
+                      && (hash & rhmap->old.mask) >= rhmap->next_bucket
+                      ? &rhmap->old
+                      : &rhmap->cur);
+}
+
+static inline size_t
+resizing_hmap_count(const struct resizing_hmap *rhmap)
+{
+    return hmap_count(&rhmap->cur) + hmap_count(&rhmap->old);
+}
+
+static inline bool
+resizing_hmap_is_empty(const struct resizing_hmap *rhmap)
+{
+    return !resizing_hmap_count(rhmap);
+}
+
+#endif /* OVN_RESIZING_HMAP_H */
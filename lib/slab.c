@@ -0,0 +1,283 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "lib/slab.h"
+
+#include "coverage.h"
+#include "openvswitch/vlog.h"
+#include "ovs-atomic.h"
+#include "simap.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(slab);
+
+COVERAGE_DEFINE(slab_chunk_alloc);
+COVERAGE_DEFINE(slab_chunk_free);
+
+/* Size and alignment of a chunk, the size of a huge page on most
+ * architectures. */
+#define SLAB_CHUNK_SIZE (2 * 1024 * 1024)
+
+/* Header at the start of each chunk, followed by its objects. */
+struct slab_chunk {
+    struct ovs_list list_node;  /* In 'partial' or 'full' of its slab. */
+    void *free_objs;            /* Freed objects, linked through their first
+                                 * bytes. */
+    size_t n_used;              /* Allocated objects. */
+    size_t n_carved;            /* Objects ever allocated, the ones that
+                                 * follow were never used. */
+    bool huge;                  /* Mapped from hugetlbfs. */
+};
+
+#define SLAB_OBJS_OFS ROUND_UP(sizeof(struct slab_chunk), CACHE_LINE_SIZE)
+
+/* Set once, before any allocation. */
+static bool slab_enabled;
+static bool slab_huge_pages;
+static atomic_bool slab_used = ATOMIC_VAR_INIT(false);
+
+static struct ovs_mutex all_slabs_mutex = OVS_MUTEX_INITIALIZER;
+static struct ovs_list all_slabs OVS_GUARDED_BY(all_slabs_mutex)
+    = OVS_LIST_INITIALIZER(&all_slabs);
+
+/* Makes the following allocations of all the slabs go through the slab
+ * allocator, with chunks backed by huge pages if 'huge_pages' is true.
+ *
+ * Huge pages are taken from the hugetlbfs pool if it has any, otherwise the
+ * chunks are aligned on their size and the kernel is asked to back them with
+ * transparent huge pages.  Either way, their pages are allocated on the NUMA
+ * node of the thread that first touches them, i.e. that allocates the chunk.
+ *
+ * Must be called before any object is allocated from a slab, e.g. when
+ * parsing the command line. */
+void
+ovn_slab_enable(bool huge_pages)
+{
+    bool used;
+
+    atomic_read_relaxed(&slab_used, &used);
+    ovs_assert(!used);
+    slab_enabled = true;
+    slab_huge_pages = huge_pages;
+}
+
+bool
+ovn_slab_is_enabled(void)
+{
+    return slab_enabled;
+}
+
+static struct slab_chunk *
+slab_chunk_of(const void *obj)
+{
+    return (struct slab_chunk *) ((uintptr_t) obj
+                                  & ~(uintptr_t) (SLAB_CHUNK_SIZE - 1));
+}
+
+static size_t
+slab_objs_per_chunk(const struct ovn_slab *slab)
+{
+    return (SLAB_CHUNK_SIZE - SLAB_OBJS_OFS) / slab->obj_size;
+}
+
+static void *
+slab_map_huge_chunk(void)
+{
+#if defined(MAP_HUGETLB) && !defined(_WIN32)
+    void *p = mmap(NULL, SLAB_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_INFO_RL(&rl, "failed to map huge pages (%s), falling back to "
+                     "transparent huge pages", ovs_strerror(errno));
+        return NULL;
+    }
+    if ((uintptr_t) p & (SLAB_CHUNK_SIZE - 1)) {
+        /* The default huge page size is smaller than a chunk. */
+        munmap(p, SLAB_CHUNK_SIZE);
+        return NULL;
+    }
+    return p;
+#else
+    return NULL;
+#endif
+}
+
+static struct slab_chunk *
+slab_chunk_create(struct ovn_slab *slab)
+    OVS_REQUIRES(slab->mutex)
+{
+    void *p = slab_huge_pages ? slab_map_huge_chunk() : NULL;
+    bool huge = p != NULL;
+
+    if (!p) {
+        p = xmalloc_size_align(SLAB_CHUNK_SIZE, SLAB_CHUNK_SIZE);
+#if defined(MADV_HUGEPAGE) && !defined(_WIN32)
+        if (slab_huge_pages) {
+            madvise(p, SLAB_CHUNK_SIZE, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    COVERAGE_INC(slab_chunk_alloc);
+
+    struct slab_chunk *chunk = p;
+    *chunk = (struct slab_chunk) { .huge = huge };
+    ovs_list_push_front(&slab->partial, &chunk->list_node);
+    slab->n_chunks++;
+    slab->n_huge_chunks += huge;
+
+    if (ovs_list_is_empty(&slab->list_node)) {
+        ovs_mutex_lock(&all_slabs_mutex);
+        ovs_list_push_back(&all_slabs, &slab->list_node);
+        ovs_mutex_unlock(&all_slabs_mutex);
+    }
+    return chunk;
+}
+
+static void
+slab_chunk_destroy(struct ovn_slab *slab, struct slab_chunk *chunk)
+    OVS_REQUIRES(slab->mutex)
+{
+    ovs_list_remove(&chunk->list_node);
+    slab->n_chunks--;
+    COVERAGE_INC(slab_chunk_free);
+#if defined(MAP_HUGETLB) && !defined(_WIN32)
+    if (chunk->huge) {
+        slab->n_huge_chunks--;
+        munmap(chunk, SLAB_CHUNK_SIZE);
+        return;
+    }
+#endif
+    free_size_align(chunk);
+}
+
+/* Returns a new object of 'slab''s size, which must be freed with
+ * ovn_slab_free(). */
+void *
+ovn_slab_alloc(struct ovn_slab *slab)
+{
+    if (!slab_enabled) {
+        bool used;
+
+        /* Only write the flag once, so that its cache line is not bounced
+         * between the threads that allocate. */
+        atomic_read_relaxed(&slab_used, &used);
+        if (!used) {
+            atomic_store_relaxed(&slab_used, true);
+        }
+        return xmalloc(slab->obj_size);
+    }
+
+    ovs_mutex_lock(&slab->mutex);
+    struct slab_chunk *chunk;
+    if (ovs_list_is_empty(&slab->partial)) {
+        chunk = slab_chunk_create(slab);
+    } else {
+        chunk = CONTAINER_OF(ovs_list_front(&slab->partial),
+                             struct slab_chunk, list_node);
+    }
+
+    void *obj = chunk->free_objs;
+    if (obj) {
+        chunk->free_objs = *(void **) obj;
+    } else {
+        obj = (char *) chunk + SLAB_OBJS_OFS
+              + chunk->n_carved++ * slab->obj_size;
+    }
+    if (++chunk->n_used == slab_objs_per_chunk(slab)) {
+        ovs_list_remove(&chunk->list_node);
+        ovs_list_push_back(&slab->full, &chunk->list_node);
+    }
+    slab->n_objs++;
+    ovs_mutex_unlock(&slab->mutex);
+
+    return obj;
+}
+
+void *
+ovn_slab_zalloc(struct ovn_slab *slab)
+{
+    void *obj = ovn_slab_alloc(slab);
+    memset(obj, 0, slab->obj_size);
+    return obj;
+}
+
+/* Frees 'obj', which was allocated from 'slab', if it is nonnull.  A chunk
+ * is released once all its objects are free, unless it is the only chunk of
+ * 'slab' with free objects, so that allocating and freeing an object in turn
+ * doesn't allocate and release a chunk each time. */
+void
+ovn_slab_free(struct ovn_slab *slab, void *obj)
+{
+    if (!obj) {
+        return;
+    }
+    if (!slab_enabled) {
+        free(obj);
+        return;
+    }
+
+    struct slab_chunk *chunk = slab_chunk_of(obj);
+
+    ovs_mutex_lock(&slab->mutex);
+    *(void **) obj = chunk->free_objs;
+    chunk->free_objs = obj;
+    if (chunk->n_used-- == slab_objs_per_chunk(slab)) {
+        ovs_list_remove(&chunk->list_node);
+        ovs_list_push_front(&slab->partial, &chunk->list_node);
+    }
+    if (!chunk->n_used && !ovs_list_is_short(&slab->partial)) {
+        slab_chunk_destroy(slab, chunk);
+    }
+    slab->n_objs--;
+    ovs_mutex_unlock(&slab->mutex);
+}
+
+/* Adds to 'usage' the number of objects and the memory, in KB, of each slab
+ * that has been used, and the memory taken from the hugetlbfs pool. */
+void
+ovn_slab_get_memory_usage(struct simap *usage)
+{
+    size_t n_huge_chunks = 0;
+    struct ovn_slab *slab;
+
+    ovs_mutex_lock(&all_slabs_mutex);
+    LIST_FOR_EACH (slab, list_node, &all_slabs) {
+        ovs_mutex_lock(&slab->mutex);
+        char *key = xasprintf("slab-%s-objs", slab->name);
+        simap_increase(usage, key, slab->n_objs);
+        free(key);
+
+        key = xasprintf("slab-%s-KB", slab->name);
+        simap_increase(usage, key, slab->n_chunks * (SLAB_CHUNK_SIZE / 1024));
+        free(key);
+
+        n_huge_chunks += slab->n_huge_chunks;
+        ovs_mutex_unlock(&slab->mutex);
+    }
+    ovs_mutex_unlock(&all_slabs_mutex);
+
+    if (slab_huge_pages) {
+        simap_increase(usage, "slab-huge-pages-KB",
+                       n_huge_chunks * (SLAB_CHUNK_SIZE / 1024));
+    }
+}
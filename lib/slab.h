@@ -0,0 +1,91 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVN_SLAB_H
+#define OVN_SLAB_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "openvswitch/list.h"
+#include "openvswitch/thread.h"
+#include "openvswitch/util.h"
+
+struct simap;
+
+/* Allocator of fixed-size objects.
+ *
+ * The tables of logical and OpenFlow flows hold millions of small objects of
+ * a handful of types.  Allocated with malloc(), each of them has its own
+ * header and the objects of a table end up scattered over the heap, among
+ * objects of other types and sizes, so that walking a table misses the TLB
+ * on almost every object.
+ *
+ * A slab carves the objects of a single type out of 2 MB chunks, aligned on
+ * their size, so that they can be backed by huge pages, see
+ * ovn_slab_enable().  The slab allocator is disabled by default, in which
+ * case ovn_slab_alloc() and ovn_slab_free() are just wrappers of xmalloc()
+ * and free().
+ *
+ * A slab may be used from several threads at once, but each allocation and
+ * free takes the slab's mutex, so it doesn't suit objects that several
+ * threads allocate at a high rate, e.g. the logical flows of the parallel
+ * build of ovn-northd.
+ *
+ * Usage:
+ *
+ *     static struct ovn_slab foo_slab =
+ *         OVN_SLAB_INITIALIZER(foo_slab, "foo", sizeof(struct foo));
+ *
+ *     struct foo *foo = ovn_slab_alloc(&foo_slab);
+ *     ...
+ *     ovn_slab_free(&foo_slab, foo);
+ */
+struct ovn_slab {
+    const char *name;           /* For ovn_slab_get_memory_usage(). */
+    size_t obj_size;
+
+    struct ovs_mutex mutex;
+    struct ovs_list partial OVS_GUARDED; /* Chunks with free objects. */
+    struct ovs_list full OVS_GUARDED;    /* Chunks without free objects. */
+    size_t n_chunks OVS_GUARDED;
+    size_t n_huge_chunks OVS_GUARDED;    /* Chunks backed by hugetlbfs. */
+    size_t n_objs OVS_GUARDED;           /* Allocated objects. */
+
+    struct ovs_list list_node;  /* In the list of all slabs, once they have
+                                 * their first chunk. */
+};
+
+/* Objects are aligned on 8 bytes, which is enough for all the types
+ * allocated from slabs, and need to be able to hold a pointer while free. */
+#define OVN_SLAB_INITIALIZER(SLAB, NAME, OBJ_SIZE)                      \
+    {                                                                   \
+        .name = NAME,                                                   \
+        .obj_size = ROUND_UP(MAX(OBJ_SIZE, sizeof(void *)), 8),         \
+        .mutex = OVS_MUTEX_INITIALIZER,                                 \
+        .partial = OVS_LIST_INITIALIZER(&(SLAB).partial),               \
+        .full = OVS_LIST_INITIALIZER(&(SLAB).full),                     \
+        .list_node = OVS_LIST_INITIALIZER(&(SLAB).list_node),           \
+    }
+
+void ovn_slab_enable(bool huge_pages);
+bool ovn_slab_is_enabled(void);
+
+void *ovn_slab_alloc(struct ovn_slab *);
+void *ovn_slab_zalloc(struct ovn_slab *);
+void ovn_slab_free(struct ovn_slab *, void *);
+
+void ovn_slab_get_memory_usage(struct simap *usage);
+
+#endif /* lib/slab.h */
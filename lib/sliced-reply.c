@@ -0,0 +1,200 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "lib/sliced-reply.h"
+
+#include "coverage.h"
+#include "lib/ovn-util.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/list.h"
+#include "openvswitch/poll-loop.h"
+#include "timeval.h"
+#include "unixctl.h"
+#include "util.h"
+
+COVERAGE_DEFINE(sliced_reply_restart);
+COVERAGE_DEFINE(sliced_reply_slice);
+
+/* Time spent formatting by each call to sliced_reply_run(). */
+#define SLICED_REPLY_BUDGET_MSEC 10
+
+/* Number of entries formatted between two checks of the time budget. */
+#define SLICED_REPLY_BATCH 64
+
+/* Number of times a reply starts over before it is formatted at once. */
+#define SLICED_REPLY_MAX_RESTARTS 3
+
+struct sliced_reply {
+    struct ovs_list list_node;      /* In 'sliced_replies'. */
+    struct unixctl_conn *conn;      /* NULL if formatted synchronously. */
+    const struct sliced_reply_class *class;
+    const void *data;
+    struct ovn_unixctl_page page;
+
+    struct ds *out;                 /* Reply being formatted. */
+    size_t out_start;               /* Length of 'out' before the reply. */
+    struct hmap_position pos;       /* Position of the next entry. */
+    size_t idx;                     /* Index of the next entry. */
+    unsigned int n_restarts;
+};
+
+/* Contains "struct sliced_reply"s, in the order they were started. */
+static struct ovs_list sliced_replies = OVS_LIST_INITIALIZER(&sliced_replies);
+
+static void
+sliced_reply_begin(struct sliced_reply *sr)
+{
+    ds_truncate(sr->out, sr->out_start);
+    sr->pos = (struct hmap_position) { 0, 0 };
+    sr->idx = 0;
+    if (sr->class->start) {
+        sr->class->start(sr->data, sr->out);
+    }
+}
+
+static void
+sliced_reply_init(struct sliced_reply *sr,
+                  const struct sliced_reply_class *class, const void *data,
+                  const struct ovn_unixctl_page *page, struct ds *out)
+{
+    *sr = (struct sliced_reply) {
+        .class = class,
+        .data = data,
+        .page = page ? *page : (struct ovn_unixctl_page) { 0, SIZE_MAX },
+        .out = out,
+        .out_start = out->length,
+    };
+    sliced_reply_begin(sr);
+}
+
+/* Formats up to 'n' more entries of 'sr'.  Returns true if the reply is
+ * complete. */
+static bool
+sliced_reply_step(struct sliced_reply *sr, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (ovn_unixctl_page_is_past(&sr->page, sr->idx)) {
+            break;
+        }
+
+        bool in_page = ovn_unixctl_page_contains(&sr->page, sr->idx);
+        if (!sr->class->next(sr->data, &sr->pos, in_page ? sr->out : NULL)) {
+            break;
+        }
+        sr->idx++;
+        if (i + 1 == n) {
+            return false;
+        }
+    }
+
+    if (sr->class->finish) {
+        sr->class->finish(sr->data, sr->out);
+    }
+    return true;
+}
+
+/* Starts replying to 'conn' with the entries of 'data' in 'page', or all of
+ * them if 'page' is NULL, as formatted by 'class'.  The reply is sent by a
+ * later call to sliced_reply_run(), so 'data' must remain valid until then,
+ * or sliced_reply_cancel_all() be called. */
+void
+sliced_reply_start(struct unixctl_conn *conn,
+                   const struct sliced_reply_class *class, const void *data,
+                   const struct ovn_unixctl_page *page)
+{
+    struct sliced_reply *sr = xmalloc(sizeof *sr);
+
+    sliced_reply_init(sr, class, data, page, xmalloc(sizeof *sr->out));
+    sr->conn = conn;
+    ovs_list_push_back(&sliced_replies, &sr->list_node);
+}
+
+/* Formats the entries of 'data' in 'page', or all of them if 'page' is
+ * NULL, into 'reply' at once. */
+void
+sliced_reply_format(const struct sliced_reply_class *class, const void *data,
+                    const struct ovn_unixctl_page *page, struct ds *reply)
+{
+    struct sliced_reply sr;
+
+    sliced_reply_init(&sr, class, data, page, reply);
+    sliced_reply_step(&sr, SIZE_MAX);
+}
+
+static void
+sliced_reply_destroy(struct sliced_reply *sr)
+{
+    ovs_list_remove(&sr->list_node);
+    ds_destroy(sr->out);
+    free(sr->out);
+    free(sr);
+}
+
+/* Formats the next slices of the replies in progress, for a bounded time,
+ * and sends the complete ones.  'data_changed' must be true if the data of
+ * any reply in progress may have changed since the previous call. */
+void
+sliced_reply_run(bool data_changed)
+{
+    long long int deadline = time_msec() + SLICED_REPLY_BUDGET_MSEC;
+    struct sliced_reply *sr;
+
+    LIST_FOR_EACH_SAFE (sr, list_node, &sliced_replies) {
+        if (data_changed && (sr->idx || sr->pos.bucket || sr->pos.offset)) {
+            COVERAGE_INC(sliced_reply_restart);
+            sr->n_restarts++;
+            sliced_reply_begin(sr);
+        }
+
+        bool done;
+        if (sr->n_restarts >= SLICED_REPLY_MAX_RESTARTS) {
+            done = sliced_reply_step(sr, SIZE_MAX);
+        } else if (time_msec() < deadline) {
+            COVERAGE_INC(sliced_reply_slice);
+            do {
+                done = sliced_reply_step(sr, SLICED_REPLY_BATCH);
+            } while (!done && time_msec() < deadline);
+        } else {
+            continue;
+        }
+
+        if (done) {
+            unixctl_command_reply(sr->conn, ds_cstr(sr->out));
+            sliced_reply_destroy(sr);
+        }
+    }
+}
+
+void
+sliced_reply_wait(void)
+{
+    if (!ovs_list_is_empty(&sliced_replies)) {
+        poll_immediate_wake();
+    }
+}
+
+/* Replies to all the commands with replies in progress with the error
+ * 'reason', e.g. because their data is about to be destroyed. */
+void
+sliced_reply_cancel_all(const char *reason)
+{
+    struct sliced_reply *sr;
+
+    LIST_FOR_EACH_SAFE (sr, list_node, &sliced_replies) {
+        unixctl_command_reply_error(sr->conn, reason);
+        sliced_reply_destroy(sr);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OVN_SLICED_REPLY_H
+#define OVN_SLICED_REPLY_H 1
+
+#include <stdbool.h>
+
+#include "openvswitch/hmap.h"
+
+struct ds;
+struct ovn_unixctl_page;
+struct unixctl_conn;
+
+/* Time-sliced replies to unixctl commands.
+ *
+ * Formatting the reply of a command that dumps a large hmap, e.g. the
+ * conntrack zones or the conjunction IDs of a busy chassis, can take long
+ * enough to delay the processing of database and OpenFlow updates.  Such a
+ * command can instead start a sliced reply, which sliced_reply_run(), called
+ * once per main loop iteration, formats for at most a few milliseconds at a
+ * time, resuming where it left off thanks to hmap_at_position().
+ *
+ * The dumped data must not change between slices, so the caller tells
+ * sliced_reply_run() whether it may have, e.g. because the incremental
+ * processing engine updated some nodes, in which case the replies in
+ * progress are started over.  A reply that had to start over too many times
+ * is formatted at once, so that it is not starved by a constantly changing
+ * data set. */
+
+struct sliced_reply_class {
+    /* Formats the beginning of the reply.  Optional. */
+    void (*start)(const void *data, struct ds *reply);
+
+    /* Moves to the entry of 'data' at 'pos', advancing 'pos', and formats
+     * it into 'reply', unless 'reply' is NULL.  Returns false if there are
+     * no more entries. */
+    bool (*next)(const void *data, struct hmap_position *pos,
+                 struct ds *reply);
+
+    /* Formats the end of the reply.  Optional. */
+    void (*finish)(const void *data, struct ds *reply);
+};
+
+void sliced_reply_start(struct unixctl_conn *,
+                        const struct sliced_reply_class *, const void *data,
+                        const struct ovn_unixctl_page *);
+void sliced_reply_format(const struct sliced_reply_class *, const void *data,
+                         const struct ovn_unixctl_page *, struct ds *reply);
+
+void sliced_reply_run(bool data_changed);
+void sliced_reply_wait(void);
+void sliced_reply_cancel_all(const char *reason);
+
+#endif /* OVN_SLICED_REPLY_H */
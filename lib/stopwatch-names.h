@@ -34,5 +34,9 @@
 #define LR_NAT_RUN_STOPWATCH_NAME "lr_nat_run"
 #define LR_STATEFUL_RUN_STOPWATCH_NAME "lr_stateful"
 #define LS_STATEFUL_RUN_STOPWATCH_NAME "ls_stateful"
+#define BUILD_IPAM_STOPWATCH_NAME "build_ipam"
+
+#define IC_PORT_BINDING_RUN_STOPWATCH_NAME "ic_port_binding_run"
+#define IC_ROUTE_RUN_STOPWATCH_NAME "ic_route_run"
 
 #endif
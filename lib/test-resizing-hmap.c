@@ -0,0 +1,121 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "hash.h"
+#include "lib/resizing-hmap.h"
+#include "tests/ovstest.h"
+#include "tests/test-utils.h"
+#include "util.h"
+
+struct test_node {
+    struct hmap_node node;
+    unsigned int value;
+};
+
+/* Pairs of consecutive values share a hash, so that buckets hold several
+ * nodes. */
+static size_t
+test_hash(unsigned int value)
+{
+    return hash_int(value / 2, 0);
+}
+
+static struct test_node *
+test_find(const struct resizing_hmap *rhmap, unsigned int value)
+{
+    size_t hash = test_hash(value);
+    struct test_node *found = NULL;
+    struct test_node *node;
+
+    HMAP_FOR_EACH_WITH_HASH (node, node, hash,
+                             resizing_hmap_for_hash(rhmap, hash)) {
+        if (node->value == value) {
+            ovs_assert(!found);
+            found = node;
+        }
+    }
+    return found;
+}
+
+/* Inserts N nodes and, after each odd one, removes the one before it.
+ * Checks after each operation that the nodes are found, or not, by
+ * resizing_hmap_for_hash(), then that all the nodes left are found by a
+ * full walk. */
+static void
+test_resizing_hmap_operations(struct ovs_cmdl_context *ctx)
+{
+    struct resizing_hmap rhmap = RESIZING_HMAP_INITIALIZER(&rhmap);
+    size_t n_resizing_inserts = 0;
+    size_t n_resizing_removes = 0;
+    unsigned int n;
+
+    if (!test_read_uint_value(ctx, 1, "n_nodes", &n)) {
+        return;
+    }
+
+    struct test_node *nodes = xcalloc(n, sizeof *nodes);
+    for (unsigned int i = 0; i < n; i++) {
+        n_resizing_inserts += resizing_hmap_is_resizing(&rhmap);
+        nodes[i].value = i;
+        resizing_hmap_insert(&rhmap, &nodes[i].node, test_hash(i));
+        ovs_assert(test_find(&rhmap, i) == &nodes[i]);
+
+        if (i % 2) {
+            n_resizing_removes += resizing_hmap_is_resizing(&rhmap);
+            resizing_hmap_remove(&rhmap, &nodes[i - 1].node);
+            ovs_assert(!test_find(&rhmap, i - 1));
+            ovs_assert(test_find(&rhmap, i) == &nodes[i]);
+        }
+    }
+
+    for (unsigned int i = 0; i < n; i++) {
+        ovs_assert(test_find(&rhmap, i)
+                   == (i % 2 || i == n - 1 ? &nodes[i] : NULL));
+    }
+
+    size_t n_found = 0;
+    struct test_node *node;
+    HMAP_FOR_EACH (node, node, resizing_hmap_settle(&rhmap)) {
+        ovs_assert(node == &nodes[node->value]);
+        n_found++;
+    }
+    ovs_assert(n_found == resizing_hmap_count(&rhmap));
+    ovs_assert(!resizing_hmap_is_resizing(&rhmap));
+
+    printf("%"PRIuSIZE" nodes, %s\n", n_found,
+           n_resizing_inserts && n_resizing_removes
+           ? "inserted and removed while resizing"
+           : "never resized");
+
+    resizing_hmap_destroy(&rhmap);
+    free(nodes);
+}
+
+static void
+test_resizing_hmap_main(int argc, char *argv[])
+{
+    set_program_name(argv[0]);
+    static const struct ovs_cmdl_command commands[] = {
+        {"operations", NULL, 1, 1, test_resizing_hmap_operations, OVS_RO},
+        {NULL, NULL, 0, 0, NULL, OVS_RO},
+    };
+    struct ovs_cmdl_context ctx;
+    ctx.argc = argc - 1;
+    ctx.argv = argv + 1;
+    ovs_cmdl_run_command(&ctx, commands);
+}
+
+OVSTEST_REGISTER("test-resizing-hmap", test_resizing_hmap_main);
@@ -46,6 +46,30 @@ AC_DEFUN([OVN_CHECK_COVERAGE],
      OVS_LDFLAGS="$OVS_LDFLAGS --coverage"
    fi])
 
+dnl Checks for --enable-usdt-probes and defines HAVE_USDT_PROBES if it is
+dnl specified, for the OVS_USDT_PROBE() tracepoints.
+AC_DEFUN([OVN_CHECK_USDT],
+  [AC_ARG_ENABLE(
+     [usdt-probes],
+     [AS_HELP_STRING([--enable-usdt-probes],
+                     [Enable User Statically Defined Tracing (USDT) probes])],
+     [case "${enableval}" in
+        (yes) usdt=true ;;
+        (no)  usdt=false ;;
+        (*) AC_MSG_ERROR([bad value ${enableval} for --enable-usdt-probes]) ;;
+      esac],
+     [usdt=false])
+   AC_MSG_CHECKING([whether USDT probes are enabled])
+   if $usdt; then
+     AC_MSG_RESULT([yes])
+     AC_CHECK_HEADER([sys/sdt.h], [],
+       [AC_MSG_ERROR([unable to find sys/sdt.h needed for USDT support])])
+     AC_DEFINE([HAVE_USDT_PROBES], [1],
+               [Define to 1 if USDT probes are enabled.])
+   else
+     AC_MSG_RESULT([no])
+   fi])
+
 dnl Checks for --enable-ndebug and defines NDEBUG if it is specified.
 AC_DEFUN([OVS_CHECK_NDEBUG],
   [AC_ARG_ENABLE(
@@ -16,6 +16,7 @@
 #include <config.h>
 
 #include "en-global-config.h"
+#include "heap.h"
 #include "lib/inc-proc-eng.h"
 #include "lib/ovn-nb-idl.h"
 #include "lib/ovn-sb-idl.h"
@@ -26,6 +27,7 @@
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/util.h"
 #include "openvswitch/vlog.h"
+#include "uuid.h"
 
 VLOG_DEFINE_THIS_MODULE(mac_binding_aging);
 
@@ -62,7 +64,7 @@ struct threshold_entry {
  * "Logical_Router:options:mac_binding_age_threshold".
  *
  * This struct is also used for non-CIDR-based threshold, e.g. the ones from
- * "NB_Global:other_config:fdb_age_threshold" for the common aging_context
+ * "NB_Global:other_config:fdb_age_threshold" for the common aging_index
  * interface.
  *
  * - The arrays `v4_entries` and `v6_entries` are populated with parsed entries
@@ -286,63 +288,229 @@ min_mac_binding_age_threshold(const char *opt)
     return threshold == UINT_MAX ? 0 : threshold;
 }
 
-struct aging_context {
-    int64_t next_wake_ms;
-    int64_t time_wall_now;
-    uint32_t removal_limit;
-    uint32_t n_removed;
-    struct threshold_config *threshold;
+/* Aging index.
+ *
+ * Keeps track of the SB rows subject to aging (MAC_Binding or FDB) ordered
+ * by expiration time, so that an aging pass only needs to look at the rows
+ * that have actually expired instead of walking all of them.  It is built
+ * from scratch when the aging engine node is recomputed and updated
+ * incrementally from the tracked changes of the SB table. */
+struct aging_dp {
+    struct hmap_node hmap_node;   /* In aging_index 'dps', by 'dp_key'. */
+    uint32_t dp_key;              /* Datapath tunnel key. */
+    struct threshold_config threshold;
+};
+
+struct aging_entry {
+    struct hmap_node hmap_node;   /* In aging_index 'entries'. */
+    struct heap_node heap_node;   /* In aging_index 'expiry'. */
+    const struct ovsdb_idl_row *row;
+    int64_t expire_msec;          /* Wall clock time when the row expires. */
 };
 
-static struct aging_context
-aging_context_init(uint32_t removal_limit)
+struct aging_index {
+    struct hmap dps;        /* Contains "struct aging_dp"s. */
+    struct hmap entries;    /* Contains "struct aging_entry"s. */
+    struct heap expiry;     /* Contains "struct aging_entry"s, the one that
+                             * expires first on top. */
+    uint32_t removal_limit; /* Max number of rows removed by a pass, 0 for
+                             * no limit. */
+};
+
+static void
+aging_index_init(struct aging_index *index)
 {
-    struct aging_context ctx = {
-           .next_wake_ms = INT64_MAX,
-           .time_wall_now = time_wall_msec(),
-           .removal_limit = removal_limit,
-           .n_removed = 0,
-           .threshold = NULL,
-    };
-    return ctx;
+    hmap_init(&index->dps);
+    hmap_init(&index->entries);
+    heap_init(&index->expiry);
+    index->removal_limit = 0;
 }
 
 static void
-aging_context_set_threshold(struct aging_context *ctx,
-                            struct threshold_config *threshold)
+aging_index_clear(struct aging_index *index)
 {
-    ctx->threshold = threshold;
+    struct aging_dp *dp;
+    HMAP_FOR_EACH_POP (dp, hmap_node, &index->dps) {
+        threshold_config_destroy(&dp->threshold);
+        free(dp);
+    }
+
+    struct aging_entry *entry;
+    HMAP_FOR_EACH_POP (entry, hmap_node, &index->entries) {
+        free(entry);
+    }
+    heap_destroy(&index->expiry);
+    heap_init(&index->expiry);
 }
 
-static bool
-aging_context_is_at_limit(struct aging_context *ctx)
+static void
+aging_index_destroy(struct aging_index *index)
 {
-    return ctx->removal_limit && ctx->n_removed == ctx->removal_limit;
+    aging_index_clear(index);
+    hmap_destroy(&index->dps);
+    hmap_destroy(&index->entries);
+    heap_destroy(&index->expiry);
 }
 
-static bool
-aging_context_handle_timestamp(struct aging_context *ctx, int64_t timestamp,
-                               const char *ip)
+/* Adds datapath 'dp_key' with the aging 'threshold' to 'index', which takes
+ * ownership of 'threshold'. */
+static void
+aging_index_add_dp(struct aging_index *index, uint32_t dp_key,
+                   struct threshold_config *threshold)
 {
-    int64_t elapsed = ctx->time_wall_now - timestamp;
-    if (elapsed < 0) {
-        return false;
+    struct aging_dp *dp = xmalloc(sizeof *dp);
+    dp->dp_key = dp_key;
+    dp->threshold = *threshold;
+    hmap_insert(&index->dps, &dp->hmap_node, hash_int(dp_key, 0));
+}
+
+static const struct aging_dp *
+aging_index_find_dp(const struct aging_index *index, uint32_t dp_key)
+{
+    struct aging_dp *dp;
+    HMAP_FOR_EACH_WITH_HASH (dp, hmap_node, hash_int(dp_key, 0),
+                             &index->dps) {
+        if (dp->dp_key == dp_key) {
+            return dp;
+        }
+    }
+    return NULL;
+}
+
+static struct aging_entry *
+aging_index_find(const struct aging_index *index,
+                 const struct ovsdb_idl_row *row)
+{
+    struct aging_entry *entry;
+    HMAP_FOR_EACH_WITH_HASH (entry, hmap_node, uuid_hash(&row->uuid),
+                             &index->entries) {
+        if (entry->row == row) {
+            return entry;
+        }
     }
+    return NULL;
+}
 
-    ovs_assert(ctx->threshold);
-    uint64_t threshold = 1000 * find_threshold_for_ip(ip, ctx->threshold);
+static void
+aging_index_remove_entry(struct aging_index *index, struct aging_entry *entry)
+{
+    hmap_remove(&index->entries, &entry->hmap_node);
+    heap_remove(&index->expiry, &entry->heap_node);
+    free(entry);
+}
 
-    if (!threshold) {
-        return false;
+static void
+aging_index_remove(struct aging_index *index, const struct ovsdb_idl_row *row)
+{
+    struct aging_entry *entry = aging_index_find(index, row);
+    if (entry) {
+        aging_index_remove_entry(index, entry);
     }
+}
 
-    if (elapsed >= threshold) {
-        ctx->n_removed++;
-        return true;
+static uint64_t
+aging_expiry_priority(int64_t expire_msec)
+{
+    /* 'heap' is a max-heap, so the earliest expiration gets the highest
+     * priority. */
+    return UINT64_MAX - MAX(expire_msec, 0);
+}
+
+/* Sets the expiration time of 'row' in 'index' to 'expire_msec', adding it
+ * if needed.  If 'expire_msec' is 0 the row is not subject to aging and is
+ * removed from 'index'. */
+static void
+aging_index_update(struct aging_index *index, const struct ovsdb_idl_row *row,
+                   int64_t expire_msec)
+{
+    struct aging_entry *entry = aging_index_find(index, row);
+
+    if (!expire_msec) {
+        if (entry) {
+            aging_index_remove_entry(index, entry);
+        }
+        return;
     }
 
-    ctx->next_wake_ms = MIN(ctx->next_wake_ms, (threshold - elapsed));
-    return false;
+    if (entry) {
+        if (entry->expire_msec != expire_msec) {
+            entry->expire_msec = expire_msec;
+            heap_change(&index->expiry, &entry->heap_node,
+                        aging_expiry_priority(expire_msec));
+        }
+        return;
+    }
+
+    entry = xmalloc(sizeof *entry);
+    entry->row = row;
+    entry->expire_msec = expire_msec;
+    hmap_insert(&index->entries, &entry->hmap_node, uuid_hash(&row->uuid));
+    heap_insert(&index->expiry, &entry->heap_node,
+                aging_expiry_priority(expire_msec));
+}
+
+/* Returns the number of milliseconds until the first entry in 'index'
+ * expires, 0 if it already has, or INT64_MAX if 'index' is empty. */
+static int64_t
+aging_index_next_wake_ms(const struct aging_index *index, int64_t now)
+{
+    if (heap_is_empty(&index->expiry)) {
+        return INT64_MAX;
+    }
+
+    const struct aging_entry *entry =
+        CONTAINER_OF(heap_max(&index->expiry), struct aging_entry, heap_node);
+    return MAX(entry->expire_msec - now, 0);
+}
+
+/* Deletes from the SB, using 'delete_row', all the rows in 'index' that
+ * have expired, up to the removal limit.  Returns the number of rows
+ * deleted and stores in '*next_wake_ms' when the next pass is needed. */
+static uint32_t
+aging_index_run(struct aging_index *index,
+                void (*delete_row)(const struct ovsdb_idl_row *),
+                int64_t *next_wake_ms)
+{
+    int64_t now = time_wall_msec();
+    uint32_t n_removed = 0;
+
+    while (!heap_is_empty(&index->expiry)) {
+        struct aging_entry *entry =
+            CONTAINER_OF(heap_max(&index->expiry), struct aging_entry,
+                         heap_node);
+        if (entry->expire_msec > now) {
+            break;
+        }
+
+        if (index->removal_limit && n_removed == index->removal_limit) {
+            /* Schedule the next run after specified delay. */
+            *next_wake_ms = AGING_BULK_REMOVAL_DELAY_MSEC;
+            return n_removed;
+        }
+
+        delete_row(entry->row);
+        aging_index_remove_entry(index, entry);
+        n_removed++;
+    }
+
+    *next_wake_ms = aging_index_next_wake_ms(index, now);
+    return n_removed;
+}
+
+/* Makes sure that 'waker' fires no later than when the first entry of
+ * 'index' expires. */
+static void
+aging_waker_update(struct aging_waker *waker, const struct aging_index *index)
+{
+    int64_t next_wake_ms = aging_index_next_wake_ms(index, time_wall_msec());
+
+    if (next_wake_ms == INT64_MAX) {
+        return;
+    }
+    if (!waker->should_schedule
+        || time_msec() + next_wake_ms < waker->next_wake_msec) {
+        aging_waker_schedule_next_wake(waker, next_wake_ms);
+    }
 }
 
 static uint32_t
@@ -354,60 +522,94 @@ get_removal_limit(struct engine_node *node, const char *name)
     return smap_get_uint(&global_config->nb_options, name, 0);
 }
 
-/* MAC binding aging */
-static void
-mac_binding_aging_run_for_datapath(const struct sbrec_datapath_binding *dp,
-                                   struct ovsdb_idl_index *mb_by_datapath,
-                                   struct aging_context *ctx)
+/* Returns true if the changes to northd can be ignored by the aging nodes.
+ * The aging thresholds and the datapath tunnel keys only change on a full
+ * recompute of northd, which leaves no tracked data. */
+static bool
+aging_northd_handler(struct engine_node *node)
 {
-    if (!ctx->threshold) {
-        return;
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+
+    return northd_has_tracked_data(&northd_data->trk_data);
+}
+
+/* Handles the global_config changes that only update the removal limit
+ * 'name' of an aging node, the limit is used by the next aging run. */
+static bool
+aging_global_config_handler(struct engine_node *node,
+                            struct aging_index *index, const char *name)
+{
+    if (!node_global_config_handler(node, NULL)) {
+        return false;
     }
 
-    if (!ctx->threshold->n_v4_entries && !ctx->threshold->n_v6_entries
-        && !ctx->threshold->default_threshold) {
-        return;
+    index->removal_limit = get_removal_limit(node, name);
+    return true;
+}
+
+/* MAC binding aging */
+static int64_t
+mac_binding_expire_msec(const struct aging_index *index,
+                        const struct sbrec_mac_binding *mb)
+{
+    if (!mb->datapath) {
+        return 0;
     }
 
-    struct sbrec_mac_binding *mb_index_row =
-        sbrec_mac_binding_index_init_row(mb_by_datapath);
-    sbrec_mac_binding_index_set_datapath(mb_index_row, dp);
+    const struct aging_dp *dp = aging_index_find_dp(index,
+                                                    mb->datapath->tunnel_key);
+    if (!dp) {
+        return 0;
+    }
 
-    const struct sbrec_mac_binding *mb;
-    SBREC_MAC_BINDING_FOR_EACH_EQUAL (mb, mb_index_row, mb_by_datapath) {
-        if (aging_context_handle_timestamp(ctx, mb->timestamp, mb->ip)) {
-            sbrec_mac_binding_delete(mb);
-            if (aging_context_is_at_limit(ctx)) {
-                break;
-            }
-        }
+    uint64_t threshold = 1000 * find_threshold_for_ip(mb->ip, &dp->threshold);
+    if (!threshold) {
+        return 0;
     }
-    sbrec_mac_binding_index_destroy_row(mb_index_row);
+
+    return MAX(mb->timestamp + threshold, 1);
 }
 
-void
-en_mac_binding_aging_run(struct engine_node *node, void *data OVS_UNUSED)
+static void
+mac_binding_delete_row(const struct ovsdb_idl_row *row)
+{
+    sbrec_mac_binding_delete(CONTAINER_OF(row, struct sbrec_mac_binding,
+                                          header_));
+}
+
+/* Runs an aging pass if the MAC binding timestamps are supported and
+ * schedules the next one. */
+static void
+mac_binding_aging_run__(struct engine_node *node, struct aging_index *index)
 {
-    const struct engine_context *eng_ctx = engine_get_context();
-    struct northd_data *northd_data = engine_get_input_data("northd", node);
     struct ed_type_global_config *global_config =
         engine_get_input_data("global_config", node);
-
     struct aging_waker *waker =
         engine_get_input_data("mac_binding_aging_waker", node);
 
-    if (!eng_ctx->ovnsb_idl_txn ||
-        !global_config->features.mac_binding_timestamp ||
-        time_msec() < waker->next_wake_msec) {
+    if (!engine_get_context()->ovnsb_idl_txn
+        || !global_config->features.mac_binding_timestamp) {
         return;
     }
 
-    uint32_t limit = get_removal_limit(node, "mac_binding_removal_limit");
-    struct aging_context ctx = aging_context_init(limit);
+    int64_t next_wake_ms;
+    if (aging_index_run(index, mac_binding_delete_row, &next_wake_ms)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    aging_waker_schedule_next_wake(waker, next_wake_ms);
+}
 
-    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath =
-        engine_ovsdb_node_get_index(engine_get_input("SB_mac_binding", node),
-                                    "sbrec_mac_binding_by_datapath");
+void
+en_mac_binding_aging_run(struct engine_node *node, void *data)
+{
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+    const struct sbrec_mac_binding_table *sbrec_mac_binding_table =
+        EN_OVSDB_GET(engine_get_input("SB_mac_binding", node));
+    struct aging_index *index = data;
+
+    aging_index_clear(index);
+    index->removal_limit = get_removal_limit(node,
+                                             "mac_binding_removal_limit");
 
     struct ovn_datapath *od;
     HMAP_FOR_EACH (od, key_node, &northd_data->lr_datapaths.datapaths) {
@@ -424,35 +626,86 @@ en_mac_binding_aging_run(struct engine_node *node, void *data OVS_UNUSED)
             continue;
         }
 
-        aging_context_set_threshold(&ctx, &threshold_config);
+        if (!threshold_config.n_v4_entries && !threshold_config.n_v6_entries
+            && !threshold_config.default_threshold) {
+            threshold_config_destroy(&threshold_config);
+            continue;
+        }
 
-        mac_binding_aging_run_for_datapath(od->sb,
-                                           sbrec_mac_binding_by_datapath,
-                                           &ctx);
-        threshold_config_destroy(&threshold_config);
+        aging_index_add_dp(index, od->sb->tunnel_key, &threshold_config);
+    }
 
-        if (aging_context_is_at_limit(&ctx)) {
-            /* Schedule the next run after specified delay. */
-            ctx.next_wake_ms = AGING_BULK_REMOVAL_DELAY_MSEC;
-            break;
+    if (!hmap_is_empty(&index->dps)) {
+        const struct sbrec_mac_binding *mb;
+        SBREC_MAC_BINDING_TABLE_FOR_EACH (mb, sbrec_mac_binding_table) {
+            aging_index_update(index, &mb->header_,
+                               mac_binding_expire_msec(index, mb));
         }
     }
 
-    aging_waker_schedule_next_wake(waker, ctx.next_wake_ms);
-
     engine_set_node_state(node, EN_UPDATED);
+    mac_binding_aging_run__(node, index);
 }
 
 void *
 en_mac_binding_aging_init(struct engine_node *node OVS_UNUSED,
                           struct engine_arg *arg OVS_UNUSED)
 {
-    return NULL;
+    struct aging_index *index = xmalloc(sizeof *index);
+
+    aging_index_init(index);
+    return index;
 }
 
 void
-en_mac_binding_aging_cleanup(void *data OVS_UNUSED)
+en_mac_binding_aging_cleanup(void *data)
+{
+    aging_index_destroy(data);
+}
+
+bool
+mac_binding_aging_sb_mac_binding_handler(struct engine_node *node,
+                                         void *data)
+{
+    const struct sbrec_mac_binding_table *sbrec_mac_binding_table =
+        EN_OVSDB_GET(engine_get_input("SB_mac_binding", node));
+    struct aging_waker *waker =
+        engine_get_input_data("mac_binding_aging_waker", node);
+    struct aging_index *index = data;
+
+    const struct sbrec_mac_binding *mb;
+    SBREC_MAC_BINDING_TABLE_FOR_EACH_TRACKED (mb, sbrec_mac_binding_table) {
+        if (sbrec_mac_binding_is_deleted(mb)) {
+            aging_index_remove(index, &mb->header_);
+        } else {
+            aging_index_update(index, &mb->header_,
+                               mac_binding_expire_msec(index, mb));
+        }
+    }
+
+    aging_waker_update(waker, index);
+    return true;
+}
+
+bool
+mac_binding_aging_northd_handler(struct engine_node *node,
+                                 void *data OVS_UNUSED)
 {
+    return aging_northd_handler(node);
+}
+
+bool
+mac_binding_aging_global_config_handler(struct engine_node *node, void *data)
+{
+    return aging_global_config_handler(node, data,
+                                       "mac_binding_removal_limit");
+}
+
+bool
+mac_binding_aging_waker_handler(struct engine_node *node, void *data)
+{
+    mac_binding_aging_run__(node, data);
+    return true;
 }
 
 /* The waker node is an input node, but the data about when to wake up
@@ -499,51 +752,59 @@ en_mac_binding_aging_waker_cleanup(void *data OVS_UNUSED)
 }
 
 /* FDB aging */
-static void
-fdb_run_for_datapath(const struct sbrec_datapath_binding *dp,
-                     struct ovsdb_idl_index *fdb_by_dp_key,
-                     struct aging_context *ctx)
+static int64_t
+fdb_expire_msec(const struct aging_index *index, const struct sbrec_fdb *fdb)
 {
-    if (!ctx->threshold) {
-        return;
+    const struct aging_dp *dp = aging_index_find_dp(index, fdb->dp_key);
+    if (!dp) {
+        return 0;
     }
 
-    struct sbrec_fdb *fdb_index_row = sbrec_fdb_index_init_row(fdb_by_dp_key);
-    sbrec_fdb_index_set_dp_key(fdb_index_row, dp->tunnel_key);
-
-    const struct sbrec_fdb *fdb;
-    SBREC_FDB_FOR_EACH_EQUAL (fdb, fdb_index_row, fdb_by_dp_key) {
-        if (aging_context_handle_timestamp(ctx, fdb->timestamp, NULL)) {
-            sbrec_fdb_delete(fdb);
-            if (aging_context_is_at_limit(ctx)) {
-                break;
-            }
-        }
+    uint64_t threshold = 1000 * find_threshold_for_ip(NULL, &dp->threshold);
+    if (!threshold) {
+        return 0;
     }
-    sbrec_fdb_index_destroy_row(fdb_index_row);
+
+    return MAX(fdb->timestamp + threshold, 1);
 }
 
-void
-en_fdb_aging_run(struct engine_node *node, void *data OVS_UNUSED)
+static void
+fdb_delete_row(const struct ovsdb_idl_row *row)
+{
+    sbrec_fdb_delete(CONTAINER_OF(row, struct sbrec_fdb, header_));
+}
+
+/* Runs an aging pass if the FDB timestamps are supported and schedules the
+ * next one. */
+static void
+fdb_aging_run__(struct engine_node *node, struct aging_index *index)
 {
-    const struct engine_context *eng_ctx = engine_get_context();
-    struct northd_data *northd_data = engine_get_input_data("northd", node);
-    struct aging_waker *waker = engine_get_input_data("fdb_aging_waker", node);
     struct ed_type_global_config *global_config =
         engine_get_input_data("global_config", node);
+    struct aging_waker *waker = engine_get_input_data("fdb_aging_waker", node);
 
-    if (!eng_ctx->ovnsb_idl_txn ||
-        !global_config->features.fdb_timestamp ||
-        time_msec() < waker->next_wake_msec) {
+    if (!engine_get_context()->ovnsb_idl_txn
+        || !global_config->features.fdb_timestamp) {
         return;
     }
 
-    uint32_t limit = get_removal_limit(node, "fdb_removal_limit");
-    struct aging_context ctx = aging_context_init(limit);
+    int64_t next_wake_ms;
+    if (aging_index_run(index, fdb_delete_row, &next_wake_ms)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    aging_waker_schedule_next_wake(waker, next_wake_ms);
+}
+
+void
+en_fdb_aging_run(struct engine_node *node, void *data)
+{
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+    const struct sbrec_fdb_table *sbrec_fdb_table =
+        EN_OVSDB_GET(engine_get_input("SB_fdb", node));
+    struct aging_index *index = data;
 
-    struct ovsdb_idl_index *sbrec_fdb_by_dp_key =
-            engine_ovsdb_node_get_index(engine_get_input("SB_fdb", node),
-                                        "fdb_by_dp_key");
+    aging_index_clear(index);
+    index->removal_limit = get_removal_limit(node, "fdb_removal_limit");
 
     struct ovn_datapath *od;
     HMAP_FOR_EACH (od, key_node, &northd_data->ls_datapaths.datapaths) {
@@ -557,31 +818,80 @@ en_fdb_aging_run(struct engine_node *node, void *data OVS_UNUSED)
         memset(&threshold_config, 0, sizeof threshold_config);
         threshold_config.default_threshold =
             smap_get_uint(&od->nbs->other_config, "fdb_age_threshold", 0);
-        aging_context_set_threshold(&ctx, &threshold_config);
-        fdb_run_for_datapath(od->sb, sbrec_fdb_by_dp_key, &ctx);
-
-        if (aging_context_is_at_limit(&ctx)) {
-            /* Schedule the next run after specified delay. */
-            ctx.next_wake_ms = AGING_BULK_REMOVAL_DELAY_MSEC;
-            break;
+        if (!threshold_config.default_threshold) {
+            continue;
         }
+
+        aging_index_add_dp(index, od->sb->tunnel_key, &threshold_config);
     }
 
-    aging_waker_schedule_next_wake(waker, ctx.next_wake_ms);
+    if (!hmap_is_empty(&index->dps)) {
+        const struct sbrec_fdb *fdb;
+        SBREC_FDB_TABLE_FOR_EACH (fdb, sbrec_fdb_table) {
+            aging_index_update(index, &fdb->header_,
+                               fdb_expire_msec(index, fdb));
+        }
+    }
 
     engine_set_node_state(node, EN_UPDATED);
+    fdb_aging_run__(node, index);
 }
 
 void *
 en_fdb_aging_init(struct engine_node *node OVS_UNUSED,
                   struct engine_arg *arg OVS_UNUSED)
 {
-    return NULL;
+    struct aging_index *index = xmalloc(sizeof *index);
+
+    aging_index_init(index);
+    return index;
 }
 
 void
-en_fdb_aging_cleanup(void *data OVS_UNUSED)
+en_fdb_aging_cleanup(void *data)
+{
+    aging_index_destroy(data);
+}
+
+bool
+fdb_aging_sb_fdb_handler(struct engine_node *node, void *data)
+{
+    const struct sbrec_fdb_table *sbrec_fdb_table =
+        EN_OVSDB_GET(engine_get_input("SB_fdb", node));
+    struct aging_waker *waker = engine_get_input_data("fdb_aging_waker", node);
+    struct aging_index *index = data;
+
+    const struct sbrec_fdb *fdb;
+    SBREC_FDB_TABLE_FOR_EACH_TRACKED (fdb, sbrec_fdb_table) {
+        if (sbrec_fdb_is_deleted(fdb)) {
+            aging_index_remove(index, &fdb->header_);
+        } else {
+            aging_index_update(index, &fdb->header_,
+                               fdb_expire_msec(index, fdb));
+        }
+    }
+
+    aging_waker_update(waker, index);
+    return true;
+}
+
+bool
+fdb_aging_northd_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    return aging_northd_handler(node);
+}
+
+bool
+fdb_aging_global_config_handler(struct engine_node *node, void *data)
+{
+    return aging_global_config_handler(node, data, "fdb_removal_limit");
+}
+
+bool
+fdb_aging_waker_handler(struct engine_node *node, void *data)
 {
+    fdb_aging_run__(node, data);
+    return true;
 }
 
 /* The waker node is an input node, but the data about when to wake up
@@ -23,6 +23,12 @@ void en_mac_binding_aging_run(struct engine_node *node, void *data);
 void *en_mac_binding_aging_init(struct engine_node *node,
                                 struct engine_arg *arg);
 void en_mac_binding_aging_cleanup(void *data);
+bool mac_binding_aging_sb_mac_binding_handler(struct engine_node *node,
+                                              void *data);
+bool mac_binding_aging_northd_handler(struct engine_node *node, void *data);
+bool mac_binding_aging_waker_handler(struct engine_node *node, void *data);
+bool mac_binding_aging_global_config_handler(struct engine_node *node,
+                                             void *data);
 
 /* The MAC binding aging waker node functions. */
 void en_mac_binding_aging_waker_run(struct engine_node *node, void *data);
@@ -37,6 +43,10 @@ unsigned int min_mac_binding_age_threshold(const char *opt);
 void en_fdb_aging_run(struct engine_node *node, void *data);
 void *en_fdb_aging_init(struct engine_node *node, struct engine_arg *arg);
 void en_fdb_aging_cleanup(void *data);
+bool fdb_aging_sb_fdb_handler(struct engine_node *node, void *data);
+bool fdb_aging_northd_handler(struct engine_node *node, void *data);
+bool fdb_aging_waker_handler(struct engine_node *node, void *data);
+bool fdb_aging_global_config_handler(struct engine_node *node, void *data);
 
 /* The FDB aging waker node functions. */
 void en_fdb_aging_waker_run(struct engine_node *node, void *data);
@@ -1,13 +1,12 @@
 # ovn-northd
 bin_PROGRAMS += northd/ovn-northd
-northd_ovn_northd_SOURCES = \
+northd_common_sources = \
 	northd/aging.c \
 	northd/aging.h \
 	northd/debug.c \
 	northd/debug.h \
 	northd/northd.c \
 	northd/northd.h \
-	northd/ovn-northd.c \
 	northd/en-global-config.c \
 	northd/en-global-config.h \
 	northd/en-northd.c \
@@ -32,6 +31,8 @@ northd_ovn_northd_SOURCES = \
 	northd/en-lr-stateful.h \
 	northd/en-ls-stateful.c \
 	northd/en-ls-stateful.h \
+	northd/hv-cfg.c \
+	northd/hv-cfg.h \
 	northd/inc-proc-northd.c \
 	northd/inc-proc-northd.h \
 	northd/ipam.c \
@@ -40,10 +41,20 @@ northd_ovn_northd_SOURCES = \
 	northd/lflow-mgr.h \
 	northd/lb.c \
 	northd/lb.h
+northd_ovn_northd_SOURCES = \
+	$(northd_common_sources) \
+	northd/ovn-northd.c
 northd_ovn_northd_LDADD = \
 	lib/libovn.la \
 	$(OVSDB_LIBDIR)/libovsdb.la \
 	$(OVS_LIBDIR)/libopenvswitch.la
+
+# ovn-northd-bench
+noinst_PROGRAMS += northd/ovn-northd-bench
+northd_ovn_northd_bench_SOURCES = \
+	$(northd_common_sources) \
+	northd/ovn-northd-bench.c
+northd_ovn_northd_bench_LDADD = $(northd_ovn_northd_LDADD)
 man_MANS += northd/ovn-northd.8
 EXTRA_DIST += northd/ovn-northd.8.xml
 CLEANFILES += northd/ovn-northd.8
@@ -177,6 +177,8 @@ en_global_config_clear_tracked_data(void *data)
     config_data->tracked = false;
     config_data->tracked_data.nb_options_changed = false;
     config_data->tracked_data.chassis_features_changed = false;
+    config_data->tracked_data.aging_options_changed = false;
+    config_data->tracked_data.addr_set_options_changed = false;
 }
 
 bool
@@ -252,6 +254,23 @@ global_config_nb_global_handler(struct engine_node *node, void *data)
         config_data->tracked_data.nb_options_changed = true;
     }
 
+    /* The options below are only used by the aging and address set sync
+     * nodes, they are handled by these nodes without recomputing the
+     * northd and lflow ones. */
+    if (config_out_of_sync(&nb->options, &config_data->nb_options,
+                           "mac_binding_removal_limit", false)
+        || config_out_of_sync(&nb->options, &config_data->nb_options,
+                              "fdb_removal_limit", false)) {
+        config_data->tracked_data.aging_options_changed = true;
+    }
+
+    if (config_out_of_sync(&nb->options, &config_data->nb_options,
+                           "aggregate_address_sets", false)
+        || config_out_of_sync(&nb->options, &config_data->nb_options,
+                              "use_nat_address_sets", false)) {
+        config_data->tracked_data.addr_set_options_changed = true;
+    }
+
     smap_destroy(&config_data->nb_options);
     smap_clone(&config_data->nb_options, &nb->options);
 
@@ -373,6 +392,7 @@ northd_enable_all_features(struct ed_type_global_config *data)
         .ls_dpg_column = true,
         .ct_commit_nat_v2 = true,
         .ct_commit_to_zone = true,
+        .lflow_parameters = true,
     };
 }
 
@@ -451,6 +471,15 @@ build_chassis_features(const struct sbrec_chassis_table *sbrec_chassis_table,
             chassis_features->ct_commit_to_zone) {
             chassis_features->ct_commit_to_zone = false;
         }
+
+        bool lflow_parameters =
+                smap_get_bool(&chassis->other_config,
+                              OVN_FEATURE_LFLOW_PARAMETERS,
+                              false);
+        if (!lflow_parameters &&
+            chassis_features->lflow_parameters) {
+            chassis_features->lflow_parameters = false;
+        }
     }
 }
 
@@ -483,16 +512,6 @@ static bool
 check_nb_options_out_of_sync(const struct nbrec_nb_global *nb,
                              struct ed_type_global_config *config_data)
 {
-    if (config_out_of_sync(&nb->options, &config_data->nb_options,
-                           "mac_binding_removal_limit", false)) {
-        return true;
-    }
-
-    if (config_out_of_sync(&nb->options, &config_data->nb_options,
-                           "fdb_removal_limit", false)) {
-        return true;
-    }
-
     if (config_out_of_sync(&nb->options, &config_data->nb_options,
                            "controller_event", false)) {
         return true;
@@ -540,6 +559,16 @@ check_nb_options_out_of_sync(const struct nbrec_nb_global *nb,
         return true;
     }
 
+    if (config_out_of_sync(&nb->options, &config_data->nb_options,
+                           "use_nat_address_sets", false)) {
+        return true;
+    }
+
+    if (config_out_of_sync(&nb->options, &config_data->nb_options,
+                           "use_lflow_parameters", false)) {
+        return true;
+    }
+
     return false;
 }
 
@@ -603,5 +632,9 @@ chassis_features_changed(const struct chassis_features *present,
         return true;
     }
 
+    if (present->lflow_parameters != updated->lflow_parameters) {
+        return true;
+    }
+
     return false;
 }
@@ -21,11 +21,19 @@ struct chassis_features {
     bool ls_dpg_column;
     bool ct_commit_nat_v2;
     bool ct_commit_to_zone;
+    bool lflow_parameters;
 };
 
 struct global_config_tracked_data {
+    /* NB options used by the northd and lflow nodes changed. */
     bool nb_options_changed;
     bool chassis_features_changed;
+
+    /* Options that only affect a given node.  Changing them doesn't set
+     * 'nb_options_changed'. */
+    bool aging_options_changed;     /* *_removal_limit. */
+    bool addr_set_options_changed;  /* aggregate_address_sets or
+                                     * use_nat_address_sets. */
 };
 
 /* struct which maintains the data of the engine node global_config. */
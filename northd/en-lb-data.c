@@ -32,6 +32,7 @@
 #include "lib/ovn-sb-idl.h"
 #include "lib/ovn-util.h"
 #include "northd.h"
+#include "simap.h"
 
 VLOG_DEFINE_THIS_MODULE(en_lb_data);
 
@@ -39,7 +40,8 @@ static void lb_data_init(struct ed_type_lb_data *);
 static void lb_data_destroy(struct ed_type_lb_data *);
 static void build_lbs(const struct nbrec_load_balancer_table *,
                       const struct nbrec_load_balancer_group_table *,
-                      struct hmap *lbs, struct hmap *lb_groups);
+                      struct hmap *lbs, struct hmap *lb_groups,
+                      struct ovn_lb_vip_cache *);
 static void build_od_lb_map(const struct nbrec_logical_switch_table *,
                             const struct nbrec_logical_router_table *,
                             struct hmap *ls_lb_map, struct hmap *lr_lb_map);
@@ -89,6 +91,7 @@ en_lb_data_init(struct engine_node *node OVS_UNUSED,
 {
     struct ed_type_lb_data *data = xzalloc(sizeof *data);
     lb_data_init(data);
+    data->vip_cache = ovn_lb_vip_cache_create();
     return data;
 }
 
@@ -109,7 +112,9 @@ en_lb_data_run(struct engine_node *node, void *data)
         EN_OVSDB_GET(engine_get_input("NB_logical_router", node));
 
     lb_data->tracked = false;
-    build_lbs(nb_lb_table, nb_lbg_table, &lb_data->lbs, &lb_data->lbgrps);
+    build_lbs(nb_lb_table, nb_lbg_table, &lb_data->lbs, &lb_data->lbgrps,
+              lb_data->vip_cache);
+    ovn_lb_vip_cache_sweep(lb_data->vip_cache);
     build_od_lb_map(nb_ls_table, nb_lr_table, &lb_data->ls_lb_map,
                     &lb_data->lr_lb_map);
 
@@ -121,6 +126,21 @@ en_lb_data_cleanup(void *data)
 {
     struct ed_type_lb_data *lb_data = (struct ed_type_lb_data *) data;
     lb_data_destroy(lb_data);
+    ovn_lb_vip_cache_destroy(lb_data->vip_cache);
+    lb_data->vip_cache = NULL;
+}
+
+void
+en_lb_data_get_memory_usage(const void *data, struct simap *usage)
+{
+    const struct ed_type_lb_data *lb_data = data;
+
+    simap_increase(usage, "lb_data-lbs", hmap_count(&lb_data->lbs));
+    simap_increase(usage, "lb_data-lb-groups", hmap_count(&lb_data->lbgrps));
+    simap_increase(usage, "lb_data-ls-lb-maps",
+                   hmap_count(&lb_data->ls_lb_map));
+    simap_increase(usage, "lb_data-lr-lb-maps",
+                   hmap_count(&lb_data->lr_lb_map));
 }
 
 void
@@ -154,7 +174,7 @@ lb_data_load_balancer_handler(struct engine_node *node, void *data)
         struct ovn_northd_lb *lb;
         if (nbrec_load_balancer_is_new(tracked_lb)) {
             /* New load balancer. */
-            lb = ovn_northd_lb_create(tracked_lb);
+            lb = ovn_northd_lb_create(tracked_lb, lb_data->vip_cache);
             hmap_insert(&lb_data->lbs, &lb->hmap_node,
                         uuid_hash(&tracked_lb->header_.uuid));
             add_crupdated_lb_to_tracked_data(lb, trk_lb_data,
@@ -181,7 +201,7 @@ lb_data_load_balancer_handler(struct engine_node *node, void *data)
             struct sset old_ips_v6 = SSET_INITIALIZER(&old_ips_v6);
             sset_swap(&lb->ips_v4, &old_ips_v4);
             sset_swap(&lb->ips_v6, &old_ips_v6);
-            ovn_northd_lb_reinit(lb, tracked_lb);
+            ovn_northd_lb_reinit(lb, tracked_lb, lb_data->vip_cache);
             health_checks |= lb->health_checks;
             struct crupdated_lb *clb = add_crupdated_lb_to_tracked_data(
                 lb, trk_lb_data, health_checks);
@@ -486,11 +506,13 @@ lb_data_destroy(struct ed_type_lb_data *lb_data)
 static void
 build_lbs(const struct nbrec_load_balancer_table *nbrec_load_balancer_table,
           const struct nbrec_load_balancer_group_table *nbrec_lb_group_table,
-          struct hmap *lbs, struct hmap *lb_groups)
+          struct hmap *lbs, struct hmap *lb_groups,
+          struct ovn_lb_vip_cache *vip_cache)
 {
     const struct nbrec_load_balancer *nbrec_lb;
     NBREC_LOAD_BALANCER_TABLE_FOR_EACH (nbrec_lb, nbrec_load_balancer_table) {
-        struct ovn_northd_lb *lb_nb = ovn_northd_lb_create(nbrec_lb);
+        struct ovn_northd_lb *lb_nb = ovn_northd_lb_create(nbrec_lb,
+                                                           vip_cache);
         hmap_insert(lbs, &lb_nb->hmap_node,
                     uuid_hash(&nbrec_lb->header_.uuid));
     }
@@ -13,6 +13,7 @@
 
 struct ovn_northd_lb;
 struct ovn_lb_group;
+struct ovn_lb_vip_cache;
 
 struct crupdated_lb {
     struct hmap_node hmap_node;
@@ -107,11 +108,15 @@ struct ed_type_lb_data {
     /* tracked data*/
     bool tracked;
     struct tracked_lb_data tracked_lb_data;
+
+    /* Parsed VIPs of the load balancers, kept across full recomputes. */
+    struct ovn_lb_vip_cache *vip_cache;
 };
 
 void *en_lb_data_init(struct engine_node *, struct engine_arg *);
 void en_lb_data_run(struct engine_node *, void *data);
 void en_lb_data_cleanup(void *data);
+void en_lb_data_get_memory_usage(const void *data, struct simap *usage);
 void en_lb_data_clear_tracked_data(void *data);
 
 bool lb_data_load_balancer_handler(struct engine_node *, void *data);
@@ -27,8 +27,10 @@
 #include "en-meters.h"
 #include "lflow-mgr.h"
 
+#include "lib/hmapx.h"
 #include "lib/inc-proc-eng.h"
 #include "northd.h"
+#include "simap.h"
 #include "stopwatch.h"
 #include "lib/stopwatch-names.h"
 #include "timeval.h"
@@ -79,6 +81,7 @@ lflow_get_input_data(struct engine_node *node,
     lflow_input->lb_datapaths_map = &northd_data->lb_datapaths_map;
     lflow_input->svc_monitor_map = &northd_data->svc_monitor_map;
     lflow_input->bfd_connections = NULL;
+    lflow_input->igmp_lflow_refs = NULL;
 
     struct ed_type_global_config *global_config =
         engine_get_input_data("global_config", node);
@@ -86,6 +89,22 @@ lflow_get_input_data(struct engine_node *node,
     lflow_input->ovn_internal_version_changed =
         global_config->ovn_internal_version_changed;
     lflow_input->svc_monitor_mac = global_config->svc_monitor_mac;
+    lflow_input->max_lflow_inserts =
+        smap_get_uint(&global_config->nb_options,
+                      "northd-max-lflow-inserts-per-txn", 0);
+}
+
+/* Lets the lflow_sync_waker node know if there are logical flows left to
+ * insert in the SB, so that the engine inserts them in the next SB
+ * transactions. */
+static void
+lflow_sync_waker_update(struct engine_node *node,
+                        const struct lflow_data *lflow_data)
+{
+    struct lflow_sync_waker *waker =
+        engine_get_input_data("lflow_sync_waker", node);
+
+    waker->pending = lflow_table_has_pending(lflow_data->lflow_table);
 }
 
 void en_lflow_run(struct engine_node *node, void *data)
@@ -95,27 +114,30 @@ void en_lflow_run(struct engine_node *node, void *data)
     struct lflow_input lflow_input;
     lflow_get_input_data(node, &lflow_input);
 
-    struct hmap bfd_connections = HMAP_INITIALIZER(&bfd_connections);
-    lflow_input.bfd_connections = &bfd_connections;
+    struct lflow_data *lflow_data = data;
+    lflow_input.bfd_connections = &lflow_data->bfd_connections;
+    lflow_input.igmp_lflow_refs = &lflow_data->igmp_lflow_refs;
 
     stopwatch_start(BUILD_LFLOWS_STOPWATCH_NAME, time_msec());
 
-    struct lflow_data *lflow_data = data;
-    lflow_table_clear(lflow_data->lflow_table);
+    /* The lflows are rebuilt in place, see lflow_table_mark_stale(). */
+    lflow_table_mark_stale(lflow_data->lflow_table);
     lflow_reset_northd_refs(&lflow_input);
+    igmp_lflow_refs_destroy(&lflow_data->igmp_lflow_refs);
 
+    bfd_destroy_connections(&lflow_data->bfd_connections);
     build_bfd_table(eng_ctx->ovnsb_idl_txn,
                     lflow_input.nbrec_bfd_table,
                     lflow_input.sbrec_bfd_table,
                     lflow_input.lr_ports,
-                    &bfd_connections);
+                    &lflow_data->bfd_connections);
     build_lflows(eng_ctx->ovnsb_idl_txn, &lflow_input,
                  lflow_data->lflow_table);
     bfd_cleanup_connections(lflow_input.nbrec_bfd_table,
-                            &bfd_connections);
-    hmap_destroy(&bfd_connections);
+                            &lflow_data->bfd_connections);
     stopwatch_stop(BUILD_LFLOWS_STOPWATCH_NAME, time_msec());
 
+    lflow_sync_waker_update(node, lflow_data);
     engine_set_node_state(node, EN_UPDATED);
 }
 
@@ -133,9 +155,11 @@ lflow_northd_handler(struct engine_node *node,
 
     struct lflow_input lflow_input;
     lflow_get_input_data(node, &lflow_input);
+    lflow_input.bfd_connections = &lflow_data->bfd_connections;
 
     if (!lflow_handle_northd_port_changes(eng_ctx->ovnsb_idl_txn,
                                           &northd_data->trk_data.trk_lsps,
+                                          &northd_data->trk_data.trk_lrps,
                                           &lflow_input,
                                           lflow_data->lflow_table)) {
         return false;
@@ -147,6 +171,34 @@ lflow_northd_handler(struct engine_node *node,
         return false;
     }
 
+    if (!lflow_handle_northd_lr_route_changes(
+            eng_ctx->ovnsb_idl_txn,
+            &northd_data->trk_data.lr_with_changed_routes,
+            &lflow_input, lflow_data->lflow_table)) {
+        return false;
+    }
+
+    if (!lflow_handle_northd_lr_policy_changes(
+            eng_ctx->ovnsb_idl_txn,
+            &northd_data->trk_data.lr_with_changed_policies,
+            &lflow_input, lflow_data->lflow_table)) {
+        return false;
+    }
+
+    if (!lflow_handle_northd_ls_qos_changes(
+            eng_ctx->ovnsb_idl_txn,
+            &northd_data->trk_data.ls_with_changed_qos,
+            &lflow_input, lflow_data->lflow_table)) {
+        return false;
+    }
+
+    if (!lflow_handle_northd_ls_config_changes(
+            eng_ctx->ovnsb_idl_txn,
+            &northd_data->trk_data.ls_with_changed_config,
+            &lflow_input, lflow_data->lflow_table)) {
+        return false;
+    }
+
     engine_set_node_state(node, EN_UPDATED);
     return true;
 }
@@ -220,17 +272,160 @@ lflow_ls_stateful_handler(struct engine_node *node, void *data)
     return true;
 }
 
+/* Handles the NB BFD status and configuration changes.  The static route
+ * flows that depend on the sessions whose status changed are regenerated,
+ * unless en_northd already reported the route changes, which happens if
+ * the IDL tracks the routes of the changed sessions. */
+bool
+lflow_nb_bfd_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+    struct lflow_data *lflow_data = data;
+    struct lflow_input lflow_input;
+
+    lflow_get_input_data(node, &lflow_input);
+    lflow_input.bfd_connections = &lflow_data->bfd_connections;
+
+    struct hmapx updated_bfds = HMAPX_INITIALIZER(&updated_bfds);
+    bool handled = bfd_handle_nb_changes(lflow_input.nbrec_bfd_table,
+                                         &lflow_data->bfd_connections,
+                                         &updated_bfds)
+                   && lflow_handle_bfd_changes(
+                          eng_ctx->ovnsb_idl_txn, &updated_bfds,
+                          &northd_data->trk_data.lr_with_changed_routes,
+                          &lflow_input, lflow_data->lflow_table);
+    if (handled && !hmapx_is_empty(&updated_bfds)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    hmapx_destroy(&updated_bfds);
+    return handled;
+}
+
+/* The SB BFD changes don't affect the logical flows directly, only through
+ * the NB status they are propagated to. */
+bool
+lflow_sb_bfd_handler(struct engine_node *node, void *data)
+{
+    struct lflow_data *lflow_data = data;
+
+    const struct nbrec_bfd_table *nbrec_bfd_table =
+        EN_OVSDB_GET(engine_get_input("NB_bfd", node));
+    const struct sbrec_bfd_table *sbrec_bfd_table =
+        EN_OVSDB_GET(engine_get_input("SB_bfd", node));
+
+    return bfd_handle_sb_changes(sbrec_bfd_table, nbrec_bfd_table,
+                                 &lflow_data->bfd_connections);
+}
+
+/* Handles the IGMP groups learnt by ovn-controller. */
+bool
+lflow_sb_igmp_group_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct lflow_data *lflow_data = data;
+    struct lflow_input lflow_input;
+
+    lflow_get_input_data(node, &lflow_input);
+    lflow_input.igmp_lflow_refs = &lflow_data->igmp_lflow_refs;
+    if (!lflow_handle_igmp_group_changes(eng_ctx->ovnsb_idl_txn,
+                                         &lflow_input,
+                                         lflow_data->lflow_table)) {
+        return false;
+    }
+
+    engine_set_node_state(node, EN_UPDATED);
+    return true;
+}
+
+/* The logical flows only refer to the meters by name, and to whether they
+ * are fair or not, so changes to the meter bands are only synced to the SB
+ * by en_sync_meters. */
+bool
+lflow_sync_meters_handler(struct engine_node *node, void *data OVS_UNUSED)
+{
+    struct sync_meters_data *sync_meters_data =
+        engine_get_input_data("sync_meters", node);
+
+    return !sync_meters_data->meter_groups_changed;
+}
+
+/* Inserts in the SB the next chunk of the logical flows that didn't fit in
+ * the previous SB transactions. */
+bool
+lflow_sync_waker_handler(struct engine_node *node, void *data)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct lflow_data *lflow_data = data;
+    struct lflow_input lflow_input;
+
+    lflow_get_input_data(node, &lflow_input);
+    size_t n = lflow_table_sync_pending(
+        lflow_data->lflow_table, eng_ctx->ovnsb_idl_txn,
+        lflow_input.ls_datapaths, lflow_input.lr_datapaths,
+        lflow_input.sbrec_logical_dp_group_table,
+        lflow_input.max_lflow_inserts);
+    lflow_sync_waker_update(node, lflow_data);
+
+    VLOG_DBG("inserted %"PRIuSIZE" pending logical flows", n);
+    if (n) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    return true;
+}
+
+/* The waker node is an input node, like the aging wakers, but its data is
+ * populated by the lflow node, which is the only one that knows if there
+ * are logical flows pending. */
+void
+en_lflow_sync_waker_run(struct engine_node *node, void *data)
+{
+    struct lflow_sync_waker *waker = data;
+
+    engine_set_node_state(node, waker->pending ? EN_UPDATED : EN_UNCHANGED);
+}
+
+void *
+en_lflow_sync_waker_init(struct engine_node *node OVS_UNUSED,
+                         struct engine_arg *arg OVS_UNUSED)
+{
+    return xzalloc(sizeof(struct lflow_sync_waker));
+}
+
+void
+en_lflow_sync_waker_cleanup(void *data OVS_UNUSED)
+{
+}
+
 void *en_lflow_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg OVS_UNUSED)
 {
     struct lflow_data *data = xmalloc(sizeof *data);
     data->lflow_table = lflow_table_alloc();
     lflow_table_init(data->lflow_table);
+    hmap_init(&data->bfd_connections);
+    hmap_init(&data->igmp_lflow_refs);
     return data;
 }
 
+void
+en_lflow_get_memory_usage(const void *data_, struct simap *usage)
+{
+    const struct lflow_data *data = data_;
+
+    lflow_table_get_memory_usage(data->lflow_table, usage);
+    simap_increase(usage, "lflow-bfd-connections",
+                   hmap_count(&data->bfd_connections));
+    simap_increase(usage, "lflow-igmp-lflow-refs",
+                   hmap_count(&data->igmp_lflow_refs));
+}
+
 void en_lflow_cleanup(void *data_)
 {
     struct lflow_data *data = data_;
     lflow_table_destroy(data->lflow_table);
+    bfd_destroy_connections(&data->bfd_connections);
+    hmap_destroy(&data->bfd_connections);
+    igmp_lflow_refs_destroy(&data->igmp_lflow_refs);
+    hmap_destroy(&data->igmp_lflow_refs);
 }
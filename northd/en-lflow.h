@@ -8,19 +8,44 @@
 #include <stdio.h>
 
 #include "lib/inc-proc-eng.h"
+#include "openvswitch/hmap.h"
 
 struct lflow_table;
 
 struct lflow_data {
     struct lflow_table *lflow_table;
+
+    /* BFD sessions, see build_bfd_table().  Kept across runs so that the
+     * BFD status updates can be handled incrementally. */
+    struct hmap bfd_connections;
+
+    /* Logical flow references of the IGMP groups, see
+     * lflow_handle_igmp_group_changes(). */
+    struct hmap igmp_lflow_refs;
+};
+
+/* Data of the lflow_sync_waker node, see
+ * "northd-max-lflow-inserts-per-txn" in ovn-nb(5). */
+struct lflow_sync_waker {
+    bool pending;   /* Logical flows are left to insert in the SB. */
 };
 
 void en_lflow_run(struct engine_node *node, void *data);
 void *en_lflow_init(struct engine_node *node, struct engine_arg *arg);
 void en_lflow_cleanup(void *data);
+void en_lflow_get_memory_usage(const void *data, struct simap *usage);
 bool lflow_northd_handler(struct engine_node *, void *data);
 bool lflow_port_group_handler(struct engine_node *, void *data);
 bool lflow_lr_stateful_handler(struct engine_node *, void *data);
 bool lflow_ls_stateful_handler(struct engine_node *node, void *data);
+bool lflow_sync_waker_handler(struct engine_node *, void *data);
+bool lflow_nb_bfd_handler(struct engine_node *, void *data);
+bool lflow_sb_bfd_handler(struct engine_node *, void *data);
+bool lflow_sb_igmp_group_handler(struct engine_node *, void *data);
+bool lflow_sync_meters_handler(struct engine_node *, void *data);
+
+void en_lflow_sync_waker_run(struct engine_node *, void *data);
+void *en_lflow_sync_waker_init(struct engine_node *, struct engine_arg *);
+void en_lflow_sync_waker_cleanup(void *data);
 
 #endif /* EN_LFLOW_H */
@@ -23,6 +23,7 @@
 /* OVS includes */
 #include "include/openvswitch/hmap.h"
 #include "lib/bitmap.h"
+#include "lib/hash.h"
 #include "lib/socket-util.h"
 #include "lib/uuidset.h"
 #include "openvswitch/util.h"
@@ -68,6 +69,12 @@ static struct lr_stateful_record *lr_stateful_record_create(
     const struct ovn_datapath *od,
     const struct hmap *lb_datapaths_map,
     const struct hmap *lbgrp_datapaths_map);
+static struct lr_stateful_record *lr_stateful_record_build(
+    const struct lr_nat_record *, const struct ovn_datapath *od,
+    const struct hmap *lb_datapaths_map,
+    const struct hmap *lbgrp_datapaths_map);
+static void lr_stateful_record_insert(struct lr_stateful_table *,
+                                      struct lr_stateful_record *);
 static void lr_stateful_record_destroy(struct lr_stateful_record *);
 
 static void build_lrouter_lb_reachable_ips(struct lr_stateful_record *,
@@ -147,10 +154,12 @@ lr_stateful_northd_handler(struct engine_node *node, void *data OVS_UNUSED)
      *      need to revisit this handler.
      *
      *      This node also accesses the router ports of the logical router
-     *      (od->ports).  When these logical router ports gets updated,
-     *      en_northd engine recomputes and so does this node.
-     *      Note: When we add I-P to handle router port changes, we need
-     *      to revisit this handler.
+     *      (od->ports) to find the reachable load balancer VIPs.  en_northd
+     *      engine only handles router ports being added or deleted
+     *      incrementally for routers without load balancers, and then it
+     *      also reports the router in 'trk_nat_lrs', which this node gets
+     *      through en_lr_nat.  Any other router port change results in a
+     *      recompute of en_northd and so of this node.
      *
      *   2. northd_data->lb_datapaths_map
      *   3. northd_data->lb_group_datapaths_map
@@ -371,7 +380,163 @@ lr_stateful_table_find_by_index(const struct lr_stateful_table *table,
     return lr_stateful_table_find_by_index_(table, od_index);
 }
 
+/* Adds the external IP of 'nat_entry' to 'ips_v4' or 'ips_v6', as per its
+ * address family, unless it is a load balancer VIP of 'lr_stateful_rec' or
+ * the set is NULL.  Returns true if the IP was added. */
+static bool
+lr_stateful_record_add_arp_req_nat_ip(
+    const struct lr_stateful_record *lr_stateful_rec,
+    const struct ovn_nat *nat_entry,
+    struct sset *ips_v4, struct sset *ips_v6)
+{
+    const char *ip = nat_entry->nb->external_ip;
+
+    if (nat_entry_is_v6(nat_entry)) {
+        if (!ips_v6 || sset_contains(&lr_stateful_rec->lb_ips->ips_v6, ip)) {
+            return false;
+        }
+        sset_add(ips_v6, ip);
+    } else {
+        if (!ips_v4 || sset_contains(&lr_stateful_rec->lb_ips->ips_v4, ip)) {
+            return false;
+        }
+        sset_add(ips_v4, ip);
+    }
+    return true;
+}
+
+/* Adds to 'ips_v4' and 'ips_v6', either of which may be NULL, the NAT
+ * external IPs of 'lr_stateful_rec' whose ARP requests and IPv6 NS the
+ * logical switches forward to the router.  If 'first_only' is true, stops
+ * at the first one.  Returns true if any IP was added. */
+static bool
+lr_stateful_record_collect_arp_req_nat_ips(
+    const struct lr_stateful_record *lr_stateful_rec,
+    struct sset *ips_v4, struct sset *ips_v6, bool first_only)
+{
+    const struct lr_nat_record *lrnat_rec = lr_stateful_rec->lrnat_rec;
+    bool found = false;
+
+    for (size_t i = 0; i < lrnat_rec->n_nat_entries; i++) {
+        const struct ovn_nat *nat_entry = &lrnat_rec->nat_entries[i];
+
+        if (!nat_entry_is_valid(nat_entry)
+            || !strcmp(nat_entry->nb->type, "snat")) {
+            continue;
+        }
+        if (lr_stateful_record_add_arp_req_nat_ip(lr_stateful_rec, nat_entry,
+                                                  ips_v4, ips_v6)) {
+            found = true;
+            if (first_only) {
+                return true;
+            }
+        }
+    }
+
+    struct shash_node *snat_snode;
+    SHASH_FOR_EACH (snat_snode, &lrnat_rec->snat_ips) {
+        struct ovn_snat_ip *snat_ip = snat_snode->data;
+
+        if (ovs_list_is_empty(&snat_ip->snat_entries)) {
+            continue;
+        }
+
+        const struct ovn_nat *nat_entry =
+            CONTAINER_OF(ovs_list_front(&snat_ip->snat_entries),
+                         struct ovn_nat, ext_addr_list_node);
+        if (nat_entry->is_router_ip) {
+            /* The router port IPs have flows of their own. */
+            continue;
+        }
+        if (lr_stateful_record_add_arp_req_nat_ip(lr_stateful_rec, nat_entry,
+                                                  ips_v4, ips_v6)) {
+            found = true;
+            if (first_only) {
+                return true;
+            }
+        }
+    }
+    return found;
+}
+
+/* Adds to 'ips_v4' and 'ips_v6' the DNAT and SNAT external IPs of
+ * 'lr_stateful_rec' that the logical switches connected to the router
+ * forward the ARP requests and IPv6 NS for to it, i.e. the ones that are
+ * neither load balancer VIPs nor router port IPs.  They are the contents of
+ * the router's NAT address sets, see lr_nat_address_set_name(). */
+void
+lr_stateful_record_get_arp_req_nat_ips(
+    const struct lr_stateful_record *lr_stateful_rec,
+    struct sset *ips_v4, struct sset *ips_v6)
+{
+    lr_stateful_record_collect_arp_req_nat_ips(lr_stateful_rec, ips_v4,
+                                               ips_v6, false);
+}
+
+/* Returns true if lr_stateful_record_get_arp_req_nat_ips() would return
+ * any IP of 'addr_family' for 'lr_stateful_rec'. */
+bool
+lr_stateful_record_has_arp_req_nat_ips(
+    const struct lr_stateful_record *lr_stateful_rec, int addr_family)
+{
+    struct sset ips = SSET_INITIALIZER(&ips);
+    bool found = lr_stateful_record_collect_arp_req_nat_ips(
+        lr_stateful_rec, addr_family == AF_INET ? &ips : NULL,
+        addr_family == AF_INET6 ? &ips : NULL, true);
+
+    sset_destroy(&ips);
+    return found;
+}
+
 /* static functions. */
+/* Returns the lflow reference of the NAT entry identified by 'key' in
+ * 'lr_stateful_rec', creating it if it doesn't exist yet.  Takes ownership
+ * of 'key'. */
+struct lr_stateful_nat_lflow_ref *
+lr_stateful_record_add_nat_lflow_ref(
+    struct lr_stateful_record *lr_stateful_rec, char *key)
+{
+    struct lr_stateful_nat_lflow_ref *nat_ref;
+    uint32_t hash = hash_string(key, 0);
+
+    HMAP_FOR_EACH_WITH_HASH (nat_ref, hmap_node, hash,
+                             &lr_stateful_rec->nat_lflow_refs) {
+        if (!strcmp(nat_ref->key, key)) {
+            free(key);
+            return nat_ref;
+        }
+    }
+
+    nat_ref = xzalloc(sizeof *nat_ref);
+    nat_ref->key = key;
+    nat_ref->lflow_ref = lflow_ref_create();
+    nat_ref->rebuilt = true;
+    hmap_insert(&lr_stateful_rec->nat_lflow_refs, &nat_ref->hmap_node, hash);
+
+    return nat_ref;
+}
+
+void
+lr_stateful_record_remove_nat_lflow_ref(
+    struct lr_stateful_record *lr_stateful_rec,
+    struct lr_stateful_nat_lflow_ref *nat_ref)
+{
+    hmap_remove(&lr_stateful_rec->nat_lflow_refs, &nat_ref->hmap_node);
+    lflow_ref_destroy(nat_ref->lflow_ref);
+    free(nat_ref->key);
+    free(nat_ref);
+}
+
+void
+lr_stateful_record_clear_nat_lflow_refs(
+    struct lr_stateful_record *lr_stateful_rec)
+{
+    struct lr_stateful_nat_lflow_ref *nat_ref;
+    HMAP_FOR_EACH_SAFE (nat_ref, hmap_node, &lr_stateful_rec->nat_lflow_refs) {
+        lr_stateful_record_remove_nat_lflow_ref(lr_stateful_rec, nat_ref);
+    }
+}
+
 static void
 lr_stateful_table_init(struct lr_stateful_table *table)
 {
@@ -399,6 +564,29 @@ lr_stateful_table_clear(struct lr_stateful_table *table)
     table->array = NULL;
 }
 
+struct lr_stateful_build_ctx {
+    const struct lr_nat_table *lr_nats;
+    const struct ovn_datapaths *lr_datapaths;
+    const struct hmap *lb_datapaths_map;
+    const struct hmap *lbgrp_datapaths_map;
+    struct lr_stateful_record **records; /* Indexed by datapath index. */
+};
+
+static void
+lr_stateful_record_build_cb(size_t idx, void *ctx_)
+{
+    struct lr_stateful_build_ctx *ctx = ctx_;
+    const struct ovn_datapath *od =
+        ovn_datapaths_find_by_index(ctx->lr_datapaths, idx);
+    const struct lr_nat_record *lrnat_rec =
+        lr_nat_table_find_by_index(ctx->lr_nats, idx);
+
+    ovs_assert(lrnat_rec);
+    ctx->records[idx] = lr_stateful_record_build(lrnat_rec, od,
+                                                 ctx->lb_datapaths_map,
+                                                 ctx->lbgrp_datapaths_map);
+}
+
 static void
 lr_stateful_table_build(struct lr_stateful_table *table,
                         const struct lr_nat_table *lr_nats,
@@ -406,15 +594,27 @@ lr_stateful_table_build(struct lr_stateful_table *table,
                         const struct hmap *lb_datapaths_map,
                         const struct hmap *lbgrp_datapaths_map)
 {
-    table->array = xrealloc(table->array,
-                            ods_size(lr_datapaths) * sizeof *table->array);
-    const struct lr_nat_record *lrnat_rec;
-    LR_NAT_TABLE_FOR_EACH (lrnat_rec, lr_nats) {
-        const struct ovn_datapath *od =
-            ovn_datapaths_find_by_index(lr_datapaths, lrnat_rec->lr_index);
-        lr_stateful_record_create(table, lrnat_rec, od, lb_datapaths_map,
-                                  lbgrp_datapaths_map);
+    size_t n = ods_size(lr_datapaths);
+    struct lr_stateful_build_ctx ctx = {
+        .lr_nats = lr_nats,
+        .lr_datapaths = lr_datapaths,
+        .lb_datapaths_map = lb_datapaths_map,
+        .lbgrp_datapaths_map = lbgrp_datapaths_map,
+        .records = xmalloc(n * sizeof *ctx.records),
+    };
+
+    table->array = xrealloc(table->array, n * sizeof *table->array);
+
+    /* Building the load balancer IP sets of a router only needs its own
+     * records, so that is done on the worker threads and the results are
+     * inserted by the current thread. */
+    northd_prep_for_each("lr-stateful", n, lr_stateful_record_build_cb, &ctx);
+
+    hmap_reserve(&table->entries, n);
+    for (size_t i = 0; i < n; i++) {
+        lr_stateful_record_insert(table, ctx.records[i]);
     }
+    free(ctx.records);
 }
 
 static struct lr_stateful_record *
@@ -446,6 +646,30 @@ lr_stateful_record_create(struct lr_stateful_table *table,
                          const struct ovn_datapath *od,
                          const struct hmap *lb_datapaths_map,
                          const struct hmap *lbgrp_datapaths_map)
+{
+    struct lr_stateful_record *lr_stateful_rec =
+        lr_stateful_record_build(lrnat_rec, od, lb_datapaths_map,
+                                 lbgrp_datapaths_map);
+    lr_stateful_record_insert(table, lr_stateful_rec);
+    return lr_stateful_rec;
+}
+
+static void
+lr_stateful_record_insert(struct lr_stateful_table *table,
+                          struct lr_stateful_record *lr_stateful_rec)
+{
+    hmap_insert(&table->entries, &lr_stateful_rec->key_node,
+                uuid_hash(&lr_stateful_rec->nbr_uuid));
+    table->array[lr_stateful_rec->lr_index] = lr_stateful_rec;
+}
+
+/* Creates the record of router 'od' without adding it to any table.  It may
+ * be called from the worker threads, see lr_stateful_table_build(). */
+static struct lr_stateful_record *
+lr_stateful_record_build(const struct lr_nat_record *lrnat_rec,
+                         const struct ovn_datapath *od,
+                         const struct hmap *lb_datapaths_map,
+                         const struct hmap *lbgrp_datapaths_map)
 {
     struct lr_stateful_record *lr_stateful_rec =
         xzalloc(sizeof *lr_stateful_rec);
@@ -453,7 +677,7 @@ lr_stateful_record_create(struct lr_stateful_table *table,
     lr_stateful_rec->lrnat_rec = lrnat_rec;
     lr_stateful_rec->lr_index = od->index;
     lr_stateful_rec->lflow_ref = lflow_ref_create();
-
+    hmap_init(&lr_stateful_rec->nat_lflow_refs);
 
     /* Initialize the record.
      * Checking load balancer groups first, starting from the largest one,
@@ -511,11 +735,6 @@ lr_stateful_record_create(struct lr_stateful_table *table,
 
     lr_stateful_rec->has_lb_vip = od_has_lb_vip(od);
 
-    hmap_insert(&table->entries, &lr_stateful_rec->key_node,
-                uuid_hash(&lr_stateful_rec->nbr_uuid));
-
-    table->array[od->index] = lr_stateful_rec;
-
     /* Load balancers are not supported (yet) if a logical router has multiple
      * distributed gateway port.  Log a warning. */
     if (lr_stateful_rec->has_lb_vip && lr_has_multiple_gw_ports(od)) {
@@ -536,6 +755,9 @@ lr_stateful_record_destroy(struct lr_stateful_record *lr_stateful_rec)
 {
     ovn_lb_ip_set_destroy(lr_stateful_rec->lb_ips);
     lflow_ref_destroy(lr_stateful_rec->lflow_ref);
+    lr_stateful_record_clear_nat_lflow_refs(lr_stateful_rec);
+    hmap_destroy(&lr_stateful_rec->nat_lflow_refs);
+    free(lr_stateful_rec->nat_lflows_config);
     free(lr_stateful_rec);
 }
 
@@ -44,6 +44,20 @@ struct lflow_ref;
  *                     logical router.
  */
 
+/* Reference of the logical flows generated for one NAT entry of a logical
+ * router, see 'nat_lflow_refs' in struct lr_stateful_record. */
+struct lr_stateful_nat_lflow_ref {
+    struct hmap_node hmap_node;  /* In 'nat_lflow_refs', by hash of 'key'. */
+    char *key;                   /* NAT row and the contents its lflows are
+                                  * built from. */
+    struct lflow_ref *lflow_ref;
+
+    /* Used by build_lr_stateful_flows() in northd.c. */
+    bool stale;                  /* The NAT wasn't found in the last build. */
+    bool rebuilt;                /* The lflows were rebuilt by the last
+                                  * build. */
+};
+
 struct lr_stateful_record {
     struct hmap_node key_node; /* Index on 'nbr->header_.uuid'. */
 
@@ -85,6 +99,21 @@ struct lr_stateful_record {
      * access lr_stateful_record->lflow_ref at any given time.
      */
     struct lflow_ref *lflow_ref;
+
+    /* References of the lflows generated for each NAT entry, so that
+     * adding, removing or updating a NAT, e.g., attaching a floating IP,
+     * only rebuilds the lflows of that NAT.  It contains
+     * 'struct lr_stateful_nat_lflow_ref's, and 'lflow_ref' above only
+     * references the lflows that depend on the NAT configuration of the
+     * router as a whole.
+     *
+     * 'nat_lflows_config' is the configuration of the router that the
+     * lflows of all of its NATs depend on, as of when they were last built.
+     * If it changes, the lflows of all the NATs are rebuilt.
+     *
+     * Same as 'lflow_ref', these belong to the en_lflow node. */
+    struct hmap nat_lflow_refs;
+    char *nat_lflows_config;
 };
 
 struct lr_stateful_table {
@@ -132,6 +161,18 @@ bool lr_stateful_lb_data_handler(struct engine_node *, void *data);
 const struct lr_stateful_record *lr_stateful_table_find_by_index(
     const struct lr_stateful_table *, size_t od_index);
 
+struct lr_stateful_nat_lflow_ref *lr_stateful_record_add_nat_lflow_ref(
+    struct lr_stateful_record *, char *key);
+void lr_stateful_record_remove_nat_lflow_ref(
+    struct lr_stateful_record *, struct lr_stateful_nat_lflow_ref *);
+void lr_stateful_record_clear_nat_lflow_refs(struct lr_stateful_record *);
+
+void lr_stateful_record_get_arp_req_nat_ips(
+    const struct lr_stateful_record *, struct sset *ips_v4,
+    struct sset *ips_v6);
+bool lr_stateful_record_has_arp_req_nat_ips(
+    const struct lr_stateful_record *, int addr_family);
+
 static inline bool
 lr_stateful_has_tracked_data(struct lr_stateful_tracked_data *trk_data)
 {
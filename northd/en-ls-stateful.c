@@ -58,7 +58,6 @@ static struct ls_stateful_input ls_stateful_get_input_data(
     struct engine_node *);
 
 static struct ls_stateful_record *ls_stateful_record_create(
-    struct ls_stateful_table *,
     const struct ovn_datapath *,
     const struct ls_port_group_table *);
 static void ls_stateful_record_destroy(struct ls_stateful_record *);
@@ -79,6 +78,8 @@ static void ls_stateful_record_set_acl_flags(
 static bool ls_stateful_record_set_acl_flags_(struct ls_stateful_record *,
                                               struct nbrec_acl **,
                                               size_t n_acls);
+static bool ls_acls_changed(const struct ovn_datapath *,
+                            const struct ls_port_group *);
 static struct ls_stateful_input ls_stateful_get_input_data(
     struct engine_node *);
 
@@ -139,7 +140,9 @@ ls_stateful_northd_handler(struct engine_node *node, void *data_)
     }
 
     if (!northd_has_ls_lbs_in_tracked_data(&northd_data->trk_data) &&
-        !northd_has_ls_acls_in_tracked_data(&northd_data->trk_data)) {
+        !northd_has_ls_acls_in_tracked_data(&northd_data->trk_data) &&
+        !northd_has_ls_router_ports_in_tracked_data(
+            &northd_data->trk_data)) {
         return true;
     }
 
@@ -157,6 +160,12 @@ ls_stateful_northd_handler(struct engine_node *node, void *data_)
         hmapx_add(&changed_stateful_od, hmapx_node->data);
     }
 
+    /* The pre-ACL and pre-LB flows of a switch skip conntrack for its
+     * router ports. */
+    HMAPX_FOR_EACH (hmapx_node, &nd_changes->ls_with_changed_router_ports) {
+        hmapx_add(&changed_stateful_od, hmapx_node->data);
+    }
+
     HMAPX_FOR_EACH (hmapx_node, &changed_stateful_od) {
         const struct ovn_datapath *od = hmapx_node->data;
 
@@ -229,6 +238,56 @@ ls_stateful_port_group_handler(struct engine_node *node, void *data_)
     return true;
 }
 
+bool
+ls_stateful_nb_acl_handler(struct engine_node *node, void *data_)
+{
+    const struct nbrec_acl_table *nb_acl_table =
+        EN_OVSDB_GET(engine_get_input("NB_acl", node));
+    const struct nbrec_acl *nb_acl;
+    bool has_changes = false;
+
+    NBREC_ACL_TABLE_FOR_EACH_TRACKED (nb_acl, nb_acl_table) {
+        has_changes = true;
+        break;
+    }
+
+    if (!has_changes) {
+        return true;
+    }
+
+    /* ACLs are referenced either directly by the logical switches or
+     * through the port groups the switches are part of.  A change to an ACL
+     * also marks the referencing switch or port group row as updated, so
+     * look for the ls_stateful records whose ACLs changed and regenerate
+     * only their logical flows. */
+    struct ls_stateful_input input_data = ls_stateful_get_input_data(node);
+    struct ed_type_ls_stateful *data = data_;
+    struct ls_stateful_record *ls_stateful_rec;
+
+    LS_STATEFUL_TABLE_FOR_EACH (ls_stateful_rec, &data->table) {
+        const struct ovn_datapath *od =
+            ovn_datapaths_find_by_index(input_data.ls_datapaths,
+                                        ls_stateful_rec->ls_index);
+        const struct ls_port_group *ls_pg =
+            ls_port_group_table_find(input_data.ls_port_groups, od->nbs);
+
+        if (!ls_acls_changed(od, ls_pg)) {
+            continue;
+        }
+
+        ls_stateful_record_reinit(ls_stateful_rec, od, ls_pg,
+                                  input_data.ls_port_groups);
+
+        /* Add the ls_stateful_rec to the tracking data. */
+        hmapx_add(&data->trk_data.crupdated, ls_stateful_rec);
+    }
+
+    if (ls_stateful_has_tracked_data(&data->trk_data)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+    return true;
+}
+
 /* static functions. */
 static void
 ls_stateful_table_init(struct ls_stateful_table *table)
@@ -254,15 +313,46 @@ ls_stateful_table_clear(struct ls_stateful_table *table)
     }
 }
 
+struct ls_stateful_build_ctx {
+    const struct ovn_datapaths *ls_datapaths;
+    const struct ls_port_group_table *ls_pgs;
+    struct ls_stateful_record **records; /* Indexed by datapath index. */
+};
+
+static void
+ls_stateful_record_build_cb(size_t idx, void *ctx_)
+{
+    struct ls_stateful_build_ctx *ctx = ctx_;
+    const struct ovn_datapath *od =
+        ovn_datapaths_find_by_index(ctx->ls_datapaths, idx);
+
+    ctx->records[idx] = ls_stateful_record_create(od, ctx->ls_pgs);
+}
+
 static void
 ls_stateful_table_build(struct ls_stateful_table *table,
                         const struct ovn_datapaths *ls_datapaths,
                         const struct ls_port_group_table *ls_pgs)
 {
-    const struct ovn_datapath *od;
-    HMAP_FOR_EACH (od, key_node, &ls_datapaths->datapaths) {
-        ls_stateful_record_create(table, od, ls_pgs);
+    size_t n = ods_size(ls_datapaths);
+    struct ls_stateful_build_ctx ctx = {
+        .ls_datapaths = ls_datapaths,
+        .ls_pgs = ls_pgs,
+        .records = xmalloc(n * sizeof *ctx.records),
+    };
+
+    /* Each record only depends on its own switch, so the records are built
+     * on the worker threads and then inserted by the current thread. */
+    northd_prep_for_each("ls-stateful", n, ls_stateful_record_build_cb, &ctx);
+
+    hmap_reserve(&table->entries, n);
+    for (size_t i = 0; i < n; i++) {
+        struct ls_stateful_record *ls_stateful_rec = ctx.records[i];
+
+        hmap_insert(&table->entries, &ls_stateful_rec->key_node,
+                    uuid_hash(&ls_stateful_rec->nbs_uuid));
     }
+    free(ctx.records);
 }
 
 static struct ls_stateful_record *
@@ -280,9 +370,11 @@ ls_stateful_table_find_(const struct ls_stateful_table *table,
     return NULL;
 }
 
+/* Creates the record of 'od', to be inserted in the table by the caller.
+ * It may be called from the worker threads, see ls_stateful_table_build(),
+ * so it must not access the table. */
 static struct ls_stateful_record *
-ls_stateful_record_create(struct ls_stateful_table *table,
-                          const struct ovn_datapath *od,
+ls_stateful_record_create(const struct ovn_datapath *od,
                           const struct ls_port_group_table *ls_pgs)
 {
     struct ls_stateful_record *ls_stateful_rec =
@@ -292,9 +384,6 @@ ls_stateful_record_create(struct ls_stateful_table *table,
     ls_stateful_record_init(ls_stateful_rec, od, NULL, ls_pgs);
     ls_stateful_rec->lflow_ref = lflow_ref_create();
 
-    hmap_insert(&table->entries, &ls_stateful_rec->key_node,
-                uuid_hash(&od->nbs->header_.uuid));
-
     return ls_stateful_rec;
 }
 
@@ -425,6 +514,50 @@ ls_stateful_record_set_acl_flags_(struct ls_stateful_record *ls_stateful_rec,
     return false;
 }
 
+static bool
+acls_changed(struct nbrec_acl **acls, size_t n_acls)
+{
+    for (size_t i = 0; i < n_acls; i++) {
+        if (nbrec_acl_is_new(acls[i]) ||
+            nbrec_acl_row_get_seqno(acls[i], OVSDB_IDL_CHANGE_MODIFY) > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Returns true if any of the ACLs applied to the logical switch 'od', either
+ * directly or through the port groups in 'ls_pg', was created, deleted or
+ * modified in the current run. */
+static bool
+ls_acls_changed(const struct ovn_datapath *od,
+                const struct ls_port_group *ls_pg)
+{
+    const struct nbrec_logical_switch *nbs = od->nbs;
+
+    if (nbrec_logical_switch_is_updated(nbs, NBREC_LOGICAL_SWITCH_COL_ACLS)
+        || acls_changed(nbs->acls, nbs->n_acls)) {
+        return true;
+    }
+
+    if (!ls_pg) {
+        return false;
+    }
+
+    const struct ls_port_group_record *ls_pg_rec;
+    HMAP_FOR_EACH (ls_pg_rec, key_node, &ls_pg->nb_pgs) {
+        const struct nbrec_port_group *nb_pg = ls_pg_rec->nb_pg;
+
+        if (nbrec_port_group_is_updated(nb_pg, NBREC_PORT_GROUP_COL_ACLS)
+            || acls_changed(nb_pg->acls, nb_pg->n_acls)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static struct ls_stateful_input
 ls_stateful_get_input_data(struct engine_node *node)
 {
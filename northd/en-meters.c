@@ -17,6 +17,7 @@
 #include <config.h>
 
 #include "openvswitch/vlog.h"
+#include "sset.h"
 #include "stopwatch.h"
 
 #include "en-meters.h"
@@ -26,6 +27,13 @@ VLOG_DEFINE_THIS_MODULE(en_meters);
 
 static void build_meter_groups(struct shash *meter_group,
                                const struct nbrec_meter_table *);
+static bool bands_need_update(const struct nbrec_meter *,
+                              const struct sbrec_meter *);
+static void sync_meters_iterate_nb_meter(struct ovsdb_idl_txn *ovnsb_txn,
+                                         const char *meter_name,
+                                         const struct nbrec_meter *,
+                                         struct shash *sb_meters,
+                                         struct sset *used_sb_meters);
 static void sync_meters(struct ovsdb_idl_txn *ovnsb_txn,
                         const struct nbrec_meter_table *,
                         const struct nbrec_acl_table *,
@@ -40,6 +48,7 @@ void
 
     *data = (struct sync_meters_data) {
         .meter_groups = SHASH_INITIALIZER(&data->meter_groups),
+        .lflow_meters = SIMAP_INITIALIZER(&data->lflow_meters),
     };
     return data;
 }
@@ -50,6 +59,7 @@ en_sync_meters_cleanup(void *data_)
     struct sync_meters_data *data = data_;
 
     shash_destroy(&data->meter_groups);
+    simap_destroy(&data->lflow_meters);
 }
 
 void
@@ -72,6 +82,18 @@ en_sync_meters_run(struct engine_node *node, void *data_)
 
     build_meter_groups(&data->meter_groups, nb_meter_table);
 
+    struct simap lflow_meters = SIMAP_INITIALIZER(&lflow_meters);
+    struct shash_node *snode;
+    SHASH_FOR_EACH (snode, &data->meter_groups) {
+        simap_put(&lflow_meters, snode->name,
+                  !!fair_meter_lookup_by_name(&data->meter_groups,
+                                              snode->name));
+    }
+    data->meter_groups_changed = !simap_equal(&lflow_meters,
+                                              &data->lflow_meters);
+    simap_swap(&lflow_meters, &data->lflow_meters);
+    simap_destroy(&lflow_meters);
+
     sync_meters(eng_ctx->ovnsb_idl_txn, nb_meter_table, acl_table,
                 sb_meter_table, &data->meter_groups);
 
@@ -79,6 +101,100 @@ en_sync_meters_run(struct engine_node *node, void *data_)
     engine_set_node_state(node, EN_UPDATED);
 }
 
+/* Handler for NB ACL changes.  The ACLs only matter to this node if they
+ * log through a fair meter, in which case each of them gets a private copy
+ * of the meter in the SB.  Falls back to a full recompute only if such an
+ * ACL is created, deleted or has its logging configuration changed. */
+bool
+sync_meters_nb_acl_handler(struct engine_node *node, void *data_)
+{
+    struct sync_meters_data *data = data_;
+
+    const struct nbrec_acl_table *acl_table =
+        EN_OVSDB_GET(engine_get_input("NB_acl", node));
+
+    const struct nbrec_acl *acl;
+    NBREC_ACL_TABLE_FOR_EACH_TRACKED (acl, acl_table) {
+        if (nbrec_acl_is_new(acl) || nbrec_acl_is_deleted(acl)) {
+            if (acl->log && fair_meter_lookup_by_name(&data->meter_groups,
+                                                      acl->meter)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (nbrec_acl_is_updated(acl, NBREC_ACL_COL_LOG) ||
+            nbrec_acl_is_updated(acl, NBREC_ACL_COL_METER)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static const struct sbrec_meter *
+sb_meter_lookup_by_name(struct ovsdb_idl_index *sbrec_meter_by_name,
+                        const char *name)
+{
+    struct sbrec_meter *target =
+        sbrec_meter_index_init_row(sbrec_meter_by_name);
+    sbrec_meter_index_set_name(target, name);
+
+    const struct sbrec_meter *sb_meter =
+        sbrec_meter_index_find(sbrec_meter_by_name, target);
+    sbrec_meter_index_destroy_row(target);
+
+    return sb_meter;
+}
+
+/* Handler for NB Meter changes.  A change of the bands or of the unit of a
+ * meter, e.g. an update of a bandwidth limit, is synced to the SB copy of
+ * the meter directly.  Falls back to a full recompute if a meter is
+ * created, deleted or renamed, if a fair meter changes, since the ACLs that
+ * log through it have private copies of it, or if the SB copy is missing. */
+bool
+sync_meters_nb_meter_handler(struct engine_node *node, void *data_)
+{
+    struct sync_meters_data *data = data_;
+
+    const struct nbrec_meter_table *nb_meter_table =
+        EN_OVSDB_GET(engine_get_input("NB_meter", node));
+
+    struct ovsdb_idl_index *sbrec_meter_by_name =
+        engine_ovsdb_node_get_index(engine_get_input("SB_meter", node),
+                                    "sbrec_meter_by_name");
+
+    const struct engine_context *eng_ctx = engine_get_context();
+
+    const struct nbrec_meter *nb_meter;
+    NBREC_METER_TABLE_FOR_EACH_TRACKED (nb_meter, nb_meter_table) {
+        if (nbrec_meter_is_new(nb_meter) || nbrec_meter_is_deleted(nb_meter)
+            || nbrec_meter_is_updated(nb_meter, NBREC_METER_COL_NAME)
+            || nbrec_meter_is_updated(nb_meter, NBREC_METER_COL_FAIR)
+            || fair_meter_lookup_by_name(&data->meter_groups,
+                                         nb_meter->name)) {
+            return false;
+        }
+
+        const struct sbrec_meter *sb_meter =
+            sb_meter_lookup_by_name(sbrec_meter_by_name, nb_meter->name);
+        if (!sb_meter) {
+            return false;
+        }
+
+        struct shash sb_meters = SHASH_INITIALIZER(&sb_meters);
+        struct sset used_sb_meters = SSET_INITIALIZER(&used_sb_meters);
+
+        shash_add(&sb_meters, sb_meter->name, sb_meter);
+        sync_meters_iterate_nb_meter(eng_ctx->ovnsb_idl_txn, nb_meter->name,
+                                     nb_meter, &sb_meters, &used_sb_meters);
+        sset_destroy(&used_sb_meters);
+        shash_destroy(&sb_meters);
+    }
+
+    return true;
+}
+
 const struct nbrec_meter*
 fair_meter_lookup_by_name(const struct shash *meter_groups,
                           const char *meter_name)
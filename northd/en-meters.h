@@ -19,16 +19,25 @@
 #include "openvswitch/shash.h"
 
 #include "lib/inc-proc-eng.h"
+#include "simap.h"
 #include "lib/ovn-nb-idl.h"
 #include "lib/ovn-sb-idl.h"
 
 struct sync_meters_data {
     struct shash meter_groups;
+
+    /* The names of the meters in 'meter_groups' mapped to whether they are
+     * fair, which is all the logical flows depend on.  'meter_groups_changed'
+     * is set if that changed in the last run. */
+    struct simap lflow_meters;
+    bool meter_groups_changed;
 };
 
 void *en_sync_meters_init(struct engine_node *, struct engine_arg *);
 void en_sync_meters_cleanup(void *data);
 void en_sync_meters_run(struct engine_node *, void *data);
+bool sync_meters_nb_acl_handler(struct engine_node *, void *data);
+bool sync_meters_nb_meter_handler(struct engine_node *, void *data);
 
 const struct nbrec_meter *fair_meter_lookup_by_name(
     const struct shash *meter_groups,
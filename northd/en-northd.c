@@ -31,6 +31,7 @@
 #include "stopwatch.h"
 #include "lib/stopwatch-names.h"
 #include "northd.h"
+#include "simap.h"
 #include "lib/util.h"
 #include "openvswitch/vlog.h"
 
@@ -65,6 +66,18 @@ northd_get_input_data(struct engine_node *node,
         engine_ovsdb_node_get_index(
             engine_get_input("SB_fdb", node),
             "sbrec_fdb_by_dp_and_port");
+    input_data->sbrec_mac_binding_by_datapath =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_mac_binding", node),
+            "sbrec_mac_binding_by_datapath");
+    input_data->sbrec_template_var_by_chassis =
+        engine_ovsdb_node_get_index(
+            engine_get_input("SB_chassis_template_var", node),
+            "sbrec_template_var_by_chassis");
+    input_data->nbrec_template_var_by_chassis =
+        engine_ovsdb_node_get_index(
+            engine_get_input("NB_chassis_template_var", node),
+            "nbrec_template_var_by_chassis");
 
     input_data->nbrec_logical_switch_table =
         EN_OVSDB_GET(engine_get_input("NB_logical_switch", node));
@@ -176,20 +189,84 @@ northd_sb_port_binding_handler(struct engine_node *node,
     return true;
 }
 
+/* The northd engine node only syncs the template vars to the SB, none of
+ * its data depends on them. */
+bool
+northd_nb_chassis_template_var_handler(struct engine_node *node,
+                                       void *data OVS_UNUSED)
+{
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+
+    return northd_handle_nb_template_var_changes(
+        eng_ctx->ovnsb_idl_txn, input_data.nbrec_chassis_template_var_table,
+        input_data.sbrec_template_var_by_chassis);
+}
+
+bool
+northd_sb_chassis_template_var_handler(struct engine_node *node,
+                                       void *data OVS_UNUSED)
+{
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+
+    return northd_handle_sb_template_var_changes(
+        input_data.sbrec_chassis_template_var_table,
+        input_data.nbrec_template_var_by_chassis);
+}
+
+bool
+northd_sb_ha_chassis_group_handler(struct engine_node *node, void *data)
+{
+    const struct sbrec_ha_chassis_group_table *sb_ha_chassis_group_table =
+        EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
+    struct northd_data *nd = data;
+
+    return northd_handle_sb_ha_chassis_group_changes(
+        sb_ha_chassis_group_table, &nd->lr_datapaths);
+}
+
+bool
+northd_sb_service_monitor_handler(struct engine_node *node, void *data)
+{
+    const struct sbrec_service_monitor_table *sbrec_service_monitor_table =
+        EN_OVSDB_GET(engine_get_input("SB_service_monitor", node));
+    struct northd_data *nd = data;
+
+    if (!northd_handle_sb_service_monitor_changes(
+            sbrec_service_monitor_table, &nd->svc_monitor_map,
+            &nd->lb_datapaths_map, &nd->trk_data)) {
+        return false;
+    }
+
+    if (northd_has_lbs_in_tracked_data(&nd->trk_data)) {
+        engine_set_node_state(node, EN_UPDATED);
+    }
+
+    return true;
+}
+
 bool
 northd_nb_logical_router_handler(struct engine_node *node,
                                  void *data)
 {
+    const struct engine_context *eng_ctx = engine_get_context();
     struct northd_data *nd = data;
     struct northd_input input_data;
 
     northd_get_input_data(node, &input_data);
 
-    if (!northd_handle_lr_changes(&input_data, nd)) {
+    if (!northd_handle_lr_changes(eng_ctx->ovnsb_idl_txn, &input_data, nd)) {
         return false;
     }
 
-    if (northd_has_lr_nats_in_tracked_data(&nd->trk_data)) {
+    if (northd_has_lsps_in_tracked_data(&nd->trk_data) ||
+        northd_has_lr_nats_in_tracked_data(&nd->trk_data) ||
+        northd_has_lr_routes_in_tracked_data(&nd->trk_data) ||
+        northd_has_lr_policies_in_tracked_data(&nd->trk_data)) {
         engine_set_node_state(node, EN_UPDATED);
     }
 
@@ -215,6 +292,19 @@ northd_lb_data_handler(struct engine_node *node, void *data)
         return false;
     }
 
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct northd_input input_data;
+
+    northd_get_input_data(node, &input_data);
+    if (!northd_handle_lb_svc_changes(eng_ctx->ovnsb_idl_txn,
+                                      &lb_data->tracked_lb_data,
+                                      input_data.svc_monitor_mac,
+                                      &input_data.svc_monitor_mac_ea,
+                                      &nd->ls_ports, &nd->svc_monitor_lsps,
+                                      &nd->svc_monitor_map)) {
+        return false;
+    }
+
     if (northd_has_lbs_in_tracked_data(&nd->trk_data)) {
         engine_set_node_state(node, EN_UPDATED);
     }
@@ -253,6 +343,25 @@ en_northd_cleanup(void *data)
     northd_destroy(data);
 }
 
+void
+en_northd_get_memory_usage(const void *data_, struct simap *usage)
+{
+    const struct northd_data *data = data_;
+
+    simap_increase(usage, "northd-ls-datapaths",
+                   ods_size(&data->ls_datapaths));
+    simap_increase(usage, "northd-lr-datapaths",
+                   ods_size(&data->lr_datapaths));
+    simap_increase(usage, "northd-ls-ports", hmap_count(&data->ls_ports));
+    simap_increase(usage, "northd-lr-ports", hmap_count(&data->lr_ports));
+    simap_increase(usage, "northd-lb-datapaths",
+                   hmap_count(&data->lb_datapaths_map));
+    simap_increase(usage, "northd-lb-group-datapaths",
+                   hmap_count(&data->lb_group_datapaths_map));
+    simap_increase(usage, "northd-svc-monitors",
+                   hmap_count(&data->svc_monitor_map));
+}
+
 void
 en_northd_clear_tracked_data(void *data_)
 {
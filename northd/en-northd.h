@@ -13,11 +13,18 @@ void en_northd_run(struct engine_node *node OVS_UNUSED, void *data OVS_UNUSED);
 void *en_northd_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg);
 void en_northd_cleanup(void *data);
+void en_northd_get_memory_usage(const void *data, struct simap *usage);
 void en_northd_clear_tracked_data(void *data);
 bool northd_global_config_handler(struct engine_node *, void *data OVS_UNUSED);
 bool northd_nb_logical_switch_handler(struct engine_node *, void *data);
 bool northd_nb_logical_router_handler(struct engine_node *, void *data);
 bool northd_sb_port_binding_handler(struct engine_node *, void *data);
+bool northd_nb_chassis_template_var_handler(struct engine_node *,
+                                            void *data);
+bool northd_sb_chassis_template_var_handler(struct engine_node *,
+                                            void *data);
+bool northd_sb_ha_chassis_group_handler(struct engine_node *, void *data);
+bool northd_sb_service_monitor_handler(struct engine_node *, void *data);
 bool northd_lb_data_handler(struct engine_node *, void *data);
 
 #endif /* EN_NORTHD_H */
@@ -22,6 +22,7 @@
 #include "en-port-group.h"
 #include "lib/stopwatch-names.h"
 #include "northd.h"
+#include "simap.h"
 
 VLOG_DEFINE_THIS_MODULE(en_port_group);
 
@@ -38,6 +39,7 @@ static bool ls_port_group_process(
     struct port_group_ls_table *,
     const struct hmap *ls_ports,
     const struct nbrec_port_group *,
+    const struct ovn_datapath **port_ods,
     struct hmapx *updated_ls_port_groups);
 
 static void ls_port_group_record_clear(
@@ -65,7 +67,7 @@ static void port_group_ls_record_destroy(struct port_group_ls_table *,
 
 static const struct sbrec_port_group *create_sb_port_group(
     struct ovsdb_idl_txn *ovnsb_txn, const char *sb_pg_name);
-static void update_sb_port_group(struct sorted_array *nb_ports,
+static void update_sb_port_group(const struct sset *nb_ports,
                                  const struct sbrec_port_group *sb_pg);
 static const struct sbrec_port_group *sb_port_group_lookup_by_name(
     struct ovsdb_idl_index *sbrec_port_group_by_name, const char *name);
@@ -109,6 +111,34 @@ ls_port_group_table_find(const struct ls_port_group_table *table,
     return NULL;
 }
 
+struct ls_port_group_build_ctx {
+    const struct hmap *ls_ports;
+    const struct nbrec_port_group **nb_pgs;
+    size_t n_pgs;
+
+    /* For each port group, the datapath of each of its ports. */
+    const struct ovn_datapath ***port_ods;
+};
+
+static void
+ls_port_group_resolve_ports_cb(size_t idx, void *ctx_)
+{
+    struct ls_port_group_build_ctx *ctx = ctx_;
+    const struct nbrec_port_group *nb_pg = ctx->nb_pgs[idx];
+
+    if (!nb_pg->n_ports) {
+        return;
+    }
+
+    const struct ovn_datapath **port_ods =
+        xmalloc(nb_pg->n_ports * sizeof *port_ods);
+    for (size_t i = 0; i < nb_pg->n_ports; i++) {
+        port_ods[i] = northd_get_datapath_for_port(ctx->ls_ports,
+                                                   nb_pg->ports[i]->name);
+    }
+    ctx->port_ods[idx] = port_ods;
+}
+
 void
 ls_port_group_table_build(
     struct ls_port_group_table *ls_port_groups,
@@ -116,11 +146,34 @@ ls_port_group_table_build(
     const struct nbrec_port_group_table *pg_table,
     const struct hmap *ls_ports)
 {
+    struct ls_port_group_build_ctx ctx = {
+        .ls_ports = ls_ports,
+    };
+    size_t allocated = 0;
+
     const struct nbrec_port_group *nb_pg;
     NBREC_PORT_GROUP_TABLE_FOR_EACH (nb_pg, pg_table) {
-        ls_port_group_process(ls_port_groups, port_group_lses,
-                              ls_ports, nb_pg, NULL);
+        if (ctx.n_pgs >= allocated) {
+            ctx.nb_pgs = x2nrealloc(ctx.nb_pgs, &allocated,
+                                    sizeof *ctx.nb_pgs);
+        }
+        ctx.nb_pgs[ctx.n_pgs++] = nb_pg;
     }
+    ctx.port_ods = xcalloc(ctx.n_pgs, sizeof *ctx.port_ods);
+
+    /* Looking up the ports of a port group is independent from the other
+     * port groups, so that is done on the worker threads.  The tables are
+     * then filled by the current thread. */
+    northd_prep_for_each("port-groups", ctx.n_pgs,
+                         ls_port_group_resolve_ports_cb, &ctx);
+
+    for (size_t i = 0; i < ctx.n_pgs; i++) {
+        ls_port_group_process(ls_port_groups, port_group_lses, ls_ports,
+                              ctx.nb_pgs[i], ctx.port_ods[i], NULL);
+        free(ctx.port_ods[i]);
+    }
+    free(ctx.port_ods);
+    free(ctx.nb_pgs);
 }
 
 /* Each port group in Port_Group table in OVN_Northbound has a corresponding
@@ -158,10 +211,7 @@ ls_port_group_table_sync(
                                                      sb_pg_name_cstr);
             };
 
-            struct sorted_array ports =
-                sorted_array_from_sset(&ls_pg_rec->ports);
-            update_sb_port_group(&ports, sb_port_group);
-            sorted_array_destroy(&ports);
+            update_sb_port_group(&ls_pg_rec->ports, sb_port_group);
         }
     }
     ds_destroy(&sb_name);
@@ -209,12 +259,16 @@ ls_port_group_destroy(struct ls_port_group_table *ls_port_groups,
 /* Process a NB.Port_Group record and stores any updated ls_port_groups
  * in updated_ls_port_groups.  Returns true if a new ls_port_group had
  * to be created or destroyed.
+ *
+ * If 'port_ods' is nonnull, it holds the datapaths of the ports of 'nb_pg'
+ * already looked up in 'ls_ports'.
  */
 static bool
 ls_port_group_process(struct ls_port_group_table *ls_port_groups,
                       struct port_group_ls_table *port_group_lses,
                       const struct hmap *ls_ports,
                       const struct nbrec_port_group *nb_pg,
+                      const struct ovn_datapath **port_ods,
                       struct hmapx *updated_ls_port_groups)
 {
     struct hmapx cleared_ls_port_groups =
@@ -235,7 +289,8 @@ ls_port_group_process(struct ls_port_group_table *ls_port_groups,
     for (size_t i = 0; i < nb_pg->n_ports; i++) {
         const char *port_name = nb_pg->ports[i]->name;
         const struct ovn_datapath *od =
-            northd_get_datapath_for_port(ls_ports, port_name);
+            port_ods ? port_ods[i]
+                     : northd_get_datapath_for_port(ls_ports, port_name);
 
         if (!od) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
@@ -475,6 +530,17 @@ en_port_group_cleanup(void *data_)
     port_group_ls_table_destroy(&data->port_groups_lses);
 }
 
+void
+en_port_group_get_memory_usage(const void *data_, struct simap *usage)
+{
+    const struct port_group_data *data = data_;
+
+    simap_increase(usage, "port_group-ls-port-groups",
+                   hmap_count(&data->ls_port_groups.entries));
+    simap_increase(usage, "port_group-port-group-lses",
+                   hmap_count(&data->port_groups_lses.entries));
+}
+
 void
 en_port_group_clear_tracked_data(void *data_)
 {
@@ -536,7 +602,7 @@ port_group_nb_port_group_handler(struct engine_node *node, void *data_)
         if (ls_port_group_process(&data->ls_port_groups,
                                   &data->port_groups_lses,
                                   input_data.ls_ports,
-                                  nb_pg, &updated_ls_port_groups)) {
+                                  nb_pg, NULL, &updated_ls_port_groups)) {
             success = false;
             break;
         }
@@ -569,10 +635,7 @@ port_group_nb_port_group_handler(struct engine_node *node, void *data_)
                     sb_pg = create_sb_port_group(eng_ctx->ovnsb_idl_txn,
                                                  sb_pg_name_cstr);
                 }
-                struct sorted_array nb_ports =
-                    sorted_array_from_sset(&ls_pg_rec->ports);
-                update_sb_port_group(&nb_ports, sb_pg);
-                sorted_array_destroy(&nb_ports);
+                update_sb_port_group(&ls_pg_rec->ports, sb_pg);
             }
         }
         ds_destroy(&sb_pg_name);
@@ -606,12 +669,11 @@ create_sb_port_group(struct ovsdb_idl_txn *ovnsb_txn, const char *sb_pg_name)
 }
 
 static void
-update_sb_port_group(struct sorted_array *nb_ports,
+update_sb_port_group(const struct sset *nb_ports,
                      const struct sbrec_port_group *sb_pg)
 {
     struct sorted_array sb_ports = sorted_array_from_dbrec(sb_pg, ports);
-    sorted_array_apply_diff(nb_ports, &sb_ports,
-                            sb_port_group_apply_diff, sb_pg);
+    sset_apply_diff(nb_ports, &sb_ports, sb_port_group_apply_diff, sb_pg);
     sorted_array_destroy(&sb_ports);
 }
 
@@ -109,6 +109,7 @@ struct port_group_data {
 
 void *en_port_group_init(struct engine_node *, struct engine_arg *);
 void en_port_group_cleanup(void *data);
+void en_port_group_get_memory_usage(const void *data, struct simap *usage);
 void en_port_group_clear_tracked_data(void *data);
 void en_port_group_run(struct engine_node *, void *data);
 
@@ -20,6 +20,7 @@
 
 #include "openvswitch/util.h"
 
+#include "en-global-config.h"
 #include "en-sync-from-sb.h"
 #include "include/ovn/expr.h"
 #include "lib/inc-proc-eng.h"
@@ -32,32 +33,78 @@
 #include "timeval.h"
 #include "northd.h"
 
+#include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(en_sync_from_sb);
 
+struct ed_type_sync_from_sb_data {
+    struct lsp_up_batch lsp_up_batch;
+};
+
 void *
 en_sync_from_sb_init(struct engine_node *node OVS_UNUSED,
                      struct engine_arg *arg OVS_UNUSED)
 {
-    return NULL;
+    struct ed_type_sync_from_sb_data *data = xzalloc(sizeof *data);
+
+    lsp_up_batch_init(&data->lsp_up_batch);
+    return data;
+}
+
+/* Returns true if the options of 'global_config' configure 'batch'
+ * differently than it is. */
+static bool
+lsp_up_batch_configure(struct lsp_up_batch *batch,
+                       const struct ed_type_global_config *global_config)
+{
+    long long int max_delay_msec =
+        smap_get_ullong(&global_config->nb_options,
+                        "northd-lsp-up-max-delay-ms", 0);
+    size_t max_per_txn = smap_get_uint(&global_config->nb_options,
+                                       "northd-max-lsp-up-per-txn", 0);
+    bool changed = (max_delay_msec != batch->max_delay_msec
+                    || max_per_txn != batch->max_per_txn);
+
+    batch->max_delay_msec = max_delay_msec;
+    batch->max_per_txn = max_per_txn;
+    return changed;
+}
+
+static void
+sync_from_sb_schedule_waker(struct sync_from_sb_waker *waker,
+                            const struct lsp_up_batch *batch)
+{
+    waker->next_wake_msec = batch->next_msec;
+    if (waker->next_wake_msec != LLONG_MAX) {
+        poll_timer_wait_until(waker->next_wake_msec);
+    }
 }
 
 void
-en_sync_from_sb_run(struct engine_node *node, void *data OVS_UNUSED)
+en_sync_from_sb_run(struct engine_node *node, void *data_)
 {
     const struct engine_context *eng_ctx = engine_get_context();
     struct northd_data *nd = engine_get_input_data("northd", node);
+    struct ed_type_global_config *global_config =
+        engine_get_input_data("global_config", node);
+    struct sync_from_sb_waker *waker =
+        engine_get_input_data("sync_from_sb_waker", node);
+    struct ed_type_sync_from_sb_data *data = data_;
 
     const struct sbrec_port_binding_table *sb_pb_table =
         EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
     const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table =
         EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
+
+    lsp_up_batch_configure(&data->lsp_up_batch, global_config);
     stopwatch_start(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
     ovnsb_db_run(eng_ctx->ovnnb_idl_txn, eng_ctx->ovnsb_idl_txn,
                  sb_pb_table, sb_ha_ch_grp_table,
-                 &nd->ls_ports, &nd->lr_ports);
+                 &nd->ls_ports, &nd->lr_ports, &data->lsp_up_batch);
     stopwatch_stop(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
+
+    sync_from_sb_schedule_waker(waker, &data->lsp_up_batch);
 }
 
 bool
@@ -77,8 +124,123 @@ sync_from_sb_northd_handler(struct engine_node *node,
     return false;
 }
 
+/* Handles the tracked SB port bindings, along with the logical switch ports
+ * whose "up" column is pending, so that the cost of the runtime changes
+ * reported by the chassis is proportional to their number. */
+static bool
+sync_from_sb_handle_port_bindings(struct engine_node *node,
+                                  struct ed_type_sync_from_sb_data *data)
+{
+    struct northd_data *nd = engine_get_input_data("northd", node);
+    struct sync_from_sb_waker *waker =
+        engine_get_input_data("sync_from_sb_waker", node);
+    const struct sbrec_port_binding_table *sb_pb_table =
+        EN_OVSDB_GET(engine_get_input("SB_port_binding", node));
+
+    stopwatch_start(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
+    bool handled = ovnsb_db_handle_port_binding_changes(
+        sb_pb_table, &nd->ls_ports, &nd->lr_ports, &data->lsp_up_batch);
+    stopwatch_stop(OVNSB_DB_RUN_STOPWATCH_NAME, time_msec());
+    if (!handled) {
+        return false;
+    }
+
+    sync_from_sb_schedule_waker(waker, &data->lsp_up_batch);
+    return true;
+}
+
+bool
+sync_from_sb_sb_port_binding_handler(struct engine_node *node, void *data)
+{
+    return sync_from_sb_handle_port_bindings(node, data);
+}
+
+bool
+sync_from_sb_waker_handler(struct engine_node *node, void *data)
+{
+    /* The pending updates are due, only the pending ports need to be looked
+     * at. */
+    return sync_from_sb_handle_port_bindings(node, data);
+}
+
+bool
+sync_from_sb_sb_ha_chassis_group_handler(struct engine_node *node,
+                                         void *data OVS_UNUSED)
+{
+    const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table =
+        EN_OVSDB_GET(engine_get_input("SB_ha_chassis_group", node));
+    const struct sbrec_ha_chassis_group *ha_ch_grp;
+
+    SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH_TRACKED (ha_ch_grp,
+                                                   sb_ha_ch_grp_table) {
+        /* The "ref_chassis" column is written by this node, and only depends
+         * on the number of chassis of the groups. */
+        if (sbrec_ha_chassis_group_is_new(ha_ch_grp)
+            || sbrec_ha_chassis_group_is_deleted(ha_ch_grp)
+            || sbrec_ha_chassis_group_is_updated(
+                   ha_ch_grp, SBREC_HA_CHASSIS_GROUP_COL_NAME)
+            || sbrec_ha_chassis_group_is_updated(
+                   ha_ch_grp, SBREC_HA_CHASSIS_GROUP_COL_HA_CHASSIS)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+sync_from_sb_global_config_handler(struct engine_node *node, void *data_)
+{
+    struct ed_type_global_config *global_config =
+        engine_get_input_data("global_config", node);
+    struct ed_type_sync_from_sb_data *data = data_;
+
+    /* Runs again with the new batching options, e.g. to update the ports
+     * right away if they are not batched anymore. */
+    return !lsp_up_batch_configure(&data->lsp_up_batch, global_config);
+}
+
 void
-en_sync_from_sb_cleanup(void *data OVS_UNUSED)
+en_sync_from_sb_cleanup(void *data_)
 {
+    struct ed_type_sync_from_sb_data *data = data_;
 
+    lsp_up_batch_destroy(&data->lsp_up_batch);
+}
+
+/* The waker node is an input node, like the aging wakers, but the time at
+ * which it fires is set by the sync_from_sb node, when NB logical switch
+ * ports are left with their "up" column out of date. */
+void
+en_sync_from_sb_waker_run(struct engine_node *node, void *data)
+{
+    struct sync_from_sb_waker *waker = data;
+
+    engine_set_node_state(node, EN_UNCHANGED);
+
+    if (waker->next_wake_msec == LLONG_MAX) {
+        return;
+    }
+
+    if (time_msec() >= waker->next_wake_msec) {
+        waker->next_wake_msec = LLONG_MAX;
+        engine_set_node_state(node, EN_UPDATED);
+        return;
+    }
+
+    poll_timer_wait_until(waker->next_wake_msec);
+}
+
+void *
+en_sync_from_sb_waker_init(struct engine_node *node OVS_UNUSED,
+                           struct engine_arg *arg OVS_UNUSED)
+{
+    struct sync_from_sb_waker *waker = xmalloc(sizeof *waker);
+
+    waker->next_wake_msec = LLONG_MAX;
+    return waker;
+}
+
+void
+en_sync_from_sb_waker_cleanup(void *data OVS_UNUSED)
+{
 }
@@ -7,5 +7,20 @@ void *en_sync_from_sb_init(struct engine_node *, struct engine_arg *);
 void en_sync_from_sb_run(struct engine_node *, void *data);
 void en_sync_from_sb_cleanup(void *data);
 bool sync_from_sb_northd_handler(struct engine_node *, void *data OVS_UNUSED);
+bool sync_from_sb_global_config_handler(struct engine_node *, void *data);
+bool sync_from_sb_sb_port_binding_handler(struct engine_node *, void *data);
+bool sync_from_sb_sb_ha_chassis_group_handler(struct engine_node *,
+                                              void *data OVS_UNUSED);
+bool sync_from_sb_waker_handler(struct engine_node *, void *data);
+
+/* Data of the sync_from_sb_waker node, see "northd-lsp-up-max-delay-ms" in
+ * ovn-nb(5). */
+struct sync_from_sb_waker {
+    long long int next_wake_msec;   /* LLONG_MAX if not scheduled. */
+};
+
+void en_sync_from_sb_waker_run(struct engine_node *, void *data);
+void *en_sync_from_sb_waker_init(struct engine_node *, struct engine_arg *);
+void en_sync_from_sb_waker_cleanup(void *data);
 
 #endif /* end of EN_SYNC_FROM_SB_H */
@@ -19,7 +19,9 @@
 #include <stdio.h>
 
 /* OVS includes. */
+#include "lib/packets.h"
 #include "lib/svec.h"
+#include "openvswitch/dynamic-string.h"
 #include "openvswitch/util.h"
 
 /* OVN includes. */
@@ -49,14 +51,39 @@ static void sync_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
                            const struct sbrec_address_set_table *,
                            const struct lr_stateful_table *,
                            const struct ovn_datapaths *,
-                           const char *svc_monitor_macp);
+                           const char *svc_monitor_macp,
+                           bool aggregate, bool nat_address_sets);
+static void sync_lr_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
+                              const struct lr_stateful_record *,
+                              const struct ovn_datapath *,
+                              bool nat_address_sets,
+                              struct shash *sb_address_sets,
+                              struct ovsdb_idl_index *);
 static const struct sbrec_address_set *sb_address_set_lookup_by_name(
     struct ovsdb_idl_index *, const char *name);
 static void update_sb_addr_set(struct sorted_array *,
                                const struct sbrec_address_set *);
+static void update_sb_addr_set_from_sset(const struct sset *,
+                                         const struct sbrec_address_set *);
 static void build_port_group_address_set(const struct nbrec_port_group *,
                                          struct svec *ipv4_addrs,
                                          struct svec *ipv6_addrs);
+static struct sorted_array nb_addr_set_addresses(
+    const struct nbrec_address_set *, bool aggregate, struct svec *buf);
+
+static bool
+aggregate_address_sets(const struct ed_type_global_config *global_config)
+{
+    return smap_get_bool(&global_config->nb_options,
+                         "aggregate_address_sets", false);
+}
+
+static bool
+nat_address_sets(const struct ed_type_global_config *global_config)
+{
+    return smap_get_bool(&global_config->nb_options,
+                         "use_nat_address_sets", false);
+}
 
 void *
 en_sync_to_sb_init(struct engine_node *node OVS_UNUSED,
@@ -104,7 +131,9 @@ en_sync_to_sb_addr_set_run(struct engine_node *node, void *data OVS_UNUSED)
                    nb_port_group_table, sb_address_set_table,
                    &lr_stateful_data->table,
                    &northd_data->lr_datapaths,
-                   global_config->svc_monitor_mac);
+                   global_config->svc_monitor_mac,
+                   aggregate_address_sets(global_config),
+                   nat_address_sets(global_config));
 
     engine_set_node_state(node, EN_UPDATED);
 }
@@ -121,6 +150,9 @@ sync_to_sb_addr_set_nb_address_set_handler(struct engine_node *node,
 {
     const struct nbrec_address_set_table *nb_address_set_table =
         EN_OVSDB_GET(engine_get_input("NB_address_set", node));
+    const struct ed_type_global_config *global_config =
+        engine_get_input_data("global_config", node);
+    bool aggregate = aggregate_address_sets(global_config);
 
     /* Return false if an address set is created or deleted.
      * Handle I-P for only updated address sets. */
@@ -146,15 +178,82 @@ sync_to_sb_addr_set_nb_address_set_handler(struct engine_node *node,
         if (!sb_addr_set) {
             return false;
         }
+        struct svec buf = SVEC_EMPTY_INITIALIZER;
         struct sorted_array addrs =
-            sorted_array_from_dbrec(nb_addr_set, addresses);
+            nb_addr_set_addresses(nb_addr_set, aggregate, &buf);
         update_sb_addr_set(&addrs, sb_addr_set);
         sorted_array_destroy(&addrs);
+        svec_destroy(&buf);
+    }
+
+    return true;
+}
+
+bool
+sync_to_sb_addr_set_northd_handler(struct engine_node *node,
+                                   void *data OVS_UNUSED)
+{
+    struct northd_data *nd = engine_get_input_data("northd", node);
+
+    /* Only the tunnel keys of the logical routers are used, to name their
+     * address sets, and the routers being created or deleted results in a
+     * recompute of en_northd. */
+    return northd_has_tracked_data(&nd->trk_data);
+}
+
+/* Syncs only the address sets of the logical routers whose load balancers
+ * or NATs changed, e.g., so that attaching a floating IP only updates the
+ * NAT address set of its router. */
+bool
+sync_to_sb_addr_set_lr_stateful_handler(struct engine_node *node,
+                                        void *data OVS_UNUSED)
+{
+    struct ed_type_lr_stateful *lr_stateful_data =
+        engine_get_input_data("lr_stateful", node);
+    if (!lr_stateful_has_tracked_data(&lr_stateful_data->trk_data)) {
+        return false;
+    }
+
+    const struct engine_context *eng_ctx = engine_get_context();
+    struct ovsdb_idl_index *sbrec_address_set_by_name =
+        engine_ovsdb_node_get_index(
+                engine_get_input("SB_address_set", node),
+                "sbrec_address_set_by_name");
+    struct northd_data *northd_data = engine_get_input_data("northd", node);
+    const struct ed_type_global_config *global_config =
+        engine_get_input_data("global_config", node);
+
+    struct hmapx_node *hmapx_node;
+    HMAPX_FOR_EACH (hmapx_node, &lr_stateful_data->trk_data.crupdated) {
+        const struct lr_stateful_record *lr_stateful_rec = hmapx_node->data;
+        const struct ovn_datapath *od =
+            ovn_datapaths_find_by_index(&northd_data->lr_datapaths,
+                                        lr_stateful_rec->lr_index);
+
+        sync_lr_addr_sets(eng_ctx->ovnsb_idl_txn, lr_stateful_rec, od,
+                          nat_address_sets(global_config), NULL,
+                          sbrec_address_set_by_name);
     }
 
     return true;
 }
 
+/* Changing aggregate_address_sets or use_nat_address_sets requires syncing
+ * all the address sets again. */
+bool
+sync_to_sb_addr_set_global_config_handler(struct engine_node *node,
+                                          void *data)
+{
+    struct ed_type_global_config *global_config =
+        engine_get_input_data("global_config", node);
+
+    if (global_config->tracked_data.addr_set_options_changed) {
+        return false;
+    }
+
+    return node_global_config_handler(node, data);
+}
+
 bool
 sync_to_sb_addr_set_nb_port_group_handler(struct engine_node *node,
                                           void *data OVS_UNUSED)
@@ -230,8 +329,6 @@ struct sb_lb_record {
 
 struct sb_lb_table {
     struct hmap entries; /* Stores struct sb_lb_record. */
-    struct hmap ls_dp_groups;
-    struct hmap lr_dp_groups;
 };
 
 struct ed_type_sync_to_sb_lb_data {
@@ -244,6 +341,7 @@ static void sb_lb_table_destroy(struct sb_lb_table *);
 
 static struct sb_lb_record *sb_lb_table_find(struct hmap *sb_lbs,
                                              const struct uuid *);
+static void sb_lb_table_remove(struct sb_lb_table *, struct sb_lb_record *);
 static void sb_lb_table_build_and_sync(struct sb_lb_table *,
                                 struct ovsdb_idl_txn *ovnsb_txn,
                                 const struct sbrec_load_balancer_table *,
@@ -255,7 +353,6 @@ static void sb_lb_table_build_and_sync(struct sb_lb_table *,
 static bool sync_sb_lb_record(struct sb_lb_record *,
                               const struct sbrec_load_balancer *,
                               const struct sbrec_logical_dp_group_table *,
-                              struct sb_lb_table *,
                               struct ovsdb_idl_txn *ovnsb_txn,
                               struct ovn_datapaths *ls_datapaths,
                               struct ovn_datapaths *lr_datapaths,
@@ -417,6 +514,7 @@ sync_to_sb_pb_northd_handler(struct engine_node *node, void *data OVS_UNUSED)
         engine_get_input_data("lr_stateful", node);
 
     if (!sync_pbs_for_northd_changed_ovn_ports(&nd->trk_data.trk_lsps,
+                                               &nd->trk_data.trk_lrps,
                                                &lr_stateful_data->table)) {
         return false;
     }
@@ -465,7 +563,8 @@ sync_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
                const struct sbrec_address_set_table *sb_address_set_table,
                const struct lr_stateful_table *lr_statefuls,
                const struct ovn_datapaths *lr_datapaths,
-               const char *svc_monitor_macp)
+               const char *svc_monitor_macp,
+               bool aggregate, bool nat_address_sets)
 {
     struct shash sb_address_sets = SHASH_INITIALIZER(&sb_address_sets);
 
@@ -507,36 +606,14 @@ sync_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
         free(ipv6_addrs_name);
     }
 
-    /* Sync router load balancer VIP generated address sets. */
+    /* Sync router load balancer VIP and NAT generated address sets. */
     const struct lr_stateful_record *lr_stateful_rec;
     LR_STATEFUL_TABLE_FOR_EACH (lr_stateful_rec, lr_statefuls) {
         const struct ovn_datapath *od =
             ovn_datapaths_find_by_index(lr_datapaths,
                                         lr_stateful_rec->lr_index);
-        if (sset_count(&lr_stateful_rec->lb_ips->ips_v4_reachable)) {
-            char *ipv4_addrs_name =
-                lr_lb_address_set_name(od->tunnel_key, AF_INET);
-
-            struct sorted_array ipv4_addrs_sorted = sorted_array_from_sset(
-                &lr_stateful_rec->lb_ips->ips_v4_reachable);
-
-            sync_addr_set(ovnsb_txn, ipv4_addrs_name,
-                          &ipv4_addrs_sorted, &sb_address_sets);
-            sorted_array_destroy(&ipv4_addrs_sorted);
-            free(ipv4_addrs_name);
-        }
-
-        if (sset_count(&lr_stateful_rec->lb_ips->ips_v6_reachable)) {
-            char *ipv6_addrs_name =
-                lr_lb_address_set_name(od->tunnel_key, AF_INET6);
-            struct sorted_array ipv6_addrs_sorted = sorted_array_from_sset(
-                &lr_stateful_rec->lb_ips->ips_v6_reachable);
-
-            sync_addr_set(ovnsb_txn, ipv6_addrs_name,
-                          &ipv6_addrs_sorted, &sb_address_sets);
-            sorted_array_destroy(&ipv6_addrs_sorted);
-            free(ipv6_addrs_name);
-        }
+        sync_lr_addr_sets(ovnsb_txn, lr_stateful_rec, od, nat_address_sets,
+                          &sb_address_sets, NULL);
     }
 
     /* sync user defined address sets, which may overwrite port group
@@ -544,11 +621,13 @@ sync_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
     const struct nbrec_address_set *nb_address_set;
     NBREC_ADDRESS_SET_TABLE_FOR_EACH (nb_address_set,
                                       nb_address_set_table) {
+        struct svec buf = SVEC_EMPTY_INITIALIZER;
         struct sorted_array addrs =
-                sorted_array_from_dbrec(nb_address_set, addresses);
+                nb_addr_set_addresses(nb_address_set, aggregate, &buf);
         sync_addr_set(ovnsb_txn, nb_address_set->name,
                       &addrs, &sb_address_sets);
         sorted_array_destroy(&addrs);
+        svec_destroy(&buf);
     }
 
     struct shash_node *node;
@@ -559,6 +638,90 @@ sync_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
     shash_destroy(&sb_address_sets);
 }
 
+/* Syncs the router address set 'name' to 'ips'.  During a full sync,
+ * 'sb_address_sets' contains the SB address sets not synced yet, which are
+ * deleted afterwards, so the address set is left out if 'ips' is empty.
+ * Otherwise, the address set is looked up in 'sbrec_address_set_by_name',
+ * and it is deleted if 'ips' is empty. */
+static void
+sync_lr_addr_set(struct ovsdb_idl_txn *ovnsb_txn, const char *name,
+                 struct sset *ips, struct shash *sb_address_sets,
+                 struct ovsdb_idl_index *sbrec_address_set_by_name)
+{
+    if (sb_address_sets) {
+        if (!sset_is_empty(ips)) {
+            struct sorted_array addrs = sorted_array_from_sset(ips);
+            sync_addr_set(ovnsb_txn, name, &addrs, sb_address_sets);
+            sorted_array_destroy(&addrs);
+        }
+        return;
+    }
+
+    const struct sbrec_address_set *sb_address_set =
+        sb_address_set_lookup_by_name(sbrec_address_set_by_name, name);
+    if (sset_is_empty(ips)) {
+        if (sb_address_set) {
+            sbrec_address_set_delete(sb_address_set);
+        }
+        return;
+    }
+
+    if (!sb_address_set) {
+        struct sorted_array addrs = sorted_array_from_sset(ips);
+        sb_address_set = sbrec_address_set_insert(ovnsb_txn);
+        sbrec_address_set_set_name(sb_address_set, name);
+        sbrec_address_set_set_addresses(sb_address_set, addrs.arr, addrs.n);
+        sorted_array_destroy(&addrs);
+    } else {
+        update_sb_addr_set_from_sset(ips, sb_address_set);
+    }
+}
+
+/* Syncs the address sets generated for the logical router 'od': the ones of
+ * its reachable load balancer VIPs and, if 'nat_address_sets' is true, the
+ * ones of the NAT external IPs that its connected switches forward ARP
+ * requests and IPv6 NS for.  See sync_lr_addr_set() for 'sb_address_sets'
+ * and 'sbrec_address_set_by_name'. */
+static void
+sync_lr_addr_sets(struct ovsdb_idl_txn *ovnsb_txn,
+                  const struct lr_stateful_record *lr_stateful_rec,
+                  const struct ovn_datapath *od, bool nat_address_sets,
+                  struct shash *sb_address_sets,
+                  struct ovsdb_idl_index *sbrec_address_set_by_name)
+{
+    char *name = lr_lb_address_set_name(od->tunnel_key, AF_INET);
+    sync_lr_addr_set(ovnsb_txn, name,
+                     &lr_stateful_rec->lb_ips->ips_v4_reachable,
+                     sb_address_sets, sbrec_address_set_by_name);
+    free(name);
+
+    name = lr_lb_address_set_name(od->tunnel_key, AF_INET6);
+    sync_lr_addr_set(ovnsb_txn, name,
+                     &lr_stateful_rec->lb_ips->ips_v6_reachable,
+                     sb_address_sets, sbrec_address_set_by_name);
+    free(name);
+
+    struct sset nat_ips_v4 = SSET_INITIALIZER(&nat_ips_v4);
+    struct sset nat_ips_v6 = SSET_INITIALIZER(&nat_ips_v6);
+    if (nat_address_sets) {
+        lr_stateful_record_get_arp_req_nat_ips(lr_stateful_rec, &nat_ips_v4,
+                                               &nat_ips_v6);
+    }
+
+    name = lr_nat_address_set_name(od->tunnel_key, AF_INET);
+    sync_lr_addr_set(ovnsb_txn, name, &nat_ips_v4,
+                     sb_address_sets, sbrec_address_set_by_name);
+    free(name);
+
+    name = lr_nat_address_set_name(od->tunnel_key, AF_INET6);
+    sync_lr_addr_set(ovnsb_txn, name, &nat_ips_v6,
+                     sb_address_sets, sbrec_address_set_by_name);
+    free(name);
+
+    sset_destroy(&nat_ips_v4);
+    sset_destroy(&nat_ips_v6);
+}
+
 static void
 sb_addr_set_apply_diff(const void *arg, const char *item, bool add)
 {
@@ -581,6 +744,18 @@ update_sb_addr_set(struct sorted_array *nb_addresses,
     sorted_array_destroy(&sb_addresses);
 }
 
+/* Same as update_sb_addr_set(), without sorting 'nb_addresses'. */
+static void
+update_sb_addr_set_from_sset(const struct sset *nb_addresses,
+                             const struct sbrec_address_set *sb_as)
+{
+    struct sorted_array sb_addresses =
+        sorted_array_from_dbrec(sb_as, addresses);
+    sset_apply_diff(nb_addresses, &sb_addresses, sb_addr_set_apply_diff,
+                    sb_as);
+    sorted_array_destroy(&sb_addresses);
+}
+
 static void
 build_port_group_address_set(const struct nbrec_port_group *nb_port_group,
                              struct svec *ipv4_addrs,
@@ -600,6 +775,194 @@ build_port_group_address_set(const struct nbrec_port_group *nb_port_group,
     }
 }
 
+/* An IPv4 or IPv6 prefix.  IPv4 prefixes are stored as IPv4-mapped IPv6
+ * addresses, so 'plen' is always counted on 128 bits. */
+struct addr_prefix {
+    struct in6_addr addr;
+    unsigned int plen;
+};
+
+static bool
+addr_prefix_bit(const struct in6_addr *addr, unsigned int bit)
+{
+    return addr->s6_addr[bit / 8] & (0x80 >> (bit % 8));
+}
+
+static int
+addr_prefix_cmp(const void *a_, const void *b_)
+{
+    const struct addr_prefix *a = a_;
+    const struct addr_prefix *b = b_;
+    int cmp = memcmp(&a->addr, &b->addr, sizeof a->addr);
+
+    return cmp ? cmp : (a->plen > b->plen) - (a->plen < b->plen);
+}
+
+/* Returns true if 'outer' covers all the addresses of 'inner'. */
+static bool
+addr_prefix_contains(const struct addr_prefix *outer,
+                     const struct addr_prefix *inner)
+{
+    if (outer->plen > inner->plen) {
+        return false;
+    }
+
+    struct in6_addr mask = ipv6_create_mask(outer->plen);
+    struct in6_addr masked = ipv6_addr_bitand(&inner->addr, &mask);
+    return ipv6_addr_equals(&masked, &outer->addr);
+}
+
+/* Parses 's' as an IPv4 or IPv6 address or CIDR into 'p'.  Returns false if
+ * 's' is something else, e.g., a MAC address, or if it has bits set past
+ * the prefix length, so that such entries are kept exactly as they are. */
+static bool
+addr_prefix_parse(const char *s, struct addr_prefix *p, bool *is_ipv4)
+{
+    ovs_be32 ipv4;
+    char *error = ip_parse_cidr(s, &ipv4, &p->plen);
+    if (!error) {
+        if (ipv4 & ~be32_prefix_mask(p->plen)) {
+            return false;
+        }
+        in6_addr_set_mapped_ipv4(&p->addr, ipv4);
+        p->plen += 96;
+        *is_ipv4 = true;
+        return true;
+    }
+    free(error);
+
+    error = ipv6_parse_cidr(s, &p->addr, &p->plen);
+    if (!error) {
+        struct in6_addr mask = ipv6_create_mask(p->plen);
+        struct in6_addr masked = ipv6_addr_bitand(&p->addr, &mask);
+        *is_ipv4 = false;
+        return ipv6_addr_equals(&masked, &p->addr);
+    }
+    free(error);
+
+    return false;
+}
+
+/* Sorts the 'n' prefixes of 'prefixes', drops the ones covered by another
+ * prefix, and merges the pairs of adjacent prefixes that are the two halves
+ * of a shorter one, without going under 'min_plen'.  The result is the
+ * smallest set of prefixes that covers exactly the same addresses.  It is
+ * stored at the beginning of 'prefixes' and its size is returned. */
+static size_t
+addr_prefixes_aggregate(struct addr_prefix *prefixes, size_t n,
+                        unsigned int min_plen)
+{
+    size_t n_out = 0;
+
+    qsort(prefixes, n, sizeof *prefixes, addr_prefix_cmp);
+    for (size_t i = 0; i < n; i++) {
+        struct addr_prefix p = prefixes[i];
+
+        /* Thanks to the sorting, only the last prefix kept can cover 'p'. */
+        if (n_out && addr_prefix_contains(&prefixes[n_out - 1], &p)) {
+            continue;
+        }
+
+        /* 'p' is the upper half of a shorter prefix whose lower half is the
+         * last prefix kept, replace both of them with it.  This can
+         * cascade back through the prefixes kept so far. */
+        while (n_out && p.plen > min_plen
+               && prefixes[n_out - 1].plen == p.plen
+               && addr_prefix_bit(&p.addr, p.plen - 1)) {
+            struct in6_addr lower = p.addr;
+
+            lower.s6_addr[(p.plen - 1) / 8] &= ~(0x80 >> ((p.plen - 1) % 8));
+            if (!ipv6_addr_equals(&lower, &prefixes[n_out - 1].addr)) {
+                break;
+            }
+            p.addr = lower;
+            p.plen--;
+            n_out--;
+        }
+        prefixes[n_out++] = p;
+    }
+
+    return n_out;
+}
+
+static void
+addr_prefixes_format(const struct addr_prefix *prefixes, size_t n,
+                     bool is_ipv4, struct svec *out)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+
+    for (size_t i = 0; i < n; i++) {
+        const struct addr_prefix *p = &prefixes[i];
+
+        ds_clear(&s);
+        if (is_ipv4) {
+            ds_put_format(&s, IP_FMT,
+                          IP_ARGS(in6_addr_get_mapped_ipv4(&p->addr)));
+            if (p->plen < 128) {
+                ds_put_format(&s, "/%u", p->plen - 96);
+            }
+        } else {
+            ipv6_format_addr(&p->addr, &s);
+            if (p->plen < 128) {
+                ds_put_format(&s, "/%u", p->plen);
+            }
+        }
+        svec_add(out, ds_cstr(&s));
+    }
+    ds_destroy(&s);
+}
+
+/* Collapses the IPv4 and IPv6 addresses and CIDRs of 'addresses' into the
+ * minimal set of prefixes that covers them, and adds the result to 'out'.
+ * The other entries of 'addresses' are added to 'out' unchanged. */
+static void
+aggregate_addresses(const struct sorted_array *addresses, struct svec *out)
+{
+    struct addr_prefix *v4 = xmalloc(MAX(addresses->n, 1) * sizeof *v4);
+    struct addr_prefix *v6 = xmalloc(MAX(addresses->n, 1) * sizeof *v6);
+    size_t n_v4 = 0, n_v6 = 0;
+
+    for (size_t i = 0; i < addresses->n; i++) {
+        struct addr_prefix p;
+        bool is_ipv4;
+
+        if (!addr_prefix_parse(addresses->arr[i], &p, &is_ipv4)) {
+            svec_add(out, addresses->arr[i]);
+        } else if (is_ipv4) {
+            v4[n_v4++] = p;
+        } else {
+            v6[n_v6++] = p;
+        }
+    }
+
+    n_v4 = addr_prefixes_aggregate(v4, n_v4, 96);
+    n_v6 = addr_prefixes_aggregate(v6, n_v6, 0);
+    addr_prefixes_format(v4, n_v4, true, out);
+    addr_prefixes_format(v6, n_v6, false, out);
+
+    free(v4);
+    free(v6);
+}
+
+/* Returns the addresses to sync to the SB for 'nb_address_set'.  If
+ * 'aggregate' is true, they are aggregated into 'buf', which the caller
+ * must destroy together with the returned array. */
+static struct sorted_array
+nb_addr_set_addresses(const struct nbrec_address_set *nb_address_set,
+                      bool aggregate, struct svec *buf)
+{
+    struct sorted_array addrs =
+        sorted_array_from_dbrec(nb_address_set, addresses);
+
+    if (!aggregate) {
+        return addrs;
+    }
+
+    aggregate_addresses(&addrs, buf);
+    sorted_array_destroy(&addrs);
+    return sorted_array_from_svec(buf);
+}
+
 /* Finds and returns the address set with the given 'name', or NULL if no such
  * address set exists. */
 static const struct sbrec_address_set *
@@ -624,20 +987,15 @@ static void
 sb_lb_table_init(struct sb_lb_table *sb_lbs)
 {
     hmap_init(&sb_lbs->entries);
-    ovn_dp_groups_init(&sb_lbs->ls_dp_groups);
-    ovn_dp_groups_init(&sb_lbs->lr_dp_groups);
 }
 
 static void
 sb_lb_table_clear(struct sb_lb_table *sb_lbs)
 {
     struct sb_lb_record *sb_lb;
-    HMAP_FOR_EACH_POP (sb_lb, key_node, &sb_lbs->entries) {
-        free(sb_lb);
+    HMAP_FOR_EACH_SAFE (sb_lb, key_node, &sb_lbs->entries) {
+        sb_lb_table_remove(sb_lbs, sb_lb);
     }
-
-    ovn_dp_groups_clear(&sb_lbs->ls_dp_groups);
-    ovn_dp_groups_clear(&sb_lbs->lr_dp_groups);
 }
 
 static void
@@ -645,8 +1003,17 @@ sb_lb_table_destroy(struct sb_lb_table *sb_lbs)
 {
     sb_lb_table_clear(sb_lbs);
     hmap_destroy(&sb_lbs->entries);
-    ovn_dp_groups_destroy(&sb_lbs->ls_dp_groups);
-    ovn_dp_groups_destroy(&sb_lbs->lr_dp_groups);
+}
+
+/* Removes 'sb_lb' from 'sb_lbs' and frees it, releasing its datapath
+ * groups. */
+static void
+sb_lb_table_remove(struct sb_lb_table *sb_lbs, struct sb_lb_record *sb_lb)
+{
+    hmap_remove(&sb_lbs->entries, &sb_lb->key_node);
+    ovn_dp_group_release(sb_lb->ls_dpg);
+    ovn_dp_group_release(sb_lb->lr_dpg);
+    free(sb_lb);
 }
 
 static struct sb_lb_record *
@@ -701,7 +1068,7 @@ sb_lb_table_build_and_sync(
         if (sb_lb) {
             sb_lb->sbrec_lb = sbrec_lb;
             bool success = sync_sb_lb_record(sb_lb, sbrec_lb, sb_dpgrp_table,
-                                             sb_lbs, ovnsb_txn, ls_datapaths,
+                                             ovnsb_txn, ls_datapaths,
                                              lr_datapaths, chassis_features);
             /* Since we are rebuilding and syncing,  sync_sb_lb_record should
              * not return false. */
@@ -716,7 +1083,7 @@ sb_lb_table_build_and_sync(
     }
 
     HMAP_FOR_EACH_POP (sb_lb, key_node, &tmp_sb_lbs) {
-        bool success = sync_sb_lb_record(sb_lb, NULL, sb_dpgrp_table, sb_lbs,
+        bool success = sync_sb_lb_record(sb_lb, NULL, sb_dpgrp_table,
                                          ovnsb_txn, ls_datapaths, lr_datapaths,
                                          chassis_features);
         /* Since we are rebuilding and syncing,  sync_sb_lb_record should not
@@ -734,7 +1101,6 @@ static bool
 sync_sb_lb_record(struct sb_lb_record *sb_lb,
                   const struct sbrec_load_balancer *sbrec_lb,
                   const struct sbrec_logical_dp_group_table *sb_dpgrp_table,
-                  struct sb_lb_table *sb_lbs,
                   struct ovsdb_idl_txn *ovnsb_txn,
                   struct ovn_datapaths *ls_datapaths,
                   struct ovn_datapaths *lr_datapaths,
@@ -771,16 +1137,12 @@ sync_sb_lb_record(struct sb_lb_record *sb_lb,
     }
 
     if (lb_dps->n_nb_ls) {
-        sb_lb->ls_dpg = ovn_dp_group_get(&sb_lbs->ls_dp_groups,
-                                         lb_dps->n_nb_ls,
+        sb_lb->ls_dpg = ovn_dp_group_get(true, lb_dps->n_nb_ls,
                                          lb_dps->nb_ls_map,
                                          ods_size(ls_datapaths));
         if (sb_lb->ls_dpg) {
             /* Update the dpg's sb dp_group. */
-            sb_lb->ls_dpg->dp_group =
-                sbrec_logical_dp_group_table_get_for_uuid(sb_dpgrp_table,
-                                                    &sb_lb->ls_dpg->dpg_uuid);
-            if (!sb_lb->ls_dpg->dp_group) {
+            if (!ovn_dp_group_refresh(sb_lb->ls_dpg, sb_dpgrp_table)) {
                 /* Ideally this should not happen.  But it can still happen
                  * due to 2 reasons:
                  * 1. There is a bug in the dp_group management.  We should
@@ -798,11 +1160,13 @@ sync_sb_lb_record(struct sb_lb_record *sb_lb,
                             "have been referencing the dp group ["UUID_FMT"]",
                             sb_lb->lb_dps->lb->nlb->name,
                             UUID_ARGS(&sb_lb->ls_dpg->dpg_uuid));
+                sb_lb->ls_dpg = pre_sync_ls_dpg;
+                sb_lb->lr_dpg = pre_sync_lr_dpg;
                 return false;
             }
         } else {
             sb_lb->ls_dpg = ovn_dp_group_create(
-                ovnsb_txn, &sb_lbs->ls_dp_groups, sbrec_ls_dp_group,
+                ovnsb_txn, sbrec_ls_dp_group,
                 lb_dps->n_nb_ls, lb_dps->nb_ls_map,
                 ods_size(ls_datapaths), true,
                 ls_datapaths, lr_datapaths);
@@ -820,22 +1184,19 @@ sync_sb_lb_record(struct sb_lb_record *sb_lb,
 
         }
     } else {
+        sb_lb->ls_dpg = NULL;
         sbrec_load_balancer_set_ls_datapath_group(sbrec_lb, NULL);
         sbrec_load_balancer_set_datapath_group(sbrec_lb, NULL);
     }
 
 
     if (lb_dps->n_nb_lr) {
-        sb_lb->lr_dpg = ovn_dp_group_get(&sb_lbs->lr_dp_groups,
-                                         lb_dps->n_nb_lr,
+        sb_lb->lr_dpg = ovn_dp_group_get(false, lb_dps->n_nb_lr,
                                          lb_dps->nb_lr_map,
                                          ods_size(lr_datapaths));
         if (sb_lb->lr_dpg) {
             /* Update the dpg's sb dp_group. */
-            sb_lb->lr_dpg->dp_group =
-                sbrec_logical_dp_group_table_get_for_uuid(sb_dpgrp_table,
-                                                    &sb_lb->lr_dpg->dpg_uuid);
-            if (!sb_lb->lr_dpg->dp_group) {
+            if (!ovn_dp_group_refresh(sb_lb->lr_dpg, sb_dpgrp_table)) {
                 /* Ideally this should not happen.  But it can still happen
                  * due to 2 reasons:
                  * 1. There is a bug in the dp_group management.  We should
@@ -853,11 +1214,13 @@ sync_sb_lb_record(struct sb_lb_record *sb_lb,
                             "have been referencing the dp group ["UUID_FMT"]",
                             sb_lb->lb_dps->lb->nlb->name,
                             UUID_ARGS(&sb_lb->lr_dpg->dpg_uuid));
+                sb_lb->ls_dpg = pre_sync_ls_dpg;
+                sb_lb->lr_dpg = pre_sync_lr_dpg;
                 return false;
             }
         } else {
             sb_lb->lr_dpg = ovn_dp_group_create(
-                ovnsb_txn, &sb_lbs->lr_dp_groups, sbrec_lr_dp_group,
+                ovnsb_txn, sbrec_lr_dp_group,
                 lb_dps->n_nb_lr, lb_dps->nb_lr_map,
                 ods_size(lr_datapaths), false,
                 ls_datapaths, lr_datapaths);
@@ -866,25 +1229,18 @@ sync_sb_lb_record(struct sb_lb_record *sb_lb,
         sbrec_load_balancer_set_lr_datapath_group(sbrec_lb,
                                                   sb_lb->lr_dpg->dp_group);
     } else {
+        sb_lb->lr_dpg = NULL;
         sbrec_load_balancer_set_lr_datapath_group(sbrec_lb, NULL);
     }
 
     if (pre_sync_ls_dpg != sb_lb->ls_dpg) {
-        if (sb_lb->ls_dpg) {
-            inc_ovn_dp_group_ref(sb_lb->ls_dpg);
-        }
-        if (pre_sync_ls_dpg) {
-            dec_ovn_dp_group_ref(&sb_lbs->ls_dp_groups, pre_sync_ls_dpg);
-        }
+        ovn_dp_group_use(sb_lb->ls_dpg);
+        ovn_dp_group_release(pre_sync_ls_dpg);
     }
 
     if (pre_sync_lr_dpg != sb_lb->lr_dpg) {
-        if (sb_lb->lr_dpg) {
-            inc_ovn_dp_group_ref(sb_lb->lr_dpg);
-        }
-        if (pre_sync_lr_dpg) {
-            dec_ovn_dp_group_ref(&sb_lbs->lr_dp_groups, pre_sync_lr_dpg);
-        }
+        ovn_dp_group_use(sb_lb->lr_dpg);
+        ovn_dp_group_release(pre_sync_lr_dpg);
     }
 
     /* Update columns. */
@@ -934,8 +1290,7 @@ sync_changed_lbs(struct sb_lb_table *sb_lbs,
                 sbrec_load_balancer_delete(sbrec_lb);
             }
 
-            hmap_remove(&sb_lbs->entries, &sb_lb->key_node);
-            free(sb_lb);
+            sb_lb_table_remove(sb_lbs, sb_lb);
         }
     }
 
@@ -968,11 +1323,11 @@ sync_changed_lbs(struct sb_lb_table *sb_lbs,
                 sbrec_load_balancer_delete(sbrec_lb);
             }
 
-            hmap_remove(&sb_lbs->entries, &sb_lb->key_node);
-            free(sb_lb);
+            sb_lb_table_remove(sb_lbs, sb_lb);
+            continue;
         }
 
-        if (!sync_sb_lb_record(sb_lb, sb_lb->sbrec_lb, sb_dpgrp_table, sb_lbs,
+        if (!sync_sb_lb_record(sb_lb, sb_lb->sbrec_lb, sb_dpgrp_table,
                                ovnsb_txn, ls_datapaths, lr_datapaths,
                                chassis_features)) {
             return false;
@@ -15,6 +15,12 @@ bool sync_to_sb_addr_set_nb_address_set_handler(struct engine_node *,
                                                 void *data);
 bool sync_to_sb_addr_set_nb_port_group_handler(struct engine_node *,
                                                void *data);
+bool sync_to_sb_addr_set_global_config_handler(struct engine_node *,
+                                               void *data);
+bool sync_to_sb_addr_set_northd_handler(struct engine_node *,
+                                        void *data OVS_UNUSED);
+bool sync_to_sb_addr_set_lr_stateful_handler(struct engine_node *,
+                                             void *data);
 
 
 void *en_sync_to_sb_lb_init(struct engine_node *, struct engine_arg *);
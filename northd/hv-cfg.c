@@ -0,0 +1,392 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "hv-cfg.h"
+
+#include "coverage.h"
+#include "hash.h"
+#include "lib/ovn-sb-idl.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/list.h"
+#include "openvswitch/vlog.h"
+#include "smap.h"
+#include "util.h"
+#include "uuid.h"
+
+VLOG_DEFINE_THIS_MODULE(hv_cfg);
+
+COVERAGE_DEFINE(hv_cfg_index_rebuild);
+
+struct hv_cfg_bucket {
+    struct hmap_node hmap_node;   /* In hv_cfg_index 'buckets'. */
+    struct heap_node min_node;    /* In hv_cfg_index 'min_heap'. */
+    struct heap_node max_node;    /* In hv_cfg_index 'max_heap'. */
+    int64_t nb_cfg;
+    struct ovs_list chassis;      /* Contains "struct hv_cfg_chassis". */
+};
+
+struct hv_cfg_chassis {
+    struct hmap_node hmap_node;   /* In hv_cfg_index 'chassis', by UUID. */
+    struct ovs_list list_node;    /* In 'bucket''s 'chassis'. */
+    struct uuid uuid;             /* Of the Chassis_Private record. */
+    int64_t nb_cfg_timestamp;
+    struct hv_cfg_bucket *bucket;
+};
+
+void
+hv_cfg_index_init(struct hv_cfg_index *index)
+{
+    hmap_init(&index->chassis);
+    hmap_init(&index->buckets);
+    heap_init(&index->min_heap);
+    heap_init(&index->max_heap);
+    index->valid = false;
+
+    index->nb_cfg = 0;
+    index->nb_cfg_ts = 0;
+    index->sb_cfg = 0;
+    index->sb_cfg_nb_ts = 0;
+    index->sb_cfg_ts = 0;
+    index->hv_cfg_reached = false;
+    hv_cfg_index_clear_latency(index);
+}
+
+static void
+hv_cfg_index_clear(struct hv_cfg_index *index)
+{
+    struct hv_cfg_chassis *chassis;
+    HMAP_FOR_EACH_POP (chassis, hmap_node, &index->chassis) {
+        free(chassis);
+    }
+
+    struct hv_cfg_bucket *bucket;
+    HMAP_FOR_EACH_POP (bucket, hmap_node, &index->buckets) {
+        free(bucket);
+    }
+    heap_destroy(&index->min_heap);
+    heap_init(&index->min_heap);
+    heap_destroy(&index->max_heap);
+    heap_init(&index->max_heap);
+}
+
+void
+hv_cfg_index_destroy(struct hv_cfg_index *index)
+{
+    hv_cfg_index_clear(index);
+    hmap_destroy(&index->chassis);
+    hmap_destroy(&index->buckets);
+    heap_destroy(&index->min_heap);
+    heap_destroy(&index->max_heap);
+}
+
+/* Makes the next hv_cfg_index_run() rebuild 'index' from all the
+ * Chassis_Private records instead of their tracked changes. */
+void
+hv_cfg_index_invalidate(struct hv_cfg_index *index)
+{
+    index->valid = false;
+}
+
+/* Maps 'nb_cfg' to a heap priority in the same order. */
+static uint64_t
+hv_cfg_priority(int64_t nb_cfg)
+{
+    return (uint64_t) nb_cfg ^ (UINT64_C(1) << 63);
+}
+
+static struct hv_cfg_bucket *
+hv_cfg_bucket_find(const struct hv_cfg_index *index, int64_t nb_cfg)
+{
+    struct hv_cfg_bucket *bucket;
+    HMAP_FOR_EACH_WITH_HASH (bucket, hmap_node, hash_uint64(nb_cfg),
+                             &index->buckets) {
+        if (bucket->nb_cfg == nb_cfg) {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+static struct hv_cfg_bucket *
+hv_cfg_bucket_get(struct hv_cfg_index *index, int64_t nb_cfg)
+{
+    struct hv_cfg_bucket *bucket = hv_cfg_bucket_find(index, nb_cfg);
+    if (!bucket) {
+        bucket = xmalloc(sizeof *bucket);
+        bucket->nb_cfg = nb_cfg;
+        ovs_list_init(&bucket->chassis);
+        hmap_insert(&index->buckets, &bucket->hmap_node, hash_uint64(nb_cfg));
+        /* Both heaps are max-heaps. */
+        heap_insert(&index->min_heap, &bucket->min_node,
+                    ~hv_cfg_priority(nb_cfg));
+        heap_insert(&index->max_heap, &bucket->max_node,
+                    hv_cfg_priority(nb_cfg));
+    }
+    return bucket;
+}
+
+static void
+hv_cfg_chassis_unlink(struct hv_cfg_index *index,
+                      struct hv_cfg_chassis *chassis)
+{
+    struct hv_cfg_bucket *bucket = chassis->bucket;
+
+    ovs_list_remove(&chassis->list_node);
+    if (ovs_list_is_empty(&bucket->chassis)) {
+        hmap_remove(&index->buckets, &bucket->hmap_node);
+        heap_remove(&index->min_heap, &bucket->min_node);
+        heap_remove(&index->max_heap, &bucket->max_node);
+        free(bucket);
+    }
+    chassis->bucket = NULL;
+}
+
+static struct hv_cfg_chassis *
+hv_cfg_chassis_find(const struct hv_cfg_index *index, const struct uuid *uuid)
+{
+    struct hv_cfg_chassis *chassis;
+    HMAP_FOR_EACH_WITH_HASH (chassis, hmap_node, uuid_hash(uuid),
+                             &index->chassis) {
+        if (uuid_equals(&chassis->uuid, uuid)) {
+            return chassis;
+        }
+    }
+    return NULL;
+}
+
+static void
+hv_cfg_index_remove(struct hv_cfg_index *index, const struct uuid *uuid)
+{
+    struct hv_cfg_chassis *chassis = hv_cfg_chassis_find(index, uuid);
+    if (chassis) {
+        hv_cfg_chassis_unlink(index, chassis);
+        hmap_remove(&index->chassis, &chassis->hmap_node);
+        free(chassis);
+    }
+}
+
+/* Adds or updates 'priv' in 'index', or removes it if it belongs to a remote
+ * chassis, which don't report their nb_cfg.  If 'measure' is true and the
+ * chassis reports the last nb_cfg committed to the SB, its latency is
+ * recorded. */
+static void
+hv_cfg_index_update(struct hv_cfg_index *index,
+                    const struct sbrec_chassis_private *priv, bool measure)
+{
+    const struct sbrec_chassis *sb_chassis = priv->chassis;
+    if (sb_chassis) {
+        if (smap_get_bool(&sb_chassis->other_config, "is-remote", false)) {
+            hv_cfg_index_remove(index, &priv->header_.uuid);
+            return;
+        }
+    } else {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+        VLOG_WARN_RL(&rl, "Chassis does not exist for "
+                     "Chassis_Private record, name: %s", priv->name);
+    }
+
+    struct hv_cfg_chassis *chassis =
+        hv_cfg_chassis_find(index, &priv->header_.uuid);
+    if (!chassis) {
+        chassis = xzalloc(sizeof *chassis);
+        chassis->uuid = priv->header_.uuid;
+        hmap_insert(&index->chassis, &chassis->hmap_node,
+                    uuid_hash(&chassis->uuid));
+    } else if (chassis->bucket->nb_cfg != priv->nb_cfg) {
+        hv_cfg_chassis_unlink(index, chassis);
+    }
+
+    chassis->nb_cfg_timestamp = priv->nb_cfg_timestamp;
+    if (!chassis->bucket) {
+        chassis->bucket = hv_cfg_bucket_get(index, priv->nb_cfg);
+        ovs_list_push_back(&chassis->bucket->chassis, &chassis->list_node);
+
+        if (measure && index->sb_cfg && priv->nb_cfg == index->sb_cfg) {
+            ovn_latency_record(&index->latency[HV_CFG_STAGE_CHASSIS],
+                               priv->nb_cfg_timestamp - index->sb_cfg_ts);
+        }
+    }
+}
+
+static void
+hv_cfg_index_rebuild(struct hv_cfg_index *index, struct ovsdb_idl *ovnsb_idl)
+{
+    COVERAGE_INC(hv_cfg_index_rebuild);
+    hv_cfg_index_clear(index);
+
+    const struct sbrec_chassis_private *priv;
+    SBREC_CHASSIS_PRIVATE_FOR_EACH (priv, ovnsb_idl) {
+        hv_cfg_index_update(index, priv, false);
+    }
+    index->valid = true;
+}
+
+/* Returns the lowest nb_cfg of the chassis in 'index', starting from
+ * 'nb_cfg', by walking all of them.  A chassis whose nb_cfg is higher than
+ * 'nb_cfg' by more than INT32_MAX is considered to be behind, i.e. 'nb_cfg'
+ * overflowed since it reported it. */
+static int64_t
+hv_cfg_index_walk(const struct hv_cfg_index *index, int64_t nb_cfg)
+{
+    int64_t hv_cfg = nb_cfg;
+
+    const struct hv_cfg_bucket *bucket;
+    HMAP_FOR_EACH (bucket, hmap_node, &index->buckets) {
+        /* Detect if overflows happened within the cfg update. */
+        int64_t delta = bucket->nb_cfg - hv_cfg;
+        if (bucket->nb_cfg < hv_cfg || delta > INT32_MAX) {
+            hv_cfg = bucket->nb_cfg;
+        }
+    }
+    return hv_cfg;
+}
+
+/* Updates 'index' and returns the hv_cfg for NB_Global's 'nb_cfg', i.e. the
+ * lowest nb_cfg reported by the local chassis, or 'nb_cfg' if there are
+ * none. */
+int64_t
+hv_cfg_index_run(struct hv_cfg_index *index, struct ovsdb_idl *ovnsb_idl,
+                 int64_t nb_cfg)
+{
+    /* Chassis may have become remote or local, or have been deleted along
+     * with their Chassis_Private. */
+    if (sbrec_chassis_track_get_first(ovnsb_idl)) {
+        index->valid = false;
+    }
+
+    if (!index->valid) {
+        hv_cfg_index_rebuild(index, ovnsb_idl);
+    } else {
+        const struct sbrec_chassis_private *priv;
+        SBREC_CHASSIS_PRIVATE_FOR_EACH_TRACKED (priv, ovnsb_idl) {
+            if (sbrec_chassis_private_is_deleted(priv)) {
+                hv_cfg_index_remove(index, &priv->header_.uuid);
+            } else {
+                hv_cfg_index_update(index, priv, true);
+            }
+        }
+    }
+
+    if (heap_is_empty(&index->min_heap)) {
+        return nb_cfg;
+    }
+
+    const struct hv_cfg_bucket *max =
+        CONTAINER_OF(heap_max(&index->max_heap), struct hv_cfg_bucket,
+                     max_node);
+    if (max->nb_cfg > nb_cfg) {
+        /* Some chassis are ahead of NB_Global's nb_cfg, which only happens
+         * transiently or if it overflowed. */
+        return hv_cfg_index_walk(index, nb_cfg);
+    }
+
+    const struct hv_cfg_bucket *min =
+        CONTAINER_OF(heap_max(&index->min_heap), struct hv_cfg_bucket,
+                     min_node);
+    return min->nb_cfg;
+}
+
+/* Returns the latest time at which a chassis in 'index' reported 'hv_cfg',
+ * or 0 if none did. */
+int64_t
+hv_cfg_index_get_timestamp(const struct hv_cfg_index *index, int64_t hv_cfg)
+{
+    const struct hv_cfg_bucket *bucket = hv_cfg_bucket_find(index, hv_cfg);
+    int64_t hv_cfg_ts = 0;
+
+    if (bucket) {
+        const struct hv_cfg_chassis *chassis;
+        LIST_FOR_EACH (chassis, list_node, &bucket->chassis) {
+            hv_cfg_ts = MAX(hv_cfg_ts, chassis->nb_cfg_timestamp);
+        }
+    }
+    return hv_cfg_ts;
+}
+
+/* Records that NB_Global's nb_cfg was 'nb_cfg' at 'timestamp'. */
+void
+hv_cfg_index_nb_cfg_seen(struct hv_cfg_index *index, int64_t nb_cfg,
+                         int64_t timestamp)
+{
+    if (nb_cfg != index->nb_cfg) {
+        index->nb_cfg = nb_cfg;
+        index->nb_cfg_ts = timestamp;
+    }
+}
+
+/* Records that the SB transaction for 'sb_cfg' committed at 'timestamp'. */
+void
+hv_cfg_index_sb_cfg_committed(struct hv_cfg_index *index, int64_t sb_cfg,
+                              int64_t timestamp)
+{
+    if (sb_cfg != index->nb_cfg || !index->nb_cfg_ts) {
+        /* Not seen by this instance of ovn-northd, e.g. committed by a
+         * previous active one. */
+        index->sb_cfg = 0;
+        return;
+    }
+
+    index->sb_cfg = sb_cfg;
+    index->sb_cfg_nb_ts = index->nb_cfg_ts;
+    index->sb_cfg_ts = timestamp;
+    index->hv_cfg_reached = false;
+    ovn_latency_record(&index->latency[HV_CFG_STAGE_NORTHD],
+                       timestamp - index->nb_cfg_ts);
+}
+
+/* Records that all the chassis reported 'hv_cfg', the last of them at
+ * 'timestamp', if any. */
+void
+hv_cfg_index_hv_cfg_reached(struct hv_cfg_index *index, int64_t hv_cfg,
+                            int64_t timestamp)
+{
+    if (!index->sb_cfg || hv_cfg != index->sb_cfg || !timestamp
+        || index->hv_cfg_reached) {
+        return;
+    }
+
+    index->hv_cfg_reached = true;
+    ovn_latency_record(&index->latency[HV_CFG_STAGE_HV],
+                       timestamp - index->sb_cfg_ts);
+    ovn_latency_record(&index->latency[HV_CFG_STAGE_TOTAL],
+                       timestamp - index->sb_cfg_nb_ts);
+}
+
+static const char *hv_cfg_stage_names[HV_CFG_N_STAGES] = {
+    [HV_CFG_STAGE_NORTHD] = "northd",
+    [HV_CFG_STAGE_CHASSIS] = "chassis",
+    [HV_CFG_STAGE_HV] = "hv",
+    [HV_CFG_STAGE_TOTAL] = "total",
+};
+
+/* Formats into 'ds' the latency histograms of the stages of the propagation
+ * of nb_cfg. */
+void
+hv_cfg_index_format_latency(const struct hv_cfg_index *index, struct ds *ds)
+{
+    ds_put_cstr(ds, "nb_cfg latency:\n");
+    for (size_t i = 0; i < HV_CFG_N_STAGES; i++) {
+        ovn_latency_format(&index->latency[i], hv_cfg_stage_names[i], ds);
+    }
+}
+
+void
+hv_cfg_index_clear_latency(struct hv_cfg_index *index)
+{
+    memset(index->latency, 0, sizeof index->latency);
+}
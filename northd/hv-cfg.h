@@ -0,0 +1,98 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NORTHD_HV_CFG_H
+#define NORTHD_HV_CFG_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "heap.h"
+#include "lib/ovn-util.h"
+#include "openvswitch/hmap.h"
+
+struct ds;
+struct ovsdb_idl;
+
+/* Stages of the propagation of an nb_cfg, whose latency is measured by
+ * hv_cfg_index:
+ *
+ *   - HV_CFG_STAGE_NORTHD: from ovn-northd seeing it in NB_Global to the
+ *     commit of the matching SB transaction.
+ *
+ *   - HV_CFG_STAGE_CHASSIS: from the SB commit to each chassis installing
+ *     its flows, as reported in Chassis_Private's nb_cfg_timestamp.
+ *
+ *   - HV_CFG_STAGE_HV: from the SB commit to the last chassis installing
+ *     its flows, i.e. to NB_Global's hv_cfg_timestamp.
+ *
+ *   - HV_CFG_STAGE_TOTAL: from ovn-northd seeing it to the last chassis
+ *     installing its flows.
+ *
+ * Only the nb_cfg values that ovn-northd commits to the SB are measured:
+ * the ones that are superseded before, e.g. because several clients bumped
+ * nb_cfg meanwhile, are skipped.  The chassis stages rely on the clocks of
+ * the chassis being in sync with ovn-northd's. */
+enum hv_cfg_stage {
+    HV_CFG_STAGE_NORTHD,
+    HV_CFG_STAGE_CHASSIS,
+    HV_CFG_STAGE_HV,
+    HV_CFG_STAGE_TOTAL,
+    HV_CFG_N_STAGES
+};
+
+/* Aggregation of the nb_cfg reported by the chassis in Chassis_Private, to
+ * compute NB_Global's hv_cfg without walking all the chassis on each run.
+ *
+ * The local chassis are grouped in buckets by nb_cfg, and the buckets are
+ * kept in a min-heap and a max-heap.  hv_cfg_index_run() updates them from
+ * the changes tracked by the SB IDL, so it must be called each time before
+ * they are cleared, or else hv_cfg_index_invalidate() must be called and the
+ * index is rebuilt from all the Chassis_Private records on the next run. */
+struct hv_cfg_index {
+    struct hmap chassis;    /* Contains "struct hv_cfg_chassis". */
+    struct hmap buckets;    /* Contains "struct hv_cfg_bucket". */
+    struct heap min_heap;   /* Buckets, the lowest nb_cfg first. */
+    struct heap max_heap;   /* Buckets, the highest nb_cfg first. */
+    bool valid;
+
+    /* Latency of the propagation of nb_cfg, see enum hv_cfg_stage.  The
+     * timestamps are wall clock times in milliseconds. */
+    int64_t nb_cfg;         /* Last nb_cfg seen in NB_Global. */
+    int64_t nb_cfg_ts;      /* When it was seen. */
+    int64_t sb_cfg;         /* Last of them committed to the SB, or 0. */
+    int64_t sb_cfg_nb_ts;   /* When 'sb_cfg' was seen in NB_Global. */
+    int64_t sb_cfg_ts;      /* When 'sb_cfg' was committed. */
+    bool hv_cfg_reached;    /* True once all chassis installed 'sb_cfg'. */
+    struct ovn_latency latency[HV_CFG_N_STAGES];
+};
+
+void hv_cfg_index_init(struct hv_cfg_index *);
+void hv_cfg_index_destroy(struct hv_cfg_index *);
+void hv_cfg_index_invalidate(struct hv_cfg_index *);
+int64_t hv_cfg_index_run(struct hv_cfg_index *, struct ovsdb_idl *ovnsb_idl,
+                         int64_t nb_cfg);
+int64_t hv_cfg_index_get_timestamp(const struct hv_cfg_index *,
+                                   int64_t hv_cfg);
+
+void hv_cfg_index_nb_cfg_seen(struct hv_cfg_index *, int64_t nb_cfg,
+                              int64_t timestamp);
+void hv_cfg_index_sb_cfg_committed(struct hv_cfg_index *, int64_t sb_cfg,
+                                   int64_t timestamp);
+void hv_cfg_index_hv_cfg_reached(struct hv_cfg_index *, int64_t hv_cfg,
+                                 int64_t timestamp);
+void hv_cfg_index_format_latency(const struct hv_cfg_index *, struct ds *);
+void hv_cfg_index_clear_latency(struct hv_cfg_index *);
+
+#endif /* NORTHD_HV_CFG_H */
@@ -30,6 +30,8 @@
 #include "openvswitch/poll-loop.h"
 #include "openvswitch/vlog.h"
 #include "inc-proc-northd.h"
+#include "lib/stopwatch-names.h"
+#include "stopwatch.h"
 #include "en-global-config.h"
 #include "en-lb-data.h"
 #include "en-lr-stateful.h"
@@ -41,12 +43,14 @@
 #include "en-meters.h"
 #include "en-sync-sb.h"
 #include "en-sync-from-sb.h"
+#include "lflow-mgr.h"
 #include "unixctl.h"
 #include "util.h"
 
 VLOG_DEFINE_THIS_MODULE(inc_proc_northd);
 
 static unixctl_cb_func chassis_features_list;
+static unixctl_cb_func lflow_stage_stats_list;
 
 #define NB_NODES \
     NB_NODE(nb_global, "nb_global") \
@@ -138,7 +142,9 @@ enum sb_engine_node {
  * avoid sparse errors. */
 static ENGINE_NODE_WITH_CLEAR_TRACK_DATA(northd, "northd");
 static ENGINE_NODE(sync_from_sb, "sync_from_sb");
+static ENGINE_NODE(sync_from_sb_waker, "sync_from_sb_waker");
 static ENGINE_NODE(lflow, "lflow");
+static ENGINE_NODE(lflow_sync_waker, "lflow_sync_waker");
 static ENGINE_NODE(mac_binding_aging, "mac_binding_aging");
 static ENGINE_NODE(mac_binding_aging_waker, "mac_binding_aging_waker");
 static ENGINE_NODE(northd_output, "northd_output");
@@ -179,29 +185,50 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
 
     engine_add_input(&en_northd, &en_nb_mirror, NULL);
     engine_add_input(&en_northd, &en_nb_static_mac_binding, NULL);
-    engine_add_input(&en_northd, &en_nb_chassis_template_var, NULL);
+    engine_add_input(&en_northd, &en_nb_chassis_template_var,
+                     northd_nb_chassis_template_var_handler);
 
     engine_add_input(&en_northd, &en_sb_chassis, NULL);
+    engine_add_input(&en_northd, &en_sb_chassis_template_var,
+                     northd_sb_chassis_template_var_handler);
     engine_add_input(&en_northd, &en_sb_mirror, NULL);
-    engine_add_input(&en_northd, &en_sb_meter, NULL);
     engine_add_input(&en_northd, &en_sb_datapath_binding, NULL);
-    engine_add_input(&en_northd, &en_sb_dns, NULL);
-    engine_add_input(&en_northd, &en_sb_ha_chassis_group, NULL);
-    engine_add_input(&en_northd, &en_sb_ip_multicast, NULL);
-    engine_add_input(&en_northd, &en_sb_service_monitor, NULL);
+    engine_add_input(&en_northd, &en_sb_ha_chassis_group,
+                     northd_sb_ha_chassis_group_handler);
+    engine_add_input(&en_northd, &en_sb_service_monitor,
+                     northd_sb_service_monitor_handler);
     engine_add_input(&en_northd, &en_sb_fdb, NULL);
-    engine_add_input(&en_northd, &en_sb_static_mac_binding, NULL);
-    engine_add_input(&en_northd, &en_sb_chassis_template_var, NULL);
     engine_add_input(&en_northd, &en_global_config,
                      northd_global_config_handler);
 
+    /* The SB Meter table isn't used by the northd engine node (meters are
+     * synced by en_sync_meters) and the SB DNS table is only written by it,
+     * from the NB DNS records.  Hence it is ok to add noop handlers here. */
+    engine_add_input(&en_northd, &en_sb_meter, engine_noop_handler);
+    engine_add_input(&en_northd, &en_sb_dns, engine_noop_handler);
+
+    /* The SB Static_MAC_Binding table is only written by northd, from the
+     * NB Static_MAC_Binding table and from the addresses of the switch
+     * ports for routers with static neighbor bindings, which the northd
+     * engine node updates incrementally.  Hence it is ok to add a noop
+     * handler here, so that northd's own updates don't trigger a
+     * recompute. */
+    engine_add_input(&en_northd, &en_sb_static_mac_binding,
+                     engine_noop_handler);
+
+    /* The SB IP_Multicast table is only written by northd, from the
+     * multicast configuration of the logical switches, which the northd
+     * engine node updates incrementally.  Hence it is ok to add a noop
+     * handler here too. */
+    engine_add_input(&en_northd, &en_sb_ip_multicast, engine_noop_handler);
+
     /* northd engine node uses the sb mac binding table to
      * cleanup mac binding entries for deleted logical ports
      * and datapaths. Any update to SB mac binding doesn't
      * change the northd engine node state or data.  Hence
      * it is ok to add a noop_handler here.
      * Note: mac_binding_aging engine node depends on SB mac binding
-     * and it results in full recompute for any changes to it.
+     * and handles the changes to it incrementally.
      * */
     engine_add_input(&en_northd, &en_sb_mac_binding,
                      engine_noop_handler);
@@ -224,30 +251,41 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_add_input(&en_ls_stateful, &en_northd, ls_stateful_northd_handler);
     engine_add_input(&en_ls_stateful, &en_port_group,
                      ls_stateful_port_group_handler);
-
-    engine_add_input(&en_mac_binding_aging, &en_sb_mac_binding, NULL);
-    engine_add_input(&en_mac_binding_aging, &en_northd, NULL);
-    engine_add_input(&en_mac_binding_aging, &en_mac_binding_aging_waker, NULL);
+    engine_add_input(&en_ls_stateful, &en_nb_acl,
+                     ls_stateful_nb_acl_handler);
+
+    engine_add_input(&en_mac_binding_aging, &en_sb_mac_binding,
+                     mac_binding_aging_sb_mac_binding_handler);
+    engine_add_input(&en_mac_binding_aging, &en_northd,
+                     mac_binding_aging_northd_handler);
+    engine_add_input(&en_mac_binding_aging, &en_mac_binding_aging_waker,
+                     mac_binding_aging_waker_handler);
     engine_add_input(&en_mac_binding_aging, &en_global_config,
-                     node_global_config_handler);
+                     mac_binding_aging_global_config_handler);
 
-    engine_add_input(&en_fdb_aging, &en_sb_fdb, NULL);
-    engine_add_input(&en_fdb_aging, &en_northd, NULL);
-    engine_add_input(&en_fdb_aging, &en_fdb_aging_waker, NULL);
+    engine_add_input(&en_fdb_aging, &en_sb_fdb, fdb_aging_sb_fdb_handler);
+    engine_add_input(&en_fdb_aging, &en_northd, fdb_aging_northd_handler);
+    engine_add_input(&en_fdb_aging, &en_fdb_aging_waker,
+                     fdb_aging_waker_handler);
     engine_add_input(&en_fdb_aging, &en_global_config,
-                     node_global_config_handler);
+                     fdb_aging_global_config_handler);
 
-    engine_add_input(&en_sync_meters, &en_nb_acl, NULL);
-    engine_add_input(&en_sync_meters, &en_nb_meter, NULL);
+    engine_add_input(&en_sync_meters, &en_nb_acl,
+                     sync_meters_nb_acl_handler);
+    engine_add_input(&en_sync_meters, &en_nb_meter,
+                     sync_meters_nb_meter_handler);
     engine_add_input(&en_sync_meters, &en_sb_meter, NULL);
 
-    engine_add_input(&en_lflow, &en_nb_bfd, NULL);
-    engine_add_input(&en_lflow, &en_nb_acl, NULL);
-    engine_add_input(&en_lflow, &en_sync_meters, NULL);
-    engine_add_input(&en_lflow, &en_sb_bfd, NULL);
+    engine_add_input(&en_lflow, &en_nb_bfd, lflow_nb_bfd_handler);
+    /* ACL changes are handled through the en_ls_stateful node, which tracks
+     * the logical switches whose ACL flows need to be regenerated. */
+    engine_add_input(&en_lflow, &en_nb_acl, engine_noop_handler);
+    engine_add_input(&en_lflow, &en_sync_meters, lflow_sync_meters_handler);
+    engine_add_input(&en_lflow, &en_sb_bfd, lflow_sb_bfd_handler);
     engine_add_input(&en_lflow, &en_sb_logical_flow, NULL);
     engine_add_input(&en_lflow, &en_sb_multicast_group, NULL);
-    engine_add_input(&en_lflow, &en_sb_igmp_group, NULL);
+    engine_add_input(&en_lflow, &en_sb_igmp_group,
+                     lflow_sb_igmp_group_handler);
     engine_add_input(&en_lflow, &en_sb_logical_dp_group, NULL);
     engine_add_input(&en_lflow, &en_global_config,
                      node_global_config_handler);
@@ -255,16 +293,20 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_add_input(&en_lflow, &en_port_group, lflow_port_group_handler);
     engine_add_input(&en_lflow, &en_lr_stateful, lflow_lr_stateful_handler);
     engine_add_input(&en_lflow, &en_ls_stateful, lflow_ls_stateful_handler);
+    engine_add_input(&en_lflow, &en_lflow_sync_waker,
+                     lflow_sync_waker_handler);
 
-    engine_add_input(&en_sync_to_sb_addr_set, &en_northd, NULL);
-    engine_add_input(&en_sync_to_sb_addr_set, &en_lr_stateful, NULL);
+    engine_add_input(&en_sync_to_sb_addr_set, &en_northd,
+                     sync_to_sb_addr_set_northd_handler);
+    engine_add_input(&en_sync_to_sb_addr_set, &en_lr_stateful,
+                     sync_to_sb_addr_set_lr_stateful_handler);
     engine_add_input(&en_sync_to_sb_addr_set, &en_sb_address_set, NULL);
     engine_add_input(&en_sync_to_sb_addr_set, &en_nb_address_set,
                      sync_to_sb_addr_set_nb_address_set_handler);
     engine_add_input(&en_sync_to_sb_addr_set, &en_nb_port_group,
                      sync_to_sb_addr_set_nb_port_group_handler);
     engine_add_input(&en_sync_to_sb_addr_set, &en_global_config,
-                     node_global_config_handler);
+                     sync_to_sb_addr_set_global_config_handler);
 
     engine_add_input(&en_port_group, &en_nb_port_group,
                      port_group_nb_port_group_handler);
@@ -300,8 +342,14 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
 
     engine_add_input(&en_sync_from_sb, &en_northd,
                      sync_from_sb_northd_handler);
-    engine_add_input(&en_sync_from_sb, &en_sb_port_binding, NULL);
-    engine_add_input(&en_sync_from_sb, &en_sb_ha_chassis_group, NULL);
+    engine_add_input(&en_sync_from_sb, &en_sb_port_binding,
+                     sync_from_sb_sb_port_binding_handler);
+    engine_add_input(&en_sync_from_sb, &en_sb_ha_chassis_group,
+                     sync_from_sb_sb_ha_chassis_group_handler);
+    engine_add_input(&en_sync_from_sb, &en_global_config,
+                     sync_from_sb_global_config_handler);
+    engine_add_input(&en_sync_from_sb, &en_sync_from_sb_waker,
+                     sync_from_sb_waker_handler);
 
     engine_add_input(&en_northd_output, &en_sync_from_sb, NULL);
     engine_add_input(&en_northd_output, &en_sync_to_sb,
@@ -313,6 +361,20 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_add_input(&en_northd_output, &en_fdb_aging,
                      northd_output_fdb_aging_handler);
 
+    /* These nodes only build their own data out of their inputs, so they can
+     * be run in parallel with each other when northd uses multiple threads.
+     */
+    engine_set_node_thread_safe(&en_lr_nat);
+    engine_set_node_thread_safe(&en_lr_stateful);
+    engine_set_node_thread_safe(&en_ls_stateful);
+
+    /* Nodes whose data is accounted in memory/show. */
+    engine_set_node_memory_usage(&en_northd, en_northd_get_memory_usage);
+    engine_set_node_memory_usage(&en_lflow, en_lflow_get_memory_usage);
+    engine_set_node_memory_usage(&en_port_group,
+                                 en_port_group_get_memory_usage);
+    engine_set_node_memory_usage(&en_lb_data, en_lb_data_get_memory_usage);
+
     struct engine_arg engine_arg = {
         .nb_idl = nb->idl,
         .sb_idl = sb->idl,
@@ -334,6 +396,14 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
         = mac_binding_by_datapath_index_create(sb->idl);
     struct ovsdb_idl_index *fdb_by_dp_key =
         ovsdb_idl_index_create1(sb->idl, &sbrec_fdb_col_dp_key);
+    struct ovsdb_idl_index *sbrec_meter_by_name =
+        ovsdb_idl_index_create1(sb->idl, &sbrec_meter_col_name);
+    struct ovsdb_idl_index *sbrec_template_var_by_chassis =
+        ovsdb_idl_index_create1(sb->idl,
+                                &sbrec_chassis_template_var_col_chassis);
+    struct ovsdb_idl_index *nbrec_template_var_by_chassis =
+        ovsdb_idl_index_create1(nb->idl,
+                                &nbrec_chassis_template_var_col_chassis);
 
     engine_init(&en_northd_output, &engine_arg);
 
@@ -361,6 +431,15 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     engine_ovsdb_node_add_index(&en_sb_fdb,
                                 "fdb_by_dp_key",
                                 fdb_by_dp_key);
+    engine_ovsdb_node_add_index(&en_sb_meter,
+                                "sbrec_meter_by_name",
+                                sbrec_meter_by_name);
+    engine_ovsdb_node_add_index(&en_sb_chassis_template_var,
+                                "sbrec_template_var_by_chassis",
+                                sbrec_template_var_by_chassis);
+    engine_ovsdb_node_add_index(&en_nb_chassis_template_var,
+                                "nbrec_template_var_by_chassis",
+                                nbrec_template_var_by_chassis);
 
     struct ovsdb_idl_index *sbrec_address_set_by_name
         = ovsdb_idl_index_create1(sb->idl, &sbrec_address_set_col_name);
@@ -386,6 +465,8 @@ void inc_proc_northd_init(struct ovsdb_idl_loop *nb,
     unixctl_command_register("debug/chassis-features-list", "", 0, 0,
                              chassis_features_list,
                              &global_config->features);
+    unixctl_command_register("debug/lflow-stage-stats", "", 0, 0,
+                             lflow_stage_stats_list, NULL);
 }
 
 /* Returns true if the incremental processing ended up updating nodes. */
@@ -437,6 +518,36 @@ bool inc_proc_northd_run(struct ovsdb_idl_txn *ovnnb_txn,
     return engine_has_updated();
 }
 
+const char *const inc_proc_northd_stopwatches[] = {
+    BUILD_LFLOWS_CTX_STOPWATCH_NAME,
+    CLEAR_LFLOWS_CTX_STOPWATCH_NAME,
+    BUILD_LFLOWS_STOPWATCH_NAME,
+    LFLOWS_DATAPATHS_STOPWATCH_NAME,
+    LFLOWS_PORTS_STOPWATCH_NAME,
+    LFLOWS_LBS_STOPWATCH_NAME,
+    LFLOWS_LR_STATEFUL_STOPWATCH_NAME,
+    LFLOWS_LS_STATEFUL_STOPWATCH_NAME,
+    LFLOWS_IGMP_STOPWATCH_NAME,
+    LFLOWS_DP_GROUPS_STOPWATCH_NAME,
+    LFLOWS_TO_SB_STOPWATCH_NAME,
+    PORT_GROUP_RUN_STOPWATCH_NAME,
+    SYNC_METERS_RUN_STOPWATCH_NAME,
+    LR_NAT_RUN_STOPWATCH_NAME,
+    LR_STATEFUL_RUN_STOPWATCH_NAME,
+    LS_STATEFUL_RUN_STOPWATCH_NAME,
+    BUILD_IPAM_STOPWATCH_NAME,
+};
+const size_t inc_proc_northd_n_stopwatches =
+    ARRAY_SIZE(inc_proc_northd_stopwatches);
+
+void
+inc_proc_northd_create_stopwatches(void)
+{
+    for (size_t i = 0; i < inc_proc_northd_n_stopwatches; i++) {
+        stopwatch_create(inc_proc_northd_stopwatches[i], SW_MS);
+    }
+}
+
 void inc_proc_northd_cleanup(void)
 {
     engine_cleanup();
@@ -472,3 +583,19 @@ chassis_features_list(struct unixctl_conn *conn, int argc OVS_UNUSED,
     unixctl_command_reply(conn, ds_cstr(&ds));
     ds_destroy(&ds);
 }
+
+static void
+lflow_stage_stats_list(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                       const char *argv[] OVS_UNUSED, void *arg OVS_UNUSED)
+{
+    const struct lflow_data *lflow_data = engine_get_data(&en_lflow);
+    if (!lflow_data) {
+        unixctl_command_reply_error(conn, "lflow data is not available");
+        return;
+    }
+
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    lflow_table_format_stage_stats(lflow_data->lflow_table, &ds);
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
@@ -24,4 +24,9 @@ bool inc_proc_northd_run(struct ovsdb_idl_txn *ovnnb_txn,
 void inc_proc_northd_cleanup(void);
 bool inc_proc_northd_can_run(struct northd_engine_context *ctx);
 
+/* Stopwatches measuring the processing done by the northd engine nodes. */
+extern const char *const inc_proc_northd_stopwatches[];
+extern const size_t inc_proc_northd_n_stopwatches;
+void inc_proc_northd_create_stopwatches(void);
+
 #endif /* INC_PROC_NORTHD */
@@ -6,11 +6,11 @@
 #include <netinet/in.h>
 
 #include "ipam.h"
+#include "lib/hbitmap.h"
 #include "ovn/lex.h"
 
 #include "smap.h"
 #include "packets.h"
-#include "bitmap.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(ipam)
@@ -20,7 +20,7 @@ static void init_ipam_ipv6_prefix(const char *ipv6_prefix,
 static void init_ipam_ipv4(const char *subnet_str,
                            const char *exclude_ip_list,
                            struct ipam_info *info);
-static bool ipam_is_duplicate_mac(struct eth_addr *ea, uint64_t mac64,
+static bool ipam_is_duplicate_mac(struct eth_addr *ea, uint32_t suffix,
                                   bool warn);
 
 void
@@ -43,7 +43,10 @@ init_ipam_info(struct ipam_info *info, const struct smap *config, const char *id
 void
 destroy_ipam_info(struct ipam_info *info)
 {
-    bitmap_free(info->allocated_ipv4s);
+    if (info->allocated_ipv4s) {
+        hbitmap_destroy(info->allocated_ipv4s);
+        free(info->allocated_ipv4s);
+    }
     free(CONST_CAST(char *, info->id));
 }
 
@@ -56,15 +59,15 @@ ipam_insert_ip(struct ipam_info *info, uint32_t ip)
 
     if (ip >= info->start_ipv4 &&
         ip < (info->start_ipv4 + info->total_ipv4s)) {
-        if (bitmap_is_set(info->allocated_ipv4s,
-                          ip - info->start_ipv4)) {
+        if (hbitmap_is_set(info->allocated_ipv4s,
+                           ip - info->start_ipv4)) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
             VLOG_WARN_RL(&rl, "%s: Duplicate IP set: " IP_FMT,
                          info->id, IP_ARGS(htonl(ip)));
             return false;
         }
-        bitmap_set1(info->allocated_ipv4s,
-                    ip - info->start_ipv4);
+        hbitmap_set1(info->allocated_ipv4s,
+                     ip - info->start_ipv4);
     }
     return true;
 }
@@ -76,8 +79,8 @@ ipam_get_unused_ip(struct ipam_info *info)
         return 0;
     }
 
-    size_t new_ip_index = bitmap_scan(info->allocated_ipv4s, 0, 0,
-                                      info->total_ipv4s - 1);
+    size_t new_ip_index = hbitmap_scan0(info->allocated_ipv4s, 0,
+                                        info->total_ipv4s - 1);
     if (new_ip_index == info->total_ipv4s - 1) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
         VLOG_WARN_RL(&rl, "%s: Subnet address space has been exhausted.",
@@ -88,19 +91,26 @@ ipam_get_unused_ip(struct ipam_info *info)
     return info->start_ipv4 + new_ip_index;
 }
 
-/* MAC address management (macam) table of "struct eth_addr"s, that holds the
- * MAC addresses allocated by the OVN ipam module. */
-static struct hmap macam = HMAP_INITIALIZER(&macam);
-
-struct macam_node {
-    struct hmap_node hmap_node;
-    struct eth_addr mac_addr; /* Allocated MAC address. */
-};
+/* MAC address management (macam) bitmap, indexed by the lower 24 bits of
+ * the MAC addresses allocated by the OVN ipam module.  Only MACs within
+ * 'mac_prefix' are tracked.  It is allocated on first use, as it takes 2 MB
+ * and most deployments never use dynamic MAC addresses. */
+static struct hbitmap *macam;
 
 #define MAC_ADDR_SPACE 0xffffff
 static struct eth_addr mac_prefix;
 static char mac_prefix_str[18];
 
+static struct hbitmap *
+macam_get(void)
+{
+    if (!macam) {
+        macam = xmalloc(sizeof *macam);
+        hbitmap_init(macam, MAC_ADDR_SPACE + 1);
+    }
+    return macam;
+}
+
 void
 ipam_insert_mac(struct eth_addr *ea, bool check)
 {
@@ -110,52 +120,47 @@ ipam_insert_mac(struct eth_addr *ea, bool check)
 
     uint64_t mac64 = eth_addr_to_uint64(*ea);
     uint64_t prefix = eth_addr_to_uint64(mac_prefix);
+    uint32_t suffix = mac64 & MAC_ADDR_SPACE;
 
     /* If the new MAC was not assigned by this address management system or
      * check is true and the new MAC is a duplicate, do not insert it into the
-     * macam hmap. */
+     * macam bitmap. */
     if (((mac64 ^ prefix) >> 24)
-        || (check && ipam_is_duplicate_mac(ea, mac64, true))) {
+        || (check && ipam_is_duplicate_mac(ea, suffix, true))) {
         return;
     }
 
-    struct macam_node *new_macam_node = xmalloc(sizeof *new_macam_node);
-    new_macam_node->mac_addr = *ea;
-    hmap_insert(&macam, &new_macam_node->hmap_node, hash_uint64(mac64));
+    hbitmap_set1(macam_get(), suffix);
 }
 
 uint64_t
 ipam_get_unused_mac(ovs_be32 ip)
 {
-    uint32_t mac_addr_suffix, i, base_addr = ntohl(ip) & MAC_ADDR_SPACE;
-    struct eth_addr mac;
-    uint64_t mac64;
-
-    for (i = 0; i < MAC_ADDR_SPACE - 1; i++) {
-        /* The tentative MAC's suffix will be in the interval (1, 0xfffffe). */
-        mac_addr_suffix = ((base_addr + i) % (MAC_ADDR_SPACE - 1)) + 1;
-        mac64 =  eth_addr_to_uint64(mac_prefix) | mac_addr_suffix;
-        eth_addr_from_uint64(mac64, &mac);
-        if (!ipam_is_duplicate_mac(&mac, mac64, false)) {
-            break;
+    uint32_t base_addr = ntohl(ip) & MAC_ADDR_SPACE;
+    struct hbitmap *hb = macam_get();
+
+    /* The tentative MAC's suffix will be in the interval [1, 0xfffffe],
+     * starting the search from the suffix derived from 'ip' and wrapping
+     * around. */
+    size_t first = (base_addr % (MAC_ADDR_SPACE - 1)) + 1;
+    size_t suffix = hbitmap_scan0(hb, first, MAC_ADDR_SPACE);
+    if (suffix == MAC_ADDR_SPACE) {
+        suffix = hbitmap_scan0(hb, 1, first);
+        if (suffix == first) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+            VLOG_WARN_RL(&rl, "MAC address space exhausted.");
+            return 0;
         }
     }
 
-    if (i == MAC_ADDR_SPACE) {
-        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-        VLOG_WARN_RL(&rl, "MAC address space exhausted.");
-        mac64 = 0;
-    }
-
-    return mac64;
+    return eth_addr_to_uint64(mac_prefix) | suffix;
 }
 
 void
 cleanup_macam(void)
 {
-    struct macam_node *node;
-    HMAP_FOR_EACH_POP (node, hmap_node, &macam) {
-        free(node);
+    if (macam) {
+        hbitmap_clear(macam);
     }
 }
 
@@ -268,11 +273,11 @@ init_ipam_ipv4(const char *subnet_str, const char *exclude_ip_list,
 
     info->start_ipv4 = ntohl(subnet & mask) + 1;
     info->total_ipv4s = ~ntohl(mask);
-    info->allocated_ipv4s =
-        bitmap_allocate(info->total_ipv4s);
+    info->allocated_ipv4s = xmalloc(sizeof *info->allocated_ipv4s);
+    hbitmap_init(info->allocated_ipv4s, info->total_ipv4s);
 
     /* Mark first IP as taken */
-    bitmap_set1(info->allocated_ipv4s, 0);
+    hbitmap_set1(info->allocated_ipv4s, 0);
 
     if (!exclude_ip_list) {
         return;
@@ -306,9 +311,9 @@ init_ipam_ipv4(const char *subnet_str, const char *exclude_ip_list,
         start = MAX(info->start_ipv4, start);
         end = MIN(info->start_ipv4 + info->total_ipv4s, end);
         if (end > start) {
-            bitmap_set_multiple(info->allocated_ipv4s,
-                                start - info->start_ipv4,
-                                end - start, 1);
+            hbitmap_set_multiple(info->allocated_ipv4s,
+                                 start - info->start_ipv4,
+                                 end - start);
         } else {
             lexer_error(&lexer, "excluded addresses not in subnet");
         }
@@ -321,20 +326,15 @@ init_ipam_ipv4(const char *subnet_str, const char *exclude_ip_list,
 }
 
 static bool
-ipam_is_duplicate_mac(struct eth_addr *ea, uint64_t mac64, bool warn)
+ipam_is_duplicate_mac(struct eth_addr *ea, uint32_t suffix, bool warn)
 {
-    struct macam_node *macam_node;
-    HMAP_FOR_EACH_WITH_HASH (macam_node, hmap_node, hash_uint64(mac64),
-                             &macam) {
-        if (eth_addr_equals(*ea, macam_node->mac_addr)) {
-            if (warn) {
-                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-                VLOG_WARN_RL(&rl, "Duplicate MAC set: "ETH_ADDR_FMT,
-                             ETH_ADDR_ARGS(macam_node->mac_addr));
-            }
-            return true;
-        }
+    if (!macam || !hbitmap_is_set(macam, suffix)) {
+        return false;
     }
-    return false;
+    if (warn) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+        VLOG_WARN_RL(&rl, "Duplicate MAC set: "ETH_ADDR_FMT,
+                     ETH_ADDR_ARGS(*ea));
+    }
+    return true;
 }
-
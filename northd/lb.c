@@ -18,6 +18,7 @@
 
 /* OVS includes */
 #include "lib/bitmap.h"
+#include "lib/hash.h"
 #include "openvswitch/vlog.h"
 #include "socket-util.h"
 
@@ -258,7 +259,8 @@ ovn_lb_get_health_check(const struct nbrec_load_balancer *nbrec_lb,
 
 static void
 ovn_northd_lb_init(struct ovn_northd_lb *lb,
-                   const struct nbrec_load_balancer *nbrec_lb)
+                   const struct nbrec_load_balancer *nbrec_lb,
+                   struct ovn_lb_vip_cache *vip_cache)
 {
     bool template = smap_get_bool(&nbrec_lb->options, "template", false);
     bool is_udp = nullable_string_is_equal(nbrec_lb->protocol, "udp");
@@ -305,8 +307,9 @@ ovn_northd_lb_init(struct ovn_northd_lb *lb,
         struct ovn_lb_vip *lb_vip = &lb->vips[n_vips];
         struct ovn_northd_lb_vip *lb_vip_nb = &lb->vips_nb[n_vips];
 
-        char *error = ovn_lb_vip_init(lb_vip, node->key, node->value,
-                                      template, address_family);
+        char *error = ovn_lb_vip_init_cached(vip_cache, lb_vip, node->key,
+                                             node->value, template,
+                                             address_family);
         if (error) {
             static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
             VLOG_WARN_RL(&rl, "Failed to initialize LB VIP: %s", error);
@@ -367,11 +370,14 @@ ovn_northd_lb_init(struct ovn_northd_lb *lb,
     }
 }
 
+/* Creates the load balancer for 'nbrec_lb'.  Its VIPs are looked up in
+ * 'vip_cache' first, if it is nonnull. */
 struct ovn_northd_lb *
-ovn_northd_lb_create(const struct nbrec_load_balancer *nbrec_lb)
+ovn_northd_lb_create(const struct nbrec_load_balancer *nbrec_lb,
+                     struct ovn_lb_vip_cache *vip_cache)
 {
     struct ovn_northd_lb *lb = xzalloc(sizeof *lb);
-    ovn_northd_lb_init(lb, nbrec_lb);
+    ovn_northd_lb_init(lb, nbrec_lb, vip_cache);
     return lb;
 }
 
@@ -425,10 +431,11 @@ ovn_northd_lb_destroy(struct ovn_northd_lb *lb)
 
 void
 ovn_northd_lb_reinit(struct ovn_northd_lb *lb,
-                     const struct nbrec_load_balancer *nbrec_lb)
+                     const struct nbrec_load_balancer *nbrec_lb,
+                     struct ovn_lb_vip_cache *vip_cache)
 {
     ovn_northd_lb_cleanup(lb);
-    ovn_northd_lb_init(lb, nbrec_lb);
+    ovn_northd_lb_init(lb, nbrec_lb, vip_cache);
 }
 
 static void
@@ -565,6 +572,7 @@ ovn_lb_datapaths_create(const struct ovn_northd_lb *lb, size_t n_ls_datapaths,
     lb_dps->nb_ls_map = bitmap_allocate(n_ls_datapaths);
     lb_dps->nb_lr_map = bitmap_allocate(n_lr_datapaths);
     lb_dps->lflow_ref = lflow_ref_create();
+    hmap_init(&lb_dps->vip_lflow_refs);
 
     return lb_dps;
 }
@@ -575,9 +583,68 @@ ovn_lb_datapaths_destroy(struct ovn_lb_datapaths *lb_dps)
     bitmap_free(lb_dps->nb_lr_map);
     bitmap_free(lb_dps->nb_ls_map);
     lflow_ref_destroy(lb_dps->lflow_ref);
+    ovn_lb_datapaths_clear_vip_lflow_refs(lb_dps);
+    hmap_destroy(&lb_dps->vip_lflow_refs);
+    free(lb_dps->lflows_config);
     free(lb_dps);
 }
 
+/* Returns the lflow reference of the VIP 'vip_idx' of 'lb_dps', creating
+ * it if it doesn't exist yet.  The VIPs are identified by their address,
+ * port and backends, and by 'active_backends', if nonnull, the backends
+ * selected by the health check of the VIP.  So a VIP whose backends, or
+ * active backends, changed gets a new lflow reference, and the old one is
+ * left for the caller to remove. */
+struct ovn_lb_vip_lflow_ref *
+ovn_lb_datapaths_add_vip_lflow_ref(struct ovn_lb_datapaths *lb_dps,
+                                   size_t vip_idx,
+                                   const char *active_backends)
+{
+    const struct ovn_lb_vip *lb_vip = &lb_dps->lb->vips[vip_idx];
+    const struct ovn_northd_lb_vip *lb_vip_nb = &lb_dps->lb->vips_nb[vip_idx];
+    struct ovn_lb_vip_lflow_ref *vip_ref;
+
+    char *key = xasprintf("%s:%s=%s;%s", lb_vip->vip_str,
+                          lb_vip->port_str ? lb_vip->port_str : "",
+                          lb_vip_nb->backend_ips,
+                          active_backends ? active_backends : "");
+    uint32_t hash = hash_string(key, 0);
+    HMAP_FOR_EACH_WITH_HASH (vip_ref, hmap_node, hash,
+                             &lb_dps->vip_lflow_refs) {
+        if (!strcmp(vip_ref->key, key)) {
+            free(key);
+            return vip_ref;
+        }
+    }
+
+    vip_ref = xzalloc(sizeof *vip_ref);
+    vip_ref->key = key;
+    vip_ref->lflow_ref = lflow_ref_create();
+    vip_ref->rebuilt = true;
+    hmap_insert(&lb_dps->vip_lflow_refs, &vip_ref->hmap_node, hash);
+
+    return vip_ref;
+}
+
+void
+ovn_lb_datapaths_remove_vip_lflow_ref(struct ovn_lb_datapaths *lb_dps,
+                                      struct ovn_lb_vip_lflow_ref *vip_ref)
+{
+    hmap_remove(&lb_dps->vip_lflow_refs, &vip_ref->hmap_node);
+    lflow_ref_destroy(vip_ref->lflow_ref);
+    free(vip_ref->key);
+    free(vip_ref);
+}
+
+void
+ovn_lb_datapaths_clear_vip_lflow_refs(struct ovn_lb_datapaths *lb_dps)
+{
+    struct ovn_lb_vip_lflow_ref *vip_ref;
+    HMAP_FOR_EACH_SAFE (vip_ref, hmap_node, &lb_dps->vip_lflow_refs) {
+        ovn_lb_datapaths_remove_vip_lflow_ref(lb_dps, vip_ref);
+    }
+}
+
 void
 ovn_lb_datapaths_add_lr(struct ovn_lb_datapaths *lb_dps, size_t n,
                         struct ovn_datapath **ods)
@@ -602,6 +669,26 @@ ovn_lb_datapaths_add_ls(struct ovn_lb_datapaths *lb_dps, size_t n,
     }
 }
 
+/* Adds to 'lb_dps' all the datapaths to which 'lb_group_dps', one of the
+ * groups of its load balancer, is applied. */
+void
+ovn_lb_datapaths_add_lb_group(struct ovn_lb_datapaths *lb_dps,
+                              const struct ovn_lb_group_datapaths *lbg_dps)
+{
+    if (lbg_dps->n_ls) {
+        bitmap_or(lb_dps->nb_ls_map, lbg_dps->nb_ls_map,
+                  lbg_dps->n_ls_datapaths);
+        lb_dps->n_nb_ls = bitmap_count1(lb_dps->nb_ls_map,
+                                        lbg_dps->n_ls_datapaths);
+    }
+    if (lbg_dps->n_lr) {
+        bitmap_or(lb_dps->nb_lr_map, lbg_dps->nb_lr_map,
+                  lbg_dps->n_lr_datapaths);
+        lb_dps->n_nb_lr = bitmap_count1(lb_dps->nb_lr_map,
+                                        lbg_dps->n_lr_datapaths);
+    }
+}
+
 struct ovn_lb_datapaths *
 ovn_lb_datapaths_find(const struct hmap *lb_dps_map,
                       const struct uuid *lb_uuid)
@@ -626,6 +713,10 @@ ovn_lb_group_datapaths_create(const struct ovn_lb_group *lb_group,
     lb_group_dps->lb_group = lb_group;
     lb_group_dps->ls = xmalloc(max_ls_datapaths * sizeof *lb_group_dps->ls);
     lb_group_dps->lr = xmalloc(max_lr_datapaths * sizeof *lb_group_dps->lr);
+    lb_group_dps->n_ls_datapaths = max_ls_datapaths;
+    lb_group_dps->nb_ls_map = bitmap_allocate(max_ls_datapaths);
+    lb_group_dps->n_lr_datapaths = max_lr_datapaths;
+    lb_group_dps->nb_lr_map = bitmap_allocate(max_lr_datapaths);
 
     return lb_group_dps;
 }
@@ -635,9 +726,35 @@ ovn_lb_group_datapaths_destroy(struct ovn_lb_group_datapaths *lb_group_dps)
 {
     free(lb_group_dps->ls);
     free(lb_group_dps->lr);
+    bitmap_free(lb_group_dps->nb_ls_map);
+    bitmap_free(lb_group_dps->nb_lr_map);
     free(lb_group_dps);
 }
 
+/* Adds the 'n' logical switches in 'ods' to the datapaths to which
+ * 'lbg_dps''s group is applied, skipping the ones already there. */
+void
+ovn_lb_group_datapaths_add_ls(struct ovn_lb_group_datapaths *lbg_dps,
+                              size_t n, struct ovn_datapath **ods)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (!bitmap_is_set(lbg_dps->nb_ls_map, ods[i]->index)) {
+            bitmap_set1(lbg_dps->nb_ls_map, ods[i]->index);
+            lbg_dps->ls[lbg_dps->n_ls++] = ods[i];
+        }
+    }
+}
+
+void
+ovn_lb_group_datapaths_add_lr(struct ovn_lb_group_datapaths *lbg_dps,
+                              struct ovn_datapath *lr)
+{
+    if (!bitmap_is_set(lbg_dps->nb_lr_map, lr->index)) {
+        bitmap_set1(lbg_dps->nb_lr_map, lr->index);
+        lbg_dps->lr[lbg_dps->n_lr++] = lr;
+    }
+}
+
 struct ovn_lb_group_datapaths *
 ovn_lb_group_datapaths_find(const struct hmap *lb_group_dps_map,
                             const struct uuid *lb_group_uuid)
@@ -89,13 +89,15 @@ struct ovn_northd_lb_backend {
     char *svc_mon_src_ip; /* Source IP to use for monitoring. */
 };
 
-struct ovn_northd_lb *ovn_northd_lb_create(const struct nbrec_load_balancer *);
+struct ovn_northd_lb *ovn_northd_lb_create(const struct nbrec_load_balancer *,
+                                           struct ovn_lb_vip_cache *);
 struct ovn_northd_lb *ovn_northd_lb_find(const struct hmap *,
                                          const struct uuid *);
 const struct smap *ovn_northd_lb_get_vips(const struct ovn_northd_lb *);
 void ovn_northd_lb_destroy(struct ovn_northd_lb *);
 void ovn_northd_lb_reinit(struct ovn_northd_lb *,
-                          const struct nbrec_load_balancer *);
+                          const struct nbrec_load_balancer *,
+                          struct ovn_lb_vip_cache *);
 
 void build_lrouter_lb_ips(struct ovn_lb_ip_set *,
                           const struct ovn_northd_lb *);
@@ -129,6 +131,22 @@ void ovn_lb_group_reinit(
     const struct hmap *lbs);
 
 struct lflow_ref;
+
+/* Reference of the logical flows generated for one VIP of a load balancer,
+ * see 'vip_lflow_refs' in struct ovn_lb_datapaths. */
+struct ovn_lb_vip_lflow_ref {
+    struct hmap_node hmap_node;  /* In 'vip_lflow_refs', by hash of 'key'. */
+    char *key;                   /* VIP, port and backends of the VIP, and
+                                  * its active backends if it has a health
+                                  * check. */
+    struct lflow_ref *lflow_ref;
+
+    /* Used by build_lb_datapaths_flows() in northd.c. */
+    bool stale;                  /* The VIP wasn't found in the last build. */
+    bool rebuilt;                /* The lflows were rebuilt by the last
+                                  * build. */
+};
+
 struct ovn_lb_datapaths {
     struct hmap_node hmap_node;
 
@@ -165,6 +183,22 @@ struct ovn_lb_datapaths {
      * access ovn_lb_datapaths->lflow_ref at any given time.
      */
     struct lflow_ref *lflow_ref;
+
+    /* References of the lflows generated for each VIP, so that a change to a
+     * single VIP, e.g., to its backends, only rebuilds the lflows of that
+     * VIP.  It contains 'struct ovn_lb_vip_lflow_ref's, and 'lflow_ref'
+     * above only references the lflows that don't depend on a VIP.
+     *
+     * 'lflows_config', 'lflows_n_nb_ls' and 'lflows_n_nb_lr' are the
+     * configuration of the load balancer and the number of datapaths it
+     * was applied to when its lflows were last built.  If any of them
+     * changes, the lflows of all the VIPs are rebuilt.
+     *
+     * Same as 'lflow_ref', these belong to the en_lflow node. */
+    struct hmap vip_lflow_refs;
+    char *lflows_config;
+    size_t lflows_n_nb_ls;
+    size_t lflows_n_nb_lr;
 };
 
 struct ovn_lb_datapaths *ovn_lb_datapaths_create(const struct ovn_northd_lb *,
@@ -178,6 +212,15 @@ void ovn_lb_datapaths_add_lr(struct ovn_lb_datapaths *, size_t n,
                              struct ovn_datapath **);
 void ovn_lb_datapaths_add_ls(struct ovn_lb_datapaths *, size_t n,
                              struct ovn_datapath **);
+struct ovn_lb_group_datapaths;
+void ovn_lb_datapaths_add_lb_group(struct ovn_lb_datapaths *,
+                                   const struct ovn_lb_group_datapaths *);
+
+struct ovn_lb_vip_lflow_ref *ovn_lb_datapaths_add_vip_lflow_ref(
+    struct ovn_lb_datapaths *, size_t vip_idx, const char *active_backends);
+void ovn_lb_datapaths_remove_vip_lflow_ref(struct ovn_lb_datapaths *,
+                                           struct ovn_lb_vip_lflow_ref *);
+void ovn_lb_datapaths_clear_vip_lflow_refs(struct ovn_lb_datapaths *);
 
 struct ovn_lb_group_datapaths {
     struct hmap_node hmap_node;
@@ -189,6 +232,14 @@ struct ovn_lb_group_datapaths {
     struct ovn_datapath **ls;
     size_t n_lr;
     struct ovn_datapath **lr;
+
+    /* The same datapaths, indexed by 'od->index', so that they're added to
+     * the load balancers of 'lb_group' a bitmap word at a time, see
+     * ovn_lb_datapaths_add_lb_group(). */
+    size_t n_ls_datapaths;
+    unsigned long *nb_ls_map;
+    size_t n_lr_datapaths;
+    unsigned long *nb_lr_map;
 };
 
 struct ovn_lb_group_datapaths *ovn_lb_group_datapaths_create(
@@ -199,19 +250,9 @@ void ovn_lb_group_datapaths_destroy(struct ovn_lb_group_datapaths *);
 struct ovn_lb_group_datapaths *ovn_lb_group_datapaths_find(
     const struct hmap *lb_group_dps, const struct uuid *);
 
-static inline void
-ovn_lb_group_datapaths_add_ls(struct ovn_lb_group_datapaths *lbg_dps, size_t n,
-                               struct ovn_datapath **ods)
-{
-    memcpy(&lbg_dps->ls[lbg_dps->n_ls], ods, n * sizeof *ods);
-    lbg_dps->n_ls += n;
-}
-
-static inline void
-ovn_lb_group_datapaths_add_lr(struct ovn_lb_group_datapaths *lbg_dps,
-                               struct ovn_datapath *lr)
-{
-    lbg_dps->lr[lbg_dps->n_lr++] = lr;
-}
+void ovn_lb_group_datapaths_add_ls(struct ovn_lb_group_datapaths *, size_t n,
+                                   struct ovn_datapath **);
+void ovn_lb_group_datapaths_add_lr(struct ovn_lb_group_datapaths *,
+                                   struct ovn_datapath *lr);
 
 #endif /* OVN_NORTHD_LB_H */
@@ -17,31 +17,54 @@
 #include <config.h>
 
 /* OVS includes */
+#include "coverage.h"
 #include "include/openvswitch/thread.h"
 #include "lib/bitmap.h"
+#include "lib/hash.h"
+#include "lib/hmapx.h"
+#include "openvswitch/usdt-probes.h"
 #include "openvswitch/vlog.h"
 
 /* OVN includes */
 #include "debug.h"
 #include "lflow-mgr.h"
 #include "lib/ovn-parallel-hmap.h"
+#include "openvswitch/dynamic-string.h"
+#include "simap.h"
 
 VLOG_DEFINE_THIS_MODULE(lflow_mgr);
 
+COVERAGE_DEFINE(lflow_fmt_format);
+COVERAGE_DEFINE(lflow_reuse);
+
 /* Static function declarations. */
 struct ovn_lflow;
 
 static void ovn_lflow_init(struct ovn_lflow *, struct ovn_datapath *od,
                            size_t dp_bitmap_len, enum ovn_stage stage,
-                           uint16_t priority, char *match,
-                           char *actions, char *io_port,
-                           char *ctrl_meter, char *stage_hint,
-                           const char *where);
+                           uint16_t priority, const char *match,
+                           const char *actions, const char *io_port,
+                           const char *ctrl_meter, char *stage_hint,
+                           const char *where,
+                           const struct ovn_datapath *params_od);
 static struct ovn_lflow *ovn_lflow_find(const struct hmap *lflows,
                                         enum ovn_stage stage,
                                         uint16_t priority, const char *match,
                                         const char *actions,
-                                        const char *ctrl_meter, uint32_t hash);
+                                        const char *ctrl_meter,
+                                        const struct ovn_datapath *params_od,
+                                        uint32_t hash);
+static struct ovn_lflow *ovn_lflow_find_fmt(const struct hmap *lflows,
+                                            enum ovn_stage stage,
+                                            uint16_t priority,
+                                            const struct ovn_fmt *match,
+                                            const struct ovn_fmt *actions,
+                                            const char *ctrl_meter,
+                                            uint32_t hash);
+static void ovn_lflow_reuse(struct lflow_table *, struct ovn_lflow *,
+                            size_t dp_bitmap_len, const char *io_port,
+                            const struct ovsdb_idl_row *stage_hint,
+                            const char *where);
 static void ovn_lflow_destroy(struct lflow_table *lflow_table,
                               struct ovn_lflow *lflow);
 static char *ovn_lflow_hint(const struct ovsdb_idl_row *row);
@@ -52,7 +75,14 @@ static struct ovn_lflow *do_ovn_lflow_add(
     const char *actions, const char *io_port,
     const char *ctrl_meter,
     const struct ovsdb_idl_row *stage_hint,
-    const char *where);
+    const char *where, const struct ovn_datapath *params_od);
+static struct ovn_lflow *ovn_lflow_create(
+    struct lflow_table *, size_t dp_bitmap_len, uint32_t hash,
+    enum ovn_stage stage, uint16_t priority, const char *match,
+    const char *actions, const char *io_port,
+    const char *ctrl_meter,
+    const struct ovsdb_idl_row *stage_hint,
+    const char *where, const struct ovn_datapath *params_od);
 
 
 static struct ovs_mutex *lflow_hash_lock(const struct hmap *lflow_table,
@@ -62,15 +92,17 @@ static void lflow_hash_unlock(struct ovs_mutex *hash_lock);
 static struct sbrec_logical_dp_group *ovn_sb_insert_or_update_logical_dp_group(
     struct ovsdb_idl_txn *ovnsb_txn,
     struct sbrec_logical_dp_group *,
-    const unsigned long *dpg_bitmap,
+    const unsigned long *dpg_bitmap, size_t n_dps,
     const struct ovn_datapaths *);
 static struct ovn_dp_group *ovn_dp_group_find(const struct hmap *dp_groups,
                                               const unsigned long *dpg_bitmap,
                                               size_t bitmap_len,
                                               uint32_t hash);
-static void ovn_dp_group_use(struct ovn_dp_group *);
-static void ovn_dp_group_release(struct hmap *dp_groups,
-                                 struct ovn_dp_group *);
+static uint32_t ovn_dp_group_hash(const unsigned long *bitmap, size_t len,
+                                  size_t n);
+struct ovn_dp_set;
+static struct ovn_dp_group *ovn_dp_group_get_for_set(
+    const struct hmap *dp_groups, const struct ovn_dp_set *);
 static void ovn_dp_group_destroy(struct ovn_dp_group *dpg);
 static void ovn_dp_group_add_with_reference(struct ovn_lflow *,
                                             const struct ovn_datapath *od,
@@ -97,7 +129,6 @@ static bool sync_lflow_to_sb(struct ovn_lflow *,
 /* TODO:  Move the parallization logic to this module to avoid accessing
  * and modifying in both northd.c and lflow-mgr.c. */
 extern int parallelization_state;
-extern thread_local size_t thread_lflow_counter;
 
 struct dp_refcnt;
 static struct dp_refcnt *dp_refcnt_find(struct hmap *dp_refcnts_map,
@@ -105,9 +136,10 @@ static struct dp_refcnt *dp_refcnt_find(struct hmap *dp_refcnts_map,
 static void dp_refcnt_use(struct hmap *dp_refcnts_map, size_t dp_index);
 static bool dp_refcnt_release(struct hmap *dp_refcnts_map, size_t dp_index);
 static void ovn_lflow_clear_dp_refcnts_map(struct ovn_lflow *);
-static struct lflow_ref_node *lflow_ref_node_find(struct hmap *lflow_ref_nodes,
-                                                  struct ovn_lflow *lflow,
-                                                  uint32_t lflow_hash);
+struct lflow_params;
+static struct lflow_ref_node *lflow_ref_node_find(
+    struct hmap *lflow_ref_nodes, struct ovn_lflow *lflow,
+    const struct lflow_params *, uint32_t lflow_hash);
 static void lflow_ref_node_destroy(struct lflow_ref_node *);
 
 static bool lflow_hash_lock_initialized = false;
@@ -125,7 +157,15 @@ static bool lflow_hash_lock_initialized = false;
  * because the chance that different threads contending the same lock amongst
  * the big number of locks is very low. */
 #define LFLOW_HASH_LOCK_MASK 0xFFFF
-static struct ovs_mutex lflow_hash_locks[LFLOW_HASH_LOCK_MASK + 1];
+
+/* The lflows inserted concurrently are counted per lock, under the lock, and
+ * added to the size of the table by lflow_table_fix_size(), because the lock
+ * doesn't protect the size of the hmap. */
+struct lflow_hash_lock {
+    struct ovs_mutex mutex;
+    size_t n_inserted;
+};
+static struct lflow_hash_lock lflow_hash_locks[LFLOW_HASH_LOCK_MASK + 1];
 
 /* Full thread safety analysis is not possible with hash locks, because
  * they are taken conditionally based on the 'parallelization_state' and
@@ -146,6 +186,29 @@ static struct ovs_mutex lflow_hash_locks[LFLOW_HASH_LOCK_MASK + 1];
  */
 extern struct ovs_mutex fake_hash_mutex;
 
+/* Set of datapaths, by their 'index', that a logical flow applies to.
+ *
+ * Most logical flows apply to a handful of datapaths, so a bitmap sized to
+ * the total number of datapaths would mostly hold zeros.  The set is kept as
+ * a sorted array of indexes while that is smaller than the bitmap and is
+ * converted to a bitmap once it grows past that size.  It is never converted
+ * back. */
+struct ovn_dp_set {
+    size_t n;                 /* Number of datapaths in the set. */
+    size_t len;               /* Total number of datapaths. */
+    unsigned long *bitmap;    /* Nonnull if the set is dense. */
+    uint32_t *indexes;        /* Sorted datapath indexes if sparse. */
+    size_t allocated;         /* Number of allocated 'indexes'. */
+};
+
+static void ovn_dp_set_init(struct ovn_dp_set *, size_t len);
+static void ovn_dp_set_clear(struct ovn_dp_set *);
+static void ovn_dp_set_destroy(struct ovn_dp_set *);
+static bool ovn_dp_set_contains(const struct ovn_dp_set *, size_t index);
+static void ovn_dp_set_add(struct ovn_dp_set *, size_t index);
+static void ovn_dp_set_remove(struct ovn_dp_set *, size_t index);
+static size_t ovn_dp_set_first(const struct ovn_dp_set *);
+
 /* Represents a logical ovn flow (lflow).
  *
  * A logical flow with match 'M' and actions 'A' - L(M, A) is created
@@ -161,16 +224,16 @@ struct ovn_lflow {
     struct hmap_node hmap_node;
 
     struct ovn_datapath *od;     /* 'logical_datapath' in SB schema.  */
-    unsigned long *dpg_bitmap;   /* Bitmap of all datapaths by their 'index'.*/
+    struct ovn_dp_set dps;       /* All datapaths by their 'index'. */
     enum ovn_stage stage;
     uint16_t priority;
-    char *match;
-    char *actions;
-    char *io_port;
+    const char *match;           /* Interned, see 'struct lflow_str'. */
+    const char *actions;         /* Interned. */
+    const char *io_port;         /* Interned, may be NULL. */
     char *stage_hint;
-    char *ctrl_meter;
+    const char *ctrl_meter;      /* Interned, may be NULL. */
     size_t n_ods;                /* Number of datapaths referenced by 'od' and
-                                  * 'dpg_bitmap'. */
+                                  * 'dps'. */
     struct ovn_dp_group *dpg;    /* Link to unique Sb datapath group. */
     const char *where;
 
@@ -179,21 +242,130 @@ struct ovn_lflow {
     struct hmap dp_refcnts_map; /* Maintains the number of times this ovn_lflow
                                  * is referenced by a given datapath.
                                  * Contains 'struct dp_refcnt' in the map. */
+    uint64_t sync_seqno;        /* lflow_table 'sync_seqno' of the last full
+                                 * sync of this lflow to the SB DB. */
+    bool stale;                 /* Not added again yet by the rebuild in
+                                 * progress, see lflow_table_mark_stale(). */
+
+    /* The only datapath of a parameterized lflow, NULL for other lflows.
+     * See lflow_table_add_lflow_with_params(). */
+    const struct ovn_datapath *params_od;
+    struct hmap *params;        /* Contains 'struct lflow_params', NULL
+                                 * until the first tuple is added. */
+};
+
+/* A tuple of parameters of a parameterized lflow.
+ *
+ * The lflows that only differ by a few constants, e.g. the MAC address and
+ * the name of a logical switch port, are added as a single lflow per
+ * datapath whose match and actions refer to the constants as template
+ * variables, and a tuple of parameters, which gives their values, per
+ * original lflow.  The tuples are synced to the 'parameters' column of the
+ * SB logical flow, ovn-controller expands the lflow once for each of them.
+ *
+ * A tuple is used by each lflow_ref_node that references the lflow for it,
+ * or by a caller of lflow_table_add_lflow_with_params() that doesn't pass
+ * an lflow_ref, and only the tuples in use are synced. */
+struct lflow_params {
+    struct hmap_node node;      /* In 'params' of 'struct ovn_lflow'. */
+    size_t n_refs;              /* Number of lflow_ref_nodes. */
+    size_t n_linked;            /* Number of uses: linked lflow_ref_nodes and
+                                 * additions without an lflow_ref. */
+    char str[];
+};
+
+/* Interned strings of the lflow table.
+ *
+ * A handful of strings, e.g. "next;" or "drop;" as actions, are shared by a
+ * very large number of logical flows, so all the match, actions, io_port and
+ * ctrl_meter strings of the lflows are stored only once per lflow table and
+ * reference counted.
+ *
+ * The lflows are added from multiple threads during the parallel build, so
+ * the strings are split into shards, each protected by its own mutex. */
+struct lflow_str {
+    struct hmap_node node;       /* In 'struct lflow_str_shard' 'strs'. */
+    size_t refcnt;
+    char str[];
+};
+
+#define LFLOW_STR_N_SHARDS 64
+
+struct lflow_str_shard {
+    struct ovs_mutex mutex;
+    struct hmap strs;            /* Contains 'struct lflow_str'. */
 };
 
 /* Logical flow table. */
 struct lflow_table {
     struct hmap entries; /* hmap of lflows. */
-    struct hmap ls_dp_groups; /* hmap of logical switch dp groups. */
-    struct hmap lr_dp_groups; /* hmap of logical router dp groups. */
     ssize_t max_seen_lflow_size;
+    uint64_t sync_seqno;      /* Incremented by lflow_table_sync_to_sb(). */
+    struct hmapx pending;     /* 'struct ovn_lflow's not yet inserted in the
+                               * SB, see lflow_table_sync_to_sb(). */
+    struct lflow_str_shard str_shards[LFLOW_STR_N_SHARDS];
 };
 
+static const char *
+lflow_str_intern(struct lflow_table *lflow_table, const char *str)
+{
+    if (!str) {
+        return NULL;
+    }
+
+    uint32_t hash = hash_string(str, 0);
+    struct lflow_str_shard *shard =
+        &lflow_table->str_shards[hash % LFLOW_STR_N_SHARDS];
+    struct lflow_str *ls;
+
+    ovs_mutex_lock(&shard->mutex);
+    HMAP_FOR_EACH_WITH_HASH (ls, node, hash, &shard->strs) {
+        if (!strcmp(ls->str, str)) {
+            ls->refcnt++;
+            ovs_mutex_unlock(&shard->mutex);
+            return ls->str;
+        }
+    }
+
+    size_t len = strlen(str);
+    ls = xmalloc(sizeof *ls + len + 1);
+    ls->refcnt = 1;
+    memcpy(ls->str, str, len + 1);
+    hmap_insert(&shard->strs, &ls->node, hash);
+    ovs_mutex_unlock(&shard->mutex);
+
+    return ls->str;
+}
+
+static void
+lflow_str_release(struct lflow_table *lflow_table, const char *str)
+{
+    if (!str) {
+        return;
+    }
+
+    struct lflow_str *ls = CONTAINER_OF(str, struct lflow_str, str);
+    struct lflow_str_shard *shard =
+        &lflow_table->str_shards[ls->node.hash % LFLOW_STR_N_SHARDS];
+
+    ovs_mutex_lock(&shard->mutex);
+    if (!--ls->refcnt) {
+        hmap_remove(&shard->strs, &ls->node);
+        free(ls);
+    }
+    ovs_mutex_unlock(&shard->mutex);
+}
+
 struct lflow_table *
 lflow_table_alloc(void)
 {
     struct lflow_table *lflow_table = xzalloc(sizeof *lflow_table);
     lflow_table->max_seen_lflow_size = 128;
+    hmapx_init(&lflow_table->pending);
+    for (size_t i = 0; i < LFLOW_STR_N_SHARDS; i++) {
+        ovs_mutex_init(&lflow_table->str_shards[i].mutex);
+        hmap_init(&lflow_table->str_shards[i].strs);
+    }
 
     return lflow_table;
 }
@@ -203,8 +375,6 @@ lflow_table_init(struct lflow_table *lflow_table)
 {
     fast_hmap_size_for(&lflow_table->entries,
                        lflow_table->max_seen_lflow_size);
-    ovn_dp_groups_init(&lflow_table->ls_dp_groups);
-    ovn_dp_groups_init(&lflow_table->lr_dp_groups);
 }
 
 void
@@ -212,11 +382,59 @@ lflow_table_clear(struct lflow_table *lflow_table)
 {
     struct ovn_lflow *lflow;
     HMAP_FOR_EACH_SAFE (lflow, hmap_node, &lflow_table->entries) {
+        ovn_dp_group_release(lflow->dpg);
         ovn_lflow_destroy(lflow_table, lflow);
     }
+    ovs_assert(hmapx_is_empty(&lflow_table->pending));
+}
+
+/* Prepares 'lflow_table' for a full rebuild of its lflows.
+ *
+ * Instead of destroying all the lflows and building them from scratch, as
+ * lflow_table_clear() does, each lflow is only emptied and marked as stale:
+ * it loses its datapaths, its references and its tuples of parameters, but
+ * keeps its interned strings, its datapath group and its SB row.  The lflows
+ * added again by the rebuild are reused in place, the other ones are
+ * destroyed by lflow_table_sweep_stale() once the rebuild is done.  This
+ * avoids freeing and allocating again, and interning again the strings of,
+ * almost all the lflows on each recompute, and holding both the lflows
+ * being destroyed and the new ones at the same time. */
+void
+lflow_table_mark_stale(struct lflow_table *lflow_table)
+{
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH (lflow, hmap_node, &lflow_table->entries) {
+        struct lflow_ref_node *lrn;
+        LIST_FOR_EACH_SAFE (lrn, ref_list_node, &lflow->referenced_by) {
+            lflow_ref_node_destroy(lrn);
+        }
+        if (lflow->params) {
+            struct lflow_params *params;
+            HMAP_FOR_EACH_POP (params, node, lflow->params) {
+                free(params);
+            }
+        }
+        ovn_lflow_clear_dp_refcnts_map(lflow);
+        hmap_init(&lflow->dp_refcnts_map);
+        ovn_dp_set_clear(&lflow->dps);
+        lflow->stale = true;
+    }
+}
 
-    ovn_dp_groups_clear(&lflow_table->ls_dp_groups);
-    ovn_dp_groups_clear(&lflow_table->lr_dp_groups);
+/* Destroys the lflows of 'lflow_table' that were not added again since
+ * lflow_table_mark_stale().  Their SB rows are deleted by the next
+ * lflow_table_sync_to_sb().  Must be called once the rebuild is done,
+ * after lflow_table_fix_size() if the lflows were added in parallel. */
+void
+lflow_table_sweep_stale(struct lflow_table *lflow_table)
+{
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH_SAFE (lflow, hmap_node, &lflow_table->entries) {
+        if (lflow->stale) {
+            ovn_dp_group_release(lflow->dpg);
+            ovn_lflow_destroy(lflow_table, lflow);
+        }
+    }
 }
 
 void
@@ -224,8 +442,13 @@ lflow_table_destroy(struct lflow_table *lflow_table)
 {
     lflow_table_clear(lflow_table);
     hmap_destroy(&lflow_table->entries);
-    ovn_dp_groups_destroy(&lflow_table->ls_dp_groups);
-    ovn_dp_groups_destroy(&lflow_table->lr_dp_groups);
+    hmapx_destroy(&lflow_table->pending);
+    for (size_t i = 0; i < LFLOW_STR_N_SHARDS; i++) {
+        /* All the strings are released together with the lflows. */
+        ovs_assert(hmap_is_empty(&lflow_table->str_shards[i].strs));
+        hmap_destroy(&lflow_table->str_shards[i].strs);
+        ovs_mutex_destroy(&lflow_table->str_shards[i].mutex);
+    }
     free(lflow_table);
 }
 
@@ -240,12 +463,248 @@ lflow_table_expand(struct lflow_table *lflow_table)
     }
 }
 
+/* Adds to the size of 'lflow_table' the lflows that were inserted
+ * concurrently by parallel lflow builds since the last call.  Must be called
+ * once the workers are done, before any other operation on the table. */
 void
-lflow_table_set_size(struct lflow_table *lflow_table, size_t size)
+lflow_table_fix_size(struct lflow_table *lflow_table)
 {
-    lflow_table->entries.n = size;
+    if (!lflow_hash_lock_initialized) {
+        return;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < LFLOW_HASH_LOCK_MASK + 1; i++) {
+        n += lflow_hash_locks[i].n_inserted;
+        lflow_hash_locks[i].n_inserted = 0;
+    }
+    lflow_table->entries.n += n;
 }
 
+size_t
+lflow_table_size(const struct lflow_table *lflow_table)
+{
+    return hmap_count(&lflow_table->entries);
+}
+
+/* Adds to 'usage' the number of lflows and datapath groups of 'lflow_table',
+ * and the number and size of its interned strings.  Must not be called
+ * while lflows are being added from multiple threads. */
+void
+lflow_table_get_memory_usage(const struct lflow_table *lflow_table,
+                             struct simap *usage)
+{
+    size_t n_strs = 0;
+    size_t strs_usage = 0;
+
+    for (size_t i = 0; i < LFLOW_STR_N_SHARDS; i++) {
+        const struct lflow_str *ls;
+
+        HMAP_FOR_EACH (ls, node, &lflow_table->str_shards[i].strs) {
+            strs_usage += sizeof *ls + strlen(ls->str) + 1;
+        }
+        n_strs += hmap_count(&lflow_table->str_shards[i].strs);
+    }
+
+    simap_increase(usage, "lflow-lflows", hmap_count(&lflow_table->entries));
+    simap_increase(usage, "lflow-ls-dp-groups", ovn_dp_groups_count(true));
+    simap_increase(usage, "lflow-lr-dp-groups", ovn_dp_groups_count(false));
+    simap_increase(usage, "lflow-strings", n_strs);
+    simap_increase(usage, "lflow-strings-KB",
+                   ROUND_UP(strs_usage, 1024) / 1024);
+}
+
+/* Per stage statistics of an lflow table, see
+ * lflow_table_format_stage_stats(). */
+struct lflow_stage_stats {
+    enum ovn_stage stage;
+    size_t n_lflows;            /* Number of lflows, i.e. of SB rows. */
+    size_t n_dp_group_lflows;   /* Lflows that apply to several datapaths. */
+    size_t n_ods;               /* Sum of the lflows' 'n_ods'. */
+};
+
+static int
+compare_lflow_stage_stats(const void *a_, const void *b_)
+{
+    const struct lflow_stage_stats *a = a_;
+    const struct lflow_stage_stats *b = b_;
+
+    if (a->n_lflows != b->n_lflows) {
+        return a->n_lflows > b->n_lflows ? -1 : 1;
+    }
+    return a->stage < b->stage ? -1 : a->stage > b->stage;
+}
+
+/* Appends to 'ds' the number of lflows of 'lflow_table' in each stage, the
+ * largest first, with the number of them that apply to several datapaths,
+ * the number of datapaths they apply to, and the sharing ratio, i.e. the
+ * average number of datapaths per lflow.  Stages without lflows are
+ * omitted.  Must not be called while lflows are being added from multiple
+ * threads. */
+void
+lflow_table_format_stage_stats(const struct lflow_table *lflow_table,
+                               struct ds *ds)
+{
+    static const enum ovn_stage stages[] = {
+#define PIPELINE_STAGE(DP_TYPE, PIPELINE, STAGE, TABLE, NAME)   \
+        S_##DP_TYPE##_##PIPELINE##_##STAGE,
+        PIPELINE_STAGES
+#undef PIPELINE_STAGE
+    };
+    /* Indexed by 'enum ovn_stage', which fits in 10 bits. */
+    struct lflow_stage_stats *by_stage =
+        xcalloc(OVN_STAGE_BUILD(DP_ROUTER, P_OUT, UINT8_MAX) + 1,
+                sizeof *by_stage);
+
+    const struct ovn_lflow *lflow;
+    HMAP_FOR_EACH (lflow, hmap_node, &lflow_table->entries) {
+        struct lflow_stage_stats *s = &by_stage[lflow->stage];
+
+        s->n_lflows++;
+        s->n_dp_group_lflows += lflow->n_ods > 1;
+        s->n_ods += lflow->n_ods;
+    }
+
+    struct lflow_stage_stats stats[ARRAY_SIZE(stages)];
+    size_t n_stats = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(stages); i++) {
+        if (by_stage[stages[i]].n_lflows) {
+            stats[n_stats] = by_stage[stages[i]];
+            stats[n_stats++].stage = stages[i];
+        }
+    }
+    free(by_stage);
+    qsort(stats, n_stats, sizeof *stats, compare_lflow_stage_stats);
+
+    struct lflow_stage_stats total = { .n_lflows = 0 };
+    ds_put_format(ds, "%-32s %10s %10s %10s %8s\n", "stage", "lflows",
+                  "dp-groups", "datapaths", "sharing");
+    for (size_t i = 0; i < n_stats; i++) {
+        ds_put_format(ds, "%-32s %10"PRIuSIZE" %10"PRIuSIZE" %10"PRIuSIZE
+                      " %8.2f\n", ovn_stage_to_str(stats[i].stage),
+                      stats[i].n_lflows, stats[i].n_dp_group_lflows,
+                      stats[i].n_ods,
+                      (double) stats[i].n_ods / stats[i].n_lflows);
+        total.n_lflows += stats[i].n_lflows;
+        total.n_dp_group_lflows += stats[i].n_dp_group_lflows;
+        total.n_ods += stats[i].n_ods;
+    }
+    ds_put_format(ds, "%-32s %10"PRIuSIZE" %10"PRIuSIZE" %10"PRIuSIZE
+                  " %8.2f\n", "total", total.n_lflows,
+                  total.n_dp_group_lflows, total.n_ods,
+                  total.n_lflows
+                  ? (double) total.n_ods / total.n_lflows : 0.0);
+}
+
+/* Returns the lflow in 'lflows' that corresponds to the SB logical flow
+ * 'sbflow', or NULL if there is none or if 'sbflow' has no valid logical
+ * datapaths anymore.  Does not modify anything, so that it can be called
+ * from multiple threads at once. */
+static struct ovn_lflow *
+ovn_lflow_find_by_sbflow(const struct hmap *lflows,
+                         const struct sbrec_logical_flow *sbflow,
+                         const struct ovn_datapaths *ls_datapaths,
+                         const struct ovn_datapaths *lr_datapaths)
+{
+    struct sbrec_logical_dp_group *dp_group = sbflow->logical_dp_group;
+    struct ovn_datapath *logical_datapath_od = NULL;
+    size_t i;
+
+    /* Find one valid datapath to get the datapath type. */
+    struct sbrec_datapath_binding *dp = sbflow->logical_datapath;
+    if (dp) {
+        logical_datapath_od = ovn_datapath_from_sbrec(
+            &ls_datapaths->datapaths, &lr_datapaths->datapaths, dp);
+        if (logical_datapath_od
+            && ovn_datapath_is_stale(logical_datapath_od)) {
+            logical_datapath_od = NULL;
+        }
+    }
+    for (i = 0; dp_group && i < dp_group->n_datapaths; i++) {
+        logical_datapath_od = ovn_datapath_from_sbrec(
+            &ls_datapaths->datapaths, &lr_datapaths->datapaths,
+            dp_group->datapaths[i]);
+        if (logical_datapath_od
+            && !ovn_datapath_is_stale(logical_datapath_od)) {
+            break;
+        }
+        logical_datapath_od = NULL;
+    }
+
+    if (!logical_datapath_od) {
+        /* This lflow has no valid logical datapaths. */
+        return NULL;
+    }
+
+    enum ovn_pipeline pipeline
+        = !strcmp(sbflow->pipeline, "ingress") ? P_IN : P_OUT;
+
+    /* 'sbflow->hash' is maintained by the IDL, see lib/ovn-sb-idl.ann, so
+     * the lookup doesn't hash the match and actions again. */
+    uint32_t hash = sbflow->hash;
+    const struct ovn_datapath *params_od = NULL;
+    if (sbflow->n_parameters) {
+        if (!dp || dp_group) {
+            return NULL;
+        }
+        params_od = logical_datapath_od;
+        hash = hash_int(params_od->index, hash);
+    }
+
+    return ovn_lflow_find(
+        lflows,
+        ovn_stage_build(ovn_datapath_get_type(logical_datapath_od),
+                        pipeline, sbflow->table_id),
+        sbflow->priority, sbflow->match, sbflow->actions,
+        sbflow->controller_meter, params_od, hash);
+}
+
+/* Number of SB logical flows matched by a worker in one go. */
+#define LFLOW_SYNC_CHUNK_SIZE 256
+
+struct lflow_sync_match_ctx {
+    const struct hmap *lflows;
+    const struct ovn_datapaths *ls_datapaths;
+    const struct ovn_datapaths *lr_datapaths;
+    const struct sbrec_logical_flow **sbflows;
+    struct ovn_lflow **matches;
+    size_t n_sbflows;
+    struct work_queue wq;       /* Jobs are chunks of 'sbflows'. */
+};
+
+static void
+lflow_sync_match_task(struct worker_control *control, void *ctx_)
+{
+    struct lflow_sync_match_ctx *ctx = ctx_;
+    size_t chunk;
+
+    while (ovn_work_queue_next(&ctx->wq, control->id, &chunk)) {
+        size_t start = chunk * LFLOW_SYNC_CHUNK_SIZE;
+        size_t end = MIN(start + LFLOW_SYNC_CHUNK_SIZE, ctx->n_sbflows);
+
+        for (size_t i = start; i < end; i++) {
+            ctx->matches[i] = ovn_lflow_find_by_sbflow(ctx->lflows,
+                                                       ctx->sbflows[i],
+                                                       ctx->ls_datapaths,
+                                                       ctx->lr_datapaths);
+        }
+    }
+}
+
+/* Syncs the lflow table to the SB Logical_Flow table.
+ *
+ * If 'pool' is nonnull, matching the existing SB logical flows to the
+ * ovn_lflows, which does not modify anything, is split between the workers
+ * of 'pool'.  The pool must have been created with ovn_worker_task_thread().
+ * All the changes to 'ovnsb_txn' and to the dp groups are still done by the
+ * calling thread.
+ *
+ * If 'max_inserts' is nonzero, at most that many new SB logical flows are
+ * inserted in 'ovnsb_txn'.  The remaining ones are kept pending and are
+ * inserted by later calls to lflow_table_sync_pending(), each one in its own
+ * transaction, so that a full recompute of a large deployment doesn't
+ * result in a single huge SB transaction.  Updates and deletions of the
+ * existing SB logical flows are never deferred. */
 void
 lflow_table_sync_to_sb(struct lflow_table *lflow_table,
                        struct ovsdb_idl_txn *ovnsb_txn,
@@ -253,63 +712,69 @@ lflow_table_sync_to_sb(struct lflow_table *lflow_table,
                        const struct ovn_datapaths *lr_datapaths,
                        bool ovn_internal_version_changed,
                        const struct sbrec_logical_flow_table *sb_flow_table,
-                       const struct sbrec_logical_dp_group_table *dpgrp_table)
+                       const struct sbrec_logical_dp_group_table *dpgrp_table,
+                       struct worker_pool *pool, size_t max_inserts)
 {
     struct hmap lflows_temp = HMAP_INITIALIZER(&lflows_temp);
     struct hmap *lflows = &lflow_table->entries;
+    long long int start OVS_UNUSED = ovn_usdt_time_usec();
     struct ovn_lflow *lflow;
 
     fast_hmap_size_for(&lflows_temp,
                        lflow_table->max_seen_lflow_size);
 
-    /* Push changes to the Logical_Flow table to database. */
+    /* Collect all the SB logical flows first, so the lookups can be done
+     * in parallel before anything is changed. */
     const struct sbrec_logical_flow *sbflow;
-    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH_SAFE (sbflow, sb_flow_table) {
-        struct sbrec_logical_dp_group *dp_group = sbflow->logical_dp_group;
-        struct ovn_datapath *logical_datapath_od = NULL;
-        size_t i;
-
-        /* Find one valid datapath to get the datapath type. */
-        struct sbrec_datapath_binding *dp = sbflow->logical_datapath;
-        if (dp) {
-            logical_datapath_od = ovn_datapath_from_sbrec(
-                &ls_datapaths->datapaths, &lr_datapaths->datapaths, dp);
-            if (logical_datapath_od
-                && ovn_datapath_is_stale(logical_datapath_od)) {
-                logical_datapath_od = NULL;
-            }
-        }
-        for (i = 0; dp_group && i < dp_group->n_datapaths; i++) {
-            logical_datapath_od = ovn_datapath_from_sbrec(
-                &ls_datapaths->datapaths, &lr_datapaths->datapaths,
-                dp_group->datapaths[i]);
-            if (logical_datapath_od
-                && !ovn_datapath_is_stale(logical_datapath_od)) {
-                break;
-            }
-            logical_datapath_od = NULL;
+    size_t n_sbflows = 0, allocated_sbflows = 0;
+    const struct sbrec_logical_flow **sbflows = NULL;
+    SBREC_LOGICAL_FLOW_TABLE_FOR_EACH (sbflow, sb_flow_table) {
+        if (n_sbflows == allocated_sbflows) {
+            sbflows = x2nrealloc(sbflows, &allocated_sbflows,
+                                 sizeof *sbflows);
         }
+        sbflows[n_sbflows++] = sbflow;
+    }
 
-        if (!logical_datapath_od) {
-            /* This lflow has no valid logical datapaths. */
-            sbrec_logical_flow_delete(sbflow);
-            continue;
+    struct ovn_lflow **matches = xmalloc(MAX(n_sbflows, 1) * sizeof *matches);
+    if (pool && n_sbflows > LFLOW_SYNC_CHUNK_SIZE) {
+        struct lflow_sync_match_ctx ctx = {
+            .lflows = lflows,
+            .ls_datapaths = ls_datapaths,
+            .lr_datapaths = lr_datapaths,
+            .sbflows = sbflows,
+            .matches = matches,
+            .n_sbflows = n_sbflows,
+        };
+
+        ovn_work_queue_init_for_pool(&ctx.wq, pool);
+        ovn_work_queue_reset(&ctx.wq, DIV_ROUND_UP(n_sbflows,
+                                                   LFLOW_SYNC_CHUNK_SIZE));
+        run_pool_task(pool, lflow_sync_match_task, &ctx);
+        ovn_work_queue_destroy(&ctx.wq);
+    } else {
+        for (size_t i = 0; i < n_sbflows; i++) {
+            matches[i] = ovn_lflow_find_by_sbflow(lflows, sbflows[i],
+                                                  ls_datapaths, lr_datapaths);
         }
-
-        enum ovn_pipeline pipeline
-            = !strcmp(sbflow->pipeline, "ingress") ? P_IN : P_OUT;
-
-        lflow = ovn_lflow_find(
-            lflows,
-            ovn_stage_build(ovn_datapath_get_type(logical_datapath_od),
-                            pipeline, sbflow->table_id),
-            sbflow->priority, sbflow->match, sbflow->actions,
-            sbflow->controller_meter, sbflow->hash);
-        if (lflow) {
+    }
+    long long int matched OVS_UNUSED = ovn_usdt_time_usec();
+
+    /* Push changes to the Logical_Flow table to database.
+     *
+     * More than one SB logical flow can match the same ovn_lflow, e.g. if
+     * the SB DB was modified externally.  Only the first one is kept, the
+     * ovn_lflow is marked with the current 'sync_seqno' once it is synced. */
+    lflow_table->sync_seqno++;
+    for (size_t i = 0; i < n_sbflows; i++) {
+        lflow = matches[i];
+        sbflow = sbflows[i];
+        if (lflow && lflow->sync_seqno != lflow_table->sync_seqno) {
             sync_lflow_to_sb(lflow, ovnsb_txn, lflow_table, ls_datapaths,
                              lr_datapaths, ovn_internal_version_changed,
                              sbflow, dpgrp_table);
 
+            lflow->sync_seqno = lflow_table->sync_seqno;
             hmap_remove(lflows, &lflow->hmap_node);
             hmap_insert(&lflows_temp, &lflow->hmap_node,
                         hmap_node_hash(&lflow->hmap_node));
@@ -317,18 +782,69 @@ lflow_table_sync_to_sb(struct lflow_table *lflow_table,
             sbrec_logical_flow_delete(sbflow);
         }
     }
+    free(matches);
+    free(sbflows);
 
+    hmapx_clear(&lflow_table->pending);
+    size_t n_inserts = 0;
     HMAP_FOR_EACH_SAFE (lflow, hmap_node, lflows) {
-        sync_lflow_to_sb(lflow, ovnsb_txn, lflow_table, ls_datapaths,
-                         lr_datapaths, ovn_internal_version_changed,
-                         NULL, dpgrp_table);
+        if (max_inserts && n_inserts >= max_inserts) {
+            hmapx_add(&lflow_table->pending, lflow);
+        } else {
+            sync_lflow_to_sb(lflow, ovnsb_txn, lflow_table, ls_datapaths,
+                             lr_datapaths, ovn_internal_version_changed,
+                             NULL, dpgrp_table);
+            n_inserts++;
+        }
 
+        lflow->sync_seqno = lflow_table->sync_seqno;
         hmap_remove(lflows, &lflow->hmap_node);
         hmap_insert(&lflows_temp, &lflow->hmap_node,
                     hmap_node_hash(&lflow->hmap_node));
     }
     hmap_swap(lflows, &lflows_temp);
     hmap_destroy(&lflows_temp);
+
+    /* Lookup of the SB logical flows, then update of the SB, in
+     * microseconds. */
+    OVS_USDT_PROBE(lflow_table_sync_to_sb, sync, hmap_count(lflows),
+                   n_sbflows, n_inserts, hmapx_count(&lflow_table->pending),
+                   matched - start, ovn_usdt_time_usec() - matched);
+}
+
+/* Inserts in 'ovnsb_txn' up to 'max_inserts' (all of them if zero) of the
+ * logical flows left pending by lflow_table_sync_to_sb().  Returns the
+ * number of logical flows inserted. */
+size_t
+lflow_table_sync_pending(
+    struct lflow_table *lflow_table, struct ovsdb_idl_txn *ovnsb_txn,
+    const struct ovn_datapaths *ls_datapaths,
+    const struct ovn_datapaths *lr_datapaths,
+    const struct sbrec_logical_dp_group_table *dpgrp_table,
+    size_t max_inserts)
+{
+    size_t n_inserts = 0;
+
+    struct hmapx_node *node;
+    HMAPX_FOR_EACH_SAFE (node, &lflow_table->pending) {
+        if (max_inserts && n_inserts >= max_inserts) {
+            break;
+        }
+
+        /* sync_lflow_to_sb() removes 'lflow' from the pending set. */
+        struct ovn_lflow *lflow = node->data;
+        sync_lflow_to_sb(lflow, ovnsb_txn, lflow_table, ls_datapaths,
+                         lr_datapaths, false, NULL, dpgrp_table);
+        n_inserts++;
+    }
+
+    return n_inserts;
+}
+
+bool
+lflow_table_has_pending(const struct lflow_table *lflow_table)
+{
+    return !hmapx_is_empty(&lflow_table->pending);
 }
 
 /* Logical flow sync using 'struct lflow_ref'
@@ -417,10 +933,10 @@ lflow_table_sync_to_sb(struct lflow_table *lflow_table,
  * L3 is referenced by E1 and E2
  * L4 is referenced by just E2
  *
- * L1->dpg_bitmap = [E1->od->index, E2->od->index]
- * L2->dpg_bitmap = [E1->od->index]
- * L3->dpg_bitmap = [E1->od->index, E2->od->index]
- * L4->dpg_bitmap = [E2->od->index]
+ * L1->dps = [E1->od->index, E2->od->index]
+ * L2->dps = [E1->od->index]
+ * L3->dps = [E1->od->index, E2->od->index]
+ * L4->dps = [E2->od->index]
  *
  *
  * When 'E' gets updated,
@@ -436,10 +952,10 @@ lflow_table_sync_to_sb(struct lflow_table *lflow_table,
  *
  *       bitmap status of all lflows in the lflows table
  *       -----------------------------------------------
- *       L1->dpg_bitmap = [E2->od->index]
- *       L2->dpg_bitmap = []
- *       L3->dpg_bitmap = [E2->od->index]
- *       L4->dpg_bitmap = [E2->od->index]
+ *       L1->dps = [E2->od->index]
+ *       L2->dps = []
+ *       L3->dps = [E2->od->index]
+ *       L4->dps = [E2->od->index]
  *
  *   2.  In step (2), client should generate the logical flows again for 'E1'.
  *       Lets say it calls:
@@ -456,11 +972,11 @@ lflow_table_sync_to_sb(struct lflow_table *lflow_table,
  *
  *       bitmap status of all lflows in the lflow table after end of step (2)
  *       --------------------------------------------------------------------
- *       L1->dpg_bitmap = [E2->od->index]
- *       L2->dpg_bitmap = []
- *       L3->dpg_bitmap = [E1->od->index, E2->od->index]
- *       L4->dpg_bitmap = [E2->od->index]
- *       L5->dpg_bitmap = [E1->od->index]
+ *       L1->dps = [E2->od->index]
+ *       L2->dps = []
+ *       L3->dps = [E1->od->index, E2->od->index]
+ *       L4->dps = [E2->od->index]
+ *       L5->dps = [E1->od->index]
  *
  *   3.  In step (3), client should sync the E1's lflows by calling
  *       lflow_ref_sync_lflows(E1->lflow_ref,....);
@@ -535,6 +1051,11 @@ struct lflow_ref_node {
      * Valid only if dpgrp_lflow is false. */
     size_t dp_index;
 
+    /* Tuple of parameters of a parameterized lflow, NULL for other lflows.
+     * An lflow_ref may reference a parameterized lflow for several tuples,
+     * e.g. for the MAC addresses of a port, with an lflow_ref_node each. */
+    struct lflow_params *params;
+
     /* Indicates if the lflow_ref_node for an lflow - L(M, A) is linked
      * to datapath(s) or not.
      * It is set to true when an lflow L(M, A) is referenced by an lflow ref
@@ -585,16 +1106,19 @@ lflow_ref_unlink_lflows(struct lflow_ref *lflow_ref)
             BITMAP_FOR_EACH_1 (index, lrn->dpgrp_bitmap_len,
                                lrn->dpgrp_bitmap) {
                 if (dp_refcnt_release(&lrn->lflow->dp_refcnts_map, index)) {
-                    bitmap_set0(lrn->lflow->dpg_bitmap, index);
+                    ovn_dp_set_remove(&lrn->lflow->dps, index);
                 }
             }
         } else {
             if (dp_refcnt_release(&lrn->lflow->dp_refcnts_map,
                                   lrn->dp_index)) {
-                bitmap_set0(lrn->lflow->dpg_bitmap, lrn->dp_index);
+                ovn_dp_set_remove(&lrn->lflow->dps, lrn->dp_index);
             }
         }
 
+        if (lrn->params && lrn->linked) {
+            lrn->params->n_linked--;
+        }
         lrn->linked = false;
     }
 }
@@ -632,6 +1156,89 @@ lflow_ref_sync_lflows(struct lflow_ref *lflow_ref,
                                    dpgrp_table);
 }
 
+/* Makes 'lflow_ref' reference 'lflow', whose hash is 'hash', for the
+ * datapath 'od' or, if 'od' is NULL, for the datapaths in 'dp_bitmap', and
+ * for the tuple 'params' if 'lflow' is parameterized.
+ * Caller must hold the hash lock of 'lflow'. */
+static void
+lflow_ref_link_lflow(struct lflow_ref *lflow_ref, struct ovn_lflow *lflow,
+                     uint32_t hash, const struct ovn_datapath *od,
+                     const unsigned long *dp_bitmap, size_t dp_bitmap_len,
+                     struct lflow_params *params)
+{
+    struct lflow_ref_node *lrn =
+        lflow_ref_node_find(&lflow_ref->lflow_ref_nodes, lflow, params,
+                            hash);
+    if (!lrn) {
+        lrn = xzalloc(sizeof *lrn);
+        lrn->lflow = lflow;
+        lrn->lflow_ref = lflow_ref;
+        lrn->params = params;
+        if (params) {
+            params->n_refs++;
+        }
+        lrn->dpgrp_lflow = !od;
+        if (lrn->dpgrp_lflow) {
+            lrn->dpgrp_bitmap = bitmap_clone(dp_bitmap, dp_bitmap_len);
+            lrn->dpgrp_bitmap_len = dp_bitmap_len;
+        } else {
+            lrn->dp_index = od->index;
+        }
+        ovs_list_insert(&lflow->referenced_by, &lrn->ref_list_node);
+        hmap_insert(&lflow_ref->lflow_ref_nodes, &lrn->ref_node, hash);
+    }
+
+    if (!lrn->linked) {
+        if (lrn->dpgrp_lflow) {
+            ovs_assert(lrn->dpgrp_bitmap_len == dp_bitmap_len);
+            size_t index;
+            BITMAP_FOR_EACH_1 (index, dp_bitmap_len, dp_bitmap) {
+                /* Allocate a reference counter only if already used. */
+                if (ovn_dp_set_contains(&lflow->dps, index)) {
+                    dp_refcnt_use(&lflow->dp_refcnts_map, index);
+                }
+            }
+        } else {
+            /* Allocate a reference counter only if already used. */
+            if (ovn_dp_set_contains(&lflow->dps, lrn->dp_index)) {
+                dp_refcnt_use(&lflow->dp_refcnts_map, lrn->dp_index);
+            }
+        }
+        if (params) {
+            params->n_linked++;
+        }
+    }
+    lrn->linked = true;
+}
+
+/* Returns the tuple 'str' of the parameterized lflow 'lflow', which is
+ * created, unused, if it doesn't exist yet.  Caller must hold the hash lock
+ * of 'lflow'. */
+static struct lflow_params *
+lflow_params_get(struct ovn_lflow *lflow, const char *str)
+{
+    uint32_t hash = hash_string(str, 0);
+    struct lflow_params *params;
+
+    if (!lflow->params) {
+        lflow->params = xmalloc(sizeof *lflow->params);
+        hmap_init(lflow->params);
+    }
+    HMAP_FOR_EACH_WITH_HASH (params, node, hash, lflow->params) {
+        if (!strcmp(params->str, str)) {
+            return params;
+        }
+    }
+
+    size_t len = strlen(str);
+    params = xmalloc(sizeof *params + len + 1);
+    params->n_refs = 0;
+    params->n_linked = 0;
+    memcpy(params->str, str, len + 1);
+    hmap_insert(lflow->params, &params->node, hash);
+    return params;
+}
+
 /* Adds a logical flow to the logical flow table for the match 'match'
  * and actions 'actions'.
  *
@@ -651,6 +1258,58 @@ lflow_ref_sync_lflows(struct lflow_ref *lflow_ref,
  * then it may corrupt the hmap.  Caller should ensure thread safety
  * for such scenarios.
  */
+static void
+lflow_table_add_lflow__(struct lflow_table *lflow_table,
+                        const struct ovn_datapath *od,
+                        const unsigned long *dp_bitmap, size_t dp_bitmap_len,
+                        enum ovn_stage stage, uint16_t priority,
+                        const char *match, const char *actions,
+                        const char *io_port, const char *ctrl_meter,
+                        const char *params,
+                        const struct ovsdb_idl_row *stage_hint,
+                        const char *where,
+                        struct lflow_ref *lflow_ref)
+    OVS_EXCLUDED(fake_hash_mutex)
+{
+    struct ovs_mutex *hash_lock;
+    uint32_t hash;
+
+    ovs_assert(!od ||
+               ovn_stage_to_datapath_type(stage) == ovn_datapath_get_type(od));
+    ovs_assert(!params || od);
+
+    hash = ovn_logical_flow_hash(ovn_stage_get_table(stage),
+                                 ovn_stage_get_pipeline(stage),
+                                 priority, match,
+                                 actions);
+    if (params) {
+        /* The parameterized lflows of different datapaths are distinct. */
+        hash = hash_int(od->index, hash);
+    }
+
+    hash_lock = lflow_hash_lock(&lflow_table->entries, hash);
+    struct ovn_lflow *lflow =
+        do_ovn_lflow_add(lflow_table,
+                         od ? ods_size(od->datapaths) : dp_bitmap_len,
+                         hash, stage, priority, match, actions,
+                         io_port, ctrl_meter, stage_hint, where,
+                         params ? od : NULL);
+
+    struct lflow_params *lflow_params = (params
+                                         ? lflow_params_get(lflow, params)
+                                         : NULL);
+    if (lflow_ref) {
+        lflow_ref_link_lflow(lflow_ref, lflow, hash, od,
+                             dp_bitmap, dp_bitmap_len, lflow_params);
+    } else if (lflow_params) {
+        lflow_params->n_linked++;
+    }
+
+    ovn_dp_group_add_with_reference(lflow, od, dp_bitmap, dp_bitmap_len);
+
+    lflow_hash_unlock(hash_lock);
+}
+
 void
 lflow_table_add_lflow(struct lflow_table *lflow_table,
                       const struct ovn_datapath *od,
@@ -662,6 +1321,57 @@ lflow_table_add_lflow(struct lflow_table *lflow_table,
                       const char *where,
                       struct lflow_ref *lflow_ref)
     OVS_EXCLUDED(fake_hash_mutex)
+{
+    lflow_table_add_lflow__(lflow_table, od, dp_bitmap, dp_bitmap_len, stage,
+                            priority, match, actions, io_port, ctrl_meter,
+                            NULL, stage_hint, where, lflow_ref);
+}
+
+/* Adds to the logical flow table the parameterized logical flow for the
+ * datapath 'od' with the match 'match' and actions 'actions', which refer
+ * to the parameters as template variables, e.g. "eth.dst == ^mac", for the
+ * tuple of parameters 'params', e.g. "mac=00:00:00:00:00:01" (see the
+ * 'parameters' column of the SB Logical_Flow table for the syntax).
+ *
+ * This is the same as adding with lflow_table_add_lflow() the logical flow
+ * whose match and actions are the ones of 'match' and 'actions' expanded
+ * with 'params', but all the tuples added for the same 'od', 'match' and
+ * 'actions' take a single SB logical flow.  The parameterized logical flows
+ * of a datapath are never shared with other datapaths. */
+void
+lflow_table_add_lflow_with_params(struct lflow_table *lflow_table,
+                                  const struct ovn_datapath *od,
+                                  enum ovn_stage stage, uint16_t priority,
+                                  const char *match, const char *actions,
+                                  const char *params,
+                                  const struct ovsdb_idl_row *stage_hint,
+                                  const char *where,
+                                  struct lflow_ref *lflow_ref)
+    OVS_EXCLUDED(fake_hash_mutex)
+{
+    lflow_table_add_lflow__(lflow_table, od, NULL, 0, stage, priority, match,
+                            actions, NULL, NULL, params, stage_hint, where,
+                            lflow_ref);
+}
+
+/* Same as lflow_table_add_lflow() for the formatted 'match' and 'actions',
+ * which are only formatted if the logical flow doesn't exist yet.  This
+ * saves formatting the match and actions of the logical flows that are
+ * added for several datapaths, or again for the same datapath by
+ * incremental processing, and interning the strings again. */
+void
+lflow_table_add_lflow_fmt(struct lflow_table *lflow_table,
+                          const struct ovn_datapath *od,
+                          const unsigned long *dp_bitmap,
+                          size_t dp_bitmap_len,
+                          enum ovn_stage stage, uint16_t priority,
+                          const struct ovn_fmt *match,
+                          const struct ovn_fmt *actions,
+                          const char *io_port, const char *ctrl_meter,
+                          const struct ovsdb_idl_row *stage_hint,
+                          const char *where,
+                          struct lflow_ref *lflow_ref)
+    OVS_EXCLUDED(fake_hash_mutex)
 {
     struct ovs_mutex *hash_lock;
     uint32_t hash;
@@ -669,56 +1379,38 @@ lflow_table_add_lflow(struct lflow_table *lflow_table,
     ovs_assert(!od ||
                ovn_stage_to_datapath_type(stage) == ovn_datapath_get_type(od));
 
-    hash = ovn_logical_flow_hash(ovn_stage_get_table(stage),
-                                 ovn_stage_get_pipeline(stage),
-                                 priority, match,
-                                 actions);
+    hash = ovn_logical_flow_fmt_hash(ovn_stage_get_table(stage),
+                                     ovn_stage_get_pipeline(stage),
+                                     priority, match, actions);
 
     hash_lock = lflow_hash_lock(&lflow_table->entries, hash);
     struct ovn_lflow *lflow =
-        do_ovn_lflow_add(lflow_table,
-                         od ? ods_size(od->datapaths) : dp_bitmap_len,
-                         hash, stage, priority, match, actions,
-                         io_port, ctrl_meter, stage_hint, where);
+        ovn_lflow_find_fmt(&lflow_table->entries, stage, priority, match,
+                           actions, ctrl_meter, hash);
+    if (!lflow) {
+        struct ds match_s = DS_EMPTY_INITIALIZER;
+        struct ds actions_s = DS_EMPTY_INITIALIZER;
+
+        COVERAGE_INC(lflow_fmt_format);
+        ovn_fmt_format(match, &match_s);
+        ovn_fmt_format(actions, &actions_s);
+        lflow = ovn_lflow_create(lflow_table,
+                                 od ? ods_size(od->datapaths) : dp_bitmap_len,
+                                 hash, stage, priority, ds_cstr(&match_s),
+                                 ds_cstr(&actions_s), io_port, ctrl_meter,
+                                 stage_hint, where, NULL);
+        ds_destroy(&match_s);
+        ds_destroy(&actions_s);
+    } else if (lflow->stale) {
+        ovn_lflow_reuse(lflow_table, lflow,
+                        od ? ods_size(od->datapaths) : dp_bitmap_len,
+                        io_port, stage_hint, where);
+    }
 
     if (lflow_ref) {
-        struct lflow_ref_node *lrn =
-            lflow_ref_node_find(&lflow_ref->lflow_ref_nodes, lflow, hash);
-        if (!lrn) {
-            lrn = xzalloc(sizeof *lrn);
-            lrn->lflow = lflow;
-            lrn->lflow_ref = lflow_ref;
-            lrn->dpgrp_lflow = !od;
-            if (lrn->dpgrp_lflow) {
-                lrn->dpgrp_bitmap = bitmap_clone(dp_bitmap, dp_bitmap_len);
-                lrn->dpgrp_bitmap_len = dp_bitmap_len;
-            } else {
-                lrn->dp_index = od->index;
-            }
-            ovs_list_insert(&lflow->referenced_by, &lrn->ref_list_node);
-            hmap_insert(&lflow_ref->lflow_ref_nodes, &lrn->ref_node, hash);
-        }
-
-        if (!lrn->linked) {
-            if (lrn->dpgrp_lflow) {
-                ovs_assert(lrn->dpgrp_bitmap_len == dp_bitmap_len);
-                size_t index;
-                BITMAP_FOR_EACH_1 (index, dp_bitmap_len, dp_bitmap) {
-                    /* Allocate a reference counter only if already used. */
-                    if (bitmap_is_set(lflow->dpg_bitmap, index)) {
-                        dp_refcnt_use(&lflow->dp_refcnts_map, index);
-                    }
-                }
-            } else {
-                /* Allocate a reference counter only if already used. */
-                if (bitmap_is_set(lflow->dpg_bitmap, lrn->dp_index)) {
-                    dp_refcnt_use(&lflow->dp_refcnts_map, lrn->dp_index);
-                }
-            }
-        }
-        lrn->linked = true;
+        lflow_ref_link_lflow(lflow_ref, lflow, hash, od,
+                             dp_bitmap, dp_bitmap_len, NULL);
     }
-
     ovn_dp_group_add_with_reference(lflow, od, dp_bitmap, dp_bitmap_len);
 
     lflow_hash_unlock(hash_lock);
@@ -736,24 +1428,101 @@ lflow_table_add_lflow_default_drop(struct lflow_table *lflow_table,
                           where, lflow_ref);
 }
 
+/* Adds the datapath 'od' to every logical flow referenced by 'src' and
+ * makes 'dst' reference them for 'od', as if each of them had been added
+ * with lflow_table_add_lflow() for 'od' and 'dst'.  This lets a caller
+ * generate a set of flows once and attach them to several datapaths
+ * without formatting and hashing their match and actions again.
+ *
+ * Only the lflows of 'src' that were added for a single datapath, and that
+ * are not parameterized, are considered. */
+void
+lflow_ref_copy_lflows(struct lflow_table *lflow_table,
+                      const struct lflow_ref *src,
+                      const struct ovn_datapath *od,
+                      struct lflow_ref *dst)
+    OVS_EXCLUDED(fake_hash_mutex)
+{
+    struct lflow_ref_node *lrn;
+
+    HMAP_FOR_EACH (lrn, ref_node, &src->lflow_ref_nodes) {
+        if (!lrn->linked || lrn->dpgrp_lflow || lrn->params) {
+            continue;
+        }
+
+        uint32_t hash = lrn->ref_node.hash;
+        struct ovs_mutex *hash_lock =
+            lflow_hash_lock(&lflow_table->entries, hash);
+        lflow_ref_link_lflow(dst, lrn->lflow, hash, od, NULL, 0, NULL);
+        ovn_dp_group_add_with_reference(lrn->lflow, od, NULL, 0);
+        lflow_hash_unlock(hash_lock);
+    }
+}
+
+/* Registry of the datapath groups, see 'struct ovn_dp_group'.
+ *
+ * The 'index' of the datapaths that the group bitmaps refer to are only
+ * valid until the datapaths are rebuilt, see ovn_dp_groups_invalidate(). */
+static struct ovn_dp_groups {
+    struct hmap ls;             /* Groups of logical switches. */
+    struct hmap lr;             /* Groups of logical routers. */
+} dp_groups_registry = {
+    .ls = HMAP_INITIALIZER(&dp_groups_registry.ls),
+    .lr = HMAP_INITIALIZER(&dp_groups_registry.lr),
+};
+
+static struct hmap *
+ovn_dp_groups_for(bool is_switch)
+{
+    return is_switch ? &dp_groups_registry.ls : &dp_groups_registry.lr;
+}
+
+/* Marks all the existing datapath groups as stale, so that they are not
+ * returned by lookups anymore, because the 'index' of the datapaths changed.
+ * The groups are still freed once their users release them, which they
+ * are expected to do when rebuilding their own data. */
+void
+ovn_dp_groups_invalidate(void)
+{
+    struct ovn_dp_group *dpg;
+
+    HMAP_FOR_EACH (dpg, node, &dp_groups_registry.ls) {
+        dpg->stale = true;
+    }
+    HMAP_FOR_EACH (dpg, node, &dp_groups_registry.lr) {
+        dpg->stale = true;
+    }
+}
+
+/* Returns the number of datapath groups of logical switches, if
+ * 'is_switch', or of logical routers, in use. */
+size_t
+ovn_dp_groups_count(bool is_switch)
+{
+    return hmap_count(ovn_dp_groups_for(is_switch));
+}
+
 struct ovn_dp_group *
-ovn_dp_group_get(struct hmap *dp_groups, size_t desired_n,
+ovn_dp_group_get(bool is_switch, size_t desired_n,
                  const unsigned long *desired_bitmap,
                  size_t bitmap_len)
 {
     uint32_t hash;
 
-    hash = hash_int(desired_n, 0);
-    return ovn_dp_group_find(dp_groups, desired_bitmap, bitmap_len, hash);
+    hash = ovn_dp_group_hash(desired_bitmap, bitmap_len, desired_n);
+    return ovn_dp_group_find(ovn_dp_groups_for(is_switch), desired_bitmap,
+                             bitmap_len, hash);
 }
 
-/* Creates a new datapath group and adds it to 'dp_groups'.
+/* Creates a new datapath group and adds it to the registry.
  * If 'sb_group' is provided, function will try to re-use this group by
  * either taking it directly, or by modifying, if it's not already in use.
- * Caller should first call ovn_dp_group_get() before calling this function. */
+ * Caller should first call ovn_dp_group_get() before calling this function.
+ *
+ * The new group has no reference, the caller should take one with
+ * ovn_dp_group_use(). */
 struct ovn_dp_group *
 ovn_dp_group_create(struct ovsdb_idl_txn *ovnsb_txn,
-                    struct hmap *dp_groups,
                     struct sbrec_logical_dp_group *sb_group,
                     size_t desired_n,
                     const unsigned long *desired_bitmap,
@@ -762,6 +1531,7 @@ ovn_dp_group_create(struct ovsdb_idl_txn *ovnsb_txn,
                     const struct ovn_datapaths *ls_datapaths,
                     const struct ovn_datapaths *lr_datapaths)
 {
+    struct hmap *dp_groups = ovn_dp_groups_for(is_switch);
     struct ovn_dp_group *dpg;
 
     bool update_dp_group = false, can_modify = false;
@@ -786,47 +1556,73 @@ ovn_dp_group_create(struct ovsdb_idl_txn *ovnsb_txn,
         /* No group or stale group.  Not going to be used. */
         update_dp_group = true;
         can_modify = true;
-    } else if (!bitmap_equal(dpg_bitmap, desired_bitmap, bitmap_len)) {
+    } else if (n != desired_n
+               || !bitmap_equal(dpg_bitmap, desired_bitmap, bitmap_len)) {
         /* The group in Sb is different. */
         update_dp_group = true;
         /* We can modify existing group if it's not already in use. */
-        can_modify = !ovn_dp_group_find(dp_groups, dpg_bitmap,
-                                        bitmap_len, hash_int(n, 0));
+        can_modify = !ovn_dp_group_find(
+            dp_groups, dpg_bitmap, bitmap_len,
+            ovn_dp_group_hash(dpg_bitmap, bitmap_len, n));
     }
 
     bitmap_free(dpg_bitmap);
 
     dpg = xzalloc(sizeof *dpg);
     dpg->bitmap = bitmap_clone(desired_bitmap, bitmap_len);
+    dpg->n_dps = desired_n;
+    dpg->is_switch = is_switch;
     if (!update_dp_group) {
         dpg->dp_group = sb_group;
     } else {
         dpg->dp_group = ovn_sb_insert_or_update_logical_dp_group(
                             ovnsb_txn,
                             can_modify ? sb_group : NULL,
-                            desired_bitmap,
+                            desired_bitmap, desired_n,
                             is_switch ? ls_datapaths : lr_datapaths);
     }
     dpg->dpg_uuid = dpg->dp_group->header_.uuid;
-    hmap_insert(dp_groups, &dpg->node, hash_int(desired_n, 0));
+    hmap_insert(dp_groups, &dpg->node,
+                ovn_dp_group_hash(desired_bitmap, bitmap_len, desired_n));
 
     return dpg;
 }
 
+/* Updates 'dpg->dp_group' from the SB 'dpgrp_table'.  Returns false if the
+ * SB row doesn't exist anymore, e.g. because it was deleted by the CMS, in
+ * which case 'dpg' is made stale so that its users, on their next sync,
+ * move to a new group. */
+bool
+ovn_dp_group_refresh(struct ovn_dp_group *dpg,
+                     const struct sbrec_logical_dp_group_table *dpgrp_table)
+{
+    dpg->dp_group = sbrec_logical_dp_group_table_get_for_uuid(dpgrp_table,
+                                                              &dpg->dpg_uuid);
+    if (!dpg->dp_group) {
+        dpg->stale = true;
+        return false;
+    }
+    return true;
+}
+
 void
-ovn_dp_groups_clear(struct hmap *dp_groups)
+ovn_dp_group_use(struct ovn_dp_group *dpg)
 {
-    struct ovn_dp_group *dpg;
-    HMAP_FOR_EACH_POP (dpg, node, dp_groups) {
-        ovn_dp_group_destroy(dpg);
+    if (dpg) {
+        dpg->refcnt++;
     }
 }
 
+/* Drops a reference to 'dpg', if nonnull, and frees it with its last
+ * reference.  The SB Logical_DP_Group row is not deleted, it is garbage
+ * collected by the database once no row references it anymore. */
 void
-ovn_dp_groups_destroy(struct hmap *dp_groups)
+ovn_dp_group_release(struct ovn_dp_group *dpg)
 {
-    ovn_dp_groups_clear(dp_groups);
-    hmap_destroy(dp_groups);
+    if (dpg && !--dpg->refcnt) {
+        hmap_remove(ovn_dp_groups_for(dpg->is_switch), &dpg->node);
+        ovn_dp_group_destroy(dpg);
+    }
 }
 
 void
@@ -834,7 +1630,8 @@ lflow_hash_lock_init(void)
 {
     if (!lflow_hash_lock_initialized) {
         for (size_t i = 0; i < LFLOW_HASH_LOCK_MASK + 1; i++) {
-            ovs_mutex_init(&lflow_hash_locks[i]);
+            ovs_mutex_init(&lflow_hash_locks[i].mutex);
+            lflow_hash_locks[i].n_inserted = 0;
         }
         lflow_hash_lock_initialized = true;
     }
@@ -845,7 +1642,7 @@ lflow_hash_lock_destroy(void)
 {
     if (lflow_hash_lock_initialized) {
         for (size_t i = 0; i < LFLOW_HASH_LOCK_MASK + 1; i++) {
-            ovs_mutex_destroy(&lflow_hash_locks[i]);
+            ovs_mutex_destroy(&lflow_hash_locks[i].mutex);
         }
     }
     lflow_hash_lock_initialized = false;
@@ -855,10 +1652,11 @@ lflow_hash_lock_destroy(void)
 static void
 ovn_lflow_init(struct ovn_lflow *lflow, struct ovn_datapath *od,
                size_t dp_bitmap_len, enum ovn_stage stage, uint16_t priority,
-               char *match, char *actions, char *io_port, char *ctrl_meter,
-               char *stage_hint, const char *where)
+               const char *match, const char *actions, const char *io_port,
+               const char *ctrl_meter, char *stage_hint, const char *where,
+               const struct ovn_datapath *params_od)
 {
-    lflow->dpg_bitmap = bitmap_allocate(dp_bitmap_len);
+    ovn_dp_set_init(&lflow->dps, dp_bitmap_len);
     lflow->od = od;
     lflow->stage = stage;
     lflow->priority = priority;
@@ -872,6 +1670,15 @@ ovn_lflow_init(struct ovn_lflow *lflow, struct ovn_datapath *od,
     lflow->sb_uuid = UUID_ZERO;
     hmap_init(&lflow->dp_refcnts_map);
     ovs_list_init(&lflow->referenced_by);
+    lflow->params_od = params_od;
+    lflow->params = NULL;
+    lflow->stale = false;
+}
+
+static struct lflow_hash_lock *
+lflow_hash_lock_get(const struct hmap *lflow_table, uint32_t hash)
+{
+    return &lflow_hash_locks[hash & lflow_table->mask & LFLOW_HASH_LOCK_MASK];
 }
 
 static struct ovs_mutex *
@@ -882,8 +1689,7 @@ lflow_hash_lock(const struct hmap *lflow_table, uint32_t hash)
     struct ovs_mutex *hash_lock = NULL;
 
     if (parallelization_state == STATE_USE_PARALLELIZATION) {
-        hash_lock =
-            &lflow_hash_locks[hash & lflow_table->mask & LFLOW_HASH_LOCK_MASK];
+        hash_lock = &lflow_hash_lock_get(lflow_table, hash)->mutex;
         ovs_mutex_lock(hash_lock);
     }
     return hash_lock;
@@ -902,10 +1708,12 @@ lflow_hash_unlock(struct ovs_mutex *hash_lock)
 static bool
 ovn_lflow_equal(const struct ovn_lflow *a, enum ovn_stage stage,
                 uint16_t priority, const char *match,
-                const char *actions, const char *ctrl_meter)
+                const char *actions, const char *ctrl_meter,
+                const struct ovn_datapath *params_od)
 {
     return (a->stage == stage
             && a->priority == priority
+            && a->params_od == params_od
             && !strcmp(a->match, match)
             && !strcmp(a->actions, actions)
             && nullable_string_is_equal(a->ctrl_meter, ctrl_meter));
@@ -915,12 +1723,36 @@ static struct ovn_lflow *
 ovn_lflow_find(const struct hmap *lflows,
                enum ovn_stage stage, uint16_t priority,
                const char *match, const char *actions,
-               const char *ctrl_meter, uint32_t hash)
+               const char *ctrl_meter, const struct ovn_datapath *params_od,
+               uint32_t hash)
 {
     struct ovn_lflow *lflow;
     HMAP_FOR_EACH_WITH_HASH (lflow, hmap_node, hash, lflows) {
         if (ovn_lflow_equal(lflow, stage, priority, match, actions,
-                            ctrl_meter)) {
+                            ctrl_meter, params_od)) {
+            return lflow;
+        }
+    }
+    return NULL;
+}
+
+/* Same as ovn_lflow_find() for the formatted 'match' and 'actions', for a
+ * logical flow that is not parameterized. */
+static struct ovn_lflow *
+ovn_lflow_find_fmt(const struct hmap *lflows,
+                   enum ovn_stage stage, uint16_t priority,
+                   const struct ovn_fmt *match,
+                   const struct ovn_fmt *actions,
+                   const char *ctrl_meter, uint32_t hash)
+{
+    struct ovn_lflow *lflow;
+    HMAP_FOR_EACH_WITH_HASH (lflow, hmap_node, hash, lflows) {
+        if (lflow->stage == stage
+            && lflow->priority == priority
+            && !lflow->params_od
+            && nullable_string_is_equal(lflow->ctrl_meter, ctrl_meter)
+            && ovn_fmt_equals(match, lflow->match)
+            && ovn_fmt_equals(actions, lflow->actions)) {
             return lflow;
         }
     }
@@ -936,21 +1768,58 @@ ovn_lflow_hint(const struct ovsdb_idl_row *row)
     return xasprintf("%08x", row->uuid.parts[0]);
 }
 
+/* Makes the stale 'lflow', emptied by lflow_table_mark_stale(), look like
+ * it was just created by the rebuild in progress for the given arguments.
+ * Caller must hold the hash lock of 'lflow'. */
+static void
+ovn_lflow_reuse(struct lflow_table *lflow_table, struct ovn_lflow *lflow,
+                size_t dp_bitmap_len, const char *io_port,
+                const struct ovsdb_idl_row *stage_hint, const char *where)
+    OVS_REQUIRES(fake_hash_mutex)
+{
+    COVERAGE_INC(lflow_reuse);
+
+    if (lflow->dps.len != dp_bitmap_len) {
+        ovn_dp_set_destroy(&lflow->dps);
+        ovn_dp_set_init(&lflow->dps, dp_bitmap_len);
+    }
+    if (!nullable_string_is_equal(lflow->io_port, io_port)) {
+        lflow_str_release(lflow_table, lflow->io_port);
+        lflow->io_port = lflow_str_intern(lflow_table, io_port);
+    }
+    free(lflow->stage_hint);
+    lflow->stage_hint = ovn_lflow_hint(stage_hint);
+    lflow->where = where;
+    /* 'od' may point to a datapath that doesn't exist anymore, it is set
+     * again with the datapaths on the next sync. */
+    lflow->od = NULL;
+    lflow->stale = false;
+}
+
 static void
 ovn_lflow_destroy(struct lflow_table *lflow_table, struct ovn_lflow *lflow)
 {
     hmap_remove(&lflow_table->entries, &lflow->hmap_node);
-    bitmap_free(lflow->dpg_bitmap);
-    free(lflow->match);
-    free(lflow->actions);
-    free(lflow->io_port);
+    hmapx_find_and_delete(&lflow_table->pending, lflow);
+    ovn_dp_set_destroy(&lflow->dps);
+    lflow_str_release(lflow_table, lflow->match);
+    lflow_str_release(lflow_table, lflow->actions);
+    lflow_str_release(lflow_table, lflow->io_port);
     free(lflow->stage_hint);
-    free(lflow->ctrl_meter);
+    lflow_str_release(lflow_table, lflow->ctrl_meter);
     ovn_lflow_clear_dp_refcnts_map(lflow);
     struct lflow_ref_node *lrn;
     LIST_FOR_EACH_SAFE (lrn, ref_list_node, &lflow->referenced_by) {
         lflow_ref_node_destroy(lrn);
     }
+    if (lflow->params) {
+        struct lflow_params *params;
+        HMAP_FOR_EACH_POP (params, node, lflow->params) {
+            free(params);
+        }
+        hmap_destroy(lflow->params);
+        free(lflow->params);
+    }
     free(lflow);
 }
 
@@ -960,41 +1829,81 @@ do_ovn_lflow_add(struct lflow_table *lflow_table, size_t dp_bitmap_len,
                  const char *match, const char *actions,
                  const char *io_port, const char *ctrl_meter,
                  const struct ovsdb_idl_row *stage_hint,
-                 const char *where)
+                 const char *where, const struct ovn_datapath *params_od)
     OVS_REQUIRES(fake_hash_mutex)
 {
     struct ovn_lflow *old_lflow;
-    struct ovn_lflow *lflow;
 
     ovs_assert(dp_bitmap_len);
 
     old_lflow = ovn_lflow_find(&lflow_table->entries, stage,
-                               priority, match, actions, ctrl_meter, hash);
+                               priority, match, actions, ctrl_meter,
+                               params_od, hash);
     if (old_lflow) {
+        if (old_lflow->stale) {
+            ovn_lflow_reuse(lflow_table, old_lflow, dp_bitmap_len, io_port,
+                            stage_hint, where);
+        }
         return old_lflow;
     }
 
-    lflow = xzalloc(sizeof *lflow);
+    return ovn_lflow_create(lflow_table, dp_bitmap_len, hash, stage,
+                            priority, match, actions, io_port, ctrl_meter,
+                            stage_hint, where, params_od);
+}
+
+static struct ovn_lflow *
+ovn_lflow_create(struct lflow_table *lflow_table, size_t dp_bitmap_len,
+                 uint32_t hash, enum ovn_stage stage, uint16_t priority,
+                 const char *match, const char *actions,
+                 const char *io_port, const char *ctrl_meter,
+                 const struct ovsdb_idl_row *stage_hint,
+                 const char *where, const struct ovn_datapath *params_od)
+    OVS_REQUIRES(fake_hash_mutex)
+{
+    struct ovn_lflow *lflow = xzalloc(sizeof *lflow);
     /* While adding new logical flows we're not setting single datapath, but
      * collecting a group.  'od' will be updated later for all flows with only
      * one datapath in a group, so it could be hashed correctly. */
     ovn_lflow_init(lflow, NULL, dp_bitmap_len, stage, priority,
-                   xstrdup(match), xstrdup(actions),
-                   io_port ? xstrdup(io_port) : NULL,
-                   nullable_xstrdup(ctrl_meter),
-                   ovn_lflow_hint(stage_hint), where);
+                   lflow_str_intern(lflow_table, match),
+                   lflow_str_intern(lflow_table, actions),
+                   lflow_str_intern(lflow_table, io_port),
+                   lflow_str_intern(lflow_table, ctrl_meter),
+                   ovn_lflow_hint(stage_hint), where, params_od);
 
     if (parallelization_state != STATE_USE_PARALLELIZATION) {
         hmap_insert(&lflow_table->entries, &lflow->hmap_node, hash);
     } else {
-        hmap_insert_fast(&lflow_table->entries, &lflow->hmap_node,
-                         hash);
-        thread_lflow_counter++;
+        parallel_hmap_insert(&lflow_table->entries, &lflow->hmap_node, hash);
+        lflow_hash_lock_get(&lflow_table->entries, hash)->n_inserted++;
     }
 
     return lflow;
 }
 
+/* Sets the 'parameters' of 'sbflow' to the tuples of parameters in use of
+ * 'lflow', a parameterized lflow. */
+static void
+sync_lflow_params_to_sb(const struct ovn_lflow *lflow,
+                        const struct sbrec_logical_flow *sbflow)
+{
+    size_t n_params = lflow->params ? hmap_count(lflow->params) : 0;
+    const char **strs = xmalloc(MAX(n_params, 1) * sizeof *strs);
+    size_t n = 0;
+
+    if (lflow->params) {
+        const struct lflow_params *params;
+        HMAP_FOR_EACH (params, node, lflow->params) {
+            if (params->n_linked) {
+                strs[n++] = params->str;
+            }
+        }
+    }
+    sbrec_logical_flow_set_parameters(sbflow, strs, n);
+    free(strs);
+}
+
 static bool
 sync_lflow_to_sb(struct ovn_lflow *lflow,
                  struct ovsdb_idl_txn *ovnsb_txn,
@@ -1015,23 +1924,21 @@ sync_lflow_to_sb(struct ovn_lflow *lflow,
     if (ovn_stage_to_datapath_type(lflow->stage) == DP_SWITCH) {
         n_datapaths = ods_size(ls_datapaths);
         datapaths_array = ls_datapaths->array;
-        dp_groups = &lflow_table->ls_dp_groups;
         is_switch = true;
     } else {
         n_datapaths = ods_size(lr_datapaths);
         datapaths_array = lr_datapaths->array;
-        dp_groups = &lflow_table->lr_dp_groups;
         is_switch = false;
     }
+    dp_groups = ovn_dp_groups_for(is_switch);
 
-    lflow->n_ods = bitmap_count1(lflow->dpg_bitmap, n_datapaths);
+    lflow->n_ods = lflow->dps.n;
     ovs_assert(lflow->n_ods);
 
     if (lflow->n_ods == 1) {
         /* There is only one datapath, so it should be moved out of the
          * group to a single 'od'. */
-        size_t index = bitmap_scan(lflow->dpg_bitmap, true, 0,
-                                    n_datapaths);
+        size_t index = ovn_dp_set_first(&lflow->dps);
 
         lflow->od = datapaths_array[index];
         lflow->dpg = NULL;
@@ -1040,6 +1947,7 @@ sync_lflow_to_sb(struct ovn_lflow *lflow,
     }
 
     if (!sbflow) {
+        hmapx_find_and_delete(&lflow_table->pending, lflow);
         lflow->sb_uuid = uuid_random();
         sbflow = sbrec_logical_flow_insert_persist_uuid(ovnsb_txn,
                                                         &lflow->sb_uuid);
@@ -1123,21 +2031,19 @@ sync_lflow_to_sb(struct ovn_lflow *lflow,
         }
     }
 
+    if (lflow->params_od) {
+        sync_lflow_params_to_sb(lflow, sbflow);
+    }
+
     if (lflow->od) {
         sbrec_logical_flow_set_logical_datapath(sbflow, lflow->od->sb);
         sbrec_logical_flow_set_logical_dp_group(sbflow, NULL);
     } else {
         sbrec_logical_flow_set_logical_datapath(sbflow, NULL);
-        lflow->dpg = ovn_dp_group_get(dp_groups, lflow->n_ods,
-                                      lflow->dpg_bitmap,
-                                      n_datapaths);
+        lflow->dpg = ovn_dp_group_get_for_set(dp_groups, &lflow->dps);
         if (lflow->dpg) {
             /* Update the dpg's sb dp_group. */
-            lflow->dpg->dp_group = sbrec_logical_dp_group_table_get_for_uuid(
-                sb_dpgrp_table,
-                &lflow->dpg->dpg_uuid);
-
-            if (!lflow->dpg->dp_group) {
+            if (!ovn_dp_group_refresh(lflow->dpg, sb_dpgrp_table)) {
                 /* Ideally this should not happen.  But it can still happen
                  * due to 2 reasons:
                  * 1. There is a bug in the dp_group management.  We should
@@ -1156,15 +2062,27 @@ sync_lflow_to_sb(struct ovn_lflow *lflow,
                             "referencing the dp group ["UUID_FMT"]",
                             UUID_ARGS(&sbflow->header_.uuid),
                             UUID_ARGS(&lflow->dpg->dpg_uuid));
+                lflow->dpg = pre_sync_dpg;
                 return false;
             }
         } else {
+            unsigned long *dpg_bitmap = lflow->dps.bitmap;
+
+            if (!dpg_bitmap) {
+                dpg_bitmap = bitmap_allocate(n_datapaths);
+                for (size_t i = 0; i < lflow->dps.n; i++) {
+                    bitmap_set1(dpg_bitmap, lflow->dps.indexes[i]);
+                }
+            }
             lflow->dpg = ovn_dp_group_create(
-                                ovnsb_txn, dp_groups, sbrec_dp_group,
-                                lflow->n_ods, lflow->dpg_bitmap,
+                                ovnsb_txn, sbrec_dp_group,
+                                lflow->n_ods, dpg_bitmap,
                                 n_datapaths, is_switch,
                                 ls_datapaths,
                                 lr_datapaths);
+            if (dpg_bitmap != lflow->dps.bitmap) {
+                bitmap_free(dpg_bitmap);
+            }
         }
         sbrec_logical_flow_set_logical_dp_group(sbflow,
                                                 lflow->dpg->dp_group);
@@ -1172,42 +2090,102 @@ sync_lflow_to_sb(struct ovn_lflow *lflow,
 
     if (pre_sync_dpg != lflow->dpg) {
         ovn_dp_group_use(lflow->dpg);
-        ovn_dp_group_release(dp_groups, pre_sync_dpg);
+        ovn_dp_group_release(pre_sync_dpg);
     }
 
     return true;
 }
 
+/* Returns the hash of the datapath group 'bitmap' with 'n' datapaths out of
+ * 'len'.  Only the nonzero words contribute to the hash, so that it can be
+ * computed from a sparse 'struct ovn_dp_set' as well. */
+static uint32_t
+ovn_dp_group_hash(const unsigned long *bitmap, size_t len, size_t n)
+{
+    uint32_t hash = 0;
+
+    for (size_t i = 0; i < bitmap_n_longs(len); i++) {
+        if (bitmap[i]) {
+            hash = hash_add(hash, i);
+            hash = hash_add64(hash, bitmap[i]);
+        }
+    }
+    return hash_finish(hash, n);
+}
+
+/* Same as ovn_dp_group_hash() for the bitmap representation of 'dps'. */
+static uint32_t
+ovn_dp_set_hash(const struct ovn_dp_set *dps)
+{
+    if (dps->bitmap) {
+        return ovn_dp_group_hash(dps->bitmap, dps->len, dps->n);
+    }
+
+    uint32_t hash = 0;
+    unsigned long word = 0;
+    size_t word_idx = 0;
+
+    for (size_t i = 0; i < dps->n; i++) {
+        size_t idx = dps->indexes[i] / BITMAP_ULONG_BITS;
+
+        if (word && idx != word_idx) {
+            hash = hash_add(hash, word_idx);
+            hash = hash_add64(hash, word);
+            word = 0;
+        }
+        word_idx = idx;
+        word |= 1UL << (dps->indexes[i] % BITMAP_ULONG_BITS);
+    }
+    if (word) {
+        hash = hash_add(hash, word_idx);
+        hash = hash_add64(hash, word);
+    }
+    return hash_finish(hash, dps->n);
+}
+
 static struct ovn_dp_group *
-ovn_dp_group_find(const struct hmap *dp_groups,
-                  const unsigned long *dpg_bitmap, size_t bitmap_len,
-                  uint32_t hash)
+ovn_dp_group_get_for_set(const struct hmap *dp_groups,
+                         const struct ovn_dp_set *dps)
 {
     struct ovn_dp_group *dpg;
 
-    HMAP_FOR_EACH_WITH_HASH (dpg, node, hash, dp_groups) {
-        if (bitmap_equal(dpg->bitmap, dpg_bitmap, bitmap_len)) {
+    HMAP_FOR_EACH_WITH_HASH (dpg, node, ovn_dp_set_hash(dps), dp_groups) {
+        if (dpg->stale || dpg->n_dps != dps->n) {
+            continue;
+        }
+        if (dps->bitmap) {
+            if (bitmap_equal(dpg->bitmap, dps->bitmap, dps->len)) {
+                return dpg;
+            }
+            continue;
+        }
+
+        size_t i;
+        for (i = 0; i < dps->n; i++) {
+            if (!bitmap_is_set(dpg->bitmap, dps->indexes[i])) {
+                break;
+            }
+        }
+        if (i == dps->n) {
             return dpg;
         }
     }
     return NULL;
 }
 
-static void
-ovn_dp_group_use(struct ovn_dp_group *dpg)
+static struct ovn_dp_group *
+ovn_dp_group_find(const struct hmap *dp_groups,
+                  const unsigned long *dpg_bitmap, size_t bitmap_len,
+                  uint32_t hash)
 {
-    if (dpg) {
-        dpg->refcnt++;
-    }
-}
+    struct ovn_dp_group *dpg;
 
-static void
-ovn_dp_group_release(struct hmap *dp_groups, struct ovn_dp_group *dpg)
-{
-    if (dpg && !--dpg->refcnt) {
-        hmap_remove(dp_groups, &dpg->node);
-        ovn_dp_group_destroy(dpg);
+    HMAP_FOR_EACH_WITH_HASH (dpg, node, hash, dp_groups) {
+        if (!dpg->stale && bitmap_equal(dpg->bitmap, dpg_bitmap, bitmap_len)) {
+            return dpg;
+        }
     }
+    return NULL;
 }
 
 /* Destroys the ovn_dp_group and frees the memory.
@@ -1224,14 +2202,17 @@ static struct sbrec_logical_dp_group *
 ovn_sb_insert_or_update_logical_dp_group(
                             struct ovsdb_idl_txn *ovnsb_txn,
                             struct sbrec_logical_dp_group *dp_group,
-                            const unsigned long *dpg_bitmap,
+                            const unsigned long *dpg_bitmap, size_t n_dps,
                             const struct ovn_datapaths *datapaths)
 {
     const struct sbrec_datapath_binding **sb;
     size_t n = 0, index;
 
-    sb = xmalloc(bitmap_count1(dpg_bitmap, ods_size(datapaths)) * sizeof *sb);
+    sb = xmalloc(n_dps * sizeof *sb);
     BITMAP_FOR_EACH_1 (index, ods_size(datapaths), dpg_bitmap) {
+        if (n == n_dps) {
+            break;
+        }
         sb[n++] = datapaths->array[index]->sb;
     }
     if (!dp_group) {
@@ -1257,10 +2238,14 @@ ovn_dp_group_add_with_reference(struct ovn_lflow *lflow_ref,
     OVS_REQUIRES(fake_hash_mutex)
 {
     if (od) {
-        bitmap_set1(lflow_ref->dpg_bitmap, od->index);
+        ovn_dp_set_add(&lflow_ref->dps, od->index);
     }
     if (dp_bitmap) {
-        bitmap_or(lflow_ref->dpg_bitmap, dp_bitmap, bitmap_len);
+        size_t index;
+
+        BITMAP_FOR_EACH_1 (index, bitmap_len, dp_bitmap) {
+            ovn_dp_set_add(&lflow_ref->dps, index);
+        }
     }
 }
 
@@ -1282,17 +2267,7 @@ lflow_ref_sync_lflows__(struct lflow_ref  *lflow_ref,
             sbrec_logical_flow_table_get_for_uuid(sbflow_table,
                                                   &lflow->sb_uuid);
 
-        struct hmap *dp_groups = NULL;
-        size_t n_datapaths;
-        if (ovn_stage_to_datapath_type(lflow->stage) == DP_SWITCH) {
-            dp_groups = &lflow_table->ls_dp_groups;
-            n_datapaths = ods_size(ls_datapaths);
-        } else {
-            dp_groups = &lflow_table->lr_dp_groups;
-            n_datapaths = ods_size(lr_datapaths);
-        }
-
-        size_t n_ods = bitmap_count1(lflow->dpg_bitmap, n_datapaths);
+        size_t n_ods = lflow->dps.n;
 
         if (n_ods) {
             if (!sync_lflow_to_sb(lflow, ovnsb_txn, lflow_table, ls_datapaths,
@@ -1306,7 +2281,7 @@ lflow_ref_sync_lflows__(struct lflow_ref  *lflow_ref,
             lflow_ref_node_destroy(lrn);
 
             if (ovs_list_is_empty(&lflow->referenced_by)) {
-                ovn_dp_group_release(dp_groups, lflow->dpg);
+                ovn_dp_group_release(lflow->dpg);
                 ovn_lflow_destroy(lflow_table, lflow);
                 if (sblflow) {
                     sbrec_logical_flow_delete(sblflow);
@@ -1396,11 +2371,11 @@ ovn_lflow_clear_dp_refcnts_map(struct ovn_lflow *lflow)
 
 static struct lflow_ref_node *
 lflow_ref_node_find(struct hmap *lflow_ref_nodes, struct ovn_lflow *lflow,
-                    uint32_t lflow_hash)
+                    const struct lflow_params *params, uint32_t lflow_hash)
 {
     struct lflow_ref_node *lrn;
     HMAP_FOR_EACH_WITH_HASH (lrn, ref_node, lflow_hash, lflow_ref_nodes) {
-        if (lrn->lflow == lflow) {
+        if (lrn->lflow == lflow && lrn->params == params) {
             return lrn;
         }
     }
@@ -1416,5 +2391,144 @@ lflow_ref_node_destroy(struct lflow_ref_node *lrn)
     if (lrn->dpgrp_lflow) {
         bitmap_free(lrn->dpgrp_bitmap);
     }
+
+    struct lflow_params *params = lrn->params;
+    if (params) {
+        params->n_linked -= lrn->linked;
+        if (!--params->n_refs && !params->n_linked) {
+            hmap_remove(lrn->lflow->params, &params->node);
+            free(params);
+        }
+    }
     free(lrn);
 }
+
+static void
+ovn_dp_set_init(struct ovn_dp_set *dps, size_t len)
+{
+    *dps = (struct ovn_dp_set) {
+        .len = len,
+    };
+}
+
+/* Removes all the datapaths from 'dps', keeping its memory, so that it can
+ * be filled again. */
+static void
+ovn_dp_set_clear(struct ovn_dp_set *dps)
+{
+    if (dps->bitmap) {
+        memset(dps->bitmap, 0, bitmap_n_bytes(dps->len));
+    }
+    dps->n = 0;
+}
+
+static void
+ovn_dp_set_destroy(struct ovn_dp_set *dps)
+{
+    bitmap_free(dps->bitmap);
+    free(dps->indexes);
+}
+
+/* Returns the position of 'index' in the sparse 'dps' or the position at
+ * which it would have to be inserted.  Sets '*found' accordingly. */
+static size_t
+ovn_dp_set_find__(const struct ovn_dp_set *dps, size_t index, bool *found)
+{
+    size_t lo = 0, hi = dps->n;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (dps->indexes[mid] < index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = lo < dps->n && dps->indexes[lo] == index;
+    return lo;
+}
+
+static bool
+ovn_dp_set_contains(const struct ovn_dp_set *dps, size_t index)
+{
+    bool found;
+
+    if (dps->bitmap) {
+        return bitmap_is_set(dps->bitmap, index);
+    }
+    ovn_dp_set_find__(dps, index, &found);
+    return found;
+}
+
+static void
+ovn_dp_set_add(struct ovn_dp_set *dps, size_t index)
+{
+    if (dps->bitmap) {
+        if (!bitmap_is_set(dps->bitmap, index)) {
+            bitmap_set1(dps->bitmap, index);
+            dps->n++;
+        }
+        return;
+    }
+
+    bool found;
+    size_t pos = ovn_dp_set_find__(dps, index, &found);
+    if (found) {
+        return;
+    }
+
+    if ((dps->n + 1) * sizeof *dps->indexes > bitmap_n_bytes(dps->len)) {
+        /* The array would be bigger than a bitmap, switch to a bitmap. */
+        dps->bitmap = bitmap_allocate(dps->len);
+        for (size_t i = 0; i < dps->n; i++) {
+            bitmap_set1(dps->bitmap, dps->indexes[i]);
+        }
+        free(dps->indexes);
+        dps->indexes = NULL;
+        dps->allocated = 0;
+
+        bitmap_set1(dps->bitmap, index);
+        dps->n++;
+        return;
+    }
+
+    if (dps->n == dps->allocated) {
+        dps->indexes = x2nrealloc(dps->indexes, &dps->allocated,
+                                  sizeof *dps->indexes);
+    }
+    memmove(&dps->indexes[pos + 1], &dps->indexes[pos],
+            (dps->n - pos) * sizeof *dps->indexes);
+    dps->indexes[pos] = index;
+    dps->n++;
+}
+
+static void
+ovn_dp_set_remove(struct ovn_dp_set *dps, size_t index)
+{
+    if (dps->bitmap) {
+        if (bitmap_is_set(dps->bitmap, index)) {
+            bitmap_set0(dps->bitmap, index);
+            dps->n--;
+        }
+        return;
+    }
+
+    bool found;
+    size_t pos = ovn_dp_set_find__(dps, index, &found);
+    if (found) {
+        memmove(&dps->indexes[pos], &dps->indexes[pos + 1],
+                (dps->n - pos - 1) * sizeof *dps->indexes);
+        dps->n--;
+    }
+}
+
+/* Returns the lowest datapath index in 'dps', which must not be empty. */
+static size_t
+ovn_dp_set_first(const struct ovn_dp_set *dps)
+{
+    ovs_assert(dps->n);
+    return (dps->bitmap
+            ? bitmap_scan(dps->bitmap, true, 0, dps->len)
+            : dps->indexes[0]);
+}
@@ -21,25 +21,43 @@
 
 #include "northd.h"
 
+struct ds;
 struct ovsdb_idl_txn;
 struct ovn_datapath;
 struct ovsdb_idl_row;
+struct simap;
+struct worker_pool;
 
 /* lflow map which stores the logical flows. */
 struct lflow_table;
 struct lflow_table *lflow_table_alloc(void);
 void lflow_table_init(struct lflow_table *);
 void lflow_table_clear(struct lflow_table *);
+void lflow_table_mark_stale(struct lflow_table *);
+void lflow_table_sweep_stale(struct lflow_table *);
 void lflow_table_destroy(struct lflow_table *);
 void lflow_table_expand(struct lflow_table *);
-void lflow_table_set_size(struct lflow_table *, size_t);
+void lflow_table_fix_size(struct lflow_table *);
+size_t lflow_table_size(const struct lflow_table *);
+void lflow_table_get_memory_usage(const struct lflow_table *,
+                                  struct simap *usage);
+void lflow_table_format_stage_stats(const struct lflow_table *,
+                                    struct ds *);
 void lflow_table_sync_to_sb(struct lflow_table *,
                             struct ovsdb_idl_txn *ovnsb_txn,
                             const struct ovn_datapaths *ls_datapaths,
                             const struct ovn_datapaths *lr_datapaths,
                             bool ovn_internal_version_changed,
                             const struct sbrec_logical_flow_table *,
-                            const struct sbrec_logical_dp_group_table *);
+                            const struct sbrec_logical_dp_group_table *,
+                            struct worker_pool *, size_t max_inserts);
+size_t lflow_table_sync_pending(struct lflow_table *,
+                                struct ovsdb_idl_txn *ovnsb_txn,
+                                const struct ovn_datapaths *ls_datapaths,
+                                const struct ovn_datapaths *lr_datapaths,
+                                const struct sbrec_logical_dp_group_table *,
+                                size_t max_inserts);
+bool lflow_table_has_pending(const struct lflow_table *);
 void lflow_table_destroy(struct lflow_table *);
 
 void lflow_hash_lock_init(void);
@@ -79,11 +97,33 @@ void lflow_table_add_lflow(struct lflow_table *, const struct ovn_datapath *,
                            const char *ctrl_meter,
                            const struct ovsdb_idl_row *stage_hint,
                            const char *where, struct lflow_ref *);
+void lflow_table_add_lflow_with_params(struct lflow_table *,
+                                       const struct ovn_datapath *,
+                                       enum ovn_stage stage,
+                                       uint16_t priority, const char *match,
+                                       const char *actions,
+                                       const char *params,
+                                       const struct ovsdb_idl_row *stage_hint,
+                                       const char *where,
+                                       struct lflow_ref *);
+void lflow_table_add_lflow_fmt(struct lflow_table *,
+                               const struct ovn_datapath *,
+                               const unsigned long *dp_bitmap,
+                               size_t dp_bitmap_len, enum ovn_stage stage,
+                               uint16_t priority,
+                               const struct ovn_fmt *match,
+                               const struct ovn_fmt *actions,
+                               const char *io_port, const char *ctrl_meter,
+                               const struct ovsdb_idl_row *stage_hint,
+                               const char *where, struct lflow_ref *);
 void lflow_table_add_lflow_default_drop(struct lflow_table *,
                                         const struct ovn_datapath *,
                                         enum ovn_stage stage,
                                         const char *where,
                                         struct lflow_ref *);
+void lflow_ref_copy_lflows(struct lflow_table *, const struct lflow_ref *src,
+                           const struct ovn_datapath *,
+                           struct lflow_ref *dst);
 
 /* Adds a row with the specified contents to the Logical_Flow table. */
 #define ovn_lflow_add_with_hint__(LFLOW_TABLE, OD, STAGE, PRIORITY, MATCH, \
@@ -106,6 +146,25 @@ void lflow_table_add_lflow_default_drop(struct lflow_table *,
                           PRIORITY, MATCH, ACTIONS, NULL, NULL, STAGE_HINT, \
                           OVS_SOURCE_LOCATOR, LFLOW_REF)
 
+/* Adds a parameterized logical flow, whose MATCH and ACTIONS refer to
+ * template variables, e.g. "^mac", with the tuple of parameters PARAMS,
+ * e.g. "mac=00:00:00:00:00:01".  See lflow_table_add_lflow_with_params(). */
+#define ovn_lflow_add_with_params(LFLOW_TABLE, OD, STAGE, PRIORITY, MATCH, \
+                                  ACTIONS, PARAMS, STAGE_HINT, LFLOW_REF) \
+    lflow_table_add_lflow_with_params(LFLOW_TABLE, OD, STAGE, PRIORITY, \
+                                      MATCH, ACTIONS, PARAMS, STAGE_HINT, \
+                                      OVS_SOURCE_LOCATOR, LFLOW_REF)
+
+/* Same as ovn_lflow_add_with_lport_and_hint() for a MATCH and ACTIONS that
+ * are struct ovn_fmt, e.g. OVN_FMT("eth.dst == %s", ea_s), which are only
+ * formatted if the logical flow doesn't exist yet.  IN_OUT_PORT may be
+ * NULL. */
+#define ovn_lflow_add_fmt(LFLOW_TABLE, OD, STAGE, PRIORITY, MATCH, ACTIONS, \
+                          IN_OUT_PORT, STAGE_HINT, LFLOW_REF) \
+    lflow_table_add_lflow_fmt(LFLOW_TABLE, OD, NULL, 0, STAGE, PRIORITY, \
+                              &(MATCH), &(ACTIONS), IN_OUT_PORT, NULL, \
+                              STAGE_HINT, OVS_SOURCE_LOCATOR, LFLOW_REF)
+
 #define ovn_lflow_add_default_drop(LFLOW_TABLE, OD, STAGE, LFLOW_REF)   \
     lflow_table_add_lflow_default_drop(LFLOW_TABLE, OD, STAGE, \
                                        OVS_SOURCE_LOCATOR, LFLOW_REF)
@@ -141,49 +200,42 @@ void lflow_table_add_lflow_default_drop(struct lflow_table *,
 
 struct sbrec_logical_dp_group;
 
+/* Datapath groups.
+ *
+ * A datapath group maps a set of datapaths, by their 'index', to a SB
+ * Logical_DP_Group row.  The groups are kept in a registry shared by the
+ * logical flows and the load balancers, so that all the users of the same
+ * set of logical switches or logical routers reference a single SB row.
+ * Each user takes a reference with ovn_dp_group_use() and drops it with
+ * ovn_dp_group_release(), the group is freed with its last reference. */
 struct ovn_dp_group {
     unsigned long *bitmap;
+    size_t n_dps;               /* Number of 1-bits in 'bitmap'. */
     const struct sbrec_logical_dp_group *dp_group;
     struct uuid dpg_uuid;
     struct hmap_node node;
     size_t refcnt;
+    bool is_switch;             /* Group of logical switches or routers. */
+    bool stale;                 /* Not returned by lookups anymore. */
 };
 
-static inline void
-ovn_dp_groups_init(struct hmap *dp_groups)
-{
-    hmap_init(dp_groups);
-}
+struct sbrec_logical_dp_group_table;
 
-void ovn_dp_groups_clear(struct hmap *dp_groups);
-void ovn_dp_groups_destroy(struct hmap *dp_groups);
-struct ovn_dp_group *ovn_dp_group_get(struct hmap *dp_groups, size_t desired_n,
+void ovn_dp_groups_invalidate(void);
+size_t ovn_dp_groups_count(bool is_switch);
+struct ovn_dp_group *ovn_dp_group_get(bool is_switch, size_t desired_n,
                                       const unsigned long *desired_bitmap,
                                       size_t bitmap_len);
 struct ovn_dp_group *ovn_dp_group_create(
-    struct ovsdb_idl_txn *ovnsb_txn, struct hmap *dp_groups,
+    struct ovsdb_idl_txn *ovnsb_txn,
     struct sbrec_logical_dp_group *sb_group,
     size_t desired_n, const unsigned long *desired_bitmap,
     size_t bitmap_len, bool is_switch,
     const struct ovn_datapaths *ls_datapaths,
     const struct ovn_datapaths *lr_datapaths);
-
-static inline void
-inc_ovn_dp_group_ref(struct ovn_dp_group *dpg)
-{
-    dpg->refcnt++;
-}
-
-static inline void
-dec_ovn_dp_group_ref(struct hmap *dp_groups, struct ovn_dp_group *dpg)
-{
-    dpg->refcnt--;
-
-    if (!dpg->refcnt) {
-        hmap_remove(dp_groups, &dpg->node);
-        free(dpg->bitmap);
-        free(dpg);
-    }
-}
+bool ovn_dp_group_refresh(struct ovn_dp_group *,
+                          const struct sbrec_logical_dp_group_table *);
+void ovn_dp_group_use(struct ovn_dp_group *);
+void ovn_dp_group_release(struct ovn_dp_group *);
 
 #endif /* LFLOW_MGR_H */
\ No newline at end of file
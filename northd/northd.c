@@ -36,6 +36,8 @@
 #include "lib/ip-mcast-index.h"
 #include "lib/static-mac-binding-index.h"
 #include "lib/copp.h"
+#include "lib/hbitmap.h"
+#include "lib/inc-proc-eng.h"
 #include "lib/mcast-group-index.h"
 #include "lib/ovn-l7.h"
 #include "lib/ovn-nb-idl.h"
@@ -70,6 +72,9 @@
 
 VLOG_DEFINE_THIS_MODULE(northd);
 
+COVERAGE_DEFINE(lflow_build_work_steal);
+COVERAGE_DEFINE(northd_prep_parallel);
+
 static bool controller_event_en;
 
 
@@ -80,6 +85,16 @@ static bool install_ls_lb_from_router;
 /* Use common zone for SNAT and DNAT if this option is set to "true". */
 static bool use_common_zone = false;
 
+/* If this option is 'true' the logical switches forward the ARP requests
+ * and IPv6 NS for the NAT external IPs of the connected routers with flows
+ * matching on per router address sets, instead of a flow per IP. */
+static bool use_nat_address_sets;
+
+/* If this option is 'true' the logical switches' L2 unicast lookup flows of
+ * the ports are generated as a parameterized logical flow per switch, with
+ * a tuple of parameters per MAC address, instead of a flow per MAC. */
+static bool use_lflow_parameters;
+
 /* If this option is 'true' northd will make use of ct.inv match fields.
  * Otherwise, it will avoid using it.  The default is true. */
 static bool use_ct_inv_match = true;
@@ -123,6 +138,7 @@ static bool vxlan_mode;
 #define REGBIT_ACL_STATELESS      "reg0[16]"
 #define REGBIT_ACL_HINT_ALLOW_REL "reg0[17]"
 #define REGBIT_FROM_ROUTER_PORT   "reg0[18]"
+#define REGBIT_ARP_ND_RSP_LOOKUP  "reg0[19]"
 
 #define REG_ORIG_DIP_IPV4         "reg1"
 #define REG_ORIG_DIP_IPV6         "xxreg1"
@@ -209,6 +225,7 @@ static bool vxlan_mode;
  * |    |     REGBIT_{HAIRPIN/HAIRPIN_REPLY}           |   |                                   |
  * |    | REGBIT_ACL_HINT_{ALLOW_NEW/ALLOW/DROP/BLOCK} |   |                                   |
  * |    |     REGBIT_ACL_{LABEL/STATELESS}             | X |                                   |
+ * |    |     REGBIT_ARP_ND_RSP_LOOKUP                 | X |                                   |
  * +----+----------------------------------------------+ X |                                   |
  * | R5 |                   UNUSED                     | X |       LB_L2_AFF_BACKEND_IP6       |
  * | R1 |         ORIG_DIP_IPV4 (>= IN_PRE_STATEFUL)   | R |                                   |
@@ -425,6 +442,93 @@ struct lrouter_group {
     struct hmapx tmp_ha_ref_chassis;
 };
 
+/* Returns the lflow reference of the routing policy identified by 'key' in
+ * 'od', creating it if it doesn't exist yet.  Takes ownership of 'key'. */
+static struct lr_policy_lflow_ref *
+ovn_datapath_add_policy_lflow_ref(struct ovn_datapath *od, char *key)
+{
+    struct lr_policy_lflow_ref *policy_ref;
+    uint32_t hash = hash_string(key, 0);
+
+    HMAP_FOR_EACH_WITH_HASH (policy_ref, hmap_node, hash,
+                             &od->policy_lflow_refs) {
+        if (!strcmp(policy_ref->key, key)) {
+            free(key);
+            return policy_ref;
+        }
+    }
+
+    policy_ref = xzalloc(sizeof *policy_ref);
+    policy_ref->key = key;
+    policy_ref->lflow_ref = lflow_ref_create();
+    policy_ref->rebuilt = true;
+    hmap_insert(&od->policy_lflow_refs, &policy_ref->hmap_node, hash);
+
+    return policy_ref;
+}
+
+static void
+ovn_datapath_remove_policy_lflow_ref(struct ovn_datapath *od,
+                                     struct lr_policy_lflow_ref *policy_ref)
+{
+    hmap_remove(&od->policy_lflow_refs, &policy_ref->hmap_node);
+    lflow_ref_destroy(policy_ref->lflow_ref);
+    free(policy_ref->key);
+    free(policy_ref);
+}
+
+static void
+ovn_datapath_clear_policy_lflow_refs(struct ovn_datapath *od)
+{
+    struct lr_policy_lflow_ref *policy_ref;
+    HMAP_FOR_EACH_SAFE (policy_ref, hmap_node, &od->policy_lflow_refs) {
+        ovn_datapath_remove_policy_lflow_ref(od, policy_ref);
+    }
+}
+
+/* Returns the lflow reference of the QoS rule identified by 'key' in 'od',
+ * creating it if it doesn't exist yet.  Takes ownership of 'key'. */
+static struct ls_qos_lflow_ref *
+ovn_datapath_add_qos_lflow_ref(struct ovn_datapath *od, char *key)
+{
+    struct ls_qos_lflow_ref *qos_ref;
+    uint32_t hash = hash_string(key, 0);
+
+    HMAP_FOR_EACH_WITH_HASH (qos_ref, hmap_node, hash, &od->qos_lflow_refs) {
+        if (!strcmp(qos_ref->key, key)) {
+            free(key);
+            return qos_ref;
+        }
+    }
+
+    qos_ref = xzalloc(sizeof *qos_ref);
+    qos_ref->key = key;
+    qos_ref->lflow_ref = lflow_ref_create();
+    qos_ref->rebuilt = true;
+    hmap_insert(&od->qos_lflow_refs, &qos_ref->hmap_node, hash);
+
+    return qos_ref;
+}
+
+static void
+ovn_datapath_remove_qos_lflow_ref(struct ovn_datapath *od,
+                                  struct ls_qos_lflow_ref *qos_ref)
+{
+    hmap_remove(&od->qos_lflow_refs, &qos_ref->hmap_node);
+    lflow_ref_destroy(qos_ref->lflow_ref);
+    free(qos_ref->key);
+    free(qos_ref);
+}
+
+static void
+ovn_datapath_clear_qos_lflow_refs(struct ovn_datapath *od)
+{
+    struct ls_qos_lflow_ref *qos_ref;
+    HMAP_FOR_EACH_SAFE (qos_ref, hmap_node, &od->qos_lflow_refs) {
+        ovn_datapath_remove_qos_lflow_ref(od, qos_ref);
+    }
+}
+
 static struct ovn_datapath *
 ovn_datapath_create(struct hmap *datapaths, const struct uuid *key,
                     const struct nbrec_logical_switch *nbs,
@@ -436,12 +540,17 @@ ovn_datapath_create(struct hmap *datapaths, const struct uuid *key,
     od->sb = sb;
     od->nbs = nbs;
     od->nbr = nbr;
-    hmap_init(&od->port_tnlids);
+    ovn_tnlids_init(&od->port_tnlids, 1, (1u << 15) - 1);
     od->port_key_hint = 0;
     hmap_insert(datapaths, &od->key_node, uuid_hash(&od->key));
     od->lr_group = NULL;
     hmap_init(&od->ports);
     sset_init(&od->router_ips);
+    od->route_lflow_ref = lflow_ref_create();
+    hmap_init(&od->policy_lflow_refs);
+    hmap_init(&od->qos_lflow_refs);
+    smap_init(&od->ls_config);
+    od->datapath_lflow_ref = lflow_ref_create();
     return od;
 }
 
@@ -471,6 +580,13 @@ ovn_datapath_destroy(struct hmap *datapaths, struct ovn_datapath *od)
         destroy_mcast_info_for_datapath(od);
         destroy_ports_for_datapath(od);
         sset_destroy(&od->router_ips);
+        lflow_ref_destroy(od->route_lflow_ref);
+        ovn_datapath_clear_policy_lflow_refs(od);
+        hmap_destroy(&od->policy_lflow_refs);
+        ovn_datapath_clear_qos_lflow_refs(od);
+        hmap_destroy(&od->qos_lflow_refs);
+        smap_destroy(&od->ls_config);
+        lflow_ref_destroy(od->datapath_lflow_ref);
         free(od);
     }
 }
@@ -575,6 +691,54 @@ init_ipam_info_for_datapath(struct ovn_datapath *od)
     init_ipam_info(&od->ipam_info, &od->nbs->other_config, uuid_s);
 }
 
+/* Keys of the other_config of a logical switch whose changes are handled
+ * incrementally, see ls_handle_other_config_changes().  They affect only
+ * the logical flows of the switch itself and its SB IP_Multicast record. */
+static const char *ls_config_incremental_keys[] = {
+    "broadcast-arps-to-all-routers",
+    "mcast_flood_unregistered",
+    "mcast_querier",
+    "mcast_idle_timeout",
+    "mcast_query_interval",
+    "mcast_query_max_response",
+    "mcast_eth_src",
+    "mcast_ip4_src",
+    "mcast_ip6_src",
+};
+
+/* Initializes 'ls_config' with the other_config of 'nbs', except the keys
+ * in ls_config_incremental_keys[]. */
+static void
+ls_config_init(struct smap *ls_config, const struct nbrec_logical_switch *nbs)
+{
+    struct smap_node *node;
+
+    smap_init(ls_config);
+    SMAP_FOR_EACH (node, &nbs->other_config) {
+        size_t i;
+
+        for (i = 0; i < ARRAY_SIZE(ls_config_incremental_keys); i++) {
+            if (!strcmp(node->key, ls_config_incremental_keys[i])) {
+                break;
+            }
+        }
+        if (i == ARRAY_SIZE(ls_config_incremental_keys)) {
+            smap_add(ls_config, node->key, node->value);
+        }
+    }
+}
+
+static void
+init_ls_config_for_datapath(struct ovn_datapath *od)
+{
+    if (!od->nbs) {
+        return;
+    }
+
+    smap_destroy(&od->ls_config);
+    ls_config_init(&od->ls_config, od->nbs);
+}
+
 static void
 init_mcast_info_for_router_datapath(struct ovn_datapath *od)
 {
@@ -650,7 +814,8 @@ init_mcast_info_for_datapath(struct ovn_datapath *od)
         return;
     }
 
-    hmap_init(&od->mcast_info.group_tnlids);
+    ovn_tnlids_init(&od->mcast_info.group_tnlids, OVN_MIN_IP_MULTICAST,
+                    OVN_MAX_IP_MULTICAST);
     /* allocations start from hint + 1 */
     od->mcast_info.group_tnlid_hint = OVN_MIN_IP_MULTICAST - 1;
     ovs_list_init(&od->mcast_info.groups);
@@ -789,6 +954,210 @@ ovn_datapath_update_external_ids(struct ovn_datapath *od)
     smap_destroy(&ids);
 }
 
+static struct worker_pool *build_lflows_pool = NULL;
+
+/* Parallel preparation of datapaths and ports.
+ *
+ * On a full recompute, parsing the northbound configuration of every
+ * datapath and port takes about as long as everything else that is done
+ * before logical flow generation.  That parsing only touches the object
+ * being parsed, so it is spread over the lflow build worker pool in chunks
+ * of NORTHD_PREP_CHUNK objects, while the joins with the southbound
+ * database, key allocation and all the southbound updates stay on the main
+ * thread.  The en_port_group, en_ls_stateful and en_lr_stateful nodes build
+ * their per port group and per datapath records the same way. */
+#define NORTHD_PREP_CHUNK 256
+
+static struct work_queue northd_prep_wq;
+
+/* Adaptive parallelization.
+ *
+ * Running a phase on the worker pool has a fixed cost, for waking up the
+ * workers and merging what they did, which exceeds the gain for small
+ * inputs.  So, with the default adaptive policy, each phase is parallelized
+ * depending on the size of its input: it runs on the main thread below a
+ * minimum size, and above it on whichever of the main thread and the pool
+ * has the lowest average time per input item so far.  One run out of
+ * NORTHD_PAR_PROBE_INTERVAL takes the other decision, so that both averages
+ * follow the changes of the workload.
+ *
+ * The decisions are reported by "parallel-build/show-stats". */
+#define NORTHD_PAR_PROBE_INTERVAL 16
+#define NORTHD_PAR_MIN_SIZE 512
+
+struct northd_par_stats {
+    size_t min_size;
+
+    /* Indexed by whether the phase ran on the pool. */
+    double nsec_per_item[2];    /* Exponential moving average. */
+    unsigned long long int n_runs[2];
+
+    unsigned int n_decisions;
+    size_t last_size;
+    bool last_parallel;
+    long long int last_usec;
+};
+
+static bool northd_par_adaptive = true;
+static struct shash northd_par_phases = SHASH_INITIALIZER(&northd_par_phases);
+
+static struct northd_par_stats *
+northd_par_stats_get(const char *phase, size_t min_size)
+{
+    struct northd_par_stats *stats = shash_find_data(&northd_par_phases,
+                                                     phase);
+    if (!stats) {
+        stats = xzalloc(sizeof *stats);
+        stats->min_size = min_size;
+        shash_add(&northd_par_phases, phase, stats);
+    }
+    return stats;
+}
+
+/* Returns true if the phase of 'stats' should run on the worker pool for an
+ * input of 'size' items.  The caller must check that the pool is usable. */
+static bool
+northd_par_decide(struct northd_par_stats *stats, size_t size)
+{
+    if (!northd_par_adaptive) {
+        return true;
+    }
+    if (size < stats->min_size) {
+        return false;
+    }
+
+    bool parallel;
+    if (!stats->n_runs[true]) {
+        parallel = true;
+    } else if (!stats->n_runs[false]) {
+        parallel = false;
+    } else {
+        parallel = (stats->nsec_per_item[true]
+                    < stats->nsec_per_item[false]);
+    }
+    if (!(++stats->n_decisions % NORTHD_PAR_PROBE_INTERVAL)) {
+        parallel = !parallel;
+    }
+    return parallel;
+}
+
+/* Records that the phase of 'stats' took 'usec' microseconds for 'size'
+ * items, on the worker pool if 'parallel' is true. */
+static void
+northd_par_record(struct northd_par_stats *stats, size_t size,
+                  bool parallel, long long int usec)
+{
+    double nsec_per_item = usec * 1000.0 / MAX(size, 1);
+
+    if (stats->n_runs[parallel]) {
+        stats->nsec_per_item[parallel] +=
+            (nsec_per_item - stats->nsec_per_item[parallel]) / 4;
+    } else {
+        stats->nsec_per_item[parallel] = nsec_per_item;
+    }
+    stats->n_runs[parallel]++;
+    stats->last_size = size;
+    stats->last_parallel = parallel;
+    stats->last_usec = usec;
+}
+
+/* With 'adaptive' false, the phases always run on the worker pool if there
+ * is one, as long as their input can be split. */
+void
+northd_par_set_adaptive(bool adaptive)
+{
+    northd_par_adaptive = adaptive;
+}
+
+void
+northd_par_stats_format(struct ds *ds)
+{
+    ds_put_format(ds, "policy: %s, %"PRIuSIZE" threads\n",
+                  northd_par_adaptive ? "adaptive" : "always",
+                  get_worker_pool_size());
+
+    const struct shash_node **nodes = shash_sort(&northd_par_phases);
+    for (size_t i = 0; i < shash_count(&northd_par_phases); i++) {
+        const struct northd_par_stats *stats = nodes[i]->data;
+
+        ds_put_format(ds, "%s: min %"PRIuSIZE" items, last run: %s, "
+                      "%"PRIuSIZE" items, %lld usec\n",
+                      nodes[i]->name, stats->min_size,
+                      stats->last_parallel ? "parallel" : "serial",
+                      stats->last_size, stats->last_usec);
+        for (int parallel = 0; parallel < 2; parallel++) {
+            ds_put_format(ds, "  %s: %llu runs, %.0f nsec/item\n",
+                          parallel ? "parallel" : "serial",
+                          stats->n_runs[parallel],
+                          stats->nsec_per_item[parallel]);
+        }
+    }
+    free(nodes);
+}
+
+struct northd_prep_task {
+    size_t n;
+    void (*cb)(size_t idx, void *aux);
+    void *aux;
+};
+
+static void
+northd_prep_task_run(struct worker_control *control, void *task_)
+{
+    const struct northd_prep_task *task = task_;
+    size_t chunk;
+
+    WORK_QUEUE_FOR_EACH_BUCKET (chunk, control->id, &northd_prep_wq) {
+        size_t end = MIN((chunk + 1) * NORTHD_PREP_CHUNK, task->n);
+
+        for (size_t i = chunk * NORTHD_PREP_CHUNK; i < end; i++) {
+            task->cb(i, task->aux);
+        }
+    }
+}
+
+/* Calls 'cb(idx, aux)' for every 'idx' in [0, n).  The calls are made from
+ * the worker threads if parallelization is enabled and 'n' is big enough to
+ * be worth it, so 'cb' must only modify data that belongs to 'idx'.
+ *
+ * 'phase' names the caller for the adaptive parallelization. */
+void
+northd_prep_for_each(const char *phase, size_t n,
+                     void (*cb)(size_t idx, void *aux), void *aux)
+{
+    size_t n_chunks = DIV_ROUND_UP(n, NORTHD_PREP_CHUNK);
+
+    /* The thread safe engine nodes may be running on the pool already. */
+    if (parallelization_state == STATE_NULL || !build_lflows_pool
+        || n_chunks < 2 || engine_worker_pool_is_busy()) {
+        for (size_t i = 0; i < n; i++) {
+            cb(i, aux);
+        }
+        return;
+    }
+
+    struct northd_par_stats *stats =
+        northd_par_stats_get(phase, 2 * NORTHD_PREP_CHUNK);
+    bool parallel = northd_par_decide(stats, n);
+    long long int start = time_usec();
+
+    if (parallel) {
+        struct northd_prep_task task = {
+            .n = n,
+            .cb = cb,
+            .aux = aux,
+        };
+        ovn_work_queue_reset(&northd_prep_wq, n_chunks);
+        run_pool_task(build_lflows_pool, northd_prep_task_run, &task);
+        COVERAGE_INC(northd_prep_parallel);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            cb(i, aux);
+        }
+    }
+    northd_par_record(stats, n, parallel, time_usec() - start);
+}
+
 static void
 join_datapaths(const struct nbrec_logical_switch_table *nbrec_ls_table,
                const struct nbrec_logical_router_table *nbrec_lr_table,
@@ -846,9 +1215,6 @@ join_datapaths(const struct nbrec_logical_switch_table *nbrec_ls_table,
                                      nbs, NULL, NULL);
             ovs_list_push_back(nb_only, &od->list);
         }
-
-        init_ipam_info_for_datapath(od);
-        init_mcast_info_for_datapath(od);
     }
 
     const struct nbrec_logical_router *nbr;
@@ -878,7 +1244,6 @@ join_datapaths(const struct nbrec_logical_switch_table *nbrec_ls_table,
                                      NULL, nbr, NULL);
             ovs_list_push_back(nb_only, &od->list);
         }
-        init_mcast_info_for_datapath(od);
         if (smap_get(&od->nbr->options, "chassis")) {
             od->is_gw_router = true;
         }
@@ -916,7 +1281,8 @@ get_ovn_max_dp_key_local(bool _vxlan_mode)
 }
 
 static void
-ovn_datapath_allocate_key(struct hmap *datapaths, struct hmap *dp_tnlids,
+ovn_datapath_allocate_key(struct hmap *datapaths,
+                          struct ovn_tnlids *dp_tnlids,
                           struct ovn_datapath *od, uint32_t *hint)
 {
     if (!od->tunnel_key) {
@@ -934,7 +1300,7 @@ ovn_datapath_allocate_key(struct hmap *datapaths, struct hmap *dp_tnlids,
 
 static void
 ovn_datapath_assign_requested_tnl_id(
-    struct hmap *dp_tnlids, struct ovn_datapath *od)
+    struct ovn_tnlids *dp_tnlids, struct ovn_datapath *od)
 {
     const struct smap *other_config = (od->nbs
                                        ? &od->nbs->other_config
@@ -961,6 +1327,34 @@ ovn_datapath_assign_requested_tnl_id(
     }
 }
 
+static void
+init_datapath_cb(size_t idx, void *ods_)
+{
+    struct ovn_datapath **ods = ods_;
+
+    init_ipam_info_for_datapath(ods[idx]);
+    init_mcast_info_for_datapath(ods[idx]);
+    init_ls_config_for_datapath(ods[idx]);
+}
+
+/* Parses the IPAM and multicast configuration of all the datapaths in
+ * 'datapaths' that have a northbound record. */
+static void
+init_datapaths_info(struct hmap *datapaths)
+{
+    struct ovn_datapath **ods = xmalloc(hmap_count(datapaths) * sizeof *ods);
+    struct ovn_datapath *od;
+    size_t n = 0;
+
+    HMAP_FOR_EACH (od, key_node, datapaths) {
+        if (od->nbs || od->nbr) {
+            ods[n++] = od;
+        }
+    }
+    northd_prep_for_each("datapaths", n, init_datapath_cb, ods);
+    free(ods);
+}
+
 static void
 ods_build_array_index(struct ovn_datapaths *datapaths)
 {
@@ -999,9 +1393,11 @@ build_datapaths(struct ovsdb_idl_txn *ovnsb_txn,
     struct hmap *datapaths = &ls_datapaths->datapaths;
     join_datapaths(nbrec_ls_table, nbrec_lr_table, sbrec_dp_table, ovnsb_txn,
                    datapaths, &sb_only, &nb_only, &both, lr_list);
+    init_datapaths_info(datapaths);
 
     /* Assign explicitly requested tunnel ids first. */
-    struct hmap dp_tnlids = HMAP_INITIALIZER(&dp_tnlids);
+    struct ovn_tnlids dp_tnlids;
+    ovn_tnlids_init(&dp_tnlids, OVN_MIN_DP_KEY_LOCAL, OVN_MAX_DP_KEY_LOCAL);
     struct ovn_datapath *od;
     LIST_FOR_EACH (od, list, &both) {
         ovn_datapath_assign_requested_tnl_id(&dp_tnlids, od);
@@ -1061,6 +1457,9 @@ build_datapaths(struct ovsdb_idl_txn *ovnsb_txn,
 
     ods_build_array_index(ls_datapaths);
     ods_build_array_index(lr_datapaths);
+
+    /* The datapath groups in use refer to the previous indexes. */
+    ovn_dp_groups_invalidate();
 }
 
 /* Structure representing logical router port
@@ -1077,6 +1476,7 @@ struct ovn_port_routable_addresses {
 };
 
 static bool lsp_can_be_inc_processed(const struct nbrec_logical_switch_port *);
+static bool lrp_can_be_inc_processed(const struct nbrec_logical_router_port *);
 
 /* This function returns true if 'op' is a gateway router port.
  * False otherwise.
@@ -1172,6 +1572,9 @@ ovn_port_set_nb(struct ovn_port *op,
         op->lsp_can_be_inc_processed = lsp_can_be_inc_processed(nbsp);
     }
     op->nbrp = nbrp;
+    if (nbrp) {
+        op->lrp_can_be_inc_processed = lrp_can_be_inc_processed(nbrp);
+    }
     init_mcast_port_info(&op->mcast_info, op->nbsp, op->nbrp);
 }
 
@@ -1362,6 +1765,64 @@ lsp_disable_arp_nd_rsp(const struct nbrec_logical_switch_port *nbsp)
     return smap_get_bool(&nbsp->options, "disable_arp_nd_rsp", false);
 }
 
+static bool
+is_vlan_transparent(const struct ovn_datapath *od)
+{
+    return smap_get_bool(&od->nbs->other_config, "vlan-passthru", false);
+}
+
+/* Returns true if the ARP/ND responder replies for the addresses of the
+ * logical switch port 'op', which must not be of type "virtual". */
+static bool
+lsp_arp_nd_rsp_enabled(const struct ovn_port *op)
+{
+    /*
+     * Add ARP/ND reply flows if either the
+     *  - port is up and it doesn't have 'unknown' address defined or it
+     *    doesn't have the option disable_arp_nd_rsp=true.
+     *  - port type is router or
+     *  - port type is localport
+     */
+    if (check_lsp_is_up &&
+        !lsp_is_up(op->nbsp) && !lsp_is_router(op->nbsp) &&
+        strcmp(op->nbsp->type, "localport")) {
+        return false;
+    }
+
+    if (lsp_is_external(op->nbsp) || op->has_unknown ||
+       (!op->nbsp->type[0] && lsp_disable_arp_nd_rsp(op->nbsp))) {
+        return false;
+    }
+
+    return !is_vlan_transparent(op->od);
+}
+
+/* Returns true if the ARP/ND responder looks up the addresses of the logical
+ * switch port 'op' in the table that ovn-controller builds from the "mac"
+ * column of its port binding, instead of having logical flows for each of
+ * them.  Only VIF and localport ports with static addresses qualify, the
+ * other ones keep their own flows. */
+static bool
+lsp_has_arp_nd_rsp_lookup(const struct ovn_port *op)
+{
+    if (!smap_get_bool(&op->od->nbs->other_config, "arp_nd_rsp_lookup",
+                       false)) {
+        return false;
+    }
+
+    if ((op->nbsp->type[0] && strcmp(op->nbsp->type, "localport"))
+        || !lsp_arp_nd_rsp_enabled(op)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < op->nbsp->n_addresses; i++) {
+        if (is_dynamic_lsp_address(op->nbsp->addresses[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static bool
 lsp_is_type_changed(const struct sbrec_port_binding *sb,
                 const struct nbrec_logical_switch_port *nbsp,
@@ -1590,7 +2051,7 @@ dynamic_ip4_changed(const char *lsp_addrs,
 
     uint32_t index = ip4 - ipam->start_ipv4;
     if (index >= ipam->total_ipv4s - 1 ||
-        bitmap_is_set(ipam->allocated_ipv4s, index)) {
+        hbitmap_is_set(ipam->allocated_ipv4s, index)) {
         /* Previously assigned dynamic IPv4 address can no longer be used.
          * It's either outside the subnet, conflicts with an excluded IP,
          * or conflicts with a statically-assigned address on the switch
@@ -1609,8 +2070,8 @@ dynamic_ip4_changed(const char *lsp_addrs,
              && lsp_addrs[n] == '\0')) {
             index = ntohl(new_ip) - ipam->start_ipv4;
             if (ntohl(new_ip) < ipam->start_ipv4 ||
-                index > ipam->total_ipv4s ||
-                bitmap_is_set(ipam->allocated_ipv4s, index)) {
+                index >= ipam->total_ipv4s ||
+                hbitmap_is_set(ipam->allocated_ipv4s, index)) {
                 /* new static ip is not valid */
                 return DYNAMIC;
             } else if (cur_addresses->ipv4_addrs[0].addr != new_ip) {
@@ -1858,6 +2319,80 @@ update_dynamic_addresses(struct dynamic_address_update *update)
     ds_destroy(&new_addr);
 }
 
+/* Checks the "dynamic" entry of 'op''s addresses, if any, against the
+ * dynamic addresses currently assigned to it.  Addresses that are still
+ * valid are claimed in IPAM right away, so that they cannot be assigned
+ * elsewhere, and the ones that need to be (re)assigned are queued in
+ * 'updates' to be processed by ipam_assign_dynamic_addresses(). */
+static void
+ipam_check_lsp_dynamic_addresses(struct ovn_datapath *od, struct ovn_port *op,
+                                 struct ovs_list *updates)
+{
+    const struct nbrec_logical_switch_port *nbsp = op->nbsp;
+    int num_dynamic_addresses = 0;
+
+    for (size_t j = 0; j < nbsp->n_addresses; j++) {
+        if (!is_dynamic_lsp_address(nbsp->addresses[j])) {
+            continue;
+        }
+        if (num_dynamic_addresses) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "More than one dynamic address "
+                         "configured for logical switch port '%s'",
+                         nbsp->name);
+            continue;
+        }
+        num_dynamic_addresses++;
+        struct dynamic_address_update *update = xzalloc(sizeof *update);
+        update->op = op;
+        update->od = od;
+        if (nbsp->dynamic_addresses) {
+            bool any_changed;
+            extract_lsp_addresses(nbsp->dynamic_addresses,
+                                  &update->current_addresses);
+            any_changed = dynamic_addresses_check_for_updates(
+                nbsp->addresses[j], update);
+            update_unchanged_dynamic_addresses(update);
+            if (any_changed) {
+                ovs_list_push_back(updates, &update->node);
+            } else {
+                /* No changes to dynamic addresses */
+                set_lsp_dynamic_addresses(nbsp->dynamic_addresses, op);
+                destroy_lport_addresses(&update->current_addresses);
+                free(update);
+            }
+        } else {
+            set_dynamic_updates(nbsp->addresses[j], update);
+            ovs_list_push_back(updates, &update->node);
+        }
+    }
+
+    if (!num_dynamic_addresses && nbsp->dynamic_addresses) {
+        nbrec_logical_switch_port_set_dynamic_addresses(nbsp, NULL);
+    }
+}
+
+/* Assigns new dynamic addresses for the 'updates' queued by
+ * ipam_check_lsp_dynamic_addresses(). */
+static void
+ipam_assign_dynamic_addresses(struct ovs_list *updates)
+{
+    struct dynamic_address_update *update;
+    LIST_FOR_EACH_POP (update, node, updates) {
+        update_dynamic_addresses(update);
+        destroy_lport_addresses(&update->current_addresses);
+        free(update);
+    }
+}
+
+static bool
+od_has_ipam(const struct ovn_datapath *od)
+{
+    return (od->ipam_info.allocated_ipv4s
+            || od->ipam_info.ipv6_prefix_set
+            || od->ipam_info.mac_only);
+}
+
 static void
 build_ipam(struct hmap *ls_datapaths, struct hmap *ls_ports)
 {
@@ -1879,9 +2414,7 @@ build_ipam(struct hmap *ls_datapaths, struct hmap *ls_ports)
         for (size_t i = 0; i < od->nbs->n_ports; i++) {
             const struct nbrec_logical_switch_port *nbsp = od->nbs->ports[i];
 
-            if (!od->ipam_info.allocated_ipv4s &&
-                !od->ipam_info.ipv6_prefix_set &&
-                !od->ipam_info.mac_only) {
+            if (!od_has_ipam(od)) {
                 if (nbsp->dynamic_addresses) {
                     nbrec_logical_switch_port_set_dynamic_addresses(nbsp,
                                                                     NULL);
@@ -1896,48 +2429,7 @@ build_ipam(struct hmap *ls_datapaths, struct hmap *ls_ports)
                 continue;
             }
 
-            int num_dynamic_addresses = 0;
-            for (size_t j = 0; j < nbsp->n_addresses; j++) {
-                if (!is_dynamic_lsp_address(nbsp->addresses[j])) {
-                    continue;
-                }
-                if (num_dynamic_addresses) {
-                    static struct vlog_rate_limit rl
-                        = VLOG_RATE_LIMIT_INIT(1, 1);
-                    VLOG_WARN_RL(&rl, "More than one dynamic address "
-                                 "configured for logical switch port '%s'",
-                                 nbsp->name);
-                    continue;
-                }
-                num_dynamic_addresses++;
-                struct dynamic_address_update *update
-                    = xzalloc(sizeof *update);
-                update->op = op;
-                update->od = od;
-                if (nbsp->dynamic_addresses) {
-                    bool any_changed;
-                    extract_lsp_addresses(nbsp->dynamic_addresses,
-                                          &update->current_addresses);
-                    any_changed = dynamic_addresses_check_for_updates(
-                        nbsp->addresses[j], update);
-                    update_unchanged_dynamic_addresses(update);
-                    if (any_changed) {
-                        ovs_list_push_back(&updates, &update->node);
-                    } else {
-                        /* No changes to dynamic addresses */
-                        set_lsp_dynamic_addresses(nbsp->dynamic_addresses, op);
-                        destroy_lport_addresses(&update->current_addresses);
-                        free(update);
-                    }
-                } else {
-                    set_dynamic_updates(nbsp->addresses[j], update);
-                    ovs_list_push_back(&updates, &update->node);
-                }
-            }
-
-            if (!num_dynamic_addresses && nbsp->dynamic_addresses) {
-                nbrec_logical_switch_port_set_dynamic_addresses(nbsp, NULL);
-            }
+            ipam_check_lsp_dynamic_addresses(od, op, &updates);
         }
 
     }
@@ -1945,12 +2437,7 @@ build_ipam(struct hmap *ls_datapaths, struct hmap *ls_ports)
     /* After retaining all unchanged dynamic addresses, now assign
      * new ones.
      */
-    struct dynamic_address_update *update;
-    LIST_FOR_EACH_POP (update, node, &updates) {
-        update_dynamic_addresses(update);
-        destroy_lport_addresses(&update->current_addresses);
-        free(update);
-    }
+    ipam_assign_dynamic_addresses(&updates);
 }
 
 /* Tag allocation for nested containers.
@@ -2100,30 +2587,112 @@ parse_lsp_addrs(struct ovn_port *op)
 }
 
 static void
-join_logical_ports(const struct sbrec_port_binding_table *sbrec_pb_table,
-                   struct hmap *ls_datapaths, struct hmap *lr_datapaths,
-                   struct hmap *ports, unsigned long *queue_id_bitmap,
-                   struct hmap *tag_alloc_table, struct ovs_list *sb_only,
-                   struct ovs_list *nb_only, struct ovs_list *both)
+parse_lsp_addrs_cb(size_t idx, void *lsps_)
 {
-    ovs_list_init(sb_only);
-    ovs_list_init(nb_only);
-    ovs_list_init(both);
+    struct ovn_port **lsps = lsps_;
 
-    const struct sbrec_port_binding *sb;
-    SBREC_PORT_BINDING_TABLE_FOR_EACH (sb, sbrec_pb_table) {
-        struct ovn_port *op = ovn_port_create(ports, sb->logical_port,
-                                              NULL, NULL, sb);
-        ovs_list_push_back(sb_only, &op->list);
+    parse_lsp_addrs(lsps[idx]);
+}
+
+/* Networks of all the ports of the logical routers in a set of datapaths,
+ * in the order in which the datapaths and their ports are iterated. */
+struct lrp_networks_prep {
+    size_t n;
+    const struct nbrec_logical_router_port **nbrps;
+    struct lport_addresses *networks;
+    bool *valid;
+};
+
+static void
+lrp_networks_prep_init(struct lrp_networks_prep *prep,
+                       const struct hmap *lr_datapaths)
+{
+    const struct ovn_datapath *od;
+    size_t n = 0;
+
+    HMAP_FOR_EACH (od, key_node, lr_datapaths) {
+        n += od->nbr->n_ports;
     }
 
-    struct ovn_datapath *od;
-    HMAP_FOR_EACH (od, key_node, ls_datapaths) {
-        ovs_assert(od->nbs);
-        size_t n_allocated_localnet_ports = 0;
-        for (size_t i = 0; i < od->nbs->n_ports; i++) {
-            const struct nbrec_logical_switch_port *nbsp
-                = od->nbs->ports[i];
+    prep->n = n;
+    prep->nbrps = xmalloc(n * sizeof *prep->nbrps);
+    prep->networks = xmalloc(n * sizeof *prep->networks);
+    prep->valid = xmalloc(n * sizeof *prep->valid);
+
+    n = 0;
+    HMAP_FOR_EACH (od, key_node, lr_datapaths) {
+        for (size_t i = 0; i < od->nbr->n_ports; i++) {
+            prep->nbrps[n++] = od->nbr->ports[i];
+        }
+    }
+}
+
+static void
+lrp_networks_prep_cb(size_t idx, void *prep_)
+{
+    struct lrp_networks_prep *prep = prep_;
+
+    prep->valid[idx] = extract_lrp_networks(prep->nbrps[idx],
+                                            &prep->networks[idx]);
+}
+
+/* Frees 'prep'.  The networks themselves are owned by the ports that use
+ * them, or freed by join_logical_ports() otherwise. */
+static void
+lrp_networks_prep_destroy(struct lrp_networks_prep *prep)
+{
+    free(prep->nbrps);
+    free(prep->networks);
+    free(prep->valid);
+}
+
+/* Adds the IP addresses of the logical router port 'op' to the
+ * 'router_ips' of its router. */
+static void
+lrp_add_router_ips(const struct ovn_port *op)
+{
+    for (size_t j = 0; j < op->lrp_networks.n_ipv4_addrs; j++) {
+        sset_add(&op->od->router_ips,
+                 op->lrp_networks.ipv4_addrs[j].addr_s);
+    }
+    for (size_t j = 0; j < op->lrp_networks.n_ipv6_addrs; j++) {
+        /* Exclude the LLA. */
+        if (!in6_is_lla(&op->lrp_networks.ipv6_addrs[j].addr)) {
+            sset_add(&op->od->router_ips,
+                     op->lrp_networks.ipv6_addrs[j].addr_s);
+        }
+    }
+}
+
+static void
+join_logical_ports(const struct sbrec_port_binding_table *sbrec_pb_table,
+                   struct hmap *ls_datapaths, struct hmap *lr_datapaths,
+                   struct hmap *ports, unsigned long *queue_id_bitmap,
+                   struct hmap *tag_alloc_table, struct ovs_list *sb_only,
+                   struct ovs_list *nb_only, struct ovs_list *both)
+{
+    ovs_list_init(sb_only);
+    ovs_list_init(nb_only);
+    ovs_list_init(both);
+
+    /* Logical switch ports whose addresses still need to be parsed. */
+    struct ovn_port **lsps = NULL;
+    size_t n_lsps = 0, n_allocated_lsps = 0;
+
+    const struct sbrec_port_binding *sb;
+    SBREC_PORT_BINDING_TABLE_FOR_EACH (sb, sbrec_pb_table) {
+        struct ovn_port *op = ovn_port_create(ports, sb->logical_port,
+                                              NULL, NULL, sb);
+        ovs_list_push_back(sb_only, &op->list);
+    }
+
+    struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, ls_datapaths) {
+        ovs_assert(od->nbs);
+        size_t n_allocated_localnet_ports = 0;
+        for (size_t i = 0; i < od->nbs->n_ports; i++) {
+            const struct nbrec_logical_switch_port *nbsp
+                = od->nbs->ports[i];
             struct ovn_port *op = ovn_port_find_bound(ports, nbsp->name);
             if (op && (op->od || op->nbsp || op->nbrp)) {
                 static struct vlog_rate_limit rl
@@ -2195,31 +2764,47 @@ join_logical_ports(const struct sbrec_port_binding_table *sbrec_pb_table,
                 od->has_vtep_lports = true;
             }
 
-            parse_lsp_addrs(op);
+            if (n_lsps >= n_allocated_lsps) {
+                lsps = x2nrealloc(lsps, &n_allocated_lsps, sizeof *lsps);
+            }
+            lsps[n_lsps++] = op;
 
             op->od = od;
-            if (op->has_unknown) {
-                od->has_unknown = true;
-            }
             hmap_insert(&od->ports, &op->dp_node,
                         hmap_node_hash(&op->key_node));
             tag_alloc_add_existing_tags(tag_alloc_table, nbsp);
         }
     }
+
+    /* Parse the addresses of the logical switch ports found above. */
+    northd_prep_for_each("lsp-addresses", n_lsps, parse_lsp_addrs_cb, lsps);
+    for (size_t i = 0; i < n_lsps; i++) {
+        if (lsps[i]->has_unknown) {
+            lsps[i]->od->has_unknown = true;
+        }
+    }
+    free(lsps);
+
+    struct lrp_networks_prep lrps;
+    lrp_networks_prep_init(&lrps, lr_datapaths);
+    northd_prep_for_each("lrp-networks", lrps.n, lrp_networks_prep_cb,
+                         &lrps);
+
+    size_t lrp_idx = 0;
     HMAP_FOR_EACH (od, key_node, lr_datapaths) {
         ovs_assert(od->nbr);
         size_t n_allocated_l3dgw_ports = 0;
-        for (size_t i = 0; i < od->nbr->n_ports; i++) {
+        for (size_t i = 0; i < od->nbr->n_ports; i++, lrp_idx++) {
             const struct nbrec_logical_router_port *nbrp
                 = od->nbr->ports[i];
 
-            struct lport_addresses lrp_networks;
-            if (!extract_lrp_networks(nbrp, &lrp_networks)) {
+            if (!lrps.valid[lrp_idx]) {
                 static struct vlog_rate_limit rl
                     = VLOG_RATE_LIMIT_INIT(5, 1);
                 VLOG_WARN_RL(&rl, "bad 'mac' %s", nbrp->mac);
                 continue;
             }
+            struct lport_addresses lrp_networks = lrps.networks[lrp_idx];
 
             if (!lrp_networks.n_ipv4_addrs && !lrp_networks.n_ipv6_addrs) {
                 continue;
@@ -2249,18 +2834,7 @@ join_logical_ports(const struct sbrec_port_binding_table *sbrec_pb_table,
 
             op->lrp_networks = lrp_networks;
             op->od = od;
-
-            for (size_t j = 0; j < op->lrp_networks.n_ipv4_addrs; j++) {
-                sset_add(&op->od->router_ips,
-                         op->lrp_networks.ipv4_addrs[j].addr_s);
-            }
-            for (size_t j = 0; j < op->lrp_networks.n_ipv6_addrs; j++) {
-                /* Exclude the LLA. */
-                if (!in6_is_lla(&op->lrp_networks.ipv6_addrs[j].addr)) {
-                    sset_add(&op->od->router_ips,
-                             op->lrp_networks.ipv6_addrs[j].addr_s);
-                }
-            }
+            lrp_add_router_ips(op);
 
             hmap_insert(&od->ports, &op->dp_node,
                         hmap_node_hash(&op->key_node));
@@ -2316,6 +2890,8 @@ join_logical_ports(const struct sbrec_port_binding_table *sbrec_pb_table,
         }
     }
 
+    lrp_networks_prep_destroy(&lrps);
+
     /* Connect logical router ports, and logical switch ports of type "router",
      * to their peers. */
     struct ovn_port *op;
@@ -2810,27 +3386,32 @@ op_get_name(const struct ovn_port *op)
 }
 
 static void
-ovn_update_ipv6_prefix(struct hmap *lr_ports)
+ovn_port_update_ipv6_prefix(const struct ovn_port *op)
 {
-    const struct ovn_port *op;
-    HMAP_FOR_EACH (op, key_node, lr_ports) {
-        ovs_assert(op->nbrp);
+    ovs_assert(op->nbrp);
 
-        if (!smap_get_bool(&op->nbrp->options, "prefix", false)) {
-            continue;
-        }
+    if (!op->sb || !smap_get_bool(&op->nbrp->options, "prefix", false)) {
+        return;
+    }
 
-        char prefix[IPV6_SCAN_LEN + 6];
-        unsigned aid;
-        const char *ipv6_pd_list = smap_get(&op->sb->options,
-                                            "ipv6_ra_pd_list");
-        if (!ipv6_pd_list ||
-            !ovs_scan(ipv6_pd_list, "%u:%s", &aid, prefix)) {
-            continue;
-        }
+    char prefix[IPV6_SCAN_LEN + 6];
+    unsigned aid;
+    const char *ipv6_pd_list = smap_get(&op->sb->options, "ipv6_ra_pd_list");
+    if (!ipv6_pd_list ||
+        !ovs_scan(ipv6_pd_list, "%u:%s", &aid, prefix)) {
+        return;
+    }
+
+    const char *prefix_ptr = prefix;
+    nbrec_logical_router_port_set_ipv6_prefix(op->nbrp, &prefix_ptr, 1);
+}
 
-        const char *prefix_ptr = prefix;
-        nbrec_logical_router_port_set_ipv6_prefix(op->nbrp, &prefix_ptr, 1);
+static void
+ovn_update_ipv6_prefix(struct hmap *lr_ports)
+{
+    const struct ovn_port *op;
+    HMAP_FOR_EACH (op, key_node, lr_ports) {
+        ovn_port_update_ipv6_prefix(op);
     }
 }
 
@@ -2966,6 +3547,65 @@ l3dgw_port_has_associated_vtep_lports(const struct ovn_port *op)
     return op->peer && op->peer->od->has_vtep_lports;
 }
 
+/* Syncs the SB HA_Chassis_Group of the chassis-redirect port 'op' with the
+ * gateway chassis or the HA chassis group of its NB router port.  If
+ * 'active_ha_chassis_grps' is nonnull, the name of the group is added to
+ * it. */
+static void
+cr_port_sync_ha_chassis_group(
+    struct ovsdb_idl_txn *ovnsb_txn,
+    struct ovsdb_idl_index *sbrec_chassis_by_name,
+    struct ovsdb_idl_index *sbrec_ha_chassis_grp_by_name,
+    const struct ovn_port *op, struct sset *active_ha_chassis_grps)
+{
+    ovs_assert(sbrec_chassis_by_name);
+    ovs_assert(sbrec_ha_chassis_grp_by_name);
+
+    if (op->nbrp->ha_chassis_group) {
+        if (op->nbrp->n_gateway_chassis) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "Both ha_chassis_group and "
+                         "gateway_chassis configured on port %s; "
+                         "ignoring the latter.", op->nbrp->name);
+        }
+
+        /* HA Chassis group is set. Ignore 'gateway_chassis'. */
+        sync_ha_chassis_group_for_sbpb(ovnsb_txn,
+                                       sbrec_chassis_by_name,
+                                       sbrec_ha_chassis_grp_by_name,
+                                       op->nbrp->ha_chassis_group,
+                                       op->sb);
+        if (active_ha_chassis_grps) {
+            sset_add(active_ha_chassis_grps,
+                     op->nbrp->ha_chassis_group->name);
+        }
+    } else if (op->nbrp->n_gateway_chassis) {
+        /* Legacy gateway_chassis support.
+         * Create ha_chassis_group for the Northbound gateway_chassis
+         * associated with the lrp. */
+        if (sbpb_gw_chassis_needs_update(op->sb, op->nbrp,
+                                         sbrec_chassis_by_name)) {
+            copy_gw_chassis_from_nbrp_to_sbpb(
+                ovnsb_txn, sbrec_chassis_by_name,
+                sbrec_ha_chassis_grp_by_name, op->nbrp, op->sb);
+        }
+
+        if (active_ha_chassis_grps) {
+            sset_add(active_ha_chassis_grps, op->nbrp->name);
+        }
+    } else {
+        /* Nothing is set. Clear ha_chassis_group  from pb. */
+        if (op->sb->ha_chassis_group) {
+            sbrec_port_binding_set_ha_chassis_group(op->sb, NULL);
+        }
+    }
+
+    if (op->sb->n_gateway_chassis) {
+        /* Delete the legacy gateway_chassis from the pb. */
+        sbrec_port_binding_set_gateway_chassis(op->sb, NULL, 0);
+    }
+}
+
 static void
 ovn_port_update_sbrec(struct ovsdb_idl_txn *ovnsb_txn,
                       struct ovsdb_idl_index *sbrec_chassis_by_name,
@@ -2993,51 +3633,11 @@ ovn_port_update_sbrec(struct ovsdb_idl_txn *ovnsb_txn,
         }
 
         if (is_cr_port(op)) {
-            ovs_assert(sbrec_chassis_by_name);
             ovs_assert(sbrec_chassis_by_hostname);
-            ovs_assert(sbrec_ha_chassis_grp_by_name);
             ovs_assert(active_ha_chassis_grps);
-
-            if (op->nbrp->ha_chassis_group) {
-                if (op->nbrp->n_gateway_chassis) {
-                    static struct vlog_rate_limit rl
-                        = VLOG_RATE_LIMIT_INIT(1, 1);
-                    VLOG_WARN_RL(&rl, "Both ha_chassis_group and "
-                                 "gateway_chassis configured on port %s; "
-                                 "ignoring the latter.", op->nbrp->name);
-                }
-
-                /* HA Chassis group is set. Ignore 'gateway_chassis'. */
-                sync_ha_chassis_group_for_sbpb(ovnsb_txn,
-                                               sbrec_chassis_by_name,
-                                               sbrec_ha_chassis_grp_by_name,
-                                               op->nbrp->ha_chassis_group,
-                                               op->sb);
-                sset_add(active_ha_chassis_grps,
-                         op->nbrp->ha_chassis_group->name);
-            } else if (op->nbrp->n_gateway_chassis) {
-                /* Legacy gateway_chassis support.
-                 * Create ha_chassis_group for the Northbound gateway_chassis
-                 * associated with the lrp. */
-                if (sbpb_gw_chassis_needs_update(op->sb, op->nbrp,
-                                                 sbrec_chassis_by_name)) {
-                    copy_gw_chassis_from_nbrp_to_sbpb(
-                        ovnsb_txn, sbrec_chassis_by_name,
-                        sbrec_ha_chassis_grp_by_name, op->nbrp, op->sb);
-                }
-
-                sset_add(active_ha_chassis_grps, op->nbrp->name);
-            } else {
-                /* Nothing is set. Clear ha_chassis_group  from pb. */
-                if (op->sb->ha_chassis_group) {
-                    sbrec_port_binding_set_ha_chassis_group(op->sb, NULL);
-                }
-            }
-
-            if (op->sb->n_gateway_chassis) {
-                /* Delete the legacy gateway_chassis from the pb. */
-                sbrec_port_binding_set_gateway_chassis(op->sb, NULL, 0);
-            }
+            cr_port_sync_ha_chassis_group(ovnsb_txn, sbrec_chassis_by_name,
+                                          sbrec_ha_chassis_grp_by_name, op,
+                                          active_ha_chassis_grps);
         }
 
         sbrec_port_binding_set_parent_port(op->sb, NULL);
@@ -3089,6 +3689,12 @@ ovn_port_update_sbrec(struct ovsdb_idl_txn *ovnsb_txn,
                 smap_add(&options, "vlan-passthru", "true");
             }
 
+            if (lsp_has_arp_nd_rsp_lookup(op)) {
+                smap_replace(&options, "arp_nd_rsp_lookup", "true");
+            } else {
+                smap_remove(&options, "arp_nd_rsp_lookup");
+            }
+
             ovn_port_update_sbrec_chassis(sbrec_chassis_by_name,
                                           sbrec_chassis_by_hostname, op);
 
@@ -3312,25 +3918,87 @@ delete_fdb_entry(struct ovsdb_idl_index *sbrec_fdb_by_dp_and_port,
 struct service_monitor_info {
     struct hmap_node hmap_node;
     const struct sbrec_service_monitor *sbrec_mon;
-    bool required;
+
+    /* The columns that identify 'sbrec_mon'.  They are kept here because
+     * the rows inserted by northd are only valid until the transaction is
+     * committed, 'sbrec_mon' is then updated with the row received from
+     * the SB by northd_handle_sb_service_monitor_changes(). */
+    char *ip;
+    char *logical_port;
+    char *protocol;
+    uint16_t service_port;
+
+    /* UUIDs of the load balancers with a backend monitored by 'sbrec_mon'.
+     * The service monitors that aren't used by any load balancer are
+     * deleted. */
+    struct uuidset lbs;
 };
 
+static uint32_t
+service_mon_hash(const char *ip, const char *logical_port,
+                 uint16_t service_port)
+{
+    uint32_t hash = service_port;
+    hash = hash_string(ip, hash);
+    return hash_string(logical_port, hash);
+}
+
+static struct service_monitor_info *
+service_mon_create(struct hmap *monitor_map,
+                   const struct sbrec_service_monitor *sbrec_mon,
+                   const char *ip, const char *logical_port,
+                   uint16_t service_port, const char *protocol)
+{
+    struct service_monitor_info *mon_info = xzalloc(sizeof *mon_info);
+    mon_info->sbrec_mon = sbrec_mon;
+    mon_info->ip = xstrdup(ip);
+    mon_info->logical_port = xstrdup(logical_port);
+    mon_info->protocol = xstrdup(protocol);
+    mon_info->service_port = service_port;
+    uuidset_init(&mon_info->lbs);
+    hmap_insert(monitor_map, &mon_info->hmap_node,
+                service_mon_hash(ip, logical_port, service_port));
+    return mon_info;
+}
+
+static void
+service_mon_free(struct service_monitor_info *mon_info)
+{
+    uuidset_destroy(&mon_info->lbs);
+    free(mon_info->ip);
+    free(mon_info->logical_port);
+    free(mon_info->protocol);
+    free(mon_info);
+}
+
+/* Deletes the SB Service_Monitor rows that aren't used by any load
+ * balancer. */
+static void
+service_mon_delete_unused(struct hmap *monitor_map)
+{
+    struct service_monitor_info *mon_info;
+    HMAP_FOR_EACH_SAFE (mon_info, hmap_node, monitor_map) {
+        if (uuidset_is_empty(&mon_info->lbs)) {
+            sbrec_service_monitor_delete(mon_info->sbrec_mon);
+            hmap_remove(monitor_map, &mon_info->hmap_node);
+            service_mon_free(mon_info);
+        }
+    }
+}
 
 static struct service_monitor_info *
 get_service_mon(const struct hmap *monitor_map,
                 const char *ip, const char *logical_port,
                 uint16_t service_port, const char *protocol)
 {
-    uint32_t hash = service_port;
-    hash = hash_string(ip, hash);
-    hash = hash_string(logical_port, hash);
+    uint32_t hash = service_mon_hash(ip, logical_port, service_port);
 
     struct service_monitor_info *mon_info;
     HMAP_FOR_EACH_WITH_HASH (mon_info, hmap_node, hash, monitor_map) {
-        if (mon_info->sbrec_mon->port == service_port &&
-            !strcmp(mon_info->sbrec_mon->ip, ip) &&
-            !strcmp(mon_info->sbrec_mon->protocol, protocol) &&
-            !strcmp(mon_info->sbrec_mon->logical_port, logical_port)) {
+        if (mon_info->service_port == service_port &&
+            !strcmp(mon_info->ip, ip) &&
+            !strcmp(mon_info->protocol, protocol) &&
+            !strcmp(mon_info->logical_port, logical_port)) {
             return mon_info;
         }
     }
@@ -3358,11 +4026,6 @@ create_or_get_service_mon(struct ovsdb_idl_txn *ovnsb_txn,
         return mon_info;
     }
 
-    /* get_service_mon() also calculates the hash the same way. */
-    uint32_t hash = service_port;
-    hash = hash_string(ip, hash);
-    hash = hash_string(logical_port, hash);
-
     struct sbrec_service_monitor *sbrec_mon =
         sbrec_service_monitor_insert(ovnsb_txn);
     sbrec_service_monitor_set_ip(sbrec_mon, ip);
@@ -3372,10 +4035,8 @@ create_or_get_service_mon(struct ovsdb_idl_txn *ovnsb_txn,
     if (chassis_name) {
         sbrec_service_monitor_set_chassis_name(sbrec_mon, chassis_name);
     }
-    mon_info = xzalloc(sizeof *mon_info);
-    mon_info->sbrec_mon = sbrec_mon;
-    hmap_insert(monitor_map, &mon_info->hmap_node, hash);
-    return mon_info;
+    return service_mon_create(monitor_map, sbrec_mon, ip, logical_port,
+                              service_port, protocol);
 }
 
 static void
@@ -3454,9 +4115,65 @@ ovn_lb_svc_create(struct ovsdb_idl_txn *ovnsb_txn,
                                                  "offline");
             }
 
-            mon_info->required = true;
+            uuidset_insert(&mon_info->lbs, &lb->nlb->header_.uuid);
+        }
+    }
+}
+
+/* Returns true if 'backend', a backend of a VIP of 'lb' with a health
+ * check, is used for load balancing, i.e., if it's monitored and its
+ * service monitor isn't reported down. */
+static bool
+lb_backend_is_active(const struct ovn_northd_lb *lb,
+                     const struct ovn_lb_backend *backend,
+                     const struct ovn_northd_lb_backend *backend_nb,
+                     const struct hmap *svc_monitor_map)
+{
+    if (!backend_nb->health_check) {
+        return false;
+    }
+
+    const char *protocol = lb->nlb->protocol;
+    if (!protocol || !protocol[0]) {
+        protocol = "tcp";
+    }
+
+    struct service_monitor_info *mon_info = get_service_mon(
+        svc_monitor_map, backend->ip_str, backend_nb->logical_port,
+        backend->port, protocol);
+
+    if (!mon_info) {
+        return false;
+    }
+
+    ovs_assert(mon_info->sbrec_mon);
+    return !mon_info->sbrec_mon->status
+           || !strcmp(mon_info->sbrec_mon->status, "online");
+}
+
+/* Returns the indexes of the backends of the VIP 'vip_idx' of 'lb' that are
+ * used for load balancing based on the status of their service monitors,
+ * or NULL if the VIP has no health check. */
+static char *
+lb_vip_active_backends(const struct ovn_northd_lb *lb, size_t vip_idx,
+                       const struct hmap *svc_monitor_map)
+{
+    const struct ovn_lb_vip *lb_vip = &lb->vips[vip_idx];
+    const struct ovn_northd_lb_vip *lb_vip_nb = &lb->vips_nb[vip_idx];
+
+    if (!lb_vip_nb->lb_health_check) {
+        return NULL;
+    }
+
+    struct ds active = DS_EMPTY_INITIALIZER;
+    for (size_t i = 0; i < lb_vip->n_backends; i++) {
+        if (lb_backend_is_active(lb, &lb_vip->backends[i],
+                                 &lb_vip_nb->backends_nb[i],
+                                 svc_monitor_map)) {
+            ds_put_format(&active, "%"PRIuSIZE",", i);
         }
     }
+    return ds_steal_cstr(&active);
 }
 
 static bool
@@ -3483,26 +4200,8 @@ build_lb_vip_actions(const struct ovn_northd_lb *lb,
             struct ovn_northd_lb_backend *backend_nb =
                 &lb_vip_nb->backends_nb[i];
 
-            if (!backend_nb->health_check) {
-                continue;
-            }
-
-            const char *protocol = lb->nlb->protocol;
-            if (!protocol || !protocol[0]) {
-                protocol = "tcp";
-            }
-
-            struct service_monitor_info *mon_info = get_service_mon(
-                svc_monitor_map, backend->ip_str, backend_nb->logical_port,
-                backend->port, protocol);
-
-            if (!mon_info) {
-                continue;
-            }
-
-            ovs_assert(mon_info->sbrec_mon);
-            if (mon_info->sbrec_mon->status &&
-                    strcmp(mon_info->sbrec_mon->status, "online")) {
+            if (!lb_backend_is_active(lb, backend, backend_nb,
+                                      svc_monitor_map)) {
                 continue;
             }
 
@@ -3628,16 +4327,15 @@ build_lb_datapaths(const struct hmap *lbs, const struct hmap *lb_groups,
         }
     }
 
+    /* The datapaths of each group are added to its load balancers at once,
+     * instead of datapath by datapath. */
     HMAP_FOR_EACH (lb_group_dps, hmap_node, lb_group_datapaths_map) {
         for (size_t j = 0; j < lb_group_dps->lb_group->n_lbs; j++) {
             const struct uuid *lb_uuid =
                 &lb_group_dps->lb_group->lbs[j]->nlb->header_.uuid;
             lb_dps = ovn_lb_datapaths_find(lb_datapaths_map, lb_uuid);
             ovs_assert(lb_dps);
-            ovn_lb_datapaths_add_ls(lb_dps, lb_group_dps->n_ls,
-                                    lb_group_dps->ls);
-            ovn_lb_datapaths_add_lr(lb_dps, lb_group_dps->n_lr,
-                                    lb_group_dps->lr);
+            ovn_lb_datapaths_add_lb_group(lb_dps, lb_group_dps);
         }
     }
 }
@@ -3655,13 +4353,9 @@ build_lb_svcs(
     const struct sbrec_service_monitor *sbrec_mon;
     SBREC_SERVICE_MONITOR_TABLE_FOR_EACH (sbrec_mon,
                             sbrec_service_monitor_table) {
-        uint32_t hash = sbrec_mon->port;
-        hash = hash_string(sbrec_mon->ip, hash);
-        hash = hash_string(sbrec_mon->logical_port, hash);
-        struct service_monitor_info *mon_info = xzalloc(sizeof *mon_info);
-        mon_info->sbrec_mon = sbrec_mon;
-        mon_info->required = false;
-        hmap_insert(svc_monitor_map, &mon_info->hmap_node, hash);
+        service_mon_create(svc_monitor_map, sbrec_mon, sbrec_mon->ip,
+                           sbrec_mon->logical_port, sbrec_mon->port,
+                           sbrec_mon->protocol ? sbrec_mon->protocol : "");
     }
 
     struct ovn_lb_datapaths *lb_dps;
@@ -3671,14 +4365,123 @@ build_lb_svcs(
                           svc_monitor_lsps);
     }
 
+    service_mon_delete_unused(svc_monitor_map);
+}
+
+/* Updates the SB Service_Monitor rows of the backends of the load balancers
+ * in 'trk_lb_data', if any of them has health checks: creates the service
+ * monitors of their new backends and deletes the ones that are no longer
+ * used by any load balancer.  The service monitors of the other load
+ * balancers are left untouched.
+ *
+ * 'svc_monitor_lsps' is only extended with the ports of the new backends,
+ * the ports that are no longer used for service monitoring are removed by
+ * the next recompute. */
+bool
+northd_handle_lb_svc_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                             const struct tracked_lb_data *trk_lb_data,
+                             const char *svc_monitor_mac,
+                             const struct eth_addr *svc_monitor_mac_ea,
+                             struct hmap *ls_ports,
+                             struct sset *svc_monitor_lsps,
+                             struct hmap *svc_monitor_map)
+{
+    if (!trk_lb_data->has_health_checks) {
+        return true;
+    }
+
+    if (!ovnsb_txn) {
+        return false;
+    }
+
+    struct uuidset changed_lbs = UUIDSET_INITIALIZER(&changed_lbs);
+    const struct hmapx_node *hmapx_node;
+    HMAPX_FOR_EACH (hmapx_node, &trk_lb_data->deleted_lbs) {
+        const struct ovn_northd_lb *lb = hmapx_node->data;
+        uuidset_insert(&changed_lbs, &lb->nlb->header_.uuid);
+    }
+
+    const struct crupdated_lb *clb;
+    HMAP_FOR_EACH (clb, hmap_node, &trk_lb_data->crupdated_lbs) {
+        uuidset_insert(&changed_lbs, &clb->lb->nlb->header_.uuid);
+    }
+
+    /* The backends of the updated load balancers may have changed, their
+     * service monitors are looked up again below. */
     struct service_monitor_info *mon_info;
-    HMAP_FOR_EACH_SAFE (mon_info, hmap_node, svc_monitor_map) {
-        if (!mon_info->required) {
-            sbrec_service_monitor_delete(mon_info->sbrec_mon);
-            hmap_remove(svc_monitor_map, &mon_info->hmap_node);
-            free(mon_info);
+    HMAP_FOR_EACH (mon_info, hmap_node, svc_monitor_map) {
+        const struct uuidset_node *uuidnode;
+        UUIDSET_FOR_EACH (uuidnode, &changed_lbs) {
+            uuidset_find_and_delete(&mon_info->lbs, &uuidnode->uuid);
+        }
+    }
+    uuidset_destroy(&changed_lbs);
+
+    HMAP_FOR_EACH (clb, hmap_node, &trk_lb_data->crupdated_lbs) {
+        ovn_lb_svc_create(ovnsb_txn, clb->lb, svc_monitor_mac,
+                          svc_monitor_mac_ea, svc_monitor_map, ls_ports,
+                          svc_monitor_lsps);
+    }
+
+    service_mon_delete_unused(svc_monitor_map);
+    return true;
+}
+
+/* Handles the changes to the SB Service_Monitor rows, i.e., the status
+ * updates of the service monitors by ovn-controller, by adding the load
+ * balancers that use them to the northd tracked data.  Only the lflows of
+ * their VIPs whose active backends changed are rebuilt by en_lflow.  Falls
+ * back to a recompute for the rows that aren't managed by northd. */
+bool
+northd_handle_sb_service_monitor_changes(
+    const struct sbrec_service_monitor_table *sbrec_service_monitor_table,
+    struct hmap *svc_monitor_map, struct hmap *lb_datapaths_map,
+    struct northd_tracked_data *trk_data)
+{
+    const struct sbrec_service_monitor *sbrec_mon;
+    SBREC_SERVICE_MONITOR_TABLE_FOR_EACH_TRACKED (sbrec_mon,
+                                            sbrec_service_monitor_table) {
+        struct service_monitor_info *mon_info =
+            get_service_mon(svc_monitor_map, sbrec_mon->ip,
+                            sbrec_mon->logical_port, sbrec_mon->port,
+                            sbrec_mon->protocol ? sbrec_mon->protocol : "");
+
+        if (sbrec_service_monitor_is_deleted(sbrec_mon)) {
+            if (mon_info && mon_info->sbrec_mon == sbrec_mon) {
+                /* Not deleted by northd. */
+                return false;
+            }
+            continue;
         }
+
+        if (!mon_info) {
+            /* Not inserted by northd. */
+            return false;
+        }
+
+        /* Replaces the row inserted by northd, if it is new. */
+        mon_info->sbrec_mon = sbrec_mon;
+        if (!sbrec_service_monitor_is_new(sbrec_mon)
+            && !sbrec_service_monitor_is_updated(
+                sbrec_mon, SBREC_SERVICE_MONITOR_COL_STATUS)) {
+            continue;
+        }
+
+        const struct uuidset_node *uuidnode;
+        UUIDSET_FOR_EACH (uuidnode, &mon_info->lbs) {
+            struct ovn_lb_datapaths *lb_dps =
+                ovn_lb_datapaths_find(lb_datapaths_map, &uuidnode->uuid);
+            if (lb_dps) {
+                hmapx_add(&trk_data->trk_lbs.crupdated, lb_dps);
+            }
+        }
+    }
+
+    if (!hmapx_is_empty(&trk_data->trk_lbs.crupdated)) {
+        trk_data->type |= NORTHD_TRACKED_LBS;
     }
+
+    return true;
 }
 
 static void
@@ -3700,19 +4503,14 @@ build_lswitch_lbs_from_lrouter(struct ovn_datapaths *lr_datapaths,
         }
     }
 
+    /* The load balancers of the groups were already applied to the peers of
+     * the groups' routers above, only the groups themselves are left. */
     struct ovn_lb_group_datapaths *lb_group_dps;
     HMAP_FOR_EACH (lb_group_dps, hmap_node, lb_group_dps_map) {
         for (size_t i = 0; i < lb_group_dps->n_lr; i++) {
             struct ovn_datapath *od = lb_group_dps->lr[i];
             ovn_lb_group_datapaths_add_ls(lb_group_dps, od->n_ls_peers,
                                           od->ls_peers);
-            for (size_t j = 0; j < lb_group_dps->lb_group->n_lbs; j++) {
-                const struct uuid *lb_uuid =
-                    &lb_group_dps->lb_group->lbs[j]->nlb->header_.uuid;
-                lb_dps = ovn_lb_datapaths_find(lb_dps_map, lb_uuid);
-                ovs_assert(lb_dps);
-                ovn_lb_datapaths_add_ls(lb_dps, od->n_ls_peers, od->ls_peers);
-            }
         }
     }
 }
@@ -3976,23 +4774,34 @@ sync_pbs(struct ovsdb_idl_txn *ovnsb_idl_txn, struct hmap *ls_ports,
     ovn_update_ipv6_options(lr_ports);
 }
 
-/* Sync the SB Port bindings for the added and updated logical switch ports
- * of the tracked northd engine data. */
+/* Sync the SB Port bindings for the added and updated logical switch and
+ * router ports of the tracked northd engine data. */
 bool
 sync_pbs_for_northd_changed_ovn_ports(
-    struct tracked_ovn_ports *trk_ovn_ports,
+    struct tracked_ovn_ports *trk_lsps,
+    struct tracked_ovn_ports *trk_lrps,
     const struct lr_stateful_table *lr_stateful_table)
 {
     struct hmapx_node *hmapx_node;
 
-    HMAPX_FOR_EACH (hmapx_node, &trk_ovn_ports->created) {
+    HMAPX_FOR_EACH (hmapx_node, &trk_lsps->created) {
         sync_pb_for_lsp(hmapx_node->data, lr_stateful_table);
     }
 
-    HMAPX_FOR_EACH (hmapx_node, &trk_ovn_ports->updated) {
+    HMAPX_FOR_EACH (hmapx_node, &trk_lsps->updated) {
         sync_pb_for_lsp(hmapx_node->data, lr_stateful_table);
     }
 
+    HMAPX_FOR_EACH (hmapx_node, &trk_lrps->created) {
+        sync_pb_for_lrp(hmapx_node->data, lr_stateful_table);
+        ovn_update_ipv6_opt_for_op(hmapx_node->data);
+    }
+
+    HMAPX_FOR_EACH (hmapx_node, &trk_lrps->updated) {
+        sync_pb_for_lrp(hmapx_node->data, lr_stateful_table);
+        ovn_update_ipv6_opt_for_op(hmapx_node->data);
+    }
+
     return true;
 }
 
@@ -4222,15 +5031,42 @@ add_op_to_northd_tracked_ports(struct hmapx *tracked_ovn_ports,
     hmapx_add(tracked_ovn_ports, op);
 }
 
+static bool
+tracked_ovn_ports_is_empty(const struct tracked_ovn_ports *trk_ports)
+{
+    return (hmapx_is_empty(&trk_ports->created)
+            && hmapx_is_empty(&trk_ports->updated)
+            && hmapx_is_empty(&trk_ports->deleted));
+}
+
+/* Tracks 'op' as updated, unless it is already tracked as created or
+ * deleted, in which case all of its flows are regenerated or removed
+ * anyway. */
+static void
+add_op_to_northd_tracked_updated_ports(struct tracked_ovn_ports *trk_ports,
+                                       struct ovn_port *op)
+{
+    if (!hmapx_contains(&trk_ports->created, op)
+        && !hmapx_contains(&trk_ports->deleted, op)) {
+        hmapx_add(&trk_ports->updated, op);
+    }
+}
+
 void
 destroy_northd_data_tracked_changes(struct northd_data *nd)
 {
     struct northd_tracked_data *trk_changes = &nd->trk_data;
     destroy_tracked_ovn_ports(&trk_changes->trk_lsps);
+    destroy_tracked_ovn_ports(&trk_changes->trk_lrps);
     destroy_tracked_lbs(&trk_changes->trk_lbs);
     hmapx_clear(&trk_changes->trk_nat_lrs);
     hmapx_clear(&trk_changes->ls_with_changed_lbs);
     hmapx_clear(&trk_changes->ls_with_changed_acls);
+    hmapx_clear(&trk_changes->lr_with_changed_routes);
+    hmapx_clear(&trk_changes->lr_with_changed_policies);
+    hmapx_clear(&trk_changes->ls_with_changed_qos);
+    hmapx_clear(&trk_changes->ls_with_changed_config);
+    hmapx_clear(&trk_changes->ls_with_changed_router_ports);
     trk_changes->type = NORTHD_TRACKED_NONE;
 }
 
@@ -4242,11 +5078,19 @@ init_northd_tracked_data(struct northd_data *nd)
     hmapx_init(&trk_data->trk_lsps.created);
     hmapx_init(&trk_data->trk_lsps.updated);
     hmapx_init(&trk_data->trk_lsps.deleted);
+    hmapx_init(&trk_data->trk_lrps.created);
+    hmapx_init(&trk_data->trk_lrps.updated);
+    hmapx_init(&trk_data->trk_lrps.deleted);
     hmapx_init(&trk_data->trk_lbs.crupdated);
     hmapx_init(&trk_data->trk_lbs.deleted);
     hmapx_init(&trk_data->trk_nat_lrs);
     hmapx_init(&trk_data->ls_with_changed_lbs);
     hmapx_init(&trk_data->ls_with_changed_acls);
+    hmapx_init(&trk_data->lr_with_changed_routes);
+    hmapx_init(&trk_data->lr_with_changed_policies);
+    hmapx_init(&trk_data->ls_with_changed_qos);
+    hmapx_init(&trk_data->ls_with_changed_config);
+    hmapx_init(&trk_data->ls_with_changed_router_ports);
 }
 
 static void
@@ -4257,21 +5101,37 @@ destroy_northd_tracked_data(struct northd_data *nd)
     hmapx_destroy(&trk_data->trk_lsps.created);
     hmapx_destroy(&trk_data->trk_lsps.updated);
     hmapx_destroy(&trk_data->trk_lsps.deleted);
+    hmapx_destroy(&trk_data->trk_lrps.created);
+    hmapx_destroy(&trk_data->trk_lrps.updated);
+    hmapx_destroy(&trk_data->trk_lrps.deleted);
     hmapx_destroy(&trk_data->trk_lbs.crupdated);
     hmapx_destroy(&trk_data->trk_lbs.deleted);
     hmapx_destroy(&trk_data->trk_nat_lrs);
     hmapx_destroy(&trk_data->ls_with_changed_lbs);
     hmapx_destroy(&trk_data->ls_with_changed_acls);
+    hmapx_destroy(&trk_data->lr_with_changed_routes);
+    hmapx_destroy(&trk_data->lr_with_changed_policies);
+    hmapx_destroy(&trk_data->ls_with_changed_qos);
+    hmapx_destroy(&trk_data->ls_with_changed_config);
+    hmapx_destroy(&trk_data->ls_with_changed_router_ports);
 }
 
 /* Check if a changed LSP can be handled incrementally within the I-P engine
- * node en_northd.
+ * node en_northd.  If 'allow_dynamic' is true, "dynamic" addresses are
+ * accepted, which is only supported for newly created ports.
  */
 static bool
-lsp_can_be_inc_processed(const struct nbrec_logical_switch_port *nbsp)
+lsp_can_be_inc_processed__(const struct nbrec_logical_switch_port *nbsp,
+                           bool allow_dynamic)
 {
-    /* Support only normal VIF for now. */
-    if (nbsp->type[0]) {
+    /* Support only normal VIF and router ports for now. */
+    bool is_router = lsp_is_router(nbsp);
+    if (nbsp->type[0] && !is_router) {
+        return false;
+    }
+
+    /* Router ports with proxy ARP are not supported for now. */
+    if (is_router && smap_get(&nbsp->options, "arp_proxy")) {
         return false;
     }
 
@@ -4288,8 +5148,9 @@ lsp_can_be_inc_processed(const struct nbrec_logical_switch_port *nbsp)
     }
 
     for (size_t j = 0; j < nbsp->n_addresses; j++) {
-        /* Dynamic address handling is not supported for now. */
-        if (is_dynamic_lsp_address(nbsp->addresses[j])) {
+        /* Dynamic address handling is only supported for new VIF ports. */
+        if ((!allow_dynamic || is_router)
+            && is_dynamic_lsp_address(nbsp->addresses[j])) {
             return false;
         }
         /* "unknown" address handling is not supported for now.  XXX: Need to
@@ -4303,6 +5164,109 @@ lsp_can_be_inc_processed(const struct nbrec_logical_switch_port *nbsp)
     return true;
 }
 
+static bool
+lsp_can_be_inc_processed(const struct nbrec_logical_switch_port *nbsp)
+{
+    return lsp_can_be_inc_processed__(nbsp, false);
+}
+
+/* Check if an added or deleted LRP can be handled incrementally within the
+ * I-P engine node en_northd. */
+static bool
+lrp_can_be_inc_processed(const struct nbrec_logical_router_port *nbrp)
+{
+    /* Distributed gateway ports have a derived chassisredirect port and
+     * are part of the HA chassis groups. */
+    if (nbrp->n_gateway_chassis || nbrp->ha_chassis_group) {
+        return false;
+    }
+
+    /* Router ports peered directly with another router port, or with
+     * multicast flooding or a redirect type, are not supported for now. */
+    if (nbrp->peer
+        || smap_get_bool(&nbrp->options, "mcast_flood", false)
+        || smap_get(&nbrp->options, "redirect-type")) {
+        return false;
+    }
+
+    /* The flows of the ports with 'gateway_mtu' depend on the other router
+     * ports. */
+    if (smap_get_int(&nbrp->options, "gateway_mtu", 0) > 0) {
+        return false;
+    }
+
+    return true;
+}
+
+/* Returns true if the logical router 'od' resolves the addresses of the
+ * VIF ports of its attached switches through Static_MAC_Binding rows,
+ * instead of a logical flow per address in its ARP resolve stage. */
+static bool
+lr_has_static_neigh_bindings(const struct ovn_datapath *od)
+{
+    return od->nbr && smap_get_bool(&od->nbr->options,
+                                    "static_neigh_bindings", false);
+}
+
+/* Returns true if router ports can be added to or deleted from the logical
+ * router 'od' incrementally, i.e., if none of the data built for the router
+ * as a whole depends on its ports. */
+static bool
+lr_ports_can_be_inc_processed(const struct ovn_datapath *od)
+{
+    /* The reachable load balancer VIPs and the load balancer datapaths of
+     * the peer switches depend on the router ports. */
+    if (od->nbr->n_load_balancer || od->nbr->n_load_balancer_group) {
+        return false;
+    }
+
+    if (od->nbr->n_policies || od->mcast_info.rtr.relay
+        || od->mcast_info.rtr.flood_static) {
+        return false;
+    }
+
+    if (od->lr_group && !sset_is_empty(&od->lr_group->ha_chassis_groups)) {
+        return false;
+    }
+
+    /* The static neighbor bindings of all the switch ports depend on the
+     * router ports. */
+    if (lr_has_static_neigh_bindings(od)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < od->nbr->n_ports; i++) {
+        if (smap_get_int(&od->nbr->ports[i]->options, "gateway_mtu", 0) > 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Returns true if the router type logical switch port 'lsp' and the
+ * logical router port 'lrp' can be connected or disconnected incrementally.
+ * Only switches without other router ports are supported, so that the
+ * flows and the logical router groups built across the router ports of the
+ * switch are not affected. */
+static bool
+router_port_link_can_be_inc_processed(const struct ovn_port *lsp,
+                                      const struct ovn_port *lrp)
+{
+    const struct ovn_datapath *od = lsp->od;
+
+    if (!lrp->nbrp || !lrp->lrp_can_be_inc_processed || is_cr_port(lrp)) {
+        return false;
+    }
+
+    if (od_has_ipam(od) || od->n_localnet_ports || od->has_vtep_lports
+        || od->has_arp_proxy_port) {
+        return false;
+    }
+
+    return lr_ports_can_be_inc_processed(lrp->od);
+}
+
 static bool
 ls_port_has_changed(const struct nbrec_logical_switch_port *new)
 {
@@ -4385,6 +5349,59 @@ ls_port_create(struct ovsdb_idl_txn *ovnsb_txn, struct hmap *ls_ports,
     return op;
 }
 
+/* Claims the addresses of the newly created logical switch port 'op' in
+ * IPAM and assigns its dynamic addresses, if any, the same way a full
+ * recompute does in join_logical_ports() and build_ipam(). */
+static void
+ls_port_update_ipam(struct ovn_datapath *od, struct ovn_port *op)
+{
+    ipam_add_port_addresses(od, op);
+
+    if (!od_has_ipam(od)) {
+        if (op->nbsp->dynamic_addresses) {
+            nbrec_logical_switch_port_set_dynamic_addresses(op->nbsp, NULL);
+        }
+        return;
+    }
+
+    struct ovs_list updates = OVS_LIST_INITIALIZER(&updates);
+    ipam_check_lsp_dynamic_addresses(od, op, &updates);
+    ipam_assign_dynamic_addresses(&updates);
+}
+
+/* Returns true if 'dynamic_addresses' are the dynamic addresses already
+ * assigned to 'op', e.g., when northd sees its own update of the
+ * dynamic_addresses column of the NB Logical_Switch_Port. */
+static bool
+lsp_dynamic_addresses_match(const struct ovn_port *op,
+                            const char *dynamic_addresses)
+{
+    if (!dynamic_addresses || op->n_lsp_addrs <= op->n_lsp_non_router_addrs) {
+        return false;
+    }
+
+    struct lport_addresses laddrs;
+    if (!extract_lsp_addresses(dynamic_addresses, &laddrs)) {
+        return false;
+    }
+
+    const struct lport_addresses *cur =
+        &op->lsp_addrs[op->n_lsp_non_router_addrs];
+    bool match = (eth_addr_equals(laddrs.ea, cur->ea)
+                  && laddrs.n_ipv4_addrs == cur->n_ipv4_addrs
+                  && laddrs.n_ipv6_addrs == cur->n_ipv6_addrs);
+    for (size_t i = 0; match && i < laddrs.n_ipv4_addrs; i++) {
+        match = laddrs.ipv4_addrs[i].addr == cur->ipv4_addrs[i].addr;
+    }
+    for (size_t i = 0; match && i < laddrs.n_ipv6_addrs; i++) {
+        match = IN6_ARE_ADDR_EQUAL(&laddrs.ipv6_addrs[i].addr,
+                                   &cur->ipv6_addrs[i].addr);
+    }
+    destroy_lport_addresses(&laddrs);
+
+    return match;
+}
+
 static bool
 ls_port_reinit(struct ovn_port *op, struct ovsdb_idl_txn *ovnsb_txn,
                 const struct nbrec_logical_switch_port *nbsp,
@@ -4402,6 +5419,113 @@ ls_port_reinit(struct ovn_port *op, struct ovsdb_idl_txn *ovnsb_txn,
                         sbrec_chassis_by_name, sbrec_chassis_by_hostname);
 }
 
+/* Tracks the changes caused by connecting or disconnecting the router type
+ * logical switch port 'lsp' and the logical router port 'lrp'. */
+static void
+track_router_port_link_change(struct northd_tracked_data *trk_data,
+                              struct ovn_port *lsp, struct ovn_port *lrp)
+{
+    /* The flows of all the ports of the switch depend on its router ports,
+     * e.g., the ARP responder and the L2 lookup flows. */
+    struct ovn_port *op;
+    HMAP_FOR_EACH (op, dp_node, &lsp->od->ports) {
+        add_op_to_northd_tracked_updated_ports(&trk_data->trk_lsps, op);
+    }
+    add_op_to_northd_tracked_updated_ports(&trk_data->trk_lrps, lrp);
+
+    /* The pre-ACL and pre-LB flows of the switch skip conntrack for its
+     * router ports, and the NAT flows of the router depend on its
+     * peers. */
+    hmapx_add(&trk_data->ls_with_changed_router_ports, lsp->od);
+    hmapx_add(&trk_data->trk_nat_lrs, lrp->od);
+}
+
+/* Connects the router type logical switch port 'lsp' to the logical router
+ * port 'lrp' the same way join_logical_ports() does.  Returns false if it
+ * can't be done incrementally. */
+static bool
+ls_port_connect_router_port(struct northd_tracked_data *trk_data,
+                            struct ovn_port *lsp, struct ovn_port *lrp)
+{
+    if (lsp->peer || lrp->peer || lsp->od->n_router_ports
+        || !router_port_link_can_be_inc_processed(lsp, lrp)) {
+        return false;
+    }
+
+    ovn_datapath_add_router_port(lsp->od, lsp);
+    ovn_datapath_add_ls_peer(lrp->od, lsp->od);
+    lrp->peer = lsp;
+    lsp->peer = lrp;
+
+    /* Fill lsp->lsp_addrs for the "router" address, which is skipped by
+     * parse_lsp_addrs(). */
+    for (size_t i = 0; i < lsp->nbsp->n_addresses; i++) {
+        if (!strcmp(lsp->nbsp->addresses[i], "router")) {
+            if (extract_lrp_networks(lrp->nbrp,
+                                     &lsp->lsp_addrs[lsp->n_lsp_addrs])) {
+                lsp->n_lsp_addrs++;
+            }
+            break;
+        }
+    }
+
+    track_router_port_link_change(trk_data, lsp, lrp);
+    return true;
+}
+
+/* Disconnects the router type logical switch port 'lsp' from its peer
+ * logical router port.  Returns false if it can't be done
+ * incrementally. */
+static bool
+ls_port_disconnect_router_port(struct northd_tracked_data *trk_data,
+                               struct ovn_port *lsp)
+{
+    struct ovn_port *lrp = lsp->peer;
+    struct ovn_datapath *ls_od = lsp->od;
+    struct ovn_datapath *lr_od = lrp->od;
+
+    if (ls_od->n_router_ports != 1 || ls_od->router_ports[0] != lsp
+        || !router_port_link_can_be_inc_processed(lsp, lrp)) {
+        return false;
+    }
+
+    ls_od->n_router_ports = 0;
+    for (size_t i = 0; i < lr_od->n_ls_peers; i++) {
+        if (lr_od->ls_peers[i] == ls_od) {
+            lr_od->ls_peers[i] = lr_od->ls_peers[--lr_od->n_ls_peers];
+            break;
+        }
+    }
+
+    /* Router type ports don't have dynamic addresses, so any address after
+     * the ones from the "addresses" column is the "router" one. */
+    if (lsp->n_lsp_addrs > lsp->n_lsp_non_router_addrs) {
+        destroy_lport_addresses(&lsp->lsp_addrs[--lsp->n_lsp_addrs]);
+    }
+
+    lrp->peer = NULL;
+    lsp->peer = NULL;
+
+    track_router_port_link_change(trk_data, lsp, lrp);
+    return true;
+}
+
+/* Updates the SB port binding of the router type logical switch port 'op'
+ * after it got connected to or disconnected from its peer, e.g., its type
+ * is "l3gateway" if the peer router is a gateway router. */
+static void
+ls_port_update_router_port_sbrec(struct ovsdb_idl_txn *ovnsb_txn,
+                                 const struct northd_input *ni,
+                                 const struct ovn_port *op)
+{
+    ovn_port_update_sbrec(ovnsb_txn, ni->sbrec_chassis_by_name,
+                          ni->sbrec_chassis_by_hostname, NULL,
+                          ni->sbrec_mirror_table, op, NULL, NULL);
+}
+
+static bool ls_handle_dns_records_changes(const struct sbrec_dns_table *,
+                                          struct ovn_datapath *od);
+
 /* Returns true if the logical switch has changes which can be
  * incrementally handled.
  * Presently supports i-p for the below changes:
@@ -4409,6 +5533,9 @@ ls_port_reinit(struct ovn_port *op, struct ovsdb_idl_txn *ovnsb_txn,
  *    - load balancers.
  *    - load balancer groups.
  *    - ACLs
+ *    - QoS rules
+ *    - DNS records, see ls_handle_dns_records_changes().
+ *    - some of the other_config keys, see ls_handle_other_config_changes().
  */
 static bool
 ls_changes_can_be_handled(
@@ -4421,7 +5548,9 @@ ls_changes_can_be_handled(
             if (col == NBREC_LOGICAL_SWITCH_COL_ACLS ||
                 col == NBREC_LOGICAL_SWITCH_COL_PORTS ||
                 col == NBREC_LOGICAL_SWITCH_COL_LOAD_BALANCER ||
-                col == NBREC_LOGICAL_SWITCH_COL_LOAD_BALANCER_GROUP) {
+                col == NBREC_LOGICAL_SWITCH_COL_LOAD_BALANCER_GROUP ||
+                col == NBREC_LOGICAL_SWITCH_COL_OTHER_CONFIG ||
+                col == NBREC_LOGICAL_SWITCH_COL_QOS_RULES) {
                 continue;
             }
             return false;
@@ -4434,35 +5563,68 @@ ls_changes_can_be_handled(
                                 OVSDB_IDL_CHANGE_MODIFY) > 0) {
         return false;
     }
-    for (size_t i = 0; i < ls->n_dns_records; i++) {
-        if (nbrec_dns_row_get_seqno(ls->dns_records[i],
-                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
-            return false;
-        }
-    }
     for (size_t i = 0; i < ls->n_forwarding_groups; i++) {
         if (nbrec_forwarding_group_row_get_seqno(ls->forwarding_groups[i],
                                 OVSDB_IDL_CHANGE_MODIFY) > 0) {
             return false;
         }
     }
-    for (size_t i = 0; i < ls->n_qos_rules; i++) {
-        if (nbrec_qos_row_get_seqno(ls->qos_rules[i],
-                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
-            return false;
-        }
+    return true;
+}
+
+/* Handles a change to the other_config of the logical switch 'od'.  Only
+ * the changes to the keys in ls_config_incremental_keys[] are supported:
+ * the multicast configuration of 'od' is parsed again and synced to its SB
+ * IP_Multicast record, and its own logical flows are regenerated by the
+ * en_lflow node, see lflow_handle_northd_ls_config_changes().  Returns false
+ * if any other key was added, removed or modified. */
+static bool
+ls_handle_other_config_changes(const struct northd_input *ni,
+                               struct ovn_datapath *od)
+{
+    struct smap ls_config;
+
+    ls_config_init(&ls_config, od->nbs);
+    bool handled = smap_equal(&ls_config, &od->ls_config);
+    smap_destroy(&ls_config);
+    if (!handled) {
+        return false;
+    }
+
+    const struct sbrec_ip_multicast *ip_mcast =
+        ip_mcast_lookup(ni->sbrec_ip_mcast_by_dp, od->sb);
+    if (!ip_mcast) {
+        return false;
     }
+
+    /* The flood flags don't come from the other_config but from the ports
+     * of the switch, keep them. */
+    struct mcast_switch_info *mcast_sw_info = &od->mcast_info.sw;
+    bool flood_relay = mcast_sw_info->flood_relay;
+    bool flood_reports = mcast_sw_info->flood_reports;
+    bool flood_static = mcast_sw_info->flood_static;
+
+    destroy_mcast_info_for_switch_datapath(od);
+    init_mcast_info_for_switch_datapath(od);
+    mcast_sw_info->flood_relay = flood_relay;
+    mcast_sw_info->flood_reports = flood_reports;
+    mcast_sw_info->flood_static = flood_static;
+
+    store_mcast_info_for_switch_datapath(ip_mcast, od);
     return true;
 }
 
+/* Returns true if 'nbsp' has changes other than to column 'ignored_col'. */
 static bool
-check_lsp_changes_other_than_up(const struct nbrec_logical_switch_port *nbsp)
+check_lsp_changes_other_than(
+    const struct nbrec_logical_switch_port *nbsp,
+    enum nbrec_logical_switch_port_column_id ignored_col)
 {
     /* Check if the columns are changed in this row. */
     enum nbrec_logical_switch_port_column_id col;
     for (col = 0; col < NBREC_LOGICAL_SWITCH_PORT_N_COLUMNS; col++) {
         if (nbrec_logical_switch_port_is_updated(nbsp, col) &&
-            col != NBREC_LOGICAL_SWITCH_PORT_COL_UP) {
+            col != ignored_col) {
             return true;
         }
     }
@@ -4493,6 +5655,199 @@ check_lsp_changes_other_than_up(const struct nbrec_logical_switch_port *nbsp)
     return false;
 }
 
+static const struct nbrec_static_mac_binding *
+static_mac_binding_by_port_ip(
+    const struct nbrec_static_mac_binding_table *nbrec_static_mb_table,
+    const char *logical_port, const char *ip)
+{
+    const struct nbrec_static_mac_binding *nb_smb = NULL;
+
+    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (nb_smb, nbrec_static_mb_table) {
+        if (!strcmp(nb_smb->logical_port, logical_port) &&
+            !strcmp(nb_smb->ip, ip)) {
+            break;
+        }
+    }
+
+    return nb_smb;
+}
+
+/* A binding of the IP address of a logical switch port to its MAC address,
+ * in the pipeline of a router attached to the port's switch. */
+struct static_neigh_binding {
+    struct hmap_node hmap_node;
+    const struct ovn_port *lrp; /* Router port that the IP is reachable
+                                 * through. */
+    char *ip;
+    char *mac;
+};
+
+static uint32_t
+static_neigh_binding_hash(const char *logical_port, const char *ip)
+{
+    return hash_string(ip, hash_string(logical_port, 0));
+}
+
+static struct static_neigh_binding *
+static_neigh_binding_find(const struct hmap *bindings,
+                          const char *logical_port, const char *ip)
+{
+    struct static_neigh_binding *b;
+    HMAP_FOR_EACH_WITH_HASH (b, hmap_node,
+                             static_neigh_binding_hash(logical_port, ip),
+                             bindings) {
+        if (!strcmp(b->lrp->key, logical_port) && !strcmp(b->ip, ip)) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static void
+static_neigh_binding_add(struct hmap *bindings, const struct ovn_port *lrp,
+                         const char *ip, const char *mac)
+{
+    if (!find_lrp_member_ip(lrp, ip)
+        || static_neigh_binding_find(bindings, lrp->key, ip)) {
+        return;
+    }
+
+    struct static_neigh_binding *b = xmalloc(sizeof *b);
+    b->lrp = lrp;
+    b->ip = xstrdup(ip);
+    b->mac = xstrdup(mac);
+    hmap_insert(bindings, &b->hmap_node,
+                static_neigh_binding_hash(lrp->key, ip));
+}
+
+static void
+static_neigh_bindings_destroy(struct hmap *bindings)
+{
+    struct static_neigh_binding *b;
+    HMAP_FOR_EACH_POP (b, hmap_node, bindings) {
+        free(b->ip);
+        free(b->mac);
+        free(b);
+    }
+    hmap_destroy(bindings);
+}
+
+/* Adds to 'bindings' the bindings of the addresses of the logical switch
+ * port 'op', if it is a VIF, for the routers attached to its switch that
+ * have static neighbor bindings enabled.  These replace the flows that
+ * build_arp_resolve_flows_for_lsp() adds otherwise. */
+static void
+lsp_collect_static_neigh_bindings(const struct ovn_port *op,
+                                  const struct hmap *lr_ports,
+                                  struct hmap *bindings)
+{
+    if (!op->nbsp || !op->od->n_router_ports || !lsp_is_enabled(op->nbsp)
+        || lsp_is_router(op->nbsp) || !strcmp(op->nbsp->type, "virtual")) {
+        return;
+    }
+
+    for (size_t k = 0; k < op->od->n_router_ports; k++) {
+        struct ovn_port *peer = ovn_port_get_peer(lr_ports,
+                                                  op->od->router_ports[k]);
+        if (!peer || !peer->nbrp || !lr_has_static_neigh_bindings(peer->od)) {
+            continue;
+        }
+
+        for (size_t i = 0; i < op->n_lsp_addrs; i++) {
+            const struct lport_addresses *addrs = &op->lsp_addrs[i];
+
+            for (size_t j = 0; j < addrs->n_ipv4_addrs; j++) {
+                static_neigh_binding_add(bindings, peer,
+                                         addrs->ipv4_addrs[j].addr_s,
+                                         addrs->ea_s);
+            }
+            for (size_t j = 0; j < addrs->n_ipv6_addrs; j++) {
+                static_neigh_binding_add(bindings, peer,
+                                         addrs->ipv6_addrs[j].addr_s,
+                                         addrs->ea_s);
+            }
+        }
+    }
+}
+
+/* Creates or updates the SB Static_MAC_Binding of 'b'.  The binding takes
+ * precedence over the learnt MAC bindings, the same as the logical flows
+ * that it replaces. */
+static void
+static_neigh_binding_sync_sb(
+    struct ovsdb_idl_txn *ovnsb_txn,
+    struct ovsdb_idl_index *sbrec_static_mac_binding_by_lport_ip,
+    const struct static_neigh_binding *b)
+{
+    const struct sbrec_static_mac_binding *mb =
+        static_mac_binding_lookup(sbrec_static_mac_binding_by_lport_ip,
+                                  b->lrp->key, b->ip);
+    if (!mb) {
+        mb = sbrec_static_mac_binding_insert(ovnsb_txn);
+        sbrec_static_mac_binding_set_logical_port(mb, b->lrp->key);
+        sbrec_static_mac_binding_set_ip(mb, b->ip);
+        sbrec_static_mac_binding_set_mac(mb, b->mac);
+        sbrec_static_mac_binding_set_override_dynamic_mac(mb, true);
+        sbrec_static_mac_binding_set_datapath(mb, b->lrp->od->sb);
+        return;
+    }
+
+    if (strcmp(mb->mac, b->mac)) {
+        sbrec_static_mac_binding_set_mac(mb, b->mac);
+    }
+    if (!mb->override_dynamic_mac) {
+        sbrec_static_mac_binding_set_override_dynamic_mac(mb, true);
+    }
+    if (mb->datapath != b->lrp->od->sb) {
+        sbrec_static_mac_binding_set_datapath(mb, b->lrp->od->sb);
+    }
+}
+
+/* Updates the SB Static_MAC_Binding rows of a logical switch port that
+ * changed, from 'old_bindings', the static neighbor bindings that it had
+ * before, to the ones of 'op', or to none if 'op' is NULL because the port
+ * was deleted.  The rows of NB Static_MAC_Bindings are left alone.
+ * Destroys 'old_bindings'. */
+static void
+lsp_update_static_neigh_bindings(struct ovsdb_idl_txn *ovnsb_txn,
+                                 const struct northd_input *ni,
+                                 const struct hmap *lr_ports,
+                                 struct hmap *old_bindings,
+                                 const struct ovn_port *op)
+{
+    struct hmap new_bindings = HMAP_INITIALIZER(&new_bindings);
+    if (op) {
+        lsp_collect_static_neigh_bindings(op, lr_ports, &new_bindings);
+    }
+
+    struct static_neigh_binding *b;
+    HMAP_FOR_EACH (b, hmap_node, &new_bindings) {
+        if (!static_mac_binding_by_port_ip(ni->nbrec_static_mac_binding_table,
+                                           b->lrp->key, b->ip)) {
+            static_neigh_binding_sync_sb(
+                ovnsb_txn, ni->sbrec_static_mac_binding_by_lport_ip, b);
+        }
+    }
+
+    HMAP_FOR_EACH (b, hmap_node, old_bindings) {
+        if (static_neigh_binding_find(&new_bindings, b->lrp->key, b->ip)
+            || static_mac_binding_by_port_ip(
+                   ni->nbrec_static_mac_binding_table, b->lrp->key, b->ip)) {
+            continue;
+        }
+
+        const struct sbrec_static_mac_binding *mb =
+            static_mac_binding_lookup(ni->sbrec_static_mac_binding_by_lport_ip,
+                                      b->lrp->key, b->ip);
+        if (mb) {
+            sbrec_static_mac_binding_delete(mb);
+        }
+    }
+
+    static_neigh_bindings_destroy(old_bindings);
+    static_neigh_bindings_destroy(&new_bindings);
+}
+
 /* Handles logical switch port changes of a changed logical switch.
  * Returns false, if any logical port can't be incrementally handled.
  */
@@ -4502,8 +5857,9 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
                       const struct northd_input *ni,
                       struct northd_data *nd,
                       struct ovn_datapath *od,
-                      struct tracked_ovn_ports *trk_lsps)
+                      struct northd_tracked_data *trk_data)
 {
+    struct tracked_ovn_ports *trk_lsps = &trk_data->trk_lsps;
     bool ls_ports_changed = false;
     if (!nbrec_logical_switch_is_updated(changed_ls,
                                          NBREC_LOGICAL_SWITCH_COL_PORTS)) {
@@ -4537,7 +5893,7 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
         op = ovn_port_find_in_datapath(od, new_nbsp);
 
         if (!op) {
-            if (!lsp_can_be_inc_processed(new_nbsp)) {
+            if (!lsp_can_be_inc_processed__(new_nbsp, true)) {
                 goto fail;
             }
             op = ls_port_create(ovnsb_idl_txn, &nd->ls_ports,
@@ -4548,8 +5904,42 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
             if (!op) {
                 goto fail;
             }
+            ls_port_update_ipam(od, op);
             add_op_to_northd_tracked_ports(&trk_lsps->created, op);
+
+            struct hmap no_bindings = HMAP_INITIALIZER(&no_bindings);
+            lsp_update_static_neigh_bindings(ovnsb_idl_txn, ni, &nd->lr_ports,
+                                             &no_bindings, op);
+
+            struct ovn_port *peer = ovn_port_get_peer(&nd->lr_ports, op);
+            if (peer) {
+                if (!ls_port_connect_router_port(trk_data, op, peer)) {
+                    goto fail;
+                }
+                ls_port_update_router_port_sbrec(ovnsb_idl_txn, ni, op);
+            }
         } else if (ls_port_has_changed(new_nbsp)) {
+            if (!check_lsp_changes_other_than(
+                    new_nbsp, NBREC_LOGICAL_SWITCH_PORT_COL_DYNAMIC_ADDRESSES)
+                && lsp_dynamic_addresses_match(op,
+                                               new_nbsp->dynamic_addresses)) {
+                /* The only change is northd's own update of the dynamic
+                 * addresses, which are already in use. */
+                op->visited = true;
+                continue;
+            }
+
+            if (lsp_is_router(new_nbsp)) {
+                /* Only northd's own update of the "up" column is handled
+                 * for router ports, which doesn't affect their flows. */
+                if (check_lsp_changes_other_than(
+                        new_nbsp, NBREC_LOGICAL_SWITCH_PORT_COL_UP)) {
+                    goto fail;
+                }
+                op->visited = true;
+                continue;
+            }
+
             /* Existing port updated */
             bool temp = false;
             if (lsp_is_type_changed(op->sb, new_nbsp, &temp) ||
@@ -4564,7 +5954,8 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
                 goto fail;
             }
             if (!check_lsp_is_up &&
-                !check_lsp_changes_other_than_up(new_nbsp)) {
+                !check_lsp_changes_other_than(
+                    new_nbsp, NBREC_LOGICAL_SWITCH_PORT_COL_UP)) {
                 /* If the only change is the "up" column while the
                  * "ignore_lsp_down" is set to true, just ignore this
                  * change. */
@@ -4572,12 +5963,17 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
                 continue;
             }
 
+            struct hmap old_bindings = HMAP_INITIALIZER(&old_bindings);
+            lsp_collect_static_neigh_bindings(op, &nd->lr_ports,
+                                              &old_bindings);
+
             uint32_t old_tunnel_key = op->tunnel_key;
             if (!ls_port_reinit(op, ovnsb_idl_txn,
                                 new_nbsp,
                                 od, sb, ni->sbrec_mirror_table,
                                 ni->sbrec_chassis_by_name,
                                 ni->sbrec_chassis_by_hostname)) {
+                static_neigh_bindings_destroy(&old_bindings);
                 if (sb) {
                     sbrec_port_binding_delete(sb);
                 }
@@ -4585,6 +5981,8 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
                 goto fail;
             }
             add_op_to_northd_tracked_ports(&trk_lsps->updated, op);
+            lsp_update_static_neigh_bindings(ovnsb_idl_txn, ni, &nd->lr_ports,
+                                             &old_bindings, op);
 
             if (old_tunnel_key != op->tunnel_key) {
                 delete_fdb_entry(ni->sbrec_fdb_by_dp_and_port, od->tunnel_key,
@@ -4605,9 +6003,19 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
                  * impacted by this deletion. Fallback to recompute. */
                 goto fail;
             }
+            struct hmap old_bindings = HMAP_INITIALIZER(&old_bindings);
+            lsp_collect_static_neigh_bindings(op, &nd->lr_ports,
+                                              &old_bindings);
+            lsp_update_static_neigh_bindings(ovnsb_idl_txn, ni, &nd->lr_ports,
+                                             &old_bindings, NULL);
+
             add_op_to_northd_tracked_ports(&trk_lsps->deleted, op);
+            hmapx_find_and_delete(&trk_lsps->updated, op);
             hmap_remove(&nd->ls_ports, &op->key_node);
             hmap_remove(&od->ports, &op->dp_node);
+            if (op->peer && !ls_port_disconnect_router_port(trk_data, op)) {
+                goto fail;
+            }
             sbrec_port_binding_delete(op->sb);
             delete_fdb_entry(ni->sbrec_fdb_by_dp_and_port, od->tunnel_key,
                                 op->tunnel_key);
@@ -4626,7 +6034,7 @@ ls_handle_lsp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
     if (ls_had_only_router_ports != ls_has_only_router_ports) {
         for (size_t i = 0; i < od->n_router_ports; i++) {
             op = od->router_ports[i];
-            add_op_to_northd_tracked_ports(&trk_lsps->updated, op);
+            add_op_to_northd_tracked_updated_ports(trk_lsps, op);
         }
     }
 
@@ -4656,12 +6064,30 @@ is_ls_acls_changed(const struct nbrec_logical_switch *nbs) {
             || is_acls_seqno_changed(nbs->acls, nbs->n_acls));
 }
 
-/* Return true if changes are handled incrementally, false otherwise.
- * When there are any changes, try to track what's exactly changed and set
- * northd_data->trk_data accordingly.
- *
- * Note: Changes to load balancer and load balancer groups associated with
- * the logical switches are handled separately in the lb_data change handlers.
+static bool
+is_ls_qos_changed(const struct nbrec_logical_switch *nbs)
+{
+    if (nbrec_logical_switch_is_updated(nbs,
+                                        NBREC_LOGICAL_SWITCH_COL_QOS_RULES)) {
+        return true;
+    }
+
+    for (size_t i = 0; i < nbs->n_qos_rules; i++) {
+        if (nbrec_qos_row_get_seqno(nbs->qos_rules[i],
+                                    OVSDB_IDL_CHANGE_MODIFY) > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Return true if changes are handled incrementally, false otherwise.
+ * When there are any changes, try to track what's exactly changed and set
+ * northd_data->trk_data accordingly.
+ *
+ * Note: Changes to load balancer and load balancer groups associated with
+ * the logical switches are handled separately in the lb_data change handlers.
  * */
 bool
 northd_handle_ls_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
@@ -4693,19 +6119,34 @@ northd_handle_ls_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
             goto fail;
         }
 
+        if (!ls_handle_dns_records_changes(ni->sbrec_dns_table, od)) {
+            goto fail;
+        }
+
+        if (nbrec_logical_switch_is_updated(
+                changed_ls, NBREC_LOGICAL_SWITCH_COL_OTHER_CONFIG)) {
+            if (!ls_handle_other_config_changes(ni, od)) {
+                goto fail;
+            }
+            hmapx_add(&trk_data->ls_with_changed_config, od);
+        }
+
         if (!ls_handle_lsp_changes(ovnsb_idl_txn, changed_ls,
-                                   ni, nd, od, &trk_data->trk_lsps)) {
+                                   ni, nd, od, trk_data)) {
             goto fail;
         }
 
         if (is_ls_acls_changed(changed_ls)) {
             hmapx_add(&trk_data->ls_with_changed_acls, od);
         }
+
+        if (is_ls_qos_changed(changed_ls)) {
+            hmapx_add(&trk_data->ls_with_changed_qos, od);
+        }
     }
 
-    if (!hmapx_is_empty(&trk_data->trk_lsps.created)
-        || !hmapx_is_empty(&trk_data->trk_lsps.updated)
-        || !hmapx_is_empty(&trk_data->trk_lsps.deleted)) {
+    if (!tracked_ovn_ports_is_empty(&trk_data->trk_lsps)
+        || !tracked_ovn_ports_is_empty(&trk_data->trk_lrps)) {
         trk_data->type |= NORTHD_TRACKED_PORTS;
     }
 
@@ -4713,6 +6154,22 @@ northd_handle_ls_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
         trk_data->type |= NORTHD_TRACKED_LS_ACLS;
     }
 
+    if (!hmapx_is_empty(&trk_data->ls_with_changed_qos)) {
+        trk_data->type |= NORTHD_TRACKED_LS_QOS;
+    }
+
+    if (!hmapx_is_empty(&trk_data->ls_with_changed_config)) {
+        trk_data->type |= NORTHD_TRACKED_LS_CONFIG;
+    }
+
+    if (!hmapx_is_empty(&trk_data->ls_with_changed_router_ports)) {
+        trk_data->type |= NORTHD_TRACKED_LS_ROUTER_PORTS;
+    }
+
+    if (!hmapx_is_empty(&trk_data->trk_nat_lrs)) {
+        trk_data->type |= NORTHD_TRACKED_LR_NATS;
+    }
+
     return true;
 
 fail:
@@ -4720,11 +6177,48 @@ fail:
     return false;
 }
 
+/* Returns true if the only changes to the router port 'nbrp' are in its
+ * Gateway_Chassis rows or in its HA_Chassis_Group, e.g. a chassis priority
+ * change or a chassis added to or removed from the group. */
+static bool
+lrp_has_only_ha_chassis_changes(const struct nbrec_logical_router_port *nbrp)
+{
+    enum nbrec_logical_router_port_column_id col;
+    for (col = 0; col < NBREC_LOGICAL_ROUTER_PORT_N_COLUMNS; col++) {
+        if (nbrec_logical_router_port_is_updated(nbrp, col)) {
+            return false;
+        }
+    }
+
+    if (nbrp->dhcp_relay
+        && nbrec_dhcp_relay_row_get_seqno(nbrp->dhcp_relay,
+                                          OVSDB_IDL_CHANGE_MODIFY) > 0) {
+        return false;
+    }
+
+    if (nbrp->ha_chassis_group
+        && nbrec_ha_chassis_group_row_get_seqno(nbrp->ha_chassis_group,
+                                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
+        return true;
+    }
+
+    for (size_t i = 0; i < nbrp->n_gateway_chassis; i++) {
+        if (nbrec_gateway_chassis_row_get_seqno(nbrp->gateway_chassis[i],
+                                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* Returns true if the logical router has changes which can be
  * incrementally handled.
  * Presently supports i-p for the below changes:
  *    - load balancers and load balancer groups.
  *    - NAT changes
+ *    - static route changes
+ *    - logical router ports, see lr_handle_lrp_changes().
+ *    - gateway chassis and HA chassis groups of the router ports.
  */
 static bool
 lr_changes_can_be_handled(const struct nbrec_logical_router *lr)
@@ -4740,7 +6234,10 @@ lr_changes_can_be_handled(const struct nbrec_logical_router *lr)
         if (nbrec_logical_router_is_updated(lr, col)) {
             if (col == NBREC_LOGICAL_ROUTER_COL_LOAD_BALANCER
                 || col == NBREC_LOGICAL_ROUTER_COL_LOAD_BALANCER_GROUP
-                || col == NBREC_LOGICAL_ROUTER_COL_NAT) {
+                || col == NBREC_LOGICAL_ROUTER_COL_NAT
+                || col == NBREC_LOGICAL_ROUTER_COL_PORTS
+                || col == NBREC_LOGICAL_ROUTER_COL_POLICIES
+                || col == NBREC_LOGICAL_ROUTER_COL_STATIC_ROUTES) {
                 continue;
             }
             return false;
@@ -4751,7 +6248,8 @@ lr_changes_can_be_handled(const struct nbrec_logical_router *lr)
        XXX: Need a better OVSDB IDL interface for this check. */
     for (size_t i = 0; i < lr->n_ports; i++) {
         if (nbrec_logical_router_port_row_get_seqno(lr->ports[i],
-                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
+                                OVSDB_IDL_CHANGE_MODIFY) > 0
+            && !lrp_has_only_ha_chassis_changes(lr->ports[i])) {
             return false;
         }
     }
@@ -4759,18 +6257,6 @@ lr_changes_can_be_handled(const struct nbrec_logical_router *lr)
                                 OVSDB_IDL_CHANGE_MODIFY) > 0) {
         return false;
     }
-    for (size_t i = 0; i < lr->n_policies; i++) {
-        if (nbrec_logical_router_policy_row_get_seqno(lr->policies[i],
-                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
-            return false;
-        }
-    }
-    for (size_t i = 0; i < lr->n_static_routes; i++) {
-        if (nbrec_logical_router_static_route_row_get_seqno(
-            lr->static_routes[i], OVSDB_IDL_CHANGE_MODIFY) > 0) {
-            return false;
-        }
-    }
     return true;
 }
 
@@ -4796,189 +6282,632 @@ is_lr_nats_changed(const struct nbrec_logical_router *nbr) {
             || is_lr_nats_seqno_changed(nbr));
 }
 
-/* Return true if changes are handled incrementally, false otherwise.
- *
- * Note: Changes to load balancer and load balancer groups associated with
- * the logical routers are handled separately in the lb_data change
- * handler -  northd_handle_lb_data_changes().
- * */
-bool
-northd_handle_lr_changes(const struct northd_input *ni,
-                         struct northd_data *nd)
+static bool
+is_lr_static_routes_seqno_changed(const struct nbrec_logical_router *nbr)
 {
-    const struct nbrec_logical_router *changed_lr;
-
-    NBREC_LOGICAL_ROUTER_TABLE_FOR_EACH_TRACKED (changed_lr,
-                                             ni->nbrec_logical_router_table) {
-        if (nbrec_logical_router_is_new(changed_lr) ||
-            nbrec_logical_router_is_deleted(changed_lr)) {
-            goto fail;
-        }
-
-        /* Presently only able to handle load balancer,
-         * load balancer group changes and NAT changes. */
-        if (!lr_changes_can_be_handled(changed_lr)) {
-            goto fail;
+    for (size_t i = 0; i < nbr->n_static_routes; i++) {
+        if (nbrec_logical_router_static_route_row_get_seqno(
+            nbr->static_routes[i], OVSDB_IDL_CHANGE_MODIFY) > 0) {
+            return true;
         }
+    }
 
-        if (is_lr_nats_changed(changed_lr)) {
-            struct ovn_datapath *od = ovn_datapath_find_(
-                                    &nd->lr_datapaths.datapaths,
-                                    &changed_lr->header_.uuid);
+    return false;
+}
 
-            if (!od) {
-                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-                VLOG_WARN_RL(&rl, "Internal error: a tracked updated LR "
-                            "doesn't exist in lr_datapaths: "UUID_FMT,
-                            UUID_ARGS(&changed_lr->header_.uuid));
-                goto fail;
-            }
+static bool
+is_lr_static_routes_changed(const struct nbrec_logical_router *nbr) {
+    return (nbrec_logical_router_is_updated(
+                nbr, NBREC_LOGICAL_ROUTER_COL_STATIC_ROUTES)
+            || is_lr_static_routes_seqno_changed(nbr));
+}
 
-            hmapx_add(&nd->trk_data.trk_nat_lrs, od);
+static bool
+is_lr_policies_seqno_changed(const struct nbrec_logical_router *nbr)
+{
+    for (size_t i = 0; i < nbr->n_policies; i++) {
+        if (nbrec_logical_router_policy_row_get_seqno(
+            nbr->policies[i], OVSDB_IDL_CHANGE_MODIFY) > 0) {
+            return true;
         }
     }
 
-    if (!hmapx_is_empty(&nd->trk_data.trk_nat_lrs)) {
-        nd->trk_data.type |= NORTHD_TRACKED_LR_NATS;
-    }
-
-    return true;
-fail:
-    destroy_northd_data_tracked_changes(nd);
     return false;
 }
 
-bool
-northd_handle_sb_port_binding_changes(
-    const struct sbrec_port_binding_table *sbrec_port_binding_table,
-    struct hmap *ls_ports, struct hmap *lr_ports)
+static bool
+is_lr_policies_changed(const struct nbrec_logical_router *nbr) {
+    return (nbrec_logical_router_is_updated(
+                nbr, NBREC_LOGICAL_ROUTER_COL_POLICIES)
+            || is_lr_policies_seqno_changed(nbr));
+}
+
+/* Returns true if a NB static MAC binding refers to the logical router
+ * port 'name'.  The SB static MAC bindings are only created during a full
+ * recompute. */
+static bool
+lrp_has_static_mac_bindings(
+    const struct nbrec_static_mac_binding_table *nbrec_static_mb_table,
+    const char *name)
 {
-    const struct sbrec_port_binding *pb;
-    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
-    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, sbrec_port_binding_table) {
-        bool is_router_port = is_pb_router_type(pb);
-        struct ovn_port *op = NULL;
+    const struct nbrec_static_mac_binding *nb_smb;
+    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (nb_smb, nbrec_static_mb_table) {
+        if (!strcmp(nb_smb->logical_port, name)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        if (is_router_port) {
-            /* A router port binding 'pb' can belong to
-             *   - a logical switch port of type router or
-             *   - a logical router port.
-             *
-             * So, first search in lr_ports hmap.  If not found, search in
-             * ls_ports hmap.
-             * */
-            op = ovn_port_find(lr_ports, pb->logical_port);
+/* Returns true if another logical router port has the logical router port
+ * 'name' as its peer. */
+static bool
+lrp_has_lrp_peers(const struct hmap *lr_ports, const char *name)
+{
+    const struct ovn_port *op;
+    HMAP_FOR_EACH (op, key_node, lr_ports) {
+        if (op->nbrp && op->nbrp->peer && !strcmp(op->nbrp->peer, name)) {
+            return true;
         }
+    }
+    return false;
+}
 
-        if (!op) {
-            op = ovn_port_find(ls_ports, pb->logical_port);
+/* Looks for the router type logical switch port whose "router-port" option
+ * refers to the logical router port 'name' and stores it in '*lsp', or NULL
+ * if there is none.  Returns false if more than one switch port refers to
+ * it. */
+static bool
+lrp_find_lsp_peer(const struct hmap *ls_ports, const char *name,
+                  struct ovn_port **lsp)
+{
+    struct ovn_port *op;
 
-            if (op) {
-                is_router_port = false;
-            }
+    *lsp = NULL;
+    HMAP_FOR_EACH (op, key_node, ls_ports) {
+        if (!op->nbsp || !lsp_is_router(op->nbsp)) {
+            continue;
         }
-
-        if (sbrec_port_binding_is_new(pb)) {
-            /* Most likely the PB was created by northd and this is the
-             * notification of that trasaction. So we just update the sb
-             * pointer in northd data. Fallback to recompute otherwise. */
-            if (!op) {
-                VLOG_WARN_RL(&rl, "A port-binding for %s is created but the "
-                            "%s is not found.", pb->logical_port,
-                            is_router_port ? "LRP" : "LSP");
-                return false;
-            }
-            op->sb = pb;
-        } else if (sbrec_port_binding_is_deleted(pb)) {
-            /* Most likely the PB was deleted by northd and this is the
-             * notification of that transaction, and we can ignore in this
-             * case. Fallback to recompute otherwise, to avoid dangling
-             * sb idl pointers and other unexpected behavior. */
-            if (op && op->sb == pb) {
-                VLOG_WARN_RL(&rl, "A port-binding for %s is deleted but the "
-                            "LSP/LRP still exists.", pb->logical_port);
-                return false;
-            }
-        } else {
-            /* The PB is updated.
-             * For an LSP PB it is most likely because of
-             * binding/unbinding to/from a chassis, and we can ignore the
-             * change (updating NB "up" will be handled in the engine node
-             * "sync_from_sb").
-             *
-             * For an LRP PB, it is most likely because of
-             *   - IPv6 prefix delagation updates from ovn-controller.
-             *     This update is handled in "sync_from_sb" node.
-             *   - ha chassis group and this can be ignored.
-             *
-             * All other changes can be ignored.
-             *
-             * Fallback to recompute for anything unexpected. */
-            if (!op) {
-                VLOG_WARN_RL(&rl, "A port-binding for %s is updated but the "
-                            "%s is not found.", pb->logical_port,
-                            is_router_port ? "LRP" : "LSP");
-                return false;
-            }
-            if (op->sb != pb) {
-                VLOG_WARN_RL(&rl, "A port-binding for %s is updated with a new"
-                             "IDL row, which is unusual.", pb->logical_port);
+        const char *router_port = smap_get(&op->nbsp->options,
+                                           "router-port");
+        if (router_port && !strcmp(router_port, name)) {
+            if (*lsp) {
                 return false;
             }
+            *lsp = op;
         }
     }
     return true;
 }
 
-/* Handler for lb_data engine changes.  It does the following
- * For every tracked 'lb' and 'lb_group'
- *  - it creates or deletes the ovn_lb_datapaths/ovn_lb_group_datapaths
- *    from the lb_datapaths hmap and lb_group_datapaths hmap.
- *
- *  - For any changes to a logical switch (in 'trk_lb_data->crupdated_ls_lbs')
- *    due to association of a load balancer (eg. ovn-nbctl ls-lb-add sw0 lb1),
- *    the logical switch datapath is added to the load balancer (represented
- *    by 'struct ovn_lb_datapaths') by calling ovn_lb_datapaths_add_ls().
- * */
-bool
-northd_handle_lb_data_changes(struct tracked_lb_data *trk_lb_data,
-                              struct ovn_datapaths *ls_datapaths,
-                              struct ovn_datapaths *lr_datapaths,
-                              struct hmap *lb_datapaths_map,
-                              struct hmap *lbgrp_datapaths_map,
-                              struct northd_tracked_data *nd_changes)
+/* Deletes the SB MAC bindings learnt on the logical router port 'op', as
+ * cleanup_mac_bindings() does for the deleted ports during a full
+ * recompute. */
+static void
+delete_lrp_mac_bindings(
+    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath,
+    const struct ovn_port *op)
 {
-    if (trk_lb_data->has_health_checks) {
-        /* Fall back to recompute since a tracked load balancer
-         * has health checks configured and I-P is not yet supported
-         * for such load balancers. */
-        return false;
-    }
+    struct hmapx to_delete = HMAPX_INITIALIZER(&to_delete);
+    struct sbrec_mac_binding *target =
+        sbrec_mac_binding_index_init_row(sbrec_mac_binding_by_datapath);
+    sbrec_mac_binding_index_set_datapath(target, op->od->sb);
 
-    /* Fall back to recompute if any load balancer was dissociated from
-     * a load balancer group (but not deleted). */
-    if (trk_lb_data->has_dissassoc_lbs_from_lbgrps) {
-        return false;
+    const struct sbrec_mac_binding *mb;
+    SBREC_MAC_BINDING_FOR_EACH_EQUAL (mb, target,
+                                      sbrec_mac_binding_by_datapath) {
+        if (!strcmp(mb->logical_port, op->key)) {
+            hmapx_add(&to_delete, CONST_CAST(struct sbrec_mac_binding *, mb));
+        }
     }
+    sbrec_mac_binding_index_destroy_row(target);
 
-    /* Fall back to recompute if load balancer groups are deleted. */
-    if (!hmapx_is_empty(&trk_lb_data->deleted_lbgrps)) {
-        return false;
+    struct hmapx_node *hmapx_node;
+    HMAPX_FOR_EACH (hmapx_node, &to_delete) {
+        sbrec_mac_binding_delete(hmapx_node->data);
     }
+    hmapx_destroy(&to_delete);
+}
 
-    /* Fall back to recompute if any load balancer has been disassociated from
-     * a logical switch or router. */
-    if (trk_lb_data->has_dissassoc_lbs_from_od) {
-        return false;
+static struct ovn_port *
+lr_port_create(struct ovsdb_idl_txn *ovnsb_txn, struct hmap *lr_ports,
+               const struct nbrec_logical_router_port *nbrp,
+               struct ovn_datapath *od,
+               const struct lport_addresses *lrp_networks,
+               const struct northd_input *ni)
+{
+    struct ovn_port *op = ovn_port_create(lr_ports, nbrp->name, NULL, nbrp,
+                                          NULL);
+    op->lrp_networks = *lrp_networks;
+    op->od = od;
+    hmap_insert(&od->ports, &op->dp_node, hmap_node_hash(&op->key_node));
+
+    if (!ovn_port_assign_requested_tnl_id(op)
+        || !ovn_port_allocate_key(op)) {
+        ovn_port_destroy(lr_ports, op);
+        return NULL;
     }
 
-    /* Fall back to recompute if any logical switch or router was deleted which
-     * had load balancer or lb group association. */
-    if (!hmapx_is_empty(&trk_lb_data->deleted_od_lb_data)) {
+    op->sb = sbrec_port_binding_insert(ovnsb_txn);
+    sbrec_port_binding_set_logical_port(op->sb, op->key);
+    ovn_port_update_sbrec(ovnsb_txn, ni->sbrec_chassis_by_name,
+                          ni->sbrec_chassis_by_hostname, NULL,
+                          ni->sbrec_mirror_table, op, NULL, NULL);
+    return op;
+}
+
+/* Handles the logical router ports added to or deleted from the logical
+ * router 'od', and connects them to or disconnects them from their peer
+ * logical switch ports.  Returns false if any of them can't be handled
+ * incrementally.
+ *
+ * Only router ports without gateway chassis and without a peer router
+ * port are supported, on routers whose ports don't affect the data built
+ * for the router as a whole (see lr_ports_can_be_inc_processed()). */
+static bool
+lr_handle_lrp_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
+                      const struct nbrec_logical_router *changed_lr,
+                      const struct northd_input *ni,
+                      struct northd_data *nd,
+                      struct ovn_datapath *od)
+{
+    struct northd_tracked_data *trk_data = &nd->trk_data;
+    struct tracked_ovn_ports *trk_lrps = &trk_data->trk_lrps;
+    bool lrps_changed = false;
+
+    if (!lr_ports_can_be_inc_processed(od)) {
         return false;
     }
 
-    /* Fall back to recompute if any load balancer group has been disassociated
+    struct ovn_port *op;
+    HMAP_FOR_EACH (op, dp_node, &od->ports) {
+        op->visited = false;
+    }
+
+    for (size_t i = 0; i < changed_lr->n_ports; i++) {
+        const struct nbrec_logical_router_port *nbrp = changed_lr->ports[i];
+
+        op = ovn_port_find(&nd->lr_ports, nbrp->name);
+        if (op && op->nbrp == nbrp && op->od == od) {
+            op->visited = true;
+            continue;
+        }
+
+        /* Duplicate port names are left to a full recompute. */
+        if (op || ovn_port_find(&nd->ls_ports, nbrp->name)
+            || !lrp_can_be_inc_processed(nbrp)) {
+            return false;
+        }
+
+        struct lport_addresses lrp_networks;
+        if (!extract_lrp_networks(nbrp, &lrp_networks)) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
+            VLOG_WARN_RL(&rl, "bad 'mac' %s", nbrp->mac);
+            destroy_lport_addresses(&lrp_networks);
+            continue;
+        }
+
+        /* Router ports without networks are ignored, the same as in
+         * join_logical_ports(). */
+        if (!lrp_networks.n_ipv4_addrs && !lrp_networks.n_ipv6_addrs) {
+            destroy_lport_addresses(&lrp_networks);
+            continue;
+        }
+
+        struct ovn_port *lsp;
+        if (lrp_has_static_mac_bindings(ni->nbrec_static_mac_binding_table,
+                                        nbrp->name)
+            || lrp_has_lrp_peers(&nd->lr_ports, nbrp->name)
+            || !lrp_find_lsp_peer(&nd->ls_ports, nbrp->name, &lsp)) {
+            destroy_lport_addresses(&lrp_networks);
+            return false;
+        }
+
+        op = lr_port_create(ovnsb_idl_txn, &nd->lr_ports, nbrp, od,
+                            &lrp_networks, ni);
+        if (!op) {
+            return false;
+        }
+        add_op_to_northd_tracked_ports(&trk_lrps->created, op);
+        op->visited = true;
+        lrps_changed = true;
+
+        if (lsp) {
+            if (!ls_port_connect_router_port(trk_data, lsp, op)) {
+                return false;
+            }
+            ls_port_update_router_port_sbrec(ovnsb_idl_txn, ni, lsp);
+        }
+    }
+
+    /* Check for deleted ports. */
+    HMAP_FOR_EACH_SAFE (op, dp_node, &od->ports) {
+        if (op->visited) {
+            continue;
+        }
+        if (!op->lrp_can_be_inc_processed
+            || lrp_has_lrp_peers(&nd->lr_ports, op->key)) {
+            return false;
+        }
+
+        struct ovn_port *lsp = op->peer;
+        if (lsp) {
+            if (!ls_port_disconnect_router_port(trk_data, lsp)) {
+                return false;
+            }
+            ls_port_update_router_port_sbrec(ovnsb_idl_txn, ni, lsp);
+        }
+
+        hmapx_find_and_delete(&trk_lrps->updated, op);
+        add_op_to_northd_tracked_ports(&trk_lrps->deleted, op);
+        hmap_remove(&nd->lr_ports, &op->key_node);
+        hmap_remove(&od->ports, &op->dp_node);
+        delete_lrp_mac_bindings(ni->sbrec_mac_binding_by_datapath, op);
+        sbrec_port_binding_delete(op->sb);
+        lrps_changed = true;
+    }
+
+    if (lrps_changed) {
+        sset_clear(&od->router_ips);
+        HMAP_FOR_EACH (op, dp_node, &od->ports) {
+            lrp_add_router_ips(op);
+        }
+
+        /* The NAT data uses the router IPs, and the static routes are
+         * resolved against the networks of the router ports. */
+        hmapx_add(&trk_data->trk_nat_lrs, od);
+        hmapx_add(&trk_data->lr_with_changed_routes, od);
+    }
+
+    return true;
+}
+
+static bool
+cr_port_has_multiple_ha_chassis(const struct ovn_port *crp)
+{
+    return crp->sb->ha_chassis_group
+           && crp->sb->ha_chassis_group->n_ha_chassis > 1;
+}
+
+/* Syncs the SB HA chassis groups of the distributed gateway ports of
+ * 'changed_lr' whose gateway chassis or HA chassis group changed.
+ *
+ * The logical flows of the chassis-redirect ports only refer to the port
+ * itself (is_chassis_resident()), and so don't depend on the chassis or
+ * their priorities.  The only northd data built from the groups is the set
+ * of HA chassis groups with more than one chassis of the logical router
+ * groups, so false is returned if that changes. */
+static bool
+lr_handle_ha_chassis_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
+                             const struct nbrec_logical_router *changed_lr,
+                             const struct northd_input *ni,
+                             struct northd_data *nd)
+{
+    for (size_t i = 0; i < changed_lr->n_ports; i++) {
+        const struct nbrec_logical_router_port *nbrp = changed_lr->ports[i];
+
+        if (nbrec_logical_router_port_row_get_seqno(
+                nbrp, OVSDB_IDL_CHANGE_MODIFY) <= 0) {
+            continue;
+        }
+
+        struct ovn_port *op = ovn_port_find(&nd->lr_ports, nbrp->name);
+        if (!op || op->nbrp != nbrp || !op->cr_port || !op->cr_port->sb) {
+            return false;
+        }
+
+        struct ovn_port *crp = op->cr_port;
+        bool had_multiple_chassis = cr_port_has_multiple_ha_chassis(crp);
+
+        cr_port_sync_ha_chassis_group(ovnsb_idl_txn,
+                                      ni->sbrec_chassis_by_name,
+                                      ni->sbrec_ha_chassis_grp_by_name,
+                                      crp, NULL);
+        if (had_multiple_chassis != cr_port_has_multiple_ha_chassis(crp)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+is_lr_ha_chassis_changed(const struct nbrec_logical_router *nbr)
+{
+    for (size_t i = 0; i < nbr->n_ports; i++) {
+        if (nbrec_logical_router_port_row_get_seqno(nbr->ports[i],
+                                OVSDB_IDL_CHANGE_MODIFY) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Return true if changes are handled incrementally, false otherwise.
+ *
+ * Note: Changes to load balancer and load balancer groups associated with
+ * the logical routers are handled separately in the lb_data change
+ * handler -  northd_handle_lb_data_changes().
+ * */
+bool
+northd_handle_lr_changes(struct ovsdb_idl_txn *ovnsb_idl_txn,
+                         const struct northd_input *ni,
+                         struct northd_data *nd)
+{
+    const struct nbrec_logical_router *changed_lr;
+
+    NBREC_LOGICAL_ROUTER_TABLE_FOR_EACH_TRACKED (changed_lr,
+                                             ni->nbrec_logical_router_table) {
+        if (nbrec_logical_router_is_new(changed_lr) ||
+            nbrec_logical_router_is_deleted(changed_lr)) {
+            goto fail;
+        }
+
+        /* Presently only able to handle load balancer,
+         * load balancer group, NAT, static route, routing policy, router
+         * port and gateway chassis changes. */
+        if (!lr_changes_can_be_handled(changed_lr)) {
+            goto fail;
+        }
+
+        bool nats_changed = is_lr_nats_changed(changed_lr);
+        bool routes_changed = is_lr_static_routes_changed(changed_lr);
+        bool policies_changed = is_lr_policies_changed(changed_lr);
+        bool ports_changed = nbrec_logical_router_is_updated(
+            changed_lr, NBREC_LOGICAL_ROUTER_COL_PORTS);
+        bool ha_chassis_changed = is_lr_ha_chassis_changed(changed_lr);
+        if (!nats_changed && !routes_changed && !policies_changed
+            && !ports_changed && !ha_chassis_changed) {
+            continue;
+        }
+
+        struct ovn_datapath *od = ovn_datapath_find_(
+                                &nd->lr_datapaths.datapaths,
+                                &changed_lr->header_.uuid);
+
+        if (!od) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
+            VLOG_WARN_RL(&rl, "Internal error: a tracked updated LR "
+                        "doesn't exist in lr_datapaths: "UUID_FMT,
+                        UUID_ARGS(&changed_lr->header_.uuid));
+            goto fail;
+        }
+
+        if (nats_changed) {
+            hmapx_add(&nd->trk_data.trk_nat_lrs, od);
+        }
+
+        if (routes_changed) {
+            hmapx_add(&nd->trk_data.lr_with_changed_routes, od);
+        }
+
+        if (policies_changed) {
+            hmapx_add(&nd->trk_data.lr_with_changed_policies, od);
+        }
+
+        if (ports_changed
+            && !lr_handle_lrp_changes(ovnsb_idl_txn, changed_lr, ni, nd,
+                                      od)) {
+            goto fail;
+        }
+
+        if (ha_chassis_changed
+            && !lr_handle_ha_chassis_changes(ovnsb_idl_txn, changed_lr, ni,
+                                             nd)) {
+            goto fail;
+        }
+    }
+
+    if (!tracked_ovn_ports_is_empty(&nd->trk_data.trk_lsps)
+        || !tracked_ovn_ports_is_empty(&nd->trk_data.trk_lrps)) {
+        nd->trk_data.type |= NORTHD_TRACKED_PORTS;
+    }
+
+    if (!hmapx_is_empty(&nd->trk_data.ls_with_changed_router_ports)) {
+        nd->trk_data.type |= NORTHD_TRACKED_LS_ROUTER_PORTS;
+    }
+
+    if (!hmapx_is_empty(&nd->trk_data.trk_nat_lrs)) {
+        nd->trk_data.type |= NORTHD_TRACKED_LR_NATS;
+    }
+
+    if (!hmapx_is_empty(&nd->trk_data.lr_with_changed_routes)) {
+        nd->trk_data.type |= NORTHD_TRACKED_LR_ROUTES;
+    }
+
+    if (!hmapx_is_empty(&nd->trk_data.lr_with_changed_policies)) {
+        nd->trk_data.type |= NORTHD_TRACKED_LR_POLICIES;
+    }
+
+    return true;
+fail:
+    destroy_northd_data_tracked_changes(nd);
+    return false;
+}
+
+/* The SB HA_Chassis_Group table is owned by northd, which updates its rows
+ * when syncing the gateway chassis (see cr_port_sync_ha_chassis_group())
+ * and their 'ref_chassis'.  The only northd data built from the groups is
+ * the set of HA chassis groups with more than one chassis of the logical
+ * router groups, see build_lrouter_groups__().  Updates to the chassis of
+ * existing groups, or to their priorities, are handled by checking that
+ * this set is still accurate, false is returned if it isn't.  Groups
+ * created, deleted or renamed are only handled by a recompute. */
+bool
+northd_handle_sb_ha_chassis_group_changes(
+    const struct sbrec_ha_chassis_group_table *sbrec_ha_chassis_group_table,
+    const struct ovn_datapaths *lr_datapaths)
+{
+    struct hmapx updated_groups = HMAPX_INITIALIZER(&updated_groups);
+    bool handled = true;
+
+    const struct sbrec_ha_chassis_group *ha_grp;
+    SBREC_HA_CHASSIS_GROUP_TABLE_FOR_EACH_TRACKED (
+            ha_grp, sbrec_ha_chassis_group_table) {
+        if (sbrec_ha_chassis_group_is_new(ha_grp)
+            || sbrec_ha_chassis_group_is_deleted(ha_grp)
+            || sbrec_ha_chassis_group_is_updated(
+                   ha_grp, SBREC_HA_CHASSIS_GROUP_COL_NAME)) {
+            handled = false;
+            goto out;
+        }
+        hmapx_add(&updated_groups, CONST_CAST(void *, ha_grp));
+    }
+    if (hmapx_is_empty(&updated_groups)) {
+        goto out;
+    }
+
+    const struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, &lr_datapaths->datapaths) {
+        if (!od->lr_group) {
+            continue;
+        }
+        for (size_t i = 0; i < od->n_l3dgw_ports; i++) {
+            const struct ovn_port *crp = od->l3dgw_ports[i]->cr_port;
+
+            if (!crp || !crp->sb || !crp->sb->ha_chassis_group
+                || !hmapx_contains(&updated_groups,
+                                   crp->sb->ha_chassis_group)) {
+                continue;
+            }
+            if (cr_port_has_multiple_ha_chassis(crp)
+                != sset_contains(&od->lr_group->ha_chassis_groups,
+                                 crp->sb->ha_chassis_group->name)) {
+                handled = false;
+                goto out;
+            }
+        }
+    }
+
+out:
+    hmapx_destroy(&updated_groups);
+    return handled;
+}
+
+bool
+northd_handle_sb_port_binding_changes(
+    const struct sbrec_port_binding_table *sbrec_port_binding_table,
+    struct hmap *ls_ports, struct hmap *lr_ports)
+{
+    const struct sbrec_port_binding *pb;
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (pb, sbrec_port_binding_table) {
+        bool is_router_port = is_pb_router_type(pb);
+        struct ovn_port *op = NULL;
+
+        if (is_router_port) {
+            /* A router port binding 'pb' can belong to
+             *   - a logical switch port of type router or
+             *   - a logical router port.
+             *
+             * So, first search in lr_ports hmap.  If not found, search in
+             * ls_ports hmap.
+             * */
+            op = ovn_port_find(lr_ports, pb->logical_port);
+        }
+
+        if (!op) {
+            op = ovn_port_find(ls_ports, pb->logical_port);
+
+            if (op) {
+                is_router_port = false;
+            }
+        }
+
+        if (sbrec_port_binding_is_new(pb)) {
+            /* Most likely the PB was created by northd and this is the
+             * notification of that trasaction. So we just update the sb
+             * pointer in northd data. Fallback to recompute otherwise. */
+            if (!op) {
+                VLOG_WARN_RL(&rl, "A port-binding for %s is created but the "
+                            "%s is not found.", pb->logical_port,
+                            is_router_port ? "LRP" : "LSP");
+                return false;
+            }
+            op->sb = pb;
+        } else if (sbrec_port_binding_is_deleted(pb)) {
+            /* Most likely the PB was deleted by northd and this is the
+             * notification of that transaction, and we can ignore in this
+             * case. Fallback to recompute otherwise, to avoid dangling
+             * sb idl pointers and other unexpected behavior. */
+            if (op && op->sb == pb) {
+                VLOG_WARN_RL(&rl, "A port-binding for %s is deleted but the "
+                            "LSP/LRP still exists.", pb->logical_port);
+                return false;
+            }
+        } else {
+            /* The PB is updated.
+             * For an LSP PB it is most likely because of
+             * binding/unbinding to/from a chassis, and we can ignore the
+             * change (updating NB "up" will be handled in the engine node
+             * "sync_from_sb").
+             *
+             * For an LRP PB, it is most likely because of
+             *   - IPv6 prefix delagation updates from ovn-controller.
+             *     This update is handled in "sync_from_sb" node.
+             *   - ha chassis group and this can be ignored.
+             *
+             * All other changes can be ignored.
+             *
+             * Fallback to recompute for anything unexpected. */
+            if (!op) {
+                VLOG_WARN_RL(&rl, "A port-binding for %s is updated but the "
+                            "%s is not found.", pb->logical_port,
+                            is_router_port ? "LRP" : "LSP");
+                return false;
+            }
+            if (op->sb != pb) {
+                VLOG_WARN_RL(&rl, "A port-binding for %s is updated with a new"
+                             "IDL row, which is unusual.", pb->logical_port);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Handler for lb_data engine changes.  It does the following
+ * For every tracked 'lb' and 'lb_group'
+ *  - it creates or deletes the ovn_lb_datapaths/ovn_lb_group_datapaths
+ *    from the lb_datapaths hmap and lb_group_datapaths hmap.
+ *
+ *  - For any changes to a logical switch (in 'trk_lb_data->crupdated_ls_lbs')
+ *    due to association of a load balancer (eg. ovn-nbctl ls-lb-add sw0 lb1),
+ *    the logical switch datapath is added to the load balancer (represented
+ *    by 'struct ovn_lb_datapaths') by calling ovn_lb_datapaths_add_ls().
+ * */
+bool
+northd_handle_lb_data_changes(struct tracked_lb_data *trk_lb_data,
+                              struct ovn_datapaths *ls_datapaths,
+                              struct ovn_datapaths *lr_datapaths,
+                              struct hmap *lb_datapaths_map,
+                              struct hmap *lbgrp_datapaths_map,
+                              struct northd_tracked_data *nd_changes)
+{
+    /* Fall back to recompute if any load balancer was dissociated from
+     * a load balancer group (but not deleted). */
+    if (trk_lb_data->has_dissassoc_lbs_from_lbgrps) {
+        return false;
+    }
+
+    /* Fall back to recompute if load balancer groups are deleted. */
+    if (!hmapx_is_empty(&trk_lb_data->deleted_lbgrps)) {
+        return false;
+    }
+
+    /* Fall back to recompute if any load balancer has been disassociated from
+     * a logical switch or router. */
+    if (trk_lb_data->has_dissassoc_lbs_from_od) {
+        return false;
+    }
+
+    /* Fall back to recompute if any logical switch or router was deleted which
+     * had load balancer or lb group association. */
+    if (!hmapx_is_empty(&trk_lb_data->deleted_od_lb_data)) {
+        return false;
+    }
+
+    /* Fall back to recompute if any load balancer group has been disassociated
      * from a logical switch or router. */
     if (trk_lb_data->has_dissassoc_lbgrps_from_od) {
         return false;
@@ -5010,7 +6939,10 @@ northd_handle_lb_data_changes(struct tracked_lb_data *trk_lb_data,
 
         hmap_remove(lb_datapaths_map, &lb_dps->hmap_node);
 
-        /* Add the deleted lb to the northd tracked data. */
+        /* Add the deleted lb to the northd tracked data.  It may have been
+         * tracked as updated because of the status of its service
+         * monitors. */
+        hmapx_find_and_delete(&nd_changes->trk_lbs.crupdated, lb_dps);
         hmapx_add(&nd_changes->trk_lbs.deleted, lb_dps);
     }
 
@@ -5148,28 +7080,26 @@ northd_handle_lb_data_changes(struct tracked_lb_data *trk_lb_data,
                                                 lb_uuid);
         ovs_assert(lbgrp_dps);
 
+        if (hmapx_is_empty(&crupdated_lbgrp->assoc_lbs)) {
+            continue;
+        }
+
         struct hmapx_node *hnode;
         HMAPX_FOR_EACH (hnode, &crupdated_lbgrp->assoc_lbs) {
             lb = hnode->data;
             lb_uuid = &lb->nlb->header_.uuid;
             lb_dps = ovn_lb_datapaths_find(lb_datapaths_map, lb_uuid);
             ovs_assert(lb_dps);
-            for (size_t i = 0; i < lbgrp_dps->n_lr; i++) {
-                od = lbgrp_dps->lr[i];
-                ovn_lb_datapaths_add_lr(lb_dps, 1, &od);
-            }
-
-            for (size_t i = 0; i < lbgrp_dps->n_ls; i++) {
-               od = lbgrp_dps->ls[i];
-                ovn_lb_datapaths_add_ls(lb_dps, 1, &od);
-
-                /* Add the ls datapath to the northd tracked data. */
-                hmapx_add(&nd_changes->ls_with_changed_lbs, od);
-            }
+            ovn_lb_datapaths_add_lb_group(lb_dps, lbgrp_dps);
 
             /* Add the lb to the northd tracked data. */
             hmapx_add(&nd_changes->trk_lbs.crupdated, lb_dps);
         }
+
+        for (size_t i = 0; i < lbgrp_dps->n_ls; i++) {
+            /* Add the ls datapath to the northd tracked data. */
+            hmapx_add(&nd_changes->ls_with_changed_lbs, lbgrp_dps->ls[i]);
+        }
     }
 
     if (!hmapx_is_empty(&nd_changes->trk_lbs.crupdated)
@@ -5337,6 +7267,9 @@ struct ovn_igmp_group {
     struct multicast_group mcgroup;
 
     struct ovs_list entries; /* List of SB entries for this group. */
+
+    /* Logical flows of the group, owned by 'struct igmp_lflow_ref'. */
+    struct lflow_ref *lflow_ref;
 };
 
 static uint32_t
@@ -5393,6 +7326,7 @@ ovn_igmp_group_add(struct ovsdb_idl_index *sbrec_mcast_group_by_name_dp,
         }
         igmp_group->mcgroup.name = address_s;
         ovs_list_init(&igmp_group->entries);
+        igmp_group->lflow_ref = NULL;
 
         hmap_insert(igmp_groups, &igmp_group->hmap_node,
                     ovn_igmp_group_hash(datapath, address));
@@ -5530,6 +7464,84 @@ ovn_igmp_group_destroy(struct hmap *igmp_groups,
     }
 }
 
+static void
+ovn_igmp_groups_destroy(struct hmap *igmp_groups)
+{
+    struct ovn_igmp_group *igmp_group;
+
+    HMAP_FOR_EACH_SAFE (igmp_group, hmap_node, igmp_groups) {
+        ovn_igmp_group_destroy(igmp_groups, igmp_group);
+    }
+    hmap_destroy(igmp_groups);
+}
+
+/* The logical flows of an IGMP group.  Unlike 'struct ovn_igmp_group',
+ * which is rebuilt from the SB IGMP_Group table every time, these are kept
+ * across the lflow engine runs, so that only the flows of the IGMP groups
+ * that got created or deleted need to be regenerated.
+ *
+ * The datapaths are only destroyed by a northd recompute, which also
+ * triggers an lflow recompute that rebuilds all of them. */
+struct igmp_lflow_ref {
+    struct hmap_node hmap_node; /* Index on 'datapath' and 'address'. */
+    const struct ovn_datapath *datapath;
+    struct in6_addr address;
+    struct lflow_ref *lflow_ref;
+    bool stale;
+};
+
+static struct igmp_lflow_ref *
+igmp_lflow_ref_find(const struct hmap *igmp_lflow_refs,
+                    const struct ovn_datapath *datapath,
+                    const struct in6_addr *address)
+{
+    struct igmp_lflow_ref *ref;
+
+    HMAP_FOR_EACH_WITH_HASH (ref, hmap_node,
+                             ovn_igmp_group_hash(datapath, address),
+                             igmp_lflow_refs) {
+        if (ref->datapath == datapath &&
+                ipv6_addr_equals(&ref->address, address)) {
+            return ref;
+        }
+    }
+    return NULL;
+}
+
+static struct igmp_lflow_ref *
+igmp_lflow_ref_add(struct hmap *igmp_lflow_refs,
+                   const struct ovn_igmp_group *igmp_group)
+{
+    struct igmp_lflow_ref *ref = xmalloc(sizeof *ref);
+
+    ref->datapath = igmp_group->datapath;
+    ref->address = igmp_group->address;
+    ref->lflow_ref = lflow_ref_create();
+    ref->stale = false;
+    hmap_insert(igmp_lflow_refs, &ref->hmap_node,
+                ovn_igmp_group_hash(ref->datapath, &ref->address));
+    return ref;
+}
+
+static void
+igmp_lflow_ref_destroy(struct hmap *igmp_lflow_refs,
+                       struct igmp_lflow_ref *ref)
+{
+    hmap_remove(igmp_lflow_refs, &ref->hmap_node);
+    lflow_ref_destroy(ref->lflow_ref);
+    free(ref);
+}
+
+void
+igmp_lflow_refs_destroy(struct hmap *igmp_lflow_refs)
+{
+    struct igmp_lflow_ref *ref;
+
+    HMAP_FOR_EACH_SAFE (ref, hmap_node, igmp_lflow_refs) {
+        igmp_lflow_ref_destroy(igmp_lflow_refs, ref);
+    }
+}
+
 /* Logical flow generation.
  *
  * This code generates the Logical_Flow table in the southbound database, as a
@@ -5538,19 +7550,6 @@ ovn_igmp_group_destroy(struct hmap *igmp_groups,
 
 int parallelization_state = STATE_NULL;
 
-
-/* This thread-local var is used for parallel lflow building when dp-groups is
- * enabled. It maintains the number of lflows inserted by the current thread to
- * the shared lflow hmap in the current iteration. It is needed because the
- * lflow_hash_lock cannot protect current update of the hmap's size (hmap->n)
- * by different threads.
- *
- * When all threads complete the tasks of an iteration, the counters of all the
- * threads are collected to fix the lflow hmap's size (by the function
- * fix_flow_map_size()).
- * */
-thread_local size_t thread_lflow_counter = 0;
-
 static bool
 build_dhcpv4_action(struct ovn_port *op, ovs_be32 offer_ip,
                     struct ds *options_action, struct ds *response_action,
@@ -5814,36 +7813,27 @@ build_lswitch_port_sec_op(struct ovn_port *op, struct lflow_table *lflows,
 }
 
 static void
-build_lswitch_learn_fdb_op(
-    struct ovn_port *op, struct lflow_table *lflows,
-    struct ds *actions, struct ds *match)
+build_lswitch_learn_fdb_op(struct ovn_port *op, struct lflow_table *lflows)
 {
     ovs_assert(op->nbsp);
 
     if (!op->n_ps_addrs && op->has_unknown && (!strcmp(op->nbsp->type, "") ||
         (lsp_is_localnet(op->nbsp) && localnet_can_learn_mac(op->nbsp)))) {
-        ds_clear(match);
-        ds_clear(actions);
-        ds_put_format(match, "inport == %s", op->json_key);
-        if (lsp_is_localnet(op->nbsp)) {
-            ds_put_cstr(actions, "flags.localnet = 1; ");
-        }
-        ds_put_format(actions, REGBIT_LKUP_FDB
-                      " = lookup_fdb(inport, eth.src); next;");
-        ovn_lflow_add_with_lport_and_hint(lflows, op->od,
-                                          S_SWITCH_IN_LOOKUP_FDB, 100,
-                                          ds_cstr(match), ds_cstr(actions),
-                                          op->key, &op->nbsp->header_,
-                                          op->lflow_ref);
+        const char *lookup_fdb = REGBIT_LKUP_FDB
+                                 " = lookup_fdb(inport, eth.src); next;";
+        struct ovn_fmt actions = (lsp_is_localnet(op->nbsp)
+                                  ? OVN_FMT("flags.localnet = 1; %s",
+                                            lookup_fdb)
+                                  : OVN_FMT_STR(lookup_fdb));
+        ovn_lflow_add_fmt(lflows, op->od, S_SWITCH_IN_LOOKUP_FDB, 100,
+                          OVN_FMT("inport == %s", op->json_key), actions,
+                          op->key, &op->nbsp->header_, op->lflow_ref);
 
-        ds_put_cstr(match, " && "REGBIT_LKUP_FDB" == 0");
-        ds_clear(actions);
-        ds_put_cstr(actions, "put_fdb(inport, eth.src); next;");
-        ovn_lflow_add_with_lport_and_hint(lflows, op->od, S_SWITCH_IN_PUT_FDB,
-                                          100, ds_cstr(match),
-                                          ds_cstr(actions), op->key,
-                                          &op->nbsp->header_,
-                                          op->lflow_ref);
+        ovn_lflow_add_fmt(lflows, op->od, S_SWITCH_IN_PUT_FDB, 100,
+                          OVN_FMT("inport == %s && "REGBIT_LKUP_FDB" == 0",
+                                  op->json_key),
+                          OVN_FMT_STR("put_fdb(inport, eth.src); next;"),
+                          op->key, &op->nbsp->header_, op->lflow_ref);
     }
 }
 
@@ -6868,6 +8858,7 @@ build_acls(const struct ls_stateful_record *ls_stateful_rec,
            struct lflow_table *lflows,
            const struct ls_port_group_table *ls_port_groups,
            const struct shash *meter_groups,
+           bool with_pg_acls,
            struct lflow_ref *lflow_ref)
 {
     const char *default_acl_action = default_acl_drop
@@ -7071,8 +9062,11 @@ build_acls(const struct ls_stateful_record *ls_stateful_rec,
                      &match, &actions, lflow_ref);
     }
 
-    const struct ls_port_group *ls_pg =
-        ls_port_group_table_find(ls_port_groups, od->nbs);
+    /* Port group ACLs, unless the caller builds them for all the logical
+     * switches of the port group at once with build_port_group_acls(). */
+    const struct ls_port_group *ls_pg = with_pg_acls
+        ? ls_port_group_table_find(ls_port_groups, od->nbs)
+        : NULL;
     if (ls_pg) {
         const struct ls_port_group_record *ls_pg_rec;
         HMAP_FOR_EACH (ls_pg_rec, key_node, &ls_pg->nb_pgs) {
@@ -7130,129 +9124,175 @@ build_acls(const struct ls_stateful_record *ls_stateful_rec,
 #define QOS_MAX_DSCP 63
 
 static void
-build_qos(struct ovn_datapath *od, struct lflow_table *lflows,
-          struct lflow_ref *lflow_ref) {
+build_qos_rule_flows(struct ovn_datapath *od, const struct nbrec_qos *qos,
+                     struct lflow_table *lflows, struct lflow_ref *lflow_ref)
+{
+    bool ingress = !strcmp(qos->direction, "from-lport") ? true :false;
+    enum ovn_stage stage = ingress ? S_SWITCH_IN_QOS : S_SWITCH_OUT_QOS;
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
     struct ds action = DS_EMPTY_INITIALIZER;
+    int64_t rate = 0;
+    int64_t burst = 0;
 
-    ovn_lflow_add(lflows, od, S_SWITCH_IN_QOS, 0, "1", "next;",
-                  lflow_ref);
-    ovn_lflow_add(lflows, od, S_SWITCH_OUT_QOS, 0, "1", "next;",
-                  lflow_ref);
-
-    for (size_t i = 0; i < od->nbs->n_qos_rules; i++) {
-        struct nbrec_qos *qos = od->nbs->qos_rules[i];
-        bool ingress = !strcmp(qos->direction, "from-lport") ? true :false;
-        enum ovn_stage stage = ingress ? S_SWITCH_IN_QOS : S_SWITCH_OUT_QOS;
-        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 1);
-        int64_t rate = 0;
-        int64_t burst = 0;
-
-        ds_clear(&action);
-        for (size_t n = 0; n < qos->n_bandwidth; n++) {
-            if (!strcmp(qos->key_bandwidth[n], "rate")) {
-                rate = qos->value_bandwidth[n];
-            } else if (!strcmp(qos->key_bandwidth[n], "burst")) {
-                burst = qos->value_bandwidth[n];
-            }
+    for (size_t n = 0; n < qos->n_bandwidth; n++) {
+        if (!strcmp(qos->key_bandwidth[n], "rate")) {
+            rate = qos->value_bandwidth[n];
+        } else if (!strcmp(qos->key_bandwidth[n], "burst")) {
+            burst = qos->value_bandwidth[n];
         }
-        if (rate) {
-            stage = ingress ? S_SWITCH_IN_QOS : S_SWITCH_OUT_QOS;
-            if (burst) {
-                ds_put_format(&action,
-                              "set_meter(%"PRId64", %"PRId64"); ",
-                              rate, burst);
-            } else {
-                ds_put_format(&action,
-                              "set_meter(%"PRId64"); ",
-                              rate);
-            }
+    }
+    if (rate) {
+        if (burst) {
+            ds_put_format(&action,
+                          "set_meter(%"PRId64", %"PRId64"); ",
+                          rate, burst);
+        } else {
+            ds_put_format(&action,
+                          "set_meter(%"PRId64"); ",
+                          rate);
         }
-        for (size_t j = 0; j < qos->n_action; j++) {
-            if (!strcmp(qos->key_action[j], "dscp")) {
-                if (qos->value_action[j] > QOS_MAX_DSCP) {
-                    VLOG_WARN_RL(&rl, "Bad 'dscp' value %"PRId64" in qos "
-                                      UUID_FMT, qos->value_action[j],
-                                      UUID_ARGS(&qos->header_.uuid));
-                    continue;
-                }
-
-                ds_put_format(&action, "ip.dscp = %"PRId64"; ",
-                              qos->value_action[j]);
-            } else if (!strcmp(qos->key_action[j], "mark")) {
-                ds_put_format(&action, "pkt.mark = %"PRId64"; ",
-                              qos->value_action[j]);
+    }
+    for (size_t j = 0; j < qos->n_action; j++) {
+        if (!strcmp(qos->key_action[j], "dscp")) {
+            if (qos->value_action[j] > QOS_MAX_DSCP) {
+                VLOG_WARN_RL(&rl, "Bad 'dscp' value %"PRId64" in qos "
+                                  UUID_FMT, qos->value_action[j],
+                                  UUID_ARGS(&qos->header_.uuid));
+                continue;
             }
+
+            ds_put_format(&action, "ip.dscp = %"PRId64"; ",
+                          qos->value_action[j]);
+        } else if (!strcmp(qos->key_action[j], "mark")) {
+            ds_put_format(&action, "pkt.mark = %"PRId64"; ",
+                          qos->value_action[j]);
         }
-            ds_put_cstr(&action, "next;");
-            ovn_lflow_add_with_hint(lflows, od, stage,
-                                    qos->priority,
-                                    qos->match, ds_cstr(&action),
-                                    &qos->header_, lflow_ref);
     }
+    ds_put_cstr(&action, "next;");
+    ovn_lflow_add_with_hint(lflows, od, stage, qos->priority, qos->match,
+                            ds_cstr(&action), &qos->header_, lflow_ref);
     ds_destroy(&action);
 }
 
+/* Returns the key of the lflow reference of the QoS rule 'qos', made of the
+ * QoS row and of the columns its lflows are built from. */
+static char *
+ls_qos_lflows_key(const struct nbrec_qos *qos)
+{
+    struct ds key = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&key, UUID_FMT";%"PRId64";%s;%s;",
+                  UUID_ARGS(&qos->header_.uuid), qos->priority,
+                  qos->direction, qos->match);
+    for (size_t i = 0; i < qos->n_bandwidth; i++) {
+        ds_put_format(&key, "%s=%"PRId64",", qos->key_bandwidth[i],
+                      qos->value_bandwidth[i]);
+    }
+    ds_put_char(&key, ';');
+    for (size_t i = 0; i < qos->n_action; i++) {
+        ds_put_format(&key, "%s=%"PRId64",", qos->key_action[i],
+                      qos->value_action[i]);
+    }
+
+    return ds_steal_cstr(&key);
+}
+
+/* Builds the logical flows of the QoS rules of 'od'.
+ *
+ * Same as for the routing policies in build_lr_policy_flows(), the logical
+ * flows of each QoS rule are referenced by their own lflow_ref and the ones
+ * of the rules whose key is unchanged are kept as they are.  The lflow_refs
+ * of the rules that are gone are left marked as stale for the caller to
+ * remove them. */
+static void
+build_ls_qos_flows(struct ovn_datapath *od, struct lflow_table *lflows)
+{
+    struct ls_qos_lflow_ref *qos_ref;
+    HMAP_FOR_EACH (qos_ref, hmap_node, &od->qos_lflow_refs) {
+        qos_ref->stale = true;
+        qos_ref->rebuilt = false;
+    }
+
+    for (size_t i = 0; i < od->nbs->n_qos_rules; i++) {
+        const struct nbrec_qos *qos = od->nbs->qos_rules[i];
+
+        qos_ref = ovn_datapath_add_qos_lflow_ref(od, ls_qos_lflows_key(qos));
+        if (qos_ref->stale) {
+            /* Built by a previous run. */
+            qos_ref->stale = false;
+            continue;
+        }
+        build_qos_rule_flows(od, qos, lflows, qos_ref->lflow_ref);
+    }
+}
+
+static void
+build_qos(struct ovn_datapath *od, struct lflow_table *lflows,
+          struct lflow_ref *lflow_ref) {
+    ovn_lflow_add(lflows, od, S_SWITCH_IN_QOS, 0, "1", "next;",
+                  lflow_ref);
+    ovn_lflow_add(lflows, od, S_SWITCH_OUT_QOS, 0, "1", "next;",
+                  lflow_ref);
+
+    build_ls_qos_flows(od, lflows);
+}
+
 static void
 build_lb_rules_pre_stateful(struct lflow_table *lflows,
                             struct ovn_lb_datapaths *lb_dps,
+                            const struct ovn_lb_vip *lb_vip,
                             bool ct_lb_mark,
                             const struct ovn_datapaths *ls_datapaths,
-                            struct ds *match, struct ds *action)
+                            struct ds *match, struct ds *action,
+                            struct lflow_ref *lflow_ref)
 {
-    if (!lb_dps->n_nb_ls) {
-        return;
-    }
-
     const struct ovn_northd_lb *lb = lb_dps->lb;
-    for (size_t i = 0; i < lb->n_vips; i++) {
-        struct ovn_lb_vip *lb_vip = &lb->vips[i];
-        ds_clear(action);
-        ds_clear(match);
-        const char *ip_match = NULL;
+    ds_clear(action);
+    ds_clear(match);
+    const char *ip_match = NULL;
 
-        /* Store the original destination IP to be used when generating
-         * hairpin flows.
-         */
-        if (lb->vips[i].address_family == AF_INET) {
-            ip_match = "ip4";
-            ds_put_format(action, REG_ORIG_DIP_IPV4 " = %s; ",
-                          lb_vip->vip_str);
-        } else {
-            ip_match = "ip6";
-            ds_put_format(action, REG_ORIG_DIP_IPV6 " = %s; ",
-                          lb_vip->vip_str);
-        }
+    /* Store the original destination IP to be used when generating
+     * hairpin flows.
+     */
+    if (lb_vip->address_family == AF_INET) {
+        ip_match = "ip4";
+        ds_put_format(action, REG_ORIG_DIP_IPV4 " = %s; ",
+                      lb_vip->vip_str);
+    } else {
+        ip_match = "ip6";
+        ds_put_format(action, REG_ORIG_DIP_IPV6 " = %s; ",
+                      lb_vip->vip_str);
+    }
 
-        const char *proto = NULL;
-        if (lb_vip->port_str) {
-            proto = "tcp";
-            if (lb->nlb->protocol) {
-                if (!strcmp(lb->nlb->protocol, "udp")) {
-                    proto = "udp";
-                } else if (!strcmp(lb->nlb->protocol, "sctp")) {
-                    proto = "sctp";
-                }
+    const char *proto = NULL;
+    if (lb_vip->port_str) {
+        proto = "tcp";
+        if (lb->nlb->protocol) {
+            if (!strcmp(lb->nlb->protocol, "udp")) {
+                proto = "udp";
+            } else if (!strcmp(lb->nlb->protocol, "sctp")) {
+                proto = "sctp";
             }
-
-            /* Store the original destination port to be used when generating
-             * hairpin flows.
-             */
-            ds_put_format(action, REG_ORIG_TP_DPORT " = %s; ",
-                          lb_vip->port_str);
         }
-        ds_put_format(action, "%s;", ct_lb_mark ? "ct_lb_mark" : "ct_lb");
 
-        ds_put_format(match, REGBIT_CONNTRACK_NAT" == 1 && %s.dst == %s",
-                      ip_match, lb_vip->vip_str);
-        if (lb_vip->port_str) {
-            ds_put_format(match, " && %s.dst == %s", proto, lb_vip->port_str);
-        }
+        /* Store the original destination port to be used when generating
+         * hairpin flows.
+         */
+        ds_put_format(action, REG_ORIG_TP_DPORT " = %s; ",
+                      lb_vip->port_str);
+    }
+    ds_put_format(action, "%s;", ct_lb_mark ? "ct_lb_mark" : "ct_lb");
 
-        ovn_lflow_add_with_dp_group(
-            lflows, lb_dps->nb_ls_map, ods_size(ls_datapaths),
-            S_SWITCH_IN_PRE_STATEFUL, 120, ds_cstr(match), ds_cstr(action),
-            &lb->nlb->header_, lb_dps->lflow_ref);
+    ds_put_format(match, REGBIT_CONNTRACK_NAT" == 1 && %s.dst == %s",
+                  ip_match, lb_vip->vip_str);
+    if (lb_vip->port_str) {
+        ds_put_format(match, " && %s.dst == %s", proto, lb_vip->port_str);
     }
+
+    ovn_lflow_add_with_dp_group(
+        lflows, lb_dps->nb_ls_map, ods_size(ls_datapaths),
+        S_SWITCH_IN_PRE_STATEFUL, 120, ds_cstr(match), ds_cstr(action),
+        &lb->nlb->header_, lflow_ref);
 }
 
 /* Builds the logical router flows related to load balancer affinity.
@@ -7657,83 +9697,81 @@ build_lrouter_lb_affinity_default_flows(struct ovn_datapath *od,
 
 static void
 build_lb_rules(struct lflow_table *lflows, struct ovn_lb_datapaths *lb_dps,
-               const struct ovn_datapaths *ls_datapaths,
+               size_t vip_idx, const struct ovn_datapaths *ls_datapaths,
                const struct chassis_features *features, struct ds *match,
                struct ds *action, const struct shash *meter_groups,
-               const struct hmap *svc_monitor_map)
+               const struct hmap *svc_monitor_map,
+               struct lflow_ref *lflow_ref)
 {
     const struct ovn_northd_lb *lb = lb_dps->lb;
-    for (size_t i = 0; i < lb->n_vips; i++) {
-        struct ovn_lb_vip *lb_vip = &lb->vips[i];
-        struct ovn_northd_lb_vip *lb_vip_nb = &lb->vips_nb[i];
-        const char *ip_match = NULL;
-        if (lb_vip->address_family == AF_INET) {
-            ip_match = "ip4";
-        } else {
-            ip_match = "ip6";
-        }
+    struct ovn_lb_vip *lb_vip = &lb->vips[vip_idx];
+    struct ovn_northd_lb_vip *lb_vip_nb = &lb->vips_nb[vip_idx];
+    const char *ip_match = NULL;
+    if (lb_vip->address_family == AF_INET) {
+        ip_match = "ip4";
+    } else {
+        ip_match = "ip6";
+    }
 
-        ds_clear(action);
-        ds_clear(match);
+    ds_clear(action);
+    ds_clear(match);
 
-        /* Make sure that we clear the REGBIT_CONNTRACK_COMMIT flag.  Otherwise
-         * the load balanced packet will be committed again in
-         * S_SWITCH_IN_STATEFUL. */
-        ds_put_format(action, REGBIT_CONNTRACK_COMMIT" = 0; ");
+    /* Make sure that we clear the REGBIT_CONNTRACK_COMMIT flag.  Otherwise
+     * the load balanced packet will be committed again in
+     * S_SWITCH_IN_STATEFUL. */
+    ds_put_format(action, REGBIT_CONNTRACK_COMMIT" = 0; ");
 
-        /* New connections in Ingress table. */
-        const char *meter = NULL;
-        bool reject = build_lb_vip_actions(lb, lb_vip, lb_vip_nb, action,
-                                           lb->selection_fields,
-                                           NULL, NULL, true, features,
-                                           svc_monitor_map);
+    /* New connections in Ingress table. */
+    const char *meter = NULL;
+    bool reject = build_lb_vip_actions(lb, lb_vip, lb_vip_nb, action,
+                                       lb->selection_fields,
+                                       NULL, NULL, true, features,
+                                       svc_monitor_map);
 
-        ds_put_format(match, "ct.new && %s.dst == %s", ip_match,
-                      lb_vip->vip_str);
-        int priority = 110;
-        if (lb_vip->port_str) {
-            ds_put_format(match, " && %s.dst == %s", lb->proto,
-                          lb_vip->port_str);
-            priority = 120;
-        }
+    ds_put_format(match, "ct.new && %s.dst == %s", ip_match,
+                  lb_vip->vip_str);
+    int priority = 110;
+    if (lb_vip->port_str) {
+        ds_put_format(match, " && %s.dst == %s", lb->proto,
+                      lb_vip->port_str);
+        priority = 120;
+    }
 
-        build_lb_affinity_ls_flows(lflows, lb_dps, lb_vip, ls_datapaths,
-                                   lb_dps->lflow_ref);
+    build_lb_affinity_ls_flows(lflows, lb_dps, lb_vip, ls_datapaths,
+                               lflow_ref);
 
-        unsigned long *dp_non_meter = NULL;
-        bool build_non_meter = false;
-        if (reject) {
-            size_t index;
+    unsigned long *dp_non_meter = NULL;
+    bool build_non_meter = false;
+    if (reject) {
+        size_t index;
 
-            dp_non_meter = bitmap_clone(lb_dps->nb_ls_map,
-                                        ods_size(ls_datapaths));
-            BITMAP_FOR_EACH_1 (index, ods_size(ls_datapaths),
-                               lb_dps->nb_ls_map) {
-                struct ovn_datapath *od = ls_datapaths->array[index];
+        dp_non_meter = bitmap_clone(lb_dps->nb_ls_map,
+                                    ods_size(ls_datapaths));
+        BITMAP_FOR_EACH_1 (index, ods_size(ls_datapaths),
+                           lb_dps->nb_ls_map) {
+            struct ovn_datapath *od = ls_datapaths->array[index];
 
-                meter = copp_meter_get(COPP_REJECT, od->nbs->copp,
-                                       meter_groups);
-                if (!meter) {
-                    build_non_meter = true;
-                    continue;
-                }
-                bitmap_set0(dp_non_meter, index);
-                ovn_lflow_add_with_hint__(
-                        lflows, od, S_SWITCH_IN_LB, priority,
-                        ds_cstr(match), ds_cstr(action),
-                        NULL, meter, &lb->nlb->header_,
-                        lb_dps->lflow_ref);
+            meter = copp_meter_get(COPP_REJECT, od->nbs->copp,
+                                   meter_groups);
+            if (!meter) {
+                build_non_meter = true;
+                continue;
             }
+            bitmap_set0(dp_non_meter, index);
+            ovn_lflow_add_with_hint__(
+                lflows, od, S_SWITCH_IN_LB, priority,
+                ds_cstr(match), ds_cstr(action),
+                NULL, meter, &lb->nlb->header_, lflow_ref);
         }
-        if (!reject || build_non_meter) {
-            ovn_lflow_add_with_dp_group(
-                lflows, dp_non_meter ? dp_non_meter : lb_dps->nb_ls_map,
-                ods_size(ls_datapaths), S_SWITCH_IN_LB, priority,
-                ds_cstr(match), ds_cstr(action), &lb->nlb->header_,
-                lb_dps->lflow_ref);
-        }
-        bitmap_free(dp_non_meter);
     }
+    if (!reject || build_non_meter) {
+        ovn_lflow_add_with_dp_group(
+            lflows, dp_non_meter ? dp_non_meter : lb_dps->nb_ls_map,
+            ods_size(ls_datapaths), S_SWITCH_IN_LB, priority,
+            ds_cstr(match), ds_cstr(action), &lb->nlb->header_,
+            lflow_ref);
+    }
+    bitmap_free(dp_non_meter);
 }
 
 static void
@@ -8329,6 +10367,28 @@ build_lswitch_rport_arp_req_flows_for_lbnats(
                                                    lflows, lflow_ref);
     }
 
+    if (use_nat_address_sets) {
+        /* The NAT external IPs are the same for all the router ports, see
+         * lr_stateful_record_get_arp_req_nat_ips(), so a flow per address
+         * family refers to the router's address set, synced by
+         * en_sync_to_sb_addr_set, instead of a flow per IP on each switch.
+         */
+        int addr_families[] = { AF_INET, AF_INET6 };
+        for (size_t i = 0; i < ARRAY_SIZE(addr_families); i++) {
+            if (!lr_stateful_record_has_arp_req_nat_ips(lr_stateful_rec,
+                                                        addr_families[i])) {
+                continue;
+            }
+            char *nat_ips_as = lr_nat_address_set_ref(op->od->tunnel_key,
+                                                      addr_families[i]);
+            build_lswitch_rport_arp_req_flow(
+                nat_ips_as, addr_families[i], sw_op, sw_od, 80, lflows,
+                stage_hint, lflow_ref);
+            free(nat_ips_as);
+        }
+        return;
+    }
+
     for (size_t i = 0; i < lr_stateful_rec->lrnat_rec->n_nat_entries; i++) {
         struct ovn_nat *nat_entry =
             &lr_stateful_rec->lrnat_rec->nat_entries[i];
@@ -8738,12 +10798,6 @@ build_drop_arp_nd_flows_for_unbound_router_ports(struct ovn_port *op,
     ds_destroy(&match);
 }
 
-static bool
-is_vlan_transparent(const struct ovn_datapath *od)
-{
-    return smap_get_bool(&od->nbs->other_config, "vlan-passthru", false);
-}
-
 static void
 build_lswitch_lflows_l2_unknown(struct ovn_datapath *od,
                                 struct lflow_table *lflows,
@@ -8841,6 +10895,16 @@ build_lswitch_arp_nd_responder_skip_local(struct ovn_port *op,
                                       S_SWITCH_IN_ARP_ND_RSP, 100,
                                       ds_cstr(match), "next;", op->key,
                                       &op->nbsp->header_, op->lflow_ref);
+    if (smap_get_bool(&op->od->nbs->other_config, "arp_nd_rsp_lookup",
+                      false)) {
+        /* Don't look up the targets either, lookup_arp_nd_rsp() would
+         * overwrite eth.dst of the requests that are forwarded. */
+        ovn_lflow_add_with_lport_and_hint(lflows, op->od,
+                                          S_SWITCH_IN_ARP_ND_LOOKUP, 100,
+                                          ds_cstr(match), "next;", op->key,
+                                          &op->nbsp->header_,
+                                          op->lflow_ref);
+    }
 }
 
 /* Ingress table 19: ARP/ND responder, reply for known IPs.
@@ -8937,29 +11001,11 @@ build_lswitch_arp_nd_responder_known_ips(struct ovn_port *op,
         }
 
         free(tokstr);
-    } else {
-        /*
-         * Add ARP/ND reply flows if either the
-         *  - port is up and it doesn't have 'unknown' address defined or it
-         *    doesn't have the option disable_arp_nd_rsp=true.
-         *  - port type is router or
-         *  - port type is localport
-         */
-        if (check_lsp_is_up &&
-            !lsp_is_up(op->nbsp) && !lsp_is_router(op->nbsp) &&
-            strcmp(op->nbsp->type, "localport")) {
-            return;
-        }
-
-        if (lsp_is_external(op->nbsp) || op->has_unknown ||
-           (!op->nbsp->type[0] && lsp_disable_arp_nd_rsp(op->nbsp))) {
-            return;
-        }
-
-        if (is_vlan_transparent(op->od)) {
-            return;
-        }
-
+    } else if (!lsp_arp_nd_rsp_enabled(op)) {
+        return;
+    } else if (!lsp_has_arp_nd_rsp_lookup(op)) {
+        /* The addresses of the ports in lookup mode are handled by the
+         * flows of build_lswitch_arp_nd_responder_lookup() instead. */
         for (size_t i = 0; i < op->n_lsp_addrs; i++) {
             for (size_t j = 0; j < op->lsp_addrs[i].n_ipv4_addrs; j++) {
                 ds_clear(match);
@@ -9185,6 +11231,64 @@ build_lswitch_arp_nd_responder_default(struct ovn_datapath *od,
                   lflow_ref);
 }
 
+/* Ingress table 20 and 21: ARP/ND responder for the switch ports in lookup
+ * mode, whose addresses are looked up by lookup_arp_nd_rsp() in the table
+ * that ovn-controller builds from their port bindings, so that the number
+ * of flows doesn't depend on the number of ports.  By default goto next.
+ * (priority 0 and 50) */
+static void
+build_lswitch_arp_nd_responder_lookup(struct ovn_datapath *od,
+                                      struct lflow_table *lflows,
+                                      const struct shash *meter_groups,
+                                      struct lflow_ref *lflow_ref)
+{
+    ovs_assert(od->nbs);
+    ovn_lflow_add(lflows, od, S_SWITCH_IN_ARP_ND_LOOKUP, 0, "1", "next;",
+                  lflow_ref);
+
+    if (!smap_get_bool(&od->nbs->other_config, "arp_nd_rsp_lookup", false)
+        || is_vlan_transparent(od)) {
+        return;
+    }
+
+    /* Same as for the flows of each address, do not reply on unicast ARPs
+     * and to the requests sent through the RAMP switch. */
+    ovn_lflow_add(lflows, od, S_SWITCH_IN_ARP_ND_LOOKUP, 50,
+                  REGBIT_FROM_RAMP" == 0 && arp.op == 1 && "
+                  "eth.dst == ff:ff:ff:ff:ff:ff",
+                  REGBIT_ARP_ND_RSP_LOOKUP" = lookup_arp_nd_rsp(); next;",
+                  lflow_ref);
+    ovn_lflow_add(lflows, od, S_SWITCH_IN_ARP_ND_LOOKUP, 50,
+                  REGBIT_FROM_RAMP" == 0 && nd_ns",
+                  REGBIT_ARP_ND_RSP_LOOKUP" = lookup_arp_nd_rsp(); next;",
+                  lflow_ref);
+
+    /* lookup_arp_nd_rsp() stores the MAC address of the port that owns the
+     * target address in eth.dst. */
+    ovn_lflow_add(lflows, od, S_SWITCH_IN_ARP_ND_RSP, 50,
+                  REGBIT_ARP_ND_RSP_LOOKUP" == 1 && arp",
+                  "eth.dst <-> eth.src; "
+                  "arp.op = 2; /* ARP reply */ "
+                  "arp.tha = arp.sha; "
+                  "arp.sha = eth.src; "
+                  "arp.tpa <-> arp.spa; "
+                  "outport = inport; "
+                  "flags.loopback = 1; "
+                  "output;",
+                  lflow_ref);
+    ovn_lflow_add_with_hint__(lflows, od, S_SWITCH_IN_ARP_ND_RSP, 50,
+                              REGBIT_ARP_ND_RSP_LOOKUP" == 1 && nd_ns",
+                              "nd_na { "
+                              "outport = inport; "
+                              "flags.loopback = 1; "
+                              "output; "
+                              "};",
+                              NULL,
+                              copp_meter_get(COPP_ND_NA, od->nbs->copp,
+                                             meter_groups),
+                              NULL, lflow_ref);
+}
+
 /* Ingress table 19: ARP/ND responder for service monitor source ip.
  * (priority 110)*/
 static void
@@ -9574,7 +11678,8 @@ build_lswitch_ip_mcast_igmp_mld(struct ovn_igmp_group *igmp_group,
                       igmp_group->mcgroup.name);
 
         ovn_lflow_add(lflows, igmp_group->datapath, S_SWITCH_IN_L2_LKUP,
-                      90, ds_cstr(match), ds_cstr(actions), NULL);
+                      90, ds_cstr(match), ds_cstr(actions),
+                      igmp_group->lflow_ref);
     }
 }
 
@@ -9658,16 +11763,28 @@ build_lswitch_ip_unicast_lookup(struct ovn_port *op,
                                 ds_cstr(match), ds_cstr(actions),
                                 &op->nbsp->header_,
                                 op->lflow_ref);
-    } else {
+    } else if (use_lflow_parameters && lsp_enabled
+               && !(lsp_clone_to_unknown && op->od->has_unknown)) {
         for (size_t i = 0; i < op->n_lsp_addrs; i++) {
             ds_clear(match);
-            ds_put_format(match, "eth.dst == %s", op->lsp_addrs[i].ea_s);
+            ds_put_format(match, "mac=%s, port=%s", op->lsp_addrs[i].ea_s,
+                          op->json_key);
 
-            ovn_lflow_add_with_hint(lflows, op->od,
-                                    S_SWITCH_IN_L2_LKUP, 50,
-                                    ds_cstr(match), ds_cstr(actions),
-                                    &op->nbsp->header_,
-                                    op->lflow_ref);
+            /* The row is shared by all the ports of the switch, so it has
+             * no stage hint. */
+            ovn_lflow_add_with_params(lflows, op->od,
+                                      S_SWITCH_IN_L2_LKUP, 50,
+                                      "eth.dst == ^mac",
+                                      "outport = ^port; output;",
+                                      ds_cstr(match), NULL, op->lflow_ref);
+        }
+    } else {
+        for (size_t i = 0; i < op->n_lsp_addrs; i++) {
+            ovn_lflow_add_fmt(lflows, op->od, S_SWITCH_IN_L2_LKUP, 50,
+                              OVN_FMT("eth.dst == %s",
+                                      op->lsp_addrs[i].ea_s),
+                              OVN_FMT_STR(ds_cstr(actions)), NULL,
+                              &op->nbsp->header_, op->lflow_ref);
         }
     }
 }
@@ -9727,6 +11844,7 @@ struct bfd_entry {
     struct hmap_node hmap_node;
 
     const struct sbrec_bfd *sb_bt;
+    const struct nbrec_bfd *nb_bt;
 
     bool ref;
 };
@@ -9767,12 +11885,33 @@ bfd_cleanup_connections(const struct nbrec_bfd_table *nbrec_bfd_table,
             nbrec_bfd_set_status(nb_bt, "admin_down");
         }
     }
+}
+
+void
+bfd_destroy_connections(struct hmap *bfd_map)
+{
+    struct bfd_entry *bfd_e;
 
     HMAP_FOR_EACH_POP (bfd_e, hmap_node, bfd_map) {
         free(bfd_e);
     }
 }
 
+/* Reconciles the status of the NB and SB copies of a BFD session: the NB
+ * is authoritative for "admin_down", ovn-controller for the other states. */
+static void
+bfd_sync_status(const struct nbrec_bfd *nb_bt, const struct sbrec_bfd *sb_bt)
+{
+    if (strcmp(sb_bt->status, nb_bt->status)) {
+        if (!strcmp(nb_bt->status, "admin_down") ||
+            !strcmp(sb_bt->status, "admin_down")) {
+            sbrec_bfd_set_status(sb_bt, nb_bt->status);
+        } else {
+            nbrec_bfd_set_status(nb_bt, sb_bt->status);
+        }
+    }
+}
+
 #define BFD_DEF_MINTX       1000 /* 1s */
 #define BFD_DEF_MINRX       1000 /* 1s */
 #define BFD_DEF_DETECT_MULT 5
@@ -9889,14 +12028,7 @@ build_bfd_table(struct ovsdb_idl_txn *ovnsb_txn,
                                               : BFD_DEF_DETECT_MULT;
             sbrec_bfd_set_detect_mult(sb_bt, d_mult);
         } else {
-            if (strcmp(bfd_e->sb_bt->status, nb_bt->status)) {
-                if (!strcmp(nb_bt->status, "admin_down") ||
-                    !strcmp(bfd_e->sb_bt->status, "admin_down")) {
-                    sbrec_bfd_set_status(bfd_e->sb_bt, nb_bt->status);
-                } else {
-                    nbrec_bfd_set_status(nb_bt, bfd_e->sb_bt->status);
-                }
-            }
+            bfd_sync_status(nb_bt, bfd_e->sb_bt);
             build_bfd_update_sb_conf(nb_bt, bfd_e->sb_bt);
             if (op && op->sb && op->sb->chassis &&
                 strcmp(op->sb->chassis->name, bfd_e->sb_bt->chassis_name)) {
@@ -9904,30 +12036,137 @@ build_bfd_table(struct ovsdb_idl_txn *ovnsb_txn,
                                            op->sb->chassis->name);
             }
 
-            hmap_remove(&sb_only, &bfd_e->hmap_node);
-            bfd_e->ref = false;
-            hash = hash_string(bfd_e->sb_bt->dst_ip, 0);
-            hash = hash_string(bfd_e->sb_bt->logical_port, hash);
-            hmap_insert(bfd_connections, &bfd_e->hmap_node, hash);
+            hmap_remove(&sb_only, &bfd_e->hmap_node);
+            bfd_e->nb_bt = nb_bt;
+            bfd_e->ref = false;
+            hash = hash_string(bfd_e->sb_bt->dst_ip, 0);
+            hash = hash_string(bfd_e->sb_bt->logical_port, hash);
+            hmap_insert(bfd_connections, &bfd_e->hmap_node, hash);
+        }
+
+        if (op) {
+            op->has_bfd = true;
+        }
+    }
+
+    HMAP_FOR_EACH_POP (bfd_e, hmap_node, &sb_only) {
+        struct ovn_port *op = ovn_port_find(lr_ports,
+                                            bfd_e->sb_bt->logical_port);
+        if (op) {
+            op->has_bfd = false;
+        }
+        sbrec_bfd_delete(bfd_e->sb_bt);
+        free(bfd_e);
+    }
+    hmap_destroy(&sb_only);
+
+    bitmap_free(bfd_src_ports);
+}
+
+static const struct nbrec_bfd *
+bfd_find_nb_session(const struct nbrec_bfd_table *nbrec_bfd_table,
+                    const char *logical_port, const char *dst_ip)
+{
+    const struct nbrec_bfd *nb_bt;
+
+    NBREC_BFD_TABLE_FOR_EACH (nb_bt, nbrec_bfd_table) {
+        if (!strcmp(nb_bt->logical_port, logical_port) &&
+            !strcmp(nb_bt->dst_ip, dst_ip)) {
+            return nb_bt;
+        }
+    }
+    return NULL;
+}
+
+/* Handles the changes to the NB BFD table, 'bfd_connections' being the
+ * sessions built by the last build_bfd_table().  Only changes to the
+ * status or the timers of existing sessions are handled, the sessions whose
+ * status changed are added to 'updated_bfds'.  Creating or deleting a
+ * session, or changing its endpoints, changes the SB rows and the router
+ * ports that have BFD enabled, so that falls back to a recompute.
+ *
+ * Returns true if the changes were handled incrementally. */
+bool
+bfd_handle_nb_changes(const struct nbrec_bfd_table *nbrec_bfd_table,
+                      const struct hmap *bfd_connections,
+                      struct hmapx *updated_bfds)
+{
+    const struct nbrec_bfd *nb_bt;
+
+    NBREC_BFD_TABLE_FOR_EACH_TRACKED (nb_bt, nbrec_bfd_table) {
+        if (nbrec_bfd_is_new(nb_bt) || nbrec_bfd_is_deleted(nb_bt) ||
+            nbrec_bfd_is_updated(nb_bt, NBREC_BFD_COL_LOGICAL_PORT) ||
+            nbrec_bfd_is_updated(nb_bt, NBREC_BFD_COL_DST_IP) ||
+            !nb_bt->status) {
+            return false;
         }
 
-        if (op) {
-            op->has_bfd = true;
+        struct bfd_entry *bfd_e = bfd_port_lookup(bfd_connections,
+                                                  nb_bt->logical_port,
+                                                  nb_bt->dst_ip);
+        if (!bfd_e || bfd_e->nb_bt != nb_bt ||
+            sbrec_bfd_is_deleted(bfd_e->sb_bt)) {
+            return false;
+        }
+
+        bfd_sync_status(nb_bt, bfd_e->sb_bt);
+        build_bfd_update_sb_conf(nb_bt, bfd_e->sb_bt);
+        if (nbrec_bfd_is_updated(nb_bt, NBREC_BFD_COL_STATUS)) {
+            hmapx_add(updated_bfds, CONST_CAST(struct nbrec_bfd *, nb_bt));
         }
     }
 
-    HMAP_FOR_EACH_POP (bfd_e, hmap_node, &sb_only) {
-        struct ovn_port *op = ovn_port_find(lr_ports,
-                                            bfd_e->sb_bt->logical_port);
-        if (op) {
-            op->has_bfd = false;
+    return true;
+}
+
+/* Handles the changes to the SB BFD table, mostly status updates from
+ * ovn-controller, which are propagated to the NB.  The logical flows only
+ * depend on the NB status, so they are updated once that NB change is
+ * received.  The rows inserted by build_bfd_table() for new sessions are
+ * added to 'bfd_connections'.
+ *
+ * Returns true if the changes were handled incrementally. */
+bool
+bfd_handle_sb_changes(const struct sbrec_bfd_table *sbrec_bfd_table,
+                      const struct nbrec_bfd_table *nbrec_bfd_table,
+                      struct hmap *bfd_connections)
+{
+    const struct sbrec_bfd *sb_bt;
+
+    SBREC_BFD_TABLE_FOR_EACH_TRACKED (sb_bt, sbrec_bfd_table) {
+        struct bfd_entry *bfd_e = bfd_port_lookup(bfd_connections,
+                                                  sb_bt->logical_port,
+                                                  sb_bt->dst_ip);
+        if (sbrec_bfd_is_deleted(sb_bt)) {
+            if (bfd_e && bfd_e->sb_bt == sb_bt) {
+                return false;
+            }
+            continue;
         }
-        sbrec_bfd_delete(bfd_e->sb_bt);
-        free(bfd_e);
+
+        if (sbrec_bfd_is_new(sb_bt)) {
+            const struct nbrec_bfd *nb_bt =
+                bfd_find_nb_session(nbrec_bfd_table, sb_bt->logical_port,
+                                    sb_bt->dst_ip);
+            if (bfd_e || !nb_bt || !nb_bt->status) {
+                return false;
+            }
+
+            uint32_t hash = hash_string(sb_bt->dst_ip, 0);
+            hash = hash_string(sb_bt->logical_port, hash);
+            bfd_e = xmalloc(sizeof *bfd_e);
+            bfd_e->sb_bt = sb_bt;
+            bfd_e->nb_bt = nb_bt;
+            bfd_e->ref = true;
+            hmap_insert(bfd_connections, &bfd_e->hmap_node, hash);
+        } else if (!bfd_e || bfd_e->sb_bt != sb_bt) {
+            return false;
+        }
+
+        bfd_sync_status(bfd_e->nb_bt, sb_bt);
     }
-    hmap_destroy(&sb_only);
 
-    bitmap_free(bfd_src_ports);
+    return true;
 }
 
 /* Returns a string of the IP address of the router port 'op' that
@@ -10547,6 +12786,229 @@ unique_routes_destroy(struct hmap *unique_routes)
     hmap_destroy(unique_routes);
 }
 
+/* Compaction of the unique routes of a router, see the
+ * "compact_static_routes" option of Logical_Router in ovn-nb(5).
+ *
+ * Two unique routes of the same route table and policy, whose prefixes are
+ * the two halves of a prefix one bit shorter and that forward in the same
+ * way, are replaced by a single route to the shorter prefix, and so on
+ * until no more routes can be merged.  The shorter prefix matches exactly
+ * the addresses of both halves, so the longest prefix match of any address
+ * is unchanged, as long as no route already goes to the shorter prefix:
+ * such a route would then have the same match and priority as the merged
+ * one, hence halves are only merged into a prefix that no unique route or
+ * ECMP group of the router uses.  Nor are they merged into a prefix that
+ * overlaps the network of a router port, as the priority of the merged
+ * route relative to the directly connected route may differ from the one
+ * of the halves. */
+struct compact_route_node {
+    struct hmap_node hmap_node; /* In the compaction's 'routes'. */
+    struct ovs_list list_node;  /* In the compaction's queue. */
+    struct in6_addr network;    /* Prefix masked by 'plen'. */
+    unsigned int plen;
+    bool is_src_route;
+    uint32_t route_table_id;
+
+    /* The unique route to 'network', NULL if it is an ECMP group, or if
+     * several unique routes have the same masked prefix. */
+    struct unique_routes_node *ur;
+};
+
+static unsigned int
+route_prefix_bits(const struct in6_addr *prefix, unsigned int plen)
+{
+    return IN6_IS_ADDR_V4MAPPED(prefix) ? plen + 96 : plen;
+}
+
+static uint32_t
+compact_route_hash(const struct in6_addr *network, unsigned int plen)
+{
+    return hash_bytes(network, sizeof *network, plen);
+}
+
+static struct compact_route_node *
+compact_routes_find(const struct hmap *routes, const struct in6_addr *network,
+                    unsigned int plen, bool is_src_route,
+                    uint32_t route_table_id)
+{
+    struct compact_route_node *cr;
+    HMAP_FOR_EACH_WITH_HASH (cr, hmap_node,
+                             compact_route_hash(network, plen), routes) {
+        if (ipv6_addr_equals(&cr->network, network) && cr->plen == plen &&
+            cr->is_src_route == is_src_route &&
+            cr->route_table_id == route_table_id) {
+            return cr;
+        }
+    }
+    return NULL;
+}
+
+static struct compact_route_node *
+compact_routes_add(struct hmap *routes, const struct in6_addr *prefix,
+                   unsigned int plen, bool is_src_route,
+                   uint32_t route_table_id, struct unique_routes_node *ur)
+{
+    struct in6_addr mask = ipv6_create_mask(route_prefix_bits(prefix, plen));
+    struct in6_addr network = ipv6_addr_bitand(prefix, &mask);
+
+    struct compact_route_node *cr =
+        compact_routes_find(routes, &network, plen, is_src_route,
+                            route_table_id);
+    if (cr) {
+        /* Leave alone the routes that overlap exactly. */
+        cr->ur = NULL;
+        return NULL;
+    }
+
+    cr = xzalloc(sizeof *cr);
+    cr->network = network;
+    cr->plen = plen;
+    cr->is_src_route = is_src_route;
+    cr->route_table_id = route_table_id;
+    cr->ur = ur;
+    ovs_list_init(&cr->list_node);
+    hmap_insert(routes, &cr->hmap_node, compact_route_hash(&network, plen));
+    return cr;
+}
+
+/* Returns true if the prefixes 'a'/'a_bits' and 'b'/'b_bits', in bits of
+ * their IPv6 or IPv4-mapped address, have addresses in common. */
+static bool
+route_prefixes_overlap(const struct in6_addr *a, unsigned int a_bits,
+                       const struct in6_addr *b, unsigned int b_bits)
+{
+    struct in6_addr mask = ipv6_create_mask(MIN(a_bits, b_bits));
+    struct in6_addr a_network = ipv6_addr_bitand(a, &mask);
+    struct in6_addr b_network = ipv6_addr_bitand(b, &mask);
+
+    return ipv6_addr_equals(&a_network, &b_network);
+}
+
+/* Returns true if 'network'/'plen' overlaps a network of a port of router
+ * 'od'.  Its directly connected route would then take precedence over, or
+ * be overridden by, a merged route differently than by the halves. */
+static bool
+compact_route_overlaps_lrp(const struct ovn_datapath *od,
+                           const struct in6_addr *network, unsigned int plen)
+{
+    unsigned int bits = route_prefix_bits(network, plen);
+    const struct ovn_port *op;
+
+    HMAP_FOR_EACH (op, dp_node, &od->ports) {
+        const struct lport_addresses *nets = &op->lrp_networks;
+
+        if (IN6_IS_ADDR_V4MAPPED(network)) {
+            for (size_t i = 0; i < nets->n_ipv4_addrs; i++) {
+                struct in6_addr lrp_network;
+
+                in6_addr_set_mapped_ipv4(&lrp_network,
+                                         nets->ipv4_addrs[i].network);
+                if (route_prefixes_overlap(network, bits, &lrp_network,
+                                           nets->ipv4_addrs[i].plen + 96)) {
+                    return true;
+                }
+            }
+        } else {
+            for (size_t i = 0; i < nets->n_ipv6_addrs; i++) {
+                if (route_prefixes_overlap(network, bits,
+                                           &nets->ipv6_addrs[i].network,
+                                           nets->ipv6_addrs[i].plen)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/* Returns true if routes 'a' and 'b' lead to the same lflow actions. */
+static bool
+parsed_routes_can_merge(const struct parsed_route *a,
+                        const struct parsed_route *b)
+{
+    return (a->is_discard_route == b->is_discard_route
+            && !strcmp(a->route->nexthop, b->route->nexthop)
+            && nullable_string_is_equal(a->route->output_port,
+                                        b->route->output_port)
+            && !strcmp(smap_get_def(&a->route->options, "origin", ""),
+                       smap_get_def(&b->route->options, "origin", "")));
+}
+
+static void
+unique_routes_compact(const struct ovn_datapath *od,
+                      struct hmap *unique_routes,
+                      const struct hmap *ecmp_groups)
+{
+    struct hmap routes = HMAP_INITIALIZER(&routes);
+    struct ovs_list queue = OVS_LIST_INITIALIZER(&queue);
+    struct compact_route_node *cr, *sibling;
+
+    const struct ecmp_groups_node *eg;
+    HMAP_FOR_EACH (eg, hmap_node, ecmp_groups) {
+        compact_routes_add(&routes, &eg->prefix, eg->plen, eg->is_src_route,
+                           eg->route_table_id, NULL);
+    }
+    struct unique_routes_node *ur;
+    HMAP_FOR_EACH (ur, hmap_node, unique_routes) {
+        cr = compact_routes_add(&routes, &ur->route->prefix, ur->route->plen,
+                                ur->route->is_src_route,
+                                ur->route->route_table_id, ur);
+        if (cr) {
+            ovs_list_push_back(&queue, &cr->list_node);
+        }
+    }
+
+    while (!ovs_list_is_empty(&queue)) {
+        cr = CONTAINER_OF(ovs_list_pop_front(&queue),
+                          struct compact_route_node, list_node);
+        ovs_list_init(&cr->list_node);
+        if (!cr->ur || !cr->plen) {
+            continue;
+        }
+
+        unsigned int bit = route_prefix_bits(&cr->network, cr->plen) - 1;
+        struct in6_addr sibling_network = cr->network;
+        sibling_network.s6_addr[bit / 8] ^= 0x80 >> (bit % 8);
+        sibling = compact_routes_find(&routes, &sibling_network, cr->plen,
+                                      cr->is_src_route, cr->route_table_id);
+        if (!sibling || !sibling->ur ||
+            !parsed_routes_can_merge(cr->ur->route, sibling->ur->route)) {
+            continue;
+        }
+
+        struct in6_addr network = cr->network;
+        network.s6_addr[bit / 8] &= ~(0x80 >> (bit % 8));
+        if (compact_routes_find(&routes, &network, cr->plen - 1,
+                                cr->is_src_route, cr->route_table_id)
+            || (!IN6_IS_ADDR_V4MAPPED(&network)
+                && in6_is_lla(&network) != in6_is_lla(&cr->network))
+            || compact_route_overlaps_lrp(od, &network, cr->plen - 1)) {
+            continue;
+        }
+
+        /* Merge 'sibling' into 'cr'. */
+        ovs_list_remove(&sibling->list_node);
+        hmap_remove(&routes, &sibling->hmap_node);
+        hmap_remove(unique_routes, &sibling->ur->hmap_node);
+        free(sibling->ur);
+        free(sibling);
+
+        struct parsed_route *route =
+            CONST_CAST(struct parsed_route *, cr->ur->route);
+        hmap_remove(&routes, &cr->hmap_node);
+        cr->network = route->prefix = network;
+        cr->plen = route->plen = cr->plen - 1;
+        hmap_insert(&routes, &cr->hmap_node,
+                    compact_route_hash(&cr->network, cr->plen));
+        ovs_list_push_back(&queue, &cr->list_node);
+    }
+
+    HMAP_FOR_EACH_POP (cr, hmap_node, &routes) {
+        free(cr);
+    }
+    hmap_destroy(&routes);
+}
+
 static char *
 build_route_prefix_s(const struct in6_addr *prefix, unsigned int plen)
 {
@@ -11153,7 +13615,8 @@ build_lrouter_nat_flows_for_lb(
     struct ds *match, struct ds *action,
     const struct shash *meter_groups,
     const struct chassis_features *features,
-    const struct hmap *svc_monitor_map)
+    const struct hmap *svc_monitor_map,
+    struct lflow_ref *lflow_ref)
 {
     const struct ovn_northd_lb *lb = lb_dps->lb;
     bool ipv4 = lb_vip->address_family == AF_INET;
@@ -11263,8 +13726,7 @@ build_lrouter_nat_flows_for_lb(
         if (!od->n_l3dgw_ports) {
             bitmap_set1(gw_dp_bitmap[type], index);
         } else {
-            build_distr_lrouter_nat_flows_for_lb(&ctx, type, od,
-                                                 lb_dps->lflow_ref);
+            build_distr_lrouter_nat_flows_for_lb(&ctx, type, od, lflow_ref);
         }
 
         if (lb->affinity_timeout) {
@@ -11274,11 +13736,10 @@ build_lrouter_nat_flows_for_lb(
 
     for (size_t type = 0; type < LROUTER_NAT_LB_FLOW_MAX; type++) {
         build_gw_lrouter_nat_flows_for_lb(&ctx, type, lr_datapaths,
-                                          gw_dp_bitmap[type],
-                                          lb_dps->lflow_ref);
+                                          gw_dp_bitmap[type], lflow_ref);
         build_lb_affinity_lr_flows(lflows, lb, lb_vip, ds_cstr(match),
                                    aff_action[type], aff_dp_bitmap[type],
-                                   lr_datapaths, lb_dps->lflow_ref);
+                                   lr_datapaths, lflow_ref);
     }
 
     ds_destroy(&undnat_match);
@@ -11293,27 +13754,24 @@ build_lrouter_nat_flows_for_lb(
 }
 
 static void
-build_lswitch_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
-                           struct lflow_table *lflows,
-                           const struct shash *meter_groups,
-                           const struct ovn_datapaths *ls_datapaths,
-                           const struct chassis_features *features,
-                           const struct hmap *svc_monitor_map,
-                           struct ds *match, struct ds *action)
+build_lswitch_flows_for_lb_vip(struct ovn_lb_datapaths *lb_dps, size_t vip_idx,
+                               struct lflow_table *lflows,
+                               const struct shash *meter_groups,
+                               const struct ovn_datapaths *ls_datapaths,
+                               const struct chassis_features *features,
+                               const struct hmap *svc_monitor_map,
+                               struct ds *match, struct ds *action,
+                               struct lflow_ref *lflow_ref)
 {
     if (!lb_dps->n_nb_ls) {
         return;
     }
 
     const struct ovn_northd_lb *lb = lb_dps->lb;
-    for (size_t i = 0; i < lb->n_vips; i++) {
-        struct ovn_lb_vip *lb_vip = &lb->vips[i];
-
-        /* pre-stateful lb */
-        if (!build_empty_lb_event_flow(lb_vip, lb, match, action)) {
-            continue;
-        }
+    struct ovn_lb_vip *lb_vip = &lb->vips[vip_idx];
 
+    /* pre-stateful lb */
+    if (build_empty_lb_event_flow(lb_vip, lb, match, action)) {
         size_t index;
         BITMAP_FOR_EACH_1 (index, ods_size(ls_datapaths), lb_dps->nb_ls_map) {
             struct ovn_datapath *od = ls_datapaths->array[index];
@@ -11325,8 +13783,7 @@ build_lswitch_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
                                       copp_meter_get(COPP_EVENT_ELB,
                                                      od->nbs->copp,
                                                      meter_groups),
-                                      &lb->nlb->header_,
-                                      lb_dps->lflow_ref);
+                                      &lb->nlb->header_, lflow_ref);
         }
         /* Ignore L4 port information in the key because fragmented packets
          * may not have L4 information.  The pre-stateful table will send
@@ -11340,10 +13797,11 @@ build_lswitch_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
      * a higher priority rule for load balancing below also commits the
      * connection, so it is okay if we do not hit the above match on
      * REGBIT_CONNTRACK_COMMIT. */
-    build_lb_rules_pre_stateful(lflows, lb_dps, features->ct_no_masked_label,
-                                ls_datapaths, match, action);
-    build_lb_rules(lflows, lb_dps, ls_datapaths, features, match, action,
-                   meter_groups, svc_monitor_map);
+    build_lb_rules_pre_stateful(lflows, lb_dps, lb_vip,
+                                features->ct_no_masked_label,
+                                ls_datapaths, match, action, lflow_ref);
+    build_lb_rules(lflows, lb_dps, vip_idx, ls_datapaths, features, match,
+                   action, meter_groups, svc_monitor_map, lflow_ref);
 }
 
 /* If there are any load balancing rules, we should send the packet to
@@ -11355,40 +13813,42 @@ build_lswitch_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
  *    defragmentation to match on L4 ports.
  */
 static void
-build_lrouter_defrag_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
-                                  struct lflow_table *lflows,
-                                  const struct ovn_datapaths *lr_datapaths,
-                                  struct ds *match)
+build_lrouter_defrag_flows_for_lb_vip(struct ovn_lb_datapaths *lb_dps,
+                                      size_t vip_idx,
+                                      struct lflow_table *lflows,
+                                      const struct ovn_datapaths *lr_datapaths,
+                                      struct ds *match,
+                                      struct lflow_ref *lflow_ref)
 {
     if (!lb_dps->n_nb_lr) {
         return;
     }
 
-    for (size_t i = 0; i < lb_dps->lb->n_vips; i++) {
-        struct ovn_lb_vip *lb_vip = &lb_dps->lb->vips[i];
-        bool ipv6 = lb_vip->address_family == AF_INET6;
-        int prio = 100;
+    struct ovn_lb_vip *lb_vip = &lb_dps->lb->vips[vip_idx];
+    bool ipv6 = lb_vip->address_family == AF_INET6;
+    int prio = 100;
 
-        ds_clear(match);
-        ds_put_format(match, "ip && ip%c.dst == %s", ipv6 ? '6' : '4',
-                      lb_vip->vip_str);
+    ds_clear(match);
+    ds_put_format(match, "ip && ip%c.dst == %s", ipv6 ? '6' : '4',
+                  lb_vip->vip_str);
 
-        ovn_lflow_add_with_dp_group(
-            lflows, lb_dps->nb_lr_map, ods_size(lr_datapaths),
-            S_ROUTER_IN_DEFRAG, prio, ds_cstr(match), "ct_dnat;",
-            &lb_dps->lb->nlb->header_, lb_dps->lflow_ref);
-    }
+    ovn_lflow_add_with_dp_group(
+        lflows, lb_dps->nb_lr_map, ods_size(lr_datapaths),
+        S_ROUTER_IN_DEFRAG, prio, ds_cstr(match), "ct_dnat;",
+        &lb_dps->lb->nlb->header_, lflow_ref);
 }
 
 static void
-build_lrouter_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
-                           struct lflow_table *lflows,
-                           const struct shash *meter_groups,
-                           const struct ovn_datapaths *lr_datapaths,
-                           const struct lr_stateful_table *lr_stateful_table,
-                           const struct chassis_features *features,
-                           const struct hmap *svc_monitor_map,
-                           struct ds *match, struct ds *action)
+build_lrouter_flows_for_lb_vip(
+    struct ovn_lb_datapaths *lb_dps, size_t vip_idx,
+    struct lflow_table *lflows,
+    const struct shash *meter_groups,
+    const struct ovn_datapaths *lr_datapaths,
+    const struct lr_stateful_table *lr_stateful_table,
+    const struct chassis_features *features,
+    const struct hmap *svc_monitor_map,
+    struct ds *match, struct ds *action,
+    struct lflow_ref *lflow_ref)
 {
     size_t index;
 
@@ -11397,39 +13857,151 @@ build_lrouter_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
     }
 
     const struct ovn_northd_lb *lb = lb_dps->lb;
-    for (size_t i = 0; i < lb->n_vips; i++) {
-        struct ovn_lb_vip *lb_vip = &lb->vips[i];
+    struct ovn_lb_vip *lb_vip = &lb->vips[vip_idx];
 
-        build_lrouter_nat_flows_for_lb(lb_vip, lb_dps, &lb->vips_nb[i],
-                                       lr_datapaths, lr_stateful_table, lflows,
-                                       match, action, meter_groups, features,
-                                       svc_monitor_map);
+    build_lrouter_nat_flows_for_lb(lb_vip, lb_dps, &lb->vips_nb[vip_idx],
+                                   lr_datapaths, lr_stateful_table, lflows,
+                                   match, action, meter_groups, features,
+                                   svc_monitor_map, lflow_ref);
 
-        if (!build_empty_lb_event_flow(lb_vip, lb, match, action)) {
-            continue;
-        }
+    if (!build_empty_lb_event_flow(lb_vip, lb, match, action)) {
+        return;
+    }
 
-        BITMAP_FOR_EACH_1 (index, ods_size(lr_datapaths), lb_dps->nb_lr_map) {
-            struct ovn_datapath *od = lr_datapaths->array[index];
+    BITMAP_FOR_EACH_1 (index, ods_size(lr_datapaths), lb_dps->nb_lr_map) {
+        struct ovn_datapath *od = lr_datapaths->array[index];
 
-            ovn_lflow_add_with_hint__(lflows, od, S_ROUTER_IN_DNAT,
-                                      130, ds_cstr(match), ds_cstr(action),
-                                      NULL,
-                                      copp_meter_get(COPP_EVENT_ELB,
-                                                     od->nbr->copp,
-                                                     meter_groups),
-                                      &lb->nlb->header_, lb_dps->lflow_ref);
-        }
+        ovn_lflow_add_with_hint__(lflows, od, S_ROUTER_IN_DNAT,
+                                  130, ds_cstr(match), ds_cstr(action),
+                                  NULL,
+                                  copp_meter_get(COPP_EVENT_ELB,
+                                                 od->nbr->copp,
+                                                 meter_groups),
+                                  &lb->nlb->header_, lflow_ref);
     }
+}
 
-    if (lb->skip_snat) {
-        BITMAP_FOR_EACH_1 (index, ods_size(lr_datapaths), lb_dps->nb_lr_map) {
-            struct ovn_datapath *od = lr_datapaths->array[index];
+static void
+build_lrouter_skip_snat_flows_for_lb(struct ovn_lb_datapaths *lb_dps,
+                                     struct lflow_table *lflows,
+                                     const struct ovn_datapaths *lr_datapaths)
+{
+    size_t index;
+
+    if (!lb_dps->n_nb_lr || !lb_dps->lb->skip_snat) {
+        return;
+    }
+
+    BITMAP_FOR_EACH_1 (index, ods_size(lr_datapaths), lb_dps->nb_lr_map) {
+        struct ovn_datapath *od = lr_datapaths->array[index];
+
+        ovn_lflow_add(lflows, od, S_ROUTER_OUT_SNAT, 120,
+                      "flags.skip_snat_for_lb == 1 && ip", "next;",
+                      lb_dps->lflow_ref);
+    }
+}
+
+/* Appends the key-value pairs of 'smap' to 'ds', sorted by key. */
+static void
+ds_put_smap_sorted(struct ds *ds, const struct smap *smap)
+{
+    const struct smap_node **nodes = smap_sort(smap);
+    for (size_t i = 0; i < smap_count(smap); i++) {
+        ds_put_format(ds, "%s=%s,", nodes[i]->key, nodes[i]->value);
+    }
+    free(nodes);
+}
+
+/* Returns a string that represents the configuration of 'lb' that the
+ * logical flows of all of its VIPs depend on. */
+static char *
+lb_lflows_config(const struct ovn_northd_lb *lb)
+{
+    struct ds config = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&config, "%s;%s;", lb->proto,
+                  lb->selection_fields ? lb->selection_fields : "");
+    ds_put_smap_sorted(&config, &lb->nlb->options);
+
+    return ds_steal_cstr(&config);
+}
+
+/* Builds the logical flows of the load balancer 'lb_dps'.
+ *
+ * The logical flows of each VIP are referenced by the lflow_ref of the VIP,
+ * see ovn_lb_datapaths_add_vip_lflow_ref().  Unless 'rebuild_all' is true,
+ * the flows of the VIPs whose lflow_ref was built with the current LB
+ * configuration, datapaths and backends are kept as they are, so that a
+ * change to one VIP, or to its backends, only rebuilds the flows of that
+ * VIP.  The lflow_refs of the VIPs that are gone are left marked as stale
+ * for the caller to remove them.  The flows that don't depend on a VIP are
+ * always rebuilt. */
+static void
+build_lb_datapaths_flows(struct ovn_lb_datapaths *lb_dps, bool rebuild_all,
+                         struct lflow_table *lflows,
+                         const struct hmap *ls_ports,
+                         const char *svc_monitor_mac,
+                         const struct ovn_datapaths *ls_datapaths,
+                         const struct ovn_datapaths *lr_datapaths,
+                         const struct lr_stateful_table *lr_stateful_table,
+                         const struct shash *meter_groups,
+                         const struct chassis_features *features,
+                         const struct hmap *svc_monitor_map,
+                         struct ds *match, struct ds *actions)
+{
+    const struct ovn_northd_lb *lb = lb_dps->lb;
+    char *config = lb_lflows_config(lb);
+
+    if (!lb_dps->lflows_config || strcmp(config, lb_dps->lflows_config)
+        || lb_dps->lflows_n_nb_ls != lb_dps->n_nb_ls
+        || lb_dps->lflows_n_nb_lr != lb_dps->n_nb_lr) {
+        rebuild_all = true;
+    }
+    free(lb_dps->lflows_config);
+    lb_dps->lflows_config = config;
+    lb_dps->lflows_n_nb_ls = lb_dps->n_nb_ls;
+    lb_dps->lflows_n_nb_lr = lb_dps->n_nb_lr;
 
-            ovn_lflow_add(lflows, od, S_ROUTER_OUT_SNAT, 120,
-                          "flags.skip_snat_for_lb == 1 && ip", "next;",
-                          lb_dps->lflow_ref);
+    lflow_ref_unlink_lflows(lb_dps->lflow_ref);
+    build_lswitch_arp_nd_service_monitor(lb_dps, ls_ports, svc_monitor_mac,
+                                         lflows, actions, match);
+    build_lrouter_skip_snat_flows_for_lb(lb_dps, lflows, lr_datapaths);
+
+    struct ovn_lb_vip_lflow_ref *vip_ref;
+    HMAP_FOR_EACH (vip_ref, hmap_node, &lb_dps->vip_lflow_refs) {
+        vip_ref->stale = true;
+        vip_ref->rebuilt = false;
+    }
+
+    for (size_t i = 0; i < lb->n_vips; i++) {
+        char *active_backends = lb_vip_active_backends(lb, i,
+                                                       svc_monitor_map);
+        vip_ref = ovn_lb_datapaths_add_vip_lflow_ref(lb_dps, i,
+                                                     active_backends);
+        free(active_backends);
+        if (vip_ref->stale) {
+            /* Built by a previous run. */
+            vip_ref->stale = false;
+            if (!rebuild_all) {
+                continue;
+            }
+            lflow_ref_unlink_lflows(vip_ref->lflow_ref);
+            vip_ref->rebuilt = true;
+        } else if (!vip_ref->rebuilt) {
+            /* Duplicate of a VIP whose flows were kept. */
+            continue;
         }
+
+        build_lrouter_defrag_flows_for_lb_vip(lb_dps, i, lflows, lr_datapaths,
+                                              match, vip_ref->lflow_ref);
+        build_lrouter_flows_for_lb_vip(lb_dps, i, lflows, meter_groups,
+                                       lr_datapaths, lr_stateful_table,
+                                       features, svc_monitor_map,
+                                       match, actions, vip_ref->lflow_ref);
+        build_lswitch_flows_for_lb_vip(lb_dps, i, lflows, meter_groups,
+                                       ls_datapaths, features,
+                                       svc_monitor_map, match, actions,
+                                       vip_ref->lflow_ref);
     }
 }
 
@@ -12706,20 +15278,84 @@ build_ip_routing_flows_for_lrp(
                   lflow_ref);
     }
 
-    for (int i = 0; i < op->lrp_networks.n_ipv6_addrs; i++) {
-        add_route(lflows, op->od, op, op->lrp_networks.ipv6_addrs[i].addr_s,
-                  op->lrp_networks.ipv6_addrs[i].network_s,
-                  op->lrp_networks.ipv6_addrs[i].plen, NULL, false, 0,
-                  &op->nbrp->header_, false, ROUTE_PRIO_OFFSET_CONNECTED,
-                  lflow_ref);
+    for (int i = 0; i < op->lrp_networks.n_ipv6_addrs; i++) {
+        add_route(lflows, op->od, op, op->lrp_networks.ipv6_addrs[i].addr_s,
+                  op->lrp_networks.ipv6_addrs[i].network_s,
+                  op->lrp_networks.ipv6_addrs[i].plen, NULL, false, 0,
+                  &op->nbrp->header_, false, ROUTE_PRIO_OFFSET_CONNECTED,
+                  lflow_ref);
+    }
+}
+
+/* Logical router ingress table ARP_REQUEST: IPv6 ND solicitations for the
+ * next hops of the static routes (priority 200). */
+static void
+build_static_route_nd_flows_for_lrouter(
+        struct ovn_datapath *od, struct lflow_table *lflows,
+        const struct shash *meter_groups,
+        struct lflow_ref *lflow_ref)
+{
+    struct ds match = DS_EMPTY_INITIALIZER;
+    struct ds actions = DS_EMPTY_INITIALIZER;
+
+    for (int i = 0; i < od->nbr->n_static_routes; i++) {
+        const struct nbrec_logical_router_static_route *route;
+
+        route = od->nbr->static_routes[i];
+        struct in6_addr gw_ip6;
+        unsigned int plen;
+        char *error = ipv6_parse_cidr(route->nexthop, &gw_ip6, &plen);
+        if (error || plen != 128) {
+            free(error);
+            continue;
+        }
+
+        ds_clear(&match);
+        ds_put_format(&match, "eth.dst == 00:00:00:00:00:00 && "
+                      "ip6 && " REG_NEXT_HOP_IPV6 " == %s",
+                      route->nexthop);
+        struct in6_addr sn_addr;
+        struct eth_addr eth_dst;
+        in6_addr_solicited_node(&sn_addr, &gw_ip6);
+        ipv6_multicast_to_ethernet(&eth_dst, &sn_addr);
+
+        char sn_addr_s[INET6_ADDRSTRLEN + 1];
+        ipv6_string_mapped(sn_addr_s, &sn_addr);
+
+        ds_clear(&actions);
+        ds_put_format(&actions,
+                      "nd_ns { "
+                      "eth.dst = "ETH_ADDR_FMT"; "
+                      "ip6.dst = %s; "
+                      "nd.target = %s; "
+                      "output; "
+                      "}; output;", ETH_ADDR_ARGS(eth_dst), sn_addr_s,
+                      route->nexthop);
+
+        ovn_lflow_add_with_hint__(lflows, od, S_ROUTER_IN_ARP_REQUEST, 200,
+                                  ds_cstr(&match), ds_cstr(&actions), NULL,
+                                  copp_meter_get(COPP_ND_NS_RESOLVE,
+                                                 od->nbr->copp,
+                                                 meter_groups),
+                                  &route->header_,
+                                  lflow_ref);
     }
+
+
+    ds_destroy(&match);
+    ds_destroy(&actions);
 }
 
+/* Logical router ingress tables IP_ROUTING and IP_ROUTING_ECMP: the routing
+ * flows built from the static routes of the router.  All of them reference
+ * 'lflow_ref', so that a change to the static routes of a single router
+ * only regenerates, and resyncs, the flows of that router. */
 static void
 build_static_route_flows_for_lrouter(
         struct ovn_datapath *od, const struct chassis_features *features,
         struct lflow_table *lflows, const struct hmap *lr_ports,
         const struct hmap *bfd_connections,
+        const struct shash *meter_groups,
         struct lflow_ref *lflow_ref)
 {
     ovs_assert(od->nbr);
@@ -12742,7 +15378,12 @@ build_static_route_flows_for_lrouter(
                                 &route_tables, lflow_ref);
     }
 
+    od->routes_have_bfd = false;
     for (int i = 0; i < od->nbr->n_static_routes; i++) {
+        if (od->nbr->static_routes[i]->bfd) {
+            od->routes_have_bfd = true;
+        }
+
         struct parsed_route *route =
             parsed_routes_add(od, lr_ports, &parsed_routes, &route_tables,
                               od->nbr->static_routes[i], bfd_connections);
@@ -12765,6 +15406,9 @@ build_static_route_flows_for_lrouter(
             }
         }
     }
+    if (smap_get_bool(&od->nbr->options, "compact_static_routes", false)) {
+        unique_routes_compact(od, &unique_routes, &ecmp_groups);
+    }
     HMAP_FOR_EACH (group, hmap_node, &ecmp_groups) {
         /* add a flow in IP_ROUTING, and one flow for each member in
          * IP_ROUTING_ECMP. */
@@ -12779,6 +15423,9 @@ build_static_route_flows_for_lrouter(
     unique_routes_destroy(&unique_routes);
     parsed_routes_destroy(&parsed_routes);
     simap_destroy(&route_tables);
+
+    build_static_route_nd_flows_for_lrouter(od, lflows, meter_groups,
+                                            lflow_ref);
 }
 
 /* IP Multicast lookup. Here we set the output port, adjust TTL and
@@ -12885,6 +15532,86 @@ build_mcast_lookup_flows_for_lrouter(
     }
 }
 
+/* Returns the key of the lflow reference of the routing policy 'rule',
+ * made of the policy row and of the ECMP group id it uses, if any. */
+static char *
+lr_policy_lflows_key(const struct nbrec_logical_router_policy *rule,
+                     uint16_t ecmp_group_id)
+{
+    struct ds key = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&key, UUID_FMT";%"PRId64";%s;%s;%s;%"PRIu16";",
+                  UUID_ARGS(&rule->header_.uuid), rule->priority,
+                  rule->match, rule->action,
+                  rule->nexthop ? rule->nexthop : "", ecmp_group_id);
+    for (size_t i = 0; i < rule->n_nexthops; i++) {
+        ds_put_format(&key, "%s,", rule->nexthops[i]);
+    }
+    ds_put_char(&key, ';');
+    ds_put_smap_sorted(&key, &rule->options);
+    for (size_t i = 0; i < rule->n_bfd_sessions; i++) {
+        ds_put_format(&key, ";"UUID_FMT,
+                      UUID_ARGS(&rule->bfd_sessions[i]->header_.uuid));
+    }
+
+    return ds_steal_cstr(&key);
+}
+
+/* Builds the logical flows of the routing policies of 'od'.
+ *
+ * Same as for the NAT entries in build_lr_stateful_nat_flows(), the logical
+ * flows of each policy are referenced by their own lflow_ref, see
+ * ovn_datapath_add_policy_lflow_ref(), and the flows of the policies whose
+ * key is unchanged are kept as they are.  The ECMP group id of a reroute
+ * policy with several nexthops is part of its key, so that a policy gets
+ * rebuilt when adding or removing another one shifts its group id.  The
+ * lflow_refs of the policies that are gone are left marked as stale for
+ * the caller to remove them. */
+static void
+build_lr_policy_flows(struct ovn_datapath *od, struct lflow_table *lflows,
+                      const struct hmap *lr_ports,
+                      const struct hmap *bfd_connections)
+{
+    struct lr_policy_lflow_ref *policy_ref;
+    HMAP_FOR_EACH (policy_ref, hmap_node, &od->policy_lflow_refs) {
+        policy_ref->stale = true;
+        policy_ref->rebuilt = false;
+    }
+
+    /* Convert routing policies to flows. */
+    uint16_t ecmp_group_id = 1;
+    for (int i = 0; i < od->nbr->n_policies; i++) {
+        const struct nbrec_logical_router_policy *rule
+            = od->nbr->policies[i];
+        bool is_ecmp_reroute =
+            (!strcmp(rule->action, "reroute") && rule->n_nexthops > 1);
+
+        char *key = lr_policy_lflows_key(rule,
+                                         is_ecmp_reroute ? ecmp_group_id : 0);
+        policy_ref = ovn_datapath_add_policy_lflow_ref(od, key);
+        policy_ref->has_bfd = rule->n_bfd_sessions > 0;
+        if (policy_ref->stale) {
+            /* Built by a previous run. */
+            policy_ref->stale = false;
+            if (is_ecmp_reroute) {
+                ecmp_group_id++;
+            }
+            continue;
+        }
+
+        if (is_ecmp_reroute) {
+            build_ecmp_routing_policy_flows(lflows, od, lr_ports, rule,
+                                            bfd_connections, ecmp_group_id,
+                                            policy_ref->lflow_ref);
+            ecmp_group_id++;
+        } else {
+            build_routing_policy_flow(lflows, od, lr_ports, rule,
+                                      bfd_connections, &rule->header_,
+                                      policy_ref->lflow_ref);
+        }
+    }
+}
+
 /* Logical router ingress table POLICY: Policy.
  *
  * A packet that arrives at this table is an IP packet that should be
@@ -12913,25 +15640,7 @@ build_ingress_policy_flows_for_lrouter(
     ovn_lflow_add_default_drop(lflows, od, S_ROUTER_IN_POLICY_ECMP,
                                lflow_ref);
 
-    /* Convert routing policies to flows. */
-    uint16_t ecmp_group_id = 1;
-    for (int i = 0; i < od->nbr->n_policies; i++) {
-        const struct nbrec_logical_router_policy *rule
-            = od->nbr->policies[i];
-        bool is_ecmp_reroute =
-            (!strcmp(rule->action, "reroute") && rule->n_nexthops > 1);
-
-        if (is_ecmp_reroute) {
-            build_ecmp_routing_policy_flows(lflows, od, lr_ports, rule,
-                                            bfd_connections, ecmp_group_id,
-                                            lflow_ref);
-            ecmp_group_id++;
-        } else {
-            build_routing_policy_flow(lflows, od, lr_ports, rule,
-                                      bfd_connections, &rule->header_,
-                                      lflow_ref);
-        }
-    }
+    build_lr_policy_flows(od, lflows, lr_ports, bfd_connections);
 }
 
 /* Local router ingress table ARP_RESOLVE: ARP Resolution. */
@@ -13066,7 +15775,11 @@ build_arp_resolve_flows_for_lsp(
          * Extract its addresses. For each of the address, go through all
          * the router ports attached to the switch (to which this port
          * connects) and if the address in question is reachable from the
-         * router port, add an ARP/ND entry in that router's pipeline. */
+         * router port, add an ARP/ND entry in that router's pipeline.
+         *
+         * Routers with static neighbor bindings resolve these addresses
+         * through Static_MAC_Binding rows instead, see
+         * lsp_collect_static_neigh_bindings(). */
 
         for (size_t i = 0; i < op->n_lsp_addrs; i++) {
             const char *ea_s = op->lsp_addrs[i].ea_s;
@@ -13078,7 +15791,8 @@ build_arp_resolve_flows_for_lsp(
                      * 'peer'. */
                     struct ovn_port *peer = ovn_port_get_peer(
                             lr_ports, op->od->router_ports[k]);
-                    if (!peer || !peer->nbrp) {
+                    if (!peer || !peer->nbrp
+                        || lr_has_static_neigh_bindings(peer->od)) {
                         continue;
                     }
 
@@ -13110,7 +15824,8 @@ build_arp_resolve_flows_for_lsp(
                      * 'peer'. */
                     struct ovn_port *peer = ovn_port_get_peer(
                             lr_ports, op->od->router_ports[k]);
-                    if (!peer || !peer->nbrp) {
+                    if (!peer || !peer->nbrp
+                        || lr_has_static_neigh_bindings(peer->od)) {
                         continue;
                     }
 
@@ -13513,54 +16228,10 @@ build_lr_gateway_redirect_flows_for_nats(
 static void
 build_arp_request_flows_for_lrouter(
         struct ovn_datapath *od, struct lflow_table *lflows,
-        struct ds *match, struct ds *actions,
         const struct shash *meter_groups,
         struct lflow_ref *lflow_ref)
 {
     ovs_assert(od->nbr);
-    for (int i = 0; i < od->nbr->n_static_routes; i++) {
-        const struct nbrec_logical_router_static_route *route;
-
-        route = od->nbr->static_routes[i];
-        struct in6_addr gw_ip6;
-        unsigned int plen;
-        char *error = ipv6_parse_cidr(route->nexthop, &gw_ip6, &plen);
-        if (error || plen != 128) {
-            free(error);
-            continue;
-        }
-
-        ds_clear(match);
-        ds_put_format(match, "eth.dst == 00:00:00:00:00:00 && "
-                      "ip6 && " REG_NEXT_HOP_IPV6 " == %s",
-                      route->nexthop);
-        struct in6_addr sn_addr;
-        struct eth_addr eth_dst;
-        in6_addr_solicited_node(&sn_addr, &gw_ip6);
-        ipv6_multicast_to_ethernet(&eth_dst, &sn_addr);
-
-        char sn_addr_s[INET6_ADDRSTRLEN + 1];
-        ipv6_string_mapped(sn_addr_s, &sn_addr);
-
-        ds_clear(actions);
-        ds_put_format(actions,
-                      "nd_ns { "
-                      "eth.dst = "ETH_ADDR_FMT"; "
-                      "ip6.dst = %s; "
-                      "nd.target = %s; "
-                      "output; "
-                      "}; output;", ETH_ADDR_ARGS(eth_dst), sn_addr_s,
-                      route->nexthop);
-
-        ovn_lflow_add_with_hint__(lflows, od, S_ROUTER_IN_ARP_REQUEST, 200,
-                                  ds_cstr(match), ds_cstr(actions), NULL,
-                                  copp_meter_get(COPP_ND_NS_RESOLVE,
-                                                 od->nbr->copp,
-                                                 meter_groups),
-                                  &route->header_,
-                                  lflow_ref);
-    }
-
     ovn_lflow_metered(lflows, od, S_ROUTER_IN_ARP_REQUEST, 100,
                       "eth.dst == 00:00:00:00:00:00 && ip4",
                       "arp { "
@@ -14080,61 +16751,6 @@ build_ipv6_input_flows_for_lrouter_port(
     ds_destroy(&ip_ds);
 }
 
-static void
-build_lrouter_arp_nd_for_datapath(const struct ovn_datapath *od,
-                                  const struct lr_nat_record *lrnat_rec,
-                                  struct lflow_table *lflows,
-                                  const struct shash *meter_groups,
-                                  struct lflow_ref *lflow_ref)
-{
-    ovs_assert(od->nbr);
-    if (!od->nbr->n_nat) {
-        return;
-    }
-
-    /* Priority-90-92 flows handle ARP requests and ND packets. Most are
-     * per logical port but DNAT addresses can be handled per datapath
-     * for non gateway router ports.
-     *
-     * Priority 91 and 92 flows are added for each gateway router
-     * port to handle the special cases. In case we get the packet
-     * on a regular port, just reply with the port's ETH address.
-     */
-    for (size_t i = 0; i < lrnat_rec->n_nat_entries; i++) {
-        struct ovn_nat *nat_entry = &lrnat_rec->nat_entries[i];
-
-        /* Skip entries we failed to parse. */
-        if (!nat_entry_is_valid(nat_entry)) {
-            continue;
-        }
-
-        /* Skip SNAT entries for now, we handle unique SNAT IPs separately
-        * below.
-        */
-        if (!strcmp(nat_entry->nb->type, "snat")) {
-            continue;
-        }
-        build_lrouter_nat_arp_nd_flow(od, nat_entry, lflows, meter_groups,
-                                      lflow_ref);
-    }
-
-    /* Now handle SNAT entries too, one per unique SNAT IP. */
-    struct shash_node *snat_snode;
-    SHASH_FOR_EACH (snat_snode, &lrnat_rec->snat_ips) {
-        struct ovn_snat_ip *snat_ip = snat_snode->data;
-
-        if (ovs_list_is_empty(&snat_ip->snat_entries)) {
-            continue;
-        }
-
-        struct ovn_nat *nat_entry =
-            CONTAINER_OF(ovs_list_front(&snat_ip->snat_entries),
-                         struct ovn_nat, ext_addr_list_node);
-        build_lrouter_nat_arp_nd_flow(od, nat_entry, lflows, meter_groups,
-                                      lflow_ref);
-    }
-}
-
 /* Logical router ingress table 3: IP Input for IPv4. */
 static void
 build_lrouter_ipv4_ip_input(struct ovn_port *op,
@@ -15216,9 +17832,7 @@ static void
 build_lrouter_nat_defrag_and_lb(
     const struct lr_stateful_record *lr_stateful_rec,
     const struct ovn_datapath *od, struct lflow_table *lflows,
-    const struct hmap *ls_ports, const struct hmap *lr_ports,
     struct ds *match, struct ds *actions,
-    const struct shash *meter_groups,
     const struct chassis_features *features,
     struct lflow_ref *lflow_ref)
 {
@@ -15301,255 +17915,26 @@ build_lrouter_nat_defrag_and_lb(
         ovn_lflow_add(lflows, od, S_ROUTER_OUT_UNDNAT, 50,
                       "ip", "flags.loopback = 1; ct_dnat;",
                       lflow_ref);
-        ovn_lflow_add(lflows, od, S_ROUTER_OUT_POST_UNDNAT, 50,
-                      "ip && ct.new", "ct_commit { } ; next; ",
-                      lflow_ref);
-    }
-
-    /* NAT rules are only valid on Gateway routers and routers with
-     * l3dgw_ports (router has port(s) with gateway chassis
-     * specified). */
-    if (!od->is_gw_router && !od->n_l3dgw_ports) {
-        return;
-    }
-
-    struct sset nat_entries = SSET_INITIALIZER(&nat_entries);
-    const struct lr_nat_record *lrnat_rec = lr_stateful_rec->lrnat_rec;
-    ovs_assert(lrnat_rec);
-
-    bool dnat_force_snat_ip =
-        !lport_addresses_is_empty(&lrnat_rec->dnat_force_snat_addrs);
-    bool lb_force_snat_ip =
-        !lport_addresses_is_empty(&lrnat_rec->lb_force_snat_addrs);
-
-    for (size_t i = 0; i < lrnat_rec->n_nat_entries; i++) {
-        struct ovn_nat *nat_entry = &lrnat_rec->nat_entries[i];
-        const struct nbrec_nat *nat = nat_entry->nb;
-        struct eth_addr mac = eth_addr_broadcast;
-        bool is_v6, distributed_nat;
-        ovs_be32 mask;
-        int cidr_bits;
-        struct ovn_port *l3dgw_port;
-
-        bool stateless = lrouter_dnat_and_snat_is_stateless(nat);
-
-        if (lrouter_check_nat_entry(od, nat, lr_ports, &mask, &is_v6,
-                                    &cidr_bits,
-                                    &mac, &distributed_nat, &l3dgw_port) < 0) {
-            continue;
-        }
-
-        /* S_ROUTER_IN_UNSNAT
-         * Ingress UNSNAT table: It is for already established connections'
-         * reverse traffic. i.e., SNAT has already been done in egress
-         * pipeline and now the packet has entered the ingress pipeline as
-         * part of a reply. We undo the SNAT here.
-         *
-         * Undoing SNAT has to happen before DNAT processing.  This is
-         * because when the packet was DNATed in ingress pipeline, it did
-         * not know about the possibility of eventual additional SNAT in
-         * egress pipeline. */
-        if (stateless) {
-            build_lrouter_in_unsnat_stateless_flow(lflows, od, nat, match,
-                                                   distributed_nat, is_v6,
-                                                   l3dgw_port, lflow_ref);
-        } else if (lrouter_use_common_zone(od)) {
-            build_lrouter_in_unsnat_in_czone_flow(lflows, od, nat, match,
-                                                  distributed_nat, is_v6,
-                                                  l3dgw_port, lflow_ref);
-        } else {
-            build_lrouter_in_unsnat_flow(lflows, od, nat, match,
-                                         distributed_nat, is_v6, l3dgw_port,
-                                         lflow_ref);
-        }
-        /* S_ROUTER_IN_DNAT */
-        build_lrouter_in_dnat_flow(lflows, od, lrnat_rec, nat, match, actions,
-                                   distributed_nat, cidr_bits, is_v6,
-                                   l3dgw_port, stateless, lflow_ref);
-
-        /* ARP resolve for NAT IPs. */
-        if (!od->is_gw_router) {
-            if (!sset_contains(&nat_entries, nat->external_ip)) {
-                /* Drop packets coming in from external that still has
-                 * destination IP equals to the NAT external IP, to avoid loop.
-                 * The packets must have gone through DNAT/unSNAT stage but
-                 * failed to convert the destination. */
-                ds_clear(match);
-                ds_put_format(
-                    match, "inport == %s && outport == %s && ip%s.dst == %s",
-                    l3dgw_port->json_key, l3dgw_port->json_key,
-                    is_v6 ? "6" : "4", nat->external_ip);
-                ovn_lflow_add_with_hint(lflows, od,
-                                        S_ROUTER_IN_ARP_RESOLVE,
-                                        150, ds_cstr(match),
-                                        debug_drop_action(),
-                                        &nat->header_,
-                                        lflow_ref);
-                /* Now for packets coming from other (downlink) LRPs, allow ARP
-                 * resolve for the NAT IP, so that such packets can be
-                 * forwarded for E/W NAT. */
-                ds_clear(match);
-                ds_put_format(
-                    match, "outport == %s && %s == %s",
-                    l3dgw_port->json_key,
-                    is_v6 ? REG_NEXT_HOP_IPV6 : REG_NEXT_HOP_IPV4,
-                    nat->external_ip);
-                ds_clear(actions);
-                ds_put_format(
-                    actions, "eth.dst = %s; next;",
-                    distributed_nat ? nat->external_mac :
-                    l3dgw_port->lrp_networks.ea_s);
-                ovn_lflow_add_with_hint(lflows, od,
-                                        S_ROUTER_IN_ARP_RESOLVE,
-                                        100, ds_cstr(match),
-                                        ds_cstr(actions),
-                                        &nat->header_,
-                                        lflow_ref);
-                if (od->redirect_bridged && distributed_nat) {
-                    ds_clear(match);
-                    ds_put_format(
-                            match,
-                            "outport == %s && ip%s.src == %s "
-                            "&& is_chassis_resident(\"%s\")",
-                            od->l3dgw_ports[0]->json_key,
-                            is_v6 ? "6" : "4", nat->logical_ip,
-                            nat->logical_port);
-                    ds_clear(actions);
-                    if (is_v6) {
-                        ds_put_cstr(actions,
-                            "get_nd(outport, " REG_NEXT_HOP_IPV6 "); next;");
-                    } else {
-                        ds_put_cstr(actions,
-                            "get_arp(outport, " REG_NEXT_HOP_IPV4 "); next;");
-                    }
-                    ovn_lflow_add_with_hint(lflows, od,
-                                            S_ROUTER_IN_ARP_RESOLVE, 90,
-                                            ds_cstr(match), ds_cstr(actions),
-                                            &nat->header_,
-                                            lflow_ref);
-                }
-                sset_add(&nat_entries, nat->external_ip);
-            }
-        }
-
-        if (use_common_zone) {
-            /* S_ROUTER_OUT_DNAT_LOCAL */
-            build_lrouter_out_is_dnat_local(lflows, od, nat, match, actions,
-                                            distributed_nat, is_v6,
-                                            l3dgw_port, lflow_ref);
-        }
-
-        /* S_ROUTER_OUT_UNDNAT */
-        build_lrouter_out_undnat_flow(lflows, od, nat, match, actions,
-                                      distributed_nat, mac, is_v6, l3dgw_port,
-                                      stateless, lflow_ref);
-        /* S_ROUTER_OUT_SNAT
-         * Egress SNAT table: Packets enter the egress pipeline with
-         * source ip address that needs to be SNATted to a external ip
-         * address. */
-        if (stateless) {
-            build_lrouter_out_snat_stateless_flow(lflows, od, nat, match,
-                                                  actions, distributed_nat,
-                                                  mac, cidr_bits, is_v6,
-                                                  l3dgw_port, lflow_ref);
-        } else if (lrouter_use_common_zone(od)) {
-            build_lrouter_out_snat_in_czone_flow(lflows, od, nat, match,
-                                                 actions, distributed_nat, mac,
-                                                 cidr_bits, is_v6, l3dgw_port,
-                                                 lflow_ref);
-        } else {
-            build_lrouter_out_snat_flow(lflows, od, nat, match, actions,
-                                        distributed_nat, mac, cidr_bits, is_v6,
-                                        l3dgw_port, lflow_ref, features);
-        }
-
-        /* S_ROUTER_IN_ADMISSION - S_ROUTER_IN_IP_INPUT */
-        build_lrouter_ingress_flow(lflows, od, nat, match, actions, mac,
-                                   distributed_nat, is_v6, l3dgw_port,
-                                   meter_groups, lflow_ref);
-
-        /* Ingress Gateway Redirect Table: For NAT on a distributed
-         * router, add flows that are specific to a NAT rule.  These
-         * flows indicate the presence of an applicable NAT rule that
-         * can be applied in a distributed manner.
-         * In particulr REG_SRC_IPV4/REG_SRC_IPV6 and eth.src are set to
-         * NAT external IP and NAT external mac so the ARP request
-         * generated in the following stage is sent out with proper IP/MAC
-         * src addresses.
-         */
-        if (distributed_nat) {
-            ds_clear(match);
-            ds_clear(actions);
-            ds_put_format(match,
-                          "ip%s.src == %s && outport == %s",
-                          is_v6 ? "6" : "4", nat->logical_ip,
-                          l3dgw_port->json_key);
-            /* Add a rule to drop traffic from a distributed NAT if
-             * the virtual port has not claimed yet becaused otherwise
-             * the traffic will be centralized misconfiguring the TOR switch.
-             */
-            struct ovn_port *op = ovn_port_find(ls_ports,
-                                                nat->logical_port);
-            if (op && op->nbsp && !strcmp(op->nbsp->type, "virtual")) {
-                ovn_lflow_add_with_hint(lflows, od, S_ROUTER_IN_GW_REDIRECT,
-                                        80, ds_cstr(match),
-                                        debug_drop_action(), &nat->header_,
-                                        lflow_ref);
-            }
-            ds_put_format(match, " && is_chassis_resident(\"%s\")",
-                          nat->logical_port);
-            ds_put_format(actions, "eth.src = %s; %s = %s; next;",
-                          nat->external_mac,
-                          is_v6 ? REG_SRC_IPV6 : REG_SRC_IPV4,
-                          nat->external_ip);
-            ovn_lflow_add_with_hint(lflows, od, S_ROUTER_IN_GW_REDIRECT,
-                                    100, ds_cstr(match),
-                                    ds_cstr(actions), &nat->header_,
-                                    lflow_ref);
-        }
-
-        /* Egress Loopback table: For NAT on a distributed router.
-         * If packets in the egress pipeline on the distributed
-         * gateway port have ip.dst matching a NAT external IP, then
-         * loop a clone of the packet back to the beginning of the
-         * ingress pipeline with inport = outport. */
-        if (od->n_l3dgw_ports) {
-            /* Distributed router. */
-            ds_clear(match);
-            ds_put_format(match, "ip%s.dst == %s && outport == %s",
-                          is_v6 ? "6" : "4",
-                          nat->external_ip,
-                          l3dgw_port->json_key);
-            if (!distributed_nat) {
-                ds_put_format(match, " && is_chassis_resident(%s)",
-                              l3dgw_port->cr_port->json_key);
-            } else {
-                ds_put_format(match, " && is_chassis_resident(\"%s\")",
-                              nat->logical_port);
-            }
+        ovn_lflow_add(lflows, od, S_ROUTER_OUT_POST_UNDNAT, 50,
+                      "ip && ct.new", "ct_commit { } ; next; ",
+                      lflow_ref);
+    }
 
-            ds_clear(actions);
-            ds_put_format(actions,
-                          "clone { ct_clear; "
-                          "inport = outport; outport = \"\"; "
-                          "eth.dst <-> eth.src; "
-                          "flags = 0; flags.loopback = 1; ");
-            if (use_common_zone) {
-                ds_put_cstr(actions, "flags.use_snat_zone = "
-                            REGBIT_DST_NAT_IP_LOCAL"; ");
-            }
-            for (int j = 0; j < MFF_N_LOG_REGS; j++) {
-                ds_put_format(actions, "reg%d = 0; ", j);
-            }
-            ds_put_format(actions, REGBIT_EGRESS_LOOPBACK" = 1; "
-                          "next(pipeline=ingress, table=%d); };",
-                          ovn_stage_get_table(S_ROUTER_IN_ADMISSION));
-            ovn_lflow_add_with_hint(lflows, od, S_ROUTER_OUT_EGR_LOOP, 100,
-                                    ds_cstr(match), ds_cstr(actions),
-                                    &nat->header_, lflow_ref);
-        }
+    /* NAT rules are only valid on Gateway routers and routers with
+     * l3dgw_ports (router has port(s) with gateway chassis
+     * specified). */
+    if (!od->is_gw_router && !od->n_l3dgw_ports) {
+        return;
     }
 
+    const struct lr_nat_record *lrnat_rec = lr_stateful_rec->lrnat_rec;
+    ovs_assert(lrnat_rec);
+
+    bool dnat_force_snat_ip =
+        !lport_addresses_is_empty(&lrnat_rec->dnat_force_snat_addrs);
+    bool lb_force_snat_ip =
+        !lport_addresses_is_empty(&lrnat_rec->lb_force_snat_addrs);
+
     if (use_common_zone && od->nbr->n_nat) {
         ds_clear(match);
         const char *ct_natted = features->ct_no_masked_label ?
@@ -15597,8 +17982,411 @@ build_lrouter_nat_defrag_and_lb(
             }
         }
     }
+}
+
+/* Builds the NAT flows of the NAT entry 'nat' of the logical router 'od',
+ * which is a gateway router or a router with distributed gateway ports.
+ * 'mac', 'is_v6', 'cidr_bits', 'distributed_nat' and 'l3dgw_port' are the
+ * results of lrouter_check_nat_entry() for 'nat'.  'owns_ext_ip' is true if
+ * 'nat' is the first valid NAT entry of the router with its external IP. */
+static void
+build_lrouter_nat_flows_for_entry(
+    const struct ovn_datapath *od, const struct lr_nat_record *lrnat_rec,
+    const struct nbrec_nat *nat, struct lflow_table *lflows,
+    const struct hmap *ls_ports, struct ds *match, struct ds *actions,
+    const struct shash *meter_groups,
+    const struct chassis_features *features, struct eth_addr mac,
+    bool is_v6, int cidr_bits, bool distributed_nat,
+    struct ovn_port *l3dgw_port, bool owns_ext_ip,
+    struct lflow_ref *lflow_ref)
+{
+    bool stateless = lrouter_dnat_and_snat_is_stateless(nat);
+
+    /* S_ROUTER_IN_UNSNAT
+     * Ingress UNSNAT table: It is for already established connections'
+     * reverse traffic. i.e., SNAT has already been done in egress
+     * pipeline and now the packet has entered the ingress pipeline as
+     * part of a reply. We undo the SNAT here.
+     *
+     * Undoing SNAT has to happen before DNAT processing.  This is
+     * because when the packet was DNATed in ingress pipeline, it did
+     * not know about the possibility of eventual additional SNAT in
+     * egress pipeline. */
+    if (stateless) {
+        build_lrouter_in_unsnat_stateless_flow(lflows, od, nat, match,
+                                               distributed_nat, is_v6,
+                                               l3dgw_port, lflow_ref);
+    } else if (lrouter_use_common_zone(od)) {
+        build_lrouter_in_unsnat_in_czone_flow(lflows, od, nat, match,
+                                              distributed_nat, is_v6,
+                                              l3dgw_port, lflow_ref);
+    } else {
+        build_lrouter_in_unsnat_flow(lflows, od, nat, match,
+                                     distributed_nat, is_v6, l3dgw_port,
+                                     lflow_ref);
+    }
+    /* S_ROUTER_IN_DNAT */
+    build_lrouter_in_dnat_flow(lflows, od, lrnat_rec, nat, match, actions,
+                               distributed_nat, cidr_bits, is_v6,
+                               l3dgw_port, stateless, lflow_ref);
+
+    /* ARP resolve for NAT IPs.  Only one NAT entry, the first one,
+     * builds these flows for a given external IP. */
+    if (!od->is_gw_router && owns_ext_ip) {
+        /* Drop packets coming in from external that still has
+         * destination IP equals to the NAT external IP, to avoid loop.
+         * The packets must have gone through DNAT/unSNAT stage but
+         * failed to convert the destination. */
+        ds_clear(match);
+        ds_put_format(
+            match, "inport == %s && outport == %s && ip%s.dst == %s",
+            l3dgw_port->json_key, l3dgw_port->json_key,
+            is_v6 ? "6" : "4", nat->external_ip);
+        ovn_lflow_add_with_hint(lflows, od,
+                                S_ROUTER_IN_ARP_RESOLVE,
+                                150, ds_cstr(match),
+                                debug_drop_action(),
+                                &nat->header_,
+                                lflow_ref);
+        /* Now for packets coming from other (downlink) LRPs, allow ARP
+         * resolve for the NAT IP, so that such packets can be
+         * forwarded for E/W NAT. */
+        ds_clear(match);
+        ds_put_format(
+            match, "outport == %s && %s == %s",
+            l3dgw_port->json_key,
+            is_v6 ? REG_NEXT_HOP_IPV6 : REG_NEXT_HOP_IPV4,
+            nat->external_ip);
+        ds_clear(actions);
+        ds_put_format(
+            actions, "eth.dst = %s; next;",
+            distributed_nat ? nat->external_mac :
+            l3dgw_port->lrp_networks.ea_s);
+        ovn_lflow_add_with_hint(lflows, od,
+                                S_ROUTER_IN_ARP_RESOLVE,
+                                100, ds_cstr(match),
+                                ds_cstr(actions),
+                                &nat->header_,
+                                lflow_ref);
+        if (od->redirect_bridged && distributed_nat) {
+            ds_clear(match);
+            ds_put_format(
+                    match,
+                    "outport == %s && ip%s.src == %s "
+                    "&& is_chassis_resident(\"%s\")",
+                    od->l3dgw_ports[0]->json_key,
+                    is_v6 ? "6" : "4", nat->logical_ip,
+                    nat->logical_port);
+            ds_clear(actions);
+            if (is_v6) {
+                ds_put_cstr(actions,
+                    "get_nd(outport, " REG_NEXT_HOP_IPV6 "); next;");
+            } else {
+                ds_put_cstr(actions,
+                    "get_arp(outport, " REG_NEXT_HOP_IPV4 "); next;");
+            }
+            ovn_lflow_add_with_hint(lflows, od,
+                                    S_ROUTER_IN_ARP_RESOLVE, 90,
+                                    ds_cstr(match), ds_cstr(actions),
+                                    &nat->header_,
+                                    lflow_ref);
+        }
+    }
+
+    if (use_common_zone) {
+        /* S_ROUTER_OUT_DNAT_LOCAL */
+        build_lrouter_out_is_dnat_local(lflows, od, nat, match, actions,
+                                        distributed_nat, is_v6,
+                                        l3dgw_port, lflow_ref);
+    }
+
+    /* S_ROUTER_OUT_UNDNAT */
+    build_lrouter_out_undnat_flow(lflows, od, nat, match, actions,
+                                  distributed_nat, mac, is_v6, l3dgw_port,
+                                  stateless, lflow_ref);
+    /* S_ROUTER_OUT_SNAT
+     * Egress SNAT table: Packets enter the egress pipeline with
+     * source ip address that needs to be SNATted to a external ip
+     * address. */
+    if (stateless) {
+        build_lrouter_out_snat_stateless_flow(lflows, od, nat, match,
+                                              actions, distributed_nat,
+                                              mac, cidr_bits, is_v6,
+                                              l3dgw_port, lflow_ref);
+    } else if (lrouter_use_common_zone(od)) {
+        build_lrouter_out_snat_in_czone_flow(lflows, od, nat, match,
+                                             actions, distributed_nat, mac,
+                                             cidr_bits, is_v6, l3dgw_port,
+                                             lflow_ref);
+    } else {
+        build_lrouter_out_snat_flow(lflows, od, nat, match, actions,
+                                    distributed_nat, mac, cidr_bits, is_v6,
+                                    l3dgw_port, lflow_ref, features);
+    }
+
+    /* S_ROUTER_IN_ADMISSION - S_ROUTER_IN_IP_INPUT */
+    build_lrouter_ingress_flow(lflows, od, nat, match, actions, mac,
+                               distributed_nat, is_v6, l3dgw_port,
+                               meter_groups, lflow_ref);
+
+    /* Ingress Gateway Redirect Table: For NAT on a distributed
+     * router, add flows that are specific to a NAT rule.  These
+     * flows indicate the presence of an applicable NAT rule that
+     * can be applied in a distributed manner.
+     * In particulr REG_SRC_IPV4/REG_SRC_IPV6 and eth.src are set to
+     * NAT external IP and NAT external mac so the ARP request
+     * generated in the following stage is sent out with proper IP/MAC
+     * src addresses.
+     */
+    if (distributed_nat) {
+        ds_clear(match);
+        ds_clear(actions);
+        ds_put_format(match,
+                      "ip%s.src == %s && outport == %s",
+                      is_v6 ? "6" : "4", nat->logical_ip,
+                      l3dgw_port->json_key);
+        /* Add a rule to drop traffic from a distributed NAT if
+         * the virtual port has not claimed yet becaused otherwise
+         * the traffic will be centralized misconfiguring the TOR switch.
+         */
+        struct ovn_port *op = ovn_port_find(ls_ports,
+                                            nat->logical_port);
+        if (op && op->nbsp && !strcmp(op->nbsp->type, "virtual")) {
+            ovn_lflow_add_with_hint(lflows, od, S_ROUTER_IN_GW_REDIRECT,
+                                    80, ds_cstr(match),
+                                    debug_drop_action(), &nat->header_,
+                                    lflow_ref);
+        }
+        ds_put_format(match, " && is_chassis_resident(\"%s\")",
+                      nat->logical_port);
+        ds_put_format(actions, "eth.src = %s; %s = %s; next;",
+                      nat->external_mac,
+                      is_v6 ? REG_SRC_IPV6 : REG_SRC_IPV4,
+                      nat->external_ip);
+        ovn_lflow_add_with_hint(lflows, od, S_ROUTER_IN_GW_REDIRECT,
+                                100, ds_cstr(match),
+                                ds_cstr(actions), &nat->header_,
+                                lflow_ref);
+    }
+
+    /* Egress Loopback table: For NAT on a distributed router.
+     * If packets in the egress pipeline on the distributed
+     * gateway port have ip.dst matching a NAT external IP, then
+     * loop a clone of the packet back to the beginning of the
+     * ingress pipeline with inport = outport. */
+    if (od->n_l3dgw_ports) {
+        /* Distributed router. */
+        ds_clear(match);
+        ds_put_format(match, "ip%s.dst == %s && outport == %s",
+                      is_v6 ? "6" : "4",
+                      nat->external_ip,
+                      l3dgw_port->json_key);
+        if (!distributed_nat) {
+            ds_put_format(match, " && is_chassis_resident(%s)",
+                          l3dgw_port->cr_port->json_key);
+        } else {
+            ds_put_format(match, " && is_chassis_resident(\"%s\")",
+                          nat->logical_port);
+        }
+
+        ds_clear(actions);
+        ds_put_format(actions,
+                      "clone { ct_clear; "
+                      "inport = outport; outport = \"\"; "
+                      "eth.dst <-> eth.src; "
+                      "flags = 0; flags.loopback = 1; ");
+        if (use_common_zone) {
+            ds_put_cstr(actions, "flags.use_snat_zone = "
+                        REGBIT_DST_NAT_IP_LOCAL"; ");
+        }
+        for (int j = 0; j < MFF_N_LOG_REGS; j++) {
+            ds_put_format(actions, "reg%d = 0; ", j);
+        }
+        ds_put_format(actions, REGBIT_EGRESS_LOOPBACK" = 1; "
+                      "next(pipeline=ingress, table=%d); };",
+                      ovn_stage_get_table(S_ROUTER_IN_ADMISSION));
+        ovn_lflow_add_with_hint(lflows, od, S_ROUTER_OUT_EGR_LOOP, 100,
+                                ds_cstr(match), ds_cstr(actions),
+                                &nat->header_, lflow_ref);
+    }
+}
+
+/* Returns a string that represents the configuration of the logical router
+ * 'od' that the logical flows of all of its NAT entries depend on. */
+static char *
+lr_nat_lflows_config(const struct ovn_datapath *od,
+                     const struct lr_nat_record *lrnat_rec,
+                     const struct chassis_features *features)
+{
+    struct ds config = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&config, "%d;%d;%d;%d;%d;%d;",
+                  od->is_gw_router, lrouter_use_common_zone(od),
+                  od->redirect_bridged,
+                  !lport_addresses_is_empty(&lrnat_rec->dnat_force_snat_addrs),
+                  features->ct_no_masked_label, features->ct_commit_to_zone);
+    ds_put_smap_sorted(&config, &od->nbr->options);
+
+    for (size_t i = 0; i < od->n_l3dgw_ports; i++) {
+        const struct ovn_port *l3dgw_port = od->l3dgw_ports[i];
+
+        ds_put_format(&config, ";%s,%s,%s,", l3dgw_port->key,
+                      l3dgw_port->cr_port ? l3dgw_port->cr_port->key : "",
+                      l3dgw_port->lrp_networks.ea_s);
+        for (size_t j = 0; j < l3dgw_port->nbrp->n_networks; j++) {
+            ds_put_format(&config, "%s,", l3dgw_port->nbrp->networks[j]);
+        }
+        ds_put_smap_sorted(&config, &l3dgw_port->nbrp->options);
+    }
+
+    return ds_steal_cstr(&config);
+}
+
+/* Returns the key of the lflow reference of 'nat_entry', made of the NAT
+ * row and of everything else specific to the NAT entry that its logical
+ * flows depend on. */
+static char *
+lr_nat_lflows_key(const struct ovn_nat *nat_entry, bool owns_ext_ip,
+                  bool owns_arp_nd, const struct hmap *ls_ports)
+{
+    const struct nbrec_nat *nat = nat_entry->nb;
+    struct ds key = DS_EMPTY_INITIALIZER;
+
+    ds_put_format(&key, UUID_FMT";%s;%s;%s;%s;%s;%s;%s;%s;%s;%"PRId64";%s;",
+                  UUID_ARGS(&nat->header_.uuid), nat->type, nat->external_ip,
+                  nat->external_mac ? nat->external_mac : "",
+                  nat->logical_ip,
+                  nat->logical_port ? nat->logical_port : "",
+                  nat->external_port_range,
+                  nat->allowed_ext_ips ? nat->allowed_ext_ips->name : "",
+                  nat->exempted_ext_ips ? nat->exempted_ext_ips->name : "",
+                  nat->gateway_port ? nat->gateway_port->name : "",
+                  nat->priority, nat->match);
+    ds_put_smap_sorted(&key, &nat->options);
+
+    if (nat->logical_port) {
+        const struct ovn_port *op = ovn_port_find(ls_ports,
+                                                  nat->logical_port);
+        ds_put_format(&key, ";%d",
+                      op && op->nbsp && !strcmp(op->nbsp->type, "virtual"));
+    }
+    ds_put_format(&key, ";%d;%d", owns_ext_ip, owns_arp_nd);
+
+    return ds_steal_cstr(&key);
+}
+
+/* Returns true if 'nat_entry' is the SNAT entry that the ARP/ND responder
+ * flows of its SNAT IP are built for, i.e., the first one that uses it. */
+static bool
+nat_entry_is_first_snat(const struct lr_nat_record *lrnat_rec,
+                        const struct ovn_nat *nat_entry)
+{
+    const char *ip = nat_entry_is_v6(nat_entry)
+                     ? nat_entry->ext_addrs.ipv6_addrs[0].addr_s
+                     : nat_entry->ext_addrs.ipv4_addrs[0].addr_s;
+    const struct ovn_snat_ip *snat_ip =
+        shash_find_data(&lrnat_rec->snat_ips, ip);
+
+    return snat_ip && !ovs_list_is_empty(&snat_ip->snat_entries)
+           && CONTAINER_OF(ovs_list_front(&snat_ip->snat_entries),
+                           struct ovn_nat, ext_addr_list_node) == nat_entry;
+}
+
+/* Builds the logical flows of the NAT entries of the logical router of
+ * 'lr_stateful_rec'.
+ *
+ * Same as for the VIPs of a load balancer in build_lb_datapaths_flows(), the
+ * logical flows of each NAT entry are referenced by their own lflow_ref, see
+ * lr_stateful_record_add_nat_lflow_ref().  Unless 'rebuild_all' is true or
+ * the NAT configuration of the router changed, the flows of the NAT entries
+ * whose key is unchanged are kept as they are, so that adding, removing or
+ * updating one NAT entry only rebuilds the flows of that entry.  The
+ * lflow_refs of the NAT entries that are gone are left marked as stale for
+ * the caller to remove them. */
+static void
+build_lr_stateful_nat_flows(struct lr_stateful_record *lr_stateful_rec,
+                            const struct ovn_datapath *od, bool rebuild_all,
+                            struct lflow_table *lflows,
+                            const struct hmap *ls_ports,
+                            const struct hmap *lr_ports,
+                            struct ds *match, struct ds *actions,
+                            const struct shash *meter_groups,
+                            const struct chassis_features *features)
+{
+    const struct lr_nat_record *lrnat_rec = lr_stateful_rec->lrnat_rec;
+    char *config = lr_nat_lflows_config(od, lrnat_rec, features);
+
+    if (!lr_stateful_rec->nat_lflows_config
+        || strcmp(config, lr_stateful_rec->nat_lflows_config)) {
+        rebuild_all = true;
+    }
+    free(lr_stateful_rec->nat_lflows_config);
+    lr_stateful_rec->nat_lflows_config = config;
+
+    struct lr_stateful_nat_lflow_ref *nat_ref;
+    HMAP_FOR_EACH (nat_ref, hmap_node, &lr_stateful_rec->nat_lflow_refs) {
+        nat_ref->stale = true;
+        nat_ref->rebuilt = false;
+    }
+
+    /* NAT rules are only valid on Gateway routers and routers with
+     * l3dgw_ports (router has port(s) with gateway chassis
+     * specified). */
+    bool build_nat = od->is_gw_router || od->n_l3dgw_ports;
+    struct sset ext_ips = SSET_INITIALIZER(&ext_ips);
+
+    for (size_t i = 0; i < lrnat_rec->n_nat_entries; i++) {
+        struct ovn_nat *nat_entry = &lrnat_rec->nat_entries[i];
+        const struct nbrec_nat *nat = nat_entry->nb;
+        struct eth_addr mac = eth_addr_broadcast;
+        bool is_v6 = false, distributed_nat = false;
+        struct ovn_port *l3dgw_port = NULL;
+        int cidr_bits = 0;
+        ovs_be32 mask;
+
+        bool valid = build_nat
+                     && lrouter_check_nat_entry(od, nat, lr_ports, &mask,
+                                                &is_v6, &cidr_bits, &mac,
+                                                &distributed_nat,
+                                                &l3dgw_port) >= 0;
+        bool owns_ext_ip = valid && sset_add(&ext_ips, nat->external_ip);
+
+        /* ARP/ND responders are built for every NAT entry but SNAT ones,
+         * for which they are built once per SNAT IP. */
+        bool owns_arp_nd = nat_entry_is_valid(nat_entry)
+                           && (strcmp(nat->type, "snat")
+                               || nat_entry_is_first_snat(lrnat_rec,
+                                                          nat_entry));
+
+        char *key = lr_nat_lflows_key(nat_entry, owns_ext_ip, owns_arp_nd,
+                                      ls_ports);
+        nat_ref = lr_stateful_record_add_nat_lflow_ref(lr_stateful_rec, key);
+        if (nat_ref->stale) {
+            /* Built by a previous run. */
+            nat_ref->stale = false;
+            if (!rebuild_all) {
+                continue;
+            }
+            lflow_ref_unlink_lflows(nat_ref->lflow_ref);
+            nat_ref->rebuilt = true;
+        }
+
+        if (valid) {
+            build_lrouter_nat_flows_for_entry(od, lrnat_rec, nat, lflows,
+                                              ls_ports, match, actions,
+                                              meter_groups, features, mac,
+                                              is_v6, cidr_bits,
+                                              distributed_nat, l3dgw_port,
+                                              owns_ext_ip,
+                                              nat_ref->lflow_ref);
+        }
+        if (owns_arp_nd) {
+            build_lrouter_nat_arp_nd_flow(od, nat_entry, lflows, meter_groups,
+                                          nat_ref->lflow_ref);
+        }
+    }
 
-    sset_destroy(&nat_entries);
+    sset_destroy(&ext_ips);
 }
 
 static void
@@ -15798,8 +18586,12 @@ build_lbnat_lflows_iterate_by_lrp(
                                          actions);
 }
 
+/* Builds the logical flows of 'lr_stateful_rec'.  Unless 'rebuild_all' is
+ * true, the flows of its NAT entries are only rebuilt for the entries that
+ * changed, see build_lr_stateful_nat_flows(). */
 static void
-build_lr_stateful_flows(const struct lr_stateful_record *lr_stateful_rec,
+build_lr_stateful_flows(struct lr_stateful_record *lr_stateful_rec,
+                        bool rebuild_all,
                         const struct ovn_datapaths *lr_datapaths,
                         struct lflow_table *lflows,
                         const struct hmap *ls_ports,
@@ -15814,15 +18606,15 @@ build_lr_stateful_flows(const struct lr_stateful_record *lr_stateful_rec,
     ovs_assert(od->nbr);
     ovs_assert(uuid_equals(&od->nbr->header_.uuid,
                            &lr_stateful_rec->nbr_uuid));
-    build_lrouter_nat_defrag_and_lb(lr_stateful_rec, od, lflows, ls_ports,
-                                    lr_ports, match, actions, meter_groups,
-                                    features, lr_stateful_rec->lflow_ref);
+    build_lrouter_nat_defrag_and_lb(lr_stateful_rec, od, lflows, match,
+                                    actions, features,
+                                    lr_stateful_rec->lflow_ref);
     build_lr_gateway_redirect_flows_for_nats(od, lr_stateful_rec->lrnat_rec,
                                              lflows, match, actions,
                                              lr_stateful_rec->lflow_ref);
-    build_lrouter_arp_nd_for_datapath(od, lr_stateful_rec->lrnat_rec,
-                                      lflows, meter_groups,
-                                      lr_stateful_rec->lflow_ref);
+    build_lr_stateful_nat_flows(lr_stateful_rec, od, rebuild_all, lflows,
+                                ls_ports, lr_ports, match, actions,
+                                meter_groups, features);
 }
 
 static void
@@ -15831,6 +18623,7 @@ build_ls_stateful_flows(const struct ls_stateful_record *ls_stateful_rec,
                         const struct ls_port_group_table *ls_pgs,
                         const struct chassis_features *features,
                         const struct shash *meter_groups,
+                        bool with_pg_acls,
                         struct lflow_table *lflows)
 {
     build_ls_stateful_rec_pre_acls(ls_stateful_rec, od, ls_pgs, lflows,
@@ -15840,10 +18633,166 @@ build_ls_stateful_flows(const struct ls_stateful_record *ls_stateful_rec,
     build_acl_hints(ls_stateful_rec, od, features, lflows,
                     ls_stateful_rec->lflow_ref);
     build_acls(ls_stateful_rec, od, features, lflows, ls_pgs,
-               meter_groups, ls_stateful_rec->lflow_ref);
+               meter_groups, with_pg_acls, ls_stateful_rec->lflow_ref);
     build_lb_hairpin(ls_stateful_rec, od, lflows, ls_stateful_rec->lflow_ref);
 }
 
+/* The logical switches that share a port group with ACLs and that would get
+ * the very same flows for them, i.e., that agree on whether they are stateful
+ * and on their maximum ACL tier. */
+struct pg_acl_ls_group {
+    struct hmap_node hmap_node;
+    const struct nbrec_port_group *nb_pg;
+    bool has_stateful;
+    uint64_t max_acl_tier;
+
+    const struct ls_stateful_record **ls_stateful_recs;
+    size_t n_ls_stateful_recs;
+    size_t allocated_ls_stateful_recs;
+};
+
+static struct pg_acl_ls_group *
+pg_acl_ls_group_find_or_add(struct hmap *groups,
+                            const struct nbrec_port_group *nb_pg,
+                            bool has_stateful, uint64_t max_acl_tier)
+{
+    uint32_t hash = uuid_hash(&nb_pg->header_.uuid);
+    hash = hash_boolean(has_stateful, hash);
+    hash = hash_uint64_basis(max_acl_tier, hash);
+
+    struct pg_acl_ls_group *group;
+    HMAP_FOR_EACH_WITH_HASH (group, hmap_node, hash, groups) {
+        if (group->nb_pg == nb_pg && group->has_stateful == has_stateful
+            && group->max_acl_tier == max_acl_tier) {
+            return group;
+        }
+    }
+
+    group = xzalloc(sizeof *group);
+    group->nb_pg = nb_pg;
+    group->has_stateful = has_stateful;
+    group->max_acl_tier = max_acl_tier;
+    hmap_insert(groups, &group->hmap_node, hash);
+    return group;
+}
+
+/* Builds the flows of the port group ACLs for all the logical switches in
+ * 'ls_stateful_table'.
+ *
+ * The flows of a port group ACL don't depend on the logical switch other
+ * than through the 'has_stateful' and 'max_acl_tier' of its ls_stateful
+ * record, so they are generated only once per port group and such variant,
+ * and then added to each logical switch of the group along with a reference
+ * in its ls_stateful record's lflow_ref.  The result is the same as calling
+ * build_acls() with 'with_pg_acls' set for every logical switch, which is
+ * what the incremental processing of a single logical switch still does,
+ * but without formatting and hashing the flows once per logical switch. */
+static void
+build_port_group_acls(const struct ls_stateful_table *ls_stateful_table,
+                      const struct ovn_datapaths *ls_datapaths,
+                      const struct ls_port_group_table *ls_pgs,
+                      const struct chassis_features *features,
+                      const struct shash *meter_groups,
+                      struct lflow_table *lflows)
+{
+    struct hmap groups = HMAP_INITIALIZER(&groups);
+    const struct ls_stateful_record *ls_stateful_rec;
+    struct pg_acl_ls_group *group;
+
+    LS_STATEFUL_TABLE_FOR_EACH (ls_stateful_rec, ls_stateful_table) {
+        const struct ovn_datapath *od =
+            ovn_datapaths_find_by_index(ls_datapaths,
+                                        ls_stateful_rec->ls_index);
+        const struct ls_port_group *ls_pg =
+            ls_port_group_table_find(ls_pgs, od->nbs);
+        if (!ls_pg) {
+            continue;
+        }
+
+        bool has_stateful = (ls_stateful_rec->has_stateful_acl
+                             || ls_stateful_rec->has_lb_vip);
+        const struct ls_port_group_record *ls_pg_rec;
+        HMAP_FOR_EACH (ls_pg_rec, key_node, &ls_pg->nb_pgs) {
+            if (!ls_pg_rec->nb_pg->n_acls) {
+                continue;
+            }
+
+            group = pg_acl_ls_group_find_or_add(&groups, ls_pg_rec->nb_pg,
+                                                has_stateful,
+                                                ls_stateful_rec->max_acl_tier);
+            if (group->n_ls_stateful_recs
+                == group->allocated_ls_stateful_recs) {
+                group->ls_stateful_recs =
+                    x2nrealloc(group->ls_stateful_recs,
+                               &group->allocated_ls_stateful_recs,
+                               sizeof *group->ls_stateful_recs);
+            }
+            group->ls_stateful_recs[group->n_ls_stateful_recs++] =
+                ls_stateful_rec;
+        }
+    }
+
+    struct lflow_ref *pg_lflow_ref = lflow_ref_create();
+    struct ds match = DS_EMPTY_INITIALIZER;
+    struct ds actions = DS_EMPTY_INITIALIZER;
+
+    HMAP_FOR_EACH_POP (group, hmap_node, &groups) {
+        const struct nbrec_port_group *nb_pg = group->nb_pg;
+        const struct ovn_datapath *od =
+            ovn_datapaths_find_by_index(ls_datapaths,
+                                        group->ls_stateful_recs[0]->ls_index);
+
+        for (size_t i = 0; i < nb_pg->n_acls; i++) {
+            const struct nbrec_acl *acl = nb_pg->acls[i];
+
+            build_acl_log_related_flows(od, lflows, acl, group->has_stateful,
+                                        features->ct_no_masked_label,
+                                        meter_groups, &match, &actions,
+                                        pg_lflow_ref);
+            consider_acl(lflows, od, acl, group->has_stateful,
+                         features->ct_no_masked_label,
+                         meter_groups, group->max_acl_tier,
+                         &match, &actions, pg_lflow_ref);
+        }
+
+        for (size_t i = 0; i < group->n_ls_stateful_recs; i++) {
+            ls_stateful_rec = group->ls_stateful_recs[i];
+            od = ovn_datapaths_find_by_index(ls_datapaths,
+                                             ls_stateful_rec->ls_index);
+            lflow_ref_copy_lflows(lflows, pg_lflow_ref, od,
+                                  ls_stateful_rec->lflow_ref);
+        }
+
+        /* The logical switches' own references now keep the flows and the
+         * datapath of the first logical switch alive. */
+        lflow_ref_unlink_lflows(pg_lflow_ref);
+        lflow_ref_clear(pg_lflow_ref);
+
+        free(group->ls_stateful_recs);
+        free(group);
+    }
+
+    ds_destroy(&match);
+    ds_destroy(&actions);
+    lflow_ref_destroy(pg_lflow_ref);
+    hmap_destroy(&groups);
+}
+
+/* Phases of the parallel lflow build.  Every phase iterates over the hash
+ * buckets of one table, and the buckets are handed out to the worker threads
+ * through a work-stealing queue per phase. */
+enum lflow_build_phase {
+    LFLOW_BUILD_LS,
+    LFLOW_BUILD_LR,
+    LFLOW_BUILD_LSP,
+    LFLOW_BUILD_LRP,
+    LFLOW_BUILD_LB,
+    LFLOW_BUILD_LR_STATEFUL,
+    LFLOW_BUILD_LS_STATEFUL,
+    LFLOW_BUILD_IGMP,
+    LFLOW_BUILD_N_PHASES
+};
+
 struct lswitch_flow_build_info {
     const struct ovn_datapaths *ls_datapaths;
     const struct ovn_datapaths *lr_datapaths;
@@ -15862,8 +18811,8 @@ struct lswitch_flow_build_info {
     char *svc_check_match;
     struct ds match;
     struct ds actions;
-    size_t thread_lflow_counter;
     const char *svc_monitor_mac;
+    struct work_queue *work_queues; /* Indexed by enum lflow_build_phase. */
 };
 
 /* Helper function to combine all lflow generation which is iterated by
@@ -15877,21 +18826,25 @@ build_lswitch_and_lrouter_iterate_by_ls(struct ovn_datapath *od,
                                         struct lswitch_flow_build_info *lsi)
 {
     ovs_assert(od->nbs);
-    build_lswitch_lflows_pre_acl_and_acl(od, lsi->features, lsi->lflows,
-                                         lsi->meter_groups, NULL);
+    struct lflow_ref *lflow_ref = od->datapath_lflow_ref;
 
-    build_fwd_group_lflows(od, lsi->lflows, NULL);
-    build_lswitch_lflows_admission_control(od, lsi->lflows, NULL);
-    build_lswitch_learn_fdb_od(od, lsi->lflows, NULL);
-    build_lswitch_arp_nd_responder_default(od, lsi->lflows, NULL);
+    build_lswitch_lflows_pre_acl_and_acl(od, lsi->features, lsi->lflows,
+                                         lsi->meter_groups, lflow_ref);
+
+    build_fwd_group_lflows(od, lsi->lflows, lflow_ref);
+    build_lswitch_lflows_admission_control(od, lsi->lflows, lflow_ref);
+    build_lswitch_learn_fdb_od(od, lsi->lflows, lflow_ref);
+    build_lswitch_arp_nd_responder_default(od, lsi->lflows, lflow_ref);
+    build_lswitch_arp_nd_responder_lookup(od, lsi->lflows, lsi->meter_groups,
+                                          lflow_ref);
     build_lswitch_dns_lookup_and_response(od, lsi->lflows, lsi->meter_groups,
-                                          NULL);
-    build_lswitch_dhcp_and_dns_defaults(od, lsi->lflows, NULL);
+                                          lflow_ref);
+    build_lswitch_dhcp_and_dns_defaults(od, lsi->lflows, lflow_ref);
     build_lswitch_destination_lookup_bmcast(od, lsi->lflows, &lsi->actions,
-                                            lsi->meter_groups, NULL);
-    build_lswitch_output_port_sec_od(od, lsi->lflows, NULL);
-    build_lswitch_lb_affinity_default_flows(od, lsi->lflows, NULL);
-    build_lswitch_lflows_l2_unknown(od, lsi->lflows, NULL);
+                                            lsi->meter_groups, lflow_ref);
+    build_lswitch_output_port_sec_od(od, lsi->lflows, lflow_ref);
+    build_lswitch_lb_affinity_default_flows(od, lsi->lflows, lflow_ref);
+    build_lswitch_lflows_l2_unknown(od, lsi->lflows, lflow_ref);
 }
 
 /* Helper function to combine all lflow generation which is iterated by
@@ -15911,7 +18864,8 @@ build_lswitch_and_lrouter_iterate_by_lr(struct ovn_datapath *od,
     build_static_route_flows_for_lrouter(od, lsi->features,
                                          lsi->lflows, lsi->lr_ports,
                                          lsi->bfd_connections,
-                                         NULL);
+                                         lsi->meter_groups,
+                                         od->route_lflow_ref);
     build_mcast_lookup_flows_for_lrouter(od, lsi->lflows, &lsi->match,
                                          &lsi->actions, NULL);
     build_ingress_policy_flows_for_lrouter(od, lsi->lflows, lsi->lr_ports,
@@ -15923,9 +18877,7 @@ build_lswitch_and_lrouter_iterate_by_lr(struct ovn_datapath *od,
                                           lsi->features);
     build_gateway_redirect_flows_for_lrouter(od, lsi->lflows, &lsi->match,
                                              &lsi->actions, NULL);
-    build_arp_request_flows_for_lrouter(od, lsi->lflows, &lsi->match,
-                                        &lsi->actions,
-                                        lsi->meter_groups,
+    build_arp_request_flows_for_lrouter(od, lsi->lflows, lsi->meter_groups,
                                         NULL);
     build_misc_local_traffic_drop_flows_for_lrouter(od, lsi->lflows, NULL);
 
@@ -15954,7 +18906,7 @@ build_lswitch_and_lrouter_iterate_by_lsp(struct ovn_port *op,
 
     /* Build Logical Switch Flows. */
     build_lswitch_port_sec_op(op, lflows, actions, match);
-    build_lswitch_learn_fdb_op(op, lflows, actions, match);
+    build_lswitch_learn_fdb_op(op, lflows);
     build_lswitch_arp_nd_responder_skip_local(op, lflows, match);
     build_lswitch_arp_nd_responder_known_ips(op, lflows, ls_ports,
                                              meter_groups, actions, match);
@@ -16005,13 +18957,13 @@ build_lswitch_and_lrouter_iterate_by_lrp(struct ovn_port *op,
                                                  &lsi->actions, op->lflow_ref);
 }
 
-static void *
-build_lflows_thread(void *arg)
+static void
+build_lflows_task(struct worker_control *control, void *lsiv_)
 {
-    struct worker_control *control = (struct worker_control *) arg;
-    const struct lr_stateful_record *lr_stateful_rec;
+    struct lswitch_flow_build_info *lsi =
+        &((struct lswitch_flow_build_info *) lsiv_)[control->id];
+    struct lr_stateful_record *lr_stateful_rec;
     const struct ls_stateful_record *ls_stateful_rec;
-    struct lswitch_flow_build_info *lsi;
     struct ovn_igmp_group *igmp_group;
     struct ovn_lb_datapaths *lb_dps;
     struct ovn_datapath *od;
@@ -16024,197 +18976,126 @@ build_lflows_thread(void *arg)
      *    - lr_stateful_rec->lflow_ref
      *    - ls_stateful_rec->lflow_ref
      * are not accessed by multiple threads at the same time. */
-    while (!stop_parallel_processing()) {
-        wait_for_work(control);
-        lsi = (struct lswitch_flow_build_info *) control->data;
-        if (stop_parallel_processing()) {
-            return NULL;
-        }
-        thread_lflow_counter = 0;
-        if (lsi) {
-            /* Iterate over bucket ThreadID, ThreadID+size, ... */
-            for (bnum = control->id;
-                    bnum <= lsi->ls_datapaths->datapaths.mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (od, key_node, bnum,
-                                           &lsi->ls_datapaths->datapaths) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_and_lrouter_iterate_by_ls(od, lsi);
-                }
-            }
-            for (bnum = control->id;
-                    bnum <= lsi->lr_datapaths->datapaths.mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (od, key_node, bnum,
-                                           &lsi->lr_datapaths->datapaths) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_and_lrouter_iterate_by_lr(od, lsi);
-                }
-            }
-            for (bnum = control->id;
-                    bnum <= lsi->ls_ports->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (op, key_node, bnum,
-                                           lsi->ls_ports) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_and_lrouter_iterate_by_lsp(op, lsi->ls_ports,
-                                                             lsi->lr_ports,
-                                                             lsi->meter_groups,
-                                                             &lsi->match,
-                                                             &lsi->actions,
-                                                             lsi->lflows);
-                    build_lbnat_lflows_iterate_by_lsp(
-                        op, lsi->lr_stateful_table, &lsi->match,
-                        &lsi->actions, lsi->lflows);
-                }
+    /* Iterate over the buckets handed out by the work queue of
+     * each phase.  Once a worker is done with its own share of a
+     * phase it steals buckets from the slower workers. */
+    WORK_QUEUE_FOR_EACH_BUCKET (bnum, control->id,
+                                &lsi->work_queues[LFLOW_BUILD_LS]) {
+        HMAP_FOR_EACH_IN_PARALLEL (od, key_node, bnum,
+                                   &lsi->ls_datapaths->datapaths) {
+            if (stop_parallel_processing()) {
+                return;
             }
-            for (bnum = control->id;
-                    bnum <= lsi->lr_ports->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (op, key_node, bnum,
-                                           lsi->lr_ports) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_and_lrouter_iterate_by_lrp(op, lsi);
-                    build_lbnat_lflows_iterate_by_lrp(
-                        op, lsi->lr_stateful_table, lsi->meter_groups,
-                        &lsi->match, &lsi->actions, lsi->lflows);
-                }
+            build_lswitch_and_lrouter_iterate_by_ls(od, lsi);
+        }
+    }
+    WORK_QUEUE_FOR_EACH_BUCKET (bnum, control->id,
+                                &lsi->work_queues[LFLOW_BUILD_LR]) {
+        HMAP_FOR_EACH_IN_PARALLEL (od, key_node, bnum,
+                                   &lsi->lr_datapaths->datapaths) {
+            if (stop_parallel_processing()) {
+                return;
             }
-            for (bnum = control->id;
-                    bnum <= lsi->lb_dps_map->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (lb_dps, hmap_node, bnum,
-                                           lsi->lb_dps_map) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_arp_nd_service_monitor(lb_dps,
-                                                         lsi->ls_ports,
-                                                         lsi->svc_monitor_mac,
-                                                         lsi->lflows,
-                                                         &lsi->match,
-                                                         &lsi->actions);
-                    build_lrouter_defrag_flows_for_lb(lb_dps, lsi->lflows,
-                                                      lsi->lr_datapaths,
-                                                      &lsi->match);
-                    build_lrouter_flows_for_lb(lb_dps, lsi->lflows,
-                                               lsi->meter_groups,
-                                               lsi->lr_datapaths,
-                                               lsi->lr_stateful_table,
-                                               lsi->features,
-                                               lsi->svc_monitor_map,
-                                               &lsi->match, &lsi->actions);
-                    build_lswitch_flows_for_lb(lb_dps, lsi->lflows,
-                                               lsi->meter_groups,
-                                               lsi->ls_datapaths,
-                                               lsi->features,
-                                               lsi->svc_monitor_map,
-                                               &lsi->match, &lsi->actions);
-                }
+            build_lswitch_and_lrouter_iterate_by_lr(od, lsi);
+        }
+    }
+    WORK_QUEUE_FOR_EACH_BUCKET (bnum, control->id,
+                                &lsi->work_queues[LFLOW_BUILD_LSP]) {
+        HMAP_FOR_EACH_IN_PARALLEL (op, key_node, bnum,
+                                   lsi->ls_ports) {
+            if (stop_parallel_processing()) {
+                return;
             }
-            for (bnum = control->id;
-                    bnum <= lsi->lr_stateful_table->entries.mask;
-                    bnum += control->pool->size)
-            {
-                LR_STATEFUL_TABLE_FOR_EACH_IN_P (lr_stateful_rec, bnum,
-                                                 lsi->lr_stateful_table) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lr_stateful_flows(lr_stateful_rec, lsi->lr_datapaths,
-                                            lsi->lflows, lsi->ls_ports,
-                                            lsi->lr_ports, &lsi->match,
-                                            &lsi->actions,
-                                            lsi->meter_groups,
-                                            lsi->features);
-                }
+            build_lswitch_and_lrouter_iterate_by_lsp(op, lsi->ls_ports,
+                                                     lsi->lr_ports,
+                                                     lsi->meter_groups,
+                                                     &lsi->match,
+                                                     &lsi->actions,
+                                                     lsi->lflows);
+            build_lbnat_lflows_iterate_by_lsp(
+                op, lsi->lr_stateful_table, &lsi->match,
+                &lsi->actions, lsi->lflows);
+        }
+    }
+    WORK_QUEUE_FOR_EACH_BUCKET (bnum, control->id,
+                                &lsi->work_queues[LFLOW_BUILD_LRP]) {
+        HMAP_FOR_EACH_IN_PARALLEL (op, key_node, bnum,
+                                   lsi->lr_ports) {
+            if (stop_parallel_processing()) {
+                return;
             }
-
-            for (bnum = control->id;
-                    bnum <= lsi->ls_stateful_table->entries.mask;
-                    bnum += control->pool->size)
-            {
-                LS_STATEFUL_TABLE_FOR_EACH_IN_P (ls_stateful_rec, bnum,
-                                                 lsi->ls_stateful_table) {
-                    od = ovn_datapaths_find_by_index(
-                        lsi->ls_datapaths, ls_stateful_rec->ls_index);
-                    /* Make sure that ls_stateful_rec and od belong to the
-                     * same NB Logical switch. */
-                    ovs_assert(uuid_equals(&ls_stateful_rec->nbs_uuid,
-                                           &od->nbs->header_.uuid));
-                    build_ls_stateful_flows(ls_stateful_rec, od,
-                                            lsi->ls_port_groups,
-                                            lsi->features, lsi->meter_groups,
-                                            lsi->lflows);
-                }
+            build_lswitch_and_lrouter_iterate_by_lrp(op, lsi);
+            build_lbnat_lflows_iterate_by_lrp(
+                op, lsi->lr_stateful_table, lsi->meter_groups,
+                &lsi->match, &lsi->actions, lsi->lflows);
+        }
+    }
+    WORK_QUEUE_FOR_EACH_BUCKET (bnum, control->id,
+                                &lsi->work_queues[LFLOW_BUILD_LB]) {
+        HMAP_FOR_EACH_IN_PARALLEL (lb_dps, hmap_node, bnum,
+                                   lsi->lb_dps_map) {
+            if (stop_parallel_processing()) {
+                return;
             }
-
-            for (bnum = control->id;
-                    bnum <= lsi->igmp_groups->mask;
-                    bnum += control->pool->size)
-            {
-                HMAP_FOR_EACH_IN_PARALLEL (
-                        igmp_group, hmap_node, bnum, lsi->igmp_groups) {
-                    if (stop_parallel_processing()) {
-                        return NULL;
-                    }
-                    build_lswitch_ip_mcast_igmp_mld(igmp_group, lsi->lflows,
-                                                    &lsi->match,
-                                                    &lsi->actions);
-                }
+            build_lb_datapaths_flows(lb_dps, true, lsi->lflows,
+                                     lsi->ls_ports, lsi->svc_monitor_mac,
+                                     lsi->ls_datapaths, lsi->lr_datapaths,
+                                     lsi->lr_stateful_table,
+                                     lsi->meter_groups, lsi->features,
+                                     lsi->svc_monitor_map,
+                                     &lsi->match, &lsi->actions);
+        }
+    }
+    WORK_QUEUE_FOR_EACH_BUCKET (
+            bnum, control->id, &lsi->work_queues[LFLOW_BUILD_LR_STATEFUL]) {
+        LR_STATEFUL_TABLE_FOR_EACH_IN_P (lr_stateful_rec, bnum,
+                                         lsi->lr_stateful_table) {
+            if (stop_parallel_processing()) {
+                return;
             }
+            build_lr_stateful_flows(lr_stateful_rec, true, lsi->lr_datapaths,
+                                    lsi->lflows, lsi->ls_ports,
+                                    lsi->lr_ports, &lsi->match,
+                                    &lsi->actions,
+                                    lsi->meter_groups,
+                                    lsi->features);
         }
-        lsi->thread_lflow_counter = thread_lflow_counter;
-        post_completed_work(control);
     }
-    return NULL;
-}
-
-static struct worker_pool *build_lflows_pool = NULL;
 
-static void
-noop_callback(struct worker_pool *pool OVS_UNUSED,
-              void *fin_result OVS_UNUSED,
-              void *result_frags OVS_UNUSED,
-              size_t index OVS_UNUSED)
-{
-    /* Do nothing */
-}
+    WORK_QUEUE_FOR_EACH_BUCKET (
+            bnum, control->id, &lsi->work_queues[LFLOW_BUILD_LS_STATEFUL]) {
+        LS_STATEFUL_TABLE_FOR_EACH_IN_P (ls_stateful_rec, bnum,
+                                         lsi->ls_stateful_table) {
+            od = ovn_datapaths_find_by_index(
+                lsi->ls_datapaths, ls_stateful_rec->ls_index);
+            /* Make sure that ls_stateful_rec and od belong to the
+             * same NB Logical switch. */
+            ovs_assert(uuid_equals(&ls_stateful_rec->nbs_uuid,
+                                   &od->nbs->header_.uuid));
+            build_ls_stateful_flows(ls_stateful_rec, od,
+                                    lsi->ls_port_groups,
+                                    lsi->features, lsi->meter_groups,
+                                    false, lsi->lflows);
+        }
+    }
 
-/* Fixes the hmap size (hmap->n) after parallel building the lflow_table when
- * dp-groups is enabled, because in that case all threads are updating the
- * global lflow hmap. Although the lflow_hash_lock prevents currently inserting
- * to the same hash bucket, the hmap->n is updated currently by all threads and
- * may not be accurate at the end of each iteration. This function collects the
- * thread-local lflow counters maintained by each thread and update the hmap
- * size with the aggregated value. This function must be called immediately
- * after the worker threads complete the tasks in each iteration before any
- * future operations on the lflow map. */
-static void
-fix_flow_table_size(struct lflow_table *lflow_table,
-                  struct lswitch_flow_build_info *lsiv,
-                  size_t n_lsiv)
-{
-    size_t total = 0;
-    for (size_t i = 0; i < n_lsiv; i++) {
-        total += lsiv[i].thread_lflow_counter;
+    WORK_QUEUE_FOR_EACH_BUCKET (bnum, control->id,
+                                &lsi->work_queues[LFLOW_BUILD_IGMP]) {
+        HMAP_FOR_EACH_IN_PARALLEL (
+                igmp_group, hmap_node, bnum, lsi->igmp_groups) {
+            if (stop_parallel_processing()) {
+                return;
+            }
+            build_lswitch_ip_mcast_igmp_mld(igmp_group, lsi->lflows,
+                                            &lsi->match,
+                                            &lsi->actions);
+        }
     }
-    lflow_table_set_size(lflow_table, total);
 }
 
+static struct work_queue build_lflows_wq[LFLOW_BUILD_N_PHASES];
+static bool build_lflows_wq_inited = false;
+
 static void
 build_lswitch_and_lrouter_flows(
     const struct ovn_datapaths *ls_datapaths,
@@ -16236,12 +19117,38 @@ build_lswitch_and_lrouter_flows(
 
     char *svc_check_match = xasprintf("eth.dst == %s", svc_monitor_mac);
 
+    size_t size = (hmap_count(&ls_datapaths->datapaths)
+                   + hmap_count(&lr_datapaths->datapaths)
+                   + hmap_count(ls_ports) + hmap_count(lr_ports)
+                   + hmap_count(lb_dps_map) + hmap_count(igmp_groups));
+    struct northd_par_stats *stats = NULL;
+    bool parallel = false;
     if (parallelization_state == STATE_USE_PARALLELIZATION) {
+        stats = northd_par_stats_get("lflow-build", NORTHD_PAR_MIN_SIZE);
+        parallel = northd_par_decide(stats, size);
+    }
+    long long int start = time_usec();
+
+    if (parallel) {
         struct lswitch_flow_build_info *lsiv;
         int index;
 
         lsiv = xcalloc(sizeof(*lsiv), build_lflows_pool->size);
 
+        const size_t n_buckets[LFLOW_BUILD_N_PHASES] = {
+            [LFLOW_BUILD_LS] = ls_datapaths->datapaths.mask + 1,
+            [LFLOW_BUILD_LR] = lr_datapaths->datapaths.mask + 1,
+            [LFLOW_BUILD_LSP] = ls_ports->mask + 1,
+            [LFLOW_BUILD_LRP] = lr_ports->mask + 1,
+            [LFLOW_BUILD_LB] = lb_dps_map->mask + 1,
+            [LFLOW_BUILD_LR_STATEFUL] = lr_stateful_table->entries.mask + 1,
+            [LFLOW_BUILD_LS_STATEFUL] = ls_stateful_table->entries.mask + 1,
+            [LFLOW_BUILD_IGMP] = igmp_groups->mask + 1,
+        };
+        for (size_t i = 0; i < LFLOW_BUILD_N_PHASES; i++) {
+            ovn_work_queue_reset(&build_lflows_wq[i], n_buckets[i]);
+        }
+
         /* Set up "work chunks" for each thread to work on. */
 
         for (index = 0; index < build_lflows_pool->size; index++) {
@@ -16263,17 +19170,29 @@ build_lswitch_and_lrouter_flows(
             lsiv[index].bfd_connections = bfd_connections;
             lsiv[index].features = features;
             lsiv[index].svc_check_match = svc_check_match;
-            lsiv[index].thread_lflow_counter = 0;
             lsiv[index].svc_monitor_mac = svc_monitor_mac;
+            lsiv[index].work_queues = build_lflows_wq;
             ds_init(&lsiv[index].match);
             ds_init(&lsiv[index].actions);
 
-            build_lflows_pool->controls[index].data = &lsiv[index];
         }
 
         /* Run thread pool. */
-        run_pool_callback(build_lflows_pool, NULL, NULL, noop_callback);
-        fix_flow_table_size(lflows, lsiv, build_lflows_pool->size);
+        run_pool_task(build_lflows_pool, build_lflows_task, lsiv);
+
+        /* Port group ACLs are built once for all the logical switches that
+         * share them, by this thread.  The lflows it and the workers inserted
+         * are only added to the size of the table by lflow_table_fix_size(),
+         * which must be called before any other use of the table. */
+        build_port_group_acls(ls_stateful_table, ls_datapaths, ls_pgs,
+                              features, meter_groups, lflows);
+        lflow_table_fix_size(lflows);
+
+        unsigned int n_steals = 0;
+        for (size_t i = 0; i < LFLOW_BUILD_N_PHASES; i++) {
+            n_steals += atomic_count_get(&build_lflows_wq[i].n_steals);
+        }
+        COVERAGE_ADD(lflow_build_work_steal, n_steals);
 
         for (index = 0; index < build_lflows_pool->size; index++) {
             ds_destroy(&lsiv[index].match);
@@ -16281,7 +19200,7 @@ build_lswitch_and_lrouter_flows(
         }
         free(lsiv);
     } else {
-        const struct lr_stateful_record *lr_stateful_rec;
+        struct lr_stateful_record *lr_stateful_rec;
         const struct ls_stateful_record *ls_stateful_rec;
         struct ovn_igmp_group *igmp_group;
         struct ovn_lb_datapaths *lb_dps;
@@ -16343,25 +19262,17 @@ build_lswitch_and_lrouter_flows(
         stopwatch_stop(LFLOWS_PORTS_STOPWATCH_NAME, time_msec());
         stopwatch_start(LFLOWS_LBS_STOPWATCH_NAME, time_msec());
         HMAP_FOR_EACH (lb_dps, hmap_node, lb_dps_map) {
-            build_lswitch_arp_nd_service_monitor(lb_dps, lsi.ls_ports,
-                                                 lsi.svc_monitor_mac,
-                                                 lsi.lflows, &lsi.actions,
-                                                 &lsi.match);
-            build_lrouter_defrag_flows_for_lb(lb_dps, lsi.lflows,
-                                              lsi.lr_datapaths, &lsi.match);
-            build_lrouter_flows_for_lb(lb_dps, lsi.lflows, lsi.meter_groups,
-                                       lsi.lr_datapaths, lsi.lr_stateful_table,
-                                       lsi.features, lsi.svc_monitor_map,
-                                       &lsi.match, &lsi.actions);
-            build_lswitch_flows_for_lb(lb_dps, lsi.lflows, lsi.meter_groups,
-                                       lsi.ls_datapaths, lsi.features,
-                                       lsi.svc_monitor_map,
-                                       &lsi.match, &lsi.actions);
+            build_lb_datapaths_flows(lb_dps, true, lsi.lflows, lsi.ls_ports,
+                                     lsi.svc_monitor_mac, lsi.ls_datapaths,
+                                     lsi.lr_datapaths, lsi.lr_stateful_table,
+                                     lsi.meter_groups, lsi.features,
+                                     lsi.svc_monitor_map,
+                                     &lsi.match, &lsi.actions);
         }
         stopwatch_stop(LFLOWS_LBS_STOPWATCH_NAME, time_msec());
         stopwatch_start(LFLOWS_LR_STATEFUL_STOPWATCH_NAME, time_msec());
         LR_STATEFUL_TABLE_FOR_EACH (lr_stateful_rec, lr_stateful_table) {
-            build_lr_stateful_flows(lr_stateful_rec, lsi.lr_datapaths,
+            build_lr_stateful_flows(lr_stateful_rec, true, lsi.lr_datapaths,
                                     lsi.lflows, lsi.ls_ports, lsi.lr_ports,
                                     &lsi.match, &lsi.actions,
                                     lsi.meter_groups, lsi.features);
@@ -16376,9 +19287,12 @@ build_lswitch_and_lrouter_flows(
             ovs_assert(uuid_equals(&ls_stateful_rec->nbs_uuid,
                                    &od->nbs->header_.uuid));
             build_ls_stateful_flows(ls_stateful_rec, od, lsi.ls_port_groups,
-                                    lsi.features, lsi.meter_groups,
+                                    lsi.features, lsi.meter_groups, false,
                                     lsi.lflows);
         }
+        build_port_group_acls(ls_stateful_table, lsi.ls_datapaths,
+                              lsi.ls_port_groups, lsi.features,
+                              lsi.meter_groups, lsi.lflows);
         stopwatch_stop(LFLOWS_LS_STATEFUL_STOPWATCH_NAME, time_msec());
         stopwatch_start(LFLOWS_IGMP_STOPWATCH_NAME, time_msec());
         HMAP_FOR_EACH (igmp_group, hmap_node, igmp_groups) {
@@ -16391,8 +19305,17 @@ build_lswitch_and_lrouter_flows(
 
         ds_destroy(&lsi.match);
         ds_destroy(&lsi.actions);
+
+        /* The lflows are inserted as for a parallel build as long as
+         * parallelization is enabled. */
+        if (stats) {
+            lflow_table_fix_size(lflows);
+        }
     }
 
+    if (stats) {
+        northd_par_record(stats, size, parallel, time_usec() - start);
+    }
     free(svc_check_match);
 }
 
@@ -16401,8 +19324,23 @@ void run_update_worker_pool(int n_threads)
     /* If number of threads has been updated (or initially set),
      * update the worker pool. */
     if (update_worker_pool(n_threads, &build_lflows_pool,
-                           build_lflows_thread) != POOL_UNCHANGED) {
+                           ovn_worker_task_thread) != POOL_UNCHANGED) {
         /* worker pool was updated */
+        if (build_lflows_wq_inited) {
+            for (size_t i = 0; i < LFLOW_BUILD_N_PHASES; i++) {
+                ovn_work_queue_destroy(&build_lflows_wq[i]);
+            }
+            ovn_work_queue_destroy(&northd_prep_wq);
+            build_lflows_wq_inited = false;
+        }
+        if (build_lflows_pool) {
+            for (size_t i = 0; i < LFLOW_BUILD_N_PHASES; i++) {
+                ovn_work_queue_init_for_pool(&build_lflows_wq[i],
+                                             build_lflows_pool);
+            }
+            ovn_work_queue_init_for_pool(&northd_prep_wq, build_lflows_pool);
+            build_lflows_wq_inited = true;
+        }
         if (get_worker_pool_size() <= 1) {
             /* destroy potentially created lflow_hash_lock */
             lflow_hash_lock_destroy();
@@ -16411,6 +19349,11 @@ void run_update_worker_pool(int n_threads)
             lflow_hash_lock_init();
             parallelization_state = STATE_INIT_HASH_SIZES;
         }
+
+        /* The incremental processing engine runs independent thread safe
+         * nodes on the same pool.  northd_prep_for_each() doesn't use the
+         * pool while the engine does. */
+        engine_set_worker_pool(build_lflows_pool);
     }
 }
 
@@ -16437,6 +19380,77 @@ create_sb_multicast_group(struct ovsdb_idl_txn *ovnsb_txn,
     return sbmc;
 }
 
+static void
+ovn_multicast_groups_destroy(struct hmap *mcast_groups)
+{
+    struct ovn_multicast *mc;
+
+    HMAP_FOR_EACH_SAFE (mc, hmap_node, mcast_groups) {
+        ovn_multicast_destroy(mcast_groups, mc);
+    }
+    hmap_destroy(mcast_groups);
+}
+
+/* Pushes the changes to the Multicast_Group table to the database.  The
+ * synced groups are removed from 'mcast_groups'. */
+static void
+sync_multicast_groups_to_sb(struct ovsdb_idl_txn *ovnsb_txn,
+                            const struct lflow_input *input_data,
+                            struct hmap *mcast_groups)
+{
+    const struct sbrec_multicast_group *sbmc;
+    SBREC_MULTICAST_GROUP_TABLE_FOR_EACH_SAFE (
+            sbmc, input_data->sbrec_multicast_group_table) {
+        struct ovn_datapath *od = ovn_datapath_from_sbrec(
+            &input_data->ls_datapaths->datapaths,
+            &input_data->lr_datapaths->datapaths,
+            sbmc->datapath);
+
+        if (!od || ovn_datapath_is_stale(od)) {
+            sbrec_multicast_group_delete(sbmc);
+            continue;
+        }
+
+        struct multicast_group group = { .name = sbmc->name,
+                                         .key = sbmc->tunnel_key };
+        struct ovn_multicast *mc = ovn_multicast_find(mcast_groups,
+                                                      od, &group);
+        if (mc) {
+            ovn_multicast_update_sbrec(mc, sbmc);
+            ovn_multicast_destroy(mcast_groups, mc);
+        } else {
+            sbrec_multicast_group_delete(sbmc);
+        }
+    }
+    struct ovn_multicast *mc;
+    HMAP_FOR_EACH_SAFE (mc, hmap_node, mcast_groups) {
+        if (!mc->datapath) {
+            ovn_multicast_destroy(mcast_groups, mc);
+            continue;
+        }
+        sbmc = create_sb_multicast_group(ovnsb_txn, mc->datapath->sb,
+                                         mc->group->name, mc->group->key);
+        ovn_multicast_update_sbrec(mc, sbmc);
+        ovn_multicast_destroy(mcast_groups, mc);
+    }
+}
+
+/* Links the IGMP groups to their logical flow references, which are
+ * created anew as all the logical flows are about to be rebuilt. */
+static void
+link_igmp_groups_lflow_refs(struct hmap *igmp_groups,
+                            struct hmap *igmp_lflow_refs)
+{
+    struct ovn_igmp_group *igmp_group;
+
+    ovs_assert(hmap_is_empty(igmp_lflow_refs));
+    HMAP_FOR_EACH (igmp_group, hmap_node, igmp_groups) {
+        struct igmp_lflow_ref *ref =
+            igmp_lflow_ref_add(igmp_lflow_refs, igmp_group);
+        igmp_group->lflow_ref = ref->lflow_ref;
+    }
+}
+
 /* Updates the Logical_Flow and Multicast_Group tables in the OVN_SB database,
  * constructing their contents based on the OVN_NB database. */
 void build_lflows(struct ovsdb_idl_txn *ovnsb_txn,
@@ -16451,6 +19465,7 @@ void build_lflows(struct ovsdb_idl_txn *ovnsb_txn,
                        input_data->ls_datapaths,
                        input_data->ls_ports, input_data->lr_ports,
                        &mcast_groups, &igmp_groups);
+    link_igmp_groups_lflow_refs(&igmp_groups, input_data->igmp_lflow_refs);
 
     build_lswitch_and_lrouter_flows(input_data->ls_datapaths,
                                     input_data->lr_datapaths,
@@ -16472,108 +19487,398 @@ void build_lflows(struct ovsdb_idl_txn *ovnsb_txn,
         parallelization_state = STATE_USE_PARALLELIZATION;
     }
 
+    /* Drop the lflows that were not built again, see en_lflow_run(). */
+    lflow_table_sweep_stale(lflows);
+
     /* Parallel build may result in a suboptimal hash. Resize the
      * lflow map to a correct size before doing lookups */
     lflow_table_expand(lflows);
     
     stopwatch_start(LFLOWS_TO_SB_STOPWATCH_NAME, time_msec());
+    size_t n_lflows = lflow_table_size(lflows);
+    struct northd_par_stats *stats = NULL;
+    bool parallel = false;
+    if (parallelization_state == STATE_USE_PARALLELIZATION) {
+        stats = northd_par_stats_get("lflow-sync", NORTHD_PAR_MIN_SIZE);
+        parallel = northd_par_decide(stats, n_lflows);
+    }
+    long long int start = time_usec();
     lflow_table_sync_to_sb(lflows, ovnsb_txn, input_data->ls_datapaths,
                            input_data->lr_datapaths,
                            input_data->ovn_internal_version_changed,
                            input_data->sbrec_logical_flow_table,
-                           input_data->sbrec_logical_dp_group_table);
+                           input_data->sbrec_logical_dp_group_table,
+                           parallel ? build_lflows_pool : NULL,
+                           input_data->max_lflow_inserts);
+    if (stats) {
+        northd_par_record(stats, n_lflows, parallel, time_usec() - start);
+    }
 
     stopwatch_stop(LFLOWS_TO_SB_STOPWATCH_NAME, time_msec());
 
-    /* Push changes to the Multicast_Group table to database. */
-    const struct sbrec_multicast_group *sbmc;
-    SBREC_MULTICAST_GROUP_TABLE_FOR_EACH_SAFE (
-            sbmc, input_data->sbrec_multicast_group_table) {
-        struct ovn_datapath *od = ovn_datapath_from_sbrec(
-            &input_data->ls_datapaths->datapaths,
-            &input_data->lr_datapaths->datapaths,
-            sbmc->datapath);
+    sync_multicast_groups_to_sb(ovnsb_txn, input_data, &mcast_groups);
+    ovn_multicast_groups_destroy(&mcast_groups);
+    ovn_igmp_groups_destroy(&igmp_groups);
+}
 
-        if (!od || ovn_datapath_is_stale(od)) {
-            sbrec_multicast_group_delete(sbmc);
-            continue;
-        }
+/* Returns true if the logical flows of an IGMP group learnt on 'od' can be
+ * added or removed without regenerating the flows of the other groups.
+ * 'n_deleted' is the number of IGMP groups deleted from all the datapaths,
+ * as the deleted groups of 'od' itself are no longer in its group list. */
+static bool
+igmp_group_can_be_inc_processed(const struct ovn_datapath *od,
+                                size_t n_deleted)
+{
+    /* The peer routers with multicast relay enabled build their own IGMP
+     * groups, and flows, out of the groups of the switch. */
+    if (!od->nbs || od->mcast_info.sw.flood_relay) {
+        return false;
+    }
 
-        struct multicast_group group = { .name = sbmc->name,
-                                         .key = sbmc->tunnel_key };
-        struct ovn_multicast *mc = ovn_multicast_find(&mcast_groups,
-                                                      od, &group);
-        if (mc) {
-            ovn_multicast_update_sbrec(mc, sbmc);
-            ovn_multicast_destroy(&mcast_groups, mc);
+    /* Once the "mcast_table_size" limit is reached, which groups get a
+     * flow depends on all the groups of the switch, so neither the new nor
+     * the old groups of the switch may reach it. */
+    uint64_t n_groups = ovs_list_size(&od->mcast_info.groups) + n_deleted;
+    return n_groups <= od->mcast_info.sw.table_size;
+}
+
+/* Handles the SB IGMP_Group changes.  The multicast groups are rebuilt and
+ * synced to the SB Multicast_Group table, which is where the group
+ * membership changes end up.  Only the logical flows of the IGMP groups
+ * that got created or deleted are regenerated. */
+bool
+lflow_handle_igmp_group_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                struct lflow_input *lflow_input,
+                                struct lflow_table *lflows)
+{
+    struct hmap *igmp_lflow_refs = lflow_input->igmp_lflow_refs;
+    struct ds match = DS_EMPTY_INITIALIZER;
+    struct ds actions = DS_EMPTY_INITIALIZER;
+    struct hmap mcast_groups;
+    struct hmap igmp_groups;
+    bool handled = false;
+
+    build_mcast_groups(lflow_input->sbrec_igmp_group_table,
+                       lflow_input->sbrec_mcast_group_by_name_dp,
+                       lflow_input->ls_datapaths,
+                       lflow_input->ls_ports, lflow_input->lr_ports,
+                       &mcast_groups, &igmp_groups);
+
+    struct igmp_lflow_ref *ref;
+    HMAP_FOR_EACH (ref, hmap_node, igmp_lflow_refs) {
+        ref->stale = true;
+    }
+
+    struct hmapx created_groups = HMAPX_INITIALIZER(&created_groups);
+    struct ovn_igmp_group *igmp_group;
+    HMAP_FOR_EACH (igmp_group, hmap_node, &igmp_groups) {
+        ref = igmp_lflow_ref_find(igmp_lflow_refs, igmp_group->datapath,
+                                  &igmp_group->address);
+        if (ref) {
+            ref->stale = false;
+            igmp_group->lflow_ref = ref->lflow_ref;
         } else {
-            sbrec_multicast_group_delete(sbmc);
+            hmapx_add(&created_groups, igmp_group);
         }
     }
-    struct ovn_multicast *mc;
-    HMAP_FOR_EACH_SAFE (mc, hmap_node, &mcast_groups) {
-        if (!mc->datapath) {
-            ovn_multicast_destroy(&mcast_groups, mc);
+
+    size_t n_deleted = 0;
+    HMAP_FOR_EACH (ref, hmap_node, igmp_lflow_refs) {
+        n_deleted += ref->stale;
+    }
+
+    struct hmapx_node *hmapx_node;
+    HMAPX_FOR_EACH (hmapx_node, &created_groups) {
+        igmp_group = hmapx_node->data;
+        if (!igmp_group_can_be_inc_processed(igmp_group->datapath,
+                                             n_deleted)) {
+            goto out;
+        }
+    }
+    HMAP_FOR_EACH (ref, hmap_node, igmp_lflow_refs) {
+        if (ref->stale
+            && !igmp_group_can_be_inc_processed(ref->datapath, n_deleted)) {
+            goto out;
+        }
+    }
+
+    sync_multicast_groups_to_sb(ovnsb_txn, lflow_input, &mcast_groups);
+
+    stopwatch_start(LFLOWS_IGMP_STOPWATCH_NAME, time_msec());
+    HMAP_FOR_EACH_SAFE (ref, hmap_node, igmp_lflow_refs) {
+        if (!ref->stale) {
             continue;
         }
-        sbmc = create_sb_multicast_group(ovnsb_txn, mc->datapath->sb,
-                                         mc->group->name, mc->group->key);
-        ovn_multicast_update_sbrec(mc, sbmc);
-        ovn_multicast_destroy(&mcast_groups, mc);
+        bool synced = lflow_ref_resync_flows(
+            ref->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
+            lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table);
+        igmp_lflow_ref_destroy(igmp_lflow_refs, ref);
+        if (!synced) {
+            stopwatch_stop(LFLOWS_IGMP_STOPWATCH_NAME, time_msec());
+            goto out;
+        }
     }
 
-    struct ovn_igmp_group *igmp_group;
+    handled = true;
+    HMAPX_FOR_EACH (hmapx_node, &created_groups) {
+        igmp_group = hmapx_node->data;
+        ref = igmp_lflow_ref_add(igmp_lflow_refs, igmp_group);
+        igmp_group->lflow_ref = ref->lflow_ref;
 
-    HMAP_FOR_EACH_SAFE (igmp_group, hmap_node, &igmp_groups) {
-        ovn_igmp_group_destroy(&igmp_groups, igmp_group);
+        build_lswitch_ip_mcast_igmp_mld(igmp_group, lflows, &actions,
+                                        &match);
+        if (!lflow_ref_sync_lflows(
+                igmp_group->lflow_ref, lflows, ovnsb_txn,
+                lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                lflow_input->ovn_internal_version_changed,
+                lflow_input->sbrec_logical_flow_table,
+                lflow_input->sbrec_logical_dp_group_table)) {
+            handled = false;
+            break;
+        }
     }
+    stopwatch_stop(LFLOWS_IGMP_STOPWATCH_NAME, time_msec());
 
-    hmap_destroy(&igmp_groups);
-    hmap_destroy(&mcast_groups);
+out:
+    ds_destroy(&match);
+    ds_destroy(&actions);
+    hmapx_destroy(&created_groups);
+    ovn_multicast_groups_destroy(&mcast_groups);
+    ovn_igmp_groups_destroy(&igmp_groups);
+    return handled;
 }
 
 void
 lflow_reset_northd_refs(struct lflow_input *lflow_input)
 {
-    const struct lr_stateful_record *lr_stateful_rec;
+    struct lr_stateful_record *lr_stateful_rec;
     struct ls_stateful_record *ls_stateful_rec;
     struct ovn_lb_datapaths *lb_dps;
     struct ovn_port *op;
 
-    LR_STATEFUL_TABLE_FOR_EACH (lr_stateful_rec,
-                                lflow_input->lr_stateful_table) {
-        lflow_ref_clear(lr_stateful_rec->lflow_ref);
-    }
+    LR_STATEFUL_TABLE_FOR_EACH (lr_stateful_rec,
+                                lflow_input->lr_stateful_table) {
+        lflow_ref_clear(lr_stateful_rec->lflow_ref);
+        lr_stateful_record_clear_nat_lflow_refs(lr_stateful_rec);
+    }
+
+    LS_STATEFUL_TABLE_FOR_EACH (ls_stateful_rec,
+                                lflow_input->ls_stateful_table) {
+        lflow_ref_clear(ls_stateful_rec->lflow_ref);
+    }
+
+    HMAP_FOR_EACH (op, key_node, lflow_input->ls_ports) {
+        lflow_ref_clear(op->lflow_ref);
+        lflow_ref_clear(op->stateful_lflow_ref);
+    }
+
+    HMAP_FOR_EACH (op, key_node, lflow_input->lr_ports) {
+        lflow_ref_clear(op->lflow_ref);
+        lflow_ref_clear(op->stateful_lflow_ref);
+    }
+
+    HMAP_FOR_EACH (lb_dps, hmap_node, lflow_input->lb_datapaths_map) {
+        lflow_ref_clear(lb_dps->lflow_ref);
+        ovn_lb_datapaths_clear_vip_lflow_refs(lb_dps);
+    }
+
+    struct ovn_datapath *od;
+    HMAP_FOR_EACH (od, key_node, &lflow_input->lr_datapaths->datapaths) {
+        lflow_ref_clear(od->route_lflow_ref);
+        ovn_datapath_clear_policy_lflow_refs(od);
+    }
+
+    HMAP_FOR_EACH (od, key_node, &lflow_input->ls_datapaths->datapaths) {
+        lflow_ref_clear(od->datapath_lflow_ref);
+        ovn_datapath_clear_qos_lflow_refs(od);
+    }
+}
+
+/* Returns true if a NB BFD session refers to the logical router port
+ * 'name'.  The SB BFD sessions are only synced during a full recompute of
+ * the logical flows. */
+static bool
+lrp_has_bfd_sessions(const struct nbrec_bfd_table *nbrec_bfd_table,
+                     const char *name)
+{
+    const struct nbrec_bfd *nb_bt;
+    NBREC_BFD_TABLE_FOR_EACH (nb_bt, nbrec_bfd_table) {
+        if (!strcmp(nb_bt->logical_port, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Handles the logical flows of the tracked logical router ports.  Their
+ * stateful flows are regenerated by the lr_stateful handler, as the
+ * routers of the added and deleted ports are tracked in 'trk_nat_lrs'. */
+static bool
+lflow_handle_northd_lrp_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                struct tracked_ovn_ports *trk_lrps,
+                                struct lflow_input *lflow_input,
+                                struct lflow_table *lflows)
+{
+    struct hmapx_node *hmapx_node;
+    struct ovn_port *op;
+
+    HMAPX_FOR_EACH (hmapx_node, &trk_lrps->deleted) {
+        op = hmapx_node->data;
+        ovs_assert(op->nbrp);
+        if (lrp_has_bfd_sessions(lflow_input->nbrec_bfd_table, op->key)) {
+            return false;
+        }
+
+        bool handled = lflow_ref_resync_flows(
+            op->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
+            lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table)
+            && lflow_ref_resync_flows(
+            op->stateful_lflow_ref, lflows, ovnsb_txn,
+            lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table);
+        if (!handled) {
+            return false;
+        }
+    }
+
+    struct lswitch_flow_build_info lsi = {
+        .lflows = lflows,
+        .meter_groups = lflow_input->meter_groups,
+        .match = DS_EMPTY_INITIALIZER,
+        .actions = DS_EMPTY_INITIALIZER,
+    };
+    bool handled = true;
+
+    HMAPX_FOR_EACH (hmapx_node, &trk_lrps->updated) {
+        op = hmapx_node->data;
+        ovs_assert(op->nbrp);
+        lflow_ref_unlink_lflows(op->lflow_ref);
+        build_lswitch_and_lrouter_iterate_by_lrp(op, &lsi);
+        handled = lflow_ref_sync_lflows(
+            op->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
+            lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table);
+        if (!handled) {
+            goto exit;
+        }
+    }
+
+    HMAPX_FOR_EACH (hmapx_node, &trk_lrps->created) {
+        op = hmapx_node->data;
+        ovs_assert(op->nbrp);
+        if (lrp_has_bfd_sessions(lflow_input->nbrec_bfd_table, op->key)) {
+            handled = false;
+            goto exit;
+        }
+
+        build_lswitch_and_lrouter_iterate_by_lrp(op, &lsi);
+        handled = lflow_ref_sync_lflows(
+            op->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
+            lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table);
+        if (!handled) {
+            goto exit;
+        }
+    }
+
+exit:
+    ds_destroy(&lsi.match);
+    ds_destroy(&lsi.actions);
+    return handled;
+}
+
+/* Logical switch ports whose lflows are generated by
+ * lflow_handle_northd_port_changes(). */
+struct lsp_lflows_build_ctx {
+    struct ovn_port **ports;
+    const struct lflow_input *lflow_input;
+    struct lflow_table *lflows;
+};
+
+static void
+lsp_lflows_build_cb(size_t idx, void *ctx_)
+{
+    struct lsp_lflows_build_ctx *ctx = ctx_;
+    const struct lflow_input *lflow_input = ctx->lflow_input;
+    struct ovn_port *op = ctx->ports[idx];
+    struct ds match = DS_EMPTY_INITIALIZER;
+    struct ds actions = DS_EMPTY_INITIALIZER;
+
+    /* Note:  lflow_ref is not thread safe, but 'op' is only handled by
+     * one thread. */
+    build_lswitch_and_lrouter_iterate_by_lsp(op, lflow_input->ls_ports,
+                                             lflow_input->lr_ports,
+                                             lflow_input->meter_groups,
+                                             &match, &actions, ctx->lflows);
+    build_lbnat_lflows_iterate_by_lsp(op, lflow_input->lr_stateful_table,
+                                      &match, &actions, ctx->lflows);
+
+    ds_destroy(&match);
+    ds_destroy(&actions);
+}
 
-    LS_STATEFUL_TABLE_FOR_EACH (ls_stateful_rec,
-                                lflow_input->ls_stateful_table) {
-        lflow_ref_clear(ls_stateful_rec->lflow_ref);
-    }
+/* SB multicast groups of a logical switch that get new ports. */
+struct ls_new_lsps_mcast {
+    struct hmap_node hmap_node;
+    const struct ovn_datapath *od;
+    const struct sbrec_multicast_group *flood;
+    const struct sbrec_multicast_group *flood_l2;
+    const struct sbrec_multicast_group *unknown;
+};
 
-    HMAP_FOR_EACH (op, key_node, lflow_input->ls_ports) {
-        lflow_ref_clear(op->lflow_ref);
-        lflow_ref_clear(op->stateful_lflow_ref);
-    }
+static struct ls_new_lsps_mcast *
+ls_new_lsps_mcast_get(struct hmap *mcast_groups,
+                      const struct ovn_datapath *od,
+                      struct ovsdb_idl_index *sbrec_mcast_group_by_name_dp)
+{
+    uint32_t hash = hash_pointer(od, 0);
+    struct ls_new_lsps_mcast *mc;
 
-    HMAP_FOR_EACH (op, key_node, lflow_input->lr_ports) {
-        lflow_ref_clear(op->lflow_ref);
-        lflow_ref_clear(op->stateful_lflow_ref);
+    HMAP_FOR_EACH_WITH_HASH (mc, hmap_node, hash, mcast_groups) {
+        if (mc->od == od) {
+            return mc;
+        }
     }
 
-    HMAP_FOR_EACH (lb_dps, hmap_node, lflow_input->lb_datapaths_map) {
-        lflow_ref_clear(lb_dps->lflow_ref);
-    }
+    mc = xmalloc(sizeof *mc);
+    mc->od = od;
+    mc->flood = mcast_group_lookup(sbrec_mcast_group_by_name_dp,
+                                   MC_FLOOD, od->sb);
+    mc->flood_l2 = mcast_group_lookup(sbrec_mcast_group_by_name_dp,
+                                      MC_FLOOD_L2, od->sb);
+    mc->unknown = mcast_group_lookup(sbrec_mcast_group_by_name_dp,
+                                     MC_UNKNOWN, od->sb);
+    hmap_insert(mcast_groups, &mc->hmap_node, hash);
+    return mc;
 }
 
 bool
 lflow_handle_northd_port_changes(struct ovsdb_idl_txn *ovnsb_txn,
                                  struct tracked_ovn_ports *trk_lsps,
+                                 struct tracked_ovn_ports *trk_lrps,
                                  struct lflow_input *lflow_input,
                                  struct lflow_table *lflows)
 {
     struct hmapx_node *hmapx_node;
     struct ovn_port *op;
 
+    if (!lflow_handle_northd_lrp_changes(ovnsb_txn, trk_lrps, lflow_input,
+                                         lflows)) {
+        return false;
+    }
+
     HMAPX_FOR_EACH (hmapx_node, &trk_lsps->deleted) {
         op = hmapx_node->data;
         /* Make sure 'op' is an lsp and not lrp. */
@@ -16591,89 +19896,55 @@ lflow_handle_northd_port_changes(struct ovsdb_idl_txn *ovnsb_txn,
          * references. */
     }
 
+    /* A single NB transaction may create or update thousands of ports, so
+     * first generate the lflows of all of them, on the worker threads if
+     * there are enough, and only then sync them to SB, which is done from
+     * this thread. */
+    size_t n_ports = hmapx_count(&trk_lsps->updated)
+                     + hmapx_count(&trk_lsps->created);
+    struct lsp_lflows_build_ctx ctx = {
+        .ports = xmalloc(n_ports * sizeof *ctx.ports),
+        .lflow_input = lflow_input,
+        .lflows = lflows,
+    };
+    size_t n = 0;
+
     HMAPX_FOR_EACH (hmapx_node, &trk_lsps->updated) {
         op = hmapx_node->data;
         /* Make sure 'op' is an lsp and not lrp. */
         ovs_assert(op->nbsp);
         /* Clear old lflows. */
         lflow_ref_unlink_lflows(op->lflow_ref);
-
-        /* Generate new lflows. */
-        struct ds match = DS_EMPTY_INITIALIZER;
-        struct ds actions = DS_EMPTY_INITIALIZER;
-        build_lswitch_and_lrouter_iterate_by_lsp(op, lflow_input->ls_ports,
-                                                 lflow_input->lr_ports,
-                                                 lflow_input->meter_groups,
-                                                 &match, &actions,
-                                                 lflows);
-        /* Sync the new flows to SB. */
-        bool handled = lflow_ref_sync_lflows(
-            op->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
-            lflow_input->lr_datapaths,
-            lflow_input->ovn_internal_version_changed,
-            lflow_input->sbrec_logical_flow_table,
-            lflow_input->sbrec_logical_dp_group_table);
-        if (handled) {
-            /* Now regenerate the stateful lflows for 'op' */
-            /* Clear old lflows. */
-            lflow_ref_unlink_lflows(op->stateful_lflow_ref);
-            build_lbnat_lflows_iterate_by_lsp(op,
-                                              lflow_input->lr_stateful_table,
-                                              &match, &actions, lflows);
-            handled = lflow_ref_sync_lflows(
-                op->stateful_lflow_ref, lflows, ovnsb_txn,
-                lflow_input->ls_datapaths,
-                lflow_input->lr_datapaths,
-                lflow_input->ovn_internal_version_changed,
-                lflow_input->sbrec_logical_flow_table,
-                lflow_input->sbrec_logical_dp_group_table);
-        }
-
-        ds_destroy(&match);
-        ds_destroy(&actions);
-
-        if (!handled) {
-            return false;
-        }
-
-        /* SB port_binding is not deleted, so don't update SB multicast
-         * groups. */
+        lflow_ref_unlink_lflows(op->stateful_lflow_ref);
+        ctx.ports[n++] = op;
     }
-
     HMAPX_FOR_EACH (hmapx_node, &trk_lsps->created) {
         op = hmapx_node->data;
         /* Make sure 'op' is an lsp and not lrp. */
         ovs_assert(op->nbsp);
+        ctx.ports[n++] = op;
+    }
 
-        const struct sbrec_multicast_group *sbmc_flood =
-            mcast_group_lookup(lflow_input->sbrec_mcast_group_by_name_dp,
-                               MC_FLOOD, op->od->sb);
-        const struct sbrec_multicast_group *sbmc_flood_l2 =
-            mcast_group_lookup(lflow_input->sbrec_mcast_group_by_name_dp,
-                               MC_FLOOD_L2, op->od->sb);
-        const struct sbrec_multicast_group *sbmc_unknown =
-            mcast_group_lookup(lflow_input->sbrec_mcast_group_by_name_dp,
-                               MC_UNKNOWN, op->od->sb);
-
-        struct ds match = DS_EMPTY_INITIALIZER;
-        struct ds actions = DS_EMPTY_INITIALIZER;
-        build_lswitch_and_lrouter_iterate_by_lsp(op, lflow_input->ls_ports,
-                                                 lflow_input->lr_ports,
-                                                 lflow_input->meter_groups,
-                                                 &match, &actions, lflows);
+    if (parallelization_state == STATE_USE_PARALLELIZATION) {
+        northd_prep_for_each("lsp-lflows", n_ports, lsp_lflows_build_cb,
+                             &ctx);
+        lflow_table_fix_size(lflows);
+    } else {
+        for (size_t i = 0; i < n_ports; i++) {
+            lsp_lflows_build_cb(i, &ctx);
+        }
+    }
 
-        /* Sync the newly added flows to SB. */
-        bool handled = lflow_ref_sync_lflows(
+    bool handled = true;
+    for (size_t i = 0; handled && i < n_ports; i++) {
+        op = ctx.ports[i];
+        handled = lflow_ref_sync_lflows(
             op->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
             lflow_input->lr_datapaths,
             lflow_input->ovn_internal_version_changed,
             lflow_input->sbrec_logical_flow_table,
             lflow_input->sbrec_logical_dp_group_table);
         if (handled) {
-            /* Now generate the stateful lflows for 'op' */
-            build_lbnat_lflows_iterate_by_lsp(op,
-                                              lflow_input->lr_stateful_table,
-                                              &match, &actions, lflows);
             handled = lflow_ref_sync_lflows(
                 op->stateful_lflow_ref, lflows, ovnsb_txn,
                 lflow_input->ls_datapaths,
@@ -16682,39 +19953,57 @@ lflow_handle_northd_port_changes(struct ovsdb_idl_txn *ovnsb_txn,
                 lflow_input->sbrec_logical_flow_table,
                 lflow_input->sbrec_logical_dp_group_table);
         }
+    }
+    free(ctx.ports);
+    if (!handled) {
+        return false;
+    }
 
-        ds_destroy(&match);
-        ds_destroy(&actions);
-
-        if (!handled) {
-            return false;
-        }
+    /* Update SB multicast groups for the new ports, looking the groups up
+     * once per logical switch.  SB port_binding is not deleted for the
+     * updated ports, so their groups don't change. */
+    struct hmap mcast_groups = HMAP_INITIALIZER(&mcast_groups);
+    HMAPX_FOR_EACH (hmapx_node, &trk_lsps->created) {
+        op = hmapx_node->data;
 
-        /* Update SB multicast groups for the new port. */
-        if (!sbmc_flood) {
-            sbmc_flood = create_sb_multicast_group(ovnsb_txn,
+        struct ls_new_lsps_mcast *mc =
+            ls_new_lsps_mcast_get(&mcast_groups, op->od,
+                                  lflow_input->sbrec_mcast_group_by_name_dp);
+        if (!mc->flood) {
+            mc->flood = create_sb_multicast_group(ovnsb_txn,
                 op->od->sb, MC_FLOOD, OVN_MCAST_FLOOD_TUNNEL_KEY);
         }
-        sbrec_multicast_group_update_ports_addvalue(sbmc_flood, op->sb);
+        sbrec_multicast_group_update_ports_addvalue(mc->flood, op->sb);
 
-        if (!sbmc_flood_l2) {
-            sbmc_flood_l2 = create_sb_multicast_group(ovnsb_txn,
-                op->od->sb, MC_FLOOD_L2,
-                OVN_MCAST_FLOOD_L2_TUNNEL_KEY);
+        /* Router ports are not part of MC_FLOOD_L2, the same as in
+         * build_mcast_groups(). */
+        if (!lsp_is_router(op->nbsp)) {
+            if (!mc->flood_l2) {
+                mc->flood_l2 = create_sb_multicast_group(ovnsb_txn,
+                    op->od->sb, MC_FLOOD_L2,
+                    OVN_MCAST_FLOOD_L2_TUNNEL_KEY);
+            }
+            sbrec_multicast_group_update_ports_addvalue(mc->flood_l2,
+                                                        op->sb);
         }
-        sbrec_multicast_group_update_ports_addvalue(sbmc_flood_l2, op->sb);
 
         if (op->has_unknown) {
-            if (!sbmc_unknown) {
-                sbmc_unknown = create_sb_multicast_group(ovnsb_txn,
+            if (!mc->unknown) {
+                mc->unknown = create_sb_multicast_group(ovnsb_txn,
                     op->od->sb, MC_UNKNOWN,
                     OVN_MCAST_UNKNOWN_TUNNEL_KEY);
             }
-            sbrec_multicast_group_update_ports_addvalue(sbmc_unknown,
+            sbrec_multicast_group_update_ports_addvalue(mc->unknown,
                                                         op->sb);
         }
     }
 
+    struct ls_new_lsps_mcast *mc;
+    HMAP_FOR_EACH_POP (mc, hmap_node, &mcast_groups) {
+        free(mc);
+    }
+    hmap_destroy(&mcast_groups);
+
     return true;
 }
 
@@ -16735,49 +20024,369 @@ lflow_handle_northd_lb_changes(struct ovsdb_idl_txn *ovnsb_txn,
             lflow_input->ovn_internal_version_changed,
             lflow_input->sbrec_logical_flow_table,
             lflow_input->sbrec_logical_dp_group_table);
+
+        struct ovn_lb_vip_lflow_ref *vip_ref;
+        HMAP_FOR_EACH (vip_ref, hmap_node, &lb_dps->vip_lflow_refs) {
+            lflow_ref_resync_flows(
+                vip_ref->lflow_ref, lflows, ovnsb_txn,
+                lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                lflow_input->ovn_internal_version_changed,
+                lflow_input->sbrec_logical_flow_table,
+                lflow_input->sbrec_logical_dp_group_table);
+        }
     }
 
     HMAPX_FOR_EACH (hmapx_node, &trk_lbs->crupdated) {
         lb_dps = hmapx_node->data;
 
-        /* unlink old lflows. */
-        lflow_ref_unlink_lflows(lb_dps->lflow_ref);
+        /* Generate new lflows, only for the VIPs that changed if
+         * possible. */
+        struct ds match = DS_EMPTY_INITIALIZER;
+        struct ds actions = DS_EMPTY_INITIALIZER;
+
+        build_lb_datapaths_flows(lb_dps, false, lflows,
+                                 lflow_input->ls_ports,
+                                 lflow_input->svc_monitor_mac,
+                                 lflow_input->ls_datapaths,
+                                 lflow_input->lr_datapaths,
+                                 lflow_input->lr_stateful_table,
+                                 lflow_input->meter_groups,
+                                 lflow_input->features,
+                                 lflow_input->svc_monitor_map,
+                                 &match, &actions);
+
+        ds_destroy(&match);
+        ds_destroy(&actions);
+
+        /* Sync the new flows to SB. */
+        bool handled = lflow_ref_sync_lflows(
+            lb_dps->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
+            lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table);
+        if (!handled) {
+            return false;
+        }
+
+        struct ovn_lb_vip_lflow_ref *vip_ref;
+        HMAP_FOR_EACH_SAFE (vip_ref, hmap_node, &lb_dps->vip_lflow_refs) {
+            if (vip_ref->stale) {
+                /* The VIP was removed or its backends changed. */
+                handled = lflow_ref_resync_flows(
+                    vip_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+                ovn_lb_datapaths_remove_vip_lflow_ref(lb_dps, vip_ref);
+            } else if (vip_ref->rebuilt) {
+                handled = lflow_ref_sync_lflows(
+                    vip_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+            }
+            if (!handled) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Regenerates the static route flows of 'od' and syncs them to the SB. */
+static bool
+lflow_rebuild_lr_route_flows(struct ovsdb_idl_txn *ovnsb_txn,
+                             struct ovn_datapath *od,
+                             const struct hmap *bfd_connections,
+                             struct lflow_input *lflow_input,
+                             struct lflow_table *lflows)
+{
+    /* Unlink old lflows. */
+    lflow_ref_unlink_lflows(od->route_lflow_ref);
+
+    /* Generate new lflows. */
+    build_static_route_flows_for_lrouter(od, lflow_input->features,
+                                         lflows, lflow_input->lr_ports,
+                                         bfd_connections,
+                                         lflow_input->meter_groups,
+                                         od->route_lflow_ref);
+
+    /* Sync the new flows to SB. */
+    return lflow_ref_sync_lflows(od->route_lflow_ref, lflows, ovnsb_txn,
+                                 lflow_input->ls_datapaths,
+                                 lflow_input->lr_datapaths,
+                                 lflow_input->ovn_internal_version_changed,
+                                 lflow_input->sbrec_logical_flow_table,
+                                 lflow_input->sbrec_logical_dp_group_table);
+}
+
+/* Returns true if none of the static routes of 'nbr' was added, removed or
+ * modified, i.e., if they are only reported as changed because a BFD
+ * session they refer to was updated. */
+static bool
+lr_static_routes_unchanged(const struct nbrec_logical_router *nbr)
+{
+    if (nbrec_logical_router_is_updated(
+            nbr, NBREC_LOGICAL_ROUTER_COL_STATIC_ROUTES)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < nbr->n_static_routes; i++) {
+        const struct nbrec_logical_router_static_route *route =
+            nbr->static_routes[i];
+        enum nbrec_logical_router_static_route_column_id col;
+
+        for (col = 0; col < NBREC_LOGICAL_ROUTER_STATIC_ROUTE_N_COLUMNS;
+             col++) {
+            if (nbrec_logical_router_static_route_is_updated(route, col)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool
+lflow_handle_northd_lr_route_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                     struct hmapx *lr_with_changed_routes,
+                                     struct lflow_input *lflow_input,
+                                     struct lflow_table *lflows)
+{
+    struct hmapx_node *hmapx_node;
+
+    HMAPX_FOR_EACH (hmapx_node, lr_with_changed_routes) {
+        struct ovn_datapath *od = hmapx_node->data;
+        bool routes_have_bfd = od->routes_have_bfd;
+
+        for (size_t i = 0; i < od->nbr->n_static_routes; i++) {
+            if (od->nbr->static_routes[i]->bfd) {
+                routes_have_bfd = true;
+            }
+        }
+
+        /* The routes with BFD may stop using a BFD session, which then has
+         * to be set to "admin_down", and that is only done during a full
+         * recompute.  That can't happen if the routes themselves didn't
+         * change, only the status of their BFD sessions. */
+        if (routes_have_bfd && !lr_static_routes_unchanged(od->nbr)) {
+            return false;
+        }
+
+        if (!lflow_rebuild_lr_route_flows(ovnsb_txn, od,
+                                          lflow_input->bfd_connections,
+                                          lflow_input, lflows)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Regenerates the flows of the routing policies that were added, removed
+ * or updated in the routers of 'lr_with_changed_policies' and syncs them
+ * to the SB. */
+bool
+lflow_handle_northd_lr_policy_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                      struct hmapx *lr_with_changed_policies,
+                                      struct lflow_input *lflow_input,
+                                      struct lflow_table *lflows)
+{
+    struct hmapx_node *hmapx_node;
+
+    HMAPX_FOR_EACH (hmapx_node, lr_with_changed_policies) {
+        struct ovn_datapath *od = hmapx_node->data;
+
+        build_lr_policy_flows(od, lflows, lflow_input->lr_ports,
+                              lflow_input->bfd_connections);
+
+        /* Same as for the static routes, the BFD sessions that policies
+         * stop using are only set to "admin_down" by a full recompute. */
+        struct lr_policy_lflow_ref *policy_ref;
+        HMAP_FOR_EACH (policy_ref, hmap_node, &od->policy_lflow_refs) {
+            if (policy_ref->has_bfd
+                && (policy_ref->stale || policy_ref->rebuilt)) {
+                return false;
+            }
+        }
+
+        HMAP_FOR_EACH_SAFE (policy_ref, hmap_node, &od->policy_lflow_refs) {
+            bool handled = true;
+
+            if (policy_ref->stale) {
+                /* The policy was removed or updated. */
+                handled = lflow_ref_resync_flows(
+                    policy_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+                ovn_datapath_remove_policy_lflow_ref(od, policy_ref);
+            } else if (policy_ref->rebuilt) {
+                handled = lflow_ref_sync_lflows(
+                    policy_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+            }
+            if (!handled) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Regenerates the flows of the QoS rules that were added, removed or
+ * updated in the switches of 'ls_with_changed_qos' and syncs them to the
+ * SB. */
+bool
+lflow_handle_northd_ls_qos_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                   struct hmapx *ls_with_changed_qos,
+                                   struct lflow_input *lflow_input,
+                                   struct lflow_table *lflows)
+{
+    struct hmapx_node *hmapx_node;
+
+    HMAPX_FOR_EACH (hmapx_node, ls_with_changed_qos) {
+        struct ovn_datapath *od = hmapx_node->data;
+
+        build_ls_qos_flows(od, lflows);
+
+        struct ls_qos_lflow_ref *qos_ref;
+        HMAP_FOR_EACH_SAFE (qos_ref, hmap_node, &od->qos_lflow_refs) {
+            bool handled = true;
+
+            if (qos_ref->stale) {
+                /* The QoS rule was removed or updated. */
+                handled = lflow_ref_resync_flows(
+                    qos_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+                ovn_datapath_remove_qos_lflow_ref(od, qos_ref);
+            } else if (qos_ref->rebuilt) {
+                handled = lflow_ref_sync_lflows(
+                    qos_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+            }
+            if (!handled) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Regenerates the logical flows of the switches in 'ls_with_changed_config'
+ * themselves, i.e., the ones referenced by their 'datapath_lflow_ref', and
+ * syncs them to the SB.
+ *
+ * The flows of the QoS rules are rebuilt along with them, but only the ones
+ * of the rules whose key changed, with their own lflow_refs.  This must
+ * hence be called after lflow_handle_northd_ls_qos_changes(), which syncs
+ * and removes these. */
+bool
+lflow_handle_northd_ls_config_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                      struct hmapx *ls_with_changed_config,
+                                      struct lflow_input *lflow_input,
+                                      struct lflow_table *lflows)
+{
+    struct lswitch_flow_build_info lsi = {
+        .ls_datapaths = lflow_input->ls_datapaths,
+        .lr_datapaths = lflow_input->lr_datapaths,
+        .ls_ports = lflow_input->ls_ports,
+        .lr_ports = lflow_input->lr_ports,
+        .lflows = lflows,
+        .meter_groups = lflow_input->meter_groups,
+        .features = lflow_input->features,
+        .match = DS_EMPTY_INITIALIZER,
+        .actions = DS_EMPTY_INITIALIZER,
+    };
+    struct hmapx_node *hmapx_node;
+    bool handled = true;
+
+    HMAPX_FOR_EACH (hmapx_node, ls_with_changed_config) {
+        struct ovn_datapath *od = hmapx_node->data;
+
+        lflow_ref_unlink_lflows(od->datapath_lflow_ref);
+        build_lswitch_and_lrouter_iterate_by_ls(od, &lsi);
+        handled = lflow_ref_sync_lflows(
+            od->datapath_lflow_ref, lflows, ovnsb_txn,
+            lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+            lflow_input->ovn_internal_version_changed,
+            lflow_input->sbrec_logical_flow_table,
+            lflow_input->sbrec_logical_dp_group_table);
+        if (!handled) {
+            break;
+        }
+    }
+
+    ds_destroy(&lsi.match);
+    ds_destroy(&lsi.actions);
+    return handled;
+}
+
+/* Regenerates the logical flows that depend on the status of the BFD
+ * sessions in 'updated_bfds'.  Only the static routes are handled
+ * incrementally, a status change of a BFD session used by a reroute
+ * policy triggers a full recompute. */
+bool
+lflow_handle_bfd_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                         const struct hmapx *updated_bfds,
+                         const struct hmapx *lr_with_changed_routes,
+                         struct lflow_input *lflow_input,
+                         struct lflow_table *lflows)
+{
+    struct ovn_datapath *od;
+
+    if (hmapx_is_empty(updated_bfds)) {
+        return true;
+    }
+
+    HMAP_FOR_EACH (od, key_node, &lflow_input->lr_datapaths->datapaths) {
+        for (size_t i = 0; i < od->nbr->n_policies; i++) {
+            const struct nbrec_logical_router_policy *rule =
+                od->nbr->policies[i];
+
+            for (size_t j = 0; j < rule->n_bfd_sessions; j++) {
+                if (hmapx_contains(updated_bfds, rule->bfd_sessions[j])) {
+                    return false;
+                }
+            }
+        }
 
-        /* Generate new lflows. */
-        struct ds match = DS_EMPTY_INITIALIZER;
-        struct ds actions = DS_EMPTY_INITIALIZER;
+        /* The routers tracked by en_northd get their route flows rebuilt
+         * by lflow_handle_northd_lr_route_changes(). */
+        if (!od->routes_have_bfd
+            || hmapx_contains(lr_with_changed_routes, od)) {
+            continue;
+        }
 
-        build_lswitch_arp_nd_service_monitor(lb_dps, lflow_input->ls_ports,
-                                             lflow_input->svc_monitor_mac,
-                                             lflows, &actions,
-                                             &match);
-        build_lrouter_defrag_flows_for_lb(lb_dps, lflows,
-                                          lflow_input->lr_datapaths, &match);
-        build_lrouter_flows_for_lb(lb_dps, lflows,
-                                   lflow_input->meter_groups,
-                                   lflow_input->lr_datapaths,
-                                   lflow_input->lr_stateful_table,
-                                   lflow_input->features,
-                                   lflow_input->svc_monitor_map,
-                                   &match, &actions);
-        build_lswitch_flows_for_lb(lb_dps, lflows,
-                                   lflow_input->meter_groups,
-                                   lflow_input->ls_datapaths,
-                                   lflow_input->features,
-                                   lflow_input->svc_monitor_map,
-                                   &match, &actions);
+        bool routes_changed = false;
+        for (size_t i = 0; i < od->nbr->n_static_routes; i++) {
+            const struct nbrec_bfd *nb_bt = od->nbr->static_routes[i]->bfd;
 
-        ds_destroy(&match);
-        ds_destroy(&actions);
+            if (nb_bt && hmapx_contains(updated_bfds, nb_bt)) {
+                routes_changed = true;
+                break;
+            }
+        }
 
-        /* Sync the new flows to SB. */
-        bool handled = lflow_ref_sync_lflows(
-            lb_dps->lflow_ref, lflows, ovnsb_txn, lflow_input->ls_datapaths,
-            lflow_input->lr_datapaths,
-            lflow_input->ovn_internal_version_changed,
-            lflow_input->sbrec_logical_flow_table,
-            lflow_input->sbrec_logical_dp_group_table);
-        if (!handled) {
+        if (routes_changed &&
+            !lflow_rebuild_lr_route_flows(ovnsb_txn, od,
+                                          lflow_input->bfd_connections,
+                                          lflow_input, lflows)) {
             return false;
         }
     }
@@ -16802,8 +20411,10 @@ lflow_handle_lr_stateful_changes(struct ovsdb_idl_txn *ovnsb_txn,
         /* Unlink old lflows. */
         lflow_ref_unlink_lflows(lr_stateful_rec->lflow_ref);
 
-        /* Generate new lflows. */
-        build_lr_stateful_flows(lr_stateful_rec, lflow_input->lr_datapaths,
+        /* Generate new lflows, only for the NAT entries that changed if
+         * possible. */
+        build_lr_stateful_flows(lr_stateful_rec, false,
+                                lflow_input->lr_datapaths,
                                 lflows, lflow_input->ls_ports,
                                 lflow_input->lr_ports, &match, &actions,
                                 lflow_input->meter_groups,
@@ -16820,6 +20431,32 @@ lflow_handle_lr_stateful_changes(struct ovsdb_idl_txn *ovnsb_txn,
             goto exit;
         }
 
+        struct lr_stateful_nat_lflow_ref *nat_ref;
+        HMAP_FOR_EACH_SAFE (nat_ref, hmap_node,
+                            &lr_stateful_rec->nat_lflow_refs) {
+            if (nat_ref->stale) {
+                /* The NAT entry was removed or updated. */
+                handled = lflow_ref_resync_flows(
+                    nat_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+                lr_stateful_record_remove_nat_lflow_ref(lr_stateful_rec,
+                                                        nat_ref);
+            } else if (nat_ref->rebuilt) {
+                handled = lflow_ref_sync_lflows(
+                    nat_ref->lflow_ref, lflows, ovnsb_txn,
+                    lflow_input->ls_datapaths, lflow_input->lr_datapaths,
+                    lflow_input->ovn_internal_version_changed,
+                    lflow_input->sbrec_logical_flow_table,
+                    lflow_input->sbrec_logical_dp_group_table);
+            }
+            if (!handled) {
+                goto exit;
+            }
+        }
+
         const struct ovn_datapath *od =
             ovn_datapaths_find_by_index(lflow_input->lr_datapaths,
                                         lr_stateful_rec->lr_index);
@@ -16893,7 +20530,7 @@ lflow_handle_ls_stateful_changes(struct ovsdb_idl_txn *ovnsb_txn,
                                 lflow_input->ls_port_groups,
                                 lflow_input->features,
                                 lflow_input->meter_groups,
-                                lflows);
+                                true, lflows);
 
         /* Sync the new flows to SB. */
         bool handled = lflow_ref_sync_lflows(
@@ -17009,6 +20646,86 @@ get_dns_info_from_hmap(struct hmap *dns_map, struct uuid *uuid)
     return NULL;
 }
 
+/* Copies the options and records of 'nb_dns' to 'sb_dns'. */
+static void
+sync_dns_record(const struct nbrec_dns *nb_dns, const struct sbrec_dns *sb_dns)
+{
+    /* Copy DNS options to SB*/
+    struct smap options = SMAP_INITIALIZER(&options);
+    if (!smap_is_empty(&sb_dns->options)) {
+        smap_clone(&options, &sb_dns->options);
+    }
+
+    bool ovn_owned = smap_get_bool(&nb_dns->options, "ovn-owned", false);
+    smap_replace(&options, "ovn-owned", ovn_owned ? "true" : "false");
+    sbrec_dns_set_options(sb_dns, &options);
+    smap_destroy(&options);
+
+    /* DNS lookups are case-insensitive. Convert records to lowercase so
+     * we can do consistent lookups when DNS requests arrive
+     */
+    struct smap lower_records = SMAP_INITIALIZER(&lower_records);
+    struct smap_node *node;
+    SMAP_FOR_EACH (node, &nb_dns->records) {
+        smap_add_nocopy(&lower_records, xstrdup(node->key),
+                        str_tolower(node->value));
+    }
+
+    sbrec_dns_set_records(sb_dns, &lower_records);
+    smap_destroy(&lower_records);
+}
+
+static const struct sbrec_dns *
+sb_dns_find(const struct sbrec_dns_table *sbrec_dns_table,
+            const struct uuid *nb_dns_uuid)
+{
+    const struct sbrec_dns *sbrec_dns;
+
+    SBREC_DNS_TABLE_FOR_EACH (sbrec_dns, sbrec_dns_table) {
+        const char *dns_id = smap_get(&sbrec_dns->external_ids, "dns_id");
+        struct uuid dns_uuid;
+
+        if (dns_id && uuid_from_string(&dns_uuid, dns_id)
+            && uuid_equals(&dns_uuid, nb_dns_uuid)) {
+            return sbrec_dns;
+        }
+    }
+    return NULL;
+}
+
+/* Syncs to the SB the changes to the DNS records referenced by logical
+ * switch 'od'.  The set of DNS records of the switch didn't change (that
+ * is not handled incrementally), so the SB DNS rows and datapaths stay the
+ * same.  The logical flows only depend on whether the switch has any
+ * non-empty DNS record, hence returns false if that changed. */
+static bool
+ls_handle_dns_records_changes(const struct sbrec_dns_table *sbrec_dns_table,
+                              struct ovn_datapath *od)
+{
+    const struct nbrec_logical_switch *nbs = od->nbs;
+
+    for (size_t i = 0; i < nbs->n_dns_records; i++) {
+        const struct nbrec_dns *nb_dns = nbs->dns_records[i];
+
+        if (!nbrec_dns_row_get_seqno(nb_dns, OVSDB_IDL_CHANGE_MODIFY)) {
+            continue;
+        }
+
+        if (ls_has_dns_records(nbs) != od->has_dns_records) {
+            return false;
+        }
+
+        const struct sbrec_dns *sb_dns =
+            sb_dns_find(sbrec_dns_table, &nb_dns->header_.uuid);
+        if (!sb_dns) {
+            return false;
+        }
+        sync_dns_record(nb_dns, sb_dns);
+    }
+
+    return true;
+}
+
 static void
 sync_dns_entries(struct ovsdb_idl_txn *ovnsb_txn,
                  const struct sbrec_dns_table *sbrec_dns_table,
@@ -17018,6 +20735,7 @@ sync_dns_entries(struct ovsdb_idl_txn *ovnsb_txn,
     struct ovn_datapath *od;
     HMAP_FOR_EACH (od, key_node, ls_datapaths) {
         ovs_assert(od->nbs);
+        od->has_dns_records = ls_has_dns_records(od->nbs);
         if (!od->nbs->n_dns_records) {
             continue;
         }
@@ -17071,19 +20789,6 @@ sync_dns_entries(struct ovsdb_idl_txn *ovnsb_txn,
             free(dns_id);
         }
 
-        /* Copy DNS options to SB*/
-        struct smap options = SMAP_INITIALIZER(&options);
-        if (!smap_is_empty(&dns_info->sb_dns->options)) {
-            smap_clone(&options, &dns_info->sb_dns->options);
-        }
-
-        bool ovn_owned = smap_get_bool(&dns_info->nb_dns->options,
-                                       "ovn-owned", false);
-        smap_replace(&options, "ovn-owned",
-                 ovn_owned? "true" : "false");
-        sbrec_dns_set_options(dns_info->sb_dns, &options);
-        smap_destroy(&options);
-
         /* Set the datapaths and records. If nothing has changed, then
          * this will be a no-op.
          */
@@ -17091,20 +20796,8 @@ sync_dns_entries(struct ovsdb_idl_txn *ovnsb_txn,
             dns_info->sb_dns,
             (struct sbrec_datapath_binding **)dns_info->sbs,
             dns_info->n_sbs);
+        sync_dns_record(dns_info->nb_dns, dns_info->sb_dns);
 
-        /* DNS lookups are case-insensitive. Convert records to lowercase so
-         * we can do consistent lookups when DNS requests arrive
-         */
-        struct smap lower_records = SMAP_INITIALIZER(&lower_records);
-        struct smap_node *node;
-        SMAP_FOR_EACH (node, &dns_info->nb_dns->records) {
-            smap_add_nocopy(&lower_records, xstrdup(node->key),
-                            str_tolower(node->value));
-        }
-
-        sbrec_dns_set_records(dns_info->sb_dns, &lower_records);
-
-        smap_destroy(&lower_records);
         free(dns_info->sbs);
         free(dns_info);
     }
@@ -17150,6 +20843,121 @@ sync_template_vars(
     shash_destroy(&nb_tvs);
 }
 
+static const struct sbrec_chassis_template_var *
+sb_template_var_lookup(struct ovsdb_idl_index *sbrec_template_var_by_chassis,
+                       const char *chassis)
+{
+    struct sbrec_chassis_template_var *target =
+        sbrec_chassis_template_var_index_init_row(
+            sbrec_template_var_by_chassis);
+    sbrec_chassis_template_var_index_set_chassis(target, chassis);
+
+    const struct sbrec_chassis_template_var *sb_tv =
+        sbrec_chassis_template_var_index_find(sbrec_template_var_by_chassis,
+                                              target);
+    sbrec_chassis_template_var_index_destroy_row(target);
+    return sb_tv;
+}
+
+/* Syncs the changes to the NB Chassis_Template_Var rows tracked in
+ * 'nbrec_ch_template_var_table' to their SB counterparts, as
+ * sync_template_vars() does for all of them.  Returns false if the chassis
+ * of a template var was changed. */
+bool
+northd_handle_nb_template_var_changes(
+    struct ovsdb_idl_txn *ovnsb_txn,
+    const struct nbrec_chassis_template_var_table *nbrec_ch_template_var_table,
+    struct ovsdb_idl_index *sbrec_template_var_by_chassis)
+{
+    const struct nbrec_chassis_template_var *nb_tv;
+    const struct sbrec_chassis_template_var *sb_tv;
+    struct sset deleted = SSET_INITIALIZER(&deleted);
+
+    NBREC_CHASSIS_TEMPLATE_VAR_TABLE_FOR_EACH_TRACKED (
+            nb_tv, nbrec_ch_template_var_table) {
+        if (nbrec_chassis_template_var_is_deleted(nb_tv)) {
+            sset_add(&deleted, nb_tv->chassis);
+        } else if (!nbrec_chassis_template_var_is_new(nb_tv)
+                   && nbrec_chassis_template_var_is_updated(
+                          nb_tv, NBREC_CHASSIS_TEMPLATE_VAR_COL_CHASSIS)) {
+            sset_destroy(&deleted);
+            return false;
+        }
+    }
+
+    NBREC_CHASSIS_TEMPLATE_VAR_TABLE_FOR_EACH_TRACKED (
+            nb_tv, nbrec_ch_template_var_table) {
+        if (nbrec_chassis_template_var_is_deleted(nb_tv)) {
+            continue;
+        }
+
+        /* The template vars of a chassis may have been deleted and created
+         * again. */
+        sset_find_and_delete(&deleted, nb_tv->chassis);
+
+        sb_tv = sb_template_var_lookup(sbrec_template_var_by_chassis,
+                                       nb_tv->chassis);
+        if (!sb_tv) {
+            sb_tv = sbrec_chassis_template_var_insert(ovnsb_txn);
+            sbrec_chassis_template_var_set_chassis(sb_tv, nb_tv->chassis);
+            sbrec_chassis_template_var_set_variables(sb_tv,
+                                                     &nb_tv->variables);
+        } else if (!smap_equal(&sb_tv->variables, &nb_tv->variables)) {
+            sbrec_chassis_template_var_set_variables(sb_tv,
+                                                     &nb_tv->variables);
+        }
+    }
+
+    const char *chassis;
+    SSET_FOR_EACH (chassis, &deleted) {
+        sb_tv = sb_template_var_lookup(sbrec_template_var_by_chassis,
+                                       chassis);
+        if (sb_tv) {
+            sbrec_chassis_template_var_delete(sb_tv);
+        }
+    }
+    sset_destroy(&deleted);
+
+    return true;
+}
+
+/* Checks the changes to the SB Chassis_Template_Var rows tracked in
+ * 'sbrec_ch_template_var_table', which are normally the result of the
+ * updates made by northd itself.  Returns false if a row doesn't match the
+ * NB one, e.g. if it was modified or deleted by someone else, so that a
+ * recompute fixes it. */
+bool
+northd_handle_sb_template_var_changes(
+    const struct sbrec_chassis_template_var_table *sbrec_ch_template_var_table,
+    struct ovsdb_idl_index *nbrec_template_var_by_chassis)
+{
+    const struct sbrec_chassis_template_var *sb_tv;
+
+    SBREC_CHASSIS_TEMPLATE_VAR_TABLE_FOR_EACH_TRACKED (
+            sb_tv, sbrec_ch_template_var_table) {
+        struct nbrec_chassis_template_var *target =
+            nbrec_chassis_template_var_index_init_row(
+                nbrec_template_var_by_chassis);
+        nbrec_chassis_template_var_index_set_chassis(target, sb_tv->chassis);
+
+        const struct nbrec_chassis_template_var *nb_tv =
+            nbrec_chassis_template_var_index_find(
+                nbrec_template_var_by_chassis, target);
+        nbrec_chassis_template_var_index_destroy_row(target);
+
+        if (sbrec_chassis_template_var_is_deleted(sb_tv)) {
+            if (nb_tv) {
+                return false;
+            }
+        } else if (!nb_tv || !smap_equal(&sb_tv->variables,
+                                         &nb_tv->variables)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static void
 build_ip_mcast(struct ovsdb_idl_txn *ovnsb_txn,
                const struct sbrec_ip_multicast_table *sbrec_ip_multicast_table,
@@ -17393,33 +21201,23 @@ build_mcast_groups(const struct sbrec_igmp_group_table *sbrec_igmp_group_table,
     }
 }
 
-static const struct nbrec_static_mac_binding *
-static_mac_binding_by_port_ip(
-    const struct nbrec_static_mac_binding_table *nbrec_static_mb_table,
-    const char *logical_port, const char *ip)
-{
-    const struct nbrec_static_mac_binding *nb_smb = NULL;
-
-    NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (nb_smb, nbrec_static_mb_table) {
-        if (!strcmp(nb_smb->logical_port, logical_port) &&
-            !strcmp(nb_smb->ip, ip)) {
-            break;
-        }
-    }
-
-    return nb_smb;
-}
-
 static void
 build_static_mac_binding_table(
     struct ovsdb_idl_txn *ovnsb_txn,
     const struct nbrec_static_mac_binding_table *nbrec_static_mb_table,
     const struct sbrec_static_mac_binding_table *sbrec_static_mb_table,
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_lport_ip,
+    const struct hmap *ls_ports,
     struct hmap *lr_ports)
 {
+    struct hmap neigh_bindings = HMAP_INITIALIZER(&neigh_bindings);
+    const struct ovn_port *lsp;
+    HMAP_FOR_EACH (lsp, key_node, ls_ports) {
+        lsp_collect_static_neigh_bindings(lsp, lr_ports, &neigh_bindings);
+    }
+
     /* Cleanup SB Static_MAC_Binding entries which do not have corresponding
-     * NB Static_MAC_Binding entries. */
+     * NB Static_MAC_Binding entries or static neighbor bindings. */
     const struct nbrec_static_mac_binding *nb_smb;
     const struct sbrec_static_mac_binding *sb_smb;
     SBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH_SAFE (sb_smb,
@@ -17427,15 +21225,28 @@ build_static_mac_binding_table(
         nb_smb = static_mac_binding_by_port_ip(nbrec_static_mb_table,
                                                sb_smb->logical_port,
                                                sb_smb->ip);
-        if (!nb_smb) {
+        if (!nb_smb && !static_neigh_binding_find(&neigh_bindings,
+                                                  sb_smb->logical_port,
+                                                  sb_smb->ip)) {
             sbrec_static_mac_binding_delete(sb_smb);
         }
     }
 
     /* Create/Update SB Static_MAC_Binding entries with corresponding values
-     * from NB Static_MAC_Binding entries. */
+     * from NB Static_MAC_Binding entries, which take precedence over the
+     * static neighbor bindings. */
     NBREC_STATIC_MAC_BINDING_TABLE_FOR_EACH (
         nb_smb, nbrec_static_mb_table) {
+        struct static_neigh_binding *b =
+            static_neigh_binding_find(&neigh_bindings, nb_smb->logical_port,
+                                      nb_smb->ip);
+        if (b) {
+            hmap_remove(&neigh_bindings, &b->hmap_node);
+            free(b->ip);
+            free(b->mac);
+            free(b);
+        }
+
         struct ovn_port *op = ovn_port_find(lr_ports, nb_smb->logical_port);
         if (op && op->nbrp) {
             struct ovn_datapath *od = op->od;
@@ -17468,6 +21279,13 @@ build_static_mac_binding_table(
             }
         }
     }
+
+    const struct static_neigh_binding *b;
+    HMAP_FOR_EACH (b, hmap_node, &neigh_bindings) {
+        static_neigh_binding_sync_sb(ovnsb_txn,
+                                     sbrec_static_mac_binding_by_lport_ip, b);
+    }
+    static_neigh_bindings_destroy(&neigh_bindings);
 }
 
 static void
@@ -17560,7 +21378,7 @@ northd_destroy(struct northd_data *data)
 
     struct service_monitor_info *mon_info;
     HMAP_FOR_EACH_POP (mon_info, hmap_node, &data->svc_monitor_map) {
-        free(mon_info);
+        service_mon_free(mon_info);
     }
     hmap_destroy(&data->svc_monitor_map);
 
@@ -17608,6 +21426,11 @@ ovnnb_db_run(struct northd_input *input_data,
                                               false);
     use_common_zone = smap_get_bool(input_data->nb_options, "use_common_zone",
                                     false);
+    use_nat_address_sets = smap_get_bool(input_data->nb_options,
+                                         "use_nat_address_sets", false);
+    use_lflow_parameters = (smap_get_bool(input_data->nb_options,
+                                          "use_lflow_parameters", false)
+                            && input_data->features->lflow_parameters);
 
     vxlan_mode = is_vxlan_mode(input_data->nb_options,
                                input_data->sbrec_chassis_table);
@@ -17643,7 +21466,9 @@ ovnnb_db_run(struct northd_input *input_data,
     build_lb_count_dps(&data->lb_datapaths_map,
                        ods_size(&data->ls_datapaths),
                        ods_size(&data->lr_datapaths));
+    stopwatch_start(BUILD_IPAM_STOPWATCH_NAME, time_msec());
     build_ipam(&data->ls_datapaths.datapaths, &data->ls_ports);
+    stopwatch_stop(BUILD_IPAM_STOPWATCH_NAME, time_msec());
     build_lrouter_groups(&data->lr_ports, &data->lr_list);
     build_ip_mcast(ovnsb_txn, input_data->sbrec_ip_multicast_table,
                    input_data->sbrec_ip_mcast_by_dp,
@@ -17652,7 +21477,7 @@ ovnnb_db_run(struct northd_input *input_data,
         input_data->nbrec_static_mac_binding_table,
         input_data->sbrec_static_mac_binding_table,
         input_data->sbrec_static_mac_binding_by_lport_ip,
-        &data->lr_ports);
+        &data->ls_ports, &data->lr_ports);
     stopwatch_stop(BUILD_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
     stopwatch_start(CLEAR_LFLOWS_CTX_STOPWATCH_NAME, time_msec());
 
@@ -17780,10 +21605,10 @@ update_sb_ha_group_ref_chassis(
  * function build_ha_chassis_group_ref_chassis will add these chassis to the
  * list of the reference chassis - 'ref_chassis' of hagrp1.
  */
-static void
-collect_lr_groups_for_ha_chassis_groups(const struct sbrec_port_binding *sb,
-                                        struct ovn_port *op,
-                                        struct hmapx *lr_groups)
+/* Returns the logical router group of the logical routers connected to the
+ * logical switch of 'op', if they have HA chassis groups, otherwise NULL. */
+static struct lrouter_group *
+ovn_port_get_ha_lr_group(const struct ovn_port *op)
 {
     struct lrouter_group *lr_group = NULL;
     for (size_t i = 0; i < op->od->n_router_ports; i++) {
@@ -17799,6 +21624,18 @@ collect_lr_groups_for_ha_chassis_groups(const struct sbrec_port_binding *sb,
     }
 
     if (!lr_group || sset_is_empty(&lr_group->ha_chassis_groups)) {
+        return NULL;
+    }
+    return lr_group;
+}
+
+static void
+collect_lr_groups_for_ha_chassis_groups(const struct sbrec_port_binding *sb,
+                                        struct ovn_port *op,
+                                        struct hmapx *lr_groups)
+{
+    struct lrouter_group *lr_group = ovn_port_get_ha_lr_group(op);
+    if (!lr_group) {
         return;
     }
 
@@ -17850,18 +21687,129 @@ handle_cr_port_binding_changes(const struct sbrec_port_binding *sb,
     }
 }
 
+void
+lsp_up_batch_init(struct lsp_up_batch *batch)
+{
+    *batch = (struct lsp_up_batch) {
+        .pending = SHASH_INITIALIZER(&batch->pending),
+        .next_msec = LLONG_MAX,
+    };
+}
+
+void
+lsp_up_batch_destroy(struct lsp_up_batch *batch)
+{
+    shash_destroy_free_data(&batch->pending);
+}
+
+struct lsp_up_update {
+    const struct nbrec_logical_switch_port *nbsp;
+    bool up;
+};
+
+struct lsp_up_updates {
+    struct lsp_up_update *updates;
+    size_t n;
+    size_t allocated;
+};
+
+/* Returns the value that the "up" column of the logical switch port of 'op'
+ * should have according to its port binding 'sb'. */
+static bool
+lsp_up_from_port_binding(const struct ovn_port *op,
+                         const struct sbrec_port_binding *sb)
+{
+    if (lsp_is_router(op->nbsp)) {
+        return true;
+    } else if (sb->chassis) {
+        return smap_get_bool(&sb->chassis->other_config,
+                             OVN_FEATURE_PORT_UP_NOTIF, false)
+               ? sb->n_up && sb->up[0]
+               : true;
+    }
+    return false;
+}
+
+/* Adds to 'updates' the logical switch port of 'op' if its "up" column
+ * isn't 'up' yet. */
+static void
+lsp_up_updates_add(struct lsp_up_updates *updates, const struct ovn_port *op,
+                   bool up)
+{
+    if (op->nbsp->up && *op->nbsp->up == up) {
+        return;
+    }
+    if (updates->n == updates->allocated) {
+        updates->updates = x2nrealloc(updates->updates, &updates->allocated,
+                                      sizeof *updates->updates);
+    }
+    updates->updates[updates->n++] = (struct lsp_up_update) {
+        .nbsp = op->nbsp,
+        .up = up,
+    };
+}
+
+/* Sets the "up" column of the 'n' logical switch ports in 'updates', whose
+ * column is out of date, once the oldest of them has waited for the maximum
+ * delay of 'batch', and at most as many of them as allowed in a single NB
+ * transaction.  The others are kept pending in 'batch'. */
+static void
+lsp_up_batch_run(struct lsp_up_batch *batch,
+                 const struct lsp_up_update *updates, size_t n)
+{
+    struct shash pending = SHASH_INITIALIZER(&pending);
+    long long int now = time_msec();
+    long long int oldest = now;
+
+    /* The ports that aren't out of date anymore are forgotten. */
+    for (size_t i = 0; i < n; i++) {
+        const char *name = updates[i].nbsp->name;
+        long long int *since = shash_find_and_delete(&batch->pending, name);
+
+        if (!since) {
+            since = xmemdup(&now, sizeof now);
+        }
+        oldest = MIN(oldest, *since);
+        shash_add(&pending, name, since);
+    }
+    shash_swap(&batch->pending, &pending);
+    shash_destroy_free_data(&pending);
+
+    batch->next_msec = LLONG_MAX;
+    if (!n) {
+        return;
+    }
+    if (now < oldest + batch->max_delay_msec) {
+        batch->next_msec = oldest + batch->max_delay_msec;
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (batch->max_per_txn && i >= batch->max_per_txn) {
+            /* The others go in the following transactions. */
+            batch->next_msec = now;
+            break;
+        }
+        nbrec_logical_switch_port_set_up(updates[i].nbsp, &updates[i].up, 1);
+        free(shash_find_and_delete(&batch->pending, updates[i].nbsp->name));
+    }
+}
+
 /* Handle changes to the 'chassis' column of the 'Port_Binding' table.  When
  * this column is not empty, it means we need to set the corresponding logical
- * port as 'up' in the northbound DB. */
+ * port as 'up' in the northbound DB.  The updates of the northbound DB are
+ * batched as configured in 'lsp_up_batch'. */
 static void
 handle_port_binding_changes(struct ovsdb_idl_txn *ovnsb_txn,
                 const struct sbrec_port_binding_table *sb_pb_table,
                 const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table,
                 struct hmap *ls_ports,
                 struct hmap *lr_ports,
-                struct shash *ha_ref_chassis_map)
+                struct shash *ha_ref_chassis_map,
+                struct lsp_up_batch *lsp_up_batch)
 {
     struct hmapx lr_groups = HMAPX_INITIALIZER(&lr_groups);
+    struct lsp_up_updates updates = { .updates = NULL };
     const struct sbrec_port_binding *sb;
     bool build_ha_chassis_ref = false;
 
@@ -17898,26 +21846,13 @@ handle_port_binding_changes(struct ovsdb_idl_txn *ovnsb_txn,
             continue;
         }
 
-        bool up = false;
-
-        if (lsp_is_router(op->nbsp)) {
-            up = true;
-        } else if (sb->chassis) {
-            up = smap_get_bool(&sb->chassis->other_config,
-                               OVN_FEATURE_PORT_UP_NOTIF, false)
-                 ? sb->n_up && sb->up[0]
-                 : true;
-        }
-
-        if (!op->nbsp->up || *op->nbsp->up != up) {
-            nbrec_logical_switch_port_set_up(op->nbsp, &up, 1);
-        }
+        lsp_up_updates_add(&updates, op, lsp_up_from_port_binding(op, sb));
 
         /* ovn-controller will update 'Port_Binding.up' only if it was
          * explicitly set to 'false'.
          */
         if (!op->sb->n_up) {
-            up = false;
+            bool up = false;
             sbrec_port_binding_set_up(op->sb, &up, 1);
         }
 
@@ -17928,6 +21863,9 @@ handle_port_binding_changes(struct ovsdb_idl_txn *ovnsb_txn,
         }
     }
 
+    lsp_up_batch_run(lsp_up_batch, updates.updates, updates.n);
+    free(updates.updates);
+
     /* Update ha chassis group's ref_chassis if required. */
     build_ha_chassis_group_ref_chassis(&lr_groups, ha_ref_chassis_map);
     hmapx_destroy(&lr_groups);
@@ -17940,7 +21878,8 @@ ovnsb_db_run(struct ovsdb_idl_txn *ovnnb_txn,
              const struct sbrec_port_binding_table *sb_pb_table,
              const struct sbrec_ha_chassis_group_table *sb_ha_ch_grp_table,
              struct hmap *ls_ports,
-             struct hmap *lr_ports)
+             struct hmap *lr_ports,
+             struct lsp_up_batch *lsp_up_batch)
 {
     if (!ovnnb_txn ||
         !ovsdb_idl_has_ever_connected(ovsdb_idl_txn_get_idl(ovnsb_txn))) {
@@ -17949,7 +21888,8 @@ ovnsb_db_run(struct ovsdb_idl_txn *ovnnb_txn,
 
     struct shash ha_ref_chassis_map = SHASH_INITIALIZER(&ha_ref_chassis_map);
     handle_port_binding_changes(ovnsb_txn, sb_pb_table, sb_ha_ch_grp_table,
-                                ls_ports, lr_ports, &ha_ref_chassis_map);
+                                ls_ports, lr_ports, &ha_ref_chassis_map,
+                                lsp_up_batch);
     if (ovnsb_txn) {
         update_sb_ha_group_ref_chassis(sb_ha_ch_grp_table,
                                        &ha_ref_chassis_map);
@@ -17959,6 +21899,86 @@ ovnsb_db_run(struct ovsdb_idl_txn *ovnnb_txn,
     ovn_update_ipv6_prefix(lr_ports);
 }
 
+/* Handles the changes to the SB Port_Binding rows tracked in 'sb_pb_table',
+ * as ovnsb_db_run() does for all of them, and updates the logical switch
+ * ports left pending in 'lsp_up_batch'.  Returns false if the changes can't
+ * be handled incrementally, i.e. if a port binding was claimed or released
+ * on a logical switch connected to logical routers with HA chassis groups,
+ * whose "ref_chassis" depend on all the port bindings. */
+bool
+ovnsb_db_handle_port_binding_changes(
+    const struct sbrec_port_binding_table *sb_pb_table,
+    struct hmap *ls_ports, struct hmap *lr_ports,
+    struct lsp_up_batch *lsp_up_batch)
+{
+    struct hmapx updated_ports = HMAPX_INITIALIZER(&updated_ports);
+    struct lsp_up_updates updates = { .updates = NULL };
+    const struct sbrec_port_binding *sb;
+    bool handled = true;
+
+    SBREC_PORT_BINDING_TABLE_FOR_EACH_TRACKED (sb, sb_pb_table) {
+        bool is_deleted = sbrec_port_binding_is_deleted(sb);
+        bool is_new = sbrec_port_binding_is_new(sb);
+
+        struct ovn_port *orp = ovn_port_find(lr_ports, sb->logical_port);
+        if (orp && orp->sb == sb && !is_deleted) {
+            if (is_cr_port(orp)) {
+                handle_cr_port_binding_changes(sb, orp);
+                continue;
+            }
+            if (is_new || sbrec_port_binding_is_updated(
+                              sb, SBREC_PORT_BINDING_COL_OPTIONS)) {
+                ovn_port_update_ipv6_prefix(orp);
+            }
+        }
+
+        struct ovn_port *op = ovn_port_find(ls_ports, sb->logical_port);
+        if (!op || !op->nbsp) {
+            continue;
+        }
+
+        if ((is_new || is_deleted
+             || sbrec_port_binding_is_updated(sb,
+                                              SBREC_PORT_BINDING_COL_CHASSIS))
+            && ovn_port_get_ha_lr_group(op)) {
+            handled = false;
+            goto out;
+        }
+        if (is_deleted || op->sb != sb) {
+            continue;
+        }
+
+        hmapx_add(&updated_ports, op);
+        lsp_up_updates_add(&updates, op, lsp_up_from_port_binding(op, sb));
+
+        /* ovn-controller will update 'Port_Binding.up' only if it was
+         * explicitly set to 'false'. */
+        if (!sb->n_up) {
+            bool up = false;
+            sbrec_port_binding_set_up(sb, &up, 1);
+        }
+    }
+
+    /* The pending ports are still evaluated, as lsp_up_batch_run() forgets
+     * the ones that it isn't passed. */
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &lsp_up_batch->pending) {
+        struct ovn_port *op = ovn_port_find(ls_ports, node->name);
+
+        if (op && op->nbsp && op->sb && !hmapx_contains(&updated_ports, op)) {
+            lsp_up_updates_add(&updates, op,
+                               lsp_up_from_port_binding(op, op->sb));
+        }
+    }
+
+    lsp_up_batch_run(lsp_up_batch, updates.updates, updates.n);
+
+out:
+    free(updates.updates);
+    hmapx_destroy(&updated_ports);
+    return handled;
+}
+
 const struct ovn_datapath *
 northd_get_datapath_for_port(const struct hmap *ls_ports,
                              const char *port_name)
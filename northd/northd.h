@@ -23,7 +23,9 @@
 #include "northd/en-port-group.h"
 #include "northd/ipam.h"
 #include "openvswitch/hmap.h"
+#include "openvswitch/shash.h"
 #include "ovs-thread.h"
+#include "smap.h"
 
 struct northd_input {
     /* Northbound table references */
@@ -69,6 +71,9 @@ struct northd_input {
     struct ovsdb_idl_index *sbrec_ip_mcast_by_dp;
     struct ovsdb_idl_index *sbrec_static_mac_binding_by_lport_ip;
     struct ovsdb_idl_index *sbrec_fdb_by_dp_and_port;
+    struct ovsdb_idl_index *sbrec_mac_binding_by_datapath;
+    struct ovsdb_idl_index *sbrec_template_var_by_chassis;
+    struct ovsdb_idl_index *nbrec_template_var_by_chassis;
 };
 
 /* A collection of datapaths. E.g. all logical switch datapaths, or all
@@ -120,15 +125,24 @@ enum northd_tracked_data_type {
     NORTHD_TRACKED_LR_NATS  = (1 << 2),
     NORTHD_TRACKED_LS_LBS   = (1 << 3),
     NORTHD_TRACKED_LS_ACLS  = (1 << 4),
+    NORTHD_TRACKED_LR_ROUTES = (1 << 5),
+    NORTHD_TRACKED_LS_ROUTER_PORTS = (1 << 6),
+    NORTHD_TRACKED_LR_POLICIES = (1 << 7),
+    NORTHD_TRACKED_LS_QOS = (1 << 8),
+    NORTHD_TRACKED_LS_CONFIG = (1 << 9),
 };
 
 /* Track what's changed in the northd engine node.
- * Now only tracks ovn_ports (of vif type) - created, updated
+ * Now only tracks ovn_ports (of vif and router type) - created, updated
  * and deleted. */
 struct northd_tracked_data {
     /* Indicates the type of data tracked.  One or all of NORTHD_TRACKED_*. */
     enum northd_tracked_data_type type;
     struct tracked_ovn_ports trk_lsps;
+
+    /* Tracked logical router ports.  NORTHD_TRACKED_PORTS covers them
+     * along with 'trk_lsps'. */
+    struct tracked_ovn_ports trk_lrps;
     struct tracked_lbs trk_lbs;
 
     /* Tracked logical routers whose NATs have changed.
@@ -142,6 +156,28 @@ struct northd_tracked_data {
     /* Tracked logical switches whose ACLs have changed.
      * hmapx node is 'struct ovn_datapath *'. */
     struct hmapx ls_with_changed_acls;
+
+    /* Tracked logical routers whose static routes have changed.
+     * hmapx node is 'struct ovn_datapath *'. */
+    struct hmapx lr_with_changed_routes;
+
+    /* Tracked logical routers whose routing policies have changed.
+     * hmapx node is 'struct ovn_datapath *'. */
+    struct hmapx lr_with_changed_policies;
+
+    /* Tracked logical switches whose QoS rules have changed.
+     * hmapx node is 'struct ovn_datapath *'. */
+    struct hmapx ls_with_changed_qos;
+
+    /* Tracked logical switches whose other_config has changed, see
+     * ls_handle_other_config_changes() in northd.c.
+     * hmapx node is 'struct ovn_datapath *'. */
+    struct hmapx ls_with_changed_config;
+
+    /* Tracked logical switches whose router ports, i.e., the 'router_ports'
+     * of their ovn_datapath, have changed.
+     * hmapx node is 'struct ovn_datapath *'. */
+    struct hmapx ls_with_changed_router_ports;
 };
 
 struct northd_data {
@@ -186,10 +222,12 @@ struct lflow_input {
     const struct shash *meter_groups;
     const struct hmap *lb_datapaths_map;
     const struct hmap *bfd_connections;
+    struct hmap *igmp_lflow_refs;  /* See igmp_lflow_refs_destroy(). */
     const struct chassis_features *features;
     const struct hmap *svc_monitor_map;
     bool ovn_internal_version_changed;
     const char *svc_monitor_mac;
+    size_t max_lflow_inserts;  /* Max new SB logical flows per txn, or 0. */
 };
 
 extern int parallelization_state;
@@ -199,7 +237,6 @@ enum {
     STATE_USE_PARALLELIZATION /* parallelization is on */
 };
 
-extern thread_local size_t thread_lflow_counter;
 
 /*
  * Multicast snooping and querier per datapath configuration.
@@ -252,7 +289,7 @@ struct mcast_router_info {
 
 struct mcast_info {
 
-    struct hmap group_tnlids;  /* Group tunnel IDs in use on this DP. */
+    struct ovn_tnlids group_tnlids; /* Group tunnel IDs in use on this DP. */
     uint32_t group_tnlid_hint; /* Hint for allocating next group tunnel ID. */
     struct ovs_list groups;    /* List of groups learnt on this DP. */
 
@@ -272,65 +309,78 @@ struct mcast_port_info {
 /* The 'key' comes from nbs->header_.uuid or nbr->header_.uuid or
  * sb->external_ids:logical-switch. */
 struct ovn_datapath {
+    /* Members used by most of the logical flow generation loops come
+     * first, see struct ovn_port. */
+
     struct hmap_node key_node;  /* Index on 'key'. */
     struct uuid key;            /* (nbs/nbr)->header_.uuid. */
 
     size_t index;   /* A unique index across all datapaths.
                      * Datapath indexes are sequential and start from zero. */
 
-    struct ovn_datapaths *datapaths; /* The collection of datapaths that
-                                        contains this datapath. */
-
     const struct nbrec_logical_switch *nbs;  /* May be NULL. */
     const struct nbrec_logical_router *nbr;  /* May be NULL. */
     const struct sbrec_datapath_binding *sb; /* May be NULL. */
 
-    struct ovs_list list;       /* In list of similar records. */
-
     uint32_t tunnel_key;
 
-    /* Logical router data. */
-    struct ovn_datapath **ls_peers;
-    size_t n_ls_peers;
-    size_t n_allocated_ls_peers;
-    struct sset router_ips; /* Router port IPs except the IPv6 LLAs. */
-
     /* Logical switch data. */
     struct ovn_port **router_ports;
     size_t n_router_ports;
     size_t n_allocated_router_ports;
 
-    struct hmap port_tnlids;
-    uint32_t port_key_hint;
+    /* OVN northd only needs to know about logical router gateway ports for
+     * NAT/LB on a distributed router.  The "distributed gateway ports" are
+     * populated only when there is a gateway chassis or ha chassis group
+     * specified for some of the ports on the logical router. Otherwise this
+     * will be NULL. */
+    struct ovn_port **l3dgw_ports;
+    size_t n_l3dgw_ports;
+
+    struct ovn_port **localnet_ports;
+    size_t n_localnet_ports;
 
     bool has_unknown;
     bool has_vtep_lports;
     bool has_arp_proxy_port;
-
-    /* IPAM data. */
-    struct ipam_info ipam_info;
-
-    /* Multicast data. */
-    struct mcast_info mcast_info;
+    /* True if any of the DNS records of the logical switch is not empty, as
+     * of the last sync of the SB DNS table. */
+    bool has_dns_records;
 
     /* Applies to only logical router datapath.
      * True if logical router is a gateway router. i.e options:chassis is set.
      * If this is true, then 'l3dgw_ports' will be ignored. */
     bool is_gw_router;
 
-    /* OVN northd only needs to know about logical router gateway ports for
-     * NAT/LB on a distributed router.  The "distributed gateway ports" are
-     * populated only when there is a gateway chassis or ha chassis group
-     * specified for some of the ports on the logical router. Otherwise this
-     * will be NULL. */
-    struct ovn_port **l3dgw_ports;
-    size_t n_l3dgw_ports;
-
     /* router datapath has a logical port with redirect-type set to bridged. */
     bool redirect_bridged;
 
-    struct ovn_port **localnet_ports;
-    size_t n_localnet_ports;
+    struct ovn_datapaths *datapaths; /* The collection of datapaths that
+                                        contains this datapath. */
+
+    /* Less frequently used members. */
+
+    struct ovs_list list;       /* In list of similar records. */
+
+    /* Logical router data. */
+    struct ovn_datapath **ls_peers;
+    size_t n_ls_peers;
+    size_t n_allocated_ls_peers;
+    struct sset router_ips; /* Router port IPs except the IPv6 LLAs. */
+
+    struct ovn_tnlids port_tnlids;
+    uint32_t port_key_hint;
+
+    /* IPAM data. */
+    struct ipam_info ipam_info;
+
+    /* Multicast data. */
+    struct mcast_info mcast_info;
+
+    /* Applies to only logical switch datapath.
+     * The other_config of the logical switch as of the last recompute,
+     * without the keys whose changes are handled incrementally. */
+    struct smap ls_config;
 
     struct ovs_list lr_list; /* In list of logical router datapaths. */
     /* The logical router group to which this datapath belongs.
@@ -340,6 +390,73 @@ struct ovn_datapath {
     /* Map of ovn_port objects belonging to this datapath.
      * This map doesn't include derived ports. */
     struct hmap ports;
+
+    /* Applies to only logical router datapath.
+     * 'route_lflow_ref' is used to reference the logical flows generated for
+     * the static routes of the logical router.  Same as for
+     * 'ovn_port->lflow_ref', this data is initialized and destroyed by the
+     * en_northd node, but populated and used only by the en_lflow node.
+     *
+     * 'routes_have_bfd' is set by the en_lflow node if any of the static
+     * routes used for generating these logical flows has BFD enabled. */
+    struct lflow_ref *route_lflow_ref;
+    bool routes_have_bfd;
+
+    /* Applies to only logical router datapath.
+     * 'policy_lflow_refs' is a map of 'struct lr_policy_lflow_ref's that
+     * reference the logical flows generated for each of the routing
+     * policies of the logical router.  Same as 'route_lflow_ref', it is
+     * initialized and destroyed by the en_northd node, but populated and
+     * used only by the en_lflow node. */
+    struct hmap policy_lflow_refs;
+
+    /* Applies to only logical switch datapath.
+     * 'qos_lflow_refs' is a map of 'struct ls_qos_lflow_ref's that reference
+     * the logical flows generated for each of the QoS rules of the logical
+     * switch.  Same as 'policy_lflow_refs', it is initialized and destroyed
+     * by the en_northd node, but populated and used only by the en_lflow
+     * node. */
+    struct hmap qos_lflow_refs;
+
+    /* Applies to only logical switch datapath.
+     * 'datapath_lflow_ref' is used to reference the logical flows generated
+     * for the logical switch itself, i.e., not for its ports, ACLs or load
+     * balancers.  Same as 'route_lflow_ref', it is initialized and destroyed
+     * by the en_northd node, but populated and used only by the en_lflow
+     * node. */
+    struct lflow_ref *datapath_lflow_ref;
+};
+
+/* Reference of the logical flows generated for one routing policy of a
+ * logical router, see 'policy_lflow_refs' in struct ovn_datapath. */
+struct lr_policy_lflow_ref {
+    struct hmap_node hmap_node;  /* In 'policy_lflow_refs', by hash of
+                                  * 'key'. */
+    char *key;                   /* Policy row and the contents its lflows
+                                  * are built from. */
+    struct lflow_ref *lflow_ref;
+    bool has_bfd;                /* The policy uses BFD sessions. */
+
+    /* Used by build_lr_policy_flows() in northd.c. */
+    bool stale;                  /* The policy wasn't found in the last
+                                  * build. */
+    bool rebuilt;                /* The lflows were rebuilt by the last
+                                  * build. */
+};
+
+/* Reference of the logical flows generated for one QoS rule of a logical
+ * switch, see 'qos_lflow_refs' in struct ovn_datapath. */
+struct ls_qos_lflow_ref {
+    struct hmap_node hmap_node;  /* In 'qos_lflow_refs', by hash of 'key'. */
+    char *key;                   /* QoS row and the contents its lflows are
+                                  * built from. */
+    struct lflow_ref *lflow_ref;
+
+    /* Used by build_ls_qos_flows() in northd.c. */
+    bool stale;                  /* The QoS rule wasn't found in the last
+                                  * build. */
+    bool rebuilt;                /* The lflows were rebuilt by the last
+                                  * build. */
 };
 
 const struct ovn_datapath *ovn_datapath_find(const struct hmap *datapaths,
@@ -409,14 +526,15 @@ enum ovn_stage {
     PIPELINE_STAGE(SWITCH, IN,  ACL_AFTER_LB_ACTION,  18, \
                    "ls_in_acl_after_lb_action")  \
     PIPELINE_STAGE(SWITCH, IN,  STATEFUL,      19, "ls_in_stateful")      \
-    PIPELINE_STAGE(SWITCH, IN,  ARP_ND_RSP,    20, "ls_in_arp_rsp")       \
-    PIPELINE_STAGE(SWITCH, IN,  DHCP_OPTIONS,  21, "ls_in_dhcp_options")  \
-    PIPELINE_STAGE(SWITCH, IN,  DHCP_RESPONSE, 22, "ls_in_dhcp_response") \
-    PIPELINE_STAGE(SWITCH, IN,  DNS_LOOKUP,    23, "ls_in_dns_lookup")    \
-    PIPELINE_STAGE(SWITCH, IN,  DNS_RESPONSE,  24, "ls_in_dns_response")  \
-    PIPELINE_STAGE(SWITCH, IN,  EXTERNAL_PORT, 25, "ls_in_external_port") \
-    PIPELINE_STAGE(SWITCH, IN,  L2_LKUP,       26, "ls_in_l2_lkup")       \
-    PIPELINE_STAGE(SWITCH, IN,  L2_UNKNOWN,    27, "ls_in_l2_unknown")    \
+    PIPELINE_STAGE(SWITCH, IN,  ARP_ND_LOOKUP, 20, "ls_in_arp_nd_lookup") \
+    PIPELINE_STAGE(SWITCH, IN,  ARP_ND_RSP,    21, "ls_in_arp_rsp")       \
+    PIPELINE_STAGE(SWITCH, IN,  DHCP_OPTIONS,  22, "ls_in_dhcp_options")  \
+    PIPELINE_STAGE(SWITCH, IN,  DHCP_RESPONSE, 23, "ls_in_dhcp_response") \
+    PIPELINE_STAGE(SWITCH, IN,  DNS_LOOKUP,    24, "ls_in_dns_lookup")    \
+    PIPELINE_STAGE(SWITCH, IN,  DNS_RESPONSE,  25, "ls_in_dns_response")  \
+    PIPELINE_STAGE(SWITCH, IN,  EXTERNAL_PORT, 26, "ls_in_external_port") \
+    PIPELINE_STAGE(SWITCH, IN,  L2_LKUP,       27, "ls_in_l2_lkup")       \
+    PIPELINE_STAGE(SWITCH, IN,  L2_UNKNOWN,    28, "ls_in_l2_unknown")    \
                                                                           \
     /* Logical switch egress stages. */                                   \
     PIPELINE_STAGE(SWITCH, OUT, PRE_ACL,      0, "ls_out_pre_acl")        \
@@ -544,6 +662,10 @@ ovn_stage_to_str(enum ovn_stage stage)
  * distributed gateway ports point a "derived" ovn_port to a duplicate LRP).
  */
 struct ovn_port {
+    /* Members used by most of the logical flow generation loops come
+     * first, so that walking the ports touches as few cache lines as
+     * possible.  The rest follow in the "cold" part below. */
+
     /* Port name aka key.
      *
      * This is ordinarily the same as nbsp->name or nbrp->name and
@@ -553,32 +675,25 @@ struct ovn_port {
     char *key;                  /* nbsp->name, nbrp->name, sb->logical_port. */
     char *json_key;             /* 'key', quoted for use in JSON. */
 
-    const struct sbrec_port_binding *sb;         /* May be NULL. */
+    struct ovn_datapath *od;
 
-    uint32_t tunnel_key;
+    /* The port's peer:
+     *
+     *     - A switch port S of type "router" has a router port R as a peer,
+     *       and R in turn has S has its peer.
+     *
+     *     - Two connected logical router ports have each other as peer.
+     *
+     *     - Other kinds of ports have no peer. */
+    struct ovn_port *peer;
 
-    /* Logical switch port data. */
+    /* Northbound and southbound records.  At most one of 'nbsp' and
+     * 'nbrp' is nonnull. */
     const struct nbrec_logical_switch_port *nbsp; /* May be NULL. */
-
-    struct lport_addresses *lsp_addrs;  /* Logical switch port addresses. */
-    unsigned int n_lsp_addrs;  /* Total length of lsp_addrs. */
-    unsigned int n_lsp_non_router_addrs; /* Number of elements from the
-                                          * beginning of 'lsp_addrs' extracted
-                                          * directly from LSP 'addresses'. */
-
-    struct lport_addresses *ps_addrs;   /* Port security addresses. */
-    unsigned int n_ps_addrs;
-
-    bool lsp_can_be_inc_processed; /* If it can be incrementally processed when
-                                      the port changes. */
-
-    /* Logical router port data. */
     const struct nbrec_logical_router_port *nbrp; /* May be NULL. */
+    const struct sbrec_port_binding *sb;         /* May be NULL. */
 
-    struct lport_addresses lrp_networks;
-
-    /* Logical port multicast data. */
-    struct mcast_port_info mcast_info;
+    uint32_t tunnel_key;
 
     /* At most one of primary_port and cr_port can be not NULL. */
 
@@ -591,27 +706,21 @@ struct ovn_port {
      * to NULL. */
     struct ovn_port *cr_port;
 
+    struct lport_addresses *lsp_addrs;  /* Logical switch port addresses. */
+    unsigned int n_lsp_addrs;  /* Total length of lsp_addrs. */
+    unsigned int n_lsp_non_router_addrs; /* Number of elements from the
+                                          * beginning of 'lsp_addrs' extracted
+                                          * directly from LSP 'addresses'. */
+
     bool has_unknown; /* If the addresses have 'unknown' defined. */
 
     bool has_bfd;
 
-    /* The port's peer:
-     *
-     *     - A switch port S of type "router" has a router port R as a peer,
-     *       and R in turn has S has its peer.
-     *
-     *     - Two connected logical router ports have each other as peer.
-     *
-     *     - Other kinds of ports have no peer. */
-    struct ovn_port *peer;
-
-    struct ovn_datapath *od;
-
-    struct ovs_list list;       /* In list of similar records. */
+    bool lsp_can_be_inc_processed; /* If it can be incrementally processed when
+                                      the port changes. */
 
-    struct hmap_node dp_node;   /* Node in od->ports. */
-
-    struct lport_addresses proxy_arp_addrs;
+    bool lrp_can_be_inc_processed; /* If it can be incrementally processed
+                                      when the port is added or deleted. */
 
     /* Temporarily used for traversing a list (or hmap) of ports. */
     bool visited;
@@ -619,6 +728,22 @@ struct ovn_port {
     /* Only used for the router type LSP whose peer is l3dgw_port */
     bool enable_router_port_acl;
 
+    /* Less frequently used members. */
+
+    struct lport_addresses *ps_addrs;   /* Port security addresses. */
+    unsigned int n_ps_addrs;
+
+    struct lport_addresses lrp_networks;
+
+    /* Logical port multicast data. */
+    struct mcast_port_info mcast_info;
+
+    struct ovs_list list;       /* In list of similar records. */
+
+    struct hmap_node dp_node;   /* Node in od->ports. */
+
+    struct lport_addresses proxy_arp_addrs;
+
     /* Reference of lflows generated for this ovn_port.
      *
      * This data is initialized and destroyed by the en_northd node, but
@@ -657,16 +782,40 @@ void ovnnb_db_run(struct northd_input *input_data,
                   struct northd_data *data,
                   struct ovsdb_idl_txn *ovnnb_txn,
                   struct ovsdb_idl_txn *ovnsb_txn);
+
+/* Batching of the updates of the NB Logical_Switch_Port "up" column, see
+ * "northd-lsp-up-max-delay-ms" and "northd-max-lsp-up-per-txn" in
+ * ovn-nb(5). */
+struct lsp_up_batch {
+    struct shash pending;           /* Logical switch ports, by name, whose
+                                     * "up" column is out of date, each one
+                                     * with the 'long long int' time_msec()
+                                     * at which it was first found so. */
+    long long int max_delay_msec;
+    size_t max_per_txn;             /* 0 means no limit. */
+    long long int next_msec;        /* When the pending updates are due,
+                                     * LLONG_MAX if there are none. */
+};
+
+void lsp_up_batch_init(struct lsp_up_batch *);
+void lsp_up_batch_destroy(struct lsp_up_batch *);
+
 void ovnsb_db_run(struct ovsdb_idl_txn *ovnnb_txn,
                   struct ovsdb_idl_txn *ovnsb_txn,
                   const struct sbrec_port_binding_table *,
                   const struct sbrec_ha_chassis_group_table *,
                   struct hmap *ls_ports,
-                  struct hmap *lr_ports);
+                  struct hmap *lr_ports,
+                  struct lsp_up_batch *);
+bool ovnsb_db_handle_port_binding_changes(
+    const struct sbrec_port_binding_table *,
+    struct hmap *ls_ports, struct hmap *lr_ports,
+    struct lsp_up_batch *);
 bool northd_handle_ls_changes(struct ovsdb_idl_txn *,
                               const struct northd_input *,
                               struct northd_data *);
-bool northd_handle_lr_changes(const struct northd_input *,
+bool northd_handle_lr_changes(struct ovsdb_idl_txn *,
+                              const struct northd_input *,
                               struct northd_data *);
 void destroy_northd_data_tracked_changes(struct northd_data *);
 void northd_destroy(struct northd_data *data);
@@ -684,13 +833,32 @@ void build_lflows(struct ovsdb_idl_txn *ovnsb_txn,
 void lflow_reset_northd_refs(struct lflow_input *);
 
 bool lflow_handle_northd_port_changes(struct ovsdb_idl_txn *ovnsb_txn,
-                                      struct tracked_ovn_ports *,
+                                      struct tracked_ovn_ports *trk_lsps,
+                                      struct tracked_ovn_ports *trk_lrps,
                                       struct lflow_input *,
                                       struct lflow_table *lflows);
 bool lflow_handle_northd_lb_changes(struct ovsdb_idl_txn *ovnsb_txn,
                                     struct tracked_lbs *,
                                     struct lflow_input *,
                                     struct lflow_table *lflows);
+bool lflow_handle_northd_lr_route_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                          struct hmapx *lr_with_changed_routes,
+                                          struct lflow_input *,
+                                          struct lflow_table *lflows);
+bool lflow_handle_northd_lr_policy_changes(
+    struct ovsdb_idl_txn *ovnsb_txn, struct hmapx *lr_with_changed_policies,
+    struct lflow_input *, struct lflow_table *lflows);
+bool lflow_handle_northd_ls_qos_changes(
+    struct ovsdb_idl_txn *ovnsb_txn, struct hmapx *ls_with_changed_qos,
+    struct lflow_input *, struct lflow_table *lflows);
+bool lflow_handle_northd_ls_config_changes(
+    struct ovsdb_idl_txn *ovnsb_txn, struct hmapx *ls_with_changed_config,
+    struct lflow_input *, struct lflow_table *lflows);
+bool lflow_handle_bfd_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                              const struct hmapx *updated_bfds,
+                              const struct hmapx *lr_with_changed_routes,
+                              struct lflow_input *,
+                              struct lflow_table *lflows);
 bool lflow_handle_lr_stateful_changes(struct ovsdb_idl_txn *,
                                       struct lr_stateful_tracked_data *,
                                       struct lflow_input *,
@@ -699,9 +867,23 @@ bool lflow_handle_ls_stateful_changes(struct ovsdb_idl_txn *,
                                       struct ls_stateful_tracked_data *,
                                       struct lflow_input *,
                                       struct lflow_table *lflows);
+bool lflow_handle_igmp_group_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                     struct lflow_input *,
+                                     struct lflow_table *lflows);
+void igmp_lflow_refs_destroy(struct hmap *igmp_lflow_refs);
 bool northd_handle_sb_port_binding_changes(
     const struct sbrec_port_binding_table *, struct hmap *ls_ports,
     struct hmap *lr_ports);
+bool northd_handle_sb_ha_chassis_group_changes(
+    const struct sbrec_ha_chassis_group_table *,
+    const struct ovn_datapaths *lr_datapaths);
+bool northd_handle_nb_template_var_changes(
+    struct ovsdb_idl_txn *ovnsb_txn,
+    const struct nbrec_chassis_template_var_table *,
+    struct ovsdb_idl_index *sbrec_template_var_by_chassis);
+bool northd_handle_sb_template_var_changes(
+    const struct sbrec_chassis_template_var_table *,
+    struct ovsdb_idl_index *nbrec_template_var_by_chassis);
 
 struct tracked_lb_data;
 bool northd_handle_lb_data_changes(struct tracked_lb_data *,
@@ -710,6 +892,17 @@ bool northd_handle_lb_data_changes(struct tracked_lb_data *,
                                    struct hmap *lb_datapaths_map,
                                    struct hmap *lbgrp_datapaths_map,
                                    struct northd_tracked_data *);
+bool northd_handle_lb_svc_changes(struct ovsdb_idl_txn *ovnsb_txn,
+                                  const struct tracked_lb_data *,
+                                  const char *svc_monitor_mac,
+                                  const struct eth_addr *svc_monitor_mac_ea,
+                                  struct hmap *ls_ports,
+                                  struct sset *svc_monitor_lsps,
+                                  struct hmap *svc_monitor_map);
+bool northd_handle_sb_service_monitor_changes(
+    const struct sbrec_service_monitor_table *,
+    struct hmap *svc_monitor_map, struct hmap *lb_datapaths_map,
+    struct northd_tracked_data *);
 
 void build_bfd_table(struct ovsdb_idl_txn *ovnsb_txn,
                      const struct nbrec_bfd_table *,
@@ -718,7 +911,22 @@ void build_bfd_table(struct ovsdb_idl_txn *ovnsb_txn,
                      struct hmap *bfd_connections);
 void bfd_cleanup_connections(const struct nbrec_bfd_table *,
                              struct hmap *bfd_map);
+void bfd_destroy_connections(struct hmap *bfd_map);
+bool bfd_handle_nb_changes(const struct nbrec_bfd_table *,
+                           const struct hmap *bfd_connections,
+                           struct hmapx *updated_bfds);
+bool bfd_handle_sb_changes(const struct sbrec_bfd_table *,
+                           const struct nbrec_bfd_table *,
+                           struct hmap *bfd_connections);
+
+#define OVN_MAX_SUPPORTED_THREADS 256
 void run_update_worker_pool(int n_threads);
+void northd_prep_for_each(const char *phase, size_t n,
+                          void (*cb)(size_t idx, void *aux), void *aux);
+
+struct ds;
+void northd_par_set_adaptive(bool adaptive);
+void northd_par_stats_format(struct ds *);
 
 const struct ovn_datapath *northd_get_datapath_for_port(
     const struct hmap *ls_ports, const char *port_name);
@@ -728,7 +936,8 @@ void sync_pbs(struct ovsdb_idl_txn *, struct hmap *ls_ports,
               struct hmap *lr_ports,
               const struct lr_stateful_table *);
 bool sync_pbs_for_northd_changed_ovn_ports(
-    struct tracked_ovn_ports *,
+    struct tracked_ovn_ports *trk_lsps,
+    struct tracked_ovn_ports *trk_lrps,
     const struct lr_stateful_table *);
 
 static inline bool
@@ -766,6 +975,33 @@ northd_has_ls_acls_in_tracked_data(struct northd_tracked_data *trk_nd_changes)
     return trk_nd_changes->type & NORTHD_TRACKED_LS_ACLS;
 }
 
+static inline bool
+northd_has_lr_routes_in_tracked_data(
+    struct northd_tracked_data *trk_nd_changes)
+{
+    return trk_nd_changes->type & NORTHD_TRACKED_LR_ROUTES;
+}
+
+static inline bool
+northd_has_lr_policies_in_tracked_data(
+    struct northd_tracked_data *trk_nd_changes)
+{
+    return trk_nd_changes->type & NORTHD_TRACKED_LR_POLICIES;
+}
+
+static inline bool
+northd_has_ls_qos_in_tracked_data(struct northd_tracked_data *trk_nd_changes)
+{
+    return trk_nd_changes->type & NORTHD_TRACKED_LS_QOS;
+}
+
+static inline bool
+northd_has_ls_router_ports_in_tracked_data(
+    struct northd_tracked_data *trk_nd_changes)
+{
+    return trk_nd_changes->type & NORTHD_TRACKED_LS_ROUTER_PORTS;
+}
+
 /* Returns 'true' if the IPv4 'addr' is on the same subnet with one of the
  * IPs configured on the router port.
  */
@@ -0,0 +1,480 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* ovn-northd-bench runs the ovn-northd incremental processing engine against
+ * existing NB and SB databases, e.g. ovsdb-server instances serving copies
+ * of production snapshots, and reports how long the processing took.
+ *
+ * It first runs a number of full recomputes and then, optionally, replays a
+ * file of NB transactions one by one, running the engine incrementally after
+ * each of them.  The results written back to the SB are committed, so the
+ * databases should be copies that nothing else writes to (in particular, no
+ * ovn-northd should be active on them). */
+
+#include <config.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "command-line.h"
+#include "fatal-signal.h"
+#include "inc-proc-northd.h"
+#include "jsonrpc.h"
+#include "lib/inc-proc-eng.h"
+#include "lib/ovn-nb-idl.h"
+#include "lib/ovn-sb-idl.h"
+#include "lib/ovn-util.h"
+#include "northd.h"
+#include "openvswitch/dynamic-string.h"
+#include "openvswitch/json.h"
+#include "openvswitch/poll-loop.h"
+#include "openvswitch/shash.h"
+#include "openvswitch/vlog.h"
+#include "ovsdb-idl.h"
+#include "stopwatch.h"
+#include "stream.h"
+#include "timeval.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(ovn_northd_bench);
+
+/* How long to wait for the NB IDL to receive the update caused by a
+ * replayed transaction before giving up on it. */
+#define BENCH_UPDATE_TIMEOUT_MS 5000
+
+static const char *ovnnb_db;
+static const char *ovnsb_db;
+static const char *replay_file;
+static unsigned int n_recomputes = 10;
+static int n_threads = 1;
+
+struct bench_stats {
+    const char *name;
+    unsigned int count;
+    long long int total_msec;
+    long long int min_msec;
+    long long int max_msec;
+};
+
+static void
+bench_stats_add(struct bench_stats *stats, long long int msec)
+{
+    stats->min_msec = stats->count ? MIN(stats->min_msec, msec) : msec;
+    stats->max_msec = MAX(stats->max_msec, msec);
+    stats->total_msec += msec;
+    stats->count++;
+}
+
+static void
+bench_stats_print(const struct bench_stats *stats)
+{
+    printf("%s: %u runs", stats->name, stats->count);
+    if (stats->count) {
+        printf(", min %lldms, avg %.1fms, max %lldms, total %lldms",
+               stats->min_msec, (double) stats->total_msec / stats->count,
+               stats->max_msec, stats->total_msec);
+    }
+    printf("\n");
+}
+
+OVS_NO_RETURN static void
+usage(void)
+{
+    printf("\
+%s: OVN northbound processing benchmark\n\
+usage: %s [OPTIONS]\n\
+\n\
+Options:\n\
+  --ovnnb-db=DATABASE       connect to ovn-nb database at DATABASE\n\
+                            (default: %s)\n\
+  --ovnsb-db=DATABASE       connect to ovn-sb database at DATABASE\n\
+                            (default: %s)\n\
+  --recompute=N             run N full recomputes (default: %u)\n\
+  --replay=FILE             replay the NB transactions in FILE, one JSON\n\
+                            array of \"transact\" parameters per line\n\
+  --n-threads=N             use N threads, as ovn-northd --n-threads\n\
+  -h, --help                display this help message\n\
+  -V, --version             display version information\n",
+           program_name, program_name, default_nb_db(), default_sb_db(),
+           n_recomputes);
+    vlog_usage();
+    exit(EXIT_SUCCESS);
+}
+
+static void
+parse_options(int argc, char *argv[])
+{
+    enum {
+        OPT_RECOMPUTE = UCHAR_MAX + 1,
+        OPT_REPLAY,
+        OPT_N_THREADS,
+        VLOG_OPTION_ENUMS,
+    };
+    static const struct option long_options[] = {
+        {"ovnnb-db", required_argument, NULL, 'd'},
+        {"ovnsb-db", required_argument, NULL, 'D'},
+        {"recompute", required_argument, NULL, OPT_RECOMPUTE},
+        {"replay", required_argument, NULL, OPT_REPLAY},
+        {"n-threads", required_argument, NULL, OPT_N_THREADS},
+        {"help", no_argument, NULL, 'h'},
+        {"version", no_argument, NULL, 'V'},
+        VLOG_LONG_OPTIONS,
+        {NULL, 0, NULL, 0},
+    };
+    char *short_options = ovs_cmdl_long_options_to_short_options(long_options);
+
+    for (;;) {
+        int c = getopt_long(argc, argv, short_options, long_options, NULL);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        VLOG_OPTION_HANDLERS;
+
+        case 'd':
+            ovnnb_db = optarg;
+            break;
+
+        case 'D':
+            ovnsb_db = optarg;
+            break;
+
+        case OPT_RECOMPUTE:
+            if (!str_to_uint(optarg, 10, &n_recomputes)) {
+                ovs_fatal(0, "--recompute requires a non-negative integer");
+            }
+            break;
+
+        case OPT_REPLAY:
+            replay_file = optarg;
+            break;
+
+        case OPT_N_THREADS:
+            n_threads = strtoul(optarg, NULL, 10);
+            if (n_threads < 1 || n_threads > OVN_MAX_SUPPORTED_THREADS) {
+                ovs_fatal(0, "--n-threads must be within [1-%d]",
+                          OVN_MAX_SUPPORTED_THREADS);
+            }
+            break;
+
+        case 'h':
+            usage();
+            /* fall through */
+
+        case 'V':
+            ovn_print_version(0, 0);
+            exit(EXIT_SUCCESS);
+
+        case '?':
+            exit(EXIT_FAILURE);
+
+        default:
+            abort();
+        }
+    }
+    free(short_options);
+
+    if (optind < argc) {
+        ovs_fatal(0, "non-option arguments not supported");
+    }
+
+    if (!ovnnb_db) {
+        ovnnb_db = default_nb_db();
+    }
+    if (!ovnsb_db) {
+        ovnsb_db = default_sb_db();
+    }
+}
+
+/* Waits until both IDLs got the initial contents of their database. */
+static void
+bench_wait_connected(struct ovsdb_idl_loop *nb, struct ovsdb_idl_loop *sb)
+{
+    for (;;) {
+        ovsdb_idl_run(nb->idl);
+        ovsdb_idl_run(sb->idl);
+        if (ovsdb_idl_has_ever_connected(nb->idl)
+            && ovsdb_idl_has_ever_connected(sb->idl)) {
+            return;
+        }
+        ovsdb_idl_wait(nb->idl);
+        ovsdb_idl_wait(sb->idl);
+        poll_block();
+    }
+}
+
+/* Waits until the transactions being committed on 'nb' and 'sb', if any,
+ * completed. */
+static void
+bench_wait_committed(struct ovsdb_idl_loop *nb, struct ovsdb_idl_loop *sb)
+{
+    while (nb->committing_txn || sb->committing_txn) {
+        poll_block();
+        ovsdb_idl_run(nb->idl);
+        ovsdb_idl_run(sb->idl);
+        ovsdb_idl_loop_commit_and_wait(nb);
+        ovsdb_idl_loop_commit_and_wait(sb);
+    }
+}
+
+/* Runs the northd engine once, fully recomputing if 'recompute' is true,
+ * commits the resulting changes and waits for the commits to complete.
+ * Accounts the time spent in the engine in 'engine_stats' and the total
+ * time, including the commits, in 'total_stats'. */
+static void
+bench_run_engine(struct ovsdb_idl_loop *nb, struct ovsdb_idl_loop *sb,
+                 bool recompute, struct bench_stats *engine_stats,
+                 struct bench_stats *total_stats)
+{
+    struct ovsdb_idl_txn *ovnnb_txn;
+    struct ovsdb_idl_txn *ovnsb_txn;
+
+    for (;;) {
+        ovnnb_txn = ovsdb_idl_loop_run(nb);
+        ovnsb_txn = ovsdb_idl_loop_run(sb);
+        if (ovnnb_txn && ovnsb_txn) {
+            break;
+        }
+        ovsdb_idl_loop_commit_and_wait(nb);
+        ovsdb_idl_loop_commit_and_wait(sb);
+        poll_block();
+    }
+
+    struct northd_engine_context eng_ctx = {
+        .recompute = recompute,
+    };
+    long long int start = time_msec();
+    inc_proc_northd_run(ovnnb_txn, ovnsb_txn, &eng_ctx);
+    long long int engine_end = time_msec();
+
+    if (!ovsdb_idl_loop_commit_and_wait(nb)
+        || !ovsdb_idl_loop_commit_and_wait(sb)) {
+        VLOG_WARN("commit failed, next run will be a full recompute");
+        engine_set_force_recompute(true);
+    }
+    bench_wait_committed(nb, sb);
+
+    if (engine_stats) {
+        bench_stats_add(engine_stats, engine_end - start);
+    }
+    if (total_stats) {
+        bench_stats_add(total_stats, time_msec() - start);
+    }
+}
+
+static struct jsonrpc *
+bench_connect_nb(void)
+{
+    struct stream *stream;
+    int error = stream_open_block(jsonrpc_stream_open(ovnnb_db, &stream,
+                                                      DSCP_DEFAULT),
+                                  -1, &stream);
+    if (error) {
+        ovs_fatal(error, "failed to connect to \"%s\"", ovnnb_db);
+    }
+    return jsonrpc_open(stream);
+}
+
+/* Sends the transaction whose "transact" parameters are in 'line' over
+ * 'rpc' and waits for the NB IDL of 'nb' to receive the resulting update.
+ * Returns false if the transaction or the wait failed. */
+static bool
+bench_replay_txn(struct jsonrpc *rpc, struct ovsdb_idl_loop *nb,
+                 const char *line, unsigned int line_number)
+{
+    struct json *params = json_from_string(line);
+
+    if (params->type == JSON_STRING) {
+        VLOG_WARN("%s:%u: %s", replay_file, line_number,
+                  json_string(params));
+        json_destroy(params);
+        return false;
+    } else if (params->type != JSON_ARRAY) {
+        VLOG_WARN("%s:%u: transaction parameters must be an array",
+                  replay_file, line_number);
+        json_destroy(params);
+        return false;
+    }
+
+    unsigned int seqno = ovsdb_idl_get_seqno(nb->idl);
+    struct jsonrpc_msg *request = jsonrpc_create_request("transact", params,
+                                                         NULL);
+    struct jsonrpc_msg *reply;
+    int error = jsonrpc_transact_block(rpc, request, &reply);
+    if (error) {
+        ovs_fatal(error, "transaction failed");
+    }
+
+    bool ok = !reply->error;
+    if (ok && reply->result->type == JSON_ARRAY) {
+        const struct json_array *results = json_array(reply->result);
+
+        for (size_t i = 0; i < results->n; i++) {
+            const struct json *result = results->elems[i];
+
+            if (result->type == JSON_OBJECT
+                && shash_find(json_object(result), "error")) {
+                ok = false;
+            }
+        }
+    }
+    if (!ok) {
+        char *s = json_to_string(reply->error ? reply->error : reply->result,
+                                 JSSF_SORT);
+        VLOG_WARN("%s:%u: transaction failed: %s", replay_file, line_number,
+                  s);
+        free(s);
+    }
+    jsonrpc_msg_destroy(reply);
+    if (!ok) {
+        return false;
+    }
+
+    long long int deadline = time_msec() + BENCH_UPDATE_TIMEOUT_MS;
+    for (;;) {
+        ovsdb_idl_run(nb->idl);
+        if (ovsdb_idl_get_seqno(nb->idl) != seqno) {
+            return true;
+        }
+        if (time_msec() >= deadline) {
+            VLOG_WARN("%s:%u: transaction didn't change the database",
+                      replay_file, line_number);
+            return false;
+        }
+        ovsdb_idl_wait(nb->idl);
+        poll_timer_wait_until(deadline);
+        poll_block();
+    }
+}
+
+static void
+bench_replay(struct ovsdb_idl_loop *nb, struct ovsdb_idl_loop *sb,
+             struct bench_stats *engine_stats,
+             struct bench_stats *total_stats)
+{
+    FILE *file = fopen(replay_file, "r");
+    if (!file) {
+        ovs_fatal(errno, "%s: open failed", replay_file);
+    }
+
+    struct jsonrpc *rpc = bench_connect_nb();
+    struct ds line = DS_EMPTY_INITIALIZER;
+    unsigned int line_number = 0;
+    unsigned int n_failed = 0;
+
+    while (!ds_get_line(&line, file)) {
+        line_number++;
+        if (!line.length || line.string[0] == '#') {
+            continue;
+        }
+        if (!bench_replay_txn(rpc, nb, ds_cstr(&line), line_number)) {
+            n_failed++;
+            continue;
+        }
+        bench_run_engine(nb, sb, false, engine_stats, total_stats);
+    }
+    if (n_failed) {
+        printf("replay: %u transactions failed or had no effect\n",
+               n_failed);
+    }
+
+    ds_destroy(&line);
+    jsonrpc_close(rpc);
+    fclose(file);
+}
+
+static void
+bench_print_stopwatches(void)
+{
+    stopwatch_sync();
+    for (size_t i = 0; i < inc_proc_northd_n_stopwatches; i++) {
+        const char *name = inc_proc_northd_stopwatches[i];
+        struct stopwatch_stats stats;
+
+        if (!stopwatch_get_stats(name, &stats) || !stats.count) {
+            continue;
+        }
+        printf("stopwatch %s: %llu samples, min %llums, max %llums, "
+               "95th percentile %.1fms\n", name, stats.count, stats.min,
+               stats.max, stats.pctl_95);
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    fatal_ignore_sigpipe();
+    ovs_cmdl_proctitle_init(argc, argv);
+    ovn_set_program_name(argv[0]);
+    parse_options(argc, argv);
+
+    struct ovsdb_idl_loop nb = OVSDB_IDL_LOOP_INITIALIZER(
+        ovsdb_idl_create(ovnnb_db, &nbrec_idl_class, true, true));
+    ovsdb_idl_track_add_all(nb.idl);
+
+    struct ovsdb_idl_loop sb = OVSDB_IDL_LOOP_INITIALIZER(
+        ovsdb_idl_create(ovnsb_db, &sbrec_idl_class, true, true));
+    ovsdb_idl_track_add_all(sb.idl);
+    ovsdb_idl_set_write_changed_only_all(sb.idl, true);
+
+    inc_proc_northd_create_stopwatches();
+    inc_proc_northd_init(&nb, &sb);
+    run_update_worker_pool(n_threads);
+
+    long long int start = time_msec();
+    bench_wait_connected(&nb, &sb);
+    printf("initial sync: %lldms\n", time_msec() - start);
+
+    /* The first run brings the SB up to date with the NB, it's not
+     * representative of a steady state recompute. */
+    struct bench_stats first = { .name = "first run" };
+    bench_run_engine(&nb, &sb, true, &first, NULL);
+    bench_stats_print(&first);
+
+    struct bench_stats recompute = { .name = "recompute" };
+    struct bench_stats recompute_total = { .name = "recompute with commit" };
+    for (unsigned int i = 0; i < n_recomputes; i++) {
+        bench_run_engine(&nb, &sb, true, &recompute, &recompute_total);
+    }
+    bench_stats_print(&recompute);
+    bench_stats_print(&recompute_total);
+
+    if (replay_file) {
+        struct bench_stats replay = { .name = "replay" };
+        struct bench_stats replay_total = { .name = "replay with commit" };
+
+        bench_replay(&nb, &sb, &replay, &replay_total);
+        bench_stats_print(&replay);
+        bench_stats_print(&replay_total);
+    }
+
+    bench_print_stopwatches();
+
+    struct rusage usage;
+    if (!getrusage(RUSAGE_SELF, &usage)) {
+        printf("peak rss: %ld kB\n", usage.ru_maxrss);
+    }
+
+    inc_proc_northd_cleanup();
+    run_update_worker_pool(0);
+    ovsdb_idl_loop_destroy(&nb);
+    ovsdb_idl_loop_destroy(&sb);
+
+    return EXIT_SUCCESS;
+}
@@ -19,10 +19,13 @@
 #include <stdio.h>
 
 #include "lib/chassis-index.h"
+#include "lib/idl-recorder.h"
 #include "command-line.h"
 #include "daemon.h"
 #include "fatal-signal.h"
+#include "hv-cfg.h"
 #include "inc-proc-northd.h"
+#include "lib/inc-proc-eng.h"
 #include "lib/ip-mcast-index.h"
 #include "lib/mcast-group-index.h"
 #include "lib/memory-trim.h"
@@ -54,18 +57,24 @@ static unixctl_cb_func ovn_northd_status;
 static unixctl_cb_func cluster_state_reset_cmd;
 static unixctl_cb_func ovn_northd_set_thread_count_cmd;
 static unixctl_cb_func ovn_northd_get_thread_count_cmd;
+static unixctl_cb_func ovn_northd_set_parallel_policy_cmd;
+static unixctl_cb_func ovn_northd_show_parallel_stats_cmd;
+static unixctl_cb_func ovn_northd_show_nb_cfg_latency_cmd;
+static unixctl_cb_func ovn_northd_clear_nb_cfg_latency_cmd;
 
 struct northd_state {
     bool had_lock;
     bool paused;
 };
 
-#define OVN_MAX_SUPPORTED_THREADS 256
-
 static const char *ovnnb_db;
 static const char *ovnsb_db;
 static const char *unixctl_path;
 
+/* Files to record the database updates into, if any. */
+static char *ovnnb_record_file;
+static char *ovnsb_record_file;
+
 /* SSL options */
 static const char *ssl_private_key_file;
 static const char *ssl_certificate_file;
@@ -469,7 +478,8 @@ update_sequence_numbers(int64_t loop_start_time,
                         struct ovsdb_idl *ovnsb_idl,
                         struct ovsdb_idl_txn *ovnnb_idl_txn,
                         struct ovsdb_idl_txn *ovnsb_idl_txn,
-                        struct ovsdb_idl_loop *sb_loop)
+                        struct ovsdb_idl_loop *sb_loop,
+                        struct hv_cfg_index *hv_cfg_index)
 {
     /* Create rows in global tables if neccessary */
     const struct nbrec_nb_global *nb = nbrec_nb_global_first(ovnnb_idl);
@@ -486,6 +496,7 @@ update_sequence_numbers(int64_t loop_start_time,
     if (nb->nb_cfg != sb->nb_cfg) {
         sbrec_sb_global_set_nb_cfg(sb, nb->nb_cfg);
         nbrec_nb_global_set_nb_cfg_timestamp(nb, loop_start_time);
+        hv_cfg_index_nb_cfg_seen(hv_cfg_index, nb->nb_cfg, loop_start_time);
     }
     sb_loop->next_cfg = nb->nb_cfg;
 
@@ -494,44 +505,22 @@ update_sequence_numbers(int64_t loop_start_time,
     if (nb && sb_cfg && nb->sb_cfg != sb_cfg) {
         nbrec_nb_global_set_sb_cfg(nb, sb_cfg);
         nbrec_nb_global_set_sb_cfg_timestamp(nb, loop_start_time);
+        hv_cfg_index_sb_cfg_committed(hv_cfg_index, sb_cfg, loop_start_time);
     }
 
     /* Update northbound hv_cfg if appropriate. */
     if (nb) {
         /* Find minimum nb_cfg among all chassis. */
-        const struct sbrec_chassis_private *chassis_priv;
-        int64_t hv_cfg = nb->nb_cfg;
-        int64_t hv_cfg_ts = 0;
-        SBREC_CHASSIS_PRIVATE_FOR_EACH (chassis_priv, ovnsb_idl) {
-            const struct sbrec_chassis *chassis = chassis_priv->chassis;
-            if (chassis) {
-                if (smap_get_bool(&chassis->other_config,
-                                  "is-remote", false)) {
-                    /* Skip remote chassises. */
-                    continue;
-                }
-            } else {
-                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 1);
-                VLOG_WARN_RL(&rl, "Chassis does not exist for "
-                             "Chassis_Private record, name: %s",
-                             chassis_priv->name);
-            }
-
-            /* Detect if overflows happened within the cfg update. */
-            int64_t delta = chassis_priv->nb_cfg - hv_cfg;
-            if (chassis_priv->nb_cfg < hv_cfg || delta > INT32_MAX) {
-                hv_cfg = chassis_priv->nb_cfg;
-                hv_cfg_ts = chassis_priv->nb_cfg_timestamp;
-            } else if (chassis_priv->nb_cfg == hv_cfg &&
-                       chassis_priv->nb_cfg_timestamp > hv_cfg_ts) {
-                hv_cfg_ts = chassis_priv->nb_cfg_timestamp;
-            }
-        }
+        int64_t hv_cfg = hv_cfg_index_run(hv_cfg_index, ovnsb_idl,
+                                          nb->nb_cfg);
 
         /* Update hv_cfg. */
         if (nb->hv_cfg != hv_cfg) {
+            int64_t hv_cfg_ts = hv_cfg_index_get_timestamp(hv_cfg_index,
+                                                           hv_cfg);
             nbrec_nb_global_set_hv_cfg(nb, hv_cfg);
             nbrec_nb_global_set_hv_cfg_timestamp(nb, hv_cfg_ts);
+            hv_cfg_index_hv_cfg_reached(hv_cfg_index, hv_cfg, hv_cfg_ts);
         }
     }
 }
@@ -548,8 +537,11 @@ Options:\n\
                             (default: %s)\n\
   --ovnsb-db=DATABASE       connect to ovn-sb database at DATABASE\n\
                             (default: %s)\n\
+  --ovnnb-record=FILE       record the updates received from ovn-nb to FILE\n\
+  --ovnsb-record=FILE       record the updates received from ovn-sb to FILE\n\
   --dry-run                 start in paused state (do not commit db changes)\n\
   --n-threads=N             specify number of threads\n\
+  --pin-threads             pin the threads to CPU cores by NUMA node\n\
   --unixctl=SOCKET          override default control socket name\n\
   -h, --help                display this help message\n\
   -o, --options             list available options\n\
@@ -570,6 +562,9 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
         SSL_OPTION_ENUMS,
         OPT_DRY_RUN,
         OPT_N_THREADS,
+        OPT_PIN_THREADS,
+        OPT_OVNNB_RECORD,
+        OPT_OVNSB_RECORD,
     };
     static const struct option long_options[] = {
         {"ovnsb-db", required_argument, NULL, 'd'},
@@ -580,6 +575,9 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
         {"version", no_argument, NULL, 'V'},
         {"dry-run", no_argument, NULL, OPT_DRY_RUN},
         {"n-threads", required_argument, NULL, OPT_N_THREADS},
+        {"pin-threads", no_argument, NULL, OPT_PIN_THREADS},
+        {"ovnnb-record", required_argument, NULL, OPT_OVNNB_RECORD},
+        {"ovnsb-record", required_argument, NULL, OPT_OVNSB_RECORD},
         OVN_DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
         STREAM_SSL_LONG_OPTIONS,
@@ -660,10 +658,24 @@ parse_options(int argc OVS_UNUSED, char *argv[] OVS_UNUSED,
             }
             break;
 
+        case OPT_PIN_THREADS:
+            ovn_set_worker_pool_numa_aware(true);
+            break;
+
         case OPT_DRY_RUN:
             *paused = true;
             break;
 
+        case OPT_OVNNB_RECORD:
+            free(ovnnb_record_file);
+            ovnnb_record_file = abs_file_name(NULL, optarg);
+            break;
+
+        case OPT_OVNSB_RECORD:
+            free(ovnsb_record_file);
+            ovnsb_record_file = abs_file_name(NULL, optarg);
+            break;
+
         default:
             break;
         }
@@ -727,30 +739,30 @@ run_idl_loop(struct ovsdb_idl_loop *idl_loop, const char *name,
 
 #define DEFAULT_NORTHD_TRIM_TO_MS 30000
 
+static struct memory_trimmer *northd_mt = NULL;
+
 static void
 run_memory_trimmer(struct ovsdb_idl *ovnnb_idl, bool activity)
 {
-    static struct memory_trimmer *mt = NULL;
-
-    if (!mt) {
-        mt = memory_trimmer_create();
+    if (!northd_mt) {
+        northd_mt = memory_trimmer_create();
     }
 
     const struct nbrec_nb_global *nb = nbrec_nb_global_first(ovnnb_idl);
     if (nb) {
-        memory_trimmer_set(mt, smap_get_uint(&nb->options,
-                                             "northd_trim_timeout",
-                                             DEFAULT_NORTHD_TRIM_TO_MS));
+        memory_trimmer_set(northd_mt,
+                           smap_get_uint(&nb->options, "northd_trim_timeout",
+                                         DEFAULT_NORTHD_TRIM_TO_MS));
     }
 
     if (activity) {
-        memory_trimmer_record_activity(mt);
+        memory_trimmer_record_activity(northd_mt);
     }
 
-    if (memory_trimmer_can_run(mt)) {
-        memory_trimmer_trim(mt);
+    if (memory_trimmer_can_run(northd_mt)) {
+        memory_trimmer_trim(northd_mt);
     }
-    memory_trimmer_wait(mt);
+    memory_trimmer_wait(northd_mt);
 }
 
 int
@@ -804,6 +816,11 @@ main(int argc, char *argv[])
     unixctl_command_register("parallel-build/get-n-threads", "", 0, 0,
                              ovn_northd_get_thread_count_cmd,
                              NULL);
+    unixctl_command_register("parallel-build/set-policy", "adaptive|always",
+                             1, 1, ovn_northd_set_parallel_policy_cmd,
+                             NULL);
+    unixctl_command_register("parallel-build/show-stats", "", 0, 0,
+                             ovn_northd_show_parallel_stats_cmd, NULL);
 
     daemonize_complete();
 
@@ -837,6 +854,26 @@ main(int argc, char *argv[])
     ovsdb_idl_omit(ovnsb_idl_loop.idl, &sbrec_sb_global_col_connections);
     ovsdb_idl_omit(ovnsb_idl_loop.idl, &sbrec_sb_global_col_ssl);
 
+    struct ovn_idl_recorder *ovnnb_recorder = NULL;
+    struct ovn_idl_recorder *ovnsb_recorder = NULL;
+    if (ovnnb_record_file) {
+        ovnnb_recorder = ovn_idl_recorder_create(ovnnb_idl_loop.idl,
+                                                 ovnnb_record_file);
+    }
+    if (ovnsb_record_file) {
+        ovnsb_recorder = ovn_idl_recorder_create(ovnsb_idl_loop.idl,
+                                                 ovnsb_record_file);
+    }
+
+    struct hv_cfg_index hv_cfg_index;
+    hv_cfg_index_init(&hv_cfg_index);
+    unixctl_command_register("nb-cfg/show-latency", "", 0, 0,
+                             ovn_northd_show_nb_cfg_latency_cmd,
+                             &hv_cfg_index);
+    unixctl_command_register("nb-cfg/clear-latency", "", 0, 0,
+                             ovn_northd_clear_nb_cfg_latency_cmd,
+                             &hv_cfg_index);
+
     /* Disable alerting for pure write-only columns. */
     ovsdb_idl_omit_alert(ovnsb_idl_loop.idl, &sbrec_sb_global_col_nb_cfg);
     ovsdb_idl_omit_alert(ovnsb_idl_loop.idl, &sbrec_address_set_col_name);
@@ -871,22 +908,7 @@ main(int argc, char *argv[])
     stopwatch_create(NORTHD_LOOP_STOPWATCH_NAME, SW_MS);
     stopwatch_create(OVNNB_DB_RUN_STOPWATCH_NAME, SW_MS);
     stopwatch_create(OVNSB_DB_RUN_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(BUILD_LFLOWS_CTX_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(CLEAR_LFLOWS_CTX_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(BUILD_LFLOWS_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_DATAPATHS_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_PORTS_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_LBS_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_LR_STATEFUL_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_LS_STATEFUL_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_IGMP_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_DP_GROUPS_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LFLOWS_TO_SB_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(PORT_GROUP_RUN_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(SYNC_METERS_RUN_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LR_NAT_RUN_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LR_STATEFUL_RUN_STOPWATCH_NAME, SW_MS);
-    stopwatch_create(LS_STATEFUL_RUN_STOPWATCH_NAME, SW_MS);
+    inc_proc_northd_create_stopwatches();
 
     /* Initialize incremental processing engine for ovn-northd */
     inc_proc_northd_init(&ovnnb_idl_loop, &ovnsb_idl_loop);
@@ -907,11 +929,16 @@ main(int argc, char *argv[])
 
             ovsdb_idl_get_memory_usage(ovnnb_idl_loop.idl, &usage);
             ovsdb_idl_get_memory_usage(ovnsb_idl_loop.idl, &usage);
+            engine_get_memory_usage(&usage);
+            if (northd_mt) {
+                memory_trimmer_get_memory_usage(northd_mt, &usage);
+            }
             memory_report(&usage);
             simap_destroy(&usage);
         }
 
         bool clear_idl_track = true;
+        bool hv_cfg_synced = false;
         if (!state.paused) {
             if (!ovsdb_idl_has_lock(ovnsb_idl_loop.idl) &&
                 !ovsdb_idl_is_lock_contended(ovnsb_idl_loop.idl))
@@ -946,6 +973,7 @@ main(int argc, char *argv[])
                 if (!new_ovnsb_cond_seqno) {
                     VLOG_INFO("OVN SB IDL reconnected, force recompute.");
                     eng_ctx.recompute = true;
+                    hv_cfg_index_invalidate(&hv_cfg_index);
                 }
                 ovnsb_cond_seqno = new_ovnsb_cond_seqno;
             }
@@ -981,7 +1009,8 @@ main(int argc, char *argv[])
                                             ovnnb_idl_loop.idl,
                                             ovnsb_idl_loop.idl,
                                             ovnnb_txn, ovnsb_txn,
-                                            &ovnsb_idl_loop);
+                                            &ovnsb_idl_loop, &hv_cfg_index);
+                    hv_cfg_synced = true;
                 } else if (!eng_ctx.recompute) {
                     clear_idl_track = false;
                 }
@@ -1034,6 +1063,16 @@ main(int argc, char *argv[])
         }
 
         if (clear_idl_track) {
+            if (ovnnb_recorder) {
+                ovn_idl_recorder_run(ovnnb_recorder);
+            }
+            if (ovnsb_recorder) {
+                ovn_idl_recorder_run(ovnsb_recorder);
+            }
+            if (!hv_cfg_synced) {
+                /* The Chassis_Private changes are lost. */
+                hv_cfg_index_invalidate(&hv_cfg_index);
+            }
             ovsdb_idl_track_clear(ovnnb_idl_loop.idl);
             ovsdb_idl_track_clear(ovnsb_idl_loop.idl);
         }
@@ -1080,6 +1119,11 @@ main(int argc, char *argv[])
     }
     inc_proc_northd_cleanup();
 
+    hv_cfg_index_destroy(&hv_cfg_index);
+    ovn_idl_recorder_destroy(ovnnb_recorder);
+    ovn_idl_recorder_destroy(ovnsb_recorder);
+    free(ovnnb_record_file);
+    free(ovnsb_record_file);
     ovsdb_idl_loop_destroy(&ovnnb_idl_loop);
     ovsdb_idl_loop_destroy(&ovnsb_idl_loop);
     ovn_exit_args_finish(&exit_args);
@@ -1184,3 +1228,58 @@ ovn_northd_get_thread_count_cmd(struct unixctl_conn *conn, int argc OVS_UNUSED,
     unixctl_command_reply(conn, ds_cstr(&s));
     ds_destroy(&s);
 }
+
+static void
+ovn_northd_set_parallel_policy_cmd(struct unixctl_conn *conn,
+                                   int argc OVS_UNUSED, const char *argv[],
+                                   void *aux OVS_UNUSED)
+{
+    if (!strcmp(argv[1], "adaptive")) {
+        northd_par_set_adaptive(true);
+    } else if (!strcmp(argv[1], "always")) {
+        northd_par_set_adaptive(false);
+    } else {
+        unixctl_command_reply_error(conn, "policy must be \"adaptive\" or "
+                                    "\"always\"");
+        return;
+    }
+    unixctl_command_reply(conn, NULL);
+}
+
+static void
+ovn_northd_show_parallel_stats_cmd(struct unixctl_conn *conn,
+                                   int argc OVS_UNUSED,
+                                   const char *argv[] OVS_UNUSED,
+                                   void *aux OVS_UNUSED)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+    northd_par_stats_format(&s);
+    unixctl_command_reply(conn, ds_cstr(&s));
+    ds_destroy(&s);
+}
+
+static void
+ovn_northd_show_nb_cfg_latency_cmd(struct unixctl_conn *conn,
+                                   int argc OVS_UNUSED,
+                                   const char *argv[] OVS_UNUSED,
+                                   void *hv_cfg_index_)
+{
+    const struct hv_cfg_index *hv_cfg_index = hv_cfg_index_;
+    struct ds s = DS_EMPTY_INITIALIZER;
+
+    hv_cfg_index_format_latency(hv_cfg_index, &s);
+    unixctl_command_reply(conn, ds_cstr(&s));
+    ds_destroy(&s);
+}
+
+static void
+ovn_northd_clear_nb_cfg_latency_cmd(struct unixctl_conn *conn,
+                                    int argc OVS_UNUSED,
+                                    const char *argv[] OVS_UNUSED,
+                                    void *hv_cfg_index_)
+{
+    struct hv_cfg_index *hv_cfg_index = hv_cfg_index_;
+
+    hv_cfg_index_clear_latency(hv_cfg_index);
+    unixctl_command_reply(conn, NULL);
+}
@@ -16,11 +16,15 @@
 
 #include <config.h>
 #include "tests/ovstest.h"
+#include "tests/test-utils.h"
 
 #include "openvswitch/dynamic-string.h"
+#include "openvswitch/vlog.h"
 #include "smap.h"
 #include "packets.h"
-#include "bitmap.h"
+#include "random.h"
+#include "timeval.h"
+#include "lib/hbitmap.h"
 
 #include "ipam.h"
 
@@ -80,13 +84,11 @@ test_ipam_init_ipv4(struct ovs_cmdl_context *ctx)
 
     ds_put_cstr(&output, "allocated_ipv4s: ");
     if (ipam.allocated_ipv4s) {
-        int start = 0;
-        int end = ipam.total_ipv4s;
-        for (size_t bit = bitmap_scan(ipam.allocated_ipv4s, true, start, end);
-             bit != end;
-             bit = bitmap_scan(ipam.allocated_ipv4s, true, bit + 1, end)) {
-            ds_put_format(&output, IP_FMT " ",
-                          IP_ARGS((htonl(ipam.start_ipv4 + bit))));
+        for (size_t bit = 0; bit < ipam.total_ipv4s; bit++) {
+            if (hbitmap_is_set(ipam.allocated_ipv4s, bit)) {
+                ds_put_format(&output, IP_FMT " ",
+                              IP_ARGS((htonl(ipam.start_ipv4 + bit))));
+            }
         }
     }
     ds_chomp(&output, ' ');
@@ -127,6 +129,198 @@ test_ipam_init_ipv6_prefix(struct ovs_cmdl_context *ctx)
     smap_destroy(&config);
 }
 
+static void
+test_ipam_get_unused_mac(struct ovs_cmdl_context *ctx)
+{
+    const char *prefix = ctx->argv[1];
+    ovs_be32 ip;
+    int num_macs;
+
+    ovs_assert(ip_parse(ctx->argv[2], &ip));
+    str_to_int(ctx->argv[3], 0, &num_macs);
+    set_mac_prefix(prefix);
+
+    struct ds output = DS_EMPTY_INITIALIZER;
+    for (size_t i = 0; i < num_macs; i++) {
+        uint64_t mac64 = ipam_get_unused_mac(ip);
+        struct eth_addr mac;
+
+        eth_addr_from_uint64(mac64, &mac);
+        ds_put_format(&output, ETH_ADDR_FMT "\n", ETH_ADDR_ARGS(mac));
+        if (mac64) {
+            ipam_insert_mac(&mac, true);
+        }
+    }
+
+    printf("%s", ds_cstr(&output));
+
+    cleanup_macam();
+    ds_destroy(&output);
+}
+
+struct bench_latencies {
+    const char *name;
+    long long int *ns;
+    size_t n;
+};
+
+static void
+bench_latencies_init(struct bench_latencies *bl, const char *name,
+                     size_t max)
+{
+    bl->name = name;
+    bl->ns = xmalloc(MAX(max, 1) * sizeof *bl->ns);
+    bl->n = 0;
+}
+
+static long long int
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    time_timespec(&ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int
+bench_compare_ns(const void *a_, const void *b_)
+{
+    const long long int *a = a_;
+    const long long int *b = b_;
+
+    return *a < *b ? -1 : *a > *b;
+}
+
+static void
+bench_latencies_report(struct bench_latencies *bl)
+{
+    if (!bl->n) {
+        printf("%-10s: no operations\n", bl->name);
+    } else {
+        qsort(bl->ns, bl->n, sizeof *bl->ns, bench_compare_ns);
+        printf("%-10s: %"PRIuSIZE" ops, p50 %lld ns, p90 %lld ns, "
+               "p99 %lld ns, max %lld ns\n", bl->name, bl->n,
+               bl->ns[bl->n / 2], bl->ns[bl->n * 9 / 10],
+               bl->ns[bl->n * 99 / 100], bl->ns[bl->n - 1]);
+    }
+    free(bl->ns);
+}
+
+/* Benchmarks the allocation of IPs in SUBNET, e.g. 10.0.0.0/8, filled up to
+ * OCCUPANCY percent, and of as many MACs, the same way as build_ipam():
+ * both are allocated from the lowest free address.  Then runs N_OPS rounds
+ * of churn, each of them freeing a random allocated IP and allocating one
+ * again, along with a MAC. */
+static void
+test_ipam_benchmark(struct ovs_cmdl_context *ctx)
+{
+    unsigned int occupancy;
+    unsigned int n_ops;
+
+    if (!test_read_uint_value(ctx, 2, "occupancy", &occupancy)
+        || !test_read_uint_value(ctx, 3, "n_ops", &n_ops)) {
+        return;
+    }
+    if (occupancy > 100) {
+        fprintf(stderr, "occupancy must be a percentage\n");
+        return;
+    }
+
+    /* Exhausting the subnet or the MAC space is expected at 100%. */
+    vlog_set_levels(NULL, VLF_ANY_DESTINATION, VLL_OFF);
+    random_set_seed(0x1234abcd);
+
+    struct smap config = SMAP_INITIALIZER(&config);
+    smap_add(&config, "subnet", ctx->argv[1]);
+
+    long long int start = bench_now_ns();
+    struct ipam_info info;
+    init_ipam_info(&info, &config, "IPAM benchmark");
+    long long int init_ns = bench_now_ns() - start;
+    if (!info.allocated_ipv4s) {
+        fprintf(stderr, "%s: invalid subnet\n", ctx->argv[1]);
+        smap_destroy(&config);
+        destroy_ipam_info(&info);
+        return;
+    }
+    printf("subnet: %"PRIuSIZE" addresses, init %lld us\n",
+           info.total_ipv4s, init_ns / 1000);
+
+    size_t n_fill = (uint64_t) info.total_ipv4s * occupancy / 100;
+    uint32_t *ips = xmalloc(MAX(n_fill, 1) * sizeof *ips);
+    size_t n_ips = 0;
+    struct bench_latencies fill_ip, fill_mac, alloc_ip, alloc_mac, free_ip;
+    bench_latencies_init(&fill_ip, "fill ip", n_fill);
+    bench_latencies_init(&fill_mac, "fill mac", n_fill);
+    bench_latencies_init(&alloc_ip, "alloc ip", n_ops);
+    bench_latencies_init(&alloc_mac, "alloc mac", n_ops);
+    bench_latencies_init(&free_ip, "free ip", n_ops);
+    set_mac_prefix("0a:00:00");
+
+    for (size_t i = 0; i < n_fill; i++) {
+        start = bench_now_ns();
+        uint32_t ip = ipam_get_unused_ip(&info);
+        if (ip) {
+            ipam_insert_ip(&info, ip);
+        }
+        fill_ip.ns[fill_ip.n++] = bench_now_ns() - start;
+        if (!ip) {
+            break;
+        }
+        ips[n_ips++] = ip;
+
+        struct eth_addr mac;
+        start = bench_now_ns();
+        uint64_t mac64 = ipam_get_unused_mac(htonl(ip));
+        if (mac64) {
+            eth_addr_from_uint64(mac64, &mac);
+            ipam_insert_mac(&mac, false);
+        }
+        fill_mac.ns[fill_mac.n++] = bench_now_ns() - start;
+    }
+    printf("allocated %"PRIuSIZE" ips\n", n_ips);
+
+    /* Ports are deleted at random, and the next ones get the lowest free
+     * address, which is the worst case of the scan of the bitmap.  MACs are
+     * only released by the next recompute, see cleanup_macam(), so they are
+     * never freed here. */
+    for (size_t i = 0; i < n_ops && n_ips; i++) {
+        size_t idx = random_range(n_ips);
+        start = bench_now_ns();
+        hbitmap_set0(info.allocated_ipv4s, ips[idx] - info.start_ipv4);
+        free_ip.ns[free_ip.n++] = bench_now_ns() - start;
+
+        start = bench_now_ns();
+        uint32_t ip = ipam_get_unused_ip(&info);
+        if (ip) {
+            ipam_insert_ip(&info, ip);
+        }
+        alloc_ip.ns[alloc_ip.n++] = bench_now_ns() - start;
+        ovs_assert(ip);
+        ips[idx] = ip;
+
+        struct eth_addr mac;
+        start = bench_now_ns();
+        uint64_t mac64 = ipam_get_unused_mac(htonl(ip));
+        if (mac64) {
+            eth_addr_from_uint64(mac64, &mac);
+            ipam_insert_mac(&mac, false);
+        }
+        alloc_mac.ns[alloc_mac.n++] = bench_now_ns() - start;
+    }
+
+    bench_latencies_report(&fill_ip);
+    bench_latencies_report(&fill_mac);
+    bench_latencies_report(&free_ip);
+    bench_latencies_report(&alloc_ip);
+    bench_latencies_report(&alloc_mac);
+
+    free(ips);
+    cleanup_macam();
+    smap_destroy(&config);
+    destroy_ipam_info(&info);
+}
+
 static void
 test_ipam_main(int argc, char *argv[])
 {
@@ -137,6 +331,9 @@ test_ipam_main(int argc, char *argv[])
             OVS_RO},
         {"ipam_init_ipv4", NULL, 1, 2, test_ipam_init_ipv4,
             OVS_RO},
+        {"ipam_get_unused_mac", NULL, 3, 3, test_ipam_get_unused_mac,
+            OVS_RO},
+        {"ipam_benchmark", NULL, 3, 3, test_ipam_benchmark, OVS_RO},
         {NULL, NULL, 0, 0, NULL, OVS_RO},
     };
     struct ovs_cmdl_context ctx;
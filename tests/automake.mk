@@ -39,11 +39,13 @@ TESTSUITE_AT = \
 	tests/ovn-ic.at \
 	tests/ovn-macros.at \
 	tests/ovn-performance.at \
+	tests/ovn-ofctrl-diff.at \
 	tests/ovn-ofctrl-seqno.at \
 	tests/ovn-ipam.at \
 	tests/ovn-features.at \
 	tests/ovn-lflow-cache.at \
 	tests/ovn-lflow-conj-ids.at \
+	tests/ovn-resizing-hmap.at \
 	tests/ovn-ipsec.at \
 	tests/ovn-vif-plug.at \
 	tests/ovn-util.at
@@ -67,7 +69,9 @@ SYSTEM_TESTSUITE_AT = \
 
 PERF_TESTSUITE_AT = \
 	tests/perf-testsuite.at \
-	tests/perf-northd.at
+	tests/perf-northd.at \
+	tests/perf-ic.at \
+	tests/perf-controller.at
 
 MULTINODE_TESTSUITE_AT = \
 	tests/multinode-testsuite.at \
@@ -85,6 +89,7 @@ SYSTEM_USERSPACE_TESTSUITE = $(srcdir)/tests/system-userspace-testsuite
 PERF_TESTSUITE = $(srcdir)/tests/perf-testsuite
 PERF_TESTSUITE_DIR = $(abs_top_builddir)/tests/perf-testsuite.dir
 PERF_TESTSUITE_RESULTS = $(PERF_TESTSUITE_DIR)/results
+PERF_TESTSUITE_CSV = $(PERF_TESTSUITE_DIR)/results.csv
 DISTCLEANFILES += tests/atconfig tests/atlocal
 MULTINODE_TESTSUITE = $(srcdir)/tests/multinode-testsuite
 MULTINODE_TESTSUITE_DIR = $(abs_top_builddir)/tests/multinode-testsuite.dir
@@ -207,6 +212,7 @@ clean-local:
 check-perf: all
 	@mkdir -p $(PERF_TESTSUITE_DIR)
 	@echo  > $(PERF_TESTSUITE_RESULTS)
+	@echo '"test","section","metric",value' > $(PERF_TESTSUITE_CSV)
 	set $(SHELL) '$(PERF_TESTSUITE)' -C tests  AUTOTEST_PATH='$(AUTOTEST_PATH)'; \
 	"$$@" $(TESTSUITEFLAGS) -j1 || (test X'$(RECHECK)' = Xyes && "$$@" --recheck)
 	@echo
@@ -216,6 +222,7 @@ check-perf: all
 	@cat $(PERF_TESTSUITE_RESULTS)
 	@echo
 	@echo "Results can be found in $(PERF_TESTSUITE_RESULTS)"
+	@echo "Machine-readable results in $(PERF_TESTSUITE_CSV)"
 
 check-multinode: all
 	@mkdir -p $(MULTINODE_TESTSUITE_DIR)
@@ -285,8 +292,10 @@ tests_ovstest_SOURCES = \
 	tests/test-ovn.c \
 	controller/test-lflow-cache.c \
 	controller/test-lflow-conj-ids.c \
+	controller/test-ofctrl-diff.c \
 	controller/test-ofctrl-seqno.c \
 	controller/test-vif-plug.c \
+	lib/test-resizing-hmap.c \
 	lib/test-ovn-features.c \
 	northd/test-ipam.c
 
@@ -301,6 +310,7 @@ tests_ovstest_LDADD = $(OVS_LIBDIR)/daemon.lo \
 	controller/lflow-conj-ids.$(OBJEXT) \
 	controller/local_data.$(OBJEXT) \
 	controller/lport.$(OBJEXT) \
+	controller/ofctrl.$(OBJEXT) \
 	controller/ofctrl-seqno.$(OBJEXT) \
 	controller/ovsport.$(OBJEXT) \
 	controller/patch.$(OBJEXT) \
@@ -20,6 +20,7 @@
 #include <sys/wait.h>
 
 #include "command-line.h"
+#include "coverage.h"
 #include "dp-packet.h"
 #include "fatal-signal.h"
 #include "flow.h"
@@ -38,7 +39,11 @@
 #include "ovs-thread.h"
 #include "ovstest.h"
 #include "openvswitch/shash.h"
+#include "packets.h"
+#include "random.h"
 #include "simap.h"
+#include "svec.h"
+#include "timeval.h"
 #include "util.h"
 #include "controller/lflow.h"
 
@@ -61,6 +66,9 @@ static enum { OP_CONVERT, OP_SIMPLIFY, OP_NORMALIZE, OP_FLOW } operation
 /* --parallel: Number of parallel processes to use in test. */
 static int test_parallel = 1;
 
+/* --conjunctive: Normalize with expr_normalize_conjunctive(). */
+static bool test_conjunctive = false;
+
 /* -m, --more: Message verbosity */
 static int verbosity;
 
@@ -329,7 +337,9 @@ test_parse_expr__(int steps)
                                                &ports);
             }
             if (steps > 2) {
-                expr = expr_normalize(expr);
+                expr = (test_conjunctive
+                        ? expr_normalize_conjunctive(expr)
+                        : expr_normalize(expr));
                 ovs_assert(expr_is_normalized(expr));
             }
         }
@@ -393,7 +403,339 @@ test_expr_to_flows(struct ovs_cmdl_context *ctx OVS_UNUSED)
 {
     test_parse_expr__(4);
 }
+
+/* Appends to 's' a set of 'n' random IPv4 prefixes of lengths 8 to 32. */
+static void
+put_random_ip4_prefixes(struct ds *s, int n)
+{
+    ds_put_char(s, '{');
+    for (int i = 0; i < n; i++) {
+        int plen = 8 + random_range(25);
+        ovs_be32 addr = htonl(random_uint32()) & be32_prefix_mask(plen);
+
+        ds_put_format(s, "%s"IP_FMT"/%d", i ? ", " : "", IP_ARGS(addr), plen);
+    }
+    ds_put_char(s, '}');
+}
+
+/* Times the normalization of a random set of N prefixes and of the
+ * intersection of two of them. */
+static void
+test_normalize_benchmark(struct ovs_cmdl_context *ctx)
+{
+    int n = atoi(ctx->argv[1]);
+    struct shash symtab;
+
+    create_symtab(&symtab);
+    random_set_seed(0x1234abcd);
+
+    for (int n_sets = 1; n_sets <= 2; n_sets++) {
+        struct ds input = DS_EMPTY_INITIALIZER;
+        char *error;
+
+        for (int i = 0; i < n_sets; i++) {
+            ds_put_cstr(&input, i ? " && ip4.src == " : "ip4.src == ");
+            put_random_ip4_prefixes(&input, n);
+        }
+
+        struct expr *expr = expr_parse_string(ds_cstr(&input), &symtab, NULL,
+                                              NULL, NULL, NULL, 0, &error);
+        if (!error) {
+            expr = expr_annotate(expr, &symtab, &error);
+        }
+        if (error) {
+            ovs_fatal(0, "%s", error);
+        }
+        expr = expr_simplify(expr);
+
+        long long int start = time_msec();
+        expr = expr_normalize(expr);
+        long long int elapsed = time_msec() - start;
+        ovs_assert(expr_is_normalized(expr));
+
+        printf("%d set(s) of %d prefixes normalized in %lld ms\n",
+               n_sets, n, elapsed);
+
+        expr_destroy(expr);
+        ds_destroy(&input);
+    }
+
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+}
 
+/* util.c counts the calls to xmalloc() and its variants with this coverage
+ * counter, whose count() function returns and zeroes the count of the
+ * calling thread. */
+extern struct coverage_counter counter_util_xalloc;
+
+/* A stage of the expression and action pipeline, timed over 'n' runs. */
+struct bench_stage {
+    const char *name;
+    int n;
+    long long int start;
+};
+
+static void
+bench_stage_start(struct bench_stage *stage, const char *name, int n)
+{
+    stage->name = name;
+    stage->n = n;
+    counter_util_xalloc.count();
+    stage->start = time_usec();
+}
+
+static void
+bench_stage_stop(const struct bench_stage *stage)
+{
+    long long int elapsed = time_usec() - stage->start;
+    unsigned int n_allocs = counter_util_xalloc.count();
+
+    printf("  %-16s %12.0f ns/op %10.1f allocs/op\n", stage->name,
+           elapsed * 1000.0 / stage->n, (double) n_allocs / stage->n);
+}
+
+/* The match and actions of a typical logical flow. */
+struct bench_workload {
+    const char *name;
+    const char *match;
+    const char *actions;
+};
+
+/* Parses, annotates, simplifies, normalizes and converts to OpenFlow matches
+ * 'n' times the match of 'wl', then encodes its actions 'n' times, and
+ * prints the time and the number of allocations of each stage. */
+static void
+expr_benchmark_workload(const struct bench_workload *wl, int n,
+                        const struct shash *symtab,
+                        const struct shash *addr_sets,
+                        const struct shash *port_groups,
+                        const struct simap *ports,
+                        const struct ovnact_parse_params *pp,
+                        const struct ovnact_encode_params *ep)
+{
+    struct expr **exprs = xmalloc(n * sizeof *exprs);
+    struct hmap *matches = xmalloc(n * sizeof *matches);
+    struct bench_stage stage;
+    char *error;
+
+    printf("%s: %s\n", wl->name, wl->match);
+
+    bench_stage_start(&stage, "lex", n);
+    for (int i = 0; i < n; i++) {
+        struct lexer lexer;
+
+        lexer_init(&lexer, wl->match);
+        while (lexer_get(&lexer) != LEX_T_END) {
+            ovs_assert(lexer.token.type != LEX_T_ERROR);
+        }
+        lexer_destroy(&lexer);
+    }
+    bench_stage_stop(&stage);
+
+    bench_stage_start(&stage, "expr_parse", n);
+    for (int i = 0; i < n; i++) {
+        exprs[i] = expr_parse_string(wl->match, symtab, addr_sets,
+                                     port_groups, NULL, NULL, 0, &error);
+        if (error) {
+            ovs_fatal(0, "%s: %s", wl->name, error);
+        }
+    }
+    bench_stage_stop(&stage);
+
+    bench_stage_start(&stage, "expr_annotate", n);
+    for (int i = 0; i < n; i++) {
+        exprs[i] = expr_annotate(exprs[i], symtab, &error);
+        if (error) {
+            ovs_fatal(0, "%s: %s", wl->name, error);
+        }
+    }
+    bench_stage_stop(&stage);
+
+    bench_stage_start(&stage, "expr_simplify", n);
+    for (int i = 0; i < n; i++) {
+        exprs[i] = expr_simplify(exprs[i]);
+    }
+    bench_stage_stop(&stage);
+
+    bench_stage_start(&stage, "expr_normalize", n);
+    for (int i = 0; i < n; i++) {
+        exprs[i] = expr_normalize(exprs[i]);
+    }
+    bench_stage_stop(&stage);
+
+    bench_stage_start(&stage, "expr_to_matches", n);
+    for (int i = 0; i < n; i++) {
+        expr_to_matches(exprs[i], lookup_port_cb, ports, &matches[i]);
+    }
+    bench_stage_stop(&stage);
+
+    size_t n_matches = hmap_count(&matches[0]);
+    for (int i = 0; i < n; i++) {
+        expr_matches_destroy(&matches[i]);
+        expr_destroy(exprs[i]);
+    }
+
+    struct ofpbuf ovnacts;
+    struct expr *prereqs;
+
+    ofpbuf_init(&ovnacts, 0);
+    error = ovnacts_parse_string(wl->actions, pp, &ovnacts, &prereqs);
+    if (error) {
+        ovs_fatal(0, "%s: %s", wl->name, error);
+    }
+
+    struct ofpbuf ofpacts;
+    ofpbuf_init(&ofpacts, 0);
+    bench_stage_start(&stage, "ovnacts_encode", n);
+    for (int i = 0; i < n; i++) {
+        ofpbuf_clear(&ofpacts);
+        ovnacts_encode(ovnacts.data, ovnacts.size, ep, &ofpacts);
+    }
+    bench_stage_stop(&stage);
+    printf("  %"PRIuSIZE" matches, %"PRIu32" bytes of actions\n",
+           n_matches, ofpacts.size);
+
+    ofpbuf_uninit(&ofpacts);
+    expr_destroy(prereqs);
+    ovnacts_free(ovnacts.data, ovnacts.size);
+    ofpbuf_uninit(&ovnacts);
+    free(matches);
+    free(exprs);
+}
+
+/* Times each stage of the processing of typical ACL, port security and load
+ * balancer logical flows, N times each, with an address set of SIZE
+ * addresses and a port group of SIZE / 10 ports. */
+static void
+test_expr_benchmark(struct ovs_cmdl_context *ctx)
+{
+    int n = atoi(ctx->argv[1]);
+    int size = ctx->argc > 2 ? atoi(ctx->argv[2]) : 1000;
+    int n_ports = MAX(size / 10, 1);
+
+    if (n <= 0 || size <= 0) {
+        ovs_fatal(0, "N and SIZE must be positive");
+    }
+
+    struct shash symtab;
+    struct hmap dhcp_opts;
+    struct hmap dhcpv6_opts;
+    struct hmap nd_ra_opts;
+    struct controller_event_options event_opts;
+
+    create_symtab(&symtab);
+    create_gen_opts(&dhcp_opts, &dhcpv6_opts, &nd_ra_opts, &event_opts);
+    random_set_seed(0x1234abcd);
+
+    struct shash addr_sets = SHASH_INITIALIZER(&addr_sets);
+    struct svec addrs = SVEC_EMPTY_INITIALIZER;
+    for (int i = 0; i < size; i++) {
+        ovs_be32 addr = htonl(0x0a000000 | (random_uint32() & 0xffffff));
+        svec_add_nocopy(&addrs, xasprintf(IP_FMT, IP_ARGS(addr)));
+    }
+    expr_const_sets_add_integers(&addr_sets, "as_big",
+                                 (const char *const *) addrs.names, addrs.n);
+
+    struct shash port_groups = SHASH_INITIALIZER(&port_groups);
+    struct simap ports = SIMAP_INITIALIZER(&ports);
+    struct svec pg_ports = SVEC_EMPTY_INITIALIZER;
+    for (int i = 0; i < n_ports; i++) {
+        char *name = xasprintf("lsp%d", i + 1);
+        simap_put(&ports, name, i + 1);
+        svec_add_nocopy(&pg_ports, name);
+    }
+    expr_const_sets_add_strings(&port_groups, "0_pg_big",
+                                (const char *const *) pg_ports.names,
+                                pg_ports.n, NULL);
+
+    struct ovn_extend_table group_table;
+    ovn_extend_table_init(&group_table, "group-table", OFPG_MAX);
+    struct ovn_extend_table meter_table;
+    ovn_extend_table_init(&meter_table, "meter-table", OFPM13_MAX);
+    struct flow_collector_ids collector_ids;
+    flow_collector_ids_init(&collector_ids);
+
+    const struct ovnact_parse_params pp = {
+        .symtab = &symtab,
+        .dhcp_opts = &dhcp_opts,
+        .dhcpv6_opts = &dhcpv6_opts,
+        .nd_ra_opts = &nd_ra_opts,
+        .controller_event_opts = &event_opts,
+        .n_tables = 24,
+        .cur_ltable = 10,
+    };
+    const struct ovnact_encode_params ep = {
+        .lookup_port = lookup_port_cb,
+        .tunnel_ofport = lookup_tunnel_ofport,
+        .aux = &ports,
+        .is_switch = true,
+        .group_table = &group_table,
+        .meter_table = &meter_table,
+        .collector_ids = &collector_ids,
+
+        .pipeline = OVNACT_P_INGRESS,
+        .ingress_ptable = OFTABLE_LOG_INGRESS_PIPELINE,
+        .egress_ptable = OFTABLE_LOG_EGRESS_PIPELINE,
+        .output_ptable = OFTABLE_SAVE_INPORT,
+        .mac_bind_ptable = OFTABLE_MAC_BINDING,
+        .mac_lookup_ptable = OFTABLE_MAC_LOOKUP,
+        .lb_hairpin_ptable = OFTABLE_CHK_LB_HAIRPIN,
+        .lb_hairpin_reply_ptable = OFTABLE_CHK_LB_HAIRPIN_REPLY,
+        .ct_snat_vip_ptable = OFTABLE_CT_SNAT_HAIRPIN,
+        .fdb_ptable = OFTABLE_GET_FDB,
+        .fdb_lookup_ptable = OFTABLE_LOOKUP_FDB,
+        .common_nat_ct_zone = MFF_LOG_DNAT_ZONE,
+        .in_port_sec_ptable = OFTABLE_CHK_IN_PORT_SEC,
+        .out_port_sec_ptable = OFTABLE_CHK_OUT_PORT_SEC,
+        .mac_cache_use_table = OFTABLE_MAC_CACHE_USE,
+        .dp_key = 0xabcdef,
+    };
+
+    static const struct bench_workload workloads[] = {
+        {
+            "acl",
+            "outport == @pg_big && ip4 && ip4.src == $as_big "
+            "&& tcp && tcp.dst == {22, 80, 443}",
+            "reg0[1] = 1; next;",
+        },
+        {
+            "port-security",
+            "inport == \"lsp1\" && eth.src == 00:00:00:00:00:01 "
+            "&& ip4.src == {10.0.0.1, 10.0.0.2} && ip4.dst != 10.0.0.0/8",
+            "next;",
+        },
+        {
+            "load-balancer",
+            "ct.new && ip4 && ip4.dst == 30.0.0.10 && tcp "
+            "&& tcp.dst == 80 && inport == \"lsp1\"",
+            "ct_lb_mark(backends=192.168.0.1:80,192.168.0.2:80,"
+            "192.168.0.3:80);",
+        },
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(workloads); i++) {
+        expr_benchmark_workload(&workloads[i], n, &symtab, &addr_sets,
+                                &port_groups, &ports, &pp, &ep);
+    }
+
+    ovn_extend_table_destroy(&group_table);
+    ovn_extend_table_destroy(&meter_table);
+    flow_collector_ids_destroy(&collector_ids);
+    svec_destroy(&pg_ports);
+    simap_destroy(&ports);
+    expr_const_sets_destroy(&port_groups);
+    shash_destroy(&port_groups);
+    svec_destroy(&addrs);
+    expr_const_sets_destroy(&addr_sets);
+    shash_destroy(&addr_sets);
+    dhcp_opts_destroy(&dhcp_opts);
+    dhcp_opts_destroy(&dhcpv6_opts);
+    nd_ra_opts_destroy(&nd_ra_opts);
+    controller_event_opts_destroy(&event_opts);
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+}
+
 /* Print the symbol table. */
 
 static void
@@ -451,7 +793,12 @@ test_evaluate_expr(struct ovs_cmdl_context *ctx)
             expr = expr_annotate(expr, &symtab, &error);
         }
         if (!error) {
-            printf("%d\n", expr_evaluate(expr, &uflow, lookup_atoi_cb, NULL));
+            bool result = expr_evaluate(expr, &uflow, lookup_atoi_cb, NULL);
+            struct expr_program *prog = expr_compile(expr, lookup_atoi_cb,
+                                                     NULL);
+            ovs_assert(expr_program_evaluate(prog, &uflow) == result);
+            expr_program_destroy(prog);
+            printf("%d\n", result);
         } else {
             puts(error);
             free(error);
@@ -935,7 +1282,9 @@ test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
             ovs_assert(expr_honors_invariants(modified));
 
             if (operation >= OP_NORMALIZE) {
-                modified = expr_normalize(modified);
+                modified = (test_conjunctive
+                            ? expr_normalize_conjunctive(modified)
+                            : expr_normalize(modified));
                 ovs_assert(expr_honors_invariants(modified));
                 ovs_assert(expr_is_normalized(modified));
             }
@@ -957,6 +1306,8 @@ test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
                                   m->conjunctions, m->n);
             }
         }
+        struct expr_program *prog = expr_compile(modified, lookup_atoi_cb,
+                                                 NULL);
         for (int subst = 0; subst < 1 << (n_bits * n_nvars + n_svars);
              subst++) {
             for (int i = 0; i < n_nvars; i++) {
@@ -969,6 +1320,7 @@ test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
 
             bool expected = expr_evaluate(expr, &f, lookup_atoi_cb, NULL);
             bool actual = expr_evaluate(modified, &f, lookup_atoi_cb, NULL);
+            ovs_assert(expr_program_evaluate(prog, &f) == actual);
             if (actual != expected) {
                 struct ds expr_s, modified_s;
 
@@ -1034,6 +1386,7 @@ test_tree_shape_exhaustively(struct expr *expr, struct shash *symtab,
                 }
             }
         }
+        expr_program_destroy(prog);
         if (operation >= OP_FLOW) {
             struct test_rule *test_rule;
 
@@ -1318,6 +1671,8 @@ test_parse_actions(struct ovs_cmdl_context *ctx OVS_UNUSED)
     simap_put(&ports, "LOCAL", ofp_to_u16(OFPP_LOCAL));
     simap_put(&ports, "lsp1", 0x11);
 
+    struct ovnacts_encode_cache *encode_cache = ovnacts_encode_cache_create();
+
     ds_init(&input);
     while (!ds_get_test_line(&input, stdin)) {
         struct ofpbuf ovnacts;
@@ -1382,10 +1737,25 @@ test_parse_actions(struct ovs_cmdl_context *ctx OVS_UNUSED)
             };
             struct ofpbuf ofpacts;
             ofpbuf_init(&ofpacts, 0);
-            ovnacts_encode(ovnacts.data, ovnacts.size, &ep, &ofpacts);
+            const struct ofpbuf *encoded = ovnacts_encode_cached(
+                encode_cache, ds_cstr(&input), pp.cur_ltable,
+                ovnacts.data, ovnacts.size, &ep, &ofpacts);
+            if (encoded != &ofpacts) {
+                /* The actions were cached, check that the cached encoding
+                 * is found again and is the same as a fresh one. */
+                ovnacts_encode(ovnacts.data, ovnacts.size, &ep, &ofpacts);
+                if (ovnacts_encode_cached(encode_cache, ds_cstr(&input),
+                                          pp.cur_ltable, ovnacts.data,
+                                          ovnacts.size, &ep, &ofpacts)
+                       != encoded
+                    || !ofpbuf_equal(encoded, &ofpacts)) {
+                    printf("    bad cached encoding\n");
+                    ok = false;
+                }
+            }
             struct ds ofpacts_s = DS_EMPTY_INITIALIZER;
             struct ofpact_format_params fp = { .s = &ofpacts_s };
-            ofpacts_format(ofpacts.data, ofpacts.size, &fp);
+            ofpacts_format(encoded->data, encoded->size, &fp);
             char *ofpacts_cstr = ds_cstr(&ofpacts_s);
             printf("    encodes as %s\n", ofpacts_cstr);
             print_group_info(&group_table, ofpacts_cstr);
@@ -1437,6 +1807,7 @@ test_parse_actions(struct ovs_cmdl_context *ctx OVS_UNUSED)
     }
     ds_destroy(&input);
 
+    ovnacts_encode_cache_destroy(encode_cache);
     simap_destroy(&ports);
     expr_symtab_destroy(&symtab);
     shash_destroy(&symtab);
@@ -1451,6 +1822,104 @@ test_parse_actions(struct ovs_cmdl_context *ctx OVS_UNUSED)
     exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
+/* Tunnel key allocation. */
+
+/* Reference implementation of ovn_allocate_tnlid(), probing keys one by one
+ * starting right after '*hint'. */
+static uint32_t
+ref_allocate_tnlid(bool *used, uint32_t min, uint32_t max, uint32_t *hint)
+{
+    *hint = *hint + 1 <= max ? *hint + 1 : min;
+    if (*hint < min) {
+        *hint = min;
+    }
+
+    uint32_t tnlid = *hint;
+    do {
+        if (!used[tnlid]) {
+            used[tnlid] = true;
+            *hint = tnlid;
+            return tnlid;
+        }
+        tnlid = tnlid + 1 <= max ? tnlid + 1 : min;
+    } while (tnlid != *hint);
+
+    return 0;
+}
+
+static void
+test_tnlid_allocation(struct ovs_cmdl_context *ctx)
+{
+    enum { MIN_KEY = 100, MAX_KEY = 5099, N_KEYS = 10000 };
+    int n = atoi(ctx->argv[1]);
+    bool *used = xcalloc(N_KEYS, sizeof *used);
+    uint32_t hint = 0, ref_hint = 0;
+    struct ovn_tnlids tnlids;
+
+    ovn_tnlids_init(&tnlids, MIN_KEY, MAX_KEY);
+    for (int i = 0; i < n; i++) {
+        uint32_t key = random_range(N_KEYS);
+        uint32_t op = random_range(10);
+
+        if (op == 0) {
+            /* Keys both inside and outside of the allocation range. */
+            ovs_assert(ovn_add_tnlid(&tnlids, key) == !used[key]);
+            used[key] = true;
+        } else if (op <= 2) {
+            ovs_assert(ovn_free_tnlid(&tnlids, key) == used[key]);
+            used[key] = false;
+        } else {
+            uint32_t min = op == 3 ? MIN_KEY + 1000 : MIN_KEY;
+            uint32_t max = op == 4 ? MAX_KEY - 1000 : MAX_KEY;
+            uint32_t expected = ref_allocate_tnlid(used, min, max, &ref_hint);
+            uint32_t tnlid = ovn_allocate_tnlid(&tnlids, "test", min, max,
+                                                &hint);
+            if (tnlid != expected || hint != ref_hint) {
+                ovs_fatal(0, "allocated tunnel key %"PRIu32" (hint %"PRIu32
+                          "), expected %"PRIu32" (hint %"PRIu32")",
+                          tnlid, hint, expected, ref_hint);
+            }
+        }
+        ovs_assert(ovn_tnlid_present(&tnlids, key) == used[key]);
+    }
+
+    ovn_destroy_tnlids(&tnlids);
+    free(used);
+}
+
+/* Formats FMT with the arguments ARG... as a struct ovn_fmt, checks that
+ * its hash is the one of the formatted string and prints it. */
+static void
+test_format_string(struct ovs_cmdl_context *ctx)
+{
+    struct ovn_fmt fmt = {
+        .fmt = ctx->argv[1],
+        .args = (const char *const *) &ctx->argv[2],
+        .n_args = ctx->argc - 2,
+    };
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    ovn_fmt_format(&fmt, &ds);
+    for (uint32_t basis = 0; basis < 3; basis++) {
+        ovs_assert(ovn_fmt_hash(&fmt, basis)
+                   == hash_string(ds_cstr(&ds), basis));
+    }
+    ovs_assert(ovn_fmt_equals(&fmt, ds_cstr(&ds)));
+
+    ds_put_char(&ds, 'x');
+    ovs_assert(!ovn_fmt_equals(&fmt, ds_cstr(&ds)));
+    ds_chomp(&ds, 'x');
+    if (ds.length) {
+        ds_chomp(&ds, ds.string[ds.length - 1]);
+        ovs_assert(!ovn_fmt_equals(&fmt, ds_cstr(&ds)));
+    }
+
+    ds_clear(&ds);
+    ovn_fmt_format(&fmt, &ds);
+    printf("%s\n", ds_cstr(&ds));
+    ds_destroy(&ds);
+}
+
 static unsigned int
 parse_relops(const char *s)
 {
@@ -1499,6 +1968,16 @@ expr-to-packets\n\
   Parses OVN expressions from stdin and prints out matching packets in\n\
   hexadecimal on stdout.\n\
 \n\
+normalize-benchmark N\n\
+  Prints the time taken to normalize a match on a set of N random IPv4\n\
+  prefixes and on the intersection of two such sets.\n\
+\n\
+expr-benchmark N [SIZE]\n\
+  Prints the time taken, in ns/op, and the number of allocations of each\n\
+  stage of the processing of typical ACL, port security and load balancer\n\
+  logical flows, over N runs, with an address set of SIZE addresses and a\n\
+  port group of SIZE / 10 ports.  SIZE defaults to 1000.\n\
+\n\
 evaluate-expr MICROFLOW\n\
   Parses OVN expressions from stdin and evaluates them against the flow\n\
   specified in MICROFLOW, which must be an expression that constrains\n\
@@ -1524,6 +2003,8 @@ exhaustive N\n\
         normalize, flow.  Default: flow.  'normalize' includes 'simplify',\n\
         'flow' includes 'simplify' and 'normalize'.\n\
     --parallel=N  Number of processes to use in parallel, default 1.\n\
+    --conjunctive  Keep disjunctions over several variables as clauses of\n\
+        conjunctive matches where possible when normalizing.\n\
    Numeric vars:\n\
     --nvars=N  Number of numeric vars to test, in range 0...4, default 2.\n\
     --bits=N  Number of bits per variable, in range 1...3, default 3.\n\
@@ -1536,6 +2017,10 @@ exhaustive N\n\
 parse-actions\n\
   Parses OVN actions from stdin and prints the equivalent OpenFlow actions\n\
   on stdout.\n\
+\n\
+tnlid-allocation N\n\
+  Runs N random tunnel key operations, checking the allocated keys\n\
+  against a reference implementation.\n\
 ",
            program_name, program_name);
     exit(EXIT_SUCCESS);
@@ -1550,7 +2035,8 @@ test_ovn_main(int argc, char *argv[])
         OPT_SVARS,
         OPT_BITS,
         OPT_OPERATION,
-        OPT_PARALLEL
+        OPT_PARALLEL,
+        OPT_CONJUNCTIVE
     };
     static const struct option long_options[] = {
         {"relops", required_argument, NULL, OPT_RELOPS},
@@ -1559,6 +2045,7 @@ test_ovn_main(int argc, char *argv[])
         {"bits", required_argument, NULL, OPT_BITS},
         {"operation", required_argument, NULL, OPT_OPERATION},
         {"parallel", required_argument, NULL, OPT_PARALLEL},
+        {"conjunctive", no_argument, NULL, OPT_CONJUNCTIVE},
         {"more", no_argument, NULL, 'm'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0},
@@ -1622,6 +2109,10 @@ test_ovn_main(int argc, char *argv[])
             test_parallel = atoi(optarg);
             break;
 
+        case OPT_CONJUNCTIVE:
+            test_conjunctive = true;
+            break;
+
         case 'm':
             verbosity++;
             break;
@@ -1657,10 +2148,18 @@ test_ovn_main(int argc, char *argv[])
         {"tree-shape", NULL, 1, 1, test_tree_shape, OVS_RO},
         {"exhaustive", NULL, 1, 1, test_exhaustive, OVS_RO},
         {"expr-to-packets", NULL, 0, 0, test_expr_to_packets, OVS_RO},
+        {"normalize-benchmark", NULL, 1, 1, test_normalize_benchmark, OVS_RO},
+        {"expr-benchmark", NULL, 1, 2, test_expr_benchmark, OVS_RO},
 
         /* Actions. */
         {"parse-actions", NULL, 0, 0, test_parse_actions, OVS_RO},
 
+        /* Tunnel keys. */
+        {"tnlid-allocation", NULL, 1, 1, test_tnlid_allocation, OVS_RO},
+
+        /* Structured strings. */
+        {"format-string", NULL, 1, INT_MAX, test_format_string, OVS_RO},
+
         {NULL, NULL, 0, 0, NULL, OVS_RO},
     };
     struct ovs_cmdl_context ctx;
@@ -267,7 +267,7 @@ main_loop(const struct ovn_dbctl_options *dbctl_options,
           const char *args, struct ctl_command *commands, size_t n_commands,
           struct ovsdb_idl *idl, const struct timer *wait_timeout)
 {
-    unsigned int seqno;
+    unsigned int seqno, cond_seqno;
     bool idl_ready;
 
     /* Execute the commands.
@@ -276,8 +276,13 @@ main_loop(const struct ovn_dbctl_options *dbctl_options,
      * execute our transaction.  There's no point in trying to commit more than
      * once for any given sequence number, because if the transaction fails
      * it's because the database changed and we need to obtain an up-to-date
-     * view of the database before we try the transaction again. */
+     * view of the database before we try the transaction again.
+     *
+     * 'cond_seqno' is the same for the monitor conditions, since a command
+     * that changed them needs to try again once they are acknowledged, even
+     * if that doesn't change the database contents. */
     seqno = ovsdb_idl_get_seqno(idl);
+    cond_seqno = ovsdb_idl_get_condition_seqno(idl);
 
     /* IDL might have already obtained the database copy during previous
      * invocation. If so, we can't expect the sequence number to change before
@@ -291,9 +296,11 @@ main_loop(const struct ovn_dbctl_options *dbctl_options,
                       db, ovs_retval_to_string(retval));
         }
 
-        if (idl_ready || seqno != ovsdb_idl_get_seqno(idl)) {
+        if (idl_ready || seqno != ovsdb_idl_get_seqno(idl)
+            || cond_seqno != ovsdb_idl_get_condition_seqno(idl)) {
             idl_ready = false;
             seqno = ovsdb_idl_get_seqno(idl);
+            cond_seqno = ovsdb_idl_get_condition_seqno(idl);
 
             bool retry;
             char *error = do_dbctl(dbctl_options,
@@ -307,7 +314,8 @@ main_loop(const struct ovn_dbctl_options *dbctl_options,
             }
         }
 
-        if (seqno == ovsdb_idl_get_seqno(idl)) {
+        if (seqno == ovsdb_idl_get_seqno(idl)
+            && cond_seqno == ovsdb_idl_get_condition_seqno(idl)) {
             ovsdb_idl_wait(idl);
             poll_block();
         }
@@ -35,6 +35,7 @@
 #include "ovn-dbctl.h"
 #include "packets.h"
 #include "openvswitch/poll-loop.h"
+#include "ovsdb-data.h"
 #include "process.h"
 #include "simap.h"
 #include "smap.h"
@@ -47,6 +48,7 @@
 #include "timer.h"
 #include "unixctl.h"
 #include "util.h"
+#include "uuidset.h"
 #include "openvswitch/vlog.h"
 #include "bitmap.h"
 
@@ -498,6 +500,11 @@ MAC_Binding commands:\n\
                                     Delete Static_MAC_Binding entry\n\
   static-mac-binding-list           List all Static_MAC_Binding entries\n\
 \n\
+Bulk commands:\n\
+  [--may-exist] bulk-load FILE\n\
+                            create the switches, ports, ACLs and load\n\
+                            balancers described in JSON FILE\n\
+\n\
 %s\
 %s\
 \n\
@@ -892,6 +899,117 @@ nbctl_sync(struct ctl_context *ctx OVS_UNUSED)
 {
 }
 
+/* Conditional monitoring for "show" with a switch or router argument.
+ *
+ * Without any condition, "show" retrieves the whole Logical_Switch,
+ * Logical_Router and port tables, which takes seconds on large databases
+ * to print a single switch or router.  When the database has not been
+ * retrieved yet, nbctl_pre_show() only monitors the switches and routers
+ * with the requested name or UUID, and none of their children.  The
+ * children are only referred to by UUID, so nbctl_show_cond_update() then
+ * adds the UUIDs of the children of the rows that were received to the
+ * conditions of the child tables, and makes the command try again until the
+ * server acknowledged them. */
+static bool show_cond_active;
+static struct uuidset show_cond_uuids = UUIDSET_INITIALIZER(&show_cond_uuids);
+static unsigned int show_cond_seqno;
+
+static const struct ovsdb_idl_table_class *show_cond_child_tables[] = {
+    &nbrec_table_logical_switch_port,
+    &nbrec_table_logical_router_port,
+    &nbrec_table_nat,
+    &nbrec_table_gateway_chassis,
+};
+
+/* The IDL has no column for "_uuid", which monitor conditions can refer
+ * to nevertheless. */
+static const struct ovsdb_idl_column nbctl_uuid_column = {
+    .name = "_uuid",
+    .type = OVSDB_TYPE_SCALAR_INITIALIZER(OVSDB_BASE_UUID_INIT),
+};
+
+static void
+nbctl_add_clause_uuid(struct ovsdb_idl_condition *cond,
+                      const struct uuid *uuid)
+{
+    union ovsdb_atom key = { .uuid = *uuid };
+    struct ovsdb_datum datum = { .n = 1, .keys = &key };
+
+    ovsdb_idl_condition_add_clause(cond, OVSDB_F_EQ, &nbctl_uuid_column,
+                                   &datum);
+}
+
+/* Sets the condition of all the child tables to the rows of
+ * 'show_cond_uuids'. */
+static void
+nbctl_show_cond_set_children(struct ovsdb_idl *idl)
+{
+    struct ovsdb_idl_condition cond = OVSDB_IDL_CONDITION_INIT(&cond);
+
+    const struct uuidset_node *node;
+    UUIDSET_FOR_EACH (node, &show_cond_uuids) {
+        nbctl_add_clause_uuid(&cond, &node->uuid);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(show_cond_child_tables); i++) {
+        show_cond_seqno = ovsdb_idl_set_condition(idl,
+                                                  show_cond_child_tables[i],
+                                                  &cond);
+    }
+    ovsdb_idl_condition_destroy(&cond);
+}
+
+/* Adds the UUIDs of the column 'datum' to 'show_cond_uuids'.  Returns true
+ * if any of them is new. */
+static bool
+nbctl_show_cond_add(const struct ovsdb_datum *datum)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < datum->n; i++) {
+        if (!uuidset_find(&show_cond_uuids, &datum->keys[i].uuid)) {
+            uuidset_insert(&show_cond_uuids, &datum->keys[i].uuid);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/* Makes sure that the children of 'ls' and 'lr' are monitored.  Returns false
+ * if the command must be tried again once the server has sent them. */
+static bool
+nbctl_show_cond_update(struct ctl_context *ctx,
+                       const struct nbrec_logical_switch *ls,
+                       const struct nbrec_logical_router *lr)
+{
+    if (!show_cond_active) {
+        return true;
+    }
+
+    /* 'ls->ports' and the like only contain the rows that were received,
+     * so use the raw columns to get all the UUIDs. */
+    bool changed = false;
+    if (ls) {
+        changed |= nbctl_show_cond_add(
+            nbrec_logical_switch_get_ports(ls, OVSDB_TYPE_UUID));
+    }
+    if (lr) {
+        changed |= nbctl_show_cond_add(
+            nbrec_logical_router_get_ports(lr, OVSDB_TYPE_UUID));
+        changed |= nbctl_show_cond_add(
+            nbrec_logical_router_get_nat(lr, OVSDB_TYPE_UUID));
+        for (size_t i = 0; i < lr->n_ports; i++) {
+            changed |= nbctl_show_cond_add(
+                nbrec_logical_router_port_get_gateway_chassis(
+                    lr->ports[i], OVSDB_TYPE_UUID));
+        }
+    }
+    if (changed) {
+        nbctl_show_cond_set_children(ctx->idl);
+    }
+
+    return ovsdb_idl_get_condition_seqno(ctx->idl) == show_cond_seqno;
+}
+
 static void
 nbctl_pre_show(struct ctl_context *ctx)
 {
@@ -924,39 +1042,61 @@ nbctl_pre_show(struct ctl_context *ctx)
     ovsdb_idl_add_column(ctx->idl, &nbrec_nat_col_external_port_range);
     ovsdb_idl_add_column(ctx->idl, &nbrec_nat_col_logical_ip);
     ovsdb_idl_add_column(ctx->idl, &nbrec_nat_col_type);
+
+    if (ctx->argc == 2 && !show_cond_active
+        && !ovsdb_idl_has_ever_connected(ctx->idl)) {
+        struct ovsdb_idl_condition ls_cond =
+            OVSDB_IDL_CONDITION_INIT(&ls_cond);
+        struct ovsdb_idl_condition lr_cond =
+            OVSDB_IDL_CONDITION_INIT(&lr_cond);
+        const char *id = ctx->argv[1];
+        struct uuid uuid;
+
+        nbrec_logical_switch_add_clause_name(&ls_cond, OVSDB_F_EQ, id);
+        nbrec_logical_router_add_clause_name(&lr_cond, OVSDB_F_EQ, id);
+        if (uuid_from_string(&uuid, id)) {
+            nbctl_add_clause_uuid(&ls_cond, &uuid);
+            nbctl_add_clause_uuid(&lr_cond, &uuid);
+        }
+        nbrec_logical_switch_set_condition(ctx->idl, &ls_cond);
+        nbrec_logical_router_set_condition(ctx->idl, &lr_cond);
+        nbctl_show_cond_set_children(ctx->idl);
+        ovsdb_idl_condition_destroy(&ls_cond);
+        ovsdb_idl_condition_destroy(&lr_cond);
+        show_cond_active = true;
+    }
 }
 
 static void
 nbctl_show(struct ctl_context *ctx)
 {
     const struct nbrec_logical_switch *ls;
+    const struct nbrec_logical_router *lr;
 
     if (ctx->argc == 2) {
         char *error = ls_by_name_or_uuid(ctx, ctx->argv[1], false, &ls);
+        if (!error) {
+            error = lr_by_name_or_uuid(ctx, ctx->argv[1], false, &lr);
+        }
         if (error) {
             ctx->error = error;
             return;
         }
-        if (ls) {
-            print_ls(ls, &ctx->output);
-        }
-    } else {
-        NBREC_LOGICAL_SWITCH_FOR_EACH(ls, ctx->idl) {
-            print_ls(ls, &ctx->output);
+        if (!nbctl_show_cond_update(ctx, ls, lr)) {
+            ctx->try_again = true;
+            return;
         }
-    }
-    const struct nbrec_logical_router *lr;
 
-    if (ctx->argc == 2) {
-        char *error = lr_by_name_or_uuid(ctx, ctx->argv[1], false, &lr);
-        if (error) {
-            ctx->error = error;
-            return;
+        if (ls) {
+            print_ls(ls, &ctx->output);
         }
         if (lr) {
             print_lr(lr, &ctx->output);
         }
     } else {
+        NBREC_LOGICAL_SWITCH_FOR_EACH(ls, ctx->idl) {
+            print_ls(ls, &ctx->output);
+        }
         NBREC_LOGICAL_ROUTER_FOR_EACH(lr, ctx->idl) {
             print_lr(lr, &ctx->output);
         }
@@ -2281,6 +2421,20 @@ parse_priority(const char *arg, int64_t *priority_p)
     return NULL;
 }
 
+static char * OVS_WARN_UNUSED_RESULT
+parse_acl_action(const char *action)
+{
+    /* Validate action. */
+    if (strcmp(action, "allow") && strcmp(action, "allow-related")
+        && strcmp(action, "allow-stateless") && strcmp(action, "drop")
+        && strcmp(action, "reject") && strcmp(action, "pass")) {
+        return xasprintf("%s: action must be one of \"allow\", "
+                         "\"allow-related\", \"allow-stateless\", "
+                         "\"drop\", and \"reject\"", action);
+    }
+    return NULL;
+}
+
 static char * OVS_WARN_UNUSED_RESULT
 parse_acl_label(const char *arg, int64_t *label_p)
 {
@@ -2350,13 +2504,9 @@ nbctl_acl_add(struct ctl_context *ctx)
         return;
     }
 
-    /* Validate action. */
-    if (strcmp(action, "allow") && strcmp(action, "allow-related")
-        && strcmp(action, "allow-stateless") && strcmp(action, "drop")
-        && strcmp(action, "reject") && strcmp(action, "pass")) {
-        ctl_error(ctx, "%s: action must be one of \"allow\", "
-                  "\"allow-related\", \"allow-stateless\", \"drop\", "
-                  "and \"reject\"", action);
+    error = parse_acl_action(action);
+    if (error) {
+        ctx->error = error;
         return;
     }
 
@@ -7832,6 +7982,684 @@ nbctl_mirror_list(struct ctl_context *ctx)
     free(mirrors);
 }
 
+/* "bulk-load" command.
+ *
+ * Creates the objects described by a JSON file within the transaction of the
+ * command.  The references between the objects, and to the rows that are
+ * already in the database, are resolved through the name indexes below.
+ * They are built once for the whole file, whereas each individual command
+ * scans the referenced table again. */
+struct bulk_load {
+    struct ctl_context *ctx;
+    struct nbctl_context *nbctx;
+    bool may_exist;
+
+    /* Names and UUIDs to rows.  A NULL row means that several rows have
+     * that name. */
+    struct shash switches;      /* "struct nbrec_logical_switch"s. */
+    struct shash routers;       /* "struct nbrec_logical_router"s. */
+    struct shash port_groups;   /* "struct nbrec_port_group"s. */
+    struct shash lbs;           /* "struct nbrec_load_balancer"s. */
+};
+
+static void
+bulk_load_index_add(struct shash *index, const char *name,
+                    const struct uuid *uuid, const void *row)
+{
+    if (name[0]) {
+        struct shash_node *node = shash_find(index, name);
+        if (node) {
+            node->data = NULL;
+        } else {
+            shash_add(index, name, row);
+        }
+    }
+    if (uuid) {
+        char uuid_s[UUID_LEN + 1];
+        snprintf(uuid_s, sizeof uuid_s, UUID_FMT, UUID_ARGS(uuid));
+        shash_replace(index, uuid_s, row);
+    }
+}
+
+static void
+bulk_load_init(struct bulk_load *bl, struct ctl_context *ctx)
+{
+    *bl = (struct bulk_load) {
+        .ctx = ctx,
+        .nbctx = nbctl_context_get(ctx),
+        .may_exist = shash_find(&ctx->options, "--may-exist") != NULL,
+        .switches = SHASH_INITIALIZER(&bl->switches),
+        .routers = SHASH_INITIALIZER(&bl->routers),
+        .port_groups = SHASH_INITIALIZER(&bl->port_groups),
+        .lbs = SHASH_INITIALIZER(&bl->lbs),
+    };
+
+    const struct nbrec_logical_switch *ls;
+    NBREC_LOGICAL_SWITCH_FOR_EACH (ls, ctx->idl) {
+        bulk_load_index_add(&bl->switches, ls->name, &ls->header_.uuid, ls);
+    }
+
+    const struct nbrec_logical_router *lr;
+    NBREC_LOGICAL_ROUTER_FOR_EACH (lr, ctx->idl) {
+        bulk_load_index_add(&bl->routers, lr->name, &lr->header_.uuid, lr);
+    }
+
+    const struct nbrec_port_group *pg;
+    NBREC_PORT_GROUP_FOR_EACH (pg, ctx->idl) {
+        bulk_load_index_add(&bl->port_groups, pg->name, &pg->header_.uuid,
+                            pg);
+    }
+
+    const struct nbrec_load_balancer *lb;
+    NBREC_LOAD_BALANCER_FOR_EACH (lb, ctx->idl) {
+        bulk_load_index_add(&bl->lbs, lb->name, &lb->header_.uuid, lb);
+    }
+}
+
+static void
+bulk_load_destroy(struct bulk_load *bl)
+{
+    shash_destroy(&bl->switches);
+    shash_destroy(&bl->routers);
+    shash_destroy(&bl->port_groups);
+    shash_destroy(&bl->lbs);
+}
+
+/* Looks up 'id', a name or a UUID, in 'index'.  'what' names the kind of
+ * rows in 'index', for the error messages. */
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_find(const struct shash *index, const char *what, const char *id,
+               const void **rowp)
+{
+    const struct shash_node *node = shash_find(index, id);
+    if (!node) {
+        return xasprintf("%s: %s not found", id, what);
+    }
+    if (!node->data) {
+        return xasprintf("Multiple %s rows named '%s'.  Use a UUID.",
+                         what, id);
+    }
+    *rowp = node->data;
+    return NULL;
+}
+
+/* Stores in '*s' the string member 'key' of 'obj', or NULL if 'obj' has no
+ * such member and it is not 'required'. */
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_get_string(const struct json *obj, const char *key, bool required,
+                     const char **s)
+{
+    const struct json *value = shash_find_data(json_object(obj), key);
+
+    *s = NULL;
+    if (!value) {
+        return required ? xasprintf("missing \"%s\"", key) : NULL;
+    }
+    if (value->type != JSON_STRING) {
+        return xasprintf("\"%s\" must be a string", key);
+    }
+    *s = json_string(value);
+    return NULL;
+}
+
+/* Stores in '*n' the integer member 'key' of 'obj', which must be in the
+ * range [min, max].  '*n' is left alone if 'obj' has no such member and it
+ * is not 'required'. */
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_get_integer(const struct json *obj, const char *key, bool required,
+                      int64_t min, int64_t max, int64_t *n)
+{
+    const struct json *value = shash_find_data(json_object(obj), key);
+
+    if (!value) {
+        return required ? xasprintf("missing \"%s\"", key) : NULL;
+    }
+    if (value->type != JSON_INTEGER
+        || value->integer < min || value->integer > max) {
+        return xasprintf("\"%s\" must be an integer in range %"PRId64"..."
+                         "%"PRId64, key, min, max);
+    }
+    *n = value->integer;
+    return NULL;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_get_bool(const struct json *obj, const char *key, bool *b)
+{
+    const struct json *value = shash_find_data(json_object(obj), key);
+
+    if (!value) {
+        return NULL;
+    }
+    if (value->type != JSON_TRUE && value->type != JSON_FALSE) {
+        return xasprintf("\"%s\" must be a boolean", key);
+    }
+    *b = value->type == JSON_TRUE;
+    return NULL;
+}
+
+/* Adds to 'strings' the members of the array of strings 'key' of 'obj'. */
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_get_strings(const struct json *obj, const char *key,
+                      struct svec *strings)
+{
+    const struct json *value = shash_find_data(json_object(obj), key);
+
+    if (!value) {
+        return NULL;
+    }
+    if (value->type != JSON_ARRAY) {
+        return xasprintf("\"%s\" must be an array of strings", key);
+    }
+
+    const struct json_array *array = json_array(value);
+    for (size_t i = 0; i < array->n; i++) {
+        if (array->elems[i]->type != JSON_STRING) {
+            return xasprintf("\"%s\" must be an array of strings", key);
+        }
+        svec_add(strings, json_string(array->elems[i]));
+    }
+    return NULL;
+}
+
+/* Adds to 'smap' the members of the object of strings 'key' of 'obj'. */
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_get_smap(const struct json *obj, const char *key, struct smap *smap)
+{
+    const struct json *value = shash_find_data(json_object(obj), key);
+
+    if (!value) {
+        return NULL;
+    }
+    if (value->type != JSON_OBJECT) {
+        return xasprintf("\"%s\" must be an object of strings", key);
+    }
+
+    const struct shash_node *node;
+    SHASH_FOR_EACH (node, json_object(value)) {
+        const struct json *member = node->data;
+        if (member->type != JSON_STRING) {
+            return xasprintf("\"%s\" must be an object of strings", key);
+        }
+        smap_replace(smap, node->name, json_string(member));
+    }
+    return NULL;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_switch(struct bulk_load *bl, const struct json *obj)
+{
+    const char *name;
+    char *error = bulk_load_get_string(obj, "name", true, &name);
+    if (error) {
+        return error;
+    }
+    if (shash_find(&bl->switches, name)) {
+        return bl->may_exist
+               ? NULL
+               : xasprintf("%s: a switch with this name already exists",
+                           name);
+    }
+
+    struct smap other_config = SMAP_INITIALIZER(&other_config);
+    struct smap external_ids = SMAP_INITIALIZER(&external_ids);
+    error = bulk_load_get_smap(obj, "other_config", &other_config);
+    if (!error) {
+        error = bulk_load_get_smap(obj, "external_ids", &external_ids);
+    }
+    if (!error) {
+        const struct nbrec_logical_switch *ls =
+            nbrec_logical_switch_insert(bl->ctx->txn);
+        nbrec_logical_switch_set_name(ls, name);
+        nbrec_logical_switch_set_other_config(ls, &other_config);
+        nbrec_logical_switch_set_external_ids(ls, &external_ids);
+        bulk_load_index_add(&bl->switches, name, NULL, ls);
+    }
+    smap_destroy(&other_config);
+    smap_destroy(&external_ids);
+    return error;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_port(struct bulk_load *bl, const struct json *obj)
+{
+    const char *name, *switch_name, *type;
+    char *error = bulk_load_get_string(obj, "name", true, &name);
+    if (!error) {
+        error = bulk_load_get_string(obj, "switch", true, &switch_name);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "type", false, &type);
+    }
+    if (error) {
+        return error;
+    }
+
+    const void *row;
+    error = bulk_load_find(&bl->switches, "switch", switch_name, &row);
+    if (error) {
+        return error;
+    }
+    const struct nbrec_logical_switch *ls = row;
+
+    const struct nbrec_logical_switch *lsw =
+        shash_find_data(&bl->nbctx->lsp_to_ls_map, name);
+    if (lsw) {
+        if (!bl->may_exist) {
+            return xasprintf("%s: a port with this name already exists",
+                             name);
+        }
+        if (lsw != ls) {
+            char uuid_s[UUID_LEN + 1];
+            return xasprintf("%s: port already exists but in switch %s",
+                             name, ls_get_name(lsw, uuid_s, sizeof uuid_s));
+        }
+        return NULL;
+    }
+
+    struct svec addresses = SVEC_EMPTY_INITIALIZER;
+    struct svec port_security = SVEC_EMPTY_INITIALIZER;
+    struct smap options = SMAP_INITIALIZER(&options);
+    struct smap external_ids = SMAP_INITIALIZER(&external_ids);
+    error = bulk_load_get_strings(obj, "addresses", &addresses);
+    if (!error) {
+        error = bulk_load_get_strings(obj, "port_security", &port_security);
+    }
+    if (!error) {
+        error = bulk_load_get_smap(obj, "options", &options);
+    }
+    if (!error) {
+        error = bulk_load_get_smap(obj, "external_ids", &external_ids);
+    }
+    if (!error) {
+        const struct nbrec_logical_switch_port *lsp =
+            nbrec_logical_switch_port_insert(bl->ctx->txn);
+        nbrec_logical_switch_port_set_name(lsp, name);
+        if (type) {
+            nbrec_logical_switch_port_set_type(lsp, type);
+        }
+        nbrec_logical_switch_port_set_addresses(
+            lsp, (const char **) addresses.names, addresses.n);
+        nbrec_logical_switch_port_set_port_security(
+            lsp, (const char **) port_security.names, port_security.n);
+        nbrec_logical_switch_port_set_options(lsp, &options);
+        nbrec_logical_switch_port_set_external_ids(lsp, &external_ids);
+
+        nbrec_logical_switch_update_ports_addvalue(ls, lsp);
+        shash_add(&bl->nbctx->lsp_to_ls_map, name, ls);
+    }
+    svec_destroy(&addresses);
+    svec_destroy(&port_security);
+    smap_destroy(&options);
+    smap_destroy(&external_ids);
+    return error;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_acl(struct bulk_load *bl, const struct json *obj)
+{
+    const char *switch_name, *pg_name, *direction_s, *match, *action;
+    const char *name, *severity, *meter;
+    int64_t priority, tier = 0, label = 0;
+    bool log = false;
+
+    char *error = bulk_load_get_string(obj, "switch", false, &switch_name);
+    if (!error) {
+        error = bulk_load_get_string(obj, "port_group", false, &pg_name);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "direction", true, &direction_s);
+    }
+    if (!error) {
+        error = bulk_load_get_integer(obj, "priority", true, 0, 32767,
+                                      &priority);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "match", true, &match);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "action", true, &action);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "name", false, &name);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "severity", false, &severity);
+    }
+    if (!error) {
+        error = bulk_load_get_string(obj, "meter", false, &meter);
+    }
+    if (!error) {
+        error = bulk_load_get_bool(obj, "log", &log);
+    }
+    if (!error) {
+        error = bulk_load_get_integer(obj, "tier", false, 0, 3, &tier);
+    }
+    if (!error) {
+        error = bulk_load_get_integer(obj, "label", false, 0, UINT32_MAX,
+                                      &label);
+    }
+    if (error) {
+        return error;
+    }
+
+    if (!switch_name == !pg_name) {
+        return xstrdup("exactly one of \"switch\" and \"port_group\" "
+                       "must be specified");
+    }
+
+    const void *row;
+    error = switch_name
+            ? bulk_load_find(&bl->switches, "switch", switch_name, &row)
+            : bulk_load_find(&bl->port_groups, "port group", pg_name, &row);
+    if (error) {
+        return error;
+    }
+
+    const char *direction;
+    error = parse_direction(direction_s, &direction);
+    if (!error) {
+        error = parse_acl_action(action);
+    }
+    if (!error && severity
+        && log_severity_from_string(severity) == UINT8_MAX) {
+        error = xasprintf("bad severity: %s", severity);
+    }
+    if (!error && label && strcmp(action, "allow")
+        && strcmp(action, "allow-related")) {
+        error = xstrdup("label can only be set with actions \"allow\" or "
+                        "\"allow-related\"");
+    }
+
+    struct smap options = SMAP_INITIALIZER(&options);
+    if (!error) {
+        error = bulk_load_get_smap(obj, "options", &options);
+    }
+    if (error) {
+        smap_destroy(&options);
+        return error;
+    }
+
+    const struct nbrec_acl *acl = nbrec_acl_insert(bl->ctx->txn);
+    nbrec_acl_set_priority(acl, priority);
+    nbrec_acl_set_direction(acl, direction);
+    nbrec_acl_set_match(acl, match);
+    nbrec_acl_set_action(acl, action);
+    nbrec_acl_set_log(acl, log || severity || name || meter);
+    if (severity) {
+        nbrec_acl_set_severity(acl, severity);
+    }
+    if (name) {
+        nbrec_acl_set_name(acl, name);
+    }
+    if (meter) {
+        nbrec_acl_set_meter(acl, meter);
+    }
+    nbrec_acl_set_label(acl, label);
+    nbrec_acl_set_tier(acl, tier);
+    nbrec_acl_set_options(acl, &options);
+    smap_destroy(&options);
+
+    if (switch_name) {
+        nbrec_logical_switch_update_acls_addvalue(row, acl);
+    } else {
+        nbrec_port_group_update_acls_addvalue(row, acl);
+    }
+    return NULL;
+}
+
+/* Resolves the names of 'names' through 'index' into '*rowsp'. */
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_find_all(const struct shash *index, const char *what,
+                   const struct svec *names, const void ***rowsp)
+{
+    const void **rows = xmalloc(names->n * sizeof *rows);
+
+    for (size_t i = 0; i < names->n; i++) {
+        char *error = bulk_load_find(index, what, names->names[i], &rows[i]);
+        if (error) {
+            free(rows);
+            return error;
+        }
+    }
+    *rowsp = rows;
+    return NULL;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_vips(const struct json *obj, struct smap *vips)
+{
+    struct smap vips_in = SMAP_INITIALIZER(&vips_in);
+    char *error = bulk_load_get_smap(obj, "vips", &vips_in);
+    if (!error && smap_is_empty(&vips_in)) {
+        error = xstrdup("missing \"vips\"");
+    }
+
+    const struct smap_node *node;
+    SMAP_FOR_EACH (node, &vips_in) {
+        if (error) {
+            break;
+        }
+
+        struct ovn_lb_vip lb_vip;
+        error = ovn_lb_vip_init(&lb_vip, node->key, node->value, false,
+                                AF_INET);
+        if (!error) {
+            struct ds vip = DS_EMPTY_INITIALIZER;
+            struct ds backends = DS_EMPTY_INITIALIZER;
+
+            ovn_lb_vip_format(&lb_vip, &vip, false);
+            ovn_lb_vip_backends_format(&lb_vip, &backends);
+            smap_replace(vips, ds_cstr(&vip), ds_cstr(&backends));
+            ds_destroy(&vip);
+            ds_destroy(&backends);
+        }
+        ovn_lb_vip_destroy(&lb_vip);
+    }
+    smap_destroy(&vips_in);
+    return error;
+}
+
+static char * OVS_WARN_UNUSED_RESULT
+bulk_load_lb(struct bulk_load *bl, const struct json *obj)
+{
+    const char *name, *protocol;
+    char *error = bulk_load_get_string(obj, "name", true, &name);
+    if (!error) {
+        error = bulk_load_get_string(obj, "protocol", false, &protocol);
+    }
+    if (error) {
+        return error;
+    }
+    if (shash_find(&bl->lbs, name)) {
+        return bl->may_exist
+               ? NULL
+               : xasprintf("%s: a load balancer with this name already "
+                           "exists", name);
+    }
+    if (!protocol) {
+        protocol = "tcp";
+    } else if (strcmp(protocol, "tcp") && strcmp(protocol, "udp")
+               && strcmp(protocol, "sctp")) {
+        return xasprintf("%s: protocol must be one of \"tcp\", \"udp\", "
+                         "or \"sctp\".", protocol);
+    }
+
+    struct smap vips = SMAP_INITIALIZER(&vips);
+    struct smap options = SMAP_INITIALIZER(&options);
+    struct smap external_ids = SMAP_INITIALIZER(&external_ids);
+    struct svec switch_names = SVEC_EMPTY_INITIALIZER;
+    struct svec router_names = SVEC_EMPTY_INITIALIZER;
+    const void **switches = NULL;
+    const void **routers = NULL;
+
+    error = bulk_load_vips(obj, &vips);
+    if (!error) {
+        error = bulk_load_get_smap(obj, "options", &options);
+    }
+    if (!error) {
+        error = bulk_load_get_smap(obj, "external_ids", &external_ids);
+    }
+    if (!error) {
+        error = bulk_load_get_strings(obj, "switches", &switch_names);
+    }
+    if (!error) {
+        error = bulk_load_get_strings(obj, "routers", &router_names);
+    }
+    if (!error) {
+        error = bulk_load_find_all(&bl->switches, "switch", &switch_names,
+                                   &switches);
+    }
+    if (!error) {
+        error = bulk_load_find_all(&bl->routers, "router", &router_names,
+                                   &routers);
+    }
+    if (!error) {
+        const struct nbrec_load_balancer *lb =
+            nbrec_load_balancer_insert(bl->ctx->txn);
+        nbrec_load_balancer_set_name(lb, name);
+        nbrec_load_balancer_set_protocol(lb, protocol);
+        nbrec_load_balancer_set_vips(lb, &vips);
+        nbrec_load_balancer_set_options(lb, &options);
+        nbrec_load_balancer_set_external_ids(lb, &external_ids);
+        bulk_load_index_add(&bl->lbs, name, NULL, lb);
+
+        for (size_t i = 0; i < switch_names.n; i++) {
+            nbrec_logical_switch_update_load_balancer_addvalue(switches[i],
+                                                               lb);
+        }
+        for (size_t i = 0; i < router_names.n; i++) {
+            nbrec_logical_router_update_load_balancer_addvalue(routers[i],
+                                                               lb);
+        }
+    }
+    smap_destroy(&vips);
+    smap_destroy(&options);
+    smap_destroy(&external_ids);
+    svec_destroy(&switch_names);
+    svec_destroy(&router_names);
+    free(switches);
+    free(routers);
+    return error;
+}
+
+static void
+nbctl_pre_bulk_load(struct ctl_context *ctx)
+{
+    nbctl_pre_context(ctx);
+
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_col_acls);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_col_external_ids);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_col_load_balancer);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_col_other_config);
+
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_port_col_addresses);
+    ovsdb_idl_add_column(ctx->idl,
+                         &nbrec_logical_switch_port_col_external_ids);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_port_col_options);
+    ovsdb_idl_add_column(ctx->idl,
+                         &nbrec_logical_switch_port_col_port_security);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_switch_port_col_type);
+
+    ovsdb_idl_add_column(ctx->idl, &nbrec_logical_router_col_load_balancer);
+
+    ovsdb_idl_add_column(ctx->idl, &nbrec_port_group_col_name);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_port_group_col_acls);
+
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_action);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_direction);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_label);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_log);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_match);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_meter);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_name);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_options);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_priority);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_severity);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_acl_col_tier);
+
+    ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_external_ids);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_name);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_options);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_protocol);
+    ovsdb_idl_add_column(ctx->idl, &nbrec_load_balancer_col_vips);
+}
+
+static void
+nbctl_bulk_load(struct ctl_context *ctx)
+{
+    /* The sections are loaded in this order, so that each object can refer
+     * to the objects of the previous sections. */
+    static const struct {
+        const char *name;
+        char *(*load)(struct bulk_load *, const struct json *);
+    } sections[] = {
+        { "switches", bulk_load_switch },
+        { "ports", bulk_load_port },
+        { "acls", bulk_load_acl },
+        { "load_balancers", bulk_load_lb },
+    };
+
+    const char *file_name = ctx->argv[1];
+    struct json *json = json_from_file(file_name);
+    if (json->type == JSON_STRING) {
+        ctl_error(ctx, "%s: %s", file_name, json_string(json));
+        json_destroy(json);
+        return;
+    }
+    if (json->type != JSON_OBJECT) {
+        ctl_error(ctx, "%s: must contain a JSON object", file_name);
+        json_destroy(json);
+        return;
+    }
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, json_object(json)) {
+        size_t i;
+        for (i = 0; i < ARRAY_SIZE(sections); i++) {
+            if (!strcmp(node->name, sections[i].name)) {
+                break;
+            }
+        }
+        if (i == ARRAY_SIZE(sections)) {
+            ctl_error(ctx, "%s: unknown section \"%s\"", file_name,
+                      node->name);
+            json_destroy(json);
+            return;
+        }
+    }
+
+    struct bulk_load bl;
+    bulk_load_init(&bl, ctx);
+    for (size_t i = 0; i < ARRAY_SIZE(sections) && !ctx->error; i++) {
+        const struct json *objs = shash_find_data(json_object(json),
+                                                  sections[i].name);
+        if (!objs) {
+            continue;
+        }
+        if (objs->type != JSON_ARRAY) {
+            ctl_error(ctx, "%s: \"%s\" must be an array", file_name,
+                      sections[i].name);
+            break;
+        }
+
+        const struct json_array *array = json_array(objs);
+        for (size_t j = 0; j < array->n; j++) {
+            char *error = array->elems[j]->type == JSON_OBJECT
+                          ? sections[i].load(&bl, array->elems[j])
+                          : xstrdup("must be an object");
+            if (error) {
+                ctl_error(ctx, "%s: %s[%"PRIuSIZE"]: %s", file_name,
+                          sections[i].name, j, error);
+                free(error);
+                break;
+            }
+        }
+    }
+    bulk_load_destroy(&bl);
+    json_destroy(json);
+}
+
 static const struct ctl_table_class tables[NBREC_N_TABLES] = {
     [NBREC_TABLE_DHCP_OPTIONS].row_ids
     = {{&nbrec_logical_switch_port_col_name, NULL,
@@ -8169,6 +8997,10 @@ static const struct ctl_command_syntax nbctl_commands[] = {
       nbctl_pre_static_mac_binding, nbctl_static_mac_binding_list, NULL,
       "", RO },
 
+    /* Bulk commands. */
+    { "bulk-load", 1, 1, "FILE", nbctl_pre_bulk_load, nbctl_bulk_load, NULL,
+      "--may-exist", RW },
+
     {NULL, 0, 0, NULL, NULL, NULL, NULL, "", RO},
 };
 
@@ -60,6 +60,7 @@
 #include "timeval.h"
 #include "unixctl.h"
 #include "util.h"
+#include "uuidset.h"
 #include "svec.h"
 
 VLOG_DEFINE_THIS_MODULE(sbctl);
@@ -377,6 +378,7 @@ pre_get_info(struct ctl_context *ctx)
     ovsdb_idl_add_column(ctx->idl, &sbrec_logical_flow_col_table_id);
     ovsdb_idl_add_column(ctx->idl, &sbrec_logical_flow_col_match);
     ovsdb_idl_add_column(ctx->idl, &sbrec_logical_flow_col_external_ids);
+    ovsdb_idl_add_column(ctx->idl, &sbrec_logical_flow_col_parameters);
 
     ovsdb_idl_add_column(ctx->idl, &sbrec_logical_dp_group_col_datapaths);
 
@@ -1082,6 +1084,86 @@ print_lflow_counters(size_t n_flows, struct sbctl_lflow *lflows, struct ds *s)
     ds_put_format(s, "Total number of logical flows = %"PRIuSIZE"\n", n_flows);
 }
 
+/* Conditional monitoring of the Logical_Flow table.
+ *
+ * The Logical_Flow table is by far the largest of the southbound database,
+ * so when a single invocation of "lflow-list" or "count-flows" is given a
+ * datapath, only the flows of the requested datapaths are retrieved, rather
+ * than the whole table.  The datapath is only known once the Datapath_Binding
+ * table is retrieved, so pre_lflow_list() starts with not monitoring any flow
+ * at all, and sbctl_lflow_cond_update() then updates the condition and makes
+ * the command try again until the server acknowledged it.
+ *
+ * This is not done when the IDL has already retrieved the database, e.g. in
+ * daemon mode, since the whole table is already there. */
+static bool lflow_cond_active;
+static struct uuidset lflow_cond_dps = UUIDSET_INITIALIZER(&lflow_cond_dps);
+static unsigned int lflow_cond_seqno;
+
+static void
+pre_lflow_list(struct ctl_context *ctx)
+{
+    pre_get_info(ctx);
+
+    if (ctx->argc > 1 && !lflow_cond_active
+        && !ovsdb_idl_has_ever_connected(ctx->idl)) {
+        struct ovsdb_idl_condition cond = OVSDB_IDL_CONDITION_INIT(&cond);
+
+        lflow_cond_seqno = sbrec_logical_flow_set_condition(ctx->idl, &cond);
+        ovsdb_idl_condition_destroy(&cond);
+        lflow_cond_active = true;
+    }
+}
+
+/* Makes sure that the logical flows of 'dp', or all of them if 'dp' is NULL,
+ * are monitored.  Returns false if the command must be tried again once the
+ * server has sent them. */
+static bool
+sbctl_lflow_cond_update(struct ctl_context *ctx,
+                        const struct sbrec_datapath_binding *dp)
+{
+    if (!lflow_cond_active) {
+        return true;
+    }
+
+    struct ovsdb_idl_condition cond = OVSDB_IDL_CONDITION_INIT(&cond);
+    bool changed = false;
+    if (!dp) {
+        ovsdb_idl_condition_add_clause_true(&cond);
+        lflow_cond_active = false;
+        uuidset_clear(&lflow_cond_dps);
+        changed = true;
+    } else if (!uuidset_find(&lflow_cond_dps, &dp->header_.uuid)) {
+        uuidset_insert(&lflow_cond_dps, &dp->header_.uuid);
+
+        const struct uuidset_node *node;
+        UUIDSET_FOR_EACH (node, &lflow_cond_dps) {
+            sbrec_logical_flow_add_clause_logical_datapath(&cond, OVSDB_F_EQ,
+                                                           &node->uuid);
+        }
+
+        const struct sbrec_logical_dp_group *dp_group;
+        SBREC_LOGICAL_DP_GROUP_FOR_EACH (dp_group, ctx->idl) {
+            for (size_t i = 0; i < dp_group->n_datapaths; i++) {
+                const struct uuid *uuid =
+                    &dp_group->datapaths[i]->header_.uuid;
+                if (uuidset_find(&lflow_cond_dps, uuid)) {
+                    sbrec_logical_flow_add_clause_logical_dp_group(
+                        &cond, OVSDB_F_EQ, &dp_group->header_.uuid);
+                    break;
+                }
+            }
+        }
+        changed = true;
+    }
+    if (changed) {
+        lflow_cond_seqno = sbrec_logical_flow_set_condition(ctx->idl, &cond);
+    }
+    ovsdb_idl_condition_destroy(&cond);
+
+    return ovsdb_idl_get_condition_seqno(ctx->idl) == lflow_cond_seqno;
+}
+
 static void
 cmd_lflow_list(struct ctl_context *ctx)
 {
@@ -1109,6 +1191,11 @@ cmd_lflow_list(struct ctl_context *ctx)
 
     }
 
+    if (!sbctl_lflow_cond_update(ctx, datapath)) {
+        ctx->try_again = true;
+        return;
+    }
+
     for (size_t i = 1; i < ctx->argc; i++) {
         if (!parse_partial_uuid(ctx->argv[i])) {
             ctl_error(ctx, "%s is not a UUID or the beginning of a UUID",
@@ -1202,6 +1289,10 @@ cmd_lflow_list(struct ctl_context *ctx)
                                    "stage-name", ""),
                       curr->lflow->priority, curr->lflow->match,
                       curr->lflow->actions);
+        for (size_t j = 0; j < curr->lflow->n_parameters; j++) {
+            ds_put_format(&ctx->output, "    parameters=(%s)\n",
+                          curr->lflow->parameters[j]);
+        }
         if (vconn) {
             sbctl_dump_openflow(vconn, &curr->lflow->header_.uuid, stats,
                                 &ctx->output);
@@ -1568,14 +1659,14 @@ static const struct ctl_command_syntax sbctl_commands[] = {
 
     /* Logical flow commands */
     {"lflow-list", 0, INT_MAX, "[DATAPATH] [LFLOW...]",
-     pre_get_info, cmd_lflow_list, NULL,
+     pre_lflow_list, cmd_lflow_list, NULL,
      "--uuid,--ovs?,--stats,--vflows?", RO},
     {"dump-flows", 0, INT_MAX, "[DATAPATH] [LFLOW...]",
-     pre_get_info, cmd_lflow_list, NULL,
+     pre_lflow_list, cmd_lflow_list, NULL,
      "--uuid,--ovs?,--stats,--vflows?",
      RO}, /* Friendly alias for lflow-list */
     {"count-flows", 0, 1, "[DATAPATH]",
-     pre_get_info, cmd_lflow_list, NULL, "", RO},
+     pre_lflow_list, cmd_lflow_list, NULL, "", RO},
 
     /* IP multicast commands. */
     {"ip-multicast-flush", 0, 1, "SWITCH",
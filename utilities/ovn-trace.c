@@ -38,14 +38,17 @@
 #include "ovn/logical-fields.h"
 #include "lib/acl-log.h"
 #include "lib/ovn-l7.h"
+#include "lib/ovn-parallel-hmap.h"
 #include "lib/ovn-sb-idl.h"
 #include "lib/ovn-util.h"
+#include "ovs-thread.h"
 #include "ovsdb-idl.h"
 #include "openvswitch/poll-loop.h"
 #include "stream-ssl.h"
 #include "stream.h"
 #include "unixctl.h"
 #include "util.h"
+#include "uuidset.h"
 #include "random.h"
 
 VLOG_DEFINE_THIS_MODULE(ovntrace);
@@ -79,7 +82,7 @@ static struct vconn *vconn;
 /* --ct: Connection tracking state to use for ct_next() actions. */
 static uint32_t *ct_states;
 static size_t n_ct_states;
-static size_t ct_state_idx;
+DEFINE_STATIC_PER_THREAD_DATA(size_t, ct_state_idx, 0);
 
 /* --lb-dst: load balancer destination info. */
 static struct ovnact_ct_lb_dst lb_dst;
@@ -87,6 +90,12 @@ static struct ovnact_ct_lb_dst lb_dst;
 /* --select-id: "select" action member id. */
 static uint16_t select_id;
 
+/* --batch: File to read microflows from, "-" for stdin. */
+static const char *batch_file;
+
+/* --threads: Number of threads that trace the microflows of --batch. */
+static size_t n_threads = 1;
+
 /* --friendly-names, --no-friendly-names: Whether to substitute human-friendly
  * port and datapath names for the awkward UUIDs typically used in the actual
  * logical flows. */
@@ -95,7 +104,9 @@ static bool use_friendly_names = true;
 OVS_NO_RETURN static void usage(void);
 static void parse_options(int argc, char *argv[]);
 static char *trace(const char *datapath, const char *flow);
+static void trace_batch(void);
 static void read_db(void);
+static void update_db(void);
 static unixctl_cb_func ovntrace_exit;
 static unixctl_cb_func ovntrace_trace;
 
@@ -112,10 +123,11 @@ main(int argc, char *argv[])
     argc -= optind;
     argv += optind;
 
-    if (get_detach()) {
+    if (get_detach() || batch_file) {
         if (argc != 0) {
-            ovs_fatal(0, "non-option arguments not supported with --detach "
-                      "(use --help for help)");
+            ovs_fatal(0, "non-option arguments not supported with %s "
+                      "(use --help for help)",
+                      batch_file ? "--batch" : "--detach");
         }
     } else {
         if (argc != 1 && argc != 2) {
@@ -142,6 +154,10 @@ main(int argc, char *argv[])
     }
     ovnsb_idl = ovsdb_idl_create(db, &sbrec_idl_class, true, false);
     ovsdb_idl_set_leader_only(ovnsb_idl, leader_only);
+    if (get_detach()) {
+        /* Track changes to keep up with the database. */
+        ovsdb_idl_track_add_all(ovnsb_idl);
+    }
 
     bool already_read = false;
     for (;;) {
@@ -157,10 +173,16 @@ main(int argc, char *argv[])
             if (!already_read) {
                 already_read = true;
                 read_db();
+            } else {
+                update_db();
             }
+            ovsdb_idl_track_clear(ovnsb_idl);
 
             daemonize_complete();
-            if (!get_detach()) {
+            if (batch_file) {
+                trace_batch();
+                return 0;
+            } else if (!get_detach()) {
                 const char *dp_s = argc > 1 ? argv[0] : NULL;
                 const char *flow_s = argv[argc - 1];
                 char *output = trace(dp_s, flow_s);
@@ -206,8 +228,10 @@ parse_ct_option(const char *state_s_)
 static uint32_t
 next_ct_state(struct ds *out_comment)
 {
-    if (ct_state_idx < n_ct_states) {
-        return ct_states[ct_state_idx++];
+    size_t *idx = ct_state_idx_get();
+
+    if (*idx < n_ct_states) {
+        return ct_states[(*idx)++];
     } else {
         ds_put_format(out_comment, " /* default (use --ct to customize) */");
         return CS_ESTABLISHED | CS_TRACKED;
@@ -262,7 +286,9 @@ parse_options(int argc, char *argv[])
         SSL_OPTION_ENUMS,
         VLOG_OPTION_ENUMS,
         OPT_LB_DST,
-        OPT_SELECT_ID
+        OPT_SELECT_ID,
+        OPT_BATCH,
+        OPT_THREADS,
     };
     static const struct option long_options[] = {
         {"db", required_argument, NULL, OPT_DB},
@@ -281,6 +307,8 @@ parse_options(int argc, char *argv[])
         {"version", no_argument, NULL, 'V'},
         {"lb-dst", required_argument, NULL, OPT_LB_DST},
         {"select-id", required_argument, NULL, OPT_SELECT_ID},
+        {"batch", required_argument, NULL, OPT_BATCH},
+        {"threads", required_argument, NULL, OPT_THREADS},
         OVN_DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
         STREAM_SSL_LONG_OPTIONS,
@@ -354,6 +382,19 @@ parse_options(int argc, char *argv[])
             parse_select_option(optarg);
             break;
 
+        case OPT_BATCH:
+            batch_file = optarg;
+            break;
+
+        case OPT_THREADS: {
+            unsigned int threads;
+            if (!str_to_uint(optarg, 10, &threads) || !threads) {
+                ovs_fatal(0, "%s: bad number of threads", optarg);
+            }
+            n_threads = threads;
+            break;
+        }
+
         case 'h':
             usage();
 
@@ -382,6 +423,14 @@ parse_options(int argc, char *argv[])
     if (!detailed && !summary && !minimal) {
         detailed = true;
     }
+
+    if (batch_file && get_detach()) {
+        ovs_fatal(0, "--batch and --detach are mutually exclusive");
+    }
+    if (n_threads > 1 && ovs) {
+        /* All the traces share the OpenFlow connection. */
+        ovs_fatal(0, "--threads is not supported with --ovs");
+    }
 }
 
 static void
@@ -390,6 +439,7 @@ usage(void)
     printf("\
 %s: OVN trace utility\n\
 usage: %s [OPTIONS] [DATAPATH] MICROFLOW\n\
+       %s [OPTIONS] --batch=FILE\n\
        %s [OPTIONS] --detach\n\
 \n\
 Output format options:\n\
@@ -398,8 +448,11 @@ Output format options:\n\
   --minimal               minimum to explain externally visible behavior\n\
   --all                   provide all forms of output\n\
 Output style options:\n\
-  --no-friendly-names     do not substitute human friendly names for UUIDs\n",
-           program_name, program_name, program_name);
+  --no-friendly-names     do not substitute human friendly names for UUIDs\n\
+Batch options:\n\
+  --batch=FILE            trace each line of FILE (\"-\" for stdin)\n\
+  --threads=N             trace the lines of FILE in N threads (default: 1)\n",
+           program_name, program_name, program_name, program_name);
     daemon_usage();
     vlog_usage();
     printf("\n\
@@ -432,6 +485,13 @@ struct ovntrace_datapath {
     struct ovntrace_flow **flows;
     size_t n_flows, allocated_flows;
 
+    /* Index of 'flows' by logical table, built once all the flows have been
+     * read.  'tables[pipeline]' has 'n_tables[pipeline]' elements, indexed
+     * by table_id. */
+    struct ovntrace_table *tables[2];
+    size_t n_tables[2];
+    bool flows_changed;         /* 'flows' must be sorted and indexed. */
+
     struct hmap mac_bindings;   /* Contains "struct ovntrace_mac_binding"s. */
     struct hmap fdbs;   /* Contains "struct ovntrace_fdb"s. */
 
@@ -473,10 +533,35 @@ struct ovntrace_flow {
     int priority;
     char *match_s;
     struct expr *match;
+    struct expr_program *match_prog; /* 'match' for its datapath. */
     struct ovnact *ovnacts;
     size_t ovnacts_len;
 };
 
+/* The flows of one logical table of a datapath, which are the 'n' elements of
+ * the datapath's 'flows' that begin at 'start', in decreasing order of
+ * priority.
+ *
+ * Many flows only match packets from (in the ingress pipeline) or to (in the
+ * egress pipeline) a single logical port, e.g., the port security flows, so
+ * the flows are also indexed by that port to avoid evaluating the ones that
+ * can't match.  The offsets of the flows, relative to 'start', are kept in
+ * increasing order. */
+struct ovntrace_table {
+    size_t start, n;
+
+    struct hmap port_flows;     /* Contains "struct ovntrace_port_flows"s. */
+    size_t *any_flows;          /* Flows not limited to one logical port. */
+    size_t n_any_flows, allocated_any_flows;
+};
+
+struct ovntrace_port_flows {
+    struct hmap_node node;      /* In struct ovntrace_table's 'port_flows'. */
+    uint32_t port_key;
+    size_t *flows;
+    size_t n_flows, allocated_flows;
+};
+
 struct ovntrace_mac_binding {
     struct hmap_node node;
     uint16_t port_key;
@@ -960,9 +1045,13 @@ ovntrace_make_names_friendly(const char *in)
     return ds_steal_cstr(&out);
 }
 
+static bool ovntrace_lookup_port(const void *dp_, const char *port_name,
+                                 unsigned int *portp);
+
 static void
-parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
-                        const struct sbrec_datapath_binding *sbdb)
+parse_lflow_for_datapath__(const struct sbrec_logical_flow *sblf,
+                           const struct sbrec_datapath_binding *sbdb,
+                           const struct smap *tvars)
 {
         struct ovntrace_datapath *dp
             = ovntrace_datapath_find_by_sb_uuid(&sbdb->header_.uuid);
@@ -974,8 +1063,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
         char *error;
         struct expr *match;
         struct lex_str match_s = lexer_parse_template_string(sblf->match,
-                                                             &template_vars,
-                                                             NULL);
+                                                             tvars, NULL);
         match = expr_parse_string(lex_str_get(&match_s), &symtab,
                                   &address_sets, &port_groups, NULL, NULL,
                                   dp->tunnel_key, &error);
@@ -1004,7 +1092,7 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
         struct ofpbuf ovnacts = OFPBUF_STUB_INITIALIZER(stub);
         struct expr *prereqs;
         struct lex_str actions_s =
-            lexer_parse_template_string(sblf->actions, &template_vars, NULL);
+            lexer_parse_template_string(sblf->actions, tvars, NULL);
         error = ovnacts_parse_string(lex_str_get(&actions_s), &pp, &ovnacts,
                                      &prereqs);
         lex_str_free(&actions_s);
@@ -1043,8 +1131,18 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
         flow->source = nullable_xstrdup(smap_get(&sblf->external_ids,
                                                  "source"));
         flow->priority = sblf->priority;
-        flow->match_s = ovntrace_make_names_friendly(sblf->match);
+        if (tvars == &template_vars) {
+            flow->match_s = ovntrace_make_names_friendly(sblf->match);
+        } else {
+            /* Each tuple of parameters of the logical flow is shown with the
+             * match that it expands to. */
+            match_s = lexer_parse_template_string(sblf->match, tvars, NULL);
+            flow->match_s = ovntrace_make_names_friendly(
+                lex_str_get(&match_s));
+            lex_str_free(&match_s);
+        }
         flow->match = match;
+        flow->match_prog = expr_compile(match, ovntrace_lookup_port, dp);
         flow->ovnacts_len = ovnacts.size;
         flow->ovnacts = ofpbuf_steal_data(&ovnacts);
 
@@ -1053,6 +1151,255 @@ parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
                                    sizeof *dp->flows);
         }
         dp->flows[dp->n_flows++] = flow;
+        dp->flows_changed = true;
+}
+
+/* Parses 'sblf' for 'sbdb', as a separate flow for each of its tuples of
+ * parameters if it has any. */
+static void
+parse_lflow_for_datapath(const struct sbrec_logical_flow *sblf,
+                         const struct sbrec_datapath_binding *sbdb)
+{
+    if (!sblf->n_parameters) {
+        parse_lflow_for_datapath__(sblf, sbdb, &template_vars);
+        return;
+    }
+
+    for (size_t i = 0; i < sblf->n_parameters; i++) {
+        struct smap tvars;
+
+        smap_clone(&tvars, &template_vars);
+        char *error = lexer_parse_template_params(sblf->parameters[i],
+                                                  &tvars);
+        if (error) {
+            VLOG_WARN("%s: parsing parameters failed (%s)",
+                      sblf->parameters[i], error);
+            free(error);
+        } else {
+            parse_lflow_for_datapath__(sblf, sbdb, &tvars);
+        }
+        smap_destroy(&tvars);
+    }
+}
+
+static void
+ovntrace_flow_destroy(struct ovntrace_flow *flow)
+{
+    free(flow->stage_name);
+    free(flow->source);
+    free(flow->match_s);
+    expr_destroy(flow->match);
+    expr_program_destroy(flow->match_prog);
+    ovnacts_free(flow->ovnacts, flow->ovnacts_len);
+    free(flow->ovnacts);
+    free(flow);
+}
+
+static void
+parse_lflow(const struct sbrec_logical_flow *sblf)
+{
+    bool missing_datapath = true;
+
+    if (sblf->logical_datapath) {
+        parse_lflow_for_datapath(sblf, sblf->logical_datapath);
+        missing_datapath = false;
+    }
+
+    const struct sbrec_logical_dp_group *g = sblf->logical_dp_group;
+    for (size_t i = 0; g && i < g->n_datapaths; i++) {
+        parse_lflow_for_datapath(sblf, g->datapaths[i]);
+        missing_datapath = false;
+    }
+    if (missing_datapath) {
+        VLOG_WARN("logical flow missing datapath");
+    }
+}
+
+/* Returns the field that holds the logical port that flows in 'pipeline' are
+ * indexed by. */
+static enum mf_field_id
+ovntrace_pipeline_port_field(enum ovnact_pipeline pipeline)
+{
+    return pipeline == OVNACT_P_INGRESS ? MFF_LOG_INPORT : MFF_LOG_OUTPORT;
+}
+
+/* If 'e' is "<port_field> == <port>" with a port of 'dp', stores the tunnel
+ * key of the port in '*keyp' and returns true.  Otherwise returns false. */
+static bool
+ovntrace_cmp_get_port(const struct ovntrace_datapath *dp,
+                      const struct expr *e, enum mf_field_id port_field,
+                      uint32_t *keyp)
+{
+    unsigned int key;
+
+    if (e->type != EXPR_T_CMP
+        || e->cmp.symbol->width
+        || e->cmp.symbol->field->id != port_field
+        || e->cmp.relop != EXPR_R_EQ
+        || !ovntrace_lookup_port(dp, e->cmp.string, &key)) {
+        return false;
+    }
+    *keyp = key;
+    return true;
+}
+
+/* If 'match' can only be true when 'port_field' has a particular value,
+ * stores it in '*keyp' and returns true.  Otherwise returns false. */
+static bool
+ovntrace_match_get_port(const struct ovntrace_datapath *dp,
+                        const struct expr *match, enum mf_field_id port_field,
+                        uint32_t *keyp)
+{
+    if (match->type == EXPR_T_AND) {
+        const struct expr *sub;
+
+        LIST_FOR_EACH (sub, node, &match->andor) {
+            if (ovntrace_cmp_get_port(dp, sub, port_field, keyp)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return ovntrace_cmp_get_port(dp, match, port_field, keyp);
+}
+
+static struct ovntrace_port_flows *
+ovntrace_table_find_port_flows(const struct ovntrace_table *table,
+                               uint32_t port_key)
+{
+    struct ovntrace_port_flows *pf;
+
+    HMAP_FOR_EACH_WITH_HASH (pf, node, hash_int(port_key, 0),
+                             &table->port_flows) {
+        if (pf->port_key == port_key) {
+            return pf;
+        }
+    }
+    return NULL;
+}
+
+static void
+ovntrace_table_add_flow(const struct ovntrace_datapath *dp,
+                        struct ovntrace_table *table, size_t ofs,
+                        enum mf_field_id port_field)
+{
+    const struct ovntrace_flow *flow = dp->flows[table->start + ofs];
+    uint32_t port_key;
+
+    if (!ovntrace_match_get_port(dp, flow->match, port_field, &port_key)) {
+        if (table->n_any_flows >= table->allocated_any_flows) {
+            table->any_flows = x2nrealloc(table->any_flows,
+                                          &table->allocated_any_flows,
+                                          sizeof *table->any_flows);
+        }
+        table->any_flows[table->n_any_flows++] = ofs;
+        return;
+    }
+
+    struct ovntrace_port_flows *pf = ovntrace_table_find_port_flows(table,
+                                                                    port_key);
+    if (!pf) {
+        pf = xzalloc(sizeof *pf);
+        pf->port_key = port_key;
+        hmap_insert(&table->port_flows, &pf->node, hash_int(port_key, 0));
+    }
+    if (pf->n_flows >= pf->allocated_flows) {
+        pf->flows = x2nrealloc(pf->flows, &pf->allocated_flows,
+                               sizeof *pf->flows);
+    }
+    pf->flows[pf->n_flows++] = ofs;
+}
+
+static void
+ovntrace_datapath_clear_index(struct ovntrace_datapath *dp)
+{
+    for (size_t p = 0; p < ARRAY_SIZE(dp->tables); p++) {
+        for (size_t t = 0; t < dp->n_tables[p]; t++) {
+            struct ovntrace_table *table = &dp->tables[p][t];
+            struct ovntrace_port_flows *pf;
+
+            HMAP_FOR_EACH_POP (pf, node, &table->port_flows) {
+                free(pf->flows);
+                free(pf);
+            }
+            hmap_destroy(&table->port_flows);
+            free(table->any_flows);
+        }
+        free(dp->tables[p]);
+        dp->tables[p] = NULL;
+        dp->n_tables[p] = 0;
+    }
+}
+
+/* Builds the per-table index of the flows of 'dp', which must already be
+ * sorted with compare_flow(). */
+static void
+ovntrace_datapath_index_flows(struct ovntrace_datapath *dp)
+{
+    ovntrace_datapath_clear_index(dp);
+
+    for (size_t i = 0; i < dp->n_flows; ) {
+        const struct ovntrace_flow *flow = dp->flows[i];
+        enum ovnact_pipeline pipeline = flow->pipeline;
+        int table_id = flow->table_id;
+
+        size_t n = 1;
+        while (i + n < dp->n_flows
+               && dp->flows[i + n]->pipeline == pipeline
+               && dp->flows[i + n]->table_id == table_id) {
+            n++;
+        }
+
+        if (table_id >= 0 && table_id <= UINT8_MAX) {
+            size_t *n_tables = &dp->n_tables[pipeline];
+            if ((size_t) table_id >= *n_tables) {
+                dp->tables[pipeline] = xrealloc(
+                    dp->tables[pipeline],
+                    (table_id + 1) * sizeof *dp->tables[pipeline]);
+                for (int t = *n_tables; t <= table_id; t++) {
+                    struct ovntrace_table *table = &dp->tables[pipeline][t];
+
+                    memset(table, 0, sizeof *table);
+                    hmap_init(&table->port_flows);
+                }
+                *n_tables = table_id + 1;
+            }
+
+            struct ovntrace_table *table = &dp->tables[pipeline][table_id];
+            enum mf_field_id port_field
+                = ovntrace_pipeline_port_field(pipeline);
+
+            table->start = i;
+            table->n = n;
+            for (size_t ofs = 0; ofs < n; ofs++) {
+                ovntrace_table_add_flow(dp, table, ofs, port_field);
+            }
+        }
+        i += n;
+    }
+}
+
+static const struct ovntrace_table *
+ovntrace_datapath_get_table(const struct ovntrace_datapath *dp,
+                            uint8_t table_id, enum ovnact_pipeline pipeline)
+{
+    return (table_id < dp->n_tables[pipeline]
+            ? &dp->tables[pipeline][table_id]
+            : NULL);
+}
+
+/* Sorts and indexes the flows of the datapaths whose flows changed. */
+static void
+index_flows(void)
+{
+    struct ovntrace_datapath *dp;
+    HMAP_FOR_EACH (dp, sb_uuid_node, &datapaths) {
+        if (dp->flows_changed) {
+            qsort(dp->flows, dp->n_flows, sizeof *dp->flows, compare_flow);
+            ovntrace_datapath_index_flows(dp);
+            dp->flows_changed = false;
+        }
+    }
 }
 
 static void
@@ -1062,27 +1409,54 @@ read_flows(void)
 
     const struct sbrec_logical_flow *sblf;
     SBREC_LOGICAL_FLOW_FOR_EACH (sblf, ovnsb_idl) {
-        bool missing_datapath = true;
+        parse_lflow(sblf);
+    }
+    index_flows();
+}
 
-        if (sblf->logical_datapath) {
-            parse_lflow_for_datapath(sblf, sblf->logical_datapath);
-            missing_datapath = false;
-        }
+/* Replaces the flows of the logical flows that changed since the last time
+ * the database was read or updated, without parsing the other ones again.
+ * Only valid if the rest of the database didn't change. */
+static void
+update_flows(void)
+{
+    struct uuidset changed = UUIDSET_INITIALIZER(&changed);
+    const struct sbrec_logical_flow *sblf;
 
-        const struct sbrec_logical_dp_group *g = sblf->logical_dp_group;
-        for (size_t i = 0; g && i < g->n_datapaths; i++) {
-            parse_lflow_for_datapath(sblf, g->datapaths[i]);
-            missing_datapath = false;
-        }
-        if (missing_datapath) {
-            VLOG_WARN("logical flow missing datapath");
-        }
+    SBREC_LOGICAL_FLOW_FOR_EACH_TRACKED (sblf, ovnsb_idl) {
+        uuidset_insert(&changed, &sblf->header_.uuid);
+    }
+    if (uuidset_is_empty(&changed)) {
+        uuidset_destroy(&changed);
+        return;
     }
 
-    const struct ovntrace_datapath *dp;
+    /* A logical flow might be in any number of datapaths because of datapath
+     * groups, so look for the old versions in all of them. */
+    struct ovntrace_datapath *dp;
     HMAP_FOR_EACH (dp, sb_uuid_node, &datapaths) {
-        qsort(dp->flows, dp->n_flows, sizeof *dp->flows, compare_flow);
+        size_t n = 0;
+
+        for (size_t i = 0; i < dp->n_flows; i++) {
+            struct ovntrace_flow *flow = dp->flows[i];
+
+            if (uuidset_find(&changed, &flow->uuid)) {
+                ovntrace_flow_destroy(flow);
+                dp->flows_changed = true;
+            } else {
+                dp->flows[n++] = flow;
+            }
+        }
+        dp->n_flows = n;
+    }
+    uuidset_destroy(&changed);
+
+    SBREC_LOGICAL_FLOW_FOR_EACH_TRACKED (sblf, ovnsb_idl) {
+        if (!sbrec_logical_flow_is_deleted(sblf)) {
+            parse_lflow(sblf);
+        }
     }
+    index_flows();
 }
 
 static void
@@ -1170,6 +1544,108 @@ read_fdbs(void)
     }
 }
 
+static void
+destroy_db(void)
+{
+    struct ovntrace_datapath *dp;
+    HMAP_FOR_EACH_POP (dp, sb_uuid_node, &datapaths) {
+        struct ovntrace_mcgroup *mcgroup;
+        LIST_FOR_EACH_POP (mcgroup, list_node, &dp->mcgroups) {
+            free(mcgroup->name);
+            free(mcgroup->ports);
+            free(mcgroup);
+        }
+
+        for (size_t i = 0; i < dp->n_flows; i++) {
+            ovntrace_flow_destroy(dp->flows[i]);
+        }
+        free(dp->flows);
+        ovntrace_datapath_clear_index(dp);
+
+        struct ovntrace_mac_binding *binding;
+        HMAP_FOR_EACH_POP (binding, node, &dp->mac_bindings) {
+            free(binding);
+        }
+        hmap_destroy(&dp->mac_bindings);
+
+        struct ovntrace_fdb *fdb;
+        HMAP_FOR_EACH_POP (fdb, node, &dp->fdbs) {
+            free(fdb);
+        }
+        hmap_destroy(&dp->fdbs);
+
+        free(dp->name);
+        free(dp->name2);
+        free(dp->friendly_name);
+        free(dp);
+    }
+    hmap_destroy(&datapaths);
+
+    struct shash_node *node;
+    SHASH_FOR_EACH (node, &ports) {
+        struct ovntrace_port *port = node->data;
+
+        free(port->name);
+        free(port->name2);
+        free(CONST_CAST(char *, port->friendly_name));
+        free(port->type);
+        for (size_t i = 0; i < port->n_ps_addrs; i++) {
+            destroy_lport_addresses(&port->ps_addrs[i]);
+        }
+        free(port->ps_addrs);
+        free(port);
+    }
+    shash_destroy(&ports);
+
+    expr_const_sets_destroy(&address_sets);
+    shash_destroy(&address_sets);
+    expr_const_sets_destroy(&port_groups);
+    shash_destroy(&port_groups);
+
+    dhcp_opts_destroy(&dhcp_opts);
+    dhcp_opts_destroy(&dhcpv6_opts);
+    nd_ra_opts_destroy(&nd_ra_opts);
+    controller_event_opts_destroy(&event_opts);
+    smap_destroy(&template_vars);
+
+    expr_symtab_destroy(&symtab);
+    shash_destroy(&symtab);
+}
+
+/* Returns true if a table that ovn-trace reads, other than Logical_Flow,
+ * changed since the last time the database was read or updated. */
+static bool
+db_changed_besides_flows(void)
+{
+    return (sbrec_datapath_binding_track_get_first(ovnsb_idl)
+            || sbrec_port_binding_track_get_first(ovnsb_idl)
+            || sbrec_multicast_group_track_get_first(ovnsb_idl)
+            || sbrec_address_set_track_get_first(ovnsb_idl)
+            || sbrec_port_group_track_get_first(ovnsb_idl)
+            || sbrec_dhcp_options_track_get_first(ovnsb_idl)
+            || sbrec_dhcpv6_options_track_get_first(ovnsb_idl)
+            || sbrec_mac_binding_track_get_first(ovnsb_idl)
+            || sbrec_fdb_track_get_first(ovnsb_idl)
+            || sbrec_logical_dp_group_track_get_first(ovnsb_idl));
+}
+
+/* Brings the state read from the database up to date with its changes.
+ *
+ * The parsed logical flows depend on almost everything else that is read
+ * from the database, e.g., on the port groups and address sets that their
+ * matches refer to, so if anything else changed, everything is read again.
+ * Otherwise, only the logical flows that changed are parsed again. */
+static void
+update_db(void)
+{
+    if (db_changed_besides_flows()) {
+        destroy_db();
+        read_db();
+    } else {
+        update_flows();
+    }
+}
+
 static void
 read_db(void)
 {
@@ -1269,11 +1745,28 @@ ovntrace_flow_lookup(const struct ovntrace_datapath *dp,
                      const struct flow *uflow,
                      uint8_t table_id, enum ovnact_pipeline pipeline)
 {
-    for (size_t i = 0; i < dp->n_flows; i++) {
-        const struct ovntrace_flow *flow = dp->flows[i];
-        if (flow->pipeline == pipeline &&
-            flow->table_id == table_id &&
-            expr_evaluate(flow->match, uflow, ovntrace_lookup_port, dp)) {
+    const struct ovntrace_table *table
+        = ovntrace_datapath_get_table(dp, table_id, pipeline);
+    if (!table) {
+        return NULL;
+    }
+
+    /* Evaluate the flows that apply to any port and the ones that apply to
+     * the packet's port, merging them in priority order. */
+    enum mf_field_id port_field = ovntrace_pipeline_port_field(pipeline);
+    uint32_t port_key = uflow->regs[port_field - MFF_REG0];
+    const struct ovntrace_port_flows *pf
+        = ovntrace_table_find_port_flows(table, port_key);
+    size_t n_port_flows = pf ? pf->n_flows : 0;
+
+    for (size_t i = 0, j = 0; i < table->n_any_flows || j < n_port_flows; ) {
+        size_t ofs = (j >= n_port_flows
+                      || (i < table->n_any_flows
+                          && table->any_flows[i] < pf->flows[j])
+                      ? table->any_flows[i++]
+                      : pf->flows[j++]);
+        const struct ovntrace_flow *flow = dp->flows[table->start + ofs];
+        if (expr_program_evaluate(flow->match_prog, uflow)) {
             return flow;
         }
     }
@@ -1284,13 +1777,12 @@ static char *
 ovntrace_stage_name(const struct ovntrace_datapath *dp,
                     uint8_t table_id, enum ovnact_pipeline pipeline)
 {
-    for (size_t i = 0; i < dp->n_flows; i++) {
-        const struct ovntrace_flow *flow = dp->flows[i];
-        if (flow->pipeline == pipeline && flow->table_id == table_id) {
-            return xstrdup(flow->stage_name);;
-        }
+    const struct ovntrace_table *table
+        = ovntrace_datapath_get_table(dp, table_id, pipeline);
+    if (!table || !table->n) {
+        return NULL;
     }
-    return NULL;
+    return xstrdup(dp->flows[table->start]->stage_name);
 }
 
 /* Type of a node within a trace. */
@@ -3447,6 +3939,8 @@ trace_actions(const struct ovnact *ovnacts, size_t ovnacts_len,
             break;
         case OVNACT_MAC_CACHE_USE:
             break;
+        case OVNACT_LOOKUP_ARP_ND_RSP:
+            break;
         }
     }
     ofpbuf_uninit(&stack);
@@ -3620,8 +4114,11 @@ trace_parse(const char *dp_s, const char *flow_s,
     return NULL;
 }
 
-static char *
-trace(const char *dp_s, const char *flow_s)
+/* Traces 'flow_s' through 'dp_s' (if nonnull).  On success, stores the
+ * output of the trace in '*outputp' and returns NULL.  On failure, returns
+ * an error message.  The caller must free() the output or the error. */
+static char * OVS_WARN_UNUSED_RESULT
+trace_microflow(const char *dp_s, const char *flow_s, char **outputp)
 {
     const struct ovntrace_datapath *dp;
     struct flow uflow;
@@ -3686,7 +4183,160 @@ trace(const char *dp_s, const char *flow_s)
 
     vconn_close(vconn);
 
-    return ds_steal_cstr(&output);
+    *outputp = ds_steal_cstr(&output);
+    return NULL;
+}
+
+static char *
+trace(const char *dp_s, const char *flow_s)
+{
+    char *output;
+    char *error = trace_microflow(dp_s, flow_s, &output);
+    return error ? error : output;
+}
+
+/* Batch mode. */
+
+/* Number of lines read from --batch and traced at a time. */
+#define TRACE_BATCH_SIZE 4096
+
+struct trace_batch_job {
+    char *line;                 /* Input line, owned by the job. */
+    const char *dp_s;           /* Datapath within 'line', if any. */
+    const char *flow_s;         /* Microflow within 'line'. */
+    char *output;               /* Output of the trace, on success. */
+    char *error;                /* Error message, on failure. */
+};
+
+struct trace_batch_task {
+    struct trace_batch_job *jobs;
+    struct work_queue wq;
+};
+
+static void
+trace_batch_job_run(struct trace_batch_job *job)
+{
+    /* Every microflow uses the --ct states from the first one. */
+    *ct_state_idx_get() = 0;
+    job->error = trace_microflow(job->dp_s, job->flow_s, &job->output);
+}
+
+static void
+trace_batch_task_run(struct worker_control *control, void *task_)
+{
+    struct trace_batch_task *task = task_;
+    size_t i;
+
+    WORK_QUEUE_FOR_EACH_BUCKET (i, control->id, &task->wq) {
+        trace_batch_job_run(&task->jobs[i]);
+    }
+}
+
+/* Prints the results of the 'n' 'jobs' as JSON objects, one per line, and
+ * frees them. */
+static void
+trace_batch_print(struct trace_batch_job *jobs, size_t n)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+
+    for (size_t i = 0; i < n; i++) {
+        struct trace_batch_job *job = &jobs[i];
+        struct json *json = json_object_create();
+
+        if (job->dp_s) {
+            json_object_put_string(json, "datapath", job->dp_s);
+        }
+        json_object_put_string(json, "microflow", job->flow_s);
+        json_object_put_string(json, job->error ? "error" : "output",
+                               job->error ? job->error : job->output);
+
+        ds_clear(&s);
+        json_to_ds(json, JSSF_SORT, &s);
+        ds_put_char(&s, '\n');
+        fputs(ds_cstr(&s), stdout);
+        json_destroy(json);
+
+        free(job->line);
+        free(job->output);
+        free(job->error);
+    }
+    ds_destroy(&s);
+}
+
+/* Traces each line of --batch, which is a microflow, optionally preceded by
+ * a datapath and a tab, and prints the results as JSON lines in the same
+ * order.  Empty lines and lines that begin with # are ignored. */
+static void
+trace_batch(void)
+{
+    FILE *stream = (!strcmp(batch_file, "-")
+                    ? stdin
+                    : fopen(batch_file, "r"));
+    if (!stream) {
+        ovs_fatal(errno, "%s: open failed", batch_file);
+    }
+
+    struct worker_pool *pool = NULL;
+    struct trace_batch_task task;
+    if (n_threads > 1) {
+        update_worker_pool(n_threads, &pool, ovn_worker_task_thread);
+        if (pool) {
+            ovn_work_queue_init_for_pool(&task.wq, pool);
+        }
+    }
+
+    task.jobs = xmalloc(TRACE_BATCH_SIZE * sizeof *task.jobs);
+    struct ds line = DS_EMPTY_INITIALIZER;
+    bool eof = false;
+    while (!eof) {
+        size_t n = 0;
+        while (n < TRACE_BATCH_SIZE) {
+            if (ds_get_line(&line, stream)) {
+                eof = true;
+                break;
+            }
+
+            const char *s = ds_cstr(&line);
+            s += strspn(s, " \t");
+            if (*s == '\0' || *s == '#') {
+                continue;
+            }
+
+            struct trace_batch_job *job = &task.jobs[n++];
+            job->line = xstrdup(s);
+            job->output = job->error = NULL;
+
+            char *tab = strchr(job->line, '\t');
+            if (tab) {
+                *tab = '\0';
+                job->dp_s = job->line;
+                job->flow_s = tab + 1;
+            } else {
+                job->dp_s = NULL;
+                job->flow_s = job->line;
+            }
+        }
+
+        if (pool && n > 1) {
+            ovn_work_queue_reset(&task.wq, n);
+            run_pool_task(pool, trace_batch_task_run, &task);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                trace_batch_job_run(&task.jobs[i]);
+            }
+        }
+        trace_batch_print(task.jobs, n);
+    }
+    fflush(stdout);
+
+    ds_destroy(&line);
+    free(task.jobs);
+    if (pool) {
+        ovn_work_queue_destroy(&task.wq);
+    }
+    if (stream != stdin) {
+        fclose(stream);
+    }
 }
 
 static void